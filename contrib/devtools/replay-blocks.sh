@@ -0,0 +1,44 @@
+#!/bin/bash
+# Replays recorded block files into a scratch data directory and prints the
+# import report of izzyd, for comparing validation performance between builds.
+#
+# Usage: replay-blocks.sh <izzyd> <blk00000.dat> [<blk00001.dat> ...]
+#
+# DBCACHE and PAR fix -dbcache and -par (defaults 450 and 2), EXTRA_ARGS are
+# passed on to izzyd, and KEEP_DATADIR=1 leaves the scratch directory behind.
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <izzyd> <block file>..." >&2
+    exit 1
+fi
+
+IZZYD=$1
+shift
+DBCACHE=${DBCACHE:-450}
+PAR=${PAR:-2}
+
+LOADBLOCK_ARGS=()
+for BLOCKFILE in "$@"; do
+    if [ ! -f "$BLOCKFILE" ]; then
+        echo "No such block file: $BLOCKFILE" >&2
+        exit 1
+    fi
+    LOADBLOCK_ARGS+=("-loadblock=$(cd "$(dirname "$BLOCKFILE")" && pwd)/$(basename "$BLOCKFILE")")
+done
+
+DATADIR=$(mktemp -d "${TMPDIR:-/tmp}/izzy-replay.XXXXXX")
+if [ "$KEEP_DATADIR" != "1" ]; then
+    trap 'rm -rf "$DATADIR"' EXIT
+fi
+# An empty configuration file, so nothing of the user's own applies.
+touch "$DATADIR/izzy.conf"
+
+"$IZZYD" -datadir="$DATADIR" -conf="$DATADIR/izzy.conf" \
+    -connect=0 -listen=0 -dnsseed=0 -server=0 -disablewallet \
+    -dbcache="$DBCACHE" -par="$PAR" \
+    "${LOADBLOCK_ARGS[@]}" -stopafterblockimport -importreport \
+    $EXTRA_ARGS
+
+echo "dbcache: $DBCACHE, par: $PAR"
+grep "Import report: " "$DATADIR/debug.log" | sed 's/.*Import report: //'
@@ -37,6 +37,13 @@ bool ActiveChainManager::ApplyDisconnectionUpdateIndexToDBs(
         if (!blocktree_->UpdateAddressUnspentIndex(indexDBUpdates.addressUnspentIndex)) {
             return state.Abort("Failed to write address unspent index");
         }
+        if (!blocktree_->UpdateAddressBalances(indexDBUpdates.addressBalanceDeltas)) {
+            return state.Abort("Failed to write address balances");
+        }
+    }
+    // Vault index entries are only collected while the index is maintained
+    if (!indexDBUpdates.vaultIndex.empty() && !blocktree_->UpdateVaultIndex(indexDBUpdates.vaultIndex)) {
+        return state.Abort("Failed to write vault index");
     }
     return true;
 }
@@ -135,5 +142,5 @@ void ActiveChainManager::DisconnectBlock(
     }
     int64_t nStart = GetTimeMicros();
     status = DisconnectBlock(block,state,pindex,coins);
-    LogPrint("bench", "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+    LogPrint(LOG_BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
 }
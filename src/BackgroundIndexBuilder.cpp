@@ -0,0 +1,196 @@
+#include <BackgroundIndexBuilder.h>
+
+#include <BlockFilter.h>
+#include <BlockTransactionChecker.h>
+#include <BlockUndo.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <CoinSupply.h>
+#include <I_BlockDataReader.h>
+#include <IndexDatabaseUpdateCollector.h>
+#include <IndexDatabaseUpdates.h>
+#include <Logging.h>
+#include <primitives/block.h>
+#include <txdb.h>
+
+namespace
+{
+bool UndoDataMatchesBlock(const CBlock& block, const CBlockUndo& blockUndo)
+{
+    if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
+        return false;
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        if (blockUndo.vtxundo[i - 1].vprevout.size() != block.vtx[i].vin.size())
+            return false;
+    }
+    return true;
+}
+
+/** Outputs spent by the block, as recorded in its undo data, which is all the update collector looks up */
+void AddSpentOutputs(const CBlock& block, const CBlockUndo& blockUndo, CCoinsViewCache& view)
+{
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        const CTxUndo& txundo = blockUndo.vtxundo[i - 1];
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const COutPoint& prevout = tx.vin[j].prevout;
+            CCoinsModifier coins = view.ModifyCoins(prevout.hash);
+            if (coins->vout.size() <= prevout.n)
+                coins->vout.resize(prevout.n + 1);
+            coins->vout[prevout.n] = txundo.vprevout[j].txout;
+        }
+    }
+}
+}
+
+BackgroundIndexBuilder::BackgroundIndexBuilder(
+    BuiltIndex index,
+    CBlockTreeDB& blocktree,
+    const I_BlockDataReader& blockReader
+    ): index_(index)
+    , blocktree_(blocktree)
+    , blockReader_(blockReader)
+    , hashBestBlock_(0)
+{
+    if (!blocktree_.ReadIndexBuildProgress(GetName(), hashBestBlock_))
+        hashBestBlock_ = 0;
+}
+
+const char* BackgroundIndexBuilder::GetName() const
+{
+    switch (index_) {
+    case BuiltIndex::TX_INDEX:
+        return "txindex";
+    case BuiltIndex::ADDRESS_INDEX:
+        return "addressindex";
+    case BuiltIndex::SPENT_INDEX:
+        return "spentindex";
+    case BuiltIndex::BLOCK_FILTER_INDEX:
+        return "blockfilterindex";
+    case BuiltIndex::SUPPLY_INDEX:
+        return "supplyindex";
+    case BuiltIndex::VAULT_INDEX:
+        return "vaultindex";
+    }
+    return "unknown";
+}
+
+bool BackgroundIndexBuilder::CollectUpdates(const CBlockIndex* pindex, bool fDisconnect, IndexDatabaseUpdates& updates) const
+{
+    CBlock block;
+    if (!blockReader_.ReadBlock(pindex, block))
+        return error("%s : failed to read block %s", __func__, pindex->GetBlockHash());
+    CBlockUndo blockUndo;
+    if (!blockReader_.ReadBlockUndo(pindex, blockUndo))
+        return error("%s : failed to read the undo data of block %s", __func__, pindex->GetBlockHash());
+
+    if (!UndoDataMatchesBlock(block, blockUndo))
+        return error("%s : block %s and its undo data are inconsistent", __func__, pindex->GetBlockHash());
+
+    if (index_ == BuiltIndex::BLOCK_FILTER_INDEX) {
+        if (!fDisconnect)
+            updates.blockFilters.push_back(BlockFilter(block, blockUndo));
+        return true;
+    }
+    if (index_ == BuiltIndex::SUPPLY_INDEX) {
+        if (fDisconnect)
+            return true;
+        // Blocks are built in chain order, so the parent's record has been written already
+        CoinSupply previous(pindex->pprev->GetBlockHash());
+        if (pindex->pprev->pprev && !blocktree_.ReadCoinSupply(pindex->pprev->GetBlockHash(), previous))
+            return error("%s : failed to read the coin supply of block %s", __func__, pindex->pprev->GetBlockHash());
+        static const std::set<CAmount> collateralAmounts = CoinSupply::GetCollateralAmounts(Params());
+        updates.coinSupplies.push_back(CoinSupply(previous, block, blockUndo, *pindex, collateralAmounts));
+        return true;
+    }
+
+    const bool fAddressIndex = index_ == BuiltIndex::ADDRESS_INDEX;
+    const bool fSpentIndex = index_ == BuiltIndex::SPENT_INDEX;
+    const bool fVaultIndex = index_ == BuiltIndex::VAULT_INDEX;
+    if (fDisconnect) {
+        CCoinsView noCoins;
+        CCoinsViewCache spentOutputs(&noCoins);
+        AddSpentOutputs(block, blockUndo, spentOutputs);
+        for (int i = block.vtx.size() - 1; i >= 0; i--) {
+            const TransactionLocationReference txLocationRef(block.vtx[i].GetHash(), pindex->nHeight, i);
+            IndexDatabaseUpdateCollector::ReverseTransaction(block.vtx[i], txLocationRef, spentOutputs, fAddressIndex, fSpentIndex, fVaultIndex, updates);
+        }
+        return true;
+    }
+
+    // Building is meant to stay in the background, so it keeps to one thread.
+    IndexDatabaseUpdateCollector::RecordBlock(block, blockUndo, pindex->nHeight, fAddressIndex, fSpentIndex, fVaultIndex, 1, updates);
+    if (index_ == BuiltIndex::TX_INDEX) {
+        TransactionLocationRecorder txLocationRecorder(pindex, block);
+        for (unsigned int i = 0; i < block.vtx.size(); i++)
+            txLocationRecorder.RecordTxLocationData(block.vtx[i], updates.txLocationData);
+    }
+    return true;
+}
+
+bool BackgroundIndexBuilder::WriteUpdates(const IndexDatabaseUpdates& updates, bool fDisconnect) const
+{
+    switch (index_) {
+    case BuiltIndex::TX_INDEX:
+        // Like the index kept along with the chain, transactions keep their entries when disconnected.
+        return fDisconnect || blocktree_.WriteTxIndex(updates.txLocationData);
+    case BuiltIndex::ADDRESS_INDEX:
+        if (fDisconnect ? !blocktree_.EraseAddressIndex(updates.addressIndex) : !blocktree_.WriteAddressIndex(updates.addressIndex))
+            return false;
+        return blocktree_.UpdateAddressUnspentIndex(updates.addressUnspentIndex);
+    case BuiltIndex::SPENT_INDEX:
+        return blocktree_.UpdateSpentIndex(updates.spentIndex);
+    case BuiltIndex::BLOCK_FILTER_INDEX:
+        // Filters are looked up by block hash, so those of disconnected blocks can stay.
+        return fDisconnect || blocktree_.WriteBlockFilters(updates.blockFilters);
+    case BuiltIndex::SUPPLY_INDEX:
+        // Each record is that of its own block's branch, so those of disconnected blocks can stay.
+        return fDisconnect || blocktree_.WriteCoinSupplies(updates.coinSupplies);
+    case BuiltIndex::VAULT_INDEX:
+        return blocktree_.UpdateVaultIndex(updates.vaultIndex);
+    }
+    return false;
+}
+
+bool BackgroundIndexBuilder::ConnectBlock(const CBlockIndex* pindex)
+{
+    // The genesis block is not indexed along with the chain either.
+    if (pindex->pprev) {
+        IndexDatabaseUpdates updates;
+        if (!CollectUpdates(pindex, false, updates))
+            return false;
+        if (!WriteUpdates(updates, false))
+            return error("%s : failed to write the %s entries of block %s", __func__, GetName(), pindex->GetBlockHash());
+    }
+    // Entries are written before the progress, so blocks after it are only ever written again.
+    if (!blocktree_.WriteIndexBuildProgress(GetName(), pindex->GetBlockHash()))
+        return error("%s : failed to write the %s build progress", __func__, GetName());
+    hashBestBlock_ = pindex->GetBlockHash();
+    return true;
+}
+
+bool BackgroundIndexBuilder::DisconnectBlock(const CBlockIndex* pindex)
+{
+    if (!pindex->pprev)
+        return error("%s : cannot disconnect the genesis block", __func__);
+    IndexDatabaseUpdates updates;
+    if (!CollectUpdates(pindex, true, updates))
+        return false;
+    if (!WriteUpdates(updates, true))
+        return error("%s : failed to take the %s entries of block %s back out", __func__, GetName(), pindex->GetBlockHash());
+    if (!blocktree_.WriteIndexBuildProgress(GetName(), pindex->pprev->GetBlockHash()))
+        return error("%s : failed to write the %s build progress", __func__, GetName());
+    hashBestBlock_ = pindex->pprev->GetBlockHash();
+    return true;
+}
+
+bool BackgroundIndexBuilder::Finish()
+{
+    if (index_ == BuiltIndex::ADDRESS_INDEX && !blocktree_.BuildAddressBalances())
+        return false;
+    if (!blocktree_.WriteFlag(GetName(), true) || !blocktree_.EraseIndexBuildProgress(GetName()))
+        return error("%s : failed to mark the %s complete", __func__, GetName());
+    LogPrintf("%s : %s built up to block %s\n", __func__, GetName(), hashBestBlock_);
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef BACKGROUND_INDEX_BUILDER_H
+#define BACKGROUND_INDEX_BUILDER_H
+#include <uint256.h>
+
+class CBlockIndex;
+class CBlockTreeDB;
+class I_BlockDataReader;
+struct IndexDatabaseUpdates;
+
+/** The optional indexes that can be turned on once the chain is synced */
+enum class BuiltIndex
+{
+    TX_INDEX,
+    ADDRESS_INDEX,
+    SPENT_INDEX,
+    BLOCK_FILTER_INDEX,
+    SUPPLY_INDEX,
+    VAULT_INDEX,
+};
+
+/**
+ * Builds one of the optional indexes from the block and undo files, one block
+ * at a time and without holding cs_main, for a node that turns the index on
+ * after it has synced.
+ *
+ * The last block built is kept in the block tree database, so an interrupted
+ * build resumes there. Blocks that leave the active chain again are taken back
+ * out. Address balances are not kept while building; they are summed up once
+ * the index is complete.
+ */
+class BackgroundIndexBuilder
+{
+private:
+    const BuiltIndex index_;
+    CBlockTreeDB& blocktree_;
+    const I_BlockDataReader& blockReader_;
+    uint256 hashBestBlock_;
+
+    bool CollectUpdates(const CBlockIndex* pindex, bool fDisconnect, IndexDatabaseUpdates& updates) const;
+    bool WriteUpdates(const IndexDatabaseUpdates& updates, bool fDisconnect) const;
+
+public:
+    BackgroundIndexBuilder(
+        BuiltIndex index,
+        CBlockTreeDB& blocktree,
+        const I_BlockDataReader& blockReader);
+
+    //! Name of the index, which is also the name of its database flag
+    const char* GetName() const;
+
+    //! Last block the index has been built up to, 0 before the genesis block is
+    const uint256& GetBestBlock() const { return hashBestBlock_; }
+
+    //! Add the entries of pindex, the child of the best block, to the index
+    bool ConnectBlock(const CBlockIndex* pindex);
+
+    //! Take the entries of pindex, the best block, back out of the index
+    bool DisconnectBlock(const CBlockIndex* pindex);
+
+    //! Mark the index complete; from now on it is updated along with the chain
+    bool Finish();
+};
+#endif// BACKGROUND_INDEX_BUILDER_H
@@ -7,24 +7,134 @@
 #include <chainparams.h>
 #include <Logging.h>
 #include <BlockUndo.h>
+#include <sync.h>
+#include <CachingBlockDataReader.h>
+#include <MappedBlockFiles.h>
+#include <defaultValues.h>
+
+namespace
+{
+/** History file kept open between consecutive block writes, positioned after the last block written. */
+CCriticalSection cs_blockFileAppender;
+FILE* blockFileAppender = NULL;
+CDiskBlockPos blockFileAppenderPos;
+
+void CloseBlockFileAppenderLocked()
+{
+    if (blockFileAppender)
+        fclose(blockFileAppender);
+    blockFileAppender = NULL;
+    blockFileAppenderPos.SetNull();
+}
+
+//! Mapping this many block files would use up most of the address space of 32-bit systems
+MappedBlockFiles mappedBlockFiles(sizeof(void*) >= 8 ? MAX_MAPPED_BLOCK_FILES : 0);
+
+const unsigned int nBlockHeaderSize = MESSAGE_START_SIZE + sizeof(unsigned int);
+
+//! Size WriteBlockToDisk recorded in front of a block, trusted only behind the network magic
+bool ReadStoredBlockSize(const char* pheader, unsigned int& nSize)
+{
+    if (memcmp(pheader, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return false;
+    CMemoryReader(pheader + MESSAGE_START_SIZE, pheader + nBlockHeaderSize, SER_DISK, CLIENT_VERSION) >> nSize;
+    return nSize > 0 && nSize <= MAX_BLOCKFILE_SIZE;
+}
+
+/** Mapping of the file holding the block at pos that covers all nSize bytes of it, or NULL if the file has to be read */
+MappedBlockFiles::MappingRef MapStoredBlock(const CDiskBlockPos& pos, unsigned int& nSize)
+{
+    if (pos.IsNull() || pos.nPos < nBlockHeaderSize)
+        return MappedBlockFiles::MappingRef();
+    MappedBlockFiles::MappingRef mapping = mappedBlockFiles.Get(pos.nFile, pos.nPos);
+    if (!mapping || !ReadStoredBlockSize(mapping->data() + pos.nPos - nBlockHeaderSize, nSize))
+        return MappedBlockFiles::MappingRef();
+    if ((uint64_t)pos.nPos + nSize > mapping->size())
+        mapping = mappedBlockFiles.Get(pos.nFile, (uint64_t)pos.nPos + nSize);
+    return mapping;
+}
+
+/** Deserialize the block at pos straight from a mapping of its file; false if that is not possible and the file has to be read */
+bool ReadMappedBlock(CBlock& block, const CDiskBlockPos& pos)
+{
+    unsigned int nSize = 0;
+    MappedBlockFiles::MappingRef mapping = MapStoredBlock(pos, nSize);
+    if (!mapping)
+        return false;
+
+    CMemoryReader blockData(mapping->data() + pos.nPos, mapping->data() + pos.nPos + nSize, SER_DISK, CLIENT_VERSION);
+    blockData >> block;
+    return true;
+}
+
+bool AppendStoredBlock(CDataStream& ssBlock, const CDiskBlockPos& pos)
+{
+    unsigned int nSize = 0;
+    MappedBlockFiles::MappingRef mapping = MapStoredBlock(pos, nSize);
+    if (mapping) {
+        ssBlock.write(mapping->data() + pos.nPos, nSize);
+        return true;
+    }
+
+    if (pos.IsNull() || pos.nPos < nBlockHeaderSize)
+        return error("%s : no block at %d:%u", __func__, pos.nFile, pos.nPos);
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - nBlockHeaderSize), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed", __func__);
+    // The block is read in one go, so reading ahead of it would only evict what other peers ask for.
+    AdviseBlockFileAccess(filein.Get(), BlockFileAccess::RANDOM);
+    char header[nBlockHeaderSize];
+    filein.read(header, nBlockHeaderSize);
+    if (!ReadStoredBlockSize(header, nSize))
+        return error("%s : no block header in front of %d:%u", __func__, pos.nFile, pos.nPos);
+    const size_t nOffset = ssBlock.size();
+    ssBlock.resize(nOffset + nSize);
+    filein.read(&ssBlock[nOffset], nSize);
+    return true;
+}
+}
+
+void CloseBlockFileAppender()
+{
+    LOCK(cs_blockFileAppender);
+    CloseBlockFileAppenderLocked();
+}
+
+void ReleaseMappedBlockFiles()
+{
+    mappedBlockFiles.Clear();
+}
 
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("WriteBlockToDisk : OpenBlockFile failed");
+    LOCK(cs_blockFileAppender);
+
+    // Blocks are normally appended one after another to the same file, so the handle
+    // is only reopened when the file changes or the write does not continue the last one.
+    if (!blockFileAppender || blockFileAppenderPos != pos) {
+        CloseBlockFileAppenderLocked();
+        blockFileAppender = OpenBlockFile(pos);
+        if (!blockFileAppender)
+            return error("WriteBlockToDisk : OpenBlockFile failed");
+        blockFileAppenderPos = pos;
+    }
 
-    // Write index header
-    unsigned int nSize = fileout.GetSerializeSize(block);
-    fileout << FLATDATA(Params().MessageStart()) << nSize;
+    // Serialize index header and block up front so the block goes out in a single write
+    unsigned int nSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    CDataStream ssBlock(SER_DISK, CLIENT_VERSION);
+    ssBlock.reserve(nSize + 8);
+    ssBlock << FLATDATA(Params().MessageStart()) << nSize;
+    const unsigned int nHeaderSize = ssBlock.size();
+    ssBlock << block;
 
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("WriteBlockToDisk : ftell failed");
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    // Flush right away, so that readers opening the file separately see the whole block
+    if (fwrite(&ssBlock[0], 1, ssBlock.size(), blockFileAppender) != ssBlock.size() || fflush(blockFileAppender) != 0) {
+        CloseBlockFileAppenderLocked();
+        return error("WriteBlockToDisk : write to block file failed");
+    }
+
+    pos.nPos = blockFileAppenderPos.nPos + nHeaderSize;
+    blockFileAppenderPos.nPos += ssBlock.size();
 
     return true;
 }
@@ -33,14 +143,14 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk : OpenBlockFile failed");
-
-    // Read block
+    // Read block, from the mapped history file where possible
     try {
-        filein >> block;
+        if (!ReadMappedBlock(block, pos)) {
+            CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("ReadBlockFromDisk : OpenBlockFile failed");
+            filein >> block;
+        }
     } catch (std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -65,6 +175,47 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CDiskBlockPos& pos)
+{
+    const size_t nOffset = ssBlock.size();
+    try {
+        if (!AppendStoredBlock(ssBlock, pos)) {
+            ssBlock.resize(nOffset);
+            return false;
+        }
+    } catch (std::exception& e) {
+        ssBlock.resize(nOffset);
+        return error("%s : I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CBlockIndex* pindex)
+{
+    const size_t nOffset = ssBlock.size();
+    if (!ReadRawBlockFromDisk(ssBlock, pindex->GetBlockPos()))
+        return false;
+
+    // Only the header is deserialized to check it, the rest is passed on as it was stored
+    CBlockHeader header;
+    try {
+        CMemoryReader(&ssBlock[nOffset], &ssBlock[0] + ssBlock.size(), SER_DISK, CLIENT_VERSION) >> header;
+    } catch (std::exception& e) {
+        ssBlock.resize(nOffset);
+        return error("%s : Deserialize error - %s", __func__, e.what());
+    }
+    if (header.GetHash() != pindex->GetBlockHash()) {
+        ssBlock.resize(nOffset);
+        LogPrintf("%s : block=%s index=%s\n", __func__, header.GetHash(), pindex->GetBlockHash());
+        return error("ReadRawBlockFromDisk(CDataStream&, CBlockIndex*) : GetHash() doesn't match index");
+    }
+    if (pindex->IsProofOfWork() && !CheckProofOfWork(header.GetHash(), header.nBits, Params())) {
+        ssBlock.resize(nOffset);
+        return error("ReadRawBlockFromDisk : Errors in block header");
+    }
+    return true;
+}
+
 bool BlockDiskDataReader::ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
 {
     return ReadBlockFromDisk(block,blockIndex);
@@ -79,3 +230,14 @@ bool BlockDiskDataReader::ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUnd
 
     return true;
 }
+
+namespace
+{
+const BlockDiskDataReader blockDiskReader;
+CachingBlockDataReader recentBlockDataReader(blockDiskReader, BLOCK_DATA_CACHE_ENTRIES);
+}
+
+CachingBlockDataReader& GetRecentBlockDataReader()
+{
+    return recentBlockDataReader;
+}
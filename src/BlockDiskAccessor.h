@@ -2,14 +2,22 @@
 #define BLOCK_DISK_ACCESSOR_H
 #include <stdint.h>
 #include <I_BlockDataReader.h>
+#include <streams.h>
 class CBlock;
 class CDiskBlockPos;
 class CBlockIndex;
+class CachingBlockDataReader;
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos);
+void CloseBlockFileAppender();
+/** Unmap the block files once their readers are done, e.g. before files are deleted */
+void ReleaseMappedBlockFiles();
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Append the block as stored on disk to ssBlock, so it can be passed on without deserializing and reserializing it */
+bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CDiskBlockPos& pos);
+bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CBlockIndex* pindex);
 
 class BlockDiskDataReader: public I_BlockDataReader
 {
@@ -18,4 +26,7 @@ public:
     virtual bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const;
     virtual bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const;
 };
+
+/** Shared reader that keeps the blocks and undo data recently read from disk */
+CachingBlockDataReader& GetRecentBlockDataReader();
 #endif // BLOCK_DISK_ACCESSOR_H
\ No newline at end of file
@@ -12,7 +12,10 @@
 #include <sync.h>
 #include <Logging.h>
 #include <script/standard.h>
+#include <PerformanceStatistics.h>
 #include <Settings.h>
+#include <StakingStatistics.h>
+#include <utiltime.h>
 
 // Actual mining functions
 BlockFactory::BlockFactory(
@@ -20,12 +23,14 @@ BlockFactory::BlockFactory(
     I_PoSTransactionCreator& coinstakeCreator,
     const Settings& settings,
     const CChain& chain,
-    const CChainParams& chainParameters
+    const CChainParams& chainParameters,
+    StakingStatistics& stakingStatistics
     ): settings_(settings)
     , chain_(chain)
     , chainParameters_(chainParameters)
     , blockTransactionCollector_(blockTransactionCollector)
     , coinstakeCreator_( coinstakeCreator)
+    , stakingStatistics_(stakingStatistics)
 {
 
 }
@@ -83,6 +88,7 @@ bool BlockFactory::AppendProofOfStakeToBlock(
 
 CBlockTemplate* BlockFactory::CreateNewBlock(const CScript& scriptPubKeyIn, bool fProofOfStake)
 {
+    PerformanceTimerScope timer(PerformanceTimer::BLOCK_TEMPLATE);
     // Create new block
     std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
     if (!pblocktemplate.get())
@@ -113,7 +119,11 @@ CBlockTemplate* BlockFactory::CreateNewBlock(const CScript& scriptPubKeyIn, bool
     }
 
     // Collect memory pool transactions into the block
-    if(!blockTransactionCollector_.CollectTransactionsIntoBlock(*pblocktemplate))
+    const int64_t collectionStart = GetTimeMicros();
+    const bool transactionsCollected = blockTransactionCollector_.CollectTransactionsIntoBlock(*pblocktemplate);
+    if (fProofOfStake)
+        stakingStatistics_.RecordStageTime(StakingStage::TRANSACTION_COLLECTION, GetTimeMicros() - collectionStart);
+    if(!transactionsCollected)
     {
         return NULL;
     }
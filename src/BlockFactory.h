@@ -14,6 +14,7 @@ class I_PoSTransactionCreator;
 class CChain;
 class CChainParams;
 class Settings;
+class StakingStatistics;
 
 class BlockFactory: public I_BlockFactory
 {
@@ -24,6 +25,7 @@ private:
 
     I_BlockTransactionCollector& blockTransactionCollector_;
     I_PoSTransactionCreator& coinstakeCreator_;
+    StakingStatistics& stakingStatistics_;
 
     void SetRequiredWork(CBlockTemplate& pblocktemplate);
     void SetBlockTime(CBlock& block);
@@ -41,7 +43,8 @@ public:
         I_PoSTransactionCreator& coinstakeCreator,
         const Settings& settings,
         const CChain& chain,
-        const CChainParams& chainParameters);
+        const CChainParams& chainParameters,
+        StakingStatistics& stakingStatistics);
 
     CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reservekey, bool fProofOfStake) override;
 };
@@ -1,12 +1,28 @@
+#include <BlockFileOpener.h>
+
 #include <chain.h>
 
 #include <boost/filesystem.hpp>
+#include <CompressedBlockFile.h>
 #include <DataDirectory.h>
+#include <defaultValues.h>
 #include <Logging.h>
+#include <util.h>
+
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#endif
 
 boost::filesystem::path GetBlockPosFilename(const CDiskBlockPos& pos, const char* prefix)
 {
-    return GetDataDir() / "blocks" / strprintf("%s%05u.dat", prefix, pos.nFile);
+    return GetBlocksDir() / strprintf("%s%05u.dat", prefix, pos.nFile);
+}
+
+boost::filesystem::path GetCompressedBlockFilename(int nFile)
+{
+    return GetBlocksDir() / strprintf("blk%05u.dat.z", nFile);
 }
 
 FILE* OpenDiskFile(const CDiskBlockPos& pos, const char* prefix, bool fReadOnly)
@@ -18,6 +34,9 @@ FILE* OpenDiskFile(const CDiskBlockPos& pos, const char* prefix, bool fReadOnly)
     FILE* file = fopen(path.string().c_str(), "rb+");
     if (!file && !fReadOnly)
         file = fopen(path.string().c_str(), "wb+");
+    // Cold block files may have been replaced by their compressed version.
+    if (!file && fReadOnly && strcmp(prefix, "blk") == 0)
+        file = CompressedBlockFile::OpenAsStream(GetCompressedBlockFilename(pos.nFile));
     if (!file) {
         LogPrintf("Unable to open file %s\n", path.string());
         return NULL;
@@ -34,7 +53,7 @@ FILE* OpenDiskFile(const CDiskBlockPos& pos, const char* prefix, bool fReadOnly)
 
 bool BlockFileExists(const CDiskBlockPos& pos, const char* prefix)
 {
-    return boost::filesystem::exists(GetBlockPosFilename(pos, "blk"));
+    return boost::filesystem::exists(GetBlockPosFilename(pos, "blk")) || boost::filesystem::exists(GetCompressedBlockFilename(pos.nFile));
 }
 
 FILE* OpenBlockFile(const CDiskBlockPos& pos, bool fReadOnly)
@@ -45,4 +64,54 @@ FILE* OpenBlockFile(const CDiskBlockPos& pos, bool fReadOnly)
 FILE* OpenUndoFile(const CDiskBlockPos& pos, bool fReadOnly)
 {
     return OpenDiskFile(pos, "rev", fReadOnly);
-}
\ No newline at end of file
+}
+
+void AdviseBlockFileAccess(FILE* file, BlockFileAccess access)
+{
+#if defined(POSIX_FADV_SEQUENTIAL) && defined(POSIX_FADV_RANDOM)
+    // Compressed block files are streams without a descriptor to advise on.
+    if (!file || fileno(file) < 0)
+        return;
+    posix_fadvise(fileno(file), 0, 0, access == BlockFileAccess::SEQUENTIAL ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+#endif
+}
+
+void PrefetchBlockFile(int nFile, unsigned int nPos)
+{
+#ifdef POSIX_FADV_WILLNEED
+    // Opened as is, so that neither a directory nor a file is created for a block file that is not there.
+    FILE* file = fopen(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk").string().c_str(), "rb");
+    if (!file)
+        return;
+    posix_fadvise(fileno(file), nPos, 0, POSIX_FADV_WILLNEED);
+    fclose(file);
+#endif
+}
+void RemoveBlockAndUndoFiles(int nFile)
+{
+    const CDiskBlockPos pos(nFile, 0);
+    boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
+    boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
+    boost::filesystem::remove(GetCompressedBlockFilename(nFile));
+}
+
+bool IsBlockFileCompressed(int nFile)
+{
+    return boost::filesystem::exists(GetCompressedBlockFilename(nFile));
+}
+
+bool CompressBlockFile(int nFile)
+{
+    const boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    const boost::filesystem::path pathCompressed = GetCompressedBlockFilename(nFile);
+    boost::filesystem::path pathTmp = pathCompressed;
+    pathTmp += ".tmp";
+    if (!CompressedBlockFile::Compress(path, pathTmp, BLOCKFILE_COMPRESSION_CHUNK_SIZE) || !RenameOver(pathTmp, pathCompressed)) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(pathTmp, ec);
+        return false;
+    }
+    // Readers that find the original gone fall back to the compressed file.
+    boost::filesystem::remove(path);
+    return true;
+}
@@ -8,4 +8,23 @@ bool BlockFileExists(const CDiskBlockPos& pos, const char* prefix);
 FILE* OpenBlockFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 FILE* OpenUndoFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 
+/** How a block file is going to be read, for the kernel to read ahead as far as is of use */
+enum class BlockFileAccess
+{
+    //! Whole files front to back, as a reindex does
+    SEQUENTIAL,
+    //! Single blocks here and there, as peers and RPC ask for them
+    RANDOM,
+};
+/** Tell the kernel how the open block file is going to be read; a no-op where there is no such hint */
+void AdviseBlockFileAccess(FILE* file, BlockFileAccess access);
+/** Have the kernel start reading blk file nFile from nPos on into memory, ahead of reading it block by block */
+void PrefetchBlockFile(int nFile, unsigned int nPos);
+/** Delete the blk and rev files numbered nFile, as far as they exist */
+void RemoveBlockAndUndoFiles(int nFile);
+/** Whether blk file nFile has been replaced by its compressed version */
+bool IsBlockFileCompressed(int nFile);
+/** Replace blk file nFile, which must not be written to any more, by its compressed version; read-only opens keep working */
+bool CompressBlockFile(int nFile);
+
 #endif // BLOCK_FILE_OPENER_H
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include <BlockFilePruning.h>
+
+#include <blockFileInfo.h>
+
+uint64_t CalculateBlockFilesUsage(const std::vector<CBlockFileInfo>& vinfoBlockFile)
+{
+    uint64_t nUsage = 0;
+    for (std::vector<CBlockFileInfo>::const_iterator it = vinfoBlockFile.begin(); it != vinfoBlockFile.end(); ++it)
+        nUsage += it->nSize + it->nUndoSize;
+    return nUsage;
+}
+
+std::set<int> FindBlockFilesToPrune(
+    const std::vector<CBlockFileInfo>& vinfoBlockFile,
+    int nLastBlockFile,
+    int nLastHeightToPrune,
+    uint64_t nPruneTarget,
+    uint64_t nBuffer)
+{
+    std::set<int> setFilesToPrune;
+    if (nLastHeightToPrune < 0)
+        return setFilesToPrune;
+
+    uint64_t nUsage = CalculateBlockFilesUsage(vinfoBlockFile);
+    for (int nFile = 0; nFile < nLastBlockFile && nFile < (int)vinfoBlockFile.size(); nFile++) {
+        if (nUsage + nBuffer < nPruneTarget)
+            break;
+        const CBlockFileInfo& info = vinfoBlockFile[nFile];
+        // Files pruned before are kept in the list with nothing left in them.
+        if (info.nSize == 0)
+            continue;
+        if (info.nHeightLast > (unsigned int)nLastHeightToPrune)
+            continue;
+        setFilesToPrune.insert(nFile);
+        nUsage -= info.nSize + info.nUndoSize;
+    }
+    return setFilesToPrune;
+}
@@ -0,0 +1,26 @@
+#ifndef BLOCK_FILE_PRUNING_H
+#define BLOCK_FILE_PRUNING_H
+#include <stdint.h>
+
+#include <set>
+#include <vector>
+
+class CBlockFileInfo;
+
+/** Bytes used by the blk?????.dat and rev?????.dat files described by vinfoBlockFile */
+uint64_t CalculateBlockFilesUsage(const std::vector<CBlockFileInfo>& vinfoBlockFile);
+
+/**
+ * Block file numbers to delete, oldest first, so that the block and undo files fit
+ * into nPruneTarget bytes with nBuffer to spare for the blocks that follow.
+ *
+ * The file being appended to is never picked, nor is any file holding a block above
+ * nLastHeightToPrune; if the target cannot be met without them it is exceeded.
+ */
+std::set<int> FindBlockFilesToPrune(
+    const std::vector<CBlockFileInfo>& vinfoBlockFile,
+    int nLastBlockFile,
+    int nLastHeightToPrune,
+    uint64_t nPruneTarget,
+    uint64_t nBuffer);
+#endif// BLOCK_FILE_PRUNING_H
@@ -0,0 +1,28 @@
+#ifndef BLOCK_FILE_SCANNER_H
+#define BLOCK_FILE_SCANNER_H
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+
+#include <chainparams.h>
+
+class CBlock;
+
+/** Called with each block found and its position right after the block's header; false stops the scan */
+typedef std::function<bool(CBlock& block, uint64_t nBlockPos)> ScannedBlockHandler;
+
+/**
+ * Look for the blocks in a file laid out like blk?????.dat, i.e. each block
+ * preceded by the message start and its size, skipping anything in between
+ * that does not deserialize. Takes over and closes fileIn.
+ *
+ * Errors deserializing a single block, or thrown by the handler, are logged
+ * and the scan resumes right after that block's header; failures to set up
+ * the read are thrown as std::runtime_error.
+ */
+void ScanBlockFile(
+    FILE* fileIn,
+    const MessageStartChars& messageStart,
+    const ScannedBlockHandler& handleBlock);
+#endif// BLOCK_FILE_SCANNER_H
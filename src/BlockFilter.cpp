@@ -0,0 +1,252 @@
+#include <BlockFilter.h>
+
+#include <BlockUndo.h>
+#include <crypto/common.h>
+#include <crypto/siphash.h>
+#include <primitives/block.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <undo.h>
+#include <version.h>
+
+#include <algorithm>
+#include <ios>
+
+namespace
+{
+uint64_t MapIntoRange(uint64_t hash, uint64_t nRange)
+{
+#ifdef __SIZEOF_INT128__
+    return (static_cast<unsigned __int128>(hash) * static_cast<unsigned __int128>(nRange)) >> 64;
+#else
+    const uint64_t hashHigh = hash >> 32, hashLow = hash & 0xFFFFFFFF;
+    const uint64_t rangeHigh = nRange >> 32, rangeLow = nRange & 0xFFFFFFFF;
+    const uint64_t middle = (hashLow * rangeLow >> 32) + (hashHigh * rangeLow & 0xFFFFFFFF) + hashLow * rangeHigh;
+    return hashHigh * rangeHigh + (hashHigh * rangeLow >> 32) + (middle >> 32);
+#endif
+}
+
+/** Appends bits to a byte vector, most significant bit first */
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& bytes_;
+    uint8_t buffer_;
+    int offset_;
+
+public:
+    explicit BitWriter(std::vector<unsigned char>& bytes) : bytes_(bytes), buffer_(0), offset_(0) {}
+
+    void Write(uint64_t data, int nBits)
+    {
+        while (nBits > 0) {
+            const int bits = std::min(8 - offset_, nBits);
+            buffer_ |= (data << (64 - nBits)) >> (64 - 8 + offset_);
+            offset_ += bits;
+            nBits -= bits;
+            if (offset_ == 8)
+                Flush();
+        }
+    }
+    void Flush()
+    {
+        if (offset_ == 0)
+            return;
+        bytes_.push_back(buffer_);
+        buffer_ = 0;
+        offset_ = 0;
+    }
+};
+
+/** Reads bits from a byte vector, most significant bit first */
+class BitReader
+{
+private:
+    const std::vector<unsigned char>& bytes_;
+    size_t position_;
+    uint8_t buffer_;
+    int offset_;
+
+public:
+    BitReader(const std::vector<unsigned char>& bytes, size_t position) : bytes_(bytes), position_(position), buffer_(0), offset_(8) {}
+
+    uint64_t Read(int nBits)
+    {
+        uint64_t data = 0;
+        while (nBits > 0) {
+            if (offset_ == 8) {
+                if (position_ >= bytes_.size())
+                    throw std::ios_base::failure("BitReader::Read : end of data");
+                buffer_ = bytes_[position_++];
+                offset_ = 0;
+            }
+            const int bits = std::min(8 - offset_, nBits);
+            data <<= bits;
+            data |= static_cast<uint8_t>(buffer_ << offset_) >> (8 - bits);
+            offset_ += bits;
+            nBits -= bits;
+        }
+        return data;
+    }
+};
+
+void GolombRiceEncode(BitWriter& writer, uint64_t value)
+{
+    uint64_t quotient = value >> BlockFilter::FILTER_P;
+    while (quotient > 0) {
+        const int nBits = quotient <= 64 ? static_cast<int>(quotient) : 64;
+        writer.Write(~0ULL, nBits);
+        quotient -= nBits;
+    }
+    writer.Write(0, 1);
+    writer.Write(value, BlockFilter::FILTER_P);
+}
+
+uint64_t GolombRiceDecode(BitReader& reader)
+{
+    uint64_t quotient = 0;
+    while (reader.Read(1) == 1)
+        ++quotient;
+    const uint64_t remainder = reader.Read(BlockFilter::FILTER_P);
+    return (quotient << BlockFilter::FILTER_P) + remainder;
+}
+
+template <typename T>
+size_t CompactSizeLength(const std::vector<unsigned char>& bytes, T& nSize)
+{
+    CDataStream stream(bytes, SER_NETWORK, PROTOCOL_VERSION);
+    nSize = ReadCompactSize(stream);
+    return bytes.size() - stream.size();
+}
+}
+
+BlockFilter::BlockFilter(
+    ): blockHash_(0)
+    , encodedFilter_()
+    , nElements_(0)
+{
+}
+
+BlockFilter::BlockFilter(
+    const CBlock& block,
+    const CBlockUndo& blockUndo
+    ): BlockFilter()
+{
+    std::set<CScript> elements;
+    for (const CTransaction& tx: block.vtx) {
+        for (const CTxOut& txout: tx.vout)
+            AddElementsForScript(txout.scriptPubKey, elements);
+    }
+    for (const CTxUndo& txundo: blockUndo.vtxundo) {
+        for (const CTxInUndo& prevout: txundo.vprevout)
+            AddElementsForScript(prevout.txout.scriptPubKey, elements);
+    }
+    *this = BlockFilter(block.GetHash(), elements);
+}
+
+BlockFilter::BlockFilter(
+    const uint256& blockHash,
+    const std::set<CScript>& elements
+    ): blockHash_(blockHash)
+    , encodedFilter_()
+    , nElements_(elements.size())
+{
+    {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        WriteCompactSize(stream, nElements_);
+        encodedFilter_.assign(stream.begin(), stream.end());
+    }
+    const uint64_t nRange = nElements_ * FILTER_M;
+    std::vector<uint64_t> hashedElements;
+    hashedElements.reserve(elements.size());
+    for (const CScript& element: elements)
+        hashedElements.push_back(HashToRange(element, nRange));
+    std::sort(hashedElements.begin(), hashedElements.end());
+
+    BitWriter writer(encodedFilter_);
+    uint64_t lastValue = 0;
+    for (uint64_t value: hashedElements) {
+        GolombRiceEncode(writer, value - lastValue);
+        lastValue = value;
+    }
+    writer.Flush();
+}
+
+void BlockFilter::ReadElementCount()
+{
+    nElements_ = 0;
+    try {
+        CompactSizeLength(encodedFilter_, nElements_);
+    } catch (const std::ios_base::failure&) {
+        nElements_ = 0;
+    }
+}
+
+uint64_t BlockFilter::HashToRange(const CScript& element, uint64_t nRange) const
+{
+    const uint64_t hash = CSipHasher(ReadLE64(blockHash_.begin()), ReadLE64(blockHash_.begin() + 8))
+        .Write(element.data(), element.size())
+        .Finalize();
+    return MapIntoRange(hash, nRange);
+}
+
+bool BlockFilter::MatchesAny(const std::vector<CScript>& elements) const
+{
+    if (elements.empty())
+        return false;
+    try {
+        uint64_t nElements;
+        const size_t nHeaderSize = CompactSizeLength(encodedFilter_, nElements);
+        if (nElements == 0)
+            return false;
+        const uint64_t nRange = nElements * FILTER_M;
+        std::vector<uint64_t> queries;
+        queries.reserve(elements.size());
+        for (const CScript& element: elements)
+            queries.push_back(HashToRange(element, nRange));
+        std::sort(queries.begin(), queries.end());
+
+        BitReader reader(encodedFilter_, nHeaderSize);
+        std::vector<uint64_t>::const_iterator query = queries.begin();
+        uint64_t value = 0;
+        for (uint64_t nDecoded = 0; nDecoded < nElements; nDecoded++) {
+            value += GolombRiceDecode(reader);
+            while (query != queries.end() && *query < value)
+                ++query;
+            if (query == queries.end())
+                return false;
+            if (*query == value)
+                return true;
+        }
+        return false;
+    } catch (const std::ios_base::failure&) {
+        return true;
+    }
+}
+
+void BlockFilter::AddElementsForScript(const CScript& script, std::set<CScript>& elements)
+{
+    if (script.empty() || script[0] == OP_META)
+        return;
+    elements.insert(script);
+
+    std::vector<std::vector<unsigned char> > vSolutions;
+    txnouttype whichType;
+    if (!ExtractScriptPubKeyFormat(script, whichType, vSolutions))
+        return;
+    switch (whichType) {
+    case TX_PUBKEY:
+        elements.insert(GetScriptForDestination(CPubKey(vSolutions[0]).GetID()));
+        break;
+    case TX_VAULT:
+        elements.insert(GetScriptForDestination(CKeyID(uint160(vSolutions[0]))));
+        elements.insert(GetScriptForDestination(CKeyID(uint160(vSolutions[1]))));
+        break;
+    case TX_MULTISIG:
+        for (size_t index = 1; index + 1 < vSolutions.size(); index++)
+            elements.insert(GetScriptForDestination(CPubKey(vSolutions[index]).GetID()));
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef BLOCK_FILTER_H
+#define BLOCK_FILTER_H
+#include <script/script.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <set>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+/**
+ * Golomb-coded set of the scripts a block pays to and spends from, along the
+ * lines of the basic filter of BIP158, so that a block can be ruled out for a
+ * set of scripts without reading it.
+ *
+ * Besides the scripts themselves, the filter has the pay-to-pubkey-hash script
+ * of every key that a pay-to-pubkey, multisig or vault script names. Whoever
+ * holds a key can then query for that one script, whichever way it is paid.
+ * The encoding is that of BIP158: the number of scripts as a compact size,
+ * followed by the Golomb-Rice coded gaps between their sorted hashes.
+ */
+class BlockFilter
+{
+public:
+    //! Golomb-Rice parameter and inverse false positive rate of BIP158's basic filter
+    static constexpr int FILTER_P = 19;
+    static constexpr uint64_t FILTER_M = 784931;
+    //! Filter type of the basic filter in getcfilters requests
+    static constexpr unsigned char BASIC_FILTER_TYPE = 0;
+
+private:
+    uint256 blockHash_;
+    std::vector<unsigned char> encodedFilter_;
+    uint64_t nElements_;
+
+    void ReadElementCount();
+    uint64_t HashToRange(const CScript& element, uint64_t nRange) const;
+
+public:
+    BlockFilter();
+    BlockFilter(const CBlock& block, const CBlockUndo& blockUndo);
+    BlockFilter(const uint256& blockHash, const std::set<CScript>& elements);
+
+    const uint256& GetBlockHash() const { return blockHash_; }
+    const std::vector<unsigned char>& GetEncodedFilter() const { return encodedFilter_; }
+    uint64_t GetElementCount() const { return nElements_; }
+
+    //! Whether any of the scripts may be in the filter; a filter that cannot be decoded matches anything
+    bool MatchesAny(const std::vector<CScript>& elements) const;
+
+    //! The scripts the filter of a block paying to, or spending from, the script has for it
+    static void AddElementsForScript(const CScript& script, std::set<CScript>& elements);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(blockHash_);
+        READWRITE(encodedFilter_);
+        if (ser_action.ForRead())
+            ReadElementCount();
+    }
+};
+#endif// BLOCK_FILTER_H
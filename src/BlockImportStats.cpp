@@ -0,0 +1,127 @@
+#include <BlockImportStats.h>
+
+#include <primitives/block.h>
+#include <tinyformat.h>
+#include <utiltime.h>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+constexpr unsigned NUMBER_OF_PHASES = static_cast<unsigned>(BlockImportPhase::NUMBER_OF_PHASES);
+}
+
+std::atomic<int64_t> BlockImportStats::phaseMicros_[NUMBER_OF_PHASES];
+std::atomic<uint64_t> BlockImportStats::blocks_(0);
+std::atomic<uint64_t> BlockImportStats::transactions_(0);
+std::atomic<uint64_t> BlockImportStats::inputs_(0);
+std::atomic<int64_t> BlockImportStats::startMicros_(0);
+
+BlockImportReport::BlockImportReport()
+    : nBlocks(0)
+    , nTransactions(0)
+    , nInputs(0)
+    , nElapsedMicros(0)
+    , phaseMicros(NUMBER_OF_PHASES, 0)
+    , nPeakResidentKilobytes(0)
+{
+}
+
+double BlockImportReport::PerSecond(uint64_t count) const
+{
+    return nElapsedMicros > 0 ? count * 1000000.0 / nElapsedMicros : 0.0;
+}
+
+std::vector<std::string> BlockImportReport::ToLines() const
+{
+    std::vector<std::string> lines;
+    lines.push_back(strprintf("elapsed: %.3fs", nElapsedMicros * 0.000001));
+    lines.push_back(strprintf("blocks: %u (%.2f/s)", nBlocks, PerSecond(nBlocks)));
+    lines.push_back(strprintf("transactions: %u (%.2f/s)", nTransactions, PerSecond(nTransactions)));
+    lines.push_back(strprintf("inputs: %u (%.2f/s)", nInputs, PerSecond(nInputs)));
+    for (unsigned i = 0; i < NUMBER_OF_PHASES; ++i) {
+        lines.push_back(strprintf("%s: %.3fs (%.1f%%)",
+                                  BlockImportStats::PhaseName(static_cast<BlockImportPhase>(i)),
+                                  phaseMicros[i] * 0.000001,
+                                  nElapsedMicros > 0 ? phaseMicros[i] * 100.0 / nElapsedMicros : 0.0));
+    }
+    lines.push_back(nPeakResidentKilobytes > 0 ? strprintf("peak rss: %u KiB", nPeakResidentKilobytes) : std::string("peak rss: unknown"));
+    return lines;
+}
+
+const char* BlockImportStats::PhaseName(BlockImportPhase phase)
+{
+    switch (phase) {
+    case BlockImportPhase::READ:
+        return "read";
+    case BlockImportPhase::CHECK_BLOCK:
+        return "checkblock";
+    case BlockImportPhase::CONNECT_BLOCK:
+        return "connectblock";
+    case BlockImportPhase::FLUSH:
+        return "flush";
+    case BlockImportPhase::INDEX_WRITES:
+        return "index writes";
+    default:
+        return "unknown";
+    }
+}
+
+void BlockImportStats::AddPhaseTime(BlockImportPhase phase, int64_t nMicros)
+{
+    phaseMicros_[static_cast<unsigned>(phase)].fetch_add(nMicros, std::memory_order_relaxed);
+}
+
+void BlockImportStats::BlockConnected(const CBlock& block)
+{
+    uint64_t nInputs = 0;
+    for (const CTransaction& tx : block.vtx) {
+        if (!tx.IsCoinBase())
+            nInputs += tx.vin.size();
+    }
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+    transactions_.fetch_add(block.vtx.size(), std::memory_order_relaxed);
+    inputs_.fetch_add(nInputs, std::memory_order_relaxed);
+}
+
+void BlockImportStats::Reset()
+{
+    for (unsigned i = 0; i < NUMBER_OF_PHASES; ++i)
+        phaseMicros_[i] = 0;
+    blocks_ = 0;
+    transactions_ = 0;
+    inputs_ = 0;
+    startMicros_ = GetTimeMicros();
+}
+
+BlockImportReport BlockImportStats::GetReport()
+{
+    BlockImportReport report;
+    report.nBlocks = blocks_;
+    report.nTransactions = transactions_;
+    report.nInputs = inputs_;
+    report.nElapsedMicros = GetTimeMicros() - startMicros_;
+    for (unsigned i = 0; i < NUMBER_OF_PHASES; ++i)
+        report.phaseMicros[i] = phaseMicros_[i];
+    report.nPeakResidentKilobytes = GetPeakResidentKilobytes();
+    return report;
+}
+
+uint64_t BlockImportStats::GetPeakResidentKilobytes()
+{
+#ifndef WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    // Darwin reports bytes where everyone else reports kilobytes.
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
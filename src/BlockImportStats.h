@@ -0,0 +1,67 @@
+#ifndef BLOCK_IMPORT_STATS_H
+#define BLOCK_IMPORT_STATS_H
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CBlock;
+
+/** Stages a block goes through from a block file into the chain state */
+enum class BlockImportPhase {
+    //! Scanning and deserializing block files, and reading blocks back for connecting
+    READ,
+    //! Context free checks of CheckBlock
+    CHECK_BLOCK,
+    //! ConnectBlock, including waiting for the script checks
+    CONNECT_BLOCK,
+    //! Moving the coins of connected blocks into the chain state and down to the database
+    FLUSH,
+    //! Writing blocks, block file information and the block index
+    INDEX_WRITES,
+    NUMBER_OF_PHASES
+};
+
+/** What a run of block imports did, and where its time went */
+struct BlockImportReport {
+    uint64_t nBlocks;
+    uint64_t nTransactions;
+    uint64_t nInputs;
+    int64_t nElapsedMicros;
+    std::vector<int64_t> phaseMicros;
+    //! Largest resident set size of the process so far, 0 where the platform does not tell
+    uint64_t nPeakResidentKilobytes;
+
+    BlockImportReport();
+    double PerSecond(uint64_t count) const;
+    //! One line per figure, for the log
+    std::vector<std::string> ToLines() const;
+};
+
+/**
+ * Process wide counters of the work done validating and connecting blocks,
+ * split by phase, so that replaying a fixed set of block files gives numbers
+ * to compare between builds.
+ *
+ * The counters only ever add up; Reset marks the start of the run to report.
+ */
+class BlockImportStats
+{
+private:
+    static std::atomic<int64_t> phaseMicros_[static_cast<unsigned>(BlockImportPhase::NUMBER_OF_PHASES)];
+    static std::atomic<uint64_t> blocks_;
+    static std::atomic<uint64_t> transactions_;
+    static std::atomic<uint64_t> inputs_;
+    static std::atomic<int64_t> startMicros_;
+
+public:
+    static const char* PhaseName(BlockImportPhase phase);
+    static void AddPhaseTime(BlockImportPhase phase, int64_t nMicros);
+    //! Counts a block that made it into the active chain
+    static void BlockConnected(const CBlock& block);
+
+    static void Reset();
+    static BlockImportReport GetReport();
+    static uint64_t GetPeakResidentKilobytes();
+};
+#endif// BLOCK_IMPORT_STATS_H
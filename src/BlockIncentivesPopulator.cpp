@@ -80,13 +80,13 @@ bool IsValidTreasuryPayment(const CChainParams& chainParameters, const CBlockRew
 
     if(!verifyPayment(TreasuryPaymentAddress(chainParameters), treasuryPart))
     {
-        LogPrint("masternode", "Expecting treasury payment, no payment address detected, rejecting\n");
+        LogPrint(LOG_MASTERNODE, "Expecting treasury payment, no payment address detected, rejecting\n");
         return false;
     }
 
     if(!verifyPayment(CharityPaymentAddress(chainParameters), charityPart))
     {
-        LogPrint("masternode", "Expecting charity payment, no payment address detected, rejecting\n");
+        LogPrint(LOG_MASTERNODE, "Expecting charity payment, no payment address detected, rejecting\n");
         return false;
     }
 
@@ -206,7 +206,7 @@ bool BlockIncentivesPopulator::HasValidMasternodePayee(const CTransaction &txNew
        into blockchain history anyway.  On regtest, this allows proper
        functioning.  */
     if (pindex->nHeight <= 100) {
-        LogPrint("masternode", "%s : not checking payments for height %d\n",
+        LogPrint(LOG_MASTERNODE, "%s : not checking payments for height %d\n",
                  __func__, pindex->nHeight);
         return true;
     }
@@ -214,7 +214,7 @@ bool BlockIncentivesPopulator::HasValidMasternodePayee(const CTransaction &txNew
     //check for masternode payee
     uint256 seedHash;
     if (!GetBlockHashForScoring(seedHash, pindex, 0)) {
-        LogPrint("masternode", "%s : failed to get scoring hash for height %d\n",
+        LogPrint(LOG_MASTERNODE, "%s : failed to get scoring hash for height %d\n",
                  __func__, pindex->nHeight);
         return false;
     }
@@ -3,7 +3,6 @@
 #include <BlockTemplate.h>
 #include "chain.h"
 #include "coins.h"
-#include "FeeAndPriorityCalculator.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "txmempool.h"
@@ -15,6 +14,8 @@
 
 #include <Settings.h>
 
+#include <algorithm>
+
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
 
 static unsigned int GetMaxBlockSize(const Settings& settings,unsigned int defaultMaxBlockSize, unsigned int maxBlockSizeCurrent)
@@ -43,25 +44,105 @@ static unsigned int GetBlockMinSize(const Settings& settings, unsigned int defau
 
 //
 // Unconfirmed transactions in the memory pool often depend on other
-// transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
-// The COrphan class keeps track of these 'temporary orphans' while
-// CreateBlock is figuring out which transactions to include.
+// transactions in the memory pool. The pool keeps its transactions ordered by
+// priority and by fee rate, so a block is filled by walking those orders. A
+// transaction met in them before the pool transactions it spends are in the
+// block waits for them, and joins a queue of released transactions, ordered
+// the same way, once they are.
+//
+
+// Once the block is this close to full, give up after this many transactions in a row did not fit
+static const unsigned int BLOCK_FULL_MARGIN = 1000;
+static const unsigned int MAX_CONSECUTIVE_FAILURES = 1000;
+
+static TxPriority GetTxPriority(const CTxMemPoolEntry& entry, int nHeight)
+{
+    return TxPriority(entry.GetModifiedPriority(nHeight), CFeeRate(entry.GetModifiedFee(), entry.GetTxSize()), &entry);
+}
+
+//
+// When selecting packages, a transaction is scored by the fee rate of itself
+// together with its ancestors still in the pool, so a child paying well pulls
+// its parents into the block. Once some of its ancestors are in the block, what
+// is left of its package is tracked apart from the pool's own totals.
 //
-class COrphan
+static bool IsBetterPackage(CAmount aFees, uint64_t aSize, const uint256& aHash, CAmount bFees, uint64_t bSize, const uint256& bHash)
 {
+    const double f1 = (double)aFees * bSize;
+    const double f2 = (double)bFees * aSize;
+    if (f1 != f2)
+        return f1 > f2;
+    return aHash < bHash;
+}
+
+namespace
+{
+struct ModifiedPackage
+{
+    const CTxMemPoolEntry* entry;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+
+    explicit ModifiedPackage(const CTxMemPoolEntry& entryIn)
+        : entry(&entryIn)
+        , nSizeWithAncestors(entryIn.GetSizeWithAncestors())
+        , nModFeesWithAncestors(entryIn.GetModFeesWithAncestors())
+    {
+    }
+};
+
+struct CompareModifiedPackage
+{
+    bool operator()(const ModifiedPackage* a, const ModifiedPackage* b) const
+    {
+        return IsBetterPackage(a->nModFeesWithAncestors, a->nSizeWithAncestors, a->entry->GetTx().GetHash(),
+                               b->nModFeesWithAncestors, b->nSizeWithAncestors, b->entry->GetTx().GetHash());
+    }
+};
+
+class ModifiedPackages
+{
+private:
+    boost::unordered_map<uint256, ModifiedPackage, SaltedUint256Hasher> packages_;
+    std::set<const ModifiedPackage*, CompareModifiedPackage> byScore_;
+
 public:
-    const CTransaction* ptx;
-    std::set<uint256> setDependsOn;
-    CFeeRate feeRate;
-    double dPriority;
+    bool Empty() const { return packages_.empty(); }
+    bool Contains(const uint256& hash) const { return packages_.count(hash) > 0; }
+    const ModifiedPackage& Best() const { return **byScore_.begin(); }
+
+    void Erase(const uint256& hash)
+    {
+        boost::unordered_map<uint256, ModifiedPackage, SaltedUint256Hasher>::iterator it = packages_.find(hash);
+        if (it == packages_.end())
+            return;
+        byScore_.erase(&it->second);
+        packages_.erase(it);
+    }
 
-    COrphan(const CTransaction* ptxIn) : ptx(ptxIn), feeRate(0), dPriority(0)
+    /** Take an ancestor that went into the block out of the package of entry */
+    void Subtract(const CTxMemPoolEntry& entry, uint64_t nAncestorSize, CAmount nAncestorFees)
     {
+        boost::unordered_map<uint256, ModifiedPackage, SaltedUint256Hasher>::iterator it =
+            packages_.insert(std::make_pair(entry.GetTx().GetHash(), ModifiedPackage(entry))).first;
+        byScore_.erase(&it->second);
+        it->second.nSizeWithAncestors -= nAncestorSize;
+        it->second.nModFeesWithAncestors -= nAncestorFees;
+        byScore_.insert(&it->second);
     }
 };
 
+struct CompareByAncestorCount
+{
+    bool operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const
+    {
+        if (a->GetCountWithAncestors() != b->GetCountWithAncestors())
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        return a->GetTx().GetHash() < b->GetTx().GetHash();
+    }
+};
+}
+
 class TxPriorityCompare
 {
     bool byFee;
@@ -98,62 +179,50 @@ BlockMemoryPoolTransactionCollector::BlockMemoryPoolTransactionCollector(
     , blockMaxSize_(GetMaxBlockSize(settings,DEFAULT_BLOCK_MAX_SIZE, MAX_BLOCK_SIZE_CURRENT))
     , blockPrioritySize_(GetBlockPrioritySize(settings,DEFAULT_BLOCK_PRIORITY_SIZE, blockMaxSize_))
     , blockMinSize_(GetBlockMinSize(settings,DEFAULT_BLOCK_MIN_SIZE, blockMaxSize_))
+    , selectPackages_(settings.GetBoolArg("-blockselectpackages", DEFAULT_BLOCK_SELECT_PACKAGES))
 {
 
 }
 
-void BlockMemoryPoolTransactionCollector::RecordOrphanTransaction (
-    std::shared_ptr<COrphan>& porphan,
-    const CTransaction& tx,
-    const CTxIn& txin,
-    std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& dependentTransactions) const
-{
-    if (porphan == nullptr)
-        porphan = std::make_shared<COrphan>(&tx);
-    dependentTransactions[txin.prevout.hash].push_back(porphan);
-    porphan->setDependsOn.insert(txin.prevout.hash);
-}
-
-void BlockMemoryPoolTransactionCollector::ComputeTransactionPriority (
-    double& dPriority,
-    const CTransaction& tx,
-    CAmount nTotalIn,
-    COrphan* porphan,
-    std::vector<TxPriority>& vecPriority,
-    const CTransaction* mempoolTx) const
+bool BlockMemoryPoolTransactionCollector::WaitsForParents (
+    const CTxMemPoolEntry& entry,
+    const std::set<uint256>& transactionsInBlock,
+    TransactionsWaitingOnParent& waitingOnParent) const
 {
-    unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-    dPriority = FeeAndPriorityCalculator::instance().ComputePriority(tx,dPriority, nTxSize);
-
-    uint256 hash = tx.GetHash();
-    mempool_.ApplyDeltas(hash, dPriority, nTotalIn);
-
-    CFeeRate feeRate(nTotalIn - tx.GetValueOut(), nTxSize);
-
-    if (porphan) {
-        porphan->dPriority = dPriority;
-        porphan->feeRate = feeRate;
-    } else
-        vecPriority.push_back(TxPriority(dPriority, feeRate, mempoolTx));
+    std::set<uint256> parents;
+    for (const CTxIn& txin : entry.GetTx().vin) {
+        const uint256& parent = txin.prevout.hash;
+        if (mempool_.mapTx.count(parent) && !transactionsInBlock.count(parent) && parents.insert(parent).second)
+            waitingOnParent[parent].push_back(&entry);
+    }
+    return !parents.empty();
 }
 
 void BlockMemoryPoolTransactionCollector::AddDependingTransactionsToPriorityQueue (
-    std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& dependentTransactions,
+    TransactionsWaitingOnParent& waitingOnParent,
     const uint256& hash,
+    const std::set<uint256>& transactionsInBlock,
+    const int& nHeight,
     std::vector<TxPriority>& vecPriority,
     TxPriorityCompare& comparer) const
 {
-    if (dependentTransactions.count(hash)) {
-        for (auto& porphan : dependentTransactions[hash]) {
-            if (!porphan->setDependsOn.empty()) {
-                porphan->setDependsOn.erase(hash);
-                if (porphan->setDependsOn.empty()) {
-                    vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                    std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                }
+    TransactionsWaitingOnParent::iterator it = waitingOnParent.find(hash);
+    if (it == waitingOnParent.end())
+        return;
+    for (const CTxMemPoolEntry* child : it->second) {
+        bool fReady = true;
+        for (const CTxIn& txin : child->GetTx().vin) {
+            if (mempool_.mapTx.count(txin.prevout.hash) && !transactionsInBlock.count(txin.prevout.hash)) {
+                fReady = false;
+                break;
             }
         }
+        if (fReady) {
+            vecPriority.push_back(GetTxPriority(*child, nHeight));
+            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        }
     }
+    waitingOnParent.erase(it);
 }
 
 bool BlockMemoryPoolTransactionCollector::IsFreeTransaction (
@@ -182,62 +251,6 @@ void BlockMemoryPoolTransactionCollector::AddTransactionToBlock (
     blocktemplate.block.vtx.push_back(tx);
 }
 
-std::vector<TxPriority> BlockMemoryPoolTransactionCollector::PrioritizeMempoolTransactions (
-    const int& nHeight,
-    std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& dependentTransactions,
-    CCoinsViewCache& view) const
-{
-    std::vector<TxPriority> vecPriority;
-    vecPriority.reserve(mempool_.mapTx.size());
-    for (auto mi = mempool_.mapTx.begin(); mi != mempool_.mapTx.end(); ++mi) {
-        const CTransaction& tx = mi->second.GetTx();
-        if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, activeChain_, nHeight)){
-            continue;
-        }
-
-        std::shared_ptr<COrphan> porphan;
-        double dPriority = 0;
-        CAmount nTotalIn = 0;
-        bool fMissingInputs = false;
-        for (const CTxIn& txin : tx.vin) {
-
-            // Read prev transaction
-            if (!view.HaveCoins(txin.prevout.hash)) {
-                CTransaction prevTx;
-                if(!mempool_.lookup(txin.prevout.hash, prevTx)) {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    LogPrintf("ERROR: mempool transaction missing input\n");
-                    fMissingInputs = true;
-                    break;
-                }
-
-                // Has to wait for dependencies
-                RecordOrphanTransaction(porphan, tx, txin, dependentTransactions);
-
-                nTotalIn += prevTx.vout[txin.prevout.n].nValue;
-                continue;
-            }
-
-            const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-            assert(coins);
-
-            CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-            nTotalIn += nValueIn;
-
-            int nConf = nHeight - coins->nHeight;
-
-            dPriority += (double)nValueIn * nConf;
-        }
-        if (fMissingInputs) {
-            continue;
-        }
-        ComputeTransactionPriority(dPriority, tx, nTotalIn, porphan.get(), vecPriority, &mi->second.GetTx());
-    }
-    return vecPriority;
-}
-
 void BlockMemoryPoolTransactionCollector::PrioritizeFeePastPrioritySize
 (
     std::vector<TxPriority>& vecPriority,
@@ -269,10 +282,8 @@ PrioritizedTransactionData::PrioritizedTransactionData(
 }
 
 std::vector<PrioritizedTransactionData> BlockMemoryPoolTransactionCollector::PrioritizeTransactions(
-    std::vector<TxPriority>& vecPriority,
     const int& nHeight,
-    CCoinsViewCache& view,
-    std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& dependentTransactions) const
+    CCoinsViewCache& view) const
 {
     std::vector<PrioritizedTransactionData> prioritizedTransactions;
 
@@ -286,29 +297,73 @@ std::vector<PrioritizedTransactionData> BlockMemoryPoolTransactionCollector::Pri
     int nBlockSigOps = 100;
     const unsigned int constexpr nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
     bool fSortedByFee = (blockPrioritySize_ <= 0);
+    unsigned int nConsecutiveFailed = 0;
 
+    const CTxMemPool::setEntriesByPriority& byPriority = mempool_.GetPriorityOrder(nHeight);
+    const CTxMemPool::setEntriesByFeeRate& byFeeRate = mempool_.GetFeeRateOrder();
+    CTxMemPool::setEntriesByPriority::const_iterator nextByPriority = byPriority.begin();
+    CTxMemPool::setEntriesByFeeRate::const_iterator nextByFeeRate = byFeeRate.begin();
+
+    std::vector<TxPriority> vecPriority;
     TxPriorityCompare comparer(fSortedByFee);
-    std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+    std::set<uint256> transactionsConsidered;
+    std::set<uint256> transactionsInBlock;
+    TransactionsWaitingOnParent waitingOnParent;
+
+    while (true) {
+        // Next in the pool's order, past what was already taken from the other order or the queue
+        const CTxMemPoolEntry* nextInOrder = nullptr;
+        if (fSortedByFee) {
+            while (nextByFeeRate != byFeeRate.end() && transactionsConsidered.count((*nextByFeeRate)->GetTx().GetHash()))
+                ++nextByFeeRate;
+            if (nextByFeeRate != byFeeRate.end())
+                nextInOrder = *nextByFeeRate;
+        } else {
+            while (nextByPriority != byPriority.end() && transactionsConsidered.count((*nextByPriority)->GetTx().GetHash()))
+                ++nextByPriority;
+            if (nextByPriority != byPriority.end())
+                nextInOrder = *nextByPriority;
+        }
 
-    while (!vecPriority.empty()) {
-        // Take highest priority transaction off the priority queue:
-        double dPriority = vecPriority.front().get<0>();
-        CFeeRate feeRate = vecPriority.front().get<1>();
-        const CTransaction& tx = *(vecPriority.front().get<2>());
+        // Take the best of it and the released transactions
+        TxPriority candidate;
+        const bool fReleased = !vecPriority.empty() &&
+            (nextInOrder == nullptr || !comparer(vecPriority.front(), GetTxPriority(*nextInOrder, nHeight)));
+        if (fReleased) {
+            candidate = vecPriority.front();
+            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
+            vecPriority.pop_back();
+        } else if (nextInOrder != nullptr) {
+            candidate = GetTxPriority(*nextInOrder, nHeight);
+        } else {
+            break;
+        }
+        double dPriority = candidate.get<0>();
+        CFeeRate feeRate = candidate.get<1>();
+        const CTxMemPoolEntry& entry = *candidate.get<2>();
+        const CTransaction& tx = entry.GetTx();
+        const uint256& hash = tx.GetHash();
+        transactionsConsidered.insert(hash);
 
-        std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-        vecPriority.pop_back();
+        if (!fReleased) {
+            if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, activeChain_, nHeight))
+                continue;
+            // Has to wait for dependencies
+            if (WaitsForParents(entry, transactionsInBlock, waitingOnParent))
+                continue;
+        }
 
         // Size limits
-        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        unsigned int nTxSize = entry.GetTxSize();
         // Legacy limits on sigOps:
         unsigned int nTxSigOps = GetLegacySigOpCount(tx);
         // Skip free transactions if we're past the minimum block size:
-        const uint256& hash = tx.GetHash();
         if (nBlockSize + nTxSize >= blockMaxSize_ ||
             nBlockSigOps + nTxSigOps >= nMaxBlockSigOps||
             IsFreeTransaction(hash, fSortedByFee, feeRate, nBlockSize, nTxSize, tx))
         {
+            if (++nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockSize + BLOCK_FULL_MARGIN >= blockMaxSize_)
+                break;
             continue;
         }
         // Prioritise by fee once past the priority size or we run out of high-priority
@@ -333,12 +388,135 @@ std::vector<PrioritizedTransactionData> BlockMemoryPoolTransactionCollector::Pri
         prioritizedTransactions.emplace_back(tx, nTxSigOps);
         nBlockSize += nTxSize;
         nBlockSigOps += nTxSigOps;
+        nConsecutiveFailed = 0;
 
         CTxUndo txundo;
         UpdateCoinsWithTransaction(tx, view, txundo, nHeight);
 
         // Add transactions that depend on this one to the priority queue
-        AddDependingTransactionsToPriorityQueue(dependentTransactions, hash, vecPriority, comparer);
+        transactionsInBlock.insert(hash);
+        AddDependingTransactionsToPriorityQueue(waitingOnParent, hash, transactionsInBlock, nHeight, vecPriority, comparer);
+    }
+
+    LogPrintf("CreateNewBlock(): total size %u\n", nBlockSize);
+    return prioritizedTransactions;
+}
+
+std::vector<PrioritizedTransactionData> BlockMemoryPoolTransactionCollector::PrioritizePackages(
+    const int& nHeight,
+    CCoinsViewCache& view) const
+{
+    std::vector<PrioritizedTransactionData> prioritizedTransactions;
+
+    uint64_t nBlockSize = 1000;
+    int nBlockSigOps = 100;
+    const unsigned int constexpr nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
+    unsigned int nConsecutiveFailed = 0;
+
+    const CTxMemPool::setEntriesByAncestorScore& byAncestorScore = mempool_.GetAncestorScoreOrder();
+    CTxMemPool::setEntriesByAncestorScore::const_iterator next = byAncestorScore.begin();
+    ModifiedPackages modifiedPackages;
+    std::set<uint256> transactionsInBlock;
+    std::set<uint256> failedPackages;
+
+    while (true) {
+        // Packages with an ancestor in the block already are scored by what is left of them
+        while (next != byAncestorScore.end()) {
+            const uint256& hash = (*next)->GetTx().GetHash();
+            if (!transactionsInBlock.count(hash) && !failedPackages.count(hash) && !modifiedPackages.Contains(hash))
+                break;
+            ++next;
+        }
+
+        const CTxMemPoolEntry* package = nullptr;
+        uint64_t nPackageSize = 0;
+        CAmount nPackageFees = 0;
+        if (!modifiedPackages.Empty()) {
+            const ModifiedPackage& best = modifiedPackages.Best();
+            if (next == byAncestorScore.end() ||
+                IsBetterPackage(best.nModFeesWithAncestors, best.nSizeWithAncestors, best.entry->GetTx().GetHash(),
+                                (*next)->GetModFeesWithAncestors(), (*next)->GetSizeWithAncestors(), (*next)->GetTx().GetHash())) {
+                package = best.entry;
+                nPackageSize = best.nSizeWithAncestors;
+                nPackageFees = best.nModFeesWithAncestors;
+                modifiedPackages.Erase(package->GetTx().GetHash());
+            }
+        }
+        if (package == nullptr) {
+            if (next == byAncestorScore.end())
+                break;
+            package = *next++;
+            nPackageSize = package->GetSizeWithAncestors();
+            nPackageFees = package->GetModFeesWithAncestors();
+        }
+        const uint256 hash = package->GetTx().GetHash();
+
+        // Everything left pays less, so it is only worth taking while below the minimum block size
+        if (CFeeRate(nPackageFees, nPackageSize) < txFeeRate_ && nBlockSize + nPackageSize >= blockMinSize_)
+            break;
+
+        if (nBlockSize + nPackageSize >= blockMaxSize_) {
+            failedPackages.insert(hash);
+            if (++nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockSize + BLOCK_FULL_MARGIN >= blockMaxSize_)
+                break;
+            continue;
+        }
+
+        std::set<uint256> ancestors;
+        mempool_.CalculateAncestors(package->GetTx(), ancestors);
+        std::vector<const CTxMemPoolEntry*> packageEntries(1, package);
+        for (const uint256& ancestor : ancestors) {
+            if (!transactionsInBlock.count(ancestor))
+                packageEntries.push_back(&mempool_.mapTx.find(ancestor)->second);
+        }
+        // A transaction has more ancestors than any of them, so this puts parents first
+        std::sort(packageEntries.begin(), packageEntries.end(), CompareByAncestorCount());
+
+        // Check the package as a whole on a view of its own before any of it goes in
+        CCoinsViewCache packageView(&view);
+        std::vector<unsigned int> packageSigOps;
+        unsigned int nPackageSigOps = 0;
+        bool fPackageValid = true;
+        for (const CTxMemPoolEntry* entry : packageEntries) {
+            const CTransaction& tx = entry->GetTx();
+            if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, activeChain_, nHeight) || !packageView.HaveInputs(tx)) {
+                fPackageValid = false;
+                break;
+            }
+            const unsigned int nTxSigOps = GetLegacySigOpCount(tx) + GetP2SHSigOpCount(tx, packageView);
+            CValidationState state;
+            if (!CheckInputs(tx, state, packageView, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true)) {
+                fPackageValid = false;
+                break;
+            }
+            packageSigOps.push_back(nTxSigOps);
+            nPackageSigOps += nTxSigOps;
+            CTxUndo txundo;
+            UpdateCoinsWithTransaction(tx, packageView, txundo, nHeight);
+        }
+        if (!fPackageValid || nBlockSigOps + nPackageSigOps >= nMaxBlockSigOps) {
+            failedPackages.insert(hash);
+            ++nConsecutiveFailed;
+            continue;
+        }
+        packageView.Flush();
+
+        for (unsigned int i = 0; i < packageEntries.size(); i++) {
+            prioritizedTransactions.emplace_back(packageEntries[i]->GetTx(), packageSigOps[i]);
+            transactionsInBlock.insert(packageEntries[i]->GetTx().GetHash());
+        }
+        nBlockSize += nPackageSize;
+        nBlockSigOps += nPackageSigOps;
+        nConsecutiveFailed = 0;
+
+        for (const CTxMemPoolEntry* entry : packageEntries) {
+            std::set<uint256> descendants;
+            mempool_.CalculateDescendants(entry->GetTx().GetHash(), descendants);
+            for (const uint256& descendant : descendants) {
+                if (!transactionsInBlock.count(descendant) && !failedPackages.count(descendant))
+                    modifiedPackages.Subtract(mempool_.mapTx.find(descendant)->second, entry->GetTxSize(), entry->GetModifiedFee());
+            }
+        }
     }
 
     LogPrintf("CreateNewBlock(): total size %u\n", nBlockSize);
@@ -350,17 +528,14 @@ void BlockMemoryPoolTransactionCollector::AddTransactionsToBlockIfPossible (
     CCoinsViewCache& view,
     CBlockTemplate& blocktemplate) const
 {
-    std::map<uint256, std::vector<std::shared_ptr<COrphan>>> dependentTransactions;
-
-    std::vector<TxPriority> vecPriority =
-        PrioritizeMempoolTransactions(nHeight, dependentTransactions, view);
-
     std::vector<PrioritizedTransactionData> prioritizedTransactions =
-        PrioritizeTransactions(
-            vecPriority,
-            nHeight,
-            view,
-            dependentTransactions);
+        selectPackages_ ?
+            PrioritizePackages(
+                nHeight,
+                view) :
+            PrioritizeTransactions(
+                nHeight,
+                view);
 
     for(const PrioritizedTransactionData& txData: prioritizedTransactions)
     {
@@ -3,15 +3,17 @@
 
 #include <amount.h>
 #include <FeeRate.h>
+#include <SaltedHasher.h>
 #include <uint256.h>
 
 #include <list>
-#include <memory>
+#include <map>
 #include <set>
 #include <stdint.h>
 #include <vector>
 
 #include <boost/tuple/tuple.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
 #include <I_BlockTransactionCollector.h>
@@ -40,10 +42,12 @@ struct PrioritizedTransactionData
         unsigned txSigOps);
 };
 
-class COrphan;
+class CTxMemPoolEntry;
 
 // We want to sort transactions by priority and fee rate, so:
-typedef boost::tuple<double, CFeeRate, const CTransaction*> TxPriority;
+typedef boost::tuple<double, CFeeRate, const CTxMemPoolEntry*> TxPriority;
+//! Transactions left out of the block for now, by the txid of the parent they wait for
+typedef boost::unordered_map<uint256, std::vector<const CTxMemPoolEntry*>, SaltedUint256Hasher> TransactionsWaitingOnParent;
 class TxPriorityCompare;
 class CChain;
 
@@ -58,24 +62,19 @@ private:
     const unsigned blockMaxSize_;
     const unsigned blockPrioritySize_;
     const unsigned blockMinSize_;
+    const bool selectPackages_;
 private:
     void UpdateTime(CBlockHeader* block, const CBlockIndex* pindexPrev) const;
-    void RecordOrphanTransaction (
-        std::shared_ptr<COrphan>& porphan,
-        const CTransaction& tx,
-        const CTxIn& txin,
-        std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& mapDependers) const;
 
-    void ComputeTransactionPriority (
-        double& dPriority,
-        const CTransaction& tx,
-        CAmount nTotalIn,
-        COrphan* porphan,
-        std::vector<TxPriority>& vecPriority,
-        const CTransaction* mempoolTx) const;
+    bool WaitsForParents (
+        const CTxMemPoolEntry& entry,
+        const std::set<uint256>& transactionsInBlock,
+        TransactionsWaitingOnParent& waitingOnParent) const;
     void AddDependingTransactionsToPriorityQueue (
-        std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& mapDependers,
+        TransactionsWaitingOnParent& waitingOnParent,
         const uint256& hash,
+        const std::set<uint256>& transactionsInBlock,
+        const int& nHeight,
         std::vector<TxPriority>& vecPriority,
         TxPriorityCompare& comparer) const;
 
@@ -91,11 +90,6 @@ private:
         const CTransaction& tx,
         CBlockTemplate& blocktemplate) const;
 
-    std::vector<TxPriority> PrioritizeMempoolTransactions (
-        const int& nHeight,
-        std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& mapDependers,
-        CCoinsViewCache& view) const;
-
     void PrioritizeFeePastPrioritySize (
         std::vector<TxPriority>& vecPriority,
         bool& fSortedByFee,
@@ -104,10 +98,11 @@ private:
         const unsigned int& nTxSize,
         double& dPriority) const;
     std::vector<PrioritizedTransactionData> PrioritizeTransactions(
-        std::vector<TxPriority>& vecPriority,
         const int& nHeight,
-        CCoinsViewCache& view,
-        std::map<uint256, std::vector<std::shared_ptr<COrphan>>>& mapDependers) const;
+        CCoinsViewCache& view) const;
+    std::vector<PrioritizedTransactionData> PrioritizePackages(
+        const int& nHeight,
+        CCoinsViewCache& view) const;
     void AddTransactionsToBlockIfPossible (
         const int& nHeight,
         CCoinsViewCache& view,
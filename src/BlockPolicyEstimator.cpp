@@ -0,0 +1,172 @@
+#include <BlockPolicyEstimator.h>
+
+#include <Logging.h>
+#include <streams.h>
+#include <txmempool.h>
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+//! Bound of the last bucket, which takes everything above the maximum
+constexpr double INF_BUCKET = 1e99;
+
+std::vector<double> BucketBounds(double minimum, double maximum, double spacing)
+{
+    std::vector<double> bounds;
+    for (double bound = minimum; bound <= maximum; bound *= spacing)
+        bounds.push_back(bound);
+    bounds.push_back(INF_BUCKET);
+    return bounds;
+}
+}
+
+BlockPolicyEstimator::BlockPolicyEstimator(
+    const CFeeRate& minRelayFee
+    ): minTrackedFee_(std::max(minRelayFee.GetFeePerK(), (CAmount)MIN_FEERATE))
+    , nBestSeenHeight_(0)
+    , mapMemPoolTxs_()
+    , feeStats_(BucketBounds(MIN_FEERATE, MAX_FEERATE, FEE_SPACING), MAX_BLOCK_CONFIRMS, DEFAULT_DECAY)
+    , priStats_(BucketBounds(MIN_PRIORITY, MAX_PRIORITY, PRI_SPACING), MAX_BLOCK_CONFIRMS, DEFAULT_DECAY)
+    , feeEstimates_(MAX_BLOCK_CONFIRMS, CFeeRate(0))
+    , priorityEstimates_(MAX_BLOCK_CONFIRMS, -1)
+{
+}
+
+bool BlockPolicyEstimator::IsFeeDataPoint(const CFeeRate& feeRate, double dPriority) const
+{
+    return feeRate >= minTrackedFee_ && !AllowFree(dPriority);
+}
+
+bool BlockPolicyEstimator::IsPriDataPoint(const CFeeRate& feeRate, double dPriority) const
+{
+    return feeRate < minTrackedFee_ && AllowFree(dPriority);
+}
+
+void BlockPolicyEstimator::ProcessTransaction(const CTxMemPoolEntry& entry)
+{
+    const uint256 hash = entry.GetTx().GetHash();
+    if (mapMemPoolTxs_.count(hash))
+        return;
+    // Only count what came in at the tip, as the time to confirm of the rest is unknown
+    const unsigned int nBlockHeight = entry.GetHeight();
+    if (nBlockHeight != nBestSeenHeight_)
+        return;
+
+    const CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
+    const double dPriority = entry.GetPriority(nBlockHeight);
+    if (IsFeeDataPoint(feeRate, dPriority)) {
+        const unsigned int bucketIndex = feeStats_.NewTx(nBlockHeight, (double)feeRate.GetFeePerK());
+        mapMemPoolTxs_.insert(std::make_pair(hash, TrackedTx(&feeStats_, nBlockHeight, bucketIndex)));
+    } else if (IsPriDataPoint(feeRate, dPriority)) {
+        const unsigned int bucketIndex = priStats_.NewTx(nBlockHeight, dPriority);
+        mapMemPoolTxs_.insert(std::make_pair(hash, TrackedTx(&priStats_, nBlockHeight, bucketIndex)));
+    } else {
+        // Neither or both fee and priority would get it mined: there is no telling why it confirms
+    }
+}
+
+void BlockPolicyEstimator::RemoveTx(const uint256& hash)
+{
+    auto it = mapMemPoolTxs_.find(hash);
+    if (it == mapMemPoolTxs_.end())
+        return;
+    it->second.stats->RemoveTx(it->second.blockHeight, nBestSeenHeight_, it->second.bucketIndex);
+    mapMemPoolTxs_.erase(it);
+}
+
+void BlockPolicyEstimator::ProcessBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry)
+{
+    auto it = mapMemPoolTxs_.find(entry.GetTx().GetHash());
+    if (it == mapMemPoolTxs_.end())
+        return;
+    ConfirmationStats* stats = it->second.stats;
+    RemoveTx(entry.GetTx().GetHash());
+
+    // How many blocks did it take for miners to include this transaction?
+    const int blocksToConfirm = nBlockHeight - entry.GetHeight();
+    if (blocksToConfirm <= 0)
+        return;
+    if (stats == &feeStats_)
+        stats->Record(blocksToConfirm, (double)CFeeRate(entry.GetFee(), entry.GetTxSize()).GetFeePerK());
+    else
+        // Want priority when it went in
+        stats->Record(blocksToConfirm, entry.GetPriority(entry.GetHeight()));
+}
+
+void BlockPolicyEstimator::ProcessBlock(unsigned int nBlockHeight, const std::vector<CTxMemPoolEntry>& entries)
+{
+    if (nBlockHeight <= nBestSeenHeight_) {
+        // Ignore side chains and re-orgs; assuming they are random
+        // they don't affect the estimate.
+        // And if an attacker can re-org the chain at will, then
+        // you've got much bigger problems than "attacker can influence
+        // transaction fees."
+        return;
+    }
+    nBestSeenHeight_ = nBlockHeight;
+
+    feeStats_.ClearCurrent(nBlockHeight);
+    priStats_.ClearCurrent(nBlockHeight);
+    for (const CTxMemPoolEntry& entry : entries)
+        ProcessBlockTx(nBlockHeight, entry);
+    feeStats_.UpdateMovingAverages();
+    priStats_.UpdateMovingAverages();
+    UpdateEstimates();
+
+    LogPrint(LOG_ESTIMATEFEE, "Blockpolicy after updating estimates for %u confirmed entries, new mempool map size %u: fee=%s, prio=%g\n",
+        entries.size(), mapMemPoolTxs_.size(), EstimateFee(1), EstimatePriority(1));
+}
+
+void BlockPolicyEstimator::UpdateEstimates()
+{
+    for (unsigned int i = 0; i < feeEstimates_.size(); i++) {
+        const double fee = feeStats_.EstimateMedianVal(i + 1, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, nBestSeenHeight_);
+        feeEstimates_[i] = fee < 0 ? CFeeRate(0) : CFeeRate(llround(fee));
+        priorityEstimates_[i] = priStats_.EstimateMedianVal(i + 1, SUFFICIENT_PRITXS, MIN_SUCCESS_PCT, nBestSeenHeight_);
+    }
+}
+
+CFeeRate BlockPolicyEstimator::EstimateFee(int nBlocksToConfirm) const
+{
+    if (nBlocksToConfirm <= 0 || nBlocksToConfirm > (int)feeEstimates_.size())
+        return CFeeRate(0);
+    return feeEstimates_[nBlocksToConfirm - 1];
+}
+
+double BlockPolicyEstimator::EstimatePriority(int nBlocksToConfirm) const
+{
+    if (nBlocksToConfirm <= 0 || nBlocksToConfirm > (int)priorityEstimates_.size())
+        return -1;
+    return priorityEstimates_[nBlocksToConfirm - 1];
+}
+
+void BlockPolicyEstimator::Write(CAutoFile& fileout) const
+{
+    fileout << nBestSeenHeight_;
+    feeStats_.Write(fileout);
+    priStats_.Write(fileout);
+}
+
+void BlockPolicyEstimator::Read(CAutoFile& filein)
+{
+    unsigned int nFileBestSeenHeight;
+    filein >> nFileBestSeenHeight;
+    ConfirmationStats fileFeeStats(feeStats_);
+    ConfirmationStats filePriStats(priStats_);
+    fileFeeStats.Read(filein);
+    filePriStats.Read(filein);
+
+    // Now that we've processed the entire fee estimate data file and not
+    // thrown any errors, we can copy it to our data structures
+    feeStats_ = fileFeeStats;
+    priStats_ = filePriStats;
+    // The transactions tracked so far were counted in the buckets being replaced
+    mapMemPoolTxs_.clear();
+    nBestSeenHeight_ = std::max(nBestSeenHeight_, nFileBestSeenHeight);
+    const unsigned int nMaxConfirms = std::min(feeStats_.GetMaxConfirms(), priStats_.GetMaxConfirms());
+    feeEstimates_.assign(std::min(nMaxConfirms, (unsigned int)MAX_BLOCK_CONFIRMS), CFeeRate(0));
+    priorityEstimates_.assign(feeEstimates_.size(), -1);
+    UpdateEstimates();
+}
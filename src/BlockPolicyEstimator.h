@@ -0,0 +1,94 @@
+#ifndef BLOCK_POLICY_ESTIMATOR_H
+#define BLOCK_POLICY_ESTIMATOR_H
+#include <ConfirmationStats.h>
+#include <FeeRate.h>
+#include <SaltedHasher.h>
+#include <uint256.h>
+
+#include <map>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+class CAutoFile;
+class CTxMemPoolEntry;
+
+/**
+ * Estimates the fee rate, or the priority, a transaction needs to confirm
+ * within a number of blocks, from how long the transactions seen entering the
+ * pool took to confirm.
+ *
+ * Transactions are told apart by why they could have been mined: those paying
+ * enough fees without the priority to go in for free count towards the fee
+ * estimates, those with the priority but not the fees towards the priority
+ * estimates, and the rest are not counted. Only transactions entering at the
+ * tip are tracked, so that ones reloaded or reorganised back in do not look
+ * quicker or slower than they were. The answers for every target are worked
+ * out once a block, which leaves looking one up a matter of indexing a table.
+ */
+class BlockPolicyEstimator
+{
+private:
+    struct TrackedTx {
+        ConfirmationStats* stats;
+        unsigned int blockHeight;
+        unsigned int bucketIndex;
+
+        TrackedTx(ConfirmationStats* statsIn, unsigned int blockHeightIn, unsigned int bucketIndexIn)
+            : stats(statsIn), blockHeight(blockHeightIn), bucketIndex(bucketIndexIn) {}
+    };
+
+    CFeeRate minTrackedFee_;
+    unsigned int nBestSeenHeight_;
+    boost::unordered_map<uint256, TrackedTx, SaltedUint256Hasher> mapMemPoolTxs_;
+
+    ConfirmationStats feeStats_;
+    ConfirmationStats priStats_;
+
+    //! Answers per target, the first being for one block
+    std::vector<CFeeRate> feeEstimates_;
+    std::vector<double> priorityEstimates_;
+
+    bool IsFeeDataPoint(const CFeeRate& feeRate, double dPriority) const;
+    bool IsPriDataPoint(const CFeeRate& feeRate, double dPriority) const;
+    void ProcessBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry);
+    void UpdateEstimates();
+
+public:
+    //! Track confirmations up to this many blocks
+    static const unsigned int MAX_BLOCK_CONFIRMS = 25;
+    //! How much of its weight a block keeps with each new block, for a half life of about 350 blocks
+    static constexpr double DEFAULT_DECAY = .998;
+    //! Share of transactions that must have confirmed within the target for their range of buckets to pass
+    static constexpr double MIN_SUCCESS_PCT = .85;
+    //! Decayed transactions per block a range of buckets needs before it is judged
+    static constexpr double SUFFICIENT_FEETXS = 1;
+    static constexpr double SUFFICIENT_PRITXS = .2;
+
+    //! Bounds of the buckets, per kB for fee rates
+    static constexpr double MIN_FEERATE = 1000;
+    static constexpr double MAX_FEERATE = 1e9;
+    static constexpr double MIN_PRIORITY = 1e8;
+    static constexpr double MAX_PRIORITY = 1e16;
+    //! Ratio between the bounds of neighbouring buckets
+    static constexpr double FEE_SPACING = 1.1;
+    static constexpr double PRI_SPACING = 2;
+
+    explicit BlockPolicyEstimator(const CFeeRate& minRelayFee);
+
+    //! The transaction entered the pool, at the height of its entry
+    void ProcessTransaction(const CTxMemPoolEntry& entry);
+    //! The transaction left the pool, whether mined or not
+    void RemoveTx(const uint256& hash);
+    //! The entries of the pool that the block at the height confirmed
+    void ProcessBlock(unsigned int nBlockHeight, const std::vector<CTxMemPoolEntry>& entries);
+
+    //! Can return CFeeRate(0) if there is not enough data for the target. nBlocksToConfirm is 1 based.
+    CFeeRate EstimateFee(int nBlocksToConfirm) const;
+    //! Can return -1 if there is not enough data for the target. nBlocksToConfirm is 1 based.
+    double EstimatePriority(int nBlocksToConfirm) const;
+
+    void Write(CAutoFile& fileout) const;
+    void Read(CAutoFile& filein);
+};
+#endif// BLOCK_POLICY_ESTIMATOR_H
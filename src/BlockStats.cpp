@@ -0,0 +1,66 @@
+#include <BlockStats.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <primitives/block.h>
+
+BlockStats::BlockStats(
+    ): blockHash(0)
+    , nHeight(0)
+    , nTime(0)
+    , nTx(0)
+    , nInputs(0)
+    , nOutputs(0)
+    , nTotalIn(0)
+    , nTotalOut(0)
+    , nFees(0)
+    , nMint(0)
+    , nMoneySupply(0)
+    , rewards(0, 0, 0, 0, 0, 0)
+    , nUtxoCreated(0)
+    , nUtxoSpent(0)
+{
+}
+
+BlockStats::BlockStats(
+    const CBlock& block,
+    const CBlockUndo& blockUndo,
+    const CBlockIndex& blockIndex,
+    const CBlockRewards& blockRewards
+    ): blockHash(blockIndex.GetBlockHash())
+    , nHeight(blockIndex.nHeight)
+    , nTime(blockIndex.nTime)
+    , nTx(block.vtx.size())
+    , nInputs(0)
+    , nOutputs(0)
+    , nTotalIn(0)
+    , nTotalOut(0)
+    , nFees(blockIndex.nMint - (blockIndex.nMoneySupply - (blockIndex.pprev ? blockIndex.pprev->nMoneySupply : 0)))
+    , nMint(blockIndex.nMint)
+    , nMoneySupply(blockIndex.nMoneySupply)
+    , rewards(blockRewards)
+    , nUtxoCreated(0)
+    , nUtxoSpent(0)
+{
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        // Like the coins view, which clears provably unspendable outputs as they are added
+        for (const CTxOut& txout : tx.vout) {
+            if (!txout.scriptPubKey.IsUnspendable())
+                nUtxoCreated++;
+        }
+        if (tx.IsCoinBase())
+            continue;
+
+        // The undo data has an entry for every input spending an output
+        const CTxUndo& txundo = blockUndo.vtxundo[i - 1];
+        nUtxoSpent += txundo.vprevout.size();
+        if (tx.IsCoinStake())
+            continue;
+        nInputs += tx.vin.size();
+        nOutputs += tx.vout.size();
+        for (const CTxInUndo& prevout : txundo.vprevout)
+            nTotalIn += prevout.txout.nValue;
+        nTotalOut += tx.GetValueOut();
+    }
+}
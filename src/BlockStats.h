@@ -0,0 +1,75 @@
+#ifndef BLOCK_STATS_H
+#define BLOCK_STATS_H
+#include <amount.h>
+#include <BlockRewards.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+
+/**
+ * Figures of one block kept in the block stats index, so that they can be
+ * looked up without reading the block and the outputs it spends.
+ *
+ * They are taken as the block is connected: the rewards are those the block
+ * was checked against, and the fees come from the minted amount and the
+ * money supply that the transaction checks recorded in its index entry.
+ * Coinbase and coinstake transactions are left out of the transaction
+ * input and output totals, but not of the unspent output counts.
+ */
+class BlockStats
+{
+public:
+    uint256 blockHash;
+    int nHeight;
+    unsigned int nTime;
+    unsigned int nTx;
+    //! Inputs and outputs of the transactions other than the coinbase and coinstake
+    unsigned int nInputs;
+    unsigned int nOutputs;
+    CAmount nTotalIn;
+    CAmount nTotalOut;
+    CAmount nFees;
+    CAmount nMint;
+    CAmount nMoneySupply;
+    CBlockRewards rewards;
+    //! Outputs the block added to and took out of the unspent output set
+    unsigned int nUtxoCreated;
+    unsigned int nUtxoSpent;
+
+    BlockStats();
+    BlockStats(const CBlock& block, const CBlockUndo& blockUndo, const CBlockIndex& blockIndex, const CBlockRewards& blockRewards);
+
+    int64_t GetUtxoDelta() const { return (int64_t)nUtxoCreated - (int64_t)nUtxoSpent; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(blockHash);
+        READWRITE(nHeight);
+        READWRITE(nTime);
+        READWRITE(VARINT(nTx));
+        READWRITE(VARINT(nInputs));
+        READWRITE(VARINT(nOutputs));
+        READWRITE(nTotalIn);
+        READWRITE(nTotalOut);
+        READWRITE(nFees);
+        READWRITE(nMint);
+        READWRITE(nMoneySupply);
+        READWRITE(rewards.nStakeReward);
+        READWRITE(rewards.nMasternodeReward);
+        READWRITE(rewards.nTreasuryReward);
+        READWRITE(rewards.nCharityReward);
+        READWRITE(rewards.nLotteryReward);
+        READWRITE(rewards.nProposalsReward);
+        READWRITE(VARINT(nUtxoCreated));
+        READWRITE(VARINT(nUtxoSpent));
+    }
+};
+#endif// BLOCK_STATS_H
@@ -5,11 +5,21 @@
 #include <I_SuperblockHeightValidator.h>
 #include <LegacyBlockSubsidies.h>
 
+constexpr unsigned BlockSubsidyProvider::SCHEDULE_SIZE;
+
+BlockSubsidyProvider::ScheduleEntry::ScheduleEntry(
+    ): nHeight(-1)
+    , rewards(0, 0, 0, 0, 0, 0)
+{
+}
+
 BlockSubsidyProvider::BlockSubsidyProvider(
     const CChainParams& chainParameters,
     I_SuperblockHeightValidator& heightValidator
     ): chainParameters_(chainParameters)
     , heightValidator_(heightValidator)
+    , cs_schedule_()
+    , schedule_(SCHEDULE_SIZE)
 {
 
 }
@@ -52,13 +62,30 @@ void BlockSubsidyProvider::updateLotteryReward(int nHeight, CBlockRewards& rewar
     lotteryReward = priorRewards.nLotteryReward * priorRewardWeight + rewards.nLotteryReward* currentRewardWeight;
 }
 
-CBlockRewards BlockSubsidyProvider::GetBlockSubsidity(int nHeight) const
+CBlockRewards BlockSubsidyProvider::ComputeBlockSubsidity(int nHeight) const
 {
     CBlockRewards rewards = Legacy::GetBlockSubsidity(nHeight,chainParameters_);
     updateTreasuryReward(nHeight,rewards, heightValidator_.IsValidTreasuryBlockHeight(nHeight));
     updateLotteryReward(nHeight,rewards, heightValidator_.IsValidLotteryBlockHeight(nHeight));
     return rewards;
 }
+
+CBlockRewards BlockSubsidyProvider::GetBlockSubsidity(int nHeight) const
+{
+    if(nHeight < 0 || Legacy::SubsidiesAreSporkAdjusted())
+    {
+        return ComputeBlockSubsidity(nHeight);
+    }
+
+    LOCK(cs_schedule_);
+    ScheduleEntry& entry = schedule_[static_cast<unsigned>(nHeight) % SCHEDULE_SIZE];
+    if(entry.nHeight != nHeight)
+    {
+        entry.rewards = ComputeBlockSubsidity(nHeight);
+        entry.nHeight = nHeight;
+    }
+    return entry.rewards;
+}
 CAmount BlockSubsidyProvider::GetFullBlockValue(int nHeight) const
 {
     return GetBlockSubsidity(nHeight).total();
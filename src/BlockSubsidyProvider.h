@@ -1,18 +1,42 @@
 #ifndef BLOCK_SUBSIDY_PROVIDER_H
 #define BLOCK_SUBSIDY_PROVIDER_H
 #include <I_BlockSubsidyProvider.h>
+#include <sync.h>
+
+#include <vector>
 class CChainParams;
 class I_SuperblockHeightValidator;
 class CBlockRewards;
 
+/**
+ * The rewards of each height, with treasury and lottery superblocks paying what
+ * accrued since the prior superblock of their kind.
+ *
+ * Without sporks overriding them the rewards are a function of the height only,
+ * so the ones worked out last are kept in a table indexed by height, which
+ * validation, block creation and staking ask for the same few heights near
+ * the tip over and over. The table is bypassed once sporks override the
+ * subsidies, as those depend on the block times too.
+ */
 class BlockSubsidyProvider: public I_BlockSubsidyProvider
 {
 private:
+    static constexpr unsigned SCHEDULE_SIZE = 256;
+    struct ScheduleEntry {
+        int nHeight;
+        CBlockRewards rewards;
+
+        ScheduleEntry();
+    };
+
     const CChainParams& chainParameters_;
     I_SuperblockHeightValidator& heightValidator_;
+    mutable CCriticalSection cs_schedule_;
+    mutable std::vector<ScheduleEntry> schedule_;
 
     void updateTreasuryReward(int nHeight, CBlockRewards& rewards, bool isTreasuryBlock) const;
     void updateLotteryReward(int nHeight, CBlockRewards& rewards,bool isLotteryBlock) const;
+    CBlockRewards ComputeBlockSubsidity(int nHeight) const;
 public:
     BlockSubsidyProvider(
         const CChainParams& chainParameters,
@@ -14,6 +14,13 @@
 #include <kernel.h>
 #include <IndexDatabaseUpdateCollector.h>
 
+#include <algorithm>
+
+extern bool fAddressIndex;
+extern bool fSpentIndex;
+extern bool fVaultIndex;
+extern int nScriptCheckThreads;
+
 TransactionLocationRecorder::TransactionLocationRecorder(
     const CBlockIndex* pindex,
     const CBlock& block
@@ -41,26 +48,59 @@ BlockTransactionChecker::BlockTransactionChecker(
     CValidationState& state,
     CBlockIndex* pindex,
     CCoinsViewCache& view,
-    const int blocksToSkipChecksFor
+    const bool checkScripts
     ): blockundo_(block.vtx.size() - 1)
     , block_(block)
     , state_(state)
     , pindex_(pindex)
     , view_(view)
-    , txInputChecker_(pindex->nHeight >= blocksToSkipChecksFor,view_,state_)
+    , txInputChecker_(checkScripts,view_,state_)
     , txLocationRecorder_(pindex_,block_)
 {
 }
 
+/** Pull every coin the block spends from outside of itself into the view
+ *  before any transaction is processed. The misses go down as one batch, which
+ *  the coin database looks up in key order and in parallel, so the
+ *  per-transaction loop below (and the script checks it hands out) never
+ *  stalls on disk. */
+void BlockTransactionChecker::PrefetchInputs() const
+{
+    std::vector<uint256> createdInBlock;
+    createdInBlock.reserve(block_.vtx.size());
+    size_t numberOfInputs = 0u;
+    for (const CTransaction& tx: block_.vtx)
+    {
+        createdInBlock.push_back(tx.GetHash());
+        if(!tx.IsCoinBase()) numberOfInputs += tx.vin.size();
+    }
+    std::sort(createdInBlock.begin(),createdInBlock.end());
+
+    std::vector<uint256> prevoutTxids;
+    prevoutTxids.reserve(numberOfInputs);
+    for (const CTransaction& tx: block_.vtx)
+    {
+        if(tx.IsCoinBase()) continue;
+        for (const CTxIn& txin: tx.vin)
+        {
+            if(!std::binary_search(createdInBlock.begin(),createdInBlock.end(),txin.prevout.hash))
+                prevoutTxids.push_back(txin.prevout.hash);
+        }
+    }
+    std::sort(prevoutTxids.begin(),prevoutTxids.end());
+    prevoutTxids.erase(std::unique(prevoutTxids.begin(),prevoutTxids.end()),prevoutTxids.end());
+
+    view_.PrefetchCoins(prevoutTxids);
+}
+
 bool BlockTransactionChecker::Check(const CBlockRewards& nExpectedMint,bool fJustCheck, IndexDatabaseUpdates& indexDatabaseUpdates)
 {
+    PrefetchInputs();
     const CAmount nMoneySupplyPrev = pindex_->pprev ? pindex_->pprev->nMoneySupply : 0;
     pindex_->nMoneySupply = nMoneySupplyPrev;
     pindex_->nMint = 0;
     for (unsigned int i = 0; i < block_.vtx.size(); i++) {
         const CTransaction& tx = block_.vtx[i];
-        const TransactionLocationReference txLocationRef(tx.GetHash(),pindex_->nHeight,i);
-
         if(!txInputChecker_.TotalSigOpsAreBelowMaximum(tx))
         {
             return false;
@@ -78,10 +118,13 @@ bool BlockTransactionChecker::Check(const CBlockRewards& nExpectedMint,bool fJus
                             REJECT_INVALID, "bad-coinstake-vault-spend");
         }
 
-        IndexDatabaseUpdateCollector::RecordTransaction(tx,txLocationRef,view_, indexDatabaseUpdates);
         UpdateCoinsWithTransaction(tx, view_, blockundo_.vtxundo[i>0u? i-1: 0u], pindex_->nHeight);
         txLocationRecorder_.RecordTxLocationData(tx,indexDatabaseUpdates.txLocationData);
     }
+    // The undo data now holds every spent output, so the index updates no longer
+    // depend on the order the coins were updated in and can be split up.
+    if (!fJustCheck)
+        IndexDatabaseUpdateCollector::RecordBlock(block_,blockundo_,pindex_->nHeight,fAddressIndex,fSpentIndex,fVaultIndex,std::max(nScriptCheckThreads,1),indexDatabaseUpdates);
     return true;
 }
 
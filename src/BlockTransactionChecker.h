@@ -40,13 +40,15 @@ private:
     CCoinsViewCache& view_;
     TransactionInputChecker txInputChecker_;
     TransactionLocationRecorder txLocationRecorder_;
+
+    void PrefetchInputs() const;
 public:
     BlockTransactionChecker(
         const CBlock& block,
         CValidationState& state,
         CBlockIndex* pindex,
         CCoinsViewCache& view,
-        const int blocksToSkipChecksFor);
+        const bool checkScripts);
 
     bool Check(
         const CBlockRewards& nExpectedMint,
@@ -0,0 +1,49 @@
+#ifndef BLOCK_TRANSACTIONS_H
+#define BLOCK_TRANSACTIONS_H
+#include <CompactBlock.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <vector>
+
+/** The "getblocktxn" request for the transactions of a compact block that could not be found locally */
+struct BlockTransactionsRequest {
+    uint256 blockHash;
+    //! Positions in the block, in ascending order
+    std::vector<uint32_t> indexes;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(blockHash);
+        uint64_t nIndexes = indexes.size();
+        READWRITE(VARINT(nIndexes));
+        if (ser_action.ForRead()) {
+            if (nIndexes > CompactBlock::MAX_TRANSACTIONS)
+                throw std::ios_base::failure("BlockTransactionsRequest : too many indexes");
+            indexes.resize(nIndexes);
+        }
+        for (uint32_t& index : indexes)
+            READWRITE(VARINT(index));
+    }
+};
+
+/** The "blocktxn" reply with the requested transactions, in the order they were asked for */
+struct BlockTransactions {
+    uint256 blockHash;
+    std::vector<CTransaction> transactions;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(blockHash);
+        READWRITE(transactions);
+    }
+};
+#endif// BLOCK_TRANSACTIONS_H
@@ -0,0 +1,162 @@
+#include <BranchAndBoundCoinSelectionAlgorithm.h>
+
+#include <algorithm>
+#include <primitives/transaction.h>
+#include <WalletTx.h>
+#include <FeeAndPriorityCalculator.h>
+#include <FeeRate.h>
+#include <version.h>
+#include <I_SignatureSizeEstimator.h>
+#include <defaultValues.h>
+
+const CFeeRate& relayFeeRate = FeeAndPriorityCalculator::instance().getFeeRateQuote();
+extern CAmount maxTxFee;
+
+namespace
+{
+constexpr unsigned nominalChangeOutputSize = 34u; // P2PKH change address
+constexpr unsigned nominalChangeSpendSize = 148u; // P2PKH input spending the change
+
+struct CoinAndEffectiveValue
+{
+    const COutput* outputRef;
+    CAmount effectiveValue;
+    unsigned sigSize;
+
+    CoinAndEffectiveValue(
+        const COutput& output,
+        const CKeyStore& keyStore,
+        const I_SignatureSizeEstimator& estimator
+        ): outputRef(&output)
+        , effectiveValue(0)
+        , sigSize(
+            estimator.MaxBytesNeededForScriptSig(
+                keyStore,
+                outputRef->scriptPubKey()))
+    {
+        effectiveValue = outputRef->Value() - relayFeeRate.GetFee(sigSize);
+    }
+};
+
+struct DecreasingEffectiveValue
+{
+    bool operator()(const CoinAndEffectiveValue& coinA, const CoinAndEffectiveValue& coinB) const
+    {
+        if(coinA.effectiveValue != coinB.effectiveValue) return coinA.effectiveValue > coinB.effectiveValue;
+        if(coinA.sigSize != coinB.sigSize) return coinA.sigSize < coinB.sigSize;
+        return *coinA.outputRef < *coinB.outputRef;
+    }
+};
+
+bool IsInterchangeable(const CoinAndEffectiveValue& coinA, const CoinAndEffectiveValue& coinB)
+{
+    return coinA.effectiveValue == coinB.effectiveValue && coinA.sigSize == coinB.sigSize;
+}
+}
+
+BranchAndBoundCoinSelectionAlgorithm::BranchAndBoundCoinSelectionAlgorithm(
+    const CKeyStore& keyStore,
+    const I_SignatureSizeEstimator& estimator,
+    const I_CoinSelectionAlgorithm& fallbackAlgorithm,
+    unsigned maximumSearchSteps
+    ): keyStore_(keyStore)
+    , estimator_(estimator)
+    , fallbackAlgorithm_(fallbackAlgorithm)
+    , maximumSearchSteps_(maximumSearchSteps)
+{
+}
+
+std::set<COutput> BranchAndBoundCoinSelectionAlgorithm::SelectCoins(
+    const CMutableTransaction& transactionToSelectCoinsFor,
+    const std::vector<COutput>& vCoins,
+    CAmount& fees) const
+{
+    CTransaction initialTransaction = CTransaction(transactionToSelectCoinsFor);
+    const unsigned initialByteSize = ::GetSerializeSize(initialTransaction, SER_NETWORK, PROTOCOL_VERSION);
+    const CAmount nValueOut = transactionToSelectCoinsFor.GetValueOut();
+    const CAmount nTargetValue = nValueOut + fees + relayFeeRate.GetFee(initialByteSize);
+    const CAmount costOfChange = relayFeeRate.GetFee(nominalChangeOutputSize + nominalChangeSpendSize);
+    const CAmount nUpperBound = nTargetValue + costOfChange;
+
+    // Coins that cost more to spend than they are worth can never help reach the target
+    std::vector<CoinAndEffectiveValue> coins;
+    coins.reserve(vCoins.size());
+    for(const COutput& input: vCoins)
+    {
+        coins.emplace_back(input,keyStore_,estimator_);
+        if(coins.back().effectiveValue <= 0) coins.pop_back();
+    }
+    std::sort(coins.begin(),coins.end(),DecreasingEffectiveValue());
+
+    // remainingValue[i] is what the coins from i onwards add up to
+    std::vector<CAmount> remainingValue(coins.size()+1u,0);
+    for(size_t index = coins.size(); index > 0u; --index)
+    {
+        remainingValue[index-1u] = remainingValue[index] + coins[index-1u].effectiveValue;
+    }
+    if(remainingValue[0] < nTargetValue)
+    {
+        return fallbackAlgorithm_.SelectCoins(transactionToSelectCoinsFor,vCoins,fees);
+    }
+
+    std::vector<size_t> selection;
+    std::vector<size_t> bestSelection;
+    CAmount bestExcess = costOfChange + 1;
+    CAmount selectedValue = 0;
+    unsigned selectedByteSize = initialByteSize;
+    size_t index = 0u;
+    for(unsigned step = 0u; step < maximumSearchSteps_; ++step)
+    {
+        bool backtrack =
+            selectedValue + remainingValue[index] < nTargetValue ||
+            selectedValue > nUpperBound ||
+            selectedByteSize >= MAX_STANDARD_TX_SIZE;
+        if(!backtrack && selectedValue >= nTargetValue)
+        {
+            if(selectedValue - nTargetValue < bestExcess)
+            {
+                bestExcess = selectedValue - nTargetValue;
+                bestSelection = selection;
+                if(bestExcess == 0) break;
+            }
+            backtrack = true;
+        }
+        if(backtrack)
+        {
+            if(selection.empty()) break;
+            // Leave out the last coin included, and the coins just like it, and carry on past it
+            index = selection.back();
+            selection.pop_back();
+            selectedValue -= coins[index].effectiveValue;
+            selectedByteSize -= coins[index].sigSize;
+            ++index;
+            while(index < coins.size() && IsInterchangeable(coins[index],coins[index-1u])) ++index;
+            continue;
+        }
+        selection.push_back(index);
+        selectedValue += coins[index].effectiveValue;
+        selectedByteSize += coins[index].sigSize;
+        ++index;
+    }
+
+    if(!bestSelection.empty())
+    {
+        std::set<COutput> inputsSelected;
+        CAmount amountCovered = 0;
+        unsigned cummulativeByteSize = initialByteSize;
+        for(size_t selectedIndex: bestSelection)
+        {
+            inputsSelected.insert(*coins[selectedIndex].outputRef);
+            amountCovered += coins[selectedIndex].outputRef->Value();
+            cummulativeByteSize += coins[selectedIndex].sigSize;
+        }
+        // The surplus is paid as fee, so it must cover the fee for the whole transaction
+        const CAmount feePaid = amountCovered - nValueOut;
+        if(feePaid >= fees + relayFeeRate.GetFee(cummulativeByteSize) && feePaid <= maxTxFee)
+        {
+            fees = feePaid;
+            return inputsSelected;
+        }
+    }
+    return fallbackAlgorithm_.SelectCoins(transactionToSelectCoinsFor,vCoins,fees);
+}
@@ -0,0 +1,37 @@
+#ifndef BRANCH_AND_BOUND_COIN_SELECTION_ALGORITHM_H
+#define BRANCH_AND_BOUND_COIN_SELECTION_ALGORITHM_H
+#include <I_CoinSelectionAlgorithm.h>
+class CKeyStore;
+class I_SignatureSizeEstimator;
+
+/**
+ * Looks for a set of inputs that pays for the transaction without needing a
+ * change output, the surplus over the fee being no more than what creating
+ * and later spending change would cost. The surplus is paid as fee.
+ *
+ * The coins are searched depth first in decreasing order of their value net
+ * of the fee for spending them, dropping branches that overshoot or can no
+ * longer reach the target, so the outcome is deterministic. When no such
+ * set is found within the search limit, the fallback algorithm selects.
+ */
+class BranchAndBoundCoinSelectionAlgorithm: public I_CoinSelectionAlgorithm
+{
+private:
+    const CKeyStore& keyStore_;
+    const I_SignatureSizeEstimator& estimator_;
+    const I_CoinSelectionAlgorithm& fallbackAlgorithm_;
+    const unsigned maximumSearchSteps_;
+public:
+    static constexpr unsigned DEFAULT_MAXIMUM_SEARCH_STEPS = 100000u;
+
+    BranchAndBoundCoinSelectionAlgorithm(
+        const CKeyStore& keyStore,
+        const I_SignatureSizeEstimator& estimator,
+        const I_CoinSelectionAlgorithm& fallbackAlgorithm,
+        unsigned maximumSearchSteps = DEFAULT_MAXIMUM_SEARCH_STEPS);
+    virtual std::set<COutput> SelectCoins(
+        const CMutableTransaction& transactionToSelectCoinsFor,
+        const std::vector<COutput>& vCoins,
+        CAmount& fees) const;
+};
+#endif// BRANCH_AND_BOUND_COIN_SELECTION_ALGORITHM_H
@@ -0,0 +1,49 @@
+#include <CachedPoSStakeModifierService.h>
+
+#include <chain.h>
+#include <LegacyPoSStakeModifierService.h>
+#include <StakingData.h>
+
+constexpr size_t CachedPoSStakeModifierService::DEFAULT_MAXIMUM_SIZE;
+
+CachedPoSStakeModifierService::CachedPoSStakeModifierService(
+    const LegacyPoSStakeModifierService& legacyStakeModifierService,
+    size_t maximumSize
+    ): legacyStakeModifierService_(legacyStakeModifierService)
+    , maximumSize_(maximumSize)
+    , cs_cache_()
+    , modifiersByConfirmationBlock_()
+{
+}
+
+std::pair<uint64_t,bool> CachedPoSStakeModifierService::getStakeModifier(const StakingData& stakingData) const
+{
+    const uint256& blockHash = stakingData.blockHashOfFirstConfirmationBlock_;
+    const CChain& activeChain = legacyStakeModifierService_.activeChain();
+    {
+        LOCK(cs_cache_);
+        std::map<uint256, CachedModifier>::const_iterator it = modifiersByConfirmationBlock_.find(blockHash);
+        if (it != modifiersByConfirmationBlock_.end() && activeChain.Contains(it->second.selectionBlock))
+            return std::make_pair(it->second.stakeModifier, true);
+    }
+
+    const CBlockIndex* selectionBlock = nullptr;
+    const std::pair<uint64_t,bool> stakeModifier =
+        legacyStakeModifierService_.getStakeModifierAndSelectionBlock(stakingData, selectionBlock);
+    if (!stakeModifier.second || !selectionBlock)
+        return stakeModifier;
+
+    LOCK(cs_cache_);
+    if (modifiersByConfirmationBlock_.size() >= maximumSize_ && !modifiersByConfirmationBlock_.count(blockHash))
+        modifiersByConfirmationBlock_.clear();
+    CachedModifier& cached = modifiersByConfirmationBlock_[blockHash];
+    cached.stakeModifier = stakeModifier.first;
+    cached.selectionBlock = selectionBlock;
+    return stakeModifier;
+}
+
+size_t CachedPoSStakeModifierService::size() const
+{
+    LOCK(cs_cache_);
+    return modifiersByConfirmationBlock_.size();
+}
@@ -0,0 +1,49 @@
+#ifndef CACHED_POS_STAKE_MODIFIER_SERVICE_H
+#define CACHED_POS_STAKE_MODIFIER_SERVICE_H
+#include <I_PoSStakeModifierService.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <utility>
+
+class CBlockIndex;
+class LegacyPoSStakeModifierService;
+class StakingData;
+
+/**
+ * Remembers the legacy stake modifier of each confirmation block, which
+ * otherwise costs a walk up the active chain for every coin on every staking
+ * attempt and for every validated block.
+ *
+ * A modifier is only reused while the last block it was read from is still in
+ * the active chain, so a reorg past that block makes the next lookup walk the
+ * new chain instead. Lookups may come from several staking threads and from
+ * validation at once.
+ */
+class CachedPoSStakeModifierService: public I_PoSStakeModifierService
+{
+private:
+    struct CachedModifier {
+        uint64_t stakeModifier;
+        const CBlockIndex* selectionBlock;
+    };
+
+    const LegacyPoSStakeModifierService& legacyStakeModifierService_;
+    const size_t maximumSize_;
+    mutable CCriticalSection cs_cache_;
+    mutable std::map<uint256, CachedModifier> modifiersByConfirmationBlock_;
+
+public:
+    //! Confirmation blocks remembered before the cache starts over
+    static constexpr size_t DEFAULT_MAXIMUM_SIZE = 100000;
+
+    explicit CachedPoSStakeModifierService(
+        const LegacyPoSStakeModifierService& legacyStakeModifierService,
+        size_t maximumSize = DEFAULT_MAXIMUM_SIZE);
+    virtual std::pair<uint64_t,bool> getStakeModifier(const StakingData& stakingData) const;
+    size_t size() const;
+};
+#endif// CACHED_POS_STAKE_MODIFIER_SERVICE_H
@@ -0,0 +1,131 @@
+#include <CachingBlockDataReader.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <primitives/block.h>
+
+BlockDataCacheStats::BlockDataCacheStats(
+    ): nCachedBlocks(0)
+    , nCachedBlockUndos(0)
+    , nBlockHits(0)
+    , nBlockMisses(0)
+    , nBlockUndoHits(0)
+    , nBlockUndoMisses(0)
+{
+}
+
+template <typename Ref>
+Ref CachingBlockDataReader::RecentlyUsed<Ref>::Find(const uint256& hash)
+{
+    typename std::map<uint256, typename Entries::iterator>::iterator it = positions.find(hash);
+    if (it == positions.end()) {
+        nMisses++;
+        return Ref();
+    }
+    nHits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+template <typename Ref>
+void CachingBlockDataReader::RecentlyUsed<Ref>::Insert(const uint256& hash, const Ref& ref, size_t maxEntries)
+{
+    if (maxEntries == 0 || positions.count(hash))
+        return;
+    entries.push_front(std::make_pair(hash, ref));
+    positions[hash] = entries.begin();
+    if (entries.size() > maxEntries) {
+        positions.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+template <typename Ref>
+void CachingBlockDataReader::RecentlyUsed<Ref>::Clear()
+{
+    positions.clear();
+    entries.clear();
+}
+
+CachingBlockDataReader::CachingBlockDataReader(
+    const I_BlockDataReader& reader,
+    size_t maxCachedEntries
+    ): reader_(reader)
+    , maxCachedEntries_(maxCachedEntries)
+    , mutex_()
+    , blocks_()
+    , blockUndos_()
+{
+}
+
+CachingBlockDataReader::BlockRef CachingBlockDataReader::GetBlock(const CBlockIndex* blockIndex) const
+{
+    const uint256 hash = blockIndex->GetBlockHash();
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        BlockRef cached = blocks_.Find(hash);
+        if (cached)
+            return cached;
+    }
+    std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+    if (!reader_.ReadBlock(blockIndex, *block))
+        return BlockRef();
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    blocks_.Insert(hash, block, maxCachedEntries_);
+    return block;
+}
+
+CachingBlockDataReader::BlockUndoRef CachingBlockDataReader::GetBlockUndo(const CBlockIndex* blockIndex) const
+{
+    const uint256 hash = blockIndex->GetBlockHash();
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        BlockUndoRef cached = blockUndos_.Find(hash);
+        if (cached)
+            return cached;
+    }
+    std::shared_ptr<CBlockUndo> blockUndo = std::make_shared<CBlockUndo>();
+    if (!reader_.ReadBlockUndo(blockIndex, *blockUndo))
+        return BlockUndoRef();
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    blockUndos_.Insert(hash, blockUndo, maxCachedEntries_);
+    return blockUndo;
+}
+
+bool CachingBlockDataReader::ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+{
+    BlockRef cached = GetBlock(blockIndex);
+    if (!cached)
+        return false;
+    block = *cached;
+    return true;
+}
+
+bool CachingBlockDataReader::ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const
+{
+    BlockUndoRef cached = GetBlockUndo(blockIndex);
+    if (!cached)
+        return false;
+    blockUndo = *cached;
+    return true;
+}
+
+BlockDataCacheStats CachingBlockDataReader::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    BlockDataCacheStats stats;
+    stats.nCachedBlocks = blocks_.entries.size();
+    stats.nCachedBlockUndos = blockUndos_.entries.size();
+    stats.nBlockHits = blocks_.nHits;
+    stats.nBlockMisses = blocks_.nMisses;
+    stats.nBlockUndoHits = blockUndos_.nHits;
+    stats.nBlockUndoMisses = blockUndos_.nMisses;
+    return stats;
+}
+
+void CachingBlockDataReader::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    blocks_.Clear();
+    blockUndos_.Clear();
+}
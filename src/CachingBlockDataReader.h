@@ -0,0 +1,81 @@
+#ifndef CACHING_BLOCK_DATA_READER_H
+#define CACHING_BLOCK_DATA_READER_H
+#include <I_BlockDataReader.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+
+struct BlockDataCacheStats {
+    size_t nCachedBlocks;
+    size_t nCachedBlockUndos;
+    uint64_t nBlockHits;
+    uint64_t nBlockMisses;
+    uint64_t nBlockUndoHits;
+    uint64_t nBlockUndoMisses;
+
+    BlockDataCacheStats();
+};
+
+/**
+ * I_BlockDataReader that keeps the blocks and undo data it most recently read
+ * through another reader, so the same recent blocks are not read and
+ * deserialized over and over.
+ *
+ * Entries are keyed by block hash and never go stale, as stored block and undo
+ * data do not change. Cached objects are shared with the readers holding them,
+ * so eviction never invalidates a block still in use. Reads that miss go to
+ * the underlying reader without holding the cache lock; two threads missing
+ * the same block may both read it.
+ */
+class CachingBlockDataReader : public I_BlockDataReader
+{
+public:
+    typedef std::shared_ptr<const CBlock> BlockRef;
+    typedef std::shared_ptr<const CBlockUndo> BlockUndoRef;
+
+private:
+    template <typename Ref>
+    struct RecentlyUsed {
+        typedef std::list<std::pair<uint256, Ref> > Entries;
+        //! Most recently used first
+        Entries entries;
+        std::map<uint256, typename Entries::iterator> positions;
+        uint64_t nHits;
+        uint64_t nMisses;
+
+        RecentlyUsed() : entries(), positions(), nHits(0), nMisses(0) {}
+        Ref Find(const uint256& hash);
+        void Insert(const uint256& hash, const Ref& ref, size_t maxEntries);
+        void Clear();
+    };
+
+    const I_BlockDataReader& reader_;
+    const size_t maxCachedEntries_;
+    mutable boost::mutex mutex_;
+    mutable RecentlyUsed<BlockRef> blocks_;
+    mutable RecentlyUsed<BlockUndoRef> blockUndos_;
+
+public:
+    //! Keep up to maxCachedEntries blocks, and as many undo records, read through reader
+    CachingBlockDataReader(const I_BlockDataReader& reader, size_t maxCachedEntries);
+
+    //! The block, shared with the cache, or NULL if it cannot be read
+    BlockRef GetBlock(const CBlockIndex* blockIndex) const;
+    //! The block's undo data, shared with the cache, or NULL if it cannot be read
+    BlockUndoRef GetBlockUndo(const CBlockIndex* blockIndex) const;
+
+    virtual bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const;
+    virtual bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const;
+
+    BlockDataCacheStats GetStats() const;
+    void Clear();
+};
+#endif// CACHING_BLOCK_DATA_READER_H
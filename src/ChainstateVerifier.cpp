@@ -0,0 +1,125 @@
+#include <ChainstateVerifier.h>
+
+#include <ActiveChainManager.h>
+#include <chain.h>
+#include <coins.h>
+#include <I_BlockDataReader.h>
+#include <Logging.h>
+#include <primitives/block.h>
+#include <ValidationState.h>
+
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+ChainstateVerificationProgress::ChainstateVerificationProgress(
+    ): state(NOT_STARTED)
+    , nTipHeight(-1)
+    , nBlocksToCheck(0)
+    , nBlocksChecked(0)
+    , nTransactionsChecked(0)
+    , strError()
+{
+}
+
+const char* ChainstateVerificationProgress::GetStateName() const
+{
+    switch (state) {
+    case NOT_STARTED:
+        return "not started";
+    case RUNNING:
+        return "running";
+    case PASSED:
+        return "passed";
+    case FAILED:
+        return "failed";
+    }
+    return "unknown";
+}
+
+double ChainstateVerificationProgress::GetFractionChecked() const
+{
+    if (state == PASSED)
+        return 1.0;
+    if (nBlocksToCheck <= 0)
+        return 0.0;
+    return std::min(1.0, (double)nBlocksChecked / (double)nBlocksToCheck);
+}
+
+ChainstateVerifier::ChainstateVerifier(
+    BlockCheck blockCheck,
+    const unsigned& maxCachedCoins
+    ): blockCheck_(blockCheck)
+    , maxCachedCoins_(maxCachedCoins)
+    , mutex_()
+    , progress_()
+{
+}
+
+bool ChainstateVerifier::Fail(const std::string& strError)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    progress_.state = ChainstateVerificationProgress::FAILED;
+    progress_.strError = strError;
+    return error("ChainstateVerifier::Verify() : *** %s", strError);
+}
+
+bool ChainstateVerifier::Verify(
+    const ActiveChainManager& chainManager,
+    const I_BlockDataReader& blockReader,
+    const CoinsSnapshot& snapshot,
+    CBlockIndex* pindexTip,
+    int nCheckDepth)
+{
+    if (nCheckDepth <= 0 || nCheckDepth > pindexTip->nHeight)
+        nCheckDepth = pindexTip->nHeight;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        progress_ = ChainstateVerificationProgress();
+        progress_.state = ChainstateVerificationProgress::RUNNING;
+        progress_.nTipHeight = pindexTip->nHeight;
+        progress_.nBlocksToCheck = nCheckDepth;
+    }
+    LogPrintf("Verifying last %i blocks against the coin database as of height %i\n", nCheckDepth, pindexTip->nHeight);
+
+    CCoinsViewCache coins(snapshot.view.get());
+    if (coins.GetBestBlock() != pindexTip->GetBlockHash())
+        return Fail(strprintf("coins snapshot is not as of block %s", pindexTip->GetBlockHash().ToString()));
+
+    int nBlocksChecked = 0;
+    for (CBlockIndex* pindex = pindexTip; pindex->pprev && nBlocksChecked < nCheckDepth; pindex = pindex->pprev) {
+        boost::this_thread::interruption_point();
+        // Unlike at startup, nothing else competes for the cache, so only its own size counts.
+        if (coins.GetCacheSize() > maxCachedCoins_) {
+            LogPrintf("%s : stopping after %i blocks, the coins cache limit is reached\n", __func__, nBlocksChecked);
+            break;
+        }
+        CBlock block;
+        if (!blockReader.ReadBlock(pindex, block))
+            return Fail(strprintf("failed to read block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+        if (!blockCheck_(block))
+            return Fail(strprintf("found bad block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+        CValidationState state;
+        bool fClean = true;
+        if (!chainManager.DisconnectBlock(block, state, pindex, coins, &fClean))
+            return Fail(strprintf("irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+        if (!fClean)
+            return Fail(strprintf("coin database inconsistency found at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString()));
+
+        nBlocksChecked++;
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        progress_.nBlocksChecked = nBlocksChecked;
+        progress_.nTransactionsChecked += block.vtx.size();
+    }
+
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    progress_.state = ChainstateVerificationProgress::PASSED;
+    LogPrintf("No coin database inconsistencies in last %i blocks (%u transactions)\n", nBlocksChecked, progress_.nTransactionsChecked);
+    return true;
+}
+
+ChainstateVerificationProgress ChainstateVerifier::GetProgress() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return progress_;
+}
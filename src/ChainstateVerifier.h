@@ -0,0 +1,75 @@
+#ifndef CHAINSTATE_VERIFIER_H
+#define CHAINSTATE_VERIFIER_H
+#include <CoinsSnapshotPublisher.h>
+
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+class ActiveChainManager;
+class CBlock;
+class CBlockIndex;
+class I_BlockDataReader;
+
+/** How far the latest chainstate verification got */
+struct ChainstateVerificationProgress {
+    enum State {
+        NOT_STARTED,
+        RUNNING,
+        PASSED,
+        FAILED,
+    };
+
+    State state;
+    //! Height of the block the verified coins are as of
+    int nTipHeight;
+    int nBlocksToCheck;
+    int nBlocksChecked;
+    unsigned int nTransactionsChecked;
+    std::string strError;
+
+    ChainstateVerificationProgress();
+
+    const char* GetStateName() const;
+    double GetFractionChecked() const;
+};
+
+/**
+ * Checks the coin database against the block and undo data of the latest
+ * blocks while the node keeps running.
+ *
+ * Works on a read-only coins snapshot, disconnecting one block at a time in a
+ * memory-only cache on top of it: the outputs each block created must be
+ * there unchanged and the inputs its undo data restores must not. Only the
+ * block check it is given may need cs_main, so callers can run it on a
+ * background thread without holding up validation or RPC.
+ */
+class ChainstateVerifier
+{
+public:
+    typedef bool (*BlockCheck)(const CBlock& block);
+
+private:
+    BlockCheck blockCheck_;
+    const unsigned& maxCachedCoins_;
+    mutable boost::mutex mutex_;
+    ChainstateVerificationProgress progress_;
+
+    bool Fail(const std::string& strError);
+
+public:
+    ChainstateVerifier(
+        BlockCheck blockCheck,
+        const unsigned& maxCachedCoins);
+
+    //! Verify up to nCheckDepth blocks (0 = all) down from pindexTip, the block snapshot is as of
+    bool Verify(
+        const ActiveChainManager& chainManager,
+        const I_BlockDataReader& blockReader,
+        const CoinsSnapshot& snapshot,
+        CBlockIndex* pindexTip,
+        int nCheckDepth);
+
+    ChainstateVerificationProgress GetProgress() const;
+};
+#endif// CHAINSTATE_VERIFIER_H
@@ -18,9 +18,12 @@
 #include <Logging.h>
 #include <MasternodeHelpers.h>
 #include <ThreadManagementHelpers.h>
+#include <StakingStatistics.h>
+#include <MintingWakeup.h>
 
 constexpr int hashingDelay = 45;
 bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp = NULL);
+void SyncWithValidationInterfaceQueue();
 
 CoinMinter::CoinMinter(
     const I_BlockSubsidyProvider& blockSubsidies,
@@ -31,6 +34,8 @@ CoinMinter::CoinMinter(
     std::vector<CNode*>& peers,
     const CMasternodeSync& masternodeSynchronization,
     HashedBlockMap& mapHashedBlocks,
+    StakingStatistics& stakingStatistics,
+    MintingWakeup& mintingWakeup,
     CTxMemPool& transactionMemoryPool,
     AnnotatedMixin<boost::recursive_mutex>& mainCS
     ): blockSubsidies_( blockSubsidies )
@@ -44,9 +49,13 @@ CoinMinter::CoinMinter(
     , mainCS_(mainCS)
     , masternodeSync_(masternodeSynchronization)
     , mapHashedBlocks_(mapHashedBlocks)
+    , stakingStatistics_(stakingStatistics)
+    , mintingWakeup_(mintingWakeup)
     , haveMintableCoins_(false)
     , lastTimeCheckedMintable_(0)
     , timeToWait_(0)
+    , stakeCoinsVersion_(0u)
+    , wakeupsSeen_(0u)
 {
 }
 
@@ -54,9 +63,12 @@ bool CoinMinter::hasMintableCoinForProofOfStake()
 {
     int timeWaited = GetTime() - lastTimeCheckedMintable_;
 
-    if(timeWaited > fiveMinutes_)
+    // Coins that came in or matured are noticed as soon as the wallet changes
+    const unsigned stakeCoinsVersion = pwallet_->GetStakeCoinsVersion();
+    if(timeWaited > fiveMinutes_ || (!haveMintableCoins_ && stakeCoinsVersion != stakeCoinsVersion_))
     {
         lastTimeCheckedMintable_ = GetTime();
+        stakeCoinsVersion_ = stakeCoinsVersion;
         haveMintableCoins_ = pwallet_->MintableCoins();
     }
     else
@@ -101,8 +113,21 @@ bool CoinMinter::limitStakingSpeed() const
     return false;
 }
 
+int64_t CoinMinter::millisecondsUntilStakingSpeedIsUnlimited() const
+{
+    CBlockIndex* chainTip = chain_.Tip();
+    if (chainTip && mapHashedBlocks_.count(chainTip->nHeight))
+    {
+        const int64_t unlimitedAt = mapHashedBlocks_[chainTip->nHeight] + static_cast<int64_t>(hashingDelay)/2;
+        return std::max<int64_t>(0, 1000 * (unlimitedAt - GetTime()));
+    }
+    return 0;
+}
+
 bool CoinMinter::CanMintCoins()
 {
+    // Wakeups from here on are for chains and coins this check has not seen
+    wakeupsSeen_ = mintingWakeup_.NumberOfWakeups();
     if( !hasMintableCoinForProofOfStake() ||
         !nextBlockIsProofOfStake() ||
         !satisfiesMintingRequirements() ||
@@ -115,7 +140,12 @@ bool CoinMinter::CanMintCoins()
 
 void CoinMinter::sleep(uint64_t milliseconds) const
 {
-    MilliSleep(milliseconds);
+    // Wake up for a new tip or wallet change, or once the current tip may be hashed again
+    int64_t timeout = static_cast<int64_t>(milliseconds);
+    const int64_t untilUnlimited = millisecondsUntilStakingSpeedIsUnlimited();
+    if (untilUnlimited > 0)
+        timeout = std::min(timeout, untilUnlimited);
+    mintingWakeup_.WaitFor(timeout, wakeupsSeen_);
 }
 void CoinMinter::setMintingRequestStatus(bool newStatus)
 {
@@ -177,7 +207,8 @@ void CoinMinter::IncrementExtraNonce(CBlock* block,const CBlockIndex* pindexPrev
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
     block->vtx[0] = txCoinbase;
-    block->hashMerkleRoot = block->BuildMerkleTree();
+    block->vMerkleTree.clear(); // A tree kept from before the new coinbase is stale
+    block->hashMerkleRoot = block->ComputeMerkleRoot();
 }
 
 
@@ -230,15 +261,25 @@ bool CoinMinter::createProofOfStakeBlock(
     //Stake miner main
     LogPrintf("%s: proof-of-stake block found %s \n",__func__, block->GetHash());
 
-    if (!SignBlock(*pwallet_, *block)) {
+    const int64_t signingStart = GetTimeMicros();
+    const bool blockSigned = SignBlock(*pwallet_, *block);
+    stakingStatistics_.RecordStageTime(StakingStage::BLOCK_SIGNING, GetTimeMicros() - signingStart);
+    if (!blockSigned) {
         LogPrintf("%s: Signing new block failed \n",__func__);
+        stakingStatistics_.RecordMiss(StakingMiss::BLOCK_SIGNING_FAILED);
         return false;
     }
 
     LogPrintf("%s: proof-of-stake block was signed %s \n", __func__, block->GetHash());
     SetThreadPriority(THREAD_PRIORITY_NORMAL);
+    const int64_t processingStart = GetTimeMicros();
     blockSuccessfullyCreated = ProcessBlockFound(block, reserveKey);
-    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    stakingStatistics_.RecordStageTime(StakingStage::BLOCK_PROCESSING, GetTimeMicros() - processingStart);
+    SetThreadPriority(ThreadGroupPriority(ThreadGroup::STAKING, THREAD_PRIORITY_LOWEST));
+    if (blockSuccessfullyCreated)
+        stakingStatistics_.RecordAcceptedBlock(block->GetHash());
+    else
+        stakingStatistics_.RecordMiss(StakingMiss::BLOCK_REJECTED);
 
     return blockSuccessfullyCreated;
 }
@@ -280,7 +321,7 @@ bool CoinMinter::createProofOfWorkBlock(
                 // Found a solution
                 SetThreadPriority(THREAD_PRIORITY_NORMAL);
                 blockSuccessfullyCreated = ProcessBlockFound(block, reserveKey);
-                SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                SetThreadPriority(ThreadGroupPriority(ThreadGroup::STAKING, THREAD_PRIORITY_LOWEST));
                 LogPrintf("%s:\n",__func__);
                 LogPrintf("proof-of-work found  \n  hash: %s  \ntarget: %s\n", hash, hashTarget);
                 // In regression test mode, stop mining after a block is found. This
@@ -325,7 +366,11 @@ bool CoinMinter::createNewBlock(
 {
     CReserveKey reserveKey(*pwallet_);
     if(fProofOfStake)
+    {
+        // The wallet has to have seen the last block connected, or coins spent in it would be staked again
+        SyncWithValidationInterfaceQueue();
         return createProofOfStakeBlock(nExtraNonce, reserveKey);
+    }
 
     return createProofOfWorkBlock(nExtraNonce, reserveKey);
 }
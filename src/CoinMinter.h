@@ -26,6 +26,8 @@ class CTxMemPool;
 template <typename MutexObj>
 class AnnotatedMixin;
 class I_BlockSubsidyProvider;
+class StakingStatistics;
+class MintingWakeup;
 
 class CoinMinter: public I_CoinMinter
 {
@@ -42,13 +44,18 @@ class CoinMinter: public I_CoinMinter
     AnnotatedMixin<boost::recursive_mutex>& mainCS_;
     const CMasternodeSync& masternodeSync_;
     HashedBlockMap& mapHashedBlocks_;
+    StakingStatistics& stakingStatistics_;
+    MintingWakeup& mintingWakeup_;
     bool haveMintableCoins_;
     int64_t lastTimeCheckedMintable_;
     int64_t timeToWait_;
+    unsigned stakeCoinsVersion_;
+    uint64_t wakeupsSeen_;
 
     bool hasMintableCoinForProofOfStake();
     bool satisfiesMintingRequirements() const;
     bool limitStakingSpeed() const;
+    int64_t millisecondsUntilStakingSpeedIsUnlimited() const;
     bool nextBlockIsProofOfStake() const;
 
     bool ProcessBlockFound(CBlock* block, CReserveKey& reservekey) const;
@@ -79,6 +86,8 @@ public:
         std::vector<CNode*>& peers,
         const CMasternodeSync& masternodeSynchronization,
         HashedBlockMap& mapHashedBlocks,
+        StakingStatistics& stakingStatistics,
+        MintingWakeup& mintingWakeup,
         CTxMemPool& mempool,
         AnnotatedMixin<boost::recursive_mutex>& mainCS);
 
@@ -8,14 +8,15 @@
 #include <PoSTransactionCreator.h>
 #include <SuperblockSubsidyContainer.h>
 #include <BlockIncentivesPopulator.h>
-#include <ProofOfStakeModule.h>
+#include <kernel.h>
 
 I_BlockFactory* BlockFactorySelector(
     I_BlockTransactionCollector& blockTransactionCollector,
     I_PoSTransactionCreator& coinstakeCreator,
     const Settings& settings,
     const CChain& activeChain,
-    const CChainParams& chainParameters)
+    const CChainParams& chainParameters,
+    StakingStatistics& stakingStatistics)
 {
     if(chainParameters.NetworkID()==CBaseChainParams::Network::REGTEST)
     {
@@ -24,7 +25,8 @@ I_BlockFactory* BlockFactorySelector(
             coinstakeCreator,
             settings,
             activeChain,
-            chainParameters);
+            chainParameters,
+            stakingStatistics);
     }
     else
     {
@@ -33,7 +35,8 @@ I_BlockFactory* BlockFactorySelector(
             coinstakeCreator,
             settings,
             activeChain,
-            chainParameters);
+            chainParameters,
+            stakingStatistics);
     }
     assert(false);
 }
@@ -51,10 +54,11 @@ CoinMintingModule::CoinMintingModule(
     std::vector<CNode*>& peers,
     CWallet& wallet,
     BlockTimestampsByHeight& hashedBlockTimestampsByHeight,
+    StakingStatistics& stakingStatistics,
+    MintingWakeup& mintingWakeup,
     BlockMap& blockIndexByHash,
     const CSporkManager& sporkManager
-    ): posModule_(new ProofOfStakeModule(chainParameters,activeChain,blockIndexByHash))
-    , blockSubsidyContainer_(new SuperblockSubsidyContainer(chainParameters))
+    ): blockSubsidyContainer_(new SuperblockSubsidyContainer(chainParameters))
     , blockIncentivesPopulator_(new BlockIncentivesPopulator(
         chainParameters,
         masternodeSynchronization,
@@ -76,16 +80,18 @@ CoinMintingModule::CoinMintingModule(
         blockIndexByHash,
         blockSubsidyContainer_->blockSubsidiesProvider(),
         *blockIncentivesPopulator_,
-        posModule_->proofOfStakeGenerator(),
+        GetProofOfStakeGenerator(activeChain),
         wallet,
-        hashedBlockTimestampsByHeight))
+        hashedBlockTimestampsByHeight,
+        stakingStatistics))
     , blockFactory_(
         BlockFactorySelector(
             *blockTransactionCollector_,
             *coinstakeTransactionCreator_,
             settings,
             activeChain,
-            chainParameters))
+            chainParameters,
+            stakingStatistics))
     , coinMinter_( new CoinMinter(
         blockSubsidyContainer_->blockSubsidiesProvider(),
         *blockFactory_,
@@ -95,6 +101,8 @@ CoinMintingModule::CoinMintingModule(
         peers,
         masternodeSynchronization,
         hashedBlockTimestampsByHeight,
+        stakingStatistics,
+        mintingWakeup,
         mempool,
         mainCS))
 {
@@ -108,7 +116,6 @@ CoinMintingModule::~CoinMintingModule()
     blockTransactionCollector_.reset();
     blockIncentivesPopulator_.reset();
     blockSubsidyContainer_.reset();
-    posModule_.reset();
 }
 
 I_BlockFactory& CoinMintingModule::blockFactory() const
@@ -21,15 +21,15 @@ class SuperblockSubsidyContainer;
 class BlockIncentivesPopulator;
 class BlockMap;
 class CMasternodePayments;
-class ProofOfStakeModule;
 class CSporkManager;
 class Settings;
 class CCoinsViewCache;
 class CFeeRate;
+class StakingStatistics;
+class MintingWakeup;
 
 class CoinMintingModule
 {
-    std::unique_ptr<ProofOfStakeModule> posModule_;
     std::unique_ptr<SuperblockSubsidyContainer> blockSubsidyContainer_;
     std::unique_ptr<BlockIncentivesPopulator> blockIncentivesPopulator_;
     std::unique_ptr<I_BlockTransactionCollector> blockTransactionCollector_;
@@ -50,6 +50,8 @@ public:
         std::vector<CNode*>& peers,
         CWallet& wallet,
         BlockTimestampsByHeight& hashedBlockTimestampsByHeight,
+        StakingStatistics& stakingStatistics,
+        MintingWakeup& mintingWakeup,
         BlockMap& blockIndexByHash,
         const CSporkManager& sporkManager);
     ~CoinMintingModule();
@@ -0,0 +1,72 @@
+#include <CoinSupply.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <script/StakingVaultScript.h>
+
+namespace
+{
+void ApplyOutput(const CTxOut& txout, const std::set<CAmount>& collateralAmounts, bool fAdd, CoinSupply& supply)
+{
+    const CAmount nValue = fAdd ? txout.nValue : -txout.nValue;
+    if (IsStakingVaultScript(txout.scriptPubKey))
+        supply.nVaultValue += nValue;
+    else if (collateralAmounts.count(txout.nValue) > 0)
+        supply.nMasternodeCollateralValue += nValue;
+}
+}
+
+CoinSupply::CoinSupply(
+    ): blockHash(0)
+    , nHeight(0)
+    , nMoneySupply(0)
+    , nVaultValue(0)
+    , nMasternodeCollateralValue(0)
+    , nUnspendableValue(0)
+{
+}
+
+CoinSupply::CoinSupply(
+    const uint256& genesisHash
+    ): CoinSupply()
+{
+    blockHash = genesisHash;
+}
+
+CoinSupply::CoinSupply(
+    const CoinSupply& previous,
+    const CBlock& block,
+    const CBlockUndo& blockUndo,
+    const CBlockIndex& blockIndex,
+    const std::set<CAmount>& collateralAmounts
+    ): blockHash(blockIndex.GetBlockHash())
+    , nHeight(blockIndex.nHeight)
+    , nMoneySupply(blockIndex.nMoneySupply)
+    , nVaultValue(previous.nVaultValue)
+    , nMasternodeCollateralValue(previous.nMasternodeCollateralValue)
+    , nUnspendableValue(previous.nUnspendableValue)
+{
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        if (i > 0) {
+            for (const CTxInUndo& prevout : blockUndo.vtxundo[i - 1].vprevout)
+                ApplyOutput(prevout.txout, collateralAmounts, false, *this);
+        }
+        for (const CTxOut& txout : tx.vout) {
+            if (txout.scriptPubKey.IsUnspendable())
+                nUnspendableValue += txout.nValue;
+            else
+                ApplyOutput(txout, collateralAmounts, true, *this);
+        }
+    }
+}
+
+std::set<CAmount> CoinSupply::GetCollateralAmounts(const CChainParams& chainParameters)
+{
+    std::set<CAmount> collateralAmounts;
+    for (const auto& entry : chainParameters.MasternodeCollateralMap())
+        collateralAmounts.insert(entry.second);
+    return collateralAmounts;
+}
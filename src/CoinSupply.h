@@ -0,0 +1,60 @@
+#ifndef COIN_SUPPLY_H
+#define COIN_SUPPLY_H
+#include <amount.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <set>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+class CChainParams;
+
+/**
+ * Where the coins stand after a block, as kept in the supply index.
+ *
+ * Each block's record is that of its parent with the block's outputs and
+ * spends applied, so records are computed incrementally and stay valid for
+ * whichever branch their block is on. Collateral is counted by amount: any
+ * unspent output that is not a vault and pays exactly a masternode tier's
+ * collateral. Unspendable outputs never leave the set, so their value only
+ * grows.
+ */
+class CoinSupply
+{
+public:
+    uint256 blockHash;
+    int nHeight;
+    CAmount nMoneySupply;
+    CAmount nVaultValue;
+    CAmount nMasternodeCollateralValue;
+    CAmount nUnspendableValue;
+
+    CoinSupply();
+    //! The record of the genesis block, whose outputs are not in the coins view
+    explicit CoinSupply(const uint256& genesisHash);
+    CoinSupply(
+        const CoinSupply& previous,
+        const CBlock& block,
+        const CBlockUndo& blockUndo,
+        const CBlockIndex& blockIndex,
+        const std::set<CAmount>& collateralAmounts);
+
+    //! Amounts that pay a masternode tier's collateral on the chain
+    static std::set<CAmount> GetCollateralAmounts(const CChainParams& chainParameters);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(blockHash);
+        READWRITE(nHeight);
+        READWRITE(nMoneySupply);
+        READWRITE(nVaultValue);
+        READWRITE(nMasternodeCollateralValue);
+        READWRITE(nUnspendableValue);
+    }
+};
+#endif// COIN_SUPPLY_H
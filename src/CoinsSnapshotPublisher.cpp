@@ -0,0 +1,57 @@
+#include <CoinsSnapshotPublisher.h>
+
+CoinsSnapshotPublisher::CoinsSnapshotPublisher(
+    ): mutex_()
+    , latest_()
+    , hashTip_(0)
+    , requested_(false)
+{
+}
+
+bool CoinsSnapshotPublisher::GetLatest(CoinsSnapshot& snapshot)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    requested_ = true;
+    if (!latest_.view || latest_.hashBlock != hashTip_)
+        return false;
+    snapshot = latest_;
+    return true;
+}
+
+bool CoinsSnapshotPublisher::Publish(CCoinsViewCache& tip, int nHeight, CoinsSnapshot& snapshot)
+{
+    CoinsSnapshot opened;
+    opened.view = tip.OpenSnapshot();
+    if (!opened.view)
+        return false;
+    opened.hashBlock = tip.GetBestBlock();
+    opened.nHeight = nHeight;
+
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    latest_ = opened;
+    hashTip_ = opened.hashBlock;
+    requested_ = false;
+    snapshot = opened;
+    return true;
+}
+
+void CoinsSnapshotPublisher::TipChanged(CCoinsViewCache& tip, int nHeight)
+{
+    bool fRequested;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        hashTip_ = tip.GetBestBlock();
+        fRequested = requested_;
+    }
+    if (fRequested) {
+        CoinsSnapshot snapshot;
+        Publish(tip, nHeight, snapshot);
+    }
+}
+
+void CoinsSnapshotPublisher::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    latest_ = CoinsSnapshot();
+    hashTip_ = uint256(0);
+}
@@ -0,0 +1,50 @@
+#ifndef COINS_SNAPSHOT_PUBLISHER_H
+#define COINS_SNAPSHOT_PUBLISHER_H
+#include <coins.h>
+#include <uint256.h>
+
+#include <memory>
+
+#include <boost/thread/mutex.hpp>
+
+/** Read-only coins view as of a connected block */
+struct CoinsSnapshot {
+    std::shared_ptr<CCoinsView> view;
+    uint256 hashBlock;
+    int nHeight;
+
+    CoinsSnapshot() : view(), hashBlock(0), nHeight(-1) {}
+};
+
+/**
+ * Hands snapshots of the coins tip to readers that do not hold cs_main.
+ *
+ * Opening a snapshot pushes the dirty entries of the tip down to the write
+ * buffer, so it is only done while someone reads: a reader that finds the
+ * latest snapshot outdated opens a new one under cs_main, and the next tip
+ * change publishes one right away once readers have shown up since the last.
+ */
+class CoinsSnapshotPublisher
+{
+private:
+    mutable boost::mutex mutex_;
+    CoinsSnapshot latest_;
+    uint256 hashTip_;
+    bool requested_;
+
+public:
+    CoinsSnapshotPublisher();
+
+    //! The latest snapshot, if it is still for the current tip
+    bool GetLatest(CoinsSnapshot& snapshot);
+
+    //! Open a snapshot of tip at nHeight and publish it; the caller keeps tip from changing meanwhile
+    bool Publish(CCoinsViewCache& tip, int nHeight, CoinsSnapshot& snapshot);
+
+    //! Called whenever tip moved to another block, with tip kept from changing
+    void TipChanged(CCoinsViewCache& tip, int nHeight);
+
+    //! Drop the latest snapshot so the databases below can go away
+    void Clear();
+};
+#endif// COINS_SNAPSHOT_PUBLISHER_H
@@ -0,0 +1,289 @@
+#include <CoinsViewWriteBuffer.h>
+
+#include <Logging.h>
+#include <ThreadManagementHelpers.h>
+#include <memusage.h>
+
+#include <stdexcept>
+
+CoinsViewWriteBuffer::CoinsViewWriteBuffer(
+    CCoinsView* baseIn
+    ): CCoinsViewBacked(baseIn)
+    , mutex_()
+    , writeStateChanged_()
+    , pendingCoins_()
+    , pendingCoinsUsage_(0)
+    , pendingBestBlock_(0)
+    , frozenBatches_()
+    , writeInProgress_(false)
+    , writeFailed_(false)
+    , stopRequested_(false)
+    , writerThread_()
+{
+    writerThread_ = boost::thread(&CoinsViewWriteBuffer::ThreadWriteCoins, this);
+}
+
+CoinsViewWriteBuffer::~CoinsViewWriteBuffer()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    writeStateChanged_.notify_all();
+    writerThread_.join();
+}
+
+namespace
+{
+bool FindFrozenCoins(const CoinsViewWriteBuffer::FrozenBatches& batches, const uint256& txid, CCoins& coins)
+{
+    for (CoinsViewWriteBuffer::FrozenBatches::const_reverse_iterator itBatch = batches.rbegin(); itBatch != batches.rend(); ++itBatch) {
+        CCoinsMap::const_iterator it = (*itBatch)->coins.find(txid);
+        if (it != (*itBatch)->coins.end()) {
+            coins = it->second.coins;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint256 GetFrozenBestBlock(const CoinsViewWriteBuffer::FrozenBatches& batches)
+{
+    for (CoinsViewWriteBuffer::FrozenBatches::const_reverse_iterator itBatch = batches.rbegin(); itBatch != batches.rend(); ++itBatch) {
+        if ((*itBatch)->hashBlock != uint256(0))
+            return (*itBatch)->hashBlock;
+    }
+    return uint256(0);
+}
+
+/** The buffered batches as of a snapshot, on top of a snapshot of the backing view */
+class CoinsViewWriteBufferSnapshot : public CCoinsView
+{
+private:
+    const CoinsViewWriteBuffer::FrozenBatches batches_;
+    const std::shared_ptr<CCoinsView> base_;
+
+public:
+    CoinsViewWriteBufferSnapshot(
+        const CoinsViewWriteBuffer::FrozenBatches& batches,
+        const std::shared_ptr<CCoinsView>& base
+        ): batches_(batches)
+        , base_(base)
+    {
+    }
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const
+    {
+        if (FindFrozenCoins(batches_, txid, coins))
+            return true;
+        return base_->GetCoins(txid, coins);
+    }
+
+    bool HaveCoins(const uint256& txid) const
+    {
+        CCoins coins;
+        if (FindFrozenCoins(batches_, txid, coins))
+            return !coins.IsPruned();
+        return base_->HaveCoins(txid);
+    }
+
+    uint256 GetBestBlock() const
+    {
+        const uint256 hashBlock = GetFrozenBestBlock(batches_);
+        if (hashBlock != uint256(0))
+            return hashBlock;
+        return base_->GetBestBlock();
+    }
+};
+}
+
+bool CoinsViewWriteBuffer::FindBufferedCoins(const uint256& txid, CCoins& coins) const
+{
+    CCoinsMap::const_iterator it = pendingCoins_.find(txid);
+    if (it != pendingCoins_.end()) {
+        coins = it->second.coins;
+        return true;
+    }
+    return FindFrozenCoins(frozenBatches_, txid, coins);
+}
+
+bool CoinsViewWriteBuffer::HasPendingWork() const
+{
+    return !pendingCoins_.empty() || pendingBestBlock_ != uint256(0) || !frozenBatches_.empty();
+}
+
+void CoinsViewWriteBuffer::FreezePendingBatch()
+{
+    if (pendingCoins_.empty() && pendingBestBlock_ == uint256(0))
+        return;
+    std::shared_ptr<Batch> batch(new Batch());
+    batch->usage = memusage::DynamicUsage(pendingCoins_) + pendingCoinsUsage_;
+    batch->coins.swap(pendingCoins_);
+    batch->hashBlock = pendingBestBlock_;
+    pendingCoinsUsage_ = 0;
+    pendingBestBlock_ = uint256(0);
+    frozenBatches_.push_back(batch);
+}
+
+bool CoinsViewWriteBuffer::GetCoins(const uint256& txid, CCoins& coins) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (FindBufferedCoins(txid, coins))
+        return true;
+    return base->GetCoins(txid, coins);
+}
+
+void CoinsViewWriteBuffer::GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    std::vector<uint256> missing;
+    CCoins found;
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        if (FindBufferedCoins(*it, found)) {
+            coins.push_back(std::make_pair(*it, CCoins()));
+            coins.back().second.swap(found);
+        } else {
+            missing.push_back(*it);
+        }
+    }
+    if (!missing.empty())
+        base->GetCoinsBatch(missing, coins);
+}
+
+bool CoinsViewWriteBuffer::HaveCoins(const uint256& txid) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    CCoins coins;
+    if (FindBufferedCoins(txid, coins))
+        return !coins.IsPruned();
+    return base->HaveCoins(txid);
+}
+
+uint256 CoinsViewWriteBuffer::GetBestBlock() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (pendingBestBlock_ != uint256(0))
+        return pendingBestBlock_;
+    const uint256 hashBlock = GetFrozenBestBlock(frozenBatches_);
+    if (hashBlock != uint256(0))
+        return hashBlock;
+    return base->GetBestBlock();
+}
+
+bool CoinsViewWriteBuffer::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (writeFailed_)
+            return false;
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+                std::pair<CCoinsMap::iterator, bool> ret = pendingCoins_.insert(std::make_pair(it->first, CCoinsCacheEntry()));
+                CCoinsCacheEntry& entry = ret.first->second;
+                // An entry merged into a pending one keeps what the database has from before the pending one
+                if (ret.second)
+                    it->second.MoveParentOutputs(entry);
+                pendingCoinsUsage_ -= entry.coins.DynamicMemoryUsage();
+                entry.coins.swap(it->second.coins);
+                pendingCoinsUsage_ += entry.coins.DynamicMemoryUsage();
+                entry.flags = CCoinsCacheEntry::DIRTY;
+            }
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        }
+        if (hashBlock != uint256(0))
+            pendingBestBlock_ = hashBlock;
+    }
+    writeStateChanged_.notify_all();
+    return true;
+}
+
+bool CoinsViewWriteBuffer::GetStats(CCoinsStats& stats) const
+{
+    if (!WaitForPendingWrites())
+        return false;
+    return base->GetStats(stats);
+}
+
+bool CoinsViewWriteBuffer::GetRunningStats(CCoinsStats& stats) const
+{
+    if (!WaitForPendingWrites())
+        return false;
+    return base->GetRunningStats(stats);
+}
+
+std::shared_ptr<CCoinsView> CoinsViewWriteBuffer::OpenSnapshot()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (writeFailed_)
+        return std::shared_ptr<CCoinsView>();
+    std::shared_ptr<CCoinsView> baseSnapshot = base->OpenSnapshot();
+    if (!baseSnapshot)
+        return baseSnapshot;
+    // Later flushes must not show through, so they go into a new batch.
+    FreezePendingBatch();
+    return std::shared_ptr<CCoinsView>(new CoinsViewWriteBufferSnapshot(frozenBatches_, baseSnapshot));
+}
+
+bool CoinsViewWriteBuffer::WaitForPendingWrites() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while ((HasPendingWork() || writeInProgress_) && !writeFailed_)
+        writeStateChanged_.wait(lock);
+    return !writeFailed_;
+}
+
+size_t CoinsViewWriteBuffer::DynamicMemoryUsage() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    size_t usage = memusage::DynamicUsage(pendingCoins_) + pendingCoinsUsage_;
+    for (FrozenBatches::const_iterator it = frozenBatches_.begin(); it != frozenBatches_.end(); ++it)
+        usage += (*it)->usage;
+    // The database is handed its own copy of the batch being written
+    if (writeInProgress_)
+        usage += frozenBatches_.front()->usage;
+    return usage;
+}
+
+void CoinsViewWriteBuffer::ThreadWriteCoins()
+{
+    RenameThread("izzy-coinswriter");
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (true) {
+        while (!HasPendingWork() && !stopRequested_)
+            writeStateChanged_.wait(lock);
+        if (!HasPendingWork())
+            break;
+
+        if (frozenBatches_.empty())
+            FreezePendingBatch();
+        writeInProgress_ = true;
+        // The backing view consumes the map it is given, while readers and
+        // snapshots keep looking entries up in the frozen batch.
+        const std::shared_ptr<const Batch> frozen = frozenBatches_.front();
+        CCoinsMap batch(frozen->coins);
+        const uint256 hashBlock = frozen->hashBlock;
+        lock.unlock();
+
+        bool fOk = false;
+        try {
+            fOk = base->BatchWrite(batch, hashBlock);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+
+        lock.lock();
+        if (!fOk) {
+            // Keep serving the unwritten entries to readers; the failure is
+            // reported to the next flush, which aborts the node.
+            LogPrintf("%s: failed to commit %u coin entries to the database\n", __func__, (unsigned int)frozen->coins.size());
+            writeFailed_ = true;
+            writeInProgress_ = false;
+            writeStateChanged_.notify_all();
+            break;
+        }
+        frozenBatches_.pop_front();
+        writeInProgress_ = false;
+        writeStateChanged_.notify_all();
+    }
+}
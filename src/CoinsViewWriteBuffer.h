@@ -0,0 +1,78 @@
+#ifndef COINS_VIEW_WRITE_BUFFER_H
+#define COINS_VIEW_WRITE_BUFFER_H
+#include <coins.h>
+#include <uint256.h>
+
+#include <deque>
+#include <memory>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/**
+ * CCoinsView that sits between the coins tip cache and the coin database and
+ * commits flushed entries to the database from a dedicated writer thread.
+ *
+ * Entries handed over through BatchWrite are merged into a pending batch until
+ * the writer picks it up or a snapshot is opened; from then on the batch is
+ * frozen and queued, and later flushes start a new one. Reads consult the
+ * pending and queued batches before the backing view, so callers never observe
+ * the database lagging behind. Each batch goes out as a single database write
+ * that carries the best block marker, so a crash mid-write leaves either the
+ * previous or the new consistent state on disk.
+ *
+ * Snapshots share the frozen batches and pin the backing view through its own
+ * snapshot, which may be taken before or after the batch being written is
+ * committed: the batch overrides the backing view either way.
+ */
+class CoinsViewWriteBuffer : public CCoinsViewBacked
+{
+public:
+    //! Coins handed over by one or more flushes, and the best block they lead to (0 if unchanged)
+    struct Batch {
+        CCoinsMap coins;
+        uint256 hashBlock;
+        size_t usage;
+
+        Batch() : coins(), hashBlock(0), usage(0) {}
+    };
+    typedef std::deque<std::shared_ptr<const Batch> > FrozenBatches;
+
+private:
+    mutable boost::mutex mutex_;
+    mutable boost::condition_variable writeStateChanged_;
+    CCoinsMap pendingCoins_;
+    size_t pendingCoinsUsage_;
+    uint256 pendingBestBlock_;
+    //! Oldest first; the front one is being written while writeInProgress_ is set
+    FrozenBatches frozenBatches_;
+    bool writeInProgress_;
+    bool writeFailed_;
+    bool stopRequested_;
+    boost::thread writerThread_;
+
+    bool FindBufferedCoins(const uint256& txid, CCoins& coins) const;
+    bool HasPendingWork() const;
+    void FreezePendingBatch();
+    void ThreadWriteCoins();
+
+public:
+    CoinsViewWriteBuffer(CCoinsView* baseIn);
+    ~CoinsViewWriteBuffer();
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const;
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const;
+    bool HaveCoins(const uint256& txid) const;
+    uint256 GetBestBlock() const;
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock);
+    bool GetStats(CCoinsStats& stats) const;
+    bool GetRunningStats(CCoinsStats& stats) const;
+    std::shared_ptr<CCoinsView> OpenSnapshot();
+
+    //! Block until everything handed over so far is committed; false if any write failed
+    bool WaitForPendingWrites() const;
+    //! Memory held by the coins not committed yet, including the copy of the batch being written
+    size_t DynamicMemoryUsage() const;
+};
+#endif// COINS_VIEW_WRITE_BUFFER_H
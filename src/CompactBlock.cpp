@@ -0,0 +1,63 @@
+#include <CompactBlock.h>
+
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <crypto/siphash.h>
+#include <streams.h>
+#include <version.h>
+
+#include <algorithm>
+
+CompactBlock::CompactBlock(
+    ): header()
+    , vchBlockSig()
+    , nonce(0)
+    , shortIds()
+    , prefilledTransactions()
+    , shortIdKey0_(0)
+    , shortIdKey1_(0)
+{
+}
+
+CompactBlock::CompactBlock(
+    const CBlock& block,
+    uint64_t nonceIn
+    ): header(block.GetBlockHeader())
+    , vchBlockSig(block.vchBlockSig)
+    , nonce(nonceIn)
+    , shortIds()
+    , prefilledTransactions()
+    , shortIdKey0_(0)
+    , shortIdKey1_(0)
+{
+    ComputeShortIdKeys();
+    const size_t prefilledCount = std::min(block.vtx.size(), block.IsProofOfStake() ? (size_t)2 : (size_t)1);
+    for (size_t index = 0; index < block.vtx.size(); index++) {
+        if (index < prefilledCount) {
+            PrefilledTransaction prefilled = {(uint32_t)index, block.vtx[index]};
+            prefilledTransactions.push_back(prefilled);
+        } else {
+            shortIds.push_back(GetShortId(block.vtx[index].GetHash()));
+        }
+    }
+}
+
+void CompactBlock::ComputeShortIdKeys()
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << header << nonce;
+    unsigned char keys[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write((const unsigned char*)&stream[0], stream.size()).Finalize(keys);
+    shortIdKey0_ = ReadLE64(keys);
+    shortIdKey1_ = ReadLE64(keys + 8);
+}
+
+uint64_t CompactBlock::GetShortId(const uint256& txHash) const
+{
+    return CSipHasher(shortIdKey0_, shortIdKey1_).Write(txHash.begin(), txHash.size()).Finalize() & 0xffffffffffffULL;
+}
+
+size_t CompactBlock::BlockTransactionCount() const
+{
+    return shortIds.size() + prefilledTransactions.size();
+}
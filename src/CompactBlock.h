@@ -0,0 +1,94 @@
+#ifndef COMPACT_BLOCK_H
+#define COMPACT_BLOCK_H
+#include <defaultValues.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * A block as announced in a "cmpctblock" message: the header and block
+ * signature, the transactions the receiver cannot have yet in full, and a
+ * short id for each of the others.
+ *
+ * The coinbase, and the coinstake of a proof-of-stake block, are prefilled
+ * since they only exist in the block. The remaining transactions are named by
+ * six bytes of a SipHash of their hash, keyed by the header and a nonce the
+ * sender picks, so a peer cannot craft colliding transactions for every
+ * announcement ahead of time.
+ */
+class CompactBlock
+{
+public:
+    struct PrefilledTransaction {
+        //! The position in the block
+        uint32_t index;
+        CTransaction tx;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+        {
+            READWRITE(VARINT(index));
+            READWRITE(tx);
+        }
+    };
+
+    static const unsigned SHORT_ID_LENGTH = 6;
+    //! No block has more transactions than would fit it at the smallest transaction size
+    static const size_t MAX_TRANSACTIONS = MAX_BLOCK_SIZE_CURRENT / 60;
+
+    CBlockHeader header;
+    std::vector<unsigned char> vchBlockSig;
+    uint64_t nonce;
+    std::vector<uint64_t> shortIds;
+    //! Kept in ascending order of position
+    std::vector<PrefilledTransaction> prefilledTransactions;
+
+private:
+    uint64_t shortIdKey0_;
+    uint64_t shortIdKey1_;
+
+    void ComputeShortIdKeys();
+
+public:
+    CompactBlock();
+    CompactBlock(const CBlock& block, uint64_t nonceIn);
+
+    uint64_t GetShortId(const uint256& txHash) const;
+    size_t BlockTransactionCount() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(header);
+        READWRITE(vchBlockSig);
+        READWRITE(nonce);
+        // Short ids go over the wire as their six low bytes
+        uint64_t nShortIds = shortIds.size();
+        READWRITE(VARINT(nShortIds));
+        if (ser_action.ForRead()) {
+            if (nShortIds > MAX_TRANSACTIONS)
+                throw std::ios_base::failure("CompactBlock : too many short ids");
+            shortIds.resize(nShortIds);
+        }
+        for (uint64_t& shortId : shortIds) {
+            uint32_t lowBytes = (uint32_t)shortId;
+            uint16_t highBytes = (uint16_t)(shortId >> 32);
+            READWRITE(lowBytes);
+            READWRITE(highBytes);
+            shortId = ((uint64_t)highBytes << 32) | lowBytes;
+        }
+        READWRITE(prefilledTransactions);
+        if (ser_action.ForRead())
+            ComputeShortIdKeys();
+    }
+};
+#endif// COMPACT_BLOCK_H
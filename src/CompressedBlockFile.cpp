@@ -0,0 +1,321 @@
+#if defined(HAVE_CONFIG_H)
+#include "config/izzy-config.h"
+#endif
+
+#include <CompressedBlockFile.h>
+
+#include <clientversion.h>
+#include <defaultValues.h>
+#include <Logging.h>
+#include <streams.h>
+#include <util.h>
+
+#include <string.h>
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+const unsigned char compressedBlockFileMagic[4] = {'I', 'Z', 'B', 'Z'};
+const uint32_t nCompressedBlockFileVersion = 1;
+//! Magic, version, chunk size, original size and index position
+const uint64_t nCompressedBlockFileHeaderSize = 4 + 4 + 4 + 8 + 8;
+std::atomic<uint64_t> nNextCompressedBlockFileId(0);
+
+/** Least recently used objects shared by all compressed block files */
+template <typename Key, typename Value>
+class RecentlyUsed
+{
+    boost::mutex mutex_;
+    const size_t maxEntries_;
+    //! Most recently used first
+    std::list<std::pair<Key, std::shared_ptr<Value> > > entries_;
+
+public:
+    explicit RecentlyUsed(size_t maxEntries) : mutex_(), maxEntries_(maxEntries), entries_() {}
+
+    std::shared_ptr<Value> Find(const Key& key)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        for (typename std::list<std::pair<Key, std::shared_ptr<Value> > >::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->first == key) {
+                entries_.splice(entries_.begin(), entries_, it);
+                return it->second;
+            }
+        }
+        return std::shared_ptr<Value>();
+    }
+
+    void Insert(const Key& key, const std::shared_ptr<Value>& value)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        entries_.push_front(std::make_pair(key, value));
+        if (entries_.size() > maxEntries_)
+            entries_.pop_back();
+    }
+};
+
+//! Keyed by the id of the file object rather than its path, which a retried compression writes anew
+RecentlyUsed<std::pair<uint64_t, uint32_t>, const std::vector<char> > decompressedChunks(COMPRESSED_BLOCKFILE_CACHED_CHUNKS);
+//! Saves reading the chunk offsets again for every block read from the same files
+RecentlyUsed<std::string, const CompressedBlockFile> openedFiles(COMPRESSED_BLOCKFILE_CACHED_CHUNKS);
+
+#if defined(HAVE_ZLIB) && defined(HAVE_FOPENCOOKIE)
+struct CompressedBlockFileStream {
+    std::shared_ptr<const CompressedBlockFile> file;
+    uint64_t nPos;
+};
+
+ssize_t ReadCompressedBlockFileStream(void* cookie, char* buf, size_t size)
+{
+    CompressedBlockFileStream* stream = static_cast<CompressedBlockFileStream*>(cookie);
+    const int64_t nRead = stream->file->Read(stream->nPos, buf, size);
+    if (nRead < 0)
+        return -1;
+    stream->nPos += nRead;
+    return nRead;
+}
+
+int SeekCompressedBlockFileStream(void* cookie, off64_t* offset, int whence)
+{
+    CompressedBlockFileStream* stream = static_cast<CompressedBlockFileStream*>(cookie);
+    int64_t nBase = 0;
+    if (whence == SEEK_CUR)
+        nBase = stream->nPos;
+    else if (whence == SEEK_END)
+        nBase = stream->file->GetOriginalSize();
+    if (nBase + *offset < 0)
+        return -1;
+    stream->nPos = nBase + *offset;
+    *offset = stream->nPos;
+    return 0;
+}
+
+int CloseCompressedBlockFileStream(void* cookie)
+{
+    delete static_cast<CompressedBlockFileStream*>(cookie);
+    return 0;
+}
+#endif
+
+bool FilesMatch(const boost::filesystem::path& source, const CompressedBlockFile& compressed, uint32_t nChunkSize)
+{
+    CAutoFile filein(fopen(source.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+    std::vector<char> original(nChunkSize);
+    std::vector<char> decompressed(nChunkSize);
+    uint64_t nPos = 0;
+    while (true) {
+        const size_t nRead = fread(&original[0], 1, nChunkSize, filein.Get());
+        if (compressed.Read(nPos, &decompressed[0], nChunkSize) != (int64_t)nRead)
+            return false;
+        if (memcmp(&original[0], &decompressed[0], nRead) != 0)
+            return false;
+        nPos += nRead;
+        if (nRead < nChunkSize)
+            return !ferror(filein.Get()) && nPos == compressed.GetOriginalSize();
+    }
+}
+}
+
+CompressedBlockFile::CompressedBlockFile(
+    const boost::filesystem::path& path
+    ): nId_(nNextCompressedBlockFileId++)
+    , path_(path)
+    , mutex_()
+    , file_(NULL)
+    , nChunkSize_(0)
+    , nOriginalSize_(0)
+    , vChunkOffsets_()
+{
+}
+
+CompressedBlockFile::~CompressedBlockFile()
+{
+    if (file_)
+        fclose(file_);
+}
+
+bool CompressedBlockFile::IsSupported()
+{
+#if defined(HAVE_ZLIB) && defined(HAVE_FOPENCOOKIE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CompressedBlockFile::ReadIndex()
+{
+    CAutoFile filein(fopen(path_.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+    try {
+        unsigned char magic[sizeof(compressedBlockFileMagic)];
+        uint32_t nVersion;
+        uint64_t nIndexPos;
+        filein >> FLATDATA(magic) >> nVersion >> nChunkSize_ >> nOriginalSize_ >> nIndexPos;
+        if (memcmp(magic, compressedBlockFileMagic, sizeof(magic)) || nVersion != nCompressedBlockFileVersion || nChunkSize_ == 0)
+            return error("%s : %s is not a compressed block file", __func__, path_.string());
+        if (fseek(filein.Get(), nIndexPos, SEEK_SET))
+            return error("%s : unable to seek to the chunk offsets of %s", __func__, path_.string());
+        filein >> vChunkOffsets_;
+    } catch (const std::exception& e) {
+        return error("%s : unable to read %s: %s", __func__, path_.string(), e.what());
+    }
+    const uint64_t nChunks = (nOriginalSize_ + nChunkSize_ - 1) / nChunkSize_;
+    if (vChunkOffsets_.size() != nChunks + 1 || vChunkOffsets_.front() != nCompressedBlockFileHeaderSize)
+        return error("%s : chunk offsets of %s do not match its size", __func__, path_.string());
+    for (unsigned n = 1; n < vChunkOffsets_.size(); n++) {
+        if (vChunkOffsets_[n] < vChunkOffsets_[n - 1])
+            return error("%s : chunk offsets of %s are out of order", __func__, path_.string());
+    }
+    file_ = filein.release();
+    return true;
+}
+
+std::shared_ptr<const std::vector<char> > CompressedBlockFile::GetChunk(uint32_t nChunk) const
+{
+    const std::pair<uint64_t, uint32_t> key(nId_, nChunk);
+    std::shared_ptr<const std::vector<char> > cached = decompressedChunks.Find(key);
+    if (cached)
+        return cached;
+#ifdef HAVE_ZLIB
+    std::vector<unsigned char> compressed(vChunkOffsets_[nChunk + 1] - vChunkOffsets_[nChunk]);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (fseek(file_, vChunkOffsets_[nChunk], SEEK_SET) || fread(compressed.data(), 1, compressed.size(), file_) != compressed.size()) {
+            error("%s : unable to read chunk %u of %s", __func__, nChunk, path_.string());
+            return cached;
+        }
+    }
+    const uint64_t nChunkStart = (uint64_t)nChunk * nChunkSize_;
+    std::shared_ptr<std::vector<char> > chunk = std::make_shared<std::vector<char> >(std::min<uint64_t>(nChunkSize_, nOriginalSize_ - nChunkStart));
+    uLongf nDecompressedSize = chunk->size();
+    if (uncompress(reinterpret_cast<Bytef*>(chunk->data()), &nDecompressedSize, compressed.data(), compressed.size()) != Z_OK || nDecompressedSize != chunk->size()) {
+        error("%s : chunk %u of %s is corrupt", __func__, nChunk, path_.string());
+        return cached;
+    }
+    decompressedChunks.Insert(key, chunk);
+    return chunk;
+#else
+    return cached;
+#endif
+}
+
+bool CompressedBlockFile::Compress(const boost::filesystem::path& source, const boost::filesystem::path& target, uint32_t nChunkSize)
+{
+#ifdef HAVE_ZLIB
+    CAutoFile filein(fopen(source.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    CAutoFile fileout(fopen(target.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull() || fileout.IsNull())
+        return error("%s : unable to open %s or %s", __func__, source.string(), target.string());
+    try {
+        uint64_t nOriginalSize = 0;
+        std::vector<uint64_t> vChunkOffsets(1, nCompressedBlockFileHeaderSize);
+        // The header is written again once the chunk offsets are known.
+        fileout << FLATDATA(compressedBlockFileMagic) << nCompressedBlockFileVersion << nChunkSize << nOriginalSize << nOriginalSize;
+
+        std::vector<unsigned char> chunk(nChunkSize);
+        std::vector<unsigned char> compressed(compressBound(nChunkSize));
+        while (true) {
+            const size_t nRead = fread(chunk.data(), 1, nChunkSize, filein.Get());
+            if (nRead == 0)
+                break;
+            uLongf nCompressedSize = compressed.size();
+            if (compress2(compressed.data(), &nCompressedSize, chunk.data(), nRead, Z_BEST_SPEED) != Z_OK)
+                return error("%s : unable to compress %s", __func__, source.string());
+            if (fwrite(compressed.data(), 1, nCompressedSize, fileout.Get()) != nCompressedSize)
+                return error("%s : unable to write %s", __func__, target.string());
+            nOriginalSize += nRead;
+            vChunkOffsets.push_back(vChunkOffsets.back() + nCompressedSize);
+        }
+        if (ferror(filein.Get()))
+            return error("%s : unable to read %s", __func__, source.string());
+
+        fileout << vChunkOffsets;
+        if (fseek(fileout.Get(), 0, SEEK_SET))
+            return error("%s : unable to seek in %s", __func__, target.string());
+        fileout << FLATDATA(compressedBlockFileMagic) << nCompressedBlockFileVersion << nChunkSize << nOriginalSize << vChunkOffsets.back();
+        FileCommit(fileout.Get());
+    } catch (const std::exception& e) {
+        return error("%s : unable to write %s: %s", __func__, target.string(), e.what());
+    }
+    fileout.fclose();
+
+    // The original goes away once this succeeds, so make sure all of it can be read back.
+    CompressedBlockFile written(target);
+    if (!written.ReadIndex() || !FilesMatch(source, written, nChunkSize))
+        return error("%s : %s does not read back as %s", __func__, target.string(), source.string());
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<const CompressedBlockFile> CompressedBlockFile::Open(const boost::filesystem::path& path)
+{
+    std::shared_ptr<const CompressedBlockFile> opened = openedFiles.Find(path.string());
+    if (opened)
+        return opened;
+    std::shared_ptr<CompressedBlockFile> file(new CompressedBlockFile(path));
+    if (!file->ReadIndex())
+        return opened;
+    openedFiles.Insert(path.string(), file);
+    return file;
+}
+
+FILE* CompressedBlockFile::OpenAsStream(const boost::filesystem::path& path)
+{
+#if defined(HAVE_ZLIB) && defined(HAVE_FOPENCOOKIE)
+    if (!boost::filesystem::exists(path))
+        return NULL;
+    CompressedBlockFileStream* stream = new CompressedBlockFileStream();
+    stream->file = Open(path);
+    stream->nPos = 0;
+    if (!stream->file) {
+        delete stream;
+        return NULL;
+    }
+    cookie_io_functions_t functions;
+    functions.read = &ReadCompressedBlockFileStream;
+    functions.write = NULL;
+    functions.seek = &SeekCompressedBlockFileStream;
+    functions.close = &CloseCompressedBlockFileStream;
+    FILE* file = fopencookie(stream, "rb", functions);
+    if (!file)
+        delete stream;
+    return file;
+#else
+    return NULL;
+#endif
+}
+
+int64_t CompressedBlockFile::Read(uint64_t nPos, char* pch, size_t nSize) const
+{
+    int64_t nCopied = 0;
+    while (nSize > 0 && nPos < nOriginalSize_) {
+        const uint32_t nChunk = nPos / nChunkSize_;
+        std::shared_ptr<const std::vector<char> > chunk = GetChunk(nChunk);
+        if (!chunk)
+            return -1;
+        const size_t nOffset = nPos - (uint64_t)nChunk * nChunkSize_;
+        const size_t nCopy = std::min(nSize, chunk->size() - nOffset);
+        memcpy(pch, chunk->data() + nOffset, nCopy);
+        pch += nCopy;
+        nPos += nCopy;
+        nSize -= nCopy;
+        nCopied += nCopy;
+    }
+    return nCopied;
+}
@@ -0,0 +1,61 @@
+#ifndef COMPRESSED_BLOCK_FILE_H
+#define COMPRESSED_BLOCK_FILE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * A block file compressed in fixed-size chunks of its original contents.
+ *
+ * Chunks are compressed on their own, so any byte range of the original file
+ * is read back by decompressing just the chunks covering it; positions into
+ * the original file, such as those the block index and the transaction index
+ * store, keep pointing at the same data. The chunk offsets are kept after the
+ * chunks, and a small cache shared by all compressed files holds the chunks
+ * decompressed most recently.
+ *
+ * Layout: magic, version, chunk size, original size, offset of the chunk
+ * offsets; the compressed chunks; the chunk offsets, one past the last chunk
+ * included.
+ */
+class CompressedBlockFile
+{
+private:
+    CompressedBlockFile(const CompressedBlockFile&);
+    CompressedBlockFile& operator=(const CompressedBlockFile&);
+
+    const uint64_t nId_;
+    const boost::filesystem::path path_;
+    mutable boost::mutex mutex_;
+    FILE* file_;
+    uint32_t nChunkSize_;
+    uint64_t nOriginalSize_;
+    std::vector<uint64_t> vChunkOffsets_;
+
+    explicit CompressedBlockFile(const boost::filesystem::path& path);
+    bool ReadIndex();
+    std::shared_ptr<const std::vector<char> > GetChunk(uint32_t nChunk) const;
+
+public:
+    ~CompressedBlockFile();
+
+    //! Whether this build can compress and read back block files at all
+    static bool IsSupported();
+    //! Write source compressed in chunks of nChunkSize bytes to target; false on failure, leaving target incomplete
+    static bool Compress(const boost::filesystem::path& source, const boost::filesystem::path& target, uint32_t nChunkSize);
+    //! The compressed file at path, or NULL if it cannot be read
+    static std::shared_ptr<const CompressedBlockFile> Open(const boost::filesystem::path& path);
+    //! A read-only stream of the original contents of the compressed file at path, or NULL
+    static FILE* OpenAsStream(const boost::filesystem::path& path);
+
+    uint64_t GetOriginalSize() const { return nOriginalSize_; }
+    //! Copy up to nSize bytes of the original file from nPos on; how many were copied, or -1 on read errors
+    int64_t Read(uint64_t nPos, char* pch, size_t nSize) const;
+};
+#endif// COMPRESSED_BLOCK_FILE_H
@@ -0,0 +1,202 @@
+#include <ConfirmationStats.h>
+
+#include <Logging.h>
+
+#include <math.h>
+#include <stdexcept>
+
+ConfirmationStats::ConfirmationStats(
+    const std::vector<double>& buckets,
+    unsigned int nMaxConfirms,
+    double decay
+    ): buckets_(buckets)
+    , bucketMap_()
+    , txCtAvg_()
+    , avg_()
+    , confAvg_()
+    , curBlockTxCt_()
+    , curBlockVal_()
+    , curBlockConf_()
+    , unconfTxs_()
+    , oldUnconfTxs_()
+    , decay_(decay)
+{
+    Resize(nMaxConfirms);
+}
+
+void ConfirmationStats::Resize(unsigned int nMaxConfirms)
+{
+    const unsigned int nBuckets = buckets_.size();
+    bucketMap_.clear();
+    for (unsigned int i = 0; i < nBuckets; i++)
+        bucketMap_[buckets_[i]] = i;
+    txCtAvg_.assign(nBuckets, 0);
+    avg_.assign(nBuckets, 0);
+    confAvg_.assign(nMaxConfirms, std::vector<double>(nBuckets, 0));
+    curBlockTxCt_.assign(nBuckets, 0);
+    curBlockVal_.assign(nBuckets, 0);
+    curBlockConf_.assign(nMaxConfirms, std::vector<int>(nBuckets, 0));
+    unconfTxs_.assign(nMaxConfirms, std::vector<int>(nBuckets, 0));
+    oldUnconfTxs_.assign(nBuckets, 0);
+}
+
+unsigned int ConfirmationStats::FindBucket(double value) const
+{
+    std::map<double, unsigned int>::const_iterator it = bucketMap_.lower_bound(value);
+    return it != bucketMap_.end() ? it->second : buckets_.size() - 1;
+}
+
+void ConfirmationStats::ClearCurrent(unsigned int nBlockHeight)
+{
+    std::vector<int>& entered = unconfTxs_[nBlockHeight % unconfTxs_.size()];
+    for (unsigned int j = 0; j < buckets_.size(); j++) {
+        oldUnconfTxs_[j] += entered[j];
+        entered[j] = 0;
+        for (unsigned int i = 0; i < curBlockConf_.size(); i++)
+            curBlockConf_[i][j] = 0;
+        curBlockTxCt_[j] = 0;
+        curBlockVal_[j] = 0;
+    }
+}
+
+unsigned int ConfirmationStats::NewTx(unsigned int nBlockHeight, double value)
+{
+    const unsigned int bucketIndex = FindBucket(value);
+    unconfTxs_[nBlockHeight % unconfTxs_.size()][bucketIndex]++;
+    return bucketIndex;
+}
+
+void ConfirmationStats::RemoveTx(unsigned int nEntryHeight, unsigned int nBestSeenHeight, unsigned int bucketIndex)
+{
+    // A transaction that entered a target's worth of blocks ago has moved on to the old
+    const int blocksAgo = nBestSeenHeight >= nEntryHeight ? nBestSeenHeight - nEntryHeight : 0;
+    int& count = blocksAgo >= (int)unconfTxs_.size() ? oldUnconfTxs_[bucketIndex] : unconfTxs_[nEntryHeight % unconfTxs_.size()][bucketIndex];
+    if (count > 0)
+        count--;
+}
+
+void ConfirmationStats::Record(int blocksToConfirm, double value)
+{
+    if (blocksToConfirm < 1)
+        return;
+    const unsigned int bucketIndex = FindBucket(value);
+    for (unsigned int i = blocksToConfirm - 1; i < curBlockConf_.size(); i++)
+        curBlockConf_[i][bucketIndex]++;
+    curBlockTxCt_[bucketIndex]++;
+    curBlockVal_[bucketIndex] += value;
+}
+
+void ConfirmationStats::UpdateMovingAverages()
+{
+    for (unsigned int j = 0; j < buckets_.size(); j++) {
+        for (unsigned int i = 0; i < confAvg_.size(); i++)
+            confAvg_[i][j] = confAvg_[i][j] * decay_ + curBlockConf_[i][j];
+        avg_[j] = avg_[j] * decay_ + curBlockVal_[j];
+        txCtAvg_[j] = txCtAvg_[j] * decay_ + curBlockTxCt_[j];
+    }
+}
+
+double ConfirmationStats::EstimateMedianVal(int confTarget, double sufficientTxVal, double successBreakPoint, unsigned int nBlockHeight) const
+{
+    // Counters for the range of buckets being looked at
+    double nConf = 0;
+    double totalNum = 0;
+    int extraNum = 0;
+
+    const int maxBucketIndex = buckets_.size() - 1;
+    int curNearBucket = maxBucketIndex;
+    int bestNearBucket = maxBucketIndex;
+    int curFarBucket = maxBucketIndex;
+    int bestFarBucket = maxBucketIndex;
+    bool foundAnswer = false;
+    const unsigned int bins = unconfTxs_.size();
+
+    // Walk from the most favourable bucket down, growing the range until it
+    // holds enough transactions to judge, then starting the next one
+    for (int bucket = maxBucketIndex; bucket >= 0; bucket--) {
+        curFarBucket = bucket;
+        nConf += confAvg_[confTarget - 1][bucket];
+        totalNum += txCtAvg_[bucket];
+        // Transactions still waiting after the target count against it
+        for (unsigned int confct = confTarget; confct < bins && confct <= nBlockHeight; confct++)
+            extraNum += unconfTxs_[(nBlockHeight - confct) % bins][bucket];
+        extraNum += oldUnconfTxs_[bucket];
+
+        if (totalNum >= sufficientTxVal / (1 - decay_)) {
+            const double curPct = nConf / (totalNum + extraNum);
+            if (curPct < successBreakPoint)
+                break;
+            foundAnswer = true;
+            nConf = 0;
+            totalNum = 0;
+            extraNum = 0;
+            bestNearBucket = curNearBucket;
+            bestFarBucket = curFarBucket;
+            curNearBucket = bucket - 1;
+        }
+    }
+
+    double median = -1;
+    double txSum = 0;
+    for (int j = bestFarBucket; j <= bestNearBucket; j++)
+        txSum += txCtAvg_[j];
+    if (foundAnswer && txSum != 0) {
+        txSum = txSum / 2;
+        for (int j = bestFarBucket; j <= bestNearBucket; j++) {
+            if (txCtAvg_[j] < txSum) {
+                txSum -= txCtAvg_[j];
+            } else {
+                median = avg_[j] / txCtAvg_[j];
+                break;
+            }
+        }
+    }
+    return median;
+}
+
+void ConfirmationStats::Write(CAutoFile& fileout) const
+{
+    fileout << decay_;
+    fileout << buckets_;
+    fileout << avg_;
+    fileout << txCtAvg_;
+    fileout << confAvg_;
+}
+
+void ConfirmationStats::Read(CAutoFile& filein)
+{
+    double fileDecay;
+    std::vector<double> fileBuckets;
+    std::vector<double> fileAvg;
+    std::vector<double> fileTxCtAvg;
+    std::vector<std::vector<double> > fileConfAvg;
+    filein >> fileDecay >> fileBuckets >> fileAvg >> fileTxCtAvg >> fileConfAvg;
+
+    if (fileDecay <= 0 || fileDecay >= 1)
+        throw std::runtime_error("Corrupt estimates file. Decay must be between 0 and 1 (non-inclusive)");
+    const unsigned int nBuckets = fileBuckets.size();
+    if (nBuckets <= 1 || nBuckets > 1000)
+        throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 fee/pri buckets");
+    for (unsigned int i = 1; i < nBuckets; i++) {
+        if (!(fileBuckets[i - 1] < fileBuckets[i]))
+            throw std::runtime_error("Corrupt estimates file. Buckets must be in increasing order");
+    }
+    if (fileAvg.size() != nBuckets || fileTxCtAvg.size() != nBuckets)
+        throw std::runtime_error("Corrupt estimates file. Mismatch in fee/pri average bucket count");
+    const unsigned int nMaxConfirms = fileConfAvg.size();
+    if (nMaxConfirms <= 0 || nMaxConfirms > 6 * 24 * 7)
+        throw std::runtime_error("Corrupt estimates file. Must maintain estimates for between 1 and 1008 (one week) confirms");
+    for (unsigned int i = 0; i < nMaxConfirms; i++) {
+        if (fileConfAvg[i].size() != nBuckets)
+            throw std::runtime_error("Corrupt estimates file. Mismatch in fee/pri conf average bucket count");
+    }
+
+    decay_ = fileDecay;
+    buckets_ = fileBuckets;
+    Resize(nMaxConfirms);
+    avg_ = fileAvg;
+    txCtAvg_ = fileTxCtAvg;
+    confAvg_ = fileConfAvg;
+
+    LogPrint(LOG_ESTIMATEFEE, "Reading estimates: %u buckets counting confirms up to %u blocks\n", nBuckets, nMaxConfirms);
+}
@@ -0,0 +1,75 @@
+#ifndef CONFIRMATION_STATS_H
+#define CONFIRMATION_STATS_H
+#include <streams.h>
+
+#include <map>
+#include <vector>
+
+/**
+ * How quickly transactions confirmed, tracked per bucket of some value that
+ * decides their chances, such as their fee rate.
+ *
+ * Every transaction seen entering the pool is counted as unconfirmed in its
+ * bucket, under the height at which it came in. Once it confirms, it adds to
+ * the counts of every target of at least as many blocks as it took. All counts
+ * decay a little with every block, so that old blocks fade away rather than
+ * drop out of a window, and the work per block depends on the number of
+ * buckets and targets only.
+ */
+class ConfirmationStats
+{
+private:
+    //! Upper bound of each bucket, the last being infinite
+    std::vector<double> buckets_;
+    std::map<double, unsigned int> bucketMap_;
+
+    //! Decayed count of confirmed transactions per bucket, and the sum of their values
+    std::vector<double> txCtAvg_;
+    std::vector<double> avg_;
+    //! Decayed count per target and bucket of transactions confirmed within target + 1 blocks
+    std::vector<std::vector<double> > confAvg_;
+
+    //! What the block being recorded adds to the above
+    std::vector<double> curBlockTxCt_;
+    std::vector<double> curBlockVal_;
+    std::vector<std::vector<int> > curBlockConf_;
+
+    //! Unconfirmed transactions per entry height, modulo the targets, and per bucket
+    std::vector<std::vector<int> > unconfTxs_;
+    //! Unconfirmed transactions that have been waiting longer than the largest target
+    std::vector<int> oldUnconfTxs_;
+
+    double decay_;
+
+    void Resize(unsigned int nMaxConfirms);
+
+public:
+    ConfirmationStats(const std::vector<double>& buckets, unsigned int nMaxConfirms, double decay);
+
+    unsigned int GetMaxConfirms() const { return confAvg_.size(); }
+    unsigned int FindBucket(double value) const;
+
+    //! Start a new block, moving what entered a target's worth of blocks ago to the old
+    void ClearCurrent(unsigned int nBlockHeight);
+    //! The transaction entered the pool, returning its bucket
+    unsigned int NewTx(unsigned int nBlockHeight, double value);
+    //! The transaction left the pool having entered it at the height
+    void RemoveTx(unsigned int nEntryHeight, unsigned int nBestSeenHeight, unsigned int bucketIndex);
+    //! A transaction of the value confirmed in the block being recorded
+    void Record(int blocksToConfirm, double value);
+    //! Fold the block being recorded into the decayed counts
+    void UpdateMovingAverages();
+
+    /**
+     * The median value of the transactions in the nearest range of buckets,
+     * walking from the most favourable, of which at least successBreakPoint
+     * confirmed within confTarget blocks, or -1 if there is no such range
+     * backed by enough transactions.
+     */
+    double EstimateMedianVal(int confTarget, double sufficientTxVal, double successBreakPoint, unsigned int nBlockHeight) const;
+
+    void Write(CAutoFile& fileout) const;
+    //! Replace the decayed counts with those of the file, throwing if they are not sane
+    void Read(CAutoFile& filein);
+};
+#endif// CONFIRMATION_STATS_H
@@ -0,0 +1,231 @@
+#ifndef CUCKOO_CACHE_H
+#define CUCKOO_CACHE_H
+#include <memusage.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+/**
+ * One flag per slot of a CuckooCache, packed eight to a byte. The flags are
+ * atomic so that readers holding only a shared lock can mark a slot as free
+ * to be overwritten.
+ */
+class AtomicBitFlags
+{
+private:
+    std::unique_ptr<std::atomic<uint8_t>[]> bytes_;
+
+public:
+    //! All the flags start out set
+    explicit AtomicBitFlags(uint32_t numberOfFlags)
+    {
+        const uint32_t numberOfBytes = (numberOfFlags + 7) / 8;
+        bytes_.reset(new std::atomic<uint8_t>[numberOfBytes]);
+        for (uint32_t i = 0; i < numberOfBytes; ++i)
+            bytes_[i].store(0xFF);
+    }
+
+    //! Replaces the flags with a new, all set, collection
+    void Reset(uint32_t numberOfFlags)
+    {
+        AtomicBitFlags flags(numberOfFlags);
+        std::swap(bytes_, flags.bytes_);
+    }
+
+    void Set(uint32_t index)
+    {
+        bytes_[index >> 3].fetch_or((uint8_t)(1 << (index & 7)), std::memory_order_relaxed);
+    }
+
+    void Unset(uint32_t index)
+    {
+        bytes_[index >> 3].fetch_and((uint8_t)~(1 << (index & 7)), std::memory_order_relaxed);
+    }
+
+    bool IsSet(uint32_t index) const
+    {
+        return (1 << (index & 7)) & bytes_[index >> 3].load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * A fixed size set of elements stored in a cuckoo hash table.
+ *
+ * Each element has eight candidate slots, picked by Hash(element, n) for n in
+ * 0..7; Hash must spread its results uniformly over uint32_t, which is the case
+ * when the elements are themselves salted hashes. An insert takes the first free
+ * candidate slot, or evicts the element in one of them, which is then moved to
+ * one of its own other slots, up to log2(size) times before the last evicted
+ * element is dropped.
+ *
+ * Lookups only read the table, so they may run concurrently with each other
+ * under a shared lock; Insert needs the lock exclusively. A lookup may mark the
+ * element it found as erasable, which only flips an atomic flag.
+ *
+ * Elements that are erasable are overwritten first. On top of that, elements
+ * are aged in two generations: once enough of the current generation has been
+ * used up, the previous one becomes erasable, so a full table keeps the most
+ * recent inserts.
+ */
+template <typename Element, typename Hash>
+class CuckooCache
+{
+private:
+    std::vector<Element> table_;
+    uint32_t size_;
+    //! Whether a slot may be overwritten
+    mutable AtomicBitFlags erasable_;
+    //! Which generation the element in a slot belongs to
+    std::vector<bool> generation_;
+    //! Inserts left before the generations are checked again
+    uint32_t generationCheckCountdown_;
+    //! Number of live elements of the current generation that start a new one
+    uint32_t generationSize_;
+    uint8_t depthLimit_;
+    const Hash hash_;
+
+    //! Maps the eight hashes of an element onto slots
+    void ComputeSlots(const Element& element, uint32_t* slots) const
+    {
+        for (uint32_t n = 0; n < 8; ++n)
+            slots[n] = (uint32_t)(((uint64_t)hash_(element, n) * (uint64_t)size_) >> 32);
+    }
+
+    static uint32_t InvalidSlot()
+    {
+        return ~(uint32_t)0;
+    }
+
+    void CheckGenerations()
+    {
+        if (generationCheckCountdown_ != 0) {
+            --generationCheckCountdown_;
+            return;
+        }
+        uint32_t liveInCurrentGeneration = 0;
+        for (uint32_t i = 0; i < size_; ++i)
+            liveInCurrentGeneration += generation_[i] && !erasable_.IsSet(i);
+        if (liveInCurrentGeneration >= generationSize_) {
+            for (uint32_t i = 0; i < size_; ++i) {
+                if (generation_[i])
+                    generation_[i] = false;
+                else
+                    erasable_.Set(i);
+            }
+            generationCheckCountdown_ = generationSize_;
+        } else {
+            // Another generation cannot start before this many inserts
+            generationCheckCountdown_ = std::max(1u, std::max(generationSize_ / 16,
+                generationSize_ - std::min(generationSize_, liveInCurrentGeneration)));
+        }
+    }
+
+public:
+    CuckooCache(
+        ): table_()
+        , size_(0)
+        , erasable_(0)
+        , generation_()
+        , generationCheckCountdown_(0)
+        , generationSize_(0)
+        , depthLimit_(0)
+        , hash_()
+    {
+    }
+
+    /** Resizes the table to hold numberOfElements, dropping what it held. Returns the actual size. */
+    uint32_t Setup(uint32_t numberOfElements)
+    {
+        size_ = std::max<uint32_t>(2, numberOfElements);
+        depthLimit_ = static_cast<uint8_t>(std::log2(static_cast<float>(size_)));
+        table_.assign(size_, Element());
+        erasable_.Reset(size_);
+        generation_.assign(size_, false);
+        generationSize_ = std::max<uint32_t>(1, (45 * size_) / 100);
+        generationCheckCountdown_ = generationSize_;
+        return size_;
+    }
+
+    /** Resizes the table to the number of elements fitting in the given number of bytes. */
+    uint32_t SetupBytes(size_t bytes)
+    {
+        return Setup(static_cast<uint32_t>(std::min<size_t>(bytes / sizeof(Element), InvalidSlot())));
+    }
+
+    void Insert(Element element)
+    {
+        CheckGenerations();
+        uint32_t slots[8];
+        ComputeSlots(element, slots);
+        for (uint32_t n = 0; n < 8; ++n) {
+            if (table_[slots[n]] == element) {
+                erasable_.Unset(slots[n]);
+                generation_[slots[n]] = true;
+                return;
+            }
+        }
+
+        uint32_t lastSlot = InvalidSlot();
+        bool lastGeneration = true;
+        for (uint8_t depth = 0; depth < depthLimit_; ++depth) {
+            for (uint32_t n = 0; n < 8; ++n) {
+                if (!erasable_.IsSet(slots[n]))
+                    continue;
+                table_[slots[n]] = std::move(element);
+                erasable_.Unset(slots[n]);
+                generation_[slots[n]] = lastGeneration;
+                return;
+            }
+            // Evict from the candidate after the slot the element was evicted
+            // from, so that two elements do not keep swapping the same slot.
+            const uint32_t* const lastCandidate = std::find(slots, slots + 8, lastSlot);
+            lastSlot = slots[(1 + (lastCandidate - slots)) & 7];
+            std::swap(table_[lastSlot], element);
+            const bool generation = lastGeneration;
+            lastGeneration = generation_[lastSlot];
+            generation_[lastSlot] = generation;
+            ComputeSlots(element, slots);
+        }
+    }
+
+    /** The memory the table and its flags take up, which only Setup changes. */
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(table_) + 2 * memusage::MallocUsage((size_ + 7) / 8);
+    }
+
+    /** Whether the element is held; if erase is set, a found element becomes erasable. */
+    bool Contains(const Element& element, bool erase) const
+    {
+        uint32_t slots[8];
+        ComputeSlots(element, slots);
+        for (uint32_t n = 0; n < 8; ++n) {
+            if (table_[slots[n]] == element) {
+                if (erase)
+                    erasable_.Set(slots[n]);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/** The Hash for CuckooCaches of salted hashes, whose bytes are already uniform: the eight 32 bit words of the entry */
+class SaltedHashHasher
+{
+public:
+    uint32_t operator()(const uint256& entry, uint32_t n) const
+    {
+        uint32_t value;
+        memcpy(&value, entry.begin() + 4 * n, 4);
+        return value;
+    }
+};
+#endif// CUCKOO_CACHE_H
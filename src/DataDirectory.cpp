@@ -84,6 +84,7 @@ boost::filesystem::path GetDefaultDataDir()
 
 static boost::filesystem::path pathCached;
 static boost::filesystem::path pathCachedNetSpecific;
+static boost::filesystem::path pathCachedBlocks;
 static CCriticalSection csPathCached;
 
 const boost::filesystem::path& GetDataDir(bool fNetSpecific)
@@ -117,8 +118,36 @@ const boost::filesystem::path& GetDataDir(bool fNetSpecific)
     return path;
 }
 
+const boost::filesystem::path& GetBlocksDir()
+{
+    namespace fs = boost::filesystem;
+
+    LOCK(csPathCached);
+
+    fs::path& path = pathCachedBlocks;
+    if (!path.empty())
+        return path;
+
+    if (settings.ParameterIsSet("-blocksdir")) {
+        path = fs::system_complete(settings.GetArg("-blocksdir", ""));
+        if (!fs::is_directory(path)) {
+            path = "";
+            return path;
+        }
+        path /= BaseParams().DataDir();
+    } else {
+        path = GetDataDir();
+    }
+    path /= "blocks";
+
+    fs::create_directories(path);
+
+    return path;
+}
+
 void ClearDatadirCache()
 {
     pathCached = boost::filesystem::path();
     pathCachedNetSpecific = boost::filesystem::path();
+    pathCachedBlocks = boost::filesystem::path();
 }
\ No newline at end of file
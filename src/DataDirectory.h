@@ -11,6 +11,8 @@
 
 boost::filesystem::path GetDefaultDataDir();
 const boost::filesystem::path& GetDataDir(bool fNetSpecific = true);
+//! Where the blk and rev files go: the network's directory under -blocksdir, or else the data directory, followed by blocks; empty if -blocksdir is no directory
+const boost::filesystem::path& GetBlocksDir();
 void ClearDatadirCache();
 
 bool TryCreateDirectory(const boost::filesystem::path& p);
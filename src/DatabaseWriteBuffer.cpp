@@ -0,0 +1,31 @@
+#include <DatabaseWriteBuffer.h>
+
+DatabaseWriteBuffer::DatabaseWriteBuffer(
+    ): writes_()
+{
+}
+
+void DatabaseWriteBuffer::Write(const CSerializeData& key, const CSerializeData& value)
+{
+    std::pair<bool, CSerializeData>& write = writes_[key];
+    write.first = false;
+    write.second = value;
+}
+
+void DatabaseWriteBuffer::Erase(const CSerializeData& key)
+{
+    std::pair<bool, CSerializeData>& write = writes_[key];
+    write.first = true;
+    write.second.clear();
+}
+
+DatabaseWriteBuffer::LookupResult DatabaseWriteBuffer::Lookup(const CSerializeData& key, CSerializeData& value) const
+{
+    BufferedWrites::const_iterator it = writes_.find(key);
+    if (it == writes_.end())
+        return NOT_BUFFERED;
+    if (it->second.first)
+        return BUFFERED_ERASE;
+    value = it->second.second;
+    return BUFFERED_WRITE;
+}
@@ -0,0 +1,44 @@
+#ifndef DATABASE_WRITE_BUFFER_H
+#define DATABASE_WRITE_BUFFER_H
+#include <allocators.h>
+
+#include <stddef.h>
+#include <map>
+#include <utility>
+
+/**
+ * Serialized writes to a database held back so they can go to disk together,
+ * where the last write or erasure of a key takes the place of the earlier
+ * ones. Erasures are kept as well, so a lookup tells a key erased in the
+ * buffer from one the buffer knows nothing of.
+ */
+class DatabaseWriteBuffer
+{
+public:
+    enum LookupResult {
+        NOT_BUFFERED,
+        BUFFERED_WRITE,
+        BUFFERED_ERASE
+    };
+
+    //! Whether the key is erased, and its value if not
+    typedef std::map<CSerializeData, std::pair<bool, CSerializeData> > BufferedWrites;
+
+private:
+    BufferedWrites writes_;
+
+public:
+    DatabaseWriteBuffer();
+
+    void Write(const CSerializeData& key, const CSerializeData& value);
+    void Erase(const CSerializeData& key);
+    LookupResult Lookup(const CSerializeData& key, CSerializeData& value) const;
+
+    BufferedWrites::const_iterator begin() const { return writes_.begin(); }
+    BufferedWrites::const_iterator end() const { return writes_.end(); }
+    size_t size() const { return writes_.size(); }
+    bool empty() const { return writes_.empty(); }
+    void clear() { writes_.clear(); }
+    void swap(DatabaseWriteBuffer& other) { writes_.swap(other.writes_); }
+};
+#endif// DATABASE_WRITE_BUFFER_H
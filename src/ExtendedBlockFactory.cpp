@@ -10,8 +10,9 @@ ExtendedBlockFactory::ExtendedBlockFactory(
     I_PoSTransactionCreator& coinstakeCreator,
     const Settings& settings,
     const CChain& chain,
-    const CChainParams& chainParameters
-    ): blockFactory_(new BlockFactory(blockTransactionCollector,coinstakeCreator, settings, chain,chainParameters))
+    const CChainParams& chainParameters,
+    StakingStatistics& stakingStatistics
+    ): blockFactory_(new BlockFactory(blockTransactionCollector,coinstakeCreator, settings, chain,chainParameters,stakingStatistics))
     , extraTransactions_()
     , customCoinstake_()
 {
@@ -15,6 +15,7 @@ class CReserveKey;
 class I_BlockTransactionCollector;
 class I_PoSTransactionCreator;
 class Settings;
+class StakingStatistics;
 
 class ExtendedBlockFactory : public I_BlockFactory
 {
@@ -29,7 +30,8 @@ public:
         I_PoSTransactionCreator& coinstakeCreator,
         const Settings& settings,
         const CChain& chain,
-        const CChainParams& chainParameters);
+        const CChainParams& chainParameters,
+        StakingStatistics& stakingStatistics);
     ~ExtendedBlockFactory();
 
     CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reserveKey, bool fProofOfStake) override;
@@ -0,0 +1,75 @@
+#include <FilterableBlock.h>
+
+#include <merkleblock.h>
+#include <script/script.h>
+#include <script/standard.h>
+
+namespace
+{
+/** The data pushed by the script, as far as it parses */
+FilterableTransaction::DataElements ExtractDataElements(const CScript& script)
+{
+    FilterableTransaction::DataElements dataElements;
+    CScript::const_iterator pc = script.begin();
+    std::vector<unsigned char> data;
+    while (pc < script.end()) {
+        opcodetype opcode;
+        if (!script.GetOp(pc, opcode, data))
+            break;
+        if (data.size() != 0)
+            dataElements.push_back(data);
+    }
+    return dataElements;
+}
+}
+
+FilterableTransaction::FilterableTransaction(
+    const CTransaction& tx
+    ): hash(tx.GetHash())
+    , outputs(tx.vout.size())
+    , inputs(tx.vin.size())
+{
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        outputs[i].dataElements = ExtractDataElements(tx.vout[i].scriptPubKey);
+        txnouttype type;
+        std::vector<std::vector<unsigned char> > vSolutions;
+        outputs[i].isPayToPubkeyOrMultisig =
+            ExtractScriptPubKeyFormat(tx.vout[i].scriptPubKey, type, vSolutions) &&
+            (type == TX_PUBKEY || type == TX_MULTISIG);
+    }
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        inputs[i].prevout = tx.vin[i].prevout;
+        inputs[i].dataElements = ExtractDataElements(tx.vin[i].scriptSig);
+    }
+}
+
+FilterableBlock::FilterableBlock(
+    const CBlock& block
+    ): header_(block.GetBlockHeader())
+    , transactions_()
+    , merkleTreeLevels_()
+{
+    std::vector<uint256> hashes;
+    transactions_.reserve(block.vtx.size());
+    hashes.reserve(block.vtx.size());
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        transactions_.push_back(FilterableTransaction(block.vtx[i]));
+        hashes.push_back(transactions_.back().hash);
+    }
+    merkleTreeLevels_ = CPartialMerkleTree::CalcTreeLevels(hashes);
+}
+
+const CBlockHeader& FilterableBlock::GetHeader() const
+{
+    return header_;
+}
+
+const std::vector<FilterableTransaction>& FilterableBlock::GetTransactions() const
+{
+    return transactions_;
+}
+
+const std::vector<std::vector<uint256> >& FilterableBlock::GetMerkleTreeLevels() const
+{
+    return merkleTreeLevels_;
+}
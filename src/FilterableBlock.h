@@ -0,0 +1,54 @@
+#ifndef FILTERABLE_BLOCK_H
+#define FILTERABLE_BLOCK_H
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <vector>
+
+/** The parts of a transaction a bloom filter is matched against, picked out of its scripts once */
+struct FilterableTransaction {
+    typedef std::vector<std::vector<unsigned char> > DataElements;
+
+    struct Output {
+        DataElements dataElements;
+        //! Whether BLOOM_UPDATE_P2PUBKEY_ONLY filters add the output once it matches
+        bool isPayToPubkeyOrMultisig;
+    };
+
+    struct Input {
+        COutPoint prevout;
+        DataElements dataElements;
+    };
+
+    uint256 hash;
+    std::vector<Output> outputs;
+    std::vector<Input> inputs;
+
+    explicit FilterableTransaction(const CTransaction& tx);
+};
+
+/**
+ * A block prepared for filtering against the bloom filters of many SPV peers.
+ *
+ * Building a CMerkleBlock straight from a CBlock parses every script and
+ * hashes the merkle tree over again for each peer; this does both once, so
+ * each of the peers asking for the block only costs the filter lookups and
+ * walking the partial tree.
+ */
+class FilterableBlock
+{
+private:
+    CBlockHeader header_;
+    std::vector<FilterableTransaction> transactions_;
+    //! The merkle tree by height, starting with the transaction hashes
+    std::vector<std::vector<uint256> > merkleTreeLevels_;
+
+public:
+    explicit FilterableBlock(const CBlock& block);
+
+    const CBlockHeader& GetHeader() const;
+    const std::vector<FilterableTransaction>& GetTransactions() const;
+    const std::vector<std::vector<uint256> >& GetMerkleTreeLevels() const;
+};
+#endif// FILTERABLE_BLOCK_H
@@ -7,7 +7,7 @@
 #include "chain.h"
 #include "primitives/block.h"
 
-#include <unordered_map>
+#include <cassert>
 
 #include <Settings.h>
 #include <set>
@@ -21,31 +21,43 @@ const std::set<Fork> manualOverrides = {};
  * For forks that get activated at a certain block time, the associated
  * activation times.
  */
-const std::unordered_map<Fork, int64_t,std::hash<int>> ACTIVATION_TIMES = {
-  {Fork::TestByTimestamp, 1000000000},
-  {Fork::HardenedStakeModifier, unixTimestampForDec31stMidnight},
-  {Fork::UniformLotteryWinners, unixTimestampForDec31stMidnight},
+const int64_t ACTIVATION_TIMES[Fork::NUMBER_OF_FORKS] = {
+  /* TestByTimestamp */ 1000000000,
+  /* HardenedStakeModifier */ unixTimestampForDec31stMidnight,
+  /* UniformLotteryWinners */ unixTimestampForDec31stMidnight,
 };
+static_assert(Fork::NUMBER_OF_FORKS <= 32, "the active forks have to fit a 32 bit mask");
 
 } // anonymous namespace
 
 ActivationState::ActivationState(const CBlockIndex* pi)
-  : nTime(pi->nTime)
+  : nTime(pi->nTime), activeForks(ComputeActiveForks(nTime))
 {}
 
 ActivationState::ActivationState(const CBlockHeader& block)
-  : nTime(block.nTime)
+  : nTime(block.nTime), activeForks(ComputeActiveForks(nTime))
 {}
 
-bool ActivationState::IsActive(const Fork f) const
+uint32_t ActivationState::ComputeActiveForks(const int64_t nTime)
 {
+  /* The manual override is only looked up for the forks that allow one,
+     so that the common case is a few comparisons per block.  */
   constexpr char manualForkSettingLookup[] = "-manual_fork";
-  if(settings.ParameterIsSet(manualForkSettingLookup) && manualOverrides.count(f)>0)
+  const bool manualOverride = !manualOverrides.empty() && settings.ParameterIsSet(manualForkSettingLookup);
+  const int64_t timestampOverride = manualOverride ? settings.GetArg(manualForkSettingLookup,0) : 0;
+
+  uint32_t active = 0;
+  for (int f = 0; f < Fork::NUMBER_OF_FORKS; ++f)
   {
-    const int64_t timestampOverride = settings.GetArg(manualForkSettingLookup,0);
-    return nTime >= timestampOverride;
+    const bool overridden = manualOverride && manualOverrides.count(static_cast<Fork>(f)) > 0;
+    if (nTime >= (overridden ? timestampOverride : ACTIVATION_TIMES[f]))
+      active |= uint32_t(1) << f;
   }
-  const auto mit = ACTIVATION_TIMES.find(f);
-  assert(mit != ACTIVATION_TIMES.end());
-  return nTime >= mit->second;
+  return active;
+}
+
+bool ActivationState::IsActive(const Fork f) const
+{
+  assert(f >= 0 && f < Fork::NUMBER_OF_FORKS);
+  return (activeForks >> f) & 1;
 }
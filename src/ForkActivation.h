@@ -22,6 +22,9 @@ enum Fork
   TestByTimestamp,
   HardenedStakeModifier,
   UniformLotteryWinners,
+
+  /* The number of forks above, not a fork itself.  */
+  NUMBER_OF_FORKS,
 };
 
 /**
@@ -37,6 +40,11 @@ private:
   /** The timestamp of the block this is associated to.  */
   const int64_t nTime;
 
+  /** One bit per fork, set if it is active for the block.  */
+  const uint32_t activeForks;
+
+  static uint32_t ComputeActiveForks(int64_t nTime);
+
 public:
 
   explicit ActivationState(const CBlockIndex* pi);
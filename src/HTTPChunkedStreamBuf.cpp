@@ -0,0 +1,76 @@
+#include <HTTPChunkedStreamBuf.h>
+
+#include <algorithm>
+#include <cstring>
+#include <tinyformat.h>
+
+HTTPChunkedStreamBuf::HTTPChunkedStreamBuf(
+    std::ostream& out,
+    size_t chunkSize
+    ): out_(out)
+    , buffer_(chunkSize > 0 ? chunkSize : 1)
+    , finished_(false)
+{
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+}
+
+HTTPChunkedStreamBuf::~HTTPChunkedStreamBuf()
+{
+    Finish();
+}
+
+bool HTTPChunkedStreamBuf::WriteChunk()
+{
+    const std::ptrdiff_t size = pptr() - pbase();
+    if (size > 0) {
+        out_ << strprintf("%x\r\n", size);
+        out_.write(pbase(), size);
+        out_ << "\r\n";
+    }
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+    return out_.good();
+}
+
+HTTPChunkedStreamBuf::int_type HTTPChunkedStreamBuf::overflow(int_type ch)
+{
+    if (finished_ || !WriteChunk())
+        return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize HTTPChunkedStreamBuf::xsputn(const char* data, std::streamsize count)
+{
+    std::streamsize written = 0;
+    while (written < count) {
+        if (pptr() == epptr() && traits_type::eq_int_type(overflow(traits_type::eof()), traits_type::eof()))
+            break;
+        const std::streamsize part = std::min<std::streamsize>(count - written, epptr() - pptr());
+        std::memcpy(pptr(), data + written, part);
+        pbump(static_cast<int>(part));
+        written += part;
+    }
+    return written;
+}
+
+int HTTPChunkedStreamBuf::sync()
+{
+    if (finished_ || !WriteChunk())
+        return -1;
+    out_.flush();
+    return out_.good() ? 0 : -1;
+}
+
+bool HTTPChunkedStreamBuf::Finish()
+{
+    if (finished_)
+        return out_.good();
+    WriteChunk();
+    finished_ = true;
+    out_ << "0\r\n\r\n";
+    out_.flush();
+    return out_.good();
+}
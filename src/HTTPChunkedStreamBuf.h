@@ -0,0 +1,38 @@
+#ifndef HTTP_CHUNKED_STREAM_BUF_H
+#define HTTP_CHUNKED_STREAM_BUF_H
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/**
+ * Writes what is put into it to another stream as the chunks of an HTTP/1.1
+ * body with chunked transfer encoding.
+ *
+ * A large reply can so go out while it is still being written, without first
+ * being collected into a string to know its length. Finish writes the last,
+ * empty chunk that ends the body.
+ */
+class HTTPChunkedStreamBuf : public std::streambuf
+{
+private:
+    std::ostream& out_;
+    std::vector<char> buffer_;
+    bool finished_;
+
+    bool WriteChunk();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit HTTPChunkedStreamBuf(std::ostream& out, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    ~HTTPChunkedStreamBuf();
+
+    //! Ends the body, and whether all of it could be written
+    bool Finish();
+};
+#endif// HTTP_CHUNKED_STREAM_BUF_H
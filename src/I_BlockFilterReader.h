@@ -0,0 +1,12 @@
+#ifndef I_BLOCK_FILTER_READER_H
+#define I_BLOCK_FILTER_READER_H
+class BlockFilter;
+class CBlockIndex;
+class I_BlockFilterReader
+{
+public:
+    virtual ~I_BlockFilterReader(){}
+    //! False when there is no filter for the block
+    virtual bool ReadBlockFilter(const CBlockIndex* blockIndex, BlockFilter& filter) const = 0;
+};
+#endif// I_BLOCK_FILTER_READER_H
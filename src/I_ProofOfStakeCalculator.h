@@ -9,5 +9,23 @@ public:
         unsigned int hashproofTimestamp,
         uint256& computedProofOfStake,
         bool checkOnly) const = 0;
+
+    /**
+     * Try numberOfTimestamps timestamps from hashproofTimestamp down, stopping at the first
+     * whose proof meets the target. hashproofTimestamp is left at that timestamp, or one past
+     * the last tried if none did.
+     */
+    virtual bool computeProofOfStakeAmongTimestamps(
+        unsigned int& hashproofTimestamp,
+        unsigned numberOfTimestamps,
+        uint256& computedProofOfStake) const
+    {
+        for (unsigned i = 0; i < numberOfTimestamps; i++, --hashproofTimestamp)
+        {
+            if (computeProofOfStakeAndCheckItMeetsTarget(hashproofTimestamp, computedProofOfStake, false))
+                return true;
+        }
+        return false;
+    }
 };
 #endif// I_PROOF_OF_STAKE_CALCULATOR_H
\ No newline at end of file
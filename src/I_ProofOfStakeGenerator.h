@@ -13,7 +13,7 @@ class HashproofCreationResult
 {
 private:
     HashproofCreationResult(unsigned timestamp, HashproofGenerationState status);
-    const unsigned hashproofTimestamp_;
+    unsigned hashproofTimestamp_;
     HashproofGenerationState state_;
 public:
     static HashproofCreationResult Success(unsigned timestamp);
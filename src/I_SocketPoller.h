@@ -0,0 +1,54 @@
+#ifndef I_SOCKET_POLLER_H
+#define I_SOCKET_POLLER_H
+#include <compat.h>
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+/**
+ * Waits for the network sockets to be ready for receiving or sending.
+ *
+ * The sockets to wait on are handed over as a whole before each wait, but a
+ * poller only passes on to the operating system the sockets whose interest
+ * changed since the last time. Readiness is level-triggered: a socket that is
+ * not fully drained is reported again on the next wait.
+ */
+class I_SocketPoller
+{
+public:
+    enum Interest {
+        //! Errors and hang-ups are reported whenever the poller can detect them
+        POLL_ERRORS = 0,
+        POLL_RECEIVE = 1 << 0,
+        POLL_SEND = 1 << 1
+    };
+
+    struct PolledSocket {
+        SOCKET socket;
+        //! Who holds the socket, so a descriptor that was closed and reused is polled afresh
+        int64_t owner;
+        unsigned interest;
+
+        PolledSocket(SOCKET socketIn, int64_t ownerIn, unsigned interestIn);
+    };
+
+    struct SocketEvents {
+        bool receive;
+        bool send;
+        bool error;
+
+        SocketEvents();
+    };
+    typedef std::map<SOCKET, SocketEvents> ReadySockets;
+
+    virtual ~I_SocketPoller(){}
+
+    //! Whether the socket can be polled at all, so it can be turned away otherwise
+    virtual bool CanPoll(SOCKET socket) const = 0;
+    //! Sets the sockets the following waits are for
+    virtual void Update(const std::vector<PolledSocket>& sockets) = 0;
+    //! Waits up to the timeout for sockets to be ready, false if polling failed
+    virtual bool Wait(int timeoutMilliseconds, ReadySockets& readySockets) = 0;
+};
+#endif// I_SOCKET_POLLER_H
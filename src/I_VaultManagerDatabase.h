@@ -1,6 +1,7 @@
 #ifndef I_VAULT_MANAGER_DATABASE_H
 #define I_VAULT_MANAGER_DATABASE_H
 #include <map>
+#include <vector>
 class CWalletTx;
 class CScript;
 using ManagedScripts = std::map<CScript,unsigned>;
@@ -10,6 +11,17 @@ public:
     virtual ~I_VaultManagerDatabase(){}
     virtual bool WriteTx(const CWalletTx& walletTransaction) = 0;
     virtual bool ReadTx(const uint64_t txIndex, CWalletTx& walletTransaction) = 0;
+    /**
+     * Append up to maxCount transactions in index order, starting at firstTxIndex,
+     * each read into a copy of emptyTransaction so that it refers to the same chain.
+     * Meant to be served by a single pass of a cursor rather than a lookup per index.
+     * @return how many were appended, none once past the last transaction
+     */
+    virtual unsigned ReadTxs(
+        const uint64_t firstTxIndex,
+        const unsigned maxCount,
+        const CWalletTx& emptyTransaction,
+        std::vector<CWalletTx>& walletTransactions) = 0;
     virtual bool WriteManagedScripts(const ManagedScripts& managedScripts) = 0;
     virtual bool ReadManagedScripts(ManagedScripts& managedScripts) = 0;
 };
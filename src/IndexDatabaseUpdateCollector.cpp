@@ -2,14 +2,30 @@
 
 #include <IndexDatabaseUpdates.h>
 #include <addressindex.h>
+#include <BlockUndo.h>
 #include <spentindex.h>
+#include <script/StakingVaultScript.h>
+#include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <vector>
 #include <coins.h>
+#include <algorithm>
+#include <cassert>
+#include <set>
 #include <utility>
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 extern bool fAddressIndex;
 extern bool fSpentIndex;
+extern bool fVaultIndex;
+
+//! Blocks with fewer transactions per available thread are recorded on fewer threads
+static const unsigned int MIN_TRANSACTIONS_PER_THREAD = 250;
+
+//! The output spent by each input of a transaction
+typedef std::vector<const CTxOut*> SpentOutputs;
 
 typedef std::pair<uint160,int> HashBytesAndAddressType;
 HashBytesAndAddressType ComputeHashbytesAndAddressTypeForScript(const CScript& script)
@@ -30,31 +46,50 @@ HashBytesAndAddressType ComputeHashbytesAndAddressTypeForScript(const CScript& s
     return {hashBytes,addressType};
 }
 
+/** Put the entries of a vault output under its owner and manager key hashes, or take them out with a null value */
+static void CollectVaultIndexUpdates(
+    const CTxOut& output,
+    const uint256& txhash,
+    const unsigned int outputIndex,
+    const VaultIndexValue& value,
+    IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    std::pair<valtype,valtype> keyHashes;
+    if (!GetStakingVaultPubkeyHashes(output.scriptPubKey, keyHashes))
+        return;
+    indexDatabaseUpdates.vaultIndex.push_back(
+        std::make_pair(VaultIndexKey(VaultIndexRole::OWNER, uint160(keyHashes.first), txhash, outputIndex), value));
+    indexDatabaseUpdates.vaultIndex.push_back(
+        std::make_pair(VaultIndexKey(VaultIndexRole::MANAGER, uint160(keyHashes.second), txhash, outputIndex), value));
+}
+
 namespace Spending
 {
 void CollectUpdatesFromInputs(
     const CTransaction& tx,
     const TransactionLocationReference& txLocationRef,
-    const CCoinsViewCache& view,
+    const SpentOutputs& spentOutputs,
+    const bool addressIndex,
+    const bool spentIndex,
     IndexDatabaseUpdates& indexDatabaseUpdates)
 {
     if (tx.IsCoinBase()) return;
-    if (fAddressIndex || fSpentIndex)
+    if (addressIndex || spentIndex)
     {
         for (size_t j = 0; j < tx.vin.size(); j++) {
 
-            const CTxIn input = tx.vin[j];
-            const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
+            const CTxIn& input = tx.vin[j];
+            const CTxOut &prevout = *spentOutputs[j];
             HashBytesAndAddressType hashbytesAndAddressType = ComputeHashbytesAndAddressTypeForScript(prevout.scriptPubKey);
             const uint160& hashBytes = hashbytesAndAddressType.first;
             const int& addressType = hashbytesAndAddressType.second;
-            if (fAddressIndex && addressType > 0) {
+            if (addressIndex && addressType > 0) {
                 // record spending activity
                 indexDatabaseUpdates.addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, txLocationRef.blockHeight, txLocationRef.transactionIndex, txLocationRef.hash, j, true), prevout.nValue * -1));
                 // remove address from unspent index
                 indexDatabaseUpdates.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
             }
-            if (fSpentIndex) {
+            if (spentIndex) {
                 // add the spent index to determine the txid and input that spent an output
                 // and to find the amount and address from an input
                 indexDatabaseUpdates.spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txLocationRef.hash, j, txLocationRef.blockHeight, prevout.nValue, addressType, hashBytes)));
@@ -66,9 +101,10 @@ void CollectUpdatesFromInputs(
 void CollectUpdatesFromOutputs(
     const CTransaction& tx,
     const TransactionLocationReference& txLocationRef,
+    const bool addressIndex,
     IndexDatabaseUpdates& indexDatabaseUpdates)
 {
-    if (fAddressIndex) {
+    if (addressIndex) {
         for (unsigned int k = 0; k < tx.vout.size(); k++) {
             const CTxOut &out = tx.vout[k];
             HashBytesAndAddressType hashbytesAndAddressType = ComputeHashbytesAndAddressTypeForScript(out.scriptPubKey);
@@ -89,6 +125,22 @@ void CollectUpdatesFromOutputs(
         }
     }
 }
+
+void CollectVaultUpdates(
+    const CTransaction& tx,
+    const TransactionLocationReference& txLocationRef,
+    const SpentOutputs& spentOutputs,
+    const bool vaultIndex,
+    IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    if (!vaultIndex) return;
+    if (!tx.IsCoinBase()) {
+        for (unsigned int j = 0; j < tx.vin.size(); j++)
+            CollectVaultIndexUpdates(*spentOutputs[j], tx.vin[j].prevout.hash, tx.vin[j].prevout.n, VaultIndexValue(), indexDatabaseUpdates);
+    }
+    for (unsigned int k = 0; k < tx.vout.size(); k++)
+        CollectVaultIndexUpdates(tx.vout[k], txLocationRef.hash, k, VaultIndexValue(tx.vout[k].nValue, tx.vout[k].scriptPubKey), indexDatabaseUpdates);
+}
 }//Spending namespace
 
 namespace ReverseSpending
@@ -96,16 +148,18 @@ namespace ReverseSpending
 static void CollectUpdatesFromInputs(
     const CTransaction& tx,
     const TransactionLocationReference& txLocationReference,
-    const CCoinsViewCache& view,
+    const SpentOutputs& spentOutputs,
+    const bool addressIndex,
+    const bool spentIndex,
     IndexDatabaseUpdates& indexDBUpdates)
 {
     if (tx.IsCoinBase()) return;
     for( unsigned int txInputIndex = tx.vin.size(); txInputIndex-- > 0;)
     {
         const CTxIn& input = tx.vin[txInputIndex];
-        if (fAddressIndex)
+        if (addressIndex)
         {
-            const CTxOut &prevout = view.GetOutputFor(input);
+            const CTxOut &prevout = *spentOutputs[txInputIndex];
 
             HashBytesAndAddressType hashbytesAndAddressType = ComputeHashbytesAndAddressTypeForScript(prevout.scriptPubKey);
             const uint160& hashBytes = hashbytesAndAddressType.first;
@@ -124,7 +178,7 @@ static void CollectUpdatesFromInputs(
                         CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, txLocationReference.blockHeight)));
             }
         }
-        if(fSpentIndex)
+        if(spentIndex)
         {
             indexDBUpdates.spentIndex.push_back(
                 std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
@@ -135,9 +189,10 @@ static void CollectUpdatesFromInputs(
 static void CollectUpdatesFromOutputs(
     const CTransaction& tx,
     const TransactionLocationReference& txLocationReference,
+    const bool addressIndex,
     IndexDatabaseUpdates& indexDBUpdates)
 {
-    if (!fAddressIndex) return;
+    if (!addressIndex) return;
     const std::vector<CTxOut>& txOutputs = tx.vout;
     for (unsigned int k = txOutputs.size(); k-- > 0;)
     {
@@ -162,6 +217,111 @@ static void CollectUpdatesFromOutputs(
         }
     }
 }
+
+static void CollectVaultUpdates(
+    const CTransaction& tx,
+    const TransactionLocationReference& txLocationReference,
+    const SpentOutputs& spentOutputs,
+    const bool vaultIndex,
+    IndexDatabaseUpdates& indexDBUpdates)
+{
+    if (!vaultIndex) return;
+    for (unsigned int k = tx.vout.size(); k-- > 0;)
+        CollectVaultIndexUpdates(tx.vout[k], txLocationReference.hash, k, VaultIndexValue(), indexDBUpdates);
+    if (tx.IsCoinBase()) return;
+    for (unsigned int txInputIndex = tx.vin.size(); txInputIndex-- > 0;) {
+        const CTxOut& prevout = *spentOutputs[txInputIndex];
+        const COutPoint& outpoint = tx.vin[txInputIndex].prevout;
+        CollectVaultIndexUpdates(prevout, outpoint.hash, outpoint.n, VaultIndexValue(prevout.nValue, prevout.scriptPubKey), indexDBUpdates);
+    }
+}
+}
+
+/** Add (nSign 1) or take back (nSign -1) the address index entries of one transaction, starting at firstEntry, to the address balances */
+static void CollectAddressBalanceDeltas(
+    size_t firstEntry,
+    int nSign,
+    IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    const std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex = indexDatabaseUpdates.addressIndex;
+    std::set<CAddressIndexIteratorKey, CAddressIndexIteratorKeyCompare> addressesOfTransaction;
+    for (size_t entry = firstEntry; entry < addressIndex.size(); entry++) {
+        const CAddressIndexIteratorKey address(addressIndex[entry].first.type, addressIndex[entry].first.hashBytes);
+        CAddressBalance& delta = indexDatabaseUpdates.addressBalanceDeltas[address];
+        delta.AddEntry(addressIndex[entry].second, nSign);
+        if (addressesOfTransaction.insert(address).second)
+            delta.txCount += nSign;
+    }
+}
+
+static SpentOutputs GetSpentOutputs(const CTransaction& tx, const CCoinsViewCache& view)
+{
+    SpentOutputs spentOutputs;
+    spentOutputs.reserve(tx.vin.size());
+    for (unsigned int j = 0; j < tx.vin.size(); j++)
+        spentOutputs.push_back(&view.GetOutputFor(tx.vin[j]));
+    return spentOutputs;
+}
+
+static void RecordTransactionSpending(
+    const CTransaction& tx,
+    const TransactionLocationReference& txLocationRef,
+    const SpentOutputs& spentOutputs,
+    const bool addressIndex,
+    const bool spentIndex,
+    const bool vaultIndex,
+    IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    const size_t firstAddressIndexEntry = indexDatabaseUpdates.addressIndex.size();
+    Spending::CollectUpdatesFromInputs(tx,txLocationRef,spentOutputs,addressIndex,spentIndex, indexDatabaseUpdates);
+    Spending::CollectUpdatesFromOutputs(tx,txLocationRef,addressIndex,indexDatabaseUpdates);
+    Spending::CollectVaultUpdates(tx,txLocationRef,spentOutputs,vaultIndex,indexDatabaseUpdates);
+    CollectAddressBalanceDeltas(firstAddressIndexEntry, 1, indexDatabaseUpdates);
+}
+
+/** Record the transactions [firstTx, endTx) of a block, whose spent outputs are found in the block's undo data */
+static void RecordBlockTransactions(
+    const CBlock& block,
+    const CBlockUndo& blockUndo,
+    const int blockHeight,
+    const unsigned int firstTx,
+    const unsigned int endTx,
+    const bool addressIndex,
+    const bool spentIndex,
+    const bool vaultIndex,
+    IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    size_t nInputs = 0;
+    size_t nOutputs = 0;
+    for (unsigned int i = firstTx; i < endTx; i++) {
+        nInputs += block.vtx[i].IsCoinBase() ? 0 : block.vtx[i].vin.size();
+        nOutputs += block.vtx[i].vout.size();
+    }
+    if (addressIndex) {
+        indexDatabaseUpdates.addressIndex.reserve(nInputs + nOutputs);
+        indexDatabaseUpdates.addressUnspentIndex.reserve(nInputs + nOutputs);
+    }
+    if (spentIndex)
+        indexDatabaseUpdates.spentIndex.reserve(nInputs);
+
+    SpentOutputs spentOutputs;
+    for (unsigned int i = firstTx; i < endTx; i++) {
+        const CTransaction& tx = block.vtx[i];
+        spentOutputs.clear();
+        if (!tx.IsCoinBase()) {
+            const std::vector<CTxInUndo>& prevouts = blockUndo.vtxundo[i - 1].vprevout;
+            for (unsigned int j = 0; j < prevouts.size(); j++)
+                spentOutputs.push_back(&prevouts[j].txout);
+        }
+        const TransactionLocationReference txLocationRef(tx.GetHash(), blockHeight, i);
+        RecordTransactionSpending(tx, txLocationRef, spentOutputs, addressIndex, spentIndex, vaultIndex, indexDatabaseUpdates);
+    }
+}
+
+template <typename T>
+static void Append(std::vector<T>& entries, const std::vector<T>& moreEntries)
+{
+    entries.insert(entries.end(), moreEntries.begin(), moreEntries.end());
 }
 
 void IndexDatabaseUpdateCollector::RecordTransaction(
@@ -170,16 +330,104 @@ void IndexDatabaseUpdateCollector::RecordTransaction(
         const CCoinsViewCache& view,
         IndexDatabaseUpdates& indexDatabaseUpdates)
 {
-    Spending::CollectUpdatesFromInputs(tx,txLocationRef,view, indexDatabaseUpdates);
-    Spending::CollectUpdatesFromOutputs(tx,txLocationRef,indexDatabaseUpdates);
+    RecordTransaction(tx,txLocationRef,view,fAddressIndex,fSpentIndex,fVaultIndex,indexDatabaseUpdates);
+}
+
+void IndexDatabaseUpdateCollector::RecordTransaction(
+        const CTransaction& tx,
+        const TransactionLocationReference& txLocationRef,
+        const CCoinsViewCache& view,
+        const bool addressIndex,
+        const bool spentIndex,
+        const bool vaultIndex,
+        IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    const bool lookUpSpentOutputs = (addressIndex || spentIndex || vaultIndex) && !tx.IsCoinBase();
+    RecordTransactionSpending(tx,txLocationRef,lookUpSpentOutputs? GetSpentOutputs(tx,view): SpentOutputs(),addressIndex,spentIndex,vaultIndex,indexDatabaseUpdates);
+}
+
+void IndexDatabaseUpdateCollector::RecordBlock(
+        const CBlock& block,
+        const CBlockUndo& blockUndo,
+        const int blockHeight,
+        const bool addressIndex,
+        const bool spentIndex,
+        const bool vaultIndex,
+        const unsigned int maxThreads,
+        IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    if (!addressIndex && !spentIndex && !vaultIndex)
+        return;
+    assert(blockUndo.vtxundo.size() + 1 == block.vtx.size());
+
+    const unsigned int nTransactions = block.vtx.size();
+    const unsigned int nThreads = std::max(1u, std::min(maxThreads, nTransactions / MIN_TRANSACTIONS_PER_THREAD));
+    if (nThreads == 1) {
+        RecordBlockTransactions(block,blockUndo,blockHeight,0,nTransactions,addressIndex,spentIndex,vaultIndex,indexDatabaseUpdates);
+        return;
+    }
+
+    // Each thread records a contiguous range of transactions; appending the
+    // ranges in order gives the same updates as recording them one by one.
+    std::vector<IndexDatabaseUpdates> rangeUpdates(nThreads);
+    boost::thread_group threads;
+    for (unsigned int range = 1; range < nThreads; range++) {
+        threads.create_thread(boost::bind(&RecordBlockTransactions,
+            boost::cref(block), boost::cref(blockUndo), blockHeight,
+            range * nTransactions / nThreads, (range + 1) * nTransactions / nThreads,
+            addressIndex, spentIndex, vaultIndex, boost::ref(rangeUpdates[range])));
+    }
+    RecordBlockTransactions(block,blockUndo,blockHeight,0,nTransactions / nThreads,addressIndex,spentIndex,vaultIndex,rangeUpdates[0]);
+    threads.join_all();
+
+    size_t nAddressIndexEntries = indexDatabaseUpdates.addressIndex.size();
+    size_t nAddressUnspentIndexEntries = indexDatabaseUpdates.addressUnspentIndex.size();
+    size_t nSpentIndexEntries = indexDatabaseUpdates.spentIndex.size();
+    size_t nVaultIndexEntries = indexDatabaseUpdates.vaultIndex.size();
+    for (unsigned int range = 0; range < nThreads; range++) {
+        nAddressIndexEntries += rangeUpdates[range].addressIndex.size();
+        nAddressUnspentIndexEntries += rangeUpdates[range].addressUnspentIndex.size();
+        nSpentIndexEntries += rangeUpdates[range].spentIndex.size();
+        nVaultIndexEntries += rangeUpdates[range].vaultIndex.size();
+    }
+    indexDatabaseUpdates.addressIndex.reserve(nAddressIndexEntries);
+    indexDatabaseUpdates.addressUnspentIndex.reserve(nAddressUnspentIndexEntries);
+    indexDatabaseUpdates.spentIndex.reserve(nSpentIndexEntries);
+    indexDatabaseUpdates.vaultIndex.reserve(nVaultIndexEntries);
+    for (unsigned int range = 0; range < nThreads; range++) {
+        const IndexDatabaseUpdates& updates = rangeUpdates[range];
+        Append(indexDatabaseUpdates.addressIndex, updates.addressIndex);
+        Append(indexDatabaseUpdates.addressUnspentIndex, updates.addressUnspentIndex);
+        Append(indexDatabaseUpdates.spentIndex, updates.spentIndex);
+        Append(indexDatabaseUpdates.vaultIndex, updates.vaultIndex);
+        for (CAddressBalanceDeltas::const_iterator it = updates.addressBalanceDeltas.begin(); it != updates.addressBalanceDeltas.end(); ++it)
+            indexDatabaseUpdates.addressBalanceDeltas[it->first].Add(it->second);
+    }
+}
+
+void IndexDatabaseUpdateCollector::ReverseTransaction(
+        const CTransaction& tx,
+        const TransactionLocationReference& txLocationRef,
+        const CCoinsViewCache& view,
+        IndexDatabaseUpdates& indexDatabaseUpdates)
+{
+    ReverseTransaction(tx,txLocationRef,view,fAddressIndex,fSpentIndex,fVaultIndex,indexDatabaseUpdates);
 }
 
 void IndexDatabaseUpdateCollector::ReverseTransaction(
         const CTransaction& tx,
         const TransactionLocationReference& txLocationRef,
         const CCoinsViewCache& view,
+        const bool addressIndex,
+        const bool spentIndex,
+        const bool vaultIndex,
         IndexDatabaseUpdates& indexDatabaseUpdates)
 {
-    ReverseSpending::CollectUpdatesFromOutputs(tx,txLocationRef,indexDatabaseUpdates);
-    ReverseSpending::CollectUpdatesFromInputs(tx,txLocationRef,view, indexDatabaseUpdates);
-}
\ No newline at end of file
+    const bool lookUpSpentOutputs = (addressIndex || vaultIndex) && !tx.IsCoinBase();
+    const SpentOutputs spentOutputs = lookUpSpentOutputs? GetSpentOutputs(tx,view): SpentOutputs();
+    const size_t firstAddressIndexEntry = indexDatabaseUpdates.addressIndex.size();
+    ReverseSpending::CollectUpdatesFromOutputs(tx,txLocationRef,addressIndex,indexDatabaseUpdates);
+    ReverseSpending::CollectUpdatesFromInputs(tx,txLocationRef,spentOutputs,addressIndex,spentIndex, indexDatabaseUpdates);
+    ReverseSpending::CollectVaultUpdates(tx,txLocationRef,spentOutputs,vaultIndex,indexDatabaseUpdates);
+    CollectAddressBalanceDeltas(firstAddressIndexEntry, -1, indexDatabaseUpdates);
+}
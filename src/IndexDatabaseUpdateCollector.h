@@ -1,5 +1,7 @@
 #ifndef INDEX_DATABASE_UPDATE_COLLECTOR_H
 #define INDEX_DATABASE_UPDATE_COLLECTOR_H
+class CBlock;
+class CBlockUndo;
 class CTransaction;
 struct TransactionLocationReference;
 class CCoinsViewCache;
@@ -15,10 +17,41 @@ public:
         const TransactionLocationReference& txLocationRef,
         const CCoinsViewCache& view,
         IndexDatabaseUpdates& indexDatabaseUpdates);
+    //! Collect the updates of the given indexes, whether or not they are maintained along with the chain yet
+    static void RecordTransaction(
+        const CTransaction& tx,
+        const TransactionLocationReference& txLocationRef,
+        const CCoinsViewCache& view,
+        const bool addressIndex,
+        const bool spentIndex,
+        const bool vaultIndex,
+        IndexDatabaseUpdates& indexDatabaseUpdates);
+    /**
+     * Collect the address, spent and vault index updates of all of a block's transactions,
+     * in the same order as recording them one by one, on up to maxThreads threads.
+     * The outputs they spend are taken from the block's undo data.
+     */
+    static void RecordBlock(
+        const CBlock& block,
+        const CBlockUndo& blockUndo,
+        const int blockHeight,
+        const bool addressIndex,
+        const bool spentIndex,
+        const bool vaultIndex,
+        const unsigned int maxThreads,
+        IndexDatabaseUpdates& indexDatabaseUpdates);
+    static void ReverseTransaction(
+        const CTransaction& tx,
+        const TransactionLocationReference& txLocationReference,
+        const CCoinsViewCache& view,
+        IndexDatabaseUpdates& indexDBUpdates);
     static void ReverseTransaction(
         const CTransaction& tx,
         const TransactionLocationReference& txLocationReference,
         const CCoinsViewCache& view,
+        const bool addressIndex,
+        const bool spentIndex,
+        const bool vaultIndex,
         IndexDatabaseUpdates& indexDBUpdates);
 };
 #endif// INDEX_DATABASE_UPDATE_COLLECTOR_H
\ No newline at end of file
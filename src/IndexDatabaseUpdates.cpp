@@ -2,9 +2,14 @@
 
 IndexDatabaseUpdates::IndexDatabaseUpdates(
     ): addressIndex()
+    , addressBalanceDeltas()
     , addressUnspentIndex()
     , spentIndex()
     , txLocationData()
+    , blockFilters()
+    , blockStats()
+    , coinSupplies()
+    , vaultIndex()
 {
 }
 
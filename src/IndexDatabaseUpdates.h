@@ -3,8 +3,12 @@
 #include <vector>
 #include <utility>
 #include <addressindex.h>
+#include <BlockFilter.h>
+#include <BlockStats.h>
+#include <CoinSupply.h>
 #include <spentindex.h>
 #include <uint256.h>
+#include <VaultIndex.h>
 
 /** One entry in the tx index, which locates transactions on disk by their txid
  *  or bare txid (both keys are possible).  */
@@ -22,9 +26,15 @@ struct TxIndexEntry
 struct IndexDatabaseUpdates
 {
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    //! Changes to the address balances, summed over the address index entries above
+    CAddressBalanceDeltas addressBalanceDeltas;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
     std::vector<TxIndexEntry> txLocationData;
+    std::vector<BlockFilter> blockFilters;
+    std::vector<BlockStats> blockStats;
+    std::vector<CoinSupply> coinSupplies;
+    std::vector<std::pair<VaultIndexKey, VaultIndexValue> > vaultIndex;
 
     IndexDatabaseUpdates();
 };
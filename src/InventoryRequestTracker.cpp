@@ -0,0 +1,154 @@
+#include <InventoryRequestTracker.h>
+
+InventoryRequestTracker::InventoryRequestTracker(
+    ): announcements_()
+    , peers_()
+    , requests_()
+{
+}
+
+bool InventoryRequestTracker::ReceivedInv(NodeId peer, const CInv& inv, bool fPreferred, int64_t nNow)
+{
+    PeerAnnouncements& peerAnnouncements = peers_[peer];
+    if (peerAnnouncements.announced.size() >= MAX_PEER_ANNOUNCEMENTS)
+        return false;
+
+    const int64_t nRequestTime = fPreferred ? nNow : nNow + NON_PREFERRED_PEER_DELAY;
+    Announcements& announcements = announcements_[inv];
+    if (!announcements.insert(std::make_pair(peer, Announcement(fPreferred, nRequestTime))).second)
+        return false;
+    peerAnnouncements.announced.insert(inv);
+    peerAnnouncements.candidates.insert(std::make_pair(nRequestTime, inv));
+    return true;
+}
+
+bool InventoryRequestTracker::IsRequestable(const Announcements& announcements, NodeId peer, int64_t nNow) const
+{
+    const bool fPreferred = announcements.find(peer)->second.fPreferred;
+    for (const Announcements::value_type& entry : announcements) {
+        if (entry.first == peer)
+            continue;
+        const Announcement& other = entry.second;
+        if (other.state == REQUESTED)
+            return false;
+        if (other.state == CANDIDATE && other.fPreferred && !fPreferred && other.nTime <= nNow)
+            return false;
+    }
+    return true;
+}
+
+void InventoryRequestTracker::GetRequestable(NodeId peer, int64_t nNow, const AlreadyHaveFunction& alreadyHave, std::vector<CInv>& toRequest)
+{
+    ExpireRequests(nNow);
+    std::map<NodeId, PeerAnnouncements>::iterator peerIt = peers_.find(peer);
+    if (peerIt == peers_.end())
+        return;
+    PeerAnnouncements& peerAnnouncements = peerIt->second;
+
+    // Requests answered through some other message than the one for the inventory
+    for (std::set<CInv>::const_iterator it = peerAnnouncements.requested.begin(); it != peerAnnouncements.requested.end();) {
+        const CInv inv = *it++;
+        if (alreadyHave(inv))
+            ForgetInv(inv);
+    }
+
+    std::set<std::pair<int64_t, CInv> >::const_iterator it = peerAnnouncements.candidates.begin();
+    while (it != peerAnnouncements.candidates.end() && it->first <= nNow &&
+           peerAnnouncements.requested.size() < MAX_PEER_REQUESTS_IN_FLIGHT) {
+        // Advanced first, as the candidate may not survive the visit
+        const CInv inv = it->second;
+        ++it;
+        if (alreadyHave(inv)) {
+            ForgetInv(inv);
+            continue;
+        }
+        std::map<CInv, Announcements>::iterator announcementsIt = announcements_.find(inv);
+        if (!IsRequestable(announcementsIt->second, peer, nNow))
+            continue;
+
+        Announcement& announcement = announcementsIt->second.find(peer)->second;
+        peerAnnouncements.candidates.erase(std::make_pair(announcement.nTime, inv));
+        announcement.state = REQUESTED;
+        announcement.nTime = nNow + REQUEST_TIMEOUT;
+        peerAnnouncements.requested.insert(inv);
+        requests_.insert(std::make_tuple(announcement.nTime, inv, peer));
+        toRequest.push_back(inv);
+    }
+}
+
+void InventoryRequestTracker::ExpireRequests(int64_t nNow)
+{
+    while (!requests_.empty() && std::get<0>(*requests_.begin()) <= nNow) {
+        const CInv inv = std::get<1>(*requests_.begin());
+        const NodeId peer = std::get<2>(*requests_.begin());
+        requests_.erase(requests_.begin());
+
+        peers_.find(peer)->second.requested.erase(inv);
+        std::map<CInv, Announcements>::iterator announcementsIt = announcements_.find(inv);
+        announcementsIt->second.find(peer)->second.state = COMPLETED;
+        EraseIfCompleted(announcementsIt);
+    }
+}
+
+void InventoryRequestTracker::EraseIfCompleted(std::map<CInv, Announcements>::iterator it)
+{
+    for (const Announcements::value_type& entry : it->second) {
+        if (entry.second.state != COMPLETED)
+            return;
+    }
+    for (const Announcements::value_type& entry : it->second)
+        peers_.find(entry.first)->second.announced.erase(it->first);
+    announcements_.erase(it);
+}
+
+void InventoryRequestTracker::ForgetInv(const CInv& inv)
+{
+    std::map<CInv, Announcements>::iterator it = announcements_.find(inv);
+    if (it == announcements_.end())
+        return;
+
+    for (const Announcements::value_type& entry : it->second) {
+        PeerAnnouncements& peerAnnouncements = peers_.find(entry.first)->second;
+        peerAnnouncements.announced.erase(inv);
+        if (entry.second.state == CANDIDATE) {
+            peerAnnouncements.candidates.erase(std::make_pair(entry.second.nTime, inv));
+        } else if (entry.second.state == REQUESTED) {
+            peerAnnouncements.requested.erase(inv);
+            requests_.erase(std::make_tuple(entry.second.nTime, inv, entry.first));
+        }
+    }
+    announcements_.erase(it);
+}
+
+void InventoryRequestTracker::DisconnectedPeer(NodeId peer)
+{
+    std::map<NodeId, PeerAnnouncements>::iterator peerIt = peers_.find(peer);
+    if (peerIt == peers_.end())
+        return;
+
+    for (const CInv& inv : peerIt->second.announced) {
+        std::map<CInv, Announcements>::iterator announcementsIt = announcements_.find(inv);
+        Announcements::iterator announcement = announcementsIt->second.find(peer);
+        if (announcement->second.state == REQUESTED)
+            requests_.erase(std::make_tuple(announcement->second.nTime, inv, peer));
+        announcementsIt->second.erase(announcement);
+        // What the peer was asked for may now be asked of the others right away
+        if (announcementsIt->second.empty())
+            announcements_.erase(announcementsIt);
+        else
+            EraseIfCompleted(announcementsIt);
+    }
+    peers_.erase(peerIt);
+}
+
+size_t InventoryRequestTracker::CountAnnounced(NodeId peer) const
+{
+    std::map<NodeId, PeerAnnouncements>::const_iterator it = peers_.find(peer);
+    return it == peers_.end() ? 0 : it->second.announced.size();
+}
+
+size_t InventoryRequestTracker::CountInFlight(NodeId peer) const
+{
+    std::map<NodeId, PeerAnnouncements>::const_iterator it = peers_.find(peer);
+    return it == peers_.end() ? 0 : it->second.requested.size();
+}
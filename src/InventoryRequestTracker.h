@@ -0,0 +1,99 @@
+#ifndef INVENTORY_REQUEST_TRACKER_H
+#define INVENTORY_REQUEST_TRACKER_H
+#include <net.h>
+#include <protocol.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * Which peer to ask for each piece of inventory other than blocks, and when.
+ *
+ * Every announcement is kept per peer, so that when the peer asked does not
+ * answer in time, the next peer that announced the same inventory is asked
+ * right away rather than after a fixed retry delay. Inventory is asked for
+ * from one peer at a time. Preferred peers are asked as soon as they
+ * announce; other peers only after a short delay, and never while a
+ * preferred peer that announced the same inventory is waiting to be asked.
+ * Each peer has only so many announcements and requests outstanding.
+ *
+ * Requests are indexed by when they expire and candidates by when they may be
+ * asked for, so neither is found by walking everything. Times are in
+ * microseconds. Not safe for concurrent use; main guards it with cs_main.
+ */
+class InventoryRequestTracker
+{
+public:
+    typedef std::function<bool(const CInv&)> AlreadyHaveFunction;
+
+private:
+    enum AnnouncementState {
+        CANDIDATE,
+        REQUESTED,
+        COMPLETED,
+    };
+    struct Announcement {
+        AnnouncementState state;
+        bool fPreferred;
+        //! When a candidate may be asked for, or when a request expires
+        int64_t nTime;
+
+        Announcement(bool fPreferredIn, int64_t nTimeIn): state(CANDIDATE), fPreferred(fPreferredIn), nTime(nTimeIn) {}
+    };
+    typedef std::map<NodeId, Announcement> Announcements;
+    struct PeerAnnouncements {
+        std::set<CInv> announced;
+        //! When each of the peer's candidates may be asked for, earliest first
+        std::set<std::pair<int64_t, CInv> > candidates;
+        std::set<CInv> requested;
+
+        PeerAnnouncements(): announced(), candidates(), requested() {}
+    };
+
+    std::map<CInv, Announcements> announcements_;
+    std::map<NodeId, PeerAnnouncements> peers_;
+    //! When each outstanding request expires, soonest first
+    std::set<std::tuple<int64_t, CInv, NodeId> > requests_;
+
+    bool IsRequestable(const Announcements& announcements, NodeId peer, int64_t nNow) const;
+    void ExpireRequests(int64_t nNow);
+    //! Forget the inventory once no announcement of it may still be asked for
+    void EraseIfCompleted(std::map<CInv, Announcements>::iterator it);
+
+public:
+    InventoryRequestTracker();
+
+    //! Announcements a peer may have outstanding
+    static const size_t MAX_PEER_ANNOUNCEMENTS = MAX_INV_SZ;
+    //! Requests a peer may have outstanding
+    static const size_t MAX_PEER_REQUESTS_IN_FLIGHT = 100;
+    //! How long a peer has to answer a request
+    static const int64_t REQUEST_TIMEOUT = 60 * 1000000;
+    //! How long an announcement from a peer that is not preferred waits before it may be asked for
+    static const int64_t NON_PREFERRED_PEER_DELAY = 2 * 1000000;
+
+    //! Whether the announcement was new to the peer and counted
+    bool ReceivedInv(NodeId peer, const CInv& inv, bool fPreferred, int64_t nNow);
+    /**
+     * Append the inventory to ask the peer for now, marking it requested.
+     * What alreadyHave returns true for is forgotten instead, and frees the
+     * peer's place for it if it had been asked for already.
+     */
+    void GetRequestable(NodeId peer, int64_t nNow, const AlreadyHaveFunction& alreadyHave, std::vector<CInv>& toRequest);
+    //! The inventory arrived, from whichever peer, so no one is to be asked for it again
+    void ForgetInv(const CInv& inv);
+    void DisconnectedPeer(NodeId peer);
+
+    size_t Size() const { return announcements_.size(); }
+    size_t CountAnnounced(NodeId peer) const;
+    size_t CountInFlight(NodeId peer) const;
+    bool IsEmpty() const { return announcements_.empty() && peers_.empty() && requests_.empty(); }
+};
+#endif// INVENTORY_REQUEST_TRACKER_H
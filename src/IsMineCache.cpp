@@ -0,0 +1,60 @@
+#include <IsMineCache.h>
+
+#include <keystore.h>
+
+IsMineCache::Classification::Classification(
+    isminetype mineIn,
+    VaultType vaultTypeIn
+    ): mine(mineIn)
+    , vaultType(vaultTypeIn)
+{
+}
+
+IsMineCache::IsMineCache(
+    const CKeyStore& keyStore,
+    const std::atomic<unsigned>& keyStoreVersion,
+    size_t maxScripts
+    ): keyStore_(keyStore)
+    , keyStoreVersion_(keyStoreVersion)
+    , maxScripts_(maxScripts)
+    , cs_cache_()
+    , cachedVersion_(keyStoreVersion.load())
+    , classifications_()
+{
+}
+
+isminetype IsMineCache::IsMine(const CScript& scriptPubKey, VaultType& vaultType) const
+{
+    const unsigned version = keyStoreVersion_.load();
+    {
+        LOCK(cs_cache_);
+        if (cachedVersion_ != version) {
+            classifications_.clear();
+            cachedVersion_ = version;
+        }
+        std::map<CScript, Classification>::const_iterator it = classifications_.find(scriptPubKey);
+        if (it != classifications_.end()) {
+            vaultType = it->second.vaultType;
+            return it->second.mine;
+        }
+    }
+
+    // Solved without the cache lock held, as the keystore takes its own locks.
+    // The result is dropped if the keystore changed in the meantime.
+    const isminetype mine = ::IsMine(keyStore_, scriptPubKey, vaultType);
+    {
+        LOCK(cs_cache_);
+        if (cachedVersion_ == version && keyStoreVersion_.load() == version) {
+            if (classifications_.size() >= maxScripts_)
+                classifications_.clear();
+            classifications_.insert(std::make_pair(scriptPubKey, Classification(mine, vaultType)));
+        }
+    }
+    return mine;
+}
+
+size_t IsMineCache::NumberOfScripts() const
+{
+    LOCK(cs_cache_);
+    return classifications_.size();
+}
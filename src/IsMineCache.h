@@ -0,0 +1,50 @@
+#ifndef IS_MINE_CACHE_H
+#define IS_MINE_CACHE_H
+#include <script/script.h>
+#include <sync.h>
+#include <wallet_ismine.h>
+
+#include <atomic>
+#include <map>
+#include <stddef.h>
+
+class CKeyStore;
+
+/**
+ * Remembers how a keystore classifies each script, so outputs paying the same
+ * scripts over and over are not solved against the keys every time the wallet
+ * looks at them.
+ *
+ * The classifications are only good for one version of the keystore: the
+ * owner must change the version after every key, redeem script, watched
+ * script or multisig script that is added or removed, and the cache starts
+ * over when it sees a new one. It also starts over once it holds the maximum
+ * number of scripts, rather than keeping track of which ones were used last.
+ */
+class IsMineCache
+{
+private:
+    struct Classification {
+        isminetype mine;
+        VaultType vaultType;
+
+        Classification(isminetype mineIn, VaultType vaultTypeIn);
+    };
+
+    const CKeyStore& keyStore_;
+    const std::atomic<unsigned>& keyStoreVersion_;
+    const size_t maxScripts_;
+    mutable CCriticalSection cs_cache_;
+    mutable unsigned cachedVersion_;
+    mutable std::map<CScript, Classification> classifications_;
+
+public:
+    IsMineCache(
+        const CKeyStore& keyStore,
+        const std::atomic<unsigned>& keyStoreVersion,
+        size_t maxScripts);
+
+    isminetype IsMine(const CScript& scriptPubKey, VaultType& vaultType) const;
+    size_t NumberOfScripts() const;
+};
+#endif// IS_MINE_CACHE_H
@@ -29,10 +29,8 @@ CAmount Legacy::GetFullBlockValue(int nHeight, const CChainParams& chainParamete
 {
     const CSporkManager& sporkManager = GetSporkManager();
     if(sporkManager.IsSporkActive(SPORK_15_BLOCK_VALUE)) {
-        MultiValueSporkList<BlockSubsiditySporkValue> vBlockSubsiditySporkValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager.GetMultiValueSpork(SPORK_15_BLOCK_VALUE), vBlockSubsiditySporkValues);
         auto nBlockTime = chainActive[nHeight] ? chainActive[nHeight]->nTime : GetAdjustedTime();
-        BlockSubsiditySporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vBlockSubsiditySporkValues, nHeight, nBlockTime);
+        BlockSubsiditySporkValue activeSpork = sporkManager.GetActiveBlockSubsiditySpork(nHeight, nBlockTime);
 
         if(activeSpork.IsValid() &&
             (activeSpork.nActivationBlockHeight % chainParameters.SubsidyHalvingInterval()) == 0 )
@@ -45,6 +43,12 @@ CAmount Legacy::GetFullBlockValue(int nHeight, const CChainParams& chainParamete
     return BlockSubsidy(nHeight, chainParameters);
 }
 
+bool Legacy::SubsidiesAreSporkAdjusted()
+{
+    const CSporkManager& sporkManager = GetSporkManager();
+    return sporkManager.IsSporkActive(SPORK_15_BLOCK_VALUE) || sporkManager.IsSporkActive(SPORK_13_BLOCK_PAYMENTS);
+}
+
 CBlockRewards Legacy::GetBlockSubsidity(int nHeight, const CChainParams& chainParameters)
 {
     CAmount nSubsidy = Legacy::GetFullBlockValue(nHeight,chainParameters);
@@ -80,10 +84,8 @@ CBlockRewards Legacy::GetBlockSubsidity(int nHeight, const CChainParams& chainPa
 
     const CSporkManager& sporkManager = GetSporkManager();
     if(sporkManager.IsSporkActive(SPORK_13_BLOCK_PAYMENTS)) {
-        MultiValueSporkList<BlockPaymentSporkValue> vBlockPaymentsValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager.GetMultiValueSpork(SPORK_13_BLOCK_PAYMENTS), vBlockPaymentsValues);
         auto nBlockTime = chainActive[nHeight] ? chainActive[nHeight]->nTime : GetAdjustedTime();
-        BlockPaymentSporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vBlockPaymentsValues, nHeight, nBlockTime);
+        BlockPaymentSporkValue activeSpork = sporkManager.GetActiveBlockPaymentSpork(nHeight, nBlockTime);
 
         if(activeSpork.IsValid() &&
             (activeSpork.nActivationBlockHeight % chainParameters.SubsidyHalvingInterval()) == 0 ) {
@@ -13,5 +13,7 @@ namespace Legacy
     int64_t GetLotteryReward(const CBlockRewards &rewards, const CChainParams& chainParams);
     CBlockRewards GetBlockSubsidity(int nHeight, const CChainParams& chainParams);
     CAmount GetFullBlockValue(int nHeight, const CChainParams& chainParams);
+    // Whether sporks override the subsidies, which then depend on the block times as well as the heights
+    bool SubsidiesAreSporkAdjusted();
 };
 #endif // LEGACY_BLOCK_SUBSIDIES_H
\ No newline at end of file
@@ -16,17 +16,26 @@ LegacyPoSStakeModifierService::LegacyPoSStakeModifierService(
 
 std::pair<uint64_t,bool> LegacyPoSStakeModifierService::getStakeModifier(const StakingData& stakingData) const
 {
+    const CBlockIndex* selectionBlock = nullptr;
+    return getStakeModifierAndSelectionBlock(stakingData, selectionBlock);
+}
+
+std::pair<uint64_t,bool> LegacyPoSStakeModifierService::getStakeModifierAndSelectionBlock(
+    const StakingData& stakingData,
+    const CBlockIndex*& selectionBlock) const
+{
+    selectionBlock = nullptr;
     const uint256& blockHash = stakingData.blockHashOfFirstConfirmationBlock_;
     if (!blockIndexByHash_.count(blockHash))
     {
         LogPrintf("%s: failed to get kernel stake modifier - block not indexed\n", __func__);
         return std::make_pair(0,false);
     }
-    uint64_t nStakeModifier = GetKernelStakeModifier(blockHash);
+    uint64_t nStakeModifier = GetKernelStakeModifier(blockHash, selectionBlock);
     return std::make_pair(nStakeModifier,true);
 }
 
-uint64_t LegacyPoSStakeModifierService::GetKernelStakeModifier(const uint256& hashBlockFrom) const
+uint64_t LegacyPoSStakeModifierService::GetKernelStakeModifier(const uint256& hashBlockFrom, const CBlockIndex*& selectionBlock) const
 {
     const CBlockIndex& stakeTransactionBlockIndex = *(blockIndexByHash_.find(hashBlockFrom)->second);
     int64_t timeStampOfSelectedBlock = stakeTransactionBlockIndex.GetBlockTime();
@@ -52,5 +61,6 @@ uint64_t LegacyPoSStakeModifierService::GetKernelStakeModifier(const uint256& ha
             timeStampOfSelectedBlock = pindex->GetBlockTime();
         }
     }
+    selectionBlock = pindex;
     return pindex->nStakeModifier;
 }
\ No newline at end of file
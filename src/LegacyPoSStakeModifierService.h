@@ -7,15 +7,23 @@ class uint256;
 class StakingData;
 class BlockMap;
 class CChain;
+class CBlockIndex;
 class LegacyPoSStakeModifierService: public I_PoSStakeModifierService
 {
 private:
     const BlockMap& blockIndexByHash_;
     const CChain& activeChain_;
 
-    uint64_t GetKernelStakeModifier(const uint256& hashBlockFrom) const;
+    uint64_t GetKernelStakeModifier(const uint256& hashBlockFrom, const CBlockIndex*& selectionBlock) const;
 public:
     LegacyPoSStakeModifierService(const BlockMap& blockIndexByHash, const CChain& activeChain);
     virtual std::pair<uint64_t,bool> getStakeModifier(const StakingData& stakinData) const;
+    /**
+     * As getStakeModifier, also setting the last block of the active chain the modifier depends on;
+     * the modifier stays the same while that block is in the active chain. Null when the chain
+     * ended before the selection interval did, and the modifier changes as the chain grows.
+     */
+    std::pair<uint64_t,bool> getStakeModifierAndSelectionBlock(const StakingData& stakingData, const CBlockIndex*& selectionBlock) const;
+    const CChain& activeChain() const { return activeChain_; }
 };
 #endif// LEGACY_POS_STAKE_MODIFIER_SERVICE_H
\ No newline at end of file
@@ -12,6 +12,10 @@
 #include <utilstrencodings.h>
 #include <version.h>
 
+#if ENABLE_ZMQ
+#include <zmq/zmqabstractnotifier.h>
+#endif
+
 #include <boost/thread.hpp>
 
 //! if set, all keys will be derived by using BIP39/BIP44
@@ -44,7 +48,10 @@ std::string HelpMessageCli()
                                              "solved instantly. This is intended for regression testing tools and app development."));
     strUsage += HelpMessageOpt("-rpcconnect=<ip>", strprintf(translate("Send commands to node running on <ip> (default: %s)"), "127.0.0.1"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(translate("Connect to JSON-RPC on <port> (default: %u or testnet: %u)"), 31473, 31475));
+    strUsage += HelpMessageOpt("-rpcwallet=<file>", translate("Send wallet commands to the wallet of the given file loaded by the server (default: the first one it loaded)"));
     strUsage += HelpMessageOpt("-rpcwait", translate("Wait for RPC server to start"));
+    strUsage += HelpMessageOpt("-stdin", translate("Read commands from standard input, one per line with its parameters separated by spaces, and send them as batches over one connection"));
+    strUsage += HelpMessageOpt("-wait=<n>", translate("Wait for the next block before sending the command, for up to <n> seconds (0 or no value for no limit); alone, print the new tip"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", translate("Username for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", translate("Password for JSON-RPC connections"));
 
@@ -59,30 +66,58 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-version", translate("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", translate("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
     strUsage += HelpMessageOpt("-alerts", strprintf(translate("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", translate("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: last checkpoint)"));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", translate("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
-    strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(translate("How many blocks to check at startup (default: %u, 0 = all)"), 500));
+    strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(translate("How many blocks to verify the coin database against in the background after startup (default: %u, 0 = all, -1 = none)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(translate("Specify configuration file (default: %s)"), "izzy.conf"));
+    strUsage += HelpMessageOpt("-compressblockfiles=<n>", strprintf(translate("Compress block files in the background once all their blocks are more than <n> blocks deep, which only builds with compression support can read back (at least %d, 0 = never, default: %d)"), MIN_BLOCKS_TO_KEEP, DEFAULT_COMPRESS_BLOCK_FILES_DEPTH));
     if (mode == HMM_BITCOIND) {
 #if !defined(WIN32)
         strUsage += HelpMessageOpt("-daemon", translate("Run in the background as a daemon and accept commands"));
 #endif
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", translate("Specify data directory"));
+    strUsage += HelpMessageOpt("-blocksdir=<dir>", translate("Keep the block and undo files in <dir> instead of the data directory, e.g. on a larger and slower disk than the chain state"));
+    strUsage += HelpMessageOpt("-coinslookupthreads=<n>", strprintf(translate("Set the number of threads looking up the coins a block spends in the coin database (0 or 1 = no concurrency, at most %d, default: %d)"), MAX_COINS_LOOKUP_THREADS, DEFAULT_COINS_LOOKUP_THREADS));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(translate("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE_SIZE, MAX_DB_CACHE_SIZE, DEFAULT_DB_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-dbblockindexcache=<n>", translate("Set the part of -dbcache given to the block index database in megabytes (default: 1/8 of -dbcache, at most 2 unless -txindex)"));
+    strUsage += HelpMessageOpt("-dbcoinscache=<n>", translate("Set the part of -dbcache given to the coin database in megabytes (default: half of what the block index leaves)"));
+    strUsage += HelpMessageOpt("-dbmaxopenfiles=<n>", strprintf(translate("Keep at most <n> coin database files open (minimum: %d, default: %d)"), MIN_DB_MAX_OPEN_FILES, DEFAULT_DB_MAX_OPEN_FILES));
+    strUsage += HelpMessageOpt("-indexbuildlag=<n>", strprintf(translate("Build the indexes turned on after the chain was synced from the block files up to <n> blocks behind the tip before indexing along with the chain (default: %d)"), DEFAULT_INDEX_BUILD_LAG));
+    strUsage += HelpMessageOpt("-indexbuildrate=<n>", strprintf(translate("Build the indexes turned on after the chain was synced at up to <n> blocks per second (0 = no limit, default: %d)"), DEFAULT_INDEX_BUILD_RATE));
+    strUsage += HelpMessageOpt("-headersfirst", strprintf(translate("Validate header chains before downloading block bodies from all peers in parallel (default: %u)"), defaultParameters.HeadersFirstSyncingActive()));
     strUsage += HelpMessageOpt("-loadblock=<file>", translate("Imports blocks from external blk000??.dat file") + " " + translate("on startup"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(translate("Set the Maximum reorg depth (default: %u)"),  defaultParameters.MaxReorganizationDepth()   ));
+    strUsage += HelpMessageOpt("-limitancestorcount=<n>", strprintf(translate("Do not accept transactions with <n> or more in-pool ancestors, themselves included (default: %u)"), DEFAULT_ANCESTOR_LIMIT));
+    strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf(translate("Do not accept transactions whose in-pool ancestors, themselves included, take more than <n> kilobytes (default: %u)"), DEFAULT_ANCESTOR_SIZE_LIMIT));
+    strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf(translate("Do not accept transactions that would give an in-pool ancestor <n> or more descendants, itself included (default: %u)"), DEFAULT_DESCENDANT_LIMIT));
+    strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf(translate("Do not accept transactions that would give an in-pool ancestor more than <n> kilobytes of descendants, itself included (default: %u)"), DEFAULT_DESCENDANT_SIZE_LIMIT));
+    strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(translate("Keep the transaction memory pool below <n> megabytes, evicting the transactions paying the lowest fee rates together with their descendants (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(translate("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-maxorphanpeersize=<n>", strprintf(translate("Keep at most <n> bytes of unconnectable transactions from a single peer, dropping its oldest ones first (default: %u)"), DEFAULT_MAX_ORPHAN_PEER_BYTES));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(translate("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
+    strUsage += HelpMessageOpt("-threadpriority=<group>:<priority>", translate("Run the threads of a group at idle, low, normal or high priority, idle also lowering their disk priority; the groups are network, scriptcheck, rpc, staking, masternode, import and background, the last running at idle by default (can be specified multiple times)"));
+    strUsage += HelpMessageOpt("-threadaffinity=<group>:<cpus>", translate("Run the threads of a group only on the listed processors, like staking:2-3 or network:0,2 (can be specified multiple times)"));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(translate("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-parallelstartup", strprintf(translate("Load the fee estimates, masternode caches and peer addresses while the block index loads on startup (default: %u)"), DEFAULT_PARALLEL_STARTUP));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(translate("Specify pid file (default: %s)"), "izzyd.pid"));
 #endif
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(translate("Reduce storage requirements by pruning (deleting) old block and undo files. Old blocks are no longer served to peers and wallet rescans are disabled. "
+            "Warning: Reverting this setting requires re-downloading the entire blockchain. (default: 0 = disable pruning blocks, >=%u = target size in MiB to use for block and undo files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex", translate("Rebuild block chain index from current blk000??.dat files") + " " + translate("on startup"));
+    strUsage += HelpMessageOpt("-reindexthreads=<n>", strprintf(translate("Set the number of threads scanning block files during -reindex, while blocks are still validated in order (0 = no concurrency, at most %d, default: %d)"), MAX_REINDEX_THREADS, DEFAULT_REINDEX_THREADS));
     strUsage += HelpMessageOpt("-resync", translate("Delete blockchain folders and resync from scratch") + " " + translate("on startup"));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", translate("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(translate("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
     strUsage += HelpMessageOpt("-addressindex", strprintf(translate("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-spentindex", strprintf(translate("Maintain a full spent index, used to query for the spending transaction of an output (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(translate("Maintain compact filters of the scripts each block pays to and spends from, used to speed up wallet rescans and served to light clients (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
+    strUsage += HelpMessageOpt("-blockstatsindex", strprintf(translate("Maintain fee, reward and unspent output figures of each block as it is connected, used by the getblockstats rpc call (default: %u)"), DEFAULT_BLOCKSTATSINDEX));
+    strUsage += HelpMessageOpt("-supplyindex", strprintf(translate("Maintain the money supply and the vaulted, masternode collateral and unspendable amounts at each block, used by the getcoinsupply rpc call (default: %u)"), DEFAULT_SUPPLYINDEX));
+    strUsage += HelpMessageOpt("-vaultindex", strprintf(translate("Maintain an index of the unspent staking vaults by owner and manager key, used by the getaddressvaults rpc call (default: %u)"), DEFAULT_VAULTINDEX));
     strUsage += HelpMessageOpt("-forcestart", translate("Attempt to force blockchain corruption recovery") + " " + translate("on startup"));
 
     strUsage += HelpMessageGroup(translate("Connection options:"));
@@ -101,6 +136,9 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(translate("Maintain at most <n> connections to peers (default: %u)"), 125));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(translate("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(translate("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
+    strUsage += HelpMessageOpt("-maxuploadrate=<n>", strprintf(translate("Serve blocks older than a day only while total uploads stay under <n> KB/s, 0 for no limit (default: %u)"), DEFAULT_MAX_UPLOAD_RATE));
+    strUsage += HelpMessageOpt("-maxpeeruploadrate=<n>", strprintf(translate("Serve blocks older than a day to each peer at up to <n> KB/s, 0 for no limit (default: %u)"), DEFAULT_MAX_PEER_UPLOAD_RATE));
+    strUsage += HelpMessageOpt("-msghandthreads=<n>", strprintf(translate("Set the number of threads processing peer messages, each serving its own share of the peers (1 to %d, default: %d)"), MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(translate("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", translate("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(translate("Relay non-P2SH multisig (default: %u)"), 1));
@@ -120,6 +158,8 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
 #endif
 #endif
     strUsage += HelpMessageOpt("-whitebind=<addr>", translate("Bind to given address and whitelist peers connecting to it. Use [host]:port notation for IPv6"));
+    strUsage += HelpMessageOpt("-compresswhitelisted", strprintf(translate("Compress the traffic with whitelisted peers that support it, such as our own nodes syncing over metered links (default: %u)"), DEFAULT_COMPRESS_WHITELISTED));
+    strUsage += HelpMessageOpt("-compresspeer=<netmask>", translate("Compress the traffic with peers at the given netmask or IP address that support it, whether they connect to us or we to them. Can be specified multiple times."));
     strUsage += HelpMessageOpt("-whitelist=<netmask>", translate("Whitelist peers connecting from the given netmask or IP address. Can be specified multiple times.") +
         " " + translate("Whitelisted peers cannot be DoS banned and their transactions are always relayed, even if they are already in the mempool, useful e.g. for a gateway"));
 
@@ -131,6 +171,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-disablewallet", translate("Do not load the wallet and disable wallet RPC calls"));
     strUsage += HelpMessageOpt("-keypool=<n>", strprintf(translate("Set key pool size to <n> (default: %u)"), 100));
    strUsage += HelpMessageOpt("-rescan", translate("Rescan the block chain for missing wallet transactions") + " " + translate("on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(translate("Set the number of threads reading blocks ahead of a wallet rescan (0 = no concurrency, at most %d, default: %d)"), MAX_RESCAN_THREADS, DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", translate("Attempt to recover private keys from a corrupt wallet.dat") + " " + translate("on startup"));
     strUsage += HelpMessageOpt("-sendfreetransactions", strprintf(translate("Send transactions as zero-fee transactions if possible (default: %u)"), 0));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(translate("Spend unconfirmed change when sending transactions (default: %u)"), false));
@@ -145,7 +186,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-maxtxfee=<amt>", strprintf(translate("Maximum total fees to use in a single wallet transaction, setting too low may abort large transactions (default: %s)"),
         FormatMoney(DEFAULT_TRANSACTION_MAXFEE)));
     strUsage += HelpMessageOpt("-upgradewallet", translate("Upgrade wallet to latest format") + " " + translate("on startup"));
-    strUsage += HelpMessageOpt("-wallet=<file>", translate("Specify wallet file (within data directory)") + " " + strprintf(translate("(default: %s)"), "wallet.dat"));
+    strUsage += HelpMessageOpt("-wallet=<file>", translate("Specify wallet file (within data directory), can be given several times to load several wallets, the first being the default one") + " " + strprintf(translate("(default: %s)"), "wallet.dat"));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", translate("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     if (mode == HMM_BITCOIN_QT)
         strUsage += HelpMessageOpt("-windowtitle=<name>", translate("Wallet window title"));
@@ -161,11 +202,18 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", translate("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", translate("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", translate("Enable publish raw transaction (locked via SwiftX) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubwallettx=<address>", translate("Enable publish hash and change of wallet transactions in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubstake=<address>", translate("Enable publish blocks staked by the wallet in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubmasternodestatus=<address>", translate("Enable publish masternode state changes in <address>"));
+    strUsage += HelpMessageOpt("-zmqpublotterywinner=<address>", translate("Enable publish lottery winners in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsporkchange=<address>", translate("Enable publish spork changes in <address>"));
+    strUsage += HelpMessageOpt("-zmqpub<type>hwm=<n>", strprintf(translate("Set the outbound message high water mark of the socket of the -zmqpub<type> notifier, beyond which messages to a slow subscriber are dropped (default: %d)"), DEFAULT_ZMQ_SNDHWM));
 #endif
 
     strUsage += HelpMessageGroup(translate("Debugging/Testing options:"));
     if (settings.GetBoolArg("-help-debug", false)) {
-        strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)",defaultParameters.DefaultConsistencyChecks() ));
+        strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked once the block index is loaded, then re-check modified entries on every tip change. Also sets -checkmempool (default: %u)",defaultParameters.DefaultConsistencyChecks() ));
+        strUsage += HelpMessageOpt("-checkblockindexsample=<n>", strprintf("With -checkblockindex, also re-check <n> randomly chosen active chain entries on every tip change (default: %u)", DEFAULT_CHECKBLOCKINDEX_SAMPLE));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultParameters.DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf(translate("Only accept block chain matching built-in checkpoints (default: %u)"), 1));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf(translate("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)"), 100));
@@ -174,19 +222,25 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", translate("Randomly drop 1 of every <n> network messages"));
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", translate("Randomly fuzz 1 of every <n> network messages"));
         strUsage += HelpMessageOpt("-flushwallet", strprintf(translate("Run a thread to flush wallet periodically (default: %u)"), 1));
+        strUsage += HelpMessageOpt("-lockprofilesampling=<n>", strprintf("Time one in every <n> lock acquisitions for getlockstats, 0 to turn lock profiling off (default: %u)", DEFAULT_LOCK_PROFILE_SAMPLING));
         strUsage += HelpMessageOpt("-maxreorg", strprintf(translate("Use a custom max chain reorganization depth (default: %u)"), 100));
         strUsage += HelpMessageOpt("-protocolversion", strprintf(translate("Use a custom protocol version (default: use latest version %d)"), PROTOCOL_VERSION));
         strUsage += HelpMessageOpt("-activeversion", translate("Use a custom active version"));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf(translate("Stop running after importing blocks from disk (default: %u)"), 0));
+        strUsage += HelpMessageOpt("-importreport", strprintf("Log blocks, transactions and inputs per second, the time spent per validation phase and the peak memory use of the blocks imported on startup (default: %u)", 0));
         strUsage += HelpMessageOpt("-sporkkey=<privkey>", translate("Enable spork administration functionality with the appropriate private key."));
     }
-    std::string debugCategories = "addrman, alert, bench, coindb, db, lock, rand, rpc, selectcoins, tor, mempool, net, proxy, izzy, (obfuscation, swiftx, masternode, mnpayments, mnbudget, zero)"; // Don't translate these and qt below
+    std::string debugCategories = "addrman, alert, bench, coindb, db, lock, rand, rpc, selectcoins, tor, mempool, net, proxy, prune, izzy, (obfuscation, swiftx, masternode, mnpayments, mnbudget, zero)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(translate("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         translate("If <category> is not supplied, output all debugging information.") + translate("<category> can be:") + " " + debugCategories + ".");
     if (settings.GetBoolArg("-help-debug", false))
         strUsage += HelpMessageOpt("-nodebug", "Turn off debugging messages, same as -debug=0");
+    strUsage += HelpMessageOpt("-debugratelimit=<n>", strprintf(translate("Log at most <n> messages per second of each debugging category, 0 for no limit (default: %u)"), DEFAULT_DEBUG_RATE_LIMIT));
+    strUsage += HelpMessageOpt("-asynclogging", strprintf(translate("Write debug.log from a thread of its own, dropping messages when it falls behind and losing the queued ones if the process aborts (default: %u)"), DEFAULT_ASYNC_LOGGING));
+    if (settings.GetBoolArg("-help-debug", false))
+        strUsage += HelpMessageOpt("-logqueuesize=<n>", strprintf("Messages queued for the -asynclogging thread before further ones are dropped (default: %u)", DEFAULT_LOG_QUEUE_SIZE));
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageOpt("-gen", strprintf(translate("Generate coins (default: %u)"), 0));
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(translate("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), 1));
@@ -197,7 +251,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     if (settings.GetBoolArg("-help-debug", false)) {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf(translate("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:%u)"), 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf(translate("Require high priority for relaying free or low-fee transactions (default:%u)"), 1));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(translate("Limit size of signature cache to <n> entries (default: %u)"), 50000));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(translate("Limit the sum of the signature cache and script execution cache sizes to <n> MiB (default: %u)"), DEFAULT_MAX_SIG_CACHE_SIZE));
         strUsage += HelpMessageOpt("-acceptnonstandard", translate("Relay non-standard transactions"));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(translate("Fees (in DIV/Kb) smaller than this are considered zero fee for relaying (default: %s)"), FormatMoney( DEFAULT_TX_RELAY_FEE_PER_KILOBYTE )));
@@ -216,6 +270,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(translate("Staking options:"));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf(translate("Enable staking functionality (0-1, default: %u)"), 1));
+    strUsage += HelpMessageOpt("-stakingthreads=<n>", strprintf(translate("Set the number of threads hashing stake kernels (0 = one per core, at most %d, default: %d)"), MAX_STAKING_THREADS, DEFAULT_STAKING_THREADS));
     if (settings.GetBoolArg("-help-debug", false)) {
         strUsage += HelpMessageOpt("-printstakemodifier", translate("Display the stake modifier calculations in the debug.log file."));
         strUsage += HelpMessageOpt("-printcoinstake", translate("Display verbose coin stake messages in the debug.log file."));
@@ -241,6 +296,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-blockminsize=<n>", strprintf(translate("Set minimum block size in bytes (default: %u)"), 0));
     strUsage += HelpMessageOpt("-blockmaxsize=<n>", strprintf(translate("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE));
     strUsage += HelpMessageOpt("-blockprioritysize=<n>", strprintf(translate("Set maximum size of high-priority/low-fee transactions in bytes (default: %d)"), DEFAULT_BLOCK_PRIORITY_SIZE));
+    strUsage += HelpMessageOpt("-blockselectpackages", strprintf(translate("Fill blocks by the fee rate of transactions together with their unconfirmed ancestors, so children can pay for their parents, instead of by priority and fee rate; -blockprioritysize is then ignored (default: %u)"), DEFAULT_BLOCK_SELECT_PACKAGES));
 
     strUsage += HelpMessageGroup(translate("RPC server options:"));
     strUsage += HelpMessageOpt("-server", translate("Accept command line and JSON-RPC commands"));
@@ -250,7 +306,13 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", translate("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(translate("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 31473, 31475));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", translate("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
-    strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(translate("Set the number of threads to service RPC calls (default: %d)"), 4));
+    strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(translate("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_RPC_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(translate("Set the number of threads running the requests of a JSON-RPC batch that take no locks alongside each other, 0 to run batches in order (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
+    strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf(translate("Set the number of RPC connections that may wait for a thread before new ones are refused as busy (default: %d)"), DEFAULT_RPC_WORK_QUEUE_DEPTH));
+    strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf(translate("Seconds an RPC client may take to send a request, or leave a persistent connection idle (default: %d)"), DEFAULT_RPC_SERVER_TIMEOUT));
+    strUsage += HelpMessageOpt("-rpccachesize=<n>", strprintf(translate("Keep up to <n> MiB of getblock, getblockheader, getrawtransaction and REST block replies about blocks deep enough not to change, 0 to keep none (default: %d)"), DEFAULT_RPC_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-rpccachedepth=<n>", strprintf(translate("Confirmations a block needs before replies about it are kept (default: %d)"), DEFAULT_RPC_CACHE_DEPTH));
+    strUsage += HelpMessageOpt("-rpcmethodlimit=<command>:<n>", translate("Allow at most <n> calls to <command> to run at once, refusing any more. This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpckeepalive", strprintf(translate("RPC support for HTTP persistent connections (default: %d)"), 1));
 
     return strUsage;
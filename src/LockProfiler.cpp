@@ -0,0 +1,140 @@
+#include <LockProfiler.h>
+
+#include <utiltime.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+constexpr unsigned LockSiteStats::NUMBER_OF_BUCKETS;
+
+std::atomic<uint32_t> LockProfiler::samplingInterval_(0);
+std::atomic<uint32_t> LockProfiler::acquisitionCount_(0);
+
+namespace
+{
+typedef std::map<std::pair<std::string, int>, LockSiteStats> LockSiteMap;
+
+// A plain mutex: the profiled CCriticalSections must not profile themselves
+boost::mutex csLockSites;
+LockSiteMap& GetLockSites()
+{
+    static LockSiteMap lockSites;
+    return lockSites;
+}
+
+unsigned HistogramBucket(uint64_t nMicros)
+{
+    unsigned bucket = 0;
+    while (nMicros != 0 && bucket + 1 < LockSiteStats::NUMBER_OF_BUCKETS) {
+        nMicros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+}
+
+LockSiteStats::LockSiteStats(
+    ): lockName()
+    , file()
+    , line(0)
+    , nSamples(0)
+    , nContended(0)
+    , nTotalWaitMicros(0)
+    , nMaxWaitMicros(0)
+    , nTotalHoldMicros(0)
+    , nMaxHoldMicros(0)
+    , waitHistogram(NUMBER_OF_BUCKETS, 0)
+    , holdHistogram(NUMBER_OF_BUCKETS, 0)
+{
+}
+
+LockProfileSample::LockProfileSample(
+    ): pszName(NULL)
+    , pszFile(NULL)
+    , nLine(0)
+    , nRequestedMicros(0)
+    , nAcquiredMicros(0)
+    , fContended(false)
+{
+}
+
+bool LockProfileSample::IsActive() const
+{
+    return pszName != NULL;
+}
+
+void LockProfiler::SetSamplingInterval(uint32_t samplingInterval)
+{
+    samplingInterval_.store(samplingInterval, std::memory_order_relaxed);
+}
+
+uint32_t LockProfiler::GetSamplingInterval()
+{
+    return samplingInterval_.load(std::memory_order_relaxed);
+}
+
+int64_t LockProfiler::NowMicros()
+{
+    return GetTimeMicros();
+}
+
+void LockProfiler::Acquired(LockProfileSample& sample, const char* pszName, const char* pszFile, int nLine, int64_t nRequestedMicros, bool fContended)
+{
+    sample.pszName = pszName;
+    sample.pszFile = pszFile;
+    sample.nLine = nLine;
+    sample.nRequestedMicros = nRequestedMicros;
+    sample.nAcquiredMicros = NowMicros();
+    sample.fContended = fContended;
+}
+
+void LockProfiler::Released(const LockProfileSample& sample)
+{
+    const int64_t nReleasedMicros = NowMicros();
+    // The clock is not monotonic, so a step back is counted as no time at all
+    const uint64_t nWaitMicros = std::max<int64_t>(0, sample.nAcquiredMicros - sample.nRequestedMicros);
+    const uint64_t nHoldMicros = std::max<int64_t>(0, nReleasedMicros - sample.nAcquiredMicros);
+
+    boost::lock_guard<boost::mutex> lock(csLockSites);
+    LockSiteStats& site = GetLockSites()[std::make_pair(std::string(sample.pszFile), sample.nLine)];
+    if (site.nSamples == 0) {
+        site.lockName = sample.pszName;
+        site.file = sample.pszFile;
+        site.line = sample.nLine;
+    }
+    ++site.nSamples;
+    if (sample.fContended)
+        ++site.nContended;
+    site.nTotalWaitMicros += nWaitMicros;
+    site.nMaxWaitMicros = std::max(site.nMaxWaitMicros, nWaitMicros);
+    site.nTotalHoldMicros += nHoldMicros;
+    site.nMaxHoldMicros = std::max(site.nMaxHoldMicros, nHoldMicros);
+    ++site.waitHistogram[HistogramBucket(nWaitMicros)];
+    ++site.holdHistogram[HistogramBucket(nHoldMicros)];
+}
+
+std::vector<LockSiteStats> LockProfiler::GetStats()
+{
+    std::vector<LockSiteStats> stats;
+    {
+        boost::lock_guard<boost::mutex> lock(csLockSites);
+        const LockSiteMap& lockSites = GetLockSites();
+        stats.reserve(lockSites.size());
+        for (LockSiteMap::const_iterator it = lockSites.begin(); it != lockSites.end(); ++it)
+            stats.push_back(it->second);
+    }
+    std::stable_sort(stats.begin(), stats.end(), [](const LockSiteStats& a, const LockSiteStats& b) {
+        return a.nTotalWaitMicros > b.nTotalWaitMicros;
+    });
+    return stats;
+}
+
+void LockProfiler::Reset()
+{
+    boost::lock_guard<boost::mutex> lock(csLockSites);
+    GetLockSites().clear();
+}
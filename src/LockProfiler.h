@@ -0,0 +1,74 @@
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Wait and hold times of the sampled acquisitions made at one LOCK site */
+struct LockSiteStats {
+    //! Histogram bucket i counts times from 2^(i-1) up to 2^i microseconds, the last one everything longer
+    static constexpr unsigned NUMBER_OF_BUCKETS = 24;
+
+    std::string lockName;
+    std::string file;
+    int line;
+    uint64_t nSamples;
+    uint64_t nContended;
+    uint64_t nTotalWaitMicros;
+    uint64_t nMaxWaitMicros;
+    uint64_t nTotalHoldMicros;
+    uint64_t nMaxHoldMicros;
+    std::vector<uint64_t> waitHistogram;
+    std::vector<uint64_t> holdHistogram;
+
+    LockSiteStats();
+};
+
+/** An acquisition being timed, from the request for the lock until it is released */
+struct LockProfileSample {
+    const char* pszName;
+    const char* pszFile;
+    int nLine;
+    int64_t nRequestedMicros;
+    int64_t nAcquiredMicros;
+    bool fContended;
+
+    LockProfileSample();
+    bool IsActive() const;
+};
+
+/**
+ * Process wide profile of how long LOCK sites wait for and then hold their
+ * locks, for finding what actually serializes the node.
+ *
+ * One in every samplingInterval acquisitions is timed; with an interval of 0
+ * the profiler is off and a lock only pays for reading the interval.
+ */
+class LockProfiler
+{
+private:
+    static std::atomic<uint32_t> samplingInterval_;
+    static std::atomic<uint32_t> acquisitionCount_;
+
+public:
+    static void SetSamplingInterval(uint32_t samplingInterval);
+    static uint32_t GetSamplingInterval();
+
+    //! Whether the acquisition about to be made is one to time
+    static bool ShouldSample()
+    {
+        const uint32_t samplingInterval = samplingInterval_.load(std::memory_order_relaxed);
+        return samplingInterval != 0 &&
+               acquisitionCount_.fetch_add(1, std::memory_order_relaxed) % samplingInterval == 0;
+    }
+
+    static int64_t NowMicros();
+    static void Acquired(LockProfileSample& sample, const char* pszName, const char* pszFile, int nLine, int64_t nRequestedMicros, bool fContended);
+    static void Released(const LockProfileSample& sample);
+
+    //! The sites sampled so far, those that waited longest first
+    static std::vector<LockSiteStats> GetStats();
+    static void Reset();
+};
+#endif// LOCK_PROFILER_H
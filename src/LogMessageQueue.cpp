@@ -0,0 +1,68 @@
+#include <LogMessageQueue.h>
+
+#include <utility>
+
+namespace
+{
+uint64_t RoundUpToPowerOfTwo(size_t capacity)
+{
+    uint64_t rounded = 1;
+    while (rounded < capacity)
+        rounded <<= 1;
+    return rounded;
+}
+}
+
+LogMessageQueue::LogMessageQueue(
+    size_t capacity
+    ): mask_(RoundUpToPowerOfTwo(capacity) - 1)
+    , slots_(new Slot[mask_ + 1])
+    , pushPosition_(0)
+    , popPosition_(0)
+{
+    for (uint64_t i = 0; i <= mask_; ++i)
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+size_t LogMessageQueue::Capacity() const
+{
+    return mask_ + 1;
+}
+
+bool LogMessageQueue::Push(Message& message)
+{
+    uint64_t position = pushPosition_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[position & mask_];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const int64_t difference = (int64_t)sequence - (int64_t)position;
+        if (difference == 0) {
+            // The slot is free for this round; claim it unless another thread did
+            if (pushPosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        } else if (difference < 0) {
+            // The slot still holds the message of the round before
+            return false;
+        } else {
+            position = pushPosition_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->message.nTime = message.nTime;
+    slot->message.text.swap(message.text);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogMessageQueue::Pop(Message& message)
+{
+    Slot& slot = slots_[popPosition_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != popPosition_ + 1)
+        return false;
+    message.nTime = slot.message.nTime;
+    message.text.swap(slot.message.text);
+    slot.message.text.clear();
+    slot.sequence.store(popPosition_ + mask_ + 1, std::memory_order_release);
+    ++popPosition_;
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef LOG_MESSAGE_QUEUE_H
+#define LOG_MESSAGE_QUEUE_H
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * Bounded queue of log messages which any number of threads push to without
+ * taking a lock, and a single thread pops from.
+ *
+ * Every slot carries a sequence number telling whether it is free for the
+ * push of a given round or holds the message of that round, as in Vyukov's
+ * bounded queue. A push into a full queue fails rather than waiting for
+ * room, so a thread logging while it holds cs_main never waits on the disk.
+ */
+class LogMessageQueue
+{
+public:
+    struct Message {
+        //! When the message was logged, for its timestamp
+        int64_t nTime;
+        std::string text;
+    };
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        Message message;
+    };
+
+    const uint64_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> pushPosition_;
+    //! Only touched by the popping thread
+    uint64_t popPosition_;
+
+public:
+    //! The capacity is rounded up to a power of two
+    explicit LogMessageQueue(size_t capacity);
+
+    size_t Capacity() const;
+    //! Moves the message into the queue; false, leaving the message alone, if the queue is full
+    bool Push(Message& message);
+    //! For the popping thread only; false if no message is ready
+    bool Pop(Message& message);
+};
+#endif// LOG_MESSAGE_QUEUE_H
@@ -1,18 +1,23 @@
 #include <Logging.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <boost/filesystem/path.hpp>
 #include <boost/thread.hpp>
 #include <utiltime.h>
+#include <atomic>
+#include <chrono>
 #include <mutex>
-#include <set>
 
 #include <DataDirectory.h>
 #include <chainparamsbase.h>
+#include <defaultValues.h>
+#include <LogMessageQueue.h>
 #include <uint256.h>
 #include <Settings.h>
 
 bool fDebug = false;
+std::atomic<uint64_t> logCategories(LOG_NONE);
 bool fPrintToConsole = false;
 bool fPrintToDebugLog = true;
 volatile bool fReopenDebugLog = false;
@@ -90,34 +95,297 @@ bool EnsureDebugPrintInitialized()
     return true;
 }
 
-} // anonymous namespace
+/** Guards debug.log and whether the last message written to it ended its line */
+std::mutex mutexDebugLog;
+bool fStartedNewLine = true;
+
+/** Appends the message to what is written to debug.log next, with mutexDebugLog held */
+void AppendToDebugLog(std::string& batch, const std::string& str, int64_t nTime)
+{
+    if (fLogTimestamps && fStartedNewLine) {
+        batch += DateTimeStrFormat("%Y-%m-%d %H:%M:%S", nTime);
+        batch += ' ';
+    }
+    fStartedNewLine = !str.empty() && str[str.size() - 1] == '\n';
+    batch += str;
+}
+
+/** Writes to debug.log in one go, reopening it first if that was requested; with mutexDebugLog held */
+int WriteToDebugLog(const std::string& batch)
+{
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = getDebugLogPath();
+        if (freopen(pathDebug.string().c_str(), "a", fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+    }
+    return fwrite(batch.data(), 1, batch.size(), fileout);
+}
+
+/**
+ * Hands debug.log messages over to a thread of its own, which writes them
+ * out in batches, so that logging threads do not wait for the file or for
+ * each other. When the queue is full messages are dropped and counted,
+ * and the count is logged once there is room again.
+ */
+class AsyncDebugLog
+{
+private:
+    std::unique_ptr<LogMessageQueue> queue_;
+    std::atomic<bool> running_;
+    std::atomic<bool> sleeping_;
+    std::atomic<uint64_t> dropped_;
+    boost::mutex wakeMutex_;
+    boost::condition_variable wake_;
+    std::unique_ptr<boost::thread> thread_;
+
+    static constexpr size_t MESSAGES_PER_BATCH = 1024;
+    static constexpr int64_t IDLE_WAIT_MILLIS = 100;
+
+    //! Writes out what is queued, one batch at a time; false if nothing was queued
+    bool WriteQueued()
+    {
+        LogMessageQueue::Message message;
+        std::string batch;
+        bool fWrote = false;
+        for (;;) {
+            size_t nMessages = 0;
+            {
+                std::lock_guard<std::mutex> scoped_lock(mutexDebugLog);
+                while (nMessages < MESSAGES_PER_BATCH && queue_->Pop(message)) {
+                    AppendToDebugLog(batch, message.text, message.nTime);
+                    ++nMessages;
+                }
+                const uint64_t nDropped = dropped_.exchange(0);
+                if (nDropped != 0)
+                    AppendToDebugLog(batch, tfm::format("%u log messages dropped, debug.log could not keep up\n", nDropped), GetTime());
+                if (!batch.empty())
+                    WriteToDebugLog(batch);
+            }
+            if (batch.empty())
+                return fWrote;
+            fWrote = true;
+            batch.clear();
+        }
+    }
+
+    void Run()
+    {
+        while (running_.load()) {
+            if (WriteQueued())
+                continue;
+            boost::unique_lock<boost::mutex> lock(wakeMutex_);
+            sleeping_.store(true);
+            // The timeout covers a push that missed the flag being set
+            wake_.timed_wait(lock, boost::posix_time::milliseconds(IDLE_WAIT_MILLIS));
+            sleeping_.store(false);
+        }
+        WriteQueued();
+    }
+
+public:
+    AsyncDebugLog(
+        ): queue_()
+        , running_(false)
+        , sleeping_(false)
+        , dropped_(0)
+        , wakeMutex_()
+        , wake_()
+        , thread_()
+    {
+    }
+
+    bool IsRunning() const
+    {
+        return running_.load(std::memory_order_relaxed);
+    }
+
+    void Start(size_t nQueuedMessages)
+    {
+        if (thread_)
+            return;
+        queue_.reset(new LogMessageQueue(nQueuedMessages));
+        running_.store(true);
+        thread_.reset(new boost::thread(&AsyncDebugLog::Run, this));
+    }
 
-bool LogAcceptCategory(const char* category)
-{
-    if (category != NULL) {
-        if (!fDebug)
-            return false;
-
-        // Give each thread quick access to -debug settings.
-        // This helps prevent issues debugging global destructors,
-        // where mapMultiArgs might be deleted before another
-        // global destructor calls LogPrint()
-        static boost::thread_specific_ptr< std::set<std::string> > ptrCategory;
-        if (ptrCategory.get() == NULL) {
-            const std::vector<std::string> categories = settings.GetMultiParameter("-debug");
-            ptrCategory.reset(new std::set<std::string>(categories.begin(), categories.end()));
-            // thread_specific_ptr automatically deletes the set when the thread ends.
+    void Stop()
+    {
+        if (!thread_)
+            return;
+        running_.store(false);
+        wake_.notify_one();
+        thread_->join();
+        thread_.reset();
+        // Whatever was pushed while the thread was finishing
+        WriteQueued();
+    }
+
+    int Push(const std::string& str)
+    {
+        LogMessageQueue::Message message;
+        message.nTime = GetTime();
+        message.text = str;
+        if (!queue_->Push(message)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return 0;
         }
-        const std::set<std::string>& setCategories = *ptrCategory.get();
+        if (sleeping_.load())
+            wake_.notify_one();
+        return str.size();
+    }
+};
+
+constexpr size_t AsyncDebugLog::MESSAGES_PER_BATCH;
+constexpr int64_t AsyncDebugLog::IDLE_WAIT_MILLIS;
+
+AsyncDebugLog& GetAsyncDebugLog()
+{
+    static AsyncDebugLog asyncDebugLog;
+    return asyncDebugLog;
+}
+
+const struct {
+    LogCategory category;
+    const char* name;
+} logCategoryNames[] = {
+    {LOG_ADDRMAN, "addrman"},
+    {LOG_ALERT, "alert"},
+    {LOG_BENCH, "bench"},
+    {LOG_BLOCKFILES, "blockfiles"},
+    {LOG_COINDB, "coindb"},
+    {LOG_DB, "db"},
+    {LOG_DEBUG, "debug"},
+    {LOG_ESTIMATEFEE, "estimatefee"},
+    {LOG_IZZY, "izzy"},
+    {LOG_LOCK, "lock"},
+    {LOG_MASTERNODE, "masternode"},
+    {LOG_MEMPOOL, "mempool"},
+    {LOG_MNBUDGET, "mnbudget"},
+    {LOG_MNPAYMENTS, "mnpayments"},
+    {LOG_MOCKTIME, "mocktime"},
+    {LOG_NET, "net"},
+    {LOG_OBFUSCATION, "obfuscation"},
+    {LOG_PROXY, "proxy"},
+    {LOG_PRUNE, "prune"},
+    {LOG_QT, "qt"},
+    {LOG_RAND, "rand"},
+    {LOG_REINDEX, "reindex"},
+    {LOG_RPC, "rpc"},
+    {LOG_SELECTCOINS, "selectcoins"},
+    {LOG_SIGN, "sign"},
+    {LOG_SPORK, "spork"},
+    {LOG_STAKING, "staking"},
+    {LOG_SWIFTX, "swiftx"},
+    {LOG_TOR, "tor"},
+    {LOG_ZERO, "zero"},
+    {LOG_ZMQ, "zmq"},
+};
+
+/** Messages of one debug category let through in the current second */
+struct CategoryRate {
+    std::atomic<int64_t> nSecond;
+    std::atomic<uint32_t> nMessages;
+    std::atomic<uint32_t> nSuppressed;
+};
+
+constexpr unsigned NUMBER_OF_CATEGORY_RATES = 64;
+CategoryRate categoryRates[NUMBER_OF_CATEGORY_RATES];
+std::atomic<unsigned> nDebugRateLimit(DEFAULT_DEBUG_RATE_LIMIT);
+
+unsigned CategoryBit(LogCategory category)
+{
+    unsigned bit = 0;
+    while (bit + 1 < NUMBER_OF_CATEGORY_RATES && !(category & (1ull << bit)))
+        ++bit;
+    return bit;
+}
+
+void UpdateDebugFlag()
+{
+    fDebug = logCategories.load() != LOG_NONE;
+}
+
+} // anonymous namespace
 
-        // "all" is a composite category enabling all IZZY-related debug output
-        if (ptrCategory->count(std::string("all")) || ptrCategory->count(std::string("")))
+bool GetLogCategory(const std::string& name, LogCategory& category)
+{
+    if (name == "all" || name == "1" || name.empty()) {
+        category = LOG_ALL;
+        return true;
+    }
+    for (const auto& categoryName : logCategoryNames) {
+        if (name == categoryName.name) {
+            category = categoryName.category;
             return true;
+        }
+    }
+    return false;
+}
 
-        // if not debugging specific category, LogPrint does nothing.
-        return setCategories.count(std::string(category)) > 0;
+std::string GetLogCategoryName(LogCategory category)
+{
+    for (const auto& categoryName : logCategoryNames) {
+        if (category == categoryName.category)
+            return categoryName.name;
     }
-    return true;
+    return "";
+}
+
+std::vector<std::pair<std::string, bool> > ListLogCategories()
+{
+    std::vector<std::pair<std::string, bool> > categories;
+    for (const auto& categoryName : logCategoryNames)
+        categories.push_back(std::make_pair(std::string(categoryName.name), LogAcceptCategory(categoryName.category)));
+    return categories;
+}
+
+void EnableLogCategory(LogCategory category)
+{
+    logCategories.fetch_or(category);
+    UpdateDebugFlag();
+}
+
+void DisableLogCategory(LogCategory category)
+{
+    logCategories.fetch_and(~(uint64_t)category);
+    UpdateDebugFlag();
+}
+
+bool LogRateLimitAccepts(LogCategory category)
+{
+    const unsigned nLimit = nDebugRateLimit.load(std::memory_order_relaxed);
+    if (nLimit == 0)
+        return true;
+
+    CategoryRate& rate = categoryRates[CategoryBit(category)];
+    const int64_t nSecond = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t nRateSecond = rate.nSecond.load(std::memory_order_relaxed);
+    if (nRateSecond != nSecond && rate.nSecond.compare_exchange_strong(nRateSecond, nSecond)) {
+        rate.nMessages.store(0);
+        const uint32_t nSuppressed = rate.nSuppressed.exchange(0);
+        if (nSuppressed != 0)
+            LogPrintStr(tfm::format("[%s] %u messages suppressed by -debugratelimit\n", GetLogCategoryName(category), nSuppressed));
+    }
+    if (rate.nMessages.fetch_add(1, std::memory_order_relaxed) < nLimit)
+        return true;
+    rate.nSuppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SetDebugRateLimit(unsigned nMessagesPerSecond)
+{
+    nDebugRateLimit.store(nMessagesPerSecond, std::memory_order_relaxed);
+}
+
+void StartAsyncLogging(size_t nQueuedMessages)
+{
+    GetAsyncDebugLog().Start(nQueuedMessages);
+}
+
+void StopAsyncLogging()
+{
+    GetAsyncDebugLog().Stop();
 }
 
 int LogPrintStr(const std::string& str)
@@ -133,31 +401,17 @@ int LogPrintStr(const std::string& str)
         ret = fwrite(str.data(), 1, str.size(), stdout);
         fflush(stdout);
     } else if (fPrintToDebugLog && AreBaseParamsConfigured()) {
-        static bool fStartedNewLine = true;
-        static std::mutex mutexDebugLog;
-
         if (fileout == NULL)
             return ret;
 
-        std::lock_guard<std::mutex> scoped_lock(mutexDebugLog);
-
-        // reopen the log file, if requested
-        if (fReopenDebugLog) {
-            fReopenDebugLog = false;
-            boost::filesystem::path pathDebug = getDebugLogPath();
-            if (freopen(pathDebug.string().c_str(), "a", fileout) != NULL)
-                setbuf(fileout, NULL); // unbuffered
-        }
-
-        // Debug print useful for profiling
-        if (fLogTimestamps && fStartedNewLine)
-            ret += fprintf(fileout, "%s ", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()).c_str());
-        if (!str.empty() && str[str.size() - 1] == '\n')
-            fStartedNewLine = true;
-        else
-            fStartedNewLine = false;
+        AsyncDebugLog& asyncDebugLog = GetAsyncDebugLog();
+        if (asyncDebugLog.IsRunning())
+            return asyncDebugLog.Push(str);
 
-        ret = fwrite(str.data(), 1, str.size(), fileout);
+        std::lock_guard<std::mutex> scoped_lock(mutexDebugLog);
+        std::string line;
+        AppendToDebugLog(line, str, GetTime());
+        ret = WriteToDebugLog(line);
     }
 
     return ret;
@@ -191,10 +445,19 @@ void SetLoggingAndDebugSettings()
     fLogIPs = settings.GetBoolArg("-logips", false);
 
     const std::vector<std::string>& categories = settings.GetMultiParameter("-debug");
-    fDebug = !categories.empty();
+    uint64_t enabledCategories = LOG_NONE;
+    for (const std::string& name : categories) {
+        LogCategory category;
+        if (GetLogCategory(name, category))
+            enabledCategories |= category;
+        else if (name != "0")
+            LogPrintf("Unsupported logging category -debug=%s\n", name);
+    }
     // Special-case: if -debug=0/-nodebug is set, turn off debugging messages
     if (settings.GetBoolArg("-nodebug", false) || std::find(categories.begin(), categories.end(), std::string("0")) != categories.end())
-        fDebug = false;
+        enabledCategories = LOG_NONE;
+    logCategories.store(enabledCategories);
+    UpdateDebugFlag();
 
     if (settings.GetBoolArg("-shrinkdebugfile", !fDebug))
         ShrinkDebugFile();
@@ -203,6 +466,17 @@ void SetLoggingAndDebugSettings()
     {
         setvbuf(stdout, NULL, _IOLBF, 0);
     }
+
+    SetDebugRateLimit((unsigned)std::max<int64_t>(0, settings.GetArg("-debugratelimit", DEFAULT_DEBUG_RATE_LIMIT)));
+    if (!fPrintToConsole && settings.GetBoolArg("-asynclogging", DEFAULT_ASYNC_LOGGING)) {
+        StartAsyncLogging(std::max<int64_t>(1, settings.GetArg("-logqueuesize", DEFAULT_LOG_QUEUE_SIZE)));
+        // Write out what is still queued however the process ends
+        static bool fStopRegistered = false;
+        if (!fStopRegistered) {
+            fStopRegistered = true;
+            atexit(StopAsyncLogging);
+        }
+    }
 }
 
 bool ShouldLogPeerIPs()
@@ -3,7 +3,9 @@
 
 #include "tinyformat.h"
 
+#include <atomic>
 #include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -13,12 +15,69 @@ extern bool fDebug;
 extern volatile bool fReopenDebugLog;
 extern bool fLogTimestamps;
 
+/** The -debug categories, each a bit of the set of enabled ones */
+enum LogCategory : uint64_t {
+    LOG_NONE = 0,
+    LOG_ADDRMAN = (1ull << 0),
+    LOG_ALERT = (1ull << 1),
+    LOG_BENCH = (1ull << 2),
+    LOG_BLOCKFILES = (1ull << 3),
+    LOG_COINDB = (1ull << 4),
+    LOG_DB = (1ull << 5),
+    LOG_DEBUG = (1ull << 6),
+    LOG_ESTIMATEFEE = (1ull << 7),
+    LOG_IZZY = (1ull << 8),
+    LOG_LOCK = (1ull << 9),
+    LOG_MASTERNODE = (1ull << 10),
+    LOG_MEMPOOL = (1ull << 11),
+    LOG_MNBUDGET = (1ull << 12),
+    LOG_MNPAYMENTS = (1ull << 13),
+    LOG_MOCKTIME = (1ull << 14),
+    LOG_NET = (1ull << 15),
+    LOG_OBFUSCATION = (1ull << 16),
+    LOG_PROXY = (1ull << 17),
+    LOG_PRUNE = (1ull << 18),
+    LOG_QT = (1ull << 19),
+    LOG_RAND = (1ull << 20),
+    LOG_REINDEX = (1ull << 21),
+    LOG_RPC = (1ull << 22),
+    LOG_SELECTCOINS = (1ull << 23),
+    LOG_SIGN = (1ull << 24),
+    LOG_SPORK = (1ull << 25),
+    LOG_STAKING = (1ull << 26),
+    LOG_SWIFTX = (1ull << 27),
+    LOG_TOR = (1ull << 28),
+    LOG_ZERO = (1ull << 29),
+    LOG_ZMQ = (1ull << 30),
+    LOG_ALL = ~(uint64_t)0,
+};
+
+/** The enabled debug categories */
+extern std::atomic<uint64_t> logCategories;
+
 void SetLoggingAndDebugSettings();
 bool ShouldLogPeerIPs();
 /** Return true if log accepts specified category */
-bool LogAcceptCategory(const char* category);
+inline bool LogAcceptCategory(LogCategory category)
+{
+    return (logCategories.load(std::memory_order_relaxed) & category) != 0;
+}
+/** The category named as for -debug, or false if there is none of that name; "all", "1" and "" name all of them */
+bool GetLogCategory(const std::string& name, LogCategory& category);
+std::string GetLogCategoryName(LogCategory category);
+//! Every category by name, with whether it is enabled
+std::vector<std::pair<std::string, bool> > ListLogCategories();
+void EnableLogCategory(LogCategory category);
+void DisableLogCategory(LogCategory category);
+/** Whether a message of the debug category stays within -debugratelimit */
+bool LogRateLimitAccepts(LogCategory category);
+void SetDebugRateLimit(unsigned nMessagesPerSecond);
 /** Send a string to the log output */
 int LogPrintStr(const std::string& str);
+/** Writes debug.log from a thread of its own, which messages are queued for */
+void StartAsyncLogging(size_t nQueuedMessages);
+/** Writes out what is queued and goes back to writing debug.log on the logging thread */
+void StopAsyncLogging();
 
 /** Explicitly converts a particular value to a string for logging.  This is
  *  used for some types (e.g. uint256) that are not literally passed on to
@@ -103,27 +162,29 @@ template <>
     return format;
 }
 
-/** Logs a message if the -debug=category switch is given OR the category
- *  is NULL (general logs).  */
+/** Logs a message of a debug category that is known to be enabled. */
 template <typename... Args>
-  int LogPrint(const char* category, const char* format, const Args&... args)
+  int LogPrintCategory(LogCategory category, const char* format, const Args&... args)
 {
-    if (!LogAcceptCategory(category))
+    if (!LogRateLimitAccepts(category))
         return 0;
 
-    const std::string base = LogFormat(format, args...);
-
-    if (category == nullptr)
-        return LogPrintStr(base);
-
-    return LogPrintStr(tfm::format("[%s] %s", category, base));
+    return LogPrintStr(tfm::format("[%s] %s", GetLogCategoryName(category), LogFormat(format, args...)));
 }
 
+/** Logs a message if its category is enabled with -debug=category or the
+ *  logging RPC.  Otherwise the arguments are not even evaluated.  */
+#define LogPrint(category, ...)                             \
+    do {                                                    \
+        if (LogAcceptCategory(category))                    \
+            LogPrintCategory((category), __VA_ARGS__);      \
+    } while (0)
+
 /** Prints a log message without category.  */
 template <typename... Args>
   int LogPrintf(const char* format, const Args&... args)
 {
-    return LogPrint(nullptr, format, args...);
+    return LogPrintStr(LogFormat(format, args...));
 }
 
 /** Logs an error and returns false.  */
@@ -42,6 +42,13 @@ void LotteryCoinstakeData::updateShallowDataStore(LotteryCoinstakeData& other)
         storage = other.storage;
     }
 }
+bool LotteryCoinstakeData::shareShallowDataStoreOfPreviousBlock(const LotteryCoinstakeData& previous)
+{
+    if(storageIsLocal) return true;
+    if(previous.height() != heightOfDataStorage) return false;
+    storage = previous.storage;
+    return true;
+}
 
 void LotteryCoinstakeData::clear()
 {
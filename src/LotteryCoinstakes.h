@@ -28,6 +28,9 @@ public:
     int height() const;
     const LotteryCoinstakes& getLotteryCoinstakes() const;
     void updateShallowDataStore(LotteryCoinstakeData& other);
+    //! Share the storage of the previous block's data when this is a shallow copy of it, which holds
+    //! once the previous block's data was itself linked, and tell whether this data is now complete
+    bool shareShallowDataStoreOfPreviousBlock(const LotteryCoinstakeData& previous);
     void clear();
     LotteryCoinstakeData getShallowCopy() const;
 
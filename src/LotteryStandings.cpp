@@ -0,0 +1,79 @@
+#include <LotteryStandings.h>
+
+#include <chain.h>
+#include <I_SuperblockHeightValidator.h>
+#include <LotteryCoinstakes.h>
+#include <LotteryWinnersCalculator.h>
+
+LotteryStandings::Snapshot::Snapshot(
+    ): height(-1)
+    , blockHash(0)
+    , lastLotteryHeight(-1)
+    , lastLotteryBlockHash(0)
+    , lotteryCycleLength(0)
+    , nextLotteryHeight(-1)
+    , vetoesApply(false)
+    , candidates()
+    , vetoedScripts()
+{
+}
+
+LotteryStandings::LotteryStandings(
+    const LotteryWinnersCalculator& calculator,
+    const I_SuperblockHeightValidator& heightValidator
+    ): calculator_(calculator)
+    , heightValidator_(heightValidator)
+    , cs_standings_()
+    , standings_()
+{
+}
+
+void LotteryStandings::Update(const CBlockIndex* chainTip) const
+{
+    Snapshot standings;
+    standings.height = chainTip->nHeight;
+    standings.blockHash = chainTip->GetBlockHash();
+
+    // The candidates at the tip were scored against the lottery block before it
+    const CBlockIndex* lastLotteryBlockIndex = calculator_.GetLastLotteryBlockIndexBeforeHeight(chainTip->nHeight);
+    if(lastLotteryBlockIndex)
+    {
+        standings.lastLotteryHeight = lastLotteryBlockIndex->nHeight;
+        standings.lastLotteryBlockHash = lastLotteryBlockIndex->GetBlockHash();
+
+        const LotteryCoinstakes& coinstakes = chainTip->vLotteryWinnersCoinstakes.getLotteryCoinstakes();
+        const RankedScoreAwareCoinstakes rankedCoinstakes =
+            LotteryWinnersCalculator::computeRankedScoreAwareCoinstakes(standings.lastLotteryBlockHash, coinstakes);
+        standings.candidates.reserve(coinstakes.size());
+        for(const LotteryCoinstake& coinstake: coinstakes)
+        {
+            const RankAwareScore& rankedScore = rankedCoinstakes.find(coinstake.first)->second;
+            Candidate candidate = {coinstake.first, coinstake.second, rankedScore.score, rankedScore.rank, rankedScore.isDuplicateScript};
+            standings.candidates.push_back(candidate);
+        }
+    }
+
+    const int nextBlockHeight = chainTip->nHeight + 1;
+    standings.lotteryCycleLength = heightValidator_.GetLotteryBlockPaymentCycle(nextBlockHeight);
+    for(int height = nextBlockHeight; height <= nextBlockHeight + standings.lotteryCycleLength; ++height)
+    {
+        if(heightValidator_.IsValidLotteryBlockHeight(height))
+        {
+            standings.nextLotteryHeight = height;
+            break;
+        }
+    }
+    standings.vetoesApply = calculator_.GetVetoedPaymentScripts(nextBlockHeight, standings.vetoedScripts);
+
+    standings_ = standings;
+}
+
+LotteryStandings::Snapshot LotteryStandings::GetSnapshot(const CBlockIndex* chainTip) const
+{
+    LOCK(cs_standings_);
+    if(chainTip && (standings_.height != chainTip->nHeight || standings_.blockHash != chainTip->GetBlockHash()))
+    {
+        Update(chainTip);
+    }
+    return standings_;
+}
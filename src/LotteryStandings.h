@@ -0,0 +1,64 @@
+#ifndef LOTTERY_STANDINGS_H
+#define LOTTERY_STANDINGS_H
+#include <script/script.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <vector>
+
+class CBlockIndex;
+class I_SuperblockHeightValidator;
+class LotteryWinnersCalculator;
+
+/**
+ * Where the lottery stands at the chain tip: the candidates in the order they
+ * would be paid, the scripts the prior winners veto and when the next lottery
+ * block is due.
+ *
+ * The standings are worked out once per tip and handed out until the tip
+ * changes, so they can be polled without rescoring the candidates or walking
+ * back over the prior lottery cycles. Lookups must hold cs_main.
+ */
+class LotteryStandings
+{
+public:
+    struct Candidate {
+        uint256 coinstakeHash;
+        CScript paymentScript;
+        uint256 score;
+        //! The position in the list, which is kept sorted by score
+        size_t rank;
+        bool isDuplicateScript;
+    };
+
+    struct Snapshot {
+        int height;
+        uint256 blockHash;
+        int lastLotteryHeight;
+        uint256 lastLotteryBlockHash;
+        int lotteryCycleLength;
+        int nextLotteryHeight;
+        bool vetoesApply;
+        std::vector<Candidate> candidates;
+        std::vector<CScript> vetoedScripts;
+
+        Snapshot();
+    };
+
+private:
+    const LotteryWinnersCalculator& calculator_;
+    const I_SuperblockHeightValidator& heightValidator_;
+    mutable CCriticalSection cs_standings_;
+    mutable Snapshot standings_;
+
+    void Update(const CBlockIndex* chainTip) const;
+
+public:
+    LotteryStandings(
+        const LotteryWinnersCalculator& calculator,
+        const I_SuperblockHeightValidator& heightValidator);
+
+    Snapshot GetSnapshot(const CBlockIndex* chainTip) const;
+};
+#endif// LOTTERY_STANDINGS_H
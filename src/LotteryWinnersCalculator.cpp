@@ -11,6 +11,9 @@
 #include <I_SuperblockHeightValidator.h>
 #include <ForkActivation.h>
 
+#include <algorithm>
+#include <cassert>
+
 LotteryWinnersCalculator::LotteryWinnersCalculator(
     int startOfLotteryBlocks,
     const CChain& activeChain,
@@ -20,6 +23,10 @@ LotteryWinnersCalculator::LotteryWinnersCalculator(
     , activeChain_(activeChain)
     , sporkManager_(sporkManager)
     , superblockHeightValidator_(superblockHeightValidator)
+    , cs_vetoedScripts_()
+    , vetoedScriptsBlockHash_(0)
+    , vetoedScriptsLotteryHeight_(-1)
+    , vetoedScripts_()
 {
 }
 
@@ -28,10 +35,8 @@ int LotteryWinnersCalculator::minimumCoinstakeForTicket(int nHeight) const
     int nMinStakeValue = 10000; // default is 10k
 
     if(sporkManager_.IsSporkActive(SPORK_16_LOTTERY_TICKET_MIN_VALUE)) {
-        MultiValueSporkList<LotteryTicketMinValueSporkValue> vValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager_.GetMultiValueSpork(SPORK_16_LOTTERY_TICKET_MIN_VALUE), vValues);
         auto nBlockTime = activeChain_[nHeight] ? activeChain_[nHeight]->nTime : GetAdjustedTime();
-        LotteryTicketMinValueSporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vValues, nHeight, nBlockTime);
+        LotteryTicketMinValueSporkValue activeSpork = sporkManager_.GetActiveLotteryTicketMinValueSpork(nHeight, nBlockTime);
 
         if(activeSpork.IsValid()) {
             // we expect that this value is in coins, not in satoshis
@@ -73,26 +78,63 @@ CBlockIndex* LotteryWinnersCalculator::GetLastLotteryBlockIndexBeforeHeight(int
     return activeChain_[nLastLotteryHeight];
 }
 
-bool LotteryWinnersCalculator::IsPaymentScriptVetoed(const CScript& paymentScript, const int blockHeight) const
+bool LotteryWinnersCalculator::UpdateVetoedPaymentScripts(const int blockHeight) const
 {
+    AssertLockHeld(cs_vetoedScripts_);
     const int lotteryBlockPaymentCycle = superblockHeightValidator_.GetLotteryBlockPaymentCycle(blockHeight);
     const int nLastLotteryHeight = std::max(startOfLotteryBlocks_,  lotteryBlockPaymentCycle* ((blockHeight - 1) / lotteryBlockPaymentCycle) );
-    constexpr int numberOfLotteryCyclesToVetoFor = 3;
-    for (int lotteryCycleCount = 0; lotteryCycleCount < numberOfLotteryCyclesToVetoFor; ++lotteryCycleCount)
+    const CBlockIndex* blockIndexPreceedingLastLotteryBlock = activeChain_[nLastLotteryHeight-1];
+    if(!blockIndexPreceedingLastLotteryBlock)
+    {
+        return false;
+    }
+
+    // The prior winners only change with the lottery cycle, or with a reorg past its start
+    if(vetoedScriptsLotteryHeight_ != nLastLotteryHeight ||
+        vetoedScriptsBlockHash_ != blockIndexPreceedingLastLotteryBlock->GetBlockHash())
     {
-        CBlockIndex* blockIndexPreceedingPriorLotteryBlock = activeChain_[ nLastLotteryHeight-lotteryBlockPaymentCycle*lotteryCycleCount-1];
-        if(!blockIndexPreceedingPriorLotteryBlock)
+        vetoedScripts_.clear();
+        constexpr int numberOfLotteryCyclesToVetoFor = 3;
+        for (int lotteryCycleCount = 0; lotteryCycleCount < numberOfLotteryCyclesToVetoFor; ++lotteryCycleCount)
         {
-            return false;
+            CBlockIndex* blockIndexPreceedingPriorLotteryBlock = activeChain_[ nLastLotteryHeight-lotteryBlockPaymentCycle*lotteryCycleCount-1];
+            if(!blockIndexPreceedingPriorLotteryBlock)
+            {
+                break;
+            }
+            for(const LotteryCoinstake& coinstake: blockIndexPreceedingPriorLotteryBlock->vLotteryWinnersCoinstakes.getLotteryCoinstakes())
+            {
+                vetoedScripts_.push_back(coinstake.second);
+            }
         }
-        const LotteryCoinstakes& previousWinners = blockIndexPreceedingPriorLotteryBlock->vLotteryWinnersCoinstakes.getLotteryCoinstakes();
-        LotteryCoinstakes::const_iterator it = std::find_if(previousWinners.begin(),previousWinners.end(),
-            [&paymentScript](const LotteryCoinstake& coinstake){
-                return coinstake.second == paymentScript;
-            });
-        if(it != previousWinners.end()) return true;
+        std::sort(vetoedScripts_.begin(),vetoedScripts_.end());
+        vetoedScriptsLotteryHeight_ = nLastLotteryHeight;
+        vetoedScriptsBlockHash_ = blockIndexPreceedingLastLotteryBlock->GetBlockHash();
+    }
+    return true;
+}
+
+bool LotteryWinnersCalculator::IsPaymentScriptVetoed(const CScript& paymentScript, const int blockHeight) const
+{
+    LOCK(cs_vetoedScripts_);
+    return UpdateVetoedPaymentScripts(blockHeight) &&
+        std::binary_search(vetoedScripts_.begin(),vetoedScripts_.end(),paymentScript);
+}
+
+bool LotteryWinnersCalculator::GetVetoedPaymentScripts(const int blockHeight, std::vector<CScript>& vetoedScripts) const
+{
+    vetoedScripts.clear();
+    const CBlockIndex* lastLotteryBlockIndex = GetLastLotteryBlockIndexBeforeHeight(blockHeight);
+    if(!lastLotteryBlockIndex || !ActivationState(lastLotteryBlockIndex).IsActive(Fork::UniformLotteryWinners))
+    {
+        return false;
+    }
+    LOCK(cs_vetoedScripts_);
+    if(UpdateVetoedPaymentScripts(blockHeight))
+    {
+        vetoedScripts = vetoedScripts_;
     }
-    return false;
+    return true;
 }
 
 static void SortCoinstakesByScore(const RankedScoreAwareCoinstakes& rankedScoreAwareCoinstakes, LotteryCoinstakes& updatedCoinstakes)
@@ -157,6 +199,50 @@ RankedScoreAwareCoinstakes LotteryWinnersCalculator::computeRankedScoreAwareCoin
     return rankedScoreAwareCoinstakes;
 }
 
+namespace
+{
+constexpr size_t numberOfLotteryWinners = 11;
+
+// The scores of the previous winners and the new coinstake, kept beside them while they are sorted in place
+struct ScoredCoinstakes
+{
+    size_t count;
+    uint256 scores[numberOfLotteryWinners + 1];
+    size_t ranks[numberOfLotteryWinners + 1];
+    bool isDuplicateScript[numberOfLotteryWinners + 1];
+
+    ScoredCoinstakes(const uint256& lastLotteryBlockHash, const LotteryCoinstakes& coinstakes): count(coinstakes.size())
+    {
+        assert(count <= numberOfLotteryWinners + 1);
+        for(size_t index = 0; index < count; ++index)
+        {
+            scores[index] = LotteryWinnersCalculator::CalculateLotteryScore(coinstakes[index].first, lastLotteryBlockHash);
+            ranks[index] = index;
+            isDuplicateScript[index] = false;
+            for(size_t earlier = 0; earlier < index && !isDuplicateScript[index]; ++earlier)
+            {
+                isDuplicateScript[index] = coinstakes[earlier].second == coinstakes[index].second;
+            }
+        }
+    }
+
+    // A stable insertion sort from the highest score down, which for at most a dozen entries beats building a map
+    void sortByScore(LotteryCoinstakes& coinstakes)
+    {
+        for(size_t index = 1; index < count; ++index)
+        {
+            for(size_t position = index; position > 0 && scores[position] > scores[position - 1]; --position)
+            {
+                std::swap(coinstakes[position], coinstakes[position - 1]);
+                std::swap(scores[position], scores[position - 1]);
+                std::swap(ranks[position], ranks[position - 1]);
+                std::swap(isDuplicateScript[position], isDuplicateScript[position - 1]);
+            }
+        }
+    }
+};
+}
+
 bool LotteryWinnersCalculator::UpdateCoinstakes(int nextBlockHeight, LotteryCoinstakes& updatedCoinstakes) const
 {
     CBlockIndex* lastLotteryBlockIndex = GetLastLotteryBlockIndexBeforeHeight(nextBlockHeight);
@@ -167,14 +253,44 @@ bool LotteryWinnersCalculator::UpdateCoinstakes(int nextBlockHeight, LotteryCoin
         return false;
     }
 
-    RankedScoreAwareCoinstakes rankedScoreAwareCoinstakes =
-        computeRankedScoreAwareCoinstakes(lastLotteryBlockIndex->GetBlockHash(), updatedCoinstakes);
-    SortCoinstakesByScore(rankedScoreAwareCoinstakes,updatedCoinstakes);
+    if(updatedCoinstakes.size() > numberOfLotteryWinners + 1)
+    {
+        RankedScoreAwareCoinstakes rankedScoreAwareCoinstakes =
+            computeRankedScoreAwareCoinstakes(lastLotteryBlockIndex->GetBlockHash(), updatedCoinstakes);
+        SortCoinstakesByScore(rankedScoreAwareCoinstakes,updatedCoinstakes);
+
+        return TopElevenBestCoinstakesNeedUpdating(
+            activations.IsActive(Fork::UniformLotteryWinners),
+            rankedScoreAwareCoinstakes,
+            updatedCoinstakes);
+    }
+
+    ScoredCoinstakes scoredCoinstakes(lastLotteryBlockIndex->GetBlockHash(), updatedCoinstakes);
+    scoredCoinstakes.sortByScore(updatedCoinstakes);
 
-    return TopElevenBestCoinstakesNeedUpdating(
-        activations.IsActive(Fork::UniformLotteryWinners),
-        rankedScoreAwareCoinstakes,
-        updatedCoinstakes);
+    const size_t last = scoredCoinstakes.count - 1;
+    bool shouldUpdateCoinstakeData = scoredCoinstakes.count > 1 ? scoredCoinstakes.ranks[last] != numberOfLotteryWinners : true;
+    if(scoredCoinstakes.count > numberOfLotteryWinners)
+    {
+        size_t lastDuplicate = scoredCoinstakes.count;
+        if(activations.IsActive(Fork::UniformLotteryWinners))
+        {
+            for(size_t position = scoredCoinstakes.count; position > 0 && lastDuplicate == scoredCoinstakes.count; --position)
+            {
+                if(scoredCoinstakes.isDuplicateScript[position - 1]) lastDuplicate = position - 1;
+            }
+        }
+        if(lastDuplicate != scoredCoinstakes.count)
+        {
+            updatedCoinstakes.erase(updatedCoinstakes.begin() + lastDuplicate);
+            shouldUpdateCoinstakeData = true;
+        }
+        else
+        {
+            updatedCoinstakes.pop_back();
+        }
+    }
+    return shouldUpdateCoinstakeData;
 }
 
 LotteryCoinstakeData LotteryWinnersCalculator::CalculateUpdatedLotteryWinners(
@@ -1,6 +1,9 @@
 #ifndef LOTTERY_WINNERS_CALCULATOR_H
 #define LOTTERY_WINNERS_CALCULATOR_H
 #include <LotteryCoinstakes.h>
+#include <sync.h>
+
+#include <vector>
 
 class CBlockIndex;
 class CTransaction;
@@ -22,7 +25,13 @@ private:
     const CChain& activeChain_;
     const CSporkManager& sporkManager_;
     const I_SuperblockHeightValidator& superblockHeightValidator_;
+    // The winners' scripts of the prior lottery cycles, sorted, for the lottery cycle they veto
+    mutable CCriticalSection cs_vetoedScripts_;
+    mutable uint256 vetoedScriptsBlockHash_;
+    mutable int vetoedScriptsLotteryHeight_;
+    mutable std::vector<CScript> vetoedScripts_;
     int minimumCoinstakeForTicket(int nHeight) const;
+    bool UpdateVetoedPaymentScripts(const int blockHeight) const;
     bool IsPaymentScriptVetoed(const CScript& paymentScript, const int blockHeight) const;
     bool TopElevenBestCoinstakesNeedUpdating(
         bool trimDuplicates,
@@ -40,6 +49,8 @@ public:
     bool IsCoinstakeValidForLottery(const CTransaction &tx, int nHeight) const;
     CBlockIndex* GetLastLotteryBlockIndexBeforeHeight(int blockHeight) const;
     bool UpdateCoinstakes(int nextBlockHeight, LotteryCoinstakes& updatedCoinstakes) const;
+    //! The winners' scripts that may not win the lottery the block at blockHeight is in, and whether such vetoes apply
+    bool GetVetoedPaymentScripts(const int blockHeight, std::vector<CScript>& vetoedScripts) const;
     LotteryCoinstakeData CalculateUpdatedLotteryWinners(const CTransaction& coinMintTransaction, const LotteryCoinstakeData& previousBlockLotteryCoinstakeData, int nHeight) const;
 };
 #endif // LOTTERY_WINNERS_CALCULATOR_H
\ No newline at end of file
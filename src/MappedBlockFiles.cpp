@@ -0,0 +1,95 @@
+#include <MappedBlockFiles.h>
+
+#include <BlockFileOpener.h>
+#include <chain.h>
+#include <Logging.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedBlockFile::MappedBlockFile(
+    const char* data,
+    size_t size
+    ): data_(data)
+    , size_(size)
+{
+}
+
+MappedBlockFile::~MappedBlockFile()
+{
+#ifndef WIN32
+    munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+MappedBlockFiles::MappedBlockFiles(
+    size_t maxMappedFiles
+    ): mutex_()
+    , maxMappedFiles_(maxMappedFiles)
+    , mappings_()
+{
+}
+
+MappedBlockFiles::MappingRef MappedBlockFiles::MapFile(int nFile)
+{
+#ifdef WIN32
+    return MappingRef();
+#else
+    FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0), true);
+    if (!file)
+        return MappingRef();
+    // Compressed block files are streams without a descriptor to map.
+    if (fileno(file) < 0) {
+        fclose(file);
+        return MappingRef();
+    }
+    // The mapping stays valid once the file is closed.
+    struct stat fileStatus;
+    void* data = MAP_FAILED;
+    if (fstat(fileno(file), &fileStatus) == 0 && fileStatus.st_size > 0)
+        data = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_SHARED, fileno(file), 0);
+    fclose(file);
+    if (data == MAP_FAILED) {
+        LogPrint(LOG_BLOCKFILES, "%s : unable to map block file %d\n", __func__, nFile);
+        return MappingRef();
+    }
+    return MappingRef(new MappedBlockFile(static_cast<const char*>(data), fileStatus.st_size));
+#endif
+}
+
+MappedBlockFiles::MappingRef MappedBlockFiles::Get(int nFile, uint64_t nEnd)
+{
+    if (maxMappedFiles_ == 0)
+        return MappingRef();
+
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    for (std::list<std::pair<int, MappingRef> >::iterator it = mappings_.begin(); it != mappings_.end(); ++it) {
+        if (it->first != nFile)
+            continue;
+        if (it->second->size() >= nEnd) {
+            mappings_.splice(mappings_.begin(), mappings_, it);
+            return it->second;
+        }
+        // The file grew since it was mapped.
+        mappings_.erase(it);
+        break;
+    }
+
+    MappingRef mapping = MapFile(nFile);
+    if (!mapping)
+        return mapping;
+    mappings_.push_front(std::make_pair(nFile, mapping));
+    if (mappings_.size() > maxMappedFiles_)
+        mappings_.pop_back();
+    if (mapping->size() < nEnd)
+        return MappingRef();
+    return mapping;
+}
+
+void MappedBlockFiles::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    mappings_.clear();
+}
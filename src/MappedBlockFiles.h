@@ -0,0 +1,60 @@
+#ifndef MAPPED_BLOCK_FILES_H
+#define MAPPED_BLOCK_FILES_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+
+/** Read-only mapping of a whole block file, unmapped once the last reader lets go */
+class MappedBlockFile
+{
+private:
+    MappedBlockFile(const MappedBlockFile&);
+    MappedBlockFile& operator=(const MappedBlockFile&);
+
+    const char* data_;
+    size_t size_;
+
+public:
+    MappedBlockFile(const char* data, size_t size);
+    ~MappedBlockFile();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
+/**
+ * Small pool of memory-mapped block files for the threads reading blocks.
+ *
+ * Readers deserialize straight from the mapping instead of opening, seeking
+ * and reading the file for every block. A file still being appended to is
+ * mapped anew once a block past the end of its current mapping is asked for;
+ * readers holding the older mapping keep it until they are done.
+ */
+class MappedBlockFiles
+{
+public:
+    typedef std::shared_ptr<const MappedBlockFile> MappingRef;
+
+private:
+    boost::mutex mutex_;
+    const size_t maxMappedFiles_;
+    //! Most recently used first
+    std::list<std::pair<int, MappingRef> > mappings_;
+
+    static MappingRef MapFile(int nFile);
+
+public:
+    explicit MappedBlockFiles(size_t maxMappedFiles);
+
+    //! Mapping of block file nFile that covers its first nEnd bytes, or NULL if it cannot be mapped
+    MappingRef Get(int nFile, uint64_t nEnd);
+
+    //! Drop all mappings once their readers are done, e.g. before the block files are rewritten
+    void Clear();
+};
+#endif// MAPPED_BLOCK_FILES_H
@@ -63,7 +63,7 @@ bool checkBlockchainSync(std::string& strErrorRet, bool fOffline)
 {
      if (!fOffline && !IsBlockchainSynced()) {
         strErrorRet = "Sync in progress. Must wait until sync is complete to start Masternode";
-        LogPrint("masternode","CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
+        LogPrint(LOG_MASTERNODE,"CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
         return false;
     }
     return true;
@@ -75,7 +75,7 @@ bool setMasternodeKeys(
 {
     if (!CObfuScationSigner::GetKeysFromSecret(strKeyMasternode, masternodeKeyPair.first, masternodeKeyPair.second)) {
         strErrorRet = strprintf("Invalid masternode key %s", strKeyMasternode);
-        LogPrint("masternode","CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
+        LogPrint(LOG_MASTERNODE,"CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
         return false;
     }
     return true;
@@ -97,7 +97,7 @@ bool setMasternodeCollateralKeys(
     if (!GetVinAndKeysFromOutput(keyStore,scriptPubKey, masternodeCollateralKeyPair.second, masternodeCollateralKeyPair.first))
     {
         strError = strprintf("Could not allocate txin %s:%s for masternode", outpoint.hash.ToString(), std::to_string(outpoint.n));
-        LogPrint("masternode","CMasternodeBroadcastFactory::Create -- %s\n", strError);
+        LogPrint(LOG_MASTERNODE,"CMasternodeBroadcastFactory::Create -- %s\n", strError);
         return false;
     }
     return true;
@@ -113,7 +113,7 @@ bool checkMasternodeCollateral(
     if(!CMasternode::IsTierValid(nMasternodeTier))
     {
         strErrorRet = strprintf("Invalid tier selected for masternode %s, collateral value is: %d", service, collateralAmount);
-        LogPrint("masternode","CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
+        LogPrint(LOG_MASTERNODE,"CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
         return false;
     }
     return true;
@@ -134,7 +134,7 @@ bool createArgumentsFromConfig(
     std::string strKeyMasternode = configEntry.getPrivKey();
     std::string strTxHash = configEntry.getTxHash();
     std::string strOutputIndex = configEntry.getOutputIndex();
-    CTransaction fundingTx;
+    CTxOut collateralOutput;
     uint256 blockHash;
 
     if (fImporting || fReindex) return false;
@@ -143,14 +143,14 @@ bool createArgumentsFromConfig(
     {
         return false;
     }
-    if(!GetTransaction(txin.prevout.hash,fundingTx,blockHash,true))
+    if(!GetTransactionOutput(txin.prevout,collateralOutput,blockHash,true))
     {
         strErrorRet = strprintf("Could not find txin %s:%s for masternode", strTxHash, strOutputIndex);
-        LogPrint("masternode","CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
+        LogPrint(LOG_MASTERNODE,"CMasternodeBroadcastFactory::Create -- %s\n", strErrorRet);
         return false;
     }
-    const CScript& collateralScript = fundingTx.vout[txin.prevout.n].scriptPubKey;
-    const CAmount& collateralAmount = fundingTx.vout[txin.prevout.n].nValue;
+    const CScript& collateralScript = collateralOutput.scriptPubKey;
+    const CAmount& collateralAmount = collateralOutput.nValue;
     //need correct blocks to send ping
     if (!checkBlockchainSync(strErrorRet,fOffline)||
         !setMasternodeKeys(strKeyMasternode,masternodeKeyPair,strErrorRet) ||
@@ -270,7 +270,7 @@ bool CMasternodeBroadcastFactory::signPing(
     if(!CObfuScationSigner::SignAndVerify<CMasternodePing>(mnp,keyMasternodeNew,pubKeyMasternodeNew,strErrorRet))
     {
         strErrorRet = strprintf("Failed to sign ping, masternode=%s", mnp.vin.prevout.hash.ToString());
-        LogPrint("masternode","%s -- %s\n",__func__, strErrorRet);
+        LogPrint(LOG_MASTERNODE,"%s -- %s\n",__func__, strErrorRet);
         return false;
     }
     return true;
@@ -284,7 +284,7 @@ bool CMasternodeBroadcastFactory::signBroadcast(
     if (! CObfuScationSigner::SignAndVerify<CMasternodeBroadcast>(mnb,keyCollateralAddressNew,mnb.pubKeyCollateralAddress,strErrorRet))
     {
         strErrorRet = strprintf("Failed to sign broadcast, masternode=%s", mnb.vin.prevout.hash.ToString());
-        LogPrint("masternode","%s -- %s\n", __func__, strErrorRet);
+        LogPrint(LOG_MASTERNODE,"%s -- %s\n", __func__, strErrorRet);
         mnb = CMasternodeBroadcast();
         return false;
     }
@@ -323,7 +323,7 @@ CMasternodePing createDelayedMasternodePing(const CMasternodeBroadcast& mnb)
     ping.blockHash = block->GetBlockHash();
     ping.sigTime = std::max(block->GetBlockTime() + offsetTimeBy45BlocksInSeconds, GetAdjustedTime());
     ping.signature = std::vector<unsigned char>();
-    LogPrint("masternode","mnp - relay block-time & sigtime: %d vs. %d\n", block->GetBlockTime(), ping.sigTime);
+    LogPrint(LOG_MASTERNODE,"mnp - relay block-time & sigtime: %d vs. %d\n", block->GetBlockTime(), ping.sigTime);
 
     return ping;
 }
@@ -339,7 +339,7 @@ void CMasternodeBroadcastFactory::createWithoutSignatures(
     bool deferRelay,
     CMasternodeBroadcast& mnbRet)
 {
-    LogPrint("masternode", "CMasternodeBroadcastFactory::createWithoutSignatures -- pubKeyCollateralAddressNew = %s, pubKeyMasternodeNew.GetID() = %s\n",
+    LogPrint(LOG_MASTERNODE, "CMasternodeBroadcastFactory::createWithoutSignatures -- pubKeyCollateralAddressNew = %s, pubKeyMasternodeNew.GetID() = %s\n",
              CBitcoinAddress(pubKeyCollateralAddressNew.GetID()).ToString(),
              pubKeyMasternodeNew.GetID().ToString());
 
@@ -360,10 +360,10 @@ void CMasternodeBroadcastFactory::createWithoutSignatures(
            enough to be later than the confirmation block time assuming the
            collateral is going to be mined "now".  */
         mnbRet.sigTime = GetAdjustedTime() + 45 * 60;
-        LogPrint("masternode", "Using future sigtime for masternode broadcast: %d\n", mnbRet.sigTime);
+        LogPrint(LOG_MASTERNODE, "Using future sigtime for masternode broadcast: %d\n", mnbRet.sigTime);
     } else {
         mnbRet.sigTime = pindexConf->GetBlockTime();
-        LogPrint("masternode", "Using collateral confirmation time for broadcast: %d\n", mnbRet.sigTime);
+        LogPrint(LOG_MASTERNODE, "Using collateral confirmation time for broadcast: %d\n", mnbRet.sigTime);
     }
 }
 
@@ -14,6 +14,7 @@ extern bool fImporting;
 extern bool fReindex;
 extern CChain chainActive;
 extern BlockMap mapBlockIndex;
+const CBlockIndex* GetChainTipSnapshot();
 
 static bool mnResyncRequested  = false;
 bool MasternodeResyncIsRequested()
@@ -46,10 +47,7 @@ bool IsBlockchainSynced()
 
     if (fImporting || fReindex) return false;
 
-    TRY_LOCK(cs_main, lockMain);
-    if (!lockMain) return false;
-
-    CBlockIndex* pindex = chainActive.Tip();
+    const CBlockIndex* pindex = GetChainTipSnapshot();
     if (pindex == NULL) return false;
 
 
@@ -87,7 +85,7 @@ const CBlockIndex* ComputeCollateralBlockIndex(const CMasternode& masternode)
 {
     static std::map<COutPoint,const CBlockIndex*> cachedCollateralBlockIndices;
 
-    const CBlockIndex* collateralBlockIndex = cachedCollateralBlockIndices[masternode.vin.prevout];
+    const CBlockIndex*& collateralBlockIndex = cachedCollateralBlockIndices[masternode.vin.prevout];
     if (collateralBlockIndex)
     {
         if(chainActive.Contains(collateralBlockIndex))
@@ -96,9 +94,16 @@ const CBlockIndex* ComputeCollateralBlockIndex(const CMasternode& masternode)
         }
     }
 
+    // An unspent collateral is found without reading its block, a spent one is still looked up
+    CTxOut collateral;
+    int nHeight;
+    if (GetUnspentTransactionOutput(masternode.vin.prevout, collateral, nHeight)) {
+        collateralBlockIndex = chainActive[nHeight];
+        return collateralBlockIndex;
+    }
+
     uint256 hashBlock;
-    CTransaction tx;
-    if (!GetTransaction(masternode.vin.prevout.hash, tx, hashBlock, true)) {
+    if (!GetTransactionOutput(masternode.vin.prevout, collateral, hashBlock, true)) {
         collateralBlockIndex = nullptr;
         return collateralBlockIndex;
     }
@@ -1,6 +1,7 @@
 #include <MasternodeModule.h>
 
 #include <utiltime.h>
+#include <algorithm>
 #include <chrono>
 
 #include <masternode-sync.h>
@@ -28,11 +29,15 @@
 
 #include <blockmap.h>
 #include <ThreadManagementHelpers.h>
+#include <PerformanceStatistics.h>
+#include <MintingWakeup.h>
 
 
 bool fLiteMode = false;
 extern CChain chainActive;
 extern BlockMap mapBlockIndex;
+void RegisterValidationInterface(NotificationInterface* pwalletIn);
+void UnregisterValidationInterface(NotificationInterface* pwalletIn);
 
 MasternodeModule::MasternodeModule(
     const CChain& activeChain,
@@ -178,6 +183,17 @@ CMasternodePayments& GetMasternodePayments()
     return masternodePayments;
 }
 
+size_t MasternodeDynamicMemoryUsage()
+{
+    return networkMessageManager.DynamicMemoryUsage() + masternodePayments.DynamicMemoryUsage();
+}
+
+uint32_t MasternodeListSize()
+{
+    LOCK(networkMessageManager.cs);
+    return networkMessageManager.masternodeCount();
+}
+
 bool LoadMasternodeDataFromDisk(UIMessenger& uiMessenger,std::string pathToDataDir)
 {
     if (!fLiteMode)
@@ -220,15 +236,20 @@ const CMasternodeSync& GetMasternodeSync()
     return masternodeSync;
 }
 
+// Wakes the background thread on new tips, for it to sleep between its periodic tasks once synced
+static MintingWakeup masternodeSyncWakeup;
+
 void ForceMasternodeResync()
 {
     masternodeSync.Reset();
+    masternodeSyncWakeup.Notify();
 }
 
 bool ShareMasternodePingWithPeer(CNode* peer,const uint256& inventoryHash)
 {
-    if (networkMessageManager.pingIsKnown(inventoryHash)) {
-        peer->PushMessage("mnp", networkMessageManager.getKnownPing(inventoryHash));
+    CMasternodePing mnp;
+    if (networkMessageManager.getKnownPing(inventoryHash, mnp)) {
+        peer->PushMessage("mnp", mnp);
         return true;
     }
     return false;
@@ -236,9 +257,10 @@ bool ShareMasternodePingWithPeer(CNode* peer,const uint256& inventoryHash)
 
 bool ShareMasternodeBroadcastWithPeer(CNode* peer,const uint256& inventoryHash)
 {
-    if (networkMessageManager.broadcastIsKnown(inventoryHash))
+    CMasternodeBroadcast mnb;
+    if (networkMessageManager.getKnownBroadcast(inventoryHash, mnb))
     {
-        peer->PushMessage("mnb", networkMessageManager.getKnownBroadcast(inventoryHash));
+        peer->PushMessage("mnb", mnb);
         return true;
     }
     return false;
@@ -283,6 +305,7 @@ bool MasternodeWinnerIsKnown(const uint256& inventoryHash)
 
 void ProcessMasternodeMessages(CNode* pfrom, std::string strCommand, CDataStream& vRecv)
 {
+    PerformanceTimerScope timer(PerformanceTimer::MASTERNODE_MESSAGE);
     if(!fLiteMode)
     {
         mnodeman.ProcessMessage(activeMasternode,masternodeSync,pfrom, strCommand, vRecv);
@@ -302,19 +325,19 @@ bool VoteForMasternodePayee(const CBlockIndex* pindex)
 
     uint256 seedHash;
     if (!GetBlockHashForScoring(seedHash, pindex, numberOfBlocksIntoTheFutureToVoteOn)) {
-        LogPrint("mnpayments", "CMasternodePayments::ProcessBlock - failed to compute seed hash\n");
+        LogPrint(LOG_MNPAYMENTS, "CMasternodePayments::ProcessBlock - failed to compute seed hash\n");
         return false;
     }
 
     const unsigned n = masternodePayments.GetMasternodeRank(activeMasternode.vin, seedHash, ActiveProtocol(), CMasternodePayments::MNPAYMENTS_SIGNATURES_TOTAL);
 
     if (n == static_cast<unsigned>(-1)) {
-        LogPrint("mnpayments", "CMasternodePayments::ProcessBlock - Unknown Masternode\n");
+        LogPrint(LOG_MNPAYMENTS, "CMasternodePayments::ProcessBlock - Unknown Masternode\n");
         return false;
     }
 
     if (n > CMasternodePayments::MNPAYMENTS_SIGNATURES_TOTAL) {
-        LogPrint("mnpayments", "CMasternodePayments::ProcessBlock - Masternode not in the top %d (%d)\n", CMasternodePayments::MNPAYMENTS_SIGNATURES_TOTAL, n);
+        LogPrint(LOG_MNPAYMENTS, "CMasternodePayments::ProcessBlock - Masternode not in the top %d (%d)\n", CMasternodePayments::MNPAYMENTS_SIGNATURES_TOTAL, n);
         return false;
     }
 
@@ -322,24 +345,24 @@ bool VoteForMasternodePayee(const CBlockIndex* pindex)
 
     CMasternodePaymentWinner newWinner(activeMasternode.vin, nBlockHeight, seedHash);
 
-    LogPrint("masternode","CMasternodePayments::ProcessBlock() Start nHeight %d - vin %s. \n", nBlockHeight, activeMasternode.vin.prevout.hash);
+    LogPrint(LOG_MASTERNODE,"CMasternodePayments::ProcessBlock() Start nHeight %d - vin %s. \n", nBlockHeight, activeMasternode.vin.prevout.hash);
 
     // pay to the oldest MN that still had no payment but its input is old enough and it was active long enough
     CScript payee = masternodePayments.GetNextMasternodePayeeInQueueForPayment(pindex, numberOfBlocksIntoTheFutureToVoteOn);
 
     if (!payee.empty()) {
-        LogPrint("masternode","CMasternodePayments::ProcessBlock() Found by FindOldestNotInVec \n");
+        LogPrint(LOG_MASTERNODE,"CMasternodePayments::ProcessBlock() Found by FindOldestNotInVec \n");
 
         newWinner.AddPayee(payee);
-        LogPrint("masternode","CMasternodePayments::ProcessBlock() WinnerPayee %s nHeight %d. \n", payee, newWinner.GetHeight());
+        LogPrint(LOG_MASTERNODE,"CMasternodePayments::ProcessBlock() WinnerPayee %s nHeight %d. \n", payee, newWinner.GetHeight());
     } else {
-        LogPrint("masternode","CMasternodePayments::ProcessBlock() Failed to find masternode to pay\n");
+        LogPrint(LOG_MASTERNODE,"CMasternodePayments::ProcessBlock() Failed to find masternode to pay\n");
     }
 
-    LogPrint("masternode","CMasternodePayments::ProcessBlock() - Signing Winner\n");
+    LogPrint(LOG_MASTERNODE,"CMasternodePayments::ProcessBlock() - Signing Winner\n");
     if(masternodePayments.CanVote(newWinner.vinMasternode.prevout,seedHash) && activeMasternode.SignMasternodeWinner(newWinner))
     {
-        LogPrint("masternode","CMasternodePayments::ProcessBlock() - AddWinningMasternode\n");
+        LogPrint(LOG_MASTERNODE,"CMasternodePayments::ProcessBlock() - AddWinningMasternode\n");
 
         if (masternodePayments.AddWinningMasternode(newWinner)) {
             newWinner.Relay();
@@ -349,7 +372,7 @@ bool VoteForMasternodePayee(const CBlockIndex* pindex)
     }
     else
     {
-        LogPrint("masternode","%s - Error signing masternode winner\n", __func__);
+        LogPrint(LOG_MASTERNODE,"%s - Error signing masternode winner\n", __func__);
     }
 
 
@@ -382,37 +405,53 @@ void ThreadMasternodeBackgroundSync()
 
     int64_t nTimeManageStatus = 0;
     int64_t nTimeConnections = 0;
+    // Poll every second while syncing, or on regtest where tests drive the sync with mocktime
+    bool fPolling = true;
+
+    RegisterValidationInterface(&masternodeSyncWakeup);
+    uint64_t wakeupsSeen = masternodeSyncWakeup.NumberOfWakeups();
+    try {
+        while (true) {
+            int64_t now;
+            if (fPolling) {
+                boost::unique_lock<boost::mutex> lock(csMockTime);
+                cvMockTimeChanged.wait_for(lock, boost::chrono::seconds(1));
+                now = GetTime();
+            } else {
+                const int64_t nTimeNextTask = std::min(nTimeManageStatus + MASTERNODE_PING_SECONDS, nTimeConnections + 60);
+                masternodeSyncWakeup.WaitFor(1000 * (nTimeNextTask - GetTime()), wakeupsSeen);
+                now = GetTime();
+            }
+            wakeupsSeen = masternodeSyncWakeup.NumberOfWakeups();
+
+            // try to sync from all available nodes, one step at a time
+            //
+            // this function keeps track of its own "last call" time and
+            // ignores calls if they are too early
+            if(MasternodeResyncIsRequested())
+            {
+                masternodeSync.Reset();
+                FulfilledMasternodeResyncRequest();
+            }
+            masternodeSync.Process(regtest);
+            fPolling = true;
+            if(!IsBlockchainSynced()) continue;
+            // check if we should activate or ping every few minutes,
+            // start right after sync is considered to be done
+            if (now >= nTimeManageStatus + MASTERNODE_PING_SECONDS) {
+                nTimeManageStatus = now;
+                activeMasternode.ManageStatus(mnodeman);
+            }
 
-    while (true) {
-        int64_t now;
-        {
-            boost::unique_lock<boost::mutex> lock(csMockTime);
-            cvMockTimeChanged.wait_for(lock, boost::chrono::seconds(1));
-            now = GetTime();
-        }
-
-        // try to sync from all available nodes, one step at a time
-        //
-        // this function keeps track of its own "last call" time and
-        // ignores calls if they are too early
-        if(MasternodeResyncIsRequested())
-        {
-            masternodeSync.Reset();
-            FulfilledMasternodeResyncRequest();
-        }
-        masternodeSync.Process(regtest);
-        if(!IsBlockchainSynced()) continue;
-        // check if we should activate or ping every few minutes,
-        // start right after sync is considered to be done
-        if (now >= nTimeManageStatus + MASTERNODE_PING_SECONDS) {
-            nTimeManageStatus = now;
-            activeMasternode.ManageStatus(mnodeman);
-        }
-
-        if (now >= nTimeConnections + 60) {
-            nTimeConnections = now;
-            mnodeman.CheckAndRemoveInnactive(masternodeSync);
-            masternodePayments.PruneOldMasternodeWinnerData(masternodeSync);
+            if (now >= nTimeConnections + 60) {
+                nTimeConnections = now;
+                mnodeman.CheckAndRemoveInnactive(masternodeSync);
+                masternodePayments.PruneOldMasternodeWinnerData(masternodeSync);
+            }
+            fPolling = regtest || !masternodeSync.IsSynced() || MasternodeResyncIsRequested();
         }
+    } catch (const boost::thread_interrupted&) {
+        UnregisterValidationInterface(&masternodeSyncWakeup);
+        throw;
     }
 }
@@ -2,6 +2,7 @@
 #define MASTERNODE_MODULE_H
 #include <string>
 #include <primitives/transaction.h>
+#include <streams.h>
 #include <functional>
 #include <stdint.h>
 #include <vector>
@@ -9,7 +10,6 @@
 
 class Settings;
 class CBlockIndex;
-class CDataStream;
 class CNode;
 class CMasternodeSync;
 class UIMessenger;
@@ -54,6 +54,9 @@ public:
 
 const CMasternodeSync& GetMasternodeSync();
 CMasternodePayments& GetMasternodePayments();
+//! Bytes of memory the masternode list, the messages seen and the payment votes take up
+size_t MasternodeDynamicMemoryUsage();
+uint32_t MasternodeListSize();
 
 void ThreadMasternodeBackgroundSync();
 void LockUpMasternodeCollateral(const Settings& settings, std::function<void(const COutPoint&)> walletUtxoLockingFunction);
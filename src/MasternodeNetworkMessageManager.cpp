@@ -1,20 +1,30 @@
 #include <MasternodeNetworkMessageManager.h>
 
 #include <Logging.h>
+#include <memusage.h>
 #include <utiltime.h>
 #include <masternode-sync.h>
 
+#include <algorithm>
+
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
 #define MASTERNODE_MIN_MNP_SECONDS (10 * 60)
 
 MasternodeNetworkMessageManager::MasternodeNetworkMessageManager(
-    ): masternodes()
+    ): masternodeIndexByCollateral_()
+    , masternodeIndexByKey_()
+    , masternodeListGeneration_(0)
+    , seenBroadcastTimes_()
+    , seenPingTimes_()
+    , latestBroadcasts_()
+    , latestBroadcastByCollateral_()
+    , latestPings_()
+    , latestPingByCollateral_()
+    , masternodes()
     , mAskedUsForMasternodeList()
     , mWeAskedForMasternodeList()
     , mWeAskedForMasternodeListEntry()
     , nDsqCount(0)
-    , mapSeenMasternodeBroadcast()
-    , mapSeenMasternodePing()
 {
 
 }
@@ -24,6 +34,133 @@ uint32_t MasternodeNetworkMessageManager::masternodeCount() const
     return masternodes.size();
 }
 
+size_t MasternodeNetworkMessageManager::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    return memusage::DynamicUsage(masternodes) + memusage::DynamicUsage(masternodeIndexByCollateral_) +
+           memusage::DynamicUsage(masternodeIndexByKey_) + memusage::DynamicUsage(seenBroadcastTimes_) +
+           memusage::DynamicUsage(seenPingTimes_) + memusage::DynamicUsage(latestBroadcasts_) +
+           memusage::DynamicUsage(latestBroadcastByCollateral_) + memusage::DynamicUsage(latestPings_) +
+           memusage::DynamicUsage(latestPingByCollateral_) + memusage::DynamicUsage(mAskedUsForMasternodeList) +
+           memusage::DynamicUsage(mWeAskedForMasternodeList) + memusage::DynamicUsage(mWeAskedForMasternodeListEntry);
+}
+
+uint64_t MasternodeNetworkMessageManager::masternodeListGeneration() const
+{
+    LOCK(cs);
+    return masternodeListGeneration_;
+}
+
+int64_t MasternodeNetworkMessageManager::newestPingTime() const
+{
+    LOCK(cs);
+    int64_t newestTime = 0;
+    for (const CMasternode& mn: masternodes)
+    {
+        newestTime = std::max(newestTime, mn.lastPing.sigTime);
+    }
+    return newestTime;
+}
+
+CMasternode* MasternodeNetworkMessageManager::findMasternode(const COutPoint& collateral)
+{
+    LOCK(cs);
+    auto it = masternodeIndexByCollateral_.find(collateral);
+    return it != masternodeIndexByCollateral_.end()? &masternodes[it->second]: nullptr;
+}
+
+CMasternode* MasternodeNetworkMessageManager::findMasternode(const CPubKey& pubKeyMasternode)
+{
+    LOCK(cs);
+    const CKeyID keyID = pubKeyMasternode.GetID();
+    auto it = masternodeIndexByKey_.find(keyID);
+    if (it != masternodeIndexByKey_.end() && masternodes[it->second].pubKeyMasternode == pubKeyMasternode) {
+        return &masternodes[it->second];
+    }
+
+    // Masternodes can share a key, so one that lost its entry to another is looked for
+    for (size_t position = 0; position < masternodes.size(); ++position) {
+        if (masternodes[position].pubKeyMasternode == pubKeyMasternode) {
+            masternodeIndexByKey_[keyID] = position;
+            return &masternodes[position];
+        }
+    }
+    return nullptr;
+}
+
+bool MasternodeNetworkMessageManager::addMasternode(const CMasternode& mn)
+{
+    LOCK(cs);
+    if (masternodeIndexByCollateral_.count(mn.vin.prevout)) return false;
+
+    masternodeIndexByCollateral_[mn.vin.prevout] = masternodes.size();
+    masternodeIndexByKey_[mn.pubKeyMasternode.GetID()] = masternodes.size();
+    masternodes.push_back(mn);
+    ++masternodeListGeneration_;
+    return true;
+}
+
+void MasternodeNetworkMessageManager::removeMasternode(const COutPoint& collateral)
+{
+    LOCK(cs);
+    auto it = masternodeIndexByCollateral_.find(collateral);
+    if (it == masternodeIndexByCollateral_.end()) return;
+
+    const size_t position = it->second;
+    masternodeIndexByCollateral_.erase(it);
+    auto keyIt = masternodeIndexByKey_.find(masternodes[position].pubKeyMasternode.GetID());
+    if (keyIt != masternodeIndexByKey_.end() && keyIt->second == position) masternodeIndexByKey_.erase(keyIt);
+
+    const size_t lastPosition = masternodes.size() - 1;
+    if (position != lastPosition) {
+        masternodes[position] = masternodes[lastPosition];
+        masternodeIndexByCollateral_[masternodes[position].vin.prevout] = position;
+        reindexMasternode(masternodes[position]);
+    }
+    masternodes.pop_back();
+    ++masternodeListGeneration_;
+}
+
+void MasternodeNetworkMessageManager::reindexMasternode(const CMasternode& mn)
+{
+    LOCK(cs);
+    auto it = masternodeIndexByCollateral_.find(mn.vin.prevout);
+    if (it == masternodeIndexByCollateral_.end()) return;
+
+    // The entry of a previous key is left in place, lookups check the key of the masternode they find
+    masternodeIndexByKey_[mn.pubKeyMasternode.GetID()] = it->second;
+    ++masternodeListGeneration_;
+}
+
+void MasternodeNetworkMessageManager::rebuildMasternodeIndexes()
+{
+    masternodeIndexByCollateral_.clear();
+    masternodeIndexByKey_.clear();
+    for (size_t position = 0; position < masternodes.size(); ++position) {
+        masternodeIndexByCollateral_[masternodes[position].vin.prevout] = position;
+        masternodeIndexByKey_[masternodes[position].pubKeyMasternode.GetID()] = position;
+    }
+    ++masternodeListGeneration_;
+}
+
+void MasternodeNetworkMessageManager::rebuildSeenMessages()
+{
+    std::map<uint256, CMasternodeBroadcast> broadcasts;
+    std::map<uint256, CMasternodePing> pings;
+    broadcasts.swap(latestBroadcasts_);
+    pings.swap(latestPings_);
+    latestBroadcastByCollateral_.clear();
+    latestPingByCollateral_.clear();
+    seenBroadcastTimes_.clear();
+    seenPingTimes_.clear();
+    for (const auto& broadcast: broadcasts) {
+        recordBroadcast(broadcast.second);
+    }
+    for (const auto& ping: pings) {
+        recordPing(ping.second);
+    }
+}
+
 const std::vector<CMasternode>& MasternodeNetworkMessageManager::GetFullMasternodeVector() const
 {
     LOCK(cs);
@@ -69,38 +206,62 @@ void MasternodeNetworkMessageManager::clearTimedOutMasternodeEntryRequests()
 
 void MasternodeNetworkMessageManager::clearTimedOutMasternodePings()
 {
-    std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-    while (it4 != mapSeenMasternodePing.end()) {
-        if ((*it4).second.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
-            mapSeenMasternodePing.erase(it4++);
+    const int64_t cutoffTime = GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2);
+    std::map<uint256, int64_t>::iterator it = seenPingTimes_.begin();
+    while (it != seenPingTimes_.end()) {
+        if ((*it).second < cutoffTime) {
+            seenPingTimes_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    std::map<uint256, CMasternodePing>::iterator it2 = latestPings_.begin();
+    while (it2 != latestPings_.end()) {
+        if ((*it2).second.sigTime < cutoffTime) {
+            latestPingByCollateral_.erase((*it2).second.vin.prevout);
+            latestPings_.erase(it2++);
         } else {
-            ++it4;
+            ++it2;
         }
     }
 }
 
 void MasternodeNetworkMessageManager::clearTimedOutMasternodeBroadcasts(CMasternodeSync& masternodeSynchronization)
 {
-    std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
-    while (it3 != mapSeenMasternodeBroadcast.end()) {
-        if ((*it3).second.lastPing.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
-            mapSeenMasternodeBroadcast.erase(it3++);
-            masternodeSynchronization.mapSeenSyncMNB.erase((*it3).second.GetHash());
+    const int64_t cutoffTime = GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2);
+    std::map<uint256, int64_t>::iterator it = seenBroadcastTimes_.begin();
+    while (it != seenBroadcastTimes_.end()) {
+        if ((*it).second < cutoffTime) {
+            masternodeSynchronization.mapSeenSyncMNB.erase((*it).first);
+            seenBroadcastTimes_.erase(it++);
         } else {
-            ++it3;
+            ++it;
+        }
+    }
+
+    std::map<uint256, CMasternodeBroadcast>::iterator it2 = latestBroadcasts_.begin();
+    while (it2 != latestBroadcasts_.end()) {
+        if ((*it2).second.lastPing.sigTime < cutoffTime) {
+            masternodeSynchronization.mapSeenSyncMNB.erase((*it2).first);
+            seenBroadcastTimes_.erase((*it2).first);
+            latestBroadcastByCollateral_.erase((*it2).second.vin.prevout);
+            latestBroadcasts_.erase(it2++);
+        } else {
+            ++it2;
         }
     }
 }
 void MasternodeNetworkMessageManager::clearExpiredMasternodeBroadcasts(const COutPoint& collateral, CMasternodeSync& masternodeSynchronization)
 {
-    std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
-    while (it3 != mapSeenMasternodeBroadcast.end()) {
-        if ((*it3).second.vin.prevout == collateral) {
-            masternodeSynchronization.mapSeenSyncMNB.erase((*it3).first);
-            mapSeenMasternodeBroadcast.erase(it3++);
-        } else {
-            ++it3;
-        }
+    // The latest broadcast is forgotten so that the masternode is taken back when it is seen again,
+    // the older ones would not be accepted anyway
+    std::map<COutPoint, uint256>::iterator it = latestBroadcastByCollateral_.find(collateral);
+    if (it != latestBroadcastByCollateral_.end()) {
+        masternodeSynchronization.mapSeenSyncMNB.erase((*it).second);
+        seenBroadcastTimes_.erase((*it).second);
+        latestBroadcasts_.erase((*it).second);
+        latestBroadcastByCollateral_.erase(it);
     }
 }
 
@@ -135,7 +296,7 @@ bool MasternodeNetworkMessageManager::recordDsegUpdateAttempt(const CAddress& pe
         std::map<CNetAddr, int64_t>::iterator it = mWeAskedForMasternodeList.find(peerAddress);
         if (it != mWeAskedForMasternodeList.end()) {
             if (GetTime() < (*it).second) {
-                LogPrint("masternode", "dseg - we already asked peer %s for the list; skipping...\n", peerAddress);
+                LogPrint(LOG_MASTERNODE, "dseg - we already asked peer %s for the list; skipping...\n", peerAddress);
                 return false;
             }
         }
@@ -156,7 +317,7 @@ bool MasternodeNetworkMessageManager::recordMasternodeEntryRequestAttempt(const
 
     // ask for the mnb info once from the node that sent mnp
 
-    LogPrint("masternode", "%s - Asking node for missing entry, vin: %s\n", __func__, masternodeCollateral.hash);
+    LogPrint(LOG_MASTERNODE, "%s - Asking node for missing entry, vin: %s\n", __func__, masternodeCollateral.hash);
     int64_t askAgain = GetTime() + MASTERNODE_MIN_MNP_SECONDS;
     mWeAskedForMasternodeListEntry[masternodeCollateral] = askAgain;
 
@@ -167,11 +328,18 @@ void MasternodeNetworkMessageManager::Clear()
 {
     LOCK(cs);
     masternodes.clear();
+    masternodeIndexByCollateral_.clear();
+    masternodeIndexByKey_.clear();
+    ++masternodeListGeneration_;
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
-    mapSeenMasternodeBroadcast.clear();
-    mapSeenMasternodePing.clear();
+    seenBroadcastTimes_.clear();
+    seenPingTimes_.clear();
+    latestBroadcasts_.clear();
+    latestBroadcastByCollateral_.clear();
+    latestPings_.clear();
+    latestPingByCollateral_.clear();
 }
 
 std::string MasternodeNetworkMessageManager::ToString() const
@@ -184,6 +352,10 @@ std::string MasternodeNetworkMessageManager::ToString() const
         << (int)mWeAskedForMasternodeList.size()
         << ", entries in Masternode list we asked for: "
         << (int)mWeAskedForMasternodeListEntry.size()
+        << ", broadcasts seen: "
+        << (int)seenBroadcastTimes_.size()
+        << ", pings seen: "
+        << (int)seenPingTimes_.size()
         << ", nDsqCount: "
         << (int)nDsqCount;
 
@@ -192,17 +364,71 @@ std::string MasternodeNetworkMessageManager::ToString() const
 
 bool MasternodeNetworkMessageManager::broadcastIsKnown(const uint256& broadcastHash) const
 {
-    return mapSeenMasternodeBroadcast.count(broadcastHash) >0;
+    LOCK(cs);
+    return seenBroadcastTimes_.count(broadcastHash) >0;
 }
 bool MasternodeNetworkMessageManager::pingIsKnown(const uint256& pingHash) const
 {
-    return mapSeenMasternodePing.count(pingHash) >0;
+    LOCK(cs);
+    return seenPingTimes_.count(pingHash) >0;
+}
+bool MasternodeNetworkMessageManager::getKnownBroadcast(const uint256& broadcastHash, CMasternodeBroadcast& mnb) const
+{
+    LOCK(cs);
+    std::map<uint256, CMasternodeBroadcast>::const_iterator it = latestBroadcasts_.find(broadcastHash);
+    if (it == latestBroadcasts_.end()) return false;
+    mnb = it->second;
+    return true;
+}
+bool MasternodeNetworkMessageManager::getKnownPing(const uint256& pingHash, CMasternodePing& mnp) const
+{
+    LOCK(cs);
+    std::map<uint256, CMasternodePing>::const_iterator it = latestPings_.find(pingHash);
+    if (it == latestPings_.end()) return false;
+    mnp = it->second;
+    return true;
 }
-const CMasternodeBroadcast& MasternodeNetworkMessageManager::getKnownBroadcast(const uint256& broadcastHash)
+void MasternodeNetworkMessageManager::recordBroadcast(const CMasternodeBroadcast& mnb)
 {
-    return mapSeenMasternodeBroadcast[broadcastHash];
+    LOCK(cs);
+    const uint256 hash = mnb.GetHash();
+    seenBroadcastTimes_[hash] = std::max(mnb.sigTime, mnb.lastPing.sigTime);
+
+    const COutPoint& collateral = mnb.vin.prevout;
+    std::map<COutPoint, uint256>::iterator it = latestBroadcastByCollateral_.find(collateral);
+    if (it != latestBroadcastByCollateral_.end() && (*it).second != hash) {
+        std::map<uint256, CMasternodeBroadcast>::iterator latest = latestBroadcasts_.find((*it).second);
+        if (latest != latestBroadcasts_.end()) {
+            if ((*latest).second.sigTime > mnb.sigTime) return;
+            latestBroadcasts_.erase(latest);
+        }
+    }
+    latestBroadcasts_[hash] = mnb;
+    latestBroadcastByCollateral_[collateral] = hash;
 }
-const CMasternodePing& MasternodeNetworkMessageManager::getKnownPing(const uint256& pingHash)
+void MasternodeNetworkMessageManager::recordPing(const CMasternodePing& mnp)
 {
-    return mapSeenMasternodePing[pingHash];
+    LOCK(cs);
+    if (mnp == CMasternodePing()) return;
+    const uint256 hash = mnp.GetHash();
+    seenPingTimes_[hash] = mnp.sigTime;
+
+    const COutPoint& collateral = mnp.vin.prevout;
+    std::map<COutPoint, uint256>::iterator it = latestPingByCollateral_.find(collateral);
+    if (it != latestPingByCollateral_.end() && (*it).second != hash) {
+        std::map<uint256, CMasternodePing>::iterator latest = latestPings_.find((*it).second);
+        if (latest != latestPings_.end()) {
+            if ((*latest).second.sigTime > mnp.sigTime) return;
+            latestPings_.erase(latest);
+        }
+    }
+    latestPings_[hash] = mnp;
+    latestPingByCollateral_[collateral] = hash;
+
+    std::map<COutPoint, uint256>::iterator broadcast = latestBroadcastByCollateral_.find(collateral);
+    if (broadcast != latestBroadcastByCollateral_.end()) {
+        CMasternodeBroadcast& mnb = latestBroadcasts_[(*broadcast).second];
+        mnb.lastPing = mnp;
+        seenBroadcastTimes_[(*broadcast).second] = std::max(mnb.sigTime, mnp.sigTime);
+    }
 }
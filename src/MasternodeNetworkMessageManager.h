@@ -8,15 +8,51 @@
 #include <serialize.h>
 #include <protocol.h>
 #include <masternode.h>
+#include <coins.h>
+
+#include <boost/unordered_map.hpp>
 
 class CMasternodeSync;
 
 class MasternodeNetworkMessageManager
 {
+private:
+    class CollateralHasher
+    {
+    private:
+        CCoinsKeyHasher txidHasher_;
+
+    public:
+        size_t operator()(const COutPoint& collateral) const { return txidHasher_(collateral.hash) ^ collateral.n; }
+    };
+
+    // Positions in the masternode list by collateral and by key, which
+    // have to be updated whenever entries are added, moved or rekeyed
+    boost::unordered_map<COutPoint, size_t, CollateralHasher> masternodeIndexByCollateral_;
+    std::map<CKeyID, size_t> masternodeIndexByKey_;
+    // Bumped whenever masternodes are added, removed or rekeyed
+    uint64_t masternodeListGeneration_;
+
+    // Hashes of the broadcasts and pings seen with the time they were last known
+    // to be current, so that the ones coming back can be dropped
+    std::map<uint256, int64_t> seenBroadcastTimes_;
+    std::map<uint256, int64_t> seenPingTimes_;
+    // Only the latest broadcast and ping of each masternode are kept whole to be
+    // passed on to peers, and these are all that is written to the cache file
+    std::map<uint256, CMasternodeBroadcast> latestBroadcasts_;
+    std::map<COutPoint, uint256> latestBroadcastByCollateral_;
+    std::map<uint256, CMasternodePing> latestPings_;
+    std::map<COutPoint, uint256> latestPingByCollateral_;
+
+    void rebuildMasternodeIndexes();
+    //! Drops all but the newest broadcast and ping of each masternode read from the cache file
+    void rebuildSeenMessages();
+
 public:
     mutable CCriticalSection cs;
 
     MasternodeNetworkMessageManager();
+    // Only iterated over directly, entries are added, found and removed by the methods below
     std::vector<CMasternode> masternodes;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
@@ -28,12 +64,19 @@ public:
     // Dummy variable to keep serialization consistent;
     int64_t nDsqCount;
 
-    // Keep track of all broadcasts I've seen
-    std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
-
     uint32_t masternodeCount() const;
+    //! Bytes of memory the masternode list and the messages seen take up, not counting what their entries allocate
+    size_t DynamicMemoryUsage() const;
+    uint64_t masternodeListGeneration() const;
+    //! The signing time of the newest ping of a listed masternode, 0 if there is none
+    int64_t newestPingTime() const;
+    CMasternode* findMasternode(const COutPoint& collateral);
+    CMasternode* findMasternode(const CPubKey& pubKeyMasternode);
+    bool addMasternode(const CMasternode& mn);
+    //! The last masternode is moved into the place of the removed one
+    void removeMasternode(const COutPoint& collateral);
+    //! Has to be called after the key of a listed masternode changes
+    void reindexMasternode(const CMasternode& mn);
     const std::vector<CMasternode>& GetFullMasternodeVector() const;
     void clearTimedOutMasternodeListRequestsFromPeers();
     void clearTimedOutMasternodeListRequestsToPeers();
@@ -51,8 +94,13 @@ public:
 
     bool broadcastIsKnown(const uint256& broadcastHash) const;
     bool pingIsKnown(const uint256& pingHash) const;
-    const CMasternodeBroadcast& getKnownBroadcast(const uint256& broadcastHash);
-    const CMasternodePing& getKnownPing(const uint256& pingHash);
+    //! False if the message is not the latest of its masternode, even if it has been seen
+    bool getKnownBroadcast(const uint256& broadcastHash, CMasternodeBroadcast& mnb) const;
+    bool getKnownPing(const uint256& pingHash, CMasternodePing& mnp) const;
+    //! The broadcast replaces the one kept for its masternode
+    void recordBroadcast(const CMasternodeBroadcast& mnb);
+    //! A newer ping replaces the one kept for its masternode and is attached to its broadcast
+    void recordPing(const CMasternodePing& mnp);
 
     ADD_SERIALIZE_METHODS
     template <typename Stream, typename Operation>
@@ -64,8 +112,12 @@ public:
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
         READWRITE(nDsqCount);
-        READWRITE(mapSeenMasternodeBroadcast);
-        READWRITE(mapSeenMasternodePing);
+        READWRITE(latestBroadcasts_);
+        READWRITE(latestPings_);
+        if (ser_action.ForRead()) {
+            rebuildMasternodeIndexes();
+            rebuildSeenMessages();
+        }
     }
 };
 #endif// MASTERNODE_NETWORK_MESSAGE_MANAGER_H
\ No newline at end of file
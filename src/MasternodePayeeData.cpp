@@ -114,7 +114,7 @@ bool CMasternodePaymentWinner::ComputeScoreHash()
     if (GetBlockHashForScoring(seedHash, nBlockHeight))
         return true;
 
-    LogPrint("masternode", "Failed to get scoring hash for winner of height %d\n", nBlockHeight);
+    LogPrint(LOG_MASTERNODE, "Failed to get scoring hash for winner of height %d\n", nBlockHeight);
     seedHash.SetNull();
     return false;
 }
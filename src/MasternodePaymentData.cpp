@@ -4,6 +4,7 @@
 MasternodePaymentData::MasternodePaymentData(
     ): mapMasternodePayeeVotes()
     , mapMasternodeBlocks()
+    , payeeVoteHashesByHeight()
 {
 }
 
@@ -19,6 +20,13 @@ bool MasternodePaymentData::masternodeWinnerVoteIsKnown(const uint256& hash) con
     return true;
 }
 
+void MasternodePaymentData::rebuildPayeeVoteIndex()
+{
+    payeeVoteHashesByHeight.clear();
+    for (const auto& vote: mapMasternodePayeeVotes)
+        payeeVoteHashesByHeight[vote.second.GetHeight()].push_back(vote.first);
+}
+
 std::string MasternodePaymentData::ToString() const
 {
     std::ostringstream info;
@@ -3,6 +3,7 @@
 #include <map>
 #include <uint256.h>
 #include <string>
+#include <vector>
 #include <MasternodePayeeData.h>
 
 class MasternodePaymentData
@@ -12,11 +13,15 @@ public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
     /** Map from score hashes of blocks to the corresponding winners.  */
     std::map<uint256, CMasternodeBlockPayees> mapMasternodeBlocks;
+    /** Inventory hashes of the mnw's by the height they vote for, so that
+     *  old heights are dropped from the front without going over all votes.  */
+    std::map<int, std::vector<uint256>> payeeVoteHashesByHeight;
 
     MasternodePaymentData();
     ~MasternodePaymentData();
 
     bool masternodeWinnerVoteIsKnown(const uint256& hash) const;
+    void rebuildPayeeVoteIndex();
 
     void CheckAndRemove(){}
     void Clear(){}
@@ -28,6 +33,9 @@ public:
     {
         READWRITE(mapMasternodePayeeVotes);
         READWRITE(mapMasternodeBlocks);
+        if (ser_action.ForRead()) {
+            rebuildPayeeVoteIndex();
+        }
     }
 };
 
@@ -15,7 +15,12 @@ CMasternodePing::CMasternodePing()
 
 std::string CMasternodePing::getMessageToSign() const
 {
-    return vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    return getMessageToSign(vin.ToString());
+}
+
+std::string CMasternodePing::getMessageToSign(const std::string& vinMessage) const
+{
+    return vinMessage + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
 }
 
 void CMasternodePing::Relay() const
@@ -19,6 +19,8 @@ public:
 
     CMasternodePing();
     std::string getMessageToSign() const;
+    //! The same message, from the part of it that only depends on the vin, for pingers to keep between pings
+    std::string getMessageToSign(const std::string& vinMessage) const;
     void Relay() const;
 
     uint256 GetHash() const;
@@ -0,0 +1,203 @@
+#include <MasternodeSignaturePrevalidator.h>
+
+#include <checkqueue.h>
+#include <hash.h>
+#include <masternode.h>
+#include <MasternodePayeeData.h>
+#include <MasternodePing.h>
+#include <net.h>
+#include <obfuscation.h>
+#include <pubkey.h>
+#include <random.h>
+#include <ThreadManagementHelpers.h>
+#include <uint256.h>
+
+#include <map>
+#include <string>
+
+#include <boost/thread.hpp>
+
+extern bool fLiteMode;
+
+namespace
+{
+//! Below this many queued masternode messages they are not worth handing out to the threads
+constexpr size_t MIN_PARALLEL_SIGNATURE_CHECKS = 8;
+//! At most this many messages of a peer are read ahead at a time
+constexpr size_t MAX_PREVALIDATED_MESSAGES = 1000;
+//! Signers remembered, about as many as there are broadcasts and pings in a list sync
+constexpr size_t MAX_CACHED_SIGNERS = 50000;
+
+/**
+ * The keys recovered from masternode message signatures, with a null key for
+ * signatures nothing could be recovered from.
+ */
+class SignerCache
+{
+private:
+    std::map<uint256, CKeyID> signers_;
+    boost::shared_mutex cs_signers_;
+
+public:
+    static uint256 Key(const uint256& messageHash, const std::vector<unsigned char>& vchSig)
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << messageHash << vchSig;
+        return ss.GetHash();
+    }
+
+    bool Get(const uint256& key, CKeyID& signer)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_signers_);
+        std::map<uint256, CKeyID>::const_iterator it = signers_.find(key);
+        if (it == signers_.end())
+            return false;
+        signer = it->second;
+        return true;
+    }
+
+    void Set(const uint256& key, const CKeyID& signer)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_signers_);
+        while (signers_.size() >= MAX_CACHED_SIGNERS) {
+            // Evict a random entry, as the signature cache does
+            std::map<uint256, CKeyID>::iterator it = signers_.lower_bound(GetRandHash());
+            if (it == signers_.end())
+                it = signers_.begin();
+            signers_.erase(it);
+        }
+        signers_[key] = signer;
+    }
+};
+
+SignerCache signerCache;
+
+CKeyID RecoverAndCacheSigner(const uint256& cacheKey, const uint256& messageHash, const std::vector<unsigned char>& vchSig)
+{
+    CPubKey pubkey;
+    const CKeyID signer = pubkey.RecoverCompact(messageHash, vchSig)? pubkey.GetID(): CKeyID();
+    signerCache.Set(cacheKey, signer);
+    return signer;
+}
+
+class SignerRecovery
+{
+private:
+    uint256 messageHash_;
+    std::vector<unsigned char> vchSig_;
+
+public:
+    SignerRecovery(): messageHash_(), vchSig_() {}
+    SignerRecovery(const uint256& messageHash, const std::vector<unsigned char>& vchSig)
+        : messageHash_(messageHash)
+        , vchSig_(vchSig)
+    {
+    }
+
+    bool operator()()
+    {
+        const uint256 cacheKey = SignerCache::Key(messageHash_, vchSig_);
+        CKeyID signer;
+        if (!signerCache.Get(cacheKey, signer))
+            RecoverAndCacheSigner(cacheKey, messageHash_, vchSig_);
+        // Bad signatures are left for the message handler to find
+        return true;
+    }
+
+    void swap(SignerRecovery& other)
+    {
+        std::swap(messageHash_, other.messageHash_);
+        vchSig_.swap(other.vchSig_);
+    }
+};
+
+CCheckQueue<SignerRecovery> prevalidationQueue(32);
+//! The queue serves a single master, so the message handler threads take turns
+boost::mutex csPrevalidationQueue;
+int nPrevalidationThreads = 0;
+
+void ThreadPrevalidateSignatures()
+{
+    RenameThread("izzy-mnsigcheck");
+    prevalidationQueue.Thread();
+}
+
+template <typename T>
+void AddRecovery(const T& signedMessage, std::vector<SignerRecovery>& recoveries)
+{
+    if (signedMessage.signature.empty())
+        return;
+    recoveries.push_back(SignerRecovery());
+    SignerRecovery recovery(CObfuScationSigner::GetMessageHash(signedMessage.getMessageToSign()), signedMessage.signature);
+    recovery.swap(recoveries.back());
+}
+
+void ReadAhead(CNetMessage& msg, std::vector<SignerRecovery>& recoveries)
+{
+    const std::string strCommand = msg.hdr.GetCommand();
+    if (strCommand != "mnb" && strCommand != "mnp" && strCommand != "mnw")
+        return;
+
+    // The message is read from a copy, so that it can still be processed as received
+    CDataStream vRecv(msg.vRecv.begin(), msg.vRecv.end(), msg.vRecv.GetType(), msg.vRecv.GetVersion());
+    try {
+        if (strCommand == "mnb") {
+            CMasternodeBroadcast mnb;
+            vRecv >> mnb;
+            AddRecovery(mnb, recoveries);
+            AddRecovery(mnb.lastPing, recoveries);
+        } else if (strCommand == "mnp") {
+            CMasternodePing mnp;
+            vRecv >> mnp;
+            AddRecovery(mnp, recoveries);
+        } else {
+            CMasternodePaymentWinner winner;
+            vRecv >> winner;
+            AddRecovery(winner, recoveries);
+        }
+    } catch (const std::exception&) {
+        // Malformed messages are left for the message handler to reject
+    }
+}
+}
+
+void MasternodeSignaturePrevalidator::StartThreads(boost::thread_group& threadGroup, int nThreads)
+{
+    nPrevalidationThreads = nThreads;
+    for (int i = 0; i < nThreads - 1; i++)
+        threadGroup.create_thread(&ThreadPrevalidateSignatures);
+}
+
+void MasternodeSignaturePrevalidator::PrevalidateQueuedMessages(std::deque<CNetMessage>& messages)
+{
+    if (fLiteMode || nPrevalidationThreads <= 1)
+        return;
+
+    std::vector<SignerRecovery> recoveries;
+    size_t messagesRead = 0;
+    for (std::deque<CNetMessage>::iterator it = messages.begin();
+         it != messages.end() && it->complete() && messagesRead < MAX_PREVALIDATED_MESSAGES;
+         ++it) {
+        if (it->fPrevalidated)
+            continue;
+        it->fPrevalidated = true;
+        ReadAhead(*it, recoveries);
+        ++messagesRead;
+    }
+
+    if (recoveries.size() < MIN_PARALLEL_SIGNATURE_CHECKS)
+        return;
+
+    boost::unique_lock<boost::mutex> lock(csPrevalidationQueue);
+    CCheckQueueControl<SignerRecovery> control(&prevalidationQueue);
+    control.Add(recoveries);
+    control.Wait();
+}
+
+bool MasternodeSignaturePrevalidator::RecoverSigner(const uint256& messageHash, const std::vector<unsigned char>& vchSig, CKeyID& signer)
+{
+    const uint256 cacheKey = SignerCache::Key(messageHash, vchSig);
+    if (!signerCache.Get(cacheKey, signer))
+        signer = RecoverAndCacheSigner(cacheKey, messageHash, vchSig);
+    return !signer.IsNull();
+}
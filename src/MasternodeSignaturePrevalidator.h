@@ -0,0 +1,33 @@
+#ifndef MASTERNODE_SIGNATURE_PREVALIDATOR_H
+#define MASTERNODE_SIGNATURE_PREVALIDATOR_H
+#include <deque>
+#include <vector>
+
+namespace boost
+{
+class thread_group;
+}
+class CKeyID;
+class CNetMessage;
+class uint256;
+
+/**
+ * Recovers the signers of the masternode broadcasts, pings and winner votes a
+ * peer has queued up, spread over a pool of threads of its own.
+ *
+ * Masternode list syncs deliver these by the thousand, and each one is left
+ * to be checked in turn by the message handler. The queued messages are read
+ * ahead once there are enough of them, and the keys recovered from their
+ * signatures are cached by message hash and signature. The messages are still
+ * processed one by one and in order, but then find their signers recovered.
+ */
+class MasternodeSignaturePrevalidator
+{
+public:
+    static void StartThreads(boost::thread_group& threadGroup, int nThreads);
+    //! The messages are the receive queue of a peer, whose lock is held
+    static void PrevalidateQueuedMessages(std::deque<CNetMessage>& messages);
+    //! The key the message was signed with, recovered or found in the cache
+    static bool RecoverSigner(const uint256& messageHash, const std::vector<unsigned char>& vchSig, CKeyID& signer);
+};
+#endif// MASTERNODE_SIGNATURE_PREVALIDATOR_H
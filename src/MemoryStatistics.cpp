@@ -0,0 +1,77 @@
+#if defined(HAVE_CONFIG_H)
+#include "config/izzy-config.h"
+#endif
+
+#include <MemoryStatistics.h>
+
+#include <addrman.h>
+#include <blockmap.h>
+#include <coins.h>
+#include <main.h>
+#include <MasternodeModule.h>
+#include <net.h>
+#include <OrphanTransactions.h>
+#include <RPCResponseCache.h>
+#include <RecentTransactionCache.h>
+#include <script/sigcache.h>
+#include <TransactionDiskAccessor.h>
+#include <txmempool.h>
+#include <UtxoCheckingAndUpdating.h>
+#ifdef ENABLE_WALLET
+#include <init.h>
+#include <wallet.h>
+#endif
+
+extern CCriticalSection cs_main;
+extern BlockMap mapBlockIndex;
+extern CCoinsViewCache* pcoinsTip;
+extern CTxMemPool mempool;
+
+SubsystemMemoryUsage::SubsystemMemoryUsage(
+    const std::string& nameIn,
+    size_t bytesIn,
+    size_t entriesIn
+    ): name(nameIn)
+    , bytes(bytesIn)
+    , entries(entriesIn)
+{
+}
+
+std::vector<SubsystemMemoryUsage> GetSubsystemMemoryUsage()
+{
+    std::vector<SubsystemMemoryUsage> usage;
+    {
+        LOCK(cs_main);
+        if (pcoinsTip)
+            usage.push_back(SubsystemMemoryUsage("coins_cache", pcoinsTip->DynamicMemoryUsage(), pcoinsTip->GetCacheSize()));
+        usage.push_back(SubsystemMemoryUsage("block_index", BlockIndexDynamicMemoryUsage(), mapBlockIndex.size()));
+        usage.push_back(SubsystemMemoryUsage("orphan_transactions", OrphanDynamicMemoryUsage(), OrphanTotalCount()));
+    }
+    usage.push_back(SubsystemMemoryUsage("mempool", mempool.DynamicMemoryUsage(), mempool.size()));
+    usage.push_back(SubsystemMemoryUsage("signature_cache", SignatureCacheDynamicMemoryUsage(), 0));
+    usage.push_back(SubsystemMemoryUsage("script_execution_cache", ScriptExecutionCacheDynamicMemoryUsage(), 0));
+    usage.push_back(SubsystemMemoryUsage("masternodes", MasternodeDynamicMemoryUsage(), MasternodeListSize()));
+
+    CAddrMan& addressManager = GetNetworkAddressManager();
+    usage.push_back(SubsystemMemoryUsage("addrman", addressManager.DynamicMemoryUsage(), addressManager.size()));
+    {
+        LOCK(cs_vNodes);
+        usage.push_back(SubsystemMemoryUsage("network_buffers", NetworkBufferMemoryUsage(), vNodes.size()));
+    }
+
+    const TransactionCacheStats txCacheStats = GetRecentTransactionCache().GetStats();
+    usage.push_back(SubsystemMemoryUsage("transaction_cache", txCacheStats.nUsage, txCacheStats.nCachedTransactions));
+    const RPCResponseCacheStats rpcCacheStats = GetRPCResponseCache().GetStats();
+    usage.push_back(SubsystemMemoryUsage("rpc_reply_cache", rpcCacheStats.nUsage, rpcCacheStats.nCachedResponses));
+
+#ifdef ENABLE_WALLET
+    size_t walletUsage = 0;
+    size_t walletTransactions = 0;
+    for (const CWallet* pwallet : vpwallets) {
+        walletUsage += pwallet->DynamicMemoryUsage();
+        walletTransactions += pwallet->GetWalletTransactionReferences().size();
+    }
+    usage.push_back(SubsystemMemoryUsage("wallets", walletUsage, walletTransactions));
+#endif
+    return usage;
+}
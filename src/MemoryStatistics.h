@@ -0,0 +1,29 @@
+#ifndef MEMORY_STATISTICS_H
+#define MEMORY_STATISTICS_H
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+/** The memory one of the node's structures takes up */
+struct SubsystemMemoryUsage {
+    std::string name;
+    size_t bytes;
+    //! What the structure holds: coins, block indexes, transactions, addresses, peers and so on
+    size_t entries;
+
+    SubsystemMemoryUsage(const std::string& nameIn, size_t bytesIn, size_t entriesIn);
+};
+
+/**
+ * The memory the coins cache, block index, mempool with its address and spent
+ * indexes, signature and script caches, masternode lists, orphan pool, address
+ * manager, peer buffers, transaction and RPC reply caches and loaded wallets
+ * take up, each as the structure itself accounts for it.
+ *
+ * Most of these are kept up to date as entries come and go, or are fixed at
+ * startup; the block index and the wallets are added up entry by entry, which
+ * takes a walk over them with their locks held.
+ */
+std::vector<SubsystemMemoryUsage> GetSubsystemMemoryUsage();
+#endif// MEMORY_STATISTICS_H
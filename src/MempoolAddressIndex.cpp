@@ -0,0 +1,105 @@
+#include <MempoolAddressIndex.h>
+
+#include <memusage.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+
+size_t MempoolAddressIndex::AddressHasher::operator()(const Address& address) const
+{
+    uint256 key(0);
+    memcpy(key.begin(), address.hashBytes.begin(), address.hashBytes.size());
+    *(key.begin() + address.hashBytes.size()) = static_cast<unsigned char>(address.type);
+    return hasher_(key);
+}
+
+MempoolAddressIndex::MempoolAddressIndex(
+    ): buckets_()
+    , transactions_()
+    , numberOfDeltas_(0)
+{
+}
+
+bool MempoolAddressIndex::HasTransaction(const uint256& txhash) const
+{
+    return transactions_.find(txhash) != transactions_.end();
+}
+
+void MempoolAddressIndex::Add(const CMempoolAddressDeltaKey& key, const CMempoolAddressDelta& delta)
+{
+    const Address address(key.type, key.addressBytes);
+    std::vector<Delta>& bucket = buckets_[address];
+    transactions_[key.txhash].push_back(Location(address, bucket.size()));
+    bucket.push_back(Delta(key, delta));
+    ++numberOfDeltas_;
+}
+
+void MempoolAddressIndex::RemoveDelta(const uint256& txhash, std::vector<Location>& locations)
+{
+    const Location removed = locations.back();
+    locations.pop_back();
+
+    Buckets::iterator bucketIt = buckets_.find(removed.address);
+    assert(bucketIt != buckets_.end());
+    std::vector<Delta>& bucket = bucketIt->second;
+    const size_t last = bucket.size() - 1;
+    if (removed.position != last) {
+        bucket[removed.position] = bucket[last];
+        const uint256& movedTxhash = bucket[removed.position].txhash;
+        std::vector<Location>& movedLocations = movedTxhash == txhash ? locations : transactions_.find(movedTxhash)->second;
+        std::vector<Location>::iterator moved = movedLocations.begin();
+        while (!(moved->position == last && moved->address == removed.address))
+            ++moved;
+        moved->position = removed.position;
+    }
+    bucket.pop_back();
+    --numberOfDeltas_;
+    if (bucket.empty())
+        buckets_.erase(bucketIt);
+}
+
+void MempoolAddressIndex::RemoveTransaction(const uint256& txhash)
+{
+    TransactionLocations::iterator it = transactions_.find(txhash);
+    if (it == transactions_.end())
+        return;
+    while (!it->second.empty())
+        RemoveDelta(txhash, it->second);
+    transactions_.erase(it);
+}
+
+void MempoolAddressIndex::Clear()
+{
+    buckets_.clear();
+    transactions_.clear();
+    numberOfDeltas_ = 0;
+}
+
+size_t MempoolAddressIndex::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(buckets_) + memusage::DynamicUsage(transactions_) +
+           (sizeof(Delta) + sizeof(Location)) * numberOfDeltas_;
+}
+
+void MempoolAddressIndex::GetAddressDeltas(const uint160& addressHash, int type, AddressDeltas& deltas) const
+{
+    Buckets::const_iterator it = buckets_.find(Address(type, addressHash));
+    if (it == buckets_.end())
+        return;
+    const std::vector<Delta>& bucket = it->second;
+    const size_t first = deltas.size();
+    deltas.reserve(first + bucket.size());
+    for (std::vector<Delta>::const_iterator delta = bucket.begin(); delta != bucket.end(); ++delta) {
+        const CMempoolAddressDeltaKey key(type, addressHash, delta->txhash, delta->index, delta->spending);
+        deltas.push_back(std::make_pair(key, delta->delta));
+    }
+
+    struct KeyOrder {
+        bool operator()(const AddressDeltas::value_type& a, const AddressDeltas::value_type& b) const
+        {
+            return CMempoolAddressDeltaKeyCompare()(a.first, b.first);
+        }
+    };
+    std::sort(deltas.begin() + first, deltas.end(), KeyOrder());
+}
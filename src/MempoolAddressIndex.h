@@ -0,0 +1,91 @@
+#ifndef MEMPOOL_ADDRESS_INDEX_H
+#define MEMPOOL_ADDRESS_INDEX_H
+#include <addressindex.h>
+#include <coins.h>
+#include <NodePoolAllocator.h>
+#include <uint256.h>
+
+#include <stddef.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+/**
+ * The address deltas of the transactions in the mempool, bucketed by address.
+ *
+ * Each address keeps its deltas in one vector and each transaction remembers
+ * where its deltas went, so adding and removing a transaction costs a hash
+ * lookup per delta rather than a tree insertion, however large the pool or a
+ * single address' bucket grows. Removal moves the last delta of a bucket into
+ * the freed slot, so buckets are unordered; lookups sort what they return.
+ */
+class MempoolAddressIndex
+{
+public:
+    typedef std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > AddressDeltas;
+
+private:
+    struct Address {
+        int type;
+        uint160 hashBytes;
+
+        Address(int typeIn, const uint160& hashBytesIn): type(typeIn), hashBytes(hashBytesIn) {}
+        bool operator==(const Address& other) const { return type == other.type && hashBytes == other.hashBytes; }
+    };
+
+    class AddressHasher
+    {
+    private:
+        CCoinsKeyHasher hasher_;
+
+    public:
+        size_t operator()(const Address& address) const;
+    };
+
+    struct Delta {
+        uint256 txhash;
+        unsigned int index;
+        int spending;
+        CMempoolAddressDelta delta;
+
+        Delta(const CMempoolAddressDeltaKey& key, const CMempoolAddressDelta& deltaIn)
+            : txhash(key.txhash), index(key.index), spending(key.spending), delta(deltaIn) {}
+    };
+
+    //! Where one of a transaction's deltas is kept
+    struct Location {
+        Address address;
+        size_t position;
+
+        Location(const Address& addressIn, size_t positionIn): address(addressIn), position(positionIn) {}
+    };
+
+    typedef boost::unordered_map<Address, std::vector<Delta>, AddressHasher, std::equal_to<Address>,
+        NodePoolAllocator<std::pair<const Address, std::vector<Delta> > > > Buckets;
+    typedef boost::unordered_map<uint256, std::vector<Location>, CCoinsKeyHasher, std::equal_to<uint256>,
+        NodePoolAllocator<std::pair<const uint256, std::vector<Location> > > > TransactionLocations;
+
+    Buckets buckets_;
+    TransactionLocations transactions_;
+    size_t numberOfDeltas_;
+
+    void RemoveDelta(const uint256& txhash, std::vector<Location>& locations);
+
+public:
+    MempoolAddressIndex();
+
+    bool HasTransaction(const uint256& txhash) const;
+    void Add(const CMempoolAddressDeltaKey& key, const CMempoolAddressDelta& delta);
+    void RemoveTransaction(const uint256& txhash);
+    void Clear();
+    //! Append the deltas of the address, ordered like CMempoolAddressDeltaKeyCompare
+    void GetAddressDeltas(const uint160& addressHash, int type, AddressDeltas& deltas) const;
+    size_t NumberOfAddresses() const { return buckets_.size(); }
+    size_t NumberOfTransactions() const { return transactions_.size(); }
+    //! Memory held by the index, taking the vectors to hold just the deltas they keep
+    size_t DynamicMemoryUsage() const;
+};
+#endif// MEMPOOL_ADDRESS_INDEX_H
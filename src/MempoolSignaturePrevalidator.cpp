@@ -0,0 +1,70 @@
+#include <MempoolSignaturePrevalidator.h>
+
+#include <checkqueue.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <scriptCheck.h>
+#include <script/SignatureCheckers.h>
+#include <ThreadManagementHelpers.h>
+
+#include <vector>
+
+#include <boost/thread.hpp>
+
+namespace
+{
+//! Below this many inputs a transaction is not worth handing out to the threads
+constexpr size_t MIN_PARALLEL_SCRIPT_CHECKS = 4;
+
+CCheckQueue<CScriptCheck> prevalidationQueue(16);
+//! Only one transaction may be spread at a time, as the queue serves a single master
+boost::mutex csPrevalidationQueue;
+int nPrevalidationThreads = 0;
+
+void ThreadPrevalidateSignatures()
+{
+    RenameThread("izzy-sigprecheck");
+    prevalidationQueue.Thread();
+}
+}
+
+void MempoolSignaturePrevalidator::StartThreads(boost::thread_group& threadGroup, int nThreads)
+{
+    nPrevalidationThreads = nThreads;
+    for (int i = 0; i < nThreads - 1; i++)
+        threadGroup.create_thread(&ThreadPrevalidateSignatures);
+}
+
+void MempoolSignaturePrevalidator::Prevalidate(const CTransaction& tx, const CCoinsViewCache& inputs)
+{
+    if (tx.IsCoinBase())
+        return;
+
+    std::shared_ptr<const PrecomputedTransactionData> txdata;
+    if (tx.vin.size() > 1)
+        txdata = std::make_shared<const PrecomputedTransactionData>(tx);
+    std::vector<CScriptCheck> checks;
+    checks.reserve(tx.vin.size());
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        const CCoins* coins = inputs.AccessCoins(tx.vin[i].prevout.hash);
+        if (coins == nullptr || !coins->IsAvailable(tx.vin[i].prevout.n))
+            return;
+        checks.push_back(CScriptCheck());
+        CScriptCheck check(*coins, tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true, txdata);
+        check.swap(checks.back());
+    }
+
+    // Failures need no report, admission finds them again with the locks held
+    if (nPrevalidationThreads > 1 && checks.size() >= MIN_PARALLEL_SCRIPT_CHECKS) {
+        boost::unique_lock<boost::mutex> lock(csPrevalidationQueue);
+        CCheckQueueControl<CScriptCheck> control(&prevalidationQueue);
+        control.Add(checks);
+        control.Wait();
+    } else {
+        for (std::vector<CScriptCheck>::iterator it = checks.begin(); it != checks.end(); ++it) {
+            if (!(*it)())
+                break;
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef MEMPOOL_SIGNATURE_PREVALIDATOR_H
+#define MEMPOOL_SIGNATURE_PREVALIDATOR_H
+
+namespace boost
+{
+class thread_group;
+}
+class CCoinsViewCache;
+class CTransaction;
+
+/**
+ * Verifies the scripts of a loose transaction ahead of its admission to the
+ * mempool, spread over a pool of threads of its own.
+ *
+ * This is meant to run without cs_main held, on the coins the transaction
+ * spends as they were looked up beforehand. The outcome is only kept in the
+ * signature cache: admission still checks everything, but then finds the good
+ * signatures cached, which keeps the time spent under the locks short.
+ */
+class MempoolSignaturePrevalidator
+{
+public:
+    static void StartThreads(boost::thread_group& threadGroup, int nThreads);
+    static void Prevalidate(const CTransaction& tx, const CCoinsViewCache& inputs);
+};
+#endif// MEMPOOL_SIGNATURE_PREVALIDATOR_H
@@ -0,0 +1,49 @@
+#include <MintingWakeup.h>
+
+#include <algorithm>
+
+#include <boost/chrono/chrono.hpp>
+
+MintingWakeup::MintingWakeup(
+    ): mutex_()
+    , condition_()
+    , numberOfWakeups_(0)
+{
+}
+
+void MintingWakeup::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    Notify();
+}
+
+void MintingWakeup::Notify()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        ++numberOfWakeups_;
+    }
+    condition_.notify_all();
+}
+
+void MintingWakeup::NotifyWalletTransactionChanged(CWallet* wallet, const uint256& hashTx, ChangeType status)
+{
+    Notify();
+}
+
+uint64_t MintingWakeup::NumberOfWakeups() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return numberOfWakeups_;
+}
+
+bool MintingWakeup::WaitFor(int64_t milliseconds, uint64_t wakeupsSeen)
+{
+    const boost::chrono::steady_clock::time_point deadline =
+        boost::chrono::steady_clock::now() + boost::chrono::milliseconds(std::max<int64_t>(0, milliseconds));
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (numberOfWakeups_ == wakeupsSeen) {
+        if (condition_.wait_until(lock, deadline) == boost::cv_status::timeout)
+            return numberOfWakeups_ != wakeupsSeen;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef MINTING_WAKEUP_H
+#define MINTING_WAKEUP_H
+#include <NotificationInterface.h>
+#include <ui_interface.h>
+
+#include <stdint.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CWallet;
+class uint256;
+
+/**
+ * Wakes a minting thread that waits between attempts as soon as there may
+ * be something new to mint on: a new chain tip, or a change to one of the
+ * wallet transactions whose coins may be staked.
+ *
+ * Waiters pass the number of wakeups they had seen when they last looked at
+ * the chain, so a wakeup that comes before they start waiting is not lost.
+ */
+class MintingWakeup: public NotificationInterface
+{
+private:
+    mutable boost::mutex mutex_;
+    boost::condition_variable condition_;
+    uint64_t numberOfWakeups_;
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindex) override;
+
+public:
+    MintingWakeup();
+
+    void Notify();
+    void NotifyWalletTransactionChanged(CWallet* wallet, const uint256& hashTx, ChangeType status);
+    uint64_t NumberOfWakeups() const;
+    //! Wait until there has been a wakeup past wakeupsSeen or the time runs out; true if woken
+    bool WaitFor(int64_t milliseconds, uint64_t wakeupsSeen);
+};
+#endif// MINTING_WAKEUP_H
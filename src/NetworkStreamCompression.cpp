@@ -0,0 +1,143 @@
+#if defined(HAVE_CONFIG_H)
+#include "config/izzy-config.h"
+#endif
+
+#include <NetworkStreamCompression.h>
+
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+//! Bytes decoded at a time before they are handed on
+constexpr size_t DECOMPRESSED_PIECE_SIZE = 64 * 1024;
+//! Raw deflate without the zlib header and trailer, as the stream never ends
+constexpr int RAW_DEFLATE_WINDOW_BITS = -15;
+}
+
+#ifdef HAVE_ZLIB
+struct NetworkStreamCompressor::Stream {
+    z_stream z;
+    bool fBroken;
+};
+
+struct NetworkStreamDecompressor::Stream {
+    z_stream z;
+    bool fBroken;
+};
+#else
+struct NetworkStreamCompressor::Stream {
+};
+
+struct NetworkStreamDecompressor::Stream {
+};
+#endif
+
+NetworkStreamCompressor::NetworkStreamCompressor(
+    ): stream_(new Stream())
+{
+#ifdef HAVE_ZLIB
+    memset(&stream_->z, 0, sizeof(stream_->z));
+    stream_->fBroken = deflateInit2(&stream_->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, RAW_DEFLATE_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK;
+#endif
+}
+
+NetworkStreamCompressor::~NetworkStreamCompressor()
+{
+#ifdef HAVE_ZLIB
+    if (!stream_->fBroken)
+        deflateEnd(&stream_->z);
+#endif
+}
+
+bool NetworkStreamCompressor::Compress(const char* data, size_t size, std::vector<char>& out)
+{
+#ifdef HAVE_ZLIB
+    if (stream_->fBroken)
+        return false;
+    z_stream& z = stream_->z;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    z.avail_in = size;
+    const size_t nStart = out.size();
+    size_t nUsed = nStart;
+    do {
+        // A sync flush adds a few bytes, and data that does not compress grows a little.
+        out.resize(nUsed + deflateBound(&z, z.avail_in) + 16);
+        z.next_out = reinterpret_cast<Bytef*>(&out[nUsed]);
+        z.avail_out = out.size() - nUsed;
+        const int ret = deflate(&z, Z_SYNC_FLUSH);
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            deflateEnd(&z);
+            stream_->fBroken = true;
+            out.resize(nStart);
+            return false;
+        }
+        nUsed = out.size() - z.avail_out;
+    } while (z.avail_in > 0 || z.avail_out == 0);
+    out.resize(nUsed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NetworkStreamCompressor::IsSupported()
+{
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+NetworkStreamDecompressor::NetworkStreamDecompressor(
+    ): stream_(new Stream())
+    , buffer_()
+{
+#ifdef HAVE_ZLIB
+    memset(&stream_->z, 0, sizeof(stream_->z));
+    stream_->fBroken = inflateInit2(&stream_->z, RAW_DEFLATE_WINDOW_BITS) != Z_OK;
+#endif
+}
+
+NetworkStreamDecompressor::~NetworkStreamDecompressor()
+{
+#ifdef HAVE_ZLIB
+    if (!stream_->fBroken)
+        inflateEnd(&stream_->z);
+#endif
+}
+
+bool NetworkStreamDecompressor::Decompress(const char* data, size_t size, const Sink& sink)
+{
+#ifdef HAVE_ZLIB
+    if (stream_->fBroken)
+        return false;
+    z_stream& z = stream_->z;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    z.avail_in = size;
+    buffer_.resize(DECOMPRESSED_PIECE_SIZE);
+    do {
+        z.next_out = reinterpret_cast<Bytef*>(buffer_.data());
+        z.avail_out = buffer_.size();
+        const int ret = inflate(&z, Z_SYNC_FLUSH);
+        // The sender never ends its stream, so an end is as corrupt as bad data.
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            inflateEnd(&z);
+            stream_->fBroken = true;
+            return false;
+        }
+        const size_t nDecoded = buffer_.size() - z.avail_out;
+        if (nDecoded > 0 && !sink(buffer_.data(), nDecoded))
+            return false;
+        if (ret == Z_BUF_ERROR)
+            break;
+    } while (z.avail_in > 0 || z.avail_out == 0);
+    return true;
+#else
+    return false;
+#endif
+}
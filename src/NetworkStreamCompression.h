@@ -0,0 +1,58 @@
+#ifndef NETWORK_STREAM_COMPRESSION_H
+#define NETWORK_STREAM_COMPRESSION_H
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/function.hpp>
+
+/**
+ * Compresses what is sent over one direction of a peer connection as a
+ * single zlib stream. Every message is flushed out whole, so that the peer
+ * can decode it as soon as it arrives, while each one still compresses
+ * against the ones before it.
+ */
+class NetworkStreamCompressor
+{
+private:
+    struct Stream;
+    std::unique_ptr<Stream> stream_;
+
+    NetworkStreamCompressor(const NetworkStreamCompressor&);
+    NetworkStreamCompressor& operator=(const NetworkStreamCompressor&);
+
+public:
+    NetworkStreamCompressor();
+    ~NetworkStreamCompressor();
+
+    //! Appends the bytes compressed to out; false once the stream is broken
+    bool Compress(const char* data, size_t size, std::vector<char>& out);
+
+    //! Whether this build can compress peer connections at all
+    static bool IsSupported();
+};
+
+/** Decodes what a NetworkStreamCompressor on the other end of the connection sent */
+class NetworkStreamDecompressor
+{
+public:
+    //! Takes decoded bytes as they come; false to stop decoding
+    typedef boost::function<bool(const char*, size_t)> Sink;
+
+private:
+    struct Stream;
+    std::unique_ptr<Stream> stream_;
+    std::vector<char> buffer_;
+
+    NetworkStreamDecompressor(const NetworkStreamDecompressor&);
+    NetworkStreamDecompressor& operator=(const NetworkStreamDecompressor&);
+
+public:
+    NetworkStreamDecompressor();
+    ~NetworkStreamDecompressor();
+
+    //! Hands the decoded bytes to sink a piece at a time, so a small input cannot blow up in memory; false on corrupt data or when sink refuses
+    bool Decompress(const char* data, size_t size, const Sink& sink);
+};
+#endif// NETWORK_STREAM_COMPRESSION_H
@@ -0,0 +1,129 @@
+#include <NodePool.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <new>
+#include <utility>
+
+constexpr size_t NodePool::ALIGNMENT;
+constexpr size_t NodePool::MAX_NODE_SIZE;
+constexpr size_t NodePool::CHUNK_SIZE;
+
+NodePool::NodePool(
+    ): freeLists_(MAX_NODE_SIZE / ALIGNMENT + 1, NULL)
+    , chunks_()
+    , chunkCursor_(NULL)
+    , chunkEnd_(NULL)
+{
+}
+
+NodePool::~NodePool()
+{
+    for (const Chunk& chunk : chunks_)
+        ::operator delete(chunk.begin);
+}
+
+size_t NodePool::RoundedSize(size_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+void NodePool::AllocateChunk()
+{
+    if (!chunks_.empty())
+        chunks_.back().carved = chunkCursor_ - chunks_.back().begin;
+    Chunk chunk = {static_cast<char*>(::operator new(CHUNK_SIZE)), 0};
+    chunks_.push_back(chunk);
+    chunkCursor_ = chunk.begin;
+    chunkEnd_ = chunkCursor_ + CHUNK_SIZE;
+}
+
+void* NodePool::Allocate(size_t size)
+{
+    assert(IsPooled(size));
+    const size_t nodeSize = RoundedSize(size);
+    FreeNode*& freeList = freeLists_[nodeSize / ALIGNMENT];
+    if (freeList) {
+        FreeNode* node = freeList;
+        freeList = node->next;
+        return node;
+    }
+    if (chunkCursor_ == NULL || static_cast<size_t>(chunkEnd_ - chunkCursor_) < nodeSize)
+        AllocateChunk();
+    void* node = chunkCursor_;
+    chunkCursor_ += nodeSize;
+    return node;
+}
+
+void NodePool::Deallocate(void* p, size_t size)
+{
+    assert(IsPooled(size));
+    FreeNode*& freeList = freeLists_[RoundedSize(size) / ALIGNMENT];
+    FreeNode* node = static_cast<FreeNode*>(p);
+    node->next = freeList;
+    freeList = node;
+}
+
+size_t NodePool::ReleaseFreeChunks()
+{
+    if (chunks_.size() < 2)
+        return 0;
+    // Sum up the free bytes of every full chunk, finding the chunk of a node by address
+    const size_t nFullChunks = chunks_.size() - 1;
+    std::vector<std::pair<char*, size_t> > byAddress;
+    byAddress.reserve(nFullChunks);
+    for (size_t i = 0; i < nFullChunks; ++i)
+        byAddress.push_back(std::make_pair(chunks_[i].begin, i));
+    std::sort(byAddress.begin(), byAddress.end());
+    std::vector<size_t> freeBytes(chunks_.size(), 0);
+    const auto chunkOf = [&](const FreeNode* node) {
+        char* const p = (char*)node;
+        std::vector<std::pair<char*, size_t> >::const_iterator it =
+            std::upper_bound(byAddress.begin(), byAddress.end(), std::make_pair(p, chunks_.size()));
+        if (it == byAddress.begin() || p >= (it - 1)->first + CHUNK_SIZE)
+            return nFullChunks;
+        return (it - 1)->second;
+    };
+    for (size_t i = 0; i < freeLists_.size(); ++i) {
+        for (const FreeNode* node = freeLists_[i]; node; node = node->next)
+            freeBytes[chunkOf(node)] += i * ALIGNMENT;
+    }
+
+    std::vector<bool> release(chunks_.size(), false);
+    bool fAny = false;
+    for (size_t i = 0; i < nFullChunks; ++i) {
+        release[i] = freeBytes[i] == chunks_[i].carved;
+        fAny = fAny || release[i];
+    }
+    if (!fAny)
+        return 0;
+
+    // Unlink the nodes of the released chunks before handing them back
+    for (FreeNode*& freeList : freeLists_) {
+        FreeNode** link = &freeList;
+        while (*link) {
+            if (release[chunkOf(*link)])
+                *link = (*link)->next;
+            else
+                link = &(*link)->next;
+        }
+    }
+    size_t nReleased = 0;
+    std::vector<Chunk> kept;
+    kept.reserve(chunks_.size());
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        if (release[i]) {
+            ::operator delete(chunks_[i].begin);
+            nReleased += CHUNK_SIZE;
+        } else {
+            kept.push_back(chunks_[i]);
+        }
+    }
+    chunks_.swap(kept);
+    return nReleased;
+}
+
+size_t NodePool::DynamicMemoryUsage() const
+{
+    return chunks_.size() * CHUNK_SIZE;
+}
@@ -0,0 +1,58 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Allocator for the small fixed-size nodes of a single node-based container.
+ *
+ * Memory is carved out of large chunks and freed nodes are kept on a free list per
+ * size, so inserting into and erasing from the container does not go through malloc.
+ * Chunks whose nodes have all been freed are returned on ReleaseFreeChunks, the rest
+ * when the pool is destroyed. A pool is not thread safe; it is meant to be used by
+ * one container and follows its locking.
+ */
+class NodePool
+{
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct Chunk {
+        char* begin;
+        //! Bytes handed out as nodes so far
+        size_t carved;
+    };
+
+    std::vector<FreeNode*> freeLists_;
+    //! The last one is the chunk nodes are being carved out of
+    std::vector<Chunk> chunks_;
+    char* chunkCursor_;
+    char* chunkEnd_;
+
+    static size_t RoundedSize(size_t size);
+    void AllocateChunk();
+
+public:
+    //! Granularity and alignment of pooled allocations
+    static constexpr size_t ALIGNMENT = 16;
+    //! Largest allocation served from the pool
+    static constexpr size_t MAX_NODE_SIZE = 256;
+    //! Size of the chunks nodes are carved out of
+    static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+    NodePool();
+    ~NodePool();
+
+    static bool IsPooled(size_t size) { return size <= MAX_NODE_SIZE; }
+
+    void* Allocate(size_t size);
+    void Deallocate(void* p, size_t size);
+    //! Return the chunks, other than the current one, that no node is allocated from; the bytes released
+    size_t ReleaseFreeChunks();
+
+    //! Memory reserved by the pool, including free nodes
+    size_t DynamicMemoryUsage() const;
+};
+#endif// NODE_POOL_H
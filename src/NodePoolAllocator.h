@@ -0,0 +1,84 @@
+#ifndef NODE_POOL_ALLOCATOR_H
+#define NODE_POOL_ALLOCATOR_H
+#include <NodePool.h>
+
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/**
+ * STL allocator that serves single-object allocations, i.e. the nodes of node-based
+ * containers, from a NodePool. Larger requests such as bucket arrays go to operator new.
+ *
+ * Every container gets its own pool, as pools are not thread safe: a copied container
+ * starts out with a new one and a copy-assigned one keeps its own, while swapping or
+ * moving containers takes their pools along.
+ */
+template <typename T>
+class NodePoolAllocator
+{
+private:
+    template <typename U>
+    friend class NodePoolAllocator;
+
+    std::shared_ptr<NodePool> pool_;
+
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind {
+        typedef NodePoolAllocator<U> other;
+    };
+
+    NodePoolAllocator(): pool_(std::make_shared<NodePool>()) {}
+
+    template <typename U>
+    NodePoolAllocator(const NodePoolAllocator<U>& other): pool_(other.pool_) {}
+
+    NodePoolAllocator select_on_container_copy_construction() const
+    {
+        return NodePoolAllocator();
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n == 1 && NodePool::IsPooled(sizeof(T)))
+            return static_cast<T*>(pool_->Allocate(sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (n == 1 && NodePool::IsPooled(sizeof(T)))
+            pool_->Deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    size_t PoolMemoryUsage() const
+    {
+        return pool_->DynamicMemoryUsage();
+    }
+
+    size_t ReleaseFreeChunks() const
+    {
+        return pool_->ReleaseFreeChunks();
+    }
+
+    template <typename U>
+    bool operator==(const NodePoolAllocator<U>& other) const
+    {
+        return pool_ == other.pool_;
+    }
+
+    template <typename U>
+    bool operator!=(const NodePoolAllocator<U>& other) const
+    {
+        return pool_ != other.pool_;
+    }
+};
+#endif// NODE_POOL_ALLOCATOR_H
@@ -2,7 +2,9 @@
 
 #include <Logging.h>
 #include <Settings.h>
+#include <sync.h>
 extern Settings& settings;
+extern CCriticalSection cs_main;
 
 CNodeState::CNodeState(
     ): fCurrentlyConnected(false)
@@ -34,6 +36,7 @@ void Misbehaving(int pnode, int howmuch)
     if (howmuch == 0)
         return;
 
+    LOCK(cs_main);
     CNodeState* state = State(pnode);
     if (state == NULL)
         return;
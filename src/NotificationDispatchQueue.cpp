@@ -0,0 +1,147 @@
+#include <NotificationDispatchQueue.h>
+
+#include <boost/bind.hpp>
+
+NotificationDispatchQueue::NotificationDispatchQueue(
+    size_t maxPending
+    ): mutex_()
+    , dispatched_()
+    , delivered_()
+    , deliveryMutex_()
+    , queue_()
+    , maxPending_(maxPending)
+    , numberDispatched_(0)
+    , numberDelivered_(0)
+    , running_(false)
+    , stopping_(false)
+    , thread_()
+{
+}
+
+NotificationDispatchQueue::~NotificationDispatchQueue()
+{
+    Stop();
+}
+
+bool NotificationDispatchQueue::DeliverNext()
+{
+    Notification notification;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (queue_.empty())
+            return false;
+        notification = queue_.front();
+        queue_.pop_front();
+    }
+    notification();
+    bool stopping;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        numberDelivered_++;
+        stopping = stopping_;
+    }
+    delivered_.notify_all();
+    if (stopping)
+        dispatched_.notify_all();
+    return true;
+}
+
+void NotificationDispatchQueue::Run()
+{
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (queue_.empty()) {
+                if (stopping_ && numberDelivered_ == numberDispatched_) {
+                    // Nothing is pending or being delivered, so dispatching threads can take over without overtaking any
+                    running_ = false;
+                    return;
+                }
+                dispatched_.wait(lock);
+            }
+        }
+        // One at a time, so a dispatching thread over the limit gets its turn between them
+        boost::unique_lock<boost::mutex> delivery(deliveryMutex_);
+        DeliverNext();
+    }
+}
+
+void NotificationDispatchQueue::Dispatch(const Notification& notification)
+{
+    bool running;
+    bool deliverNow = false;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        numberDispatched_++;
+        running = running_;
+        if (running) {
+            queue_.push_back(notification);
+            deliverNow = queue_.size() > maxPending_;
+        }
+    }
+    if (!running) {
+        notification();
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            numberDelivered_++;
+        }
+        delivered_.notify_all();
+        return;
+    }
+    if (!deliverNow) {
+        dispatched_.notify_one();
+        return;
+    }
+
+    // The queue thread may be waiting on a lock held by this thread, so this never waits for it
+    boost::unique_lock<boost::mutex> delivery(deliveryMutex_, boost::try_to_lock);
+    if (!delivery.owns_lock()) {
+        dispatched_.notify_one();
+        return;
+    }
+    while (DeliverNext())
+        ;
+}
+
+void NotificationDispatchQueue::Start()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (running_ || thread_)
+        return;
+    running_ = true;
+    stopping_ = false;
+    thread_.reset(new boost::thread(boost::bind(&NotificationDispatchQueue::Run, this)));
+}
+
+void NotificationDispatchQueue::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (!thread_)
+            return;
+        stopping_ = true;
+    }
+    dispatched_.notify_all();
+    thread_->join();
+    thread_.reset();
+}
+
+bool NotificationDispatchQueue::IsRunning() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return running_;
+}
+
+void NotificationDispatchQueue::WaitUntilDelivered()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    const uint64_t target = numberDispatched_;
+    while (numberDelivered_ < target)
+        delivered_.wait(lock);
+}
+
+size_t NotificationDispatchQueue::Pending() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return queue_.size();
+}
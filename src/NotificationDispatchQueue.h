@@ -0,0 +1,73 @@
+#ifndef NOTIFICATION_DISPATCH_QUEUE_H
+#define NOTIFICATION_DISPATCH_QUEUE_H
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/**
+ * Delivers notifications one at a time and in the order they were
+ * dispatched, from a thread of its own once started.
+ *
+ * Dispatching does not wait for the listeners, so validation can move on
+ * to the next block while the wallet catches up with the last one. Before
+ * the queue is started, and after it is stopped, notifications are
+ * delivered straight away on the dispatching thread instead.
+ *
+ * The queue cannot make a dispatching thread wait for room, since it may
+ * hold locks the listeners need. Once more than the given number of
+ * notifications are pending, the dispatching thread delivers them itself,
+ * whenever the queue thread is not in the middle of one.
+ */
+class NotificationDispatchQueue
+{
+public:
+    typedef boost::function<void()> Notification;
+
+private:
+    mutable boost::mutex mutex_;
+    boost::condition_variable dispatched_;
+    boost::condition_variable delivered_;
+    //! Held while delivering, so notifications never overlap or overtake each other
+    boost::mutex deliveryMutex_;
+    std::deque<Notification> queue_;
+    const size_t maxPending_;
+    uint64_t numberDispatched_;
+    uint64_t numberDelivered_;
+    //! Cleared by the queue thread itself, once stopping and with nothing left pending or being delivered
+    bool running_;
+    bool stopping_;
+    boost::scoped_ptr<boost::thread> thread_;
+
+    //! Delivers the oldest pending notification, with the delivery mutex held
+    bool DeliverNext();
+    void Run();
+
+public:
+    explicit NotificationDispatchQueue(size_t maxPending);
+    ~NotificationDispatchQueue();
+
+    void Dispatch(const Notification& notification);
+    void Start();
+    /**
+     * Waits for the queue thread to deliver what is still pending, and what
+     * is dispatched meanwhile, before it exits. Dispatching threads are
+     * never made to wait on it in the meantime, so it must not be called
+     * while holding a lock the listeners take.
+     */
+    void Stop();
+    bool IsRunning() const;
+    /**
+     * Waits until the notifications dispatched so far have been delivered.
+     * Must not be called while holding a lock the listeners take, nor from
+     * a listener.
+     */
+    void WaitUntilDelivered();
+    size_t Pending() const;
+};
+#endif// NOTIFICATION_DISPATCH_QUEUE_H
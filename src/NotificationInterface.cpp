@@ -5,8 +5,19 @@
 
 #include "NotificationInterface.h"
 
+#include "primitives/block.h"
+
+#include <boost/bind.hpp>
+
 MainNotificationSignals NotificationInterfaceRegistry::g_signals;
 
+NotificationInterfaceRegistry::NotificationInterfaceRegistry(
+    ): registeredInterfaces()
+    , dispatchQueue(MAX_PENDING_NOTIFICATIONS)
+    , dispatchedBlock()
+{
+}
+
 void NotificationInterfaceRegistry::RegisterValidationInterface(NotificationInterface* pwalletIn)
 {
     registeredInterfaces.insert(pwalletIn);
@@ -27,7 +38,66 @@ void NotificationInterfaceRegistry::UnregisterAllValidationInterfaces() {
 }
 
 void NotificationInterfaceRegistry::SyncWithWallets(const CTransaction &tx, const CBlock *pblock = NULL) {
-    g_signals.SyncTransaction(tx, pblock);
+    if (!dispatchQueue.IsRunning()) {
+        g_signals.SyncTransaction(tx, pblock);
+        return;
+    }
+    if (pblock && !pblock->vtx.empty() && &tx >= &pblock->vtx.front() && &tx <= &pblock->vtx.back()) {
+        // Copy the block once for all of its transactions, rather than each transaction on its own
+        if (!dispatchedBlock || dispatchedBlock->GetHash() != pblock->GetHash())
+            dispatchedBlock.reset(new CBlock(*pblock));
+        dispatchQueue.Dispatch(boost::bind(&NotificationInterfaceRegistry::DeliverBlockTransaction, this, dispatchedBlock, size_t(&tx - &pblock->vtx.front())));
+        return;
+    }
+    boost::shared_ptr<const CTransaction> ptx(new CTransaction(tx));
+    boost::shared_ptr<const CBlock> pblockCopy(pblock ? new CBlock(*pblock) : NULL);
+    dispatchQueue.Dispatch(boost::bind(&NotificationInterfaceRegistry::DeliverTransaction, this, ptx, pblockCopy));
+}
+
+void NotificationInterfaceRegistry::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    dispatchQueue.Dispatch(boost::bind(&NotificationInterfaceRegistry::DeliverUpdatedBlockTip, this, pindex));
+}
+
+void NotificationInterfaceRegistry::SetBestChain(const CBlockLocator& locator)
+{
+    dispatchQueue.Dispatch(boost::bind(&NotificationInterfaceRegistry::DeliverBestChain, this, locator));
+}
+
+void NotificationInterfaceRegistry::StartAsynchronousNotifications()
+{
+    dispatchQueue.Start();
+}
+
+void NotificationInterfaceRegistry::StopAsynchronousNotifications()
+{
+    dispatchQueue.Stop();
+    dispatchedBlock.reset();
+}
+
+void NotificationInterfaceRegistry::WaitForPendingNotifications()
+{
+    dispatchQueue.WaitUntilDelivered();
+}
+
+void NotificationInterfaceRegistry::DeliverBlockTransaction(boost::shared_ptr<const CBlock> pblock, size_t nTx) const
+{
+    g_signals.SyncTransaction(pblock->vtx[nTx], pblock.get());
+}
+
+void NotificationInterfaceRegistry::DeliverTransaction(boost::shared_ptr<const CTransaction> ptx, boost::shared_ptr<const CBlock> pblock) const
+{
+    g_signals.SyncTransaction(*ptx, pblock.get());
+}
+
+void NotificationInterfaceRegistry::DeliverUpdatedBlockTip(const CBlockIndex* pindex) const
+{
+    g_signals.UpdatedBlockTip(pindex);
+}
+
+void NotificationInterfaceRegistry::DeliverBestChain(const CBlockLocator& locator) const
+{
+    g_signals.SetBestChain(locator);
 }
 
 MainNotificationSignals& NotificationInterfaceRegistry::getSignals() const
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_VALIDATIONINTERFACE_H
 #define BITCOIN_VALIDATIONINTERFACE_H
 
+#include <NotificationDispatchQueue.h>
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 #include <unordered_set>
@@ -49,7 +50,21 @@ class NotificationInterfaceRegistry
 private:
     static MainNotificationSignals g_signals;
     std::unordered_set<NotificationInterface*> registeredInterfaces;
+    /** Delivers transaction, tip and best chain updates in order, off the validation thread once started */
+    NotificationDispatchQueue dispatchQueue;
+    /** The copy of the block being connected, shared by the notifications for each of its transactions */
+    boost::shared_ptr<const CBlock> dispatchedBlock;
+
+    void DeliverBlockTransaction(boost::shared_ptr<const CBlock> pblock, size_t nTx) const;
+    void DeliverTransaction(boost::shared_ptr<const CTransaction> ptx, boost::shared_ptr<const CBlock> pblock) const;
+    void DeliverUpdatedBlockTip(const CBlockIndex* pindex) const;
+    void DeliverBestChain(const CBlockLocator& locator) const;
 public:
+    /** The pending notifications past which validation delivers them itself */
+    static const size_t MAX_PENDING_NOTIFICATIONS = 1000;
+
+    NotificationInterfaceRegistry();
+
     /** Register a wallet to receive updates from core */
     void RegisterValidationInterface(NotificationInterface* pwalletIn);
     /** Unregister a wallet from core */
@@ -58,6 +73,17 @@ public:
     void UnregisterAllValidationInterfaces();
     /** Push an updated transaction to all registered wallets */
     void SyncWithWallets(const CTransaction& tx, const CBlock* pblock);
+    /** Tell all registered wallets about the new chain tip */
+    void UpdatedBlockTip(const CBlockIndex* pindex);
+    /** Tell all registered wallets the best chain to record */
+    void SetBestChain(const CBlockLocator& locator);
+
+    /** Deliver the notifications above from a background thread, instead of the validating one */
+    void StartAsynchronousNotifications();
+    /** Deliver the notifications still pending, and any others as they come */
+    void StopAsynchronousNotifications();
+    /** Wait until the listeners have seen everything notified so far; never call with cs_main held */
+    void WaitForPendingNotifications();
 
     MainNotificationSignals& getSignals() const;
 };
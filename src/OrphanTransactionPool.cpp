@@ -0,0 +1,196 @@
+#include <OrphanTransactionPool.h>
+
+#include <Logging.h>
+#include <memusage.h>
+#include <random.h>
+#include <TransactionMemoryUsage.h>
+#include <serialize.h>
+
+OrphanTransactionPool::OrphanTransactionPool(
+    ): orphans_()
+    , orphansByOutPoint_()
+    , peers_()
+    , totalBytes_(0)
+    , nextExpiry_(0)
+{
+}
+
+bool OrphanTransactionPool::Add(const CTransaction& tx, NodeId peer, int64_t nNow, size_t nMaxPeerBytes)
+{
+    const uint256 hash = tx.GetHash();
+    if (Contains(hash))
+        return false;
+
+    // Ignore big transactions, to avoid a
+    // send-big-orphans memory exhaustion attack. If a peer has a legitimate
+    // large transaction with a missing parent then we assume
+    // it will rebroadcast it later, after the parent transaction(s)
+    // have been mined or received.
+    const size_t sz = tx.GetSerializeSize(SER_NETWORK, CTransaction::CURRENT_VERSION);
+    if (sz > MAX_ORPHAN_TX_SIZE || sz > nMaxPeerBytes) {
+        LogPrint(LOG_MEMPOOL, "ignoring large orphan tx (size: %u, hash: %s)\n", sz, hash);
+        return false;
+    }
+
+    // The peer makes room from its own oldest orphans
+    std::map<NodeId, PeerOrphans>::iterator peerIt;
+    while ((peerIt = peers_.find(peer)) != peers_.end() && peerIt->second.bytes + sz > nMaxPeerBytes)
+        EraseOldestOf(peerIt);
+    peerIt = peers_.insert(std::make_pair(peer, PeerOrphans())).first;
+
+    orphans_.insert(std::make_pair(hash, Orphan(tx, peer, nNow, sz)));
+    for (const CTxIn& txin : tx.vin)
+        orphansByOutPoint_[txin.prevout].insert(hash);
+    peerIt->second.bytes += sz;
+    peerIt->second.byAge.insert(std::make_pair(nNow, hash));
+    totalBytes_ += sz;
+
+    LogPrint(LOG_MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash,
+             orphans_.size(), orphansByOutPoint_.size());
+    return true;
+}
+
+bool OrphanTransactionPool::Contains(const uint256& hash) const
+{
+    return orphans_.count(hash) > 0;
+}
+
+const CTransaction* OrphanTransactionPool::Get(const uint256& hash, NodeId& peer) const
+{
+    Orphans::const_iterator it = orphans_.find(hash);
+    if (it == orphans_.end())
+        return nullptr;
+    peer = it->second.fromPeer;
+    return &it->second.tx;
+}
+
+void OrphanTransactionPool::GetOrphansSpending(const CTransaction& parent, std::vector<uint256>& orphans) const
+{
+    if (orphansByOutPoint_.empty())
+        return;
+    const uint256 hash = parent.GetHash();
+    std::set<uint256> found;
+    for (unsigned int i = 0; i < parent.vout.size(); i++) {
+        OrphansByOutPoint::const_iterator it = orphansByOutPoint_.find(COutPoint(hash, i));
+        if (it == orphansByOutPoint_.end())
+            continue;
+        for (const uint256& orphan : it->second) {
+            if (found.insert(orphan).second)
+                orphans.push_back(orphan);
+        }
+    }
+}
+
+void OrphanTransactionPool::Erase(const uint256& hash)
+{
+    Orphans::iterator it = orphans_.find(hash);
+    if (it == orphans_.end())
+        return;
+    const Orphan& orphan = it->second;
+    for (const CTxIn& txin : orphan.tx.vin) {
+        OrphansByOutPoint::iterator spending = orphansByOutPoint_.find(txin.prevout);
+        if (spending == orphansByOutPoint_.end())
+            continue;
+        spending->second.erase(hash);
+        if (spending->second.empty())
+            orphansByOutPoint_.erase(spending);
+    }
+
+    std::map<NodeId, PeerOrphans>::iterator peerIt = peers_.find(orphan.fromPeer);
+    peerIt->second.bytes -= orphan.nSize;
+    peerIt->second.byAge.erase(std::make_pair(orphan.nTimeAdded, hash));
+    if (peerIt->second.byAge.empty())
+        peers_.erase(peerIt);
+    totalBytes_ -= orphan.nSize;
+    orphans_.erase(it);
+}
+
+void OrphanTransactionPool::EraseOldestOf(std::map<NodeId, PeerOrphans>::iterator peer)
+{
+    Erase(peer->second.byAge.begin()->second);
+}
+
+unsigned int OrphanTransactionPool::EraseForPeer(NodeId peer)
+{
+    unsigned int nErased = 0;
+    // The peer's entry goes away with its last orphan
+    std::map<NodeId, PeerOrphans>::iterator peerIt;
+    while ((peerIt = peers_.find(peer)) != peers_.end()) {
+        EraseOldestOf(peerIt);
+        ++nErased;
+    }
+    if (nErased > 0) LogPrint(LOG_MEMPOOL, "Erased %d orphan tx from peer %d\n", nErased, peer);
+    return nErased;
+}
+
+unsigned int OrphanTransactionPool::Expire(int64_t nNow)
+{
+    if (nNow < nextExpiry_)
+        return 0;
+    nextExpiry_ = nNow + ORPHAN_TX_EXPIRE_INTERVAL;
+
+    std::vector<uint256> expired;
+    for (const std::pair<const NodeId, PeerOrphans>& peer : peers_) {
+        for (const std::pair<int64_t, uint256>& orphan : peer.second.byAge) {
+            if (orphan.first + ORPHAN_TX_EXPIRE_TIME > nNow)
+                break;
+            expired.push_back(orphan.second);
+        }
+    }
+    for (const uint256& hash : expired)
+        Erase(hash);
+    if (!expired.empty()) LogPrint(LOG_MEMPOOL, "Erased %u orphan tx due to expiration\n", expired.size());
+    return expired.size();
+}
+
+unsigned int OrphanTransactionPool::LimitCount(unsigned int nMaxOrphans)
+{
+    unsigned int nEvicted = 0;
+    while (orphans_.size() > nMaxOrphans) {
+        std::map<NodeId, PeerOrphans>::iterator heaviest = peers_.begin();
+        for (std::map<NodeId, PeerOrphans>::iterator it = peers_.begin(); it != peers_.end(); ++it) {
+            if (it->second.bytes > heaviest->second.bytes)
+                heaviest = it;
+        }
+        EraseOldestOf(heaviest);
+        ++nEvicted;
+    }
+    return nEvicted;
+}
+
+const CTransaction& OrphanTransactionPool::SelectRandom() const
+{
+    Orphans::const_iterator it = orphans_.lower_bound(GetRandHash());
+    if (it == orphans_.end())
+        it = orphans_.begin();
+    return it->second.tx;
+}
+
+void OrphanTransactionPool::GetTransactions(std::vector<const CTransaction*>& transactions) const
+{
+    transactions.reserve(transactions.size() + orphans_.size());
+    for (const std::pair<const uint256, Orphan>& orphan : orphans_)
+        transactions.push_back(&orphan.second.tx);
+}
+
+OrphanTransactionPool::Stats OrphanTransactionPool::GetStats() const
+{
+    Stats stats;
+    stats.count = orphans_.size();
+    stats.bytes = totalBytes_;
+    for (const std::pair<const NodeId, PeerOrphans>& peer : peers_)
+        stats.peers.push_back(PeerStats(peer.first, peer.second.byAge.size(), peer.second.bytes));
+    return stats;
+}
+
+size_t OrphanTransactionPool::DynamicMemoryUsage() const
+{
+    size_t usage = memusage::DynamicUsage(orphans_) + memusage::DynamicUsage(orphansByOutPoint_) + memusage::DynamicUsage(peers_);
+    for (const std::pair<const uint256, Orphan>& orphan : orphans_)
+        usage += TransactionMemoryUsage(orphan.second.tx);
+    for (const std::pair<const COutPoint, std::set<uint256> >& spenders : orphansByOutPoint_)
+        usage += memusage::DynamicUsage(spenders.second);
+    for (const std::pair<const NodeId, PeerOrphans>& peer : peers_)
+        usage += memusage::DynamicUsage(peer.second.byAge);
+    return usage;
+}
@@ -0,0 +1,115 @@
+#ifndef ORPHAN_TRANSACTION_POOL_H
+#define ORPHAN_TRANSACTION_POOL_H
+#include <coins.h>
+#include <net.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+/**
+ * Transactions whose inputs could not be found yet, held until a parent
+ * arrives.
+ *
+ * Each peer may hold only so many bytes of orphans, past which its oldest ones
+ * make room for the new. When the pool as a whole is too large, the peer
+ * holding the most bytes gives up its oldest orphan first, so a single peer
+ * flooding the pool only pushes out its own. Orphans expire after a while, and
+ * are indexed by the outpoints they spend, so the orphans waiting on a parent
+ * are found by a lookup per output of the parent.
+ */
+class OrphanTransactionPool
+{
+public:
+    struct PeerStats {
+        NodeId peer;
+        size_t count;
+        size_t bytes;
+
+        PeerStats(NodeId peerIn, size_t countIn, size_t bytesIn): peer(peerIn), count(countIn), bytes(bytesIn) {}
+    };
+    struct Stats {
+        size_t count;
+        size_t bytes;
+        std::vector<PeerStats> peers;
+
+        Stats(): count(0), bytes(0), peers() {}
+    };
+
+private:
+    struct Orphan {
+        CTransaction tx;
+        NodeId fromPeer;
+        int64_t nTimeAdded;
+        size_t nSize;
+
+        Orphan(const CTransaction& txIn, NodeId fromPeerIn, int64_t nTimeAddedIn, size_t nSizeIn)
+            : tx(txIn), fromPeer(fromPeerIn), nTimeAdded(nTimeAddedIn), nSize(nSizeIn) {}
+    };
+    struct PeerOrphans {
+        size_t bytes;
+        //! Time added and hash of the orphans of the peer, oldest first
+        std::set<std::pair<int64_t, uint256> > byAge;
+
+        PeerOrphans(): bytes(0), byAge() {}
+    };
+    class OutPointHasher
+    {
+    private:
+        CCoinsKeyHasher txidHasher_;
+
+    public:
+        size_t operator()(const COutPoint& outpoint) const { return txidHasher_(outpoint.hash) ^ outpoint.n; }
+    };
+
+    typedef std::map<uint256, Orphan> Orphans;
+    typedef boost::unordered_map<COutPoint, std::set<uint256>, OutPointHasher, std::equal_to<COutPoint> > OrphansByOutPoint;
+
+    Orphans orphans_;
+    OrphansByOutPoint orphansByOutPoint_;
+    std::map<NodeId, PeerOrphans> peers_;
+    size_t totalBytes_;
+    int64_t nextExpiry_;
+
+    void EraseOldestOf(std::map<NodeId, PeerOrphans>::iterator peer);
+
+public:
+    OrphanTransactionPool();
+
+    //! Orphans larger than this are not kept at all
+    static const size_t MAX_ORPHAN_TX_SIZE = 5000;
+    //! How long an orphan is kept waiting for its parents
+    static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
+    //! How often to look for orphans that expired
+    static const int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
+
+    bool Add(const CTransaction& tx, NodeId peer, int64_t nNow, size_t nMaxPeerBytes);
+    bool Contains(const uint256& hash) const;
+    //! The orphan with the hash, or null if there is none
+    const CTransaction* Get(const uint256& hash, NodeId& peer) const;
+    //! Append the hashes of the orphans spending outputs of the parent, each once
+    void GetOrphansSpending(const CTransaction& parent, std::vector<uint256>& orphans) const;
+    void Erase(const uint256& hash);
+    unsigned int EraseForPeer(NodeId peer);
+    //! Erase what has been waiting too long, looking at most once an interval
+    unsigned int Expire(int64_t nNow);
+    unsigned int LimitCount(unsigned int nMaxOrphans);
+    const CTransaction& SelectRandom() const;
+    //! Append every orphan, for matching against the short ids of a compact block
+    void GetTransactions(std::vector<const CTransaction*>& transactions) const;
+
+    size_t Size() const { return orphans_.size(); }
+    bool IsEmpty() const { return orphans_.empty() && orphansByOutPoint_.empty() && peers_.empty(); }
+    Stats GetStats() const;
+    size_t DynamicMemoryUsage() const;
+};
+#endif// ORPHAN_TRANSACTION_POOL_H
@@ -1,16 +1,21 @@
 #ifndef ORPHAN_TRANSACTIONS_H
 #define ORPHAN_TRANSACTIONS_H
+#include <defaultValues.h>
 #include <net.h>
+#include <OrphanTransactionPool.h>
 #include <uint256.h>
-#include <set>
-const std::set<uint256>& GetOrphanSpendingTransactionIds(const uint256& txHash);
-const CTransaction& GetOrphanTransaction(const uint256& txHash, NodeId& peer);
+#include <vector>
+void GetOrphansSpending(const CTransaction& parent, std::vector<uint256>& orphans);
+const CTransaction* GetOrphanTransaction(const uint256& txHash, NodeId& peer);
 bool OrphanTransactionIsKnown(const uint256& hash);
-bool AddOrphanTx(const CTransaction& tx, NodeId peer);
+bool AddOrphanTx(const CTransaction& tx, NodeId peer, size_t nMaxPeerBytes = DEFAULT_MAX_ORPHAN_PEER_BYTES);
 void EraseOrphanTx(uint256 hash);
 void EraseOrphansFor(NodeId peer);
 unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
 const CTransaction& SelectRandomOrphan();
+void GetOrphanTransactions(std::vector<const CTransaction*>& transactions);
 size_t OrphanTotalCount();
 bool OrphanMapsAreEmpty();
+OrphanTransactionPool::Stats GetOrphanStats();
+size_t OrphanDynamicMemoryUsage();
 #endif// ORPHAN_TRANSACTIONS_H
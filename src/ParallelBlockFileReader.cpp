@@ -0,0 +1,129 @@
+#include <ParallelBlockFileReader.h>
+
+#include <BlockFileScanner.h>
+#include <primitives/block.h>
+#include <util.h>
+
+#include <string.h>
+
+#include <boost/bind.hpp>
+
+ParallelBlockFileReader::ParallelBlockFileReader(
+    FileOpener openFile,
+    const MessageStartChars& messageStart,
+    unsigned nThreads,
+    size_t maxQueuedBlocksPerFile
+    ): openFile_(openFile)
+    , messageStart_()
+    , maxQueuedBlocksPerFile_(std::max<size_t>(maxQueuedBlocksPerFile, 1))
+    , mutex_()
+    , queuesChanged_()
+    , files_()
+    , nNextFileToScan_(0)
+    , nNextFileToRead_(0)
+    , fNoFilesLeft_(false)
+    , stopRequested_(false)
+    , strError_()
+    , scannerThreads_()
+{
+    memcpy(messageStart_, messageStart, MESSAGE_START_SIZE);
+    for (unsigned n = 0; n < std::max(nThreads, 1u); n++)
+        scannerThreads_.create_thread(boost::bind(&ParallelBlockFileReader::ThreadScanBlockFiles, this));
+}
+
+ParallelBlockFileReader::~ParallelBlockFileReader()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    queuesChanged_.notify_all();
+    scannerThreads_.join_all();
+}
+
+bool ParallelBlockFileReader::QueueBlock(int nFile, CBlock& block, uint64_t nBlockPos)
+{
+    ScannedBlock scannedBlock;
+    // Only the block as stored is needed, which saves copying its transactions.
+    scannedBlock.block = std::make_shared<CBlock>(block.GetBlockHeader());
+    scannedBlock.block->vtx.swap(block.vtx);
+    scannedBlock.block->vchBlockSig.swap(block.vchBlockSig);
+    scannedBlock.pos = CDiskBlockPos(nFile, nBlockPos);
+
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    FileQueue& queue = files_[nFile];
+    while (!stopRequested_ && queue.blocks.size() >= maxQueuedBlocksPerFile_)
+        queuesChanged_.wait(lock);
+    if (stopRequested_)
+        return false;
+    queue.blocks.push_back(scannedBlock);
+    queuesChanged_.notify_all();
+    return true;
+}
+
+void ParallelBlockFileReader::FinishFile(int nFile, bool fMissing, const std::string& strError)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    FileQueue& queue = files_[nFile];
+    queue.fScanned = true;
+    queue.fMissing = fMissing;
+    queue.strError = strError;
+    if (fMissing)
+        fNoFilesLeft_ = true;
+    queuesChanged_.notify_all();
+}
+
+void ParallelBlockFileReader::ThreadScanBlockFiles()
+{
+    RenameThread("izzy-scanblk");
+    while (true) {
+        int nFile;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            if (stopRequested_ || fNoFilesLeft_)
+                return;
+            nFile = nNextFileToScan_++;
+        }
+        FILE* file = openFile_(nFile);
+        if (!file) {
+            FinishFile(nFile, true, "");
+            return;
+        }
+        std::string strError;
+        try {
+            ScanBlockFile(file, messageStart_, boost::bind(&ParallelBlockFileReader::QueueBlock, this, nFile, _1, _2));
+        } catch (std::runtime_error& e) {
+            strError = e.what();
+        }
+        FinishFile(nFile, false, strError);
+    }
+}
+
+bool ParallelBlockFileReader::Next(ScannedBlock& scannedBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (true) {
+        FileQueue& queue = files_[nNextFileToRead_];
+        if (!queue.blocks.empty()) {
+            scannedBlock = queue.blocks.front();
+            queue.blocks.pop_front();
+            queuesChanged_.notify_all();
+            return true;
+        }
+        if (!queue.fScanned) {
+            queuesChanged_.wait(lock);
+            continue;
+        }
+        if (queue.fMissing || !queue.strError.empty()) {
+            strError_ = queue.strError;
+            return false;
+        }
+        files_.erase(nNextFileToRead_++);
+    }
+}
+
+std::string ParallelBlockFileReader::GetError() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return strError_;
+}
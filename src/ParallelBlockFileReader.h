@@ -0,0 +1,85 @@
+#ifndef PARALLEL_BLOCK_FILE_READER_H
+#define PARALLEL_BLOCK_FILE_READER_H
+#include <chain.h>
+#include <chainparams.h>
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class CBlock;
+
+/**
+ * Scans numbered block files on a pool of threads and hands their blocks to a
+ * single reader in file order, and in the order they are stored within a file.
+ *
+ * Each scanning thread claims the next file number and queues the blocks it
+ * deserializes for that file; a queue holding maxQueuedBlocksPerFile blocks
+ * stalls its thread until the reader catches up. The file being read can
+ * always make progress, so no more than one file per thread is held in memory,
+ * and only partially. The first file number for which no file can be opened
+ * ends the sequence.
+ */
+class ParallelBlockFileReader
+{
+public:
+    //! Open block file nFile for reading, or NULL if there is none
+    typedef std::function<FILE*(int nFile)> FileOpener;
+
+    struct ScannedBlock {
+        std::shared_ptr<CBlock> block;
+        //! Position right after the block's header, like blocks stored by WriteBlockToDisk
+        CDiskBlockPos pos;
+    };
+
+private:
+    struct FileQueue {
+        std::deque<ScannedBlock> blocks;
+        bool fScanned;
+        bool fMissing;
+        std::string strError;
+
+        FileQueue() : blocks(), fScanned(false), fMissing(false), strError() {}
+    };
+
+    const FileOpener openFile_;
+    MessageStartChars messageStart_;
+    const size_t maxQueuedBlocksPerFile_;
+    mutable boost::mutex mutex_;
+    boost::condition_variable queuesChanged_;
+    std::map<int, FileQueue> files_;
+    int nNextFileToScan_;
+    int nNextFileToRead_;
+    bool fNoFilesLeft_;
+    bool stopRequested_;
+    std::string strError_;
+    boost::thread_group scannerThreads_;
+
+    bool QueueBlock(int nFile, CBlock& block, uint64_t nBlockPos);
+    void FinishFile(int nFile, bool fMissing, const std::string& strError);
+    void ThreadScanBlockFiles();
+
+public:
+    ParallelBlockFileReader(
+        FileOpener openFile,
+        const MessageStartChars& messageStart,
+        unsigned nThreads,
+        size_t maxQueuedBlocksPerFile);
+    ~ParallelBlockFileReader();
+
+    //! Wait for the next block; false once the files run out or one of them failed to read
+    bool Next(ScannedBlock& scannedBlock);
+
+    //! Why the file Next stopped at could not be read, empty if the files simply ran out
+    std::string GetError() const;
+};
+#endif// PARALLEL_BLOCK_FILE_READER_H
@@ -0,0 +1,136 @@
+#include <PartiallyDownloadedBlock.h>
+
+#include <CompactBlock.h>
+#include <sync.h>
+#include <txmempool.h>
+
+#include <unordered_map>
+
+PartiallyDownloadedBlock::PartiallyDownloadedBlock(
+    ): header_()
+    , vchBlockSig_()
+    , transactions_()
+    , prefilledCount_(0)
+    , mempoolCount_(0)
+    , extraCount_(0)
+{
+}
+
+PartiallyDownloadedBlock::ReadStatus PartiallyDownloadedBlock::InitData(
+    const CompactBlock& compactBlock,
+    const CTxMemPool& pool,
+    const std::vector<const CTransaction*>& extraTransactions)
+{
+    if (compactBlock.header.IsNull() || compactBlock.BlockTransactionCount() == 0)
+        return READ_STATUS_INVALID;
+    if (compactBlock.BlockTransactionCount() > CompactBlock::MAX_TRANSACTIONS)
+        return READ_STATUS_INVALID;
+
+    header_ = compactBlock.header;
+    vchBlockSig_ = compactBlock.vchBlockSig;
+    transactions_.assign(compactBlock.BlockTransactionCount(), CTransactionRef());
+    prefilledCount_ = 0;
+    mempoolCount_ = 0;
+    extraCount_ = 0;
+
+    for (const CompactBlock::PrefilledTransaction& prefilled : compactBlock.prefilledTransactions) {
+        const bool inOrder = prefilledCount_ == 0 || prefilled.index > compactBlock.prefilledTransactions[prefilledCount_ - 1].index;
+        if (!inOrder || prefilled.index >= transactions_.size() || prefilled.tx.IsNull())
+            return READ_STATUS_INVALID;
+        transactions_[prefilled.index] = MakeTransactionRef(prefilled.tx);
+        prefilledCount_++;
+    }
+
+    // The short ids name the positions left over, in order
+    std::unordered_map<uint64_t, uint32_t> positionsByShortId;
+    positionsByShortId.reserve(compactBlock.shortIds.size());
+    uint32_t position = 0;
+    for (uint64_t shortId : compactBlock.shortIds) {
+        while (transactions_[position])
+            position++;
+        positionsByShortId[shortId] = position++;
+    }
+    // Two transactions of the block with the same short id cannot be told apart
+    if (positionsByShortId.size() != compactBlock.shortIds.size())
+        return READ_STATUS_FAILED;
+
+    // A short id matched more than once is asked for instead of guessed at
+    std::vector<bool> ambiguous(transactions_.size(), false);
+    {
+        LOCK(pool.cs);
+        for (std::map<uint256, CTxMemPoolEntry>::const_iterator it = pool.mapTx.begin(); it != pool.mapTx.end(); ++it) {
+            const std::unordered_map<uint64_t, uint32_t>::const_iterator match = positionsByShortId.find(compactBlock.GetShortId(it->first));
+            if (match == positionsByShortId.end() || ambiguous[match->second])
+                continue;
+            if (transactions_[match->second]) {
+                transactions_[match->second].reset();
+                ambiguous[match->second] = true;
+                mempoolCount_--;
+            } else {
+                transactions_[match->second] = it->second.GetSharedTx();
+                mempoolCount_++;
+            }
+            if (mempoolCount_ == positionsByShortId.size())
+                break;
+        }
+    }
+
+    for (const CTransaction* tx : extraTransactions) {
+        const uint256 txHash = tx->GetHash();
+        const std::unordered_map<uint64_t, uint32_t>::const_iterator match = positionsByShortId.find(compactBlock.GetShortId(txHash));
+        if (match == positionsByShortId.end() || ambiguous[match->second])
+            continue;
+        if (!transactions_[match->second]) {
+            transactions_[match->second] = MakeTransactionRef(*tx);
+            extraCount_++;
+        } else if (transactions_[match->second]->GetHash() != txHash) {
+            // An orphan may also still be in the mempool, which is no collision
+            transactions_[match->second].reset();
+            ambiguous[match->second] = true;
+        }
+    }
+    return READ_STATUS_OK;
+}
+
+bool PartiallyDownloadedBlock::IsInitialized() const
+{
+    return !transactions_.empty();
+}
+
+std::vector<uint32_t> PartiallyDownloadedBlock::GetMissingIndexes() const
+{
+    std::vector<uint32_t> missing;
+    for (uint32_t index = 0; index < transactions_.size(); index++) {
+        if (!transactions_[index])
+            missing.push_back(index);
+    }
+    return missing;
+}
+
+PartiallyDownloadedBlock::ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<CTransaction>& missingTransactions) const
+{
+    if (!IsInitialized())
+        return READ_STATUS_INVALID;
+
+    block = CBlock(header_);
+    block.vchBlockSig = vchBlockSig_;
+    block.vtx.reserve(transactions_.size());
+    size_t missingUsed = 0;
+    for (const CTransactionRef& tx : transactions_) {
+        if (tx) {
+            block.vtx.push_back(*tx);
+        } else {
+            if (missingUsed == missingTransactions.size())
+                return READ_STATUS_INVALID;
+            block.vtx.push_back(missingTransactions[missingUsed++]);
+        }
+    }
+    if (missingUsed != missingTransactions.size())
+        return READ_STATUS_INVALID;
+
+    // A short id collision with a transaction known here gives a different merkle root
+    bool mutated = false;
+    if (block.ComputeMerkleRoot(&mutated) != block.hashMerkleRoot || mutated)
+        return READ_STATUS_FAILED;
+    return READ_STATUS_OK;
+}
@@ -0,0 +1,59 @@
+#ifndef PARTIALLY_DOWNLOADED_BLOCK_H
+#define PARTIALLY_DOWNLOADED_BLOCK_H
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class CompactBlock;
+class CTxMemPool;
+
+/**
+ * A block being put back together from a compact block, out of its
+ * prefilled transactions and those the short ids match in the mempool or
+ * among the orphans, until the peer hands over the rest.
+ *
+ * Matching fails, and the full block has to be fetched, when a short id is
+ * repeated in the block or matches more than one known transaction, or when
+ * the filled in block turns out not to have the announced merkle root.
+ */
+class PartiallyDownloadedBlock
+{
+public:
+    enum ReadStatus {
+        READ_STATUS_OK,
+        //! The peer sent something no honest peer would
+        READ_STATUS_INVALID,
+        //! The block could not be put together, but nobody is to blame
+        READ_STATUS_FAILED,
+    };
+
+private:
+    CBlockHeader header_;
+    std::vector<unsigned char> vchBlockSig_;
+    std::vector<CTransactionRef> transactions_;
+    size_t prefilledCount_;
+    size_t mempoolCount_;
+    size_t extraCount_;
+
+public:
+    PartiallyDownloadedBlock();
+
+    //! Matches the short ids against the mempool and the extra transactions (such as the orphans), under the mempool lock
+    ReadStatus InitData(
+        const CompactBlock& compactBlock,
+        const CTxMemPool& pool,
+        const std::vector<const CTransaction*>& extraTransactions);
+    bool IsInitialized() const;
+    //! Positions of the transactions no match was found for, in ascending order
+    std::vector<uint32_t> GetMissingIndexes() const;
+    //! The block with the missing transactions filled in, in the order of their positions
+    ReadStatus FillBlock(CBlock& block, const std::vector<CTransaction>& missingTransactions) const;
+
+    size_t PrefilledCount() const { return prefilledCount_; }
+    size_t MempoolCount() const { return mempoolCount_; }
+    size_t ExtraCount() const { return extraCount_; }
+};
+#endif// PARTIALLY_DOWNLOADED_BLOCK_H
@@ -0,0 +1,212 @@
+#include <PerformanceStatistics.h>
+
+#include <utiltime.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <set>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+constexpr unsigned PerformanceTimerStats::NUMBER_OF_BUCKETS;
+constexpr unsigned PerformanceStatistics::NUMBER_OF_TIMERS;
+
+namespace
+{
+const char* const timerNames[PerformanceStatistics::NUMBER_OF_TIMERS] = {
+    "checkblock",
+    "connectblock",
+    "connecttip",
+    "mempool_accept",
+    "block_template",
+    "masternode_message",
+    "wallet_sync" };
+
+struct TimerCounters {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalMicros;
+    std::atomic<uint64_t> maximumMicros;
+    std::atomic<uint64_t> buckets[PerformanceTimerStats::NUMBER_OF_BUCKETS];
+
+    TimerCounters(): count(0), totalMicros(0), maximumMicros(0)
+    {
+        for (std::atomic<uint64_t>& bucket : buckets)
+            bucket = 0;
+    }
+
+    void Clear()
+    {
+        count = 0;
+        totalMicros = 0;
+        maximumMicros = 0;
+        for (std::atomic<uint64_t>& bucket : buckets)
+            bucket = 0;
+    }
+};
+
+struct ThreadCounters {
+    TimerCounters timers[PerformanceStatistics::NUMBER_OF_TIMERS];
+};
+
+// Never destroyed, as threads may still exit while static objects are torn down
+boost::mutex& GetThreadCountersMutex()
+{
+    static boost::mutex* csThreadCounters = new boost::mutex();
+    return *csThreadCounters;
+}
+std::set<ThreadCounters*>& GetLiveThreadCounters()
+{
+    static std::set<ThreadCounters*>* liveThreadCounters = new std::set<ThreadCounters*>();
+    return *liveThreadCounters;
+}
+ThreadCounters& GetExitedThreadCounters()
+{
+    static ThreadCounters* exitedThreadCounters = new ThreadCounters();
+    return *exitedThreadCounters;
+}
+
+void AddCounters(const TimerCounters& from, TimerCounters& to)
+{
+    to.count += from.count.load(std::memory_order_relaxed);
+    to.totalMicros += from.totalMicros.load(std::memory_order_relaxed);
+    to.maximumMicros = std::max(to.maximumMicros.load(std::memory_order_relaxed), from.maximumMicros.load(std::memory_order_relaxed));
+    for (unsigned bucket = 0; bucket < PerformanceTimerStats::NUMBER_OF_BUCKETS; ++bucket)
+        to.buckets[bucket] += from.buckets[bucket].load(std::memory_order_relaxed);
+}
+
+//! Called as a thread exits, keeping what it measured
+void RetireThreadCounters(ThreadCounters* counters)
+{
+    boost::lock_guard<boost::mutex> lock(GetThreadCountersMutex());
+    GetLiveThreadCounters().erase(counters);
+    for (unsigned timer = 0; timer < PerformanceStatistics::NUMBER_OF_TIMERS; ++timer)
+        AddCounters(counters->timers[timer], GetExitedThreadCounters().timers[timer]);
+    delete counters;
+}
+
+boost::thread_specific_ptr<ThreadCounters> threadCounters(&RetireThreadCounters);
+
+ThreadCounters& GetThreadCounters()
+{
+    ThreadCounters* counters = threadCounters.get();
+    if (counters == NULL) {
+        counters = new ThreadCounters();
+        {
+            boost::lock_guard<boost::mutex> lock(GetThreadCountersMutex());
+            GetLiveThreadCounters().insert(counters);
+        }
+        threadCounters.reset(counters);
+    }
+    return *counters;
+}
+
+unsigned HistogramBucket(uint64_t micros)
+{
+    unsigned bucket = 0;
+    while (micros != 0 && bucket + 1 < PerformanceTimerStats::NUMBER_OF_BUCKETS) {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+}
+
+PerformanceTimerStats::PerformanceTimerStats(
+    ): name()
+    , count(0)
+    , totalMicros(0)
+    , maximumMicros(0)
+    , buckets(NUMBER_OF_BUCKETS, 0)
+{
+}
+
+int64_t PerformanceTimerStats::BucketUpperBound(unsigned bucket)
+{
+    return bucket + 1 < NUMBER_OF_BUCKETS ? (int64_t(1) << bucket) - 1 : -1;
+}
+
+uint64_t PerformanceTimerStats::Percentile(double fraction) const
+{
+    if (count == 0)
+        return 0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * count)));
+    uint64_t cumulativeCount = 0;
+    for (unsigned bucket = 0; bucket < NUMBER_OF_BUCKETS; ++bucket) {
+        cumulativeCount += buckets[bucket];
+        if (cumulativeCount >= rank) {
+            const int64_t upperBound = BucketUpperBound(bucket);
+            return upperBound < 0 ? maximumMicros : std::min<uint64_t>(upperBound, maximumMicros);
+        }
+    }
+    return maximumMicros;
+}
+
+const char* PerformanceStatistics::TimerName(PerformanceTimer timer)
+{
+    assert(timer != PerformanceTimer::NUMBER_OF_TIMERS);
+    return timerNames[static_cast<unsigned>(timer)];
+}
+
+void PerformanceStatistics::Record(PerformanceTimer timer, int64_t micros)
+{
+    assert(timer != PerformanceTimer::NUMBER_OF_TIMERS);
+    // The clock is not monotonic, so a step back is counted as no time at all
+    const uint64_t elapsed = static_cast<uint64_t>(std::max<int64_t>(0, micros));
+    TimerCounters& counters = GetThreadCounters().timers[static_cast<unsigned>(timer)];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.totalMicros.fetch_add(elapsed, std::memory_order_relaxed);
+    if (elapsed > counters.maximumMicros.load(std::memory_order_relaxed))
+        counters.maximumMicros.store(elapsed, std::memory_order_relaxed);
+    counters.buckets[HistogramBucket(elapsed)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<PerformanceTimerStats> PerformanceStatistics::GetStats()
+{
+    ThreadCounters total;
+    {
+        boost::lock_guard<boost::mutex> lock(GetThreadCountersMutex());
+        for (unsigned timer = 0; timer < NUMBER_OF_TIMERS; ++timer) {
+            AddCounters(GetExitedThreadCounters().timers[timer], total.timers[timer]);
+            for (const ThreadCounters* counters : GetLiveThreadCounters())
+                AddCounters(counters->timers[timer], total.timers[timer]);
+        }
+    }
+
+    std::vector<PerformanceTimerStats> stats(NUMBER_OF_TIMERS);
+    for (unsigned timer = 0; timer < NUMBER_OF_TIMERS; ++timer) {
+        const TimerCounters& counters = total.timers[timer];
+        stats[timer].name = timerNames[timer];
+        stats[timer].count = counters.count;
+        stats[timer].totalMicros = counters.totalMicros;
+        stats[timer].maximumMicros = counters.maximumMicros;
+        for (unsigned bucket = 0; bucket < PerformanceTimerStats::NUMBER_OF_BUCKETS; ++bucket)
+            stats[timer].buckets[bucket] = counters.buckets[bucket];
+    }
+    return stats;
+}
+
+void PerformanceStatistics::Reset()
+{
+    boost::lock_guard<boost::mutex> lock(GetThreadCountersMutex());
+    for (unsigned timer = 0; timer < NUMBER_OF_TIMERS; ++timer) {
+        GetExitedThreadCounters().timers[timer].Clear();
+        for (ThreadCounters* counters : GetLiveThreadCounters())
+            counters->timers[timer].Clear();
+    }
+}
+
+PerformanceTimerScope::PerformanceTimerScope(
+    PerformanceTimer timer
+    ): timer_(timer)
+    , startMicros_(GetTimeMicros())
+{
+}
+
+PerformanceTimerScope::~PerformanceTimerScope()
+{
+    PerformanceStatistics::Record(timer_, GetTimeMicros() - startMicros_);
+}
@@ -0,0 +1,69 @@
+#ifndef PERFORMANCE_STATISTICS_H
+#define PERFORMANCE_STATISTICS_H
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//! The hot paths whose latency is timed
+enum class PerformanceTimer {
+    CHECK_BLOCK,
+    CONNECT_BLOCK,
+    CONNECT_TIP,
+    MEMPOOL_ACCEPT,
+    BLOCK_TEMPLATE,
+    MASTERNODE_MESSAGE,
+    WALLET_SYNC,
+    NUMBER_OF_TIMERS
+};
+
+/** What one timer has measured, summed over all threads */
+struct PerformanceTimerStats {
+    //! Histogram bucket i counts times from 2^(i-1) up to 2^i microseconds, the last one everything longer
+    static constexpr unsigned NUMBER_OF_BUCKETS = 32;
+
+    std::string name;
+    uint64_t count;
+    uint64_t totalMicros;
+    uint64_t maximumMicros;
+    std::vector<uint64_t> buckets;
+
+    PerformanceTimerStats();
+    //! Upper bound in microseconds of the bucket holding the given fraction of the measurements, 0 when there are none
+    uint64_t Percentile(double fraction) const;
+    //! Inclusive upper bound in microseconds of the histogram bucket, -1 for the last one
+    static int64_t BucketUpperBound(unsigned bucket);
+};
+
+/**
+ * Process wide latency histograms of the hot paths of validation, mempool
+ * acceptance, block template creation, masternode messages and wallet sync.
+ *
+ * Each thread records into counters of its own, which only that thread
+ * writes, so timing a call costs two clock reads and a few uncontended atomic
+ * adds. Reading adds up the counters of all threads, including those of
+ * threads which have exited since.
+ */
+class PerformanceStatistics
+{
+public:
+    static constexpr unsigned NUMBER_OF_TIMERS = static_cast<unsigned>(PerformanceTimer::NUMBER_OF_TIMERS);
+
+    static const char* TimerName(PerformanceTimer timer);
+    static void Record(PerformanceTimer timer, int64_t micros);
+
+    static std::vector<PerformanceTimerStats> GetStats();
+    static void Reset();
+};
+
+/** Times the scope it lives in into one of the timers */
+class PerformanceTimerScope
+{
+private:
+    const PerformanceTimer timer_;
+    const int64_t startMicros_;
+
+public:
+    explicit PerformanceTimerScope(PerformanceTimer timer);
+    ~PerformanceTimerScope();
+};
+#endif// PERFORMANCE_STATISTICS_H
@@ -17,14 +17,32 @@
 #include <utiltime.h>
 #include <StakableCoin.h>
 #include <timedata.h>
+#include <ProofOfStakeKernelSearch.h>
+#include <defaultValues.h>
+#include <StakingStatistics.h>
+#include <BlockRewards.h>
+
+#include <cassert>
+
+#include <boost/thread/thread.hpp>
 
 class StakedCoins
 {
 private:
     std::set<StakableCoin> underlyingSet_;
     int64_t timestampOfLastUpdate_;
+    unsigned walletVersion_;
+    int chainHeight_;
+    int64_t nextChangeTime_;
+    int nextChangeHeight_;
 public:
-    StakedCoins(): underlyingSet_(), timestampOfLastUpdate_(0)
+    StakedCoins(
+        ): underlyingSet_()
+        , timestampOfLastUpdate_(0)
+        , walletVersion_(0u)
+        , chainHeight_(0)
+        , nextChangeTime_(0)
+        , nextChangeHeight_(0)
     {
     }
     const int64_t& timestamp() const
@@ -43,8 +61,85 @@ public:
     {
         return underlyingSet_;
     }
+    void recordSelection(unsigned walletVersion, int chainHeight, int64_t nextChangeTime, int nextChangeHeight)
+    {
+        walletVersion_ = walletVersion;
+        chainHeight_ = chainHeight;
+        nextChangeTime_ = nextChangeTime;
+        nextChangeHeight_ = nextChangeHeight;
+    }
+    //! Whether the wallet, a coin's age or a coin's depth may have changed the selection since it was made
+    bool selectionMayHaveChanged(unsigned walletVersion, int chainHeight, int64_t adjustedTime) const
+    {
+        return walletVersion != walletVersion_ ||
+            chainHeight < chainHeight_ ||
+            chainHeight >= nextChangeHeight_ ||
+            adjustedTime >= nextChangeTime_;
+    }
 };
 
+/**
+ * The reward payouts of a coinstake on top of a given tip, which are the same
+ * whichever coin wins the kernel search. They are worked out once per tip,
+ * before hashing, so that a found kernel only leaves the coin's own outputs
+ * and the signatures to fill in. Masternode payment votes for the next block
+ * may still arrive while the tip stays the same, so a template is also worked
+ * out again once it is a hash drift old.
+ */
+class CoinstakePayoutTemplate
+{
+private:
+    uint256 tipHash_;
+    int64_t timestamp_;
+    CBlockRewards rewards_;
+    std::vector<CTxOut> payouts_;
+public:
+    CoinstakePayoutTemplate(
+        ): tipHash_(0)
+        , timestamp_(0)
+        , rewards_(0, 0, 0, 0, 0, 0)
+        , payouts_()
+    {
+    }
+    bool isFor(const CBlockIndex* chainTip) const
+    {
+        return tipHash_ == chainTip->GetBlockHash() && tipHash_ != 0;
+    }
+    bool isCurrentFor(const CBlockIndex* chainTip) const
+    {
+        return isFor(chainTip) && GetTime() - timestamp_ < I_ProofOfStakeGenerator::nHashDrift;
+    }
+    void prepare(
+        const CBlockIndex* chainTip,
+        const I_BlockSubsidyProvider& blockSubsidies,
+        const I_BlockIncentivesPopulator& incentives)
+    {
+        rewards_ = blockSubsidies.GetBlockSubsidity(chainTip->nHeight + 1);
+        CMutableTransaction payoutsOnly;
+        incentives.FillBlockPayee(payoutsOnly,rewards_,chainTip,true);
+        payouts_ = payoutsOnly.vout;
+        tipHash_ = chainTip->GetBlockHash();
+        timestamp_ = GetTime();
+    }
+    const CBlockRewards& rewards() const
+    {
+        return rewards_;
+    }
+    void appendPayouts(CMutableTransaction& txCoinStake) const
+    {
+        txCoinStake.vout.insert(txCoinStake.vout.end(), payouts_.begin(), payouts_.end());
+    }
+};
+
+static unsigned NumberOfStakingThreads(const Settings& settings)
+{
+    // -stakingthreads=0 means one thread per core
+    int64_t nThreads = settings.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS);
+    if (nThreads <= 0)
+        nThreads += boost::thread::hardware_concurrency();
+    return static_cast<unsigned>(std::max<int64_t>(1, std::min<int64_t>(nThreads, MAX_STAKING_THREADS)));
+}
+
 PoSTransactionCreator::PoSTransactionCreator(
     const Settings& settings,
     const CChainParams& chainParameters,
@@ -54,7 +149,8 @@ PoSTransactionCreator::PoSTransactionCreator(
     const I_BlockIncentivesPopulator& incentives,
     const I_ProofOfStakeGenerator& proofGenerator,
     CWallet& wallet,
-    std::map<unsigned int, unsigned int>& hashedBlockTimestamps
+    std::map<unsigned int, unsigned int>& hashedBlockTimestamps,
+    StakingStatistics& stakingStatistics
     ): settings_(settings)
     , chainParameters_(chainParameters)
     , activeChain_(activeChain)
@@ -63,28 +159,49 @@ PoSTransactionCreator::PoSTransactionCreator(
     , incentives_(incentives)
     , proofGenerator_(proofGenerator )
     , stakedCoins_(new StakedCoins())
+    , payoutTemplate_(new CoinstakePayoutTemplate())
+    , kernelSearch_(new ProofOfStakeKernelSearch(proofGenerator, NumberOfStakingThreads(settings)))
     , wallet_(wallet)
     , hashedBlockTimestamps_(hashedBlockTimestamps)
+    , stakingStatistics_(stakingStatistics)
     , hashproofTimestampMinimumValue_(0)
 {
 }
 
 PoSTransactionCreator::~PoSTransactionCreator()
 {
+    kernelSearch_.reset();
+    payoutTemplate_.reset();
     stakedCoins_.reset();
 }
 
 bool PoSTransactionCreator::SelectCoins()
 {
-    if (chainParameters_.NetworkID() == CBaseChainParams::REGTEST ||
-        GetTime() - stakedCoins_->timestamp() > settings_.GetArg("-stakeupdatetime",300))
+    // The wallet keeps its stake candidates up to date as transactions come in, so the coins
+    // are selected again as soon as they may have changed. The timer remains as a fallback that
+    // rebuilds the candidates from the whole wallet.
+    const bool selectionExpired = GetTime() - stakedCoins_->timestamp() > settings_.GetArg("-stakeupdatetime",300);
+    if (selectionExpired)
+    {
+        wallet_.MarkStakeCandidatesStale();
+    }
+    const unsigned walletVersion = wallet_.GetStakeCoinsVersion();
+    const int chainHeight = activeChain_.Height();
+    if (chainParameters_.NetworkID() == CBaseChainParams::REGTEST || selectionExpired ||
+        stakedCoins_->selectionMayHaveChanged(walletVersion, chainHeight, GetAdjustedTime()))
     {
         stakedCoins_->asSet().clear();
-        if (!wallet_.SelectStakeCoins(stakedCoins_->asSet())) {
+        int64_t nextChangeTime = 0;
+        int nextChangeHeight = 0;
+        if (!wallet_.SelectStakeCoins(stakedCoins_->asSet(), nextChangeTime, nextChangeHeight)) {
             return error("failed to select coins for staking");
         }
 
-        stakedCoins_->updateTimestamp();
+        if (selectionExpired)
+        {
+            stakedCoins_->updateTimestamp();
+        }
+        stakedCoins_->recordSelection(walletVersion, chainHeight, nextChangeTime, nextChangeHeight);
     }
 
     if (stakedCoins_->asSet().empty()) {
@@ -113,10 +230,10 @@ bool IsSupportedScript(
         LogPrintf("CreateCoinStake : failed to parse kernel\n");
         return false;
     }
-    LogPrint("staking","%s : parsed kernel type=%d\n",__func__, whichType);
+    LogPrint(LOG_STAKING,"%s : parsed kernel type=%d\n",__func__, whichType);
     if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_VAULT)
     {
-        LogPrint("staking","%s : no support for kernel type=%d\n",__func__, whichType);
+        LogPrint(LOG_STAKING,"%s : no support for kernel type=%d\n",__func__, whichType);
         return false; // only support pay to public key and pay to address
     }
     isVaultScript =whichType == TX_VAULT;
@@ -172,47 +289,27 @@ void PoSTransactionCreator::CombineUtxos(
     }
 }
 
-bool PoSTransactionCreator::FindHashproof(
+bool PoSTransactionCreator::GetStakingData(
     const CBlockIndex* chainTip,
     unsigned int nBits,
-    unsigned int& nTxNewTime,
     const StakableCoin& stakeData,
-    CMutableTransaction& txNew)
+    StakingData& stakingData) const
 {
     BlockMap::const_iterator it = mapBlockIndex_.find(stakeData.blockHashOfFirstConfirmation);
     if (it == mapBlockIndex_.end())
     {
-        LogPrint("staking","%s failed to find block index for %s\n",__func__,stakeData.blockHashOfFirstConfirmation);
+        LogPrint(LOG_STAKING,"%s failed to find block index for %s\n",__func__,stakeData.blockHashOfFirstConfirmation);
         return false;
     }
 
-    StakingData stakingData(
+    stakingData = StakingData(
         nBits,
         static_cast<unsigned>(it->second->GetBlockTime()),
         it->second->GetBlockHash(),
         COutPoint(stakeData.tx->GetHash(), stakeData.outputIndex),
         stakeData.tx->vout[stakeData.outputIndex].nValue,
         chainTip->GetBlockHash());
-    HashproofCreationResult hashproofResult = proofGenerator_.CreateHashproofTimestamp(stakingData,nTxNewTime);
-    if(!hashproofResult.failedAtSetup())
-    {
-        hashedBlockTimestamps_.clear();
-        hashedBlockTimestamps_[chainTip->nHeight] = GetTime();
-    }
-    if (hashproofResult.succeeded())
-    {
-        if (hashproofResult.timestamp() <= chainTip->GetMedianTimePast())
-        {
-            LogPrintf("%s : kernel found, but it is too far in the past \n",__func__);
-            return false;
-        }
-        LogPrint("staking","%s : kernel found for %s\n",__func__, stakeData.tx->ToStringShort());
-
-        SetSuportedStakingScript(stakeData,txNew);
-        nTxNewTime = hashproofResult.timestamp();
-        return true;
-    }
-    return false;
+    return true;
 }
 
 StakableCoin PoSTransactionCreator::FindProofOfStake(
@@ -222,23 +319,82 @@ StakableCoin PoSTransactionCreator::FindProofOfStake(
     unsigned int& nTxNewTime,
     bool& isVaultScript)
 {
+    std::vector<const StakableCoin*> candidateCoins;
+    std::vector<bool> candidateIsVault;
+    std::vector<StakingData> candidates;
     for (const StakableCoin& pcoin: stakedCoins_->asSet())
     {
-        if(!IsSupportedScript(pcoin.tx->vout[pcoin.outputIndex].scriptPubKey,isVaultScript))
+        bool isVault = false;
+        StakingData stakingData;
+        if(!IsSupportedScript(pcoin.tx->vout[pcoin.outputIndex].scriptPubKey,isVault) ||
+           !GetStakingData(chainTip,blockBits,pcoin,stakingData))
         {
             continue;
         }
-        if(chainTip->nHeight != activeChain_.Height())
+        candidateCoins.push_back(&pcoin);
+        candidateIsVault.push_back(isVault);
+        candidates.push_back(stakingData);
+    }
+    if(chainTip->nHeight != activeChain_.Height())
+    {
+        hashproofTimestampMinimumValue_ = 0;
+        stakingStatistics_.RecordMiss(StakingMiss::CHAIN_TIP_CHANGED);
+        return StakableCoin();
+    }
+
+    // The coins are hashed in parallel, but the winner is the first one in set order, as if hashed one by one
+    const unsigned timestampLimit = static_cast<unsigned>(chainTip->GetMedianTimePast());
+    std::vector<HashproofCreationResult> results;
+    const int64_t searchStart = GetTimeMicros();
+    const size_t first = kernelSearch_->FindFirstHashproof(candidates,nTxNewTime,timestampLimit,results);
+    const int64_t searchTime = GetTimeMicros() - searchStart;
+    if(chainTip->nHeight != activeChain_.Height())
+    {
+        hashproofTimestampMinimumValue_ = 0;
+        stakingStatistics_.RecordMiss(StakingMiss::CHAIN_TIP_CHANGED);
+        return StakableCoin();
+    }
+
+    // Only the kernels up to the winner are counted, not those other threads hashed past it
+    const size_t searched = std::min(first + 1, candidates.size());
+    uint64_t kernelsHashed = 0;
+    for (size_t index = 0; index < searched; index++)
+    {
+        if(results[index].succeeded())
+        {
+            kernelsHashed += nTxNewTime - results[index].timestamp() + 1;
+        }
+        else if(!results[index].failedAtSetup())
+        {
+            kernelsHashed += I_ProofOfStakeGenerator::nHashDrift;
+        }
+    }
+    stakingStatistics_.RecordKernelSearch(candidates.size(), kernelsHashed, searchTime);
+
+    for (size_t index = 0; index < searched; index++)
+    {
+        if(!results[index].failedAtSetup())
         {
-            hashproofTimestampMinimumValue_ = 0;
-            return StakableCoin();
+            hashedBlockTimestamps_.clear();
+            hashedBlockTimestamps_[chainTip->nHeight] = GetTime();
         }
-        if(FindHashproof(chainTip,blockBits, nTxNewTime, pcoin,txCoinStake) )
+        if(index != first && results[index].succeeded())
         {
-            return pcoin;
+            LogPrintf("%s : kernel found, but it is too far in the past \n",__func__);
         }
     }
+    if(first < candidates.size())
+    {
+        const StakableCoin& stakeData = *candidateCoins[first];
+        LogPrint(LOG_STAKING,"%s : kernel found for %s\n",__func__, stakeData.tx->ToStringShort());
+
+        SetSuportedStakingScript(stakeData,txCoinStake);
+        nTxNewTime = results[first].timestamp();
+        isVaultScript = candidateIsVault[first];
+        return stakeData;
+    }
     hashproofTimestampMinimumValue_ = nTxNewTime;
+    stakingStatistics_.RecordMiss(StakingMiss::NO_KERNEL_FOUND);
     return StakableCoin();
 }
 
@@ -249,8 +405,8 @@ void PoSTransactionCreator::SplitOrCombineUTXOS(
     const StakableCoin& stakeData,
     std::vector<const CTransaction*>& vwtxPrev)
 {
-    CBlockRewards blockSubdidy = blockSubsidies_.GetBlockSubsidity(chainTip->nHeight + 1);
-    CAmount nCredit = stakeData.tx->vout[stakeData.outputIndex].nValue + blockSubdidy.nStakeReward;
+    assert(payoutTemplate_->isFor(chainTip));
+    CAmount nCredit = stakeData.tx->vout[stakeData.outputIndex].nValue + payoutTemplate_->rewards().nStakeReward;
     constexpr char autocombineSettingLookup[] = "-autocombine";
     bool autocombine = settings_.GetBoolArg(autocombineSettingLookup,true);
     if (nCredit > stakeSplit )
@@ -275,8 +431,8 @@ void PoSTransactionCreator::AppendBlockRewardPayoutsToTransaction(
     const CBlockIndex* chainTip,
     CMutableTransaction& txCoinStake)
 {
-    CBlockRewards blockSubdidy = blockSubsidies_.GetBlockSubsidity(chainTip->nHeight + 1);
-    incentives_.FillBlockPayee(txCoinStake,blockSubdidy,chainTip,true);
+    assert(payoutTemplate_->isFor(chainTip));
+    payoutTemplate_->appendPayouts(txCoinStake);
 }
 
 bool PoSTransactionCreator::CreateProofOfStake(
@@ -287,7 +443,15 @@ bool PoSTransactionCreator::CreateProofOfStake(
 {
     MarkTransactionAsCoinstake(txCoinStake);
 
-    if(!SelectCoins()) return false;
+    stakingStatistics_.RecordAttempt();
+    const int64_t selectionStart = GetTimeMicros();
+    const bool coinsSelected = SelectCoins();
+    stakingStatistics_.RecordStageTime(StakingStage::COIN_SELECTION, GetTimeMicros() - selectionStart);
+    if(!coinsSelected)
+    {
+        stakingStatistics_.RecordMiss(StakingMiss::NO_STAKABLE_COINS);
+        return false;
+    }
 
     if(hashedBlockTimestamps_.count(chainTip->nHeight) == 0u)
     {
@@ -298,9 +462,18 @@ bool PoSTransactionCreator::CreateProofOfStake(
     const int64_t maximumTime = adjustedTime + settings_.MaxFutureBlockDrift() - 1;
     minimumTime += chainParameters_.RetargetDifficulty()? I_ProofOfStakeGenerator::nHashDrift: 0;
     minimumTime = std::max(hashproofTimestampMinimumValue_,minimumTime);
-    if(maximumTime <= minimumTime) return false;
+    if(maximumTime <= minimumTime)
+    {
+        stakingStatistics_.RecordMiss(StakingMiss::NO_TIME_WINDOW);
+        return false;
+    }
     nTxNewTime = std::min(std::max(adjustedTime, minimumTime), maximumTime);
 
+    if(!payoutTemplate_->isCurrentFor(chainTip))
+    {
+        payoutTemplate_->prepare(chainTip,blockSubsidies_,incentives_);
+    }
+
     bool isVaultScript = false;
     StakableCoin successfullyStakableUTXO =
         FindProofOfStake(chainTip, blockBits,txCoinStake,nTxNewTime,isVaultScript);
@@ -329,9 +502,13 @@ bool PoSTransactionCreator::CreateProofOfStake(
     int nIn = 0;
     for (const CTransaction* pcoin : vwtxPrev) {
         if (!SignSignature(wallet_, *pcoin, txCoinStake, nIn++))
+        {
+            stakingStatistics_.RecordMiss(StakingMiss::COINSTAKE_SIGNING_FAILED);
             return error("CreateCoinStake : failed to sign coinstake");
+        }
     }
 
     stakedCoins_->resetTimestamp(); //this will trigger stake set to repopulate next round
+    stakingStatistics_.RecordStakeFound();
     return true;
 }
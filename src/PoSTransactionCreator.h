@@ -24,8 +24,12 @@ class I_ProofOfStakeGenerator;
 class I_BlockSubsidyProvider;
 class BlockMap;
 class StakedCoins;
+class CoinstakePayoutTemplate;
 struct StakableCoin;
+struct StakingData;
+class ProofOfStakeKernelSearch;
 class Settings;
+class StakingStatistics;
 
 class PoSTransactionCreator: public I_PoSTransactionCreator
 {
@@ -38,8 +42,11 @@ private:
     const I_BlockIncentivesPopulator& incentives_;
     const I_ProofOfStakeGenerator& proofGenerator_;
     std::unique_ptr<StakedCoins> stakedCoins_;
+    std::unique_ptr<CoinstakePayoutTemplate> payoutTemplate_;
+    std::unique_ptr<ProofOfStakeKernelSearch> kernelSearch_;
     CWallet& wallet_;
     std::map<unsigned int, unsigned int>& hashedBlockTimestamps_;
+    StakingStatistics& stakingStatistics_;
     int64_t hashproofTimestampMinimumValue_;
 
     void CombineUtxos(
@@ -54,12 +61,11 @@ private:
 
     bool SelectCoins();
 
-    bool FindHashproof(
+    bool GetStakingData(
         const CBlockIndex* chainTip,
         unsigned int nBits,
-        unsigned int& nTxNewTime,
         const StakableCoin& stakeData,
-        CMutableTransaction& txNew);
+        StakingData& stakingData) const;
 
     StakableCoin FindProofOfStake(
         const CBlockIndex* chainTip,
@@ -87,7 +93,8 @@ public:
         const I_BlockIncentivesPopulator& incentives,
         const I_ProofOfStakeGenerator& proofGenerator,
         CWallet& wallet,
-        std::map<unsigned int, unsigned int>& hashedBlockTimestamps);
+        std::map<unsigned int, unsigned int>& hashedBlockTimestamps,
+        StakingStatistics& stakingStatistics);
     ~PoSTransactionCreator();
     virtual bool CreateProofOfStake(
         const CBlockIndex* chainTip,
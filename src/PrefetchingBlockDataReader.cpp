@@ -0,0 +1,110 @@
+#include <PrefetchingBlockDataReader.h>
+
+#include <chain.h>
+
+#include <utility>
+
+PrefetchingBlockDataReader::Prefetched::Prefetched(
+    const CBlockIndex* blockIndexIn
+    ): blockIndex(blockIndexIn)
+    , fBlockRead(false)
+    , block()
+    , fBlockUndoRead(false)
+    , blockUndo()
+{
+}
+
+PrefetchingBlockDataReader::PrefetchingBlockDataReader(
+    const I_BlockDataReader& reader,
+    const CBlockIndex* pindexStop
+    ): reader_(reader)
+    , pindexStop_(pindexStop)
+    , current_()
+    , ahead_()
+    , prefetcher_()
+    , nHits_(0)
+    , nMisses_(0)
+{
+}
+
+PrefetchingBlockDataReader::~PrefetchingBlockDataReader()
+{
+    if (prefetcher_.joinable())
+        prefetcher_.join();
+}
+
+PrefetchingBlockDataReader::Prefetched* PrefetchingBlockDataReader::Take(const CBlockIndex* blockIndex) const
+{
+    if (current_ && current_->blockIndex == blockIndex)
+        return current_.get();
+    if (ahead_ && ahead_->blockIndex == blockIndex) {
+        if (prefetcher_.joinable())
+            prefetcher_.join();
+        current_ = std::move(ahead_);
+        return current_.get();
+    }
+    return nullptr;
+}
+
+void PrefetchingBlockDataReader::ReadAhead(const CBlockIndex* blockIndex) const
+{
+    const CBlockIndex* pindexParent = blockIndex->pprev;
+    if (pindexParent == nullptr || pindexParent == pindexStop_ || pindexParent->pprev == nullptr)
+        return;
+    if (ahead_ && ahead_->blockIndex == pindexParent)
+        return;
+
+    if (prefetcher_.joinable())
+        prefetcher_.join();
+    ahead_.reset(new Prefetched(pindexParent));
+    Prefetched* prefetched = ahead_.get();
+    const I_BlockDataReader& reader = reader_;
+    prefetcher_ = boost::thread([prefetched, &reader]() {
+        prefetched->fBlockRead = reader.ReadBlock(prefetched->blockIndex, prefetched->block);
+        prefetched->fBlockUndoRead = reader.ReadBlockUndo(prefetched->blockIndex, prefetched->blockUndo);
+    });
+}
+
+bool PrefetchingBlockDataReader::ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+{
+    bool fRead;
+    Prefetched* prefetched = Take(blockIndex);
+    if (prefetched && prefetched->fBlockRead) {
+        nHits_++;
+        block = std::move(prefetched->block);
+        prefetched->fBlockRead = false;
+        fRead = true;
+    } else {
+        nMisses_++;
+        fRead = reader_.ReadBlock(blockIndex, block);
+    }
+    ReadAhead(blockIndex);
+    return fRead;
+}
+
+bool PrefetchingBlockDataReader::ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const
+{
+    bool fRead;
+    Prefetched* prefetched = Take(blockIndex);
+    if (prefetched && prefetched->fBlockUndoRead) {
+        nHits_++;
+        blockUndo = std::move(prefetched->blockUndo);
+        prefetched->fBlockUndoRead = false;
+        fRead = true;
+    } else {
+        nMisses_++;
+        fRead = reader_.ReadBlockUndo(blockIndex, blockUndo);
+    }
+    ReadAhead(blockIndex);
+    return fRead;
+}
+
+uint64_t PrefetchingBlockDataReader::GetHits() const
+{
+    return nHits_;
+}
+
+uint64_t PrefetchingBlockDataReader::GetMisses() const
+{
+    return nMisses_;
+}
@@ -0,0 +1,59 @@
+#ifndef PREFETCHING_BLOCK_DATA_READER_H
+#define PREFETCHING_BLOCK_DATA_READER_H
+#include <BlockUndo.h>
+#include <I_BlockDataReader.h>
+#include <primitives/block.h>
+
+#include <stdint.h>
+
+#include <memory>
+
+#include <boost/thread/thread.hpp>
+
+/**
+ * I_BlockDataReader for walking back down a chain, as disconnecting blocks
+ * does, that reads the block and undo data of the parent of each block asked
+ * for through another reader in the background, while the caller applies the
+ * block it was handed.
+ *
+ * Only the block asked for last and its parent are held. Blocks asked for out
+ * of that order are read right away, as the other reader would. Ancestors are
+ * not read ahead past pindexStop, nor is the genesis block, which has no undo
+ * data. Meant for a single thread at a time.
+ */
+class PrefetchingBlockDataReader : public I_BlockDataReader
+{
+private:
+    struct Prefetched {
+        const CBlockIndex* blockIndex;
+        bool fBlockRead;
+        CBlock block;
+        bool fBlockUndoRead;
+        CBlockUndo blockUndo;
+
+        explicit Prefetched(const CBlockIndex* blockIndexIn);
+    };
+
+    const I_BlockDataReader& reader_;
+    const CBlockIndex* const pindexStop_;
+    mutable std::unique_ptr<Prefetched> current_;
+    mutable std::unique_ptr<Prefetched> ahead_;
+    mutable boost::thread prefetcher_;
+    mutable uint64_t nHits_;
+    mutable uint64_t nMisses_;
+
+    Prefetched* Take(const CBlockIndex* blockIndex) const;
+    void ReadAhead(const CBlockIndex* blockIndex) const;
+
+public:
+    PrefetchingBlockDataReader(const I_BlockDataReader& reader, const CBlockIndex* pindexStop = nullptr);
+    ~PrefetchingBlockDataReader();
+
+    virtual bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const;
+    virtual bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const;
+
+    //! Reads served from what was read ahead, and reads that had to wait on the other reader
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+};
+#endif// PREFETCHING_BLOCK_DATA_READER_H
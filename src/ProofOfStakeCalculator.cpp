@@ -4,29 +4,33 @@
 #include <primitives/transaction.h>
 #include <hash.h>
 #include <StakingData.h>
+#include <crypto/common.h>
 
 static constexpr unsigned int MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING = 60 * 60 * 24 * 7 - 60 * 60;
 
-static uint256 stakeHash(uint64_t stakeModifier, unsigned int hashproofTimestamp, const COutPoint& prevout, unsigned int coinstakeStartTime)
+static int64_t coinAgeWeight(unsigned int hashproofTimestamp, unsigned int coinstakeStartTime)
 {
-    //Izzy will hash in the transaction hash and the index number in order to make sure each hash is unique
-    CDataStream ss(SER_GETHASH, 0);
-    ss << stakeModifier << coinstakeStartTime << prevout.n << prevout.hash << hashproofTimestamp;
-    return Hash(ss.begin(), ss.end());
+    return std::min<int64_t>(hashproofTimestamp - coinstakeStartTime, MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING);
 }
 
-//test hash vs target
-static bool stakeTargetHit(const uint256& hashProofOfStake, int64_t nValueIn, const uint256& bnTargetPerCoinDay, int64_t nTimeWeight)
+//target for the coin's weight; false if it overflows, which means any hash meets it
+static bool stakeTarget(int64_t nValueIn, const uint256& bnTargetPerCoinDay, int64_t nTimeWeight, uint256& target)
 {
     const uint256 bnCoinDayWeight = (uint256(nValueIn) * nTimeWeight) / COIN / 400;
 
-    uint256 target = bnTargetPerCoinDay;
-    if (!target.MultiplyBy(bnCoinDayWeight)) {
-        // In regtest with minimal difficulty, it may happen that the
-        // modification overflows the uint256, in which case it just means
-        // that the target will always be hit.
+    target = bnTargetPerCoinDay;
+    // In regtest with minimal difficulty, it may happen that the
+    // modification overflows the uint256, in which case it just means
+    // that the target will always be hit.
+    return target.MultiplyBy(bnCoinDayWeight);
+}
+
+//test hash vs target
+static bool stakeTargetHit(const uint256& hashProofOfStake, int64_t nValueIn, const uint256& bnTargetPerCoinDay, int64_t nTimeWeight)
+{
+    uint256 target;
+    if (!stakeTarget(nValueIn, bnTargetPerCoinDay, nTimeWeight, target))
         return true;
-    }
 
     // Now check if proof-of-stake hash meets target protocol
     return hashProofOfStake < target;
@@ -41,7 +45,22 @@ ProofOfStakeCalculator::ProofOfStakeCalculator(
     , stakeModifier_(stakeModifier)
     , targetPerCoinDay_(uint256().SetCompact(stakingData.nBits_))
     , coinstakeStartTime_(stakingData.blockTimeOfFirstConfirmationBlock_)
+    , kernelPrefix_()
 {
+    //Izzy will hash in the transaction hash and the index number in order to make sure each hash is unique
+    CDataStream ss(SER_GETHASH, 0);
+    ss << stakeModifier_ << coinstakeStartTime_ << utxoToStake_.n << utxoToStake_.hash;
+    kernelPrefix_.Write((const unsigned char*)&ss[0], ss.size());
+}
+
+uint256 ProofOfStakeCalculator::kernelHash(unsigned int hashproofTimestamp) const
+{
+    unsigned char timestamp[4];
+    WriteLE32(timestamp, hashproofTimestamp);
+    CHash256 hasher(kernelPrefix_);
+    uint256 hash;
+    hasher.Write(timestamp, sizeof(timestamp)).Finalize((unsigned char*)&hash);
+    return hash;
 }
 
 bool ProofOfStakeCalculator::computeProofOfStakeAndCheckItMeetsTarget(
@@ -49,7 +68,32 @@ bool ProofOfStakeCalculator::computeProofOfStakeAndCheckItMeetsTarget(
     uint256& computedProofOfStake,
     bool checkOnly) const
 {
-    if(!checkOnly) computedProofOfStake = stakeHash(stakeModifier_,hashproofTimestamp, utxoToStake_,coinstakeStartTime_);
-    int64_t coinAgeWeightOfUtxo = std::min<int64_t>(hashproofTimestamp - coinstakeStartTime_, MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING);
+    if(!checkOnly) computedProofOfStake = kernelHash(hashproofTimestamp);
+    int64_t coinAgeWeightOfUtxo = coinAgeWeight(hashproofTimestamp, coinstakeStartTime_);
     return stakeTargetHit(computedProofOfStake,utxoValue_,targetPerCoinDay_, coinAgeWeightOfUtxo);
+}
+
+bool ProofOfStakeCalculator::computeProofOfStakeAmongTimestamps(
+    unsigned int& hashproofTimestamp,
+    unsigned numberOfTimestamps,
+    uint256& computedProofOfStake) const
+{
+    // Only the timestamp changes between tries: the prefix is hashed once and the target is
+    // only worked out again when the coin's weight does, which stops once it reaches its cap
+    int64_t targetWeight = -1;
+    bool targetOverflows = false;
+    uint256 target;
+    for (unsigned i = 0; i < numberOfTimestamps; i++, --hashproofTimestamp)
+    {
+        computedProofOfStake = kernelHash(hashproofTimestamp);
+        const int64_t weight = coinAgeWeight(hashproofTimestamp, coinstakeStartTime_);
+        if (weight != targetWeight)
+        {
+            targetOverflows = !stakeTarget(utxoValue_, targetPerCoinDay_, weight, target);
+            targetWeight = weight;
+        }
+        if (targetOverflows || computedProofOfStake < target)
+            return true;
+    }
+    return false;
 }
\ No newline at end of file
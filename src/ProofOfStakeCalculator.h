@@ -2,6 +2,7 @@
 #define PROOF_OF_STAKE_CALCULATOR_H
 #include <stdint.h>
 #include <uint256.h>
+#include <hash.h>
 #include <I_ProofOfStakeCalculator.h>
 struct StakingData;
 class COutPoint;
@@ -13,6 +14,9 @@ private:
     const uint64_t stakeModifier_;
     const uint256 targetPerCoinDay_;
     const unsigned int& coinstakeStartTime_;
+    CHash256 kernelPrefix_; //! Hasher fed everything in the kernel but the timestamp
+
+    uint256 kernelHash(unsigned int hashproofTimestamp) const;
 public:
     ProofOfStakeCalculator(
         const StakingData& stakingData,
@@ -22,5 +26,9 @@ public:
         unsigned int hashproofTimestamp,
         uint256& computedProofOfStake,
         bool checkOnly) const;
+    virtual bool computeProofOfStakeAmongTimestamps(
+        unsigned int& hashproofTimestamp,
+        unsigned numberOfTimestamps,
+        uint256& computedProofOfStake) const;
 };
 #endif// PROOF_OF_STAKE_CALCULATOR_H
@@ -48,20 +48,7 @@ bool CreateHashProofForProofOfStake(
     unsigned int& hashproofTimestamp)
 {
     uint256 hashproof = 0;
-    for (unsigned int i = 0; i < I_ProofOfStakeGenerator::nHashDrift; i++) //iterate the hashing
-    {
-        if(!calculator.computeProofOfStakeAndCheckItMeetsTarget(hashproofTimestamp,hashproof,false))
-        {
-            --hashproofTimestamp;
-            continue;
-        }
-        else
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return calculator.computeProofOfStakeAmongTimestamps(hashproofTimestamp, I_ProofOfStakeGenerator::nHashDrift, hashproof);
 }
 
 ProofOfStakeGenerator::ProofOfStakeGenerator(
@@ -0,0 +1,78 @@
+#include <ProofOfStakeKernelSearch.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+struct SearchProgress {
+    std::atomic<size_t> nextCandidate;
+    std::atomic<size_t> firstFound;
+
+    explicit SearchProgress(size_t numberOfCandidates): nextCandidate(0), firstFound(numberOfCandidates) {}
+};
+
+bool IsGoodEnough(const HashproofCreationResult& result, unsigned timestampLimit)
+{
+    return result.succeeded() && result.timestamp() > timestampLimit;
+}
+
+void SearchCandidates(
+    const I_ProofOfStakeGenerator& proofGenerator,
+    const std::vector<StakingData>& candidates,
+    unsigned initialTimestamp,
+    unsigned timestampLimit,
+    SearchProgress& progress,
+    std::vector<HashproofCreationResult>& results)
+{
+    while (true) {
+        // Claims only grow and the first success only shrinks, so once a claim is past it every later one is too
+        const size_t index = progress.nextCandidate++;
+        if (index >= candidates.size() || index > progress.firstFound.load())
+            return;
+
+        results[index] = proofGenerator.CreateHashproofTimestamp(candidates[index], initialTimestamp);
+        if (!IsGoodEnough(results[index], timestampLimit))
+            continue;
+
+        size_t firstFound = progress.firstFound.load();
+        while (index < firstFound && !progress.firstFound.compare_exchange_weak(firstFound, index)) {
+        }
+    }
+}
+}
+
+constexpr size_t ProofOfStakeKernelSearch::MIN_CANDIDATES_PER_THREAD;
+
+ProofOfStakeKernelSearch::ProofOfStakeKernelSearch(
+    const I_ProofOfStakeGenerator& proofGenerator,
+    unsigned numberOfThreads
+    ): proofGenerator_(proofGenerator)
+    , numberOfThreads_(std::max(1u, numberOfThreads))
+{
+}
+
+size_t ProofOfStakeKernelSearch::FindFirstHashproof(
+    const std::vector<StakingData>& candidates,
+    unsigned initialTimestamp,
+    unsigned timestampLimit,
+    std::vector<HashproofCreationResult>& results) const
+{
+    results.assign(candidates.size(), HashproofCreationResult::FailedGeneration());
+    SearchProgress progress(candidates.size());
+
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(numberOfThreads_, candidates.size() / MIN_CANDIDATES_PER_THREAD));
+    boost::thread_group threads;
+    for (size_t thread = 1; thread < nThreads; thread++) {
+        threads.create_thread(boost::bind(&SearchCandidates,
+            boost::cref(proofGenerator_), boost::cref(candidates), initialTimestamp, timestampLimit,
+            boost::ref(progress), boost::ref(results)));
+    }
+    SearchCandidates(proofGenerator_, candidates, initialTimestamp, timestampLimit, progress, results);
+    threads.join_all();
+
+    return progress.firstFound.load();
+}
@@ -0,0 +1,43 @@
+#ifndef PROOF_OF_STAKE_KERNEL_SEARCH_H
+#define PROOF_OF_STAKE_KERNEL_SEARCH_H
+#include <I_ProofOfStakeGenerator.h>
+#include <StakingData.h>
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Hashes the kernels of a list of staking candidates on several threads and
+ * finds the first candidate, in list order, whose hashproof is good enough.
+ *
+ * Threads claim candidates in order from a shared counter and skip any that
+ * come after the best success found so far. Every candidate before the winner
+ * is therefore hashed, and the winner is the one a single thread hashing the
+ * list front to back would have stopped at.
+ */
+class ProofOfStakeKernelSearch
+{
+private:
+    const I_ProofOfStakeGenerator& proofGenerator_;
+    const unsigned numberOfThreads_;
+
+public:
+    //! Candidates each thread should have to hash before another thread is worth starting
+    static constexpr size_t MIN_CANDIDATES_PER_THREAD = 16;
+
+    ProofOfStakeKernelSearch(
+        const I_ProofOfStakeGenerator& proofGenerator,
+        unsigned numberOfThreads);
+
+    /**
+     * Hash the candidates starting at initialTimestamp and return the index of the first
+     * one whose hashproof timestamp is later than timestampLimit, or candidates.size() if
+     * none has one. The results of every candidate up to that index are filled in.
+     */
+    size_t FindFirstHashproof(
+        const std::vector<StakingData>& candidates,
+        unsigned initialTimestamp,
+        unsigned timestampLimit,
+        std::vector<HashproofCreationResult>& results) const;
+};
+#endif// PROOF_OF_STAKE_KERNEL_SEARCH_H
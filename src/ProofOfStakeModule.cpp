@@ -1,6 +1,7 @@
 #include <ProofOfStakeModule.h>
 
 #include <LegacyPoSStakeModifierService.h>
+#include <CachedPoSStakeModifierService.h>
 #include <PoSStakeModifierService.h>
 #include <ProofOfStakeGenerator.h>
 #include <chainparams.h>
@@ -10,7 +11,8 @@ ProofOfStakeModule::ProofOfStakeModule(
     const CChain& activeChain,
     const BlockMap& blockIndexByHash
     ): legacyStakeModifierService_(new LegacyPoSStakeModifierService(blockIndexByHash,activeChain))
-    , stakeModifierService_(new PoSStakeModifierService(*legacyStakeModifierService_, blockIndexByHash))
+    , cachedLegacyStakeModifierService_(new CachedPoSStakeModifierService(*legacyStakeModifierService_))
+    , stakeModifierService_(new PoSStakeModifierService(*cachedLegacyStakeModifierService_, blockIndexByHash))
     , proofGenerator_(new ProofOfStakeGenerator(*stakeModifierService_,chainParameters.GetMinCoinAgeForStaking()))
 {
 
@@ -19,6 +21,7 @@ ProofOfStakeModule::~ProofOfStakeModule()
 {
     proofGenerator_.reset();
     stakeModifierService_.reset();
+    cachedLegacyStakeModifierService_.reset();
     legacyStakeModifierService_.reset();
 }
 
@@ -3,14 +3,15 @@
 #include <memory>
 #include <I_ProofOfStakeGenerator.h>
 class I_PoSStakeModifierService;
-class I_PoSStakeModifierService;
+class LegacyPoSStakeModifierService;
 class CChainParams;
 class CChain;
 class BlockMap;
 
 class ProofOfStakeModule
 {
-    std::unique_ptr<I_PoSStakeModifierService> legacyStakeModifierService_;
+    std::unique_ptr<LegacyPoSStakeModifierService> legacyStakeModifierService_;
+    std::unique_ptr<I_PoSStakeModifierService> cachedLegacyStakeModifierService_;
     std::unique_ptr<I_PoSStakeModifierService> stakeModifierService_;
     std::unique_ptr<I_ProofOfStakeGenerator> proofGenerator_;
 public:
@@ -2,7 +2,9 @@
 #define QUEUED_BLOCK_H
 #include <uint256.h>
 #include <stdint.h>
+#include <memory>
 class CBlockIndex;
+class PartiallyDownloadedBlock;
 /** Blocks that are in flight, and that are in the queue to be downloaded. Protected by cs_main. */
 struct QueuedBlock {
     uint256 hash;
@@ -10,5 +12,6 @@ struct QueuedBlock {
     int64_t nTime;              //! Time of "getdata" request in microseconds.
     int nValidatedQueuedBefore; //! Number of blocks queued with validated headers (globally) at the time this one is requested.
     bool fValidatedHeaders;     //! Whether this block has validated headers at the time of request.
+    std::shared_ptr<PartiallyDownloadedBlock> partialBlock; //! Set while the block is put together from a compact block.
 };
 #endif// QUEUED_BLOCK_H
\ No newline at end of file
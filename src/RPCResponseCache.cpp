@@ -0,0 +1,159 @@
+#include <RPCResponseCache.h>
+
+#include <memusage.h>
+
+#include <boost/foreach.hpp>
+
+using namespace json_spirit;
+
+RPCResponseCacheStats::RPCResponseCacheStats(
+    ): nCachedResponses(0)
+    , nUsage(0)
+    , nHits(0)
+    , nMisses(0)
+{
+}
+
+RPCResponseCacheKey::RPCResponseCacheKey(
+    const std::string& methodIn,
+    const uint256& hashIn,
+    int verbosityIn
+    ): method(methodIn)
+    , hash(hashIn)
+    , verbosity(verbosityIn)
+{
+}
+
+bool RPCResponseCacheKey::operator<(const RPCResponseCacheKey& other) const
+{
+    if (hash != other.hash)
+        return hash < other.hash;
+    if (verbosity != other.verbosity)
+        return verbosity < other.verbosity;
+    return method < other.method;
+}
+
+RPCResponseCache::RPCResponseCache(
+    ): mutex_()
+    , maxUsage_(0)
+    , minDepth_(0)
+    , entries_()
+    , byKey_()
+    , usage_(0)
+    , nHits_(0)
+    , nMisses_(0)
+{
+}
+
+void RPCResponseCache::Erase(Entries::iterator entry)
+{
+    usage_ -= entry->nUsage;
+    byKey_.erase(entry->key);
+    entries_.erase(entry);
+}
+
+void RPCResponseCache::SetLimits(size_t maxUsage, int minDepth)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    maxUsage_ = maxUsage;
+    minDepth_ = minDepth;
+    while (usage_ > maxUsage_)
+        Erase(--entries_.end());
+}
+
+bool RPCResponseCache::IsCacheable(int nHeight, int nTipHeight) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return maxUsage_ > 0 && nHeight >= 0 && nTipHeight - nHeight + 1 >= minDepth_;
+}
+
+bool RPCResponseCache::Find(const RPCResponseCacheKey& key, int nTipHeight, Value& value)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    std::map<RPCResponseCacheKey, Entries::iterator>::const_iterator it = byKey_.find(key);
+    if (it == byKey_.end()) {
+        nMisses_++;
+        return false;
+    }
+    nHits_++;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    value = it->second->value;
+    const int nHeight = it->second->nHeight;
+    lock.unlock();
+
+    if (value.type() == obj_type) {
+        BOOST_FOREACH (Pair& pair, value.get_obj()) {
+            if (pair.name_ == "confirmations") {
+                pair.value_ = nTipHeight - nHeight + 1;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void RPCResponseCache::Insert(const RPCResponseCacheKey& key, const Value& value, int nHeight, int nTipHeight)
+{
+    if (!IsCacheable(nHeight, nTipHeight))
+        return;
+    const size_t nUsage = memusage::MallocUsage(sizeof(Entry)) + DynamicUsage(value) + key.method.capacity();
+
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (nUsage > maxUsage_ || byKey_.count(key))
+        return;
+    Entry entry = {key, value, nHeight, nUsage};
+    entries_.push_front(entry);
+    byKey_.insert(std::make_pair(key, entries_.begin()));
+    usage_ += nUsage;
+    while (usage_ > maxUsage_)
+        Erase(--entries_.end());
+}
+
+void RPCResponseCache::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    byKey_.clear();
+    entries_.clear();
+    usage_ = 0;
+}
+
+RPCResponseCacheStats RPCResponseCache::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    RPCResponseCacheStats stats;
+    stats.nCachedResponses = entries_.size();
+    stats.nUsage = usage_;
+    stats.nHits = nHits_;
+    stats.nMisses = nMisses_;
+    return stats;
+}
+
+size_t RPCResponseCache::DynamicUsage(const Value& value)
+{
+    switch (value.type()) {
+    case str_type:
+        return memusage::MallocUsage(value.get_str().capacity());
+    case array_type: {
+        const Array& array = value.get_array();
+        size_t nUsage = memusage::MallocUsage(sizeof(Array)) + memusage::MallocUsage(array.capacity() * sizeof(Value));
+        BOOST_FOREACH (const Value& element, array)
+            nUsage += DynamicUsage(element);
+        return nUsage;
+    }
+    case obj_type: {
+        const Object& object = value.get_obj();
+        size_t nUsage = memusage::MallocUsage(sizeof(Object)) + memusage::MallocUsage(object.capacity() * sizeof(Pair));
+        BOOST_FOREACH (const Pair& pair, object)
+            nUsage += memusage::MallocUsage(pair.name_.capacity()) + DynamicUsage(pair.value_);
+        return nUsage;
+    }
+    default:
+        return 0;
+    }
+}
+
+RPCResponseCache& GetRPCResponseCache()
+{
+    static RPCResponseCache rpcResponses;
+    return rpcResponses;
+}
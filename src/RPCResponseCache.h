@@ -0,0 +1,89 @@
+#ifndef RPC_RESPONSE_CACHE_H
+#define RPC_RESPONSE_CACHE_H
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+#include "json/json_spirit_value.h"
+
+struct RPCResponseCacheStats {
+    size_t nCachedResponses;
+    size_t nUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    RPCResponseCacheStats();
+};
+
+/** What a cached reply answers: the command or REST endpoint, the hash it was asked about and its verbosity */
+struct RPCResponseCacheKey {
+    std::string method;
+    uint256 hash;
+    int verbosity;
+
+    RPCResponseCacheKey(const std::string& methodIn, const uint256& hashIn, int verbosityIn);
+    bool operator<(const RPCResponseCacheKey& other) const;
+};
+
+/**
+ * The replies recently built about blocks, and the transactions in them,
+ * that are deep enough in the active chain not to change any more, up to a
+ * bound on the memory they take, least recently used first out.
+ *
+ * Their confirmations are the one part that does change, so a reply keeps
+ * the height of its block and is handed out with the confirmations it has
+ * at the tip of the time. Replies about a block stay valid until that block
+ * is disconnected, which is why the cache is to be cleared whenever a block
+ * is, after which it fills again from those in the chain.
+ */
+class RPCResponseCache
+{
+private:
+    struct Entry {
+        RPCResponseCacheKey key;
+        json_spirit::Value value;
+        int nHeight;
+        size_t nUsage;
+    };
+    typedef std::list<Entry> Entries;
+
+    mutable boost::mutex mutex_;
+    size_t maxUsage_;
+    int minDepth_;
+    //! Most recently used first
+    Entries entries_;
+    std::map<RPCResponseCacheKey, Entries::iterator> byKey_;
+    size_t usage_;
+    uint64_t nHits_;
+    uint64_t nMisses_;
+
+    void Erase(Entries::iterator entry);
+
+public:
+    RPCResponseCache();
+
+    //! Keep up to maxUsage bytes of replies, about blocks with at least minDepth confirmations; no replies for zero bytes
+    void SetLimits(size_t maxUsage, int minDepth);
+    //! Whether a reply about a block at nHeight is worth caching with the tip at nTipHeight
+    bool IsCacheable(int nHeight, int nTipHeight) const;
+    //! Whether the reply is cached, and if so the reply with its confirmations brought up to the tip at nTipHeight
+    bool Find(const RPCResponseCacheKey& key, int nTipHeight, json_spirit::Value& value);
+    //! To be called with cs_main held and the block at nHeight in the active chain, so that it cannot be disconnected meanwhile
+    void Insert(const RPCResponseCacheKey& key, const json_spirit::Value& value, int nHeight, int nTipHeight);
+    void Clear();
+    RPCResponseCacheStats GetStats() const;
+
+    //! The memory the value takes up, beyond its own size
+    static size_t DynamicUsage(const json_spirit::Value& value);
+};
+
+/** The replies of getblock, getblockheader, getrawtransaction and the REST block, to be cleared whenever a block is disconnected */
+RPCResponseCache& GetRPCResponseCache();
+#endif// RPC_RESPONSE_CACHE_H
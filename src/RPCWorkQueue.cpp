@@ -0,0 +1,59 @@
+#include <RPCWorkQueue.h>
+
+#include <ThreadManagementHelpers.h>
+
+RPCWorkQueue::RPCWorkQueue(
+    size_t maxDepth
+    ): mutex_()
+    , condition_()
+    , queue_()
+    , maxDepth_(maxDepth)
+    , running_(true)
+{
+}
+
+bool RPCWorkQueue::Enqueue(const WorkItem& item)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (!running_ || queue_.size() >= maxDepth_)
+            return false;
+        queue_.push_back(item);
+    }
+    condition_.notify_one();
+    return true;
+}
+
+void RPCWorkQueue::Run()
+{
+    RenameThread("izzy-rpcworker");
+    while (true) {
+        WorkItem item;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (running_ && queue_.empty())
+                condition_.wait(lock);
+            if (!running_)
+                return;
+            item = queue_.front();
+            queue_.pop_front();
+        }
+        item();
+    }
+}
+
+void RPCWorkQueue::Interrupt()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        running_ = false;
+        queue_.clear();
+    }
+    condition_.notify_all();
+}
+
+size_t RPCWorkQueue::Depth() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    return queue_.size();
+}
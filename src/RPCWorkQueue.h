@@ -0,0 +1,40 @@
+#ifndef RPC_WORK_QUEUE_H
+#define RPC_WORK_QUEUE_H
+#include <deque>
+#include <stddef.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * A bounded queue of work items for the RPC server threads.
+ *
+ * Accepting connections and running the timers never waits on work, and
+ * work beyond the depth of the queue is refused instead of piling up, so
+ * the server can answer it as busy right away.
+ */
+class RPCWorkQueue
+{
+public:
+    typedef boost::function<void()> WorkItem;
+
+private:
+    mutable boost::mutex mutex_;
+    boost::condition_variable condition_;
+    std::deque<WorkItem> queue_;
+    const size_t maxDepth_;
+    bool running_;
+
+public:
+    explicit RPCWorkQueue(size_t maxDepth);
+
+    //! False if the queue is full or no longer running
+    bool Enqueue(const WorkItem& item);
+    //! Runs work items until interrupted, from each of the worker threads
+    void Run();
+    //! Wakes up the workers to exit, dropping the work still queued
+    void Interrupt();
+    size_t Depth() const;
+};
+#endif// RPC_WORK_QUEUE_H
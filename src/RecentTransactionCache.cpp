@@ -0,0 +1,98 @@
+#include <RecentTransactionCache.h>
+
+#include <memusage.h>
+#include <TransactionMemoryUsage.h>
+
+TransactionCacheStats::TransactionCacheStats(
+    ): nCachedTransactions(0)
+    , nUsage(0)
+    , nHits(0)
+    , nMisses(0)
+{
+}
+
+RecentTransactionCache::RecentTransactionCache(
+    size_t maxEntries
+    ): maxEntries_(maxEntries)
+    , mutex_()
+    , entries_()
+    , byTxid_()
+    , byBareTxid_()
+    , usage_(0)
+    , nHits_(0)
+    , nMisses_(0)
+{
+}
+
+size_t RecentTransactionCache::EntryMemoryUsage(const Entry& entry)
+{
+    // The list node and the nodes of both indexes
+    static const size_t nNodeUsage = memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) +
+                                     2 * memusage::MallocUsage(sizeof(std::pair<const uint256, Entries::iterator>) + 4 * sizeof(void*));
+    return nNodeUsage + memusage::DynamicUsage(entry.tx) + TransactionMemoryUsage(*entry.tx);
+}
+
+void RecentTransactionCache::Erase(Entries::iterator entry)
+{
+    usage_ -= EntryMemoryUsage(*entry);
+    byTxid_.erase(entry->tx->GetHash());
+    // Malleated copies of a transaction share its bare txid, which finds the last one cached
+    std::map<uint256, Entries::iterator>::iterator it = byBareTxid_.find(entry->tx->GetBareTxid());
+    if (it != byBareTxid_.end() && it->second == entry)
+        byBareTxid_.erase(it);
+    entries_.erase(entry);
+}
+
+bool RecentTransactionCache::Find(const uint256& hash, CTransaction& tx, uint256& hashBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    std::map<uint256, Entries::iterator>::const_iterator it = byTxid_.find(hash);
+    if (it == byTxid_.end()) {
+        it = byBareTxid_.find(hash);
+        if (it == byBareTxid_.end()) {
+            nMisses_++;
+            return false;
+        }
+    }
+    nHits_++;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    tx = *it->second->tx;
+    hashBlock = it->second->hashBlock;
+    return true;
+}
+
+void RecentTransactionCache::Insert(const CTransaction& tx, const uint256& hashBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (maxEntries_ == 0 || byTxid_.count(tx.GetHash()))
+        return;
+    Entry entry;
+    entry.tx = MakeTransactionRef(tx);
+    entry.hashBlock = hashBlock;
+    entries_.push_front(entry);
+    byTxid_[tx.GetHash()] = entries_.begin();
+    byBareTxid_[tx.GetBareTxid()] = entries_.begin();
+    usage_ += EntryMemoryUsage(entry);
+    if (entries_.size() > maxEntries_)
+        Erase(--entries_.end());
+}
+
+void RecentTransactionCache::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    byTxid_.clear();
+    byBareTxid_.clear();
+    entries_.clear();
+    usage_ = 0;
+}
+
+TransactionCacheStats RecentTransactionCache::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    TransactionCacheStats stats;
+    stats.nCachedTransactions = entries_.size();
+    stats.nUsage = usage_;
+    stats.nHits = nHits_;
+    stats.nMisses = nMisses_;
+    return stats;
+}
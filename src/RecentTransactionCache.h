@@ -0,0 +1,62 @@
+#ifndef RECENT_TRANSACTION_CACHE_H
+#define RECENT_TRANSACTION_CACHE_H
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+
+struct TransactionCacheStats {
+    size_t nCachedTransactions;
+    size_t nUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    TransactionCacheStats();
+};
+
+/**
+ * The transactions most recently read out of blocks on disk, with the hash of
+ * the block each was read from, found by txid or by bare txid.
+ *
+ * A transaction found in a block stays in it until that block is disconnected;
+ * the cache is to be cleared whenever a block is, after which it fills again
+ * from the blocks that are in the chain.
+ */
+class RecentTransactionCache
+{
+private:
+    struct Entry {
+        CTransactionRef tx;
+        uint256 hashBlock;
+    };
+    typedef std::list<Entry> Entries;
+
+    const size_t maxEntries_;
+    mutable boost::mutex mutex_;
+    //! Most recently used first
+    Entries entries_;
+    std::map<uint256, Entries::iterator> byTxid_;
+    std::map<uint256, Entries::iterator> byBareTxid_;
+    size_t usage_;
+    uint64_t nHits_;
+    uint64_t nMisses_;
+
+    void Erase(Entries::iterator entry);
+    static size_t EntryMemoryUsage(const Entry& entry);
+
+public:
+    explicit RecentTransactionCache(size_t maxEntries);
+
+    //! Whether the transaction with txid or bare txid hash is cached, and if so the transaction and its block
+    bool Find(const uint256& hash, CTransaction& tx, uint256& hashBlock);
+    void Insert(const CTransaction& tx, const uint256& hashBlock);
+    void Clear();
+    TransactionCacheStats GetStats() const;
+};
+#endif// RECENT_TRANSACTION_CACHE_H
@@ -0,0 +1,159 @@
+#include <RescanBlockReader.h>
+
+#include <BlockFileOpener.h>
+#include <BlockFilter.h>
+#include <chain.h>
+#include <I_BlockDataReader.h>
+#include <I_BlockFilterReader.h>
+#include <primitives/block.h>
+#include <util.h>
+#include <WalletOutputFilter.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+RescanBlockReader::ScannedBlock::ScannedBlock(
+    ): pindex(nullptr)
+    , block()
+    , fRead(false)
+    , fSkipped(false)
+    , paysToFilter()
+    , filter()
+{
+}
+
+RescanBlockReader::RescanBlockReader(
+    const I_BlockDataReader& blockReader,
+    const std::vector<const CBlockIndex*>& blocks,
+    std::shared_ptr<const WalletOutputFilter> filter,
+    unsigned nThreads,
+    size_t maxBlocksAhead,
+    const I_BlockFilterReader* blockFilterReader
+    ): blockReader_(blockReader)
+    , blockFilterReader_(blockFilterReader)
+    , blocks_(blocks)
+    , maxBlocksAhead_(std::max<size_t>(maxBlocksAhead, 1))
+    , mutex_()
+    , blocksChanged_()
+    , filter_(filter)
+    , scannedBlocks_()
+    , nNextBlockToScan_(0)
+    , nNextBlockToRead_(0)
+    , stopRequested_(false)
+    , nPrefetchedFile_(-1)
+    , scannerThreads_()
+{
+    for (unsigned n = 0; n < nThreads; n++)
+        scannerThreads_.create_thread(boost::bind(&RescanBlockReader::ThreadScanBlocks, this));
+}
+
+RescanBlockReader::~RescanBlockReader()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    blocksChanged_.notify_all();
+    scannerThreads_.join_all();
+}
+
+bool RescanBlockReader::ClaimPrefetch(size_t nBlock, CDiskBlockPos& pos)
+{
+    const CBlockIndex* pindex = blocks_[nBlock];
+    if (blockFilterReader_ || !(pindex->nStatus & BLOCK_HAVE_DATA) || pindex->nFile == nPrefetchedFile_)
+        return false;
+    nPrefetchedFile_ = pindex->nFile;
+    pos = pindex->GetBlockPos();
+    return true;
+}
+
+void RescanBlockReader::ScanBlock(size_t nBlock, const std::shared_ptr<const WalletOutputFilter>& filter, ScannedBlock& scannedBlock) const
+{
+    scannedBlock.pindex = blocks_[nBlock];
+    scannedBlock.block = std::make_shared<CBlock>();
+    scannedBlock.filter = filter;
+    if (filter && blockFilterReader_) {
+        BlockFilter blockFilter;
+        if (blockFilterReader_->ReadBlockFilter(scannedBlock.pindex, blockFilter) &&
+            !blockFilter.MatchesAny(filter->GetBlockFilterQuery())) {
+            scannedBlock.fSkipped = true;
+            return;
+        }
+    }
+    scannedBlock.fRead = blockReader_.ReadBlock(scannedBlock.pindex, *scannedBlock.block);
+    scannedBlock.paysToFilter.assign(scannedBlock.block->vtx.size(), false);
+    if (!filter)
+        return;
+    for (size_t nTx = 0; nTx < scannedBlock.block->vtx.size(); nTx++) {
+        for (const CTxOut& txout: scannedBlock.block->vtx[nTx].vout) {
+            if (filter->MayBeMine(txout.scriptPubKey)) {
+                scannedBlock.paysToFilter[nTx] = true;
+                break;
+            }
+        }
+    }
+}
+
+void RescanBlockReader::ThreadScanBlocks()
+{
+    RenameThread("izzy-rescanblk");
+    while (true) {
+        size_t nBlock;
+        std::shared_ptr<const WalletOutputFilter> filter;
+        CDiskBlockPos prefetchPos;
+        bool fPrefetch;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (!stopRequested_ && nNextBlockToScan_ < blocks_.size() &&
+                   nNextBlockToScan_ >= nNextBlockToRead_ + maxBlocksAhead_)
+                blocksChanged_.wait(lock);
+            if (stopRequested_ || nNextBlockToScan_ >= blocks_.size())
+                return;
+            nBlock = nNextBlockToScan_++;
+            filter = filter_;
+            fPrefetch = ClaimPrefetch(nBlock, prefetchPos);
+        }
+        if (fPrefetch)
+            PrefetchBlockFile(prefetchPos.nFile, prefetchPos.nPos);
+        ScannedBlock scannedBlock;
+        ScanBlock(nBlock, filter, scannedBlock);
+
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        scannedBlocks_[nBlock] = scannedBlock;
+        blocksChanged_.notify_all();
+    }
+}
+
+void RescanBlockReader::SetFilter(std::shared_ptr<const WalletOutputFilter> filter)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    filter_ = filter;
+}
+
+bool RescanBlockReader::Next(ScannedBlock& scannedBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (nNextBlockToRead_ >= blocks_.size())
+        return false;
+    if (scannerThreads_.size() == 0) {
+        const size_t nBlock = nNextBlockToRead_++;
+        nNextBlockToScan_ = nNextBlockToRead_;
+        const std::shared_ptr<const WalletOutputFilter> filter = filter_;
+        CDiskBlockPos prefetchPos;
+        const bool fPrefetch = ClaimPrefetch(nBlock, prefetchPos);
+        lock.unlock();
+        if (fPrefetch)
+            PrefetchBlockFile(prefetchPos.nFile, prefetchPos.nPos);
+        ScanBlock(nBlock, filter, scannedBlock);
+        return true;
+    }
+    std::map<size_t, ScannedBlock>::iterator it;
+    while ((it = scannedBlocks_.find(nNextBlockToRead_)) == scannedBlocks_.end())
+        blocksChanged_.wait(lock);
+    scannedBlock = it->second;
+    scannedBlocks_.erase(it);
+    ++nNextBlockToRead_;
+    blocksChanged_.notify_all();
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef RESCAN_BLOCK_READER_H
+#define RESCAN_BLOCK_READER_H
+#include <stddef.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class CBlock;
+class CBlockIndex;
+class CDiskBlockPos;
+class I_BlockDataReader;
+class I_BlockFilterReader;
+class WalletOutputFilter;
+
+/**
+ * Reads the blocks a wallet rescan goes over on a pool of threads, ahead of
+ * the rescan, and hands them to it in the order they were listed.
+ *
+ * Each thread claims the next block to read, reads it and marks the
+ * transactions that pay to outputs the filter lets through, so the rescan
+ * only needs to look closely at those and at transactions spending coins it
+ * knows of. No thread reads more than maxBlocksAhead blocks past the one the
+ * rescan waits for. A filter set while reading only applies to the blocks
+ * claimed after that; each block tells which filter it was marked with.
+ * Without threads, the blocks are read and marked as they are asked for.
+ *
+ * With a block filter reader, blocks whose filter has none of the scripts the
+ * output filter lists are not read at all but handed out as skipped.
+ * Without one, the blocks are read in one after another, so each block file
+ * the rescan gets to is prefetched from there on.
+ */
+class RescanBlockReader
+{
+public:
+    struct ScannedBlock {
+        const CBlockIndex* pindex;
+        std::shared_ptr<CBlock> block;
+        bool fRead;
+        //! Whether the block was left unread because its block filter ruled it out
+        bool fSkipped;
+        //! Whether each transaction of the block pays to an output of the filter
+        std::vector<bool> paysToFilter;
+        std::shared_ptr<const WalletOutputFilter> filter;
+
+        ScannedBlock();
+    };
+
+private:
+    const I_BlockDataReader& blockReader_;
+    const I_BlockFilterReader* blockFilterReader_;
+    const std::vector<const CBlockIndex*> blocks_;
+    const size_t maxBlocksAhead_;
+    mutable boost::mutex mutex_;
+    boost::condition_variable blocksChanged_;
+    std::shared_ptr<const WalletOutputFilter> filter_;
+    std::map<size_t, ScannedBlock> scannedBlocks_;
+    size_t nNextBlockToScan_;
+    size_t nNextBlockToRead_;
+    bool stopRequested_;
+    int nPrefetchedFile_;
+    boost::thread_group scannerThreads_;
+
+    //! Whether the block just claimed is the first in a block file to prefetch, and from where; to be called with mutex_ held
+    bool ClaimPrefetch(size_t nBlock, CDiskBlockPos& pos);
+    void ScanBlock(size_t nBlock, const std::shared_ptr<const WalletOutputFilter>& filter, ScannedBlock& scannedBlock) const;
+    void ThreadScanBlocks();
+
+public:
+    RescanBlockReader(
+        const I_BlockDataReader& blockReader,
+        const std::vector<const CBlockIndex*>& blocks,
+        std::shared_ptr<const WalletOutputFilter> filter,
+        unsigned nThreads,
+        size_t maxBlocksAhead,
+        const I_BlockFilterReader* blockFilterReader = nullptr);
+    ~RescanBlockReader();
+
+    //! Mark the blocks not yet claimed with this filter instead
+    void SetFilter(std::shared_ptr<const WalletOutputFilter> filter);
+
+    //! Wait for the next block; false once all of them were handed out
+    bool Next(ScannedBlock& scannedBlock);
+};
+#endif// RESCAN_BLOCK_READER_H
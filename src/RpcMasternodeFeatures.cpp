@@ -86,16 +86,16 @@ bool RelayMasternodeBroadcast(const std::string& hexData, const std::string& sig
         {
             if(activeMasternode.UpdatePing(mnb.lastPing))
             {
-                LogPrint("masternode","Ping updated successfully!\n");
+                LogPrint(LOG_MASTERNODE,"Ping updated successfully!\n");
             }
             else
             {
-                LogPrint("masternode","Ping not updated! Failure to sign!\n");
+                LogPrint(LOG_MASTERNODE,"Ping not updated! Failure to sign!\n");
             }
         }
         else
         {
-            LogPrint("masternode","This broadcast does not belong to us!\n");
+            LogPrint(LOG_MASTERNODE,"This broadcast does not belong to us!\n");
         }
     }
 
@@ -0,0 +1,67 @@
+#include <RunningCoinsStats.h>
+
+#include <clientversion.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <streams.h>
+
+#include <algorithm>
+
+RunningCoinsStats::RunningCoinsStats(
+    ): muhash_()
+    , hashBlock(0)
+    , nTransactions(0)
+    , nTransactionOutputs(0)
+    , nTotalAmount(0)
+{
+}
+
+void RunningCoinsStats::ApplyOutput(const uint256& txid, unsigned int nPos, const CCoins& coins, const CTxOut& out, bool fAdd)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << COutPoint(txid, nPos) << coins.nHeight << coins.fCoinBase << coins.fCoinStake << out;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(&ss[0]);
+    if (fAdd) {
+        muhash_.Insert(data, ss.size());
+        nTransactionOutputs++;
+        nTotalAmount += out.nValue;
+    } else {
+        muhash_.Remove(data, ss.size());
+        nTransactionOutputs--;
+        nTotalAmount -= out.nValue;
+    }
+}
+
+void RunningCoinsStats::UpdateCoins(const uint256& txid, const CCoins* oldCoins, const CCoins& newCoins)
+{
+    static const CCoins emptyCoins;
+    const CCoins& old = (oldCoins && !oldCoins->IsPruned()) ? *oldCoins : emptyCoins;
+    if (!old.IsPruned())
+        nTransactions--;
+    if (!newCoins.IsPruned())
+        nTransactions++;
+
+    // Outputs are committed together with their transaction's metadata, which
+    // only differs if the entry was replaced by another transaction altogether.
+    const bool fSameMetadata = old.nHeight == newCoins.nHeight && old.fCoinBase == newCoins.fCoinBase && old.fCoinStake == newCoins.fCoinStake;
+    const size_t nOutputs = std::max(old.vout.size(), newCoins.vout.size());
+    for (unsigned int i = 0; i < nOutputs; i++) {
+        const bool fOld = i < old.vout.size() && !old.vout[i].IsNull();
+        const bool fNew = i < newCoins.vout.size() && !newCoins.vout[i].IsNull();
+        if (fOld && fNew && fSameMetadata && old.vout[i] == newCoins.vout[i])
+            continue;
+        if (fOld)
+            ApplyOutput(txid, i, old, old.vout[i], false);
+        if (fNew)
+            ApplyOutput(txid, i, newCoins, newCoins.vout[i], true);
+    }
+}
+
+void RunningCoinsStats::GetStats(CCoinsStats& stats) const
+{
+    stats.hashBlock = hashBlock;
+    stats.nTransactions = nTransactions;
+    stats.nTransactionOutputs = nTransactionOutputs;
+    stats.nTotalAmount = nTotalAmount;
+    muhash_.Finalize(stats.hashMuHash.begin());
+}
@@ -0,0 +1,56 @@
+#ifndef RUNNING_COINS_STATS_H
+#define RUNNING_COINS_STATS_H
+#include <amount.h>
+#include <crypto/muhash.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+
+class CCoins;
+class CTxOut;
+struct CCoinsStats;
+
+/**
+ * Statistics about the UTXO set that are kept up to date as coins are
+ * written, so they can be reported without scanning the coin database.
+ *
+ * The set is committed to with a MuHash over the individual unspent outputs,
+ * which does not depend on the order in which they were added or removed.
+ */
+class RunningCoinsStats
+{
+private:
+    MuHash3072 muhash_;
+
+    void ApplyOutput(const uint256& txid, unsigned int nPos, const CCoins& coins, const CTxOut& out, bool fAdd);
+
+public:
+    uint256 hashBlock;
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    CAmount nTotalAmount;
+
+    RunningCoinsStats();
+
+    //! Account for a coins entry changing from oldCoins, NULL if it did not exist, to newCoins
+    void UpdateCoins(const uint256& txid, const CCoins* oldCoins, const CCoins& newCoins);
+    //! Fill in the counters and the MuHash of stats
+    void GetStats(CCoinsStats& stats) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(hashBlock);
+        READWRITE(nTransactions);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nTotalAmount);
+        for (int i = 0; i < Num3072::LIMBS; i++)
+            READWRITE(muhash_.Numerator().limbs[i]);
+        for (int i = 0; i < Num3072::LIMBS; i++)
+            READWRITE(muhash_.Denominator().limbs[i]);
+    }
+};
+#endif// RUNNING_COINS_STATS_H
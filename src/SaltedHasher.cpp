@@ -0,0 +1,11 @@
+#include <SaltedHasher.h>
+
+#include <random.h>
+
+SaltedUint256Hasher::SaltedUint256Hasher(): salt_(GetRandHash())
+{
+}
+
+SaltedUint160Hasher::SaltedUint160Hasher(): salt_(GetRandHash())
+{
+}
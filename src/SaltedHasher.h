@@ -0,0 +1,45 @@
+#ifndef SALTED_HASHER_H
+#define SALTED_HASHER_H
+#include <uint256.h>
+
+#include <stddef.h>
+
+/**
+ * Hashers for unordered containers keyed by hashes that peers get to choose,
+ * such as txids and addresses. Every hasher draws a random salt of its own,
+ * so no one can precompute keys that collide in our containers, while a
+ * lookup costs a few rounds of mixing instead of the comparisons of an
+ * ordered map.
+ *
+ * These *must* return size_t. With Boost 1.46 on 32-bit systems the
+ * unordered_map will behave unpredictably if the custom hasher returns a
+ * uint64_t, resulting in failures when syncing the chain (#4634).
+ */
+class SaltedUint256Hasher
+{
+private:
+    uint256 salt_;
+
+public:
+    SaltedUint256Hasher();
+
+    size_t operator()(const uint256& key) const
+    {
+        return key.GetHash(salt_);
+    }
+};
+
+class SaltedUint160Hasher
+{
+private:
+    uint256 salt_;
+
+public:
+    SaltedUint160Hasher();
+
+    size_t operator()(const uint160& key) const
+    {
+        return key.GetHash(salt_);
+    }
+};
+#endif// SALTED_HASHER_H
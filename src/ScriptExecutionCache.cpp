@@ -0,0 +1,50 @@
+#include <ScriptExecutionCache.h>
+
+#include <crypto/sha256.h>
+#include <primitives/transaction.h>
+#include <random.h>
+
+ScriptExecutionCache::ScriptExecutionCache(
+    ): nonce_()
+    , validEntries_()
+    , mutex_()
+{
+    GetRandBytes(nonce_.begin(), 32);
+    validEntries_.Setup(0);
+}
+
+uint256 ScriptExecutionCache::ComputeEntry(const CTransaction& tx, unsigned int flags) const
+{
+    const uint256 hash = tx.GetHash();
+    uint256 entry;
+    CSHA256()
+        .Write(nonce_.begin(), 32)
+        .Write(hash.begin(), 32)
+        .Write((const unsigned char*)&flags, sizeof(flags))
+        .Finalize(entry.begin());
+    return entry;
+}
+
+bool ScriptExecutionCache::Contains(const uint256& entry, bool erase) const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    return validEntries_.Contains(entry, erase);
+}
+
+void ScriptExecutionCache::Insert(const uint256& entry)
+{
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    validEntries_.Insert(entry);
+}
+
+uint32_t ScriptExecutionCache::SetupBytes(size_t bytes)
+{
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    return validEntries_.SetupBytes(bytes);
+}
+
+size_t ScriptExecutionCache::DynamicMemoryUsage() const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    return validEntries_.DynamicMemoryUsage();
+}
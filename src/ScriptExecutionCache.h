@@ -0,0 +1,37 @@
+#ifndef SCRIPT_EXECUTION_CACHE_H
+#define SCRIPT_EXECUTION_CACHE_H
+#include <CuckooCache.h>
+#include <uint256.h>
+
+#include <boost/thread/shared_mutex.hpp>
+
+class CTransaction;
+
+/**
+ * The transactions whose input scripts all passed under a set of verification
+ * flags, so that a block including a transaction already checked on entering
+ * the mempool does not evaluate its scripts again.
+ *
+ * An entry is a salted hash of the transaction hash and the flags. The
+ * transaction hash commits to the outputs spent and so to every script run,
+ * which makes it enough to stand for the result.
+ */
+class ScriptExecutionCache
+{
+private:
+    uint256 nonce_;
+    CuckooCache<uint256, SaltedHashHasher> validEntries_;
+    mutable boost::shared_mutex mutex_;
+
+public:
+    ScriptExecutionCache();
+
+    uint256 ComputeEntry(const CTransaction& tx, unsigned int flags) const;
+    //! Whether the entry is cached; a block's lookups erase it, as it is not needed again
+    bool Contains(const uint256& entry, bool erase) const;
+    void Insert(const uint256& entry);
+    //! Resizes the cache, dropping its entries, and returns the number of entries it holds
+    uint32_t SetupBytes(size_t bytes);
+    size_t DynamicMemoryUsage() const;
+};
+#endif// SCRIPT_EXECUTION_CACHE_H
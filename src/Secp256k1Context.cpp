@@ -6,41 +6,46 @@
 
 Secp256k1Context::Secp256k1Context()
 {
-    assert(verifying_context == NULL);
-    verifying_context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
-    assert(verifying_context != NULL);
-
-
-    assert(signing_context == NULL);
-    secp256k1_context *ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
-    assert(ctx != NULL);
-    {
-        // Pass in a random blinding seed to the secp256k1 context.
-        std::vector<unsigned char, secure_allocator<unsigned char>> vseed(32);
-        GetRandBytes(vseed.data(), 32);
-        bool ret = secp256k1_context_randomize(ctx, vseed.data());
-        assert(ret);
-    }
-    signing_context = ctx;
 }
 Secp256k1Context::~Secp256k1Context()
 {
-    assert(verifying_context != NULL);
-    secp256k1_context_destroy(verifying_context);
+    secp256k1_context *ctx = verifying_context;
     verifying_context = NULL;
+    if (ctx) {
+        secp256k1_context_destroy(ctx);
+    }
 
-    secp256k1_context *ctx = signing_context;
+    ctx = signing_context;
     signing_context = NULL;
     if (ctx) {
         secp256k1_context_destroy(ctx);
     }
 }
 
-secp256k1_context* Secp256k1Context::GetVerifyContext()
+const secp256k1_context* Secp256k1Context::GetVerifyContext()
 {
+    std::call_once(verifyingContextBuilt_, [this]() {
+        assert(verifying_context == NULL);
+        verifying_context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+        assert(verifying_context != NULL);
+    });
     return verifying_context;
 }
-secp256k1_context* Secp256k1Context::GetSigningContext()
+const secp256k1_context* Secp256k1Context::GetSigningContext()
 {
+    // The generator tables are compiled into the library, so this is cheap apart from the blinding.
+    std::call_once(signingContextBuilt_, [this]() {
+        assert(signing_context == NULL);
+        secp256k1_context *ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+        assert(ctx != NULL);
+        {
+            // Pass in a random blinding seed to the secp256k1 context.
+            std::vector<unsigned char, secure_allocator<unsigned char>> vseed(32);
+            GetRandBytes(vseed.data(), 32);
+            bool ret = secp256k1_context_randomize(ctx, vseed.data());
+            assert(ret);
+        }
+        signing_context = ctx;
+    });
     return signing_context;
-}
\ No newline at end of file
+}
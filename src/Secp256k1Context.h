@@ -3,11 +3,24 @@
 #include <secp256k1.h>
 #include <secp256k1_recovery.h>
 
+#include <mutex>
+
+/**
+ * The verifying and the signing context of the process, each built the first
+ * time it is asked for, so that programs that never verify, such as most of
+ * the test suites and izzy-tx, do not compute the verification tables.
+ *
+ * Both are handed out read only: once built, neither holds state that a call
+ * changes, so the threads checking scripts share them without locking and
+ * without a copy of the tables each.
+ */
 class Secp256k1Context
 {
 private:
     secp256k1_context* verifying_context = NULL;
     secp256k1_context* signing_context = NULL;
+    std::once_flag verifyingContextBuilt_;
+    std::once_flag signingContextBuilt_;
 
     Secp256k1Context();
     ~Secp256k1Context();
@@ -18,7 +31,7 @@ public:
         return uniqueInstance;
     }
 
-    secp256k1_context* GetVerifyContext();
-    secp256k1_context* GetSigningContext();
+    const secp256k1_context* GetVerifyContext();
+    const secp256k1_context* GetSigningContext();
 };
-#endif //SECP256_K1_CONTEXT_H
\ No newline at end of file
+#endif //SECP256_K1_CONTEXT_H
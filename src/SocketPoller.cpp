@@ -0,0 +1,305 @@
+#include <SocketPoller.h>
+
+#include <utiltime.h>
+
+#include <algorithm>
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+#if !defined(WIN32)
+#include <sys/select.h>
+#endif
+
+I_SocketPoller::PolledSocket::PolledSocket(
+    SOCKET socketIn,
+    int64_t ownerIn,
+    unsigned interestIn
+    ): socket(socketIn)
+    , owner(ownerIn)
+    , interest(interestIn)
+{
+}
+
+I_SocketPoller::SocketEvents::SocketEvents(
+    ): receive(false)
+    , send(false)
+    , error(false)
+{
+}
+
+RegisteringSocketPoller::RegisteringSocketPoller(
+    ): registeredSockets_()
+{
+}
+
+void RegisteringSocketPoller::Update(const std::vector<PolledSocket>& sockets)
+{
+    std::map<SOCKET, PolledSocket> polledSockets;
+    for (const PolledSocket& socket: sockets)
+        polledSockets.insert(std::make_pair(socket.socket, socket));
+
+    for (std::map<SOCKET, PolledSocket>::const_iterator it = registeredSockets_.begin(); it != registeredSockets_.end(); ++it) {
+        if (polledSockets.count(it->first) == 0)
+            Deregister(it->first);
+    }
+
+    std::map<SOCKET, PolledSocket> registeredSockets;
+    for (std::map<SOCKET, PolledSocket>::const_iterator it = polledSockets.begin(); it != polledSockets.end(); ++it) {
+        const PolledSocket& socket = it->second;
+        std::map<SOCKET, PolledSocket>::const_iterator registered = registeredSockets_.find(socket.socket);
+        bool fRegistered = true;
+        if (registered == registeredSockets_.end()) {
+            fRegistered = Register(socket, nullptr);
+        } else if (registered->second.owner != socket.owner) {
+            Deregister(socket.socket);
+            fRegistered = Register(socket, nullptr);
+        } else if (registered->second.interest != socket.interest) {
+            fRegistered = Register(socket, &registered->second);
+        }
+        // Sockets that failed to register are tried again on the next update
+        if (fRegistered)
+            registeredSockets.insert(std::make_pair(socket.socket, socket));
+    }
+    registeredSockets_.swap(registeredSockets);
+}
+
+SelectSocketPoller::SelectSocketPoller(
+    ): polledSockets_()
+{
+}
+
+bool SelectSocketPoller::CanPoll(SOCKET socket) const
+{
+    return IsSelectableSocket(socket);
+}
+
+void SelectSocketPoller::Update(const std::vector<PolledSocket>& sockets)
+{
+    polledSockets_ = sockets;
+}
+
+bool SelectSocketPoller::Wait(int timeoutMilliseconds, ReadySockets& readySockets)
+{
+    readySockets.clear();
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+    for (const PolledSocket& socket: polledSockets_) {
+        if (!CanPoll(socket.socket))
+            continue;
+        FD_SET(socket.socket, &fdsetError);
+        if (socket.interest & POLL_RECEIVE)
+            FD_SET(socket.socket, &fdsetRecv);
+        if (socket.interest & POLL_SEND)
+            FD_SET(socket.socket, &fdsetSend);
+        hSocketMax = std::max(hSocketMax, socket.socket);
+        have_fds = true;
+    }
+    if (!have_fds) {
+        MilliSleep(timeoutMilliseconds);
+        return true;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMilliseconds / 1000;
+    timeout.tv_usec = (timeoutMilliseconds % 1000) * 1000;
+    if (select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout) == SOCKET_ERROR)
+        return false;
+
+    for (const PolledSocket& socket: polledSockets_) {
+        if (!CanPoll(socket.socket))
+            continue;
+        const bool fReceive = FD_ISSET(socket.socket, &fdsetRecv);
+        const bool fSend = FD_ISSET(socket.socket, &fdsetSend);
+        const bool fError = FD_ISSET(socket.socket, &fdsetError);
+        if (!fReceive && !fSend && !fError)
+            continue;
+        SocketEvents& events = readySockets[socket.socket];
+        events.receive = events.receive || fReceive;
+        events.send = events.send || fSend;
+        events.error = events.error || fError;
+    }
+    return true;
+}
+
+#if defined(HAVE_SYS_EPOLL_H)
+EpollSocketPoller::EpollSocketPoller(
+    ): RegisteringSocketPoller()
+    , epollDescriptor_(epoll_create1(EPOLL_CLOEXEC))
+{
+}
+
+EpollSocketPoller::~EpollSocketPoller()
+{
+    if (IsValid())
+        close(epollDescriptor_);
+}
+
+bool EpollSocketPoller::IsValid() const
+{
+    return epollDescriptor_ >= 0;
+}
+
+bool EpollSocketPoller::CanPoll(SOCKET socket) const
+{
+    return true;
+}
+
+bool EpollSocketPoller::Register(const PolledSocket& socket, const PolledSocket* previous)
+{
+    struct epoll_event event;
+    event.events = 0;
+    if (socket.interest & POLL_RECEIVE)
+        event.events |= EPOLLIN;
+    if (socket.interest & POLL_SEND)
+        event.events |= EPOLLOUT;
+    event.data.u64 = 0;
+    event.data.fd = socket.socket;
+
+    // A closed descriptor drops out of the epoll set by itself, and one that
+    // was reused may still be in it, so either operation may need the other
+    const int operation = previous ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epollDescriptor_, operation, socket.socket, &event) == 0)
+        return true;
+    if (errno == ENOENT)
+        return epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, socket.socket, &event) == 0;
+    if (errno == EEXIST)
+        return epoll_ctl(epollDescriptor_, EPOLL_CTL_MOD, socket.socket, &event) == 0;
+    return false;
+}
+
+void EpollSocketPoller::Deregister(SOCKET socket)
+{
+    struct epoll_event event;
+    epoll_ctl(epollDescriptor_, EPOLL_CTL_DEL, socket, &event);
+}
+
+bool EpollSocketPoller::Wait(int timeoutMilliseconds, ReadySockets& readySockets)
+{
+    readySockets.clear();
+    struct epoll_event events[MAX_SOCKET_EVENTS_PER_WAIT];
+    const int nEvents = epoll_wait(epollDescriptor_, events, MAX_SOCKET_EVENTS_PER_WAIT, timeoutMilliseconds);
+    if (nEvents < 0)
+        return errno == EINTR;
+
+    for (int i = 0; i < nEvents; i++) {
+        SocketEvents& readyEvents = readySockets[events[i].data.fd];
+        readyEvents.receive = (events[i].events & EPOLLIN) != 0;
+        readyEvents.send = (events[i].events & EPOLLOUT) != 0;
+        readyEvents.error = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+    }
+    return true;
+}
+#elif defined(HAVE_SYS_EVENT_H)
+KqueueSocketPoller::KqueueSocketPoller(
+    ): RegisteringSocketPoller()
+    , kqueueDescriptor_(kqueue())
+{
+}
+
+KqueueSocketPoller::~KqueueSocketPoller()
+{
+    if (IsValid())
+        close(kqueueDescriptor_);
+}
+
+bool KqueueSocketPoller::IsValid() const
+{
+    return kqueueDescriptor_ >= 0;
+}
+
+bool KqueueSocketPoller::CanPoll(SOCKET socket) const
+{
+    return true;
+}
+
+void KqueueSocketPoller::ChangeFilter(SOCKET socket, short filter, bool enable)
+{
+    struct kevent change;
+    EV_SET(&change, socket, filter, enable ? EV_ADD | EV_ENABLE : EV_DELETE, 0, 0, nullptr);
+    kevent(kqueueDescriptor_, &change, 1, nullptr, 0, nullptr);
+}
+
+bool KqueueSocketPoller::Register(const PolledSocket& socket, const PolledSocket* previous)
+{
+    const bool fReceive = (socket.interest & POLL_RECEIVE) != 0;
+    const bool fSend = (socket.interest & POLL_SEND) != 0;
+    struct kevent changes[2];
+    int nChanges = 0;
+    if (fReceive)
+        EV_SET(&changes[nChanges++], socket.socket, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, nullptr);
+    if (fSend)
+        EV_SET(&changes[nChanges++], socket.socket, EVFILT_WRITE, EV_ADD | EV_ENABLE, 0, 0, nullptr);
+    if (nChanges > 0 && kevent(kqueueDescriptor_, changes, nChanges, nullptr, 0, nullptr) < 0)
+        return false;
+
+    // Filters are deleted one at a time, as deleting one that is not there fails
+    if (!fReceive && (!previous || (previous->interest & POLL_RECEIVE)))
+        ChangeFilter(socket.socket, EVFILT_READ, false);
+    if (!fSend && (!previous || (previous->interest & POLL_SEND)))
+        ChangeFilter(socket.socket, EVFILT_WRITE, false);
+    return true;
+}
+
+void KqueueSocketPoller::Deregister(SOCKET socket)
+{
+    ChangeFilter(socket, EVFILT_READ, false);
+    ChangeFilter(socket, EVFILT_WRITE, false);
+}
+
+bool KqueueSocketPoller::Wait(int timeoutMilliseconds, ReadySockets& readySockets)
+{
+    readySockets.clear();
+    struct kevent events[MAX_SOCKET_EVENTS_PER_WAIT];
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMilliseconds / 1000;
+    timeout.tv_nsec = (timeoutMilliseconds % 1000) * 1000000;
+    const int nEvents = kevent(kqueueDescriptor_, nullptr, 0, events, MAX_SOCKET_EVENTS_PER_WAIT, &timeout);
+    if (nEvents < 0)
+        return errno == EINTR;
+
+    for (int i = 0; i < nEvents; i++) {
+        SocketEvents& readyEvents = readySockets[static_cast<SOCKET>(events[i].ident)];
+        if (events[i].filter == EVFILT_READ)
+            readyEvents.receive = true;
+        if (events[i].filter == EVFILT_WRITE)
+            readyEvents.send = true;
+        if (events[i].flags & (EV_EOF | EV_ERROR))
+            readyEvents.error = true;
+    }
+    return true;
+}
+#endif
+
+std::unique_ptr<I_SocketPoller> CreateSocketPoller()
+{
+#if defined(HAVE_SYS_EPOLL_H)
+    std::unique_ptr<EpollSocketPoller> poller(new EpollSocketPoller());
+    if (poller->IsValid())
+        return std::unique_ptr<I_SocketPoller>(poller.release());
+#elif defined(HAVE_SYS_EVENT_H)
+    std::unique_ptr<KqueueSocketPoller> poller(new KqueueSocketPoller());
+    if (poller->IsValid())
+        return std::unique_ptr<I_SocketPoller>(poller.release());
+#endif
+    return std::unique_ptr<I_SocketPoller>(new SelectSocketPoller());
+}
+
+bool SocketPollerScalesPastFdSetSize()
+{
+#if defined(HAVE_SYS_EPOLL_H) || defined(HAVE_SYS_EVENT_H)
+    return true;
+#else
+    return false;
+#endif
+}
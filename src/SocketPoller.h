@@ -0,0 +1,91 @@
+#ifndef SOCKET_POLLER_H
+#define SOCKET_POLLER_H
+#include <I_SocketPoller.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * Keeps track of what was registered for each socket with a poller whose
+ * registrations the kernel holds on to (epoll, kqueue), so each update only
+ * makes calls for the sockets that were added, removed or changed interest.
+ */
+class RegisteringSocketPoller: public I_SocketPoller
+{
+private:
+    std::map<SOCKET, PolledSocket> registeredSockets_;
+
+protected:
+    //! Previous is null when the kernel holds no registration for this owner of the socket
+    virtual bool Register(const PolledSocket& socket, const PolledSocket* previous) = 0;
+    virtual void Deregister(SOCKET socket) = 0;
+
+public:
+    RegisteringSocketPoller();
+
+    void Update(const std::vector<PolledSocket>& sockets) override;
+};
+
+/** Polls with select(), which only takes descriptors below FD_SETSIZE */
+class SelectSocketPoller: public I_SocketPoller
+{
+private:
+    std::vector<PolledSocket> polledSockets_;
+
+public:
+    SelectSocketPoller();
+
+    bool CanPoll(SOCKET socket) const override;
+    void Update(const std::vector<PolledSocket>& sockets) override;
+    bool Wait(int timeoutMilliseconds, ReadySockets& readySockets) override;
+};
+
+#if defined(HAVE_SYS_EPOLL_H)
+class EpollSocketPoller: public RegisteringSocketPoller
+{
+private:
+    int epollDescriptor_;
+
+protected:
+    bool Register(const PolledSocket& socket, const PolledSocket* previous) override;
+    void Deregister(SOCKET socket) override;
+
+public:
+    EpollSocketPoller();
+    ~EpollSocketPoller();
+
+    bool IsValid() const;
+    bool CanPoll(SOCKET socket) const override;
+    bool Wait(int timeoutMilliseconds, ReadySockets& readySockets) override;
+};
+#elif defined(HAVE_SYS_EVENT_H)
+class KqueueSocketPoller: public RegisteringSocketPoller
+{
+private:
+    int kqueueDescriptor_;
+
+    void ChangeFilter(SOCKET socket, short filter, bool enable);
+
+protected:
+    bool Register(const PolledSocket& socket, const PolledSocket* previous) override;
+    void Deregister(SOCKET socket) override;
+
+public:
+    KqueueSocketPoller();
+    ~KqueueSocketPoller();
+
+    bool IsValid() const;
+    bool CanPoll(SOCKET socket) const override;
+    bool Wait(int timeoutMilliseconds, ReadySockets& readySockets) override;
+};
+#endif
+
+//! Most ready sockets a single wait hands back; the others are reported on the next one
+constexpr int MAX_SOCKET_EVENTS_PER_WAIT = 256;
+
+//! The best poller this platform offers, falling back to select()
+std::unique_ptr<I_SocketPoller> CreateSocketPoller();
+//! Whether the platform offers a poller that is not bound by FD_SETSIZE
+bool SocketPollerScalesPastFdSetSize();
+#endif// SOCKET_POLLER_H
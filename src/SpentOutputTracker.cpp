@@ -1,18 +1,24 @@
 #include <SpentOutputTracker.h>
 
+#include <chain.h>
 #include <primitives/transaction.h>
+#include <sync.h>
 #include <WalletTx.h>
 #include <WalletTransactionRecord.h>
 #include <timedata.h>
 
+extern CCriticalSection cs_main;
+
 SpentOutputTracker::SpentOutputTracker(
-    WalletTransactionRecord& transactionRecord
+    WalletTransactionRecord& transactionRecord,
+    const CChain& activeChain
     ): transactionRecord_(transactionRecord)
+    , activeChain_(activeChain)
     , mapTxSpends()
 {
 }
 
-void SpentOutputTracker::SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator> range)
+void SpentOutputTracker::SyncMetaData(const OutpointSpends& spends)
 {
     // We want all the wallet transactions in range to have the same metadata as
     // the oldest (smallest nOrderPos).
@@ -21,38 +27,57 @@ void SpentOutputTracker::SyncMetaData(std::pair<TxSpends::iterator, TxSpends::it
     int nMinOrderPos = std::numeric_limits<int>::max();
     const CWalletTx* copyFrom = NULL;
     uint256 hashFrom(0);
-    for (TxSpends::iterator it = range.first; it != range.second; ++it) {
-        const CWalletTx* transactionPtr = transactionRecord_.GetWalletTx(it->second);
+    for (const uint256& hash: spends.spenders) {
+        const CWalletTx* transactionPtr = transactionRecord_.GetWalletTx(hash);
         if (transactionPtr) {
             int n = transactionPtr->nOrderPos;
             if(n < nMinOrderPos)
             {
                 nMinOrderPos = n;
                 copyFrom = transactionPtr;
-                hashFrom = it->second;
+                hashFrom = hash;
             }
         }
     }
     // Now copy data from copyFrom to rest:
-    for (TxSpends::iterator it = range.first; it != range.second; ++it)
+    for (const uint256& hash: spends.spenders)
     {
-        const uint256& hash = it->second;
         if(hashFrom == hash) continue;
         transactionRecord_.UpdateMetadata(hash,*copyFrom,false);
     }
 }
 
+bool SpentOutputTracker::HasSpenderInBlock(const OutpointSpends& spends) const
+{
+    {
+        LOCK(cs_main);
+        if (spends.confirmingBlock && activeChain_.Contains(spends.confirmingBlock))
+            return true;
+    }
+    spends.confirmingBlock = nullptr;
+    for (const uint256& hash: spends.spenders) {
+        const CWalletTx* transactionPtr = transactionRecord_.GetWalletTx(hash);
+        const CBlockIndex* confirmingBlock = nullptr;
+        if (transactionPtr && transactionPtr->GetNumberOfBlockConfirmations(confirmingBlock) > 0) {
+            spends.confirmingBlock = confirmingBlock;
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Outpoint is spent if any non-conflicted transaction
  * spends it:
  */
 bool SpentOutputTracker::IsSpent(const uint256& hash, unsigned int n) const
 {
-    const COutPoint outpoint(hash, n);
-    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
-    range = mapTxSpends.equal_range(outpoint);
-    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
-        const uint256& wtxid = it->second;
+    TxSpends::const_iterator it = mapTxSpends.find(COutPoint(hash, n));
+    if (it == mapTxSpends.end())
+        return false;
+    if (HasSpenderInBlock(it->second))
+        return true;
+    for (const uint256& wtxid: it->second.spenders) {
         const CWalletTx* transactionPtr = transactionRecord_.GetWalletTx(wtxid);
         if (transactionPtr && transactionPtr->GetNumberOfBlockConfirmations() >= 0)
             return true; // Spent
@@ -60,6 +85,12 @@ bool SpentOutputTracker::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+bool SpentOutputTracker::IsSpentInBlock(const uint256& hash, unsigned int n) const
+{
+    TxSpends::const_iterator it = mapTxSpends.find(COutPoint(hash, n));
+    return it != mapTxSpends.end() && HasSpenderInBlock(it->second);
+}
+
 std::pair<CWalletTx*,bool> SpentOutputTracker::UpdateSpends(
     const CWalletTx& newlyAddedTransaction,
     int64_t orderedTransactionIndex,
@@ -80,12 +111,40 @@ std::pair<CWalletTx*,bool> SpentOutputTracker::UpdateSpends(
     return std::make_pair(&(ret.first->second),ret.second);
 }
 
+std::vector<CWalletTx*> SpentOutputTracker::AddLoadedTransactions(const std::vector<CWalletTx>& loadedTransactions)
+{
+    std::vector<CWalletTx*> addedTransactions;
+    addedTransactions.reserve(loadedTransactions.size());
+    std::set<COutPoint> outpointsSpentMoreThanOnce;
+    for (const CWalletTx& loadedTransaction: loadedTransactions)
+    {
+        std::pair<std::map<uint256, CWalletTx>::iterator, bool> ret = transactionRecord_.AddTransaction(loadedTransaction);
+        if (!ret.second)
+            continue;
+        addedTransactions.push_back(&ret.first->second);
+        if (loadedTransaction.IsCoinBase()) // Coinbases don't spend anything!
+            continue;
+
+        for (const CTxIn& txin: loadedTransaction.vin)
+        {
+            std::vector<uint256>& spenders = mapTxSpends[txin.prevout].spenders;
+            spenders.push_back(ret.first->first);
+            if (spenders.size() > 1)
+                outpointsSpentMoreThanOnce.insert(txin.prevout);
+        }
+    }
+    for (const COutPoint& outpoint: outpointsSpentMoreThanOnce)
+    {
+        SyncMetaData(mapTxSpends[outpoint]);
+    }
+    return addedTransactions;
+}
+
 void SpentOutputTracker::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
-    mapTxSpends.insert(std::make_pair(outpoint, wtxid));
-    std::pair<TxSpends::iterator, TxSpends::iterator> range;
-    range = mapTxSpends.equal_range(outpoint);
-    SyncMetaData(range);
+    OutpointSpends& spends = mapTxSpends[outpoint];
+    spends.spenders.push_back(wtxid);
+    SyncMetaData(spends);
 }
 
 
@@ -105,15 +164,13 @@ void SpentOutputTracker::AddToSpends(const uint256& wtxid)
 std::set<uint256> SpentOutputTracker::GetConflictingTxHashes(const CWalletTx& tx) const
 {
     std::set<uint256> result;
-    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
 
     for (const CTxIn& txin: tx.vin)
     {
-        if (mapTxSpends.count(txin.prevout) <= 1 )
+        TxSpends::const_iterator it = mapTxSpends.find(txin.prevout);
+        if (it == mapTxSpends.end() || it->second.spenders.size() <= 1)
             continue; // No conflict if zero or one spends
-        range = mapTxSpends.equal_range(txin.prevout);
-        for (TxSpends::const_iterator it = range.first; it != range.second; ++it)
-            result.insert(it->second);
+        result.insert(it->second.spenders.begin(), it->second.spenders.end());
     }
     return result;
-}
\ No newline at end of file
+}
@@ -3,25 +3,57 @@
 #include <map>
 #include <utility>
 #include <set>
+#include <vector>
 #include <uint256.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+
+#include <boost/unordered_map.hpp>
 
 class WalletTransactionRecord;
-class COutPoint;
+class CBlockIndex;
+class CChain;
 class uint256;
 class CWalletTx;
 
+/**
+ * The wallet transactions spending each outpoint, kept in a hash table so
+ * spend checks do not depend on the number of transactions in the wallet.
+ *
+ * Each outpoint remembers the active chain block that confirmed one of its
+ * spenders when it was last checked. That block is only trusted while it is
+ * still in the active chain, so a reorganization needs no invalidation: the
+ * spenders are looked at again once it has left. Access must hold the lock
+ * of the transaction record.
+ */
 class SpentOutputTracker
 {
 private:
     WalletTransactionRecord& transactionRecord_;
+    const CChain& activeChain_;
 protected:
-    using TxSpends = std::multimap<COutPoint, uint256>;
+    class OutpointHasher
+    {
+    private:
+        CCoinsKeyHasher txidHasher_;
+
+    public:
+        size_t operator()(const COutPoint& outpoint) const { return txidHasher_(outpoint.hash) ^ outpoint.n; }
+    };
+    struct OutpointSpends {
+        std::vector<uint256> spenders;
+        mutable const CBlockIndex* confirmingBlock;
+
+        OutpointSpends(): spenders(), confirmingBlock(nullptr) {}
+    };
+    using TxSpends = boost::unordered_map<COutPoint, OutpointSpends, OutpointHasher>;
     TxSpends mapTxSpends;
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
-    void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
+    void SyncMetaData(const OutpointSpends& spends);
+    bool HasSpenderInBlock(const OutpointSpends& spends) const;
 public:
-    SpentOutputTracker(WalletTransactionRecord& transactionRecord);
+    SpentOutputTracker(WalletTransactionRecord& transactionRecord, const CChain& activeChain);
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -31,7 +63,15 @@ public:
         const CWalletTx& newlyAddedTransaction,
         int64_t orderedTransactionIndex=0,
         bool loadedFromDisk=false);
+    /**
+     * Adds transactions read from disk and their spends in one pass, syncing the
+     * metadata of the transactions spending the same outpoints once at the end.
+     * @return the transactions that were new to the wallet
+     */
+    std::vector<CWalletTx*> AddLoadedTransactions(const std::vector<CWalletTx>& loadedTransactions);
     bool IsSpent(const uint256& hash, unsigned int n) const;
+    //! Spent by a transaction in a block, which only a reorganization can undo
+    bool IsSpentInBlock(const uint256& hash, unsigned int n) const;
     std::set<uint256> GetConflictingTxHashes(const CWalletTx& tx) const;
 };
-#endif// SPENT_OUTPUT_TRACKER_H
\ No newline at end of file
+#endif// SPENT_OUTPUT_TRACKER_H
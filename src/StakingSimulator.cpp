@@ -0,0 +1,120 @@
+#include <StakingSimulator.h>
+
+#include <blockmap.h>
+#include <chain.h>
+#include <hash.h>
+#include <I_ProofOfStakeGenerator.h>
+#include <ProofOfStakeKernelSearch.h>
+#include <serialize.h>
+
+#include <algorithm>
+
+StakingSimulator::Result::Result(
+    ): numberOfCoins(0u)
+    , blocksSimulated(0u)
+    , blocksStaked(0u)
+    , kernelsHashed(0u)
+{
+}
+
+StakingSimulator::StakingSimulator(
+    const CChain& activeChain,
+    const BlockMap& mapBlockIndex,
+    const ProofOfStakeKernelSearch& kernelSearch
+    ): activeChain_(activeChain)
+    , mapBlockIndex_(mapBlockIndex)
+    , kernelSearch_(kernelSearch)
+{
+}
+
+StakingSimulator::Result StakingSimulator::Simulate(
+    const std::vector<StakingData>& coins,
+    int firstHeight,
+    int lastHeight) const
+{
+    Result result;
+    result.numberOfCoins = coins.size();
+    std::vector<StakingData> simulatedCoins(coins);
+    std::vector<StakingData> candidates;
+    std::vector<size_t> candidateCoins;
+    std::vector<HashproofCreationResult> results;
+
+    lastHeight = std::min(lastHeight, activeChain_.Height());
+    for (int height = std::max(firstHeight, 1); height <= lastHeight; height++)
+    {
+        const CBlockIndex* chainTip = activeChain_[height - 1];
+        const CBlockIndex* actualBlock = activeChain_[height];
+        ++result.blocksSimulated;
+
+        candidates.clear();
+        candidateCoins.clear();
+        for (size_t index = 0; index < simulatedCoins.size(); index++)
+        {
+            BlockMap::const_iterator it = mapBlockIndex_.find(simulatedCoins[index].blockHashOfFirstConfirmationBlock_);
+            if (it == mapBlockIndex_.end() || it->second->nHeight >= height || !activeChain_.Contains(it->second))
+                continue;
+
+            StakingData candidate = simulatedCoins[index];
+            candidate.nBits_ = actualBlock->nBits;
+            candidate.blockTimeOfFirstConfirmationBlock_ = it->second->GetBlockTime();
+            candidate.blockHashOfChainTipBlock_ = chainTip->GetBlockHash();
+            candidates.push_back(candidate);
+            candidateCoins.push_back(index);
+        }
+        if (candidates.empty())
+            continue;
+
+        // The coins are hashed drift by drift back from the actual block to its parent
+        const unsigned timestampLimit = static_cast<unsigned>(chainTip->GetBlockTime());
+        for (int64_t initialTimestamp = actualBlock->GetBlockTime();
+             initialTimestamp > timestampLimit;
+             initialTimestamp -= I_ProofOfStakeGenerator::nHashDrift)
+        {
+            const unsigned timestamp = static_cast<unsigned>(initialTimestamp);
+            const size_t first = kernelSearch_.FindFirstHashproof(candidates, timestamp, timestampLimit, results);
+            const size_t searched = std::min(first + 1, candidates.size());
+            for (size_t index = 0; index < searched; index++)
+            {
+                if (results[index].succeeded())
+                    result.kernelsHashed += timestamp - results[index].timestamp() + 1;
+                else if (!results[index].failedAtSetup())
+                    result.kernelsHashed += I_ProofOfStakeGenerator::nHashDrift;
+            }
+            if (first < candidates.size())
+            {
+                ++result.blocksStaked;
+                StakingData& restakedCoin = simulatedCoins[candidateCoins[first]];
+                restakedCoin.blockHashOfFirstConfirmationBlock_ = actualBlock->GetBlockHash();
+                restakedCoin.blockTimeOfFirstConfirmationBlock_ = actualBlock->GetBlockTime();
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<StakingData> StakingSimulator::SplitCoins(
+    const std::vector<StakingData>& coins,
+    unsigned parts)
+{
+    parts = std::max(parts, 1u);
+    std::vector<StakingData> splitCoins;
+    splitCoins.reserve(coins.size() * parts);
+    for (const StakingData& coin: coins)
+    {
+        const CAmount partValue = coin.utxoValue_ / parts;
+        for (unsigned part = 0; part < parts; part++)
+        {
+            StakingData splitCoin = coin;
+            if (part > 0)
+            {
+                CHashWriter outpointHasher(SER_GETHASH, 0);
+                outpointHasher << coin.utxoBeingStaked_ << part;
+                splitCoin.utxoBeingStaked_ = COutPoint(outpointHasher.GetHash(), coin.utxoBeingStaked_.n);
+            }
+            splitCoin.utxoValue_ = part == 0 ? coin.utxoValue_ - partValue * (parts - 1) : partValue;
+            splitCoins.push_back(splitCoin);
+        }
+    }
+    return splitCoins;
+}
@@ -0,0 +1,58 @@
+#ifndef STAKING_SIMULATOR_H
+#define STAKING_SIMULATOR_H
+#include <amount.h>
+#include <StakingData.h>
+
+#include <stdint.h>
+#include <vector>
+
+class BlockMap;
+class CChain;
+class I_ProofOfStakeGenerator;
+class ProofOfStakeKernelSearch;
+
+/**
+ * Replays a stretch of the active chain against a set of coins to tell how
+ * many of its blocks those coins would have staked, and at what hashing cost.
+ *
+ * For each block the coins race the block that was actually found: a coin
+ * wins if it has a hashproof later than the previous block and no later than
+ * the actual one, and then counts as restaked in the actual block, so its age
+ * starts again from there. Coins confirmed later than a block's parent do not
+ * take part in that block's race.
+ */
+class StakingSimulator
+{
+public:
+    struct Result {
+        unsigned numberOfCoins;
+        unsigned blocksSimulated;
+        unsigned blocksStaked;
+        uint64_t kernelsHashed;
+
+        Result();
+    };
+
+private:
+    const CChain& activeChain_;
+    const BlockMap& mapBlockIndex_;
+    const ProofOfStakeKernelSearch& kernelSearch_;
+
+public:
+    StakingSimulator(
+        const CChain& activeChain,
+        const BlockMap& mapBlockIndex,
+        const ProofOfStakeKernelSearch& kernelSearch);
+
+    //! The coins only need their value, the coin they spend and their confirmation block
+    Result Simulate(
+        const std::vector<StakingData>& coins,
+        int firstHeight,
+        int lastHeight) const;
+
+    //! Each coin split into the given number of coins of equal value and the same confirmation
+    static std::vector<StakingData> SplitCoins(
+        const std::vector<StakingData>& coins,
+        unsigned parts);
+};
+#endif// STAKING_SIMULATOR_H
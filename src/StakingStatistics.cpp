@@ -0,0 +1,145 @@
+#include <StakingStatistics.h>
+
+#include <utiltime.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+
+namespace
+{
+const int64_t bucketUpperBounds[StakingStatistics::NUMBER_OF_BUCKETS - 1] = {
+    1000, 10000, 100000, 1000000, 10000000, 60000000 };
+
+const char* const stageNames[StakingStatistics::NUMBER_OF_STAGES] = {
+    "coin_selection",
+    "kernel_search",
+    "transaction_collection",
+    "block_signing",
+    "block_processing" };
+
+const char* const missNames[StakingStatistics::NUMBER_OF_MISSES] = {
+    "no_stakable_coins",
+    "no_time_window",
+    "chain_tip_changed",
+    "no_kernel_found",
+    "coinstake_signing_failed",
+    "block_signing_failed",
+    "block_rejected" };
+}
+
+constexpr unsigned StakingStatistics::NUMBER_OF_STAGES;
+constexpr unsigned StakingStatistics::NUMBER_OF_MISSES;
+constexpr unsigned StakingStatistics::NUMBER_OF_BUCKETS;
+constexpr size_t StakingStatistics::DEFAULT_MAXIMUM_STAKED_BLOCKS;
+
+StakingStatistics::StageTimings::StageTimings(
+    ): count(0)
+    , totalMicros(0)
+    , maximumMicros(0)
+{
+    memset(buckets, 0, sizeof(buckets));
+}
+
+StakingStatistics::Snapshot::Snapshot(
+    ): startTime(GetTime())
+    , attempts(0)
+    , coinsScanned(0)
+    , kernelsHashed(0)
+    , stakesFound(0)
+    , blocksAccepted(0)
+    , stakedBlocks()
+{
+    memset(misses, 0, sizeof(misses));
+}
+
+const char* StakingStatistics::StageName(StakingStage stage)
+{
+    assert(stage != StakingStage::NUMBER_OF_STAGES);
+    return stageNames[static_cast<unsigned>(stage)];
+}
+
+const char* StakingStatistics::MissName(StakingMiss miss)
+{
+    assert(miss != StakingMiss::NUMBER_OF_MISSES);
+    return missNames[static_cast<unsigned>(miss)];
+}
+
+int64_t StakingStatistics::BucketUpperBound(unsigned bucket)
+{
+    return bucket + 1 < NUMBER_OF_BUCKETS ? bucketUpperBounds[bucket] : -1;
+}
+
+StakingStatistics::StakingStatistics(
+    size_t maximumStakedBlocks
+    ): maximumStakedBlocks_(maximumStakedBlocks)
+    , cs_statistics_()
+    , statistics_()
+    , stakedBlocks_()
+{
+}
+
+void StakingStatistics::RecordAttempt()
+{
+    LOCK(cs_statistics_);
+    ++statistics_.attempts;
+}
+
+void StakingStatistics::RecordMiss(StakingMiss miss)
+{
+    assert(miss != StakingMiss::NUMBER_OF_MISSES);
+    LOCK(cs_statistics_);
+    ++statistics_.misses[static_cast<unsigned>(miss)];
+}
+
+void StakingStatistics::RecordStageTime(StakingStage stage, int64_t micros)
+{
+    assert(stage != StakingStage::NUMBER_OF_STAGES);
+    const uint64_t elapsed = static_cast<uint64_t>(std::max<int64_t>(0, micros));
+    const int64_t* bucket = std::lower_bound(bucketUpperBounds, bucketUpperBounds + NUMBER_OF_BUCKETS - 1, static_cast<int64_t>(elapsed));
+
+    LOCK(cs_statistics_);
+    StageTimings& timings = statistics_.stages[static_cast<unsigned>(stage)];
+    ++timings.count;
+    timings.totalMicros += elapsed;
+    timings.maximumMicros = std::max(timings.maximumMicros, elapsed);
+    ++timings.buckets[bucket - bucketUpperBounds];
+}
+
+void StakingStatistics::RecordKernelSearch(size_t coinsScanned, uint64_t kernelsHashed, int64_t micros)
+{
+    RecordStageTime(StakingStage::KERNEL_SEARCH, micros);
+    LOCK(cs_statistics_);
+    statistics_.coinsScanned += coinsScanned;
+    statistics_.kernelsHashed += kernelsHashed;
+}
+
+void StakingStatistics::RecordStakeFound()
+{
+    LOCK(cs_statistics_);
+    ++statistics_.stakesFound;
+}
+
+void StakingStatistics::RecordAcceptedBlock(const uint256& blockHash)
+{
+    LOCK(cs_statistics_);
+    ++statistics_.blocksAccepted;
+    stakedBlocks_.push_back(blockHash);
+    if (stakedBlocks_.size() > maximumStakedBlocks_)
+        stakedBlocks_.pop_front();
+}
+
+StakingStatistics::Snapshot StakingStatistics::GetSnapshot() const
+{
+    LOCK(cs_statistics_);
+    Snapshot snapshot = statistics_;
+    snapshot.stakedBlocks.assign(stakedBlocks_.begin(), stakedBlocks_.end());
+    return snapshot;
+}
+
+void StakingStatistics::Reset()
+{
+    LOCK(cs_statistics_);
+    statistics_ = Snapshot();
+    stakedBlocks_.clear();
+}
@@ -0,0 +1,101 @@
+#ifndef STAKING_STATISTICS_H
+#define STAKING_STATISTICS_H
+#include <sync.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+//! The timed parts of an attempt to stake a block
+enum class StakingStage {
+    COIN_SELECTION,
+    KERNEL_SEARCH,
+    TRANSACTION_COLLECTION,
+    BLOCK_SIGNING,
+    BLOCK_PROCESSING,
+    NUMBER_OF_STAGES
+};
+
+//! Why an attempt to stake a block did not produce one
+enum class StakingMiss {
+    NO_STAKABLE_COINS,
+    NO_TIME_WINDOW,
+    CHAIN_TIP_CHANGED,
+    NO_KERNEL_FOUND,
+    COINSTAKE_SIGNING_FAILED,
+    BLOCK_SIGNING_FAILED,
+    BLOCK_REJECTED,
+    NUMBER_OF_MISSES
+};
+
+/**
+ * Counters and timing histograms of the staking attempts made by this node,
+ * so it can be told whether stakes are lost to coin selection, hashing,
+ * block creation or block processing.
+ *
+ * The hashes of the last staked blocks that were accepted are remembered so
+ * that the ones which have since left the active chain can be counted as
+ * orphaned. Attempts are recorded by the minting threads while RPC and REST
+ * read snapshots.
+ */
+class StakingStatistics
+{
+public:
+    static constexpr unsigned NUMBER_OF_STAGES = static_cast<unsigned>(StakingStage::NUMBER_OF_STAGES);
+    static constexpr unsigned NUMBER_OF_MISSES = static_cast<unsigned>(StakingMiss::NUMBER_OF_MISSES);
+    //! Histogram buckets of each stage, the last of which has no upper bound
+    static constexpr unsigned NUMBER_OF_BUCKETS = 7;
+    //! Accepted staked blocks remembered to count orphans
+    static constexpr size_t DEFAULT_MAXIMUM_STAKED_BLOCKS = 1000;
+
+    struct StageTimings {
+        uint64_t count;
+        uint64_t totalMicros;
+        uint64_t maximumMicros;
+        uint64_t buckets[NUMBER_OF_BUCKETS];
+
+        StageTimings();
+    };
+
+    struct Snapshot {
+        int64_t startTime;
+        uint64_t attempts;
+        uint64_t coinsScanned;
+        uint64_t kernelsHashed;
+        uint64_t stakesFound;
+        uint64_t blocksAccepted;
+        uint64_t misses[NUMBER_OF_MISSES];
+        StageTimings stages[NUMBER_OF_STAGES];
+        std::vector<uint256> stakedBlocks;
+
+        Snapshot();
+    };
+
+    static const char* StageName(StakingStage stage);
+    static const char* MissName(StakingMiss miss);
+    //! Inclusive upper bound in microseconds of the histogram bucket, -1 for the last one
+    static int64_t BucketUpperBound(unsigned bucket);
+
+private:
+    const size_t maximumStakedBlocks_;
+    mutable CCriticalSection cs_statistics_;
+    Snapshot statistics_;
+    std::deque<uint256> stakedBlocks_;
+
+public:
+    explicit StakingStatistics(size_t maximumStakedBlocks = DEFAULT_MAXIMUM_STAKED_BLOCKS);
+
+    void RecordAttempt();
+    void RecordMiss(StakingMiss miss);
+    void RecordStageTime(StakingStage stage, int64_t micros);
+    //! Record a kernel search over coinsScanned coins, which is also timed as a stage
+    void RecordKernelSearch(size_t coinsScanned, uint64_t kernelsHashed, int64_t micros);
+    void RecordStakeFound();
+    void RecordAcceptedBlock(const uint256& blockHash);
+
+    Snapshot GetSnapshot() const;
+    void Reset();
+};
+#endif// STAKING_STATISTICS_H
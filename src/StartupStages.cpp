@@ -0,0 +1,72 @@
+#include <StartupStages.h>
+
+#include <Logging.h>
+#include <ThreadManagementHelpers.h>
+#include <utiltime.h>
+
+StartupStages::StageState::StageState(
+    ): thread()
+    , fSucceeded(false)
+    , fWaitedFor(false)
+    , exception()
+    , nElapsedMillis(0)
+{
+}
+
+StartupStages::StartupStages(
+    bool fParallel
+    ): fParallel_(fParallel)
+    , stages_()
+{
+}
+
+StartupStages::~StartupStages()
+{
+    for (auto& entry : stages_) {
+        if (entry.second.thread && entry.second.thread->joinable())
+            entry.second.thread->join();
+    }
+}
+
+void StartupStages::Run(const Stage& stage, StageState& state)
+{
+    const int64_t nStart = GetTimeMillis();
+    try {
+        state.fSucceeded = stage();
+    } catch (...) {
+        state.fSucceeded = false;
+        state.exception = std::current_exception();
+    }
+    state.nElapsedMillis = GetTimeMillis() - nStart;
+}
+
+void StartupStages::Start(const std::string& name, Stage stage)
+{
+    StageState& state = stages_[name];
+    if (!fParallel_) {
+        Run(stage, state);
+        return;
+    }
+    state.thread.reset(new boost::thread([name, stage, &state]() {
+        RenameThread(("izzy-init-" + name).c_str());
+        Run(stage, state);
+    }));
+}
+
+bool StartupStages::Wait(const std::string& name)
+{
+    std::map<std::string, StageState>::iterator it = stages_.find(name);
+    if (it == stages_.end())
+        return true;
+    StageState& state = it->second;
+    if (!state.fWaitedFor) {
+        const int64_t nStart = GetTimeMillis();
+        if (state.thread)
+            state.thread->join();
+        state.fWaitedFor = true;
+        LogPrintf(" %-11s %15dms (waited %dms)\n", name, state.nElapsedMillis, GetTimeMillis() - nStart);
+    }
+    if (state.exception)
+        std::rethrow_exception(state.exception);
+    return state.fSucceeded;
+}
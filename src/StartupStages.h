@@ -0,0 +1,54 @@
+#ifndef STARTUP_STAGES_H
+#define STARTUP_STAGES_H
+#include <stdint.h>
+
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <boost/thread/thread.hpp>
+
+/**
+ * Runs the stages of startup that do not depend on one another on threads of
+ * their own, for startup to wait on each one only right before the first step
+ * that needs what it loaded.
+ *
+ * A stage reports failure by returning false, after raising its own error for
+ * the user; an exception thrown by a stage is rethrown to whoever waits on it.
+ * Every stage still running when the stages go out of scope is waited for, so
+ * returning early out of startup never leaves a stage loading into state that
+ * shutdown is about to save. Without parallel stages, each stage runs to
+ * completion as it is started.
+ */
+class StartupStages
+{
+public:
+    typedef std::function<bool()> Stage;
+
+private:
+    struct StageState {
+        std::unique_ptr<boost::thread> thread;
+        bool fSucceeded;
+        bool fWaitedFor;
+        std::exception_ptr exception;
+        int64_t nElapsedMillis;
+
+        StageState();
+    };
+
+    const bool fParallel_;
+    std::map<std::string, StageState> stages_;
+
+    static void Run(const Stage& stage, StageState& state);
+
+public:
+    explicit StartupStages(bool fParallel);
+    ~StartupStages();
+
+    void Start(const std::string& name, Stage stage);
+    //! Whether the stage succeeded, logging how long it took and how much of that was spent waiting for it; a stage never started succeeds
+    bool Wait(const std::string& name);
+};
+#endif// STARTUP_STAGES_H
@@ -49,6 +49,19 @@
 #include <sys/prctl.h>
 #endif
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <map>
+#include <utilstrencodings.h>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 
 // Work around clang compilation problem in Boost 1.46:
@@ -91,6 +104,270 @@ void PrintExceptionContinue(std::exception* pex, const char* pszThread)
     strMiscWarning = message;
 }
 
+namespace
+{
+struct ThreadGroupSettings {
+    bool fPriority;
+    int nPriority;
+    bool fIdleIO;
+    std::vector<unsigned> processors;
+
+    ThreadGroupSettings(
+        ): fPriority(false)
+        , nPriority(THREAD_PRIORITY_NORMAL)
+        , fIdleIO(false)
+        , processors()
+    {
+    }
+};
+
+//! Bounds the processor numbers taken, as the masks binding threads to them have a fixed size
+constexpr unsigned MAX_THREAD_PROCESSORS = 1024;
+
+const std::pair<const char*, ThreadGroup> threadGroupNames[] = {
+    {"network", ThreadGroup::NETWORK},
+    {"scriptcheck", ThreadGroup::SCRIPT_CHECK},
+    {"rpc", ThreadGroup::RPC},
+    {"staking", ThreadGroup::STAKING},
+    {"masternode", ThreadGroup::MASTERNODE},
+    {"import", ThreadGroup::IMPORT},
+    {"background", ThreadGroup::BACKGROUND},
+};
+
+const std::pair<const char*, ThreadGroup> threadGroupsByThreadName[] = {
+    {"net", ThreadGroup::NETWORK},
+    {"msghand", ThreadGroup::NETWORK},
+    {"opencon", ThreadGroup::NETWORK},
+    {"addcon", ThreadGroup::NETWORK},
+    {"dnsseed", ThreadGroup::NETWORK},
+    {"upnp", ThreadGroup::NETWORK},
+    {"torcontrol", ThreadGroup::NETWORK},
+    {"scriptch", ThreadGroup::SCRIPT_CHECK},
+    {"sigprecheck", ThreadGroup::SCRIPT_CHECK},
+    {"mnsigcheck", ThreadGroup::SCRIPT_CHECK},
+    {"coinslookup", ThreadGroup::SCRIPT_CHECK},
+    {"rpc", ThreadGroup::RPC},
+    {"rpcworker", ThreadGroup::RPC},
+    {"stakemint", ThreadGroup::STAKING},
+    {"miner", ThreadGroup::STAKING},
+    {"obfuscation", ThreadGroup::MASTERNODE},
+    {"loadblk", ThreadGroup::IMPORT},
+    {"scanblk", ThreadGroup::IMPORT},
+    {"rescanblk", ThreadGroup::IMPORT},
+    {"wallet", ThreadGroup::BACKGROUND},
+    {"keypool", ThreadGroup::BACKGROUND},
+    {"monthly_backup", ThreadGroup::BACKGROUND},
+    {"dustcombiner", ThreadGroup::BACKGROUND},
+    {"buildindex", ThreadGroup::BACKGROUND},
+    {"compressblk", ThreadGroup::BACKGROUND},
+    {"verifychain", ThreadGroup::BACKGROUND},
+    {"dumpaddr", ThreadGroup::BACKGROUND},
+};
+
+boost::mutex csThreadGroupSettings;
+std::map<ThreadGroup, ThreadGroupSettings> threadGroupSettings;
+
+ThreadGroupSettings IdleThreadGroupSettings()
+{
+    ThreadGroupSettings idle;
+    idle.fPriority = true;
+    idle.nPriority = THREAD_PRIORITY_LOWEST;
+    idle.fIdleIO = true;
+    return idle;
+}
+
+std::map<ThreadGroup, ThreadGroupSettings> DefaultThreadGroupSettings()
+{
+    std::map<ThreadGroup, ThreadGroupSettings> defaults;
+    defaults[ThreadGroup::BACKGROUND] = IdleThreadGroupSettings();
+    return defaults;
+}
+
+bool ParseThreadGroupName(const std::string& name, ThreadGroup& group)
+{
+    BOOST_FOREACH (const auto& groupName, threadGroupNames) {
+        if (name == groupName.first) {
+            group = groupName.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+//! Splits a <group>:<value> setting
+bool ParseThreadGroupSetting(const std::string& setting, ThreadGroup& group, std::string& value)
+{
+    const size_t separator = setting.find(':');
+    if (separator == std::string::npos || !ParseThreadGroupName(setting.substr(0, separator), group))
+        return false;
+    value = setting.substr(separator + 1);
+    return true;
+}
+
+bool ParseProcessorNumber(const std::string& str, unsigned& processor)
+{
+    int32_t n;
+    if (!ParseInt32(str, &n) || n < 0 || static_cast<unsigned>(n) >= MAX_THREAD_PROCESSORS)
+        return false;
+    processor = static_cast<unsigned>(n);
+    return true;
+}
+
+bool ParseProcessorList(const std::string& str, std::vector<unsigned>& processors)
+{
+    std::vector<std::string> ranges;
+    boost::split(ranges, str, boost::is_any_of(","));
+    BOOST_FOREACH (const std::string& range, ranges) {
+        const size_t dash = range.find('-');
+        unsigned first, last;
+        if (!ParseProcessorNumber(range.substr(0, dash), first))
+            return false;
+        last = first;
+        if (dash != std::string::npos && (!ParseProcessorNumber(range.substr(dash + 1), last) || last < first))
+            return false;
+        for (unsigned processor = first; processor <= last; processor++) {
+            if (std::find(processors.begin(), processors.end(), processor) == processors.end())
+                processors.push_back(processor);
+        }
+    }
+    std::sort(processors.begin(), processors.end());
+    return true;
+}
+
+void SetThreadIdleIOPriority()
+{
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    // The idle class, in the top bits of the priority, for the calling thread
+    static const int IOPRIO_WHO_PROCESS = 1;
+    static const int IOPRIO_CLASS_IDLE = 3;
+    static const int IOPRIO_CLASS_SHIFT = 13;
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0)
+        LogPrintf("%s: could not lower the I/O priority of the thread\n", __func__);
+#endif
+}
+
+void SetThreadProcessors(const std::vector<unsigned>& processors)
+{
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    BOOST_FOREACH (unsigned processor, processors) {
+        if (processor < CPU_SETSIZE)
+            CPU_SET(processor, &cpus);
+    }
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0)
+        LogPrintf("%s: could not bind the thread to its processors (error %d)\n", __func__, error);
+#elif defined(WIN32)
+    DWORD_PTR mask = 0;
+    BOOST_FOREACH (unsigned processor, processors) {
+        if (processor < 8 * sizeof(mask))
+            mask |= static_cast<DWORD_PTR>(1) << processor;
+    }
+    if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+        LogPrintf("%s: could not bind the thread to its processors\n", __func__);
+#else
+    LogPrintf("%s: binding threads to processors is not supported on this platform\n", __func__);
+#endif
+}
+
+void ApplyThreadGroupSettings(const char* name)
+{
+    const ThreadGroup group = ThreadGroupOf(name);
+    if (group == ThreadGroup::NONE)
+        return;
+    ThreadGroupSettings groupSettings;
+    {
+        boost::unique_lock<boost::mutex> lock(csThreadGroupSettings);
+        if (threadGroupSettings.empty())
+            threadGroupSettings = DefaultThreadGroupSettings();
+        const auto it = threadGroupSettings.find(group);
+        if (it == threadGroupSettings.end())
+            return;
+        groupSettings = it->second;
+    }
+    if (groupSettings.fPriority)
+        SetThreadPriority(groupSettings.nPriority);
+    if (groupSettings.fIdleIO)
+        SetThreadIdleIOPriority();
+    if (!groupSettings.processors.empty())
+        SetThreadProcessors(groupSettings.processors);
+}
+} // namespace
+
+ThreadGroup ThreadGroupOf(const std::string& threadName)
+{
+    const std::string prefix = "izzy-";
+    const std::string name = threadName.compare(0, prefix.size(), prefix) == 0 ? threadName.substr(prefix.size()) : threadName;
+    BOOST_FOREACH (const auto& threadGroup, threadGroupsByThreadName) {
+        if (name == threadGroup.first)
+            return threadGroup.second;
+    }
+    return ThreadGroup::NONE;
+}
+
+bool InitThreadGroupSettings(const std::vector<std::string>& priorities, const std::vector<std::string>& affinities, std::string& error)
+{
+    std::map<ThreadGroup, ThreadGroupSettings> groupSettings = DefaultThreadGroupSettings();
+    BOOST_FOREACH (const std::string& setting, priorities) {
+        ThreadGroup group;
+        std::string priority;
+        if (!ParseThreadGroupSetting(setting, group, priority)) {
+            error = strprintf("Unknown thread group in -threadpriority=%s", setting);
+            return false;
+        }
+        ThreadGroupSettings& settingsOfGroup = groupSettings[group];
+        settingsOfGroup.fPriority = true;
+        settingsOfGroup.fIdleIO = priority == "idle";
+        if (priority == "idle")
+            settingsOfGroup.nPriority = THREAD_PRIORITY_LOWEST;
+        else if (priority == "low")
+            settingsOfGroup.nPriority = THREAD_PRIORITY_BELOW_NORMAL;
+        else if (priority == "normal")
+            settingsOfGroup.nPriority = THREAD_PRIORITY_NORMAL;
+        else if (priority == "high")
+            settingsOfGroup.nPriority = THREAD_PRIORITY_ABOVE_NORMAL;
+        else {
+            error = strprintf("Unknown priority in -threadpriority=%s, expected idle, low, normal or high", setting);
+            return false;
+        }
+    }
+    BOOST_FOREACH (const std::string& setting, affinities) {
+        ThreadGroup group;
+        std::string processorList;
+        std::vector<unsigned> processors;
+        if (!ParseThreadGroupSetting(setting, group, processorList)) {
+            error = strprintf("Unknown thread group in -threadaffinity=%s", setting);
+            return false;
+        }
+        if (!ParseProcessorList(processorList, processors)) {
+            error = strprintf("Invalid processor list in -threadaffinity=%s, expected processors like 0,2-3", setting);
+            return false;
+        }
+        groupSettings[group].processors = processors;
+    }
+
+    boost::unique_lock<boost::mutex> lock(csThreadGroupSettings);
+    threadGroupSettings = groupSettings;
+    return true;
+}
+
+int ThreadGroupPriority(ThreadGroup group, int defaultPriority)
+{
+    boost::unique_lock<boost::mutex> lock(csThreadGroupSettings);
+    if (threadGroupSettings.empty())
+        threadGroupSettings = DefaultThreadGroupSettings();
+    const auto it = threadGroupSettings.find(group);
+    return it != threadGroupSettings.end() && it->second.fPriority ? it->second.nPriority : defaultPriority;
+}
+
+std::vector<unsigned> ThreadGroupProcessors(ThreadGroup group)
+{
+    boost::unique_lock<boost::mutex> lock(csThreadGroupSettings);
+    const auto it = threadGroupSettings.find(group);
+    return it != threadGroupSettings.end() ? it->second.processors : std::vector<unsigned>();
+}
+
 void RenameThread(const char* name)
 {
 #if defined(PR_SET_NAME)
@@ -113,6 +390,7 @@ void RenameThread(const char* name)
     // Prevent warnings for unused parameters...
     (void)name;
 #endif
+    ApplyThreadGroupSettings(name);
 }
 
 void SetThreadPriority(int nPriority)
@@ -8,6 +8,7 @@
 
 #include <Logging.h>
 #include <string>
+#include <vector>
 #include <exception>
 #include <utiltime.h>
 
@@ -17,8 +18,37 @@
 extern std::string strMiscWarning;
 void PrintExceptionContinue(std::exception* pex, const char* pszThread);
 void SetThreadPriority(int nPriority);
+//! Names the calling thread, and gives it the priority and processors set for its thread group
 void RenameThread(const char* name);
 
+/** The threads that share a priority and processors, named in -threadpriority and -threadaffinity */
+enum class ThreadGroup
+{
+    NONE,
+    NETWORK,
+    SCRIPT_CHECK,
+    RPC,
+    STAKING,
+    MASTERNODE,
+    IMPORT,
+    BACKGROUND,
+};
+
+//! The group of a thread by its name, with or without the izzy- prefix
+ThreadGroup ThreadGroupOf(const std::string& threadName);
+/**
+ * Takes the -threadpriority=<group>:<idle|low|normal|high> and the
+ * -threadaffinity=<group>:<cpus> settings, cpus being a list like 0,2-3.
+ * The background group, which flushes, backs up, combines dust and builds
+ * indexes, runs at idle priority unless set otherwise. Fails with the
+ * error on a setting that names no group, priority or processor.
+ */
+bool InitThreadGroupSettings(const std::vector<std::string>& priorities, const std::vector<std::string>& affinities, std::string& error);
+//! The priority set for the group, or defaultPriority when there is none
+int ThreadGroupPriority(ThreadGroup group, int defaultPriority);
+//! The processors the group is bound to, none when it may run on any
+std::vector<unsigned> ThreadGroupProcessors(ThreadGroup group);
+
 /**
  * Standard wrapper for do-something-forever thread functions.
  * "Forever" really means until the thread is interrupted.
@@ -1,6 +1,7 @@
 #include <TransactionDiskAccessor.h>
 
 #include <BlockDiskAccessor.h>
+#include <CachingBlockDataReader.h>
 #include <sync.h>
 #include <txmempool.h>
 #include <coins.h>
@@ -9,14 +10,27 @@
 #include <BlockFileOpener.h>
 #include <clientversion.h>
 #include <Logging.h>
+#include <RecentTransactionCache.h>
+#include <defaultValues.h>
 
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
 extern CBlockTreeDB* pblocktree;
 extern bool fTxIndex;
+extern bool fHavePruned;
 extern CCoinsViewCache* pcoinsTip;
 extern CChain chainActive;
 
+namespace
+{
+RecentTransactionCache recentTransactions(TRANSACTION_CACHE_ENTRIES);
+}
+
+RecentTransactionCache& GetRecentTransactionCache()
+{
+    return recentTransactions;
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock, bool fAllowSlow)
 {
@@ -30,6 +44,8 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
         }
 
         if (fTxIndex) {
+            if (recentTransactions.Find(hash, txOut, hashBlock))
+                return true;
             CDiskTxPos postx;
             if (pblocktree->ReadTxIndex(hash, postx)) {
                 CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
@@ -46,6 +62,7 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
                 hashBlock = header.GetHash();
                 if (txOut.GetHash() != hash && txOut.GetBareTxid() != hash)
                     return error("%s : txid mismatch", __func__);
+                recentTransactions.Insert(txOut, hashBlock);
                 return true;
             }
 
@@ -65,15 +82,25 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
             if (nHeight > 0)
                 pindexSlow = chainActive[nHeight];
         }
+
+        // Only found when the coin database places the transaction in the block it was cached from
+        CTransaction cachedTx;
+        uint256 hashCachedBlock;
+        if (pindexSlow && recentTransactions.Find(hash, cachedTx, hashCachedBlock) && hashCachedBlock == pindexSlow->GetBlockHash()) {
+            txOut = cachedTx;
+            hashBlock = hashCachedBlock;
+            return true;
+        }
     }
 
     if (pindexSlow) {
-        CBlock block;
-        if (ReadBlockFromDisk(block, pindexSlow)) {
-            BOOST_FOREACH (const CTransaction& tx, block.vtx) {
+        CachingBlockDataReader::BlockRef block = GetRecentBlockDataReader().GetBlock(pindexSlow);
+        if (block) {
+            BOOST_FOREACH (const CTransaction& tx, block->vtx) {
                 if (tx.GetHash() == hash || tx.GetBareTxid() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
+                    recentTransactions.Insert(txOut, hashBlock);
                     return true;
                 }
             }
@@ -83,18 +110,51 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
     return false;
 }
 
+bool GetTransactionOutput(const COutPoint& outpoint, CTxOut& txout, uint256& hashBlock, bool fAllowSlow)
+{
+    CTransaction tx;
+    if (GetTransaction(outpoint.hash, tx, hashBlock, fAllowSlow)) {
+        if (outpoint.n >= tx.vout.size())
+            return false;
+        txout = tx.vout[outpoint.n];
+        return true;
+    }
+
+    // The block holding the transaction may have been pruned, the coin database still has what is unspent.
+    if (!fHavePruned)
+        return false;
+    LOCK(cs_main);
+    const CCoins* coins = pcoinsTip->AccessCoins(outpoint.hash);
+    if (!coins || !coins->IsAvailable(outpoint.n) || coins->nHeight < 0 || coins->nHeight > chainActive.Height())
+        return false;
+    txout = coins->vout[outpoint.n];
+    hashBlock = chainActive[coins->nHeight]->GetBlockHash();
+    return true;
+}
+
+bool GetUnspentTransactionOutput(const COutPoint& outpoint, CTxOut& txout, int& nHeight)
+{
+    LOCK(cs_main);
+    const CCoins* coins = pcoinsTip->AccessCoins(outpoint.hash);
+    if (!coins || !coins->IsAvailable(outpoint.n) || coins->nHeight < 0 || coins->nHeight > chainActive.Height())
+        return false;
+    txout = coins->vout[outpoint.n];
+    nHeight = coins->nHeight;
+    return true;
+}
+
 bool CollateralIsExpectedAmount(const COutPoint &outpoint, int64_t expectedAmount)
 {
-    CCoins coins;
     LOCK(cs_main);
-    if (!pcoinsTip->GetCoins(outpoint.hash, coins))
+    const CCoins* coins = pcoinsTip->AccessCoins(outpoint.hash);
+    if (!coins)
         return false;
 
     int n = outpoint.n;
-    if (n < 0 || (unsigned int)n >= coins.vout.size() || coins.vout[n].IsNull()) {
+    if (n < 0 || (unsigned int)n >= coins->vout.size() || coins->vout[n].IsNull()) {
         return false;
     }
-    else if (coins.vout[n].nValue != expectedAmount)
+    else if (coins->vout[n].nValue != expectedAmount)
     {
         return false;
     }
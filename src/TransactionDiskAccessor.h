@@ -4,8 +4,16 @@
 class uint256;
 class CTransaction;
 class COutPoint;
+class CTxOut;
+class RecentTransactionCache;
 
 /** Get transaction from mempool or disk **/
 bool GetTransaction(const uint256& hash, CTransaction& tx, uint256& hashBlock, bool fAllowSlow = false);
+/** Get the output outpoint refers to like GetTransaction; unspent outputs are also found once their block was pruned */
+bool GetTransactionOutput(const COutPoint& outpoint, CTxOut& txout, uint256& hashBlock, bool fAllowSlow = false);
+/** Get an unspent output and the height of its block from the coin database, which never reads a block */
+bool GetUnspentTransactionOutput(const COutPoint& outpoint, CTxOut& txout, int& nHeight);
+/** The transactions GetTransaction read from disk recently, to be cleared whenever a block is disconnected */
+RecentTransactionCache& GetRecentTransactionCache();
 bool CollateralIsExpectedAmount(const COutPoint &outpoint, int64_t expectedAmount);
 #endif // TRANSACTION_DISK_ACCESSOR_H
\ No newline at end of file
@@ -76,5 +76,11 @@ bool TransactionInputChecker::TotalSigOpsAreBelowMaximum(const CTransaction& tx)
 
 bool TransactionInputChecker::WaitForScriptsToBeChecked()
 {
-    return multiThreadedScriptChecker.Wait();
+    const bool fScriptsOk = multiThreadedScriptChecker.Wait();
+    if (fScriptChecks && nScriptCheckThreads) {
+        const CCheckQueueStats stats = scriptcheckqueue.GetStats();
+        LogPrint(LOG_BENCH, "    - Script check queue: %u checks in %u batches, %.2fus per check, master waited %.2fms in total\n",
+            stats.nChecks, stats.nBatches, 0.001 * stats.nCheckCostNanos, 0.001 * stats.nMasterWaitMicros);
+    }
+    return fScriptsOk;
 }
\ No newline at end of file
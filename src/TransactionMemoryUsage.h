@@ -0,0 +1,16 @@
+#ifndef TRANSACTION_MEMORY_USAGE_H
+#define TRANSACTION_MEMORY_USAGE_H
+#include <memusage.h>
+#include <primitives/transaction.h>
+
+/** The memory a transaction's inputs, outputs and scripts take up, beyond the size of the transaction itself */
+static inline size_t TransactionMemoryUsage(const CTransaction& tx)
+{
+    size_t usage = memusage::DynamicUsage(tx.vin) + memusage::DynamicUsage(tx.vout);
+    for (const CTxIn& txin : tx.vin)
+        usage += memusage::DynamicUsage(*static_cast<const CScriptBase*>(&txin.scriptSig));
+    for (const CTxOut& txout : tx.vout)
+        usage += memusage::DynamicUsage(*static_cast<const CScriptBase*>(&txout.scriptPubKey));
+    return usage;
+}
+#endif// TRANSACTION_MEMORY_USAGE_H
@@ -0,0 +1,80 @@
+#include <UniValueReader.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <locale>
+#include <sstream>
+
+#include "json/json_spirit_reader_template.h"
+#include "univalue/univalue.h"
+
+namespace
+{
+/** Numbers become integers the way json_spirit reads them, unless they have a fraction or exponent */
+json_spirit::Value NumberToJSONSpirit(const std::string& strNumber)
+{
+    if (strNumber.find_first_of(".eE") == std::string::npos) {
+        errno = 0;
+        if (strNumber[0] == '-') {
+            const long long n = strtoll(strNumber.c_str(), NULL, 10);
+            if (errno == 0)
+                return json_spirit::Value(static_cast<int64_t>(n));
+        } else {
+            const unsigned long long n = strtoull(strNumber.c_str(), NULL, 10);
+            if (errno == 0) {
+                if (n <= static_cast<unsigned long long>(INT64_MAX))
+                    return json_spirit::Value(static_cast<int64_t>(n));
+                return json_spirit::Value(static_cast<uint64_t>(n));
+            }
+        }
+    }
+    std::istringstream stream(strNumber);
+    stream.imbue(std::locale::classic());
+    double d = 0;
+    stream >> d;
+    return json_spirit::Value(d);
+}
+}
+
+json_spirit::Value UniValueToJSONSpirit(const UniValue& uv)
+{
+    switch (uv.getType()) {
+    case UniValue::VOBJ: {
+        json_spirit::Object obj;
+        const std::vector<std::string>& keys = uv.getKeys();
+        const std::vector<UniValue>& values = uv.getValues();
+        obj.reserve(keys.size());
+        for (unsigned int i = 0; i < keys.size() && i < values.size(); i++)
+            obj.push_back(json_spirit::Pair(keys[i], UniValueToJSONSpirit(values[i])));
+        return obj;
+    }
+    case UniValue::VARR: {
+        json_spirit::Array arr;
+        const std::vector<UniValue>& values = uv.getValues();
+        arr.reserve(values.size());
+        for (unsigned int i = 0; i < values.size(); i++)
+            arr.push_back(UniValueToJSONSpirit(values[i]));
+        return arr;
+    }
+    case UniValue::VSTR:
+        return json_spirit::Value(uv.getValStr());
+    case UniValue::VNUM:
+        return NumberToJSONSpirit(uv.getValStr());
+    case UniValue::VBOOL:
+        return json_spirit::Value(uv.isTrue());
+    case UniValue::VNULL:
+    default:
+        return json_spirit::Value::null;
+    }
+}
+
+bool ReadJSONValue(const std::string& strJSON, json_spirit::Value& value)
+{
+    // UniValue reads nothing at all as null, where json_spirit fails
+    UniValue uv;
+    if (uv.read(strJSON) && (uv.isObject() || uv.isArray())) {
+        value = UniValueToJSONSpirit(uv);
+        return true;
+    }
+    return json_spirit::read_string(strJSON, value);
+}
@@ -0,0 +1,20 @@
+#ifndef UNIVALUE_READER_H
+#define UNIVALUE_READER_H
+#include <string>
+
+#include "json/json_spirit_value.h"
+
+class UniValue;
+
+/**
+ * Parses JSON text with the UniValue parser into a json_spirit value.
+ *
+ * The hand-written UniValue tokenizer is much faster than the Spirit based
+ * parser of json_spirit, which is what dominates the cost of small RPC
+ * calls. Text UniValue refuses, such as a lone scalar at the top level, is
+ * left to json_spirit so the result is the same as read_string's.
+ */
+bool ReadJSONValue(const std::string& strJSON, json_spirit::Value& value);
+
+json_spirit::Value UniValueToJSONSpirit(const UniValue& uv);
+#endif// UNIVALUE_READER_H
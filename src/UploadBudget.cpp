@@ -0,0 +1,70 @@
+#include <UploadBudget.h>
+
+#include <algorithm>
+
+const int64_t UploadBudget::MAX_BYTES_PER_SECOND;
+const int64_t UploadBudget::MAX_REFILL_MICROS;
+
+UploadBudget::UploadBudget(
+    ): bytesPerSecond_(0)
+    , burstBytes_(0)
+    , availableBytes_(0)
+    , lastRefillMicros_(0)
+{
+}
+
+void UploadBudget::Refill(int64_t nowMicros)
+{
+    if (!IsLimited() || nowMicros <= lastRefillMicros_)
+        return;
+    // Long idle periods refill the whole burst anyway, and counting them in full could overflow
+    const int64_t elapsedMicros = std::min(nowMicros - lastRefillMicros_, MAX_REFILL_MICROS);
+    const int64_t refilledBytes = elapsedMicros * bytesPerSecond_ / 1000000;
+    if (refilledBytes == 0)
+        return;
+    availableBytes_ = std::min(burstBytes_, availableBytes_ + refilledBytes);
+    // Keep the time a fraction of a byte took for the next refill, unless the bucket is full
+    if (availableBytes_ == burstBytes_)
+        lastRefillMicros_ = nowMicros;
+    else
+        lastRefillMicros_ += refilledBytes * 1000000 / bytesPerSecond_;
+}
+
+void UploadBudget::SetRate(int64_t bytesPerSecond, int64_t burstSeconds, int64_t nowMicros)
+{
+    bytesPerSecond_ = std::max((int64_t)0, std::min(bytesPerSecond, MAX_BYTES_PER_SECOND));
+    burstBytes_ = bytesPerSecond_ * std::max((int64_t)1, burstSeconds);
+    availableBytes_ = burstBytes_;
+    lastRefillMicros_ = nowMicros;
+}
+
+bool UploadBudget::IsLimited() const
+{
+    return bytesPerSecond_ > 0;
+}
+
+void UploadBudget::Spend(int64_t bytes, int64_t nowMicros)
+{
+    if (!IsLimited())
+        return;
+    Refill(nowMicros);
+    availableBytes_ -= bytes;
+}
+
+bool UploadBudget::HasBytesAvailable(int64_t nowMicros)
+{
+    return !IsLimited() || GetAvailableBytes(nowMicros) > 0;
+}
+
+int64_t UploadBudget::GetBytesPerSecond() const
+{
+    return bytesPerSecond_;
+}
+
+int64_t UploadBudget::GetAvailableBytes(int64_t nowMicros)
+{
+    if (!IsLimited())
+        return 0;
+    Refill(nowMicros);
+    return availableBytes_;
+}
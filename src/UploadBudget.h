@@ -0,0 +1,40 @@
+#ifndef UPLOAD_BUDGET_H
+#define UPLOAD_BUDGET_H
+#include <stdint.h>
+
+/**
+ * A token bucket of bytes that may be uploaded, refilled at a steady rate up
+ * to a burst of a few seconds worth.
+ *
+ * Spending is never refused, so traffic that must go out regardless can run
+ * the budget into debt; traffic of lower priority goes out only while the
+ * budget is positive, and so waits until the debt is paid off. A rate of zero
+ * means unlimited. Not thread-safe: callers serialize access.
+ */
+class UploadBudget
+{
+public:
+    static const int64_t MAX_BYTES_PER_SECOND = 1000000000;
+
+private:
+    static const int64_t MAX_REFILL_MICROS = 1000 * 1000000LL;
+
+    int64_t bytesPerSecond_;
+    int64_t burstBytes_;
+    int64_t availableBytes_;
+    int64_t lastRefillMicros_;
+
+    void Refill(int64_t nowMicros);
+
+public:
+    UploadBudget();
+
+    void SetRate(int64_t bytesPerSecond, int64_t burstSeconds, int64_t nowMicros);
+    bool IsLimited() const;
+    void Spend(int64_t bytes, int64_t nowMicros);
+    //! Whether lower priority traffic may go out now
+    bool HasBytesAvailable(int64_t nowMicros);
+    int64_t GetBytesPerSecond() const;
+    int64_t GetAvailableBytes(int64_t nowMicros);
+};
+#endif// UPLOAD_BUDGET_H
@@ -10,8 +10,31 @@
 #include <undo.h>
 #include <chainparams.h>
 #include <defaultValues.h>
+#include <ScriptExecutionCache.h>
+#include <script/SignatureCheckers.h>
+#include <Settings.h>
 
 extern BlockMap mapBlockIndex;
+extern Settings& settings;
+
+namespace
+{
+ScriptExecutionCache scriptExecutionCache;
+}
+
+void InitScriptExecutionCache()
+{
+    // The other half of -maxsigcachesize goes to the signature cache
+    const size_t nMaxCacheSize = (std::min(std::max((int64_t)0, settings.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) << 20) / 2;
+    const uint32_t nElements = scriptExecutionCache.SetupBytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for script execution cache, able to store %u elements\n",
+              (nElements * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElements);
+}
+
+size_t ScriptExecutionCacheDynamicMemoryUsage()
+{
+    return scriptExecutionCache.DynamicMemoryUsage();
+}
 
 void UpdateCoinsWithTransaction(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo& txundo, int nHeight)
 {
@@ -206,13 +229,24 @@ bool CheckInputs(
         // before the last block chain checkpoint. This is safe because block merkle hashes are
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
+            // Transactions whose scripts passed under these flags on entering the mempool
+            // need no evaluation. A block's lookups erase the entry, as it is done with.
+            const uint256 scriptCacheEntry = scriptExecutionCache.ComputeEntry(tx, flags);
+            if (scriptExecutionCache.Contains(scriptCacheEntry, !cacheStore))
+                return true;
+
+            // A single input gains nothing from serializing the rest of the transaction ahead
+            std::shared_ptr<const PrecomputedTransactionData> txdata;
+            if (tx.vin.size() > 1)
+                txdata = std::make_shared<const PrecomputedTransactionData>(tx);
+
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint& prevout = tx.vin[i].prevout;
                 const CCoins* coins = inputs.AccessCoins(prevout.hash);
                 assert(coins);
 
                 // Verify signature
-                CScriptCheck check(*coins, tx, i, flags, cacheStore);
+                CScriptCheck check(*coins, tx, i, flags, cacheStore, txdata);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -225,7 +259,7 @@ bool CheckInputs(
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
                         CScriptCheck check(*coins, tx, i,
-                                           flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore);
+                                           flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, txdata);
                         if (check())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
                     }
@@ -239,6 +273,10 @@ bool CheckInputs(
                     return state.DoS(100, false, REJECT_INVALID, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
                 }
             }
+
+            // Deferred checks have not run yet, so only a result known here can be cached
+            if (cacheStore && !pvChecks)
+                scriptExecutionCache.Insert(scriptCacheEntry);
         }
     }
 
@@ -15,6 +15,9 @@ enum class TxReversalStatus
     CONTINUE_WITH_ERRORS,
     OK,
 };
+/** Sizes the script execution cache from -maxsigcachesize */
+void InitScriptExecutionCache();
+size_t ScriptExecutionCacheDynamicMemoryUsage();
 void UpdateCoinsWithTransaction(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo& txundo, int nHeight);
 TxReversalStatus UpdateCoinsReversingTransaction(const CTransaction& tx, CCoinsViewCache& inputs, const CTxUndo& txundo, int nHeight);
 bool CheckInputs(
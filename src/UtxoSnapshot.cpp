@@ -0,0 +1,200 @@
+#include <UtxoSnapshot.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <hash.h>
+#include <streams.h>
+#include <txdb.h>
+#include <util.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <boost/filesystem/operations.hpp>
+
+UtxoSnapshotMetadata::UtxoSnapshotMetadata(
+    ): nMagic(SNAPSHOT_MAGIC)
+    , nVersion(CURRENT_VERSION)
+    , hashBaseBlock(0)
+    , nBaseHeight(0)
+    , nMoneySupply(0)
+    , nCoinsCount(0)
+    , hashSerialized(0)
+{
+    memcpy(pchMessageStart, Params().MessageStart(), MESSAGE_START_SIZE);
+}
+
+namespace
+{
+bool ReadMetadata(CAutoFile& file, UtxoSnapshotMetadata& metadata, std::string& strError)
+{
+    try {
+        file >> metadata;
+    } catch (const std::exception& e) {
+        strError = strprintf("unable to read snapshot header: %s", e.what());
+        return false;
+    }
+    if (metadata.nMagic != UtxoSnapshotMetadata::SNAPSHOT_MAGIC) {
+        strError = "not a UTXO snapshot file";
+        return false;
+    }
+    if (metadata.nVersion != UtxoSnapshotMetadata::CURRENT_VERSION) {
+        strError = strprintf("unsupported snapshot version %d", metadata.nVersion);
+        return false;
+    }
+    if (memcmp(metadata.pchMessageStart, Params().MessageStart(), MESSAGE_START_SIZE) != 0) {
+        strError = "snapshot was created for a different network";
+        return false;
+    }
+    return true;
+}
+
+//! Write the snapshot to pathTmp, which the caller renames into place or removes
+bool WriteSnapshotFile(
+    const CCoinsViewDB& coinsDB,
+    const CBlockIndex* pindexBase,
+    const boost::filesystem::path& pathTmp,
+    UtxoSnapshotMetadata& metadata,
+    std::string& strError)
+{
+    CAutoFile file(fopen(pathTmp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        strError = strprintf("unable to create %s", pathTmp.string());
+        return false;
+    }
+
+    // The header is written again once the record count and hash are known.
+    CCoinsStats stats;
+    try {
+        file << metadata;
+        if (!coinsDB.WriteSnapshot(file, stats)) {
+            strError = "unable to read the coin database";
+            return false;
+        }
+        if (stats.hashBlock != pindexBase->GetBlockHash()) {
+            strError = "coin database is not at the requested block";
+            return false;
+        }
+        metadata.hashBaseBlock = stats.hashBlock;
+        metadata.nBaseHeight = pindexBase->nHeight;
+        metadata.nMoneySupply = pindexBase->nMoneySupply;
+        metadata.nCoinsCount = stats.nTransactions;
+        metadata.hashSerialized = stats.hashSerialized;
+        if (fseek(file.Get(), 0, SEEK_SET) != 0) {
+            strError = "unable to rewrite snapshot header";
+            return false;
+        }
+        file << metadata;
+    } catch (const std::exception& e) {
+        strError = strprintf("unable to write snapshot: %s", e.what());
+        return false;
+    }
+    FileCommit(file.Get());
+    return true;
+}
+}
+
+bool IsKnownUtxoSnapshot(const UtxoSnapshotMetadata& metadata)
+{
+    const MapUtxoSnapshots& snapshots = Params().UtxoSnapshots();
+    MapUtxoSnapshots::const_iterator it = snapshots.find(metadata.hashBaseBlock);
+    return it != snapshots.end() &&
+           it->second.hashSerialized == metadata.hashSerialized &&
+           it->second.nMoneySupply == metadata.nMoneySupply;
+}
+
+bool WriteUtxoSnapshot(
+    const CCoinsViewDB& coinsDB,
+    const CBlockIndex* pindexBase,
+    const boost::filesystem::path& path,
+    UtxoSnapshotMetadata& metadata,
+    std::string& strError)
+{
+    const boost::filesystem::path pathTmp = path.string() + ".incomplete";
+    if (!WriteSnapshotFile(coinsDB, pindexBase, pathTmp, metadata, strError)) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(pathTmp, ec);
+        return false;
+    }
+    if (!RenameOver(pathTmp, path)) {
+        strError = strprintf("unable to rename %s to %s", pathTmp.string(), path.string());
+        boost::system::error_code ec;
+        boost::filesystem::remove(pathTmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool VerifyUtxoSnapshot(const boost::filesystem::path& path, UtxoSnapshotMetadata& metadata, std::string& strError)
+{
+    CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        strError = strprintf("unable to open %s", path.string());
+        return false;
+    }
+    if (!ReadMetadata(file, metadata, strError))
+        return false;
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << metadata.hashBaseBlock;
+    CCoinsStats stats;
+    uint256 txhashPrev = 0;
+    try {
+        for (uint64_t i = 0; i < metadata.nCoinsCount; i++) {
+            uint256 txhash;
+            CCoins coins;
+            file >> txhash >> coins;
+            // Records come out of the database in key order; anything else means duplicates or tampering.
+            if (i > 0 && memcmp(txhashPrev.begin(), txhash.begin(), txhash.size()) >= 0) {
+                strError = "snapshot records are not in order";
+                return false;
+            }
+            if (coins.IsPruned()) {
+                strError = strprintf("snapshot contains a spent entry for %s", txhash.GetHex());
+                return false;
+            }
+            UpdateCoinsStats(ss, txhash, coins, stats);
+            txhashPrev = txhash;
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("unable to read snapshot records: %s", e.what());
+        return false;
+    }
+    if (ss.GetHash() != metadata.hashSerialized) {
+        strError = "snapshot contents do not match its hash";
+        return false;
+    }
+    return true;
+}
+
+bool LoadUtxoSnapshot(
+    CCoinsViewDB& coinsDB,
+    const boost::filesystem::path& path,
+    const UtxoSnapshotMetadata& metadata,
+    std::string& strError)
+{
+    CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        strError = strprintf("unable to open %s", path.string());
+        return false;
+    }
+    UtxoSnapshotMetadata header;
+    if (!ReadMetadata(file, header, strError))
+        return false;
+    if (header.hashSerialized != metadata.hashSerialized) {
+        strError = "snapshot file changed after it was verified";
+        return false;
+    }
+    try {
+        if (!coinsDB.LoadSnapshot(file, header.nCoinsCount, header.hashBaseBlock)) {
+            strError = "unable to write the coin database";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("unable to write the coin database: %s", e.what());
+        return false;
+    }
+    return true;
+}
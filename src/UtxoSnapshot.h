@@ -0,0 +1,76 @@
+#ifndef UTXO_SNAPSHOT_H
+#define UTXO_SNAPSHOT_H
+#include <amount.h>
+#include <protocol.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+class CBlockIndex;
+class CCoinsViewDB;
+struct CCoinsStats;
+
+/**
+ * Header of a UTXO snapshot file as written by dumptxoutset.
+ *
+ * The header is followed by nCoinsCount (txid, CCoins) records in txid order.
+ * hashSerialized commits to the base block and all records, and is the same
+ * hash gettxoutsetinfo reports as hash_serialized for the base block. Nothing
+ * in the file commits to nMoneySupply; only a snapshot listed in the chain
+ * parameters vouches for it.
+ */
+class UtxoSnapshotMetadata
+{
+public:
+    static const uint32_t SNAPSHOT_MAGIC = 0x6f787475;
+    static const int CURRENT_VERSION = 1;
+
+    uint32_t nMagic;
+    int nVersion;
+    unsigned char pchMessageStart[MESSAGE_START_SIZE];
+    uint256 hashBaseBlock;
+    int nBaseHeight;
+    CAmount nMoneySupply;
+    uint64_t nCoinsCount;
+    uint256 hashSerialized;
+
+    UtxoSnapshotMetadata();
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersionDummy)
+    {
+        READWRITE(nMagic);
+        READWRITE(nVersion);
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBaseBlock);
+        READWRITE(nBaseHeight);
+        READWRITE(nMoneySupply);
+        READWRITE(nCoinsCount);
+        READWRITE(hashSerialized);
+    }
+};
+
+/** Whether the snapshot is listed in the chain parameters, with the same coins hash and money supply */
+bool IsKnownUtxoSnapshot(const UtxoSnapshotMetadata& metadata);
+/** Write the coin database, which must be at pindexBase, to a snapshot file */
+bool WriteUtxoSnapshot(
+    const CCoinsViewDB& coinsDB,
+    const CBlockIndex* pindexBase,
+    const boost::filesystem::path& path,
+    UtxoSnapshotMetadata& metadata,
+    std::string& strError);
+/** Read the header of a snapshot file and check its records against the committed hash */
+bool VerifyUtxoSnapshot(const boost::filesystem::path& path, UtxoSnapshotMetadata& metadata, std::string& strError);
+/** Replace the contents of the coin database by a verified snapshot */
+bool LoadUtxoSnapshot(
+    CCoinsViewDB& coinsDB,
+    const boost::filesystem::path& path,
+    const UtxoSnapshotMetadata& metadata,
+    std::string& strError);
+#endif// UTXO_SNAPSHOT_H
@@ -0,0 +1,134 @@
+#ifndef VAULT_INDEX_H
+#define VAULT_INDEX_H
+#include <amount.h>
+#include <serialize.h>
+#include <script/script.h>
+#include <uint256.h>
+
+/** The key hashes a staking vault script is indexed under */
+enum class VaultIndexRole : unsigned char
+{
+    OWNER = 1,
+    MANAGER = 2,
+};
+
+/** Vault index entries are sorted by role and key hash, so those of one key are read in one go */
+struct VaultIndexIteratorKey
+{
+    VaultIndexRole role;
+    uint160 keyHash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const
+    {
+        return 21;
+    }
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata8(s, static_cast<unsigned char>(role));
+        keyHash.Serialize(s, nType, nVersion);
+    }
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        role = static_cast<VaultIndexRole>(ser_readdata8(s));
+        keyHash.Unserialize(s, nType, nVersion);
+    }
+
+    VaultIndexIteratorKey(
+        ): role(VaultIndexRole::OWNER)
+        , keyHash()
+    {
+    }
+    VaultIndexIteratorKey(
+        VaultIndexRole roleValue,
+        const uint160& keyHashValue
+        ): role(roleValue)
+        , keyHash(keyHashValue)
+    {
+    }
+};
+
+/** One unspent vault output, under the owner or the manager key hash of its script */
+struct VaultIndexKey
+{
+    VaultIndexRole role;
+    uint160 keyHash;
+    uint256 txhash;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const
+    {
+        return 57;
+    }
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata8(s, static_cast<unsigned char>(role));
+        keyHash.Serialize(s, nType, nVersion);
+        txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, index);
+    }
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        role = static_cast<VaultIndexRole>(ser_readdata8(s));
+        keyHash.Unserialize(s, nType, nVersion);
+        txhash.Unserialize(s, nType, nVersion);
+        index = ser_readdata32(s);
+    }
+
+    VaultIndexKey(
+        ): role(VaultIndexRole::OWNER)
+        , keyHash()
+        , txhash()
+        , index(0)
+    {
+    }
+    VaultIndexKey(
+        VaultIndexRole roleValue,
+        const uint160& keyHashValue,
+        const uint256& txid,
+        unsigned int indexValue
+        ): role(roleValue)
+        , keyHash(keyHashValue)
+        , txhash(txid)
+        , index(indexValue)
+    {
+    }
+};
+
+/** The vault output itself; a null value takes the entry out of the index */
+struct VaultIndexValue
+{
+    CAmount satoshis;
+    CScript script;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(satoshis);
+        READWRITE(script);
+    }
+
+    VaultIndexValue(
+        ): satoshis(-1)
+        , script()
+    {
+    }
+    VaultIndexValue(
+        CAmount amount,
+        const CScript& scriptPubKey
+        ): satoshis(amount)
+        , script(scriptPubKey)
+    {
+    }
+
+    bool IsNull() const
+    {
+        return satoshis == -1;
+    }
+};
+#endif// VAULT_INDEX_H
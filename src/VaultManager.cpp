@@ -1,4 +1,5 @@
 #include <VaultManager.h>
+#include <chain.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
 #include <WalletTx.h>
@@ -14,8 +15,13 @@ VaultManager::VaultManager(
     , cs_vaultManager_()
     , transactionOrderingIndex_(0)
     , walletTxRecord_(new WalletTransactionRecord(cs_vaultManager_))
-    , outputTracker_(new SpentOutputTracker(*walletTxRecord_))
+    , outputTracker_(new SpentOutputTracker(*walletTxRecord_,activeChain_))
     , managedScriptsLimits_()
+    , outputIndexIsStale_(true)
+    , lastSeenTip_(nullptr)
+    , pendingOutputs_()
+    , immatureOutputsByMaturityHeight_()
+    , readyOutputsByScript_()
 {
 }
 
@@ -28,20 +34,16 @@ VaultManager::VaultManager(
 {
     LOCK(cs_vaultManager_);
     vaultManagerDB.ReadManagedScripts(managedScriptsLimits_);
-    bool continueLoadingTransactions = true;
-    while(continueLoadingTransactions)
+    const CWalletTx emptyTransaction(CMerkleTx{CMutableTransaction(), activeChain_,blockIndicesByHash_});
+    std::vector<CWalletTx> loadedTransactions;
+    unsigned transactionsRead = 0u;
+    do
     {
-        CWalletTx txToAdd(CMerkleTx{CMutableTransaction(), activeChain_,blockIndicesByHash_});
-        if(vaultManagerDB.ReadTx(transactionOrderingIndex_,txToAdd))
-        {
-            outputTracker_->UpdateSpends(txToAdd,transactionOrderingIndex_,true);
-            ++transactionOrderingIndex_;
-        }
-        else
-        {
-            continueLoadingTransactions = false;
-        }
-    }
+        transactionsRead = vaultManagerDB.ReadTxs(transactionOrderingIndex_,LOAD_BATCH_SIZE,emptyTransaction,loadedTransactions);
+        transactionOrderingIndex_ += transactionsRead;
+    } while(transactionsRead > 0u);
+    // The spends are indexed once everything is in, not per transaction
+    outputTracker_->AddLoadedTransactions(loadedTransactions);
 }
 
 VaultManager::~VaultManager()
@@ -60,8 +62,21 @@ void VaultManager::SyncTransaction(const CTransaction& tx, const CBlock *pblock)
         {
             CMerkleTx merkleTx(tx,activeChain_,blockIndicesByHash_);
             if(pblock) merkleTx.SetMerkleBranch(*pblock);
-            outputTracker_->UpdateSpends(merkleTx,transactionOrderingIndex_,false);
+            std::pair<CWalletTx*,bool> addedTx = outputTracker_->UpdateSpends(merkleTx,transactionOrderingIndex_,false);
             ++transactionOrderingIndex_;
+            if(addedTx.second && !outputIndexIsStale_)
+            {
+                // Ready outputs this spends are checked again
+                for(const CTxIn& input: tx.vin)
+                {
+                    const CWalletTx* spentTx = walletTxRecord_->GetWalletTx(input.prevout.hash);
+                    if(!spentTx || input.prevout.n >= spentTx->vout.size()) continue;
+                    auto readyOutputs = readyOutputsByScript_.find(spentTx->vout[input.prevout.n].scriptPubKey);
+                    if(readyOutputs != readyOutputsByScript_.end() && readyOutputs->second.erase(input.prevout) > 0)
+                        pendingOutputs_.insert(input.prevout);
+                }
+                AddPendingOutputs(*addedTx.first);
+            }
             break;
         }
     }
@@ -71,28 +86,84 @@ void VaultManager::addManagedScript(const CScript& script, unsigned limit)
 {
     LOCK(cs_vaultManager_);
     managedScriptsLimits_.insert({script, limit});
+    outputIndexIsStale_ = true;
 }
 
-UnspentOutputs VaultManager::getUTXOs() const
+void VaultManager::AddPendingOutputs(const CWalletTx& tx) const
 {
-    LOCK(cs_vaultManager_);
-    UnspentOutputs outputs;
-    auto managedScriptsLimitsCopy = managedScriptsLimits_;
+    const uint256 hash = tx.GetHash();
+    for(unsigned outputIndex = 0; outputIndex < tx.vout.size(); ++outputIndex)
+    {
+        if(managedScriptsLimits_.count(tx.vout[outputIndex].scriptPubKey))
+            pendingOutputs_.insert(COutPoint{hash,outputIndex});
+    }
+}
+
+void VaultManager::RebuildOutputIndex() const
+{
+    pendingOutputs_.clear();
+    immatureOutputsByMaturityHeight_.clear();
+    readyOutputsByScript_.clear();
     for(const auto& hashAndTransaction: walletTxRecord_->mapWallet)
     {
-        uint256 hash = hashAndTransaction.first;
-        const CWalletTx& tx = hashAndTransaction.second;
-        if(tx.GetNumberOfBlockConfirmations()<1) continue;
-        if((tx.IsCoinBase() || tx.IsCoinStake()) && tx.GetBlocksToMaturity() > 0) continue;
-        for(unsigned outputIndex = 0; outputIndex < tx.vout.size(); ++outputIndex)
+        AddPendingOutputs(hashAndTransaction.second);
+    }
+    outputIndexIsStale_ = false;
+}
+
+void VaultManager::UpdateOutputIndex() const
+{
+    const CBlockIndex* tip = activeChain_.Tip();
+    if(outputIndexIsStale_ || (lastSeenTip_ && !activeChain_.Contains(lastSeenTip_)))
+        RebuildOutputIndex();
+    lastSeenTip_ = tip;
+    const int tipHeight = activeChain_.Height();
+
+    while(!immatureOutputsByMaturityHeight_.empty() && immatureOutputsByMaturityHeight_.begin()->first <= tipHeight)
+    {
+        pendingOutputs_.insert(immatureOutputsByMaturityHeight_.begin()->second);
+        immatureOutputsByMaturityHeight_.erase(immatureOutputsByMaturityHeight_.begin());
+    }
+
+    for(auto it = pendingOutputs_.begin(); it != pendingOutputs_.end(); )
+    {
+        const COutPoint outpoint = *it;
+        const CWalletTx* tx = walletTxRecord_->GetWalletTx(outpoint.hash);
+        if(tx->GetNumberOfBlockConfirmations()<1)
+        {
+            ++it;
+            continue;
+        }
+        if(!outputTracker_->IsSpentInBlock(outpoint.hash,outpoint.n))
         {
-            const CTxOut& output = tx.vout[outputIndex];
-            auto it = managedScriptsLimitsCopy.find(output.scriptPubKey);
-            if(it != managedScriptsLimitsCopy.end() && it->second > 0u && !outputTracker_->IsSpent(hash,outputIndex))
+            // A spend not yet in a block can still drop out of the mempool
+            if(outputTracker_->IsSpent(outpoint.hash,outpoint.n))
             {
-                outputs.insert(COutPoint{hash,outputIndex});
-                --(it->second);
+                ++it;
+                continue;
             }
+            if((tx->IsCoinBase() || tx->IsCoinStake()) && tx->GetBlocksToMaturity() > 0)
+                immatureOutputsByMaturityHeight_.insert(std::make_pair(tipHeight + tx->GetBlocksToMaturity(), outpoint));
+            else
+                readyOutputsByScript_[tx->vout[outpoint.n].scriptPubKey].insert(outpoint);
+        }
+        it = pendingOutputs_.erase(it);
+    }
+}
+
+UnspentOutputs VaultManager::getUTXOs() const
+{
+    LOCK(cs_vaultManager_);
+    UpdateOutputIndex();
+    UnspentOutputs outputs;
+    for(const auto& scriptAndLimit: managedScriptsLimits_)
+    {
+        auto readyOutputs = readyOutputsByScript_.find(scriptAndLimit.first);
+        if(readyOutputs == readyOutputsByScript_.end()) continue;
+        unsigned remaining = scriptAndLimit.second;
+        for(auto it = readyOutputs->second.begin(); it != readyOutputs->second.end() && remaining > 0u; ++it, --remaining)
+        {
+            outputs.insert(*it);
         }
     }
     return outputs;
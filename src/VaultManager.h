@@ -21,6 +21,19 @@ class WalletTransactionRecord;
 class SpentOutputTracker;
 class CChain;
 class BlockMap;
+class CBlockIndex;
+
+/**
+ * Keeps the transactions paying to the managed vault scripts and hands out
+ * their unspent outputs, up to each script's limit.
+ *
+ * The outputs are sorted as they are seen: pending ones are checked again
+ * on every call, immature ones wait for the height at which they mature,
+ * and ready ones are kept by script in the order they are handed out.
+ * Outputs spent in a block are dropped. If the tip seen last leaves the
+ * active chain, or a managed script is added, everything is sorted again
+ * from the transactions.
+ */
 class VaultManager
 {
 private:
@@ -31,6 +44,18 @@ private:
     std::unique_ptr<WalletTransactionRecord> walletTxRecord_;
     std::unique_ptr<SpentOutputTracker> outputTracker_;
     ManagedScripts managedScriptsLimits_;
+    mutable bool outputIndexIsStale_;
+    mutable const CBlockIndex* lastSeenTip_;
+    mutable UnspentOutputs pendingOutputs_;
+    mutable std::multimap<int, COutPoint> immatureOutputsByMaturityHeight_;
+    mutable std::map<CScript, UnspentOutputs> readyOutputsByScript_;
+
+    //! Transactions asked of the database at a time while loading
+    static const unsigned LOAD_BATCH_SIZE = 1000;
+
+    void AddPendingOutputs(const CWalletTx& tx) const;
+    void RebuildOutputIndex() const;
+    void UpdateOutputIndex() const;
 public:
     VaultManager(
         const CChain& activeChain,
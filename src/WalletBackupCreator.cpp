@@ -53,6 +53,21 @@ bool WalletBackupCreator::BackupFile(PathType& sourceFile, PathType& backupFile)
     return false;
 }
 
+bool WalletBackupCreator::NewestBackupIsCurrent(const PathType& sourceFile, const PathType& backupDir)
+{
+    const TimeStampedFolderContents folderContents = fileSystem_.get_timestamped_folder_contents(backupDir);
+    if(folderContents.empty()){
+        return false;
+    }
+    std::time_t newestBackupTime = folderContents.front().first;
+    for(const TimeStampedFolderContents::value_type& file: folderContents)
+    {
+        newestBackupTime = std::max(newestBackupTime, file.first);
+    }
+    // Times are whole seconds, a backup made the same second as a change may not hold it
+    return newestBackupTime > fileSystem_.last_write_time(sourceFile);
+}
+
 bool WalletBackupCreator::BackupWalletFile(std::string strWalletFile, PathType backupDir)
 {
     // Create backup of the wallet
@@ -66,6 +81,10 @@ bool WalletBackupCreator::BackupWalletFile(std::string strWalletFile, PathType b
     sourceFile = make_preferred(sourceFile);
     backupFile = make_preferred(backupFile);
     if (fileSystem_.exists(sourceFile)) {
+        if (NewestBackupIsCurrent(sourceFile,backupDir)) {
+            LogPrintf("%s has not changed since its last backup in %s\n", sourceFile, backupDir);
+            return true;
+        }
         return BackupFile(sourceFile,backupFile);
     }
     return false;
@@ -14,6 +14,8 @@ private:
     std::string walletFilename_;
     std::string backupSubfolderDirectory_;
     bool BackupFile(PathType& sourceFile, PathType& backupFile);
+    //! Whether a backup was made after the wallet file last changed, so another copy would be the same
+    bool NewestBackupIsCurrent(const PathType& sourceFile, const PathType& backupDir);
     bool BackupWalletFile(std::string strWalletFile, PathType backupDir);
     void PruneOldBackups(std::string strWalletFile, PathType backupDir);
 
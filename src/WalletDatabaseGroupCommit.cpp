@@ -0,0 +1,35 @@
+#include <WalletDatabaseGroupCommit.h>
+
+#include <db.h>
+#include <Logging.h>
+#include <walletdb.h>
+
+WalletDatabaseGroupCommit::WalletDatabaseGroupCommit(
+    Settings& settings,
+    const std::string& walletFilename
+    ): settings_(settings)
+    , walletFilename_(walletFilename)
+    , holdsBackWrites_(!walletFilename_.empty() && CDB::bitdb.BeginGroupCommit(walletFilename_))
+{
+}
+
+WalletDatabaseGroupCommit::~WalletDatabaseGroupCommit()
+{
+    if (holdsBackWrites_ && !Commit())
+        LogPrintf("%s : failed to write the held back writes to %s\n", __func__, walletFilename_);
+}
+
+bool WalletDatabaseGroupCommit::Commit()
+{
+    if (!holdsBackWrites_)
+        return true;
+    holdsBackWrites_ = false;
+    CDB::bitdb.EndGroupCommit(walletFilename_);
+    try {
+        CWalletDB walletdb(settings_, walletFilename_);
+        return walletdb.WriteBufferedWrites();
+    } catch (const std::exception& e) {
+        LogPrintf("%s : unable to open %s to write the held back writes: %s\n", __func__, walletFilename_, e.what());
+        return false;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef WALLET_DATABASE_GROUP_COMMIT_H
+#define WALLET_DATABASE_GROUP_COMMIT_H
+#include <string>
+
+class Settings;
+
+/**
+ * Holds back the writes this thread makes to a wallet file, through any
+ * CWalletDB, while it lasts, to write them out in one transaction. Writing a
+ * key more than once in between only writes it once. Other threads keep
+ * writing straight to the file meanwhile.
+ *
+ * Reads through CWalletDB see the writes held back, cursors do not. Writes
+ * are also written out early once MAX_GROUP_COMMIT_WRITES are held back, or
+ * when a CWalletDB begins a transaction of its own.
+ *
+ * Writes made in a group commit report success before they reach disk, so
+ * anything relying on them being stored, such as handing out keys or
+ * relaying a transaction, has to check what Commit returns first.
+ */
+class WalletDatabaseGroupCommit
+{
+private:
+    Settings& settings_;
+    const std::string walletFilename_;
+    bool holdsBackWrites_;
+
+    WalletDatabaseGroupCommit(const WalletDatabaseGroupCommit&);
+    void operator=(const WalletDatabaseGroupCommit&);
+
+public:
+    WalletDatabaseGroupCommit(Settings& settings, const std::string& walletFilename);
+    //! Writes out what is still held back, logging a failure, when Commit was not called
+    ~WalletDatabaseGroupCommit();
+
+    //! Ends the group commit and writes out everything held back on the file so far, even within an enclosing one; false if that failed
+    bool Commit();
+};
+#endif// WALLET_DATABASE_GROUP_COMMIT_H
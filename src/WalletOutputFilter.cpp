@@ -0,0 +1,62 @@
+#include <WalletOutputFilter.h>
+
+#include <script/standard.h>
+
+#include <vector>
+
+WalletOutputFilter::WalletOutputFilter(
+    ): keyIds_()
+    , scriptIds_()
+    , scripts_()
+    , blockFilterQuery_()
+{
+}
+
+void WalletOutputFilter::AddKey(const CKeyID& keyId)
+{
+    if (keyIds_.insert(keyId).second)
+        blockFilterQuery_.push_back(GetScriptForDestination(keyId));
+}
+
+void WalletOutputFilter::AddScriptHash(const CScriptID& scriptId)
+{
+    if (scriptIds_.insert(scriptId).second)
+        blockFilterQuery_.push_back(GetScriptForDestination(scriptId));
+}
+
+void WalletOutputFilter::AddScript(const CScript& script)
+{
+    if (scripts_.insert(script).second)
+        blockFilterQuery_.push_back(script);
+}
+
+bool WalletOutputFilter::MayBeMine(const CScript& scriptPubKey) const
+{
+    if (scripts_.count(scriptPubKey))
+        return true;
+
+    std::vector<std::vector<unsigned char> > vSolutions;
+    txnouttype whichType;
+    if (!ExtractScriptPubKeyFormat(scriptPubKey, whichType, vSolutions))
+        return false;
+
+    switch (whichType) {
+    case TX_PUBKEY:
+        return keyIds_.count(CPubKey(vSolutions[0]).GetID()) > 0;
+    case TX_PUBKEYHASH:
+        return keyIds_.count(CKeyID(uint160(vSolutions[0]))) > 0;
+    case TX_SCRIPTHASH:
+        return scriptIds_.count(CScriptID(uint160(vSolutions[0]))) > 0;
+    case TX_VAULT:
+        return keyIds_.count(CKeyID(uint160(vSolutions[0]))) > 0 ||
+               keyIds_.count(CKeyID(uint160(vSolutions[1]))) > 0;
+    case TX_MULTISIG:
+        for (size_t index = 1; index + 1 < vSolutions.size(); index++) {
+            if (keyIds_.count(CPubKey(vSolutions[index]).GetID()))
+                return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
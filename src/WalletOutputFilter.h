@@ -0,0 +1,39 @@
+#ifndef WALLET_OUTPUT_FILTER_H
+#define WALLET_OUTPUT_FILTER_H
+#include <pubkey.h>
+#include <destination.h>
+#include <script/script.h>
+
+#include <set>
+#include <vector>
+
+/**
+ * A copy of the keys, redeem scripts and watched scripts of a wallet, to tell
+ * apart outputs that cannot be the wallet's from those that may be, without
+ * touching the wallet or its locks.
+ *
+ * An output may be the wallet's when its script is watched or one of the
+ * keys or the script hash it pays to is known, so the filter lets through
+ * every output IsMine accepts, and a few more, such as multisig outputs of
+ * which only some keys are known. Those still need checking with IsMine.
+ */
+class WalletOutputFilter
+{
+private:
+    std::set<CKeyID> keyIds_;
+    std::set<CScriptID> scriptIds_;
+    std::set<CScript> scripts_;
+    std::vector<CScript> blockFilterQuery_;
+
+public:
+    WalletOutputFilter();
+
+    void AddKey(const CKeyID& keyId);
+    void AddScriptHash(const CScriptID& scriptId);
+    void AddScript(const CScript& script);
+
+    bool MayBeMine(const CScript& scriptPubKey) const;
+
+    const std::vector<CScript>& GetBlockFilterQuery() const { return blockFilterQuery_; }
+};
+#endif// WALLET_OUTPUT_FILTER_H
@@ -0,0 +1,77 @@
+#include <WalletTransactionOrderIndex.h>
+
+#include <WalletTx.h>
+
+WalletTransactionOrderIndex::WalletTransactionOrderIndex(
+    ): itemsByOrderPosition_()
+    , transactionItems_()
+    , accountingEntries_()
+    , transactionsByHeight_()
+    , transactionHeights_()
+{
+}
+
+void WalletTransactionOrderIndex::Clear()
+{
+    itemsByOrderPosition_.clear();
+    transactionItems_.clear();
+    accountingEntries_.clear();
+    transactionsByHeight_.clear();
+    transactionHeights_.clear();
+}
+
+void WalletTransactionOrderIndex::UpdateTransaction(CWalletTx& wtx, int confirmationHeight)
+{
+    std::map<const CWalletTx*, TxItems::iterator>::iterator item = transactionItems_.find(&wtx);
+    if (item == transactionItems_.end())
+    {
+        transactionItems_[&wtx] = itemsByOrderPosition_.insert(
+            std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
+    }
+    else if (item->second->first != wtx.nOrderPos)
+    {
+        itemsByOrderPosition_.erase(item->second);
+        item->second = itemsByOrderPosition_.insert(
+            std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
+    }
+
+    std::map<const CWalletTx*, TransactionsByHeight::iterator>::iterator height = transactionHeights_.find(&wtx);
+    if (height == transactionHeights_.end())
+    {
+        transactionHeights_[&wtx] = transactionsByHeight_.insert(std::make_pair(confirmationHeight, &wtx));
+    }
+    else if (height->second->first != confirmationHeight)
+    {
+        transactionsByHeight_.erase(height->second);
+        height->second = transactionsByHeight_.insert(std::make_pair(confirmationHeight, &wtx));
+    }
+}
+
+void WalletTransactionOrderIndex::AddAccountingEntry(const CAccountingEntry& entry)
+{
+    accountingEntries_.push_back(entry);
+    CAccountingEntry* const indexedEntry = &accountingEntries_.back();
+    itemsByOrderPosition_.insert(std::make_pair(indexedEntry->nOrderPos, TxPair((CWalletTx*)0, indexedEntry)));
+}
+
+const WalletTransactionOrderIndex::TxItems& WalletTransactionOrderIndex::GetOrderedItems() const
+{
+    return itemsByOrderPosition_;
+}
+
+std::vector<CWalletTx*> WalletTransactionOrderIndex::GetTransactionsAboveHeight(int height) const
+{
+    std::vector<CWalletTx*> transactions;
+    for (TransactionsByHeight::const_iterator it = transactionsByHeight_.upper_bound(height);
+         it != transactionsByHeight_.end();
+         ++it)
+    {
+        transactions.push_back(it->second);
+    }
+    return transactions;
+}
+
+size_t WalletTransactionOrderIndex::NumberOfTransactions() const
+{
+    return transactionItems_.size();
+}
@@ -0,0 +1,55 @@
+#ifndef WALLET_TRANSACTION_ORDER_INDEX_H
+#define WALLET_TRANSACTION_ORDER_INDEX_H
+#include <wallet.h>
+
+#include <stdint.h>
+#include <limits>
+#include <list>
+#include <map>
+#include <vector>
+
+class CWalletTx;
+
+/**
+ * The wallet's activity log kept in order as transactions are added and
+ * updated, so listing the newest entries or the transactions since a block
+ * does not sort the whole wallet on every call.
+ *
+ * Wallet transactions are kept by their order position together with copies
+ * of the accounting entries, and also by the height of the block of the
+ * active chain that confirms them. The positions and heights are only as
+ * current as the last update of each transaction, so every change to a
+ * transaction's order position or confirming block has to be passed on.
+ * Access must hold cs_wallet.
+ */
+class WalletTransactionOrderIndex
+{
+public:
+    typedef CWallet::TxPair TxPair;
+    typedef CWallet::TxItems TxItems;
+    //! Recorded for transactions that are not in a block of the active chain
+    static constexpr int UNCONFIRMED_HEIGHT = std::numeric_limits<int>::max();
+
+private:
+    typedef std::multimap<int, CWalletTx*> TransactionsByHeight;
+
+    TxItems itemsByOrderPosition_;
+    std::map<const CWalletTx*, TxItems::iterator> transactionItems_;
+    std::list<CAccountingEntry> accountingEntries_;
+    TransactionsByHeight transactionsByHeight_;
+    std::map<const CWalletTx*, TransactionsByHeight::iterator> transactionHeights_;
+
+public:
+    WalletTransactionOrderIndex();
+
+    void Clear();
+    //! Adds the transaction, or moves it to its current order position and the given height
+    void UpdateTransaction(CWalletTx& wtx, int confirmationHeight);
+    void AddAccountingEntry(const CAccountingEntry& entry);
+
+    const TxItems& GetOrderedItems() const;
+    //! The transactions recorded above the given height, the unconfirmed ones included
+    std::vector<CWalletTx*> GetTransactionsAboveHeight(int height) const;
+    size_t NumberOfTransactions() const;
+};
+#endif// WALLET_TRANSACTION_ORDER_INDEX_H
@@ -1,5 +1,7 @@
 #include <WalletTransactionRecord.h>
 
+#include <memusage.h>
+#include <TransactionMemoryUsage.h>
 #include <walletdb.h>
 #include <Settings.h>
 extern Settings& settings;
@@ -59,6 +61,28 @@ std::vector<const CWalletTx*> WalletTransactionRecord::GetWalletTransactionRefer
     return transactions;
 }
 
+static size_t StringMemoryUsage(const std::string& str)
+{
+    // Short strings are kept inside the string itself
+    return str.capacity() > 15 ? memusage::MallocUsage(str.capacity() + 1) : 0;
+}
+
+size_t WalletTransactionRecord::DynamicMemoryUsage() const
+{
+    AssertLockHeld(cs_walletTxRecord);
+    size_t usage = memusage::DynamicUsage(mapWallet) + memusage::DynamicUsage(mapBareTxid);
+    for (const std::pair<const uint256, CWalletTx>& entry : mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        usage += TransactionMemoryUsage(wtx) + memusage::DynamicUsage(wtx.vMerkleBranch) +
+                 memusage::DynamicUsage(wtx.mapValue) + memusage::DynamicUsage(wtx.vOrderForm) + StringMemoryUsage(wtx.strFromAccount);
+        for (const std::pair<const std::string, std::string>& value : wtx.mapValue)
+            usage += StringMemoryUsage(value.first) + StringMemoryUsage(value.second);
+        for (const std::pair<std::string, std::string>& form : wtx.vOrderForm)
+            usage += StringMemoryUsage(form.first) + StringMemoryUsage(form.second);
+    }
+    return usage;
+}
+
 std::pair<std::map<uint256, CWalletTx>::iterator, bool> WalletTransactionRecord::AddTransaction(const CWalletTx& newlyAddedTransaction)
 {
     AssertLockHeld(cs_walletTxRecord);
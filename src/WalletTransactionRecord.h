@@ -1,9 +1,12 @@
 #ifndef WALLET_TRANSACTION_RECORD_H
 #define WALLET_TRANSACTION_RECORD_H
+#include <SaltedHasher.h>
 #include <sync.h>
 #include <uint256.h>
 #include <WalletTx.h>
 #include <map>
+
+#include <boost/unordered_map.hpp>
 struct WalletTransactionRecord
 {
 private:
@@ -13,7 +16,7 @@ private:
 
     /** Map from the bare txid of transactions in the wallet to the matching
      *  transactions themselves.  */
-    std::map<uint256, const CWalletTx*> mapBareTxid;
+    boost::unordered_map<uint256, const CWalletTx*, SaltedUint256Hasher> mapBareTxid;
 
 public:
     std::map<uint256, CWalletTx> mapWallet;
@@ -25,6 +28,7 @@ public:
     /** Tries to look up a transaction in the wallet, either by hash (txid) or
      *  the bare txid that is used after segwit-light to identify outputs.  */
     std::vector<const CWalletTx*> GetWalletTransactionReferences() const;
+    size_t DynamicMemoryUsage() const;
     std::pair<std::map<uint256, CWalletTx>::iterator, bool> AddTransaction(const CWalletTx& newlyAddedTransaction);
     void UpdateMetadata(const uint256& hashOfTransactionToUpdate, const CWalletTx& updatedTransaction, bool updateDiskAndTimestamp,bool writeToWalletDb=false);
 };
@@ -34,19 +34,22 @@ public:
     unsigned int nTimeReceived; //! time received by this node
     unsigned int nTimeSmart;
     char createdByMe;
+
+    // memory only, packed into the padding after createdByMe
+    mutable bool fDebitCached : 1;
+    mutable bool fCreditCached : 1;
+    mutable bool fImmatureCreditCached : 1;
+    mutable bool fAvailableCreditCached : 1;
+    mutable bool fWatchDebitCached : 1;
+    mutable bool fWatchCreditCached : 1;
+    mutable bool fImmatureWatchCreditCached : 1;
+    mutable bool fAvailableWatchCreditCached : 1;
+    mutable bool fChangeCached : 1;
+
     std::string strFromAccount;
     int64_t nOrderPos; //! position in ordered transaction list
 
     // memory only
-    mutable bool fDebitCached;
-    mutable bool fCreditCached;
-    mutable bool fImmatureCreditCached;
-    mutable bool fAvailableCreditCached;
-    mutable bool fWatchDebitCached;
-    mutable bool fWatchCreditCached;
-    mutable bool fImmatureWatchCreditCached;
-    mutable bool fAvailableWatchCreditCached;
-    mutable bool fChangeCached;
     mutable CAmount nDebitCached;
     mutable CAmount nCreditCached;
     mutable CAmount nImmatureCreditCached;
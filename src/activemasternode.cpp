@@ -22,6 +22,8 @@ CActiveMasternode::CActiveMasternode(
     , fMasterNode_(masterNodeEnabled)
     , addressHasBeenSet_(false)
     , masternodeKey_()
+    , masternodeKeyID_()
+    , pingVinMessage_()
     , pubKeyMasternode()
     , vin()
     , service()
@@ -47,6 +49,7 @@ bool CActiveMasternode::SetMasternodeKey(const std::string& privKeyString)
         errorMessage = strprintf("Error upon calling SetKey: %s\n", errorMessage);
         return false;
     }
+    masternodeKeyID_ = pubKeyMasternode.GetID();
     return true;
 }
 
@@ -56,7 +59,7 @@ void CActiveMasternode::ManageStatus(CMasternodeMan& masternodeManager)
 
     if (!fMasterNode_) return;
 
-    LogPrint("masternode","CActiveMasternode::ManageStatus() - Begin\n");
+    LogPrint(LOG_MASTERNODE,"CActiveMasternode::ManageStatus() - Begin\n");
 
     //need correct blocks to send ping
     if (!IsBlockchainSynced()) {
@@ -151,9 +154,9 @@ bool CActiveMasternode::SendMasternodePing(CMasternodeMan& masternodeManager, st
     LogPrintf("CActiveMasternode::SendMasternodePing() - Relay Masternode Ping vin = %s\n", vin);
 
     CMasternodePing mnp = createCurrentPing(vin);
-    if(!CObfuScationSigner::SignAndVerify<CMasternodePing>(mnp,masternodeKey_,pubKeyMasternode,errorMessage))
+    if(!SignPing(mnp,errorMessage))
     {
-        LogPrint("masternode","%s - %s",__func__,errorMessage);
+        LogPrint(LOG_MASTERNODE,"%s - %s",__func__,errorMessage);
         return false;
     }
 
@@ -181,6 +184,17 @@ bool CActiveMasternode::SendMasternodePing(CMasternodeMan& masternodeManager, st
     }
 }
 
+bool CActiveMasternode::SignPing(CMasternodePing& mnp, std::string& errorMessage) const
+{
+    const std::string strMessage = (!pingVinMessage_.empty() && mnp.vin == vin)
+        ? mnp.getMessageToSign(pingVinMessage_)
+        : mnp.getMessageToSign();
+    if (!CObfuScationSigner::SignMessage(strMessage, errorMessage, mnp.signature, masternodeKey_)) {
+        return false;
+    }
+    return CObfuScationSigner::VerifyMessage(masternodeKeyID_, mnp.signature, strMessage, errorMessage);
+}
+
 // when starting a Masternode, this can enable to run as a hot wallet with no funds
 bool CActiveMasternode::IsThisMasternodeCollateral(const CTxIn& newVin) const
 {
@@ -219,6 +233,7 @@ bool CActiveMasternode::EnableHotColdMasterNode(CTxIn& newVin, CService& newServ
     status = ACTIVE_MASTERNODE_STARTED;
     vin = newVin;
     service = newService;
+    pingVinMessage_ = vin.ToString();
 
     LogPrintf("CActiveMasternode::EnableHotColdMasterNode() - Enabled! You may shut down the cold daemon.\n");
 
@@ -230,7 +245,7 @@ bool CActiveMasternode::SignMasternodeWinner(CMasternodePaymentWinner& winner) c
 
     if(!CObfuScationSigner::SignAndVerify<CMasternodePaymentWinner>(winner,masternodeKey_,pubKeyMasternode,errorMessage))
     {
-        LogPrint("masternode", "%s - Error: %s\n", __func__, errorMessage);
+        LogPrint(LOG_MASTERNODE, "%s - Error: %s\n", __func__, errorMessage);
     }
     return true;
 }
@@ -246,7 +261,7 @@ bool CActiveMasternode::UpdatePing(CMasternodePing& mnp) const
 {
     CMasternodePing updatedPing = createCurrentPing(mnp.vin);
     std::string errorMessage = "";
-    if(CObfuScationSigner::SignAndVerify<CMasternodePing>(updatedPing,masternodeKey_,pubKeyMasternode,errorMessage))
+    if(SignPing(updatedPing,errorMessage))
     {
         CMasternodePing().swap(mnp,updatedPing);
         return true;
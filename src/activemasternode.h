@@ -30,6 +30,7 @@ class CActiveMasternode
 private:
     bool SendMasternodePing(CMasternodeMan& masternodeManager,std::string& errorMessage);
     bool IsThisMasternodeCollateral(const CTxIn& newVin) const;
+    bool SignPing(CMasternodePing& mnp, std::string& errorMessage) const;
 private:
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -37,6 +38,9 @@ private:
     const bool& fMasterNode_;
     bool addressHasBeenSet_;
     CKey masternodeKey_;
+    CKeyID masternodeKeyID_;
+    // The part of the ping message from our vin, kept from when the masternode starts as it never changes
+    std::string pingVinMessage_;
 public:
     // Initialized by init.cpp
     // Keys for the main Masternode
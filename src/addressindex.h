@@ -11,6 +11,8 @@
 #include <serialize.h>
 #include <script/script.h>
 #include <chain.h>
+
+#include <map>
 struct CMempoolAddressDelta
 {
     int64_t time;
@@ -178,6 +180,62 @@ struct CAddressIndexIteratorKey {
     }
 };
 
+struct CAddressIndexIteratorKeyCompare
+{
+    bool operator()(const CAddressIndexIteratorKey& a, const CAddressIndexIteratorKey& b) const {
+        if (a.type == b.type) {
+            return a.hashBytes < b.hashBytes;
+        } else {
+            return a.type < b.type;
+        }
+    }
+};
+
+/** Totals over an address' index entries, kept up to date next to them */
+struct CAddressBalance {
+    CAmount balance;
+    CAmount received;
+    int64_t txCount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txCount);
+    }
+
+    CAddressBalance() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+    }
+
+    bool IsNull() const {
+        return balance == 0 && received == 0 && txCount == 0;
+    }
+
+    //! Account for one index entry, or take it back again with nSign -1
+    void AddEntry(CAmount amount, int nSign) {
+        balance += nSign * amount;
+        if (amount > 0)
+            received += nSign * amount;
+    }
+
+    void Add(const CAddressBalance& other) {
+        balance += other.balance;
+        received += other.received;
+        txCount += other.txCount;
+    }
+};
+
+typedef std::map<CAddressIndexIteratorKey, CAddressBalance, CAddressIndexIteratorKeyCompare> CAddressBalanceDeltas;
+
 struct CAddressIndexIteratorHeightKey {
     unsigned int type;
     uint160 hashBytes;
@@ -222,7 +222,7 @@ void CAddrMan::Good_(const CService& addr, int64_t nTime)
         return;
 
     // find a bucket it is in now
-    int nRnd = GetRandInt(ADDRMAN_NEW_BUCKET_COUNT);
+    int nRnd = insecure_rand(ADDRMAN_NEW_BUCKET_COUNT);
     int nUBucket = -1;
     for (unsigned int n = 0; n < ADDRMAN_NEW_BUCKET_COUNT; n++) {
         int nB = (n + nRnd) % ADDRMAN_NEW_BUCKET_COUNT;
@@ -238,7 +238,7 @@ void CAddrMan::Good_(const CService& addr, int64_t nTime)
     if (nUBucket == -1)
         return;
 
-    LogPrint("addrman", "Moving %s to tried\n", addr);
+    LogPrint(LOG_ADDRMAN, "Moving %s to tried\n", addr);
 
     // move nId to the tried tables
     MakeTried(info, nId);
@@ -279,7 +279,7 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         int nFactor = 1;
         for (int n = 0; n < pinfo->nRefCount; n++)
             nFactor *= 2;
-        if (nFactor > 1 && (GetRandInt(nFactor) != 0))
+        if (nFactor > 1 && (insecure_rand(nFactor) != 0))
             return false;
     } else {
         pinfo = Create(addr, source, &nId);
@@ -337,18 +337,21 @@ CAddress CAddrMan::Select_()
         return CAddress();
 
     // Use a 50% chance for choosing between tried and new table entries.
-    if (nTried > 0 && (nNew == 0 || GetRandInt(2) == 0)) {
+    // Entries are found by walking a random bucket from a random position, so
+    // a sparse table costs a scan per empty bucket rather than a random draw
+    // per empty position.
+    if (nTried > 0 && (nNew == 0 || insecure_rand(2) == 0)) {
         // use a tried node
         double fChanceFactor = 1.0;
         while (1) {
-            int nKBucket = GetRandInt(ADDRMAN_TRIED_BUCKET_COUNT);
-            int nKBucketPos = GetRandInt(ADDRMAN_BUCKET_SIZE);
-            if (vvTried[nKBucket][nKBucketPos] == -1)
+            int nKBucket = insecure_rand(ADDRMAN_TRIED_BUCKET_COUNT);
+            int nKBucketPos = FirstUsedPosition(vvTried[nKBucket], insecure_rand(ADDRMAN_BUCKET_SIZE));
+            if (nKBucketPos == -1)
                 continue;
             int nId = vvTried[nKBucket][nKBucketPos];
             assert(mapInfo.count(nId) == 1);
             CAddrInfo& info = mapInfo[nId];
-            if (GetRandInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
+            if (insecure_rand(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
                 return info;
             fChanceFactor *= 1.2;
         }
@@ -356,20 +359,30 @@ CAddress CAddrMan::Select_()
         // use a new node
         double fChanceFactor = 1.0;
         while (1) {
-            int nUBucket = GetRandInt(ADDRMAN_NEW_BUCKET_COUNT);
-            int nUBucketPos = GetRandInt(ADDRMAN_BUCKET_SIZE);
-            if (vvNew[nUBucket][nUBucketPos] == -1)
+            int nUBucket = insecure_rand(ADDRMAN_NEW_BUCKET_COUNT);
+            int nUBucketPos = FirstUsedPosition(vvNew[nUBucket], insecure_rand(ADDRMAN_BUCKET_SIZE));
+            if (nUBucketPos == -1)
                 continue;
             int nId = vvNew[nUBucket][nUBucketPos];
             assert(mapInfo.count(nId) == 1);
             CAddrInfo& info = mapInfo[nId];
-            if (GetRandInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
+            if (insecure_rand(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
                 return info;
             fChanceFactor *= 1.2;
         }
     }
 }
 
+int CAddrMan::FirstUsedPosition(const int (&bucket)[ADDRMAN_BUCKET_SIZE], int nPos)
+{
+    for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+        const int nBucketPos = (nPos + i) % ADDRMAN_BUCKET_SIZE;
+        if (bucket[nBucketPos] != -1)
+            return nBucketPos;
+    }
+    return -1;
+}
+
 #ifdef DEBUG_ADDRMAN
 int CAddrMan::Check_()
 {
@@ -459,7 +472,7 @@ void CAddrMan::GetAddr_(std::vector<CAddress>& vAddr)
         if (vAddr.size() >= nNodes)
             break;
 
-        int nRndPos = GetRandInt(vRandom.size() - n) + n;
+        int nRndPos = insecure_rand(vRandom.size() - n) + n;
         SwapRandom(n, nRndPos);
         assert(mapInfo.count(vRandom[n]) == 1);
 
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_ADDRMAN_H
 #define BITCOIN_ADDRMAN_H
 
+#include "memusage.h"
 #include "netbase.h"
 #include "protocol.h"
 #include "random.h"
@@ -198,6 +199,9 @@ private:
     //! list of "new" buckets
     int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
 
+    //! randomness for picking entries, which need not be unpredictable and is drawn under cs
+    FastRandomContext insecure_rand;
+
 protected:
     //! Find an entry.
     CAddrInfo* Find(const CNetAddr& addr, int* pnId = NULL);
@@ -231,6 +235,9 @@ protected:
     //! nUnkBias determines how much to favor new addresses over tried ones (min=0, max=100)
     CAddress Select_();
 
+    //! The first used position of a bucket from nPos on, wrapping around, or -1 if the bucket is empty.
+    static int FirstUsedPosition(const int (&bucket)[ADDRMAN_BUCKET_SIZE], int nPos);
+
 #ifdef DEBUG_ADDRMAN
     //! Perform consistency check. Returns an error code or zero.
     int Check_();
@@ -414,7 +421,7 @@ public:
             }
         }
         if (nLost + nLostUnk > 0) {
-            LogPrint("addrman", "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
+            LogPrint(LOG_ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
         }
 
         Check();
@@ -461,6 +468,13 @@ public:
         return vRandom.size();
     }
 
+    //! Bytes of memory the address tables take up, with the fixed size buckets
+    size_t DynamicMemoryUsage() const
+    {
+        LOCK(cs);
+        return sizeof(CAddrMan) + memusage::DynamicUsage(mapInfo) + memusage::DynamicUsage(mapAddr) + memusage::DynamicUsage(vRandom);
+    }
+
     //! Consistency check
     void Check()
     {
@@ -485,7 +499,7 @@ public:
             Check();
         }
         if (fRet)
-            LogPrint("addrman", "Added %s from %s: %i tried, %i new\n", addr.ToStringIPPort(), source, nTried, nNew);
+            LogPrint(LOG_ADDRMAN, "Added %s from %s: %i tried, %i new\n", addr.ToStringIPPort(), source, nTried, nNew);
         return fRet;
     }
 
@@ -501,7 +515,7 @@ public:
             Check();
         }
         if (nAdd)
-            LogPrint("addrman", "Added %i addresses from %s: %i tried, %i new\n", nAdd, source, nTried, nNew);
+            LogPrint(LOG_ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source, nTried, nNew);
         return nAdd > 0;
     }
 
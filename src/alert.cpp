@@ -198,11 +198,11 @@ bool CAlert::ProcessAlert(const Settings& settings, bool fThread)
         for (std::map<uint256, CAlert>::iterator mi = mapAlerts.begin(); mi != mapAlerts.end();) {
             const CAlert& alert = (*mi).second;
             if (Cancels(alert)) {
-                LogPrint("alert", "cancelling alert %d\n", alert.nID);
+                LogPrint(LOG_ALERT, "cancelling alert %d\n", alert.nID);
                 uiInterface.NotifyAlertChanged((*mi).first, CT_DELETED);
                 mapAlerts.erase(mi++);
             } else if (!alert.IsInEffect()) {
-                LogPrint("alert", "expiring alert %d\n", alert.nID);
+                LogPrint(LOG_ALERT, "expiring alert %d\n", alert.nID);
                 uiInterface.NotifyAlertChanged((*mi).first, CT_DELETED);
                 mapAlerts.erase(mi++);
             } else
@@ -214,7 +214,7 @@ bool CAlert::ProcessAlert(const Settings& settings, bool fThread)
         {
             const CAlert& alert = item.second;
             if (alert.Cancels(*this)) {
-                LogPrint("alert", "alert already cancelled by %d\n", alert.nID);
+                LogPrint(LOG_ALERT, "alert already cancelled by %d\n", alert.nID);
                 return false;
             }
         }
@@ -228,7 +228,7 @@ bool CAlert::ProcessAlert(const Settings& settings, bool fThread)
         }
     }
 
-    LogPrint("alert", "accepted alert %d, AppliesToMe()=%d\n", nID, AppliesToMe());
+    LogPrint(LOG_ALERT, "accepted alert %d, AppliesToMe()=%d\n", nID, AppliesToMe());
     return true;
 }
 
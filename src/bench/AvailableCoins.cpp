@@ -0,0 +1,40 @@
+#include <bench/bench.h>
+
+#include <Output.h>
+#include <script/standard.h>
+#include <sync.h>
+#include <test/FakeBlockIndexChain.h>
+#include <test/FakeWallet.h>
+#include <WalletTx.h>
+
+#include <cassert>
+#include <vector>
+
+namespace
+{
+constexpr unsigned NUMBER_OF_WALLET_COINS = 1000;
+}
+
+/** Listing the spendable coins of a wallet with many confirmed transactions, as coin selection and staking do */
+static void AvailableCoinsOfLargeWallet(benchmark::State& state)
+{
+    FakeBlockIndexWithHashes fakeChain(1, 1600000000, 1);
+    FakeWallet wallet(fakeChain);
+    {
+        LOCK(wallet.cs_wallet);
+        const CScript walletScript = GetScriptForDestination(wallet.vchDefaultKey.GetID());
+        for (unsigned i = 0; i < NUMBER_OF_WALLET_COINS; ++i) {
+            unsigned outputIndex = 0;
+            wallet.FakeAddToChain(wallet.AddDefaultTx(walletScript, outputIndex, 100 * COIN));
+        }
+        wallet.AddBlock();
+    }
+
+    std::vector<COutput> coins;
+    while (state.KeepRunning()) {
+        wallet.AvailableCoins(coins);
+        assert(coins.size() == NUMBER_OF_WALLET_COINS);
+    }
+}
+
+BENCHMARK(AvailableCoinsOfLargeWallet);
@@ -0,0 +1,69 @@
+#include <bench/bench.h>
+#include <bench/SyntheticBlocks.h>
+
+#include <blockmap.h>
+#include <BlockRewards.h>
+#include <BlockTransactionChecker.h>
+#include <chain.h>
+#include <coins.h>
+#include <IndexDatabaseUpdates.h>
+#include <main.h>
+#include <test/FakeBlockIndexChain.h>
+#include <ValidationState.h>
+
+#include <cassert>
+
+extern BlockMap mapBlockIndex;
+
+namespace
+{
+constexpr unsigned TRANSACTIONS_PER_BLOCK = 200;
+}
+
+static void CheckBlockOfSignedSpends(benchmark::State& state)
+{
+    const SyntheticCoins coins(TRANSACTIONS_PER_BLOCK);
+    CBlock block = CreateBlockSpending(coins, TRANSACTIONS_PER_BLOCK);
+    SolveBlock(block);
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        const bool fValid = CheckBlock(block, validationState, true);
+        assert(fValid);
+    }
+}
+
+/** The work ConnectBlock does per transaction: input, script and sigop checks, and
+ *  updating the coins, on top of a synthetic chain. The subsidy and payee checks
+ *  around it need a real chain and masternode list, and are left out. */
+static void ConnectBlockOfSignedSpends(benchmark::State& state)
+{
+    FakeBlockIndexWithHashes fakeChain(100, 1600000000, CBlockHeader::CURRENT_VERSION);
+    const CBlockIndex* const previousTip = fakeChain.activeChain->Tip();
+    // CheckInputs takes the height the inputs are spent at from the block index
+    mapBlockIndex.insert(std::make_pair(previousTip->GetBlockHash(), const_cast<CBlockIndex*>(previousTip)));
+
+    CCoinsView emptyView;
+    CCoinsViewCache coinsTip(&emptyView);
+    const SyntheticCoins coins(TRANSACTIONS_PER_BLOCK);
+    coins.AddTo(coinsTip, previousTip->nHeight);
+    coinsTip.SetBestBlock(previousTip->GetBlockHash());
+
+    CBlock block = CreateBlockSpending(coins, TRANSACTIONS_PER_BLOCK);
+    fakeChain.addSingleBlock(block);
+    CBlockIndex* const pindex = fakeChain.activeChain->Tip();
+    const CBlockRewards nExpectedMint(0, 0, 0, 0, 0, 0);
+
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&coinsTip);
+        CValidationState validationState;
+        IndexDatabaseUpdates indexDatabaseUpdates;
+        BlockTransactionChecker blockTxChecker(block, validationState, pindex, view, true);
+        const bool fConnected = blockTxChecker.Check(nExpectedMint, false, indexDatabaseUpdates) &&
+                                blockTxChecker.WaitForScriptsToBeChecked();
+        assert(fConnected);
+    }
+    mapBlockIndex.erase(previousTip->GetBlockHash());
+}
+
+BENCHMARK(CheckBlockOfSignedSpends);
+BENCHMARK(ConnectBlockOfSignedSpends);
@@ -0,0 +1,76 @@
+#include <bench/bench.h>
+#include <bench/SyntheticBlocks.h>
+
+#include <blockmap.h>
+#include <chain.h>
+#include <coins.h>
+#include <script/standard.h>
+#include <test/FakeBlockIndexChain.h>
+#include <UtxoCheckingAndUpdating.h>
+#include <ValidationState.h>
+
+#include <cassert>
+#include <vector>
+
+extern BlockMap mapBlockIndex;
+
+namespace
+{
+constexpr unsigned NUMBER_OF_SPENDS = 100;
+
+/** Signed spends of coins confirmed at the tip of a synthetic chain, as the mempool and blocks check them */
+struct CheckInputsSetup {
+    FakeBlockIndexWithHashes fakeChain;
+    CCoinsView emptyView;
+    CCoinsViewCache view;
+    SyntheticCoins coins;
+    std::vector<CTransaction> spends;
+
+    CheckInputsSetup(
+        ): fakeChain(100, 1600000000, CBlockHeader::CURRENT_VERSION)
+        , emptyView()
+        , view(&emptyView)
+        , coins(NUMBER_OF_SPENDS)
+        , spends()
+    {
+        CBlockIndex* const tip = fakeChain.activeChain->Tip();
+        // CheckInputs takes the height the inputs are spent at from the block index
+        mapBlockIndex.insert(std::make_pair(tip->GetBlockHash(), tip));
+        coins.AddTo(view, tip->nHeight);
+        view.SetBestBlock(tip->GetBlockHash());
+        for (unsigned outputIndex = 0; outputIndex < NUMBER_OF_SPENDS; ++outputIndex)
+            spends.push_back(coins.CreateSignedSpend(outputIndex));
+    }
+    ~CheckInputsSetup()
+    {
+        mapBlockIndex.erase(fakeChain.activeChain->Tip()->GetBlockHash());
+    }
+
+    void CheckAll(bool fScriptChecks) const
+    {
+        for (const CTransaction& tx : spends) {
+            CValidationState validationState;
+            // Not storing in the caches, so every pass verifies the signatures again
+            const bool fValid = CheckInputs(tx, validationState, view, fScriptChecks, STANDARD_SCRIPT_VERIFY_FLAGS, false);
+            assert(fValid);
+        }
+    }
+};
+}
+
+static void CheckInputsWithScripts(benchmark::State& state)
+{
+    const CheckInputsSetup setup;
+    while (state.KeepRunning())
+        setup.CheckAll(true);
+}
+
+static void CheckInputsWithoutScripts(benchmark::State& state)
+{
+    const CheckInputsSetup setup;
+    while (state.KeepRunning())
+        setup.CheckAll(false);
+}
+
+BENCHMARK(CheckInputsWithScripts);
+BENCHMARK(CheckInputsWithoutScripts);
@@ -0,0 +1,79 @@
+#include <bench/bench.h>
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+
+#include <cassert>
+#include <vector>
+
+namespace
+{
+constexpr unsigned COINS_IN_VIEW = 10000;
+constexpr unsigned COINS_PER_BLOCK = 100;
+
+std::vector<CTransaction> CreateDistinctTransactions(unsigned numberOfTransactions, uint32_t firstLockTime)
+{
+    std::vector<CTransaction> transactions;
+    transactions.reserve(numberOfTransactions);
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256S("4f5e1dcf6b28438ecb4f92c37f72bc430055fc91651f3dbc22050eb93164c579"), 0);
+    tx.vout.resize(2, CTxOut(COIN, CScript() << OP_TRUE));
+    for (unsigned i = 0; i < numberOfTransactions; ++i) {
+        // The lock time only tells the transactions apart
+        tx.nLockTime = firstLockTime + i;
+        transactions.push_back(tx);
+    }
+    return transactions;
+}
+
+void AddTransactions(CCoinsViewCache& view, const std::vector<CTransaction>& transactions, int nHeight)
+{
+    for (const CTransaction& tx : transactions)
+        view.ModifyCoins(tx.GetHash())->FromTx(tx, nHeight);
+}
+}
+
+static void CoinsViewCacheAccessCoins(benchmark::State& state)
+{
+    CCoinsView emptyView;
+    CCoinsViewCache view(&emptyView);
+    const std::vector<CTransaction> transactions = CreateDistinctTransactions(COINS_IN_VIEW, 0);
+    AddTransactions(view, transactions, 1);
+
+    unsigned index = 0;
+    while (state.KeepRunning()) {
+        const CCoins* coins = view.AccessCoins(transactions[index].GetHash());
+        assert(coins);
+        index = (index + 1) % transactions.size();
+    }
+}
+
+/** A block's worth of coin updates: fetching the coins spent from the view below,
+ *  adding the new ones and flushing them all down, as connecting a block does */
+static void CoinsViewCacheSpendAddAndFlush(benchmark::State& state)
+{
+    CCoinsView emptyView;
+    CCoinsViewCache coinsTip(&emptyView);
+    const std::vector<CTransaction> spentTransactions = CreateDistinctTransactions(COINS_IN_VIEW, 0);
+    AddTransactions(coinsTip, spentTransactions, 1);
+    const std::vector<CTransaction> newTransactions = CreateDistinctTransactions(COINS_PER_BLOCK, COINS_IN_VIEW);
+
+    unsigned nextSpent = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache parent(&coinsTip);
+        CCoinsViewCache view(&parent);
+        for (unsigned i = 0; i < COINS_PER_BLOCK; ++i) {
+            const bool fSpent = view.ModifyCoins(spentTransactions[nextSpent].GetHash())->Spend(0);
+            assert(fSpent);
+            nextSpent = (nextSpent + 1) % spentTransactions.size();
+        }
+        AddTransactions(view, newTransactions, 2);
+        const bool fFlushed = view.Flush();
+        assert(fFlushed);
+    }
+}
+
+BENCHMARK(CoinsViewCacheAccessCoins);
+BENCHMARK(CoinsViewCacheSpendAddAndFlush);
@@ -0,0 +1,44 @@
+#include <bench/bench.h>
+
+#include <crypto/sha256.h>
+#include <hash.h>
+#include <primitives/block.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <vector>
+
+static void SHA256_1MB(benchmark::State& state)
+{
+    uint8_t hash[CSHA256::OUTPUT_SIZE];
+    const std::vector<uint8_t> data(1024 * 1024, 0);
+    while (state.KeepRunning())
+        CSHA256().Write(data.data(), data.size()).Finalize(hash);
+}
+
+static void SHA256_64Bytes(benchmark::State& state)
+{
+    uint8_t hash[CSHA256::OUTPUT_SIZE];
+    std::vector<uint8_t> data(64, 0);
+    while (state.KeepRunning()) {
+        CSHA256().Write(data.data(), data.size()).Finalize(hash);
+        data[0] = hash[0];
+    }
+}
+
+static void HashQuarkBlockHeader(benchmark::State& state)
+{
+    CBlockHeader header;
+    header.nVersion = 3;
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0fffff;
+    while (state.KeepRunning()) {
+        ++header.nNonce;
+        const uint256 hash = HashQuark(BEGIN(header.nVersion), END(header.nNonce));
+        header.hashPrevBlock = hash;
+    }
+}
+
+BENCHMARK(SHA256_1MB);
+BENCHMARK(SHA256_64Bytes);
+BENCHMARK(HashQuarkBlockHeader);
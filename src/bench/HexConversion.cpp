@@ -0,0 +1,50 @@
+#include <bench/bench.h>
+
+#include <SaltedHasher.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <string>
+
+namespace
+{
+const uint256 SAMPLE_HASH = uint256("0x000000000000038b2a1ce6b2a41e66e7c09f0e079765bd29fd9980c06a50cd7f");
+}
+
+/** Formatting a hash, as RPCs listing transactions and blocks do for every one of them */
+static void Uint256GetHex(benchmark::State& state)
+{
+    uint256 hash = SAMPLE_HASH;
+    while (state.KeepRunning()) {
+        const std::string hex = hash.GetHex();
+        assert(hex.size() == 64);
+        ++hash;
+    }
+}
+
+/** Parsing a hash, as RPCs do for every txid and block hash they are given */
+static void Uint256SetHex(benchmark::State& state)
+{
+    const std::string hex = SAMPLE_HASH.GetHex();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        hash.SetHex(hex);
+        assert(hash == SAMPLE_HASH);
+    }
+}
+
+static void SaltedUint256Hash(benchmark::State& state)
+{
+    const SaltedUint256Hasher hasher;
+    uint256 hash = SAMPLE_HASH;
+    size_t combined = 0;
+    while (state.KeepRunning()) {
+        combined ^= hasher(hash);
+        ++hash;
+    }
+    assert(combined != 1);
+}
+
+BENCHMARK(Uint256GetHex);
+BENCHMARK(Uint256SetHex);
+BENCHMARK(SaltedUint256Hash);
@@ -0,0 +1,87 @@
+#include <bench/bench.h>
+
+#include <chain.h>
+#include <I_SuperblockHeightValidator.h>
+#include <LotteryWinnersCalculator.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <spork.h>
+#include <test/FakeBlockIndexChain.h>
+
+#include <vector>
+
+namespace
+{
+constexpr int LOTTERY_START_BLOCK = 100;
+constexpr int LOTTERY_CYCLE_LENGTH = 100;
+//! Past the forks that changed how the winners are picked
+constexpr unsigned CHAIN_START_TIME = 1609459200;
+
+class FixedCycleSuperblockHeightValidator: public I_SuperblockHeightValidator
+{
+public:
+    int GetTreasuryBlockPaymentCycle(int nBlockHeight) const
+    {
+        return LOTTERY_CYCLE_LENGTH;
+    }
+    int GetLotteryBlockPaymentCycle(int nBlockHeight) const
+    {
+        return LOTTERY_CYCLE_LENGTH;
+    }
+    bool IsValidLotteryBlockHeight(int nBlockHeight) const
+    {
+        return nBlockHeight >= LOTTERY_START_BLOCK && (nBlockHeight - LOTTERY_START_BLOCK) % LOTTERY_CYCLE_LENGTH == 0;
+    }
+    bool IsValidTreasuryBlockHeight(int nBlockHeight) const
+    {
+        return IsValidLotteryBlockHeight(nBlockHeight);
+    }
+};
+
+CTransaction CreateCoinstake(unsigned index)
+{
+    CScript paymentScript = CScript() << OP_TRUE;
+    for (unsigned i = 0; i < index; ++i)
+        paymentScript << OP_FALSE;
+
+    CMutableTransaction tx;
+    tx.nLockTime = index;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256S("4f5e1dcf6b28438ecb4f92c37f72bc430055fc91651f3dbc22050eb93164c579"), 42);
+    tx.vout.resize(2);
+    tx.vout[0] = CTxOut(0, CScript());
+    tx.vout[1] = CTxOut(20000 * COIN, paymentScript);
+    return tx;
+}
+}
+
+/** Updating the lottery winners with the coinstake of a new block, once the
+ *  cycle already has a full set of winners to rank the new one against */
+static void LotteryWinnersUpdateWithFullCycle(benchmark::State& state)
+{
+    FakeBlockIndexWithHashes fakeChain(LOTTERY_START_BLOCK + 64, CHAIN_START_TIME, CBlockHeader::CURRENT_VERSION);
+    const CSporkManager sporkManager;
+    const FixedCycleSuperblockHeightValidator heightValidator;
+    const LotteryWinnersCalculator calculator(LOTTERY_START_BLOCK, *fakeChain.activeChain, sporkManager, heightValidator);
+
+    std::vector<CTransaction> coinstakes;
+    for (unsigned index = 0; index < 64; ++index)
+        coinstakes.push_back(CreateCoinstake(index));
+
+    const CChain& chain = *fakeChain.activeChain;
+    const int nLastHeight = LOTTERY_START_BLOCK + 32;
+    for (int nHeight = 1; nHeight <= nLastHeight; ++nHeight) {
+        CBlockIndex* const pindex = chain[nHeight];
+        pindex->vLotteryWinnersCoinstakes = calculator.CalculateUpdatedLotteryWinners(
+            coinstakes[nHeight % coinstakes.size()], pindex->pprev->vLotteryWinnersCoinstakes, nHeight);
+    }
+
+    const LotteryCoinstakeData& previousData = chain[nLastHeight]->vLotteryWinnersCoinstakes;
+    unsigned index = 0;
+    while (state.KeepRunning()) {
+        const LotteryCoinstakeData updated = calculator.CalculateUpdatedLotteryWinners(coinstakes[index], previousData, nLastHeight + 1);
+        index = (index + 1) % coinstakes.size();
+    }
+}
+
+BENCHMARK(LotteryWinnersUpdateWithFullCycle);
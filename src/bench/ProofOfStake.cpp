@@ -0,0 +1,71 @@
+#include <bench/bench.h>
+
+#include <amount.h>
+#include <I_PoSStakeModifierService.h>
+#include <ProofOfStakeGenerator.h>
+#include <StakingData.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <utility>
+
+namespace
+{
+class FixedStakeModifierService: public I_PoSStakeModifierService
+{
+private:
+    const uint64_t stakeModifier_;
+
+public:
+    explicit FixedStakeModifierService(uint64_t stakeModifier): stakeModifier_(stakeModifier)
+    {
+    }
+    std::pair<uint64_t, bool> getStakeModifier(const StakingData& stakingData) const
+    {
+        return std::make_pair(stakeModifier_, true);
+    }
+};
+
+//! The stake of mainnet block 10000, with the stake modifier and timestamp it was found with
+StakingData MainnetBlock10kStakingData()
+{
+    return StakingData(
+        unsigned(470026099),
+        unsigned(1538645320),
+        uint256S("967b03e3c1daf39633ed73ffb29abfcab9ae5b384dc5b95dabee0890bf8b4546"),
+        COutPoint(uint256S("4266403b499375917920311b1af704805d3fa2d6d6f4e3217026618028423607"), 1),
+        CAmount(62542750000000),
+        uint256S("acf49c06030a7a76059a25b174dc7adcdc5f4ad36c91b564c585743af4829f7a"));
+}
+constexpr uint64_t MAINNET_BLOCK_10K_STAKE_MODIFIER = 13260253192;
+constexpr unsigned MAINNET_BLOCK_10K_TIMESTAMP = 1538663336;
+}
+
+static void ProofOfStakeHashproofFound(benchmark::State& state)
+{
+    const FixedStakeModifierService stakeModifierService(MAINNET_BLOCK_10K_STAKE_MODIFIER);
+    const ProofOfStakeGenerator generator(stakeModifierService, 0);
+    const StakingData stakingData = MainnetBlock10kStakingData();
+    while (state.KeepRunning()) {
+        const bool fFound = generator.CreateHashproofTimestamp(stakingData, MAINNET_BLOCK_10K_TIMESTAMP).succeeded();
+        assert(fFound);
+    }
+}
+
+/** What a staking wallet does for most of its coins most of the time: trying
+ *  every timestamp of the hash drift without finding a hashproof */
+static void ProofOfStakeHashproofSearchExhausted(benchmark::State& state)
+{
+    const FixedStakeModifierService stakeModifierService(MAINNET_BLOCK_10K_STAKE_MODIFIER);
+    const ProofOfStakeGenerator generator(stakeModifierService, 0);
+    StakingData stakingData = MainnetBlock10kStakingData();
+    // A target no hash meets
+    stakingData.nBits_ = 0x03000001;
+    while (state.KeepRunning()) {
+        const bool fFound = generator.CreateHashproofTimestamp(stakingData, MAINNET_BLOCK_10K_TIMESTAMP).succeeded();
+        assert(!fFound);
+    }
+}
+
+BENCHMARK(ProofOfStakeHashproofFound);
+BENCHMARK(ProofOfStakeHashproofSearchExhausted);
@@ -0,0 +1,64 @@
+#include <bench/bench.h>
+#include <bench/SyntheticBlocks.h>
+
+#include <primitives/block.h>
+#include <serialize.h>
+#include <streams.h>
+#include <version.h>
+
+#include <cassert>
+
+namespace
+{
+constexpr unsigned TRANSACTIONS_PER_BLOCK = 200;
+
+CDataStream SerializedBlock()
+{
+    const SyntheticCoins coins(TRANSACTIONS_PER_BLOCK);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CreateBlockSpending(coins, TRANSACTIONS_PER_BLOCK);
+    return stream;
+}
+}
+
+static void SerializeBlock(benchmark::State& state)
+{
+    const CDataStream serialized = SerializedBlock();
+    CBlock block;
+    CDataStream(serialized) >> block;
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream.reserve(serialized.size());
+        stream << block;
+        assert(stream.size() == serialized.size());
+    }
+}
+
+/** Reading a block out of a stream, which hashes every transaction by serializing it once more */
+static void DeserializeBlock(benchmark::State& state)
+{
+    const CDataStream serialized = SerializedBlock();
+    while (state.KeepRunning()) {
+        CDataStream stream(serialized);
+        CBlock block;
+        stream >> block;
+        assert(block.vtx.size() == TRANSACTIONS_PER_BLOCK + 1);
+    }
+}
+
+/** Reading a block where it lies in the stream, as the block and tx messages are, which hashes
+ *  every transaction from the bytes it was read from */
+static void DeserializeBlockInPlace(benchmark::State& state)
+{
+    const CDataStream serialized = SerializedBlock();
+    while (state.KeepRunning()) {
+        CDataStream stream(serialized);
+        CBlock block;
+        UnserializeInPlace(stream, block);
+        assert(block.vtx.size() == TRANSACTIONS_PER_BLOCK + 1);
+    }
+}
+
+BENCHMARK(SerializeBlock);
+BENCHMARK(DeserializeBlock);
+BENCHMARK(DeserializeBlockInPlace);
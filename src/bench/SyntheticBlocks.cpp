@@ -0,0 +1,77 @@
+#include <bench/SyntheticBlocks.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <key.h>
+#include <pow.h>
+#include <script/sign.h>
+#include <script/standard.h>
+
+#include <cassert>
+
+constexpr CAmount SyntheticCoins::OUTPUT_VALUE;
+
+SyntheticCoins::SyntheticCoins(
+    unsigned numberOfOutputs
+    ): keystore_()
+    , fundingTransaction_()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    keystore_.AddKey(key);
+
+    CMutableTransaction funding;
+    funding.vin.resize(1);
+    funding.vin[0].prevout = COutPoint(uint256S("4f5e1dcf6b28438ecb4f92c37f72bc430055fc91651f3dbc22050eb93164c579"), 0);
+    funding.vout.resize(numberOfOutputs, CTxOut(OUTPUT_VALUE, GetScriptForDestination(key.GetPubKey().GetID())));
+    fundingTransaction_ = funding;
+}
+
+const CTransaction& SyntheticCoins::fundingTransaction() const
+{
+    return fundingTransaction_;
+}
+
+void SyntheticCoins::AddTo(CCoinsViewCache& view, int nHeight) const
+{
+    view.ModifyCoins(fundingTransaction_.GetHash())->FromTx(fundingTransaction_, nHeight);
+}
+
+CTransaction SyntheticCoins::CreateSignedSpend(unsigned outputIndex) const
+{
+    assert(outputIndex < fundingTransaction_.vout.size());
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(fundingTransaction_.GetHash(), outputIndex);
+    const CScript& scriptPubKey = fundingTransaction_.vout[outputIndex].scriptPubKey;
+    // Leave a fee, as ordinary spends do
+    spend.vout.resize(2, CTxOut(OUTPUT_VALUE / 2 - 1000, scriptPubKey));
+    const bool fSigned = SignSignature(keystore_, fundingTransaction_, spend, 0);
+    assert(fSigned);
+    return spend;
+}
+
+CBlock CreateBlockSpending(const SyntheticCoins& coins, unsigned numberOfTransactions)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vout.resize(1, CTxOut(0, CScript() << OP_TRUE));
+
+    CBlock block;
+    block.nVersion = CBlockHeader::CURRENT_VERSION;
+    block.nTime = 1600000000;
+    block.nBits = Params().ProofOfWorkLimit().GetCompact();
+    block.vtx.push_back(coinbase);
+    for (unsigned outputIndex = 0; outputIndex < numberOfTransactions; ++outputIndex)
+        block.vtx.push_back(coins.CreateSignedSpend(outputIndex));
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+void SolveBlock(CBlock& block)
+{
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params()))
+        ++block.nNonce;
+}
@@ -0,0 +1,33 @@
+#ifndef BENCH_SYNTHETIC_BLOCKS_H
+#define BENCH_SYNTHETIC_BLOCKS_H
+#include <keystore.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+
+class CCoinsViewCache;
+
+/** Outputs of one transaction, all paying to a key of our own, for the transactions of the benchmarks to spend */
+class SyntheticCoins
+{
+private:
+    CBasicKeyStore keystore_;
+    CTransaction fundingTransaction_;
+
+public:
+    static constexpr CAmount OUTPUT_VALUE = 10 * COIN;
+
+    explicit SyntheticCoins(unsigned numberOfOutputs);
+
+    const CTransaction& fundingTransaction() const;
+    //! Makes the outputs spendable from the view, as if confirmed at the given height
+    void AddTo(CCoinsViewCache& view, int nHeight) const;
+    //! A signed transaction spending one of the outputs into two
+    CTransaction CreateSignedSpend(unsigned outputIndex) const;
+};
+
+/** A proof-of-work block, of a coinbase followed by one signed spend of each of the coins */
+CBlock CreateBlockSpending(const SyntheticCoins& coins, unsigned numberOfTransactions);
+//! Grinds the nonce until the block meets the proof-of-work limit of the chain in use
+void SolveBlock(CBlock& block);
+#endif// BENCH_SYNTHETIC_BLOCKS_H
@@ -0,0 +1,208 @@
+#include <bench/bench.h>
+
+#include <json/json_spirit_reader_template.h>
+#include <json/json_spirit_utils.h>
+#include <json/json_spirit_writer_template.h>
+#include <tinyformat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+using namespace json_spirit;
+
+namespace benchmark
+{
+namespace
+{
+//! The sample below which a fraction of all samples lie, by nearest rank
+double Percentile(const std::vector<double>& sortedSamples, double fraction)
+{
+    const size_t rank = static_cast<size_t>(std::ceil(fraction * sortedSamples.size()));
+    return sortedSamples[std::max<size_t>(rank, 1) - 1];
+}
+}
+
+Options::Options(
+    ): filter()
+    , nWarmupIterations(10)
+    , nSamples(20)
+    , nMinSampleMicros(10000)
+{
+}
+
+Result::Result(
+    ): name()
+    , nIterationsPerSample(0)
+    , samples()
+    , min(0)
+    , median(0)
+    , p90(0)
+    , p99(0)
+    , max(0)
+    , mean(0)
+{
+}
+
+void Result::Summarize()
+{
+    if (samples.empty())
+        return;
+    std::vector<double> sortedSamples(samples);
+    std::sort(sortedSamples.begin(), sortedSamples.end());
+    const size_t nMiddle = sortedSamples.size() / 2;
+    min = sortedSamples.front();
+    median = sortedSamples.size() % 2 == 0 ? (sortedSamples[nMiddle - 1] + sortedSamples[nMiddle]) / 2 : sortedSamples[nMiddle];
+    p90 = Percentile(sortedSamples, 0.90);
+    p99 = Percentile(sortedSamples, 0.99);
+    max = sortedSamples.back();
+    mean = std::accumulate(sortedSamples.begin(), sortedSamples.end(), 0.0) / sortedSamples.size();
+}
+
+State::State(
+    const Options& options,
+    Result& result
+    ): options_(options)
+    , result_(result)
+    , phase_(NOT_STARTED)
+    , nIterationsLeft_(0)
+    , batchStart_()
+{
+}
+
+bool State::NextBatch()
+{
+    const Clock::time_point now = Clock::now();
+    const double elapsedNanos = std::chrono::duration<double, std::nano>(now - batchStart_).count();
+    switch (phase_) {
+    case NOT_STARTED:
+        phase_ = WARMING_UP;
+        nIterationsLeft_ = std::max<uint64_t>(options_.nWarmupIterations, 1) - 1;
+        break;
+    case WARMING_UP: {
+        // Enough operations for a sample to stay well above the resolution of the clock
+        const uint64_t nWarmupIterations = std::max<uint64_t>(options_.nWarmupIterations, 1);
+        const double nanosPerIteration = std::max(elapsedNanos / nWarmupIterations, 1.0);
+        result_.nIterationsPerSample = std::max<uint64_t>(1, std::ceil(options_.nMinSampleMicros * 1000.0 / nanosPerIteration));
+        result_.samples.reserve(options_.nSamples);
+        phase_ = SAMPLING;
+        nIterationsLeft_ = result_.nIterationsPerSample - 1;
+        break;
+    }
+    case SAMPLING:
+        result_.samples.push_back(elapsedNanos / result_.nIterationsPerSample);
+        if (result_.samples.size() >= std::max<uint64_t>(options_.nSamples, 1)) {
+            phase_ = FINISHED;
+            return false;
+        }
+        nIterationsLeft_ = result_.nIterationsPerSample - 1;
+        break;
+    case FINISHED:
+        return false;
+    }
+    // Read the clock last, so the bookkeeping above is not timed
+    batchStart_ = Clock::now();
+    return true;
+}
+
+BenchRunner::BenchmarkMap& BenchRunner::benchmarks()
+{
+    static BenchmarkMap benchmarksMap;
+    return benchmarksMap;
+}
+
+BenchRunner::BenchRunner(const std::string& name, BenchFunction func)
+{
+    benchmarks().insert(std::make_pair(name, func));
+}
+
+std::vector<std::string> BenchRunner::ListBenchmarks()
+{
+    std::vector<std::string> names;
+    for (BenchmarkMap::const_iterator it = benchmarks().begin(); it != benchmarks().end(); ++it)
+        names.push_back(it->first);
+    return names;
+}
+
+std::vector<Result> BenchRunner::RunAll(const Options& options)
+{
+    std::vector<Result> results;
+    std::cout << strprintf("%-40s %10s %12s %12s %12s %12s %12s\n", "# Benchmark", "ops/sample", "min(ns)", "median(ns)", "p90(ns)", "p99(ns)", "max(ns)");
+    for (BenchmarkMap::const_iterator it = benchmarks().begin(); it != benchmarks().end(); ++it) {
+        if (it->first.find(options.filter) == std::string::npos)
+            continue;
+        Result result;
+        result.name = it->first;
+        State state(options, result);
+        it->second(state);
+        result.Summarize();
+        std::cout << strprintf("%-40s %10u %12.0f %12.0f %12.0f %12.0f %12.0f\n", result.name, result.nIterationsPerSample,
+            result.min, result.median, result.p90, result.p99, result.max);
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::string ResultsToJSON(const std::vector<Result>& results, const Options& options)
+{
+    Array benchmarks;
+    for (const Result& result : results) {
+        Object nanosPerOperation;
+        nanosPerOperation.push_back(Pair("min", result.min));
+        nanosPerOperation.push_back(Pair("median", result.median));
+        nanosPerOperation.push_back(Pair("p90", result.p90));
+        nanosPerOperation.push_back(Pair("p99", result.p99));
+        nanosPerOperation.push_back(Pair("max", result.max));
+        nanosPerOperation.push_back(Pair("mean", result.mean));
+
+        Array samples;
+        for (double sample : result.samples)
+            samples.push_back(sample);
+
+        Object benchmark;
+        benchmark.push_back(Pair("name", result.name));
+        benchmark.push_back(Pair("iterations_per_sample", result.nIterationsPerSample));
+        benchmark.push_back(Pair("ns_per_op", nanosPerOperation));
+        benchmark.push_back(Pair("samples", samples));
+        benchmarks.push_back(benchmark);
+    }
+
+    Object document;
+    document.push_back(Pair("warmup_iterations", options.nWarmupIterations));
+    document.push_back(Pair("samples", options.nSamples));
+    document.push_back(Pair("min_sample_micros", options.nMinSampleMicros));
+    document.push_back(Pair("benchmarks", benchmarks));
+    return write_string(Value(document), true);
+}
+
+std::vector<std::string> FindRegressions(const std::vector<Result>& results, const std::string& baselineJSON, double maxSlowdownPercent)
+{
+    std::vector<std::string> regressions;
+    std::map<std::string, double> baselineMedians;
+    try {
+        Value baseline;
+        if (!read_string(baselineJSON, baseline))
+            throw std::runtime_error("not valid JSON");
+        for (const Value& benchmark : find_value(baseline.get_obj(), "benchmarks").get_array()) {
+            const Object& entry = benchmark.get_obj();
+            baselineMedians[find_value(entry, "name").get_str()] = find_value(find_value(entry, "ns_per_op").get_obj(), "median").get_real();
+        }
+    } catch (const std::runtime_error& e) {
+        regressions.push_back(strprintf("cannot read the baseline: %s", e.what()));
+        return regressions;
+    }
+
+    for (const Result& result : results) {
+        std::map<std::string, double>::const_iterator it = baselineMedians.find(result.name);
+        if (it == baselineMedians.end() || it->second <= 0)
+            continue;
+        const double slowdownPercent = (result.median / it->second - 1) * 100;
+        if (slowdownPercent > maxSlowdownPercent)
+            regressions.push_back(strprintf("%s: median of %.0f ns/op against %.0f in the baseline (%+.1f%%)",
+                result.name, result.median, it->second, slowdownPercent));
+    }
+    return regressions;
+}
+}
@@ -0,0 +1,131 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+#include <chrono>
+#include <functional>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+/*
+ * Usage:
+
+static void CODE_TO_TIME(benchmark::State& state)
+{
+    ... do any setup needed...
+    while (state.KeepRunning()) {
+       ... do stuff you want to time...
+    }
+    ... do any cleanup needed...
+}
+
+BENCHMARK(CODE_TO_TIME);
+
+ */
+namespace benchmark
+{
+typedef std::chrono::steady_clock Clock;
+
+/** How every benchmark is run, from the command line of bench_izzy */
+struct Options {
+    //! Only benchmarks whose name contains this are run
+    std::string filter;
+    //! Operations run untimed before the first sample, to warm the caches up
+    uint64_t nWarmupIterations;
+    //! Samples timed per benchmark
+    uint64_t nSamples;
+    //! A sample runs as many operations as it takes to last at least this long
+    uint64_t nMinSampleMicros;
+
+    Options();
+};
+
+/** What a benchmark measured: the nanoseconds per operation of each sample, and their summary */
+struct Result {
+    std::string name;
+    uint64_t nIterationsPerSample;
+    std::vector<double> samples;
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+
+    Result();
+    //! Fills in the summary from the samples
+    void Summarize();
+};
+
+/**
+ * Times the loop of a benchmark: the body of `while (state.KeepRunning())`
+ * does one operation.
+ *
+ * The warm-up operations also tell how long one operation takes, from which
+ * the number of operations a sample lasts is picked; every sample after that
+ * is timed on its own, so they give a distribution rather than an average.
+ */
+class State
+{
+private:
+    enum Phase {
+        NOT_STARTED,
+        WARMING_UP,
+        SAMPLING,
+        FINISHED,
+    };
+
+    const Options& options_;
+    Result& result_;
+    Phase phase_;
+    uint64_t nIterationsLeft_;
+    Clock::time_point batchStart_;
+
+    bool NextBatch();
+
+public:
+    State(const Options& options, Result& result);
+
+    bool KeepRunning()
+    {
+        if (nIterationsLeft_ != 0) {
+            --nIterationsLeft_;
+            return true;
+        }
+        return NextBatch();
+    }
+};
+
+typedef std::function<void(State&)> BenchFunction;
+
+class BenchRunner
+{
+private:
+    typedef std::map<std::string, BenchFunction> BenchmarkMap;
+    static BenchmarkMap& benchmarks();
+
+public:
+    BenchRunner(const std::string& name, BenchFunction func);
+
+    static std::vector<std::string> ListBenchmarks();
+    static std::vector<Result> RunAll(const Options& options);
+};
+
+//! The results as a JSON document, for keeping as a baseline
+std::string ResultsToJSON(const std::vector<Result>& results, const Options& options);
+/**
+ * Compares the median of every result with the one in a baseline written by
+ * ResultsToJSON; the benchmarks that got slower by more than the allowed
+ * percentage are returned as messages, and an unreadable baseline as one message.
+ */
+std::vector<std::string> FindRegressions(const std::vector<Result>& results, const std::string& baselineJSON, double maxSlowdownPercent);
+}
+
+// BENCHMARK(foo) expands to:  benchmark::BenchRunner bench_11foo("foo", foo);
+#define BENCHMARK(n) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n);
+
+#endif// BENCH_BENCH_H
@@ -0,0 +1,138 @@
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <LicenseAndInfo.h>
+#include <Logging.h>
+#include <noui.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <Settings.h>
+#include <tinyformat.h>
+#include <util.h>
+#include <utiltime.h>
+#include <UtxoCheckingAndUpdating.h>
+#ifdef ENABLE_WALLET
+#include <db.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+extern Settings& settings;
+
+namespace
+{
+void PrintUsage()
+{
+    std::string strUsage = "Usage:\n  bench_izzy [options]\n\n";
+    strUsage += HelpMessageGroup("Options:");
+    strUsage += HelpMessageOpt("-?", "This help message");
+    strUsage += HelpMessageOpt("-list", "List the benchmarks and exit");
+    strUsage += HelpMessageOpt("-filter=<text>", "Only run the benchmarks whose name contains <text>");
+    strUsage += HelpMessageOpt("-warmup=<n>", strprintf("Operations run before the first timed sample (default: %u)", benchmark::Options().nWarmupIterations));
+    strUsage += HelpMessageOpt("-samples=<n>", strprintf("Samples timed per benchmark (default: %u)", benchmark::Options().nSamples));
+    strUsage += HelpMessageOpt("-minsampletime=<n>", strprintf("Microseconds a sample lasts at least (default: %u)", benchmark::Options().nMinSampleMicros));
+    strUsage += HelpMessageOpt("-json=<file>", "Write the results as JSON to <file>");
+    strUsage += HelpMessageOpt("-baseline=<file>", "Fail when a median is slower than in the JSON results in <file>");
+    strUsage += HelpMessageOpt("-maxslowdown=<n>", "Percentage by which a median may exceed the baseline (default: 10)");
+    fprintf(stdout, "%s", strUsage.c_str());
+}
+
+bool ReadFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+        return false;
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+/** The node state the benchmarks run against, set up as test_izzy does but on regtest, where blocks are solved instantly */
+struct BenchmarkingSetup {
+    boost::filesystem::path pathTemp;
+
+    BenchmarkingSetup()
+    {
+        SHA256AutoDetect();
+        InitSignatureCache();
+        InitScriptExecutionCache();
+        fPrintToDebugLog = false;
+        SelectParams(CBaseChainParams::REGTEST);
+        noui_connect();
+#ifdef ENABLE_WALLET
+        CDB::bitdb.MakeMock();
+#endif
+        pathTemp = GetTempPath() / strprintf("bench_izzy_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
+        boost::filesystem::create_directories(pathTemp);
+        settings.SetParameter("-datadir", pathTemp.string());
+    }
+    ~BenchmarkingSetup()
+    {
+#ifdef ENABLE_WALLET
+        CDB::bitdb.Flush(true);
+#endif
+        boost::filesystem::remove_all(pathTemp);
+    }
+};
+}
+
+int main(int argc, char** argv)
+{
+    SetupEnvironment();
+    settings.ParseParameters(argc, argv);
+    if (settings.ParameterIsSet("-?") || settings.ParameterIsSet("-help")) {
+        PrintUsage();
+        return 0;
+    }
+    if (settings.GetBoolArg("-list", false)) {
+        for (const std::string& name : benchmark::BenchRunner::ListBenchmarks())
+            fprintf(stdout, "%s\n", name.c_str());
+        return 0;
+    }
+
+    benchmark::Options options;
+    options.filter = settings.GetArg("-filter", options.filter);
+    options.nWarmupIterations = std::max<int64_t>(settings.GetArg("-warmup", (int64_t)options.nWarmupIterations), 1);
+    options.nSamples = std::max<int64_t>(settings.GetArg("-samples", (int64_t)options.nSamples), 1);
+    options.nMinSampleMicros = std::max<int64_t>(settings.GetArg("-minsampletime", (int64_t)options.nMinSampleMicros), 1);
+
+    std::string baselineJSON;
+    const std::string baselinePath = settings.GetArg("-baseline", "");
+    if (!baselinePath.empty() && !ReadFile(baselinePath, baselineJSON)) {
+        fprintf(stderr, "Error: cannot read the baseline %s\n", baselinePath.c_str());
+        return 1;
+    }
+
+    std::vector<benchmark::Result> results;
+    {
+        BenchmarkingSetup setup;
+        results = benchmark::BenchRunner::RunAll(options);
+    }
+
+    const std::string jsonPath = settings.GetArg("-json", "");
+    if (!jsonPath.empty()) {
+        std::ofstream jsonFile(jsonPath.c_str());
+        jsonFile << benchmark::ResultsToJSON(results, options) << "\n";
+        if (!jsonFile) {
+            fprintf(stderr, "Error: cannot write the results to %s\n", jsonPath.c_str());
+            return 1;
+        }
+    }
+
+    if (!baselinePath.empty()) {
+        const double maxSlowdownPercent = settings.GetArg("-maxslowdown", (int64_t)10);
+        const std::vector<std::string> regressions = benchmark::FindRegressions(results, baselineJSON, maxSlowdownPercent);
+        for (const std::string& regression : regressions)
+            fprintf(stderr, "Regression: %s\n", regression.c_str());
+        if (!regressions.empty())
+            return 1;
+    }
+    return 0;
+}
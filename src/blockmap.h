@@ -1,11 +1,22 @@
 #ifndef BLOCK_MAP_H
 #define BLOCK_MAP_H
 #include "chain.h"
+#include <NodePoolAllocator.h>
+#include <SaltedHasher.h>
+
+#include <functional>
+
 #include <boost/unordered_map.hpp>
-struct BlockHasher {
-    size_t operator()(const uint256& hash) const { return hash.GetLow64(); }
-};
-class BlockMap: public boost::unordered_map<uint256, CBlockIndex*, BlockHasher>
+/**
+ * The block indexes by block hash. Nodes are pool allocated, as there is one per
+ * header ever seen, and salted hashing keeps headers announced by peers from
+ * being chosen to collide.
+ *
+ * The map stays node based so that keys never move: every CBlockIndex points to
+ * its own key through phashBlock.
+ */
+class BlockMap: public boost::unordered_map<uint256, CBlockIndex*, SaltedUint256Hasher, std::equal_to<uint256>,
+    NodePoolAllocator<std::pair<const uint256, CBlockIndex*> > >
 {
 };
-#endif // BLOCK_MAP_H
\ No newline at end of file
+#endif // BLOCK_MAP_H
@@ -4,7 +4,10 @@
 
 #include "bloom.h"
 
+#include "crypto/common.h"
+#include "FilterableBlock.h"
 #include "hash.h"
+#include "random.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/standard.h"
@@ -12,6 +15,7 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <boost/foreach.hpp>
 
@@ -40,46 +44,61 @@ CBloomFilter::CBloomFilter(unsigned int nElements, double nFPRate, unsigned int
 {
 }
 
-inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const
+namespace
+{
+/** An outpoint as it is serialized, which is how filters take it */
+const unsigned int OUTPOINT_KEY_SIZE = 36;
+
+void SerializeOutPointKey(const COutPoint& outpoint, unsigned char key[OUTPOINT_KEY_SIZE])
+{
+    memcpy(key, outpoint.hash.begin(), 32);
+    WriteLE32(key + 32, outpoint.n);
+}
+}
+
+inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const unsigned char* pDataToHash, size_t nDataSize) const
 {
     // 0xFBA4C795 chosen as it guarantees a reasonable bit difference between nHashNum values.
-    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
+    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, pDataToHash, nDataSize) % (vData.size() * 8);
 }
 
-void CBloomFilter::insert(const vector<unsigned char>& vKey)
+void CBloomFilter::insert(const unsigned char* pKey, size_t nKeySize)
 {
     if (isFull)
         return;
     for (unsigned int i = 0; i < nHashFuncs; i++) {
-        unsigned int nIndex = Hash(i, vKey);
+        unsigned int nIndex = Hash(i, pKey, nKeySize);
         // Sets bit nIndex of vData
         vData[nIndex >> 3] |= (1 << (7 & nIndex));
     }
     isEmpty = false;
 }
 
+void CBloomFilter::insert(const vector<unsigned char>& vKey)
+{
+    insert(vKey.empty() ? NULL : &vKey[0], vKey.size());
+}
+
 void CBloomFilter::insert(const COutPoint& outpoint)
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
-    insert(data);
+    unsigned char key[OUTPOINT_KEY_SIZE];
+    SerializeOutPointKey(outpoint, key);
+    insert(key, sizeof(key));
 }
 
 void CBloomFilter::insert(const uint256& hash)
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    insert(data);
+    insert(hash.begin(), hash.size());
 }
 
-bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+bool CBloomFilter::contains(const unsigned char* pKey, size_t nKeySize) const
 {
     if (isFull)
         return true;
     if (isEmpty)
         return false;
     for (unsigned int i = 0; i < nHashFuncs; i++) {
-        unsigned int nIndex = Hash(i, vKey);
+        unsigned int nIndex = Hash(i, pKey, nKeySize);
         // Checks bit nIndex of vData
         if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
             return false;
@@ -87,18 +106,21 @@ bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
     return true;
 }
 
+bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+{
+    return contains(vKey.empty() ? NULL : &vKey[0], vKey.size());
+}
+
 bool CBloomFilter::contains(const COutPoint& outpoint) const
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
-    return contains(data);
+    unsigned char key[OUTPOINT_KEY_SIZE];
+    SerializeOutPointKey(outpoint, key);
+    return contains(key, sizeof(key));
 }
 
 bool CBloomFilter::contains(const uint256& hash) const
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    return contains(data);
+    return contains(hash.begin(), hash.size());
 }
 
 void CBloomFilter::clear()
@@ -177,6 +199,44 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
     return false;
 }
 
+bool CBloomFilter::IsRelevantAndUpdate(const FilterableTransaction& tx)
+{
+    // The same matching as for a CTransaction, on the data elements picked out of its scripts beforehand
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    bool fFound = contains(tx.hash);
+
+    for (unsigned int i = 0; i < tx.outputs.size(); i++) {
+        const FilterableTransaction::Output& output = tx.outputs[i];
+        BOOST_FOREACH (const std::vector<unsigned char>& data, output.dataElements) {
+            if (contains(data)) {
+                fFound = true;
+                if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
+                    insert(COutPoint(tx.hash, i));
+                else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY && output.isPayToPubkeyOrMultisig)
+                    insert(COutPoint(tx.hash, i));
+                break;
+            }
+        }
+    }
+
+    if (fFound)
+        return true;
+
+    BOOST_FOREACH (const FilterableTransaction::Input& input, tx.inputs) {
+        if (contains(input.prevout))
+            return true;
+        BOOST_FOREACH (const std::vector<unsigned char>& data, input.dataElements) {
+            if (contains(data))
+                return true;
+        }
+    }
+
+    return false;
+}
+
 void CBloomFilter::UpdateEmptyFull()
 {
     bool full = true;
@@ -188,3 +248,82 @@ void CBloomFilter::UpdateEmptyFull()
     isFull = full;
     isEmpty = empty;
 }
+
+CRollingBloomFilter::CRollingBloomFilter(
+    unsigned int nElements,
+    double fpRate
+    ): nEntriesPerGeneration((nElements + 1) / 2)
+    , nEntriesThisGeneration(0)
+    , nGeneration(1)
+    , data()
+    , nTweak(0)
+    , nHashFuncs(0)
+{
+    const double logFpRate = log(fpRate);
+    // The optimal number of hash functions is log(fpRate) / log(0.5), kept within 1 to 50
+    nHashFuncs = std::max(1, std::min((int)round(logFpRate / log(0.5)), 50));
+    // Between two and three generations are held at a time, and the filter is
+    // sized for the false positive rate to hold with three of them:
+    // fpRate = (1 - exp(-nHashFuncs * nMaxElements / nFilterBits)) ^ nHashFuncs
+    const uint32_t nMaxElements = nEntriesPerGeneration * 3;
+    const uint32_t nFilterBits = (uint32_t)ceil(-1.0 * nHashFuncs * nMaxElements / log(1.0 - exp(logFpRate / nHashFuncs)));
+    // Bit P is stored as bit (P & 63) of both data[(P >> 6) * 2] and data[(P >> 6) * 2 + 1]
+    data.resize(((nFilterBits + 63) / 64) << 1);
+    reset();
+}
+
+static inline uint32_t RollingBloomHash(unsigned int nHashNum, uint32_t nTweak, const std::vector<unsigned char>& vDataToHash)
+{
+    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash);
+}
+
+void CRollingBloomFilter::insert(const std::vector<unsigned char>& vKey)
+{
+    if (nEntriesThisGeneration == nEntriesPerGeneration) {
+        nEntriesThisGeneration = 0;
+        nGeneration++;
+        if (nGeneration == 4)
+            nGeneration = 1;
+        // Wipe the bits last set by the generation whose number is taken over
+        const uint64_t nGenerationMask1 = -(uint64_t)(nGeneration & 1);
+        const uint64_t nGenerationMask2 = -(uint64_t)(nGeneration >> 1);
+        for (uint32_t p = 0; p < data.size(); p += 2) {
+            const uint64_t p1 = data[p];
+            const uint64_t p2 = data[p + 1];
+            const uint64_t mask = (p1 ^ nGenerationMask1) | (p2 ^ nGenerationMask2);
+            data[p] = p1 & mask;
+            data[p + 1] = p2 & mask;
+        }
+    }
+    nEntriesThisGeneration++;
+
+    for (int n = 0; n < nHashFuncs; n++) {
+        const uint32_t h = RollingBloomHash(n, nTweak, vKey);
+        const int bit = h & 0x3F;
+        const uint32_t pos = (h >> 6) % data.size();
+        // The lowest bit of pos picks the first or second half of the generation number
+        data[pos & ~1] = (data[pos & ~1] & ~(((uint64_t)1) << bit)) | ((uint64_t)(nGeneration & 1)) << bit;
+        data[pos | 1] = (data[pos | 1] & ~(((uint64_t)1) << bit)) | ((uint64_t)(nGeneration >> 1)) << bit;
+    }
+}
+
+bool CRollingBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+{
+    for (int n = 0; n < nHashFuncs; n++) {
+        const uint32_t h = RollingBloomHash(n, nTweak, vKey);
+        const int bit = h & 0x3F;
+        const uint32_t pos = (h >> 6) % data.size();
+        // A bit neither half of the generation number is set for was never set
+        if (!(((data[pos & ~1] | data[pos | 1]) >> bit) & 1))
+            return false;
+    }
+    return true;
+}
+
+void CRollingBloomFilter::reset()
+{
+    nTweak = GetRand(std::numeric_limits<unsigned int>::max());
+    nEntriesThisGeneration = 0;
+    nGeneration = 1;
+    std::fill(data.begin(), data.end(), 0);
+}
@@ -12,6 +12,7 @@
 class COutPoint;
 class CTransaction;
 class uint256;
+struct FilterableTransaction;
 
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
@@ -50,7 +51,10 @@ private:
     unsigned int nTweak;
     unsigned char nFlags;
 
-    unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
+    unsigned int Hash(unsigned int nHashNum, const unsigned char* pDataToHash, size_t nDataSize) const;
+    // The keys are hashed where they lie, without copying them into vectors first
+    void insert(const unsigned char* pKey, size_t nKeySize);
+    bool contains(const unsigned char* pKey, size_t nKeySize) const;
 
 public:
     /**
@@ -92,9 +96,41 @@ public:
 
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
+    //! As above, for a transaction whose scripts were parsed once for all the filters it is matched against
+    bool IsRelevantAndUpdate(const FilterableTransaction& tx);
 
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
 };
 
+/**
+ * RollingBloomFilter is a probabilistic "keep track of most recently inserted" set.
+ * Construct it with the number of items to keep track of, and a false-positive
+ * rate. Unlike CBloomFilter, it never fills up: it remembers at least the last
+ * nElements inserted, in generations of half of them, and forgets the oldest
+ * generation when a new one begins.
+ *
+ * Each bit of the filter takes two bits of storage, telling which of three
+ * generations last set it, so a generation can be wiped in one pass.
+ */
+class CRollingBloomFilter
+{
+public:
+    CRollingBloomFilter(unsigned int nElements, double nFPRate);
+
+    void insert(const std::vector<unsigned char>& vKey);
+    bool contains(const std::vector<unsigned char>& vKey) const;
+
+    //! Forgets everything, and chooses a new tweak so the false positives change too
+    void reset();
+
+private:
+    int nEntriesPerGeneration;
+    int nEntriesThisGeneration;
+    int nGeneration;
+    std::vector<uint64_t> data;
+    unsigned int nTweak;
+    int nHashFuncs;
+};
+
 #endif // BITCOIN_BLOOM_H
@@ -108,6 +108,9 @@ enum BlockStatus {
 class  CBlockIndex
 {
 public:
+    // Fields consulted while walking the block tree and selecting the best chain come first, so
+    // that they share cache lines. Members are grouped by size to keep padding to a minimum.
+
     //! pointer to the hash of the block, if any. memory is owned by this CBlockIndex
     const uint256* phashBlock;
 
@@ -120,23 +123,14 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
-    //ppcoin: trust score of block chain
-    uint256 bnChainTrust;
+    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
+    uint256 nChainWork;
 
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
-
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
-
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
-
-    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
-    uint256 nChainWork;
+    //! Verification status of this block. See enum BlockStatus
+    unsigned int nStatus;
 
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
@@ -147,8 +141,14 @@ public:
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-    //! Verification status of this block. See enum BlockStatus
-    unsigned int nStatus;
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId;
+
+    //! block header
+    int nVersion;
+    unsigned int nTime;
+    unsigned int nBits;
+    unsigned int nNonce;
 
     unsigned int nFlags; // ppcoin: block index flags
     enum {
@@ -157,31 +157,31 @@ public:
         BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
     };
 
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
+
     // proof-of-stake specific fields
     uint256 GetBlockTrust() const;
-    uint64_t nStakeModifier;             // hash modifier for proof-of-stake
     unsigned int nStakeModifierChecksum; // checksum of index; in-memeory only
-    COutPoint prevoutStake;
     unsigned int nStakeTime;
-    uint256 hashProofOfStake;
+    uint64_t nStakeModifier;             // hash modifier for proof-of-stake
     int64_t nMint;
     int64_t nMoneySupply;
+    COutPoint prevoutStake;
+    uint256 hashProofOfStake;
+
+    //ppcoin: trust score of block chain
+    uint256 bnChainTrust;
 
-    //! block header
-    int nVersion;
     uint256 hashMerkleRoot;
-    unsigned int nTime;
-    unsigned int nBits;
-    unsigned int nNonce;
     uint256 nAccumulatorCheckpoint;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId;
-
-    //! zerocoin specific fields
-    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
-    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
-
     LotteryCoinstakeData vLotteryWinnersCoinstakes;
 
     void SetNull()
@@ -213,11 +213,6 @@ public:
         nBits = 0;
         nNonce = 0;
         nAccumulatorCheckpoint = 0;
-        // Start supply of each denomination with 0s
-        for (auto& denom : libzerocoin::zerocoinDenomList) {
-            mapZerocoinSupply.insert(std::make_pair(denom, 0));
-        }
-        vMintDenominationsInBlock.clear();
         vLotteryWinnersCoinstakes.clear();
     }
 
@@ -403,15 +398,31 @@ public:
     uint256 hashPrev;
     uint256 hashNext;
 
+    //! zerocoin specific fields, kept on disk only since nothing reads them once loaded
+    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
+    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
+
     CDiskBlockIndex()
     {
         hashPrev = uint256();
         hashNext = uint256();
+        SetNullZerocoinFields();
     }
 
     explicit CDiskBlockIndex(CBlockIndex* pindex) : CBlockIndex(*pindex)
     {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        SetNullZerocoinFields();
+    }
+
+    void SetNullZerocoinFields()
+    {
+        // Start supply of each denomination with 0s
+        mapZerocoinSupply.clear();
+        for (auto& denom : libzerocoin::zerocoinDenomList) {
+            mapZerocoinSupply.insert(std::make_pair(denom, 0));
+        }
+        vMintDenominationsInBlock.clear();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -252,6 +252,7 @@ public:
         fDifficultyRetargeting = true;
         fMineBlocksOnDemand = false;
         fHeadersFirstSyncingActive = false;
+        fRequireListedUtxoSnapshots = true;
 
         nFulfilledRequestExpireTime = 30 * 60; // fulfilled requests expire in 30 minutes
         strSporkKey = "03d7e085a5582121723b308b0d4858775f906a49eb7a39a12e35c2651bc00d39ee";
@@ -361,6 +362,7 @@ public:
         fDefaultConsistencyChecks = false;
         fMineBlocksOnDemand = false;
         fHeadersFirstSyncingActive = false;
+        fRequireListedUtxoSnapshots = true;
 
         nFulfilledRequestExpireTime = 60 * 60; // fulfilled requests expire in 1 hour
         strSporkKey = "04B433E6598390C992F4F022F20D3B4CBBE691652EE7C48243B81701CBDB7CC7D7BF0EE09E154E6FCBF2043D65AF4E9E97B89B5DBAF830D83B9B7F469A6C45A717";
@@ -518,6 +520,7 @@ public:
         fDefaultConsistencyChecks = true;
         fDifficultyRetargeting = false;
         fMineBlocksOnDemand = true;
+        fRequireListedUtxoSnapshots = false; // Any self-consistent snapshot may be loaded for testing
     }
     const CCheckpointData& Checkpoints() const
     {
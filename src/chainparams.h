@@ -22,6 +22,13 @@
 class Settings;
 
 typedef unsigned char MessageStartChars[MESSAGE_START_SIZE];
+//! What a trusted UTXO snapshot commits to besides its coins hash, as its coins do not tell
+struct UtxoSnapshotCommitment {
+    uint256 hashSerialized; //! The hash of the coins, as reported by gettxoutsetinfo
+    CAmount nMoneySupply;   //! The money supply at the base block
+};
+//! Trusted UTXO snapshots, keyed by the hash of their base block
+typedef std::map<uint256, UtxoSnapshotCommitment> MapUtxoSnapshots;
 
 struct CDNSSeedData {
     std::string name, host;
@@ -94,6 +101,10 @@ public:
     const std::vector<unsigned char>& Base58Prefix(Base58Type type) const { return base58Prefixes[type]; }
     const std::vector<CAddress>& FixedSeeds() const { return vFixedSeeds; }
     virtual const CCheckpointData& Checkpoints() const = 0;
+    /** UTXO snapshots that loadtxoutset accepts */
+    const MapUtxoSnapshots& UtxoSnapshots() const { return mapUtxoSnapshots; }
+    /** Whether loadtxoutset refuses snapshots not listed in UtxoSnapshots() */
+    bool RequireListedUtxoSnapshots() const { return fRequireListedUtxoSnapshots; }
     std::string SporkKey() const { return strSporkKey; }
     int64_t StartMasternodePayments() const { return nStartMasternodePayments; }
     CBaseChainParams::Network NetworkID() const { return networkID; }
@@ -151,6 +162,8 @@ protected:
     bool fDifficultyRetargeting;
     bool fMineBlocksOnDemand;
     bool fHeadersFirstSyncingActive;
+    MapUtxoSnapshots mapUtxoSnapshots;
+    bool fRequireListedUtxoSnapshots;
     std::string strSporkKey;
     int64_t nStartMasternodePayments;
 
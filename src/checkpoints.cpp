@@ -98,6 +98,20 @@ int CCheckpointServices::GetTotalBlocksEstimate() const
     return checkpoints.rbegin()->first;
 }
 
+uint256 CCheckpointServices::GetLastCheckpointHash() const
+{
+    if (!CCheckpointServices::fEnabled)
+        return uint256(0);
+
+    const MapCheckpoints& checkpoints = *checkpointDataProvider_().mapCheckpoints;
+    if(checkpoints.empty())
+    {
+        return uint256(0);
+    }
+
+    return checkpoints.rbegin()->second;
+}
+
 CBlockIndex* CCheckpointServices::GetLastCheckpoint(const BlockMap& mapBlockIndex) const
 {
     if (!CCheckpointServices::fEnabled)
@@ -36,6 +36,9 @@ public:
     //! Return conservative estimate of total number of blocks, 0 if unknown
     int GetTotalBlocksEstimate() const;
 
+    //! Return the hash of the highest checkpoint, 0 if unknown
+    uint256 GetLastCheckpointHash() const;
+
     //! Returns last CBlockIndex* in mapBlockIndex that is a checkpoint
     CBlockIndex* GetLastCheckpoint(const BlockMap& mapBlockIndex) const;
 
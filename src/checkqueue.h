@@ -6,8 +6,11 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <stdint.h>
 #include <vector>
 
+#include <utiltime.h>
+
 #include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
@@ -16,6 +19,18 @@
 template <typename T>
 class CCheckQueueControl;
 
+/** What a CCheckQueue has done since it was created */
+struct CCheckQueueStats {
+    uint64_t nChecks;
+    uint64_t nBatches;
+    //! Moving average of the time one check takes, 0 until a batch completed
+    int64_t nCheckCostNanos;
+    //! Time the master spent blocked on workers finishing their batches
+    int64_t nMasterWaitMicros;
+
+    CCheckQueueStats() : nChecks(0), nBatches(0), nCheckCostNanos(0), nMasterWaitMicros(0) {}
+};
+
 /** 
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -65,6 +80,34 @@ private:
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! How long one batch should take once the cost of a check is known. Short enough that
+    //! workers finish together at the end of a block, long enough to keep lock traffic low.
+    static const int64_t nTargetBatchNanos = 250 * 1000;
+
+    CCheckQueueStats stats;
+
+    /** The batch size that takes about nTargetBatchNanos at the measured cost of a check */
+    unsigned int AdaptedBatchSize() const
+    {
+        if (stats.nCheckCostNanos <= 0)
+            return nBatchSize;
+        return (unsigned int)std::max<int64_t>(1, std::min<int64_t>(nBatchSize, nTargetBatchNanos / stats.nCheckCostNanos));
+    }
+
+    void RecordBatch(unsigned int nChecks, int64_t nBatchMicros, bool fCompleted)
+    {
+        stats.nChecks += nChecks;
+        stats.nBatches++;
+        // A batch cut short by a failed check does not tell what a check costs
+        if (!fCompleted)
+            return;
+        const int64_t nCostNanos = std::max<int64_t>(1, nBatchMicros * 1000 / nChecks);
+        if (stats.nCheckCostNanos == 0)
+            stats.nCheckCostNanos = nCostNanos;
+        else
+            stats.nCheckCostNanos += (nCostNanos - stats.nCheckCostNanos) / 8;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
@@ -73,6 +116,8 @@ private:
         vChecks.reserve(nBatchSize);
         unsigned int nNow = 0;
         bool fOk = true;
+        bool fCompleted = true;
+        int64_t nBatchMicros = 0;
         do {
             {
                 boost::unique_lock<boost::mutex> lock(mutex);
@@ -80,6 +125,7 @@ private:
                 if (nNow) {
                     fAllOk &= fOk;
                     nTodo -= nNow;
+                    RecordBatch(nNow, nBatchMicros, fCompleted);
                     if (nTodo == 0 && !fMaster)
                         // We processed the last element; inform the master he can exit and return the result
                         condMaster.notify_one();
@@ -99,7 +145,10 @@ private:
                         return fRet;
                     }
                     nIdle++;
+                    const int64_t nWaitStart = fMaster ? GetTimeMicros() : 0;
                     cond.wait(lock); // wait
+                    if (fMaster)
+                        stats.nMasterWaitMicros += GetTimeMicros() - nWaitStart;
                     nIdle--;
                 }
                 // Decide how many work units to process now.
@@ -107,7 +156,9 @@ private:
                 //   all workers finish approximately simultaneously.
                 // * Try to account for idle jobs which will instantly start helping.
                 // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
+                // * Once the cost of a check has been measured, keep batches to about nTargetBatchNanos,
+                //   so a batch of expensive checks does not leave the others waiting on one worker.
+                nNow = std::max(1U, std::min(AdaptedBatchSize(), (unsigned int)queue.size() / (nTotal + nIdle + 1)));
                 vChecks.resize(nNow);
                 for (unsigned int i = 0; i < nNow; i++) {
                     // We want the lock on the mutex to be as short as possible, so swap jobs from the global
@@ -119,9 +170,13 @@ private:
                 fOk = fAllOk;
             }
             // execute work
+            fCompleted = fOk;
+            const int64_t nBatchStart = GetTimeMicros();
             BOOST_FOREACH (T& check, vChecks)
                 if (fOk)
                     fOk = check();
+            nBatchMicros = GetTimeMicros() - nBatchStart;
+            fCompleted = fCompleted && fOk;
             vChecks.clear();
         } while (true);
     }
@@ -166,6 +221,12 @@ public:
         boost::unique_lock<boost::mutex> lock(mutex);
         return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
     }
+
+    CCheckQueueStats GetStats()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        return stats;
+    }
 };
 
 /** 
@@ -5,8 +5,10 @@
 
 #include "coins.h"
 
+#include "memusage.h"
 #include "random.h"
 
+#include <algorithm>
 #include <assert.h>
 
 #include "FeeAndPriorityCalculator.h"
@@ -91,6 +93,15 @@ bool CCoins::IsPruned() const
     return true;
 }
 
+size_t CCoins::DynamicMemoryUsage() const
+{
+    size_t ret = memusage::DynamicUsage(vout);
+    BOOST_FOREACH (const CTxOut& out, vout) {
+        ret += memusage::DynamicUsage(*static_cast<const CScriptBase*>(&out.scriptPubKey));
+    }
+    return ret;
+}
+
 /**
  * calculate number of bytes for the bitmask, and its number of non-zero bytes
  * each bit in the bitmask represents the availability of one output, but the
@@ -145,19 +156,33 @@ bool CCoinsView::HaveCoins(const uint256& txid) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(0); }
 bool CCoinsView::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) { return false; }
 bool CCoinsView::GetStats(CCoinsStats& stats) const { return false; }
+bool CCoinsView::GetRunningStats(CCoinsStats& stats) const { return false; }
+std::shared_ptr<CCoinsView> CCoinsView::OpenSnapshot() { return std::shared_ptr<CCoinsView>(); }
+
+void CCoinsView::GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+{
+    CCoins found;
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        if (GetCoins(*it, found)) {
+            coins.push_back(std::make_pair(*it, CCoins()));
+            coins.back().second.swap(found);
+        }
+    }
+}
 
 
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView* viewIn) : base(viewIn) {}
 bool CCoinsViewBacked::GetCoins(const uint256& txid, CCoins& coins) const { return base->GetCoins(txid, coins); }
+void CCoinsViewBacked::GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const { base->GetCoinsBatch(txids, coins); }
 bool CCoinsViewBacked::HaveCoins(const uint256& txid) const { return base->HaveCoins(txid); }
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 void CCoinsViewBacked::SetBackend(CCoinsView& viewIn) { base = &viewIn; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) { return base->BatchWrite(mapCoins, hashBlock); }
 bool CCoinsViewBacked::GetStats(CCoinsStats& stats) const { return base->GetStats(stats); }
+bool CCoinsViewBacked::GetRunningStats(CCoinsStats& stats) const { return base->GetRunningStats(stats); }
+std::shared_ptr<CCoinsView> CCoinsViewBacked::OpenSnapshot() { return base->OpenSnapshot(); }
 
-CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
-
-CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), hashBlock(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), hashBlock(0), cachedCoinsUsage(0) {}
 
 CCoinsViewCache::~CCoinsViewCache()
 {
@@ -174,6 +199,7 @@ CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256& txid) const
         return cacheCoins.end();
     CCoinsMap::iterator ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry())).first;
     tmp.swap(ret->second.coins);
+    cachedCoinsUsage += ret->second.coins.DynamicMemoryUsage();
     if (ret->second.coins.IsPruned()) {
         // The parent only has an empty entry for this txid; we can consider our
         // version as fresh.
@@ -182,6 +208,41 @@ CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256& txid) const
     return ret;
 }
 
+void CCoinsViewCache::PrefetchCoins(const std::vector<uint256>& txids) const
+{
+    std::vector<uint256> missing;
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        if (cacheCoins.find(*it) == cacheCoins.end())
+            missing.push_back(*it);
+    }
+    if (missing.empty())
+        return;
+
+    std::vector<std::pair<uint256, CCoins> > found;
+    base->GetCoinsBatch(missing, found);
+    for (std::vector<std::pair<uint256, CCoins> >::iterator it = found.begin(); it != found.end(); ++it) {
+        std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(it->first, CCoinsCacheEntry()));
+        if (!ret.second)
+            continue;
+        ret.first->second.coins.swap(it->second);
+        cachedCoinsUsage += ret.first->second.coins.DynamicMemoryUsage();
+        if (ret.first->second.coins.IsPruned()) {
+            // As in FetchCoins, the parent only has an empty entry for this txid.
+            ret.first->second.flags = CCoinsCacheEntry::FRESH;
+        }
+    }
+}
+
+void CCoinsViewCache::GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+{
+    PrefetchCoins(txids);
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        CCoinsMap::const_iterator itCache = cacheCoins.find(*it);
+        if (itCache != cacheCoins.end())
+            coins.push_back(std::make_pair(*it, itCache->second.coins));
+    }
+}
+
 bool CCoinsViewCache::GetCoins(const uint256& txid, CCoins& coins) const
 {
     CCoinsMap::const_iterator it = FetchCoins(txid);
@@ -196,6 +257,7 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256& txid)
 {
     assert(!hasModifier);
     std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry()));
+    size_t cachedCoinUsage = 0;
     if (ret.second) {
         if (!base->GetCoins(txid, ret.first->second.coins)) {
             // The parent view does not have this entry; mark it as fresh.
@@ -205,10 +267,14 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256& txid)
             // The parent view only has a pruned entry for this; mark it as fresh.
             ret.first->second.flags = CCoinsCacheEntry::FRESH;
         }
+    } else {
+        cachedCoinUsage = ret.first->second.coins.DynamicMemoryUsage();
     }
+    if (!(ret.first->second.flags & (CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH)))
+        ret.first->second.RecordParentOutputs();
     // Assume that whenever ModifyCoins is called, the entry will be modified.
     ret.first->second.flags |= CCoinsCacheEntry::DIRTY;
-    return CCoinsModifier(*this, ret.first);
+    return CCoinsModifier(*this, ret.first, cachedCoinUsage);
 }
 
 const CCoins* CCoinsViewCache::AccessCoins(const uint256& txid) const
@@ -258,6 +324,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlockIn
                     assert(it->second.flags & CCoinsCacheEntry::FRESH);
                     CCoinsCacheEntry& entry = cacheCoins[it->first];
                     entry.coins.swap(it->second.coins);
+                    cachedCoinsUsage += entry.coins.DynamicMemoryUsage();
                     entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
                 }
             } else {
@@ -265,10 +332,15 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlockIn
                     // The grandparent does not have an entry, and the child is
                     // modified and being pruned. This means we can just delete
                     // it from the parent.
+                    cachedCoinsUsage -= itUs->second.coins.DynamicMemoryUsage();
                     cacheCoins.erase(itUs);
                 } else {
                     // A normal modification.
+                    if (!(itUs->second.flags & (CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH)))
+                        itUs->second.RecordParentOutputs();
+                    cachedCoinsUsage -= itUs->second.coins.DynamicMemoryUsage();
                     itUs->second.coins.swap(it->second.coins);
+                    cachedCoinsUsage += itUs->second.coins.DynamicMemoryUsage();
                     itUs->second.flags |= CCoinsCacheEntry::DIRTY;
                 }
             }
@@ -280,18 +352,103 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlockIn
     return true;
 }
 
+std::shared_ptr<CCoinsView> CCoinsViewCache::OpenSnapshot()
+{
+    assert(!hasModifier);
+    CCoinsMap mapWrite;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        CCoinsCacheEntry& entry = it->second;
+        if (!(entry.flags & CCoinsCacheEntry::DIRTY)) {
+            it++;
+            continue;
+        }
+        if (entry.coins.IsPruned()) {
+            cachedCoinsUsage -= entry.coins.DynamicMemoryUsage();
+            CCoinsCacheEntry& entryWrite = mapWrite[it->first];
+            entryWrite.coins.swap(entry.coins);
+            entryWrite.flags = entry.flags;
+            entry.MoveParentOutputs(entryWrite);
+            CCoinsMap::iterator itOld = it++;
+            cacheCoins.erase(itOld);
+            continue;
+        }
+        mapWrite[it->first] = entry;
+        entry.flags = 0;
+        it++;
+    }
+    if (!base->BatchWrite(mapWrite, hashBlock))
+        return std::shared_ptr<CCoinsView>();
+    return base->OpenSnapshot();
+}
+
 bool CCoinsViewCache::Flush()
 {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
-    cacheCoins.clear();
+    // Swap with a fresh map rather than clearing, so the node pool is released as well.
+    CCoinsMap().swap(cacheCoins);
+    cachedCoinsUsage = 0;
     return fOk;
 }
 
+namespace
+{
+bool IsOlderCoinsEntry(const CCoinsMap::iterator& a, const CCoinsMap::iterator& b)
+{
+    return a->second.coins.nHeight < b->second.coins.nHeight;
+}
+}
+
+bool CCoinsViewCache::Trim(size_t nMaxUsage)
+{
+    assert(!hasModifier);
+    std::vector<CCoinsMap::iterator> vEntries;
+    vEntries.reserve(cacheCoins.size());
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+        vEntries.push_back(it);
+    }
+    std::sort(vEntries.begin(), vEntries.end(), IsOlderCoinsEntry);
+
+    // Entries that get evicted are moved to the batch, the ones that stay are copied if dirty.
+    CCoinsMap mapWrite;
+    size_t nUsage = DynamicMemoryUsage();
+    for (std::vector<CCoinsMap::iterator>::iterator itEntry = vEntries.begin(); itEntry != vEntries.end(); itEntry++) {
+        CCoinsCacheEntry& entry = (*itEntry)->second;
+        // Nothing needs to stay for spent transactions once the spend is written.
+        const bool fEvict = nUsage > nMaxUsage || entry.coins.IsPruned();
+        if (!fEvict) {
+            if (entry.flags & CCoinsCacheEntry::DIRTY) {
+                mapWrite[(*itEntry)->first] = entry;
+                entry.flags = 0;
+            }
+            continue;
+        }
+        const size_t nEntryUsage = entry.coins.DynamicMemoryUsage();
+        if (entry.flags & CCoinsCacheEntry::DIRTY) {
+            CCoinsCacheEntry& entryWrite = mapWrite[(*itEntry)->first];
+            entryWrite.coins.swap(entry.coins);
+            entryWrite.flags = entry.flags;
+            entry.MoveParentOutputs(entryWrite);
+        }
+        nUsage -= memusage::MallocUsage(sizeof(memusage::unordered_node<CCoinsMap::value_type>)) + nEntryUsage;
+        cachedCoinsUsage -= nEntryUsage;
+        cacheCoins.erase(*itEntry);
+    }
+    // Hand the chunks the evicted entries leave empty back, so the cache really shrinks
+    cacheCoins.get_allocator().ReleaseFreeChunks();
+    return base->BatchWrite(mapWrite, hashBlock);
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const
 {
     return cacheCoins.size();
 }
 
+size_t CCoinsViewCache::DynamicMemoryUsage() const
+{
+    // The nodes are counted by the pool they live in, which keeps freed ones until Trim releases their chunks
+    return cacheCoins.get_allocator().PoolMemoryUsage() + memusage::MallocUsage(sizeof(void*) * cacheCoins.bucket_count()) + cachedCoinsUsage;
+}
+
 const CTxOut& CCoinsViewCache::GetOutputFor(const CTxIn& input) const
 {
     const CCoins* coins = AccessCoins(input.prevout.hash);
@@ -341,7 +498,7 @@ double CCoinsViewCache::GetPriority(const CTransaction& tx, int nHeight) const
     return FeeAndPriorityCalculator::instance().ComputePriority(tx,dResult);
 }
 
-CCoinsModifier::CCoinsModifier(CCoinsViewCache& cache_, CCoinsMap::iterator it_) : cache(cache_), it(it_)
+CCoinsModifier::CCoinsModifier(CCoinsViewCache& cache_, CCoinsMap::iterator it_, size_t usage) : cache(cache_), it(it_), cachedCoinUsage(usage)
 {
     assert(!cache.hasModifier);
     cache.hasModifier = true;
@@ -352,7 +509,11 @@ CCoinsModifier::~CCoinsModifier()
     assert(cache.hasModifier);
     cache.hasModifier = false;
     it->second.coins.Cleanup();
+    cache.cachedCoinsUsage -= cachedCoinUsage; // Subtract the old usage
     if ((it->second.flags & CCoinsCacheEntry::FRESH) && it->second.coins.IsPruned()) {
         cache.cacheCoins.erase(it);
+    } else {
+        // If the coin still exists after the modification, add the new usage
+        cache.cachedCoinsUsage += it->second.coins.DynamicMemoryUsage();
     }
 }
@@ -6,6 +6,8 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#include "NodePoolAllocator.h"
+#include <SaltedHasher.h>
 #include "compressor.h"
 #include "script/standard.h"
 #include "serialize.h"
@@ -13,6 +15,7 @@
 #include "undo.h"
 
 #include <assert.h>
+#include <memory>
 #include <stdint.h>
 
 #include <boost/foreach.hpp>
@@ -120,6 +123,9 @@ public:
     //! note that only !IsPruned() CCoins can be serialized
     bool IsPruned() const;
 
+    //! heap memory owned by the outputs and their scripts
+    size_t DynamicMemoryUsage() const;
+
     //! equality test
     friend bool operator==(const CCoins& a, const CCoins& b)
     {
@@ -230,38 +236,44 @@ public:
 
 };
 
-class CCoinsKeyHasher
-{
-private:
-    uint256 salt;
-
-public:
-    CCoinsKeyHasher();
-
-    /**
-     * This *must* return size_t. With Boost 1.46 on 32-bit systems the
-     * unordered_map will behave unpredictably if the custom hasher returns a
-     * uint64_t, resulting in failures when syncing the chain (#4634).
-     */
-    size_t operator()(const uint256& key) const
-    {
-        return key.GetHash(salt);
-    }
-};
+typedef SaltedUint256Hasher CCoinsKeyHasher;
 
 struct CCoinsCacheEntry {
     CCoins coins; // The actual cached data.
     unsigned char flags;
+    // The outputs the parent view has unspent, and the height it has them at, as of when the
+    // entry was made dirty. Writing the entry back tells created and spent outputs apart with
+    // these instead of reading the parent. Empty if the parent has none (FRESH).
+    std::vector<bool> vParentUnspent;
+    int nParentHeight;
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
         FRESH = (1 << 1), // The parent view does not have this entry (or it is pruned).
     };
 
-    CCoinsCacheEntry() : coins(), flags(0) {}
+    CCoinsCacheEntry() : coins(), flags(0), vParentUnspent(), nParentHeight(0) {}
+
+    //! Record the current coins as those of the parent view, before they are first modified
+    void RecordParentOutputs()
+    {
+        vParentUnspent.resize(coins.vout.size());
+        for (unsigned int i = 0; i < coins.vout.size(); i++)
+            vParentUnspent[i] = !coins.vout[i].IsNull();
+        nParentHeight = coins.nHeight;
+    }
+
+    //! Hand the recorded parent outputs over to other, the entry that is written in place of this one
+    void MoveParentOutputs(CCoinsCacheEntry& other)
+    {
+        other.vParentUnspent.swap(vParentUnspent);
+        other.nParentHeight = nParentHeight;
+    }
 };
 
-typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
+//! Nodes are pool allocated, as coins cache entries are inserted and erased at a high rate
+typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher, std::equal_to<uint256>,
+    NodePoolAllocator<std::pair<const uint256, CCoinsCacheEntry> > > CCoinsMap;
 
 struct CCoinsStats {
     int nHeight;
@@ -270,9 +282,10 @@ struct CCoinsStats {
     uint64_t nTransactionOutputs;
     uint64_t nSerializedSize;
     uint256 hashSerialized;
+    uint256 hashMuHash;
     CAmount nTotalAmount;
 
-    CCoinsStats() : nHeight(0), hashBlock(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), hashSerialized(0), nTotalAmount(0) {}
+    CCoinsStats() : nHeight(0), hashBlock(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), hashSerialized(0), hashMuHash(0), nTotalAmount(0) {}
 };
 
 
@@ -283,6 +296,10 @@ public:
     //! Retrieve the CCoins (unspent transaction outputs) for a given txid
     virtual bool GetCoins(const uint256& txid, CCoins& coins) const;
 
+    //! Retrieve the CCoins for several txids at once, appending the ones found to coins.
+    //! Views that go to disk override this to look all of them up in one go.
+    virtual void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const;
+
     //! Just check whether we have data for a given txid.
     //! This may (but cannot always) return true for fully spent transactions
     virtual bool HaveCoins(const uint256& txid) const;
@@ -297,6 +314,13 @@ public:
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats& stats) const;
 
+    //! Retrieve the statistics kept up to date while writing, without the serialized size and hash
+    virtual bool GetRunningStats(CCoinsStats& stats) const;
+
+    //! Open a read-only view that keeps showing the current state while this view moves on,
+    //! or NULL if the view cannot provide one
+    virtual std::shared_ptr<CCoinsView> OpenSnapshot();
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 };
@@ -311,11 +335,14 @@ protected:
 public:
     CCoinsViewBacked(CCoinsView* viewIn);
     bool GetCoins(const uint256& txid, CCoins& coins) const;
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const;
     bool HaveCoins(const uint256& txid) const;
     uint256 GetBestBlock() const;
     void SetBackend(CCoinsView& viewIn);
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock);
     bool GetStats(CCoinsStats& stats) const;
+    bool GetRunningStats(CCoinsStats& stats) const;
+    std::shared_ptr<CCoinsView> OpenSnapshot();
 };
 
 class CCoinsViewCache;
@@ -343,7 +370,8 @@ class CCoinsModifier
 private:
     CCoinsViewCache& cache;
     CCoinsMap::iterator it;
-    CCoinsModifier(CCoinsViewCache& cache_, CCoinsMap::iterator it_);
+    size_t cachedCoinUsage; // Cached memory usage of the CCoins object before modification
+    CCoinsModifier(CCoinsViewCache& cache_, CCoinsMap::iterator it_, size_t usage);
 
 public:
     CCoins* operator->() { return &it->second.coins; }
@@ -366,17 +394,33 @@ protected:
     mutable uint256 hashBlock;
     mutable CCoinsMap cacheCoins;
 
+    /* Cached dynamic memory usage for the inner CCoins objects. */
+    mutable size_t cachedCoinsUsage;
+
 public:
     CCoinsViewCache(CCoinsView* baseIn);
     ~CCoinsViewCache();
 
     // Standard CCoinsView methods
     bool GetCoins(const uint256& txid, CCoins& coins) const;
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const;
     bool HaveCoins(const uint256& txid) const;
     uint256 GetBestBlock() const;
     void SetBestBlock(const uint256& hashBlock);
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock);
 
+    /**
+     * Push the modifications applied to this cache to its base, keeping every unspent entry cached,
+     * and open a snapshot of the base. The snapshot shows the state this cache currently represents.
+     */
+    std::shared_ptr<CCoinsView> OpenSnapshot();
+
+    /**
+     * Bring the CCoins for all the given txids into the cache, looking the ones not cached
+     * yet up in a single batch, so that later accesses do not go to the base one by one.
+     */
+    void PrefetchCoins(const std::vector<uint256>& txids) const;
+
     /**
      * Return a pointer to CCoins in the cache, or NULL if not found. This is
      * more efficient than GetCoins. Modifications to other cache entries are
@@ -398,9 +442,20 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base like Flush, but only evict entries
+     * until the cache uses at most nMaxUsage bytes. The most recently created coins are kept, as
+     * those are the most likely to be spent soon; the entries that stay are no longer dirty.
+     * If false is returned, the state of this cache (and its backing view) will be undefined.
+     */
+    bool Trim(size_t nMaxUsage);
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
+    //! Calculate the size of the cache (in bytes)
+    size_t DynamicMemoryUsage() const;
+
     /**
      * Amount of izzy coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
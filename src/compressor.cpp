@@ -8,6 +8,7 @@
 #include "hash.h"
 #include "pubkey.h"
 #include "script/standard.h"
+#include "script/StakingVaultScript.h"
 
 bool CScriptCompressor::IsToKeyID(CKeyID& hash) const
 {
@@ -40,7 +41,17 @@ bool CScriptCompressor::IsToPubKey(CPubKey& pubkey) const
     return false;
 }
 
-bool CScriptCompressor::Compress(std::vector<unsigned char>& out) const
+bool CScriptCompressor::IsToStakingVault(std::vector<unsigned char>& hashes) const
+{
+    std::pair<valtype, valtype> pubkeyHashes;
+    if (!GetStakingVaultPubkeyHashes(script, pubkeyHashes))
+        return false;
+    hashes = pubkeyHashes.first;
+    hashes.insert(hashes.end(), pubkeyHashes.second.begin(), pubkeyHashes.second.end());
+    return true;
+}
+
+bool CScriptCompressor::Compress(std::vector<unsigned char>& out, int nType) const
 {
     CKeyID keyID;
     if (IsToKeyID(keyID)) {
@@ -68,6 +79,13 @@ bool CScriptCompressor::Compress(std::vector<unsigned char>& out) const
             return true;
         }
     }
+    std::vector<unsigned char> hashes;
+    if ((nType & SER_COMPACT_SCRIPTS) && IsToStakingVault(hashes)) {
+        out.resize(41);
+        out[0] = 0x06;
+        memcpy(&out[1], &hashes[0], 40);
+        return true;
+    }
     return false;
 }
 
@@ -77,6 +95,8 @@ unsigned int CScriptCompressor::GetSpecialSize(unsigned int nSize) const
         return 20;
     if (nSize == 2 || nSize == 3 || nSize == 4 || nSize == 5)
         return 32;
+    if (nSize == 6)
+        return 40;
     return 0;
 }
 
@@ -108,7 +128,7 @@ bool CScriptCompressor::Decompress(unsigned int nSize, const std::vector<unsigne
         script[34] = OP_CHECKSIG;
         return true;
     case 0x04:
-    case 0x05:
+    case 0x05: {
         unsigned char vch[33] = {};
         vch[0] = nSize - 2;
         memcpy(&vch[1], &in[0], 32);
@@ -122,6 +142,10 @@ bool CScriptCompressor::Decompress(unsigned int nSize, const std::vector<unsigne
         script[66] = OP_CHECKSIG;
         return true;
     }
+    case 0x06:
+        script = CreateStakingVaultScript(valtype(in.begin(), in.begin() + 20), valtype(in.begin() + 20, in.end()));
+        return true;
+    }
     return false;
 }
 
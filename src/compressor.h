@@ -22,8 +22,12 @@ class CScriptID;
  *  * Pay to script hash (encoded as 21 bytes)
  *  * Pay to pubkey starting with 0x02, 0x03 or 0x04 (encoded as 33 bytes)
  *
- *  Other scripts up to 121 bytes require 1 byte + script length. Above
- *  that, scripts up to 16505 bytes require 2 bytes + script length.
+ *  When serializing with SER_COMPACT_SCRIPTS, one more case is defined:
+ *  * Staking vault (encoded as 41 bytes instead of 51)
+ *
+ *  Other scripts up to 121 bytes (120 with SER_COMPACT_SCRIPTS) require
+ *  1 byte + script length. Above that, scripts up to 16505 bytes require
+ *  2 bytes + script length.
  */
 class CScriptCompressor
 {
@@ -35,6 +39,13 @@ private:
      * and nHeight of the enclosing transaction.
      */
     static const unsigned int nSpecialScripts = 6;
+    //! the staking vault template takes the next code when serializing with SER_COMPACT_SCRIPTS
+    static const unsigned int nSpecialScriptsCompact = 7;
+
+    static unsigned int GetSpecialScripts(int nType)
+    {
+        return (nType & SER_COMPACT_SCRIPTS) ? nSpecialScriptsCompact : nSpecialScripts;
+    }
 
     CScript& script;
 
@@ -49,8 +60,9 @@ protected:
     bool IsToKeyID(CKeyID& hash) const;
     bool IsToScriptID(CScriptID& hash) const;
     bool IsToPubKey(CPubKey& pubkey) const;
+    bool IsToStakingVault(std::vector<unsigned char>& hashes) const;
 
-    bool Compress(std::vector<unsigned char>& out) const;
+    bool Compress(std::vector<unsigned char>& out, int nType) const;
     unsigned int GetSpecialSize(unsigned int nSize) const;
     bool Decompress(unsigned int nSize, const std::vector<unsigned char>& out);
 
@@ -60,9 +72,9 @@ public:
     unsigned int GetSerializeSize(int nType, int nVersion) const
     {
         std::vector<unsigned char> compr;
-        if (Compress(compr))
+        if (Compress(compr, nType))
             return compr.size();
-        unsigned int nSize = script.size() + nSpecialScripts;
+        unsigned int nSize = script.size() + GetSpecialScripts(nType);
         return script.size() + VARINT(nSize).GetSerializeSize(nType, nVersion);
     }
 
@@ -70,11 +82,11 @@ public:
     void Serialize(Stream& s, int nType, int nVersion) const
     {
         std::vector<unsigned char> compr;
-        if (Compress(compr)) {
+        if (Compress(compr, nType)) {
             s << CFlatData(compr);
             return;
         }
-        unsigned int nSize = script.size() + nSpecialScripts;
+        unsigned int nSize = script.size() + GetSpecialScripts(nType);
         s << VARINT(nSize);
         s << CFlatData(script);
     }
@@ -84,13 +96,14 @@ public:
     {
         unsigned int nSize = 0;
         s >> VARINT(nSize);
-        if (nSize < nSpecialScripts) {
+        const unsigned int nSpecial = GetSpecialScripts(nType);
+        if (nSize < nSpecial) {
             std::vector<unsigned char> vch(GetSpecialSize(nSize), 0x00);
             s >> REF(CFlatData(vch));
             Decompress(nSize, vch);
             return;
         }
-        nSize -= nSpecialScripts;
+        nSize -= nSpecial;
         script.resize(nSize);
         s >> REF(CFlatData(script));
     }
@@ -11,9 +11,12 @@
 #include "script/standard.h"
 #include "Logging.h"
 
+#include <boost/atomic.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
 #include <openssl/aes.h>
 #include <openssl/evp.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <boost/foreach.hpp>
@@ -227,9 +230,14 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn, bool fForMixin
 
         bool keyPass = false;
         bool keyFail = false;
+        // Keys left out of the sample are checked by GetKey when they are decrypted for use
+        const size_t nStride = std::max<size_t>(1, mapCryptedKeys.size() / WALLET_CRYPTO_UNLOCK_KEYS_CHECKED);
+        size_t nKey = 0;
         CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
-        for (; mi != mapCryptedKeys.end(); ++mi)
+        for (; mi != mapCryptedKeys.end(); ++mi, ++nKey)
         {
+            if (nKey % nStride != 0)
+                continue;
             const CPubKey &vchPubKey = (*mi).second.first;
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
             CKey key;
@@ -343,6 +351,28 @@ bool CCryptoKeyStore::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) co
     return false;
 }
 
+namespace
+{
+struct EncryptedKey {
+    const CKey* key;
+    CPubKey vchPubKey;
+    std::vector<unsigned char> vchCryptedSecret;
+
+    explicit EncryptedKey(const CKey& keyIn) : key(&keyIn), vchPubKey(), vchCryptedSecret() {}
+};
+
+void EncryptKeysFrom(const CKeyingMaterial& vMasterKey, std::vector<EncryptedKey>& encryptedKeys, boost::atomic<size_t>& nextKey, boost::atomic<bool>& fFailed)
+{
+    for (size_t nKey = nextKey++; nKey < encryptedKeys.size() && !fFailed; nKey = nextKey++) {
+        EncryptedKey& encryptedKey = encryptedKeys[nKey];
+        encryptedKey.vchPubKey = encryptedKey.key->GetPubKey();
+        CKeyingMaterial vchSecret(encryptedKey.key->begin(), encryptedKey.key->end());
+        if (!EncryptSecret(vMasterKey, vchSecret, encryptedKey.vchPubKey.GetHash(), encryptedKey.vchCryptedSecret))
+            fFailed = true;
+    }
+}
+}
+
 bool CCryptoKeyStore::EncryptKeys(CKeyingMaterial& vMasterKeyIn)
 {
     {
@@ -350,16 +380,28 @@ bool CCryptoKeyStore::EncryptKeys(CKeyingMaterial& vMasterKeyIn)
         if (!mapCryptedKeys.empty() || IsCrypted())
             return false;
 
+        // Deriving the public keys and encrypting is spread over threads, handing
+        // the results over to AddCryptedKey, which may write them out, stays serial
+        std::vector<EncryptedKey> encryptedKeys;
+        encryptedKeys.reserve(mapKeys.size());
+        BOOST_FOREACH(const KeyMap::value_type& mKey, mapKeys)
+            encryptedKeys.push_back(EncryptedKey(mKey.second));
+
+        boost::atomic<size_t> nextKey(0);
+        boost::atomic<bool> fFailed(false);
+        const size_t nThreads = std::min<size_t>(encryptedKeys.size(), boost::thread::hardware_concurrency());
+        boost::thread_group threads;
+        for (size_t nThread = 1; nThread < nThreads; nThread++)
+            threads.create_thread(boost::bind(&EncryptKeysFrom, boost::cref(vMasterKeyIn), boost::ref(encryptedKeys), boost::ref(nextKey), boost::ref(fFailed)));
+        EncryptKeysFrom(vMasterKeyIn, encryptedKeys, nextKey, fFailed);
+        threads.join_all();
+        if (fFailed)
+            return false;
+
         fUseCrypto = true;
-        BOOST_FOREACH(KeyMap::value_type& mKey, mapKeys)
+        BOOST_FOREACH(const EncryptedKey& encryptedKey, encryptedKeys)
         {
-            const CKey &key = mKey.second;
-            CPubKey vchPubKey = key.GetPubKey();
-            CKeyingMaterial vchSecret(key.begin(), key.end());
-            std::vector<unsigned char> vchCryptedSecret;
-            if (!EncryptSecret(vMasterKeyIn, vchSecret, vchPubKey.GetHash(), vchCryptedSecret))
-                return false;
-            if (!AddCryptedKey(vchPubKey, vchCryptedSecret))
+            if (!AddCryptedKey(encryptedKey.vchPubKey, encryptedKey.vchCryptedSecret))
                 return false;
         }
         mapKeys.clear();
@@ -14,6 +14,8 @@ class uint256;
 const unsigned int WALLET_CRYPTO_KEY_SIZE = 32;
 const unsigned int WALLET_CRYPTO_SALT_SIZE = 8;
 const unsigned int WALLET_CRYPTO_IV_SIZE = 16;
+//! Keys Unlock decrypts to check the master key against, spread over the wallet; the others are checked as they are used
+const unsigned int WALLET_CRYPTO_UNLOCK_KEYS_CHECKED = 16;
 
 /**
  * Private key encryption is done based on a CMasterKey,
@@ -129,7 +131,7 @@ private:
     //! if fUseCrypto is false, vMasterKey must be empty
     bool fUseCrypto;
 
-    //! keeps track of whether Unlock has run a thorough check before
+    //! keeps track of whether Unlock has checked a sample of the keys before
     bool fDecryptionThoroughlyChecked;
 
     //! if fOnlyMixingAllowed is true, only mixing should be allowed in unlocked wallet
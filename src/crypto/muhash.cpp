@@ -0,0 +1,147 @@
+// Copyright (c) 2026 The IZZY Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <string.h>
+
+namespace
+{
+/** 2^3072 - MAX_PRIME_DIFF is the modulus */
+const uint32_t MAX_PRIME_DIFF = 1103717;
+
+/** Add c * MAX_PRIME_DIFF at the bottom of limbs, returning the carry out of the top limb */
+uint32_t AddMultipleOfPrimeDiff(uint32_t* limbs, uint64_t c)
+{
+    uint64_t carry = c * MAX_PRIME_DIFF;
+    for (int i = 0; i < Num3072::LIMBS && carry; ++i) {
+        carry += limbs[i];
+        limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    return (uint32_t)carry;
+}
+
+/** Reduce a number that is known to be below 2^3072 into [0, p) */
+void ReduceOnce(uint32_t* limbs)
+{
+    // limbs >= p exactly when limbs + MAX_PRIME_DIFF overflows 3072 bits,
+    // in which case the truncated sum is limbs - p.
+    uint32_t trial[Num3072::LIMBS];
+    memcpy(trial, limbs, sizeof(trial));
+    if (AddMultipleOfPrimeDiff(trial, 1))
+        memcpy(limbs, trial, sizeof(trial));
+}
+}
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i)
+        limbs[i] = ReadLE32(data + 4 * i);
+    ReduceOnce(limbs);
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i)
+        limbs[i] = 0;
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    uint32_t product[2 * LIMBS] = {0};
+    for (int i = 0; i < LIMBS; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            carry += (uint64_t)limbs[i] * a.limbs[j] + product[i + j];
+            product[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        product[i + LIMBS] = (uint32_t)carry;
+    }
+
+    // 2^3072 is congruent to MAX_PRIME_DIFF, so fold the upper half into the lower one.
+    uint64_t carry = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        carry += (uint64_t)product[i + LIMBS] * MAX_PRIME_DIFF + product[i];
+        limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    while (carry)
+        carry = AddMultipleOfPrimeDiff(limbs, carry);
+    ReduceOnce(limbs);
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Fermat's little theorem: a^(p-2) is the inverse of a, with p - 2 = 2^3072 - (MAX_PRIME_DIFF + 2).
+    uint32_t exponent[LIMBS];
+    for (int i = 0; i < LIMBS; ++i)
+        exponent[i] = 0xFFFFFFFF;
+    exponent[0] -= MAX_PRIME_DIFF + 1;
+
+    Num3072 result;
+    for (int i = LIMBS - 1; i >= 0; --i) {
+        for (int bit = 31; bit >= 0; --bit) {
+            result.Multiply(result);
+            if ((exponent[i] >> bit) & 1)
+                result.Multiply(*this);
+        }
+    }
+    return result;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; ++i)
+        WriteLE32(out + 4 * i, limbs[i]);
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    // Expand the SHA256 of the element to 3072 bits by hashing it with a counter.
+    unsigned char key[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(key);
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    for (unsigned char counter = 0; counter < Num3072::BYTE_SIZE / CSHA256::OUTPUT_SIZE; ++counter)
+        CSHA256().Write(key, sizeof(key)).Write(&counter, 1).Finalize(expanded + counter * CSHA256::OUTPUT_SIZE);
+    return Num3072(expanded);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& other)
+{
+    numerator.Multiply(other.numerator);
+    denominator.Multiply(other.denominator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char out[OUTPUT_SIZE]) const
+{
+    Num3072 result = numerator;
+    result.Divide(denominator);
+    unsigned char bytes[Num3072::BYTE_SIZE];
+    result.ToBytes(bytes);
+    CSHA256().Write(bytes, sizeof(bytes)).Finalize(out);
+}
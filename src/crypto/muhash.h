@@ -0,0 +1,66 @@
+// Copyright (c) 2026 The IZZY Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Number modulo the prime 2^3072 - 1103717, stored as little endian 32 bit limbs. */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+    static const int LIMBS = 96;
+    uint32_t limbs[LIMBS];
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+};
+
+/**
+ * Rolling hash of a set of byte strings (MuHash3072).
+ *
+ * Every element is mapped to a number modulo a 3072 bit prime, and the set is
+ * represented by their product, so elements can be added and removed in any
+ * order and the result only depends on the final set. Removals are kept in a
+ * separate denominator, so the costly inversion is only done in Finalize.
+ *
+ * This is an implementation of its own, not Bitcoin Core's MuHash3072: elements
+ * are expanded to 3072 bits with SHA256 rather than ChaCha20, so the digests
+ * differ from the ones Bitcoin Core computes for the same set.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    static const size_t OUTPUT_SIZE = 32;
+
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+    //! Combine with the set represented by another hash
+    MuHash3072& operator*=(const MuHash3072& other);
+    void Finalize(unsigned char out[OUTPUT_SIZE]) const;
+
+    const Num3072& Numerator() const { return numerator; }
+    const Num3072& Denominator() const { return denominator; }
+    Num3072& Numerator() { return numerator; }
+    Num3072& Denominator() { return denominator; }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
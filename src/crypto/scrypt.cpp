@@ -31,7 +31,10 @@
 #include "uint256.h"
 #include "utilstrencodings.h"
 #include <openssl/sha.h>
+#include <algorithm>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <string.h>
 #include <stdint.h>
@@ -359,26 +362,39 @@ void SMix(uint8_t *B, unsigned int r, unsigned int N, void* _V, void* XY)
         le32enc_2(&B[4 * k], X[k]);
 }
 
-void scrypt(const char* pass, unsigned int pLen, const char* salt, unsigned int sLen, char *output, unsigned int N, unsigned int r, unsigned int p, unsigned int dkLen)
+//! SMix every lane from nFirst on, a stride apart, with scratch memory of its own
+static void SMixLanes(uint8_t* B, unsigned int r, unsigned int N, unsigned int p, unsigned int nFirst, unsigned int nStride)
 {
-    //containers
     void* V0 = malloc(128 * r * N + 63);
     void* XY0 = malloc(256 * r + 64 + 63);
-    void* B1 = malloc(128 * r * p + 63);
-    uint8_t* B = (uint8_t *)(((uintptr_t)(B1) + 63) & ~ (uintptr_t)(63));
     uint32_t* V = (uint32_t *)(((uintptr_t)(V0) + 63) & ~ (uintptr_t)(63));
     uint32_t* XY = (uint32_t *)(((uintptr_t)(XY0) + 63) & ~ (uintptr_t)(63));
 
+    for (unsigned int i = nFirst; i < p; i += nStride)
+        SMix(&B[i * 128 * r], r, N, V, XY);
+
+    free(V0);
+    free(XY0);
+}
+
+void scrypt(const char* pass, unsigned int pLen, const char* salt, unsigned int sLen, char *output, unsigned int N, unsigned int r, unsigned int p, unsigned int dkLen)
+{
+    //containers
+    void* B1 = malloc(128 * r * p + 63);
+    uint8_t* B = (uint8_t *)(((uintptr_t)(B1) + 63) & ~ (uintptr_t)(63));
+
     PBKDF2_SHA256((const uint8_t *)pass, pLen, (const uint8_t *)salt, sLen, 1, B, p * 128 * r);
 
-    for(unsigned int i = 0; i < p; i++)
-    {
-        SMix(&B[i * 128 * r], r, N, V, XY);
-    }
+    // The lanes are independent of one another, so they are mixed side by side
+    unsigned int nThreads = std::min(p, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (unsigned int nThread = 1; nThread < nThreads; nThread++)
+        threads.emplace_back(SMixLanes, B, r, N, p, nThread, nThreads);
+    SMixLanes(B, r, N, p, 0, nThreads);
+    for (std::thread& thread : threads)
+        thread.join();
 
     PBKDF2_SHA256((const uint8_t *)pass, pLen, B, p * 128 * r, 1, (uint8_t *)output, dkLen);
 
-    free(V0);
-    free(XY0);
     free(B1);
 }
@@ -5,6 +5,7 @@
 
 #include "db.h"
 
+#include <defaultValues.h>
 #include "hash.h"
 #include "protocol.h"
 #include "util.h"
@@ -97,6 +98,83 @@ void CDB::Flush()
     CDB::bitdb.dbenv.txn_checkpoint(dbLogSize, nMinutes, 0);
 }
 
+bool CDB::BufferWrite(const CSecureDataStream& ssKey, const CSecureDataStream& ssValue, bool fOverwrite, bool& fResult)
+{
+    if (activeTxn)
+        return false;
+    const CSerializeData key(ssKey.begin(), ssKey.end());
+    if (!fOverwrite) {
+        CSerializeData bufferedValue;
+        const DatabaseWriteBuffer::LookupResult buffered = CDB::bitdb.LookupBufferedWrite(strFile, key, bufferedValue);
+        if (buffered == DatabaseWriteBuffer::BUFFERED_WRITE) {
+            fResult = false;
+            return true;
+        }
+        if (buffered == DatabaseWriteBuffer::NOT_BUFFERED) {
+            Dbt datKey(const_cast<char*>(&key[0]), key.size());
+            if (pdb->exists(NULL, &datKey, 0) == 0) {
+                fResult = false;
+                return true;
+            }
+        }
+    }
+    size_t nBufferedWrites = 0;
+    if (!CDB::bitdb.BufferWrite(strFile, key, CSerializeData(ssValue.begin(), ssValue.end()), nBufferedWrites))
+        return false;
+    fResult = nBufferedWrites < MAX_GROUP_COMMIT_WRITES || WriteBufferedWrites();
+    return true;
+}
+
+bool CDB::BufferErase(const CSecureDataStream& ssKey)
+{
+    if (activeTxn)
+        return false;
+    size_t nBufferedWrites = 0;
+    if (!CDB::bitdb.BufferErase(strFile, CSerializeData(ssKey.begin(), ssKey.end()), nBufferedWrites))
+        return false;
+    if (nBufferedWrites >= MAX_GROUP_COMMIT_WRITES)
+        WriteBufferedWrites();
+    return true;
+}
+
+DatabaseWriteBuffer::LookupResult CDB::LookupBufferedWrite(const CSecureDataStream& ssKey, CSerializeData& value) const
+{
+    return CDB::bitdb.LookupBufferedWrite(strFile, CSerializeData(ssKey.begin(), ssKey.end()), value);
+}
+
+bool CDB::WriteBufferedWrites()
+{
+    if (!pdb)
+        return false;
+    DatabaseWriteBuffer writes;
+    CDB::bitdb.TakeBufferedWrites(strFile, writes);
+    if (writes.empty())
+        return true;
+
+    DbTxn* ptxn = CDB::bitdb.TxnBegin();
+    if (!ptxn)
+        return error("%s : failed to begin the transaction for %u writes to %s", __func__, writes.size(), strFile);
+    for (DatabaseWriteBuffer::BufferedWrites::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+        Dbt datKey(const_cast<char*>(&it->first[0]), it->first.size());
+        int ret;
+        if (it->second.first) {
+            ret = pdb->del(ptxn, &datKey, 0);
+            if (ret == DB_NOTFOUND)
+                ret = 0;
+        } else {
+            Dbt datValue(const_cast<char*>(&it->second.second[0]), it->second.second.size());
+            ret = pdb->put(ptxn, &datKey, &datValue, 0);
+        }
+        if (ret != 0) {
+            ptxn->abort();
+            return error("%s : error %d writing the %u held back writes to %s", __func__, ret, writes.size(), strFile);
+        }
+    }
+    if (ptxn->commit(0) != 0)
+        return error("%s : failed to commit %u writes to %s", __func__, writes.size(), strFile);
+    return true;
+}
+
 void CDB::Close()
 {
     if (!pdb)
@@ -146,8 +224,8 @@ bool CDB::Rewrite(const Settings& settings,const std::string& strFile, const cha
                     Dbc* pcursor = db.GetCursor();
                     if (pcursor)
                         while (fSuccess) {
-                            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-                            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+                            CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
+                            CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
                             int ret = db.ReadAtCursor(pcursor, ssKey, ssValue, DB_NEXT);
                             if (ret == DB_NOTFOUND) {
                                 pcursor->close();
@@ -7,6 +7,7 @@
 #define BITCOIN_DB_H
 
 #include "clientversion.h"
+#include <DatabaseWriteBuffer.h>
 #include "serialize.h"
 #include "streams.h"
 #include "sync.h"
@@ -45,10 +46,18 @@ public:
     void Flush();
     void Close();
 
+    //! Write what the group commit on the file holds back, in one transaction
+    bool WriteBufferedWrites();
+
 private:
     CDB(const CDB&);
     void operator=(const CDB&);
 
+    //! Whether the write was held back in a group commit, with fResult what Write returns for it
+    bool BufferWrite(const CSecureDataStream& ssKey, const CSecureDataStream& ssValue, bool fOverwrite, bool& fResult);
+    bool BufferErase(const CSecureDataStream& ssKey);
+    DatabaseWriteBuffer::LookupResult LookupBufferedWrite(const CSecureDataStream& ssKey, CSerializeData& value) const;
+
 protected:
     template <typename K, typename T>
     bool Read(const K& key, T& value)
@@ -57,11 +66,30 @@ protected:
             return false;
 
         // Key
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
         Dbt datKey(&ssKey[0], ssKey.size());
 
+        // Writes held back in a group commit take the place of what is on disk
+        CSerializeData bufferedValue;
+        switch (LookupBufferedWrite(ssKey, bufferedValue)) {
+        case DatabaseWriteBuffer::BUFFERED_ERASE:
+            memset(datKey.get_data(), 0, datKey.get_size());
+            return false;
+        case DatabaseWriteBuffer::BUFFERED_WRITE:
+            memset(datKey.get_data(), 0, datKey.get_size());
+            try {
+                CSecureDataStream ssValue(bufferedValue.begin(), bufferedValue.end(), SER_DISK, CLIENT_VERSION);
+                ssValue >> value;
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        case DatabaseWriteBuffer::NOT_BUFFERED:
+            break;
+        }
+
         // Read
         Dbt datValue;
         datValue.set_flags(DB_DBT_MALLOC);
@@ -72,7 +100,7 @@ protected:
 
         // Unserialize value
         try {
-            CDataStream ssValue((char*)datValue.get_data(), (char*)datValue.get_data() + datValue.get_size(), SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue((char*)datValue.get_data(), (char*)datValue.get_data() + datValue.get_size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -93,15 +121,21 @@ protected:
             assert(!"Write called on database in read-only mode");
 
         // Key
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Value
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
         ssValue.reserve(10000);
         ssValue << value;
+        bool fBuffered = false;
+        if (BufferWrite(ssKey, ssValue, fOverwrite, fBuffered)) {
+            memset(&ssKey[0], 0, ssKey.size());
+            memset(&ssValue[0], 0, ssValue.size());
+            return fBuffered;
+        }
         Dbt datValue(&ssValue[0], ssValue.size());
 
         // Write
@@ -122,9 +156,13 @@ protected:
             assert(!"Erase called on database in read-only mode");
 
         // Key
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        if (BufferErase(ssKey)) {
+            memset(&ssKey[0], 0, ssKey.size());
+            return true;
+        }
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Erase
@@ -142,9 +180,15 @@ protected:
             return false;
 
         // Key
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        CSerializeData bufferedValue;
+        const DatabaseWriteBuffer::LookupResult buffered = LookupBufferedWrite(ssKey, bufferedValue);
+        if (buffered != DatabaseWriteBuffer::NOT_BUFFERED) {
+            memset(&ssKey[0], 0, ssKey.size());
+            return buffered == DatabaseWriteBuffer::BUFFERED_WRITE;
+        }
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Exists
@@ -166,7 +210,7 @@ protected:
         return pcursor;
     }
 
-    int ReadAtCursor(Dbc* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
+    int ReadAtCursor(Dbc* pcursor, CSecureDataStream& ssKey, CSecureDataStream& ssValue, unsigned int fFlags = DB_NEXT)
     {
         // Read at cursor
         Dbt datKey;
@@ -208,6 +252,9 @@ public:
     {
         if (!pdb || activeTxn)
             return false;
+        // Writes made in the transaction go past the group commit, so what it holds back goes first
+        if (!WriteBufferedWrites())
+            return false;
         DbTxn* ptxn = CDB::bitdb.TxnBegin();
         if (!ptxn)
             return false;
@@ -96,7 +96,7 @@ void CDBEnv::MakeMock()
 
     boost::this_thread::interruption_point();
 
-    LogPrint("db", "CDBEnv::MakeMock\n");
+    LogPrint(LOG_DB, "CDBEnv::MakeMock\n");
 
     dbenv.set_cachesize(1, 0, 1);
     dbenv.set_lg_bsize(10485760 * 4);
@@ -197,6 +197,73 @@ void CDBEnv::CheckpointLSN(const std::string& strFile)
 }
 
 
+bool CDBEnv::BeginGroupCommit(const std::string& strFile)
+{
+    LOCK(cs_writeBuffers);
+    std::map<std::string, std::pair<boost::thread::id, unsigned> >::iterator it = mapGroupCommits.find(strFile);
+    if (it == mapGroupCommits.end()) {
+        mapGroupCommits[strFile] = std::make_pair(boost::this_thread::get_id(), 1u);
+        return true;
+    }
+    if (it->second.first != boost::this_thread::get_id())
+        return false;
+    ++it->second.second;
+    return true;
+}
+
+void CDBEnv::EndGroupCommit(const std::string& strFile)
+{
+    LOCK(cs_writeBuffers);
+    std::map<std::string, std::pair<boost::thread::id, unsigned> >::iterator it = mapGroupCommits.find(strFile);
+    assert(it != mapGroupCommits.end() && it->second.first == boost::this_thread::get_id() && it->second.second > 0);
+    if (--it->second.second == 0)
+        mapGroupCommits.erase(it);
+}
+
+bool CDBEnv::BufferWrite(const std::string& strFile, const CSerializeData& key, const CSerializeData& value, size_t& nBufferedWrites)
+{
+    LOCK(cs_writeBuffers);
+    std::map<std::string, std::pair<boost::thread::id, unsigned> >::const_iterator it = mapGroupCommits.find(strFile);
+    if (it == mapGroupCommits.end() || it->second.first != boost::this_thread::get_id())
+        return false;
+    DatabaseWriteBuffer& buffer = mapWriteBuffers[strFile];
+    buffer.Write(key, value);
+    nBufferedWrites = buffer.size();
+    return true;
+}
+
+bool CDBEnv::BufferErase(const std::string& strFile, const CSerializeData& key, size_t& nBufferedWrites)
+{
+    LOCK(cs_writeBuffers);
+    std::map<std::string, std::pair<boost::thread::id, unsigned> >::const_iterator it = mapGroupCommits.find(strFile);
+    if (it == mapGroupCommits.end() || it->second.first != boost::this_thread::get_id())
+        return false;
+    DatabaseWriteBuffer& buffer = mapWriteBuffers[strFile];
+    buffer.Erase(key);
+    nBufferedWrites = buffer.size();
+    return true;
+}
+
+DatabaseWriteBuffer::LookupResult CDBEnv::LookupBufferedWrite(const std::string& strFile, const CSerializeData& key, CSerializeData& value) const
+{
+    LOCK(cs_writeBuffers);
+    std::map<std::string, DatabaseWriteBuffer>::const_iterator it = mapWriteBuffers.find(strFile);
+    if (it == mapWriteBuffers.end())
+        return DatabaseWriteBuffer::NOT_BUFFERED;
+    return it->second.Lookup(key, value);
+}
+
+void CDBEnv::TakeBufferedWrites(const std::string& strFile, DatabaseWriteBuffer& writes)
+{
+    LOCK(cs_writeBuffers);
+    writes.clear();
+    std::map<std::string, DatabaseWriteBuffer>::iterator it = mapWriteBuffers.find(strFile);
+    if (it == mapWriteBuffers.end())
+        return;
+    writes.swap(it->second);
+    mapWriteBuffers.erase(it);
+}
+
 void CDBEnv::CloseDb(const std::string& strFile)
 {
     {
@@ -224,7 +291,7 @@ void CDBEnv::Flush(bool fShutdown)
 {
     int64_t nStart = GetTimeMillis();
     // Flush log data to the actual data file on all files that are not in use
-    LogPrint("db", "CDBEnv::Flush : Flush(%s)%s\n", fShutdown ? "true" : "false", fDbEnvInit ? "" : " database not started");
+    LogPrint(LOG_DB, "CDBEnv::Flush : Flush(%s)%s\n", fShutdown ? "true" : "false", fDbEnvInit ? "" : " database not started");
     if (!fDbEnvInit)
         return;
     {
@@ -233,21 +300,21 @@ void CDBEnv::Flush(bool fShutdown)
         while (mi != mapFileUseCount.end()) {
             std::string strFile = (*mi).first;
             int nRefCount = (*mi).second;
-            LogPrint("db", "CDBEnv::Flush : Flushing %s (refcount = %d)...\n", strFile, nRefCount);
+            LogPrint(LOG_DB, "CDBEnv::Flush : Flushing %s (refcount = %d)...\n", strFile, nRefCount);
             if (nRefCount == 0) {
                 // Move log data to the dat file
                 CloseDb(strFile);
-                LogPrint("db", "CDBEnv::Flush : %s checkpoint\n", strFile);
+                LogPrint(LOG_DB, "CDBEnv::Flush : %s checkpoint\n", strFile);
                 dbenv.txn_checkpoint(0, 0, 0);
-                LogPrint("db", "CDBEnv::Flush : %s detach\n", strFile);
+                LogPrint(LOG_DB, "CDBEnv::Flush : %s detach\n", strFile);
                 if (!fMockDb)
                     dbenv.lsn_reset(strFile.c_str(), 0);
-                LogPrint("db", "CDBEnv::Flush : %s closed\n", strFile);
+                LogPrint(LOG_DB, "CDBEnv::Flush : %s closed\n", strFile);
                 mapFileUseCount.erase(mi++);
             } else
                 mi++;
         }
-        LogPrint("db", "CDBEnv::Flush : Flush(%s)%s took %15dms\n", fShutdown ? "true" : "false", fDbEnvInit ? "" : " database not started", GetTimeMillis() - nStart);
+        LogPrint(LOG_DB, "CDBEnv::Flush : Flush(%s)%s took %15dms\n", fShutdown ? "true" : "false", fDbEnvInit ? "" : " database not started", GetTimeMillis() - nStart);
         if (fShutdown) {
             char** listp;
             if (mapFileUseCount.empty()) {
@@ -7,9 +7,11 @@
 #include <vector>
 
 #include <db_cxx.h>
+#include <DatabaseWriteBuffer.h>
 #include <sync.h>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/thread/thread.hpp>
 
 class CDBEnv
 {
@@ -19,6 +21,10 @@ private:
     // Don't change into boost::filesystem::path, as that can result in
     // shutdown problems/crashes caused by a static initialized internal pointer.
     std::string strPath;
+    mutable CCriticalSection cs_writeBuffers;
+    //! The thread that holds back the writes to a file, and how deep its group commits nest
+    std::map<std::string, std::pair<boost::thread::id, unsigned> > mapGroupCommits;
+    std::map<std::string, DatabaseWriteBuffer> mapWriteBuffers;
 
     void EnvShutdown();
 
@@ -61,6 +67,21 @@ public:
     void CloseDb(const std::string& strFile);
     bool RemoveDb(const std::string& strFile);
 
+    /**
+     * Group commits hold back the writes one thread makes to a file while any
+     * of them lasts, so they can be written in a single transaction. Other
+     * threads keep writing straight to the file meanwhile; a group commit
+     * they begin does not hold anything back, and BeginGroupCommit tells so.
+     */
+    bool BeginGroupCommit(const std::string& strFile);
+    void EndGroupCommit(const std::string& strFile);
+    //! Hold back the write in the file's group commit, false when there is none on this thread
+    bool BufferWrite(const std::string& strFile, const CSerializeData& key, const CSerializeData& value, size_t& nBufferedWrites);
+    bool BufferErase(const std::string& strFile, const CSerializeData& key, size_t& nBufferedWrites);
+    DatabaseWriteBuffer::LookupResult LookupBufferedWrite(const std::string& strFile, const CSerializeData& key, CSerializeData& value) const;
+    //! Hand over the writes held back for the file, which are then no longer buffered
+    void TakeBufferedWrites(const std::string& strFile, DatabaseWriteBuffer& writes);
+
     DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC)
     {
         DbTxn* ptxn = NULL;
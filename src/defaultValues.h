@@ -17,6 +17,15 @@ constexpr int64_t DEFAULT_DB_CACHE_SIZE = 100;
 constexpr int64_t MAX_DB_CACHE_SIZE = sizeof(void*) > 4 ? 4096 : 1024;
 //! min. -dbcache in (MiB)
 constexpr int64_t MIN_DB_CACHE_SIZE = 4;
+//! -dbmaxopenfiles default, table files the coin database keeps open
+constexpr int DEFAULT_DB_MAX_OPEN_FILES = 64;
+//! min. -dbmaxopenfiles
+constexpr int MIN_DB_MAX_OPEN_FILES = 16;
+
+//! -maxsigcachesize default (MiB)
+constexpr int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+//! max. -maxsigcachesize (MiB)
+constexpr int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
 //! -maxtxfee default
 constexpr CAmount DEFAULT_TRANSACTION_MAXFEE = 100 * COIN;
@@ -36,6 +45,8 @@ constexpr unsigned int DEFAULT_BLOCK_MAX_SIZE = 750000;
 constexpr unsigned int DEFAULT_BLOCK_MIN_SIZE = 0;
 /** Default for -blockprioritysize, maximum space for zero/low-fee transactions **/
 constexpr unsigned int DEFAULT_BLOCK_PRIORITY_SIZE = 50000;
+/** Default for -blockselectpackages, filling blocks by the fee rate of transactions together with their unconfirmed ancestors **/
+constexpr bool DEFAULT_BLOCK_SELECT_PACKAGES = false;
 /** Default for accepting alerts from the P2P network. */
 constexpr bool DEFAULT_ALERTS = true;
 /** The maximum size for transactions we're willing to relay/mine */
@@ -50,12 +61,30 @@ constexpr unsigned int MAX_TX_SIGOPS_CURRENT = MAX_BLOCK_SIGOPS_CURRENT / 5;
 constexpr unsigned int MAX_TX_SIGOPS_LEGACY = MAX_BLOCK_SIGOPS_LEGACY / 5;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 constexpr unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -maxorphanpeersize, maximum bytes of orphan transactions kept for a single peer */
+constexpr unsigned int DEFAULT_MAX_ORPHAN_PEER_BYTES = 100000;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 constexpr unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 constexpr unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
+/** Number of blk?????.dat files kept memory-mapped for reading blocks */
+constexpr unsigned int MAX_MAPPED_BLOCK_FILES = 8;
+/** Recently read blocks, and as many undo records, kept deserialized for the next reader */
+constexpr unsigned int BLOCK_DATA_CACHE_ENTRIES = 128;
+/** Transactions recently read out of blocks by GetTransaction, kept for the next lookup of the same ones */
+constexpr unsigned int TRANSACTION_CACHE_ENTRIES = 1024;
+/** Bytes of a cold blk?????.dat file compressed as a unit, so reads only decompress what they need */
+constexpr uint32_t BLOCKFILE_COMPRESSION_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Decompressed chunks of compressed block files kept for the next reads */
+constexpr unsigned int COMPRESSED_BLOCKFILE_CACHED_CHUNKS = 8;
+/** -compressblockfiles default: depth below which block files get compressed (0 = never) */
+constexpr int DEFAULT_COMPRESS_BLOCK_FILES_DEPTH = 0;
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 constexpr unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Blocks below the tip whose block and undo files are never pruned, unless reorgs go deeper */
+constexpr int MIN_BLOCKS_TO_KEEP = 288;
+/** Smallest -prune target; the blk/rev files of MIN_BLOCKS_TO_KEEP blocks plus their pre-allocated chunks have to fit */
+constexpr uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
 /** Coinbase transaction outputs can only be spent after this number of new blocks (network rule) */
 constexpr int COINBASE_MATURITY = 100;
 /** Threshold for nLockTime: below this value it is interpreted as block number, otherwise as UNIX timestamp. */
@@ -64,13 +93,87 @@ constexpr unsigned int LOCKTIME_THRESHOLD = 500000000; // Tue Nov  5 00:53:20 19
 constexpr int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 constexpr int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads looking up batches of coins in the coin database */
+constexpr int MAX_COINS_LOOKUP_THREADS = 16;
+/** -coinslookupthreads default; lookups mostly wait on disk, so this does not depend on the cores */
+constexpr int DEFAULT_COINS_LOOKUP_THREADS = 4;
+/** Maximum number of threads hashing stake kernels */
+constexpr int MAX_STAKING_THREADS = 16;
+/** -stakingthreads default (number of threads hashing stake kernels, 0 = one per core) */
+constexpr int DEFAULT_STAKING_THREADS = 0;
+/** Maximum number of threads scanning block files during -reindex */
+constexpr int MAX_REINDEX_THREADS = 16;
+/** -reindexthreads default (0 = scan the block files on the import thread, one by one) */
+constexpr int DEFAULT_REINDEX_THREADS = 0;
+/** Maximum number of threads processing peer messages */
+constexpr int MAX_MESSAGE_HANDLER_THREADS = 16;
+/** -msghandthreads default; each thread serves its own share of the peers */
+constexpr int DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+/** Blocks each reindex scanning thread may have deserialized ahead of validation */
+constexpr unsigned int REINDEX_QUEUED_BLOCKS_PER_FILE = 64;
+/** Maximum number of threads reading blocks ahead of a wallet rescan */
+constexpr int MAX_RESCAN_THREADS = 16;
+/** -rescanthreads default (0 = read the blocks on the rescanning thread); reading mostly waits on disk */
+constexpr int DEFAULT_RESCAN_THREADS = 4;
+/** Blocks each rescan reading thread may have read ahead of the rescan */
+constexpr unsigned int RESCAN_BLOCKS_AHEAD_PER_THREAD = 16;
+/** Writes a wallet database group commit holds back before writing them out, keeping its transaction within the lock limits */
+constexpr unsigned int MAX_GROUP_COMMIT_WRITES = 1000;
+/** Keys the keypool maintainer derives and writes before letting go of the wallet lock */
+constexpr unsigned int KEYPOOL_TOPUP_BATCH_SIZE = 100;
+/** Recipients sendpayouts pays in each of its transactions when it is not told otherwise */
+constexpr unsigned int DEFAULT_PAYOUTS_PER_TRANSACTION = 250;
+/** Seconds the dust combiner waits after a round before it looks for dust again */
+constexpr int64_t DUST_COMBINE_INTERVAL = 10 * 60;
+/** Transactions the dust combiner sends in one round at most */
+constexpr unsigned int DUST_COMBINE_MAX_TRANSACTIONS_PER_ROUND = 5;
+/** Bytes a dust combining transaction is kept under, so its inputs need not be split up again */
+constexpr unsigned int DUST_COMBINE_MAX_TRANSACTION_SIZE = 50000;
+/** Blocks the fee estimate the dust combiner goes by is for */
+constexpr int DUST_COMBINE_FEE_ESTIMATE_BLOCKS = 10;
+/** Multiple of the relay fee above which the mempool is considered too busy to combine dust */
+constexpr int64_t DUST_COMBINE_MAX_FEE_RATE_MULTIPLE = 2;
+/** Scripts the wallet remembers the ownership of before it starts over */
+constexpr unsigned int ISMINE_CACHE_MAX_SCRIPTS = 50000;
 /** Number of blocks that can be requested at any given time from a single peer. */
 constexpr int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Blocks this far below the tip or deeper are sent in full when asked for as compact blocks */
+constexpr int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Blocks this far below the tip or deeper have their transactions sent in full rather than picked out */
+constexpr int MAX_BLOCKTXN_DEPTH = 10;
+/** Blocks this far below the tip or deeper are filtered for SPV peers without being prepared once for all of them */
+constexpr int MAX_FILTERABLE_BLOCK_DEPTH = 10;
+/** Recent blocks kept prepared for the filters of SPV peers */
+constexpr size_t MAX_CACHED_FILTERABLE_BLOCKS = 8;
+/** -maxuploadrate default in KB/s, where 0 is unlimited */
+constexpr int64_t DEFAULT_MAX_UPLOAD_RATE = 0;
+/** -maxpeeruploadrate default in KB/s, where 0 is unlimited */
+constexpr int64_t DEFAULT_MAX_PEER_UPLOAD_RATE = 0;
+/** -compresswhitelisted default: whether the traffic with whitelisted peers is compressed when they support it */
+constexpr bool DEFAULT_COMPRESS_WHITELISTED = false;
+/** Seconds of the upload rate that may go out in one burst */
+constexpr int64_t UPLOAD_BURST_SECONDS = 10;
+/** Seconds a block may be older than the tip before serving it waits for the upload limits */
+constexpr int64_t HISTORICAL_BLOCK_AGE = 24 * 60 * 60;
+/** -rpcthreads default, the number of threads serving RPC connections */
+constexpr int64_t DEFAULT_RPC_THREADS = 4;
+/** -rpcworkqueue default, the number of RPC connections that may wait for a thread */
+constexpr int64_t DEFAULT_RPC_WORK_QUEUE_DEPTH = 16;
+/** -rpcbatchthreads default, the number of threads helping to run the requests of a batch */
+constexpr int64_t DEFAULT_RPC_BATCH_THREADS = 4;
+/** -rpcservertimeout default in seconds, for reading a request or waiting on an idle connection */
+constexpr int64_t DEFAULT_RPC_SERVER_TIMEOUT = 30;
+/** -rpccachesize default in MiB, for the replies about blocks deep enough not to change, 0 to cache none */
+constexpr int64_t DEFAULT_RPC_CACHE_SIZE = 32;
+/** -rpccachedepth default, the confirmations a block needs before replies about it are cached */
+constexpr int64_t DEFAULT_RPC_CACHE_DEPTH = 100;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 constexpr unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached their tip. Changing this value is a protocol upgrade. */
 constexpr unsigned int MAX_HEADERS_RESULTS = 2000;
+/** Number of blocks a getcfilters request may ask the filters of */
+constexpr unsigned int MAX_GETCFILTERS_SIZE = 1000;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -81,8 +184,47 @@ constexpr unsigned int DATABASE_WRITE_INTERVAL = 3600;
 /** Maximum length of reject messages. */
 constexpr unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 
+/** Default for -checkblocks, number of latest blocks the coin database is verified against after startup */
+constexpr int DEFAULT_CHECKBLOCKS = 100;
+/** Default for -parallelstartup, whether files independent of the block index load while it does */
+constexpr bool DEFAULT_PARALLEL_STARTUP = true;
+/** Default for -checkblockindexsample, number of active chain entries re-verified per tip change */
+constexpr unsigned int DEFAULT_CHECKBLOCKINDEX_SAMPLE = 100;
+/** Default for -lockprofilesampling, one in how many lock acquisitions are timed; 0 turns the lock profiler off */
+constexpr unsigned int DEFAULT_LOCK_PROFILE_SAMPLING = 0;
+/** Default for -asynclogging, whether debug.log is written from a thread of its own. Off, as queued messages are lost on a crash */
+constexpr bool DEFAULT_ASYNC_LOGGING = false;
+/** Default for -logqueuesize, messages queued for that thread before further ones are dropped */
+constexpr unsigned int DEFAULT_LOG_QUEUE_SIZE = 16384;
+/** Default for -debugratelimit, messages of a debug category logged per second; 0 for no limit */
+constexpr unsigned int DEFAULT_DEBUG_RATE_LIMIT = 0;
+
 constexpr bool DEFAULT_ADDRESSINDEX = false;
 constexpr bool DEFAULT_SPENTINDEX = false;
+constexpr bool DEFAULT_BLOCKFILTERINDEX = false;
+constexpr bool DEFAULT_BLOCKSTATSINDEX = false;
+constexpr bool DEFAULT_SUPPLYINDEX = false;
+constexpr bool DEFAULT_VAULTINDEX = false;
+/** -indexbuildlag default: blocks an index built in the background stays behind the tip until it takes over from there */
+constexpr int DEFAULT_INDEX_BUILD_LAG = 6;
+/** -indexbuildrate default: blocks per second an index is built at in the background (0 = as fast as the disk allows) */
+constexpr int DEFAULT_INDEX_BUILD_RATE = 0;
+/** -persistmempool default: dump the mempool on shutdown and reload it on startup */
+constexpr bool DEFAULT_PERSIST_MEMPOOL = true;
+/** -maxmempool default: megabytes of memory the mempool may use before evicting its lowest fee rate packages */
+constexpr unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** -limitancestorcount default: most in-pool ancestors, itself included, a transaction may have; high enough for the staking vault's chains of 40 */
+constexpr unsigned int DEFAULT_ANCESTOR_LIMIT = 50;
+/** -limitancestorsize default: most kilobytes a transaction and its in-pool ancestors may take */
+constexpr unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 101;
+/** -limitdescendantcount default: most in-pool descendants, itself included, a transaction may have */
+constexpr unsigned int DEFAULT_DESCENDANT_LIMIT = 50;
+/** -limitdescendantsize default: most kilobytes a transaction and its in-pool descendants may take */
+constexpr unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
+/** Most transactions a single page of getaddresstxids or getaddressdeltas may ask for */
+constexpr unsigned int MAX_ADDRESS_INDEX_PAGE_TRANSACTIONS = 10000;
+/** Most unspent outputs a single page of getaddressutxos may ask for */
+constexpr unsigned int MAX_ADDRESS_UNSPENT_PAGE_OUTPUTS = 10000;
 
 /** Enable bloom filter */
  constexpr bool DEFAULT_PEERBLOOMFILTERS = true;
@@ -12,6 +12,10 @@
 #include "utiltime.h"
 #include "Logging.h"
 #include "DataDirectory.h"
+#include "util.h"
+
+#include <algorithm>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -39,35 +43,46 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
+    //! Bytes hashed at a time when checking a file
+    static const size_t HASH_CHUNK_SIZE = 64 * 1024;
+
     bool Write(const T& objToSave)
     {
         // LOCK(objToSave.cs);
 
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        // The file is written next to the old one and replaces it once complete,
+        // so a failed write leaves the old file in place
+        boost::filesystem::path pathTmp = pathDB;
+        pathTmp += ".new";
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-        // Write and commit header, data
+        // serialize straight to the file, checksum data up to that point, then append checksum
         try {
-            fileout << ssObj;
+            CHashingWriter<CAutoFile> hashedOut(&fileout, SER_DISK, CLIENT_VERSION);
+            hashedOut << strMagicMessage; // specific magic message for this type of object
+            hashedOut << FLATDATA(Params().MessageStart()); // network specific magic number
+            hashedOut << objToSave;
+            uint256 hash = hashedOut.GetHash();
+            fileout << hash;
         }
         catch (std::exception &e) {
+            fileout.fclose();
+            boost::filesystem::remove(pathTmp);
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed for %s", __func__, pathDB.string());
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
@@ -88,43 +103,53 @@ private:
             return FileError;
         }
 
-        // use file size to size memory buffer
-        int fileSize = boost::filesystem::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
+        // use file size to tell the data from the checksum that follows it
+        int64_t fileSize = boost::filesystem::file_size(pathDB);
+        int64_t dataSize = fileSize - sizeof(uint256);
+        // Don't try to read a negative number of bytes if file is small
         if (dataSize < 0)
             dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
-        uint256 hashIn;
 
-        // read data and checksum from file
+        // hash the data chunk by chunk and read the checksum
+        uint256 hashIn;
+        uint256 hashTmp;
         try {
-            filein.read((char *)&vchData[0], dataSize);
+            CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+            std::vector<char> chunk(std::min<int64_t>(HASH_CHUNK_SIZE, std::max<int64_t>(dataSize, 1)));
+            for (int64_t remaining = dataSize; remaining > 0;)
+            {
+                const size_t chunkSize = std::min<int64_t>(remaining, chunk.size());
+                filein.read(&chunk[0], chunkSize);
+                hasher.write(&chunk[0], chunkSize);
+                remaining -= chunkSize;
+            }
             filein >> hashIn;
+            hashTmp = hasher.GetHash();
         }
         catch (std::exception &e) {
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return HashReadError;
         }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
 
         // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
         if (hashIn != hashTmp)
         {
             error("%s: Checksum mismatch, data corrupted", __func__);
             return IncorrectHash;
         }
 
+        // the data is then read a second time, straight from the file
+        if (fseek(filein.Get(), 0, SEEK_SET) != 0)
+        {
+            error("%s: Failed to rewind file %s", __func__, pathDB.string());
+            return HashReadError;
+        }
 
         unsigned char pchMsgTmp[4];
         std::string strMagicMessageTmp;
         try {
             // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
+            filein >> strMagicMessageTmp;
 
             // ... verify the message matches predefined one
             if (strMagicMessage != strMagicMessageTmp)
@@ -135,7 +160,7 @@ private:
 
 
             // de-serialize file header (network specific magic number) and ..
-            ssObj >> FLATDATA(pchMsgTmp);
+            filein >> FLATDATA(pchMsgTmp);
 
             // ... verify the network matches ours
             if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
@@ -144,14 +169,21 @@ private:
                 return IncorrectMagicNumber;
             }
 
+            // checking the format of an existing file only needs its header
+            if (fDryRun)
+                return Ok;
+
             // de-serialize data into T object
-            ssObj >> objToLoad;
+            filein >> objToLoad;
+            if (ftell(filein.Get()) > dataSize)
+                throw std::ios_base::failure("object runs into the checksum");
         }
         catch (std::exception &e) {
             objToLoad.Clear();
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return IncorrectFormat;
         }
+        filein.fclose();
 
         LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToLoad.ToString());
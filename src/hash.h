@@ -10,6 +10,7 @@
 
 #include "crypto/ripemd160.h"
 #include "crypto/sha256.h"
+#include "prevector.h"
 #include "serialize.h"
 #include "uint256.h"
 #include "version.h"
@@ -217,6 +218,13 @@ inline uint160 Hash160(const std::vector<unsigned char>& vch)
     return Hash160(vch.begin(), vch.end());
 }
 
+/** Compute the 160-bit hash of a prevector, such as a script. */
+template <unsigned int N>
+inline uint160 Hash160(const prevector<N, unsigned char>& vch)
+{
+    return Hash160(vch.begin(), vch.end());
+}
+
 /** A writer stream (for serialization) that computes a 256-bit hash. */
 class CHashWriter
 {
@@ -252,6 +260,32 @@ public:
     }
 };
 
+/** A writer stream (for serialization) that passes the data on to another stream while hashing it. */
+template <typename Sink>
+class CHashingWriter : public CHashWriter
+{
+private:
+    Sink* sink;
+
+public:
+    CHashingWriter(Sink* sinkIn, int nTypeIn, int nVersionIn) : CHashWriter(nTypeIn, nVersionIn), sink(sinkIn) {}
+
+    CHashingWriter<Sink>& write(const char* pch, size_t size)
+    {
+        sink->write(pch, size);
+        CHashWriter::write(pch, size);
+        return (*this);
+    }
+
+    template <typename T>
+    CHashingWriter<Sink>& operator<<(const T& obj)
+    {
+        // Serialize to this stream
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 /** Compute the 256-bit hash of an object's serialization. */
 template <typename T>
 uint256 SerializeHash(const T& obj, int nType = SER_GETHASH, int nVersion = PROTOCOL_VERSION)
@@ -261,6 +295,7 @@ uint256 SerializeHash(const T& obj, int nType = SER_GETHASH, int nVersion = PROT
     return ss.GetHash();
 }
 
+unsigned int MurmurHash3(unsigned int nHashSeed, const unsigned char* pDataToHash, size_t nDataSize);
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char>& vDataToHash);
 
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
@@ -282,8 +317,8 @@ inline uint256 HashQuark(const T1 pbegin, const T1 pend)
     sph_skein512_context ctx_skein;
     static unsigned char pblank[1];
 
-    uint512 mask = 8;
-    uint512 zero = 0;
+    // Bit 3 of each branching hash picks the next kernel
+    const uint64_t mask = 8;
 
     uint512 hash[9];
 
@@ -297,7 +332,7 @@ inline uint256 HashQuark(const T1 pbegin, const T1 pend)
     sph_bmw512(&ctx_bmw, static_cast<const void*>(&hash[0]), 64);
     sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[1]));
 
-    if ((hash[1] & mask) != zero) {
+    if (hash[1].GetLow64() & mask) {
         sph_groestl512_init(&ctx_groestl);
         // ZGROESTL;
         sph_groestl512(&ctx_groestl, static_cast<const void*>(&hash[1]), 64);
@@ -319,7 +354,7 @@ inline uint256 HashQuark(const T1 pbegin, const T1 pend)
     sph_jh512(&ctx_jh, static_cast<const void*>(&hash[3]), 64);
     sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[4]));
 
-    if ((hash[4] & mask) != zero) {
+    if (hash[4].GetLow64() & mask) {
         sph_blake512_init(&ctx_blake);
         // ZBLAKE;
         sph_blake512(&ctx_blake, static_cast<const void*>(&hash[4]), 64);
@@ -341,7 +376,7 @@ inline uint256 HashQuark(const T1 pbegin, const T1 pend)
     sph_skein512(&ctx_skein, static_cast<const void*>(&hash[6]), 64);
     sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[7]));
 
-    if ((hash[7] & mask) != zero) {
+    if (hash[7].GetLow64() & mask) {
         sph_keccak512_init(&ctx_keccak);
         // ZKECCAK;
         sph_keccak512(&ctx_keccak, static_cast<const void*>(&hash[7]), 64);
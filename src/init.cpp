@@ -13,18 +13,23 @@
 
 #include "amount.h"
 #include "BlockFileOpener.h"
+#include <BlockImportStats.h>
 #include <chainparams.h>
 #include "checkpoints.h"
 #include "compat/sanity.h"
+#include "crypto/sha256.h"
 #include "datacachemanager.h"
 #include <defaultValues.h>
 #include "key.h"
+#include <LockProfiler.h>
 #include "main.h"
 #include "obfuscation.h"
 #include <WalletBackupFeatureContainer.h>
 #include "miner.h"
 #include "net.h"
 #include "rpcserver.h"
+#include "script/sigcache.h"
+#include <UtxoCheckingAndUpdating.h>
 #include "script/standard.h"
 #include "spork.h"
 #include "sporkdb.h"
@@ -36,21 +41,26 @@
 #include "NotificationInterface.h"
 #include "FeeAndPriorityCalculator.h"
 #include <Settings.h>
+#include <StartupStages.h>
 #include <MasternodeModule.h>
 #include <functional>
 #include <uiMessenger.h>
-#include <ActiveChainManager.h>
-#include <BlockDiskAccessor.h>
 #include <TransactionInputChecker.h>
+#include <MempoolSignaturePrevalidator.h>
+#include <MasternodeSignaturePrevalidator.h>
 #include <txmempool.h>
+#include <CompressedBlockFile.h>
+#include <BackgroundIndexBuilder.h>
 
 #ifdef ENABLE_WALLET
 #include "db.h"
 #include "wallet.h"
 #include "walletdb.h"
 #include <WalletTx.h>
+#include <walletdustcombiner.h>
 #endif
 
+#include <atomic>
 #include <fstream>
 #include <stdint.h>
 #include <stdio.h>
@@ -71,12 +81,22 @@
 #endif
 
 #include <ValidationState.h>
-#include <verifyDb.h>
+#include <CoinsViewWriteBuffer.h>
 
 #ifdef ENABLE_WALLET
 CWallet* pwalletMain = NULL;
+std::vector<CWallet*> vpwallets;
 constexpr int nWalletBackups = 20;
 
+CWallet* FindWallet(const std::string& strWalletFile)
+{
+    BOOST_FOREACH (CWallet* pwallet, vpwallets) {
+        if (pwallet->strWalletFile == strWalletFile)
+            return pwallet;
+    }
+    return NULL;
+}
+
 /**
  * Wallet Settings
  */
@@ -87,9 +107,16 @@ extern Settings& settings;
 extern bool fReindex;
 extern bool fImporting;
 extern bool fCheckBlockIndex;
+extern unsigned int nCheckBlockIndexSample;
+extern uint256 hashAssumeValid;
+extern bool fHeadersFirstSync;
 extern int nScriptCheckThreads;
 extern int nCoinCacheSize;
+extern size_t nCoinCacheUsage;
 extern bool fTxIndex;
+extern bool fPruneMode;
+extern bool fHavePruned;
+extern uint64_t nPruneTarget;
 extern bool fVerifyingBlocks;
 extern bool fLiteMode;
 extern BlockMap mapBlockIndex;
@@ -98,6 +125,8 @@ extern Settings& settings;
 extern NotificationInterfaceRegistry registry;
 extern CBlockTreeDB* pblocktree;
 extern CCoinsViewCache* pcoinsTip;
+extern CoinsViewWriteBuffer* pcoinsWriteBuffer;
+extern CCoinsViewDB* pcoinsdbview;
 #if ENABLE_ZMQ
 static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
 #endif
@@ -108,8 +137,16 @@ static const CAmount nHighTransactionFeeWarning = 0.1 * COIN;
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
 
 constexpr char FEE_ESTIMATES_FILENAME[] = "fee_estimates.dat";
+constexpr char MEMPOOL_FILENAME[] = "mempool.dat";
+//! Transactions reloaded into the mempool per cs_main lock
+constexpr unsigned int MEMPOOL_LOAD_BATCH_SIZE = 100;
 CClientUIInterface uiInterface;
 extern bool fAddressIndex;
+extern bool fSpentIndex;
+extern bool fBlockFilterIndex;
+extern bool fBlockStatsIndex;
+extern bool fSupplyIndex;
+extern bool fVaultIndex;
 
 bool static InitError(const std::string& str)
 {
@@ -167,6 +204,18 @@ bool MainShutdownRequested()
 
 class CCoinsViewErrorCatcher : public CCoinsViewBacked
 {
+private:
+    [[noreturn]] static void AbortOnReadError(const std::runtime_error& e)
+    {
+        uiInterface.ThreadSafeMessageBox(translate("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
+        LogPrintf("Error reading from database: %s\n", e.what());
+        // Starting the shutdown sequence and returning false to the caller would be
+        // interpreted as 'entry not found' (as opposed to unable to read data), and
+        // could lead to invalid interpration. Just exit immediately, as we can't
+        // continue anyway, and all writes should be atomic.
+        abort();
+    }
+
 public:
     CCoinsViewErrorCatcher(CCoinsView* view) : CCoinsViewBacked(view) {}
     bool GetCoins(const uint256& txid, CCoins& coins) const
@@ -174,19 +223,20 @@ public:
         try {
             return CCoinsViewBacked::GetCoins(txid, coins);
         } catch (const std::runtime_error& e) {
-            uiInterface.ThreadSafeMessageBox(translate("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
-            LogPrintf("Error reading from database: %s\n", e.what());
-            // Starting the shutdown sequence and returning false to the caller would be
-            // interpreted as 'entry not found' (as opposed to unable to read data), and
-            // could lead to invalid interpration. Just exit immediately, as we can't
-            // continue anyway, and all writes should be atomic.
-            abort();
+            AbortOnReadError(e);
+        }
+    }
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+    {
+        try {
+            CCoinsViewBacked::GetCoinsBatch(txids, coins);
+        } catch (const std::runtime_error& e) {
+            AbortOnReadError(e);
         }
     }
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB* pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher* pcoinscatcher = NULL;
 
 #ifdef ENABLE_WALLET
@@ -238,14 +288,110 @@ void SaveFeeEstimatesFromMempool()
     }
 }
 
+//! Set once the mempool.dat of the last run has been reloaded, so dumping the pool cannot lose part of it
+static std::atomic<bool> fMempoolReloaded(false);
+
+void LoadMempoolFromDisk()
+{
+    if (!settings.GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        return;
+
+    boost::filesystem::path mempool_path = GetDataDir() / MEMPOOL_FILENAME;
+    CAutoFile filein(fopen(mempool_path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    // Allowed to fail as this file IS missing on first startup.
+    if (filein.IsNull()) {
+        fMempoolReloaded = true;
+        return;
+    }
+
+    const int64_t nStart = GetTimeMillis();
+    unsigned int nAccepted = 0;
+    unsigned int nFailed = 0;
+    unsigned int nAlreadyThere = 0;
+    try {
+        uint64_t nVersion;
+        filein >> nVersion;
+        if (nVersion != MEMPOOL_DUMP_VERSION) {
+            LogPrintf("%s: unknown version %d of %s, not reloading it\n", __func__, nVersion, mempool_path.string());
+            fMempoolReloaded = true;
+            return;
+        }
+        uint64_t nTransactions;
+        filein >> nTransactions;
+        while (nTransactions > 0) {
+            {
+                // cs_main is released between batches, so blocks keep being processed
+                LOCK(cs_main);
+                for (unsigned int n = 0; n < MEMPOOL_LOAD_BATCH_SIZE && nTransactions > 0; n++, nTransactions--) {
+                    CDumpedMempoolEntry entry;
+                    filein >> entry;
+                    const uint256 hash = entry.tx.GetHash();
+                    if (entry.dPriorityDelta != 0 || entry.nFeeDelta != 0)
+                        mempool.PrioritiseTransaction(hash, hash.ToString(), entry.dPriorityDelta, entry.nFeeDelta);
+
+                    CValidationState state;
+                    if (mempool.exists(hash))
+                        nAlreadyThere++;
+                    else if (AcceptToMemoryPoolWithTime(mempool, state, entry.tx, true, NULL, entry.nTime))
+                        nAccepted++;
+                    else
+                        nFailed++;
+                }
+            }
+            if (ShutdownRequested())
+                return;
+        }
+        std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+        filein >> mapDeltas;
+        for (const auto& deltas : mapDeltas)
+            mempool.PrioritiseTransaction(deltas.first, deltas.first.ToString(), deltas.second.first, deltas.second.second);
+    } catch (const std::exception& e) {
+        LogPrintf("%s: failed to read %s (%s), reloaded what came before\n", __func__, mempool_path.string(), e.what());
+    }
+    LogPrintf("Reloaded the mempool: %u transactions accepted, %u failed, %u already there (%dms)\n",
+              nAccepted, nFailed, nAlreadyThere, GetTimeMillis() - nStart);
+    fMempoolReloaded = true;
+}
+
+void SaveMempoolToDisk()
+{
+    if (!settings.GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        return;
+    if (!fMempoolReloaded) {
+        LogPrintf("%s: the mempool was not reloaded yet, keeping the previous %s\n", __func__, MEMPOOL_FILENAME);
+        return;
+    }
+
+    const int64_t nStart = GetTimeMillis();
+    boost::filesystem::path mempool_path = GetDataDir() / MEMPOOL_FILENAME;
+    boost::filesystem::path mempool_path_new = GetDataDir() / (std::string(MEMPOOL_FILENAME) + ".new");
+    CAutoFile fileout(fopen(mempool_path_new.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        LogPrintf("%s: Failed to write the mempool to %s\n", __func__, mempool_path_new.string());
+        return;
+    }
+    if (!mempool.WriteTransactions(fileout))
+        return;
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    if (!RenameOver(mempool_path_new, mempool_path)) {
+        LogPrintf("%s: Failed to rename %s to %s\n", __func__, mempool_path_new.string(), mempool_path.string());
+        return;
+    }
+    LogPrintf("Dumped the mempool to %s (%dms)\n", mempool_path.string(), GetTimeMillis() - nStart);
+}
+
 void DeallocateShallowDatabases()
 {
+    ReleaseCoinsSnapshot();
     delete pcoinsTip;
+    delete pcoinsWriteBuffer;
     delete pcoinscatcher;
     delete pcoinsdbview;
     delete pblocktree;
 
     pcoinsTip = NULL;
+    pcoinsWriteBuffer = NULL;
     pcoinscatcher = NULL;
     pcoinsdbview = NULL;
     pblocktree = NULL;
@@ -256,10 +402,16 @@ void CleanAndReallocateShallowDatabases(const std::pair<std::size_t,std::size_t>
 {
     DeallocateShallowDatabases();
     GetSporkManager().AllocateDatabase();
-    pblocktree = new CBlockTreeDB(blockTreeAndCoinDBCacheSizes.first, false, fReindex);
-    pcoinsdbview = new CCoinsViewDB(blockTreeAndCoinDBCacheSizes.second, false, fReindex);
+    // LevelDB cannot be retuned once open, so favour writes up front when
+    // every block is about to be connected anew.
+    const bool fInitialSync = fReindex || !boost::filesystem::exists(GetDataDir() / "chainstate");
+    CLevelDBTuning coinsTuning = CLevelDBTuning::ForChainstate(blockTreeAndCoinDBCacheSizes.second, fInitialSync);
+    coinsTuning.nMaxOpenFiles = std::max(MIN_DB_MAX_OPEN_FILES, (int)settings.GetArg("-dbmaxopenfiles", DEFAULT_DB_MAX_OPEN_FILES));
+    pblocktree = new CBlockTreeDB(CLevelDBTuning::ForBlockIndex(blockTreeAndCoinDBCacheSizes.first, fInitialSync), false, fReindex);
+    pcoinsdbview = new CCoinsViewDB(coinsTuning, false, fReindex);
     pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
-    pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+    pcoinsWriteBuffer = new CoinsViewWriteBuffer(pcoinscatcher);
+    pcoinsTip = new CCoinsViewCache(pcoinsWriteBuffer);
 }
 
 void FlushStateAndDeallocateShallowDatabases()
@@ -291,6 +443,8 @@ void PrepareShutdown()
     RenameThread("izzy-shutoff");
     mempool.AddTransactionsUpdated(1);
     StopRPCThreads();
+    // The wallet must have seen every notification before it is flushed
+    StopValidationInterfaceQueue();
     FlushWalletAndStopMinting();
     StopNode();
     InterruptTorControl();
@@ -299,6 +453,7 @@ void PrepareShutdown()
     StoreDataCaches();
     UnregisterNodeSignals(GetNodeSignals());
     SaveFeeEstimatesFromMempool();
+    SaveMempoolToDisk();
     FlushStateAndDeallocateShallowDatabases();
 
 #ifdef ENABLE_WALLET
@@ -336,7 +491,9 @@ void MainShutdown()
 
 // Shutdown part 2: delete wallet instance
 #ifdef ENABLE_WALLET
-    delete pwalletMain;
+    BOOST_FOREACH (CWallet* pwallet, vpwallets)
+        delete pwallet;
+    vpwallets.clear();
     pwalletMain = NULL;
 #endif
     LogPrintf("%s: done\n", __func__);
@@ -431,21 +588,30 @@ struct CImportingNow {
 void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
 {
     RenameThread("izzy-loadblk");
+    const bool fImportReport = settings.GetBoolArg("-importreport", false);
+    if (fImportReport)
+        BlockImportStats::Reset();
 
     // -reindex
     if (fReindex) {
         CImportingNow imp;
-        int nFile = 0;
-        while (true) {
-            CDiskBlockPos pos(nFile, 0);
-            if (!BlockFileExists(pos, "blk"))
-                break; // No block files left to reindex
-            FILE* file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(file, &pos);
-            nFile++;
+        const int nReindexThreads = std::min((int)settings.GetArg("-reindexthreads", DEFAULT_REINDEX_THREADS), MAX_REINDEX_THREADS);
+        if (nReindexThreads > 0) {
+            ReindexBlockFiles(nReindexThreads);
+        } else {
+            int nFile = 0;
+            while (true) {
+                CDiskBlockPos pos(nFile, 0);
+                if (!BlockFileExists(pos, "blk"))
+                    break; // No block files left to reindex
+                FILE* file = OpenBlockFile(pos, true);
+                if (!file)
+                    break; // This error is logged in OpenBlockFile
+                AdviseBlockFileAccess(file, BlockFileAccess::SEQUENTIAL);
+                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+                LoadExternalBlockFile(file, &pos);
+                nFile++;
+            }
         }
         pblocktree->WriteReindexing(false);
         fReindex = false;
@@ -481,10 +647,22 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         }
     }
 
+    if (fImportReport) {
+        // Write out what is still cached, so the report covers everything the import has to do.
+        FlushStateToDisk();
+        const BlockImportReport report = BlockImportStats::GetReport();
+        for (const std::string& line : report.ToLines())
+            LogPrintf("Import report: %s\n", line);
+    }
+
     if (settings.GetBoolArg("-stopafterblockimport", false)) {
         LogPrintf("Stopping after block import\n");
         StartShutdown();
+        return;
     }
+
+    // The chain is loaded by now, so the reloaded transactions find their inputs.
+    LoadMempoolFromDisk();
 }
 
 
@@ -495,12 +673,15 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
 bool VerifyECCAndLibCCompatibilityAreAvailable(void)
 {
     if (!ECC_InitSanityCheck()) {
-        InitError("OpenSSL appears to lack support for elliptic curve cryptography. For more "
-                  "information, visit https://en.bitcoin.it/wiki/OpenSSL_and_EC_Libraries");
+        InitError("Elliptic curve cryptography sanity check failure. Aborting.");
         return false;
     }
     if (!glibc_sanity_test() || !glibcxx_sanity_test())
         return false;
+    if (!SHA256SelfTest()) {
+        InitError("The selected SHA256 implementation does not compute correct hashes.");
+        return false;
+    }
 
     return true;
 }
@@ -509,6 +690,8 @@ bool VerifyCriticalDependenciesAreAvailable()
 {
     // ********************************************************* Step 4: sanity checks
 
+    LogPrintf("Using the '%s' SHA256 implementation\n", SHA256AutoDetect());
+
     // Sanity check
     if (!VerifyECCAndLibCCompatibilityAreAvailable())
         return InitError(strprintf(translate("Initialization sanity check failed. %s is shutting down."), translate(PACKAGE_NAME)));
@@ -558,9 +741,63 @@ bool CheckCriticalUnsupportedFeaturesAreNotUsed()
 void SetConsistencyChecks()
 {
     // Checkmempool and checkblockindex default to true in regtest mode
-    mempool.setSanityCheck(settings.GetBoolArg("-checkmempool", Params().DefaultConsistencyChecks()));
+    int64_t nMempoolCheckRatio = settings.GetArg("-checkmempool", Params().DefaultConsistencyChecks() ? 1 : 0);
+    if (nMempoolCheckRatio == 0 && settings.GetBoolArg("-checkmempool", false))
+        nMempoolCheckRatio = 1; // bare -checkmempool
+    mempool.setSanityCheck((unsigned int)std::min<int64_t>(std::max<int64_t>(0, nMempoolCheckRatio), 1000000));
     fCheckBlockIndex = settings.GetBoolArg("-checkblockindex", Params().DefaultConsistencyChecks());
+    nCheckBlockIndexSample = std::max<int64_t>(0, settings.GetArg("-checkblockindexsample", DEFAULT_CHECKBLOCKINDEX_SAMPLE));
+    LockProfiler::SetSamplingInterval((uint32_t)std::min<int64_t>(std::max<int64_t>(0, settings.GetArg("-lockprofilesampling", DEFAULT_LOCK_PROFILE_SAMPLING)), 1000000));
     CCheckpointServices::fEnabled = settings.GetBoolArg("-checkpoints", true);
+
+    static const CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
+    hashAssumeValid = uint256S(settings.GetArg("-assumevalid", checkpointsVerifier.GetLastCheckpointHash().GetHex()));
+    if (hashAssumeValid != 0)
+        LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating signatures for all blocks.\n");
+}
+
+void SetBlockSynchronizationMode()
+{
+    fHeadersFirstSync = settings.GetBoolArg("-headersfirst", Params().HeadersFirstSyncingActive());
+    if (fHeadersFirstSync)
+        LogPrintf("Using headers-first block synchronization\n");
+}
+
+bool SetPruningMode()
+{
+    const int64_t nPruneArg = settings.GetArg("-prune", 0);
+    if (nPruneArg < 0)
+        return InitError(translate("Prune cannot be configured with a negative value."));
+    nPruneTarget = (uint64_t)nPruneArg * 1024 * 1024;
+    if (nPruneTarget) {
+        if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES)
+            return InitError(strprintf(translate("Prune configured below the minimum of %d MiB.  Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+        LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
+        fPruneMode = true;
+        // Peers cannot download the history from us any more
+        nLocalServices &= ~NODE_NETWORK;
+    }
+    return true;
+}
+
+bool CheckBlocksDirectory()
+{
+    if (settings.ParameterIsSet("-blocksdir") && GetBlocksDir().empty())
+        return InitError(strprintf(translate("Specified blocks directory \"%s\" does not exist."), settings.GetArg("-blocksdir", "")));
+    return true;
+}
+
+bool CheckBlockFileCompression()
+{
+    if (settings.GetArg("-compressblockfiles", DEFAULT_COMPRESS_BLOCK_FILES_DEPTH) <= 0)
+        return true;
+    if (!CompressedBlockFile::IsSupported())
+        return InitError(translate("Block file compression is not supported by this build."));
+    if (fPruneMode)
+        return InitError(translate("Block file compression cannot be combined with -prune, which deletes old block files instead."));
+    return true;
 }
 
 void SetNumberOfThreadsToCheckScripts()
@@ -575,6 +812,14 @@ void SetNumberOfThreadsToCheckScripts()
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 }
 
+bool SetThreadGroupSettings()
+{
+    std::string error;
+    if (!InitThreadGroupSettings(settings.GetMultiParameter("-threadpriority"), settings.GetMultiParameter("-threadaffinity"), error))
+        return InitError(error);
+    return true;
+}
+
 bool WalletIsDisabled()
 {
 #ifdef ENABLE_WALLET
@@ -632,22 +877,48 @@ bool TryLockDataDirectory(const std::string& datadir)
     return true;
 }
 
+/** The wallet files to load, the first of them being the default wallet */
+static std::vector<std::string> GetWalletFileNames()
+{
+    std::vector<std::string> walletFiles = settings.GetMultiParameter("-wallet");
+    if (walletFiles.empty())
+        walletFiles.push_back("wallet.dat");
+    return walletFiles;
+}
+
 bool CheckWalletFileExists(std::string strDataDir)
 {
-    std::string strWalletFile = settings.GetArg("-wallet", "wallet.dat");
-    // Wallet file must be a plain filename without a directory
-    if (strWalletFile != boost::filesystem::basename(strWalletFile) + boost::filesystem::extension(strWalletFile))
-        return InitError(strprintf(translate("Wallet %s resides outside data directory %s"), strWalletFile, strDataDir));
+    std::set<std::string> walletFiles;
+    BOOST_FOREACH (const std::string& strWalletFile, GetWalletFileNames()) {
+        // Wallet file must be a plain filename without a directory
+        if (strWalletFile != boost::filesystem::basename(strWalletFile) + boost::filesystem::extension(strWalletFile))
+            return InitError(strprintf(translate("Wallet %s resides outside data directory %s"), strWalletFile, strDataDir));
+        if (!walletFiles.insert(strWalletFile).second)
+            return InitError(strprintf(translate("Error loading wallet %s. Duplicate -wallet filename specified."), strWalletFile));
+    }
 
     return true;
 }
 
 void StartScriptVerificationThreads(boost::thread_group& threadGroup)
 {
+    InitSignatureCache();
+    InitScriptExecutionCache();
     if (nScriptCheckThreads) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&TransactionInputChecker::ThreadScriptCheck);
     }
+    // Loose transactions get a pool of their own, as block connection holds on to the one above
+    MempoolSignaturePrevalidator::StartThreads(threadGroup, nScriptCheckThreads);
+    // So do the signatures of queued masternode messages
+    MasternodeSignaturePrevalidator::StartThreads(threadGroup, nScriptCheckThreads);
+}
+
+void StartCoinsLookupThreads(boost::thread_group& threadGroup)
+{
+    const int nCoinsLookupThreads = std::min((int)settings.GetArg("-coinslookupthreads", DEFAULT_COINS_LOOKUP_THREADS), MAX_COINS_LOOKUP_THREADS);
+    if (nCoinsLookupThreads > 1)
+        CCoinsViewDB::StartLookupThreads(threadGroup, nCoinsLookupThreads);
 }
 
 
@@ -658,6 +929,7 @@ void ClearFoldersForResync()
     uiInterface.InitMessage(translate("Preparing for resync..."));
     // Delete the local blockchain folders to force a resync from scratch to get a consitent blockchain-state
     boost::filesystem::path blocksDir = GetDataDir() / "blocks";
+    boost::filesystem::path blockFilesDir = GetBlocksDir();
     boost::filesystem::path chainstateDir = GetDataDir() / "chainstate";
     boost::filesystem::path sporksDir = GetDataDir() / "sporks";
 
@@ -669,6 +941,11 @@ void ClearFoldersForResync()
             LogPrintf("-resync: folder deleted: %s\n", blocksDir.string());
         }
 
+        if (boost::filesystem::exists(blockFilesDir)){
+            boost::filesystem::remove_all(blockFilesDir);
+            LogPrintf("-resync: folder deleted: %s\n", blockFilesDir.string());
+        }
+
         if (boost::filesystem::exists(chainstateDir)){
             boost::filesystem::remove_all(chainstateDir);
             LogPrintf("-resync: folder deleted: %s\n", chainstateDir.string());
@@ -688,20 +965,22 @@ void ClearFoldersForResync()
 bool BackupWallet(std::string strDataDir, bool fDisableWallet)
 {
 #ifdef ENABLE_WALLET
-    std::string strWalletFile = settings.GetArg("-wallet", "wallet.dat");
     if (!fDisableWallet) {
-        WalletBackupFeatureContainer walletBackupFeatureContainer(
-            settings.GetArg("-createwalletbackups",nWalletBackups), strWalletFile, strDataDir);
-        LogPrintf("backing up wallet\n");
-        if(walletBackupFeatureContainer.GetWalletIntegrityVerifier().CheckWalletIntegrity(strDataDir, strWalletFile))
-        {
-            return walletBackupFeatureContainer.GetBackupCreator().BackupWallet() &&
-                walletBackupFeatureContainer.GetMonthlyBackupCreator().BackupWallet();
-        }
-        else
-        {
-            LogPrintf("Error: Wallet integrity check failed.");
-            return false;
+        BOOST_FOREACH (const std::string& strWalletFile, GetWalletFileNames()) {
+            WalletBackupFeatureContainer walletBackupFeatureContainer(
+                settings.GetArg("-createwalletbackups",nWalletBackups), strWalletFile, strDataDir);
+            LogPrintf("backing up wallet %s\n", strWalletFile);
+            if(walletBackupFeatureContainer.GetWalletIntegrityVerifier().CheckWalletIntegrity(strDataDir, strWalletFile))
+            {
+                if (!walletBackupFeatureContainer.GetBackupCreator().BackupWallet() ||
+                    !walletBackupFeatureContainer.GetMonthlyBackupCreator().BackupWallet())
+                    return false;
+            }
+            else
+            {
+                LogPrintf("Error: Wallet integrity check failed.");
+                return false;
+            }
         }
     }
 #endif // ENABLE_WALLET
@@ -768,7 +1047,7 @@ void CreateHardlinksForBlocks()
         for (unsigned int i = 1; i < 10000; i++) {
             boost::filesystem::path source = GetDataDir() / strprintf("blk%04u.dat", i);
             if (!boost::filesystem::exists(source)) break;
-            boost::filesystem::path dest = blocksDir / strprintf("blk%05u.dat", i - 1);
+            boost::filesystem::path dest = GetBlocksDir() / strprintf("blk%05u.dat", i - 1);
             try {
                 boost::filesystem::create_hard_link(source, dest);
                 LogPrintf("Hardlinked %s -> %s\n", source.string(), dest.string());
@@ -786,6 +1065,53 @@ void CreateHardlinksForBlocks()
     }
 }
 
+/**
+ * A reindex of pruned block files can only use the files that are left in a row from blk00000.dat,
+ * the others and all undo files are removed so that their blocks are downloaded again.
+ */
+void CleanupBlockRevFiles()
+{
+    std::map<int, boost::filesystem::path> mapBlockFiles;
+    LogPrintf("Removing unusable blk?????.dat and rev?????.dat files for -reindex with -prune\n");
+    boost::filesystem::path blocksDir = GetBlocksDir();
+    for (boost::filesystem::directory_iterator it(blocksDir); it != boost::filesystem::directory_iterator(); it++) {
+        const std::string strFilename = it->path().filename().string();
+        if (!boost::filesystem::is_regular_file(*it) || strFilename.length() != 12 || strFilename.substr(8, 4) != ".dat")
+            continue;
+        if (strFilename.substr(0, 3) == "blk")
+            mapBlockFiles[atoi(strFilename.substr(3, 5))] = it->path();
+        else if (strFilename.substr(0, 3) == "rev")
+            boost::filesystem::remove(it->path());
+    }
+    int nContiguous = 0;
+    for (std::map<int, boost::filesystem::path>::const_iterator it = mapBlockFiles.begin(); it != mapBlockFiles.end(); ++it) {
+        if (it->first == nContiguous) {
+            nContiguous++;
+            continue;
+        }
+        boost::filesystem::remove(it->second);
+    }
+}
+
+/** Indexes turned on since the block database was created, which are built in the background */
+std::vector<BuiltIndex> GetIndexesToBuild()
+{
+    std::vector<BuiltIndex> indexes;
+    if (!fTxIndex && settings.GetBoolArg("-txindex", true))
+        indexes.push_back(BuiltIndex::TX_INDEX);
+    if (!fAddressIndex && settings.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX))
+        indexes.push_back(BuiltIndex::ADDRESS_INDEX);
+    if (!fSpentIndex && settings.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))
+        indexes.push_back(BuiltIndex::SPENT_INDEX);
+    if (!fBlockFilterIndex && settings.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+        indexes.push_back(BuiltIndex::BLOCK_FILTER_INDEX);
+    if (!fSupplyIndex && settings.GetBoolArg("-supplyindex", DEFAULT_SUPPLYINDEX))
+        indexes.push_back(BuiltIndex::SUPPLY_INDEX);
+    if (!fVaultIndex && settings.GetBoolArg("-vaultindex", DEFAULT_VAULTINDEX))
+        indexes.push_back(BuiltIndex::VAULT_INDEX);
+    return indexes;
+}
+
 std::pair<size_t,size_t> CalculateDBCacheSizes()
 {
     size_t nTotalCache = (settings.GetArg("-dbcache", DEFAULT_DB_CACHE_SIZE) << 20);
@@ -798,10 +1124,15 @@ std::pair<size_t,size_t> CalculateDBCacheSizes()
     nBlockTreeDBCache = nTotalCache / 8;
     if (nBlockTreeDBCache > (1 << 21) && !settings.GetBoolArg("-txindex", true))
         nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
+    if (settings.ParameterIsSet("-dbblockindexcache"))
+        nBlockTreeDBCache = std::min(nTotalCache / 2, (size_t)std::max((int64_t)1, settings.GetArg("-dbblockindexcache", 0)) << 20);
     nTotalCache -= nBlockTreeDBCache;
     nCoinDBCache = nTotalCache / 2; // use half of the remaining cache for coindb cache
+    if (settings.ParameterIsSet("-dbcoinscache"))
+        nCoinDBCache = std::min(nTotalCache * 3 / 4, (size_t)std::max((int64_t)1, settings.GetArg("-dbcoinscache", 0)) << 20); // leave the coins tip cache a share
     nTotalCache -= nCoinDBCache;
     nCoinCacheSize = nTotalCache / 300; // coins in memory require around 300 bytes
+    nCoinCacheUsage = nTotalCache;
 
     return std::make_pair(nBlockTreeDBCache,nCoinDBCache);
 }
@@ -814,8 +1145,11 @@ bool TryToLoadBlocks(bool& fLoaded, std::string& strLoadError)
         std::pair<std::size_t, std::size_t> dbCacheSizes = CalculateDBCacheSizes();
         CleanAndReallocateShallowDatabases(dbCacheSizes);
 
-        if (fReindex)
+        if (fReindex) {
             pblocktree->WriteReindexing(true);
+            if (fPruneMode)
+                CleanupBlockRevFiles();
+        }
 
         // IZZY: load previous sessions sporks if we have them.
         uiInterface.InitMessage(translate("Loading sporks..."));
@@ -839,54 +1173,47 @@ bool TryToLoadBlocks(bool& fLoaded, std::string& strLoadError)
             strLoadError = translate("Error initializing block database");
             return skipLoadingDueToError;
         }
+        if (fBlockFilterIndex)
+            nLocalServices |= NODE_COMPACT_FILTERS;
 
-        // Check for changed -txindex state
-        if (fTxIndex != settings.GetBoolArg("-txindex", true)) {
+        // Indexes can be built in the background later on, but not taken out again
+        if (fTxIndex && !settings.GetBoolArg("-txindex", true)) {
             strLoadError = translate("You need to rebuild the database using -reindex to change -txindex");
             return skipLoadingDueToError;
         }
+        // Block stats record the rewards the block was checked against, which only connecting it gives
+        if (!fBlockStatsIndex && settings.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+            strLoadError = translate("You need to rebuild the database using -reindex to turn on -blockstatsindex");
+            return skipLoadingDueToError;
+        }
+        if (fPruneMode && !GetIndexesToBuild().empty()) {
+            strLoadError = translate("You need to rebuild the database using -reindex to turn on -txindex, -addressindex or -spentindex with -prune");
+            return skipLoadingDueToError;
+        }
 
-        uiInterface.InitMessage(translate("Verifying blocks..."));
-
-        // Flag sent to validation code to let it know it can skip certain checks
-        fVerifyingBlocks = true;
-
-        {
-
-            LOCK(cs_main);
-            const BlockDiskDataReader blockDiskReader;
-            ActiveChainManager chainManager(fAddressIndex,pblocktree,blockDiskReader);
-            CVerifyDB dbVerifier(
-                chainManager,
-                chainActive,
-                uiInterface,
-                nCoinCacheSize,
-                &ShutdownRequested);
-            if (!dbVerifier.VerifyDB(pcoinsdbview,pcoinsTip, 4, settings.GetArg("-checkblocks", 100)))
-            {
-                strLoadError = translate("Corrupted block database detected");
-                fVerifyingBlocks = false;
-                return skipLoadingDueToError;
-            }
+        // Pruned block files cannot be brought back without downloading the chain again
+        if (fHavePruned && !fPruneMode) {
+            strLoadError = translate("You need to rebuild the database using -reindex to go back to unpruned mode. This will redownload the entire blockchain");
+            return skipLoadingDueToError;
         }
+
+        // The coin database is checked against the latest blocks by
+        // ThreadVerifyChainstate once the node is up.
     } catch (std::exception& e) {
         if (fDebug) LogPrintf("%s\n", e.what());
         strLoadError = translate("Error opening block database");
-        fVerifyingBlocks = false;
         return skipLoadingDueToError;
     }
 
-    fVerifyingBlocks = false;
     fLoaded = true;
 
     return true;
 }
 
-bool CreateNewWalletIfOneIsNotAvailable(std::string strWalletFile, std::ostringstream& strErrors)
+bool CreateNewWalletIfOneIsNotAvailable(CWallet& wallet, std::ostringstream& strErrors)
 {
     bool fFirstRun = true;
-    pwalletMain = new CWallet(strWalletFile, chainActive, mapBlockIndex);
-    DBErrors nLoadWalletRet = pwalletMain->LoadWallet(fFirstRun);
+    DBErrors nLoadWalletRet = wallet.LoadWallet(fFirstRun);
     if (nLoadWalletRet != DB_LOAD_OK) {
         if (nLoadWalletRet == DB_CORRUPT)
             strErrors << translate("Error loading wallet.dat: Wallet corrupted") << "\n";
@@ -910,90 +1237,99 @@ bool CreateNewWalletIfOneIsNotAvailable(std::string strWalletFile, std::ostrings
         {
             LogPrintf("Performing wallet upgrade to %i\n", FEATURE_LATEST);
             nMaxVersion = CLIENT_VERSION;
-            pwalletMain->SetMinVersion(FEATURE_LATEST); // permanently upgrade the wallet immediately
+            wallet.SetMinVersion(FEATURE_LATEST); // permanently upgrade the wallet immediately
         } else
             LogPrintf("Allowing wallet upgrade up to %i\n", nMaxVersion);
-        if (nMaxVersion < pwalletMain->GetVersion())
+        if (nMaxVersion < wallet.GetVersion())
             strErrors << translate("Cannot downgrade wallet") << "\n";
-        pwalletMain->SetMaxVersion(nMaxVersion);
+        wallet.SetMaxVersion(nMaxVersion);
     }
 
     if (fFirstRun)
     {
         // Create new keyUser and set as default key
-        if (settings.GetBoolArg("-usehd", DEFAULT_USE_HD_WALLET) && !pwalletMain->IsHDEnabled()) {
+        if (settings.GetBoolArg("-usehd", DEFAULT_USE_HD_WALLET) && !wallet.IsHDEnabled()) {
             if (settings.GetArg("-mnemonicpassphrase", "").size() > 256) {
                 InitError(translate("Mnemonic passphrase is too long, must be at most 256 characters"));
                 return false;
             }
             // generate a new master key
-            pwalletMain->GenerateNewHDChain();
+            wallet.GenerateNewHDChain();
 
             // ensure this wallet.dat can only be opened by clients supporting HD
-            pwalletMain->SetMinVersion(FEATURE_HD);
+            wallet.SetMinVersion(FEATURE_HD);
         }
 
         CPubKey newDefaultKey;
-        if (pwalletMain->GetKeyFromPool(newDefaultKey, false)) {
-            pwalletMain->SetDefaultKey(newDefaultKey);
-            if (!pwalletMain->SetAddressBook(pwalletMain->vchDefaultKey.GetID(), "", "receive")) {
+        if (wallet.GetKeyFromPool(newDefaultKey, false)) {
+            wallet.SetDefaultKey(newDefaultKey);
+            if (!wallet.SetAddressBook(wallet.vchDefaultKey.GetID(), "", "receive")) {
                 InitError(translate("Cannot write default address") += "\n");
                 return false;
             }
         }
 
-        pwalletMain->SetBestChain(chainActive.GetLocator());
+        wallet.SetBestChain(chainActive.GetLocator());
 
     }
     else if (settings.ParameterIsSet("-usehd")) {
         bool useHD = settings.GetBoolArg("-usehd", DEFAULT_USE_HD_WALLET);
-        if (pwalletMain->IsHDEnabled() && !useHD) {
+        if (wallet.IsHDEnabled() && !useHD) {
             InitError(strprintf(translate("Error loading %s: You can't disable HD on a already existing HD wallet"),
-                                pwalletMain->strWalletFile));
+                                wallet.strWalletFile));
             return false;
         }
-        if (!pwalletMain->IsHDEnabled() && useHD) {
+        if (!wallet.IsHDEnabled() && useHD) {
             InitError(strprintf(translate("Error loading %s: You can't enable HD on a already existing non-HD wallet"),
-                                pwalletMain->strWalletFile));
+                                wallet.strWalletFile));
             return false;
         }
     }
 
     // Warn user every time he starts non-encrypted HD wallet
-    if (!settings.GetBoolArg("-allowunencryptedwallet", false) && settings.GetBoolArg("-usehd", DEFAULT_USE_HD_WALLET) && !pwalletMain->IsLocked()) {
+    if (!settings.GetBoolArg("-allowunencryptedwallet", false) && settings.GetBoolArg("-usehd", DEFAULT_USE_HD_WALLET) && !wallet.IsLocked()) {
         InitWarning(translate("Make sure to encrypt your wallet and delete all non-encrypted backups after you verified that wallet works!"));
     }
 
     return true;
 }
 
-void ScanBlockchainForWalletUpdates(std::string strWalletFile,const std::vector<CWalletTx>& vWtx, int64_t& nStart)
+bool ScanBlockchainForWalletUpdates(CWallet& wallet, const std::vector<CWalletTx>& vWtx, int64_t& nStart)
 {
     CBlockIndex* pindexRescan = chainActive.Tip();
     if (settings.GetBoolArg("-rescan", false))
         pindexRescan = chainActive.Genesis();
     else {
-        CWalletDB walletdb(settings,strWalletFile);
+        CWalletDB walletdb(settings,wallet.strWalletFile);
         CBlockLocator locator;
         if (walletdb.ReadBestBlock(locator))
             pindexRescan = FindForkInGlobalIndex(chainActive, locator);
         else
             pindexRescan = chainActive.Genesis();
     }
+    if (fHavePruned) {
+        // The blocks to rescan have to be there
+        CBlockIndex* block = chainActive.Tip();
+        while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA) && pindexRescan != block)
+            block = block->pprev;
+        if (pindexRescan != block)
+            return InitError(translate("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
+    }
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan) {
         uiInterface.InitMessage(translate("Rescanning..."));
         LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
         nStart = GetTimeMillis();
-        pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+        wallet.ScanForWalletTransactions(pindexRescan, true);
         LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
-        pwalletMain->SetBestChain(chainActive.GetLocator());
-        pwalletMain->IncrementDBUpdateCount();
+        wallet.SetBestChain(chainActive.GetLocator());
+        wallet.IncrementDBUpdateCount();
 
         // Restore wallet transaction metadata after -zapwallettxes=1
         if (settings.GetBoolArg("-zapwallettxes", false) && settings.GetArg("-zapwallettxes", "1") != "2") {
-            pwalletMain->UpdateTransactionMetadata(vWtx);
+            wallet.UpdateTransactionMetadata(vWtx);
         }
     }
+    return true;
 }
 
 void LockUpMasternodeCollateral()
@@ -1018,15 +1354,12 @@ bool ZapWalletTransactionsIfRequested(const std::string& strWalletFile, std::vec
     {
         uiInterface.InitMessage(translate("Zapping all transactions from wallet..."));
 
-        pwalletMain = new CWallet(strWalletFile, chainActive, mapBlockIndex);
-        DBErrors nZapWalletRet = pwalletMain->ZapWalletTx(vWtx);
+        CWallet wallet(strWalletFile, chainActive, mapBlockIndex);
+        DBErrors nZapWalletRet = wallet.ZapWalletTx(vWtx);
         if (nZapWalletRet != DB_LOAD_OK) {
             uiInterface.InitMessage(translate("Error loading wallet.dat: Wallet corrupted"));
             return false;
         }
-
-        delete pwalletMain;
-        pwalletMain = NULL;
     }
     return true;
 }
@@ -1122,7 +1455,24 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
         return false;
     }
     SetConsistencyChecks();
+    SetBlockSynchronizationMode();
+    if(!SetPruningMode())
+    {
+        return false;
+    }
+    if(!CheckBlocksDirectory())
+    {
+        return false;
+    }
+    if(!CheckBlockFileCompression())
+    {
+        return false;
+    }
     SetNumberOfThreadsToCheckScripts();
+    if(!SetThreadGroupSettings())
+    {
+        return false;
+    }
 
     // Staking needs a CWallet instance, so make sure wallet is enabled
     bool fDisableWallet = WalletIsDisabled();
@@ -1159,6 +1509,7 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
 #endif
     PrintInitialLogHeader(fDisableWallet,numberOfFileDescriptors,strDataDir);
     StartScriptVerificationThreads(threadGroup);
+    StartCoinsLookupThreads(threadGroup);
 
     if(!SetSporkKey())
     {
@@ -1192,6 +1543,22 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
 #endif
 
     // ********************************************************* Step 7: load block chain
+    // The fee estimates, the masternode caches and the peer addresses are
+    // read from files of their own and load while the block index does; each
+    // is waited for right before the first step using it.
+    StartupStages startupStages(settings.GetBoolArg("-parallelstartup", DEFAULT_PARALLEL_STARTUP));
+    startupStages.Start("fee estimates", []() {
+        LoadFeeEstimatesForMempool();
+        return true;
+    });
+    startupStages.Start("mn caches", [&uiMessenger]() {
+        return LoadDataCaches() && LoadMasternodeDataFromDisk(uiMessenger, GetDataDir().string());
+    });
+    startupStages.Start("addresses", []() {
+        LoadPeerAddresses();
+        return true;
+    });
+
     CreateHardlinksForBlocks();
     bool fLoaded = false;
     while (!fLoaded) {
@@ -1234,51 +1601,72 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
-    LoadFeeEstimatesForMempool();
+    if (fPruneMode && !fReindex) {
+        uiInterface.InitMessage(translate("Pruning blockstore..."));
+        PruneAndFlush();
+    }
+
+    startupStages.Wait("fee estimates");
 
 // ********************************************************* Step 8: load wallet
     std::ostringstream strErrors;
 #ifdef ENABLE_WALLET
-    const std::string strWalletFile = settings.GetArg("-wallet", "wallet.dat");
     if (fDisableWallet) {
         pwalletMain = NULL;
         LogPrintf("Wallet disabled!\n");
     } else {
-        // needed to restore wallet transaction meta data after -zapwallettxes
-        std::vector<CWalletTx> vWtx;
-        if(!ZapWalletTransactionsIfRequested(strWalletFile,vWtx))
-        {
-            return false;
-        }
-
-        uiInterface.InitMessage(translate("Loading wallet..."));
-        fVerifyingBlocks = true;
+        // Each wallet gets its own lock and is told of blocks and transactions on its own,
+        // while the node, staking and masternodes keep to the first one
+        BOOST_FOREACH (const std::string& strWalletFile, GetWalletFileNames()) {
+            // needed to restore wallet transaction meta data after -zapwallettxes
+            std::vector<CWalletTx> vWtx;
+            if(!ZapWalletTransactionsIfRequested(strWalletFile,vWtx))
+            {
+                return false;
+            }
 
-        nStart = GetTimeMillis();
-        if(!CreateNewWalletIfOneIsNotAvailable(strWalletFile,strErrors))
-        {
-            return false;
-        }
-        if(settings.GetBoolArg("-spendzeroconfchange", false))
-        {
-            // Off by default in wallet
-            pwalletMain->toggleSpendingZeroConfirmationOutputs();
-        }
+            uiInterface.InitMessage(translate("Loading wallet..."));
+            fVerifyingBlocks = true;
 
+            nStart = GetTimeMillis();
+            CWallet* pwallet = new CWallet(strWalletFile, chainActive, mapBlockIndex);
+            vpwallets.push_back(pwallet);
+            if (!pwalletMain)
+                pwalletMain = pwallet;
+            if(!CreateNewWalletIfOneIsNotAvailable(*pwallet,strErrors))
+            {
+                return false;
+            }
+            if(settings.GetBoolArg("-spendzeroconfchange", false))
+            {
+                // Off by default in wallet
+                pwallet->toggleSpendingZeroConfirmationOutputs();
+            }
 
-        LogPrintf("%s", strErrors.str());
-        LogPrintf(" wallet      %15dms\n", GetTimeMillis() - nStart);
 
-        RegisterValidationInterface(pwalletMain);
+            LogPrintf("%s", strErrors.str());
+            LogPrintf(" wallet %s %15dms\n", strWalletFile, GetTimeMillis() - nStart);
 
-        ScanBlockchainForWalletUpdates(strWalletFile,vWtx,nStart);
-        fVerifyingBlocks = false;
+            RegisterValidationInterface(pwallet);
+#if ENABLE_ZMQ
+            if (pzmqNotificationInterface && pwallet == pwalletMain)
+                pzmqNotificationInterface->ConnectWallet(pwallet);
+#endif
 
+            if(!ScanBlockchainForWalletUpdates(*pwallet,vWtx,nStart))
+            {
+                return false;
+            }
+            fVerifyingBlocks = false;
+        }
     }  // (!fDisableWallet)
 #else  // ENABLE_WALLET
     LogPrintf("No wallet compiled in!\n");
 #endif // !ENABLE_WALLET
     // ********************************************************* Step 9: import blocks
+    // Connecting blocks reaches into the masternode caches, which must be done loading by then
+    if (!startupStages.Wait("mn caches"))
+        return false;
 
     if (settings.ParameterIsSet("-blocknotify"))
         uiInterface.NotifyBlockTip.connect(BlockNotifyCallback);
@@ -1293,6 +1681,7 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
         BOOST_FOREACH (std::string strFile, settings.GetMultiParameter("-loadblock"))
             vImportFiles.push_back(strFile);
     }
+    StartValidationInterfaceQueue();
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
     if (chainActive.Tip() == NULL) {
         LogPrintf("Waiting for genesis block to be imported...\n");
@@ -1301,15 +1690,7 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
     }
 
     // ********************************************************* Step 10: setup ObfuScation
-    if(!LoadDataCaches())
-    {
-        return false;
-    }
     std::string errorMessage;
-    if(!LoadMasternodeDataFromDisk(uiMessenger,GetDataDir().string()) )
-    {
-        return false;
-    }
     if(!InitializeMasternodeIfRequested(settings,fTxIndex,errorMessage))
     {
         return InitError(errorMessage);
@@ -1337,8 +1718,27 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
     if (settings.GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup);
 
+    startupStages.Wait("addresses");
     StartNode(threadGroup);
 
+    int nCheckBlocks = settings.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS);
+    // Pruned nodes only keep the latest blocks to check against
+    if (fPruneMode && (nCheckBlocks == 0 || nCheckBlocks > GetPruneKeepDepth()))
+        nCheckBlocks = GetPruneKeepDepth();
+    if (nCheckBlocks >= 0)
+        threadGroup.create_thread(boost::bind(&ThreadVerifyChainstate, nCheckBlocks));
+
+    const int nCompressDepth = settings.GetArg("-compressblockfiles", DEFAULT_COMPRESS_BLOCK_FILES_DEPTH);
+    if (nCompressDepth > 0)
+        threadGroup.create_thread(boost::bind(&ThreadCompressBlockFiles, std::max(nCompressDepth, MIN_BLOCKS_TO_KEEP)));
+
+    const std::vector<BuiltIndex> indexesToBuild = GetIndexesToBuild();
+    if (!indexesToBuild.empty()) {
+        const int nIndexBuildLag = std::max(0, (int)settings.GetArg("-indexbuildlag", DEFAULT_INDEX_BUILD_LAG));
+        const int nIndexBuildRate = std::max(0, (int)settings.GetArg("-indexbuildrate", DEFAULT_INDEX_BUILD_RATE));
+        threadGroup.create_thread(boost::bind(&ThreadBuildIndexes, indexesToBuild, nIndexBuildLag, nIndexBuildRate));
+    }
+
 #ifdef ENABLE_WALLET
     // Generate coins in the background
     if (pwalletMain)
@@ -1351,14 +1751,25 @@ bool InitializeIzzy(boost::thread_group& threadGroup)
     uiInterface.InitMessage(translate("Done loading"));
 
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
+    BOOST_FOREACH (CWallet* pwallet, vpwallets) {
         // Add wallet transactions that aren't already in a block to mapTransactions
-        pwalletMain->ReacceptWalletTransactions();
+        pwallet->ReacceptWalletTransactions();
 
         // Run a thread to flush wallet periodically
         if (settings.GetBoolArg("-flushwallet", true))
         {
-            threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
+            threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwallet->strWalletFile)));
+        }
+
+        // Run a thread to derive keypool keys ahead of address requests
+        threadGroup.create_thread(boost::bind(&ThreadMaintainKeyPool, pwallet));
+    }
+    if (pwalletMain) {
+
+        // Run a thread to combine the wallet's dust when blocks come in
+        if (settings.ParameterIsSet("-combinethreshold"))
+        {
+            threadGroup.create_thread(boost::bind(&ThreadCombineWalletDust, boost::cref(settings)));
         }
     }
 #endif
@@ -9,6 +9,7 @@
 #include <string>
 #include <boost/signals2/signal.hpp>
 #include <set>
+#include <vector>
 class CWallet;
 
 namespace boost
@@ -28,4 +29,9 @@ struct StartAndShutdownSignals
     static void EnableUnitTestSignals();
 };
 bool InitializeIzzy(boost::thread_group& threadGroup);
+
+/** The loaded wallets, the default one (pwalletMain) first */
+extern std::vector<CWallet*> vpwallets;
+/** The loaded wallet kept in the given file, or NULL */
+CWallet* FindWallet(const std::string& strWalletFile);
 #endif // BITCOIN_INIT_H
@@ -14,7 +14,12 @@
 #include "utilstrencodings.h"
 #include "Settings.h"
 
+#include <algorithm>
+#include <iostream>
+
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/foreach.hpp>
 
 #define translate(x) std::string(x) /* Keep the translate() around in case gettext or such will be used later to translate non-UI */
 
@@ -53,7 +58,9 @@ static bool AppInitRPC(int argc, char* argv[])
             strUsage += "\n" + translate("Usage:") + "\n" +
                         "  izzy-cli [options] <command> [params]  " + translate("Send command to Izzy Core") + "\n" +
                         "  izzy-cli [options] help                " + translate("List commands") + "\n" +
-                        "  izzy-cli [options] help <command>      " + translate("Get help for a command") + "\n";
+                        "  izzy-cli [options] help <command>      " + translate("Get help for a command") + "\n" +
+                        "  izzy-cli [options] -stdin < commands   " + translate("Send the commands, one per line, as batches over one connection") + "\n" +
+                        "  izzy-cli [options] -wait [command]     " + translate("Wait for a new block, then send the command") + "\n";
 
             strUsage += "\n" + HelpMessageCli();
         }
@@ -79,7 +86,30 @@ static bool AppInitRPC(int argc, char* argv[])
     return true;
 }
 
-Object CallRPC(const string& strMethod, const Array& params)
+/** The most requests read from -stdin sent to the server in one batch */
+static const size_t MAX_STDIN_BATCH_SIZE = 1000;
+
+/**
+ * A keep-alive connection to the server, so that the requests of a run
+ * pay to connect and authenticate only once.
+ */
+class CRPCConnection
+{
+private:
+    basic_socket_iostream<ip::tcp> stream;
+    map<string, string> mapRequestHeaders;
+    bool fOpen;
+
+    void Connect();
+
+public:
+    CRPCConnection();
+
+    //! Sends the request, or batch of them, and returns the parsed reply
+    Value Post(const Value& request);
+};
+
+CRPCConnection::CRPCConnection(): stream(), mapRequestHeaders(), fOpen(false)
 {
     if (settings.GetParameter("-rpcuser") == "" && settings.GetParameter("-rpcpassword") == "")
         throw runtime_error(strprintf(
@@ -87,20 +117,34 @@ Object CallRPC(const string& strMethod, const Array& params)
               "If the file does not exist, create it with owner-readable-only file permissions."),
             settings.GetConfigFile().string().c_str()));
 
+    // HTTP basic authentication
+    string strUserPass64 = EncodeBase64(settings.GetParameter("-rpcuser") + ":" + settings.GetParameter("-rpcpassword"));
+    mapRequestHeaders["Authorization"] = string("Basic ") + strUserPass64;
+
+    Connect();
+}
+
+void CRPCConnection::Connect()
+{
     // Connect to localhost
-    basic_socket_iostream<ip::tcp> stream;
+    stream.close();
+    stream.clear();
     stream.connect(settings.GetArg("-rpcconnect", "127.0.0.1"), settings.GetArg("-rpcport", itostr(BaseParams().RPCPort())));
     if (!stream)
         throw CConnectionFailed("couldn't connect to server");
+    fOpen = true;
+}
 
-    // HTTP basic authentication
-    string strUserPass64 = EncodeBase64(settings.GetParameter("-rpcuser") + ":" + settings.GetParameter("-rpcpassword"));
-    map<string, string> mapRequestHeaders;
-    mapRequestHeaders["Authorization"] = string("Basic ") + strUserPass64;
+Value CRPCConnection::Post(const Value& request)
+{
+    // The server closes the connection after a reply when it does not keep connections alive
+    if (!fOpen)
+        Connect();
 
     // Send request
-    string strRequest = JSONRPCRequest(strMethod, params, 1);
-    string strPost = HTTPPost(strRequest, mapRequestHeaders);
+    // Wallet commands go to the wallet named by -rpcwallet, or to the default one
+    const string strPath = settings.ParameterIsSet("-rpcwallet") ? "/wallet/" + settings.GetArg("-rpcwallet", "") : "/";
+    string strPost = HTTPPost(write_string(request, false) + "\n", mapRequestHeaders, true, strPath);
     stream << strPost << std::flush;
 
     // Receive HTTP reply status
@@ -111,6 +155,7 @@ Object CallRPC(const string& strMethod, const Array& params)
     map<string, string> mapHeaders;
     string strReply;
     ReadHTTPMessage(stream, mapHeaders, strReply, nProto, std::numeric_limits<size_t>::max());
+    fOpen = stream && mapHeaders["connection"] != "close";
 
     if (nStatus == HTTP_UNAUTHORIZED)
         throw runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
@@ -123,11 +168,66 @@ Object CallRPC(const string& strMethod, const Array& params)
     Value valReply;
     if (!read_string(strReply, valReply))
         throw runtime_error("couldn't parse reply from server");
-    const Object& reply = valReply.get_obj();
-    if (reply.empty())
+    return valReply;
+}
+
+static const Object& CheckReply(const Value& valReply)
+{
+    if (valReply.type() != obj_type || valReply.get_obj().empty())
         throw runtime_error("expected reply to have result, error and id properties");
+    return valReply.get_obj();
+}
+
+Object CallRPC(const string& strMethod, const Array& params)
+{
+    CRPCConnection connection;
+    return CheckReply(connection.Post(JSONRPCRequestObj(strMethod, params, 1)));
+}
+
+/** Formats the reply the way it is printed, and returns the exit code it makes for */
+static int FormatReply(const Object& reply, string& strPrint, bool fWait)
+{
+    const Value& result = find_value(reply, "result");
+    const Value& error = find_value(reply, "error");
+
+    if (error.type() != null_type) {
+        // Error
+        const int code = find_value(error.get_obj(), "code").get_int();
+        if (fWait && code == RPC_IN_WARMUP)
+            throw CConnectionFailed("server in warmup");
+        strPrint = "error: " + write_string(error, false);
+        return abs(code);
+    }
+
+    // Result
+    if (result.type() == null_type)
+        strPrint = "";
+    else if (result.type() == str_type)
+        strPrint = result.get_str();
+    else
+        strPrint = write_string(result, true);
+    return 0;
+}
+
+static void PrintReply(const string& strPrint, int nRet)
+{
+    if (strPrint != "")
+        fprintf((nRet == 0 ? stdout : stderr), "%s\n", strPrint.c_str());
+}
 
-    return reply;
+/** One request per line of the standard input, the method followed by its parameters, separated by spaces */
+static void ReadStdinRequests(Array& vRequests)
+{
+    string strLine;
+    while (std::getline(std::cin, strLine)) {
+        std::vector<std::string> vArgs;
+        boost::split(vArgs, strLine, boost::is_any_of(" \t\r"), boost::token_compress_on);
+        vArgs.erase(std::remove(vArgs.begin(), vArgs.end(), std::string()), vArgs.end());
+        if (vArgs.empty())
+            continue;
+        std::vector<std::string> strParams(vArgs.begin() + 1, vArgs.end());
+        vRequests.push_back(JSONRPCRequestObj(vArgs[0], RPCConvertValues(vArgs[0], strParams), (int)vRequests.size()));
+    }
 }
 
 int CommandLineRPC(int argc, char* argv[])
@@ -141,40 +241,61 @@ int CommandLineRPC(int argc, char* argv[])
             argv++;
         }
 
-        // Method
-        if (argc < 2)
+        const bool fStdin = settings.GetBoolArg("-stdin", false);
+        const bool fWaitForBlock = settings.ParameterIsSet("-wait");
+
+        // The command on the command line, if any, goes first
+        Array vRequests;
+        if (argc >= 2) {
+            string strMethod = argv[1];
+
+            // Parameters default to strings
+            std::vector<std::string> strParams(&argv[2], &argv[argc]);
+            vRequests.push_back(JSONRPCRequestObj(strMethod, RPCConvertValues(strMethod, strParams), 1));
+        }
+        if (fStdin)
+            ReadStdinRequests(vRequests);
+        if (vRequests.empty() && !fWaitForBlock)
             throw runtime_error("too few parameters");
-        string strMethod = argv[1];
 
-        // Parameters default to strings
-        std::vector<std::string> strParams(&argv[2], &argv[argc]);
-        Array params = RPCConvertValues(strMethod, strParams);
+        Array waitParams;
+        if (fWaitForBlock && settings.GetArg("-wait", 0) > 0)
+            waitParams.push_back(settings.GetArg("-wait", 0) * 1000);
 
         // Execute and handle connection failures with -rpcwait
         const bool fWait = settings.GetBoolArg("-rpcwait", false);
         do {
             try {
-                const Object reply = CallRPC(strMethod, params);
-
-                // Parse reply
-                const Value& result = find_value(reply, "result");
-                const Value& error = find_value(reply, "error");
-
-                if (error.type() != null_type) {
-                    // Error
-                    const int code = find_value(error.get_obj(), "code").get_int();
-                    if (fWait && code == RPC_IN_WARMUP)
-                        throw CConnectionFailed("server in warmup");
-                    strPrint = "error: " + write_string(error, false);
-                    nRet = abs(code);
-                } else {
-                    // Result
-                    if (result.type() == null_type)
-                        strPrint = "";
-                    else if (result.type() == str_type)
-                        strPrint = result.get_str();
-                    else
-                        strPrint = write_string(result, true);
+                CRPCConnection connection;
+                bool fPrinted = false;
+
+                // Long poll for the next block before running the commands
+                if (fWaitForBlock) {
+                    nRet = FormatReply(CheckReply(connection.Post(JSONRPCRequestObj("waitfornewblock", waitParams, "wait"))), strPrint, fWait);
+                    if (nRet != 0 || vRequests.empty())
+                        break;
+                    strPrint = "";
+                }
+
+                if (vRequests.size() == 1 && !fStdin) {
+                    nRet = FormatReply(CheckReply(connection.Post(vRequests[0])), strPrint, fWait);
+                    break;
+                }
+
+                // Batches over the one connection, printing the replies in the order of the requests
+                for (size_t nStart = 0; nStart < vRequests.size(); nStart += MAX_STDIN_BATCH_SIZE) {
+                    Array batch(vRequests.begin() + nStart, vRequests.begin() + std::min(vRequests.size(), nStart + MAX_STDIN_BATCH_SIZE));
+                    const Value valReplies = connection.Post(batch);
+                    if (valReplies.type() != array_type || valReplies.get_array().size() != batch.size())
+                        throw runtime_error("expected a reply for each request of the batch");
+                    BOOST_FOREACH (const Value& valReply, valReplies.get_array()) {
+                        string strReply;
+                        const int nReplyRet = FormatReply(CheckReply(valReply), strReply, fWait && !fPrinted);
+                        PrintReply(strReply, nReplyRet);
+                        fPrinted = true;
+                        if (nReplyRet != 0)
+                            nRet = nReplyRet;
+                    }
                 }
 
                 // Connection succeeded, no need to retry.
@@ -196,9 +317,7 @@ int CommandLineRPC(int argc, char* argv[])
         throw;
     }
 
-    if (strPrint != "") {
-        fprintf((nRet == 0 ? stdout : stderr), "%s\n", strPrint.c_str());
-    }
+    PrintReply(strPrint, nRet);
     return nRet;
 }
 
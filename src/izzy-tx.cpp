@@ -22,17 +22,24 @@
 #include "Settings.h"
 #include <stdio.h>
 
+#include <iostream>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace boost::assign;
 using namespace std;
 extern Settings& settings;
 
 static bool fCreateBlank;
-static map<string, UniValue> registers;
+typedef map<string, UniValue> Registers;
 CClientUIInterface uiInterface;
 
+/** Lines of a batch read before signing them side by side and writing them out */
+static const size_t BATCH_LINES = 1024;
+
 static bool AppInitRawTx(int argc, char* argv[])
 {
     //
@@ -60,6 +67,10 @@ static bool AppInitRawTx(int argc, char* argv[])
 
         strUsage = HelpMessageGroup(translate("Options:"));
         strUsage += HelpMessageOpt("-?", translate("This help message"));
+        strUsage += HelpMessageOpt("-batch", translate("Read one transaction per line from standard input, as <hex-tx> or -create followed by its own commands, "
+            "and write one result per line. Register commands given on the command line are evaluated once for all of them, "
+            "other commands run on each transaction before its own. A transaction that fails is written as an error line"));
+        strUsage += HelpMessageOpt("-batchthreads=<n>", translate("Transactions of a batch processed side by side (default: the number of cores)"));
         strUsage += HelpMessageOpt("-create", translate("Create new, empty TX."));
         strUsage += HelpMessageOpt("-json", translate("Select JSON output"));
         strUsage += HelpMessageOpt("-txid", translate("Output only the hex-encoded transaction id of the resultant transaction."));
@@ -94,7 +105,7 @@ static bool AppInitRawTx(int argc, char* argv[])
     return true;
 }
 
-static void RegisterSetJson(const string& key, const string& rawJson)
+static void RegisterSetJson(Registers& registers, const string& key, const string& rawJson)
 {
     UniValue val;
     if (!val.read(rawJson)) {
@@ -105,7 +116,7 @@ static void RegisterSetJson(const string& key, const string& rawJson)
     registers[key] = val;
 }
 
-static void RegisterSet(const string& strInput)
+static void RegisterSet(Registers& registers, const string& strInput)
 {
     // separate NAME:VALUE in string
     size_t pos = strInput.find(':');
@@ -117,10 +128,10 @@ static void RegisterSet(const string& strInput)
     string key = strInput.substr(0, pos);
     string valStr = strInput.substr(pos + 1, string::npos);
 
-    RegisterSetJson(key, valStr);
+    RegisterSetJson(registers, key, valStr);
 }
 
-static void RegisterLoad(const string& strInput)
+static void RegisterLoad(Registers& registers, const string& strInput)
 {
     // separate NAME:FILENAME in string
     size_t pos = strInput.find(':');
@@ -157,7 +168,7 @@ static void RegisterLoad(const string& strInput)
     fclose(f);
 
     // evaluate as JSON buffer register
-    RegisterSetJson(key, valStr);
+    RegisterSetJson(registers, key, valStr);
 }
 
 static void MutateTxVersion(CMutableTransaction& tx, const string& cmdVal)
@@ -329,7 +340,38 @@ std::vector<unsigned char> ParseHexUO(map<string, UniValue>& o, string strKey)
     return ParseHexUV(o[strKey], strKey);
 }
 
-static void MutateTxSign(CMutableTransaction& tx, const string& flagStr)
+/** The keys of a privatekeys register, decoded and with their public keys derived once for every transaction signed with them */
+class SigningKeys
+{
+private:
+    string source_;
+    vector<pair<CKey, CPubKey> > keys_;
+
+public:
+    void AddTo(const UniValue& keysObj, CBasicKeyStore& keystore)
+    {
+        const string source = keysObj.write();
+        if (source != source_ || keys_.empty()) {
+            keys_.clear();
+            for (unsigned int kidx = 0; kidx < keysObj.count(); kidx++) {
+                if (!keysObj[kidx].isStr())
+                    throw runtime_error("privatekey not a string");
+                CBitcoinSecret vchSecret;
+                bool fGood = vchSecret.SetString(keysObj[kidx].getValStr());
+                if (!fGood)
+                    throw runtime_error("privatekey not valid");
+
+                CKey key = vchSecret.GetKey();
+                keys_.push_back(make_pair(key, key.GetPubKey()));
+            }
+            source_ = source;
+        }
+        for (const pair<CKey, CPubKey>& key : keys_)
+            keystore.AddKeyPubKey(key.first, key.second);
+    }
+};
+
+static void MutateTxSign(CMutableTransaction& tx, const string& flagStr, Registers& registers, SigningKeys& signingKeys)
 {
     int nHashType = SIGHASH_ALL;
 
@@ -351,25 +393,14 @@ static void MutateTxSign(CMutableTransaction& tx, const string& flagStr)
         throw runtime_error("privatekeys register variable must be set.");
     bool fGivenKeys = false;
     CBasicKeyStore tempKeystore;
-    UniValue keysObj = registers["privatekeys"];
+    const UniValue& keysObj = registers["privatekeys"];
     fGivenKeys = true;
-
-    for (unsigned int kidx = 0; kidx < keysObj.count(); kidx++) {
-        if (!keysObj[kidx].isStr())
-            throw runtime_error("privatekey not a string");
-        CBitcoinSecret vchSecret;
-        bool fGood = vchSecret.SetString(keysObj[kidx].getValStr());
-        if (!fGood)
-            throw runtime_error("privatekey not valid");
-
-        CKey key = vchSecret.GetKey();
-        tempKeystore.AddKey(key);
-    }
+    signingKeys.AddTo(keysObj, tempKeystore);
 
     // Add previous txouts given in the RPC call:
     if (!registers.count("prevtxs"))
         throw runtime_error("prevtxs register variable must be set.");
-    UniValue prevtxsObj = registers["prevtxs"];
+    const UniValue& prevtxsObj = registers["prevtxs"];
     {
         for (unsigned int previdx = 0; previdx < prevtxsObj.count(); previdx++) {
             UniValue prevOut = prevtxsObj[previdx];
@@ -450,7 +481,7 @@ static void MutateTxSign(CMutableTransaction& tx, const string& flagStr)
     tx = mergedTx;
 }
 
-static void MutateTx(CMutableTransaction& tx, const string& command, const string& commandVal)
+static void MutateTx(CMutableTransaction& tx, const string& command, const string& commandVal, Registers& registers, SigningKeys& signingKeys)
 {
     if (command == "nversion")
         MutateTxVersion(tx, commandVal);
@@ -470,49 +501,50 @@ static void MutateTx(CMutableTransaction& tx, const string& command, const strin
         MutateTxAddOutScript(tx, commandVal);
 
     else if (command == "sign")
-        MutateTxSign(tx, commandVal);
+        MutateTxSign(tx, commandVal, registers, signingKeys);
 
     else if (command == "load")
-        RegisterLoad(commandVal);
+        RegisterLoad(registers, commandVal);
 
     else if (command == "set")
-        RegisterSet(commandVal);
+        RegisterSet(registers, commandVal);
 
     else
         throw runtime_error("unknown command");
 }
 
-static void OutputTxJSON(const CTransaction& tx)
+static string FormatTxJSON(const CTransaction& tx, unsigned int prettyIndent)
 {
     UniValue entry(UniValue::VOBJ);
     TxToUniv(tx, 0, entry);
 
-    string jsonOutput = entry.write(4);
-    fprintf(stdout, "%s\n", jsonOutput.c_str());
+    return entry.write(prettyIndent);
 }
 
-static void OutputTxHash(const CTransaction& tx)
+static string FormatTxHash(const CTransaction& tx)
 {
-    string strHexHash = tx.GetHash().GetHex(); // the hex-encoded transaction hash (aka the transaction id)
-
-    fprintf(stdout, "%s\n", strHexHash.c_str());
+    return tx.GetHash().GetHex(); // the hex-encoded transaction hash (aka the transaction id)
 }
 
-static void OutputTxHex(const CTransaction& tx)
+static string FormatTxHex(const CTransaction& tx)
 {
-    string strHex = EncodeHexTx(tx);
-
-    fprintf(stdout, "%s\n", strHex.c_str());
+    return EncodeHexTx(tx);
 }
 
-static void OutputTx(const CTransaction& tx)
+//! The transaction as it is written out; batches keep JSON on a single line
+static string FormatTx(const CTransaction& tx, bool fBatch)
 {
     if (settings.GetBoolArg("-json", false))
-        OutputTxJSON(tx);
+        return FormatTxJSON(tx, fBatch ? 0 : 4);
     else if (settings.GetBoolArg("-txid", false))
-        OutputTxHash(tx);
+        return FormatTxHash(tx);
     else
-        OutputTxHex(tx);
+        return FormatTxHex(tx);
+}
+
+static void OutputTx(const CTransaction& tx)
+{
+    fprintf(stdout, "%s\n", FormatTx(tx, false).c_str());
 }
 
 static string readStdin()
@@ -535,6 +567,150 @@ static string readStdin()
     return ret;
 }
 
+static void SplitCommand(const string& arg, string& key, string& value)
+{
+    size_t eqpos = arg.find('=');
+    if (eqpos == string::npos)
+        key = arg;
+    else {
+        key = arg.substr(0, eqpos);
+        value = arg.substr(eqpos + 1);
+    }
+}
+
+static bool IsRegisterCommand(const string& key)
+{
+    return key == "load" || key == "set";
+}
+
+/** What a batch has in common for every one of its transactions */
+struct BatchCommands {
+    Registers registers;
+    vector<pair<string, string> > commands;
+};
+
+//! The result line for one line of a batch, as <hex-tx> or -create followed by commands
+static string ProcessBatchLine(const string& line, const BatchCommands& common, SigningKeys& signingKeys)
+{
+    vector<string> args;
+    boost::algorithm::split(args, line, boost::algorithm::is_space(), boost::algorithm::token_compress_on);
+
+    CTransaction txDecodeTmp;
+    if (args[0] != "-create" && !DecodeHexTx(txDecodeTmp, args[0]))
+        throw runtime_error("invalid transaction encoding");
+
+    CMutableTransaction tx(txDecodeTmp);
+    Registers registers(common.registers);
+    for (const pair<string, string>& command : common.commands)
+        MutateTx(tx, command.first, command.second, registers, signingKeys);
+    for (size_t i = 1; i < args.size(); i++) {
+        string key, value;
+        SplitCommand(args[i], key, value);
+        MutateTx(tx, key, value, registers, signingKeys);
+    }
+    return FormatTx(tx, true);
+}
+
+static void ProcessBatchLines(
+    const vector<string>& lines,
+    vector<string>& results,
+    boost::atomic<size_t>& nextLine,
+    boost::atomic<bool>& fFailed,
+    const BatchCommands& common,
+    SigningKeys& signingKeys)
+{
+    for (size_t nLine = nextLine++; nLine < lines.size(); nLine = nextLine++) {
+        try {
+            results[nLine] = ProcessBatchLine(lines[nLine], common, signingKeys);
+        } catch (const std::exception& e) {
+            results[nLine] = string("error: ") + e.what();
+            fFailed = true;
+        }
+    }
+}
+
+static int BatchRawTx(int argc, char* argv[])
+{
+    string strPrint;
+    int nRet = 0;
+    try {
+        // Skip switches
+        while (argc > 1 && IsSwitchChar(argv[1][0]) &&
+               (argv[1][1] != 0)) {
+            argc--;
+            argv++;
+        }
+
+        BatchCommands common;
+        SigningKeys unusedKeys;
+        for (int i = 1; i < argc; i++) {
+            string key, value;
+            SplitCommand(argv[i], key, value);
+            if (IsRegisterCommand(key)) {
+                CMutableTransaction unused;
+                MutateTx(unused, key, value, common.registers, unusedKeys);
+            } else {
+                common.commands.push_back(make_pair(key, value));
+            }
+        }
+
+        int64_t nThreads = settings.GetArg("-batchthreads", 0);
+        if (nThreads <= 0)
+            nThreads = std::max(1u, boost::thread::hardware_concurrency());
+        // Each thread keeps the keys it decoded for the lines that follow
+        vector<SigningKeys> signingKeys(nThreads);
+
+        boost::atomic<bool> fFailed(false);
+        bool fEndOfInput = false;
+        while (!fEndOfInput) {
+            vector<string> lines;
+            string line;
+            while (lines.size() < BATCH_LINES) {
+                if (!getline(std::cin, line)) {
+                    fEndOfInput = true;
+                    break;
+                }
+                boost::algorithm::trim(line);
+                if (!line.empty())
+                    lines.push_back(line);
+            }
+            if (std::cin.bad())
+                throw runtime_error("error reading stdin");
+
+            vector<string> results(lines.size());
+            boost::atomic<size_t> nextLine(0);
+            boost::thread_group threads;
+            for (int64_t nThread = 1; nThread < nThreads && static_cast<size_t>(nThread) < lines.size(); nThread++) {
+                threads.create_thread(boost::bind(&ProcessBatchLines, boost::cref(lines), boost::ref(results),
+                    boost::ref(nextLine), boost::ref(fFailed), boost::cref(common), boost::ref(signingKeys[nThread])));
+            }
+            ProcessBatchLines(lines, results, nextLine, fFailed, common, signingKeys[0]);
+            threads.join_all();
+
+            for (const string& result : results)
+                fprintf(stdout, "%s\n", result.c_str());
+            fflush(stdout);
+        }
+        if (fFailed)
+            nRet = EXIT_FAILURE;
+    }
+
+    catch (boost::thread_interrupted) {
+        throw;
+    } catch (std::exception& e) {
+        strPrint = string("error: ") + e.what();
+        nRet = EXIT_FAILURE;
+    } catch (...) {
+        PrintExceptionContinue(NULL, "BatchRawTx()");
+        throw;
+    }
+
+    if (strPrint != "") {
+        fprintf(stderr, "%s\n", strPrint.c_str());
+    }
+    return nRet;
+}
+
 static int CommandLineRawTx(int argc, char* argv[])
 {
     string strPrint;
@@ -568,19 +744,13 @@ static int CommandLineRawTx(int argc, char* argv[])
             startArg = 1;
 
         CMutableTransaction tx(txDecodeTmp);
+        Registers registers;
+        SigningKeys signingKeys;
 
         for (int i = startArg; i < argc; i++) {
-            string arg = argv[i];
             string key, value;
-            size_t eqpos = arg.find('=');
-            if (eqpos == string::npos)
-                key = arg;
-            else {
-                key = arg.substr(0, eqpos);
-                value = arg.substr(eqpos + 1);
-            }
-
-            MutateTx(tx, key, value);
+            SplitCommand(argv[i], key, value);
+            MutateTx(tx, key, value, registers, signingKeys);
         }
 
         OutputTx(tx);
@@ -619,7 +789,7 @@ int main(int argc, char* argv[])
 
     int ret = EXIT_FAILURE;
     try {
-        ret = CommandLineRawTx(argc, argv);
+        ret = settings.GetBoolArg("-batch", false) ? BatchRawTx(argc, argv) : CommandLineRawTx(argc, argv);
     } catch (std::exception& e) {
         PrintExceptionContinue(&e, "CommandLineRawTx()");
     } catch (...) {
@@ -35,9 +35,12 @@
 #include <utiltime.h>
 
 #include <Settings.h>
+#include <sync.h>
 
 extern BlockMap mapBlockIndex;
 extern Settings& settings;
+extern CCriticalSection cs_main;
+extern CCoinsViewCache* pcoinsTip;
 
 
 // Hard checkpoints of stake modifiers to ensure they are deterministic
@@ -235,7 +238,32 @@ void SetStakeModifiersForNewBlockIndex(CBlockIndex* pindexNew)
 }
 
 // Check kernel hash target and coinstake signature
+// Blocks building on the tip spend coins that are in the coin database, so
+// lookups that may go to the coin database anyway (fAllowSlow) are answered
+// from it before falling back to reading the staked transactions from disk.
+// Other lookups keep going through the transaction index only.
+static bool GetStakeInputOutput(
+    const CChain& activeChain,
+    const CBlockIndex* pindexPrev,
+    const COutPoint& prevout,
+    CTxOut& output,
+    uint256& hashBlock,
+    bool fAllowSlow = false)
+{
+    if (fAllowSlow && pcoinsTip != NULL && pindexPrev == activeChain.Tip()) {
+        AssertLockHeld(cs_main);
+        const CCoins* coins = pcoinsTip->AccessCoins(prevout.hash);
+        if (coins && coins->IsAvailable(prevout.n) && coins->nHeight >= 0 && coins->nHeight <= activeChain.Height()) {
+            output = coins->vout[prevout.n];
+            hashBlock = activeChain[coins->nHeight]->GetBlockHash();
+            return true;
+        }
+    }
+    return GetTransactionOutput(prevout, output, hashBlock, fAllowSlow);
+}
+
 bool CheckProofOfStakeContextAndRecoverStakingData(
+    const CChain& activeChain,
     const CBlock& block, CBlockIndex* pindexPrev, StakingData& stakingData)
 {
     static const unsigned maxInputs = settings.MaxNumberOfPoSCombinableInputs();
@@ -252,24 +280,24 @@ bool CheckProofOfStakeContextAndRecoverStakingData(
 
     // First try finding the previous transaction in database
     uint256 hashBlock;
-    CTransaction txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
+    CTxOut kernelOutput;
+    if (!GetStakeInputOutput(activeChain, pindexPrev, txin.prevout, kernelOutput, hashBlock, true))
         return error("CheckProofOfStake() : INFO: read txPrev failed");
 
-    const CScript &kernelScript = txPrev.vout[txin.prevout.n].scriptPubKey;
+    const CScript &kernelScript = kernelOutput.scriptPubKey;
 
     // All other inputs (if any) must pay to the same script.
     for (unsigned i = 1; i < tx.vin.size (); ++i) {
-        CTransaction txPrev2;
+        CTxOut output2;
         uint256 hashBlock2;
-        if (!GetTransaction(tx.vin[i].prevout.hash, txPrev2, hashBlock2))
+        if (!GetStakeInputOutput(activeChain, pindexPrev, tx.vin[i].prevout, output2, hashBlock2))
             return error("CheckProofOfStake() : INFO: read txPrev failed for input %u", i);
-        if (txPrev2.vout[tx.vin[i].prevout.n].scriptPubKey != kernelScript)
+        if (output2.scriptPubKey != kernelScript)
             return error("CheckProofOfStake() : Stake input %u pays to different script", i);
     }
 
     //verify signature and script
-    if (!VerifyScript(txin.scriptSig, txPrev.vout[txin.prevout.n].scriptPubKey, POS_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
+    if (!VerifyScript(txin.scriptSig, kernelScript, POS_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
         return error("CheckProofOfStake() : VerifySignature failed on coinstake %s", tx.ToStringShort());
 
     CBlockIndex* pindex = NULL;
@@ -279,27 +307,28 @@ bool CheckProofOfStakeContextAndRecoverStakingData(
     else
         return error("CheckProofOfStake() : read block failed");
 
-    // Read block header
-    CBlock blockprev;
-    if (!ReadBlockFromDisk(blockprev, pindex->GetBlockPos()))
-        return error("CheckProofOfStake(): INFO: failed to find block");
-
+    // The block index has the header fields needed, even once the block itself was pruned
     stakingData = StakingData(
         block.nBits,
-        blockprev.GetBlockTime(),
-        blockprev.GetHash(),
+        pindex->GetBlockTime(),
+        pindex->GetBlockHash(),
         txin.prevout,
-        txPrev.vout[txin.prevout.n].nValue,
+        kernelOutput.nValue,
         pindexPrev->GetBlockHash());
 
     return true;
 }
-bool CheckProofOfStake(CChain& activeChain, const CBlock& block, CBlockIndex* pindexPrev, uint256& hashProofOfStake)
+const I_ProofOfStakeGenerator& GetProofOfStakeGenerator(const CChain& activeChain)
 {
     static ProofOfStakeModule posModule(Params(),activeChain,mapBlockIndex);
-    static const I_ProofOfStakeGenerator& posGenerator = posModule.proofOfStakeGenerator();
+    return posModule.proofOfStakeGenerator();
+}
+
+bool CheckProofOfStake(const CChain& activeChain, const CBlock& block, CBlockIndex* pindexPrev, uint256& hashProofOfStake)
+{
+    const I_ProofOfStakeGenerator& posGenerator = GetProofOfStakeGenerator(activeChain);
     StakingData stakingData;
-    if(!CheckProofOfStakeContextAndRecoverStakingData(block,pindexPrev,stakingData))
+    if(!CheckProofOfStakeContextAndRecoverStakingData(activeChain,block,pindexPrev,stakingData))
         return false;
     if (!posGenerator.ComputeAndVerifyProofOfStake(stakingData, block.nTime, hashProofOfStake))
         return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s \n",
@@ -18,11 +18,15 @@ class COutPoint;
 class BlockMap;
 class CChain;
 struct StakingData;
+class I_ProofOfStakeGenerator;
+
+/** The proof of stake generator of the active chain, shared by validation and the staker so they fill one stake modifier cache */
+const I_ProofOfStakeGenerator& GetProofOfStakeGenerator(const CChain& activeChain);
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
 bool CheckProofOfStake(
-    CChain& activeChain,
+    const CChain& activeChain,
     const CBlock& block,
     CBlockIndex* pindexPrev,
     uint256& hashProofOfStake);
@@ -26,14 +26,62 @@ void HandleError(const leveldb::Status& status) noexcept(false)
     throw leveldb_error("Unknown database error");
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+CLevelDBSnapshot::CLevelDBSnapshot(
+    const CLevelDBWrapper& db
+    ): pdb(db.pdb)
+    , psnapshot(db.pdb->GetSnapshot())
+{
+}
+
+CLevelDBSnapshot::~CLevelDBSnapshot()
+{
+    pdb->ReleaseSnapshot(psnapshot);
+}
+
+CLevelDBTuning::CLevelDBTuning(
+    size_t nCacheSize
+    ): nBlockCacheSize(nCacheSize / 2)
+    , nWriteBufferSize(nCacheSize / 4)
+    , nMaxOpenFiles(64)
+    , nBloomBitsPerKey(10)
+{
+}
+
+CLevelDBTuning CLevelDBTuning::ForChainstate(size_t nCacheSize, bool fInitialSync)
+{
+    CLevelDBTuning tuning(nCacheSize);
+    if (fInitialSync) {
+        // Almost every lookup while syncing is for a coin created moments
+        // ago, which the coins tip cache serves; spend the memory on fewer,
+        // larger flushes to level 0 instead.
+        tuning.nBlockCacheSize = nCacheSize / 4;
+        tuning.nWriteBufferSize = nCacheSize * 3 / 8;
+    }
+    return tuning;
+}
+
+CLevelDBTuning CLevelDBTuning::ForBlockIndex(size_t nCacheSize, bool fInitialSync)
+{
+    CLevelDBTuning tuning(nCacheSize);
+    // Block index entries are loaded once at startup and then only appended,
+    // so the cache matters less than for the coin database.
+    tuning.nMaxOpenFiles = 32;
+    if (fInitialSync) {
+        tuning.nBlockCacheSize = nCacheSize / 8;
+        tuning.nWriteBufferSize = nCacheSize * 7 / 16;
+    }
+    return tuning;
+}
+
+static leveldb::Options GetOptions(const CLevelDBTuning& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(tuning.nBlockCacheSize);
+    options.write_buffer_size = tuning.nWriteBufferSize; // up to two write buffers may be held in memory simultaneously
+    if (tuning.nBloomBitsPerKey > 0)
+        options.filter_policy = leveldb::NewBloomFilterPolicy(tuning.nBloomBitsPerKey);
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.max_open_files = tuning.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -42,14 +90,36 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
+CLevelDBWrapper::CLevelDBWrapper(
+    const boost::filesystem::path& path,
+    size_t nCacheSize,
+    bool fMemory,
+    bool fWipe
+    ): tuning(nCacheSize)
+    , nValueType(SER_DISK)
+{
+    Open(path, fMemory, fWipe);
+}
+
+CLevelDBWrapper::CLevelDBWrapper(
+    const boost::filesystem::path& path,
+    const CLevelDBTuning& tuningIn,
+    bool fMemory,
+    bool fWipe
+    ): tuning(tuningIn)
+    , nValueType(SER_DISK)
+{
+    Open(path, fMemory, fWipe);
+}
+
+void CLevelDBWrapper::Open(const boost::filesystem::path& path, bool fMemory, bool fWipe)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -60,7 +130,8 @@ CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCa
             leveldb::DestroyDB(path.string(), options);
         }
         TryCreateDirectory(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s (cache %u MiB, write buffer %u MiB, %d open files)\n", path.string(),
+            (unsigned int)(tuning.nBlockCacheSize >> 20), (unsigned int)(tuning.nWriteBufferSize >> 20), tuning.nMaxOpenFiles);
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     HandleError(status);
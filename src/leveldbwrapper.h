@@ -32,7 +32,12 @@ class CLevelDBBatch
 private:
     leveldb::WriteBatch batch;
 
+    //! serialization type values are written with; keys always use SER_DISK
+    int nValueType;
+
 public:
+    explicit CLevelDBBatch(int nValueTypeIn = SER_DISK) : nValueType(nValueTypeIn) {}
+
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
@@ -41,7 +46,7 @@ public:
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(nValueType, CLIENT_VERSION);
         ssValue.reserve(ssValue.GetSerializeSize(value));
         ssValue << value;
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
@@ -59,14 +64,148 @@ public:
 
         batch.Delete(slKey);
     }
+
+    void Clear()
+    {
+        batch.Clear();
+    }
+};
+
+/**
+ * How a database spends its share of -dbcache and file descriptors. LevelDB
+ * fixes these when the database is opened, so a profile is picked up front
+ * from how the database is about to be used.
+ */
+struct CLevelDBTuning {
+    //! Memory for caching uncompressed table blocks
+    size_t nBlockCacheSize;
+    //! Memory for buffering writes before they are sorted into a table file; up to two may be held at once
+    size_t nWriteBufferSize;
+    //! Table files kept open at once
+    int nMaxOpenFiles;
+    //! Bits per key of the bloom filters that spare reads of missing keys a disk seek, 0 for none
+    int nBloomBitsPerKey;
+
+    //! Half of the cache for table blocks and a quarter for each write buffer
+    explicit CLevelDBTuning(size_t nCacheSize);
+
+    //! Coin database: random lookups, many of them for outputs that do not exist
+    static CLevelDBTuning ForChainstate(size_t nCacheSize, bool fInitialSync);
+    //! Block index database, which also holds the transaction, address and spent indexes
+    static CLevelDBTuning ForBlockIndex(size_t nCacheSize, bool fInitialSync);
+};
+
+class CLevelDBWrapper;
+
+/**
+ * Cursor over the serialized keys and values of a CLevelDBWrapper, in key
+ * order or backwards.
+ */
+class CLevelDBIterator
+{
+private:
+    leveldb::Iterator* piter;
+
+    //! serialization type values are read with
+    int nValueType;
+
+    CLevelDBIterator(const CLevelDBIterator&);
+    void operator=(const CLevelDBIterator&);
+
+    template <typename K>
+    static CDataStream SerializeKey(const K& key)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(ssKey.GetSerializeSize(key));
+        ssKey << key;
+        return ssKey;
+    }
+
+public:
+    //! Takes over piterIn
+    CLevelDBIterator(leveldb::Iterator* piterIn, int nValueTypeIn) : piter(piterIn), nValueType(nValueTypeIn) {}
+    ~CLevelDBIterator() { delete piter; }
+
+    bool Valid() const { return piter->Valid(); }
+    void Next() { piter->Next(); }
+    void Prev() { piter->Prev(); }
+    void SeekToFirst() { piter->SeekToFirst(); }
+    void SeekToLast() { piter->SeekToLast(); }
+
+    //! Position at the first entry at or after key
+    template <typename K>
+    void Seek(const K& key)
+    {
+        CDataStream ssKey = SerializeKey(key);
+        piter->Seek(leveldb::Slice(&ssKey[0], ssKey.size()));
+    }
+
+    //! Position at the last entry before key, to walk a range of keys backwards from its end
+    template <typename K>
+    void SeekBefore(const K& key)
+    {
+        Seek(key);
+        if (Valid())
+            Prev();
+        else
+            SeekToLast();
+    }
+
+    template <typename K>
+    bool GetKey(K& key) const
+    {
+        leveldb::Slice slKey = piter->key();
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    template <typename V>
+    bool GetValue(V& value) const
+    {
+        leveldb::Slice slValue = piter->value();
+        try {
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), nValueType, CLIENT_VERSION);
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+};
+
+/** Pins the state of a database as of its creation for reads; the database must outlive it */
+class CLevelDBSnapshot
+{
+private:
+    friend class CLevelDBWrapper;
+
+    leveldb::DB* pdb;
+    const leveldb::Snapshot* psnapshot;
+
+    CLevelDBSnapshot(const CLevelDBSnapshot&);
+    void operator=(const CLevelDBSnapshot&);
+
+public:
+    explicit CLevelDBSnapshot(const CLevelDBWrapper& db);
+    ~CLevelDBSnapshot();
 };
 
 class CLevelDBWrapper
 {
 private:
+    friend class CLevelDBSnapshot;
+
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
 
+    //! profile the database options were derived from
+    CLevelDBTuning tuning;
+
     //! database options used
     leveldb::Options options;
 
@@ -85,12 +224,38 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! serialization type values are read and written with
+    int nValueType;
+
+    void Open(const boost::filesystem::path& path, bool fMemory, bool fWipe);
+
+    leveldb::ReadOptions GetReadOptions(const CLevelDBSnapshot* psnapshot) const
+    {
+        leveldb::ReadOptions options = readoptions;
+        if (psnapshot)
+            options.snapshot = psnapshot->psnapshot;
+        return options;
+    }
+
 public:
     CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CLevelDBWrapper(const boost::filesystem::path& path, const CLevelDBTuning& tuning, bool fMemory = false, bool fWipe = false);
     ~CLevelDBWrapper();
 
+    const CLevelDBTuning& GetTuning() const { return tuning; }
+
+    //! Serialization type of stored values; only to be changed before the database is shared
+    int GetValueSerializationType() const { return nValueType; }
+    void SetValueSerializationType(int nType) { nValueType = nType; }
+
+    //! Look up one of LevelDB's introspection properties, e.g. "leveldb.stats"
+    bool GetProperty(const std::string& strProperty, std::string& strValue) const
+    {
+        return pdb->GetProperty(strProperty, &strValue);
+    }
+
     template <typename K, typename V>
-    bool Read(const K& key, V& value) const noexcept(false)
+    bool Read(const K& key, V& value, const CLevelDBSnapshot* psnapshot = NULL) const noexcept(false)
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(ssKey.GetSerializeSize(key));
@@ -98,7 +263,7 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(GetReadOptions(psnapshot), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -106,7 +271,7 @@ public:
             HandleError(status);
         }
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), nValueType, CLIENT_VERSION);
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -117,13 +282,13 @@ public:
     template <typename K, typename V>
     bool Write(const K& key, const V& value, bool fSync = false) noexcept(false)
     {
-        CLevelDBBatch batch;
+        CLevelDBBatch batch(nValueType);
         batch.Write(key, value);
         return WriteBatch(batch, fSync);
     }
 
     template <typename K>
-    bool Exists(const K& key) const noexcept(false)
+    bool Exists(const K& key, const CLevelDBSnapshot* psnapshot = NULL) const noexcept(false)
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(ssKey.GetSerializeSize(key));
@@ -131,7 +296,7 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(GetReadOptions(psnapshot), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -168,6 +333,21 @@ public:
     {
         return pdb->NewIterator(iteroptions);
     }
+
+    //! Iterator for reading a few adjacent entries, which go through the block cache like Read does
+    leveldb::Iterator* NewLookupIterator(const CLevelDBSnapshot* psnapshot = NULL) const
+    {
+        return pdb->NewIterator(GetReadOptions(psnapshot));
+    }
+
+    //! Cursor over the database, as of psnapshot if given
+    CLevelDBIterator* NewCursor(const CLevelDBSnapshot* psnapshot = NULL) const
+    {
+        leveldb::ReadOptions options = iteroptions;
+        if (psnapshot)
+            options.snapshot = psnapshot->psnapshot;
+        return new CLevelDBIterator(pdb->NewIterator(options), nValueType);
+    }
 };
 
 #endif // BITCOIN_LEVELDBWRAPPER_H
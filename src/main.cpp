@@ -11,7 +11,13 @@
 #include "addrman.h"
 #include "alert.h"
 #include "BlockFileOpener.h"
+#include <BlockFilter.h>
+#include <BlockStats.h>
+#include <CoinSupply.h>
+#include <VaultIndex.h>
+#include <BlockImportStats.h>
 #include "BlockDiskAccessor.h"
+#include <CachingBlockDataReader.h>
 #include "BlockRewards.h"
 #include "BlockSigning.h"
 #include "chainparams.h"
@@ -24,7 +30,11 @@
 #include "kernel.h"
 #include "libzerocoin/bignum.h"
 #include "masternode-payments.h"
+#include <PerformanceStatistics.h>
+#include <PrefetchingBlockDataReader.h>
+#include <InventoryRequestTracker.h>
 #include "masternodeman.h"
+#include "memusage.h"
 #include "merkleblock.h"
 #include "net.h"
 #include "pow.h"
@@ -50,9 +60,13 @@
 #include <BlockIncentivesPopulator.h>
 #include <BlockIndexLotteryUpdater.h>
 #include "libzerocoin/Denominations.h"
+#include <atomic>
+#include <list>
+#include <memory>
 #include <sstream>
 #include "Settings.h"
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/lexical_cast.hpp>
@@ -61,14 +75,31 @@
 #include <ValidationState.h>
 #include <scriptCheck.h>
 #include <blockFileInfo.h>
+#include <BlockFilePruning.h>
+#include <BlockFileScanner.h>
+#include <ParallelBlockFileReader.h>
 #include <walletdustcombiner.h>
 #include <WalletLoggingHelper.h>
 #include <TransactionOpCounting.h>
+#include <TransactionDiskAccessor.h>
+#include <RecentTransactionCache.h>
+#include <RPCResponseCache.h>
 #include <OrphanTransactions.h>
 #include <MasternodeModule.h>
 #include <IndexDatabaseUpdates.h>
 #include <BlockTransactionChecker.h>
 #include <NodeState.h>
+#include <CoinsViewWriteBuffer.h>
+#include <UtxoSnapshot.h>
+#include <CoinsSnapshotPublisher.h>
+#include <ChainstateVerifier.h>
+#include <BackgroundIndexBuilder.h>
+#include <MempoolSignaturePrevalidator.h>
+#include <MasternodeSignaturePrevalidator.h>
+#include <CompactBlock.h>
+#include <FilterableBlock.h>
+#include <BlockTransactions.h>
+#include <PartiallyDownloadedBlock.h>
 
 /** Minimum disk space required - used in CheckDiskSpace() */
 static const uint64_t nMinDiskSpace = 52428800;
@@ -96,6 +127,9 @@ BlockMap mapBlockIndex;
 std::map<uint256, uint256> mapProofOfStake;
 std::set<std::pair<COutPoint, unsigned int> > setStakeSeen;
 CChain chainActive;
+static std::atomic<const CBlockIndex*> pindexTipSnapshot(NULL);
+/** Block index entries without known children, i.e. the tips of all branches of the block tree. */
+std::set<const CBlockIndex*> setBlockIndexTips;
 CBlockIndex* pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
@@ -106,9 +140,20 @@ bool fReindex = false;
 bool fTxIndex = true;
 bool fAddressIndex = false;
 bool fSpentIndex = false;
+bool fBlockFilterIndex = false;
+bool fBlockStatsIndex = false;
+bool fSupplyIndex = false;
+bool fVaultIndex = false;
+bool fPruneMode = false;
+bool fHavePruned = false;
+uint64_t nPruneTarget = 0;
 bool fCheckBlockIndex = false;
+unsigned int nCheckBlockIndexSample = DEFAULT_CHECKBLOCKINDEX_SAMPLE;
+uint256 hashAssumeValid = 0;
+bool fHeadersFirstSync = false;
 bool fVerifyingBlocks = false;
 unsigned int nCoinCacheSize = 5000;
+size_t nCoinCacheUsage = 5000 * 300;
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
 
 CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
@@ -175,6 +220,9 @@ uint32_t nBlockSequenceId = 1;
 std::map<uint256, NodeId> mapBlockSource;
 std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
+/** Which peer to ask for each announced inventory other than blocks, and when. Protected by cs_main. */
+InventoryRequestTracker inventoryRequests;
+
 /** Number of blocks in flight with validated headers. */
 int nQueuedValidatedHeaders = 0;
 
@@ -186,6 +234,25 @@ std::set<CBlockIndex*> setDirtyBlockIndex;
 
 /** Dirty block file entries. */
 std::set<int> setDirtyFileInfo;
+
+/** Set when the block or undo files grew, so that the next flush looks for files to prune. */
+bool fCheckForPruning = false;
+
+/** Block index entries modified since the last CheckBlockIndex call. */
+std::set<CBlockIndex*> setBlockIndexToCheck;
+
+/** Whether CheckBlockIndex has walked the entire block tree since it was loaded. */
+bool fBlockIndexFullyChecked = false;
+
+/** Tip at the time of the last CheckBlockIndex call. */
+CBlockIndex* pindexLastCheckedTip = NULL;
+
+void MarkBlockIndexDirty(CBlockIndex* pindex)
+{
+    setDirtyBlockIndex.insert(pindex);
+    if (fCheckBlockIndex)
+        setBlockIndexToCheck.insert(pindex);
+}
 } // anon namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -218,6 +285,21 @@ void SyncWithWallets(const CTransaction& tx, const CBlock* pblock)
     registry.SyncWithWallets(tx, pblock);
 }
 
+void StartValidationInterfaceQueue()
+{
+    registry.StartAsynchronousNotifications();
+}
+
+void StopValidationInterfaceQueue()
+{
+    registry.StopAsynchronousNotifications();
+}
+
+void SyncWithValidationInterfaceQueue()
+{
+    registry.WaitForPendingNotifications();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Registration of network node signals.
@@ -227,14 +309,8 @@ namespace
 {
 int GetHeight()
 {
-    while (true) {
-        TRY_LOCK(cs_main, lockMain);
-        if (!lockMain) {
-            MilliSleep(50);
-            continue;
-        }
-        return chainActive.Height();
-    }
+    const CBlockIndex* tip = GetChainTipSnapshot();
+    return tip ? tip->nHeight : -1;
 }
 
 void UpdatePreferredDownload(CNode* node, CNodeState* state)
@@ -270,6 +346,7 @@ void FinalizeNode(NodeId nodeid)
     BOOST_FOREACH (const QueuedBlock& entry, state->vBlocksInFlight)
             mapBlocksInFlight.erase(entry.hash);
     EraseOrphansFor(nodeid);
+    inventoryRequests.DisconnectedPeer(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
 
     mapNodeState.erase(nodeid);
@@ -298,13 +375,19 @@ void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, CBlockIndex* pindex
     // Make sure it's not listed somewhere already.
     MarkBlockAsReceived(hash);
 
-    QueuedBlock newentry = {hash, pindex, GetTimeMicros(), nQueuedValidatedHeaders, pindex != NULL};
+    QueuedBlock newentry = {hash, pindex, GetTimeMicros(), nQueuedValidatedHeaders, pindex != NULL, std::shared_ptr<PartiallyDownloadedBlock>()};
     nQueuedValidatedHeaders += newentry.fValidatedHeaders;
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(), newentry);
     state->nBlocksInFlight++;
     mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
 }
 
+/** Whether blocks can be exchanged with the peer as compact blocks */
+static bool PeerSupportsCompactBlocks(const CNode* pnode)
+{
+    return pnode->nVersion >= COMPACT_BLOCKS_VERSION && PROTOCOL_VERSION >= COMPACT_BLOCKS_VERSION;
+}
+
 /** Check whether the last unknown block a peer advertized is not yet known. */
 void ProcessBlockAvailability(NodeId nodeid)
 {
@@ -446,19 +529,26 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
 
 } // anon namespace
 
+// Requires cs_main.
+static void CopyNodeStateStats(const CNodeState& state, CNodeStateStats& stats)
+{
+    stats.nMisbehavior = state.nMisbehavior;
+    stats.nSyncHeight = state.pindexBestKnownBlock ? state.pindexBestKnownBlock->nHeight : -1;
+    stats.nCommonHeight = state.pindexLastCommonBlock ? state.pindexLastCommonBlock->nHeight : -1;
+    stats.vHeightInFlight.clear();
+    BOOST_FOREACH (const QueuedBlock& queue, state.vBlocksInFlight) {
+        if (queue.pindex)
+            stats.vHeightInFlight.push_back(queue.pindex->nHeight);
+    }
+}
+
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats)
 {
     LOCK(cs_main);
     CNodeState* state = State(nodeid);
     if (state == NULL)
         return false;
-    stats.nMisbehavior = state->nMisbehavior;
-    stats.nSyncHeight = state->pindexBestKnownBlock ? state->pindexBestKnownBlock->nHeight : -1;
-    stats.nCommonHeight = state->pindexLastCommonBlock ? state->pindexLastCommonBlock->nHeight : -1;
-    BOOST_FOREACH (const QueuedBlock& queue, state->vBlocksInFlight) {
-        if (queue.pindex)
-            stats.vHeightInFlight.push_back(queue.pindex->nHeight);
-    }
+    CopyNodeStateStats(*state, stats);
     return true;
 }
 
@@ -495,7 +585,215 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache* pcoinsTip = NULL;
+CoinsViewWriteBuffer* pcoinsWriteBuffer = NULL;
+CCoinsViewDB* pcoinsdbview = NULL;
 CBlockTreeDB* pblocktree = NULL;
+CoinsSnapshotPublisher coinsSnapshotPublisher;
+
+bool GetCoinsSnapshot(CoinsSnapshot& snapshot)
+{
+    if (coinsSnapshotPublisher.GetLatest(snapshot))
+        return true;
+    LOCK(cs_main);
+    if (pcoinsTip == NULL || chainActive.Tip() == NULL)
+        return false;
+    return coinsSnapshotPublisher.Publish(*pcoinsTip, chainActive.Height(), snapshot);
+}
+
+void ReleaseCoinsSnapshot()
+{
+    coinsSnapshotPublisher.Clear();
+}
+
+static bool CheckBlockForChainstateVerifier(const CBlock& block)
+{
+    // The swiftTX filtering in CheckBlock reads the transaction locks.
+    LOCK(cs_main);
+    CValidationState state;
+    return CheckBlock(block, state);
+}
+
+ChainstateVerifier chainstateVerifier(&CheckBlockForChainstateVerifier, nCoinCacheSize);
+
+void ThreadVerifyChainstate(int nCheckDepth)
+{
+    RenameThread("izzy-verifychain");
+    // Blocks still being imported would not have been checked against anything yet.
+    while (fImporting || fReindex)
+        MilliSleep(1000);
+
+    CoinsSnapshot snapshot;
+    if (!GetCoinsSnapshot(snapshot))
+        return;
+    CBlockIndex* pindexTip = NULL;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator it = mapBlockIndex.find(snapshot.hashBlock);
+        if (it != mapBlockIndex.end())
+            pindexTip = it->second;
+    }
+    if (pindexTip == NULL || pindexTip->pprev == NULL)
+        return;
+
+    const BlockDiskDataReader blockDiskReader;
+    const PrefetchingBlockDataReader blockDataReader(blockDiskReader);
+    ActiveChainManager chainManager(fAddressIndex, pblocktree, blockDataReader);
+    if (!chainstateVerifier.Verify(chainManager, blockDataReader, snapshot, pindexTip, nCheckDepth)) {
+        strMiscWarning = translate("Warning: Corrupted block database detected. Please restart with -reindex.");
+        uiInterface.ThreadSafeMessageBox(strMiscWarning, "", CClientUIInterface::MSG_WARNING);
+    }
+}
+
+ChainstateVerificationProgress GetChainstateVerificationProgress()
+{
+    return chainstateVerifier.GetProgress();
+}
+
+void ThreadCompressBlockFiles(int nMinDepth)
+{
+    RenameThread("izzy-compressblk");
+    // Files are compressed oldest first; one whose blocks are not deep enough yet holds up the rest.
+    int nFile = 0;
+    while (true) {
+        bool fCold = false;
+        bool fEmpty = false;
+        if (!fImporting && !fReindex) {
+            LOCK2(cs_main, cs_LastBlockFile);
+            // The file before the last one may still be finalized by FlushBlockFile.
+            // No block is deep enough while the chain is shorter than nMinDepth.
+            const int nHeight = chainActive.Height();
+            fCold = nFile < nLastBlockFile - 1 && nHeight >= nMinDepth &&
+                    static_cast<int>(vinfoBlockFile[nFile].nHeightLast) < nHeight - nMinDepth;
+            fEmpty = fCold && vinfoBlockFile[nFile].nSize == 0;
+        }
+        if (!fCold) {
+            MilliSleep(60 * 1000);
+            continue;
+        }
+        if (!fEmpty && !IsBlockFileCompressed(nFile)) {
+            int64_t nStart = GetTimeMillis();
+            if (CompressBlockFile(nFile)) {
+                // Mappings of the original would keep its disk space in use.
+                ReleaseMappedBlockFiles();
+                LogPrint(LOG_BLOCKFILES, "%s : compressed blk%05u.dat in %dms\n", __func__, (unsigned int)nFile, GetTimeMillis() - nStart);
+            } else {
+                LogPrintf("%s : unable to compress blk%05u.dat, leaving it as it is\n", __func__, (unsigned int)nFile);
+            }
+        }
+        nFile++;
+    }
+}
+
+namespace
+{
+bool& IndexIsMaintained(BuiltIndex index)
+{
+    switch (index) {
+    case BuiltIndex::TX_INDEX:
+        return fTxIndex;
+    case BuiltIndex::ADDRESS_INDEX:
+        return fAddressIndex;
+    case BuiltIndex::BLOCK_FILTER_INDEX:
+        return fBlockFilterIndex;
+    case BuiltIndex::SUPPLY_INDEX:
+        return fSupplyIndex;
+    case BuiltIndex::VAULT_INDEX:
+        return fVaultIndex;
+    default:
+        return fSpentIndex;
+    }
+}
+
+/** Block the builder has to connect, or disconnect when it left the active chain, to get within nLag blocks of the tip; NULL once it is there */
+const CBlockIndex* NextIndexBuildStep(const BackgroundIndexBuilder& builder, int nLag, bool& fDisconnect)
+{
+    AssertLockHeld(cs_main);
+    fDisconnect = false;
+    const CBlockIndex* pindexBest = NULL;
+    if (builder.GetBestBlock() != 0) {
+        BlockMap::const_iterator it = mapBlockIndex.find(builder.GetBestBlock());
+        if (it == mapBlockIndex.end()) {
+            LogPrintf("%s : the %s was built up to the unknown block %s, starting over\n", __func__, builder.GetName(), builder.GetBestBlock());
+            return chainActive.Genesis();
+        }
+        pindexBest = it->second;
+    }
+    if (!pindexBest)
+        return chainActive.Height() > nLag ? chainActive.Genesis() : NULL;
+    if (!chainActive.Contains(pindexBest)) {
+        fDisconnect = true;
+        return pindexBest;
+    }
+    if (pindexBest->nHeight >= chainActive.Height() - nLag)
+        return NULL;
+    return chainActive[pindexBest->nHeight + 1];
+}
+
+bool ApplyIndexBuildStep(BackgroundIndexBuilder& builder, const CBlockIndex* pindex, bool fDisconnect)
+{
+    if (!(pindex->nStatus & BLOCK_HAVE_DATA) || (pindex->pprev && !(pindex->nStatus & BLOCK_HAVE_UNDO)))
+        return error("%s : block %s is not on disk", __func__, pindex->GetBlockHash());
+    return fDisconnect ? builder.DisconnectBlock(pindex) : builder.ConnectBlock(pindex);
+}
+}
+
+void ThreadBuildIndexes(const std::vector<BuiltIndex>& indexes, int nLag, int nMaxBlocksPerSecond)
+{
+    RenameThread("izzy-buildindex");
+    const BlockDiskDataReader blockReader;
+    for (const BuiltIndex index : indexes) {
+        BackgroundIndexBuilder builder(index, *pblocktree, blockReader);
+        LogPrintf("%s : building the %s in the background\n", __func__, builder.GetName());
+        int64_t nLastProgressLog = GetTime();
+        while (true) {
+            boost::this_thread::interruption_point();
+            if (fImporting || fReindex) {
+                MilliSleep(1000);
+                continue;
+            }
+            const int64_t nStart = GetTimeMillis();
+            bool fDisconnect = false;
+            const CBlockIndex* pindex = NULL;
+            {
+                LOCK(cs_main);
+                pindex = NextIndexBuildStep(builder, nLag, fDisconnect);
+            }
+            if (!pindex)
+                break;
+            if (!ApplyIndexBuildStep(builder, pindex, fDisconnect)) {
+                LogPrintf("%s : stopped building the %s, it stays off\n", __func__, builder.GetName());
+                return;
+            }
+            if (GetTime() - nLastProgressLog >= 60) {
+                LogPrintf("%s : built the %s up to height %d\n", __func__, builder.GetName(), fDisconnect ? pindex->nHeight - 1 : pindex->nHeight);
+                nLastProgressLog = GetTime();
+            }
+            if (nMaxBlocksPerSecond > 0) {
+                const int64_t nElapsed = GetTimeMillis() - nStart;
+                if (nElapsed < 1000 / nMaxBlocksPerSecond)
+                    MilliSleep(1000 / nMaxBlocksPerSecond - nElapsed);
+            }
+        }
+
+        // The last few blocks hold up block connection, which takes over from there.
+        LOCK(cs_main);
+        bool fDisconnect = false;
+        const CBlockIndex* pindex = NULL;
+        while ((pindex = NextIndexBuildStep(builder, 0, fDisconnect)) != NULL) {
+            if (!ApplyIndexBuildStep(builder, pindex, fDisconnect)) {
+                LogPrintf("%s : stopped building the %s, it stays off\n", __func__, builder.GetName());
+                return;
+            }
+        }
+        if (!builder.Finish()) {
+            LogPrintf("%s : unable to turn the %s on\n", __func__, builder.GetName());
+            return;
+        }
+        IndexIsMaintained(index) = true;
+        if (index == BuiltIndex::BLOCK_FILTER_INDEX)
+            nLocalServices |= NODE_COMPACT_FILTERS;
+    }
+}
 
 bool IsStandardTx(const CTransaction& tx, string& reason)
 {
@@ -659,6 +957,8 @@ bool AreInputsStandard(const CTransaction& tx, const CCoinsViewCache& mapInputs)
     return true;
 }
 
+static boost::thread_specific_ptr<std::vector<COutPoint> > duplicateInputsBuffer;
+
 bool CheckTransaction(const CTransaction& tx, CValidationState& state)
 {
     // Basic checks that don't depend on any context
@@ -692,14 +992,18 @@ bool CheckTransaction(const CTransaction& tx, CValidationState& state)
                              REJECT_INVALID, "bad-txns-txouttotal-toolarge");
     }
 
-    // Check for duplicate inputs
-    std::set<COutPoint> vInOutPoints;
-    for (const CTxIn& txin : tx.vin) {
-        if (vInOutPoints.count(txin.prevout))
+    // Check for duplicate inputs by sorting the prevouts, in a buffer each thread keeps for the next transaction
+    if (tx.vin.size() > 1) {
+        if (!duplicateInputsBuffer.get())
+            duplicateInputsBuffer.reset(new std::vector<COutPoint>());
+        std::vector<COutPoint>& prevouts = *duplicateInputsBuffer;
+        prevouts.clear();
+        for (const CTxIn& txin : tx.vin)
+            prevouts.push_back(txin.prevout);
+        std::sort(prevouts.begin(), prevouts.end());
+        if (std::adjacent_find(prevouts.begin(), prevouts.end()) != prevouts.end())
             return state.DoS(100, error("%s : duplicate inputs",__func__),
                              REJECT_INVALID, "bad-txns-inputs-duplicate");
-
-        vInOutPoints.insert(txin.prevout);
     }
 
     if (tx.IsCoinBase()) {
@@ -745,7 +1049,7 @@ bool RateLimiterAllowsFreeTransaction(CValidationState& state, const unsigned nS
     if (dFreeCount >= settings.GetArg("-limitfreerelay", 30) * 10 * 1000)
         return state.DoS(0, error("%s : free transaction rejected by rate limiter",__func__),
                             REJECT_INSUFFICIENTFEE, "rate limited free transaction");
-    LogPrint("mempool", "Rate limit dFreeCount: %g => %g\n", dFreeCount, dFreeCount + nSize);
+    LogPrint(LOG_MEMPOOL, "Rate limit dFreeCount: %g => %g\n", dFreeCount, dFreeCount + nSize);
     dFreeCount += nSize;
     return true;
 }
@@ -780,9 +1084,75 @@ bool CheckFeesPaidAreAcceptable(
     return true;
 }
 
+size_t GetMaxMempoolSize()
+{
+    return std::max<int64_t>(0, settings.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE)) * 1000000;
+}
+
+size_t BlockIndexDynamicMemoryUsage()
+{
+    AssertLockHeld(cs_main);
+    size_t usage = memusage::DynamicUsage(mapBlockIndex) + mapBlockIndex.get_allocator().PoolMemoryUsage() +
+                   mapBlockIndex.size() * memusage::MallocUsage(sizeof(CBlockIndex));
+    for (const std::pair<const uint256, CBlockIndex*>& entry : mapBlockIndex) {
+        const CBlockIndex* pindex = entry.second;
+        // Lottery coinstakes are shared with the next blocks until they change, and counted once, with the block owning them
+        const LotteryCoinstakeData& lottery = pindex->vLotteryWinnersCoinstakes;
+        if (!lottery.storageIsLocal || !lottery.storage)
+            continue;
+        usage += memusage::DynamicUsage(lottery.storage) + memusage::DynamicUsage(*lottery.storage);
+        for (const LotteryCoinstake& coinstake : *lottery.storage)
+            usage += memusage::DynamicUsage(*static_cast<const CScriptBase*>(&coinstake.second));
+    }
+    return usage;
+}
+
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool ignoreFees)
+{
+    return AcceptToMemoryPoolWithTime(pool, state, tx, fLimitFree, pfMissingInputs, GetTime(), ignoreFees);
+}
+
+/**
+ * Verify the scripts of a loose transaction with cs_main held only to look up
+ * the coins it spends, so that admitting it afterwards finds its signatures in
+ * the cache instead of verifying them under the lock.
+ */
+static void PrevalidateTransactionSignatures(const CTransaction& tx)
+{
+    CValidationState state;
+    if (!CheckTransaction(tx, state) || tx.IsCoinBase() || tx.IsCoinStake())
+        return;
+
+    CCoinsView dummy;
+    CCoinsViewCache view(&dummy);
+    {
+        LOCK2(cs_main, mempool.cs);
+        if (mempool.exists(tx.GetHash()))
+            return;
+        CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+        view.SetBackend(viewMemPool);
+        // Missing inputs leave it to admission to file the transaction as an orphan
+        if (!view.HaveInputs(tx))
+            return;
+        view.SetBackend(dummy);
+    }
+    MempoolSignaturePrevalidator::Prevalidate(tx, view);
+}
+
+/** Relay a transaction the mempool just accepted, handing out the mempool's own copy of it */
+static void RelayAcceptedTransaction(const CTransaction& tx)
+{
+    CTransactionRef txRef = mempool.get(tx.GetHash());
+    if (txRef)
+        RelayTransaction(txRef);
+    else
+        RelayTransaction(tx);
+}
+
+bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, int64_t nAcceptTime, bool ignoreFees)
 {
     AssertLockHeld(cs_main);
+    PerformanceTimerScope timer(PerformanceTimer::MEMPOOL_ACCEPT);
     if (pfMissingInputs)
         *pfMissingInputs = false;
 
@@ -856,6 +1226,11 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
             // do all inputs exist?
             // Note that this does not check for the presence of actual outputs (see the next check for that),
             // only helps filling in pfMissingInputs (to determine missing vs spent).
+            std::vector<uint256> prevoutTxids;
+            prevoutTxids.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin)
+                prevoutTxids.push_back(txin.prevout.hash);
+            view.PrefetchCoins(prevoutTxids);
             for (const CTxIn txin : tx.vin) {
                 if (!view.HaveCoins(txin.prevout.hash)) {
                     if (pfMissingInputs)
@@ -901,7 +1276,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 
         const CAmount nFees = nValueIn - tx.GetValueOut();
         double dPriority = view.GetPriority(tx, chainActive.Height());
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height());
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime, dPriority, chainActive.Height());
         unsigned int nSize = entry.GetTxSize();
 
         // Don't accept it if it can't get into a block
@@ -911,6 +1286,29 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
             return false;
         }
 
+        // Once the pool had to evict, require more than what went out until the bar has decayed again
+        const size_t nMaxMempoolSize = GetMaxMempoolSize();
+        double dPriorityDelta = 0;
+        CAmount nModifiedFees = nFees;
+        pool.ApplyDeltas(hash, dPriorityDelta, nModifiedFees);
+        const CAmount mempoolRejectFee = pool.GetMinFee(nMaxMempoolSize).GetFee(nSize);
+        if (!ignoreFees && mempoolRejectFee > 0 && nModifiedFees < mempoolRejectFee)
+            return state.DoS(0, error("%s : mempool min fee not met %s, %d < %d", __func__, hash, nModifiedFees, mempoolRejectFee),
+                             REJECT_INSUFFICIENTFEE, "mempool min fee not met");
+
+        // Keep unconfirmed chains short enough that updating and evicting packages stays cheap
+        std::string errString;
+        {
+            LOCK(pool.cs);
+            if (!pool.CheckChainLimits(tx, nSize,
+                                       settings.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT),
+                                       settings.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT) * 1000,
+                                       settings.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT),
+                                       settings.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000,
+                                       errString))
+                return state.DoS(0, error("%s : %s %s", __func__, hash, errString), REJECT_NONSTANDARD, "too-long-mempool-chain");
+        }
+
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         if (!CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true)) {
@@ -942,6 +1340,11 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
         if (fSpentIndex) {
             pool.addSpentIndex(entry, view);
         }
+
+        // Make room, which evicts the transaction itself if nothing in the pool pays less
+        pool.TrimToSize(nMaxMempoolSize);
+        if (!pool.exists(hash))
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
     SyncWithWallets(tx, NULL);
@@ -966,6 +1369,42 @@ bool GetAddressIndex(bool addresIndexEnabled,
     return true;
 }
 
+bool GetAddressIndexPage(bool addresIndexEnabled,
+                         CBlockTreeDB* pblocktree,
+                         uint160 addressHash,
+                         int type,
+                         int start,
+                         int end,
+                         bool fNewestFirst,
+                         unsigned int nMaxTransactions,
+                         const CAddressIndexKey* pkeyAfter,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                         bool& fMore)
+{
+    if (!addresIndexEnabled)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndexPage(addressHash, type, start, end, fNewestFirst, nMaxTransactions, pkeyAfter, addressIndex, fMore))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressBalance(bool addresIndexEnabled,
+                       CBlockTreeDB* pblocktree,
+                       uint160 addressHash,
+                       int type,
+                       CAddressBalance& balance)
+{
+    if (!addresIndexEnabled)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 bool GetAddressUnspent(bool addresIndexEnabled,
                       CBlockTreeDB* pblocktree,
                       uint160 addressHash,
@@ -982,6 +1421,26 @@ bool GetAddressUnspent(bool addresIndexEnabled,
     return true;
 }
 
+bool GetAddressUnspentPage(bool addresIndexEnabled,
+                           CBlockTreeDB* pblocktree,
+                           uint160 addressHash,
+                           int type,
+                           int nMinHeight,
+                           CAmount nMinAmount,
+                           unsigned int nMaxOutputs,
+                           const CAddressUnspentKey* pkeyAfter,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                           bool& fMore)
+{
+    if (!addresIndexEnabled)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndexPage(addressHash, type, nMinHeight, nMinAmount, nMaxOutputs, pkeyAfter, unspentOutputs, fMore))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
     if (!fSpentIndex)
@@ -996,6 +1455,42 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return true;
 }
 
+bool GetBlockFilter(const CBlockIndex* pindex, BlockFilter& filter)
+{
+    if (!fBlockFilterIndex || !pindex)
+        return false;
+    return pblocktree->ReadBlockFilter(pindex->GetBlockHash(), filter);
+}
+
+bool GetBlockStats(const CBlockIndex* pindex, BlockStats& stats)
+{
+    if (!fBlockStatsIndex || !pindex)
+        return false;
+    return pblocktree->ReadBlockStats(pindex->GetBlockHash(), stats);
+}
+
+bool GetVaultIndex(VaultIndexRole role, const uint160& keyHash, std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vaults)
+{
+    if (!fVaultIndex)
+        return error("vault index not enabled");
+
+    if (!pblocktree->ReadVaultIndex(role, keyHash, vaults))
+        return error("unable to get vaults for key hash");
+
+    return true;
+}
+
+bool GetCoinSupply(const CBlockIndex* pindex, CoinSupply& supply)
+{
+    if (!fSupplyIndex || !pindex)
+        return false;
+    if (!pindex->pprev) {
+        supply = CoinSupply(pindex->GetBlockHash());
+        return true;
+    }
+    return pblocktree->ReadCoinSupply(pindex->GetBlockHash(), supply);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // CBlock and CBlockIndex
@@ -1140,7 +1635,7 @@ void InvalidBlockFound(CBlockIndex* pindex, const CValidationState& state)
     }
     if (!state.CorruptionPossible()) {
         pindex->nStatus |= BLOCK_FAILED_VALID;
-        setDirtyBlockIndex.insert(pindex);
+        MarkBlockIndexDirty(pindex);
         setBlockIndexCandidates.erase(pindex);
         InvalidChainFound(pindex);
     }
@@ -1152,6 +1647,11 @@ void FlushBlockFile(bool fFinalize = false)
 
     CDiskBlockPos posOld(nLastBlockFile, 0);
 
+    // Blocks are written through a handle kept open across writes, which must not outlive
+    // the file being finalized.
+    if (fFinalize)
+        CloseBlockFileAppender();
+
     FILE* fileOld = OpenBlockFile(posOld);
     if (fileOld) {
         if (fFinalize)
@@ -1183,6 +1683,8 @@ bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigne
     unsigned int nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     unsigned int nNewChunks = (nNewSize + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     if (nNewChunks > nOldChunks) {
+        if (fPruneMode)
+            fCheckForPruning = true;
         if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos)) {
             FILE* file = OpenUndoFile(pos);
             if (file) {
@@ -1197,6 +1699,67 @@ bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigne
     return true;
 }
 
+int GetPruneKeepDepth()
+{
+    return std::max(MIN_BLOCKS_TO_KEEP, Params().MaxReorganizationDepth());
+}
+
+/** Forget the block and undo data stored in block file nFile, so that the file can be deleted */
+void static PruneOneBlockFile(int nFile)
+{
+    AssertLockHeld(cs_main);
+    for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
+        CBlockIndex* pindex = it->second;
+        if (!(pindex->nStatus & BLOCK_HAVE_MASK) || pindex->nFile != nFile)
+            continue;
+        // nTx stays, the block has been validated and counted in nChainTx of its descendants.
+        pindex->nStatus &= ~BLOCK_HAVE_MASK;
+        pindex->nFile = 0;
+        pindex->nDataPos = 0;
+        pindex->nUndoPos = 0;
+        MarkBlockIndexDirty(pindex);
+
+        // Its children can only be connected once it was downloaded again, which puts them back.
+        std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex->pprev);
+        while (range.first != range.second) {
+            std::multimap<CBlockIndex*, CBlockIndex*>::iterator itUnlinked = range.first++;
+            if (itUnlinked->second == pindex)
+                mapBlocksUnlinked.erase(itUnlinked);
+        }
+    }
+    vinfoBlockFile[nFile].SetNull();
+    setDirtyFileInfo.insert(nFile);
+}
+
+/** Prune the oldest block files while the block and undo files take up more than -prune allows */
+void static FindFilesToPrune(std::set<int>& setFilesToPrune)
+{
+    LOCK2(cs_main, cs_LastBlockFile);
+    if (chainActive.Tip() == NULL || nPruneTarget == 0)
+        return;
+
+    const uint64_t nUsageBefore = CalculateBlockFilesUsage(vinfoBlockFile);
+    const int nLastHeightToPrune = chainActive.Tip()->nHeight - GetPruneKeepDepth();
+    setFilesToPrune = FindBlockFilesToPrune(vinfoBlockFile, nLastBlockFile, nLastHeightToPrune, nPruneTarget, BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE);
+    BOOST_FOREACH (int nFile, setFilesToPrune) {
+        PruneOneBlockFile(nFile);
+    }
+    LogPrint(LOG_PRUNE, "Prune: target=%dMiB actual=%dMiB max_prune_height=%d removed %d blk/rev pairs\n",
+        nPruneTarget / 1024 / 1024, CalculateBlockFilesUsage(vinfoBlockFile) / 1024 / 1024, nLastHeightToPrune, setFilesToPrune.size());
+    if (!setFilesToPrune.empty())
+        LogPrintf("Prune: freed %dMiB of block and undo files\n", (nUsageBefore - CalculateBlockFilesUsage(vinfoBlockFile)) / 1024 / 1024);
+}
+
+void static UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
+{
+    // Mapped files would keep taking up disk space until they are evicted.
+    ReleaseMappedBlockFiles();
+    BOOST_FOREACH (int nFile, setFilesToPrune) {
+        RemoveBlockAndUndoFiles(nFile);
+        LogPrint(LOG_PRUNE, "Prune: deleted blk/rev (%05u)\n", nFile);
+    }
+}
+
 int64_t nTimeTotal = 0;
 
 void VerifyBestBlockIsAtPreviousBlock(const CBlockIndex* pindex, CCoinsViewCache& view)
@@ -1253,7 +1816,7 @@ bool WriteUndoDataToDisk(CBlockIndex* pindex, CValidationState& state, CBlockUnd
         }
 
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
-        setDirtyBlockIndex.insert(pindex);
+        MarkBlockIndexDirty(pindex);
     }
     return true;
 }
@@ -1282,7 +1845,7 @@ bool CheckMintTotalsAndBlockPayees(
     }
 
     if (blockHeight == 0) {
-        LogPrint("masternode","IsBlockValueValid() : WARNING: Couldn't find previous block\n");
+        LogPrint(LOG_MASTERNODE,"IsBlockValueValid() : WARNING: Couldn't find previous block\n");
     }
 
     if (!chainTipIsNull && !incentives.IsBlockValueValid(nExpectedMint, pindex->nMint, blockHeight)) {
@@ -1305,32 +1868,55 @@ bool UpdateDBIndicesForNewBlock(
     const IndexDatabaseUpdates& indexDatabaseUpdates,
     CValidationState& state)
 {
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(indexDatabaseUpdates.txLocationData))
-            return state.Abort("Failed to write transaction index");
-
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(indexDatabaseUpdates.addressIndex)) {
-            return state.Abort("Failed to write address index");
-        }
+    if (!fTxIndex && !fAddressIndex && !fSpentIndex && !fBlockFilterIndex && !fBlockStatsIndex && !fSupplyIndex && !fVaultIndex)
+        return true;
 
-        if (!pblocktree->UpdateAddressUnspentIndex(indexDatabaseUpdates.addressUnspentIndex)) {
-            return state.Abort("Failed to write address unspent index");
-        }
-    }
+    if (!pblocktree->WriteIndexDatabaseUpdates(indexDatabaseUpdates, fTxIndex, fAddressIndex, fSpentIndex))
+        return state.Abort("Failed to write the transaction, address, spent, block filter, block stats, supply and vault indexes");
 
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(indexDatabaseUpdates.spentIndex))
-            return state.Abort("Failed to write transaction index");
+    return true;
+}
 
+/** The supply index record of the block, from that of its parent, which is connected already */
+bool RecordCoinSupply(const CBlock& block, const CBlockUndo& blockUndo, const CBlockIndex* pindex, IndexDatabaseUpdates& indexDatabaseUpdates, CValidationState& state)
+{
+    static const std::set<CAmount> collateralAmounts = CoinSupply::GetCollateralAmounts(Params());
+    CoinSupply previous;
+    if (!GetCoinSupply(pindex->pprev, previous))
+        return state.Abort("Failed to read the coin supply of the previous block");
+    indexDatabaseUpdates.coinSupplies.push_back(CoinSupply(previous, block, blockUndo, *pindex, collateralAmounts));
     return true;
 }
 
+/**
+ * Script checks can be skipped for blocks that are ancestors of the -assumevalid
+ * block on the best header chain. Coin accounting, coinstake and payee checks
+ * are still done for such blocks. When the assumed valid block is not known yet
+ * and it is the default (the last checkpoint), blocks below the checkpoint height
+ * are covered by the checkpoint hashes themselves.
+ */
+bool BlockScriptsAreAssumedValid(const CBlockIndex* pindex)
+{
+    if (hashAssumeValid == 0)
+        return false;
+
+    BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+    if (it == mapBlockIndex.end())
+        return hashAssumeValid == checkpointsVerifier.GetLastCheckpointHash() &&
+               pindex->nHeight < checkpointsVerifier.GetTotalBlocksEstimate();
+
+    const CBlockIndex* pindexAssumeValid = it->second;
+    return pindexBestHeader != NULL &&
+           pindexAssumeValid->GetAncestor(pindex->nHeight) == pindex &&
+           pindexBestHeader->GetAncestor(pindex->nHeight) == pindex;
+}
+
 } // anonymous namespace
 
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck, bool fAlreadyChecked)
 {
     AssertLockHeld(cs_main);
+    PerformanceTimerScope timer(PerformanceTimer::CONNECT_BLOCK);
     // Check it again in case a previous version let a bad block in
     if (!fAlreadyChecked && !CheckBlock(block, state, !fJustCheck))
         return false;
@@ -1360,10 +1946,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         subsidiesContainer.blockSubsidiesProvider(),
         GetSporkManager());
 
-    const int blocksToSkipChecksFor = checkpointsVerifier.GetTotalBlocksEstimate();
+    const bool fScriptChecks = !BlockScriptsAreAssumedValid(pindex);
     IndexDatabaseUpdates indexDatabaseUpdates;
     CBlockRewards nExpectedMint = subsidiesContainer.blockSubsidiesProvider().GetBlockSubsidity(pindex->nHeight);
-    BlockTransactionChecker blockTxChecker(block,state,pindex,view,blocksToSkipChecksFor);
+    BlockTransactionChecker blockTxChecker(block,state,pindex,view,fScriptChecks);
 
     if(!blockTxChecker.Check(nExpectedMint,fJustCheck,indexDatabaseUpdates))
     {
@@ -1384,6 +1970,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (fJustCheck)
         return true;
 
+    if (fBlockFilterIndex)
+        indexDatabaseUpdates.blockFilters.push_back(BlockFilter(block, blockTxChecker.getBlockUndoData()));
+    if (fBlockStatsIndex)
+        indexDatabaseUpdates.blockStats.push_back(BlockStats(block, blockTxChecker.getBlockUndoData(), *pindex, nExpectedMint));
+    if (fSupplyIndex && !RecordCoinSupply(block, blockTxChecker.getBlockUndoData(), pindex, indexDatabaseUpdates, state))
+        return false;
     if(!WriteUndoDataToDisk(pindex,state,blockTxChecker.getBlockUndoData()) ||
        !UpdateDBIndicesForNewBlock(indexDatabaseUpdates,state))
     {
@@ -1410,9 +2002,25 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
 {
     LOCK(cs_main);
     static int64_t nLastWrite = 0;
+    static CBlockLocator locatorPreviousFlush;
+    std::set<int> setFilesToPrune;
+    bool fFlushForPrune = false;
     try {
-        if ((mode == FLUSH_STATE_ALWAYS) ||
-                ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->GetCacheSize() > nCoinCacheSize) ||
+        if (fPruneMode && fCheckForPruning && !fReindex) {
+            FindFilesToPrune(setFilesToPrune);
+            fCheckForPruning = false;
+            if (!setFilesToPrune.empty()) {
+                fFlushForPrune = true;
+                if (!fHavePruned) {
+                    pblocktree->WriteFlag("prunedblockfiles", true);
+                    fHavePruned = true;
+                }
+            }
+        }
+        // Coins handed over but not committed yet still take up memory
+        const size_t cacheUsage = pcoinsTip->DynamicMemoryUsage() + (pcoinsWriteBuffer ? pcoinsWriteBuffer->DynamicMemoryUsage() : 0);
+        if ((mode == FLUSH_STATE_ALWAYS) || fFlushForPrune ||
+                ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && cacheUsage > nCoinCacheUsage) ||
                 (mode == FLUSH_STATE_PERIODIC && GetTimeMicros() > nLastWrite + DATABASE_WRITE_INTERVAL * 1000000)) {
             // Typical CCoins structures on disk are around 100 bytes in size.
             // Pushing a new one to the database can cause it to be written
@@ -1421,6 +2029,7 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(100 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
+            const int64_t nFlushStart = GetTimeMicros();
             // First make sure all block and undo data is flushed to disk.
             FlushBlockFile();
             // Then update all block file information (which may refer to block and undo files).
@@ -1442,13 +2051,35 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
                 setDirtyBlockIndex.erase(it++);
             }
             pblocktree->Sync();
+            const int64_t nIndexWritten = GetTimeMicros();
+            BlockImportStats::AddPhaseTime(BlockImportPhase::INDEX_WRITES, nIndexWritten - nFlushStart);
+            // Pruned files can go once the block index no longer refers to them.
+            if (fFlushForPrune)
+                UnlinkPrunedFiles(setFilesToPrune);
             // Finally flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // The database batch itself is committed by the coins writer thread,
+            // so cs_main is only held until the entries have been handed over.
+            // The batch of the previous flush has to be committed first, so no
+            // more than one flush worth of coins is held outside the cache.
+            // The most recent coins stay cached, so the blocks that follow do not
+            // start out with a cold cache.
+            if (pcoinsWriteBuffer && !pcoinsWriteBuffer->WaitForPendingWrites())
+                return state.Abort("Failed to write to coin database");
+            if (!pcoinsTip->Trim(nCoinCacheUsage / 2))
                 return state.Abort("Failed to write to coin database");
+            if (mode == FLUSH_STATE_ALWAYS && pcoinsWriteBuffer && !pcoinsWriteBuffer->WaitForPendingWrites())
+                return state.Abort("Failed to write to coin database");
+            BlockImportStats::AddPhaseTime(BlockImportPhase::FLUSH, GetTimeMicros() - nIndexWritten);
             // Update best block in wallet (so we can detect restored wallets).
+            // It may only record a block whose coins are committed, which for a
+            // periodic flush is the one the previous flush led to.
+            CBlockLocator locator = chainActive.GetLocator();
             if (mode != FLUSH_STATE_IF_NEEDED) {
-                g_signals.SetBestChain(chainActive.GetLocator());
+                CBlockLocator locatorCommitted = (mode == FLUSH_STATE_ALWAYS || !pcoinsWriteBuffer) ? locator : locatorPreviousFlush;
+                if (!locatorCommitted.IsNull())
+                    registry.SetBestChain(locatorCommitted);
             }
+            locatorPreviousFlush.vHave.swap(locator.vHave);
             nLastWrite = GetTimeMicros();
         }
     } catch (const std::runtime_error& e) {
@@ -1463,20 +2094,34 @@ void FlushStateToDisk()
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+void PruneAndFlush()
+{
+    CValidationState state;
+    fCheckForPruning = true;
+    FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED);
+}
+
+const CBlockIndex* GetChainTipSnapshot()
+{
+    return pindexTipSnapshot;
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex* pindexNew)
 {
     chainActive.SetTip(pindexNew);
+    pindexTipSnapshot = pindexNew;
     GetMasternodePayments().updateChainTipHeight(pindexNew);
+    coinsSnapshotPublisher.TipChanged(*pcoinsTip, pindexNew->nHeight);
 
     // New best block
     nTimeBestReceived = GetTime();
     mempool.AddTransactionsUpdated(1);
 
-    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%u\n",
+    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%.1fMiB(%utx)\n",
               chainActive.Tip()->GetBlockHash(), chainActive.Height(), log(chainActive.Tip()->nChainWork.getdouble()) / log(2.0), (unsigned long)chainActive.Tip()->nChainTx,
               DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()),
-              checkpointsVerifier.GuessVerificationProgress(chainActive.Tip()), (unsigned int)pcoinsTip->GetCacheSize());
+              checkpointsVerifier.GuessVerificationProgress(chainActive.Tip()), pcoinsTip->DynamicMemoryUsage() * (1.0 / (1 << 20)), (unsigned int)pcoinsTip->GetCacheSize());
 
     cvBlockChange.notify_all();
 
@@ -1501,15 +2146,46 @@ void static UpdateTip(CBlockIndex* pindexNew)
     }
 }
 
-/** Disconnect chainActive's tip. */
-bool static DisconnectTip(CValidationState& state)
+/**
+ * Re-admit the transactions of a block that was just disconnected to the mempool, in block order so
+ * that parents come before the children spending them. The coins they spend are fetched into the tip
+ * cache in one pass up front, and the pool is checked once the whole block is back rather than after
+ * every transaction.
+ */
+static void ResurrectDisconnectedTransactions(const std::vector<CTransaction>& blockTransactions, unsigned int nMemPoolHeight)
+{
+    AssertLockHeld(cs_main);
+    std::vector<uint256> prevoutTxids;
+    for (const CTransaction& tx : blockTransactions) {
+        if (tx.IsCoinBase() || tx.IsCoinStake())
+            continue;
+        for (const CTxIn& txin : tx.vin)
+            prevoutTxids.push_back(txin.prevout.hash);
+    }
+    pcoinsTip->PrefetchCoins(prevoutTxids);
+
+    std::list<CTransaction> removed;
+    for (const CTransaction& tx : blockTransactions) {
+        // ignore validation errors in resurrected transactions
+        CValidationState stateDummy;
+        if (tx.IsCoinBase() || tx.IsCoinStake() || !AcceptToMemoryPool(mempool, stateDummy, tx, false))
+            mempool.remove(tx, removed, true);
+    }
+    mempool.removeCoinbaseSpends(pcoinsTip, nMemPoolHeight);
+    mempool.check(pcoinsTip);
+}
+
+/**
+ * Disconnect chainActive's tip. When fReorganizing is set, the block is disconnected on the way to
+ * another branch and the chain state is only written if the cache is full; the caller flushes once
+ * the new branch is connected.
+ */
+bool static DisconnectTip(CValidationState& state, bool fReorganizing = false, const I_BlockDataReader& blockDataReader = GetRecentBlockDataReader())
 {
     CBlockIndex* pindexDelete = chainActive.Tip();
     assert(pindexDelete);
-    mempool.check(pcoinsTip);
     // Read block from disk.
-    static const BlockDiskDataReader blockDiskReader;
-    static ActiveChainManager chainManager(fAddressIndex,pblocktree,blockDiskReader);
+    const ActiveChainManager chainManager(fAddressIndex,pblocktree,blockDataReader);
     std::pair<CBlock,bool> disconnectedBlock;
     {
          CCoinsViewCache view(pcoinsTip);
@@ -1521,20 +2197,14 @@ bool static DisconnectTip(CValidationState& state)
     std::vector<CTransaction>& blockTransactions = disconnectedBlock.first.vtx;
 
     // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+    if (!FlushStateToDisk(state, fReorganizing ? FLUSH_STATE_IF_NEEDED : FLUSH_STATE_ALWAYS))
         return false;
     // Resurrect mempool transactions from the disconnected block.
-    BOOST_FOREACH (const CTransaction& tx, blockTransactions) {
-        // ignore validation errors in resurrected transactions
-        std::list<CTransaction> removed;
-        CValidationState stateDummy;
-        if (tx.IsCoinBase() || tx.IsCoinStake() || !AcceptToMemoryPool(mempool, stateDummy, tx, false))
-            mempool.remove(tx, removed, true);
-    }
-    mempool.removeCoinbaseSpends(pcoinsTip, pindexDelete->nHeight);
-    mempool.check(pcoinsTip);
+    ResurrectDisconnectedTransactions(blockTransactions, pindexDelete->nHeight);
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev);
+    GetRecentTransactionCache().Clear();
+    GetRPCResponseCache().Clear();
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     BOOST_FOREACH (const CTransaction& tx, blockTransactions) {
@@ -1555,6 +2225,7 @@ static int64_t nTimePostConnect = 0;
  */
 bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock* pblock, bool fAlreadyChecked)
 {
+    PerformanceTimerScope timer(PerformanceTimer::CONNECT_TIP);
     assert(pindexNew->pprev == chainActive.Tip());
     mempool.check(pcoinsTip);
     CCoinsViewCache view(pcoinsTip);
@@ -1566,15 +2237,16 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
     int64_t nTime1 = GetTimeMicros();
     CBlock block;
     if (!pblock) {
-        if (!ReadBlockFromDisk(block, pindexNew))
+        if (!GetRecentBlockDataReader().ReadBlock(pindexNew, block))
             return state.Abort("Failed to read block");
         pblock = &block;
     }
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros();
     nTimeReadFromDisk += nTime2 - nTime1;
+    BlockImportStats::AddPhaseTime(BlockImportPhase::READ, nTime2 - nTime1);
     int64_t nTime3;
-    LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    LogPrint(LOG_BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         CInv inv(MSG_BLOCK, pindexNew->GetBlockHash());
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, false, fAlreadyChecked);
@@ -1587,12 +2259,14 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
         mapBlockSource.erase(inv.hash);
         nTime3 = GetTimeMicros();
         nTimeConnectTotal += nTime3 - nTime2;
-        LogPrint("bench", "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
+        BlockImportStats::AddPhaseTime(BlockImportPhase::CONNECT_BLOCK, nTime3 - nTime2);
+        LogPrint(LOG_BENCH, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         assert(view.Flush());
     }
     int64_t nTime4 = GetTimeMicros();
     nTimeFlush += nTime4 - nTime3;
-    LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
+    BlockImportStats::AddPhaseTime(BlockImportPhase::FLUSH, nTime4 - nTime3);
+    LogPrint(LOG_BENCH, "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
 
     // Write the chain state to disk, if necessary. Always write to disk if this is the first of a new file.
     FlushStateMode flushMode = FLUSH_STATE_IF_NEEDED;
@@ -1602,7 +2276,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
         return false;
     int64_t nTime5 = GetTimeMicros();
     nTimeChainState += nTime5 - nTime4;
-    LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
+    LogPrint(LOG_BENCH, "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
 
     // Remove conflicting transactions from the mempool.
     std::list<CTransaction> txConflicted;
@@ -1610,6 +2284,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
     mempool.check(pcoinsTip);
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    BlockImportStats::BlockConnected(*pblock);
     // Tell wallet about transactions that went from mempool
     // to conflicted:
     BOOST_FOREACH (const CTransaction& tx, txConflicted) {
@@ -1623,8 +2298,8 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
     int64_t nTime6 = GetTimeMicros();
     nTimePostConnect += nTime6 - nTime5;
     nTimeTotal += nTime6 - nTime1;
-    LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
-    LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
+    LogPrint(LOG_BENCH, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
+    LogPrint(LOG_BENCH, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
     return true;
 }
 
@@ -1726,10 +2401,16 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
     const CBlockIndex* pindexOldTip = chainActive.Tip();
     const CBlockIndex* pindexFork = chainActive.FindFork(pindexMostWork);
 
-    // Disconnect active blocks which are no longer in the best chain.
-    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state))
-            return false;
+    // Disconnect active blocks which are no longer in the best chain. The chain state is written
+    // once the whole step is done rather than after every disconnected block.
+    const bool fReorganizing = chainActive.Tip() && chainActive.Tip() != pindexFork;
+    if (fReorganizing) {
+        // Each block below the tip is read while the one above it is being disconnected
+        const PrefetchingBlockDataReader blockDataReader(GetRecentBlockDataReader(), pindexFork);
+        while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
+            if (!DisconnectTip(state, true, blockDataReader))
+                return false;
+        }
     }
 
     // Build list of new blocks to connect.
@@ -1775,6 +2456,9 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
         }
     }
 
+    if (fReorganizing && !FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+        return false;
+
     // Callbacks/notifications for a new best chain.
     if (fInvalidFound)
         CheckForkWarningConditionsOnNewFork(vpindexToConnect.back());
@@ -1833,7 +2517,7 @@ bool ActivateBestChain(CValidationState& state, CBlock* pblock, bool fAlreadyChe
             }
             // Notify external listeners about the new tip.
             uiInterface.NotifyBlockTip(hashNewTip);
-            g_signals.UpdatedBlockTip(pindexNewTip);
+            registry.UpdatedBlockTip(pindexNewTip);
         }
     } while (pindexMostWork != chainActive.Tip());
     CheckBlockIndex();
@@ -1852,13 +2536,13 @@ bool InvalidateBlock(CValidationState& state, CBlockIndex* pindex)
 
     // Mark the block itself as invalid.
     pindex->nStatus |= BLOCK_FAILED_VALID;
-    setDirtyBlockIndex.insert(pindex);
+    MarkBlockIndexDirty(pindex);
     setBlockIndexCandidates.erase(pindex);
 
     while (chainActive.Contains(pindex)) {
         CBlockIndex* pindexWalk = chainActive.Tip();
         pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
-        setDirtyBlockIndex.insert(pindexWalk);
+        MarkBlockIndexDirty(pindexWalk);
         setBlockIndexCandidates.erase(pindexWalk);
         // ActivateBestChain considers blocks already in chainActive
         // unconditionally valid already, so force disconnect away from it.
@@ -1892,7 +2576,7 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     while (it != mapBlockIndex.end()) {
         if (!it->second->IsValid() && it->second->GetAncestor(nHeight) == pindex) {
             it->second->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(it->second);
+            MarkBlockIndexDirty(it->second);
             if (it->second->IsValid(BLOCK_VALID_TRANSACTIONS) && it->second->nChainTx && setBlockIndexCandidates.value_comp()(chainActive.Tip(), it->second)) {
                 setBlockIndexCandidates.insert(it->second);
             }
@@ -1908,13 +2592,93 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     while (pindex != NULL) {
         if (pindex->nStatus & BLOCK_FAILED_MASK) {
             pindex->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(pindex);
+            MarkBlockIndexDirty(pindex);
         }
         pindex = pindex->pprev;
     }
     return true;
 }
 
+bool DumpUtxoSnapshot(const std::string& strPath, UtxoSnapshotMetadata& metadata, std::string& strError)
+{
+    AssertLockHeld(cs_main);
+
+    CValidationState state;
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS)) {
+        strError = state.GetRejectReason();
+        return false;
+    }
+    return WriteUtxoSnapshot(*pcoinsdbview, chainActive.Tip(), strPath, metadata, strError);
+}
+
+bool ActivateUtxoSnapshot(const std::string& strPath, UtxoSnapshotMetadata& metadata, std::string& strError)
+{
+    AssertLockHeld(cs_main);
+
+    // Index databases are built while connecting blocks and cannot be derived from a snapshot.
+    if (fTxIndex || fAddressIndex || fSpentIndex || fBlockFilterIndex || fBlockStatsIndex || fSupplyIndex || fVaultIndex) {
+        strError = "snapshots cannot be loaded with -txindex, -addressindex, -spentindex, -blockfilterindex, -blockstatsindex, -supplyindex or -vaultindex enabled";
+        return false;
+    }
+    if (!VerifyUtxoSnapshot(strPath, metadata, strError))
+        return false;
+
+    // The listed snapshots pin the money supply of the header as well, which the coins hash does not cover.
+    const bool fListed = Params().UtxoSnapshots().count(metadata.hashBaseBlock) > 0;
+    if (fListed ? !IsKnownUtxoSnapshot(metadata) : Params().RequireListedUtxoSnapshots()) {
+        strError = strprintf("snapshot %s for block %s is not a known snapshot", metadata.hashSerialized.GetHex(), metadata.hashBaseBlock.GetHex());
+        return false;
+    }
+
+    // Block data up to the base must be stored already, since the blocks after
+    // it are validated against the entries of its ancestors in the block index.
+    BlockMap::iterator mi = mapBlockIndex.find(metadata.hashBaseBlock);
+    if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA) || mi->second->nChainTx == 0) {
+        strError = "the blocks up to the snapshot base have not been downloaded yet";
+        return false;
+    }
+    CBlockIndex* pindexBase = mi->second;
+    if (pindexBase->nStatus & BLOCK_FAILED_MASK) {
+        strError = "the snapshot base block is invalid";
+        return false;
+    }
+    if (pindexBase->nHeight <= chainActive.Height() || pindexBase->GetAncestor(chainActive.Height()) != chainActive.Tip()) {
+        strError = "the snapshot base block does not extend the active chain";
+        return false;
+    }
+
+    // Hand everything cached so far to the database, so nothing stale can be written over the snapshot.
+    CValidationState state;
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS) || !pcoinsTip->Flush() || !pcoinsWriteBuffer->WaitForPendingWrites()) {
+        strError = "unable to flush the chainstate";
+        return false;
+    }
+    if (!LoadUtxoSnapshot(*pcoinsdbview, strPath, metadata, strError))
+        return false;
+    pcoinsTip->SetBestBlock(pindexBase->GetBlockHash());
+
+    // The blocks up to the base are taken to be valid as the snapshot commits to their outcome.
+    // They have no undo data, so the chain cannot be reorganized below the base afterwards.
+    for (CBlockIndex* pindex = pindexBase; pindex != chainActive.Tip(); pindex = pindex->pprev) {
+        if (pindex->RaiseValidity(BLOCK_VALID_SCRIPTS))
+            MarkBlockIndexDirty(pindex);
+    }
+    pindexBase->nMoneySupply = metadata.nMoneySupply;
+    MarkBlockIndexDirty(pindexBase);
+    mempool.clear();
+    UpdateTip(pindexBase);
+    setBlockIndexCandidates.insert(pindexBase);
+    PruneBlockIndexCandidates();
+    LogPrintf("%s: loaded %u coins entries from %s, new best=%s height=%d\n", __func__,
+              (unsigned int)metadata.nCoinsCount, strPath, pindexBase->GetBlockHash(), pindexBase->nHeight);
+
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS)) {
+        strError = state.GetRejectReason();
+        return false;
+    }
+    return true;
+}
+
 CBlockIndex* AddToBlockIndex(const CBlock& block)
 {
     static const CSporkManager& sporkManager = GetSporkManager();
@@ -1947,6 +2711,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
 
         //update previous block pointer
         pindexNew->pprev->pnext = pindexNew;
+        setBlockIndexTips.erase(pindexNew->pprev);
 
         // ppcoin: compute chain trust score
         pindexNew->bnChainTrust = (pindexNew->pprev ? pindexNew->pprev->bnChainTrust : 0) + pindexNew->GetBlockTrust();
@@ -1976,7 +2741,8 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
 
     lotteryUpdater.UpdateBlockIndexLotteryWinners(block,pindexNew);
 
-    setDirtyBlockIndex.insert(pindexNew);
+    setBlockIndexTips.insert(pindexNew);
+    MarkBlockIndexDirty(pindexNew);
 
     return pindexNew;
 }
@@ -1993,7 +2759,7 @@ bool ReceivedBlockTransactions(const CBlock& block, CValidationState& state, CBl
     pindexNew->nUndoPos = 0;
     pindexNew->nStatus |= BLOCK_HAVE_DATA;
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
-    setDirtyBlockIndex.insert(pindexNew);
+    MarkBlockIndexDirty(pindexNew);
 
     if (pindexNew->pprev == NULL || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
@@ -2009,6 +2775,8 @@ bool ReceivedBlockTransactions(const CBlock& block, CValidationState& state, CBl
                 LOCK(cs_nBlockSequenceId);
                 pindex->nSequenceId = nBlockSequenceId++;
             }
+            if (fCheckBlockIndex)
+                setBlockIndexToCheck.insert(pindex);
             if (chainActive.Tip() == NULL || !setBlockIndexCandidates.value_comp()(pindex, chainActive.Tip())) {
                 setBlockIndexCandidates.insert(pindex);
             }
@@ -2062,6 +2830,8 @@ bool FindBlockPos(CValidationState& state, CDiskBlockPos& pos, unsigned int nAdd
         unsigned int nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
         unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
         if (nNewChunks > nOldChunks) {
+            if (fPruneMode)
+                fCheckForPruning = true;
             if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos)) {
                 FILE* file = OpenBlockFile(pos);
                 if (file) {
@@ -2080,6 +2850,7 @@ bool FindBlockPos(CValidationState& state, CDiskBlockPos& pos, unsigned int nAdd
 
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleRoot)
 {
+    PerformanceTimerScope timer(PerformanceTimer::CHECK_BLOCK);
     // These are checks that are independent of context.
 
     // Check that the header is valid (particularly PoW).  This is mostly
@@ -2091,7 +2862,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleR
     }
 
     // Check timestamp
-    LogPrint("debug", "%s: block=%s  is proof of stake=%d\n", __func__, block.GetHash(), block.IsProofOfStake());
+    LogPrint(LOG_DEBUG, "%s: block=%s  is proof of stake=%d\n", __func__, block.GetHash(), block.IsProofOfStake());
     if (block.GetBlockTime() > GetAdjustedTime() + (block.IsProofOfStake() ? settings.MaxFutureBlockDrift() : 7200)) // 3 minute future drift for PoS
         return state.Invalid(error("%s : block timestamp too far in the future",__func__),
                              REJECT_INVALID, "time-too-new");
@@ -2099,7 +2870,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleR
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
-        uint256 hashMerkleRoot2 = block.BuildMerkleTree(&mutated);
+        uint256 hashMerkleRoot2 = block.ComputeMerkleRoot(&mutated);
         if (block.hashMerkleRoot != hashMerkleRoot2)
             return state.DoS(100, error("%s : hashMerkleRoot mismatch",__func__),
                              REJECT_INVALID, "bad-txnmrklroot", true);
@@ -2166,18 +2937,15 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleR
         LogPrintf("%s : skipping transaction locking checks\n",__func__);
     }
 
-    // Check transactions
+    // Check transactions, counting their sigops in the same pass
+    unsigned int nSigOps = 0;
     for (const CTransaction& tx : block.vtx) {
         if (!CheckTransaction(tx, state))
             return error("%s : CheckTransaction failed",__func__);
 
-    }
-
-
-    unsigned int nSigOps = 0;
-    BOOST_FOREACH (const CTransaction& tx, block.vtx) {
         nSigOps += GetLegacySigOpCount(tx);
     }
+
     unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_LEGACY;
     if (nSigOps > nMaxBlockSigOps)
         return state.DoS(100, error("%s : out-of-bounds SigOpCount",__func__),
@@ -2384,10 +3152,14 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
         return true;
     }
 
+    // Blocks pruned since were processed already, and are too deep to be of use again.
+    if (fHavePruned && pindex->nTx != 0)
+        return true;
+
     if ((!fAlreadyCheckedBlock && !CheckBlock(block, state)) || !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
-            setDirtyBlockIndex.insert(pindex);
+            MarkBlockIndexDirty(pindex);
         }
         return false;
     }
@@ -2395,6 +3167,7 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
     int nHeight = pindex->nHeight;
 
     // Write block to history file
+    const int64_t nWriteStart = GetTimeMicros();
     try {
         unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
         CDiskBlockPos blockPos;
@@ -2410,6 +3183,7 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
     } catch (std::runtime_error& e) {
         return state.Abort(std::string("System error: ") + e.what());
     }
+    BlockImportStats::AddPhaseTime(BlockImportPhase::INDEX_WRITES, GetTimeMicros() - nWriteStart);
 
     return true;
 }
@@ -2418,7 +3192,9 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDis
 {
     // Preliminary checks
     int64_t nStartTime = GetTimeMillis();
+    const int64_t nCheckStart = GetTimeMicros();
     bool checked = CheckBlock(*pblock, state);
+    BlockImportStats::AddPhaseTime(BlockImportPhase::CHECK_BLOCK, GetTimeMicros() - nCheckStart);
 
     // ppcoin: check proof-of-stake
     // Limited duplicity on stake: prevents block flood attack
@@ -2484,7 +3260,8 @@ bool AbortNode(const std::string& strMessage, const std::string& userMessage)
 
 bool CheckDiskSpace(uint64_t nAdditionalBytes)
 {
-    uint64_t nFreeBytesAvailable = filesystem::space(GetDataDir()).available;
+    // Block and undo files may be on another disk than the databases.
+    uint64_t nFreeBytesAvailable = std::min(filesystem::space(GetDataDir()).available, filesystem::space(GetBlocksDir()).available);
 
     // Check for nMinDiskSpace bytes (currently 50MB)
     if (nFreeBytesAvailable < nMinDiskSpace + nAdditionalBytes)
@@ -2536,7 +3313,12 @@ bool static LoadBlockIndexDB(string& strError)
     BOOST_FOREACH (const PAIRTYPE(int, CBlockIndex*) & item, vSortedByHeight) {
         CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
-        if (pindex->nStatus & BLOCK_HAVE_DATA) {
+        // Parents are visited first, so only entries without children remain in the set.
+        setBlockIndexTips.insert(pindex);
+        if (pindex->pprev)
+            setBlockIndexTips.erase(pindex->pprev);
+        // Pruned blocks keep nTx, so their descendants can still be connected.
+        if (pindex->nTx > 0) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
                     pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
@@ -2554,9 +3336,12 @@ bool static LoadBlockIndexDB(string& strError)
             pindexBestInvalid = pindex;
         if (pindex->pprev){
             pindex->BuildSkip();
-            CBlockIndex* pAncestor = pindex->GetAncestor(pindex->vLotteryWinnersCoinstakes.height());
-            pindex->vLotteryWinnersCoinstakes.updateShallowDataStore(
-                pAncestor->vLotteryWinnersCoinstakes );
+            // Parents are linked first, so a shallow copy of the parent's winners takes its storage without walking back
+            if (!pindex->vLotteryWinnersCoinstakes.shareShallowDataStoreOfPreviousBlock(pindex->pprev->vLotteryWinnersCoinstakes)) {
+                CBlockIndex* pAncestor = pindex->GetAncestor(pindex->vLotteryWinnersCoinstakes.height());
+                if (pAncestor)
+                    pindex->vLotteryWinnersCoinstakes.updateShallowDataStore(pAncestor->vLotteryWinnersCoinstakes);
+            }
         }
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == NULL || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
@@ -2671,6 +3456,12 @@ bool static LoadBlockIndexDB(string& strError)
     pblocktree->ReadReindexing(fReindexing);
     fReindex |= fReindexing;
 
+    // Check whether block files have been pruned
+    fHavePruned = false;
+    pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
+    if (fHavePruned)
+        LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
+
     // Check whether we have a transaction index
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("LoadBlockIndexDB(): transaction index %s\n", fTxIndex ? "enabled" : "disabled");
@@ -2679,10 +3470,34 @@ bool static LoadBlockIndexDB(string& strError)
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Address indexes written before the balances were kept along need them summed up once
+    bool fHaveAddressBalances = false;
+    pblocktree->ReadFlag("addressbalances", fHaveAddressBalances);
+    if (fAddressIndex && !fHaveAddressBalances && !pblocktree->BuildAddressBalances()) {
+        strError = "Failed to build the address balances";
+        return false;
+    }
+
     // Check whether we have a spent index
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have a block filter index
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
+
+    // Check whether we have a block stats index
+    pblocktree->ReadFlag("blockstatsindex", fBlockStatsIndex);
+    LogPrintf("%s: block stats index %s\n", __func__, fBlockStatsIndex ? "enabled" : "disabled");
+
+    // Check whether we have a supply index
+    pblocktree->ReadFlag("supplyindex", fSupplyIndex);
+    LogPrintf("%s: supply index %s\n", __func__, fSupplyIndex ? "enabled" : "disabled");
+
+    // Check whether we have a vault index
+    pblocktree->ReadFlag("vaultindex", fVaultIndex);
+    LogPrintf("%s: vault index %s\n", __func__, fVaultIndex ? "enabled" : "disabled");
+
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
 
@@ -2691,6 +3506,7 @@ bool static LoadBlockIndexDB(string& strError)
     if (it == mapBlockIndex.end())
         return true;
     chainActive.SetTip(it->second);
+    pindexTipSnapshot = it->second;
     GetMasternodePayments().updateChainTipHeight(it->second);
 
     PruneBlockIndexCandidates();
@@ -2705,8 +3521,13 @@ bool static LoadBlockIndexDB(string& strError)
 
 void UnloadBlockIndex()
 {
+    pindexTipSnapshot = NULL;
     mapBlockIndex.clear();
     setBlockIndexCandidates.clear();
+    setBlockIndexTips.clear();
+    setBlockIndexToCheck.clear();
+    fBlockIndexFullyChecked = false;
+    pindexLastCheckedTip = NULL;
     chainActive.SetTip(NULL);
     pindexBestInvalid = NULL;
 }
@@ -2734,10 +3555,23 @@ bool InitBlockIndex()
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = settings.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressbalances", true);
 
     fSpentIndex = settings.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    fBlockFilterIndex = settings.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+
+    fBlockStatsIndex = settings.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX);
+    pblocktree->WriteFlag("blockstatsindex", fBlockStatsIndex);
+
+    fSupplyIndex = settings.GetBoolArg("-supplyindex", DEFAULT_SUPPLYINDEX);
+    pblocktree->WriteFlag("supplyindex", fSupplyIndex);
+
+    fVaultIndex = settings.GetBoolArg("-vaultindex", DEFAULT_VAULTINDEX);
+    pblocktree->WriteFlag("vaultindex", fVaultIndex);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -2767,120 +3601,137 @@ bool InitBlockIndex()
 }
 
 
-bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
+namespace
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+// Map of disk positions for blocks with unknown parent (only used for reindex)
+std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
 
-    int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != Params().HashGenesisBlock() && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash,
-                             block.hashPrevBlock);
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
-
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, NULL, &block, dbp))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != Params().HashGenesisBlock() && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash, mapBlockIndex[hash]->nHeight);
-                }
+/** Validate a block found in a block file, and any earlier found children waiting for it; false on system errors */
+bool ProcessExternalBlock(CBlock& block, CDiskBlockPos* dbp, int& nLoaded)
+{
+    // detect out of order blocks, and store them for later
+    uint256 hash = block.GetHash();
+    if (hash != Params().HashGenesisBlock() && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+        LogPrint(LOG_REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash,
+                 block.hashPrevBlock);
+        if (dbp)
+            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+        return true;
+    }
 
-                // Recursively process earlier encountered successors of this block
-                deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash(), head);
-                            CValidationState dummy;
-                            if (ProcessNewBlock(dummy, NULL, &block, &it->second)) {
-                                nLoaded++;
-                                queue.push_back(block.GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                    }
+    // process in case the block isn't known yet
+    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+        CValidationState state;
+        if (ProcessNewBlock(state, NULL, &block, dbp))
+            nLoaded++;
+        if (state.IsError())
+            return false;
+    } else if (hash != Params().HashGenesisBlock() && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+        LogPrintf("Block Import: already had block %s at height %d\n", hash, mapBlockIndex[hash]->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+            if (ReadBlockFromDisk(block, it->second)) {
+                LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash(), head);
+                CValidationState dummy;
+                if (ProcessNewBlock(dummy, NULL, &block, &it->second)) {
+                    nLoaded++;
+                    queue.push_back(block.GetHash());
                 }
-            } catch (std::exception& e) {
-                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
             }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
         }
+    }
+    return true;
+}
+
+bool ProcessScannedBlock(CDiskBlockPos* dbp, int* pnLoaded, int64_t* pnProcessingMicros, CBlock& block, uint64_t nBlockPos)
+{
+    if (dbp)
+        dbp->nPos = nBlockPos;
+    const int64_t nStart = GetTimeMicros();
+    const bool fResult = ProcessExternalBlock(block, dbp, *pnLoaded);
+    *pnProcessingMicros += GetTimeMicros() - nStart;
+    return fResult;
+}
+
+FILE* OpenBlockFileToReindex(int nFile)
+{
+    CDiskBlockPos pos(nFile, 0);
+    if (!BlockFileExists(pos, "blk"))
+        return NULL; // No block files left to reindex
+    FILE* file = OpenBlockFile(pos, true); // Failures are logged in OpenBlockFile
+    AdviseBlockFileAccess(file, BlockFileAccess::SEQUENTIAL);
+    return file;
+}
+}
+
+bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
+{
+    int64_t nStart = GetTimeMillis();
+    const int64_t nScanStart = GetTimeMicros();
+
+    int nLoaded = 0;
+    int64_t nProcessingMicros = 0;
+    try {
+        ScanBlockFile(fileIn, Params().MessageStart(), boost::bind(&ProcessScannedBlock, dbp, &nLoaded, &nProcessingMicros, _1, _2));
     } catch (std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
+    // Whatever the scan did besides processing its blocks was reading them.
+    BlockImportStats::AddPhaseTime(BlockImportPhase::READ, GetTimeMicros() - nScanStart - nProcessingMicros);
     if (nLoaded > 0)
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
     return nLoaded > 0;
 }
 
-void static CheckBlockIndex()
+bool ReindexBlockFiles(unsigned int nThreads)
 {
-    if (!fCheckBlockIndex) {
-        return;
-    }
-
-    LOCK(cs_main);
+    int64_t nStart = GetTimeMillis();
 
-    // During a reindex, we read the genesis block and call CheckBlockIndex before ActivateBestChain,
-    // so we have the genesis block in mapBlockIndex but no active chain.  (A few of the tests when
-    // iterating the block tree require that chainActive has been initialized.)
-    if (chainActive.Height() < 0) {
-        assert(mapBlockIndex.size() <= 1);
-        return;
+    int nLoaded = 0;
+    int nFile = -1;
+    bool fSkipFile = false;
+    ParallelBlockFileReader reader(&OpenBlockFileToReindex, Params().MessageStart(), nThreads, REINDEX_QUEUED_BLOCKS_PER_FILE);
+    ParallelBlockFileReader::ScannedBlock scannedBlock;
+    int64_t nWaitStart = GetTimeMicros();
+    while (reader.Next(scannedBlock)) {
+        BlockImportStats::AddPhaseTime(BlockImportPhase::READ, GetTimeMicros() - nWaitStart);
+        boost::this_thread::interruption_point();
+        if (scannedBlock.pos.nFile != nFile) {
+            nFile = scannedBlock.pos.nFile;
+            fSkipFile = false;
+            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+        }
+        // Like a single-threaded reindex, give up on the rest of a file once validation fails to write.
+        if (fSkipFile)
+            continue;
+        try {
+            fSkipFile = !ProcessExternalBlock(*scannedBlock.block, &scannedBlock.pos, nLoaded);
+        } catch (std::exception& e) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+        nWaitStart = GetTimeMicros();
     }
+    const std::string strError = reader.GetError();
+    if (!strError.empty())
+        AbortNode(std::string("System error: ") + strError);
+    LogPrintf("Reindexed %i blocks on %u scanning threads in %dms\n", nLoaded, nThreads, GetTimeMillis() - nStart);
+    return nLoaded > 0;
+}
+
+void static CheckEntireBlockIndex()
+{
+    AssertLockHeld(cs_main);
 
     // Build forward-pointing map of the entire block tree.
     std::multimap<CBlockIndex*, CBlockIndex*> forward;
@@ -2901,14 +3752,14 @@ void static CheckBlockIndex()
     size_t nNodes = 0;
     int nHeight = 0;
     CBlockIndex* pindexFirstInvalid = NULL;         // Oldest ancestor of pindex which is invalid.
-    CBlockIndex* pindexFirstMissing = NULL;         // Oldest ancestor of pindex which does not have BLOCK_HAVE_DATA.
+    CBlockIndex* pindexFirstMissing = NULL;         // Oldest ancestor of pindex whose transactions were never received (pruning keeps nTx).
     CBlockIndex* pindexFirstNotTreeValid = NULL;    // Oldest ancestor of pindex which does not have BLOCK_VALID_TREE (regardless of being valid or not).
     CBlockIndex* pindexFirstNotChainValid = NULL;   // Oldest ancestor of pindex which does not have BLOCK_VALID_CHAIN (regardless of being valid or not).
     CBlockIndex* pindexFirstNotScriptsValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_SCRIPTS (regardless of being valid or not).
     while (pindex != NULL) {
         nNodes++;
         if (pindexFirstInvalid == NULL && pindex->nStatus & BLOCK_FAILED_VALID) pindexFirstInvalid = pindex;
-        if (pindexFirstMissing == NULL && !(pindex->nStatus & BLOCK_HAVE_DATA)) pindexFirstMissing = pindex;
+        if (pindexFirstMissing == NULL && pindex->nTx == 0) pindexFirstMissing = pindex;
         if (pindex->pprev != NULL && pindexFirstNotTreeValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TREE) pindexFirstNotTreeValid = pindex;
         if (pindex->pprev != NULL && pindexFirstNotChainValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_CHAIN) pindexFirstNotChainValid = pindex;
         if (pindex->pprev != NULL && pindexFirstNotScriptsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) pindexFirstNotScriptsValid = pindex;
@@ -2919,8 +3770,11 @@ void static CheckBlockIndex()
             assert(pindex->GetBlockHash() == Params().HashGenesisBlock()); // Genesis block's hash must match.
             assert(pindex == chainActive.Genesis());                       // The current active chain's genesis block must be this block.
         }
-        // HAVE_DATA is equivalent to VALID_TRANSACTIONS and equivalent to nTx > 0 (we stored the number of transactions in the block)
-        assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+        // HAVE_DATA is equivalent to VALID_TRANSACTIONS and equivalent to nTx > 0 (we stored the number of transactions in the block),
+        // unless block files were pruned, which leaves nTx behind.
+        if (!fHavePruned) assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+        else if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
+        if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
         assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0));
         if (pindex->nChainTx == 0) assert(pindex->nSequenceId == 0); // nSequenceId can't be set for blocks that aren't linked
         // All parents having data is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
@@ -2937,8 +3791,8 @@ void static CheckBlockIndex()
             assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0); // The failed mask cannot be set for blocks without invalid parents.
         }
         if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstMissing == NULL) {
-            if (pindexFirstInvalid == NULL) { // If this block sorts at least as good as the current tip and is valid, it must be in setBlockIndexCandidates.
-                assert(setBlockIndexCandidates.count(pindex));
+            if (pindexFirstInvalid == NULL && (!fHavePruned || pindex == chainActive.Tip())) { // If this block sorts at least as good as the current tip and is valid, it must be in setBlockIndexCandidates.
+                assert(setBlockIndexCandidates.count(pindex));                               // Once pruned, FindMostWorkChain drops those with a parent whose data is gone.
             }
         } else { // If this block sorts worse than the current tip, it cannot be in setBlockIndexCandidates.
             assert(setBlockIndexCandidates.count(pindex) == 0);
@@ -2958,8 +3812,8 @@ void static CheckBlockIndex()
             if (pindexFirstInvalid == NULL) { // If this block has block data available, some parent doesn't, and has no invalid parents, it must be in mapBlocksUnlinked.
                 assert(foundInUnlinked);
             }
-        } else { // If this block does not have block data available, or all parents do, it cannot be in mapBlocksUnlinked.
-            assert(!foundInUnlinked);
+        } else if (!fHavePruned) { // If this block does not have block data available, or all parents do, it cannot be in mapBlocksUnlinked.
+            assert(!foundInUnlinked); // Once pruned, FindMostWorkChain also puts those there whose parent's data is gone.
         }
         // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
         // End: actual consistency checks.
@@ -3009,6 +3863,118 @@ void static CheckBlockIndex()
     assert(nNodes == forward.size());
 }
 
+/** Whether pindex or one of its ancestors that are not on the active chain failed validation. */
+static bool HasInvalidForkAncestor(const CBlockIndex* pindex)
+{
+    for (; pindex != NULL && !chainActive.Contains(pindex); pindex = pindex->pprev) {
+        if (pindex->nStatus & BLOCK_FAILED_VALID) return true;
+    }
+    return false;
+}
+
+/**
+ * Same checks as CheckEntireBlockIndex for a single entry. Properties of the path from genesis
+ * are derived from the parent, which satisfies the same invariants once it has been checked itself.
+ */
+void static CheckBlockIndexEntry(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+
+    CBlockIndex* pindexPrev = pindex->pprev;
+    const int nStatusValidity = pindex->nStatus & BLOCK_VALID_MASK;
+    const int nPrevStatusValidity = pindexPrev ? (pindexPrev->nStatus & BLOCK_VALID_MASK) : 0;
+    if (pindexPrev == NULL) {
+        // Genesis block checks.
+        assert(pindex->GetBlockHash() == Params().HashGenesisBlock());
+        assert(pindex == chainActive.Genesis());
+    }
+    if (!fHavePruned) assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+    else if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
+    if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
+    assert((nStatusValidity >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0));
+    if (pindex->nChainTx == 0) assert(pindex->nSequenceId == 0);
+    // nChainTx is set iff this block and all of its parents have been received, even if their data was pruned since.
+    const bool fAllDataAvailable = pindex->nTx > 0 && (pindexPrev == NULL || pindexPrev->nChainTx != 0);
+    assert(fAllDataAvailable == (pindex->nChainTx != 0));
+    assert(pindex->nHeight == (pindexPrev ? pindexPrev->nHeight + 1 : 0));
+    assert(pindexPrev == NULL || pindex->nChainWork >= pindexPrev->nChainWork);
+    assert(pindex->nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < pindex->nHeight)));
+    if (pindexPrev != NULL) assert(nStatusValidity >= BLOCK_VALID_TREE);
+    // Validity levels imply the same level on all parents except the genesis block.
+    if (pindexPrev != NULL && pindexPrev->pprev != NULL) {
+        if (nStatusValidity >= BLOCK_VALID_CHAIN) assert(nPrevStatusValidity >= BLOCK_VALID_CHAIN);
+        if (nStatusValidity >= BLOCK_VALID_SCRIPTS) assert(nPrevStatusValidity >= BLOCK_VALID_SCRIPTS);
+    }
+    const bool fInvalid = HasInvalidForkAncestor(pindex);
+    if (!fInvalid) {
+        assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0);
+    }
+    if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && fAllDataAvailable) {
+        if (!fInvalid && (!fHavePruned || pindex == chainActive.Tip())) {
+            assert(setBlockIndexCandidates.count(pindex));
+        }
+    } else {
+        assert(setBlockIndexCandidates.count(pindex) == 0);
+    }
+    std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> rangeUnlinked = mapBlocksUnlinked.equal_range(pindexPrev);
+    bool foundInUnlinked = false;
+    for (; rangeUnlinked.first != rangeUnlinked.second; rangeUnlinked.first++) {
+        if (rangeUnlinked.first->second == pindex) {
+            foundInUnlinked = true;
+            break;
+        }
+    }
+    if (pindexPrev && pindex->nStatus & BLOCK_HAVE_DATA && !fAllDataAvailable) {
+        if (!fInvalid) {
+            assert(foundInUnlinked);
+        }
+    } else if (!fHavePruned) {
+        assert(!foundInUnlinked);
+    }
+}
+
+void static CheckBlockIndex()
+{
+    if (!fCheckBlockIndex) {
+        return;
+    }
+
+    LOCK(cs_main);
+
+    // During a reindex, we read the genesis block and call CheckBlockIndex before ActivateBestChain,
+    // so we have the genesis block in mapBlockIndex but no active chain.  (A few of the tests when
+    // iterating the block tree require that chainActive has been initialized.)
+    if (chainActive.Height() < 0) {
+        assert(mapBlockIndex.size() <= 1);
+        return;
+    }
+
+    // Walk the whole tree once, which covers everything loaded from disk. After that only the
+    // entries modified since the previous call, the current candidates and, once per tip change,
+    // a random sample of the active chain are checked.
+    if (!fBlockIndexFullyChecked) {
+        CheckEntireBlockIndex();
+        fBlockIndexFullyChecked = true;
+        setBlockIndexToCheck.clear();
+        pindexLastCheckedTip = chainActive.Tip();
+        return;
+    }
+
+    BOOST_FOREACH (CBlockIndex* pindex, setBlockIndexToCheck) {
+        CheckBlockIndexEntry(pindex);
+    }
+    setBlockIndexToCheck.clear();
+    BOOST_FOREACH (CBlockIndex* pindex, setBlockIndexCandidates) {
+        CheckBlockIndexEntry(pindex);
+    }
+    if (pindexLastCheckedTip != chainActive.Tip()) {
+        for (unsigned int i = 0; i < nCheckBlockIndexSample; i++) {
+            CheckBlockIndexEntry(chainActive[GetRand(chainActive.Height() + 1)]);
+        }
+        pindexLastCheckedTip = chainActive.Tip();
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // CAlert
@@ -3058,6 +4024,39 @@ string GetWarnings(string strFor)
 //
 
 
+/**
+ * Transactions recently turned away from the mempool for reasons other than missing inputs, so
+ * that peers announcing them again cost a lookup rather than another validation. Forgotten at
+ * every new tip, which may make them valid.
+ */
+static std::unique_ptr<CRollingBloomFilter> recentRejects;
+static uint256 hashRecentRejectsChainTip;
+
+static CRollingBloomFilter& RecentRejects()
+{
+    AssertLockHeld(cs_main);
+    if (!recentRejects)
+        recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    const uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+    if (hashTip != hashRecentRejectsChainTip) {
+        hashRecentRejectsChainTip = hashTip;
+        recentRejects->reset();
+    }
+    return *recentRejects;
+}
+
+static bool RecentlyRejected(const uint256& txid)
+{
+    return RecentRejects().contains(std::vector<unsigned char>(txid.begin(), txid.end()));
+}
+
+static void AddRecentlyRejected(const uint256& txid, const CValidationState& state)
+{
+    // A transaction that may only have been corrupted on its way here is left to be asked for again
+    if (!state.CorruptionPossible())
+        RecentRejects().insert(std::vector<unsigned char>(txid.begin(), txid.end()));
+}
+
 bool static AlreadyHave(const CInv& inv)
 {
     switch (inv.type) {
@@ -3065,6 +4064,7 @@ bool static AlreadyHave(const CInv& inv)
         bool txInMap = false;
         txInMap = mempool.exists(inv.hash);
         return txInMap || OrphanTransactionIsKnown(inv.hash) ||
+                RecentlyRejected(inv.hash) ||
                 pcoinsTip->HaveCoins(inv.hash);
     }
 
@@ -3089,11 +4089,35 @@ bool static AlreadyHave(const CInv& inv)
 }
 
 
+/** Recent blocks prepared for the filters of SPV peers, the most recently asked for first */
+static std::list<std::pair<uint256, std::shared_ptr<const FilterableBlock> > > recentFilterableBlocks;
+static CCriticalSection cs_recentFilterableBlocks;
+
+static std::shared_ptr<const FilterableBlock> GetFilterableBlock(const CBlock& block)
+{
+    const uint256 blockHash = block.GetHash();
+    LOCK(cs_recentFilterableBlocks);
+    for (std::list<std::pair<uint256, std::shared_ptr<const FilterableBlock> > >::iterator it = recentFilterableBlocks.begin();
+         it != recentFilterableBlocks.end();
+         ++it) {
+        if (it->first == blockHash) {
+            recentFilterableBlocks.splice(recentFilterableBlocks.begin(), recentFilterableBlocks, it);
+            return it->second;
+        }
+    }
+    std::shared_ptr<const FilterableBlock> filterableBlock = std::make_shared<FilterableBlock>(block);
+    recentFilterableBlocks.push_front(std::make_pair(blockHash, filterableBlock));
+    if (recentFilterableBlocks.size() > MAX_CACHED_FILTERABLE_BLOCKS)
+        recentFilterableBlocks.pop_back();
+    return filterableBlock;
+}
+
 void static ProcessGetData(CNode* pfrom)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
 
     std::vector<CInv> vNotFound;
+    pfrom->fUploadThrottled = false;
 
     while (it != pfrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
@@ -3105,8 +4129,9 @@ void static ProcessGetData(CNode* pfrom)
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
                 bool send = false;
+                bool historical = false;
                 const CBlockIndex* pindex;
                 {
                 LOCK(cs_main);
@@ -3125,21 +4150,50 @@ void static ProcessGetData(CNode* pfrom)
                             LogPrintf("ProcessGetData(): ignoring request from peer=%i for old block that isn't in the main chain\n", pfrom->GetId());
                         }
                     }
+                    // Blocks a peer needs to follow the tip go out first, the ones it catches up on wait for the upload limits
+                    historical = !pfrom->fWhitelisted && chainActive.Tip()->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE;
+                }
                 }
+                if (send && historical && !pfrom->HistoricalUploadAllowed()) {
+                    // Leave the request queued until the budgets refill
+                    --it;
+                    break;
                 }
                 // Don't send not-validated blocks
                 if (send && (pindex->nStatus & BLOCK_HAVE_DATA)) {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, pindex))
-                        assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
-                        pfrom->PushMessage("block", block);
-                    else // MSG_FILTERED_BLOCK)
+                    // Send block from disk, as it was stored unless it has to be filtered
+                    if (inv.type == MSG_BLOCK) {
+                        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+                        if (!ReadRawBlockFromDisk(ssBlock, pindex))
+                            assert(!"cannot load block from disk");
+                        pfrom->PushMessage("block", ssBlock);
+                        if (historical)
+                            pfrom->RecordHistoricalBytesSent(ssBlock.size());
+                    } else if (inv.type == MSG_CMPCT_BLOCK) {
+                        CBlock block;
+                        if (!GetRecentBlockDataReader().ReadBlock(pindex, block))
+                            assert(!"cannot load block from disk");
+                        if (historical)
+                            pfrom->RecordHistoricalBytesSent(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+                        // Older blocks are unlikely to be in the peer's mempool any more
+                        if (pindex->nHeight > chainActive.Height() - MAX_CMPCTBLOCK_DEPTH)
+                            pfrom->PushMessage("cmpctblock", CompactBlock(block, GetRand(std::numeric_limits<uint64_t>::max())));
+                        else
+                            pfrom->PushMessage("block", block);
+                    } else // MSG_FILTERED_BLOCK)
                     {
+                        CBlock block;
+                        if (!GetRecentBlockDataReader().ReadBlock(pindex, block))
+                            assert(!"cannot load block from disk");
+                        if (historical)
+                            pfrom->RecordHistoricalBytesSent(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+                        // Recent blocks are asked for by many SPV peers at once, so their scripts and merkle tree are only worked through once
+                        std::shared_ptr<const FilterableBlock> filterableBlock;
+                        if (pindex->nHeight > chainActive.Height() - MAX_FILTERABLE_BLOCK_DEPTH)
+                            filterableBlock = GetFilterableBlock(block);
                         LOCK(pfrom->cs_filter);
                         if (pfrom->pfilter) {
-                            CMerkleBlock merkleBlock(block, *pfrom->pfilter);
+                            CMerkleBlock merkleBlock = filterableBlock ? CMerkleBlock(*filterableBlock, *pfrom->pfilter) : CMerkleBlock(block, *pfrom->pfilter);
                             pfrom->PushMessage("merkleblock", merkleBlock);
                             // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
                             // This avoids hurting performance by pointlessly requiring a round-trip
@@ -3149,7 +4203,7 @@ void static ProcessGetData(CNode* pfrom)
                             // however we MUST always provide at least what the remote peer needs
                             typedef std::pair<unsigned int, uint256> PairType;
                             BOOST_FOREACH (PairType& pair, merkleBlock.vMatchedTxn)
-                                    if (!pfrom->setInventoryKnown.count(CInv(MSG_TX, pair.second)))
+                                    if (!pfrom->HasInventoryKnown(CInv(MSG_TX, pair.second)))
                                     pfrom->PushMessage("tx", block.vtx[pair.first]);
                         }
                         // else
@@ -3168,24 +4222,21 @@ void static ProcessGetData(CNode* pfrom)
                     }
                 }
             } else if (inv.IsKnownType()) {
-                // Send stream from relay memory
+                // Send transaction from relay memory
                 bool pushed = false;
                 {
                     LOCK(cs_mapRelay);
-                    std::map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
+                    std::map<CInv, CTransactionRef>::iterator mi = mapRelay.find(inv);
                     if (mi != mapRelay.end()) {
-                        pfrom->PushMessage(inv.GetCommand(), (*mi).second);
+                        pfrom->PushMessage(inv.GetCommand(), *(*mi).second);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_TX) {
-                    CTransaction tx;
-                    if (mempool.lookup(inv.hash, tx)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << tx;
-                        pfrom->PushMessage("tx", ss);
+                    CTransactionRef tx = mempool.get(inv.hash);
+                    if (tx) {
+                        pfrom->PushMessage("tx", *tx);
                         pushed = true;
                     }
                 }
@@ -3283,7 +4334,7 @@ void static ProcessGetData(CNode* pfrom)
             // Track requests for our stuff.
             g_signals.Inventory(inv.hash);
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -3302,13 +4353,79 @@ void static ProcessGetData(CNode* pfrom)
     }
 }
 
+/** Validate a block received in full or put together from a compact block, whose parent is known */
+static void ProcessReceivedBlock(CNode* pfrom, CBlock& block, const std::string& strCommand)
+{
+    const CInv inv(MSG_BLOCK, block.GetHash());
+    pfrom->AddInventoryKnown(inv);
+
+    CValidationState state;
+    if (!mapBlockIndex.count(inv.hash)) {
+        ProcessNewBlock(state, pfrom, &block);
+        int nDoS;
+        if(state.IsInvalid(nDoS)) {
+            pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
+                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
+            if(nDoS > 0) {
+                TRY_LOCK(cs_main, lockMain);
+                if(lockMain) Misbehaving(pfrom->GetId(), nDoS);
+            }
+        }
+        //disconnect this node if its old protocol version
+        pfrom->DisconnectOldProtocol(ActiveProtocol(), strCommand);
+    } else {
+        LogPrint(LOG_NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, inv.hash);
+    }
+}
+
+/** Relay fresh addresses to a limited number of other nodes, looking at the nodes once for the whole batch */
+static void RelayAddresses(const std::vector<CAddress>& vAddr)
+{
+    LOCK(cs_vNodes);
+    std::vector<std::pair<unsigned int, CNode*> > vRelayNodes;
+    BOOST_FOREACH (CNode* pnode, vNodes) {
+        if (pnode->nVersion < CADDR_TIME_VERSION)
+            continue;
+        unsigned int nPointer;
+        memcpy(&nPointer, &pnode, sizeof(nPointer));
+        vRelayNodes.push_back(std::make_pair(nPointer, pnode));
+    }
+
+    // Use deterministic randomness to send to the same nodes for 24 hours
+    // at a time so the setAddrKnowns of the chosen nodes prevent repeats
+    static const uint256 hashSalt = GetRandHash();
+    BOOST_FOREACH (const CAddress& addr, vAddr) {
+        uint64_t hashAddr = addr.GetHash();
+        uint256 hashRand = hashSalt ^ (hashAddr << 32) ^ ((GetTime() + hashAddr) / (24 * 60 * 60));
+        hashRand = Hash(BEGIN(hashRand), END(hashRand));
+        std::multimap<uint256, CNode*> mapMix;
+        for (const std::pair<unsigned int, CNode*>& relayNode : vRelayNodes) {
+            uint256 hashKey = hashRand ^ relayNode.first;
+            hashKey = Hash(BEGIN(hashKey), END(hashKey));
+            mapMix.insert(make_pair(hashKey, relayNode.second));
+        }
+        int nRelayNodes = IsReachable(addr) ? 2 : 1; // limited relaying of addresses outside our network(s)
+        for (std::multimap<uint256, CNode*>::iterator mi = mapMix.begin(); mi != mapMix.end() && nRelayNodes-- > 0; ++mi)
+            ((*mi).second)->PushAddress(addr);
+    }
+}
+
+/** Fall back to downloading the block in full, keeping it in flight from the peer */
+static void RequestFullBlock(CNode* pfrom, const uint256& hashBlock)
+{
+    std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hashBlock);
+    if (itInFlight != mapBlocksInFlight.end())
+        itInFlight->second.second->partialBlock.reset();
+    pfrom->PushMessage("getdata", std::vector<CInv>(1, CInv(MSG_BLOCK, hashBlock)));
+}
+
 bool fRequestedSporksIDB = false;
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     static CAddrMan& addrman = GetNetworkAddressManager();
-    LogPrint("net","received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
+    LogPrint(LOG_NET,"received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
     if (settings.ParameterIsSet("-dropmessagestest") && GetRand(atoi(settings.GetParameter("-dropmessagestest"))) == 0) {
-        LogPrint("net","dropmessagestest DROPPING RECV MESSAGE\n");
+        LogPrint(LOG_NET,"dropmessagestest DROPPING RECV MESSAGE\n");
         return true;
     }
 
@@ -3428,6 +4545,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     else if (strCommand == "verack") {
         pfrom->SetRecvVersion(min(pfrom->nVersion, PROTOCOL_VERSION));
 
+        // Peers that do not know "sendcompress" ignore it and keep sending uncompressed
+        if (pfrom->CompressionAllowed()) {
+            pfrom->fAcceptCompressed = true;
+            pfrom->PushMessage("sendcompress");
+        }
+
         // Mark this node as currently connected, so we update its timestamp later.
         if (pfrom->fNetworkNode) {
             LOCK(cs_main);
@@ -3448,8 +4571,9 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             return error("message addr size() = %u", vAddr.size());
         }
 
-        // Store the new addresses
+        // Store the new addresses, all in one go
         std::vector<CAddress> vAddrOk;
+        std::vector<CAddress> vAddrRelay;
         int64_t nNow = GetAdjustedTime();
         int64_t nSince = nNow - 10 * 60;
         BOOST_FOREACH (CAddress& addr, vAddr) {
@@ -3458,38 +4582,14 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             if (addr.nTime <= 100000000 || addr.nTime > nNow + 10 * 60)
                 addr.nTime = nNow - 5 * 24 * 60 * 60;
             pfrom->AddAddressKnown(addr);
-            bool fReachable = IsReachable(addr);
-            if (addr.nTime > nSince && !pfrom->fGetAddr && vAddr.size() <= 10 && addr.IsRoutable()) {
-                // Relay to a limited number of other nodes
-                {
-                    LOCK(cs_vNodes);
-                    // Use deterministic randomness to send to the same nodes for 24 hours
-                    // at a time so the setAddrKnowns of the chosen nodes prevent repeats
-                    static uint256 hashSalt;
-                    if (hashSalt == 0)
-                        hashSalt = GetRandHash();
-                    uint64_t hashAddr = addr.GetHash();
-                    uint256 hashRand = hashSalt ^ (hashAddr << 32) ^ ((GetTime() + hashAddr) / (24 * 60 * 60));
-                    hashRand = Hash(BEGIN(hashRand), END(hashRand));
-                    std::multimap<uint256, CNode*> mapMix;
-                    BOOST_FOREACH (CNode* pnode, vNodes) {
-                        if (pnode->nVersion < CADDR_TIME_VERSION)
-                            continue;
-                        unsigned int nPointer;
-                        memcpy(&nPointer, &pnode, sizeof(nPointer));
-                        uint256 hashKey = hashRand ^ nPointer;
-                        hashKey = Hash(BEGIN(hashKey), END(hashKey));
-                        mapMix.insert(make_pair(hashKey, pnode));
-                    }
-                    int nRelayNodes = fReachable ? 2 : 1; // limited relaying of addresses outside our network(s)
-                    for (std::multimap<uint256, CNode*>::iterator mi = mapMix.begin(); mi != mapMix.end() && nRelayNodes-- > 0; ++mi)
-                        ((*mi).second)->PushAddress(addr);
-                }
-            }
+            if (addr.nTime > nSince && !pfrom->fGetAddr && vAddr.size() <= 10 && addr.IsRoutable())
+                vAddrRelay.push_back(addr);
             // Do not store addresses outside our network
-            if (fReachable)
+            if (IsReachable(addr))
                 vAddrOk.push_back(addr);
         }
+        if (!vAddrRelay.empty())
+            RelayAddresses(vAddrRelay);
         addrman.Add(vAddrOk, pfrom->addr, 2 * 60 * 60);
         if (vAddr.size() < 1000)
             pfrom->fGetAddr = false;
@@ -3515,18 +4615,25 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             pfrom->AddInventoryKnown(inv);
 
             bool fAlreadyHave = AlreadyHave(inv);
-            LogPrint("net", "got inv: %s  %s peer=%d\n", inv, fAlreadyHave ? "have" : "new", pfrom->id);
+            LogPrint(LOG_NET, "got inv: %s  %s peer=%d\n", inv, fAlreadyHave ? "have" : "new", pfrom->id);
 
+            // Outbound and whitelisted peers are asked first; anyone else may be racing to announce
             if (!fAlreadyHave && !fImporting && !fReindex && inv.type != MSG_BLOCK)
-                pfrom->AskFor(inv);
+                inventoryRequests.ReceivedInv(pfrom->GetId(), inv, !pfrom->fInbound || pfrom->fWhitelisted, GetTimeMicros());
 
 
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
-                    // Add this to the list of blocks to request
-                    vToFetch.push_back(inv);
-                    LogPrint("net", "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash, pfrom->id);
+                    if (fHeadersFirstSync) {
+                        // Validate the header chain first; the body is fetched in SendMessages
+                        pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), inv.hash);
+                        LogPrint(LOG_NET, "getheaders (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash, pfrom->id);
+                    } else {
+                        // Add this to the list of blocks to request, compact unless catching up
+                        vToFetch.push_back(PeerSupportsCompactBlocks(pfrom) && !IsInitialBlockDownload() ? CInv(MSG_CMPCT_BLOCK, inv.hash) : inv);
+                        LogPrint(LOG_NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash, pfrom->id);
+                    }
                 }
             }
 
@@ -3552,17 +4659,17 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             return error("message getdata size() = %u", vInv.size());
         }
 
-        LogPrint("net", "received getdata (%u invsz) peer=%d\n", vInv.size(), pfrom->id);
+        LogPrint(LOG_NET, "received getdata (%u invsz) peer=%d\n", vInv.size(), pfrom->id);
 
         if (vInv.size() > 0)
-            LogPrint("net", "received getdata for: %s peer=%d\n", vInv[0], pfrom->id);
+            LogPrint(LOG_NET, "received getdata for: %s peer=%d\n", vInv[0], pfrom->id);
 
         pfrom->vRecvGetData.insert(pfrom->vRecvGetData.end(), vInv.begin(), vInv.end());
         ProcessGetData(pfrom);
     }
 
 
-    else if (strCommand == "getblocks" || strCommand == "getheaders") {
+    else if (strCommand == "getblocks" || (strCommand == "getheaders" && !fHeadersFirstSync)) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
@@ -3582,8 +4689,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         if (pindex)
             pindex = chainActive.Next(pindex);
         int nLimit = 500;
-        LogPrint("net", "getblocks %d to %s limit %d from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop == uint256(0) ? "end" : hashStop.ToString(), nLimit, pfrom->id);
+        LogPrint(LOG_NET, "getblocks %d to %s limit %d from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop == uint256(0) ? "end" : hashStop.ToString(), nLimit, pfrom->id);
         for (; pindex; pindex = chainActive.Next(pindex)) {
+            // Pruned blocks cannot be sent, the peer has to get them from someone else.
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrint(LOG_NET, "  getblocks stopping at pruned block %d %s\n", pindex->nHeight, pindex->GetBlockHash());
+                break;
+            }
             // Make sure the inv messages for the requested chain are sent
             // in any case, even if e.g. we have already announced those
             // blocks in the past.  This ensures that the peer will be able
@@ -3592,12 +4704,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             if (--nLimit <= 0) {
                 // When this block is requested, we'll send an inv that'll make them
                 // getblocks the next batch of inventory.
-                LogPrint("net", "  getblocks stopping at limit %d %s\n", pindex->nHeight, pindex->GetBlockHash());
+                LogPrint(LOG_NET, "  getblocks stopping at limit %d %s\n", pindex->nHeight, pindex->GetBlockHash());
                 pfrom->hashContinue = pindex->GetBlockHash();
                 break;
             }
             if (pindex->GetBlockHash() == hashStop) {
-                LogPrint("net", "  getblocks stopping at %d %s\n", pindex->nHeight, pindex->GetBlockHash());
+                LogPrint(LOG_NET, "  getblocks stopping at %d %s\n", pindex->nHeight, pindex->GetBlockHash());
                 break;
             }
         }
@@ -3608,7 +4720,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
-    else if (strCommand == "headers" && Params().HeadersFirstSyncingActive()) {
+    else if (strCommand == "getheaders" && fHeadersFirstSync) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
@@ -3635,7 +4747,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
         std::vector<CBlock> vHeaders;
         int nLimit = MAX_HEADERS_RESULTS;
-        LogPrint("net","getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop, pfrom->id);
+        LogPrint(LOG_NET,"getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop, pfrom->id);
         for (; pindex; pindex = chainActive.Next(pindex)) {
             vHeaders.push_back(pindex->GetBlockHeader());
             if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
@@ -3645,8 +4757,45 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    else if (strCommand == "getcfilters") {
+        unsigned char filterType;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> filterType >> nStartHeight >> hashStop;
+
+        if (!fBlockFilterIndex || filterType != BlockFilter::BASIC_FILTER_TYPE) {
+            LogPrint(LOG_NET, "getcfilters for unavailable filter type %d from peer=%d\n", filterType, pfrom->id);
+            return true;
+        }
+
+        std::vector<const CBlockIndex*> vBlocks;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(hashStop);
+            if (mi == mapBlockIndex.end())
+                return true;
+            const CBlockIndex* pindexStop = mi->second;
+            if (nStartHeight > static_cast<uint32_t>(pindexStop->nHeight) ||
+                static_cast<uint32_t>(pindexStop->nHeight) - nStartHeight >= MAX_GETCFILTERS_SIZE) {
+                Misbehaving(pfrom->GetId(), 10);
+                return true;
+            }
+            for (const CBlockIndex* pindex = pindexStop; pindex && pindex->nHeight >= static_cast<int>(nStartHeight); pindex = pindex->pprev)
+                vBlocks.push_back(pindex);
+        }
+
+        LogPrint(LOG_NET, "getcfilters %u to %s from peer=%d\n", nStartHeight, hashStop, pfrom->id);
+        for (std::vector<const CBlockIndex*>::reverse_iterator it = vBlocks.rbegin(); it != vBlocks.rend(); ++it) {
+            BlockFilter filter;
+            if (!GetBlockFilter(*it, filter))
+                break;
+            pfrom->PushMessage("cfilter", filterType, filter.GetBlockHash(), filter.GetEncodedFilter());
+        }
+    }
+
+
     else if (strCommand == "tx" || strCommand == "dstx") {
-        std::vector<uint256> vWorkQueue;
+        std::vector<CTransaction> vWorkQueue;
         std::vector<uint256> vEraseQueue;
         CTransaction tx;
 
@@ -3655,26 +4804,31 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         std::vector<unsigned char> vchSig;
 
         if (strCommand == "tx") {
-            vRecv >> tx;
+            UnserializeInPlace(vRecv, tx);
         }
 
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
+        PrevalidateTransactionSignatures(tx);
         LOCK(cs_main);
 
         bool fMissingInputs = false;
         CValidationState state;
 
-        mapAlreadyAskedFor.erase(inv);
+        inventoryRequests.ForgetInv(inv);
 
-        if ( AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
+        const bool fRecentlyRejected = RecentlyRejected(inv.hash);
+        if (fRecentlyRejected) {
+            LogPrint(LOG_MEMPOOL, "%s: peer=%d %s : recently rejected %s\n",
+                    __func__, pfrom->id, pfrom->cleanSubVer, tx.ToStringShort());
+        } else if ( AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
         {
             mempool.check(pcoinsTip);
-            RelayTransaction(tx);
-            vWorkQueue.push_back(inv.hash);
+            RelayAcceptedTransaction(tx);
+            vWorkQueue.push_back(tx);
 
-            LogPrint("mempool", "%s: peer=%d %s : accepted %s (poolsz %u)\n",
+            LogPrint(LOG_MEMPOOL, "%s: peer=%d %s : accepted %s (poolsz %u)\n",
                     __func__,
                      pfrom->id, pfrom->cleanSubVer,
                      tx.ToStringShort(),
@@ -3684,11 +4838,15 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             std::set<NodeId> setMisbehaving;
             for(unsigned int i = 0; i < vWorkQueue.size(); i++)
             {
-                const std::set<uint256>& spendingTransactionIds = GetOrphanSpendingTransactionIds(vWorkQueue[i]);
+                std::vector<uint256> spendingTransactionIds;
+                GetOrphansSpending(vWorkQueue[i], spendingTransactionIds);
                 for(const uint256 &orphanHash: spendingTransactionIds)
                 {
                     NodeId fromPeer;
-                    const CTransaction &orphanTx = GetOrphanTransaction(orphanHash,fromPeer);
+                    const CTransaction* orphan = GetOrphanTransaction(orphanHash,fromPeer);
+                    if (orphan == nullptr)
+                        continue;
+                    const CTransaction &orphanTx = *orphan;
                     bool fMissingInputs2 = false;
                     // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
                     // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
@@ -3699,9 +4857,9 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     if(setMisbehaving.count(fromPeer))
                         continue;
                     if(AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2)) {
-                        LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash);
-                        RelayTransaction(orphanTx);
-                        vWorkQueue.push_back(orphanHash);
+                        LogPrint(LOG_MEMPOOL, "   accepted orphan tx %s\n", orphanHash);
+                        RelayAcceptedTransaction(orphanTx);
+                        vWorkQueue.push_back(orphanTx);
                         vEraseQueue.push_back(orphanHash);
                     } else if(!fMissingInputs2) {
                         int nDos = 0;
@@ -3709,12 +4867,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                             // Punish peer that gave us an invalid orphan tx
                             Misbehaving(fromPeer, nDos);
                             setMisbehaving.insert(fromPeer);
-                            LogPrint("mempool", "   invalid orphan tx %s\n", orphanHash);
+                            LogPrint(LOG_MEMPOOL, "   invalid orphan tx %s\n", orphanHash);
                         }
                         // Has inputs but not accepted to mempool
                         // Probably non-standard or insufficient fee/priority
-                        LogPrint("mempool", "   removed orphan tx %s\n", orphanHash);
+                        LogPrint(LOG_MEMPOOL, "   removed orphan tx %s\n", orphanHash);
                         vEraseQueue.push_back(orphanHash);
+                        AddRecentlyRejected(orphanHash, stateDummy);
                     }
                     mempool.check(pcoinsTip);
                 }
@@ -3722,24 +4881,29 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
             BOOST_FOREACH (uint256 hash, vEraseQueue)EraseOrphanTx(hash);
         } else if (fMissingInputs) {
-            AddOrphanTx(tx, pfrom->GetId());
+            const size_t nMaxOrphanPeerBytes = (size_t)std::max((int64_t)0, settings.GetArg("-maxorphanpeersize", DEFAULT_MAX_ORPHAN_PEER_BYTES));
+            AddOrphanTx(tx, pfrom->GetId(), nMaxOrphanPeerBytes);
 
-            // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+            // DoS prevention: do not allow the orphan pool to grow unbounded
             unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, settings.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
             unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
             if (nEvicted > 0)
-                LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
-        } else if (pfrom->fWhitelisted) {
-            // Always relay transactions received from whitelisted peers, even
-            // if they are already in the mempool (allowing the node to function
-            // as a gateway for nodes hidden behind it).
+                LogPrint(LOG_MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+        } else {
+            if (state.IsInvalid())
+                AddRecentlyRejected(inv.hash, state);
+            if (pfrom->fWhitelisted && !fRecentlyRejected) {
+                // Always relay transactions received from whitelisted peers, even
+                // if they are already in the mempool (allowing the node to function
+                // as a gateway for nodes hidden behind it).
 
-            RelayTransaction(tx);
+                RelayTransaction(tx);
+            }
         }
 
         int nDoS = 0;
         if (state.IsInvalid(nDoS)) {
-            LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.ToStringShort(),
+            LogPrint(LOG_MEMPOOL, "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.ToStringShort(),
                      pfrom->id, pfrom->cleanSubVer,
                      state.GetRejectReason());
             pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
@@ -3750,7 +4914,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
-    else if (strCommand == "headers" && Params().HeadersFirstSyncingActive() && !fImporting && !fReindex) // Ignore headers received while importing
+    else if (strCommand == "headers" && fHeadersFirstSync && !fImporting && !fReindex) // Ignore headers received while importing
     {
         std::vector<CBlockHeader> headers;
 
@@ -3801,20 +4965,23 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             // Headers message had its maximum size; the peer may have more headers.
             // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
             // from there instead.
-            LogPrintf("more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
+            LogPrint(LOG_NET, "more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
             pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexLast), uint256(0));
         }
 
+        // Bodies of the validated headers are requested from every peer that has
+        // them in SendMessages, inside the moving download window.
+
         CheckBlockIndex();
     }
 
     else if (strCommand == "block" && !fImporting && !fReindex) // Ignore blocks received while importing
     {
         CBlock block;
-        vRecv >> block;
+        UnserializeInPlace(vRecv, block);
         uint256 hashBlock = block.GetHash();
         CInv inv(MSG_BLOCK, hashBlock);
-        LogPrint("net", "received block %s peer=%d\n", inv.hash, pfrom->id);
+        LogPrint(LOG_NET, "received block %s peer=%d\n", inv.hash, pfrom->id);
 
         //sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
         if (!mapBlockIndex.count(block.hashPrevBlock)) {
@@ -3828,26 +4995,129 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 pfrom->vBlockRequested.push_back(hashBlock);
             }
         } else {
-            pfrom->AddInventoryKnown(inv);
+            ProcessReceivedBlock(pfrom, block, strCommand);
+        }
+    }
 
-            CValidationState state;
-            if (!mapBlockIndex.count(block.GetHash())) {
-                ProcessNewBlock(state, pfrom, &block);
-                int nDoS;
-                if(state.IsInvalid(nDoS)) {
-                    pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
-                                       state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
-                    if(nDoS > 0) {
-                        TRY_LOCK(cs_main, lockMain);
-                        if(lockMain) Misbehaving(pfrom->GetId(), nDoS);
-                    }
-                }
-                //disconnect this node if its old protocol version
-                pfrom->DisconnectOldProtocol(ActiveProtocol(), strCommand);
-            } else {
-                LogPrint("net", "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, block.GetHash());
+
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CompactBlock compactBlock;
+        vRecv >> compactBlock;
+        const uint256 hashBlock = compactBlock.header.GetHash();
+        LogPrint(LOG_NET, "received compact block %s peer=%d\n", hashBlock, pfrom->id);
+        pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hashBlock));
+
+        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA))
+            return true;
+        if (!mapBlockIndex.count(compactBlock.header.hashPrevBlock)) {
+            // The full block handling works out how to sync up to it
+            pfrom->PushMessage("getdata", std::vector<CInv>(1, CInv(MSG_BLOCK, hashBlock)));
+            return true;
+        }
+
+        std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hashBlock);
+        if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != pfrom->GetId()) {
+            MarkBlockAsInFlight(pfrom->GetId(), hashBlock, mi != mapBlockIndex.end() ? mi->second : NULL);
+            itInFlight = mapBlocksInFlight.find(hashBlock);
+        }
+
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock = std::make_shared<PartiallyDownloadedBlock>();
+        std::vector<const CTransaction*> orphans;
+        GetOrphanTransactions(orphans);
+        PartiallyDownloadedBlock::ReadStatus status = partialBlock->InitData(compactBlock, mempool, orphans);
+        if (status == PartiallyDownloadedBlock::READ_STATUS_INVALID) {
+            MarkBlockAsReceived(hashBlock);
+            Misbehaving(pfrom->GetId(), 100);
+            return error("invalid compact block %s received from peer=%d", hashBlock, pfrom->id);
+        }
+        if (status == PartiallyDownloadedBlock::READ_STATUS_FAILED) {
+            LogPrint(LOG_NET, "short ids of compact block %s collide, downloading it in full from peer=%d\n", hashBlock, pfrom->id);
+            RequestFullBlock(pfrom, hashBlock);
+            return true;
+        }
+
+        BlockTransactionsRequest request;
+        request.blockHash = hashBlock;
+        request.indexes = partialBlock->GetMissingIndexes();
+        LogPrint(LOG_NET, "compact block %s has %u prefilled, %u mempool, %u orphan and %u missing transactions peer=%d\n",
+            hashBlock, partialBlock->PrefilledCount(), partialBlock->MempoolCount(), partialBlock->ExtraCount(), request.indexes.size(), pfrom->id);
+        if (!request.indexes.empty()) {
+            itInFlight->second.second->partialBlock = partialBlock;
+            pfrom->PushMessage("getblocktxn", request);
+            return true;
+        }
+
+        CBlock block;
+        status = partialBlock->FillBlock(block, std::vector<CTransaction>());
+        if (status != PartiallyDownloadedBlock::READ_STATUS_OK) {
+            LogPrint(LOG_NET, "compact block %s did not match its merkle root, downloading it in full from peer=%d\n", hashBlock, pfrom->id);
+            RequestFullBlock(pfrom, hashBlock);
+            return true;
+        }
+        ProcessReceivedBlock(pfrom, block, strCommand);
+    }
+
+
+    else if (strCommand == "getblocktxn") {
+        BlockTransactionsRequest request;
+        vRecv >> request;
+
+        BlockMap::iterator mi = mapBlockIndex.find(request.blockHash);
+        if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA)) {
+            LogPrint(LOG_NET, "peer=%d asked for transactions of unknown block %s\n", pfrom->id, request.blockHash);
+            return true;
+        }
+        // Blocks that are deep, or off the active chain, are only handed out as getdata would
+        if (!chainActive.Contains(mi->second) || mi->second->nHeight <= chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
+            pfrom->vRecvGetData.push_back(CInv(MSG_BLOCK, request.blockHash));
+            ProcessGetData(pfrom);
+            return true;
+        }
+
+        CBlock block;
+        if (!GetRecentBlockDataReader().ReadBlock(mi->second, block))
+            assert(!"cannot load block from disk");
+        BlockTransactions response;
+        response.blockHash = request.blockHash;
+        response.transactions.reserve(request.indexes.size());
+        BOOST_FOREACH (uint32_t index, request.indexes) {
+            if (index >= block.vtx.size()) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d asked for transaction %u of block %s, which has %u", pfrom->id, index, request.blockHash, block.vtx.size());
             }
+            response.transactions.push_back(block.vtx[index]);
+        }
+        pfrom->PushMessage("blocktxn", response);
+    }
+
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions response;
+        vRecv >> response;
+
+        std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(response.blockHash);
+        if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != pfrom->GetId() || !itInFlight->second.second->partialBlock) {
+            LogPrint(LOG_NET, "peer=%d sent unrequested transactions of block %s\n", pfrom->id, response.blockHash);
+            return true;
+        }
+
+        const std::shared_ptr<PartiallyDownloadedBlock> partialBlock = itInFlight->second.second->partialBlock;
+        CBlock block;
+        PartiallyDownloadedBlock::ReadStatus status = partialBlock->FillBlock(block, response.transactions);
+        if (status == PartiallyDownloadedBlock::READ_STATUS_INVALID) {
+            MarkBlockAsReceived(response.blockHash);
+            Misbehaving(pfrom->GetId(), 100);
+            return error("peer=%d sent the wrong number of transactions for block %s", pfrom->id, response.blockHash);
+        }
+        if (status == PartiallyDownloadedBlock::READ_STATUS_FAILED) {
+            LogPrint(LOG_NET, "compact block %s did not match its merkle root, downloading it in full from peer=%d\n", response.blockHash, pfrom->id);
+            RequestFullBlock(pfrom, response.blockHash);
+            return true;
         }
+        ProcessReceivedBlock(pfrom, block, strCommand);
     }
 
 
@@ -3857,7 +5127,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     // Making users (which are behind NAT and can only make outgoing connections) ignore
     // getaddr message mitigates the attack.
     else if ((strCommand == "getaddr") && (pfrom->fInbound)) {
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrRelay);
+            pfrom->vAddrToSend.clear();
+        }
         std::vector<CAddress> vAddr = addrman.GetAddr();
         BOOST_FOREACH (const CAddress& addr, vAddr)
                 pfrom->PushAddress(addr);
@@ -3950,7 +5223,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
 
         if (!(sProblem.empty())) {
-            LogPrint("net", "pong peer=%d %s: %s, %x expected, %x received, %u bytes\n",
+            LogPrint(LOG_NET, "pong peer=%d %s: %s, %x expected, %x received, %u bytes\n",
                      pfrom->id,
                      pfrom->cleanSubVer,
                      sProblem,
@@ -4041,6 +5314,18 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    else if (strCommand == "sendcompress") {
+        // The peer takes compressed messages, from our "compress" message on
+        if (pfrom->CompressionAllowed())
+            pfrom->StartSendCompression();
+    }
+
+
+    else if (strCommand == "compress") {
+        // What follows was already switched over to decompression as it was received
+    }
+
+
     else if (strCommand == "reject") {
         if (fDebug) {
             try {
@@ -4057,10 +5342,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     vRecv >> hash;
                     ss << ": hash " << hash.ToString();
                 }
-                LogPrint("net", "Reject %s\n", SanitizeString(ss.str()));
+                LogPrint(LOG_NET, "Reject %s\n", SanitizeString(ss.str()));
             } catch (std::ios_base::failure& e) {
                 // Avoid feedback loops by preventing reject messages from triggering a new reject message.
-                LogPrint("net", "Unparseable reject message received\n");
+                LogPrint(LOG_NET, "Unparseable reject message received\n");
             }
         }
     } else {
@@ -4072,6 +5357,25 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+/**
+ * Whether a message may touch the chain state or state that is shared between
+ * the peers without a lock of its own. Those are processed holding cs_main, so
+ * several message handler threads only run the rest side by side.
+ */
+static bool MessageNeedsChainState(const std::string& strCommand)
+{
+    return strCommand != "ping" &&
+           strCommand != "pong" &&
+           strCommand != "addr" &&
+           strCommand != "getaddr" &&
+           strCommand != "filterload" &&
+           strCommand != "filteradd" &&
+           strCommand != "filterclear" &&
+           strCommand != "sendcompress" &&
+           strCommand != "compress" &&
+           strCommand != "reject";
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -4084,12 +5388,16 @@ bool ProcessMessages(CNode* pfrom)
     //
     bool fOk = true;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        LOCK(cs_main);
         ProcessGetData(pfrom);
+    }
 
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
 
+    MasternodeSignaturePrevalidator::PrevalidateQueuedMessages(pfrom->vRecvMsg);
+
     std::deque<CNetMessage>::iterator it = pfrom->vRecvMsg.begin();
     while (!pfrom->fDisconnect && it != pfrom->vRecvMsg.end()) {
         // Don't bother if send buffer is too full to respond anyway
@@ -4138,7 +5446,12 @@ bool ProcessMessages(CNode* pfrom)
         // Process message
         bool fRet = false;
         try {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            if (MessageNeedsChainState(strCommand)) {
+                LOCK(cs_main);
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            } else {
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            }
             boost::this_thread::interruption_point();
         } catch (std::ios_base::failure& e) {
             pfrom->PushMessage("reject", strCommand, REJECT_MALFORMED, string("error parsing message"));
@@ -4167,7 +5480,7 @@ bool ProcessMessages(CNode* pfrom)
 
     // In case the connection got shut down, its receive buffer was wiped
     if (!pfrom->fDisconnect)
-        pfrom->vRecvMsg.erase(pfrom->vRecvMsg.begin(), it);
+        pfrom->RecycleReceivedMessages(it);
 
     return fOk;
 }
@@ -4176,34 +5489,44 @@ bool ProcessMessages(CNode* pfrom)
 bool SendMessages(CNode* pto, bool fSendTrickle)
 {
     {
+        const int64_t nNow = GetTimeMicros();
+
         //
         // Message: addr
         //
-        if (fSendTrickle) {
+        if (fSendTrickle || pto->nNextAddrSend < nNow) {
+            pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
             std::vector<CAddress> vAddr;
-            vAddr.reserve(pto->vAddrToSend.size());
-            BOOST_FOREACH (const CAddress& addr, pto->vAddrToSend) {
-                // returns true if wasn't already contained in the set
-                if (pto->setAddrKnown.insert(addr).second) {
-                    vAddr.push_back(addr);
-                    // receiver rejects addr messages larger than 1000
-                    if (vAddr.size() >= 1000) {
-                        pto->PushMessage("addr", vAddr);
-                        vAddr.clear();
-                    }
+            {
+                // Other handler threads push addresses to relay to this peer meanwhile
+                LOCK(pto->cs_addrRelay);
+                vAddr.reserve(pto->vAddrToSend.size());
+                BOOST_FOREACH (const CAddress& addr, pto->vAddrToSend) {
+                    // returns true if wasn't already contained in the set
+                    if (pto->setAddrKnown.insert(addr).second)
+                        vAddr.push_back(addr);
                 }
+                pto->vAddrToSend.clear();
+            }
+            // receiver rejects addr messages larger than 1000
+            for (size_t nStart = 0; nStart < vAddr.size(); nStart += 1000) {
+                const size_t nEnd = std::min(vAddr.size(), nStart + 1000);
+                pto->PushMessage("addr", std::vector<CAddress>(vAddr.begin() + nStart, vAddr.begin() + nEnd));
             }
-            pto->vAddrToSend.clear();
-            if (!vAddr.empty())
-                pto->PushMessage("addr", vAddr);
         }
 
-        CNodeState* state;
-        {
-            TRY_LOCK(cs_main, lockMain);
-            if (!lockMain)
-                return true;
-            state = State(pto->GetId());
+        // The rest reads the chain and the block download state shared by the peers
+        TRY_LOCK(cs_main, lockMain);
+        if (!lockMain)
+            return true;
+        CNodeState* state = State(pto->GetId());
+
+        // Publish what getpeerinfo shows of the state, while cs_main is held anyway
+        if (pto->nNextStateStatsPublish < nNow) {
+            pto->nNextStateStatsPublish = nNow + NODE_STATE_STATS_PUBLISH_INTERVAL * 1000000;
+            CNodeStateStats stats;
+            CopyNodeStateStats(*state, stats);
+            pto->PublishStateStats(stats);
         }
 
         if (state->fShouldBan) {
@@ -4233,10 +5556,13 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             if (nSyncStarted == 0 || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
                 state->fSyncStarted = true;
                 nSyncStarted++;
-                //CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
-                //LogPrint("net", "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
-                //pto->PushMessage("getheaders", chainActive.GetLocator(pindexStart), uint256(0));
-                pto->PushMessage("getblocks", chainActive.GetLocator(chainActive.Tip()), uint256(0));
+                if (fHeadersFirstSync) {
+                    CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
+                    LogPrint(LOG_NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
+                    pto->PushMessage("getheaders", chainActive.GetLocator(pindexStart), uint256(0));
+                } else {
+                    pto->PushMessage("getblocks", chainActive.GetLocator(chainActive.Tip()), uint256(0));
+                }
             }
         }
 
@@ -4255,35 +5581,30 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             std::vector<CInv> vInvWait;
 
             LOCK(pto->cs_inventory);
+            // Transactions are trickled out to protect privacy: each peer gets
+            // them all at once on its own randomly timed schedule, so the
+            // order they reach the peers does not give away their origin
+            bool fSendTransactions = fSendTrickle;
+            if (pto->nNextInvSend < nNow) {
+                fSendTransactions = true;
+                pto->nNextInvSend = PoissonNextSend(nNow, AVG_INVENTORY_BROADCAST_INTERVAL >> !pto->fInbound);
+            }
             vInv.reserve(pto->vInventoryToSend.size());
-            vInvWait.reserve(pto->vInventoryToSend.size());
             for (const auto& inv : pto->vInventoryToSend) {
-                if (pto->setInventoryKnown.count(inv) > 0)
+                const std::vector<unsigned char> vKey = CNode::InventoryKnownKey(inv);
+                if (pto->filterInventoryKnown.contains(vKey))
                     continue;
 
-                // trickle out tx inv to protect privacy
-                if (inv.type == MSG_TX && !fSendTrickle) {
-                    // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt == 0)
-                        hashSalt = GetRandHash();
-                    uint256 hashRand = inv.hash ^ hashSalt;
-                    hashRand = Hash(BEGIN(hashRand), END(hashRand));
-                    bool fTrickleWait = ((hashRand & 3) != 0);
-
-                    if (fTrickleWait) {
-                        vInvWait.push_back(inv);
-                        continue;
-                    }
+                if (inv.type == MSG_TX && !fSendTransactions) {
+                    vInvWait.push_back(inv);
+                    continue;
                 }
 
-                // returns true if wasn't already contained in the set
-                if (pto->setInventoryKnown.insert(inv).second) {
-                    vInv.push_back(inv);
-                    if (vInv.size() >= 1000) {
-                        pto->PushMessage("inv", vInv);
-                        vInv.clear();
-                    }
+                pto->filterInventoryKnown.insert(vKey);
+                vInv.push_back(inv);
+                if (vInv.size() >= 1000) {
+                    pto->PushMessage("inv", vInv);
+                    vInv.clear();
                 }
             }
             pto->vInventoryToSend = std::move(vInvWait);
@@ -4292,7 +5613,6 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             pto->PushMessage("inv", vInv);
 
         // Detect whether we're stalling
-        int64_t nNow = GetTimeMicros();
         if (!pto->fDisconnect && state->nStallingSince && state->nStallingSince < nNow - 1000000 * BLOCK_STALLING_TIMEOUT) {
             // Stalling only triggers when the block download window cannot move. During normal steady state,
             // the download window should be much larger than the to-be-downloaded set of blocks, so disconnection
@@ -4319,7 +5639,9 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state->nBlocksInFlight, vToDownload, staller);
             BOOST_FOREACH (CBlockIndex* pindex, vToDownload) {
-                vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
+                // A block on top of the tip is likely made of transactions already in the mempool
+                const bool fCompact = PeerSupportsCompactBlocks(pto) && pindex->pprev == chainActive.Tip() && !IsInitialBlockDownload();
+                vGetData.push_back(CInv(fCompact ? MSG_CMPCT_BLOCK : MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), pindex);
                 LogPrintf("Requesting block %s (%d) peer=%d\n", pindex->GetBlockHash(),
                           pindex->nHeight, pto->id);
@@ -4327,7 +5649,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             if (state->nBlocksInFlight == 0 && staller != -1) {
                 if (State(staller)->nStallingSince == 0) {
                     State(staller)->nStallingSince = nNow;
-                    LogPrint("net", "Stall started peer=%d\n", staller);
+                    LogPrint(LOG_NET, "Stall started peer=%d\n", staller);
                 }
             }
         }
@@ -4335,17 +5657,16 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         //
         // Message: getdata (non-blocks)
         //
-        while (!pto->fDisconnect && !pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow) {
-            const CInv& inv = (*pto->mapAskFor.begin()).second;
-            if (!AlreadyHave(inv)) {
-                LogPrint("net", "Requesting %s peer=%d\n", inv, pto->id);
-                vGetData.push_back(inv);
-                if (vGetData.size() >= 1000) {
-                    pto->PushMessage("getdata", vGetData);
-                    vGetData.clear();
-                }
+        std::vector<CInv> vToRequest;
+        if (!pto->fDisconnect)
+            inventoryRequests.GetRequestable(pto->GetId(), nNow, &AlreadyHave, vToRequest);
+        BOOST_FOREACH (const CInv& inv, vToRequest) {
+            LogPrint(LOG_NET, "Requesting %s peer=%d\n", inv, pto->id);
+            vGetData.push_back(inv);
+            if (vGetData.size() >= 1000) {
+                pto->PushMessage("getdata", vGetData);
+                vGetData.clear();
             }
-            pto->mapAskFor.erase(pto->mapAskFor.begin());
         }
         if (!vGetData.empty())
             pto->PushMessage("getdata", vGetData);
@@ -38,6 +38,9 @@ class CNode;
 struct CNodeSignals;
 class CTxMemPool;
 class CCoinsViewCache;
+class UtxoSnapshotMetadata;
+struct CoinsSnapshot;
+struct ChainstateVerificationProgress;
 
 /** Register a wallet to receive updates from core */
 void RegisterValidationInterface(NotificationInterface* pwalletIn);
@@ -47,6 +50,12 @@ void UnregisterValidationInterface(NotificationInterface* pwalletIn);
 void UnregisterAllValidationInterfaces();
 /** Push an updated transaction to all registered wallets */
 void SyncWithWallets(const CTransaction& tx, const CBlock* pblock = NULL);
+/** Deliver wallet notifications from a background thread, so validation does not wait on the wallets */
+void StartValidationInterfaceQueue();
+/** Deliver the wallet notifications still pending, and the rest straight away from then on */
+void StopValidationInterfaceQueue();
+/** Wait until the wallets have seen every notification so far; must not be called holding cs_main */
+void SyncWithValidationInterfaceQueue();
 
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
@@ -70,6 +79,8 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp = NULL);
+/** Re-import the blocks in the blk?????.dat files, scanning them on nThreads threads */
+bool ReindexBlockFiles(unsigned int nThreads);
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex();
 /** Load the block tree and coins database from disk */
@@ -82,7 +93,7 @@ bool ProcessMessages(CNode* pfrom);
  * Send queued protocol messages to be sent to a give node.
  *
  * @param[in]   pto             The node which we are sending messages to.
- * @param[in]   fSendTrickle    When true send the trickled data, otherwise trickle the data until true.
+ * @param[in]   fSendTrickle    When true send the trickled data now, otherwise send it on the peer's own schedule.
  */
 bool SendMessages(CNode* pto, bool fSendTrickle);
 
@@ -108,16 +119,19 @@ bool AbortNode(const std::string& msg, const std::string& userMessage);
 bool GetNodeStateStats(int nodeid, CNodeStateStats& stats);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Prune block files as far as -prune asks for and flush the state that refers to them. */
+void PruneAndFlush();
+/** Number of blocks below the tip whose block and undo files are kept when pruning */
+int GetPruneKeepDepth();
+/** Bytes of memory the mempool may use, as set with -maxmempool */
+size_t GetMaxMempoolSize();
+/** Bytes of memory the block indexes take up, with their lottery coinstakes; walks them all, with cs_main held */
+size_t BlockIndexDynamicMemoryUsage();
 
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs = nullptr, bool ignoreFees = false);
-
-struct CNodeStateStats {
-    int nMisbehavior;
-    int nSyncHeight;
-    int nCommonHeight;
-    std::vector<int> vHeightInFlight;
-};
+/** Like AcceptToMemoryPool, for a transaction that entered the pool at nAcceptTime before, such as one reloaded from mempool.dat */
+bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, int64_t nAcceptTime, bool ignoreFees = false);
 
 /**
  * Check transaction inputs, and make sure any
@@ -176,9 +190,39 @@ bool InvalidateBlock(CValidationState& state, CBlockIndex* pindex);
 /** Remove invalidity status from a block and its descendants. */
 bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex);
 
+/** Write the UTXO set at the active tip to a snapshot file. */
+bool DumpUtxoSnapshot(const std::string& strPath, UtxoSnapshotMetadata& metadata, std::string& strError);
+
+/** Replace the chainstate by a snapshot based on a stored block ahead of the active tip. */
+bool ActivateUtxoSnapshot(const std::string& strPath, UtxoSnapshotMetadata& metadata, std::string& strError);
+
+/** Get a read-only view of the coins as of the active tip, only taking cs_main if the latest one is outdated. */
+bool GetCoinsSnapshot(CoinsSnapshot& snapshot);
+
+/** Drop the published coins snapshot before the coin databases are closed. */
+void ReleaseCoinsSnapshot();
+
+/** Check the coin database against the last nCheckDepth blocks (0 = all) once imports are done, without holding up the node. */
+void ThreadVerifyChainstate(int nCheckDepth);
+
+/** Progress of the latest ThreadVerifyChainstate run. */
+ChainstateVerificationProgress GetChainstateVerificationProgress();
+
+/** Compress the block files whose blocks are all more than nMinDepth blocks deep, keeping them readable. */
+void ThreadCompressBlockFiles(int nMinDepth);
+
+enum class BuiltIndex;
+
+/** Build the given indexes from the block files one after another, each up to nLag blocks behind the tip and at up
+ *  to nMaxBlocksPerSecond (0 = no limit), then catch up and turn them on to be updated along with the chain. */
+void ThreadBuildIndexes(const std::vector<BuiltIndex>& indexes, int nLag, int nMaxBlocksPerSecond);
+
 /** The currently-connected chain of blocks. */
 extern CChain chainActive;
+/** The tip of chainActive as of its last update, readable without cs_main, as block index entries outlive the tip */
+const CBlockIndex* GetChainTipSnapshot();
 
+struct CAddressBalance;
 struct CAddressIndexKey;
 struct CAddressUnspentKey;
 struct CAddressUnspentValue;
@@ -191,12 +235,55 @@ bool GetAddressIndex(bool addresIndexEnabled,
                      int start = 0,
                      int end = 0);
 
+bool GetAddressIndexPage(bool addresIndexEnabled,
+                         CBlockTreeDB* pblocktree,
+                         uint160 addressHash,
+                         int type,
+                         int start,
+                         int end,
+                         bool fNewestFirst,
+                         unsigned int nMaxTransactions,
+                         const CAddressIndexKey* pkeyAfter,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                         bool& fMore);
+
+bool GetAddressBalance(bool addresIndexEnabled,
+                       CBlockTreeDB* pblocktree,
+                       uint160 addressHash,
+                       int type,
+                       CAddressBalance& balance);
+
 bool GetAddressUnspent(bool addresIndexEnabled,
                       CBlockTreeDB* pblocktree,
                       uint160 addressHash,
                       int type,
                       std::vector<std::pair<CAddressUnspentKey,
                       CAddressUnspentValue> > &unspentOutputs);
+
+bool GetAddressUnspentPage(bool addresIndexEnabled,
+                           CBlockTreeDB* pblocktree,
+                           uint160 addressHash,
+                           int type,
+                           int nMinHeight,
+                           CAmount nMinAmount,
+                           unsigned int nMaxOutputs,
+                           const CAddressUnspentKey* pkeyAfter,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                           bool& fMore);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+class BlockFilter;
+/** Filter of the block from the block filter index, false when the index is off or does not have it yet */
+bool GetBlockFilter(const CBlockIndex* pindex, BlockFilter& filter);
+class BlockStats;
+/** Figures of the block from the block stats index, false when the index is off or does not have them */
+bool GetBlockStats(const CBlockIndex* pindex, BlockStats& stats);
+class CoinSupply;
+/** Where the coins stand after the block, from the supply index; false when the index is off or does not have it */
+bool GetCoinSupply(const CBlockIndex* pindex, CoinSupply& supply);
+struct VaultIndexKey;
+struct VaultIndexValue;
+enum class VaultIndexRole : unsigned char;
+/** Unspent vault outputs whose script has the key hash as owner or manager, from the vault index */
+bool GetVaultIndex(VaultIndexRole role, const uint160& keyHash, std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vaults);
 
 #endif // BITCOIN_MAIN_H
@@ -11,11 +11,13 @@
 #include <masternode.h>
 #include "masternode-sync.h"
 #include "masternodeman.h"
+#include "memusage.h"
 #include "obfuscation.h"
 #include "spork.h"
 #include "sync.h"
 #include "Logging.h"
 #include "utilmoneystr.h"
+#include "utiltime.h"
 #include "netfulfilledman.h"
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
@@ -32,7 +34,6 @@
 #include <timedata.h>
 #include <NodeState.h>
 
-extern CCriticalSection cs_main;
 const int CMasternodePayments::MNPAYMENTS_SIGNATURES_REQUIRED = 6;
 const int CMasternodePayments::MNPAYMENTS_SIGNATURES_TOTAL = 10;
 constexpr int MN_WINNER_MINIMUM_AGE = 8000;    // Age in seconds. This should be > MASTERNODE_REMOVAL_SECONDS to avoid misconfigured new nodes in the list.
@@ -45,6 +46,9 @@ static constexpr unsigned MAX_RANKING_CHECK_NUM = 20;
 
 /** Number of entries (blocks) we keep in the cache of ranked masternodes.  */
 static constexpr unsigned RANKING_CACHE_SIZE = 2500;
+
+/** Number of blocks whose payment queue is kept for checking winner votes.  */
+static constexpr unsigned PAYMENT_QUEUE_CACHE_SIZE = 16;
 /**
  * An entry in the ranking cache.  We use mruset to hold the cache,
  * which means that even though it is conceptually a map, we represent
@@ -58,14 +62,15 @@ struct RankingCacheEntry
 
   using value_type = std::array<uint256, MAX_RANKING_CHECK_NUM>;
 
-  /** The scoring hash this is for, i.e. the key.  */
+  /** The scoring hash and minimum protocol this is for, i.e. the key.  */
   uint256 seedHash;
+  int minProtocol;
 
   /** The list of best masternodes by rank (represented through
    *  their vin prevout hashes).  */
   value_type bestVins;
 
-  RankingCacheEntry() = default;
+  RankingCacheEntry() : minProtocol(0) {}
   RankingCacheEntry(RankingCacheEntry&&) = default;
   RankingCacheEntry(const RankingCacheEntry&) = default;
 
@@ -75,12 +80,14 @@ struct RankingCacheEntry
 
 bool operator==(const RankingCacheEntry& a, const RankingCacheEntry& b)
 {
-  return a.seedHash == b.seedHash;
+  return a.seedHash == b.seedHash && a.minProtocol == b.minProtocol;
 }
 
 bool operator<(const RankingCacheEntry& a, const RankingCacheEntry& b)
 {
-  return a.seedHash < b.seedHash;
+  if (a.seedHash != b.seedHash)
+    return a.seedHash < b.seedHash;
+  return a.minProtocol < b.minProtocol;
 }
 
 } // anonymous namespace
@@ -108,10 +115,11 @@ public:
 
   /** Looks up an entry by seed hash and returns it, or a null
    *  pointer if there is no matching entry.  */
-  const RankingCacheEntry::value_type* Find(const uint256& hash) const
+  const RankingCacheEntry::value_type* Find(const uint256& hash, const int minProtocol) const
   {
     RankingCacheEntry entry;
     entry.seedHash = hash;
+    entry.minProtocol = minProtocol;
 
     auto mit = entries.find(entry);
     if (mit == entries.end())
@@ -121,10 +129,11 @@ public:
   }
 
   /** Inserts an entry into the cache.  */
-  void Insert(const uint256& hash, const RankingCacheEntry::value_type& bestVins)
+  void Insert(const uint256& hash, const int minProtocol, const RankingCacheEntry::value_type& bestVins)
   {
     RankingCacheEntry entry;
     entry.seedHash = hash;
+    entry.minProtocol = minProtocol;
     entry.bestVins = bestVins;
 
     auto ins = entries.insert(std::move(entry));
@@ -134,6 +143,84 @@ public:
 };
 
 
+/**
+ * Internal helper class that remembers the payees at the top of the payment
+ * queue of recent blocks, so that the many winner votes received for the same
+ * block are checked against one computation of the queue.
+ *
+ * An entry is only used while nothing the queue depends on has changed: the
+ * masternode list, the chain tip and the payees already scheduled for the
+ * next blocks.  The enabled state and age of the masternodes also go into
+ * the queue, so entries expire as quickly as those are rechecked.
+ */
+class CMasternodePayments::PaymentQueueCache
+{
+
+private:
+
+  struct Entry
+  {
+    int nBlockHeight;
+    int chainTipHeight;
+    uint64_t masternodeListGeneration;
+    std::set<CScript> scheduledPayees;
+    int64_t computedTime;
+    std::vector<CScript> topPayees;
+  };
+
+  /** Entries for the blocks that are voted on, by seed hash.  */
+  std::map<uint256, Entry> entries;
+
+public:
+
+  PaymentQueueCache() = default;
+  PaymentQueueCache(const PaymentQueueCache&) = delete;
+  void operator=(const PaymentQueueCache&) = delete;
+
+  /** Looks up the top payees for the block, or returns a null pointer
+   *  if there is no entry that is still valid.  */
+  const std::vector<CScript>* Find(const uint256& seedHash, const int nBlockHeight,
+                                   const int chainTipHeight, const uint64_t masternodeListGeneration,
+                                   const std::set<CScript>& scheduledPayees, const int64_t now) const
+  {
+    auto mit = entries.find(seedHash);
+    if (mit == entries.end())
+      return nullptr;
+
+    const Entry& entry = mit->second;
+    if (entry.nBlockHeight != nBlockHeight || entry.chainTipHeight != chainTipHeight
+        || entry.masternodeListGeneration != masternodeListGeneration
+        || now - entry.computedTime >= MASTERNODE_CHECK_SECONDS
+        || entry.scheduledPayees != scheduledPayees)
+      return nullptr;
+
+    return &entry.topPayees;
+  }
+
+  /** Inserts or replaces the entry for a block and returns its top payees.
+   *  Entries are dropped together once there are more than a few blocks
+   *  being voted on.  */
+  const std::vector<CScript>* Insert(const uint256& seedHash, const int nBlockHeight,
+              const int chainTipHeight, const uint64_t masternodeListGeneration,
+              const std::set<CScript>& scheduledPayees, const int64_t now,
+              const std::vector<CScript>& topPayees)
+  {
+    if (entries.size() >= PAYMENT_QUEUE_CACHE_SIZE && entries.count(seedHash) == 0)
+      entries.clear();
+
+    Entry& entry = entries[seedHash];
+    entry.nBlockHeight = nBlockHeight;
+    entry.chainTipHeight = chainTipHeight;
+    entry.masternodeListGeneration = masternodeListGeneration;
+    entry.scheduledPayees = scheduledPayees;
+    entry.computedTime = now;
+    entry.topPayees = topPayees;
+    return &entry.topPayees;
+  }
+
+};
+
+
 /** Object for who's going to get paid on which blocks */
 
 CMasternodePayments::CMasternodePayments(
@@ -142,19 +229,22 @@ CMasternodePayments::CMasternodePayments(
     CMasternodeMan& masternodeManager,
     const CChain& activeChain
     ): rankingCache(new RankingCache)
+    , paymentQueueCache(new PaymentQueueCache)
     , nSyncedFromPeer(0)
     , nLastBlockHeight(0)
-    , chainTipHeight(0)
+    , chainTip(nullptr)
     , paymentData_(paymentData)
     , networkMessageManager_(networkMessageManager)
     , masternodeManager_(masternodeManager)
     , activeChain_(activeChain)
     , mapMasternodePayeeVotes(paymentData_.mapMasternodePayeeVotes)
     , mapMasternodeBlocks(paymentData_.mapMasternodeBlocks)
+    , payeeVoteHashesByHeight(paymentData_.payeeVoteHashesByHeight)
 {
 }
 CMasternodePayments::~CMasternodePayments()
 {
+    paymentQueueCache.reset();
     rankingCache.reset();
 }
 
@@ -178,7 +268,7 @@ void CMasternodePayments::FillBlockPayee(const CBlockIndex* pindexPrev, CMutable
     //spork
     uint256 seedHash;
     if (!GetBlockHashForScoring(seedHash, pindexPrev, 1)) {
-        LogPrint("masternode", "FillBlockPayee - failed to get score hash\n");
+        LogPrint(LOG_MASTERNODE, "FillBlockPayee - failed to get score hash\n");
         return;
     }
     if (!GetBlockPayee(seedHash, payee)) {
@@ -186,7 +276,7 @@ void CMasternodePayments::FillBlockPayee(const CBlockIndex* pindexPrev, CMutable
         payee = GetNextMasternodePayeeInQueueForPayment(pindexPrev, 1);
         if(payee.empty())
         {
-            LogPrint("masternode","CreateNewBlock: Failed to detect masternode to pay\n");
+            LogPrint(LOG_MASTERNODE,"CreateNewBlock: Failed to detect masternode to pay\n");
             hasPayment = false;
         }
     }
@@ -199,7 +289,7 @@ void CMasternodePayments::FillBlockPayee(const CBlockIndex* pindexPrev, CMutable
         ExtractDestination(payee, address1);
         CBitcoinAddress address2(address1);
 
-        LogPrint("masternode","Masternode payment of %s to %s\n", FormatMoney(masternodePayment), address2);
+        LogPrint(LOG_MASTERNODE,"Masternode payment of %s to %s\n", FormatMoney(masternodePayment), address2);
     }
 }
 
@@ -227,7 +317,7 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CMasternodeSync& mast
 
         netfulfilledman.AddFulfilledRequest(pfrom->addr, "mnget");
         Sync(pfrom, nCountNeeded);
-        LogPrint("mnpayments", "mnget - Sent Masternode winners to peer %i\n", pfrom->GetId());
+        LogPrint(LOG_MNPAYMENTS, "mnget - Sent Masternode winners to peer %i\n", pfrom->GetId());
     } else if (strCommand == "mnw") { //Masternode Payments Declare Winner
         //this is required in litemodef
         CMasternodePaymentWinner winner;
@@ -235,27 +325,24 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CMasternodeSync& mast
 
         if (pfrom->nVersion < ActiveProtocol()) return;
 
-        int nHeight;
-        {
-            TRY_LOCK(cs_main, locked);
-            if (!locked || activeChain_.Tip() == NULL) return;
-            nHeight = activeChain_.Tip()->nHeight;
-        }
+        const CBlockIndex* tip = chainTip;
+        if (tip == NULL) return;
+        const int nHeight = tip->nHeight;
 
         if (GetPaymentWinnerForHash(winner.GetHash()) != nullptr) {
-            LogPrint("mnpayments", "mnw - Already seen - %s bestHeight %d\n", winner.GetHash(), nHeight);
+            LogPrint(LOG_MNPAYMENTS, "mnw - Already seen - %s bestHeight %d\n", winner.GetHash(), nHeight);
             masternodeSynchronization.AddedMasternodeWinner(winner.GetHash());
             return;
         }
 
         int nFirstBlock = nHeight - (masternodeManager_.CountEnabled() * 1.25);
         if (winner.GetHeight() < nFirstBlock || winner.GetHeight() > nHeight + 20) {
-            LogPrint("mnpayments", "mnw - winner out of range - FirstBlock %d Height %d bestHeight %d\n", nFirstBlock, winner.GetHeight(), nHeight);
+            LogPrint(LOG_MNPAYMENTS, "mnw - winner out of range - FirstBlock %d Height %d bestHeight %d\n", nFirstBlock, winner.GetHeight(), nHeight);
             return;
         }
 
         if (!winner.ComputeScoreHash()) {
-            LogPrint("mnpayments", "mnw - could not compute score hash for height %d\n", winner.GetHeight());
+            LogPrint(LOG_MNPAYMENTS, "mnw - could not compute score hash for height %d\n", winner.GetHeight());
             return;
         }
 
@@ -266,7 +353,7 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CMasternodeSync& mast
         }
 
         if (!CanVote(winner.vinMasternode.prevout, winner.GetScoreHash())) {
-            //  LogPrint("masternode","mnw - masternode already voted - %s\n", winner.vinMasternode.prevout.ToStringShort());
+            //  LogPrint(LOG_MASTERNODE,"mnw - masternode already voted - %s\n", winner.vinMasternode.prevout.ToStringShort());
             return;
         }
 
@@ -282,7 +369,7 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CMasternodeSync& mast
         ExtractDestination(winner.payee, address1);
         CBitcoinAddress address2(address1);
 
-        //   LogPrint("mnpayments", "mnw - winning vote - Addr %s Height %d bestHeight %d - %s\n", address2, winner.nBlockHeight, nHeight, winner.vinMasternode.prevout.ToStringShort());
+        //   LogPrint(LOG_MNPAYMENTS, "mnw - winning vote - Addr %s Height %d bestHeight %d - %s\n", address2, winner.nBlockHeight, nHeight, winner.vinMasternode.prevout.ToStringShort());
 
         if (AddWinningMasternode(winner)) {
             winner.Relay();
@@ -320,14 +407,14 @@ bool CMasternodePayments::CheckMasternodeWinnerValidity(const CMasternodeSync& m
 
     if (!pmn) {
         strError = strprintf("Unknown Masternode %s", winner.vinMasternode.prevout.hash.ToString());
-        LogPrint("masternode","%s - %s\n",__func__, strError);
+        LogPrint(LOG_MASTERNODE,"%s - %s\n",__func__, strError);
         masternodeSynchronization.AskForMN(pnode, winner.vinMasternode);
         return false;
     }
 
     if (pmn->protocolVersion < ActiveProtocol()) {
         strError = strprintf("Masternode protocol too old %d - req %d", pmn->protocolVersion, ActiveProtocol());
-        LogPrint("masternode","%s - %s\n",__func__, strError);
+        LogPrint(LOG_MASTERNODE,"%s - %s\n",__func__, strError);
         return false;
     }
 
@@ -337,7 +424,7 @@ bool CMasternodePayments::CheckMasternodeWinnerValidity(const CMasternodeSync& m
     masternodeManager_.Check(*pmn);
     if (!pmn->IsEnabled()) {
         strError = strprintf("Masternode %s is not active", winner.vinMasternode.prevout.hash.ToString());
-        LogPrint("masternode", "%s - %s\n",__func__, strError);
+        LogPrint(LOG_MASTERNODE, "%s - %s\n",__func__, strError);
         return false;
     }
 
@@ -350,7 +437,7 @@ bool CMasternodePayments::CheckMasternodeWinnerValidity(const CMasternodeSync& m
         // We don't want to print all of these messages, or punish them unless they're way off
         if (voterRank > MNPAYMENTS_SIGNATURES_TOTAL * 2) {
             strError = strprintf("Masternode not in the top %d (%u)", MNPAYMENTS_SIGNATURES_TOTAL * 2, voterRank);
-            LogPrint("masternode","%s - %s\n",__func__, strError);
+            LogPrint(LOG_MASTERNODE,"%s - %s\n",__func__, strError);
         }
         return false;
     }
@@ -359,30 +446,48 @@ bool CMasternodePayments::CheckMasternodeWinnerValidity(const CMasternodeSync& m
     if(!masternodeSynchronization.IsSynced()){ return true;}
 
     /* Make sure that the payee is in our own payment queue near the top.  */
-    const std::vector<CMasternode*> mnQueue = GetMasternodePaymentQueue(seedHash, winner.GetHeight());
-    for (int i = 0; i < std::min<int>(2 * MNPAYMENTS_SIGNATURES_TOTAL, mnQueue.size()); ++i) {
-        const auto& mn = *mnQueue[i];
-        const CScript mnPayee = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
-        if (mnPayee == winner.payee)
-            return true;
+    return IsPayeeNearTopOfPaymentQueue(seedHash, winner.GetHeight(), winner.payee);
+}
+
+bool CMasternodePayments::IsPayeeNearTopOfPaymentQueue(const uint256& seedHash, const int nBlockHeight, const CScript& payee) const
+{
+    std::set<CScript> scheduledPayees;
+    CollectScheduledPayees(nBlockHeight, scheduledPayees);
+    const int64_t now = GetTime();
+
+    LOCK2(networkMessageManager_.cs, cs_paymentQueueCache);
+    const uint64_t masternodeListGeneration = networkMessageManager_.masternodeListGeneration();
+    const std::vector<CScript>* topPayees = paymentQueueCache->Find(
+        seedHash, nBlockHeight, ChainTipHeight(), masternodeListGeneration, scheduledPayees, now);
+    if (topPayees == nullptr) {
+        const std::vector<CMasternode*> mnQueue = ComputeMasternodePaymentQueue(seedHash, nBlockHeight, scheduledPayees);
+        std::vector<CScript> newTopPayees;
+        for (int i = 0; i < std::min<int>(2 * MNPAYMENTS_SIGNATURES_TOTAL, mnQueue.size()); ++i)
+            newTopPayees.push_back(GetScriptForDestination(mnQueue[i]->pubKeyCollateralAddress.GetID()));
+
+        topPayees = paymentQueueCache->Insert(
+            seedHash, nBlockHeight, ChainTipHeight(), masternodeListGeneration, scheduledPayees, now, newTopPayees);
     }
-    return false;
+
+    return std::find(topPayees->begin(), topPayees->end(), payee) != topPayees->end();
 }
 
 // Is this masternode scheduled to get paid soon?
 // -- Only look ahead up to 8 blocks to allow for propagation of the latest 2 winners
 bool CMasternodePayments::IsScheduled(const CScript mnpayee, int nNotBlockHeight) const
+{
+    std::set<CScript> scheduledPayees;
+    CollectScheduledPayees(nNotBlockHeight, scheduledPayees);
+    return scheduledPayees.count(mnpayee) > 0;
+}
+
+void CMasternodePayments::CollectScheduledPayees(int nNotBlockHeight, std::set<CScript>& scheduledPayees) const
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    CBlockIndex* tip = nullptr;
-    {
-        TRY_LOCK(cs_main, locked);
-        if (!locked) return false;
-        tip = activeChain_.Tip();
-    }
+    const CBlockIndex* tip = chainTip;
     if (tip == nullptr)
-        return false;
+        return;
 
     for (int64_t h = 0; h <= 8; ++h) {
         if (tip->nHeight + h == nNotBlockHeight) continue;
@@ -390,11 +495,9 @@ bool CMasternodePayments::IsScheduled(const CScript mnpayee, int nNotBlockHeight
         if (!GetBlockHashForScoring(seedHash, tip, h)) continue;
         auto* payees = GetPayeesForScoreHash(seedHash);
         CScript payee;
-        if (payees != nullptr && payees->GetPayee(payee) && payee == mnpayee)
-            return true;
+        if (payees != nullptr && payees->GetPayee(payee))
+            scheduledPayees.insert(payee);
     }
-
-    return false;
 }
 
 bool CMasternodePayments::AddWinningMasternode(const CMasternodePaymentWinner& winnerIn)
@@ -408,6 +511,7 @@ bool CMasternodePayments::AddWinningMasternode(const CMasternodePaymentWinner& w
 
         auto ins = mapMasternodePayeeVotes.emplace(winnerIn.GetHash(), winnerIn);
         assert(ins.second);
+        payeeVoteHashesByHeight[winnerIn.GetHeight()].push_back(winnerIn.GetHash());
 
         payees = GetPayeesForScoreHash(winnerIn.GetScoreHash());
         if (payees == nullptr) {
@@ -446,7 +550,7 @@ bool CMasternodeBlockPayees::IsTransactionValid(const I_BlockSubsidyProvider& su
                 if(out.nValue >= requiredMasternodePayment)
                     found = true;
                 else
-                    LogPrint("masternode","Masternode payment is out of drift range. Paid=%s Min=%s\n", FormatMoney(out.nValue), FormatMoney(requiredMasternodePayment));
+                    LogPrint(LOG_MASTERNODE,"Masternode payment is out of drift range. Paid=%s Min=%s\n", FormatMoney(out.nValue), FormatMoney(requiredMasternodePayment));
             }
         }
 
@@ -465,7 +569,7 @@ bool CMasternodeBlockPayees::IsTransactionValid(const I_BlockSubsidyProvider& su
         }
     }
 
-    LogPrint("masternode","CMasternodePayments::IsTransactionValid - Missing required payment of %s to %s\n", FormatMoney(requiredMasternodePayment), strPayeesPossible);
+    LogPrint(LOG_MASTERNODE,"CMasternodePayments::IsTransactionValid - Missing required payment of %s to %s\n", FormatMoney(requiredMasternodePayment), strPayeesPossible);
     return false;
 }
 
@@ -520,34 +624,38 @@ void CMasternodePayments::PruneOldMasternodeWinnerData(CMasternodeSync& masterno
 {
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
 
-    int nHeight;
-    {
-        TRY_LOCK(cs_main, locked);
-        if (!locked || activeChain_.Tip() == NULL) return;
-        nHeight = activeChain_.Tip()->nHeight;
-    }
+    const CBlockIndex* tip = chainTip;
+    if (tip == NULL) return;
+    const int nHeight = tip->nHeight;
 
     //keep up to five cycles for historical sake
     int nLimit = std::max(int(masternodeSynchronization.masternodeCount() * 1.25), 1000);
 
-    std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
-    while (it != mapMasternodePayeeVotes.end()) {
-        CMasternodePaymentWinner winner = (*it).second;
-
-        if (nHeight - winner.GetHeight() > nLimit) {
-            LogPrint("mnpayments", "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.GetHeight());
-            masternodeSynchronization.mapSeenSyncMNW.erase((*it).first);
-            mapMasternodePayeeVotes.erase(it++);
-            mapMasternodeBlocks.erase(winner.GetScoreHash());
-        } else {
-            ++it;
+    // Only the heights that have fallen out of the window are visited
+    const std::map<int, std::vector<uint256>>::iterator firstKeptHeight = payeeVoteHashesByHeight.lower_bound(nHeight - nLimit);
+    for (std::map<int, std::vector<uint256>>::iterator it = payeeVoteHashesByHeight.begin(); it != firstKeptHeight; ++it) {
+        for (const uint256& hash: (*it).second) {
+            std::map<uint256, CMasternodePaymentWinner>::iterator vote = mapMasternodePayeeVotes.find(hash);
+            if (vote == mapMasternodePayeeVotes.end()) continue;
+
+            LogPrint(LOG_MNPAYMENTS, "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", (*it).first);
+            masternodeSynchronization.mapSeenSyncMNW.erase(hash);
+            mapMasternodeBlocks.erase((*vote).second.GetScoreHash());
+            mapMasternodePayeeVotes.erase(vote);
         }
     }
+    payeeVoteHashesByHeight.erase(payeeVoteHashesByHeight.begin(), firstKeptHeight);
+}
+
+void CMasternodePayments::updateChainTipHeight(const CBlockIndex* pindex)
+{
+    chainTip = pindex;
 }
 
-void CMasternodePayments::updateChainTipHeight(const CBlockIndex* chainTip)
+int CMasternodePayments::ChainTipHeight() const
 {
-    chainTipHeight = chainTip->nHeight;
+    const CBlockIndex* tip = chainTip;
+    return tip ? tip->nHeight : 0;
 }
 void CMasternodePayments::Sync(CNode* node, int nCountNeeded)
 {
@@ -557,14 +665,13 @@ void CMasternodePayments::Sync(CNode* node, int nCountNeeded)
     if (nCountNeeded > nCount) nCountNeeded = nCount;
 
     int nInvCount = 0;
-    std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
-    while (it != mapMasternodePayeeVotes.end()) {
-        CMasternodePaymentWinner winner = (*it).second;
-        if (winner.GetHeight() >= chainTipHeight - nCountNeeded && winner.GetHeight() <= chainTipHeight + 20) {
-            node->PushInventory(CInv(MSG_MASTERNODE_WINNER, winner.GetHash()));
+    const int nChainTipHeight = ChainTipHeight();
+    const std::map<int, std::vector<uint256>>::const_iterator end = payeeVoteHashesByHeight.upper_bound(nChainTipHeight + 20);
+    for (std::map<int, std::vector<uint256>>::const_iterator it = payeeVoteHashesByHeight.lower_bound(nChainTipHeight - nCountNeeded); it != end; ++it) {
+        for (const uint256& hash: (*it).second) {
+            node->PushInventory(CInv(MSG_MASTERNODE_WINNER, hash));
             nInvCount++;
         }
-        ++it;
     }
     node->PushMessage("ssc", MASTERNODE_SYNC_MNW, nInvCount);
 }
@@ -578,6 +685,16 @@ std::string CMasternodePayments::ToString() const
     return info.str();
 }
 
+size_t CMasternodePayments::DynamicMemoryUsage() const
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
+    size_t usage = memusage::DynamicUsage(mapMasternodePayeeVotes) + memusage::DynamicUsage(mapMasternodeBlocks) +
+                   memusage::DynamicUsage(payeeVoteHashesByHeight);
+    for (const std::pair<const int, std::vector<uint256> >& votes : payeeVoteHashesByHeight)
+        usage += memusage::DynamicUsage(votes.second);
+    return usage;
+}
+
 unsigned CMasternodePayments::FindLastPayeePaymentTime(const CMasternode& masternode, const unsigned maxBlockDepth) const
 {
     const CBlockIndex* chainTip = activeChain_.Tip();
@@ -633,7 +750,7 @@ std::vector<CMasternode*> CMasternodePayments::GetMasternodePaymentQueue(const C
 }
 
 void ComputeMasternodesAndScores(
-    const CMasternodePayments& masternodePayments,
+    const std::set<CScript>& scheduledPayees,
     std::vector<CMasternode>& masternodes,
     const uint256& seedHash,
     const int nMnCount,
@@ -655,7 +772,7 @@ void ComputeMasternodesAndScores(
         // proper testing with a very small number of masternodes (which would
         // be scheduled and skipped all the time).
         if (Params().NetworkID() != CBaseChainParams::REGTEST) {
-            if (masternodePayments.IsScheduled(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), nBlockHeight)) continue;
+            if (scheduledPayees.count(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()))) continue;
         }
 
         //it's too new, wait for a cycle
@@ -675,6 +792,15 @@ void ComputeMasternodesAndScores(
 std::vector<CMasternode*> CMasternodePayments::GetMasternodePaymentQueue(const uint256& seedHash, const int nBlockHeight) const
 {
     LOCK(networkMessageManager_.cs);
+    std::set<CScript> scheduledPayees;
+    CollectScheduledPayees(nBlockHeight, scheduledPayees);
+    return ComputeMasternodePaymentQueue(seedHash, nBlockHeight, scheduledPayees);
+}
+
+std::vector<CMasternode*> CMasternodePayments::ComputeMasternodePaymentQueue(
+    const uint256& seedHash, const int nBlockHeight, const std::set<CScript>& scheduledPayees) const
+{
+    AssertLockHeld(networkMessageManager_.cs);
     std::vector< CMasternode* > masternodeQueue;
     std::map<const CMasternode*, uint256> masternodeScores;
     std::vector<CMasternode> filteredMasternodes;
@@ -682,7 +808,7 @@ std::vector<CMasternode*> CMasternodePayments::GetMasternodePaymentQueue(const u
     int nMnCount = masternodeManager_.CountEnabled();
     masternodeManager_.Check();
     ComputeMasternodesAndScores(
-        *this,
+        scheduledPayees,
         networkMessageManager_.masternodes,
         seedHash,
         nMnCount,
@@ -695,7 +821,7 @@ std::vector<CMasternode*> CMasternodePayments::GetMasternodePaymentQueue(const u
     if (static_cast<int>(masternodeQueue.size()) < nMnCount / 3)
     {
         ComputeMasternodesAndScores(
-            *this,
+            scheduledPayees,
             filteredMasternodes,
             seedHash,
             nMnCount,
@@ -732,13 +858,13 @@ bool CheckAndGetScore(CMasternode& mn,
                       int64_t& score)
 {
     if (mn.protocolVersion < minProtocol) {
-        LogPrint("masternode", "Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
+        LogPrint(LOG_MASTERNODE, "Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
         return false;
     }
 
     const int64_t nAge = GetAdjustedTime() - mn.sigTime;
     if (nAge < MN_WINNER_MINIMUM_AGE) {
-        LogPrint("masternode", "Skipping just activated Masternode. Age: %ld\n", nAge);
+        LogPrint(LOG_MASTERNODE, "Skipping just activated Masternode. Age: %ld\n", nAge);
         return false;
     }
 
@@ -760,7 +886,7 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
     const RankingCacheEntry::value_type* cacheEntry;
     RankingCacheEntry::value_type newEntry;
 
-    cacheEntry = rankingCache->Find(seedHash);
+    cacheEntry = rankingCache->Find(seedHash, minProtocol);
     if (cacheEntry == nullptr) {
         std::vector<std::pair<int64_t, uint256>> rankedNodes;
         {
@@ -787,7 +913,7 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
             else
                 newEntry[i].SetNull();
 
-        rankingCache->Insert(seedHash, newEntry);
+        rankingCache->Insert(seedHash, minProtocol, newEntry);
         cacheEntry = &newEntry;
     }
 
@@ -802,4 +928,6 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
 void CMasternodePayments::ResetRankingCache()
 {
     rankingCache.reset(new RankingCache);
+    LOCK(cs_paymentQueueCache);
+    paymentQueueCache.reset(new PaymentQueueCache);
 }
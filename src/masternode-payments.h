@@ -11,8 +11,12 @@
 #include <boost/lexical_cast.hpp>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <streams.h>
 #include <MasternodePayeeData.h>
 
+#include <atomic>
+#include <set>
+
 class CBlock;
 class CMasternodePayments;
 class CMasternodePaymentWinner;
@@ -20,7 +24,6 @@ class CMasternodeBlockPayees;
 class CMasternode;
 class CNode;
 class CBlockIndex;
-class CDataStream;
 class CMasternodeSync;
 class I_BlockSubsidyProvider;
 class CMasternodeMan;
@@ -39,10 +42,15 @@ private:
     // if some masternode is in the top-20 for a recent block height.
     class RankingCache;
     std::unique_ptr<RankingCache> rankingCache;
+    // Cache of the top of the payment queue that winner votes are checked against
+    class PaymentQueueCache;
+    std::unique_ptr<PaymentQueueCache> paymentQueueCache;
+    mutable CCriticalSection cs_paymentQueueCache;
 
     int nSyncedFromPeer;
     int nLastBlockHeight;
-    int chainTipHeight;
+    //! The tip UpdateTip last published, readable without cs_main
+    std::atomic<const CBlockIndex*> chainTip;
     MasternodePaymentData& paymentData_;
     MasternodeNetworkMessageManager& networkMessageManager_;
     CMasternodeMan& masternodeManager_;
@@ -52,12 +60,19 @@ private:
     std::map<uint256, CMasternodePaymentWinner>& mapMasternodePayeeVotes;
     /** Map from score hashes of blocks to the corresponding winners.  */
     std::map<uint256, CMasternodeBlockPayees>& mapMasternodeBlocks;
+    /** Hashes of the mnw's by the height they vote for.  */
+    std::map<int, std::vector<uint256>>& payeeVoteHashesByHeight;
 
     mutable CCriticalSection cs_mapMasternodeBlocks;
     mutable CCriticalSection cs_mapMasternodePayeeVotes;
 
+    int ChainTipHeight() const;
     bool GetBlockPayee(const uint256& seedHash, CScript& payee) const;
     bool CheckMasternodeWinnerSignature(const CMasternodePaymentWinner& winner) const;
+    void CollectScheduledPayees(int nNotBlockHeight, std::set<CScript>& scheduledPayees) const;
+    std::vector<CMasternode*> ComputeMasternodePaymentQueue(
+        const uint256& seedHash, int nBlockHeight, const std::set<CScript>& scheduledPayees) const;
+    bool IsPayeeNearTopOfPaymentQueue(const uint256& seedHash, int nBlockHeight, const CScript& payee) const;
     bool CheckMasternodeWinnerValidity(const CMasternodeSync& masternodeSynchronization,const CMasternodePaymentWinner& winner, CNode* pnode, std::string& strError) const;
 public:
     static const int MNPAYMENTS_SIGNATURES_REQUIRED;
@@ -87,6 +102,8 @@ public:
     std::string GetRequiredPaymentsString(const uint256& seedHash) const;
     void FillBlockPayee(const CBlockIndex* pindexPrev, CMutableTransaction& txNew, const CBlockRewards &rewards, bool fProofOfStake) const;
     std::string ToString() const;
+    //! Bytes of memory the votes and the payees by block take up, not counting what their entries allocate
+    size_t DynamicMemoryUsage() const;
 
     unsigned FindLastPayeePaymentTime(const CMasternode& masternode, const unsigned maxBlockDepth) const;
     CScript GetNextMasternodePayeeInQueueForPayment(const CBlockIndex* pindex, const int offset) const;
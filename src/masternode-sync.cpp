@@ -9,6 +9,7 @@
 #include <masternode-payments.h>
 #include <spork.h>
 #include <utiltime.h>
+#include <timedata.h>
 #include <Logging.h>
 #include <netfulfilledman.h>
 #include <ui_interface.h>
@@ -25,6 +26,10 @@
 
 static constexpr int64_t MASTERNODE_SYNC_TIMEOUT = 5;
 static constexpr int64_t MASTERNODE_SYNC_THRESHOLD = 2;
+// Peers that have to report sending an asset before it can be done with ahead of the timeouts
+static constexpr int MASTERNODE_SYNC_QUORUM = 2;
+// Peers asked for an asset at once, instead of one peer each time the sync is processed
+static constexpr unsigned MASTERNODE_SYNC_PARALLEL_PEERS = 3;
 
 CMasternodeSync::CMasternodeSync(
     CMasternodePayments& masternodePayments,
@@ -53,6 +58,8 @@ void CMasternodeSync::Reset()
     sumMasternodeWinner = 0;
     countMasternodeList = 0;
     countMasternodeWinner = 0;
+    largestMasternodeList = 0;
+    largestMasternodeWinner = 0;
     RequestedMasternodeAssets = MASTERNODE_SYNC_INITIAL;
     RequestedMasternodeAttempt = 0;
     nAssetSyncStarted = GetTime();
@@ -65,7 +72,17 @@ void CMasternodeSync::DsegUpdate(CNode* pnode)
 
     if(networkMessageManager_.recordDsegUpdateAttempt(pnode->addr))
     {
-        pnode->PushMessage("dseg", CTxIn());
+        // A list that was kept up to date until recently only needs the changes since then.
+        // Peers that do not know about the time ignore it and send the full list.
+        const int64_t newestPingTime = networkMessageManager_.newestPingTime();
+        if (newestPingTime > 0 && GetAdjustedTime() - newestPingTime < MASTERNODE_EXPIRATION_SECONDS)
+        {
+            pnode->PushMessage("dseg", CTxIn(), newestPingTime - MASTERNODE_MIN_MNP_SECONDS);
+        }
+        else
+        {
+            pnode->PushMessage("dseg", CTxIn());
+        }
     }
 }
 
@@ -156,6 +173,7 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, std::string& strCommand, CDat
             }
             sumMasternodeList += nCount;
             countMasternodeList++;
+            largestMasternodeList = std::max(largestMasternodeList, nCount);
             break;
         case (MASTERNODE_SYNC_MNW):
             if (nItemID != RequestedMasternodeAssets) return;
@@ -164,10 +182,11 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, std::string& strCommand, CDat
             }
             sumMasternodeWinner += nCount;
             countMasternodeWinner++;
+            largestMasternodeWinner = std::max(largestMasternodeWinner, nCount);
             break;
         }
 
-        LogPrint("masternode", "CMasternodeSync:ProcessMessage - ssc - got inventory count %d %d\n", nItemID, nCount);
+        LogPrint(LOG_MASTERNODE, "CMasternodeSync:ProcessMessage - ssc - got inventory count %d %d\n", nItemID, nCount);
     }
 }
 bool CMasternodeSync::ShouldWaitForSync(const int64_t now)
@@ -176,7 +195,7 @@ bool CMasternodeSync::ShouldWaitForSync(const int64_t now)
        due to mocktime during testing.  But in any case it means something is
        weird, so let's start over.  */
     if (nTimeLastProcess > now) {
-        LogPrint("masternode", "CMasternodeSync::Process() - WARNING: time went backwards, restarting sync...\n");
+        LogPrint(LOG_MASTERNODE, "CMasternodeSync::Process() - WARNING: time went backwards, restarting sync...\n");
         Reset();
         nTimeLastProcess = now;
         return true;
@@ -207,7 +226,7 @@ bool CMasternodeSync::ShouldWaitForSync(const int64_t now)
 SyncStatus CMasternodeSync::SyncAssets(CNode* pnode, const int64_t now, const int64_t lastUpdate, std::string assetType)
 {
     static const CSporkManager& sporkManager = GetSporkManager();
-    LogPrint("masternode", "%s - %s %lld (GetTime() - MASTERNODE_SYNC_TIMEOUT) %lld\n",__func__,assetType, lastUpdate, now - MASTERNODE_SYNC_TIMEOUT);
+    LogPrint(LOG_MASTERNODE, "%s - %s %lld (GetTime() - MASTERNODE_SYNC_TIMEOUT) %lld\n",__func__,assetType, lastUpdate, now - MASTERNODE_SYNC_TIMEOUT);
     if (lastUpdate > 0 && lastUpdate < now - MASTERNODE_SYNC_TIMEOUT * 2 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD)
     { //hasn't received a new item in the last five seconds, so we'll move to the
         GetNextAsset();
@@ -217,9 +236,8 @@ SyncStatus CMasternodeSync::SyncAssets(CNode* pnode, const int64_t now, const in
     if (netfulfilledman.HasFulfilledRequest(pnode->addr, assetType)) return SyncStatus::SUCCESS;
     netfulfilledman.AddFulfilledRequest(pnode->addr, assetType);
 
-    // timeout
-    if (lastUpdate == 0 &&
-            (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3 || now - nAssetSyncStarted > MASTERNODE_SYNC_TIMEOUT * 5)) {
+    // timeout, by time alone as several peers are asked at once
+    if (lastUpdate == 0 && now - nAssetSyncStarted > MASTERNODE_SYNC_TIMEOUT * 5) {
         if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
             LogPrintf("%s - ERROR - Sync has failed, will retry later (%s)\n",__func__,assetType);
             RequestedMasternodeAssets = MASTERNODE_SYNC_FAILED;
@@ -301,14 +319,28 @@ bool CMasternodeSync::MasternodeWinnersListIsSync(CNode* pnode, const int64_t no
     }
     return true;
 }
+bool CMasternodeSync::CurrentAssetReachedQuorum() const
+{
+    // Peers send their count after queueing the items, so the items can still be on their way when it comes
+    switch (RequestedMasternodeAssets) {
+    case (MASTERNODE_SYNC_LIST):
+        return countMasternodeList >= MASTERNODE_SYNC_QUORUM &&
+            mapSeenSyncMNB.size() >= static_cast<size_t>(largestMasternodeList);
+    case (MASTERNODE_SYNC_MNW):
+        return countMasternodeWinner >= MASTERNODE_SYNC_QUORUM &&
+            mapSeenSyncMNW.size() >= static_cast<size_t>(largestMasternodeWinner);
+    }
+    return false;
+}
+
 void CMasternodeSync::Process(bool networkIsRegtest)
 {
     const int64_t now = GetTime();
-    LogPrint("masternode", "Masternode sync process at %lld\n", now);
+    LogPrint(LOG_MASTERNODE, "Masternode sync process at %lld\n", now);
 
     if(ShouldWaitForSync(now)) return;
 
-    LogPrint("masternode", "CMasternodeSync::Process() - RequestedMasternodeAssets %d\n", RequestedMasternodeAssets);
+    LogPrint(LOG_MASTERNODE, "CMasternodeSync::Process() - RequestedMasternodeAssets %d\n", RequestedMasternodeAssets);
 
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_INITIAL) GetNextAsset();
 
@@ -330,6 +362,12 @@ void CMasternodeSync::Process(bool networkIsRegtest)
         return;
     }
 
+    while (CurrentAssetReachedQuorum()) {
+        LogPrint(LOG_MASTERNODE, "CMasternodeSync::Process() - quorum of peers reached for asset %d\n", RequestedMasternodeAssets);
+        GetNextAsset();
+    }
+
+    unsigned peersAsked = 0;
     for(CNode* pnode: vSporkSyncedNodes)
     {
         //set to synced
@@ -344,13 +382,13 @@ void CMasternodeSync::Process(bool networkIsRegtest)
 
         if (pnode->nVersion >=  ActiveProtocol())
         {
-            if(!MasternodeListIsSynced(pnode,now))
-            {
-                return;
-            }
-
-            if (!MasternodeWinnersListIsSync(pnode,now))
+            const int asset = RequestedMasternodeAssets;
+            const int attempt = RequestedMasternodeAttempt;
+            if(!MasternodeListIsSynced(pnode,now) || !MasternodeWinnersListIsSync(pnode,now))
             {
+                // Having asked this peer, go on to ask the next ones for the same asset
+                const bool asked = RequestedMasternodeAssets == asset && RequestedMasternodeAttempt > attempt;
+                if (asked && ++peersAsked < MASTERNODE_SYNC_PARALLEL_PEERS) continue;
                 return;
             }
         }
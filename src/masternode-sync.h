@@ -15,7 +15,6 @@
 
 class CMasternodeSync;
 class CNode;
-class CDataStream;
 class MasternodeNetworkMessageManager;
 class MasternodePaymentData;
 class CMasternodePayments;
@@ -23,6 +22,7 @@ class CTxIn;
 
 #include <map>
 #include <uint256.h>
+#include <streams.h>
 #include <stdint.h>
 #include <string>
 //
@@ -57,6 +57,9 @@ public:
     // peers that reported counts
     int countMasternodeList;
     int countMasternodeWinner;
+    // largest count a single peer reported
+    int largestMasternodeList;
+    int largestMasternodeWinner;
 
     // Count peers we've requested the list from
     int RequestedMasternodeAssets;
@@ -83,6 +86,8 @@ public:
     SyncStatus SyncAssets(CNode* pnode, const int64_t now,const int64_t lastUpdate, std::string assetType);
     bool MasternodeListIsSynced(CNode* pnode, const int64_t now);
     bool MasternodeWinnersListIsSync(CNode* pnode, const int64_t now);
+    //! Whether enough peers reported sending the current asset, and the most any of them sent has been seen
+    bool CurrentAssetReachedQuorum() const;
     void Process(bool networkIsRegtest);
     bool IsSynced() const;
     bool IsMasternodeListSynced() const { return RequestedMasternodeAssets > MASTERNODE_SYNC_LIST; }
@@ -23,6 +23,7 @@
 #include <blockmap.h>
 #include <TransactionDiskAccessor.h>
 #include <NodeState.h>
+#include <ui_interface.h>
 
 extern bool ShutdownRequested();
 
@@ -59,14 +60,12 @@ static bool IsVinAssociatedWithPubkey(CTxIn& vin, CPubKey& pubkey, MasternodeTie
 {
     CScript payee = GetScriptForDestination(pubkey.GetID());
 
-    CTransaction txVin;
-    uint256 hash;
+    CTxOut output;
+    int nHeight;
     auto nCollateral = CMasternode::GetTierCollateralAmount(nMasternodeTier);
-    if (GetTransaction(vin.prevout.hash, txVin, hash, true))
+    // The collateral has to be unspent, so the coin database holds it
+    if (GetUnspentTransactionOutput(vin.prevout, output, nHeight))
     {
-        if(vin.prevout.n >= txVin.vout.size()) return false;
-
-        const CTxOut& output = txVin.vout[vin.prevout.n];
         return output.nValue == nCollateral && output.scriptPubKey == payee;
     }
     return false;
@@ -98,10 +97,9 @@ bool CMasternodeMan::Add(const CMasternode& mn)
     if (!mn.IsEnabled())
         return false;
 
-    CMasternode* pmn = Find(mn.vin);
-    if (pmn == NULL) {
-        LogPrint("masternode", "CMasternodeMan: Adding new Masternode %s - %i now\n", mn.vin.prevout.hash, networkMessageManager_.masternodeCount() + 1);
-        networkMessageManager_.masternodes.push_back(mn);
+    if (networkMessageManager_.addMasternode(mn)) {
+        LogPrint(LOG_MASTERNODE, "CMasternodeMan: Adding new Masternode %s - %i now\n", mn.vin.prevout.hash, networkMessageManager_.masternodeCount());
+        uiInterface.NotifyMasternodeChanged(mn.vin.prevout, mn.activeState);
         return true;
     }
 
@@ -124,7 +122,14 @@ void CMasternodeMan::Check(CMasternode& mn, bool forceCheck)
     if (!forceCheck && (GetTime() - mn.lastTimeChecked < MASTERNODE_CHECK_SECONDS)) return;
     mn.lastTimeChecked = GetTime();
 
+    const int previousState = mn.activeState;
+    UpdateActiveState(mn);
+    if (mn.activeState != previousState)
+        uiInterface.NotifyMasternodeChanged(mn.vin.prevout, mn.activeState);
+}
 
+void CMasternodeMan::UpdateActiveState(CMasternode& mn)
+{
     //once spent, stop doing the checks
     if (mn.activeState == CMasternode::state::MASTERNODE_VIN_SPENT) return;
 
@@ -172,22 +177,25 @@ void CMasternodeMan::CheckAndRemoveInnactive(CMasternodeSync& masternodeSynchron
 
     LOCK(cs);
 
-    //remove inactive and outdated
-    std::vector<CMasternode>::iterator it = networkMessageManager_.masternodes.begin();
-    while (it != networkMessageManager_.masternodes.end())
+    //remove inactive and outdated, the removed ones are replaced by the last masternode
+    std::vector<CMasternode>& masternodes = networkMessageManager_.masternodes;
+    size_t position = 0;
+    while (position < masternodes.size())
     {
-        if ((*it).activeState == CMasternode::MASTERNODE_REMOVE ||
-            (*it).activeState == CMasternode::MASTERNODE_VIN_SPENT ||
-            (forceExpiredRemoval && (*it).activeState == CMasternode::MASTERNODE_EXPIRED) ||
-            (*it).protocolVersion < ActiveProtocol())
+        const CMasternode& mn = masternodes[position];
+        if (mn.activeState == CMasternode::MASTERNODE_REMOVE ||
+            mn.activeState == CMasternode::MASTERNODE_VIN_SPENT ||
+            (forceExpiredRemoval && mn.activeState == CMasternode::MASTERNODE_EXPIRED) ||
+            mn.protocolVersion < ActiveProtocol())
         {
-            LogPrint("masternode", "CMasternodeMan: Removing inactive Masternode %s - %i now\n", (*it).vin.prevout.hash, networkMessageManager_.masternodeCount() - 1);
+            const COutPoint collateral = mn.vin.prevout;
+            LogPrint(LOG_MASTERNODE, "CMasternodeMan: Removing inactive Masternode %s - %i now\n", collateral.hash, networkMessageManager_.masternodeCount() - 1);
 
-            networkMessageManager_.clearExpiredMasternodeBroadcasts(it->vin.prevout,masternodeSynchronization);
-            networkMessageManager_.clearExpiredMasternodeEntryRequests(it->vin.prevout);
-            it = networkMessageManager_.masternodes.erase(it);
+            networkMessageManager_.clearExpiredMasternodeBroadcasts(collateral,masternodeSynchronization);
+            networkMessageManager_.clearExpiredMasternodeEntryRequests(collateral);
+            networkMessageManager_.removeMasternode(collateral);
         } else {
-            ++it;
+            ++position;
         }
     }
 
@@ -222,24 +230,24 @@ bool CMasternodeMan::CheckInputsForMasternode(const CMasternodeBroadcast& mnb, i
 
     if (IsCoinSpent(mnb))
     {
-        LogPrint("masternode", "mnb - coin is already spent\n");
+        LogPrint(LOG_MASTERNODE, "mnb - coin is already spent\n");
         return false;
     }
 
 
-    LogPrint("masternode", "mnb - Accepted Masternode entry\n");
+    LogPrint(LOG_MASTERNODE, "mnb - Accepted Masternode entry\n");
 
     const CBlockIndex* pindexConf = ComputeMasternodeConfirmationBlockIndex(mnb);
 
     if (pindexConf == nullptr) {
-        LogPrint("masternode","mnb - Input must have at least %d confirmations\n", MASTERNODE_MIN_CONFIRMATIONS);
+        LogPrint(LOG_MASTERNODE,"mnb - Input must have at least %d confirmations\n", MASTERNODE_MIN_CONFIRMATIONS);
         return false;
     }
 
     // verify that sig time is legit in past
     // should be at least not earlier than block when 1000 PIV tx got MASTERNODE_MIN_CONFIRMATIONS
     if (pindexConf->GetBlockTime() > mnb.sigTime) {
-        LogPrint("masternode","mnb - Bad sigTime %d for Masternode %s (%i conf block is at %d)\n",
+        LogPrint(LOG_MASTERNODE,"mnb - Bad sigTime %d for Masternode %s (%i conf block is at %d)\n",
                  mnb.sigTime, mnb.vin.prevout.hash, MASTERNODE_MIN_CONFIRMATIONS, pindexConf->GetBlockTime());
         return false;
     }
@@ -262,12 +270,12 @@ bool CMasternodeMan::CheckAndUpdateMasternode(CMasternodeSync& masternodeSynchro
     }
 
     if (mnb.protocolVersion < ActiveProtocol()) {
-        LogPrint("masternode","mnb - ignoring outdated Masternode %s protocol version %d\n", mnb.vin.prevout.hash, mnb.protocolVersion);
+        LogPrint(LOG_MASTERNODE,"mnb - ignoring outdated Masternode %s protocol version %d\n", mnb.vin.prevout.hash, mnb.protocolVersion);
         return false;
     }
 
     if (!mnb.vin.scriptSig.empty()) {
-        LogPrint("masternode","mnb - Ignore Not Empty ScriptSig %s\n", mnb.vin.prevout.hash);
+        LogPrint(LOG_MASTERNODE,"mnb - Ignore Not Empty ScriptSig %s\n", mnb.vin.prevout.hash);
         return false;
     }
 
@@ -288,7 +296,7 @@ bool CMasternodeMan::CheckAndUpdateMasternode(CMasternodeSync& masternodeSynchro
 
     // this broadcast older than we have, it's bad.
     if (pmn->sigTime > mnb.sigTime) {
-        LogPrint("masternode","mnb - Bad sigTime %d for Masternode %s (existing broadcast is at %d)\n",
+        LogPrint(LOG_MASTERNODE,"mnb - Bad sigTime %d for Masternode %s (existing broadcast is at %d)\n",
                  mnb.sigTime, mnb.vin.prevout.hash, pmn->sigTime);
         return false;
     }
@@ -299,8 +307,9 @@ bool CMasternodeMan::CheckAndUpdateMasternode(CMasternodeSync& masternodeSynchro
     //   after that they just need to match
     if (pmn->pubKeyCollateralAddress == mnb.pubKeyCollateralAddress && !MasternodeCanBeUpdatedFromBroadcast(*pmn)) {
         //take the newest entry
-        LogPrint("masternode","mnb - Got updated entry for %s\n", mnb.vin.prevout.hash);
+        LogPrint(LOG_MASTERNODE,"mnb - Got updated entry for %s\n", mnb.vin.prevout.hash);
         if (UpdateWithNewBroadcast(mnb,*pmn)) {
+            networkMessageManager_.reindexMasternode(*pmn);
             int unusedDoSValue = 0;
             if (mnb.lastPing != CMasternodePing() &&
                 CheckAndUpdatePing(*pmn,mnb.lastPing,unusedDoSValue))
@@ -320,31 +329,31 @@ bool CMasternodeMan::CheckAndUpdateMasternode(CMasternodeSync& masternodeSynchro
 bool CMasternodeMan::CheckAndUpdatePing(CMasternode& mn, CMasternodePing& mnp, int& nDoS,bool skipPingChainSyncCheck)
 {
     if (mnp.sigTime > GetAdjustedTime() + 60 * 60) {
-        LogPrint("masternode", "%s - Signature rejected, too far into the future %s\n",
+        LogPrint(LOG_MASTERNODE, "%s - Signature rejected, too far into the future %s\n",
                  __func__, mnp.vin.prevout.hash);
         nDoS = 1;
         return false;
     }
 
     if (mnp.sigTime <= GetAdjustedTime() - 60 * 60) {
-        LogPrint("masternode", "%s - Signature rejected, too far into the past %s - %d %d\n",
+        LogPrint(LOG_MASTERNODE, "%s - Signature rejected, too far into the past %s - %d %d\n",
                  __func__, mnp.vin.prevout.hash, mnp.sigTime, GetAdjustedTime());
         nDoS = 1;
         return false;
     }
 
-    LogPrint("masternode", "%s - New Ping - %s - %lli\n", __func__, mnp.blockHash, mnp.sigTime);
+    LogPrint(LOG_MASTERNODE, "%s - New Ping - %s - %lli\n", __func__, mnp.blockHash, mnp.sigTime);
 
     // see if we have this Masternode
     if (mn.protocolVersion >= ActiveProtocol()) {
-        // LogPrint("masternode","mnping - Found corresponding mn for vin: %s\n", vin);
+        // LogPrint(LOG_MASTERNODE,"mnping - Found corresponding mn for vin: %s\n", vin);
         // update only if there is no known ping for this masternode or
         // last ping was more then MASTERNODE_MIN_MNP_SECONDS-60 ago comparing to this one
         if (!IsTooEarlyToReceivePingUpdate(mn,mnp.sigTime)) {
             std::string errorMessage = "";
             if (!CObfuScationSigner::VerifySignature<CMasternodePing>(mnp,mn.pubKeyMasternode,errorMessage))
             {
-                LogPrint("masternode", "%s - Got bad Masternode address signature %s (%s)\n",
+                LogPrint(LOG_MASTERNODE, "%s - Got bad Masternode address signature %s (%s)\n",
                          __func__, mnp.vin.prevout.hash, errorMessage);
                 nDoS = 33;
                 return false;
@@ -355,7 +364,7 @@ bool CMasternodeMan::CheckAndUpdatePing(CMasternode& mn, CMasternodePing& mnp, i
                 BlockMap::const_iterator mi = blockIndicesByHash_.find(mnp.blockHash);
                 if (mi != blockIndicesByHash_.end() && (*mi).second) {
                     if ((*mi).second->nHeight < activeChain_.Height() - 24) {
-                        LogPrint("masternode", "%s - Masternode %s block hash %s is too old\n",
+                        LogPrint(LOG_MASTERNODE, "%s - Masternode %s block hash %s is too old\n",
                                 __func__, mnp.vin.prevout.hash, mnp.blockHash);
                         // Do nothing here (no Masternode update, no mnping relay)
                         // Let this node to be visible but fail to accept mnping
@@ -363,7 +372,7 @@ bool CMasternodeMan::CheckAndUpdatePing(CMasternode& mn, CMasternodePing& mnp, i
                         return false;
                     }
                 } else {
-                    LogPrint("masternode", "%s - Masternode %s block hash %s is unknown\n",
+                    LogPrint(LOG_MASTERNODE, "%s - Masternode %s block hash %s is unknown\n",
                             __func__, mnp.vin.prevout.hash, mnp.blockHash);
                     // maybe we stuck so we shouldn't ban this node, just fail to accept it
                     // TODO: or should we also request this block?
@@ -377,16 +386,16 @@ bool CMasternodeMan::CheckAndUpdatePing(CMasternode& mn, CMasternodePing& mnp, i
             Check(mn,true);
             if (!mn.IsEnabled()) return false;
 
-            LogPrint("masternode", "%s - Masternode ping accepted, vin: %s\n",
+            LogPrint(LOG_MASTERNODE, "%s - Masternode ping accepted, vin: %s\n",
                      __func__, mnp.vin.prevout.hash);
             return true;
         }
-        LogPrint("masternode", "%s - Masternode ping arrived too early, vin: %s\n",
+        LogPrint(LOG_MASTERNODE, "%s - Masternode ping arrived too early, vin: %s\n",
                  __func__, mnp.vin.prevout.hash);
         //nDos = 1; //disable, this is happening frequently and causing banned peers
         return false;
     }
-    LogPrint("masternode", "%s - Couldn't find compatible Masternode entry, vin: %s\n",
+    LogPrint(LOG_MASTERNODE, "%s - Couldn't find compatible Masternode entry, vin: %s\n",
              __func__, mnp.vin.prevout.hash);
 
     return false;
@@ -406,25 +415,13 @@ int CMasternodeMan::CountEnabled() const
 
 CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 {
-    LOCK(cs);
-
-    BOOST_FOREACH (CMasternode& mn, networkMessageManager_.masternodes) {
-        if (mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    return networkMessageManager_.findMasternode(vin.prevout);
 }
 
 
 CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
-    LOCK(cs);
-
-    BOOST_FOREACH (CMasternode& mn, networkMessageManager_.masternodes) {
-        if (mn.pubKeyMasternode == pubKeyMasternode)
-            return &mn;
-    }
-    return NULL;
+    return networkMessageManager_.findMasternode(pubKeyMasternode);
 }
 
 //
@@ -433,20 +430,12 @@ CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 
 void CMasternodeMan::RecordSeenPing(const CMasternodePing& mnp)
 {
-    networkMessageManager_.mapSeenMasternodePing[mnp.GetHash()] = mnp;
-
-    const auto* pmn = Find(mnp.vin);
-    if (pmn != nullptr) {
-        const uint256 mnbHash = CMasternodeBroadcast(*pmn).GetHash();
-        auto mit = networkMessageManager_.mapSeenMasternodeBroadcast.find(mnbHash);
-        if (mit != networkMessageManager_.mapSeenMasternodeBroadcast.end())
-          mit->second.lastPing = mnp;
-    }
+    networkMessageManager_.recordPing(mnp);
 }
 
 bool CMasternodeMan::ProcessBroadcast(CActiveMasternode& localMasternode, CMasternodeSync& masternodeSynchronization,CNode* pfrom, CMasternodeBroadcast& mnb)
 {
-    if (networkMessageManager_.mapSeenMasternodeBroadcast.count(mnb.GetHash())) { //seen
+    if (networkMessageManager_.broadcastIsKnown(mnb.GetHash())) { //seen
         masternodeSynchronization.AddedMasternodeList(mnb.GetHash());
         return true;
     }
@@ -506,10 +495,10 @@ bool CMasternodeMan::ProcessBroadcast(CActiveMasternode& localMasternode, CMaste
         Remove(mnb.vin);
     }
 
-    LogPrint("masternode","mnb - Got NEW Masternode entry - %s - %lli \n", mnb.vin.prevout.hash, mnb.sigTime);
+    LogPrint(LOG_MASTERNODE,"mnb - Got NEW Masternode entry - %s - %lli \n", mnb.vin.prevout.hash, mnb.sigTime);
     Add(mn);
 
-    networkMessageManager_.mapSeenMasternodeBroadcast[mnb.GetHash()] = mnb;
+    networkMessageManager_.recordBroadcast(mnb);
     RecordSeenPing(mnb.lastPing);
 
     // if it matches our Masternode privkey, then we've been remotely activated
@@ -526,7 +515,7 @@ bool CMasternodeMan::ProcessBroadcast(CActiveMasternode& localMasternode, CMaste
 
 bool CMasternodeMan::ProcessPing(CNode* pfrom, CMasternodePing& mnp, CMasternodeSync& masternodeSynchronization)
 {
-    if (networkMessageManager_.mapSeenMasternodePing.count(mnp.GetHash())) return true; //seen
+    if (networkMessageManager_.pingIsKnown(mnp.GetHash())) return true; //seen
 
     auto* pmn = Find(mnp.vin);
     int nDoS = 0;
@@ -562,25 +551,46 @@ bool CMasternodeMan::NotifyPeerOfMasternode(const CMasternode& mn, CNode* peer)
         CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
         const uint256 hash = mnb.GetHash();
         peer->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
-        if (!networkMessageManager_.mapSeenMasternodeBroadcast.count(hash)) networkMessageManager_.mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
+        CMasternodeBroadcast knownBroadcast;
+        if (!networkMessageManager_.getKnownBroadcast(hash, knownBroadcast)) networkMessageManager_.recordBroadcast(mnb);
         return true;
     }
     return false;
 }
-void CMasternodeMan::SyncMasternodeListWithPeer(CNode* peer)
+bool CMasternodeMan::NotifyPeerOfMasternodePing(const CMasternode& mn, CNode* peer)
+{
+    if (!mn.addr.IsRFC1918() && mn.IsEnabled() && mn.lastPing != CMasternodePing())
+    {
+        const uint256 hash = mn.lastPing.GetHash();
+        peer->PushInventory(CInv(MSG_MASTERNODE_PING, hash));
+        CMasternodePing knownPing;
+        if (!networkMessageManager_.getKnownPing(hash, knownPing)) networkMessageManager_.recordPing(mn.lastPing);
+        return true;
+    }
+    return false;
+}
+void CMasternodeMan::SyncMasternodeListWithPeer(CNode* peer, int64_t nChangedSince)
 {
     LOCK(cs);
     int nInvCount = 0;
     for (const CMasternode& mn: networkMessageManager_.masternodes)
     {
+        // Masternodes announced before the peer's list was last up to date only need their latest ping,
+        // and a peer that does not know one of them asks for its entry once it sees the ping
+        if (mn.sigTime < nChangedSince)
+        {
+            if (mn.lastPing.sigTime >= nChangedSince && NotifyPeerOfMasternodePing(mn,peer))
+                nInvCount++;
+            continue;
+        }
         if (NotifyPeerOfMasternode(mn,peer))
         {
-            LogPrint("masternode", "dseg - Sending Masternode entry - %s \n", mn.vin.prevout.hash);
+            LogPrint(LOG_MASTERNODE, "dseg - Sending Masternode entry - %s \n", mn.vin.prevout.hash);
             nInvCount++;
         }
     }
     peer->PushMessage("ssc", MASTERNODE_SYNC_LIST, nInvCount);
-    LogPrint("masternode", "dseg - Sent %d Masternode entries to peer %i\n", nInvCount, peer->GetId());
+    LogPrint(LOG_MASTERNODE, "dseg - Sent %d Masternode entries to peer %i\n", nInvCount, peer->GetId());
 }
 bool CMasternodeMan::HasRequestedMasternodeSyncTooOften(CNode* pfrom)
 {
@@ -612,24 +622,28 @@ void CMasternodeMan::ProcessMessage(CActiveMasternode& localMasternode,CMasterno
         CMasternodePing mnp;
         vRecv >> mnp;
 
-        LogPrint("masternode", "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash);
+        LogPrint(LOG_MASTERNODE, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash);
         if (!ProcessPing(pfrom, mnp, masternodeSynchronization))
             return;
     } else if (strCommand == "dseg") { //Get Masternode list or specific entry
 
         CTxIn vin;
         vRecv >> vin;
+        // Optionally followed by the time since which the peer wants the changes to the list
+        int64_t nChangedSince = 0;
+        if (!vRecv.empty())
+            vRecv >> nChangedSince;
 
         bool peerIsRequestingMasternodeListSync = vin == CTxIn();
         if (peerIsRequestingMasternodeListSync && !HasRequestedMasternodeSyncTooOften(pfrom)) { //only should ask for this once
-            SyncMasternodeListWithPeer(pfrom);
+            SyncMasternodeListWithPeer(pfrom, nChangedSince);
         }
         else if(!peerIsRequestingMasternodeListSync)
         {
             CMasternode* pmn = Find(vin);
             if(pmn != nullptr && NotifyPeerOfMasternode(*pmn,pfrom) )
             {
-                LogPrint("masternode", "dseg - Sent 1 Masternode entry to peer %i\n", pfrom->GetId());
+                LogPrint(LOG_MASTERNODE, "dseg - Sent 1 Masternode entry to peer %i\n", pfrom->GetId());
                 return;
             }
         }
@@ -640,14 +654,10 @@ void CMasternodeMan::Remove(const CTxIn& vin)
 {
     LOCK(cs);
 
-    std::vector<CMasternode>::iterator it = networkMessageManager_.masternodes.begin();
-    while (it != networkMessageManager_.masternodes.end()) {
-        if ((*it).vin == vin) {
-            LogPrint("masternode", "CMasternodeMan: Removing Masternode %s - %i now\n", (*it).vin.prevout.hash, networkMessageManager_.masternodeCount() - 1);
-            networkMessageManager_.masternodes.erase(it);
-            break;
-        }
-        ++it;
+    CMasternode* pmn = Find(vin);
+    if (pmn != nullptr && pmn->vin == vin) {
+        LogPrint(LOG_MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", vin.prevout.hash, networkMessageManager_.masternodeCount() - 1);
+        networkMessageManager_.removeMasternode(vin.prevout);
     }
 }
 
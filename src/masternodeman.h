@@ -40,9 +40,12 @@ private:
 
     bool Add(const CMasternode& mn);
     bool NotifyPeerOfMasternode(const CMasternode& mn, CNode* peer);
-    void SyncMasternodeListWithPeer(CNode* peer);
+    bool NotifyPeerOfMasternodePing(const CMasternode& mn, CNode* peer);
+    //! Only the masternodes announced or pinged since nChangedSince are sent, all of them if it is 0
+    void SyncMasternodeListWithPeer(CNode* peer, int64_t nChangedSince);
     bool HasRequestedMasternodeSyncTooOften(CNode* pfrom);
     void Remove(const CTxIn& vin);
+    void UpdateActiveState(CMasternode& mn);
 
     bool UpdateWithNewBroadcast(const CMasternodeBroadcast &mnb, CMasternode& masternode) const;
     bool CheckInputsForMasternode(const CMasternodeBroadcast& mnb, int& nDoS);
@@ -92,7 +95,7 @@ public:
     bool ProcessBroadcast(CActiveMasternode& localMasternode, CMasternodeSync& masternodeSynchronization, CNode* pfrom, CMasternodeBroadcast& mnb);
 
     /** Processes a masternode ping.  It is verified first, and if valid,
-     *  used to update our state and inserted into mapSeenMasternodePing.
+     *  used to update our state and recorded as seen.
      *
      *  If pfrom is null, we assume this is from a local RPC command.  Otherwise
      *  we apply potential DoS banscores.
@@ -6,6 +6,8 @@
 
 #include "merkleblock.h"
 
+#include "FilterableBlock.h"
+#include "crypto/sha256.h"
 #include "hash.h"
 #include "primitives/block.h" // for MAX_BLOCK_SIZE
 #include "utilstrencodings.h"
@@ -35,25 +37,26 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
     txn = CPartialMerkleTree(vHashes, vMatch);
 }
 
-uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid)
+CMerkleBlock::CMerkleBlock(const FilterableBlock& block, CBloomFilter& filter)
 {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
-        return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+    header = block.GetHeader();
+
+    const std::vector<FilterableTransaction>& transactions = block.GetTransactions();
+    std::vector<bool> vMatch;
+    vMatch.reserve(transactions.size());
+
+    for (unsigned int i = 0; i < transactions.size(); i++) {
+        if (filter.IsRelevantAndUpdate(transactions[i])) {
+            vMatch.push_back(true);
+            vMatchedTxn.push_back(std::make_pair(i, transactions[i].hash));
+        } else
+            vMatch.push_back(false);
     }
+
+    txn = CPartialMerkleTree(block.GetMerkleTreeLevels(), vMatch);
 }
 
-void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch)
+void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<std::vector<uint256> >& vTreeLevels, const std::vector<bool>& vMatch)
 {
     // determine whether this node is the parent of at least one matched txid
     bool fParentOfMatch = false;
@@ -63,12 +66,12 @@ void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const st
     vBits.push_back(fParentOfMatch);
     if (height == 0 || !fParentOfMatch) {
         // if at height 0, or nothing interesting below, store hash and stop
-        vHash.push_back(CalcHash(height, pos, vTxid));
+        vHash.push_back(vTreeLevels[height][pos]);
     } else {
         // otherwise, don't store any hash, but descend into the subtrees
-        TraverseAndBuild(height - 1, pos * 2, vTxid, vMatch);
+        TraverseAndBuild(height - 1, pos * 2, vTreeLevels, vMatch);
         if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            TraverseAndBuild(height - 1, pos * 2 + 1, vTxid, vMatch);
+            TraverseAndBuild(height - 1, pos * 2 + 1, vTreeLevels, vMatch);
     }
 }
 
@@ -104,6 +107,16 @@ uint256 CPartialMerkleTree::TraverseAndExtract(int height, unsigned int pos, uns
 }
 
 CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch) : nTransactions(vTxid.size()), fBad(false)
+{
+    Build(CalcTreeLevels(vTxid), vMatch);
+}
+
+CPartialMerkleTree::CPartialMerkleTree(const std::vector<std::vector<uint256> >& vTreeLevels, const std::vector<bool>& vMatch) : nTransactions(vTreeLevels[0].size()), fBad(false)
+{
+    Build(vTreeLevels, vMatch);
+}
+
+void CPartialMerkleTree::Build(const std::vector<std::vector<uint256> >& vTreeLevels, const std::vector<bool>& vMatch)
 {
     // reset state
     vBits.clear();
@@ -115,7 +128,25 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256>& vTxid, const
         nHeight++;
 
     // traverse the partial tree
-    TraverseAndBuild(nHeight, 0, vTxid, vMatch);
+    TraverseAndBuild(nHeight, 0, vTreeLevels, vMatch);
+}
+
+std::vector<std::vector<uint256> > CPartialMerkleTree::CalcTreeLevels(const std::vector<uint256>& vTxid)
+{
+    std::vector<std::vector<uint256> > vTreeLevels(1, vTxid);
+    // each level pairs up the nodes below, the last one with itself if it has no partner
+    while (vTreeLevels.back().size() > 1) {
+        const std::vector<uint256>& vBelow = vTreeLevels.back();
+        std::vector<uint256> vLevel((vBelow.size() + 1) / 2);
+        const size_t nPairs = vBelow.size() / 2;
+        SHA256D64(vLevel[0].begin(), vBelow[0].begin(), nPairs);
+        if (vBelow.size() % 2) {
+            const uint256& last = vBelow.back();
+            vLevel.back() = Hash(BEGIN(last), END(last), BEGIN(last), END(last));
+        }
+        vTreeLevels.push_back(vLevel);
+    }
+    return vTreeLevels;
 }
 
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
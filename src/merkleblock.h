@@ -13,6 +13,8 @@
 
 #include <vector>
 
+class FilterableBlock;
+
 /** Data structure that represents a partial merkle tree.
  *
  * It represents a subset of the txid's of a known block, in a way that
@@ -68,11 +70,10 @@ protected:
         return (nTransactions + (1 << height) - 1) >> height;
     }
 
-    /** calculate the hash of a node in the merkle tree (at leaf level: the txid's themselves) */
-    uint256 CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid);
-
     /** recursive function that traverses tree nodes, storing the data as bits and hashes */
-    void TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch);
+    void TraverseAndBuild(int height, unsigned int pos, const std::vector<std::vector<uint256> >& vTreeLevels, const std::vector<bool>& vMatch);
+
+    void Build(const std::vector<std::vector<uint256> >& vTreeLevels, const std::vector<bool>& vMatch);
 
     /**
      * recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
@@ -107,6 +108,8 @@ public:
 
     /** Construct a partial merkle tree from a list of transaction id's, and a mask that selects a subset of them */
     CPartialMerkleTree(const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch);
+    /** As above, from the whole merkle tree as CalcTreeLevels returns it */
+    CPartialMerkleTree(const std::vector<std::vector<uint256> >& vTreeLevels, const std::vector<bool>& vMatch);
 
     CPartialMerkleTree();
 
@@ -115,6 +118,9 @@ public:
      * returns the merkle root, or 0 in case of failure
      */
     uint256 ExtractMatches(std::vector<uint256>& vMatch);
+
+    /** the hashes of the merkle tree by height, starting with the txid's, so each is only calculated once */
+    static std::vector<std::vector<uint256> > CalcTreeLevels(const std::vector<uint256>& vTxid);
 };
 
 
@@ -139,6 +145,8 @@ public:
      * thus the filter will likely be modified.
      */
     CMerkleBlock(const CBlock& block, CBloomFilter& filter);
+    /** As above, from a block prepared once for the filters of many peers */
+    CMerkleBlock(const FilterableBlock& block, CBloomFilter& filter);
 
     ADD_SERIALIZE_METHODS;
 
@@ -47,6 +47,31 @@ void CMerkleTx::Init()
     hashBlock = 0;
     nIndex = -1;
     fMerkleVerified = false;
+    nBlockHeightHint_ = -1;
+}
+
+/**
+ * The block of hashBlock if it is in the active chain. Wallets ask for the depth
+ * of the same transactions again and again, so the height the block was found at
+ * is remembered and the chain entry at that height is compared with hashBlock
+ * before the block index is searched. A reorganization replacing the block, or a
+ * change of hashBlock, fails the comparison without anything to invalidate.
+ */
+const CBlockIndex* CMerkleTx::FindBlockInActiveChain() const
+{
+    AssertLockHeld(cs_main);
+    const CBlockIndex* pindex = activeChain_[nBlockHeightHint_];
+    if (pindex && pindex->GetBlockHash() == hashBlock)
+        return pindex;
+
+    BlockMap::const_iterator mi = blockIndices_.find(hashBlock);
+    if (mi == blockIndices_.end())
+        return NULL;
+    pindex = (*mi).second;
+    if (!pindex || !activeChain_.Contains(pindex))
+        return NULL;
+    nBlockHeightHint_ = pindex->nHeight;
+    return pindex;
 }
 
 int CMerkleTx::GetNumberOfBlockConfirmations() const
@@ -81,11 +106,8 @@ int CMerkleTx::SetMerkleBranch(const CBlock& block)
 
     // Is the tx in a block that's in the main chain
     LOCK(cs_main);
-    BlockMap::const_iterator mi = blockIndices_.find(hashBlock);
-    if (mi == blockIndices_.end())
-        return 0;
-    const CBlockIndex* pindex = (*mi).second;
-    if (!pindex || !activeChain_.Contains(pindex))
+    const CBlockIndex* pindex = FindBlockInActiveChain();
+    if (!pindex)
         return 0;
 
     return activeChain_.Height() - pindex->nHeight + 1;
@@ -98,14 +120,11 @@ int CMerkleTx::GetNumberOfBlockConfirmationsINTERNAL(const CBlockIndex*& pindexR
 
     // Find the block it claims to be in
     unsigned bestHeight;
-    CBlockIndex* pindex;
+    const CBlockIndex* pindex;
     {
         LOCK(cs_main);
-        BlockMap::const_iterator mi = blockIndices_.find(hashBlock);
-        if (mi == blockIndices_.end())
-            return 0;
-        pindex = (*mi).second;
-        if (!pindex || !activeChain_.Contains(pindex))
+        pindex = FindBlockInActiveChain();
+        if (!pindex)
             return 0;
         bestHeight = activeChain_.Height();
     }
@@ -15,6 +15,10 @@ protected:
     const CChain& activeChain_;
     const BlockMap& blockIndices_;
 private:
+    //! Height at which hashBlock was last found in the active chain, -1 before it was; only a hint, checked against the chain on use
+    mutable int nBlockHeightHint_;
+
+    const CBlockIndex* FindBlockInActiveChain() const;
     int GetNumberOfBlockConfirmationsINTERNAL(const CBlockIndex*& pindexRet) const;
 
 public:
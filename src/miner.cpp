@@ -22,7 +22,11 @@
 #include <chain.h>
 #include <map>
 #include <FeeAndPriorityCalculator.h>
+#include <StakingStatistics.h>
+#include <MintingWakeup.h>
+#include <wallet.h>
 
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 
@@ -32,12 +36,26 @@ extern CChain chainActive;
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
 extern BlockMap mapBlockIndex;
+void RegisterValidationInterface(NotificationInterface* pwalletIn);
+void UnregisterValidationInterface(NotificationInterface* pwalletIn);
 
 LastExtensionTimestampByBlockHeight& getLastExtensionTimestampByBlockHeight()
 {
     static std::map<unsigned int, unsigned int> mapHashedBlocks;
     return mapHashedBlocks;
 }
+
+StakingStatistics& GetStakingStatistics()
+{
+    static StakingStatistics stakingStatistics;
+    return stakingStatistics;
+}
+
+MintingWakeup& GetMintingWakeup()
+{
+    static MintingWakeup mintingWakeup;
+    return mintingWakeup;
+}
 //////////////////////////////////////////////////////////////////////////////
 //
 // IZZYMiner
@@ -112,6 +130,11 @@ void ThreadStakeMinter(CWallet* pwallet)
     static LastExtensionTimestampByBlockHeight& mapHashedBlocks = getLastExtensionTimestampByBlockHeight();
     boost::this_thread::interruption_point();
     LogPrintf("ThreadStakeMinter started\n");
+    // Wait between attempts on new tips and wallet changes instead of a fixed sleep
+    MintingWakeup& mintingWakeup = GetMintingWakeup();
+    RegisterValidationInterface(&mintingWakeup);
+    boost::signals2::connection walletChanges = pwallet->NotifyTransactionChanged.connect(
+        boost::bind(&MintingWakeup::NotifyWalletTransactionChanged, &mintingWakeup, _1, _2, _3));
     try {
         static CoinMintingModule mintingModule(
             settings,
@@ -125,6 +148,8 @@ void ThreadStakeMinter(CWallet* pwallet)
             vNodes,
             *pwallet,
             mapHashedBlocks,
+            GetStakingStatistics(),
+            GetMintingWakeup(),
             mapBlockIndex,
             sporkManager);
         static I_CoinMinter& minter = mintingModule.coinMinter();
@@ -137,6 +162,8 @@ void ThreadStakeMinter(CWallet* pwallet)
     } catch (...) {
         LogPrintf("ThreadStakeMinter() error \n");
     }
+    walletChanges.disconnect();
+    UnregisterValidationInterface(&mintingWakeup);
     LogPrintf("ThreadStakeMinter exiting,\n");
 }
 
@@ -159,6 +186,8 @@ void static ThreadPoWMinter(CWallet* pwallet,bool fGenerate)
             vNodes,
             *pwallet,
             mapHashedBlocks,
+            GetStakingStatistics(),
+            GetMintingWakeup(),
             mapBlockIndex,
             sporkManager);
         static I_CoinMinter& minter = mintingModule.coinMinter();
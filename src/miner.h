@@ -15,6 +15,8 @@ class CBlockIndex;
 class CScript;
 class CWallet;
 class I_CoinMinter;
+class StakingStatistics;
+class MintingWakeup;
 
 struct CBlockTemplate;
 
@@ -31,5 +33,7 @@ bool HasRecentlyAttemptedToGenerateProofOfStake();
 
 typedef std::map<unsigned int, unsigned int> LastExtensionTimestampByBlockHeight;
 LastExtensionTimestampByBlockHeight& getLastExtensionTimestampByBlockHeight();
+StakingStatistics& GetStakingStatistics();
+MintingWakeup& GetMintingWakeup();
 
 #endif // BITCOIN_MINER_H
@@ -14,6 +14,7 @@
 #include "addrman.h"
 #include "chainparams.h"
 #include "clientversion.h"
+#include "memusage.h"
 #include "miner.h"
 #include "obfuscation.h"
 #include "primitives/transaction.h"
@@ -30,11 +31,14 @@
 #include <ThreadManagementHelpers.h>
 #include <version.h>
 #include <uiMessenger.h>
+#include <SocketPoller.h>
+#include <defaultValues.h>
 
 #ifdef WIN32
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_UPNP
@@ -44,7 +48,12 @@
 #include <miniupnpc/upnperrors.h>
 #endif
 
+#include <atomic>
+#include <math.h>
+#include <memory>
+
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 
 
@@ -107,13 +116,14 @@ static std::vector<ListenSocket> vhListenSocket;
 CAddrMan addrman;
 int nMaxConnections = 125;
 bool fAddressesInitialized = false;
+//! Set once peers.dat and anchors.dat were read, which startup may do before the node is started
+static bool fPeerAddressesLoaded = false;
 
 std::vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
+map<CInv, CTransactionRef> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
-limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 
 static deque<string> vOneShots;
 CCriticalSection cs_vOneShots;
@@ -128,8 +138,18 @@ NodeId nLastNodeId = 0;
 CCriticalSection cs_nLastNodeId;
 
 static CSemaphore* semOutbound = NULL;
+static std::vector<CAddress> vAnchors;
+static CCriticalSection cs_vAnchors;
 boost::condition_variable messageHandlerCondition;
 
+//! Large receive buffers kept in the pools of all of the peers together
+static std::atomic<int> nPooledLargeReceiveBuffers(0);
+
+static bool IsLargeReceiveBuffer(const CNetMessage& msg)
+{
+    return msg.vRecv.capacity() > LARGE_RECEIVE_BUFFER_SIZE;
+}
+
 // Signals for message handling
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
@@ -223,12 +243,12 @@ bool RecvLine(SOCKET hSocket, string& strLine)
                 return true;
             if (nBytes == 0) {
                 // socket closed
-                LogPrint("net", "socket closed\n");
+                LogPrint(LOG_NET, "socket closed\n");
                 return false;
             } else {
                 // socket error
                 int nErr = WSAGetLastError();
-                LogPrint("net", "recv failed: %s\n", NetworkErrorString(nErr));
+                LogPrint(LOG_NET, "recv failed: %s\n", NetworkErrorString(nErr));
                 return false;
             }
         }
@@ -382,6 +402,10 @@ uint64_t CNode::nTotalBytesRecv = 0;
 uint64_t CNode::nTotalBytesSent = 0;
 CCriticalSection CNode::cs_totalBytesRecv;
 CCriticalSection CNode::cs_totalBytesSent;
+UploadBudget CNode::totalUploadBudget;
+int64_t CNode::nPeerUploadRate = 0;
+uint64_t CNode::nHistoricalBytesSent = 0;
+uint64_t CNode::nDeferredHistoricalRequests = 0;
 
 CNode* FindNode(const CNetAddr& ip)
 {
@@ -436,7 +460,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool obfuScationMa
     }
 
     /// debug print
-    LogPrint("net", "trying connection %s lastseen=%.1fhrs\n",
+    LogPrint(LOG_NET, "trying connection %s lastseen=%.1fhrs\n",
         pszDest ? pszDest : addrConnect.ToString(),
         pszDest ? 0.0 : (double)(GetAdjustedTime() - addrConnect.nTime) / 3600.0);
 
@@ -445,7 +469,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool obfuScationMa
     bool proxyConnectionFailed = false;
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed)) {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!SocketPollerScalesPastFdSetSize() && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -479,14 +503,14 @@ void CNode::CloseSocketDisconnect()
 {
     fDisconnect = true;
     if (hSocket != INVALID_SOCKET) {
-        LogPrint("net", "disconnecting peer=%d\n", id);
+        LogPrint(LOG_NET, "disconnecting peer=%d\n", id);
         CloseSocket(hSocket);
     }
 
     // in case this fails, we'll empty the recv buffer when the CNode is deleted
     TRY_LOCK(cs_vRecvMsg, lockRecv);
     if (lockRecv)
-        vRecvMsg.clear();
+        ClearReceivedMessages();
 }
 
 bool CNode::DisconnectOldProtocol(int nVersionRequired, string strLastCommand)
@@ -512,9 +536,9 @@ void CNode::PushVersion()
     CAddress addrMe = GetLocalAddress(&addr);
     GetRandBytes((unsigned char*)&nLocalHostNonce, sizeof(nLocalHostNonce));
     if (ShouldLogPeerIPs())
-        LogPrint("net", "send version message: version %d, blocks=%d, us=%s, them=%s, peer=%d\n", PROTOCOL_VERSION, nBestHeight, addrMe, addrYou, id);
+        LogPrint(LOG_NET, "send version message: version %d, blocks=%d, us=%s, them=%s, peer=%d\n", PROTOCOL_VERSION, nBestHeight, addrMe, addrYou, id);
     else
-        LogPrint("net", "send version message: version %d, blocks=%d, us=%s, peer=%d\n", PROTOCOL_VERSION, nBestHeight, addrMe, id);
+        LogPrint(LOG_NET, "send version message: version %d, blocks=%d, us=%s, peer=%d\n", PROTOCOL_VERSION, nBestHeight, addrMe, id);
     PushMessage("version", PROTOCOL_VERSION, nLocalServices, nTime, addrYou, addrMe,
                 nLocalHostNonce, FormatSubVersion(std::vector<std::string>()), nBestHeight, true);
 }
@@ -649,6 +673,48 @@ void CNode::AddWhitelistedRange(const CSubNet& subnet)
     vWhitelistedRange.push_back(subnet);
 }
 
+std::vector<CSubNet> CNode::vCompressedRange;
+CCriticalSection CNode::cs_vCompressedRange;
+std::atomic<bool> CNode::fCompressWhitelisted(false);
+
+bool CNode::IsCompressedRange(const CNetAddr& addr)
+{
+    LOCK(cs_vCompressedRange);
+    BOOST_FOREACH (const CSubNet& subnet, vCompressedRange) {
+        if (subnet.Match(addr))
+            return true;
+    }
+    return false;
+}
+
+void CNode::AddCompressedRange(const CSubNet& subnet)
+{
+    LOCK(cs_vCompressedRange);
+    vCompressedRange.push_back(subnet);
+}
+
+void CNode::SetCompressWhitelisted(bool fCompress)
+{
+    fCompressWhitelisted = fCompress;
+}
+
+bool CNode::CompressionAllowed() const
+{
+    if (!NetworkStreamCompressor::IsSupported())
+        return false;
+    return (fWhitelisted && fCompressWhitelisted) || IsCompressedRange(addr);
+}
+
+void CNode::StartSendCompression()
+{
+    LOCK(cs_vSend);
+    if (sendCompressor)
+        return;
+    PushMessage("compress");
+    sendCompressor.reset(new NetworkStreamCompressor());
+    LogPrint(LOG_NET, "compressing what is sent to peer=%d\n", id);
+}
+
 #undef X
 #define X(name) stats.name = name
 void CNode::copyStats(CNodeStats& stats)
@@ -684,17 +750,44 @@ void CNode::copyStats(CNodeStats& stats)
 
     // Leave string empty if addrLocal invalid (not filled in yet)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
+
+    LOCK(cs_stateStats);
+    stats.fStateStats = fStateStatsPublished;
+    stats.stateStats = stateStats;
 }
 #undef X
 
+void CNode::PublishStateStats(const CNodeStateStats& stats)
+{
+    LOCK(cs_stateStats);
+    stateStats = stats;
+    fStateStatsPublished = true;
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes)
+{
+    if (recvDecompressor)
+        return recvDecompressor->Decompress(pch, nBytes, boost::bind(&CNode::ReceivePlainMsgBytes, this, _1, _2));
+    return ReceivePlainMsgBytes(pch, nBytes);
+}
+
+bool CNode::ReceivePlainMsgBytes(const char* pch, size_t nBytes)
 {
     while (nBytes > 0) {
-        // get current incomplete message, or create a new one
+        // get current incomplete message, or start one in a recycled buffer
         if (vRecvMsg.empty() ||
-            vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(SER_NETWORK, nRecvVersion));
+            vRecvMsg.back().complete()) {
+            if (vRecvMsgPool.empty()) {
+                vRecvMsg.push_back(CNetMessage(SER_NETWORK, nRecvVersion));
+            } else {
+                if (IsLargeReceiveBuffer(vRecvMsgPool.back()))
+                    --nPooledLargeReceiveBuffers;
+                vRecvMsg.push_back(std::move(vRecvMsgPool.back()));
+                vRecvMsgPool.pop_back();
+                vRecvMsg.back().Reset(nRecvVersion);
+            }
+        }
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -709,7 +802,7 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes)
             return false;
 
         if (msg.in_data && msg.hdr.nMessageSize > MAX_PROTOCOL_MESSAGE_LENGTH) {
-            LogPrint("net", "Oversized message from peer=%i, disconnecting", GetId());
+            LogPrint(LOG_NET, "Oversized message from peer=%i, disconnecting", GetId());
             return false;
         }
 
@@ -718,13 +811,79 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            messageHandlerCondition.notify_all();
+
+            // Whatever the peer sends after its "compress" message is compressed, down to the rest of these bytes
+            if (!recvDecompressor && msg.hdr.GetCommand() == "compress") {
+                if (!fAcceptCompressed) {
+                    LogPrint(LOG_NET, "Compressed messages from peer=%i that was not asked to send them, disconnecting\n", GetId());
+                    return false;
+                }
+                recvDecompressor.reset(new NetworkStreamDecompressor());
+                return ReceiveMsgBytes(pch, nBytes);
+            }
         }
     }
 
     return true;
 }
 
+void CNode::RecycleReceivedMessages(std::deque<CNetMessage>::iterator end)
+{
+    for (std::deque<CNetMessage>::iterator it = vRecvMsg.begin(); it != end; ++it) {
+        if (vRecvMsgPool.size() >= MAX_POOLED_RECEIVE_MESSAGES)
+            break;
+        if (IsLargeReceiveBuffer(*it) && nPooledLargeReceiveBuffers.fetch_add(1) >= MAX_POOLED_LARGE_RECEIVE_BUFFERS) {
+            --nPooledLargeReceiveBuffers;
+            continue;
+        }
+        vRecvMsgPool.push_back(std::move(*it));
+    }
+    vRecvMsg.erase(vRecvMsg.begin(), end);
+}
+
+size_t CNode::BufferMemoryUsage()
+{
+    size_t usage = 0;
+    {
+        LOCK(cs_vSend);
+        usage += memusage::MallocUsage(ssSend.capacity()) + memusage::MallocUsage(sizeof(std::vector<char>)) * vSendMsg.size();
+        BOOST_FOREACH (const std::vector<char>& msg, vSendMsg)
+            usage += memusage::DynamicUsage(msg);
+    }
+    LOCK(cs_vRecvMsg);
+    usage += memusage::MallocUsage(sizeof(CNetMessage)) * vRecvMsg.size() + memusage::DynamicUsage(vRecvMsgPool);
+    BOOST_FOREACH (const CNetMessage& msg, vRecvMsg)
+        usage += memusage::MallocUsage(msg.hdrbuf.capacity()) + memusage::MallocUsage(msg.vRecv.capacity());
+    BOOST_FOREACH (const CNetMessage& msg, vRecvMsgPool)
+        usage += memusage::MallocUsage(msg.hdrbuf.capacity()) + memusage::MallocUsage(msg.vRecv.capacity());
+    return usage;
+}
+
+void CNode::ClearReceivedMessages()
+{
+    vRecvMsg.clear();
+    BOOST_FOREACH (const CNetMessage& msg, vRecvMsgPool) {
+        if (IsLargeReceiveBuffer(msg))
+            --nPooledLargeReceiveBuffers;
+    }
+    vRecvMsgPool.clear();
+}
+
+void CNetMessage::Reset(int nVersionIn)
+{
+    hdrbuf.clear();
+    hdrbuf.resize(24);
+    hdr = CMessageHeader();
+    nHdrPos = 0;
+    in_data = false;
+    vRecv.clear();
+    nDataPos = 0;
+    nTime = 0;
+    fPrevalidated = false;
+    SetVersion(nVersionIn);
+}
+
 int CNetMessage::readHeader(const char* pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -772,26 +931,74 @@ int CNetMessage::readData(const char* pch, unsigned int nBytes)
 }
 
 
+/**
+ * Hands as many of the queued messages to the socket as one call takes,
+ * starting at the given offset into the first one, and sets how many bytes
+ * were offered.
+ */
+static int SendQueuedMessages(
+    SOCKET hSocket,
+    std::deque<std::vector<char> >::const_iterator it,
+    std::deque<std::vector<char> >::const_iterator end,
+    size_t nOffset,
+    size_t& nOffered)
+{
+#ifdef WIN32
+    nOffered = it->size() - nOffset;
+    return send(hSocket, &(*it)[nOffset], nOffered, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+#if defined(IOV_MAX)
+    const int nMaxBuffers = std::min(MAX_SEND_BUFFERS_PER_CALL, static_cast<int>(IOV_MAX));
+#else
+    const int nMaxBuffers = MAX_SEND_BUFFERS_PER_CALL;
+#endif
+    struct iovec buffers[MAX_SEND_BUFFERS_PER_CALL];
+    int nBuffers = 0;
+    nOffered = 0;
+    for (; it != end && nBuffers < nMaxBuffers; ++it) {
+        buffers[nBuffers].iov_base = const_cast<char*>(&(*it)[nOffset]);
+        buffers[nBuffers].iov_len = it->size() - nOffset;
+        nOffered += buffers[nBuffers].iov_len;
+        nOffset = 0;
+        nBuffers++;
+    }
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = buffers;
+    message.msg_iovlen = nBuffers;
+    return sendmsg(hSocket, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+}
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode* pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<std::vector<char> >::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData& data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        assert(it->size() > pnode->nSendOffset);
+        size_t nOffered = 0;
+        int nBytes = SendQueuedMessages(pnode->hSocket, it, pnode->vSendMsg.end(), pnode->nSendOffset, nOffered);
         if (nBytes > 0) {
             pnode->nLastSend = GetTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
-            if (pnode->nSendOffset == data.size()) {
+            // Move past the messages that went out in full
+            size_t nSent = nBytes;
+            while (nSent > 0) {
+                const size_t nRemaining = it->size() - pnode->nSendOffset;
+                if (nSent < nRemaining) {
+                    pnode->nSendOffset += nSent;
+                    break;
+                }
+                nSent -= nRemaining;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            if (static_cast<size_t>(nBytes) < nOffered) {
+                // could not send everything offered; stop sending more
                 break;
             }
         } else {
@@ -820,6 +1027,9 @@ static list<CNode*> vNodesDisconnected;
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    std::unique_ptr<I_SocketPoller> poller = CreateSocketPoller();
+    std::vector<I_SocketPoller::PolledSocket> polledSockets;
+    I_SocketPoller::ReadySockets readySockets;
     while (true) {
         //
         // Disconnect nodes
@@ -885,23 +1095,12 @@ void ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        const int nTimeoutMilliseconds = 50; // frequency to poll pnode->vSend
 
-        BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+        polledSockets.clear();
+        for (size_t i = 0; i < vhListenSocket.size(); i++) {
+            polledSockets.push_back(
+                I_SocketPoller::PolledSocket(vhListenSocket[i].socket, -1 - static_cast<int64_t>(i), I_SocketPoller::POLL_RECEIVE));
         }
 
         {
@@ -909,18 +1108,15 @@ void ThreadSocketHandler()
             BOOST_FOREACH (CNode* pnode, vNodes) {
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
 
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, poll for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
                 // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
+                //   or there is space left in the buffer, poll for receiving data.
                 // * (if neither of the above applies, there is certainly one message
                 //   in the receiver buffer ready to be processed).
                 // Together, that means that at least one of the following is always possible,
@@ -928,43 +1124,44 @@ void ThreadSocketHandler()
                 // * We send some data.
                 // * We wait for data to be received (and disconnect after timeout).
                 // * We process a message in the buffer (message handler thread).
+                // The poller only passes on the sockets whose interest changed.
+                unsigned interest = I_SocketPoller::POLL_ERRORS;
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
+                    if (lockSend && !pnode->vSendMsg.empty())
+                        interest = I_SocketPoller::POLL_SEND;
                 }
-                {
+                if (interest == I_SocketPoller::POLL_ERRORS) {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                     if (lockRecv && (pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
                                         pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
+                        interest = I_SocketPoller::POLL_RECEIVE;
                 }
+                polledSockets.push_back(I_SocketPoller::PolledSocket(pnode->hSocket, pnode->id, interest));
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-            &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        poller->Update(polledSockets);
+        const bool fPolled = poller->Wait(nTimeoutMilliseconds, readySockets);
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
+        if (!fPolled) {
+            readySockets.clear();
+            if (!polledSockets.empty()) {
                 int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
+                LogPrintf("socket poll error %s\n", NetworkErrorString(nErr));
+                BOOST_FOREACH (const I_SocketPoller::PolledSocket& polledSocket, polledSockets)
+                    readySockets[polledSocket.socket].receive = true;
             }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
+            MilliSleep(nTimeoutMilliseconds);
         }
 
         //
         // Accept new connections
         //
         BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv)) {
+            I_SocketPoller::ReadySockets::const_iterator ready = readySockets.find(hListenSocket.socket);
+            if (hListenSocket.socket != INVALID_SOCKET && ready != readySockets.end() && ready->second.receive) {
                 struct sockaddr_storage sockaddr;
                 socklen_t len = sizeof(sockaddr);
                 SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
@@ -987,11 +1184,11 @@ void ThreadSocketHandler()
                     int nErr = WSAGetLastError();
                     if (nErr != WSAEWOULDBLOCK)
                         LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
-                } else if (!IsSelectableSocket(hSocket)) {
+                } else if (!poller->CanPoll(hSocket)) {
                     LogPrintf("connection from %s dropped: non-selectable socket\n", addr);
                     CloseSocket(hSocket);
                 } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
-                    LogPrint("net", "connection from %s dropped (full)\n", addr);
+                    LogPrint(LOG_NET, "connection from %s dropped (full)\n", addr);
                     CloseSocket(hSocket);
                 } else if (CNode::IsBanned(addr) && !whitelisted) {
                     LogPrintf("connection from %s dropped (banned)\n", addr);
@@ -1027,7 +1224,11 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError)) {
+            I_SocketPoller::SocketEvents events;
+            I_SocketPoller::ReadySockets::const_iterator ready = readySockets.find(pnode->hSocket);
+            if (ready != readySockets.end())
+                events = ready->second;
+            if (events.receive || events.error) {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv) {
                     {
@@ -1043,7 +1244,7 @@ void ThreadSocketHandler()
                         } else if (nBytes == 0) {
                             // socket closed gracefully
                             if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
+                                LogPrint(LOG_NET, "socket closed\n");
                             pnode->CloseSocketDisconnect();
                         } else if (nBytes < 0) {
                             // error
@@ -1063,7 +1264,7 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend)) {
+            if (events.send) {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
                     SocketSendData(pnode);
@@ -1075,7 +1276,7 @@ void ThreadSocketHandler()
             int64_t nTime = GetTime();
             if (nTime - pnode->nTimeConnected > 60) {
                 if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+                    LogPrint(LOG_NET, "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
                     pnode->fDisconnect = true;
                 } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
                     LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
@@ -1207,6 +1408,23 @@ void MapPort(bool)
 #endif
 
 
+/** Adds the addresses the seed resolves to; the arguments are copies, so a lookup left behind at shutdown is harmless */
+static void LookupDNSSeed(const CDNSSeedData seed, std::shared_ptr<std::atomic<int> > found)
+{
+    std::vector<CNetAddr> vIPs;
+    std::vector<CAddress> vAdd;
+    if (LookupHost(seed.host.c_str(), vIPs)) {
+        BOOST_FOREACH (CNetAddr& ip, vIPs) {
+            int nOneDay = 24 * 3600;
+            CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()));
+            addr.nTime = GetTime() - 3 * nOneDay - GetRand(4 * nOneDay); // use a random age between 3 and 7 days old
+            vAdd.push_back(addr);
+        }
+    }
+    addrman.Add(vAdd, CNetAddr(seed.name, true));
+    *found += vAdd.size();
+}
+
 void ThreadDNSAddressSeed()
 {
     // goal: only query DNS seeds if address need is acute
@@ -1222,30 +1440,21 @@ void ThreadDNSAddressSeed()
     }
 
     const std::vector<CDNSSeedData>& vSeeds = Params().DNSSeeds();
-    int found = 0;
+    std::shared_ptr<std::atomic<int> > found = std::make_shared<std::atomic<int> >(0);
 
     LogPrintf("Loading addresses from DNS seeds (could take a while)\n");
 
+    // Each seed is looked up on a thread of its own, so that a slow or dead seed does not hold up the others
+    boost::thread_group lookupThreads;
     BOOST_FOREACH (const CDNSSeedData& seed, vSeeds) {
-        if (HaveNameProxy()) {
+        if (HaveNameProxy())
             AddOneShot(seed.host);
-        } else {
-            std::vector<CNetAddr> vIPs;
-            std::vector<CAddress> vAdd;
-            if (LookupHost(seed.host.c_str(), vIPs)) {
-                BOOST_FOREACH (CNetAddr& ip, vIPs) {
-                    int nOneDay = 24 * 3600;
-                    CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()));
-                    addr.nTime = GetTime() - 3 * nOneDay - GetRand(4 * nOneDay); // use a random age between 3 and 7 days old
-                    vAdd.push_back(addr);
-                    found++;
-                }
-            }
-            addrman.Add(vAdd, CNetAddr(seed.name, true));
-        }
+        else
+            lookupThreads.create_thread(boost::bind(&LookupDNSSeed, seed, found));
     }
+    lookupThreads.join_all();
 
-    LogPrintf("%d addresses found from DNS seeds\n", found);
+    LogPrintf("%d addresses found from DNS seeds\n", found->load());
 }
 
 
@@ -1256,10 +1465,31 @@ void DumpAddresses()
     CAddrDB adb;
     adb.Write(addrman);
 
-    LogPrint("net", "Flushed %d addresses to peers.dat  %dms\n",
+    LogPrint(LOG_NET, "Flushed %d addresses to peers.dat  %dms\n",
         addrman.size(), GetTimeMillis() - nStart);
 }
 
+/** Remembers the outbound peers connected the longest, to connect to them first on the next start */
+void static DumpAnchors()
+{
+    std::vector<std::pair<int64_t, CAddress> > vOutbound;
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodes) {
+            if (!pnode->fInbound && !pnode->fOneShot && pnode->fSuccessfullyConnected && !pnode->fDisconnect)
+                vOutbound.push_back(std::make_pair(pnode->nTimeConnected, pnode->addr));
+        }
+    }
+    std::sort(vOutbound.begin(), vOutbound.end());
+    std::vector<CAddress> anchors;
+    for (unsigned i = 0; i < vOutbound.size() && anchors.size() < MAX_ANCHOR_CONNECTIONS; i++)
+        anchors.push_back(vOutbound[i].second);
+
+    CAddrDB adb;
+    if (adb.WriteAnchors(anchors))
+        LogPrint(LOG_NET, "Flushed %d anchor peers to anchors.dat\n", anchors.size());
+}
+
 void static ProcessOneShot()
 {
     string strDest;
@@ -1278,10 +1508,24 @@ void static ProcessOneShot()
     }
 }
 
-void ThreadOpenConnections()
+/** Hands out the anchors read at startup, each to one of the connection threads */
+static bool PopAnchor(CAddress& anchor)
+{
+    LOCK(cs_vAnchors);
+    if (vAnchors.empty())
+        return false;
+    anchor = vAnchors.back();
+    vAnchors.pop_back();
+    return true;
+}
+
+void ThreadOpenConnections(unsigned threadIndex)
 {
     // Connect to specific addresses
     if (settings.ParameterIsSet("-connect")) {
+        // Only the first thread connects to them, the others are not needed
+        if (threadIndex > 0)
+            return;
         const auto& connections = settings.GetMultiParameter("-connect");
         if(connections.size() > 0)
         {
@@ -1303,15 +1547,25 @@ void ThreadOpenConnections()
     // Initiate network connections
     int64_t nStart = GetTime();
     while (true) {
-        ProcessOneShot();
-
-        MilliSleep(500);
+        if (threadIndex == 0)
+            ProcessOneShot();
 
         CSemaphoreGrant grant(*semOutbound);
         boost::this_thread::interruption_point();
 
+        // The peers that were good before shutdown are tried first, and right away
+        CAddress anchor;
+        if (PopAnchor(anchor)) {
+            if (!IsLimited(anchor) && !IsLocal(anchor) && !FindNode(static_cast<CService>(anchor)))
+                OpenNetworkConnection(anchor, &grant);
+            continue;
+        }
+
+        MilliSleep(500);
+        boost::this_thread::interruption_point();
+
         // Add seed nodes if DNS seeds are all down (an infrastructure attack?).
-        if (addrman.size() == 0 && (GetTime() - nStart > 60)) {
+        if (threadIndex == 0 && addrman.size() == 0 && (GetTime() - nStart > 60)) {
             static bool done = false;
             if (!done) {
                 LogPrintf("Adding fixed seed nodes as DNS doesn't seem to be available.\n");
@@ -1473,7 +1727,14 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant* grantOu
 }
 
 
-void ThreadMessageHandler()
+static unsigned nMessageHandlerThreads = 1;
+
+/**
+ * Each handler thread serves the peers whose id falls to it, so the messages
+ * of a peer are still processed one at a time and in the order received.
+ * ProcessMessages serializes whatever touches the chain state on cs_main.
+ */
+void ThreadMessageHandler(unsigned handlerIndex)
 {
     boost::mutex condition_mutex;
     boost::unique_lock<boost::mutex> lock(condition_mutex);
@@ -1482,13 +1743,15 @@ void ThreadMessageHandler()
        we did a broadcast.  */
     int64_t nLastRebroadcast = 0;
 
-    SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
+    SetThreadPriority(ThreadGroupPriority(ThreadGroup::NETWORK, THREAD_PRIORITY_BELOW_NORMAL));
     while (true) {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            BOOST_FOREACH (CNode* pnode, vNodesCopy) {
+            BOOST_FOREACH (CNode* pnode, vNodes) {
+                if (static_cast<unsigned>(pnode->id) % nMessageHandlerThreads != handlerIndex)
+                    continue;
+                vNodesCopy.push_back(pnode);
                 pnode->AddRef();
             }
         }
@@ -1496,10 +1759,6 @@ void ThreadMessageHandler()
         bool rebroadcast = (!IsInitialBlockDownload() && (GetTime() > nLastRebroadcast + 24 * 60 * 60));
 
         // Poll the connected nodes for messages
-        CNode* pnodeTrickle = NULL;
-        if (!vNodesCopy.empty())
-            pnodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())];
-
         bool fSleep = true;
 
         BOOST_FOREACH (CNode* pnode, vNodesCopy) {
@@ -1514,7 +1773,7 @@ void ThreadMessageHandler()
                         pnode->CloseSocketDisconnect();
 
                     if (pnode->nSendSize < SendBufferSize()) {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete())) {
+                        if ((!pnode->vRecvGetData.empty() && !pnode->fUploadThrottled) || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete())) {
                             fSleep = false;
                         }
                     }
@@ -1540,8 +1799,10 @@ void ThreadMessageHandler()
                         continue;
 
                     // Periodically clear setAddrKnown to allow refresh broadcasts
-                    if (nLastRebroadcast > 0)
+                    if (nLastRebroadcast > 0) {
+                        LOCK(pnode2->cs_addrRelay);
                         pnode2->setAddrKnown.clear();
+                    }
 
                     // Rebroadcast our address
                     AdvertizeLocal(pnode2);
@@ -1557,7 +1818,7 @@ void ThreadMessageHandler()
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
-                    g_signals.SendMessages(pnode, pnode == pnodeTrickle || pnode->fWhitelisted);
+                    g_signals.SendMessages(pnode, pnode->fWhitelisted);
             }
             boost::this_thread::interruption_point();
         }
@@ -1736,7 +1997,7 @@ void static Discover(boost::thread_group& threadGroup)
 #endif
 }
 
-void StartNode(boost::thread_group& threadGroup)
+void LoadPeerAddresses()
 {
     uiInterface.InitMessage(translate("Loading addresses..."));
     // Load addresses for peers.dat
@@ -1748,6 +2009,19 @@ void StartNode(boost::thread_group& threadGroup)
     }
     LogPrintf("Loaded %i addresses from peers.dat  %dms\n",
         addrman.size(), GetTimeMillis() - nStart);
+    if (!settings.ParameterIsSet("-connect")) {
+        CAddrDB adb;
+        LOCK(cs_vAnchors);
+        if (adb.ReadAnchors(vAnchors))
+            LogPrintf("Loaded %i anchor peers from anchors.dat\n", vAnchors.size());
+    }
+    fPeerAddressesLoaded = true;
+}
+
+void StartNode(boost::thread_group& threadGroup)
+{
+    if (!fPeerAddressesLoaded)
+        LoadPeerAddresses();
     fAddressesInitialized = true;
 
     if (semOutbound == NULL) {
@@ -1779,11 +2053,14 @@ void StartNode(boost::thread_group& threadGroup)
     // Initiate outbound connections from -addnode
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "addcon", &ThreadOpenAddedConnections));
 
-    // Initiate outbound connections
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
+    // Initiate outbound connections, several at a time so the first ones to answer are not held up by the rest
+    for (unsigned i = 0; i < OUTBOUND_CONNECTION_THREADS; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)(unsigned), unsigned>, "opencon", &ThreadOpenConnections, i));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    nMessageHandlerThreads = std::max(1, std::min((int)settings.GetArg("-msghandthreads", DEFAULT_MESSAGE_HANDLER_THREADS), MAX_MESSAGE_HANDLER_THREADS));
+    for (unsigned i = 0; i < nMessageHandlerThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)(unsigned), unsigned>, "msghand", &ThreadMessageHandler, i));
 
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
@@ -1816,6 +2093,8 @@ bool StopNode()
 
     if (fAddressesInitialized) {
         DumpAddresses();
+        if (!settings.ParameterIsSet("-connect"))
+            DumpAnchors();
         fAddressesInitialized = false;
     }
 
@@ -1868,14 +2147,12 @@ void CExplicitNetCleanup::callCleanup()
 
 void RelayTransaction(const CTransaction& tx)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << tx;
-    RelayTransaction(tx, ss);
+    RelayTransaction(MakeTransactionRef(tx));
 }
 
-void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
+void RelayTransaction(const CTransactionRef& txRef)
 {
+    const CTransaction& tx = *txRef;
     CInv inv(MSG_TX, tx.GetHash());
     {
         LOCK(cs_mapRelay);
@@ -1885,8 +2162,8 @@ void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
             vRelayExpiration.pop_front();
         }
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
+        // Keep the transaction itself rather than a serialized copy, sharing it with the mempool
+        mapRelay.insert(std::make_pair(inv, txRef));
         vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
     }
     LOCK(cs_vNodes);
@@ -1936,6 +2213,7 @@ void CNode::RecordBytesSent(uint64_t bytes)
 {
     LOCK(cs_totalBytesSent);
     nTotalBytesSent += bytes;
+    totalUploadBudget.Spend(bytes, GetTimeMicros());
 }
 
 uint64_t CNode::GetTotalBytesRecv()
@@ -1950,6 +2228,42 @@ uint64_t CNode::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+void CNode::SetUploadRates(int64_t bytesPerSecond, int64_t peerBytesPerSecond)
+{
+    LOCK(cs_totalBytesSent);
+    totalUploadBudget.SetRate(bytesPerSecond, UPLOAD_BURST_SECONDS, GetTimeMicros());
+    nPeerUploadRate = peerBytesPerSecond;
+}
+
+bool CNode::HistoricalUploadAllowed()
+{
+    const int64_t nNow = GetTimeMicros();
+    LOCK(cs_totalBytesSent);
+    fUploadThrottled = !totalUploadBudget.HasBytesAvailable(nNow) || !uploadBudget.HasBytesAvailable(nNow);
+    if (fUploadThrottled)
+        nDeferredHistoricalRequests++;
+    return !fUploadThrottled;
+}
+
+void CNode::RecordHistoricalBytesSent(uint64_t bytes)
+{
+    LOCK(cs_totalBytesSent);
+    nHistoricalBytesSent += bytes;
+    uploadBudget.Spend(bytes, GetTimeMicros());
+}
+
+CUploadLimitStats CNode::GetUploadLimitStats()
+{
+    LOCK(cs_totalBytesSent);
+    CUploadLimitStats stats;
+    stats.nMaxUploadRate = totalUploadBudget.GetBytesPerSecond();
+    stats.nMaxPeerUploadRate = nPeerUploadRate;
+    stats.nAvailableBytes = totalUploadBudget.GetAvailableBytes(GetTimeMicros());
+    stats.nHistoricalBytesSent = nHistoricalBytesSent;
+    stats.nDeferredHistoricalRequests = nDeferredHistoricalRequests;
+    return stats;
+}
+
 void CNode::Fuzz(int nChance)
 {
     if (!fSuccessfullyConnected) return; // Don't fuzz initial handshake
@@ -1991,51 +2305,59 @@ void CNode::Fuzz(int nChance)
 CAddrDB::CAddrDB()
 {
     pathAddr = GetDataDir() / "peers.dat";
+    pathAnchors = GetDataDir() / "anchors.dat";
 }
 
-bool CAddrDB::Write(const CAddrMan& addr)
+template <typename Data>
+static bool SerializeFileDB(const std::string& prefix, const boost::filesystem::path& path, const Data& data)
 {
     // Generate random temporary filename
     unsigned short randv = 0;
     GetRandBytes((unsigned char*)&randv, sizeof(randv));
-    std::string tmpfn = strprintf("peers.dat.%04x", randv);
-
-    // serialize addresses, checksum data up to that point, then append csum
-    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
-    ssPeers << FLATDATA(Params().MessageStart());
-    ssPeers << addr;
-    uint256 hash = Hash(ssPeers.begin(), ssPeers.end());
-    ssPeers << hash;
-
-    // open output file, and associate with CAutoFile
-    boost::filesystem::path pathAddr = GetDataDir() / "peers.dat";
-    FILE* file = fopen(pathAddr.string().c_str(), "wb");
+    std::string tmpfn = strprintf("%s.%04x", prefix, randv);
+
+    // serialize the data, checksum data up to that point, then append csum
+    CDataStream ssData(SER_DISK, CLIENT_VERSION);
+    ssData << FLATDATA(Params().MessageStart());
+    ssData << data;
+    uint256 hash = Hash(ssData.begin(), ssData.end());
+    ssData << hash;
+
+    // The data is serialized by now, so its owner is free again while the
+    // snapshot goes to a temporary file that then replaces the old file
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
     CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
     if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathAddr.string());
+        return error("%s : Failed to open file %s", __func__, pathTmp.string());
 
     // Write and commit header, data
     try {
-        fileout << ssPeers;
+        fileout << ssData;
     } catch (std::exception& e) {
         return error("%s : Serialize or I/O error - %s", __func__, e.what());
     }
     FileCommit(fileout.Get());
     fileout.fclose();
 
+    // replace the existing file, if any, with the temporary one
+    if (!RenameOver(pathTmp, path))
+        return error("%s : Rename-into-place failed", __func__);
+
     return true;
 }
 
-bool CAddrDB::Read(CAddrMan& addr)
+template <typename Data>
+static bool DeserializeFileDB(const boost::filesystem::path& path, Data& data)
 {
     // open input file, and associate with CAutoFile
-    FILE* file = fopen(pathAddr.string().c_str(), "rb");
+    FILE* file = fopen(path.string().c_str(), "rb");
     CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathAddr.string());
+        return error("%s : Failed to open file %s", __func__, path.string());
 
     // use file size to size memory buffer
-    int fileSize = boost::filesystem::file_size(pathAddr);
+    int fileSize = boost::filesystem::file_size(path);
     int dataSize = fileSize - sizeof(uint256);
     // Don't try to resize to a negative number if file is small
     if (dataSize < 0)
@@ -2053,24 +2375,24 @@ bool CAddrDB::Read(CAddrMan& addr)
     }
     filein.fclose();
 
-    CDataStream ssPeers(vchData, SER_DISK, CLIENT_VERSION);
+    CDataStream ssData(vchData, SER_DISK, CLIENT_VERSION);
 
     // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssPeers.begin(), ssPeers.end());
+    uint256 hashTmp = Hash(ssData.begin(), ssData.end());
     if (hashIn != hashTmp)
         return error("%s : Checksum mismatch, data corrupted", __func__);
 
     unsigned char pchMsgTmp[4];
     try {
         // de-serialize file header (network specific magic number) and ..
-        ssPeers >> FLATDATA(pchMsgTmp);
+        ssData >> FLATDATA(pchMsgTmp);
 
         // ... verify the network matches ours
         if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
             return error("%s : Invalid network magic number", __func__);
 
-        // de-serialize address data into one CAddrMan object
-        ssPeers >> addr;
+        // de-serialize the data
+        ssData >> data;
     } catch (std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -2078,14 +2400,55 @@ bool CAddrDB::Read(CAddrMan& addr)
     return true;
 }
 
+bool CAddrDB::Write(const CAddrMan& addr)
+{
+    return SerializeFileDB("peers.dat", pathAddr, addr);
+}
+
+bool CAddrDB::Read(CAddrMan& addr)
+{
+    return DeserializeFileDB(pathAddr, addr);
+}
+
+bool CAddrDB::WriteAnchors(const std::vector<CAddress>& anchors)
+{
+    return SerializeFileDB("anchors.dat", pathAnchors, anchors);
+}
+
+bool CAddrDB::ReadAnchors(std::vector<CAddress>& anchors)
+{
+    if (!boost::filesystem::exists(pathAnchors))
+        return false;
+    const bool fRead = DeserializeFileDB(pathAnchors, anchors);
+    boost::filesystem::remove(pathAnchors);
+    if (anchors.size() > MAX_ANCHOR_CONNECTIONS)
+        anchors.resize(MAX_ANCHOR_CONNECTIONS);
+    return fRead;
+}
+
+int64_t PoissonNextSend(int64_t nNow, int average_interval_seconds)
+{
+    return nNow + (int64_t)(log1p(GetRand(1ULL << 48) * -0.0000000000000035527136788 /* -1/2^48 */) * average_interval_seconds * -1000000.0 + 0.5);
+}
+
 unsigned int ReceiveFloodSize() { return 1000 * settings.GetArg("-maxreceivebuffer", 5 * 1000); }
 unsigned int SendBufferSize() { return 1000 * settings.GetArg("-maxsendbuffer", 1 * 1000); }
 
-CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fInboundIn) : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000)
+size_t NetworkBufferMemoryUsage()
+{
+    LOCK(cs_vNodes);
+    size_t usage = 0;
+    BOOST_FOREACH (CNode* pnode, vNodes)
+        usage += pnode->BufferMemoryUsage();
+    return usage;
+}
+
+CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fInboundIn) : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000), filterInventoryKnown(INVENTORY_KNOWN_FILTER_SIZE, INVENTORY_KNOWN_FILTER_FP_RATE)
 {
     nServices = 0;
     hSocket = hSocketIn;
     nRecvVersion = INIT_PROTO_VERSION;
+    fAcceptCompressed = false;
     nLastSend = 0;
     nLastRecv = 0;
     nSendBytes = 0;
@@ -2109,12 +2472,20 @@ CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fIn
     nStartingHeight = -1;
     fGetAddr = false;
     fRelayTxes = false;
-    setInventoryKnown.max_size(SendBufferSize() / 1000);
+    nNextAddrSend = 0;
+    nNextInvSend = 0;
+    {
+        LOCK(cs_totalBytesSent);
+        uploadBudget.SetRate(nPeerUploadRate, UPLOAD_BURST_SECONDS, GetTimeMicros());
+    }
+    fUploadThrottled = false;
     pfilter = new CBloomFilter();
     nPingNonceSent = 0;
     nPingUsecStart = 0;
     nPingUsecTime = 0;
     fPingQueued = false;
+    fStateStatsPublished = false;
+    nNextStateStatsPublish = 0;
     fObfuScationMaster = false;
 
     {
@@ -2123,9 +2494,9 @@ CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fIn
     }
 
     if (ShouldLogPeerIPs())
-        LogPrint("net", "Added connection to %s peer=%d\n", addrName, id);
+        LogPrint(LOG_NET, "Added connection to %s peer=%d\n", addrName, id);
     else
-        LogPrint("net", "Added connection peer=%d\n", id);
+        LogPrint(LOG_NET, "Added connection peer=%d\n", id);
 
     // Be shy and don't send version until we hear
     if (hSocket != INVALID_SOCKET && !fInbound)
@@ -2137,6 +2508,7 @@ CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fIn
 CNode::~CNode()
 {
     CloseSocket(hSocket);
+    ClearReceivedMessages();
 
     if (pfilter)
         delete pfilter;
@@ -2144,42 +2516,12 @@ CNode::~CNode()
     GetNodeSignals().FinalizeNode(GetId());
 }
 
-void CNode::AskFor(const CInv& inv)
-{
-    if (mapAskFor.size() > MAPASKFOR_MAX_SZ)
-        return;
-    // We're using mapAskFor as a priority queue,
-    // the key is the earliest time the request can be sent
-    int64_t nRequestTime;
-    limitedmap<CInv, int64_t>::const_iterator it = mapAlreadyAskedFor.find(inv);
-    if (it != mapAlreadyAskedFor.end())
-        nRequestTime = it->second;
-    else
-        nRequestTime = 0;
-    LogPrint("net", "askfor %s  %d (%s) peer=%d\n", inv, nRequestTime, DateTimeStrFormat("%H:%M:%S", nRequestTime / 1000000), id);
-
-    // Make sure not to reuse time indexes to keep things in the same order
-    int64_t nNow = GetTimeMicros() - 1000000;
-    static int64_t nLastTime;
-    ++nLastTime;
-    nNow = std::max(nNow, nLastTime);
-    nLastTime = nNow;
-
-    // Each retry is 2 minutes after the last
-    nRequestTime = std::max(nRequestTime + 2 * 60 * 1000000, nNow);
-    if (it != mapAlreadyAskedFor.end())
-        mapAlreadyAskedFor.update(it, nRequestTime);
-    else
-        mapAlreadyAskedFor.insert(std::make_pair(inv, nRequestTime));
-    mapAskFor.insert(std::make_pair(nRequestTime, inv));
-}
-
 void CNode::BeginMessage(const char* pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSend)
 {
     ENTER_CRITICAL_SECTION(cs_vSend);
     assert(ssSend.size() == 0);
     ssSend << CMessageHeader(pszCommand, 0);
-    LogPrint("net", "sending: %s ", SanitizeString(pszCommand));
+    LogPrint(LOG_NET, "sending: %s ", SanitizeString(pszCommand));
 }
 
 void CNode::AbortMessage() UNLOCK_FUNCTION(cs_vSend)
@@ -2188,7 +2530,7 @@ void CNode::AbortMessage() UNLOCK_FUNCTION(cs_vSend)
 
     LEAVE_CRITICAL_SECTION(cs_vSend);
 
-    LogPrint("net", "(aborted)\n");
+    LogPrint(LOG_NET, "(aborted)\n");
 }
 
 void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
@@ -2197,7 +2539,7 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     // since they are only used during development to debug the networking code and are
     // not intended for end-users.
     if (settings.ParameterIsSet("-dropmessagestest") && GetRand(settings.GetArg("-dropmessagestest", 2)) == 0) {
-        LogPrint("net", "dropmessages DROPPING SEND MESSAGE\n");
+        LogPrint(LOG_NET, "dropmessages DROPPING SEND MESSAGE\n");
         AbortMessage();
         return;
     }
@@ -2218,10 +2560,23 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     assert(ssSend.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
     memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
 
-    LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
-
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
+    LogPrint(LOG_NET, "(%d bytes) peer=%d\n", nSize, id);
+
+    std::deque<std::vector<char> >::iterator it = vSendMsg.insert(vSendMsg.end(), std::vector<char>());
+    if (sendCompressor) {
+        const bool fCompressed = sendCompressor->Compress(&ssSend[0], ssSend.size(), *it);
+        ssSend.clear();
+        if (!fCompressed) {
+            // The peer could not decode anything after a gap in the stream.
+            LogPrintf("Unable to compress a message to peer=%d, disconnecting\n", id);
+            vSendMsg.erase(it);
+            fDisconnect = true;
+            LEAVE_CRITICAL_SECTION(cs_vSend);
+            return;
+        }
+    } else {
+        ssSend.GetAndClear(*it);
+    }
     nSendSize += (*it).size();
 
     // If write queue empty, attempt "optimistic write"
@@ -2329,7 +2684,13 @@ void SetNetworkingParameters()
     const int reservedFileDescriptors = MIN_CORE_FILEDESCRIPTORS;
     int nBind = std::max((int)settings.ParameterIsSet("-bind") + (int)settings.ParameterIsSet("-whitebind"), 1);
     nMaxConnections = settings.GetArg("-maxconnections", 125);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - reservedFileDescriptors)), 0);
+    if (!SocketPollerScalesPastFdSetSize())
+        nMaxConnections = std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - reservedFileDescriptors));
+    nMaxConnections = std::max(nMaxConnections, 0);
+
+    CNode::SetUploadRates(
+        1000 * settings.GetArg("-maxuploadrate", DEFAULT_MAX_UPLOAD_RATE),
+        1000 * settings.GetArg("-maxpeeruploadrate", DEFAULT_MAX_PEER_UPLOAD_RATE));
 }
 
 bool InitializeP2PNetwork(UIMessenger& uiMessenger)
@@ -2359,6 +2720,16 @@ bool InitializeP2PNetwork(UIMessenger& uiMessenger)
         }
     }
 
+    CNode::SetCompressWhitelisted(settings.GetBoolArg("-compresswhitelisted", DEFAULT_COMPRESS_WHITELISTED));
+    BOOST_FOREACH (const std::string& net, settings.GetMultiParameter("-compresspeer")) {
+        CSubNet subnet(net);
+        if (!subnet.IsValid())
+            return uiMessenger.InitError(strprintf(translate("Invalid netmask specified in -compresspeer: '%s'"), net));
+        CNode::AddCompressedRange(subnet);
+    }
+    if ((settings.GetBoolArg("-compresswhitelisted", DEFAULT_COMPRESS_WHITELISTED) || settings.ParameterIsSet("-compresspeer")) && !NetworkStreamCompressor::IsSupported())
+        uiMessenger.InitWarning(translate("Peer connections cannot be compressed by this build, -compresswhitelisted and -compresspeer are ignored."));
+
     // Check for host lookup allowed before parsing any network related parameters
     fNameLookup = settings.GetBoolArg("-dns", DEFAULT_NAME_LOOKUP);
 
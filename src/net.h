@@ -10,17 +10,21 @@
 #include "bloom.h"
 #include "compat.h"
 #include "hash.h"
-#include "limitedmap.h"
 #include "mruset.h"
 #include "netbase.h"
+#include "primitives/transaction.h"
 #include "protocol.h"
 #include "random.h"
 #include "streams.h"
 #include "sync.h"
 #include "uint256.h"
 #include "utilstrencodings.h"
+#include <NetworkStreamCompression.h>
+#include <UploadBudget.h>
 
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef WIN32
@@ -58,11 +62,36 @@ static const bool DEFAULT_UPNP = USE_UPNP;
 #else
 static const bool DEFAULT_UPNP = false;
 #endif
-/** The maximum number of entries in mapAskFor */
-static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
+/** The most queued messages handed to the socket in a single send call */
+static const int MAX_SEND_BUFFERS_PER_CALL = 64;
+/** Processed messages each peer keeps to receive its next messages into */
+static const size_t MAX_POOLED_RECEIVE_MESSAGES = 4;
+/** Receive buffers above this size are large, and only a few of those are kept for all peers together */
+static const size_t LARGE_RECEIVE_BUFFER_SIZE = 256 * 1024;
+/** Large receive buffers kept for all peers together */
+static const int MAX_POOLED_LARGE_RECEIVE_BUFFERS = 16;
+/** The most recent inventory items remembered as known to each peer */
+static const unsigned int INVENTORY_KNOWN_FILTER_SIZE = 10000;
+/** The chance an item never announced to a peer is taken as known to it */
+static const double INVENTORY_KNOWN_FILTER_FP_RATE = 0.000001;
+/** Average delay between trickled transaction inventory announcements to a peer (in seconds). Halved for outbound peers. */
+static const int AVG_INVENTORY_BROADCAST_INTERVAL = 5;
+/** Average delay between address announcements to a peer (in seconds) */
+static const int AVG_ADDRESS_BROADCAST_INTERVAL = 30;
+/** Delay between publications of a peer's validation state stats for getpeerinfo (in seconds) */
+static const int NODE_STATE_STATS_PUBLISH_INTERVAL = 1;
+/** Threads opening outbound connections side by side, so that peers which are slow to answer do not hold up the others */
+static const unsigned int OUTBOUND_CONNECTION_THREADS = 4;
+/** Outbound peers remembered at shutdown (in anchors.dat) and connected to first on the next start */
+static const unsigned int MAX_ANCHOR_CONNECTIONS = 4;
+
+/** The time of the next of a series of announcements an average interval apart, chosen so that peers cannot tell when they were queued */
+int64_t PoissonNextSend(int64_t nNow, int average_interval_seconds);
 
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
+//! Bytes of memory the buffers of all connected peers take up
+size_t NetworkBufferMemoryUsage();
 
 void AddOneShot(std::string strDest);
 bool RecvLine(SOCKET hSocket, std::string& strLine);
@@ -75,6 +104,8 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant* grantOu
 void MapPort(bool fUseUPnP);
 unsigned short GetListenPort();
 bool BindListenPort(const CService& bindAddr, std::string& strError, bool fWhitelisted = false);
+//! Reads peers.dat and anchors.dat, which StartNode does unless done before
+void LoadPeerAddresses();
 void StartNode(boost::thread_group& threadGroup);
 bool StopNode();
 void SocketSendData(CNode* pnode);
@@ -130,10 +161,9 @@ CAddrMan& GetNetworkAddressManager();
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern std::map<CInv, CDataStream> mapRelay;
+extern std::map<CInv, CTransactionRef> mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
-extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
 
 extern std::vector<std::string> vAddedNodes;
 extern CCriticalSection cs_vAddedNodes;
@@ -149,6 +179,21 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+struct CUploadLimitStats {
+    int64_t nMaxUploadRate;
+    int64_t nMaxPeerUploadRate;
+    int64_t nAvailableBytes;
+    uint64_t nHistoricalBytesSent;
+    uint64_t nDeferredHistoricalRequests;
+};
+
+struct CNodeStateStats {
+    int nMisbehavior;
+    int nSyncHeight;
+    int nCommonHeight;
+    std::vector<int> vHeightInFlight;
+};
+
 class CNodeStats
 {
 public:
@@ -168,6 +213,9 @@ public:
     double dPingTime;
     double dPingWait;
     std::string addrLocal;
+    //! Whether the stats of the peer's validation state have been published yet
+    bool fStateStats;
+    CNodeStateStats stateStats;
 };
 
 
@@ -184,6 +232,7 @@ public:
     unsigned int nDataPos;
 
     int64_t nTime; // time (in microseconds) of message receipt.
+    bool fPrevalidated; // whether signatures were already read ahead from it
 
     CNetMessage(int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn)
     {
@@ -192,6 +241,7 @@ public:
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
+        fPrevalidated = false;
     }
 
     bool complete() const
@@ -207,6 +257,9 @@ public:
         vRecv.SetVersion(nVersionIn);
     }
 
+    //! Starts over on a new message, keeping the buffers already allocated
+    void Reset(int nVersionIn);
+
     int readHeader(const char* pch, unsigned int nBytes);
     int readData(const char* pch, unsigned int nBytes);
 };
@@ -223,14 +276,26 @@ public:
     size_t nSendSize;   // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<std::vector<char> > vSendMsg;
     CCriticalSection cs_vSend;
+    //! Compresses every message queued after our "compress" one; requires LOCK(cs_vSend)
+    std::unique_ptr<NetworkStreamCompressor> sendCompressor;
 
     std::deque<CInv> vRecvGetData;
+    //! Historical blocks this peer may still be sent; only the message handler thread touches it
+    UploadBudget uploadBudget;
+    //! Set while vRecvGetData waits for the upload limits, so the message handler does not spin on it
+    bool fUploadThrottled;
     std::deque<CNetMessage> vRecvMsg;
+    //! Processed messages whose buffers the next ones are received into
+    std::vector<CNetMessage> vRecvMsgPool;
     CCriticalSection cs_vRecvMsg;
     uint64_t nRecvBytes;
     int nRecvVersion;
+    //! Decodes whatever follows the peer's "compress" message; requires LOCK(cs_vRecvMsg)
+    std::unique_ptr<NetworkStreamDecompressor> recvDecompressor;
+    //! Set once we told the peer with "sendcompress" that it may compress what it sends us
+    std::atomic<bool> fAcceptCompressed;
 
     int64_t nLastSend;
     int64_t nLastRecv;
@@ -281,6 +346,12 @@ protected:
     static std::vector<CSubNet> vWhitelistedRange;
     static CCriticalSection cs_vWhitelistedRange;
 
+    // Peers whose traffic may be compressed: those connecting from or to these
+    // ranges, and whitelisted ones if so configured.
+    static std::vector<CSubNet> vCompressedRange;
+    static CCriticalSection cs_vCompressedRange;
+    static std::atomic<bool> fCompressWhitelisted;
+
     // Basic fuzz-testing
     void Fuzz(int nChance); // modifies ssSend
 
@@ -288,17 +359,20 @@ public:
     uint256 hashContinue;
     int nStartingHeight;
 
-    // flood relay
+    // flood relay, taken from other handler threads when relaying, so under cs_addrRelay
     std::vector<CAddress> vAddrToSend;
     mruset<CAddress> setAddrKnown;
+    CCriticalSection cs_addrRelay;
     bool fGetAddr;
     std::set<uint256> setKnown;
 
+    int64_t nNextAddrSend;
+
     // inventory based relay
-    mruset<CInv> setInventoryKnown;
+    CRollingBloomFilter filterInventoryKnown;
     std::vector<CInv> vInventoryToSend;
     CCriticalSection cs_inventory;
-    std::multimap<int64_t, CInv> mapAskFor;
+    int64_t nNextInvSend;
     std::vector<uint256> vBlockRequested;
 
     // Ping time measurement:
@@ -311,6 +385,13 @@ public:
     // Whether a ping is requested.
     bool fPingQueued;
 
+    // The stats of the validation state of this peer, as last published by the message handler,
+    // for those reading them not to wait on cs_main
+    CCriticalSection cs_stateStats;
+    bool fStateStatsPublished;
+    CNodeStateStats stateStats;
+    int64_t nNextStateStatsPublish;
+
     int nSporksSynced = 0;
 
     CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn = "", bool fInboundIn = false);
@@ -322,6 +403,10 @@ private:
     static CCriticalSection cs_totalBytesSent;
     static uint64_t nTotalBytesRecv;
     static uint64_t nTotalBytesSent;
+    static UploadBudget totalUploadBudget;
+    static int64_t nPeerUploadRate;
+    static uint64_t nHistoricalBytesSent;
+    static uint64_t nDeferredHistoricalRequests;
 
     CNode(const CNode&);
     void operator=(const CNode&);
@@ -347,8 +432,20 @@ public:
         return total;
     }
 
+    //! Bytes of memory the send and receive buffers take up, including the pooled ones
+    size_t BufferMemoryUsage();
+
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char* pch, unsigned int nBytes);
+    // requires LOCK(cs_vRecvMsg)
+    //! Parses bytes as they are on the wire without compression, switching over to decompression after a "compress" message
+    bool ReceivePlainMsgBytes(const char* pch, size_t nBytes);
+
+    // requires LOCK(cs_vRecvMsg)
+    //! Removes the processed messages up to the given one, keeping some of them to receive into
+    void RecycleReceivedMessages(std::deque<CNetMessage>::iterator end);
+    // requires LOCK(cs_vRecvMsg)
+    void ClearReceivedMessages();
 
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
@@ -372,6 +469,7 @@ public:
 
     void AddAddressKnown(const CAddress& addr)
     {
+        LOCK(cs_addrRelay);
         setAddrKnown.insert(addr);
     }
 
@@ -380,6 +478,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrRelay);
         if (addr.IsValid() && !setAddrKnown.count(addr)) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[FastRandomContext()(vAddrToSend.size())] = addr;
@@ -390,23 +489,35 @@ public:
     }
 
 
+    //! The key the inventory known filter is queried with, so items of different types with the same hash are told apart
+    static std::vector<unsigned char> InventoryKnownKey(const CInv& inv)
+    {
+        std::vector<unsigned char> vKey(inv.hash.begin(), inv.hash.end());
+        vKey.insert(vKey.end(), (const unsigned char*)&inv.type, (const unsigned char*)&inv.type + sizeof(inv.type));
+        return vKey;
+    }
+
     void AddInventoryKnown(const CInv& inv)
     {
         {
             LOCK(cs_inventory);
-            setInventoryKnown.insert(inv);
+            filterInventoryKnown.insert(InventoryKnownKey(inv));
         }
     }
 
+    bool HasInventoryKnown(const CInv& inv)
+    {
+        LOCK(cs_inventory);
+        return filterInventoryKnown.contains(InventoryKnownKey(inv));
+    }
+
     void PushInventory(const CInv& inv)
     {
         LOCK(cs_inventory);
-        if (setInventoryKnown.count(inv) == 0)
+        if (!filterInventoryKnown.contains(InventoryKnownKey(inv)))
             vInventoryToSend.push_back(inv);
     }
 
-    void AskFor(const CInv& inv);
-
     // TODO: Document the postcondition of this function.  Is cs_vSend locked?
     void BeginMessage(const char* pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSend);
 
@@ -621,16 +732,32 @@ public:
     static bool Ban(const CNetAddr& ip);
     static bool Ban(const CNetAddr& addr, int64_t banTime);
     void copyStats(CNodeStats& stats);
+    void PublishStateStats(const CNodeStateStats& stats);
 
     static bool IsWhitelistedRange(const CNetAddr& ip);
     static void AddWhitelistedRange(const CSubNet& subnet);
 
+    static bool IsCompressedRange(const CNetAddr& ip);
+    static void AddCompressedRange(const CSubNet& subnet);
+    static void SetCompressWhitelisted(bool fCompress);
+    //! Whether the traffic with this peer may be compressed both ways, once either side asks for it with "sendcompress"
+    bool CompressionAllowed() const;
+    //! Queue a "compress" message and compress everything queued after it
+    void StartSendCompression();
+
     // Network stats
     static void RecordBytesRecv(uint64_t bytes);
     static void RecordBytesSent(uint64_t bytes);
 
     static uint64_t GetTotalBytesRecv();
     static uint64_t GetTotalBytesSent();
+
+    // Upload limits, which all traffic counts against but only historical blocks wait for
+    static void SetUploadRates(int64_t bytesPerSecond, int64_t peerBytesPerSecond);
+    //! Whether a historical block may be sent now, or else marks the request as throttled
+    bool HistoricalUploadAllowed();
+    void RecordHistoricalBytesSent(uint64_t bytes);
+    static CUploadLimitStats GetUploadLimitStats();
 };
 
 class CExplicitNetCleanup
@@ -639,22 +766,25 @@ public:
     static void callCleanup();
 };
 
-class CTransaction;
 void RelayTransaction(const CTransaction& tx);
-void RelayTransaction(const CTransaction& tx, const CDataStream& ss);
+void RelayTransaction(const CTransactionRef& tx);
 void RelayTransactionLockReq(const CTransaction& tx, bool relayToAll = false);
 void RelayInv(CInv& inv);
 
-/** Access to the (IP) address database (peers.dat) */
+/** Access to the (IP) address database (peers.dat) and the anchor peers (anchors.dat) */
 class CAddrDB
 {
 private:
     boost::filesystem::path pathAddr;
+    boost::filesystem::path pathAnchors;
 
 public:
     CAddrDB();
     bool Write(const CAddrMan& addr);
     bool Read(CAddrMan& addr);
+    bool WriteAnchors(const std::vector<CAddress>& anchors);
+    //! Reads the anchors and removes the file, so that peers which keep failing are not tried first again
+    bool ReadAnchors(std::vector<CAddress>& anchors);
 };
 
 class UIMessenger;
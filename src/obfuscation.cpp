@@ -11,6 +11,7 @@
 #include <string>
 #include <ui_interface.h>
 #include <Logging.h>
+#include <MasternodeSignaturePrevalidator.h>
 
 const std::string strMessageMagic = "DarkNet Signed Message:\n";
 
@@ -42,13 +43,17 @@ bool CObfuScationSigner::GetKeysFromSecret(std::string strSecret, CKey& keyRet,
     return true;
 }
 
-bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorMessage, std::vector<unsigned char>& vchSig, CKey key)
+uint256 CObfuScationSigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    return ss.GetHash();
+}
 
-    if (!key.SignCompact(ss.GetHash(), vchSig)) {
+bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorMessage, std::vector<unsigned char>& vchSig, CKey key)
+{
+    if (!key.SignCompact(GetMessageHash(strMessage), vchSig)) {
         errorMessage = translate("Signing failed.");
         return false;
     }
@@ -58,18 +63,15 @@ bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorM
 
 bool CObfuScationSigner::VerifyMessage(CKeyID pubkeyID, const std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage)
 {
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << strMessageMagic;
-    ss << strMessage;
-
-    CPubKey pubkey2;
-    if (!pubkey2.RecoverCompact(ss.GetHash(), vchSig)) {
+    // The signer may have been recovered ahead, when the message was queued
+    CKeyID signer;
+    if (!MasternodeSignaturePrevalidator::RecoverSigner(GetMessageHash(strMessage), vchSig, signer)) {
         errorMessage = translate("Error recovering public key.");
         return false;
     }
 
-    if (pubkey2.GetID() != pubkeyID)
-        LogPrint("sign","CObfuScationSigner::VerifyMessage -- keys don't match: %s %s\n", pubkey2.GetID(), pubkeyID);
+    if (signer != pubkeyID)
+        LogPrint(LOG_SIGN,"CObfuScationSigner::VerifyMessage -- keys don't match: %s %s\n", signer, pubkeyID);
 
-    return (pubkey2.GetID() == pubkeyID);
+    return (signer == pubkeyID);
 }
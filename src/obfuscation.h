@@ -17,6 +17,8 @@ struct CObfuScationSigner
     static bool SetKey(std::string strSecret, std::string& errorMessage, CKey& key, CPubKey& pubkey);
     /// Sign the message, returns true if successful
     static bool SignMessage(std::string strMessage, std::string& errorMessage, std::vector<unsigned char>& vchSig, CKey key);
+    /// The hash that is signed for the message
+    static uint256 GetMessageHash(const std::string& strMessage);
     /// Verify the message, returns true if succcessful
     static bool VerifyMessage(CKeyID pubkeyID, const std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage);
 
@@ -0,0 +1,421 @@
+#ifndef PREVECTOR_H
+#define PREVECTOR_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#pragma pack(push, 1)
+/**
+ * A replacement for std::vector<T> that keeps up to N elements inside the
+ * object itself and only allocates once it grows past them.
+ *
+ * While the elements fit, they are stored directly in the object and _size
+ * is their count. Past N, the elements move to the heap and _size holds
+ * their count plus N + 1, which is how the two layouts are told apart.
+ *
+ * Elements are moved with memcpy and memmove, so T has to be a trivial type.
+ * Ordering and equality are those of std::vector.
+ */
+template <unsigned int N, typename T, typename Size = uint32_t, typename Diff = int32_t>
+class prevector
+{
+    static_assert(std::is_trivial<T>::value, "prevector elements are moved with memcpy");
+
+public:
+    typedef Size size_type;
+    typedef Diff difference_type;
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef value_type* pointer;
+    typedef const value_type* const_pointer;
+
+    class iterator
+    {
+        T* ptr;
+
+    public:
+        typedef Diff difference_type;
+        typedef T value_type;
+        typedef T* pointer;
+        typedef T& reference;
+        typedef std::random_access_iterator_tag iterator_category;
+        iterator() : ptr(nullptr) {}
+        iterator(T* ptr_) : ptr(ptr_) {}
+        T& operator*() const { return *ptr; }
+        T* operator->() const { return ptr; }
+        T& operator[](difference_type pos) const { return ptr[pos]; }
+        iterator& operator++() { ptr++; return *this; }
+        iterator& operator--() { ptr--; return *this; }
+        iterator operator++(int) { iterator copy(*this); ++(*this); return copy; }
+        iterator operator--(int) { iterator copy(*this); --(*this); return copy; }
+        iterator& operator+=(difference_type n) { ptr += n; return *this; }
+        iterator& operator-=(difference_type n) { ptr -= n; return *this; }
+        friend iterator operator+(iterator x, difference_type n) { return iterator(x.ptr + n); }
+        friend iterator operator+(difference_type n, iterator x) { return iterator(x.ptr + n); }
+        friend iterator operator-(iterator x, difference_type n) { return iterator(x.ptr - n); }
+        friend difference_type operator-(iterator a, iterator b) { return a.ptr - b.ptr; }
+        friend bool operator==(iterator a, iterator b) { return a.ptr == b.ptr; }
+        friend bool operator!=(iterator a, iterator b) { return a.ptr != b.ptr; }
+        friend bool operator<(iterator a, iterator b) { return a.ptr < b.ptr; }
+        friend bool operator>(iterator a, iterator b) { return a.ptr > b.ptr; }
+        friend bool operator<=(iterator a, iterator b) { return a.ptr <= b.ptr; }
+        friend bool operator>=(iterator a, iterator b) { return a.ptr >= b.ptr; }
+    };
+
+    class const_iterator
+    {
+        const T* ptr;
+
+    public:
+        typedef Diff difference_type;
+        typedef const T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+        typedef std::random_access_iterator_tag iterator_category;
+        const_iterator() : ptr(nullptr) {}
+        const_iterator(const T* ptr_) : ptr(ptr_) {}
+        const_iterator(iterator x) : ptr(&(*x)) {}
+        const T& operator*() const { return *ptr; }
+        const T* operator->() const { return ptr; }
+        const T& operator[](difference_type pos) const { return ptr[pos]; }
+        const_iterator& operator++() { ptr++; return *this; }
+        const_iterator& operator--() { ptr--; return *this; }
+        const_iterator operator++(int) { const_iterator copy(*this); ++(*this); return copy; }
+        const_iterator operator--(int) { const_iterator copy(*this); --(*this); return copy; }
+        const_iterator& operator+=(difference_type n) { ptr += n; return *this; }
+        const_iterator& operator-=(difference_type n) { ptr -= n; return *this; }
+        // Found through either operand, so iterators and const_iterators mix freely
+        friend const_iterator operator+(const_iterator x, difference_type n) { return const_iterator(x.ptr + n); }
+        friend const_iterator operator+(difference_type n, const_iterator x) { return const_iterator(x.ptr + n); }
+        friend const_iterator operator-(const_iterator x, difference_type n) { return const_iterator(x.ptr - n); }
+        friend difference_type operator-(const_iterator a, const_iterator b) { return a.ptr - b.ptr; }
+        friend bool operator==(const_iterator a, const_iterator b) { return a.ptr == b.ptr; }
+        friend bool operator!=(const_iterator a, const_iterator b) { return a.ptr != b.ptr; }
+        friend bool operator<(const_iterator a, const_iterator b) { return a.ptr < b.ptr; }
+        friend bool operator>(const_iterator a, const_iterator b) { return a.ptr > b.ptr; }
+        friend bool operator<=(const_iterator a, const_iterator b) { return a.ptr <= b.ptr; }
+        friend bool operator>=(const_iterator a, const_iterator b) { return a.ptr >= b.ptr; }
+    };
+
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+    union direct_or_indirect {
+        char direct[sizeof(T) * N];
+        struct {
+            char* indirect;
+            size_type capacity;
+        } indirect_contents;
+    } _union;
+    size_type _size;
+
+    T* direct_ptr(difference_type pos) { return reinterpret_cast<T*>(_union.direct) + pos; }
+    const T* direct_ptr(difference_type pos) const { return reinterpret_cast<const T*>(_union.direct) + pos; }
+    T* indirect_ptr(difference_type pos) { return reinterpret_cast<T*>(_union.indirect_contents.indirect) + pos; }
+    const T* indirect_ptr(difference_type pos) const { return reinterpret_cast<const T*>(_union.indirect_contents.indirect) + pos; }
+    bool is_direct() const { return _size <= N; }
+    T* item_ptr(difference_type pos) { return is_direct() ? direct_ptr(pos) : indirect_ptr(pos); }
+    const T* item_ptr(difference_type pos) const { return is_direct() ? direct_ptr(pos) : indirect_ptr(pos); }
+
+    void change_capacity(size_type new_capacity)
+    {
+        if (new_capacity <= N) {
+            if (!is_direct()) {
+                // The pointer is overwritten by the elements it points to
+                char* indirect = _union.indirect_contents.indirect;
+                memcpy(_union.direct, indirect, size() * sizeof(T));
+                free(indirect);
+                _size -= N + 1;
+            }
+        } else if (!is_direct()) {
+            // Running out of memory is not recovered from anywhere else either
+            _union.indirect_contents.indirect = static_cast<char*>(realloc(_union.indirect_contents.indirect, sizeof(T) * (size_t)new_capacity));
+            assert(_union.indirect_contents.indirect);
+            _union.indirect_contents.capacity = new_capacity;
+        } else {
+            char* new_indirect = static_cast<char*>(malloc(sizeof(T) * (size_t)new_capacity));
+            assert(new_indirect);
+            memcpy(new_indirect, _union.direct, size() * sizeof(T));
+            _union.indirect_contents.indirect = new_indirect;
+            _union.indirect_contents.capacity = new_capacity;
+            _size += N + 1;
+        }
+    }
+
+    //! Make room for at least new_size elements, growing by half again when it has to
+    void grow_for(size_type new_size)
+    {
+        if (capacity() < new_size)
+            change_capacity(new_size + (new_size >> 1));
+    }
+
+    template <typename InputIterator>
+    static void fill(T* dst, InputIterator first, InputIterator last)
+    {
+        std::copy(first, last, dst);
+    }
+
+    static void fill(T* dst, const T* first, const T* last)
+    {
+        if (first != last)
+            memmove(dst, first, (last - first) * sizeof(T));
+    }
+
+    static void fill(T* dst, const_iterator first, const_iterator last)
+    {
+        fill(dst, &(*first), &(*first) + (last - first));
+    }
+
+    static void fill(T* dst, iterator first, iterator last)
+    {
+        fill(dst, const_iterator(first), const_iterator(last));
+    }
+
+public:
+    prevector() : _size(0) {}
+
+    explicit prevector(size_type n) : _size(0)
+    {
+        resize(n);
+    }
+
+    prevector(size_type n, const T& val) : _size(0)
+    {
+        assign(n, val);
+    }
+
+    template <typename InputIterator, typename = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+    prevector(InputIterator first, InputIterator last) : _size(0)
+    {
+        assign(first, last);
+    }
+
+    prevector(const prevector& other) : _size(0)
+    {
+        assign(other.begin(), other.end());
+    }
+
+    prevector(prevector&& other) : _size(0)
+    {
+        swap(other);
+    }
+
+    ~prevector()
+    {
+        if (!is_direct())
+            free(_union.indirect_contents.indirect);
+    }
+
+    prevector& operator=(const prevector& other)
+    {
+        if (&other != this)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    prevector& operator=(prevector&& other)
+    {
+        if (&other != this) {
+            if (!is_direct())
+                free(_union.indirect_contents.indirect);
+            _union = other._union;
+            _size = other._size;
+            other._size = 0;
+        }
+        return *this;
+    }
+
+    void assign(size_type n, const T& val)
+    {
+        const T copy(val);
+        clear();
+        if (capacity() < n)
+            change_capacity(n);
+        std::fill_n(item_ptr(0), n, copy);
+        _size += n;
+    }
+
+    template <typename InputIterator, typename = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+    void assign(InputIterator first, InputIterator last)
+    {
+        const size_type n = std::distance(first, last);
+        clear();
+        if (capacity() < n)
+            change_capacity(n);
+        fill(item_ptr(0), first, last);
+        _size += n;
+    }
+
+    size_type size() const { return is_direct() ? _size : _size - N - 1; }
+    bool empty() const { return size() == 0; }
+    size_type capacity() const { return is_direct() ? N : _union.indirect_contents.capacity; }
+    //! Bytes allocated on the heap, not counting the object itself
+    size_t allocated_memory() const { return is_direct() ? 0 : sizeof(T) * (size_t)_union.indirect_contents.capacity; }
+
+    iterator begin() { return iterator(item_ptr(0)); }
+    const_iterator begin() const { return const_iterator(item_ptr(0)); }
+    iterator end() { return iterator(item_ptr(size())); }
+    const_iterator end() const { return const_iterator(item_ptr(size())); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    T& operator[](size_type pos) { return *item_ptr(pos); }
+    const T& operator[](size_type pos) const { return *item_ptr(pos); }
+    T& front() { return *item_ptr(0); }
+    const T& front() const { return *item_ptr(0); }
+    T& back() { return *item_ptr(size() - 1); }
+    const T& back() const { return *item_ptr(size() - 1); }
+    T* data() { return item_ptr(0); }
+    const T* data() const { return item_ptr(0); }
+
+    void resize(size_type new_size)
+    {
+        const size_type cur_size = size();
+        if (new_size <= cur_size) {
+            _size -= cur_size - new_size;
+            return;
+        }
+        resize_uninitialized(new_size);
+        std::fill_n(item_ptr(cur_size), new_size - cur_size, T());
+    }
+
+    //! Grow or shrink without initializing what is added, for it to be overwritten right away
+    void resize_uninitialized(size_type new_size)
+    {
+        const size_type cur_size = size();
+        if (new_size > capacity())
+            change_capacity(new_size);
+        if (new_size > cur_size)
+            _size += new_size - cur_size;
+        else
+            _size -= cur_size - new_size;
+    }
+
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity > capacity())
+            change_capacity(new_capacity);
+    }
+
+    void shrink_to_fit()
+    {
+        change_capacity(size());
+    }
+
+    //! Keeps the capacity, like std::vector; shrink_to_fit releases it
+    void clear()
+    {
+        resize(0);
+    }
+
+    iterator insert(const_iterator pos, const T& value)
+    {
+        const size_type p = pos - begin();
+        const T copy(value);
+        grow_for(size() + 1);
+        T* ptr = item_ptr(p);
+        memmove(ptr + 1, ptr, (size() - p) * sizeof(T));
+        _size++;
+        *ptr = copy;
+        return iterator(ptr);
+    }
+
+    iterator insert(const_iterator pos, size_type count, const T& value)
+    {
+        const size_type p = pos - begin();
+        const T copy(value);
+        grow_for(size() + count);
+        T* ptr = item_ptr(p);
+        memmove(ptr + count, ptr, (size() - p) * sizeof(T));
+        _size += count;
+        std::fill_n(ptr, count, copy);
+        return iterator(ptr);
+    }
+
+    template <typename InputIterator, typename = typename std::enable_if<!std::is_integral<InputIterator>::value>::type>
+    iterator insert(const_iterator pos, InputIterator first, InputIterator last)
+    {
+        const size_type p = pos - begin();
+        const size_type count = std::distance(first, last);
+        grow_for(size() + count);
+        T* ptr = item_ptr(p);
+        memmove(ptr + count, ptr, (size() - p) * sizeof(T));
+        _size += count;
+        fill(ptr, first, last);
+        return iterator(ptr);
+    }
+
+    //! Keeps the capacity, so a vector that shrinks below N stays on the heap until shrink_to_fit
+    iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        const size_type p = first - begin();
+        const size_type count = last - first;
+        T* ptr = item_ptr(p);
+        memmove(ptr, ptr + count, (size() - p - count) * sizeof(T));
+        _size -= count;
+        return iterator(ptr);
+    }
+
+    void push_back(const T& value)
+    {
+        const T copy(value);
+        grow_for(size() + 1);
+        *item_ptr(size()) = copy;
+        _size++;
+    }
+
+    void pop_back()
+    {
+        _size--;
+    }
+
+    void swap(prevector& other)
+    {
+        std::swap(_union, other._union);
+        std::swap(_size, other._size);
+    }
+
+    friend void swap(prevector& a, prevector& b)
+    {
+        a.swap(b);
+    }
+
+    bool operator==(const prevector& other) const
+    {
+        return size() == other.size() && std::equal(data(), data() + size(), other.data());
+    }
+
+    bool operator!=(const prevector& other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator<(const prevector& other) const
+    {
+        return std::lexicographical_compare(data(), data() + size(), other.data(), other.data() + other.size());
+    }
+
+    bool operator>(const prevector& other) const { return other < *this; }
+    bool operator<=(const prevector& other) const { return !(other < *this); }
+    bool operator>=(const prevector& other) const { return !(*this < other); }
+};
+#pragma pack(pop)
+
+#endif// PREVECTOR_H
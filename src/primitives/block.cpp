@@ -6,15 +6,52 @@
 
 #include "primitives/block.h"
 
+#include "crypto/sha256.h"
 #include "hash.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "Logging.h"
 
+#include <assert.h>
+#include <string.h>
+
+#include <boost/thread/tss.hpp>
+
+namespace
+{
+/** The last legacy header a thread hashed. Accepting a block hashes its header
+ *  several times over, which is expensive with the Quark kernels. */
+struct QuarkHashCache {
+    bool fValid;
+    unsigned char header[80];
+    uint256 hash;
+
+    QuarkHashCache() : fValid(false) {}
+};
+
+boost::thread_specific_ptr<QuarkHashCache> quarkHashCache;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
     if(nVersion < 4)
-        return HashQuark(BEGIN(nVersion), END(nNonce));
+    {
+        const char* const pbegin = BEGIN(nVersion);
+        const char* const pend = END(nNonce);
+        const size_t nSize = pend - pbegin;
+        assert(nSize == sizeof(QuarkHashCache().header));
+        QuarkHashCache* cache = quarkHashCache.get();
+        if (cache == NULL) {
+            cache = new QuarkHashCache();
+            quarkHashCache.reset(cache);
+        }
+        if (!cache->fValid || memcmp(cache->header, pbegin, nSize) != 0) {
+            cache->hash = HashQuark(pbegin, pend);
+            memcpy(cache->header, pbegin, nSize);
+            cache->fValid = true;
+        }
+        return cache->hash;
+    }
 
     return Hash(BEGIN(nVersion), END(nAccumulatorCheckpoint));
 }
@@ -64,15 +101,17 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     bool mutated = false;
     for (int nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        if (nSize % 2 == 0 && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // The pairs lie next to each other, so the whole level is hashed as a batch of 64 byte blobs.
+        const int nPairs = nSize / 2;
+        vMerkleTree.resize(j + nSize + (nSize + 1) / 2);
+        SHA256D64(vMerkleTree[j+nSize].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize % 2) {
+            const uint256& last = vMerkleTree[j+nSize-1];
+            vMerkleTree[j+nSize+nPairs] = Hash(BEGIN(last), END(last), BEGIN(last), END(last));
         }
         j += nSize;
     }
@@ -82,6 +121,37 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
 }
 
+uint256 CBlock::ComputeMerkleRoot(bool* fMutated) const
+{
+    std::vector<uint256> hashes;
+    hashes.reserve(vtx.size() + 1); // Room to pair the last hash with itself without reallocating.
+    for (std::vector<CTransaction>::const_iterator it(vtx.begin()); it != vtx.end(); ++it)
+        hashes.push_back(it->GetHash());
+    return ComputeMerkleRootInPlace(hashes, fMutated);
+}
+
+uint256 CBlock::ComputeMerkleRootInPlace(std::vector<uint256>& hashes, bool* fMutated)
+{
+    // The same tree as BuildMerkleTree, see the warning there. Each level is
+    // written over the start of the one below it, which SHA256D64 allows as
+    // every batch reads its input before writing its output.
+    bool mutated = false;
+    while (hashes.size() > 1) {
+        if (hashes.size() % 2 == 0 && hashes[hashes.size() - 2] == hashes[hashes.size() - 1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        if (hashes.size() % 2)
+            hashes.push_back(hashes.back());
+        SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
+        hashes.resize(hashes.size() / 2);
+    }
+    if (fMutated) {
+        *fMutated = mutated;
+    }
+    return (hashes.empty() ? uint256() : hashes[0]);
+}
+
 std::vector<uint256> CBlock::GetMerkleBranch(int nIndex) const
 {
     if (vMerkleTree.empty())
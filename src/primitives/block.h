@@ -157,6 +157,14 @@ public:
     // merkle root).
     uint256 BuildMerkleTree(bool* mutated = NULL) const;
 
+    // Compute the merkle root without keeping the tree, setting *mutated as
+    // BuildMerkleTree does. Use this when only the root is checked; the tree is
+    // built on demand by GetMerkleBranch.
+    uint256 ComputeMerkleRoot(bool* mutated = NULL) const;
+
+    // Reduce the hashes to their merkle root in place, overwriting them.
+    static uint256 ComputeMerkleRootInPlace(std::vector<uint256>& hashes, bool* mutated = NULL);
+
     std::vector<uint256> GetMerkleBranch(int nIndex) const;
     static uint256 CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMerkleBranch, int nIndex);
     std::string ToString() const;
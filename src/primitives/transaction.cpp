@@ -244,6 +244,15 @@ void CTransaction::UpdateHash() const
     *const_cast<uint256*>(&hash) = SerializeHash(*this);
 }
 
+void CTransaction::UpdateHash(const char* serializedBegin, const char* serializedEnd) const
+{
+    // Sizes are read canonically, so the bytes read are the serialization being hashed
+    if (serializedBegin == NULL)
+        UpdateHash();
+    else
+        *const_cast<uint256*>(&hash) = Hash(serializedBegin, serializedEnd);
+}
+
 uint256 CTransaction::GetBareTxid () const
 {
     if (IsCoinBase())
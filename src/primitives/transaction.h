@@ -13,6 +13,7 @@
 #include "uint256.h"
 
 #include <list>
+#include <memory>
 
 /** An outpoint - a combination of a transaction hash and an index n into its vout */
 class COutPoint
@@ -114,6 +115,8 @@ private:
     /** Memory only. */
     const uint256 hash;
     void UpdateHash() const;
+    //! Hashes the bytes the transaction was read from, if the stream kept them in place
+    void UpdateHash(const char* serializedBegin, const char* serializedEnd) const;
 
 public:
     static const int32_t CURRENT_VERSION=1;
@@ -141,13 +144,14 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        const char* const serializedBegin = ser_action.ForRead() ? GetReadPosition(s) : NULL;
         READWRITE(*const_cast<int32_t*>(&this->nVersion));
         nVersion = this->nVersion;
         READWRITE(*const_cast<std::vector<CTxIn>*>(&vin));
         READWRITE(*const_cast<std::vector<CTxOut>*>(&vout));
         READWRITE(*const_cast<uint32_t*>(&nLockTime));
         if (ser_action.ForRead())
-            UpdateHash();
+            UpdateHash(serializedBegin, GetReadPosition(s));
     }
 
     bool IsNull() const;
@@ -197,4 +201,8 @@ struct CMutableTransaction
     CAmount GetValueOut() const;
 };
 
+/** A transaction shared by everything holding on to it, rather than copied into each */
+typedef std::shared_ptr<const CTransaction> CTransactionRef;
+static inline CTransactionRef MakeTransactionRef(const CTransaction& tx) { return std::make_shared<const CTransaction>(tx); }
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
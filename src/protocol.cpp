@@ -29,7 +29,8 @@ static const char* ppszTypeName[] = {
     "mn budget finalized vote",
     "mn quorum",
     "mn announce",
-    "mn ping"
+    "mn ping",
+    "compact block"
 };
 
 CMessageHeader::CMessageHeader()
@@ -121,7 +122,7 @@ CInv::CInv(const std::string& strType, const uint256& hashIn)
         }
     }
     if (i == ARRAYLEN(ppszTypeName))
-        LogPrint("net", "CInv::CInv(string, uint256) : unknown type '%s'", strType);
+        LogPrint(LOG_NET, "CInv::CInv(string, uint256) : unknown type '%s'", strType);
     hash = hashIn;
 }
 
@@ -136,13 +137,13 @@ bool CInv::IsKnownType() const
 }
 
 bool CInv::IsMasterNodeType() const{
-    return (type >= 6);
+    return (type >= MSG_SPORK && type <= MSG_MASTERNODE_PING);
 }
 
 const char* CInv::GetCommand() const
 {
     if (!IsKnownType())
-        LogPrint("net", "CInv::GetCommand() : type=%d unknown type", type);
+        LogPrint(LOG_NET, "CInv::GetCommand() : type=%d unknown type", type);
 
     return ppszTypeName[type];
 }
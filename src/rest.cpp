@@ -4,17 +4,27 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "main.h"
+#include "miner.h"
 #include "BlockDiskAccessor.h"
+#include <CachingBlockDataReader.h>
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "rpcserver.h"
 #include "streams.h"
 #include "sync.h"
 #include <TransactionDiskAccessor.h>
+#include <RPCResponseCache.h>
 #include "utilstrencodings.h"
 #include "version.h"
 #include <blockmap.h>
 #include <sync.h>
+#include <StakingStatistics.h>
+#include <MemoryStatistics.h>
+#include <PerformanceStatistics.h>
+#include <tinyformat.h>
+
+#include <CoinsSnapshotPublisher.h>
+#include <txmempool.h>
 
 #include <boost/algorithm/string.hpp>
 
@@ -23,6 +33,13 @@ using namespace json_spirit;
 
 extern BlockMap mapBlockIndex;
 extern CCriticalSection cs_main;
+extern bool fHavePruned;
+extern CTxMemPool mempool;
+
+/** Block headers a single /rest/headers request may ask for */
+static const unsigned int MAX_REST_HEADERS_RESULTS = 2000;
+/** Outpoints a single /rest/getutxos request may ask for */
+static const size_t MAX_GETUTXOS_OUTPOINTS = 15;
 
 enum RetFormat {
     RF_UNDEF,
@@ -50,6 +67,12 @@ public:
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, Object& entry);
 extern Object blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern Object blockHeaderToJSON(const CBlock& block, const CBlockIndex* blockindex);
+extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, Object& out, bool fIncludeHex);
+extern unsigned int CountOrphanedStakes(const std::vector<uint256>& stakedBlocks);
+extern Object StakingStatisticsToJSON(const StakingStatistics::Snapshot& snapshot, unsigned int nOrphanedStakes);
+extern Object PerformanceStatisticsToJSON(const std::vector<PerformanceTimerStats>& stats);
+extern Object SubsystemMemoryUsageToJSON(const std::vector<SubsystemMemoryUsage>& usage);
 
 static RestErr RESTERR(enum HTTPStatusCode status, string message)
 {
@@ -59,6 +82,23 @@ static RestErr RESTERR(enum HTTPStatusCode status, string message)
     return re;
 }
 
+/** An unspent output as /rest/getutxos returns it */
+struct CCoin {
+    uint32_t nTxVer; // Don't call this nVersion, that name has a special meaning inside the serialization methods
+    uint32_t nHeight;
+    CTxOut out;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(nTxVer);
+        READWRITE(nHeight);
+        READWRITE(out);
+    }
+};
+
 static enum RetFormat ParseDataFormat(std::vector<std::string>& params, const string strReq)
 {
     boost::split(params, strReq, boost::is_any_of("."));
@@ -100,6 +140,7 @@ static bool rest_block(AcceptedConnection* conn,
     string& strReq,
     map<string, string>& mapHeaders,
     bool fRun,
+    int nProto,
     bool showTxDetails)
 {
     std::vector<std::string> params;
@@ -111,20 +152,29 @@ static bool rest_block(AcceptedConnection* conn,
         throw RESTERR(HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
     CBlock block;
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
     CBlockIndex* pblockindex = NULL;
+    const RPCResponseCacheKey cacheKey("rest/block", hash, showTxDetails ? 2 : 1);
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
             throw RESTERR(HTTP_NOT_FOUND, hashStr + " not found");
 
         pblockindex = mapBlockIndex[hash];
-        if (!ReadBlockFromDisk(block, pblockindex))
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw RESTERR(HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
+
+        Value cached;
+        if (rf == RF_JSON && GetRPCResponseCache().Find(cacheKey, chainActive.Height(), cached)) {
+            WriteHTTPJSONReply(conn->stream(), HTTP_OK, cached, fRun, nProto);
+            return true;
+        }
+
+        // Binary and hex replies pass the block on as it was stored
+        if (rf == RF_JSON ? !GetRecentBlockDataReader().ReadBlock(pblockindex, block) : !ReadRawBlockFromDisk(ssBlock, pblockindex))
             throw RESTERR(HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
     switch (rf) {
     case RF_BINARY: {
         string binaryBlock = ssBlock.str();
@@ -139,9 +189,13 @@ static bool rest_block(AcceptedConnection* conn,
     }
 
     case RF_JSON: {
-        Object objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = write_string(Value(objBlock), false) + "\n";
-        conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+        const Value result = blockToJSON(block, pblockindex, showTxDetails);
+        if (GetRPCResponseCache().IsCacheable(pblockindex->nHeight, chainActive.Height())) {
+            LOCK(cs_main);
+            if (chainActive.Contains(pblockindex))
+                GetRPCResponseCache().Insert(cacheKey, result, pblockindex->nHeight, chainActive.Height());
+        }
+        WriteHTTPJSONReply(conn->stream(), HTTP_OK, result, fRun, nProto);
         return true;
     }
 
@@ -157,23 +211,26 @@ static bool rest_block(AcceptedConnection* conn,
 static bool rest_block_extended(AcceptedConnection* conn,
     string& strReq,
     map<string, string>& mapHeaders,
-    bool fRun)
+    bool fRun,
+    int nProto)
 {
-    return rest_block(conn, strReq, mapHeaders, fRun, true);
+    return rest_block(conn, strReq, mapHeaders, fRun, nProto, true);
 }
 
 static bool rest_block_notxdetails(AcceptedConnection* conn,
     string& strReq,
     map<string, string>& mapHeaders,
-    bool fRun)
+    bool fRun,
+    int nProto)
 {
-    return rest_block(conn, strReq, mapHeaders, fRun, false);
+    return rest_block(conn, strReq, mapHeaders, fRun, nProto, false);
 }
 
 static bool rest_tx(AcceptedConnection* conn,
     std::string& strReq,
     std::map<std::string, std::string>& mapHeaders,
-    bool fRun)
+    bool fRun,
+    int nProto)
 {
     std::vector<std::string> params;
     enum RetFormat rf = ParseDataFormat(params, strReq);
@@ -221,22 +278,424 @@ static bool rest_tx(AcceptedConnection* conn,
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+/** Runs an RPC command whose reply an endpoint passes on, turning its errors into REST errors */
+static Value ExecuteForREST(const string& strMethod, const Array& params)
+{
+    try {
+        return tableRPC.execute(strMethod, params);
+    } catch (Object& objError) {
+        const Value& message = find_value(objError, "message");
+        throw RESTERR(HTTP_INTERNAL_SERVER_ERROR, message.type() == str_type ? message.get_str() : strMethod + " failed");
+    }
+}
+
+static bool rest_headers(AcceptedConnection* conn,
+    std::string& strReq,
+    std::map<std::string, std::string>& mapHeaders,
+    bool fRun,
+    int nProto)
+{
+    std::vector<std::string> params;
+    enum RetFormat rf = ParseDataFormat(params, strReq);
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        throw RESTERR(HTTP_BAD_REQUEST, "No header count specified. Use /rest/headers/<count>/<hash>.<ext>.");
+
+    int32_t count = 0;
+    if (!ParseInt32(path[0], &count) || count < 1 || (unsigned int)count > MAX_REST_HEADERS_RESULTS)
+        throw RESTERR(HTTP_BAD_REQUEST, strprintf("Header count out of range: %s", path[0]));
+
+    string hashStr = path[1];
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        throw RESTERR(HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    // Only the lookup needs cs_main: the active chain is walked from the tip
+    // snapshot, whose ancestors never change
+    const CBlockIndex* pindex = NULL;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        if (it != mapBlockIndex.end())
+            pindex = it->second;
+    }
+    std::vector<const CBlockIndex*> headers;
+    const CBlockIndex* tip = GetChainTipSnapshot();
+    if (pindex && tip && tip->GetAncestor(pindex->nHeight) == pindex) {
+        for (int height = pindex->nHeight; height <= tip->nHeight && headers.size() < (size_t)count; height++)
+            headers.push_back(tip->GetAncestor(height));
+    }
+
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_FOREACH (const CBlockIndex* pheader, headers)
+        ssHeader << pheader->GetBlockHeader();
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryHeader = ssHeader.str();
+        conn->stream() << HTTPReplyHeader(HTTP_OK, fRun, binaryHeader.size(), "application/octet-stream") << binaryHeader << std::flush;
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssHeader.begin(), ssHeader.end()) + "\n";
+        conn->stream() << HTTPReply(HTTP_OK, strHex, fRun, false, "text/plain") << std::flush;
+        return true;
+    }
+
+    case RF_JSON: {
+        Array jsonHeaders;
+        BOOST_FOREACH (const CBlockIndex* pheader, headers) {
+            Object objHeader;
+            objHeader.push_back(Pair("hash", pheader->GetBlockHash().GetHex()));
+            objHeader.push_back(Pair("height", pheader->nHeight));
+            const Object fields = blockHeaderToJSON(CBlock(pheader->GetBlockHeader()), pheader);
+            objHeader.insert(objHeader.end(), fields.begin(), fields.end());
+            jsonHeaders.push_back(objHeader);
+        }
+        WriteHTTPJSONReply(conn->stream(), HTTP_OK, jsonHeaders, fRun, nProto);
+        return true;
+    }
+
+    default: {
+        throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_getutxos(AcceptedConnection* conn,
+    std::string& strReq,
+    std::map<std::string, std::string>& mapHeaders,
+    bool fRun,
+    int nProto)
+{
+    std::vector<std::string> params;
+    enum RetFormat rf = ParseDataFormat(params, strReq);
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    // Outpoints as <txid>-<n>, after an optional checkmempool
+    bool fCheckMemPool = false;
+    size_t first = 0;
+    if (!path.empty() && path[0] == "checkmempool") {
+        fCheckMemPool = true;
+        first = 1;
+    }
+    if (path.size() <= first || path[first].empty())
+        throw RESTERR(HTTP_BAD_REQUEST, "Error: empty request");
+    if (path.size() - first > MAX_GETUTXOS_OUTPOINTS)
+        throw RESTERR(HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", MAX_GETUTXOS_OUTPOINTS, path.size() - first));
+
+    std::vector<COutPoint> vOutPoints;
+    for (size_t i = first; i < path.size(); i++) {
+        const size_t separator = path[i].find('-');
+        uint256 txid;
+        int32_t nOutput = 0;
+        if (separator == string::npos ||
+            !ParseHashStr(path[i].substr(0, separator), txid) ||
+            !ParseInt32(path[i].substr(separator + 1), &nOutput) || nOutput < 0)
+            throw RESTERR(HTTP_BAD_REQUEST, "Parse error: " + path[i]);
+        vOutPoints.push_back(COutPoint(txid, (uint32_t)nOutput));
+    }
+
+    // Read from a snapshot of the coins tip, so blocks keep being connected meanwhile
+    CoinsSnapshot snapshot;
+    if (!GetCoinsSnapshot(snapshot))
+        throw RESTERR(HTTP_INTERNAL_SERVER_ERROR, "Unable to read UTXO set");
+
+    std::vector<unsigned char> bitmap((vOutPoints.size() + 7) / 8);
+    std::vector<CCoin> outs;
+    string bitmapStringRepresentation;
+    {
+        LOCK(mempool.cs);
+        CCoinsViewMemPool viewMempool(snapshot.view.get(), mempool);
+        const CCoinsView& view = fCheckMemPool ? static_cast<const CCoinsView&>(viewMempool) : *snapshot.view;
+        for (size_t i = 0; i < vOutPoints.size(); i++) {
+            CCoins coins;
+            uint256 hash = vOutPoints[i].hash;
+            bool hit = false;
+            if (view.GetCoins(hash, coins)) {
+                if (fCheckMemPool)
+                    mempool.pruneSpent(hash, coins);
+                if (coins.IsAvailable(vOutPoints[i].n)) {
+                    hit = true;
+                    CCoin coin;
+                    coin.nTxVer = coins.nVersion;
+                    coin.nHeight = coins.nHeight;
+                    coin.out = coins.vout.at(vOutPoints[i].n);
+                    outs.push_back(coin);
+                }
+            }
+            bitmapStringRepresentation.append(hit ? "1" : "0");
+            bitmap[i / 8] |= ((uint8_t)hit) << (i % 8);
+        }
+    }
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssGetUTXOResponse(SER_NETWORK, PROTOCOL_VERSION);
+        ssGetUTXOResponse << snapshot.nHeight << snapshot.hashBlock << bitmap << outs;
+        if (rf == RF_BINARY) {
+            string ssGetUTXOResponseString = ssGetUTXOResponse.str();
+            conn->stream() << HTTPReplyHeader(HTTP_OK, fRun, ssGetUTXOResponseString.size(), "application/octet-stream") << ssGetUTXOResponseString << std::flush;
+        } else {
+            string strHex = HexStr(ssGetUTXOResponse.begin(), ssGetUTXOResponse.end()) + "\n";
+            conn->stream() << HTTPReply(HTTP_OK, strHex, fRun, false, "text/plain") << std::flush;
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        Object objGetUTXOResponse;
+        objGetUTXOResponse.push_back(Pair("chainHeight", snapshot.nHeight));
+        objGetUTXOResponse.push_back(Pair("chaintipHash", snapshot.hashBlock.GetHex()));
+        objGetUTXOResponse.push_back(Pair("bitmap", bitmapStringRepresentation));
+
+        Array utxos;
+        BOOST_FOREACH (const CCoin& coin, outs) {
+            Object utxo;
+            utxo.push_back(Pair("txvers", (int32_t)coin.nTxVer));
+            utxo.push_back(Pair("height", (int32_t)coin.nHeight));
+            utxo.push_back(Pair("value", ValueFromAmount(coin.out.nValue)));
+            Object o;
+            ScriptPubKeyToJSON(coin.out.scriptPubKey, o, true);
+            utxo.push_back(Pair("scriptPubKey", o));
+            utxos.push_back(utxo);
+        }
+        objGetUTXOResponse.push_back(Pair("utxos", utxos));
+
+        string strJSON = write_string(Value(objGetUTXOResponse), false) + "\n";
+        conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+        return true;
+    }
+
+    default: {
+        throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_chaininfo(AcceptedConnection* conn,
+    std::string& strReq,
+    std::map<std::string, std::string>& mapHeaders,
+    bool fRun,
+    int nProto)
+{
+    std::vector<std::string> params;
+    enum RetFormat rf = ParseDataFormat(params, strReq);
+    if (!params[0].empty())
+        throw RESTERR(HTTP_NOT_FOUND, "unknown chain information " + params[0]);
+    if (rf != RF_JSON)
+        throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: json)");
+
+    string strJSON = write_string(ExecuteForREST("getblockchaininfo", Array()), false) + "\n";
+    conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+    return true;
+}
+
+static bool rest_mempool(AcceptedConnection* conn,
+    std::string& strReq,
+    std::map<std::string, std::string>& mapHeaders,
+    bool fRun,
+    int nProto)
+{
+    std::vector<std::string> params;
+    enum RetFormat rf = ParseDataFormat(params, strReq);
+    if (rf != RF_JSON)
+        throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: json)");
+
+    // Both are served by commands that take no locks beyond mempool.cs
+    if (params[0] == "info") {
+        string strJSON = write_string(ExecuteForREST("getmempoolinfo", Array()), false) + "\n";
+        conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+        return true;
+    }
+    if (params[0] == "contents") {
+        Array verbose;
+        verbose.push_back(true);
+        WriteHTTPJSONReply(conn->stream(), HTTP_OK, ExecuteForREST("getrawmempool", verbose), fRun, nProto);
+        return true;
+    }
+    throw RESTERR(HTTP_NOT_FOUND, "unknown mempool information " + params[0] + " (available: info, contents)");
+}
+
+/** The staking statistics in the Prometheus text exposition format */
+static string StakingStatisticsToPrometheusText(const StakingStatistics::Snapshot& snapshot, unsigned int nOrphanedStakes)
+{
+    string text;
+    text += "# TYPE izzy_staking_attempts_total counter\n";
+    text += strprintf("izzy_staking_attempts_total %u\n", snapshot.attempts);
+    text += "# TYPE izzy_staking_coins_scanned_total counter\n";
+    text += strprintf("izzy_staking_coins_scanned_total %u\n", snapshot.coinsScanned);
+    text += "# TYPE izzy_staking_kernels_hashed_total counter\n";
+    text += strprintf("izzy_staking_kernels_hashed_total %u\n", snapshot.kernelsHashed);
+    text += "# TYPE izzy_staking_stakes_found_total counter\n";
+    text += strprintf("izzy_staking_stakes_found_total %u\n", snapshot.stakesFound);
+    text += "# TYPE izzy_staking_blocks_accepted_total counter\n";
+    text += strprintf("izzy_staking_blocks_accepted_total %u\n", snapshot.blocksAccepted);
+    text += "# TYPE izzy_staking_orphaned_stakes gauge\n";
+    text += strprintf("izzy_staking_orphaned_stakes %u\n", nOrphanedStakes);
+
+    text += "# TYPE izzy_staking_misses_total counter\n";
+    for (unsigned miss = 0; miss < StakingStatistics::NUMBER_OF_MISSES; miss++)
+        text += strprintf("izzy_staking_misses_total{reason=\"%s\"} %u\n",
+            StakingStatistics::MissName(static_cast<StakingMiss>(miss)), snapshot.misses[miss]);
+
+    text += "# TYPE izzy_staking_stage_seconds histogram\n";
+    for (unsigned stage = 0; stage < StakingStatistics::NUMBER_OF_STAGES; stage++) {
+        const StakingStatistics::StageTimings& timings = snapshot.stages[stage];
+        const char* stageName = StakingStatistics::StageName(static_cast<StakingStage>(stage));
+        uint64_t cumulativeCount = 0;
+        for (unsigned bucket = 0; bucket < StakingStatistics::NUMBER_OF_BUCKETS; bucket++) {
+            cumulativeCount += timings.buckets[bucket];
+            const int64_t upperBound = StakingStatistics::BucketUpperBound(bucket);
+            const string le = upperBound < 0 ? string("+Inf") : strprintf("%g", upperBound / 1000000.0);
+            text += strprintf("izzy_staking_stage_seconds_bucket{stage=\"%s\",le=\"%s\"} %u\n", stageName, le, cumulativeCount);
+        }
+        text += strprintf("izzy_staking_stage_seconds_sum{stage=\"%s\"} %.6f\n", stageName, timings.totalMicros / 1000000.0);
+        text += strprintf("izzy_staking_stage_seconds_count{stage=\"%s\"} %u\n", stageName, timings.count);
+    }
+    return text;
+}
+
+static bool rest_stakingstats(AcceptedConnection* conn,
+    std::string& strReq,
+    std::map<std::string, std::string>& mapHeaders,
+    bool fRun,
+    int nProto)
+{
+    std::vector<std::string> params;
+    enum RetFormat rf = ParseDataFormat(params, strReq);
+    if (!params[0].empty())
+        throw RESTERR(HTTP_NOT_FOUND, "unknown staking statistics " + params[0]);
+
+    const StakingStatistics::Snapshot snapshot = GetStakingStatistics().GetSnapshot();
+    const unsigned int nOrphanedStakes = CountOrphanedStakes(snapshot.stakedBlocks);
+
+    if (rf == RF_JSON) {
+        string strJSON = write_string(Value(StakingStatisticsToJSON(snapshot, nOrphanedStakes)), false) + "\n";
+        conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+        return true;
+    }
+    if (params.size() > 1 && params[1] == "txt") {
+        conn->stream() << HTTPReply(HTTP_OK, StakingStatisticsToPrometheusText(snapshot, nOrphanedStakes), fRun, false, "text/plain; version=0.0.4") << std::flush;
+        return true;
+    }
+    throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: .json, .txt)");
+}
+
+/** The hot path timings in the Prometheus text exposition format */
+static string PerformanceStatisticsToPrometheusText(const std::vector<PerformanceTimerStats>& stats)
+{
+    string text;
+    text += "# TYPE izzy_hot_path_seconds histogram\n";
+    for (const PerformanceTimerStats& timer : stats) {
+        uint64_t cumulativeCount = 0;
+        for (unsigned bucket = 0; bucket < PerformanceTimerStats::NUMBER_OF_BUCKETS; bucket++) {
+            cumulativeCount += timer.buckets[bucket];
+            const int64_t upperBound = PerformanceTimerStats::BucketUpperBound(bucket);
+            const string le = upperBound < 0 ? string("+Inf") : strprintf("%g", upperBound / 1000000.0);
+            text += strprintf("izzy_hot_path_seconds_bucket{path=\"%s\",le=\"%s\"} %u\n", timer.name, le, cumulativeCount);
+        }
+        text += strprintf("izzy_hot_path_seconds_sum{path=\"%s\"} %.6f\n", timer.name, timer.totalMicros / 1000000.0);
+        text += strprintf("izzy_hot_path_seconds_count{path=\"%s\"} %u\n", timer.name, timer.count);
+    }
+    text += "# TYPE izzy_hot_path_max_seconds gauge\n";
+    for (const PerformanceTimerStats& timer : stats)
+        text += strprintf("izzy_hot_path_max_seconds{path=\"%s\"} %.6f\n", timer.name, timer.maximumMicros / 1000000.0);
+    return text;
+}
+
+/** The memory taken up by the node's structures in the Prometheus text exposition format */
+static string SubsystemMemoryUsageToPrometheusText(const std::vector<SubsystemMemoryUsage>& usage)
+{
+    string text;
+    text += "# TYPE izzy_memory_bytes gauge\n";
+    for (const SubsystemMemoryUsage& subsystem : usage)
+        text += strprintf("izzy_memory_bytes{subsystem=\"%s\"} %u\n", subsystem.name, subsystem.bytes);
+    text += "# TYPE izzy_memory_entries gauge\n";
+    for (const SubsystemMemoryUsage& subsystem : usage)
+        text += strprintf("izzy_memory_entries{subsystem=\"%s\"} %u\n", subsystem.name, subsystem.entries);
+    return text;
+}
+
+static bool rest_memorystats(AcceptedConnection* conn,
+    enum RetFormat rf,
+    const std::vector<std::string>& params,
+    bool fRun)
+{
+    const std::vector<SubsystemMemoryUsage> usage = GetSubsystemMemoryUsage();
+    if (rf == RF_JSON) {
+        string strJSON = write_string(Value(SubsystemMemoryUsageToJSON(usage)), false) + "\n";
+        conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+        return true;
+    }
+    if (params.size() > 1 && params[1] == "txt") {
+        conn->stream() << HTTPReply(HTTP_OK, SubsystemMemoryUsageToPrometheusText(usage), fRun, false, "text/plain; version=0.0.4") << std::flush;
+        return true;
+    }
+    throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: .json, .txt)");
+}
+
+static bool rest_perfstats(AcceptedConnection* conn,
+    std::string& strReq,
+    std::map<std::string, std::string>& mapHeaders,
+    bool fRun,
+    int nProto)
+{
+    std::vector<std::string> params;
+    enum RetFormat rf = ParseDataFormat(params, strReq);
+    if (params[0] == "/memory")
+        return rest_memorystats(conn, rf, params, fRun);
+    if (!params[0].empty())
+        throw RESTERR(HTTP_NOT_FOUND, "unknown performance statistics " + params[0]);
+
+    const std::vector<PerformanceTimerStats> stats = PerformanceStatistics::GetStats();
+    if (rf == RF_JSON) {
+        string strJSON = write_string(Value(PerformanceStatisticsToJSON(stats)), false) + "\n";
+        conn->stream() << HTTPReply(HTTP_OK, strJSON, fRun) << std::flush;
+        return true;
+    }
+    if (params.size() > 1 && params[1] == "txt") {
+        conn->stream() << HTTPReply(HTTP_OK, PerformanceStatisticsToPrometheusText(stats), fRun, false, "text/plain; version=0.0.4") << std::flush;
+        return true;
+    }
+    throw RESTERR(HTTP_NOT_FOUND, "output format not found (available: .json, .txt)");
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(AcceptedConnection* conn,
         string& strURI,
         map<string, string>& mapHeaders,
-        bool fRun);
+        bool fRun,
+        int nProto);
 } uri_prefixes[] = {
     {"/rest/tx/", rest_tx},
     {"/rest/block/notxdetails/", rest_block_notxdetails},
     {"/rest/block/", rest_block_extended},
+    {"/rest/stakingstats", rest_stakingstats},
+    {"/rest/perfstats", rest_perfstats},
+    {"/rest/headers/", rest_headers},
+    {"/rest/getutxos/", rest_getutxos},
+    {"/rest/chaininfo", rest_chaininfo},
+    {"/rest/mempool/", rest_mempool},
 };
 
 bool HTTPReq_REST(AcceptedConnection* conn,
     string& strURI,
     map<string, string>& mapHeaders,
-    bool fRun)
+    bool fRun,
+    int nProto)
 {
     try {
         std::string statusmessage;
@@ -247,7 +706,7 @@ bool HTTPReq_REST(AcceptedConnection* conn,
             unsigned int plen = strlen(uri_prefixes[i].prefix);
             if (strURI.substr(0, plen) == uri_prefixes[i].prefix) {
                 string strReq = strURI.substr(plen);
-                return uri_prefixes[i].handler(conn, strReq, mapHeaders, fRun);
+                return uri_prefixes[i].handler(conn, strReq, mapHeaders, fRun, nProto);
             }
         }
     } catch (RestErr& re) {
@@ -8,6 +8,10 @@
 #include "checkpoints.h"
 #include "main.h"
 #include "BlockDiskAccessor.h"
+#include <CachingBlockDataReader.h>
+#include <RecentTransactionCache.h>
+#include <RPCResponseCache.h>
+#include <TransactionDiskAccessor.h>
 #include <rpcserver.h>
 #include "sync.h"
 #include "util.h"
@@ -18,12 +22,21 @@
 #include "base58.h"
 #include <ValidationState.h>
 #include <verifyDb.h>
+#include <ChainstateVerifier.h>
 #include <ui_interface.h>
 #include <txdb.h>
 #include <ActiveChainManager.h>
 #include <boost/foreach.hpp>
 #include <utilstrencodings.h>
 #include <txmempool.h>
+#include <UtxoSnapshot.h>
+#include <CoinsSnapshotPublisher.h>
+#include <DataDirectory.h>
+#include <OrphanTransactions.h>
+#include <BlockStats.h>
+#include <CoinSupply.h>
+
+#include <boost/filesystem/operations.hpp>
 
 using namespace json_spirit;
 using namespace std;
@@ -34,9 +47,13 @@ extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, Object& en
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, Object& out, bool fIncludeHex);
 extern bool ShutdownRequested();
 extern CBlockTreeDB* pblocktree;
+extern CCoinsViewDB* pcoinsdbview;
 extern CCoinsViewCache* pcoinsTip;
 extern bool fAddressIndex;
+extern bool fPruneMode;
+extern bool fHavePruned;
 extern BlockMap mapBlockIndex;
+extern std::set<const CBlockIndex*> setBlockIndexTips;
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
 extern CBlockIndex* pindexBestHeader;
@@ -125,6 +142,46 @@ Object blockHeaderToJSON(const CBlock& block, const CBlockIndex* blockindex)
     return result;
 }
 
+Object blockStatsToJSON(const BlockStats& stats)
+{
+    Object result;
+    result.push_back(Pair("hash", stats.blockHash.GetHex()));
+    result.push_back(Pair("height", stats.nHeight));
+    result.push_back(Pair("time", (int64_t)stats.nTime));
+    result.push_back(Pair("txs", (int)stats.nTx));
+    result.push_back(Pair("ins", (int)stats.nInputs));
+    result.push_back(Pair("outs", (int)stats.nOutputs));
+    result.push_back(Pair("total_in", ValueFromAmount(stats.nTotalIn)));
+    result.push_back(Pair("total_out", ValueFromAmount(stats.nTotalOut)));
+    result.push_back(Pair("fees", ValueFromAmount(stats.nFees)));
+    result.push_back(Pair("mint", ValueFromAmount(stats.nMint)));
+    result.push_back(Pair("moneysupply", ValueFromAmount(stats.nMoneySupply)));
+    Object rewards;
+    rewards.push_back(Pair("stake", ValueFromAmount(stats.rewards.nStakeReward)));
+    rewards.push_back(Pair("masternode", ValueFromAmount(stats.rewards.nMasternodeReward)));
+    rewards.push_back(Pair("treasury", ValueFromAmount(stats.rewards.nTreasuryReward)));
+    rewards.push_back(Pair("charity", ValueFromAmount(stats.rewards.nCharityReward)));
+    rewards.push_back(Pair("lottery", ValueFromAmount(stats.rewards.nLotteryReward)));
+    rewards.push_back(Pair("proposals", ValueFromAmount(stats.rewards.nProposalsReward)));
+    result.push_back(Pair("rewards", rewards));
+    result.push_back(Pair("utxo_created", (int)stats.nUtxoCreated));
+    result.push_back(Pair("utxo_spent", (int)stats.nUtxoSpent));
+    result.push_back(Pair("utxo_delta", stats.GetUtxoDelta()));
+    return result;
+}
+
+Object coinSupplyToJSON(const CoinSupply& supply)
+{
+    Object result;
+    result.push_back(Pair("hash", supply.blockHash.GetHex()));
+    result.push_back(Pair("height", supply.nHeight));
+    result.push_back(Pair("moneysupply", ValueFromAmount(supply.nMoneySupply)));
+    result.push_back(Pair("vaulted", ValueFromAmount(supply.nVaultValue)));
+    result.push_back(Pair("masternode_collateral", ValueFromAmount(supply.nMasternodeCollateralValue)));
+    result.push_back(Pair("unspendable", ValueFromAmount(supply.nUnspendableValue)));
+    return result;
+}
+
 
 Value getblockcount(const Array& params, bool fHelp)
 {
@@ -137,7 +194,8 @@ Value getblockcount(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    return chainActive.Height();
+    const CBlockIndex* tip = GetChainTipSnapshot();
+    return tip ? tip->nHeight : -1;
 }
 
 Value getbestblockhash(const Array& params, bool fHelp)
@@ -151,7 +209,60 @@ Value getbestblockhash(const Array& params, bool fHelp)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    const CBlockIndex* tip = GetChainTipSnapshot();
+    if (!tip)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No blocks loaded");
+    return tip->GetBlockHash().GetHex();
+}
+
+extern CWaitableCriticalSection csBestBlock;
+extern CConditionVariable cvBlockChange;
+
+Value waitfornewblock(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "waitfornewblock ( timeout )\n"
+            "\nWaits for the tip to change, and returns the new tip.\n"
+            "The call holds one of the -rpcthreads for as long as it waits.\n"
+            "\nArguments:\n"
+            "1. timeout       (numeric, optional, default=0) Time in milliseconds to wait for a response, 0 for no timeout\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"hash\" : \"hash\",   (string) The block hash of the tip, the same as before on a timeout\n"
+            "  \"height\" : n        (numeric) The block height of the tip\n"
+            "}\n"
+            "\nExamples\n" +
+            HelpExampleCli("waitfornewblock", "1000") + HelpExampleRpc("waitfornewblock", "1000"));
+
+    const int64_t nTimeout = params.size() > 0 ? params[0].get_int64() : 0;
+    if (nTimeout < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative timeout");
+
+    const CBlockIndex* pindexStart = GetChainTipSnapshot();
+    const int64_t nDeadline = GetTimeMillis() + nTimeout;
+    {
+        boost::unique_lock<boost::mutex> lock(csBestBlock);
+        while (GetChainTipSnapshot() == pindexStart && IsRPCRunning()) {
+            int64_t nWait = 1000;
+            if (nTimeout > 0) {
+                const int64_t nRemaining = nDeadline - GetTimeMillis();
+                if (nRemaining <= 0)
+                    break;
+                nWait = std::min(nWait, nRemaining);
+            }
+            // The tip is notified without csBestBlock held, so a wakeup can be missed; look again at least every second
+            cvBlockChange.timed_wait(lock, boost::posix_time::milliseconds(nWait));
+        }
+    }
+
+    const CBlockIndex* tip = GetChainTipSnapshot();
+    if (!tip)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No blocks loaded");
+    Object result;
+    result.push_back(Pair("hash", tip->GetBlockHash().GetHex()));
+    result.push_back(Pair("height", tip->nHeight));
+    return result;
 }
 
 Value getdifficulty(const Array& params, bool fHelp)
@@ -191,6 +302,12 @@ Value getrawmempool(const Array& params, bool fHelp)
             "    \"height\" : n,           (numeric) block height when transaction entered pool\n"
             "    \"startingpriority\" : n, (numeric) priority when transaction entered pool\n"
             "    \"currentpriority\" : n,  (numeric) transaction priority now\n"
+            "    \"descendantcount\" : n,  (numeric) number of in-mempool descendant transactions (including this one)\n"
+            "    \"descendantsize\" : n,   (numeric) size of in-mempool descendants (including this one)\n"
+            "    \"descendantfees\" : n,   (numeric) modified fees (see above) of in-mempool descendants (including this one)\n"
+            "    \"ancestorcount\" : n,    (numeric) number of in-mempool ancestor transactions (including this one)\n"
+            "    \"ancestorsize\" : n,     (numeric) size of in-mempool ancestors (including this one)\n"
+            "    \"ancestorfees\" : n,     (numeric) modified fees (see above) of in-mempool ancestors (including this one)\n"
             "    \"depends\" : [           (array) unconfirmed transactions used as inputs for this transaction\n"
             "        \"transactionid\",    (string) parent transaction id\n"
             "       ... ]\n"
@@ -204,6 +321,8 @@ Value getrawmempool(const Array& params, bool fHelp)
         fVerbose = params[0].get_bool();
 
     if (fVerbose) {
+        const CBlockIndex* tip = GetChainTipSnapshot();
+        const int nTipHeight = tip ? tip->nHeight : -1;
         LOCK(mempool.cs);
         Object o;
         BOOST_FOREACH (const PAIRTYPE(uint256, CTxMemPoolEntry) & entry, mempool.mapTx) {
@@ -215,7 +334,13 @@ Value getrawmempool(const Array& params, bool fHelp)
             info.push_back(Pair("time", e.GetTime()));
             info.push_back(Pair("height", (int)e.GetHeight()));
             info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
+            info.push_back(Pair("currentpriority", e.GetPriority(nTipHeight)));
+            info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
+            info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
+            info.push_back(Pair("descendantfees", e.GetModFeesWithDescendants()));
+            info.push_back(Pair("ancestorcount", e.GetCountWithAncestors()));
+            info.push_back(Pair("ancestorsize", e.GetSizeWithAncestors()));
+            info.push_back(Pair("ancestorfees", e.GetModFeesWithAncestors()));
             const CTransaction& tx = e.GetTx();
             set<string> setDepends;
             BOOST_FOREACH (const CTxIn& txin, tx.vin) {
@@ -305,20 +430,32 @@ Value getblock(const Array& params, bool fHelp)
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
-    if (!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
+        if (!ReadRawBlockFromDisk(ssBlock, pblockindex))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
         return strHex;
     }
 
-    return blockToJSON(block, pblockindex);
+    const RPCResponseCacheKey cacheKey("getblock", hash, 1);
+    Value result;
+    if (GetRPCResponseCache().Find(cacheKey, chainActive.Height(), result))
+        return result;
+
+    CachingBlockDataReader::BlockRef block = GetRecentBlockDataReader().GetBlock(pblockindex);
+    if (!block)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+    result = blockToJSON(*block, pblockindex);
+    if (chainActive.Contains(pblockindex))
+        GetRPCResponseCache().Insert(cacheKey, result, pblockindex->nHeight, chainActive.Height());
+    return result;
 }
 
 Value getblockheader(const Array& params, bool fHelp)
@@ -352,61 +489,431 @@ Value getblockheader(const Array& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    // Only the lookup needs cs_main, as block index entries and the blocks on disk do not go away
+    CBlockIndex* pblockindex;
+    int nTipHeight;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
+        nTipHeight = chainActive.Height();
+    }
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    const RPCResponseCacheKey cacheKey("getblockheader", hash, fVerbose ? 1 : 0);
+    Value result;
+    if (GetRPCResponseCache().Find(cacheKey, nTipHeight, result))
+        return result;
 
-    if (!ReadBlockFromDisk(block, pblockindex))
+    CachingBlockDataReader::BlockRef block = GetRecentBlockDataReader().GetBlock(pblockindex);
+    if (!block)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block.GetBlockHeader();
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        ssBlock << block->GetBlockHeader();
+        result = HexStr(ssBlock.begin(), ssBlock.end());
+    } else
+        result = blockHeaderToJSON(*block, pblockindex);
+
+    if (GetRPCResponseCache().IsCacheable(pblockindex->nHeight, nTipHeight)) {
+        LOCK(cs_main);
+        if (chainActive.Contains(pblockindex))
+            GetRPCResponseCache().Insert(cacheKey, result, pblockindex->nHeight, chainActive.Height());
+    }
+    return result;
+}
+
+//! Blocks a single getblockstats or getcoinsupply call returns the figures of
+static const int MAX_BLOCK_RANGE_COUNT = 10000;
+
+/** The block given by hash or height, the tip when null, followed by those after it in the active chain up to nCount in all when fRange is set */
+static std::vector<const CBlockIndex*> LookUpBlockRange(const Value& hashOrHeight, int nCount, bool fRange)
+{
+    if (nCount < 1 || nCount > MAX_BLOCK_RANGE_COUNT)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count has to be between 1 and %d", MAX_BLOCK_RANGE_COUNT));
+
+    // Heights typed on the command line arrive as strings, but never as long as a hash
+    int nHeight = -1;
+    uint256 hash;
+    if (hashOrHeight.type() == int_type) {
+        nHeight = hashOrHeight.get_int();
+    } else if (hashOrHeight.type() != null_type) {
+        const std::string& strHashOrHeight = hashOrHeight.get_str();
+        if (strHashOrHeight.size() == 64)
+            hash = uint256(strHashOrHeight);
+        else if (!ParseInt32(strHashOrHeight, &nHeight))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Expected a block hash or height");
+    }
+
+    // Only the lookups need cs_main, as block index entries do not go away
+    std::vector<const CBlockIndex*> blocks;
+    LOCK(cs_main);
+    const CBlockIndex* pblockindex = NULL;
+    if (hashOrHeight.type() == null_type) {
+        pblockindex = chainActive.Tip();
+    } else if (hash != 0) {
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
+    } else {
+        if (nHeight < 0 || nHeight > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        pblockindex = chainActive[nHeight];
+    }
+    if (fRange && !chainActive.Contains(pblockindex))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "A range has to start at a block of the active chain");
+    for (; pblockindex && (int)blocks.size() < nCount; pblockindex = chainActive.Next(pblockindex))
+        blocks.push_back(pblockindex);
+    return blocks;
+}
+
+Value getblockstats(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "getblockstats \"hash_or_height\" ( count )\n"
+            "\nReturns the figures the block stats index keeps of a block, or of a range of blocks of the active chain.\n"
+            "The node has to run with -blockstatsindex.\n"
+            "\nArguments:\n"
+            "1. \"hash_or_height\"  (string or numeric, required) The block hash, or the height of the block in the active chain\n"
+            "2. count             (numeric, optional) Return an array with the figures of this many blocks of the active chain, starting at the block; fewer when the tip comes first\n"
+            "\nResult (for a single block):\n"
+            "{\n"
+            "  \"hash\" : \"hash\",      (string) The block hash\n"
+            "  \"height\" : n,         (numeric) The block height\n"
+            "  \"time\" : ttt,         (numeric) The block time in seconds since epoch (Jan 1 1970 GMT)\n"
+            "  \"txs\" : n,            (numeric) The number of transactions, including the coinbase and coinstake\n"
+            "  \"ins\" : n,            (numeric) The number of inputs, leaving out the coinbase and coinstake\n"
+            "  \"outs\" : n,           (numeric) The number of outputs, leaving out the coinbase and coinstake\n"
+            "  \"total_in\" : x.xxx,   (numeric) The amount spent, leaving out the coinbase and coinstake\n"
+            "  \"total_out\" : x.xxx,  (numeric) The amount paid, leaving out the coinbase and coinstake\n"
+            "  \"fees\" : x.xxx,       (numeric) The fees of the block's transactions\n"
+            "  \"mint\" : x.xxx,       (numeric) The amount minted by the block\n"
+            "  \"moneysupply\" : x.xxx, (numeric) The money supply after the block\n"
+            "  \"rewards\" : {         (object) The rewards the block was checked against\n"
+            "    \"stake\", \"masternode\", \"treasury\", \"charity\", \"lottery\", \"proposals\" : x.xxx\n"
+            "  },\n"
+            "  \"utxo_created\" : n,   (numeric) The number of outputs added to the unspent output set\n"
+            "  \"utxo_spent\" : n,     (numeric) The number of outputs taken out of the unspent output set\n"
+            "  \"utxo_delta\" : n      (numeric) The change in the size of the unspent output set\n"
+            "}\n"
+            "\nResult (with count):\n"
+            "[ { ... }, ... ]         (array) The figures of each block, in chain order\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getblockstats", "1000") + HelpExampleCli("getblockstats", "1000 100") + HelpExampleRpc("getblockstats", "1000, 100"));
+
+    const bool fRange = params.size() > 1;
+    const std::vector<const CBlockIndex*> blocks = LookUpBlockRange(params[0], fRange ? params[1].get_int() : 1, fRange);
+
+    Array result;
+    for (const CBlockIndex* pblockindex : blocks) {
+        BlockStats stats;
+        if (!GetBlockStats(pblockindex, stats))
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("No block stats for block %s; -blockstatsindex is needed", pblockindex->GetBlockHash().GetHex()));
+        if (!fRange)
+            return blockStatsToJSON(stats);
+        result.push_back(blockStatsToJSON(stats));
     }
+    return result;
+}
 
-    return blockHeaderToJSON(block, pblockindex);
+Value getcoinsupply(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getcoinsupply ( \"hash_or_height\" count )\n"
+            "\nReturns where the coins stand after a block, or after each of a range of blocks of the active chain, from the supply index.\n"
+            "The node has to run with -supplyindex.\n"
+            "\nArguments:\n"
+            "1. \"hash_or_height\"  (string or numeric, optional, default=the tip) The block hash, or the height of the block in the active chain\n"
+            "2. count             (numeric, optional) Return an array with the figures of this many blocks of the active chain, starting at the block; fewer when the tip comes first\n"
+            "\nResult (for a single block):\n"
+            "{\n"
+            "  \"hash\" : \"hash\",                (string) The block hash\n"
+            "  \"height\" : n,                   (numeric) The block height\n"
+            "  \"moneysupply\" : x.xxx,          (numeric) The money supply after the block\n"
+            "  \"vaulted\" : x.xxx,              (numeric) The amount held in unspent vault outputs\n"
+            "  \"masternode_collateral\" : x.xxx, (numeric) The amount held in unspent outputs paying a masternode tier's collateral\n"
+            "  \"unspendable\" : x.xxx           (numeric) The amount ever paid to provably unspendable outputs\n"
+            "}\n"
+            "\nResult (with count):\n"
+            "[ { ... }, ... ]         (array) The figures after each block, in chain order\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getcoinsupply", "") + HelpExampleCli("getcoinsupply", "1000 100") + HelpExampleRpc("getcoinsupply", "1000, 100"));
+
+    const bool fRange = params.size() > 1;
+    const Value hashOrHeight = params.empty() ? Value() : params[0];
+    const std::vector<const CBlockIndex*> blocks = LookUpBlockRange(hashOrHeight, fRange ? params[1].get_int() : 1, fRange);
+
+    Array result;
+    for (const CBlockIndex* pblockindex : blocks) {
+        CoinSupply supply;
+        if (!GetCoinSupply(pblockindex, supply))
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("No coin supply for block %s; -supplyindex is needed", pblockindex->GetBlockHash().GetHex()));
+        if (!fRange)
+            return coinSupplyToJSON(supply);
+        result.push_back(coinSupplyToJSON(supply));
+    }
+    return result;
 }
 
 Value gettxoutsetinfo(const Array& params, bool fHelp)
 {
-    if (fHelp || params.size() != 0)
+    if (fHelp || params.size() > 1)
         throw runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( full )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "The statistics are kept up to date as blocks are connected, so this returns quickly\n"
+            "unless a full scan of the coin database is requested.\n"
+            "\nArguments:\n"
+            "1. full      (boolean, optional, default=false) Recompute everything by scanning the coin database,\n"
+            "             also returning bytes_serialized and hash_serialized. Note this may take some time.\n"
+            "             Unlike in earlier versions, bytes_serialized and hash_serialized are only returned\n"
+            "             by a full scan.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
             "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
+            "  \"bytes_serialized\": n,  (numeric) The serialized size (full scan only)\n"
+            "  \"hash_serialized\": \"hash\",   (string) The serialized hash (full scan only)\n"
+            "  \"muhash\": \"hash\",   (string) Rolling hash of the set of unspent outputs\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n" +
-            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
+            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleCli("gettxoutsetinfo", "true") + HelpExampleRpc("gettxoutsetinfo", ""));
 
-    Object ret;
+    const bool fFullScan = params.size() > 0 && params[0].get_bool();
 
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+    }
+
+    // The coin database is read without cs_main, so blocks keep being processed meanwhile.
     CCoinsStats stats;
-    FlushStateToDisk();
-    if (pcoinsTip->GetStats(stats)) {
+    bool fHaveStats = !fFullScan && pcoinsTip->GetRunningStats(stats);
+    if (!fHaveStats) {
+        stats = CCoinsStats();
+        fHaveStats = pcoinsTip->GetStats(stats);
+        if (!fHaveStats && fFullScan)
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read UTXO set");
+    }
+
+    Object ret;
+    if (fHaveStats) {
+        {
+            LOCK(cs_main);
+            BlockMap::const_iterator it = mapBlockIndex.find(stats.hashBlock);
+            if (it != mapBlockIndex.end())
+                stats.nHeight = it->second->nHeight;
+        }
         ret.push_back(Pair("height", (int64_t)stats.nHeight));
         ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
         ret.push_back(Pair("transactions", (int64_t)stats.nTransactions));
         ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
-        ret.push_back(Pair("bytes_serialized", (int64_t)stats.nSerializedSize));
-        ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
+        if (stats.hashSerialized != uint256(0)) {
+            ret.push_back(Pair("bytes_serialized", (int64_t)stats.nSerializedSize));
+            ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
+        }
+        ret.push_back(Pair("muhash", stats.hashMuHash.GetHex()));
         ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
     }
     return ret;
 }
 
+namespace
+{
+std::string SnapshotPathFromParam(const Value& param)
+{
+    return boost::filesystem::absolute(param.get_str(), GetDataDir()).string();
+}
+
+Object SnapshotMetadataToJSON(const UtxoSnapshotMetadata& metadata, const std::string& strPath)
+{
+    Object ret;
+    ret.push_back(Pair("path", strPath));
+    ret.push_back(Pair("height", metadata.nBaseHeight));
+    ret.push_back(Pair("bestblock", metadata.hashBaseBlock.GetHex()));
+    ret.push_back(Pair("transactions", (int64_t)metadata.nCoinsCount));
+    ret.push_back(Pair("hash_serialized", metadata.hashSerialized.GetHex()));
+    ret.push_back(Pair("moneysupply", ValueFromAmount(metadata.nMoneySupply)));
+    ret.push_back(Pair("known", IsKnownUtxoSnapshot(metadata)));
+    return ret;
+}
+}
+
+Value dumptxoutset(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrite the unspent transaction output set at the current tip to a snapshot file.\n"
+            "Note this call may take some time, during which blocks are not processed.\n"
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) Snapshot file, relative to the data directory if not absolute\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"path\",          (string) The snapshot file written\n"
+            "  \"height\":n,              (numeric) The height of the snapshot base block\n"
+            "  \"bestblock\": \"hex\",      (string) The snapshot base block hash hex\n"
+            "  \"transactions\": n,       (numeric) The number of transactions with unspent outputs\n"
+            "  \"hash_serialized\": \"hash\", (string) The snapshot hash, as reported by gettxoutsetinfo\n"
+            "  \"moneysupply\": x.xxx,    (numeric) The money supply at the snapshot base block\n"
+            "  \"known\": true|false      (boolean) Whether this snapshot is listed in the chain parameters, with this hash and supply\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("dumptxoutset", "\"utxo.snapshot\"") + HelpExampleRpc("dumptxoutset", "\"utxo.snapshot\""));
+
+    const std::string strPath = SnapshotPathFromParam(params[0]);
+    if (boost::filesystem::exists(strPath))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strPath + " already exists");
+
+    LOCK(cs_main);
+    UtxoSnapshotMetadata metadata;
+    std::string strError;
+    if (!DumpUtxoSnapshot(strPath, metadata, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to dump snapshot: " + strError);
+    return SnapshotMetadataToJSON(metadata, strPath);
+}
+
+Value loadtxoutset(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "loadtxoutset \"path\"\n"
+            "\nReplace the unspent transaction output set by a snapshot written with dumptxoutset.\n"
+            "The blocks up to the snapshot base must already be stored, but need not be connected;\n"
+            "they are accepted without being validated, and the chain cannot be reorganized below\n"
+            "the snapshot base afterwards. Use -reindex to validate the full history again.\n"
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) Snapshot file, relative to the data directory if not absolute\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"path\",          (string) The snapshot file loaded\n"
+            "  \"height\":n,              (numeric) The height of the snapshot base block\n"
+            "  \"bestblock\": \"hex\",      (string) The snapshot base block hash hex\n"
+            "  \"transactions\": n,       (numeric) The number of transactions with unspent outputs\n"
+            "  \"hash_serialized\": \"hash\", (string) The snapshot hash, as reported by gettxoutsetinfo\n"
+            "  \"moneysupply\": x.xxx,    (numeric) The money supply at the snapshot base block\n"
+            "  \"known\": true|false      (boolean) Whether this snapshot is listed in the chain parameters, with this hash and supply\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("loadtxoutset", "\"utxo.snapshot\"") + HelpExampleRpc("loadtxoutset", "\"utxo.snapshot\""));
+
+    const std::string strPath = SnapshotPathFromParam(params[0]);
+    UtxoSnapshotMetadata metadata;
+    {
+        LOCK(cs_main);
+        std::string strError;
+        if (!ActivateUtxoSnapshot(strPath, metadata, strError))
+            throw JSONRPCError(RPC_MISC_ERROR, "Unable to load snapshot: " + strError);
+    }
+
+    CValidationState state;
+    ActivateBestChain(state);
+    if (!state.IsValid())
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+    return SnapshotMetadataToJSON(metadata, strPath);
+}
+
+static Object LevelDBInfoToJSON(const CLevelDBWrapper& db)
+{
+    const CLevelDBTuning& tuning = db.GetTuning();
+    Object result;
+    result.push_back(Pair("block_cache_size", (uint64_t)tuning.nBlockCacheSize));
+    result.push_back(Pair("write_buffer_size", (uint64_t)tuning.nWriteBufferSize));
+    result.push_back(Pair("max_open_files", tuning.nMaxOpenFiles));
+    result.push_back(Pair("bloom_bits_per_key", tuning.nBloomBitsPerKey));
+
+    Array files;
+    std::string strValue;
+    for (int nLevel = 0; db.GetProperty(strprintf("leveldb.num-files-at-level%d", nLevel), strValue); ++nLevel)
+        files.push_back(atoi(strValue));
+    result.push_back(Pair("files_per_level", files));
+    if (db.GetProperty("leveldb.stats", strValue))
+        result.push_back(Pair("stats", strValue));
+    return result;
+}
+
+Value getdbinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbinfo\n"
+            "\nReturns how the LevelDB databases are tuned and how their files are laid out, and how often\n"
+            "recently read blocks and transactions are found in memory.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {              (object) The coin database\n"
+            "    \"block_cache_size\": n,     (numeric) Bytes of cache for table blocks\n"
+            "    \"write_buffer_size\": n,    (numeric) Bytes buffered before writing a table file\n"
+            "    \"max_open_files\": n,       (numeric) Table files kept open at once\n"
+            "    \"bloom_bits_per_key\": n,   (numeric) Bloom filter size per key, 0 for none\n"
+            "    \"files_per_level\": [n,...], (array) Number of table files at each level\n"
+            "    \"stats\": \"...\"            (string) Compaction statistics reported by LevelDB\n"
+            "  },\n"
+            "  \"blockindex\": {...},         (object) The block index database, same fields\n"
+            "  \"blockdatacache\": {          (object) Blocks and undo data recently read from disk\n"
+            "    \"blocks\": n,               (numeric) Blocks cached\n"
+            "    \"undos\": n,                (numeric) Undo records cached\n"
+            "    \"block_hits\": n,           (numeric) Block reads served from the cache\n"
+            "    \"block_misses\": n,         (numeric) Block reads that went to disk\n"
+            "    \"undo_hits\": n,            (numeric) Undo reads served from the cache\n"
+            "    \"undo_misses\": n           (numeric) Undo reads that went to disk\n"
+            "  },\n"
+            "  \"txcache\": {                 (object) Transactions recently read out of blocks\n"
+            "    \"transactions\": n,         (numeric) Transactions cached\n"
+            "    \"usage\": n,                (numeric) Memory they take up in bytes\n"
+            "    \"hits\": n,                 (numeric) Lookups served from the cache\n"
+            "    \"misses\": n                (numeric) Lookups that went to disk\n"
+            "  },\n"
+            "  \"rpccache\": {                (object) Replies about blocks deep enough not to change\n"
+            "    \"replies\": n,              (numeric) Replies cached\n"
+            "    \"usage\": n,                (numeric) Memory they take up in bytes\n"
+            "    \"hits\": n,                 (numeric) Requests served from the cache\n"
+            "    \"misses\": n                (numeric) Requests that built their reply\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getdbinfo", "") + HelpExampleRpc("getdbinfo", ""));
+
+    Object result;
+    result.push_back(Pair("chainstate", LevelDBInfoToJSON(pcoinsdbview->GetDatabase())));
+    result.push_back(Pair("blockindex", LevelDBInfoToJSON(*pblocktree)));
+
+    const BlockDataCacheStats cacheStats = GetRecentBlockDataReader().GetStats();
+    Object blockDataCache;
+    blockDataCache.push_back(Pair("blocks", (uint64_t)cacheStats.nCachedBlocks));
+    blockDataCache.push_back(Pair("undos", (uint64_t)cacheStats.nCachedBlockUndos));
+    blockDataCache.push_back(Pair("block_hits", cacheStats.nBlockHits));
+    blockDataCache.push_back(Pair("block_misses", cacheStats.nBlockMisses));
+    blockDataCache.push_back(Pair("undo_hits", cacheStats.nBlockUndoHits));
+    blockDataCache.push_back(Pair("undo_misses", cacheStats.nBlockUndoMisses));
+    result.push_back(Pair("blockdatacache", blockDataCache));
+
+    const TransactionCacheStats txCacheStats = GetRecentTransactionCache().GetStats();
+    Object txCache;
+    txCache.push_back(Pair("transactions", (uint64_t)txCacheStats.nCachedTransactions));
+    txCache.push_back(Pair("usage", (uint64_t)txCacheStats.nUsage));
+    txCache.push_back(Pair("hits", txCacheStats.nHits));
+    txCache.push_back(Pair("misses", txCacheStats.nMisses));
+    result.push_back(Pair("txcache", txCache));
+
+    const RPCResponseCacheStats rpcCacheStats = GetRPCResponseCache().GetStats();
+    Object rpcCache;
+    rpcCache.push_back(Pair("replies", (uint64_t)rpcCacheStats.nCachedResponses));
+    rpcCache.push_back(Pair("usage", (uint64_t)rpcCacheStats.nUsage));
+    rpcCache.push_back(Pair("hits", rpcCacheStats.nHits));
+    rpcCache.push_back(Pair("misses", rpcCacheStats.nMisses));
+    result.push_back(Pair("rpccache", rpcCache));
+    return result;
+}
+
 Value gettxout(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() < 2 || params.size() > 3)
@@ -451,27 +958,30 @@ Value gettxout(const Array& params, bool fHelp)
     if (params.size() > 2)
         fMempool = params[2].get_bool();
 
+    // Read from a snapshot of the coins tip, so blocks keep being connected meanwhile.
+    CoinsSnapshot snapshot;
+    if (!GetCoinsSnapshot(snapshot))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read UTXO set");
+
     CCoins coins;
     if (fMempool) {
         LOCK(mempool.cs);
-        CCoinsViewMemPool view(pcoinsTip, mempool);
+        CCoinsViewMemPool view(snapshot.view.get(), mempool);
         if (!view.GetCoins(hash, coins))
             return Value::null;
         mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
     } else {
-        if (!pcoinsTip->GetCoins(hash, coins))
+        if (!snapshot.view->GetCoins(hash, coins))
             return Value::null;
     }
     if (n < 0 || (unsigned int)n >= coins.vout.size() || coins.vout[n].IsNull())
         return Value::null;
 
-    BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
-    CBlockIndex* pindex = it->second;
-    ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
+    ret.push_back(Pair("bestblock", snapshot.hashBlock.GetHex()));
     if ((unsigned int)coins.nHeight == MEMPOOL_HEIGHT)
         ret.push_back(Pair("confirmations", 0));
     else
-        ret.push_back(Pair("confirmations", pindex->nHeight - coins.nHeight + 1));
+        ret.push_back(Pair("confirmations", snapshot.nHeight - coins.nHeight + 1));
     ret.push_back(Pair("value", ValueFromAmount(coins.vout[n].nValue)));
     Object o;
     ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
@@ -527,7 +1037,18 @@ Value getblockchaininfo(const Array& params, bool fHelp)
             "  \"bestblockhash\": \"...\", (string) the hash of the currently best block\n"
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
-            "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"chainwork\": \"xxxx\",    (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
+            "  \"pruneheight\": xxxxxx,    (numeric, if pruned) lowest height of a block that is stored with its undo data\n"
+            "  \"chainstateverification\": {  (object) background check of the coin database against the latest blocks\n"
+            "    \"status\": \"xxxx\",       (string) not started, running, passed or failed\n"
+            "    \"height\": xxxxxx,       (numeric) height of the block the checked coins are as of\n"
+            "    \"blockstocheck\": xxxxxx, (numeric) number of blocks being checked\n"
+            "    \"blockschecked\": xxxxxx, (numeric) number of blocks checked so far\n"
+            "    \"transactionschecked\": xxxxxx, (numeric) number of transactions in the blocks checked so far\n"
+            "    \"progress\": xxxx,       (numeric) fraction of the blocks checked [0..1]\n"
+            "    \"error\": \"xxxx\"        (string, if failed) what was found inconsistent\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getblockchaininfo", "") + HelpExampleRpc("getblockchaininfo", ""));
@@ -540,6 +1061,25 @@ Value getblockchaininfo(const Array& params, bool fHelp)
     obj.push_back(Pair("difficulty", (double)GetDifficulty()));
     obj.push_back(Pair("verificationprogress", checkpointsVerifier.GuessVerificationProgress(chainActive.Tip())));
     obj.push_back(Pair("chainwork", chainActive.Tip()->nChainWork.GetHex()));
+    obj.push_back(Pair("pruned", fPruneMode));
+    if (fPruneMode) {
+        CBlockIndex* block = chainActive.Tip();
+        while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
+            block = block->pprev;
+        obj.push_back(Pair("pruneheight", block ? block->nHeight : 0));
+    }
+
+    const ChainstateVerificationProgress verification = GetChainstateVerificationProgress();
+    Object verificationObj;
+    verificationObj.push_back(Pair("status", verification.GetStateName()));
+    verificationObj.push_back(Pair("height", verification.nTipHeight));
+    verificationObj.push_back(Pair("blockstocheck", verification.nBlocksToCheck));
+    verificationObj.push_back(Pair("blockschecked", verification.nBlocksChecked));
+    verificationObj.push_back(Pair("transactionschecked", (uint64_t)verification.nTransactionsChecked));
+    verificationObj.push_back(Pair("progress", verification.GetFractionChecked()));
+    if (verification.state == ChainstateVerificationProgress::FAILED)
+        verificationObj.push_back(Pair("error", verification.strError));
+    obj.push_back(Pair("chainstateverification", verificationObj));
     return obj;
 }
 
@@ -588,17 +1128,11 @@ Value getchaintips(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getchaintips", "") + HelpExampleRpc("getchaintips", ""));
 
-    /* Build up a list of chain tips.  We start with the list of all
-       known blocks, and successively remove blocks that appear as pprev
-       of another block.  */
-    std::set<const CBlockIndex*, CompareBlocksByHeight> setTips;
-    BOOST_FOREACH (const PAIRTYPE(const uint256, CBlockIndex*) & item, mapBlockIndex)
-        setTips.insert(item.second);
-    BOOST_FOREACH (const PAIRTYPE(const uint256, CBlockIndex*) & item, mapBlockIndex) {
-        const CBlockIndex* pprev = item.second->pprev;
-        if (pprev)
-            setTips.erase(pprev);
-    }
+    LOCK(cs_main);
+
+    /* The tips of all branches are maintained as blocks are added to the
+       block index, so there is no need to scan the entire block tree.  */
+    std::set<const CBlockIndex*, CompareBlocksByHeight> setTips(setBlockIndexTips.begin(), setBlockIndexTips.end());
 
     // Always report the currently active tip.
     setTips.insert(chainActive.Tip());
@@ -651,6 +1185,9 @@ Value getmempoolinfo(const Array& params, bool fHelp)
             "{\n"
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
+            "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"maxmempool\": xxxxx          (numeric) Maximum memory usage for the mempool\n"
+            "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee for a transaction to be accepted\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getmempoolinfo", "") + HelpExampleRpc("getmempoolinfo", ""));
@@ -658,6 +1195,54 @@ Value getmempoolinfo(const Array& params, bool fHelp)
     Object ret;
     ret.push_back(Pair("size", (int64_t)mempool.size()));
     ret.push_back(Pair("bytes", (int64_t)mempool.GetTotalTxSize()));
+    ret.push_back(Pair("usage", (int64_t)mempool.DynamicMemoryUsage()));
+    const size_t maxmempool = GetMaxMempoolSize();
+    ret.push_back(Pair("maxmempool", (int64_t)maxmempool));
+    ret.push_back(Pair("mempoolminfee", ValueFromAmount(mempool.GetMinFee(maxmempool).GetFeePerK())));
+
+    return ret;
+}
+
+Value getorphaninfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getorphaninfo\n"
+            "\nReturns details on the transactions held while their inputs are unknown.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx                (numeric) Current orphan count\n"
+            "  \"bytes\": xxxxx               (numeric) Sum of all orphan sizes\n"
+            "  \"maxorphantx\": xxxxx         (numeric) Maximum number of orphans kept\n"
+            "  \"maxorphanpeersize\": xxxxx   (numeric) Maximum bytes of orphans kept from a single peer\n"
+            "  \"peers\": [                   (array) The peers orphans came from\n"
+            "    {\n"
+            "      \"id\": n,                 (numeric) Peer index\n"
+            "      \"size\": xxxxx,           (numeric) Orphans from the peer\n"
+            "      \"bytes\": xxxxx           (numeric) Sum of their sizes\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getorphaninfo", "") + HelpExampleRpc("getorphaninfo", ""));
+
+    LOCK(cs_main);
+    const OrphanTransactionPool::Stats stats = GetOrphanStats();
+    Object ret;
+    ret.push_back(Pair("size", (int64_t)stats.count));
+    ret.push_back(Pair("bytes", (int64_t)stats.bytes));
+    ret.push_back(Pair("maxorphantx", std::max((int64_t)0, settings.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS))));
+    ret.push_back(Pair("maxorphanpeersize", std::max((int64_t)0, settings.GetArg("-maxorphanpeersize", DEFAULT_MAX_ORPHAN_PEER_BYTES))));
+    Array peers;
+    for (const OrphanTransactionPool::PeerStats& peer : stats.peers) {
+        Object obj;
+        obj.push_back(Pair("id", (int64_t)peer.peer));
+        obj.push_back(Pair("size", (int64_t)peer.count));
+        obj.push_back(Pair("bytes", (int64_t)peer.bytes));
+        peers.push_back(obj);
+    }
+    ret.push_back(Pair("peers", peers));
 
     return ret;
 }
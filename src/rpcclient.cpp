@@ -30,6 +30,11 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"getaddednodeinfo", 0},
         {"setgenerate", 0},
         {"setgenerate", 1},
+        {"getstakingstats", 0},
+        {"simulatestaking", 0},
+        {"simulatestaking", 1},
+        {"generate", 0},
+        {"generate", 1},
         {"generateblock", 0},
         {"sendtoaddress", 1},
         {"getcoinavailability", 0},
@@ -47,6 +52,11 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"getbalance", 1},
         {"getbalance", 2},
         {"getblockhash", 0},
+        {"waitfornewblock", 0},
+        {"getlockstats", 0},
+        {"getperfstats", 0},
+        {"logging", 0},
+        {"logging", 1},
         {"move", 2},
         {"move", 3},
         {"sendfrom", 2},
@@ -63,6 +73,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"listsinceblock", 2},
         {"sendmany", 1},
         {"sendmany", 2},
+        {"sendpayouts", 1},
+        {"sendpayouts", 2},
         {"addmultisigaddress", 0},
         {"addmultisigaddress", 1},
         {"createmultisig", 0},
@@ -72,6 +84,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"listunspent", 2},
         {"getblock", 1},
         {"getblockheader", 1},
+        {"getblockstats", 1},
+        {"getcoinsupply", 1},
         {"gettransaction", 1},
         {"getrawtransaction", 1},
         {"createrawtransaction", 0},
@@ -79,12 +93,15 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"signrawtransaction", 1},
         {"signrawtransaction", 2},
         {"sendrawtransaction", 1},
+        {"gettxoutsetinfo", 0},
         {"gettxout", 1},
         {"gettxout", 2},
         {"lockunspent", 0},
         {"lockunspent", 1},
         {"importprivkey", 2},
         {"importaddress", 2},
+        {"importmulti", 0},
+        {"importmulti", 1},
         {"verifychain", 0},
         {"verifychain", 1},
         {"keypoolrefill", 0},
@@ -114,7 +131,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"getaddressbalance", 0},
         {"getaddressutxos", 0},
         {"getaddressmempool", 0},
-        {"getspentinfo", 0}
+        {"getspentinfo", 0},
+        {"getaddressvaults", 0}
     };
 
 class CRPCConvertTable
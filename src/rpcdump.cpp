@@ -16,6 +16,8 @@
 #include "utilstrencodings.h"
 #include "utiltime.h"
 #include "wallet.h"
+#include "WalletDatabaseGroupCommit.h"
+#include "Settings.h"
 
 #include <fstream>
 #include <secp256k1.h>
@@ -26,11 +28,13 @@
 #include <openssl/aes.h>
 #include <openssl/sha.h>
 
+#include "json/json_spirit_utils.h"
 #include "json/json_spirit_value.h"
 
 using namespace json_spirit;
 using namespace std;
-extern CWallet* pwalletMain;
+extern bool fHavePruned;
+extern Settings& settings;
 
 void EnsureWalletIsUnlocked();
 
@@ -83,6 +87,7 @@ std::string DecodeDumpString(const std::string& str)
 
 Value importprivkey(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 3)
         throw runtime_error(
             "importprivkey \"izzyprivkey\" ( \"label\" rescan )\n"
@@ -110,6 +115,8 @@ Value importprivkey(const Array& params, bool fHelp)
     bool fRescan = true;
     if (params.size() > 2)
         fRescan = params[2].get_bool();
+    if (fRescan && fHavePruned)
+        throw JSONRPCError(RPC_WALLET_ERROR, "Rescan is disabled once block files were pruned");
 
     CBitcoinSecret vchSecret;
     bool fGood = vchSecret.SetString(strSecret);
@@ -123,23 +130,23 @@ Value importprivkey(const Array& params, bool fHelp)
     assert(key.VerifyPubKey(pubkey));
     CKeyID vchAddress = pubkey.GetID();
     {
-        pwalletMain->RecomputeCachedQuantities();
-        pwalletMain->SetAddressBook(vchAddress, strLabel, "receive");
+        pwallet->RecomputeCachedQuantities();
+        pwallet->SetAddressBook(vchAddress, strLabel, "receive");
 
         // Don't throw error in case a key is already there
-        if (pwalletMain->HaveKey(vchAddress))
+        if (pwallet->HaveKey(vchAddress))
             return Value::null;
 
-        pwalletMain->mapKeyMetadata[vchAddress].nCreateTime = 1;
+        pwallet->mapKeyMetadata[vchAddress].nCreateTime = 1;
 
-        if (!pwalletMain->AddKeyPubKey(key, pubkey))
+        if (!pwallet->AddKeyPubKey(key, pubkey))
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding key to wallet");
 
         // whenever a key is imported, we need to scan the whole chain
-        pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
+        pwallet->nTimeFirstKey = 1; // 0 would be considered 'no value'
 
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+            pwallet->ScanForWalletTransactions(chainActive.Genesis(), true);
         }
     }
 
@@ -148,6 +155,7 @@ Value importprivkey(const Array& params, bool fHelp)
 
 Value importaddress(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 3)
         throw runtime_error(
             "importaddress \"address\" ( \"label\" rescan )\n"
@@ -183,38 +191,240 @@ Value importaddress(const Array& params, bool fHelp)
     bool fRescan = true;
     if (params.size() > 2)
         fRescan = params[2].get_bool();
+    if (fRescan && fHavePruned)
+        throw JSONRPCError(RPC_WALLET_ERROR, "Rescan is disabled once block files were pruned");
 
     {
-        if(!pwalletMain)
+        if(!pwallet)
             throw JSONRPCError(RPC_WALLET_ERROR,"Wallet is not enabled in this build");
 
-        if (pwalletMain->IsMine(script) == ISMINE_SPENDABLE)
+        if (pwallet->IsMine(script) == ISMINE_SPENDABLE)
             throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this address or script");
 
         // add to address book or update label
         if (address.IsValid())
-            pwalletMain->SetAddressBook(address.Get(), strLabel, "receive");
+            pwallet->SetAddressBook(address.Get(), strLabel, "receive");
 
         // Don't throw error in case an address is already there
-        if (pwalletMain->HaveWatchOnly(script))
+        if (pwallet->HaveWatchOnly(script))
             return Value::null;
 
-        pwalletMain->RecomputeCachedQuantities();
+        pwallet->RecomputeCachedQuantities();
 
-        if (!pwalletMain->AddWatchOnly(script))
+        if (!pwallet->AddWatchOnly(script))
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding address to wallet");
 
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
-            pwalletMain->ReacceptWalletTransactions();
+            pwallet->ScanForWalletTransactions(chainActive.Genesis(), true);
+            pwallet->ReacceptWalletTransactions();
         }
     }
 
     return Value::null;
 }
 
+namespace
+{
+/** One entry of an importmulti call, checked before any of them touches the wallet */
+struct ImportRequest {
+    CKey key;
+    CScript script;
+    CScript redeemScript;
+    CTxDestination dest;
+    std::string strLabel;
+    int64_t nTime;
+};
+
+ImportRequest ParseImportRequest(CWallet* pwallet, const Value& value, int64_t nNow)
+{
+    if (value.type() != obj_type)
+        throw JSONRPCError(RPC_TYPE_ERROR, "Expected an object");
+    const Object& request = value.get_obj();
+
+    ImportRequest parsed;
+    parsed.dest = CNoDestination();
+    const Value& privkey = find_value(request, "privkey");
+    const Value& address = find_value(request, "address");
+    const Value& redeemscript = find_value(request, "redeemscript");
+    if ((privkey.type() != null_type) + (address.type() != null_type) + (redeemscript.type() != null_type) != 1)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Exactly one of privkey, address or redeemscript must be given");
+
+    if (privkey.type() != null_type) {
+        CBitcoinSecret vchSecret;
+        if (privkey.type() != str_type || !vchSecret.SetString(privkey.get_str()))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid private key encoding");
+        parsed.key = vchSecret.GetKey();
+        if (!parsed.key.IsValid())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Private key outside allowed range");
+        parsed.dest = parsed.key.GetPubKey().GetID();
+    } else if (address.type() != null_type) {
+        if (address.type() != str_type)
+            throw JSONRPCError(RPC_TYPE_ERROR, "Expected address as a string");
+        CBitcoinAddress watched(address.get_str());
+        if (watched.IsValid()) {
+            parsed.dest = watched.Get();
+            parsed.script = GetScriptForDestination(parsed.dest);
+        } else if (IsHex(address.get_str())) {
+            std::vector<unsigned char> data(ParseHex(address.get_str()));
+            parsed.script = CScript(data.begin(), data.end());
+        } else {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid IZZY address or script");
+        }
+        if (pwallet->IsMine(parsed.script) == ISMINE_SPENDABLE)
+            throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this address or script");
+    } else {
+        std::vector<unsigned char> data(ParseHexV(redeemscript, "redeemscript"));
+        parsed.redeemScript = CScript(data.begin(), data.end());
+        if (parsed.redeemScript.size() > MAX_SCRIPT_ELEMENT_SIZE)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Redeem script is too large to be spent");
+        parsed.dest = CScriptID(parsed.redeemScript);
+    }
+
+    const Value& label = find_value(request, "label");
+    if (label.type() == str_type)
+        parsed.strLabel = label.get_str();
+    else if (label.type() != null_type)
+        throw JSONRPCError(RPC_TYPE_ERROR, "Expected label as a string");
+
+    const Value& timestamp = find_value(request, "timestamp");
+    if (timestamp.type() == int_type && timestamp.get_int64() >= 0)
+        parsed.nTime = timestamp.get_int64();
+    else if (timestamp.type() == str_type && timestamp.get_str() == "now")
+        parsed.nTime = nNow;
+    else
+        throw JSONRPCError(RPC_TYPE_ERROR, "Expected timestamp as a non-negative number of seconds or \"now\"");
+    return parsed;
+}
+
+/** Adds a checked entry to the wallet, with the lock on the wallet held; false when the wallet could not store it */
+bool AddImportRequest(CWallet* pwallet, const ImportRequest& request)
+{
+    if (request.key.IsValid()) {
+        const CPubKey pubkey = request.key.GetPubKey();
+        const CKeyID keyID = pubkey.GetID();
+        if (!pwallet->HaveKey(keyID)) {
+            pwallet->mapKeyMetadata[keyID].nCreateTime = std::max(request.nTime, (int64_t)1);
+            if (!pwallet->AddKeyPubKey(request.key, pubkey))
+                return false;
+            pwallet->UpdateTimeFirstKey(request.nTime);
+        }
+    } else if (!request.redeemScript.empty()) {
+        if (!pwallet->HaveCScript(CScriptID(request.redeemScript)) && !pwallet->AddCScript(request.redeemScript))
+            return false;
+        pwallet->UpdateTimeFirstKey(request.nTime);
+    } else if (!pwallet->HaveWatchOnly(request.script) && !pwallet->AddWatchOnly(request.script)) {
+        return false;
+    }
+    if (!boost::get<CNoDestination>(&request.dest))
+        pwallet->SetAddressBook(request.dest, request.strLabel, "receive");
+    return true;
+}
+}
+
+Value importmulti(const Array& params, bool fHelp)
+{
+    CWallet* const pwallet = GetWalletForRPC();
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "importmulti [{\"privkey\"|\"address\"|\"redeemscript\":\"...\",\"timestamp\":n|\"now\",\"label\":\"...\"},...] ( {\"rescan\":true|false} )\n"
+            "\nAdds private keys, watched addresses or scripts and redeem scripts to your wallet in one go,\n"
+            "then rescans the blocks once, from the earliest of their timestamps on.\n"
+            "All of them are checked before any is added, so an invalid one leaves the wallet as it was.\n"
+            "\nArguments:\n"
+            "1. requests             (array, required) The keys, addresses and scripts to import\n"
+            "     [\n"
+            "       {\n"
+            "         \"privkey\": \"key\",          (string) A private key (see dumpprivkey), or\n"
+            "         \"address\": \"address\",      (string) An address or script (in hex) to watch, or\n"
+            "         \"redeemscript\": \"hex\",     (string) A redeem script, to know the P2SH address paying to it\n"
+            "         \"timestamp\": n,            (numeric or \"now\", required) When the key or script was created, in seconds\n"
+            "                                    since epoch; 0 rescans the whole chain, \"now\" only the latest blocks\n"
+            "         \"label\": \"label\"           (string, optional, default=\"\") An optional label\n"
+            "       }\n"
+            "       ,...\n"
+            "     ]\n"
+            "2. options              (object, optional)\n"
+            "     {\n"
+            "       \"rescan\": true|false         (boolean, optional, default=true) Rescan the wallet for transactions\n"
+            "     }\n"
+            "\nResult:\n"
+            "[                       (array) The outcome of each request, in order\n"
+            "  {\n"
+            "    \"success\": true|false   (boolean) Whether the wallet stored it\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nNote: This call can take minutes to complete if rescan is true, but takes one rescan for all the requests.\n"
+            "\nExamples:\n" +
+            HelpExampleCli("importmulti", "\"[{\\\"privkey\\\":\\\"mykey\\\",\\\"timestamp\\\":1500000000},{\\\"address\\\":\\\"myaddress\\\",\\\"timestamp\\\":\\\"now\\\",\\\"label\\\":\\\"testing\\\"}]\"") +
+            HelpExampleCli("importmulti", "\"[{\\\"address\\\":\\\"myaddress\\\",\\\"timestamp\\\":0}]\" \"{\\\"rescan\\\":false}\"") +
+            "\nAs a JSON-RPC call\n" + HelpExampleRpc("importmulti", "[{\"address\":\"myaddress\",\"timestamp\":0}], {\"rescan\":false}"));
+
+    if (params[0].type() != array_type)
+        throw JSONRPCError(RPC_TYPE_ERROR, "Expected an array of requests");
+    const Array& requests = params[0].get_array();
+
+    // Whether to perform rescan after import
+    bool fRescan = true;
+    if (params.size() > 1) {
+        if (params[1].type() != obj_type)
+            throw JSONRPCError(RPC_TYPE_ERROR, "Expected options as an object");
+        const Value& rescan = find_value(params[1].get_obj(), "rescan");
+        if (rescan.type() != null_type)
+            fRescan = rescan.get_bool();
+    }
+    if (fRescan && fHavePruned)
+        throw JSONRPCError(RPC_WALLET_ERROR, "Rescan is disabled once block files were pruned");
+
+    const int64_t nNow = chainActive.Tip()->GetBlockTime();
+    std::vector<ImportRequest> vRequests;
+    vRequests.reserve(requests.size());
+    for (unsigned int i = 0; i < requests.size(); i++) {
+        try {
+            vRequests.push_back(ParseImportRequest(pwallet, requests[i], nNow));
+        } catch (Object& error) {
+            error.push_back(Pair("request", (int)i));
+            throw;
+        }
+    }
+    BOOST_FOREACH (const ImportRequest& request, vRequests) {
+        if (request.key.IsValid()) {
+            EnsureWalletIsUnlocked();
+            break;
+        }
+    }
+
+    Array results;
+    int64_t nTimeBegin = nNow;
+    {
+        WalletDatabaseGroupCommit groupCommit(settings, pwallet->strWalletFile);
+        BOOST_FOREACH (const ImportRequest& request, vRequests) {
+            Object result;
+            result.push_back(Pair("success", AddImportRequest(pwallet, request)));
+            results.push_back(result);
+            nTimeBegin = std::min(nTimeBegin, request.nTime);
+        }
+        if (!groupCommit.Commit())
+            throw JSONRPCError(RPC_WALLET_ERROR, "Error writing the imported keys and scripts to the wallet file");
+    }
+    pwallet->RecomputeCachedQuantities();
+
+    if (fRescan && !vRequests.empty()) {
+        CBlockIndex* pindex = chainActive.Tip();
+        while (pindex && pindex->pprev && pindex->GetBlockTime() > nTimeBegin - 7200)
+            pindex = pindex->pprev;
+        LogPrintf("Rescanning last %i blocks\n", chainActive.Height() - pindex->nHeight + 1);
+        pwallet->ScanForWalletTransactions(pindex, true);
+        pwallet->ReacceptWalletTransactions();
+        pwallet->RecomputeCachedQuantities();
+    }
+
+    return results;
+}
+
 Value importwallet(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 1)
         throw runtime_error(
             "importwallet \"filename\"\n"
@@ -227,6 +437,9 @@ Value importwallet(const Array& params, bool fHelp)
             "\nImport the wallet\n" + HelpExampleCli("importwallet", "\"test\"") +
             "\nImport using the json rpc call\n" + HelpExampleRpc("importwallet", "\"test\""));
 
+    if (fHavePruned)
+        throw JSONRPCError(RPC_WALLET_ERROR, "Importing wallets is disabled once block files were pruned");
+
     EnsureWalletIsUnlocked();
 
     ifstream file;
@@ -241,9 +454,9 @@ Value importwallet(const Array& params, bool fHelp)
     int64_t nFilesize = std::max((int64_t)1, (int64_t)file.tellg());
     file.seekg(0, file.beg);
 
-    pwalletMain->ShowProgress(translate("Importing..."), 0); // show progress dialog in GUI
+    pwallet->ShowProgress(translate("Importing..."), 0); // show progress dialog in GUI
     while (file.good()) {
-        pwalletMain->ShowProgress("", std::max(1, std::min(99, (int)(((double)file.tellg() / (double)nFilesize) * 100))));
+        pwallet->ShowProgress("", std::max(1, std::min(99, (int)(((double)file.tellg() / (double)nFilesize) * 100))));
         std::string line;
         std::getline(file, line);
         if (line.empty() || line[0] == '#')
@@ -260,7 +473,7 @@ Value importwallet(const Array& params, bool fHelp)
         CPubKey pubkey = key.GetPubKey();
         assert(key.VerifyPubKey(pubkey));
         CKeyID keyid = pubkey.GetID();
-        if (pwalletMain->HaveKey(keyid)) {
+        if (pwallet->HaveKey(keyid)) {
             LogPrintf("Skipping import of %s (key already present)\n", CBitcoinAddress(keyid));
             continue;
         }
@@ -280,28 +493,28 @@ Value importwallet(const Array& params, bool fHelp)
             }
         }
         LogPrintf("Importing %s...\n", CBitcoinAddress(keyid));
-        if (!pwalletMain->AddKeyPubKey(key, pubkey)) {
+        if (!pwallet->AddKeyPubKey(key, pubkey)) {
             fGood = false;
             continue;
         }
-        pwalletMain->mapKeyMetadata[keyid].nCreateTime = nTime;
+        pwallet->mapKeyMetadata[keyid].nCreateTime = nTime;
         if (fLabel)
-            pwalletMain->SetAddressBook(keyid, strLabel, "receive");
+            pwallet->SetAddressBook(keyid, strLabel, "receive");
         nTimeBegin = std::min(nTimeBegin, nTime);
     }
     file.close();
-    pwalletMain->ShowProgress("", 100); // hide progress dialog in GUI
+    pwallet->ShowProgress("", 100); // hide progress dialog in GUI
 
     CBlockIndex* pindex = chainActive.Tip();
     while (pindex && pindex->pprev && pindex->GetBlockTime() > nTimeBegin - 7200)
         pindex = pindex->pprev;
 
-    if (!pwalletMain->nTimeFirstKey || nTimeBegin < pwalletMain->nTimeFirstKey)
-        pwalletMain->nTimeFirstKey = nTimeBegin;
+    if (!pwallet->nTimeFirstKey || nTimeBegin < pwallet->nTimeFirstKey)
+        pwallet->nTimeFirstKey = nTimeBegin;
 
     LogPrintf("Rescanning last %i blocks\n", chainActive.Height() - pindex->nHeight + 1);
-    pwalletMain->ScanForWalletTransactions(pindex);
-    pwalletMain->RecomputeCachedQuantities();
+    pwallet->ScanForWalletTransactions(pindex);
+    pwallet->RecomputeCachedQuantities();
 
     if (!fGood)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error adding some keys to wallet");
@@ -311,6 +524,7 @@ Value importwallet(const Array& params, bool fHelp)
 
 Value dumpprivkey(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 1)
         throw runtime_error(
             "dumpprivkey \"izzyaddress\"\n"
@@ -333,13 +547,14 @@ Value dumpprivkey(const Array& params, bool fHelp)
     if (!address.GetKeyID(keyID))
         throw JSONRPCError(RPC_TYPE_ERROR, "Address does not refer to a key");
     CKey vchSecret;
-    if (!pwalletMain->GetKey(keyID, vchSecret))
+    if (!pwallet->GetKey(keyID, vchSecret))
         throw JSONRPCError(RPC_WALLET_ERROR, "Private key for address " + strAddress + " is not known");
     return CBitcoinSecret(vchSecret).ToString();
 }
 
 Value dumphdinfo(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 0)
         throw std::runtime_error(
             "dumphdinfo\n"
@@ -355,15 +570,15 @@ Value dumphdinfo(const Array& params, bool fHelp)
             + HelpExampleRpc("dumphdinfo", "")
         );
 
-    LOCK(pwalletMain->cs_wallet);
+    LOCK(pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
     CHDChain hdChainCurrent;
-    if (!pwalletMain->GetHDChain(hdChainCurrent))
+    if (!pwallet->GetHDChain(hdChainCurrent))
         throw JSONRPCError(RPC_WALLET_ERROR, "This wallet is not a HD wallet.");
 
-    if (!pwalletMain->GetDecryptedHDChain(hdChainCurrent))
+    if (!pwallet->GetDecryptedHDChain(hdChainCurrent))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot decrypt HD seed");
 
     SecureString ssMnemonic;
@@ -380,6 +595,7 @@ Value dumphdinfo(const Array& params, bool fHelp)
 
 Value dumpwallet(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 1)
         throw runtime_error(
             "dumpwallet \"filename\"\n"
@@ -398,8 +614,8 @@ Value dumpwallet(const Array& params, bool fHelp)
 
     std::map<CKeyID, int64_t> mapKeyBirth;
     std::set<CKeyID> setKeyPool;
-    pwalletMain->GetKeyBirthTimes(mapKeyBirth);
-    pwalletMain->GetAllReserveKeys(setKeyPool);
+    pwallet->GetKeyBirthTimes(mapKeyBirth);
+    pwallet->GetAllReserveKeys(setKeyPool);
 
     // sort time/key pairs
     std::vector<std::pair<int64_t, CKeyID> > vKeyBirth;
@@ -418,10 +634,10 @@ Value dumpwallet(const Array& params, bool fHelp)
 
     // add the base58check encoded extended master if the wallet uses HD
     CHDChain hdChainCurrent;
-    if (pwalletMain->GetHDChain(hdChainCurrent))
+    if (pwallet->GetHDChain(hdChainCurrent))
     {
 
-        if (!pwalletMain->GetDecryptedHDChain(hdChainCurrent))
+        if (!pwallet->GetDecryptedHDChain(hdChainCurrent))
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot decrypt HD chain");
 
         SecureString ssMnemonic;
@@ -466,16 +682,16 @@ Value dumpwallet(const Array& params, bool fHelp)
         std::string strTime = EncodeDumpTime(it->first);
         std::string strAddr = CBitcoinAddress(keyid).ToString();
         CKey key;
-        if (pwalletMain->GetKey(keyid, key)) {
-            if (pwalletMain->mapAddressBook.count(keyid)) {
-                file << strprintf("%s %s label=%s # addr=%s", CBitcoinSecret(key).ToString(), strTime, EncodeDumpString(pwalletMain->mapAddressBook[keyid].name), strAddr);
+        if (pwallet->GetKey(keyid, key)) {
+            if (pwallet->mapAddressBook.count(keyid)) {
+                file << strprintf("%s %s label=%s # addr=%s", CBitcoinSecret(key).ToString(), strTime, EncodeDumpString(pwallet->mapAddressBook[keyid].name), strAddr);
             } else if (setKeyPool.count(keyid)) {
                 file << strprintf("%s %s reserve=1 # addr=%s", CBitcoinSecret(key).ToString(), strTime, strAddr);
             } else {
                 file << strprintf("%s %s change=1 # addr=%s", CBitcoinSecret(key).ToString(), strTime, strAddr);
             }
 
-            file << strprintf(" %s", pwalletMain->mapHdPubKeys.at(keyid).GetKeyPath());
+            file << strprintf(" %s", pwallet->mapHdPubKeys.at(keyid).GetKeyPath());
 
             file << "\n";
         }
@@ -488,6 +704,7 @@ Value dumpwallet(const Array& params, bool fHelp)
 
 Value bip38encrypt(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 2)
         throw runtime_error(
             "bip38encrypt \"izzyaddress\"\n"
@@ -511,7 +728,7 @@ Value bip38encrypt(const Array& params, bool fHelp)
     if (!address.GetKeyID(keyID))
         throw JSONRPCError(RPC_TYPE_ERROR, "Address does not refer to a key");
     CKey vchSecret;
-    if (!pwalletMain->GetKey(keyID, vchSecret))
+    if (!pwallet->GetKey(keyID, vchSecret))
         throw JSONRPCError(RPC_WALLET_ERROR, "Private key for address " + strAddress + " is not known");
 
 #if 0 // TODO: check this
@@ -528,6 +745,7 @@ Value bip38encrypt(const Array& params, bool fHelp)
 
 Value bip38decrypt(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 2)
         throw runtime_error(
             "bip38decrypt \"izzyaddress\"\n"
@@ -540,6 +758,9 @@ Value bip38decrypt(const Array& params, bool fHelp)
             "\"key\"                (string) The decrypted private key\n"
             "\nExamples:\n");
 
+    if (fHavePruned)
+        throw JSONRPCError(RPC_WALLET_ERROR, "Rescan is disabled once block files were pruned");
+
     EnsureWalletIsUnlocked();
 
     /** Collect private key and passphrase **/
@@ -566,21 +787,21 @@ Value bip38decrypt(const Array& params, bool fHelp)
     result.push_back(Pair("Address", CBitcoinAddress(pubkey.GetID()).ToString()));
     CKeyID vchAddress = pubkey.GetID();
     {
-        pwalletMain->RecomputeCachedQuantities();
-        pwalletMain->SetAddressBook(vchAddress, "", "receive");
+        pwallet->RecomputeCachedQuantities();
+        pwallet->SetAddressBook(vchAddress, "", "receive");
 
         // Don't throw error in case a key is already there
-        if (pwalletMain->HaveKey(vchAddress))
+        if (pwallet->HaveKey(vchAddress))
             throw JSONRPCError(RPC_WALLET_ERROR, "Key already held by wallet");
 
-        pwalletMain->mapKeyMetadata[vchAddress].nCreateTime = 1;
+        pwallet->mapKeyMetadata[vchAddress].nCreateTime = 1;
 
-        if (!pwalletMain->AddKeyPubKey(key, pubkey))
+        if (!pwallet->AddKeyPubKey(key, pubkey))
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding key to wallet");
 
         // whenever a key is imported, we need to scan the whole chain
-        pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+        pwallet->nTimeFirstKey = 1; // 0 would be considered 'no value'
+        pwallet->ScanForWalletTransactions(chainActive.Genesis(), true);
     }
 
     return result;
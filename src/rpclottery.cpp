@@ -8,11 +8,50 @@
 #include <base58address.h>
 #include <rpcprotocol.h>
 #include <sync.h>
+#include <LotteryStandings.h>
+#include <I_SuperblockHeightValidator.h>
+#include <rpcserver.h>
+#include <utilstrencodings.h>
+#ifdef ENABLE_WALLET
+#include <wallet_ismine.h>
+#include <wallet.h>
+#endif
 
 extern CChain chainActive;
 extern CCriticalSection cs_main;
+#ifdef ENABLE_WALLET
+extern CWallet* pwalletMain;
+#endif
 using namespace json_spirit;
 
+static const SuperblockSubsidyContainer& GetSubsidyContainer()
+{
+    static SuperblockSubsidyContainer subsidyCointainer(Params());
+    return subsidyCointainer;
+}
+
+static const LotteryWinnersCalculator& GetLotteryWinnersCalculator()
+{
+    static LotteryWinnersCalculator calculator(
+        Params().GetLotteryBlockStartBlock(),chainActive, GetSporkManager(),GetSubsidyContainer().superblockHeightValidator());
+    return calculator;
+}
+
+static std::string PaymentScriptToAddresses(const CScript& paymentScript)
+{
+    txnouttype outputType;
+    std::vector<CTxDestination> addresses;
+    int requiredSigs;
+    ExtractDestinations(paymentScript, outputType, addresses, requiredSigs);
+    std::string destinationString = "";
+    for(const CTxDestination& dest: addresses)
+    {
+        destinationString += CBitcoinAddress(dest).ToString();
+        destinationString += ":";
+    }
+    return destinationString.substr(0, destinationString.size()-1);
+}
+
 Value getlotteryblockwinners(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -40,10 +79,7 @@ Value getlotteryblockwinners(const Array& params, bool fHelp)
 
 
 
-    static const CChainParams& chainParameters = Params();
-    static SuperblockSubsidyContainer subsidyCointainer(chainParameters);
-    static LotteryWinnersCalculator calculator(
-        chainParameters.GetLotteryBlockStartBlock(),chainActive, GetSporkManager(),subsidyCointainer.superblockHeightValidator());
+    const LotteryWinnersCalculator& calculator = GetLotteryWinnersCalculator();
     const CBlockIndex* chainTip = nullptr;
     {
         LOCK(cs_main);
@@ -68,19 +104,7 @@ Value getlotteryblockwinners(const Array& params, bool fHelp)
         Object coinstakeResult;
         const auto& rankAwareEntry = lotteryCurrentResults[coinstake.first];
 
-        txnouttype outputType;
-        std::vector<CTxDestination> addresses;
-        int requiredSigs;
-        ExtractDestinations(coinstake.second, outputType, addresses, requiredSigs);
-        std::string destinationString = "";
-        for(const CTxDestination& dest: addresses)
-        {
-            destinationString += CBitcoinAddress(dest).ToString();
-            destinationString += ":";
-        }
-        destinationString = destinationString.substr(0, destinationString.size()-1);
-
-        coinstakeResult.push_back(Pair("Address", destinationString));
+        coinstakeResult.push_back(Pair("Address", PaymentScriptToAddresses(coinstake.second)));
         coinstakeResult.push_back(Pair("Rank", static_cast<uint64_t>(rankAwareEntry.rank) ));
         coinstakeResult.push_back(Pair("Score", rankAwareEntry.score.ToString().substr(0,8) ));
 
@@ -88,4 +112,75 @@ Value getlotteryblockwinners(const Array& params, bool fHelp)
     }
     result.push_back(Pair("Lottery Candidates",lotteryResults));
     return result;
-}
\ No newline at end of file
+}
+
+Value getlotterystandings(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw std::runtime_error(
+            "getlotterystandings\n"
+            "\nReturns where the lottery stands at the chain tip: the candidates in the order they would be paid,\n"
+            "the scripts that may not win again yet and when the next lottery block is due.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\": n,                 (numeric) The height of the chain tip\n"
+            "  \"blockhash\": \"hash\",         (string) The hash of the chain tip\n"
+            "  \"lastlotteryheight\": n,      (numeric) The lottery block the candidates are scored against\n"
+            "  \"lotterycycle\": n,           (numeric) The blocks between lottery blocks\n"
+            "  \"nextlotteryheight\": n,      (numeric) The height of the next lottery block\n"
+            "  \"blockstonextlottery\": n,    (numeric) The blocks left until the next lottery block\n"
+            "  \"candidates\": [              (array) The candidates from the highest score down\n"
+            "    {\n"
+            "      \"rank\": n,               (numeric) The position of the candidate\n"
+            "      \"address\": \"address\",    (string) The address the candidate would be paid to\n"
+            "      \"coinstake\": \"hash\",     (string) The transaction that entered the candidate\n"
+            "      \"score\": \"hex\",          (string) The candidate's score for this lottery\n"
+            "      \"duplicate\": true|false, (boolean) Whether a higher candidate pays the same address\n"
+            "      \"ismine\": true|false     (boolean) Whether the address belongs to this wallet\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"vetoesapply\": true|false,   (boolean) Whether recent winners are kept from winning again\n"
+            "  \"vetoed\": [ \"address\", ... ] (array) The addresses of the winners of the prior lotteries\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getlotterystandings", "") + HelpExampleRpc("getlotterystandings", ""));
+
+    static LotteryStandings standings(GetLotteryWinnersCalculator(),GetSubsidyContainer().superblockHeightValidator());
+    LOCK(cs_main);
+    const CBlockIndex* chainTip = chainActive.Tip();
+    if(!chainTip) throw JSONRPCError(RPC_MISC_ERROR,"No chain tip.");
+    const LotteryStandings::Snapshot snapshot = standings.GetSnapshot(chainTip);
+
+    Object result;
+    result.push_back(Pair("height",snapshot.height));
+    result.push_back(Pair("blockhash",snapshot.blockHash.GetHex()));
+    result.push_back(Pair("lastlotteryheight",snapshot.lastLotteryHeight));
+    result.push_back(Pair("lotterycycle",snapshot.lotteryCycleLength));
+    result.push_back(Pair("nextlotteryheight",snapshot.nextLotteryHeight));
+    result.push_back(Pair("blockstonextlottery",snapshot.nextLotteryHeight < 0 ? -1 : snapshot.nextLotteryHeight - snapshot.height));
+    Array candidates;
+    for(const LotteryStandings::Candidate& candidate: snapshot.candidates)
+    {
+        Object entry;
+        entry.push_back(Pair("rank",static_cast<uint64_t>(candidate.rank)));
+        entry.push_back(Pair("address",PaymentScriptToAddresses(candidate.paymentScript)));
+        entry.push_back(Pair("coinstake",candidate.coinstakeHash.GetHex()));
+        entry.push_back(Pair("score",candidate.score.GetHex()));
+        entry.push_back(Pair("duplicate",candidate.isDuplicateScript));
+#ifdef ENABLE_WALLET
+        entry.push_back(Pair("ismine",pwalletMain != NULL && IsMine(*pwalletMain,candidate.paymentScript) != ISMINE_NO));
+#else
+        entry.push_back(Pair("ismine",false));
+#endif
+        candidates.push_back(entry);
+    }
+    result.push_back(Pair("candidates",candidates));
+    result.push_back(Pair("vetoesapply",snapshot.vetoesApply));
+    Array vetoed;
+    for(const CScript& paymentScript: snapshot.vetoedScripts)
+    {
+        vetoed.push_back(PaymentScriptToAddresses(paymentScript));
+    }
+    result.push_back(Pair("vetoed",vetoed));
+    return result;
+}
@@ -156,7 +156,7 @@ Value fundmasternode(const Array& params, bool fHelp)
     }
 
     EnsureWalletIsUnlocked();
-    pwalletMain->TopUpKeyPool();
+    pwalletMain->RequestKeyPoolTopUp();
 
     // Generate a new key that is added to wallet
     CBitcoinAddress address = GetAccountAddress("reserved->" + alias);
@@ -30,7 +30,10 @@
 #include <txmempool.h>
 #include <sync.h>
 
+#include <algorithm>
+
 #include <boost/assign/list_of.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "json/json_spirit_utils.h"
 #include "json/json_spirit_value.h"
@@ -39,6 +42,13 @@
 #include <coins.h>
 #include <FeeRate.h>
 #include <FeeAndPriorityCalculator.h>
+#include <StakingStatistics.h>
+#include <StakingSimulator.h>
+#include <StakingData.h>
+#include <StakableCoin.h>
+#include <ProofOfStakeKernelSearch.h>
+#include <kernel.h>
+#include <defaultValues.h>
 
 extern NotificationInterfaceRegistry registry;//TODO: rid this
 using namespace json_spirit;
@@ -54,6 +64,77 @@ extern CTxMemPool mempool;
 
 LastExtensionTimestampByBlockHeight& mapHashedBlocks = getLastExtensionTimestampByBlockHeight();
 #ifdef ENABLE_WALLET
+//! Attempts at a block, each on a later mock time, before a batch with a time step gives up
+static const int MAX_GENERATE_ATTEMPTS_PER_BLOCK = 10;
+
+/**
+ * Mines nGenerate blocks one after another on the calling thread, proof of
+ * stake past the last proof-of-work block, for chains that mine on demand.
+ * With a time step, the mock time is moved that many seconds past the later
+ * of itself and the tip before every attempt, so that the blocks get times
+ * of their own and stakes find new kernels without the caller bumping it.
+ */
+static Array GenerateBlocksOnDemand(int nGenerate, int64_t nTimeStep)
+{
+    int nHeight = 0;
+    int nHeightEnd = 0;
+
+    { // Don't keep cs_main locked
+        LOCK(cs_main);
+        nHeight = chainActive.Height();
+        nHeightEnd = nHeight + nGenerate;
+    }
+
+    Array blockHashes;
+    CoinMintingModule mintingModule(
+        settings,
+        cs_main,
+        Params(),
+        chainActive,
+        GetMasternodeSync(),
+        FeeAndPriorityCalculator::instance().getFeeRateQuote(),
+        pcoinsTip,
+        GetMasternodePayments(),
+        mempool,
+        vNodes,
+        *pwalletMain,
+        mapHashedBlocks,
+        GetStakingStatistics(),
+        GetMintingWakeup(),
+        mapBlockIndex,
+        GetSporkManager());
+    I_CoinMinter& minter = mintingModule.coinMinter();
+
+    while (nHeight < nHeightEnd)
+    {
+        const bool fProofOfStake = (nHeight >= Params().LAST_POW_BLOCK());
+
+        bool newBlockAdded = false;
+        for (int nAttempt = 0; !newBlockAdded && nAttempt < (nTimeStep > 0 ? MAX_GENERATE_ATTEMPTS_PER_BLOCK : 1); nAttempt++) {
+            if (nTimeStep > 0) {
+                int64_t nTipTime;
+                {
+                    LOCK(cs_main);
+                    nTipTime = chainActive.Tip()->GetBlockTime();
+                }
+                SetMockTime(std::max(GetTime(), nTipTime) + nTimeStep);
+            }
+            unsigned int nExtraNonce = 0;
+            newBlockAdded = minter.createNewBlock(nExtraNonce, fProofOfStake);
+        }
+        nHeight += newBlockAdded;
+
+        if (!newBlockAdded)
+            throw JSONRPCError(RPC_VERIFY_ERROR, "failed to generate a valid block");
+
+        // Don't keep cs_main locked
+        LOCK(cs_main);
+        if(nHeight == chainActive.Height())
+            blockHashes.push_back(chainActive.Tip()->GetBlockHash().GetHex());
+    }
+    return blockHashes;
+}
+
 Value setgenerate(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -90,53 +171,7 @@ Value setgenerate(const Array& params, bool fHelp)
 
     // -regtest mode: don't return until nGenProcLimit blocks are generated
     if (fGenerate && Params().MineBlocksOnDemand()) {
-        int nHeightStart = 0;
-        int nHeightEnd = 0;
-        int nHeight = 0;
-        int nGenerate = (nGenProcLimit > 0 ? nGenProcLimit : 1);
-
-        { // Don't keep cs_main locked
-            LOCK(cs_main);
-            nHeightStart = chainActive.Height();
-            nHeight = nHeightStart;
-            nHeightEnd = nHeightStart + nGenerate;
-        }
-
-        Array blockHashes;
-        CoinMintingModule mintingModule(
-            settings,
-            cs_main,
-            Params(),
-            chainActive,
-            GetMasternodeSync(),
-            FeeAndPriorityCalculator::instance().getFeeRateQuote(),
-            pcoinsTip,
-            GetMasternodePayments(),
-            mempool,
-            vNodes,
-            *pwalletMain,
-            mapHashedBlocks,
-            mapBlockIndex,
-            GetSporkManager());
-        I_CoinMinter& minter = mintingModule.coinMinter();
-
-        while (nHeight < nHeightEnd)
-        {
-            const bool fProofOfStake = (nHeight >= Params().LAST_POW_BLOCK());
-
-            unsigned int nExtraNonce = 0;
-            const bool newBlockAdded = minter.createNewBlock(nExtraNonce, fProofOfStake);
-            nHeight +=  newBlockAdded;
-
-            if (!newBlockAdded)
-                throw JSONRPCError(RPC_VERIFY_ERROR, "failed to generate a valid block");
-
-            // Don't keep cs_main locked
-            LOCK(cs_main);
-            if(nHeight == chainActive.Height())
-                blockHashes.push_back(chainActive.Tip()->GetBlockHash().GetHex());
-        }
-        return blockHashes;
+        return GenerateBlocksOnDemand(nGenProcLimit > 0 ? nGenProcLimit : 1, 0);
     }
     else // Not -regtest: start generate thread, return immediately
     {
@@ -148,6 +183,38 @@ Value setgenerate(const Array& params, bool fHelp)
     return Value::null;
 }
 
+Value generate(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "generate nblocks ( timestep )\n"
+            "\nMine nblocks blocks right away, proof of stake past the last proof-of-work block (regtest only).\n"
+            "The blocks are mined one after another within the node and relayed to its peers as they are found.\n"
+            "\nArguments:\n"
+            "1. nblocks          (numeric, required) How many blocks to mine\n"
+            "2. timestep         (numeric, optional, default=0) Seconds to move the mock time on past the later of itself\n"
+            "                    and the tip before each block, so that staking finds new kernels without setmocktime calls\n"
+            "\nResult\n"
+            "[ blockhashes ]     (array) hashes of the blocks mined\n"
+            "\nExamples:\n"
+            "\nMine 100 proof-of-stake blocks a minute apart\n" +
+            HelpExampleCli("generate", "100 60") + HelpExampleRpc("generate", "100, 60"));
+
+    if (pwalletMain == NULL)
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found (disabled)");
+    if (!Params().MineBlocksOnDemand())
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "This method can only be used on regtest");
+
+    const int nGenerate = params[0].get_int();
+    if (nGenerate <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid nblocks, must be positive");
+    const int64_t nTimeStep = params.size() > 1 ? params[1].get_int64() : 0;
+    if (nTimeStep < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid timestep, must not be negative");
+
+    return GenerateBlocksOnDemand(nGenerate, nTimeStep);
+}
+
 Value generateblock(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -195,6 +262,8 @@ Value generateblock(const Array& params, bool fHelp)
         vNodes,
         *pwalletMain,
         mapHashedBlocks,
+        GetStakingStatistics(),
+        GetMintingWakeup(),
         mapBlockIndex,
         GetSporkManager());
     I_CoinMinter& minter = mintingModule.coinMinter();
@@ -271,6 +340,221 @@ Value getmininginfo(const Array& params, bool fHelp)
     return obj;
 }
 
+unsigned int CountOrphanedStakes(const std::vector<uint256>& stakedBlocks)
+{
+    LOCK(cs_main);
+    unsigned int nOrphaned = 0;
+    for (const uint256& blockHash : stakedBlocks) {
+        BlockMap::const_iterator it = mapBlockIndex.find(blockHash);
+        if (it == mapBlockIndex.end() || !chainActive.Contains(it->second))
+            ++nOrphaned;
+    }
+    return nOrphaned;
+}
+
+Object StakingStatisticsToJSON(const StakingStatistics::Snapshot& snapshot, unsigned int nOrphanedStakes)
+{
+    const int64_t kernelSearchMicros = snapshot.stages[static_cast<unsigned>(StakingStage::KERNEL_SEARCH)].totalMicros;
+
+    Object obj;
+    obj.push_back(Pair("since", snapshot.startTime));
+    obj.push_back(Pair("attempts", snapshot.attempts));
+    obj.push_back(Pair("coinsscanned", snapshot.coinsScanned));
+    obj.push_back(Pair("kernelshashed", snapshot.kernelsHashed));
+    obj.push_back(Pair("kernelspersec", kernelSearchMicros > 0 ? 1000000.0 * snapshot.kernelsHashed / kernelSearchMicros : 0.0));
+    obj.push_back(Pair("stakesfound", snapshot.stakesFound));
+    obj.push_back(Pair("blocksaccepted", snapshot.blocksAccepted));
+    obj.push_back(Pair("orphanedstakes", (uint64_t)nOrphanedStakes));
+
+    Object misses;
+    for (unsigned miss = 0; miss < StakingStatistics::NUMBER_OF_MISSES; miss++)
+        misses.push_back(Pair(StakingStatistics::MissName(static_cast<StakingMiss>(miss)), snapshot.misses[miss]));
+    obj.push_back(Pair("misses", misses));
+
+    Object stages;
+    for (unsigned stage = 0; stage < StakingStatistics::NUMBER_OF_STAGES; stage++) {
+        const StakingStatistics::StageTimings& timings = snapshot.stages[stage];
+        Object entry;
+        entry.push_back(Pair("count", timings.count));
+        entry.push_back(Pair("totalms", timings.totalMicros / 1000.0));
+        entry.push_back(Pair("averagems", timings.count > 0 ? timings.totalMicros / 1000.0 / timings.count : 0.0));
+        entry.push_back(Pair("maxms", timings.maximumMicros / 1000.0));
+        Array histogram;
+        for (unsigned bucket = 0; bucket < StakingStatistics::NUMBER_OF_BUCKETS; bucket++) {
+            const int64_t upperBound = StakingStatistics::BucketUpperBound(bucket);
+            Object bin;
+            bin.push_back(Pair("upto", upperBound < 0 ? Value("inf") : Value(upperBound / 1000.0)));
+            bin.push_back(Pair("count", timings.buckets[bucket]));
+            histogram.push_back(bin);
+        }
+        entry.push_back(Pair("histogram", histogram));
+        stages.push_back(Pair(StakingStatistics::StageName(static_cast<StakingStage>(stage)), entry));
+    }
+    obj.push_back(Pair("stages", stages));
+    return obj;
+}
+
+Value getstakingstats(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getstakingstats ( reset )\n"
+            "\nReturns counters and timings of the staking attempts made since startup or the last reset.\n"
+            "\nArguments:\n"
+            "1. reset           (boolean, optional, default=false) Start the counters over after reporting them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"since\": n,               (numeric) The time the counters started at\n"
+            "  \"attempts\": n,            (numeric) The attempts to create a coinstake\n"
+            "  \"coinsscanned\": n,        (numeric) The coins whose kernels were searched\n"
+            "  \"kernelshashed\": n,       (numeric) The kernel hashes evaluated\n"
+            "  \"kernelspersec\": x.xxx,   (numeric) The kernel hashes evaluated per second of kernel search\n"
+            "  \"stakesfound\": n,         (numeric) The coinstakes created\n"
+            "  \"blocksaccepted\": n,      (numeric) The staked blocks accepted by this node\n"
+            "  \"orphanedstakes\": n,      (numeric) The recently accepted staked blocks no longer in the active chain\n"
+            "  \"misses\": {               (object) The attempts that did not produce a block, by reason\n"
+            "    \"reason\": n, ...\n"
+            "  },\n"
+            "  \"stages\": {               (object) The timings of each part of an attempt\n"
+            "    \"stage\": {\n"
+            "      \"count\": n,           (numeric) The times the stage ran\n"
+            "      \"totalms\": x.xxx,     (numeric) The milliseconds spent in the stage\n"
+            "      \"averagems\": x.xxx,   (numeric) The average milliseconds the stage took\n"
+            "      \"maxms\": x.xxx,       (numeric) The longest the stage took, in milliseconds\n"
+            "      \"histogram\": [        (array) The times the stage took up to each bound, in milliseconds\n"
+            "        { \"upto\": x.xxx, \"count\": n }, ...\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getstakingstats", "") + HelpExampleRpc("getstakingstats", "true"));
+
+    StakingStatistics& stakingStatistics = GetStakingStatistics();
+    const StakingStatistics::Snapshot snapshot = stakingStatistics.GetSnapshot();
+    if (params.size() > 0 && params[0].get_bool())
+        stakingStatistics.Reset();
+
+    return StakingStatisticsToJSON(snapshot, CountOrphanedStakes(snapshot.stakedBlocks));
+}
+
+
+#ifdef ENABLE_WALLET
+Object StakingSimulationToJSON(unsigned int nParts, CAmount nAmount, int64_t nSeconds, const StakingSimulator::Result& result)
+{
+    Object obj;
+    obj.push_back(Pair("parts", (uint64_t)nParts));
+    obj.push_back(Pair("outputs", (uint64_t)result.numberOfCoins));
+    obj.push_back(Pair("outputvalue", ValueFromAmount(result.numberOfCoins > 0 ? nAmount / result.numberOfCoins : 0)));
+    obj.push_back(Pair("stakes", (uint64_t)result.blocksStaked));
+    obj.push_back(Pair("stakesperday", nSeconds > 0 ? 86400.0 * result.blocksStaked / nSeconds : 0.0));
+    obj.push_back(Pair("kernelshashed", result.kernelsHashed));
+    return obj;
+}
+
+Value simulatestaking(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "simulatestaking ( blocks [parts,...] )\n"
+            "\nReplays the last blocks of the active chain against the coins this wallet can stake, with each coin\n"
+            "split into the given numbers of parts, and reports the blocks they would have staked.\n"
+            "A coin wins a block if it has a kernel between the block's parent and the block itself, and then\n"
+            "counts as restaked in that block.\n"
+            "\nArguments:\n"
+            "1. blocks          (numeric, optional, default=1000) The number of blocks to replay, at most 10000\n"
+            "2. parts           (array, optional, default=[1,2,4,8,16]) The numbers of parts to split each coin into\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": n,                (numeric) The blocks replayed\n"
+            "  \"amount\": x.xxx,            (numeric) The value of the stakable coins\n"
+            "  \"configurations\": [         (array) The outcome of each split\n"
+            "    {\n"
+            "      \"parts\": n,             (numeric) The parts each coin was split into\n"
+            "      \"outputs\": n,           (numeric) The coins that were staking\n"
+            "      \"outputvalue\": x.xxx,   (numeric) The average value of a coin\n"
+            "      \"stakes\": n,            (numeric) The blocks the coins would have staked\n"
+            "      \"stakesperday\": x.xxx,  (numeric) The stakes per day over the time the blocks took\n"
+            "      \"kernelshashed\": n      (numeric) The kernel hashes it took\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"best\": n,                  (numeric) The parts of the configuration with the most stakes, the fewest on a tie\n"
+            "  \"stakesplitthreshold\": n    (numeric) A -stakesplitthreshold that keeps coins near the best output value\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("simulatestaking", "") + HelpExampleCli("simulatestaking", "5000 \"[1,3,10]\"") +
+            HelpExampleRpc("simulatestaking", "5000, [1,3,10]"));
+
+    if (pwalletMain == NULL)
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found (disabled)");
+
+    int nBlocks = 1000;
+    if (params.size() > 0)
+        nBlocks = params[0].get_int();
+    if (nBlocks < 1 || nBlocks > 10000)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of blocks, must be between 1 and 10000");
+
+    std::vector<unsigned int> vParts = {1, 2, 4, 8, 16};
+    if (params.size() > 1) {
+        vParts.clear();
+        for (const Value& part : params[1].get_array()) {
+            if (part.get_int() < 1 || part.get_int() > 1000)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of parts, must be between 1 and 1000");
+            vParts.push_back(part.get_int());
+        }
+        if (vParts.empty())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "No numbers of parts given");
+    }
+    std::sort(vParts.begin(), vParts.end());
+    vParts.erase(std::unique(vParts.begin(), vParts.end()), vParts.end());
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    std::set<StakableCoin> stakableCoins;
+    int64_t nextChangeTime = 0;
+    int nextChangeHeight = 0;
+    pwalletMain->SelectStakeCoins(stakableCoins, nextChangeTime, nextChangeHeight);
+    std::vector<StakingData> coins;
+    CAmount nAmount = 0;
+    for (const StakableCoin& coin : stakableCoins) {
+        const CTxOut& output = coin.tx->vout[coin.outputIndex];
+        coins.push_back(StakingData(0, 0, coin.blockHashOfFirstConfirmation, coin.utxo, output.nValue, uint256(0)));
+        nAmount += output.nValue;
+    }
+
+    const unsigned nThreads = std::max(1u, std::min<unsigned>(boost::thread::hardware_concurrency(), MAX_STAKING_THREADS));
+    const ProofOfStakeKernelSearch kernelSearch(GetProofOfStakeGenerator(chainActive), nThreads);
+    const StakingSimulator simulator(chainActive, mapBlockIndex, kernelSearch);
+    const int nLastHeight = chainActive.Height();
+    const int nFirstHeight = std::max(1, nLastHeight - nBlocks + 1);
+    const int64_t nSeconds = nLastHeight >= nFirstHeight ?
+        chainActive[nLastHeight]->GetBlockTime() - chainActive[nFirstHeight - 1]->GetBlockTime() : 0;
+
+    Array configurations;
+    unsigned int nBestParts = vParts.front();
+    unsigned int nBestStakes = 0;
+    CAmount nBestOutputValue = 0;
+    for (unsigned int nParts : vParts) {
+        const StakingSimulator::Result result =
+            simulator.Simulate(StakingSimulator::SplitCoins(coins, nParts), nFirstHeight, nLastHeight);
+        if (result.blocksStaked > nBestStakes) {
+            nBestParts = nParts;
+            nBestStakes = result.blocksStaked;
+            nBestOutputValue = result.numberOfCoins > 0 ? nAmount / result.numberOfCoins : 0;
+        }
+        configurations.push_back(StakingSimulationToJSON(nParts, nAmount, nSeconds, result));
+    }
+
+    Object obj;
+    obj.push_back(Pair("blocks", std::max(0, nLastHeight - nFirstHeight + 1)));
+    obj.push_back(Pair("amount", ValueFromAmount(nAmount)));
+    obj.push_back(Pair("configurations", configurations));
+    obj.push_back(Pair("best", (uint64_t)nBestParts));
+    // A coin is split in two once its value and reward exceed the threshold
+    obj.push_back(Pair("stakesplitthreshold", nBestStakes > 0 ? (int64_t)(2 * nBestOutputValue / COIN) : Value::null));
+    return obj;
+}
+#endif
 
 // NOTE: Unlike wallet RPC (which use IZZY values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 Value prioritisetransaction(const Array& params, bool fHelp)
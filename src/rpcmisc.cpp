@@ -19,6 +19,7 @@
 #endif
 
 #include <stdint.h>
+#include <limits>
 
 #include "json/json_spirit_utils.h"
 #include "json/json_spirit_value.h"
@@ -26,6 +27,8 @@
 #include <txdb.h>
 #include <addressindex.h>
 #include <spentindex.h>
+#include <VaultIndex.h>
+#include <script/StakingVaultScript.h>
 #include <net.h>
 #include <obfuscation.h>
 #include <txmempool.h>
@@ -35,6 +38,12 @@
 #include <FeeAndPriorityCalculator.h>
 
 #include <Settings.h>
+#include <defaultValues.h>
+#include <LockProfiler.h>
+#include <MemoryStatistics.h>
+#include <PerformanceStatistics.h>
+#include <streams.h>
+#include <utilstrencodings.h>
 extern Settings& settings;
 
 using namespace boost;
@@ -71,10 +80,30 @@ bool GetAddressIndex(bool addresIndexEnabled,
                      int start = 0,
                      int end = 0);
 
+bool GetAddressIndexPage(bool addresIndexEnabled,
+                         CBlockTreeDB* pblocktree,
+                         uint160 addressHash,
+                         int type,
+                         int start,
+                         int end,
+                         bool fNewestFirst,
+                         unsigned int nMaxTransactions,
+                         const CAddressIndexKey* pkeyAfter,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                         bool& fMore);
+
+bool GetAddressBalance(bool addresIndexEnabled,
+                       CBlockTreeDB* pblocktree,
+                       uint160 addressHash,
+                       int type,
+                       CAddressBalance& balance);
+
 std::string GetWarnings(std::string strFor);
 
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 
+bool GetVaultIndex(VaultIndexRole role, const uint160& keyHash, std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vaults);
+
 bool GetAddressUnspent(bool addresIndexEnabled,
                       CBlockTreeDB* pblocktree,
                       uint160 addressHash,
@@ -82,6 +111,17 @@ bool GetAddressUnspent(bool addresIndexEnabled,
                       std::vector<std::pair<CAddressUnspentKey,
                       CAddressUnspentValue> > &unspentOutputs);
 
+bool GetAddressUnspentPage(bool addresIndexEnabled,
+                           CBlockTreeDB* pblocktree,
+                           uint160 addressHash,
+                           int type,
+                           int nMinHeight,
+                           CAmount nMinAmount,
+                           unsigned int nMaxOutputs,
+                           const CAddressUnspentKey* pkeyAfter,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                           bool& fMore);
+
 Value ban(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -194,9 +234,10 @@ Value getinfo(const Array& params, bool fHelp)
     obj.push_back(Pair("version", CLIENT_VERSION_STR));
     obj.push_back(Pair("protocolversion", PROTOCOL_VERSION));
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
-        obj.push_back(Pair("walletversion", pwalletMain->GetVersion()));
-        obj.push_back(Pair("balance", ValueFromAmount(pwalletMain->GetBalance())));
+    CWallet* const pwallet = GetWalletForRPC();
+    if (pwallet) {
+        obj.push_back(Pair("walletversion", pwallet->GetVersion()));
+        obj.push_back(Pair("balance", ValueFromAmount(pwallet->GetBalance())));
     }
 #endif
     obj.push_back(Pair("blocks", (int)chainActive.Height()));
@@ -208,11 +249,11 @@ Value getinfo(const Array& params, bool fHelp)
     obj.push_back(Pair("moneysupply",ValueFromAmount(chainActive.Tip()->nMoneySupply)));
 
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
-        obj.push_back(Pair("keypoololdest", pwalletMain->GetOldestKeyPoolTime()));
-        obj.push_back(Pair("keypoolsize", (int)pwalletMain->GetKeyPoolSize()));
+    if (pwallet) {
+        obj.push_back(Pair("keypoololdest", pwallet->GetOldestKeyPoolTime()));
+        obj.push_back(Pair("keypoolsize", (int)pwallet->GetKeyPoolSize()));
     }
-    if (pwalletMain && pwalletMain->IsCrypted())
+    if (pwallet && pwallet->IsCrypted())
         obj.push_back(Pair("unlocked_until", nWalletUnlockTime));
 #endif
     obj.push_back(Pair("relayfee", ValueFromAmount( FeeAndPriorityCalculator::instance().getFeeRateQuote().GetFeePerK())));
@@ -252,6 +293,11 @@ Value mnsync(const Array& params, bool fHelp)
             "  \"countMasternodeWinner\": n,    (numeric) Number of MN winner messages (local)\n"
             "  \"countBudgetItemProp\": n,      (numeric) Number of MN budget messages (local)\n"
             "  \"countBudgetItemFin\": n,       (numeric) Number of MN budget finalization messages (local)\n"
+            "  \"seenMasternodeList\": n,       (numeric) Number of distinct MN list entries seen while syncing\n"
+            "  \"seenMasternodeWinner\": n,     (numeric) Number of distinct MN winner votes seen while syncing\n"
+            "  \"largestMasternodeList\": n,    (numeric) Most MN list messages a single peer reported sending\n"
+            "  \"largestMasternodeWinner\": n,  (numeric) Most MN winner messages a single peer reported sending\n"
+            "  \"assetSyncStarted\": xxxx,      (numeric) Timestamp of when the current sync phase started\n"
             "  \"RequestedMasternodeAssets\": n, (numeric) Status code of last sync phase\n"
             "  \"RequestedMasternodeAttempt\": n, (numeric) Status code of last sync attempt\n"
             "}\n"
@@ -274,6 +320,11 @@ Value mnsync(const Array& params, bool fHelp)
         obj.push_back(Pair("sumMasternodeWinner", masternodeSynchronization.sumMasternodeWinner));
         obj.push_back(Pair("countMasternodeList", masternodeSynchronization.countMasternodeList));
         obj.push_back(Pair("countMasternodeWinner", masternodeSynchronization.countMasternodeWinner));
+        obj.push_back(Pair("seenMasternodeList", (uint64_t)masternodeSynchronization.mapSeenSyncMNB.size()));
+        obj.push_back(Pair("seenMasternodeWinner", (uint64_t)masternodeSynchronization.mapSeenSyncMNW.size()));
+        obj.push_back(Pair("largestMasternodeList", masternodeSynchronization.largestMasternodeList));
+        obj.push_back(Pair("largestMasternodeWinner", masternodeSynchronization.largestMasternodeWinner));
+        obj.push_back(Pair("assetSyncStarted", masternodeSynchronization.nAssetSyncStarted));
         obj.push_back(Pair("RequestedMasternodeAssets", masternodeSynchronization.RequestedMasternodeAssets));
         obj.push_back(Pair("RequestedMasternodeAttempt", masternodeSynchronization.RequestedMasternodeAttempt));
 
@@ -304,7 +355,7 @@ public:
         CPubKey vchPubKey;
         obj.push_back(Pair("isscript", false));
         if (mine == ISMINE_SPENDABLE) {
-            pwalletMain->GetPubKey(keyID, vchPubKey);
+            GetWalletForRPC()->GetPubKey(keyID, vchPubKey);
             obj.push_back(Pair("pubkey", HexStr(vchPubKey)));
             obj.push_back(Pair("iscompressed", vchPubKey.IsCompressed()));
         }
@@ -317,7 +368,7 @@ public:
         obj.push_back(Pair("isscript", true));
         if (mine != ISMINE_NO) {
             CScript subscript;
-            pwalletMain->GetCScript(scriptID, subscript);
+            GetWalletForRPC()->GetCScript(scriptID, subscript);
             std::vector<CTxDestination> addresses;
             txnouttype whichType;
             int nRequired;
@@ -415,20 +466,21 @@ Value validateaddress(const Array& params, bool fHelp)
         ret.push_back(Pair("scriptPubKey", HexStr(scriptPubKey.begin(), scriptPubKey.end())));
 
 #ifdef ENABLE_WALLET
-        isminetype mine = pwalletMain ? pwalletMain->IsMine(scriptPubKey) : ISMINE_NO;
+        CWallet* const pwallet = GetWalletForRPC();
+        isminetype mine = pwallet ? pwallet->IsMine(scriptPubKey) : ISMINE_NO;
         ret.push_back(Pair("ismine", (mine & ISMINE_SPENDABLE) ? true : false));
         if (mine != ISMINE_NO) {
             ret.push_back(Pair("iswatchonly", (mine & ISMINE_WATCH_ONLY) ? true : false));
             Object detail = boost::apply_visitor(DescribeAddressVisitor(mine), dest);
             ret.insert(ret.end(), detail.begin(), detail.end());
         }
-        if (pwalletMain && pwalletMain->mapAddressBook.count(dest))
-            ret.push_back(Pair("account", pwalletMain->mapAddressBook[dest].name));
+        if (pwallet && pwallet->mapAddressBook.count(dest))
+            ret.push_back(Pair("account", pwallet->mapAddressBook[dest].name));
 
 
         CKeyID keyID;
-        if (pwalletMain) {
-            const auto& meta = pwalletMain->mapKeyMetadata;
+        if (pwallet) {
+            const auto& meta = pwallet->mapKeyMetadata;
             auto it = address.GetKeyID(keyID) ? meta.find(keyID) : meta.end();
             if (it == meta.end()) {
                 it = meta.find(CKeyID(CScriptID(scriptPubKey)));
@@ -438,8 +490,8 @@ Value validateaddress(const Array& params, bool fHelp)
             }
 
             CHDChain hdChainCurrent;
-            if (!keyID.IsNull() && pwalletMain->mapHdPubKeys.count(keyID) && pwalletMain->GetHDChain(hdChainCurrent)) {
-                ret.push_back(Pair("hdkeypath", pwalletMain->mapHdPubKeys[keyID].GetKeyPath()));
+            if (!keyID.IsNull() && pwallet->mapHdPubKeys.count(keyID) && pwallet->GetHDChain(hdChainCurrent)) {
+                ret.push_back(Pair("hdkeypath", pwallet->mapHdPubKeys[keyID].GetKeyPath()));
                 ret.push_back(Pair("hdchainid", hdChainCurrent.GetID().GetHex()));
             }
         }
@@ -473,13 +525,14 @@ CScript _createmultisig_redeemScript(const Array& params)
 #ifdef ENABLE_WALLET
         // Case 1: IZZY address and we have full public key:
         CBitcoinAddress address(ks);
-        if (pwalletMain && address.IsValid()) {
+        CWallet* const pwallet = GetWalletForRPC();
+        if (pwallet && address.IsValid()) {
             CKeyID keyID;
             if (!address.GetKeyID(keyID))
                 throw runtime_error(
                     strprintf("%s does not refer to a key", ks));
             CPubKey vchPubKey;
-            if (!pwalletMain->GetPubKey(keyID, vchPubKey))
+            if (!pwallet->GetPubKey(keyID, vchPubKey))
                 throw runtime_error(
                     strprintf("no full public key for address %s", ks));
             if (!vchPubKey.IsFullyValid())
@@ -608,6 +661,215 @@ Value setmocktime(const Array& params, bool fHelp)
     return Value::null;
 }
 
+namespace
+{
+uint64_t LogCategoriesFromJSON(const Value& value)
+{
+    uint64_t categories = LOG_NONE;
+    for (const Value& name : value.get_array()) {
+        LogCategory category;
+        if (!GetLogCategory(name.get_str(), category))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "unknown logging category " + name.get_str());
+        categories |= category;
+    }
+    return categories;
+}
+}
+
+Value logging(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "logging ( [\"include_category\",...] [\"exclude_category\",...] )\n"
+            "\nGets and sets which debug categories are logged, as -debug does at startup.\n"
+            "With no arguments the current state of each category is returned.\n"
+            "\nArguments:\n"
+            "1. \"include\"  (array of strings, optional) Categories to start logging, \"all\" for every one\n"
+            "2. \"exclude\"  (array of strings, optional) Categories to stop logging, applied after the included ones\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"category\": true|false,  (boolean) Whether the category is logged\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("logging", "\"[\\\"net\\\"]\" \"[\\\"mnpayments\\\"]\"") + HelpExampleRpc("logging", "[\"all\"], [\"masternode\"]"));
+
+    if (params.size() > 0)
+        EnableLogCategory((LogCategory)LogCategoriesFromJSON(params[0]));
+    if (params.size() > 1)
+        DisableLogCategory((LogCategory)LogCategoriesFromJSON(params[1]));
+
+    Object result;
+    for (const std::pair<std::string, bool>& category : ListLogCategories())
+        result.push_back(Pair(category.first, category.second));
+    return result;
+}
+
+namespace
+{
+Array HistogramToJSON(const std::vector<uint64_t>& histogram)
+{
+    Array buckets;
+    for (uint64_t count : histogram)
+        buckets.push_back(count);
+    return buckets;
+}
+}
+
+Value getlockstats(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getlockstats ( reset )\n"
+            "\nReturns how long the sampled lock acquisitions of each LOCK site waited for and held their lock,\n"
+            "the sites that waited longest first. Sampling is set with -lockprofilesampling.\n"
+            "\nArguments:\n"
+            "1. reset        (boolean, optional, default=false) Start over once the statistics are returned\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"sampling\": n,              (numeric) One in how many acquisitions is timed, 0 when profiling is off\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"lock\": \"name\",         (string) The lock as written at the site\n"
+            "      \"site\": \"file:line\",    (string) Where it is taken\n"
+            "      \"samples\": n,           (numeric) Acquisitions timed\n"
+            "      \"contended\": n,         (numeric) Of those, how many found the lock taken\n"
+            "      \"wait_total_us\": n,     (numeric) Microseconds spent waiting for the lock\n"
+            "      \"wait_max_us\": n,       (numeric) Longest wait\n"
+            "      \"hold_total_us\": n,     (numeric) Microseconds the lock was held\n"
+            "      \"hold_max_us\": n,       (numeric) Longest hold\n"
+            "      \"wait_histogram\": [n,...], (array) Waits by bucket, bucket i counting waits from 2^(i-1) up to 2^i microseconds\n"
+            "      \"hold_histogram\": [n,...]  (array) Holds by the same buckets\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getlockstats", "") + HelpExampleCli("getlockstats", "true") + HelpExampleRpc("getlockstats", ""));
+
+    const bool fReset = params.size() > 0 && params[0].get_bool();
+    const std::vector<LockSiteStats> stats = LockProfiler::GetStats();
+    if (fReset)
+        LockProfiler::Reset();
+
+    Array sites;
+    for (const LockSiteStats& site : stats) {
+        Object obj;
+        obj.push_back(Pair("lock", site.lockName));
+        obj.push_back(Pair("site", strprintf("%s:%d", site.file, site.line)));
+        obj.push_back(Pair("samples", site.nSamples));
+        obj.push_back(Pair("contended", site.nContended));
+        obj.push_back(Pair("wait_total_us", site.nTotalWaitMicros));
+        obj.push_back(Pair("wait_max_us", site.nMaxWaitMicros));
+        obj.push_back(Pair("hold_total_us", site.nTotalHoldMicros));
+        obj.push_back(Pair("hold_max_us", site.nMaxHoldMicros));
+        obj.push_back(Pair("wait_histogram", HistogramToJSON(site.waitHistogram)));
+        obj.push_back(Pair("hold_histogram", HistogramToJSON(site.holdHistogram)));
+        sites.push_back(obj);
+    }
+    Object result;
+    result.push_back(Pair("sampling", (uint64_t)LockProfiler::GetSamplingInterval()));
+    result.push_back(Pair("sites", sites));
+    return result;
+}
+
+Object PerformanceStatisticsToJSON(const std::vector<PerformanceTimerStats>& stats)
+{
+    Object result;
+    for (const PerformanceTimerStats& timer : stats) {
+        Object obj;
+        obj.push_back(Pair("count", timer.count));
+        obj.push_back(Pair("total_us", timer.totalMicros));
+        obj.push_back(Pair("mean_us", timer.count > 0 ? (double)timer.totalMicros / timer.count : 0.0));
+        obj.push_back(Pair("p50_us", timer.Percentile(0.5)));
+        obj.push_back(Pair("p90_us", timer.Percentile(0.9)));
+        obj.push_back(Pair("p99_us", timer.Percentile(0.99)));
+        obj.push_back(Pair("max_us", timer.maximumMicros));
+        obj.push_back(Pair("histogram", HistogramToJSON(timer.buckets)));
+        result.push_back(Pair(timer.name, obj));
+    }
+    return result;
+}
+
+Value getperfstats(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getperfstats ( reset )\n"
+            "\nReturns how long the hot paths of the node took since startup or the last reset: block checks and\n"
+            "connection, mempool acceptance, block template creation, masternode messages and wallet sync.\n"
+            "Percentiles are the upper bounds of the histogram buckets they fall in.\n"
+            "The same figures are served in the Prometheus text format at /rest/perfstats.txt.\n"
+            "\nArguments:\n"
+            "1. reset        (boolean, optional, default=false) Start over once the statistics are returned\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {               (object) One of checkblock, connectblock, connecttip, mempool_accept,\n"
+            "                            block_template, masternode_message or wallet_sync\n"
+            "    \"count\": n,             (numeric) Calls timed\n"
+            "    \"total_us\": n,          (numeric) Microseconds spent in them\n"
+            "    \"mean_us\": x.x,         (numeric) Average microseconds per call\n"
+            "    \"p50_us\": n,            (numeric) Median microseconds per call\n"
+            "    \"p90_us\": n,            (numeric) 90th percentile\n"
+            "    \"p99_us\": n,            (numeric) 99th percentile\n"
+            "    \"max_us\": n,            (numeric) Longest call\n"
+            "    \"histogram\": [n,...]    (array) Calls by bucket, bucket i counting calls from 2^(i-1) up to 2^i microseconds\n"
+            "  }\n"
+            "  ,...\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getperfstats", "") + HelpExampleCli("getperfstats", "true") + HelpExampleRpc("getperfstats", ""));
+
+    const bool fReset = params.size() > 0 && params[0].get_bool();
+    const std::vector<PerformanceTimerStats> stats = PerformanceStatistics::GetStats();
+    if (fReset)
+        PerformanceStatistics::Reset();
+    return PerformanceStatisticsToJSON(stats);
+}
+
+Object SubsystemMemoryUsageToJSON(const std::vector<SubsystemMemoryUsage>& usage)
+{
+    Object subsystems;
+    uint64_t nTotal = 0;
+    for (const SubsystemMemoryUsage& subsystem : usage) {
+        Object obj;
+        obj.push_back(Pair("bytes", (uint64_t)subsystem.bytes));
+        obj.push_back(Pair("entries", (uint64_t)subsystem.entries));
+        subsystems.push_back(Pair(subsystem.name, obj));
+        nTotal += subsystem.bytes;
+    }
+    Object result;
+    result.push_back(Pair("total", nTotal));
+    result.push_back(Pair("subsystems", subsystems));
+    return result;
+}
+
+Value getmemoryinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getmemoryinfo\n"
+            "\nReturns how much memory the node's main structures take up, as each accounts for it.\n"
+            "The same figures are served at /rest/perfstats/memory.json, and in the Prometheus text format at /rest/perfstats/memory.txt.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"total\": n,                (numeric) Bytes taken up by all of them\n"
+            "  \"subsystems\": {\n"
+            "    \"name\": {               (object) One of coins_cache, block_index, orphan_transactions, mempool, signature_cache,\n"
+            "                              script_execution_cache, masternodes, addrman, network_buffers, transaction_cache,\n"
+            "                              rpc_reply_cache or wallets\n"
+            "      \"bytes\": n,            (numeric) Bytes taken up\n"
+            "      \"entries\": n           (numeric) Coins, block indexes, transactions, masternodes, addresses, peers or replies held\n"
+            "    }\n"
+            "    ,...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getmemoryinfo", "") + HelpExampleRpc("getmemoryinfo", ""));
+
+    return SubsystemMemoryUsageToJSON(GetSubsystemMemoryUsage());
+}
+
 bool getAddressesFromParams(const Array& params, std::vector<std::pair<uint160, int> > &addresses)
 {
     if (params[0].type() == str_type) {
@@ -655,6 +917,81 @@ bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &addr
     return true;
 }
 
+/** Optional paging of a single address' index entries, see getaddresstxids */
+struct AddressIndexPaging
+{
+    bool fPaged;
+    unsigned int nLimit;
+    bool fNewestFirst;
+    bool fContinue;
+    CAddressIndexKey keyAfter;
+
+    AddressIndexPaging() : fPaged(false), nLimit(0), fNewestFirst(false), fContinue(false), keyAfter() {}
+
+    bool IsRequested() const { return fPaged || fNewestFirst; }
+};
+
+AddressIndexPaging getAddressIndexPagingFromParams(const Array& params, const std::vector<std::pair<uint160, int> > &addresses)
+{
+    AddressIndexPaging paging;
+    if (params[0].type() != obj_type)
+        return paging;
+
+    Value limitValue = find_value(params[0].get_obj(), "limit");
+    Value reverseValue = find_value(params[0].get_obj(), "reverse");
+    Value continuationValue = find_value(params[0].get_obj(), "continuation");
+
+    if (limitValue.type() != null_type) {
+        if (limitValue.type() != int_type || limitValue.get_int() <= 0 || (unsigned int)limitValue.get_int() > MAX_ADDRESS_INDEX_PAGE_TRANSACTIONS)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Limit is expected to be between 1 and %u", MAX_ADDRESS_INDEX_PAGE_TRANSACTIONS));
+        paging.fPaged = true;
+        paging.nLimit = limitValue.get_int();
+    }
+    if (reverseValue.type() != null_type) {
+        if (reverseValue.type() != bool_type)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Reverse is expected to be a boolean");
+        paging.fNewestFirst = reverseValue.get_bool();
+    }
+    if (paging.IsRequested() && addresses.size() != 1)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit and reverse take a single address");
+
+    if (continuationValue.type() != null_type) {
+        if (!paging.fPaged)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Continuation requires a limit");
+        if (continuationValue.type() != str_type || !IsHex(continuationValue.get_str()))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Continuation is expected to be a hex string");
+        std::vector<unsigned char> continuation = ParseHex(continuationValue.get_str());
+        CDataStream ssKey(continuation, SER_DISK, CLIENT_VERSION);
+        try {
+            ssKey >> paging.keyAfter;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid continuation");
+        }
+        if (!ssKey.empty() || paging.keyAfter.hashBytes != addresses[0].first || paging.keyAfter.type != (unsigned int)addresses[0].second)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid continuation");
+        paging.fContinue = true;
+    }
+    return paging;
+}
+
+void getAddressIndexPage(const AddressIndexPaging& paging, const std::pair<uint160, int>& address, int start, int end,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, Value& continuation)
+{
+    bool fMore = false;
+    const unsigned int nMaxTransactions = paging.fPaged ? paging.nLimit : std::numeric_limits<unsigned int>::max();
+    if (!GetAddressIndexPage(fAddressIndex, pblocktree, address.first, address.second, start, end, paging.fNewestFirst,
+                             nMaxTransactions, paging.fContinue ? &paging.keyAfter : NULL, addressIndex, fMore)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    continuation = Value::null;
+    if (fMore && !addressIndex.empty()) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << addressIndex.back().first;
+        continuation = HexStr(ssKey.begin(), ssKey.end());
+    }
+}
+
 Value getaddresstxids(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -670,14 +1007,23 @@ Value getaddresstxids(const Array& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many transactions and a continuation (single address only)\n"
+            "  \"reverse\" (boolean, optional, default=false) Newest transactions first (single address only)\n"
+            "  \"continuation\" (string, optional) Continue after the page that returned this continuation\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (when limit is given):\n"
+            "{\n"
+            "  \"txids\": [...]  (array) The transaction ids as above\n"
+            "  \"continuation\"  (string) Pass on to get the next page, null once there are no more transactions\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"], \"limit\": 100, \"reverse\": true}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
         );
 
@@ -699,16 +1045,22 @@ Value getaddresstxids(const Array& params, bool fHelp)
         }
     }
 
+    const AddressIndexPaging paging = getAddressIndexPagingFromParams(params, addresses);
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    Value continuation;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    if (paging.IsRequested()) {
+        getAddressIndexPage(paging, addresses[0], start, end, addressIndex, continuation);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -735,6 +1087,12 @@ Value getaddresstxids(const Array& params, bool fHelp)
         }
     }
 
+    if (paging.fPaged) {
+        Object page;
+        page.push_back(Pair("txids", result));
+        page.push_back(Pair("continuation", continuation));
+        return page;
+    }
     return result;
 
 }
@@ -755,6 +1113,9 @@ Value getaddressdeltas(const Array& params, bool fHelp)
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
+            "  \"limit\" (number, optional) Return the changes of at most this many transactions and a continuation (single address only)\n"
+            "  \"reverse\" (boolean, optional, default=false) Newest changes first (single address only)\n"
+            "  \"continuation\" (string, optional) Continue after the page that returned this continuation\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -766,6 +1127,8 @@ Value getaddressdeltas(const Array& params, bool fHelp)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nWith chainInfo or a limit the changes come as \"deltas\" in an object, along with \"start\" and \"end\"\n"
+            "or a \"continuation\" (null once there are no more changes) respectively.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -800,16 +1163,22 @@ Value getaddressdeltas(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    const AddressIndexPaging paging = getAddressIndexPagingFromParams(params, addresses);
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    Value continuation;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    if (paging.IsRequested()) {
+        getAddressIndexPage(paging, addresses[0], start, end, addressIndex, continuation);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -856,7 +1225,13 @@ Value getaddressdeltas(const Array& params, bool fHelp)
         result.push_back(Pair("deltas", deltas));
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
+        if (paging.fPaged)
+            result.push_back(Pair("continuation", continuation));
 
+        return result;
+    } else if (paging.fPaged) {
+        result.push_back(Pair("deltas", deltas));
+        result.push_back(Pair("continuation", continuation));
         return result;
     } else {
         return deltas;
@@ -881,6 +1256,7 @@ Value getaddressbalance(const Array& params, bool fHelp)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions paying to or spending from the address(es), counted per address\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
@@ -893,32 +1269,87 @@ Value getaddressbalance(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    CAddressBalance total;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex(fAddressIndex,pblocktree,(*it).first, (*it).second, addressIndex)) {
+        CAddressBalance balance;
+        if (!GetAddressBalance(fAddressIndex,pblocktree,(*it).first, (*it).second, balance)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
-
-    CAmount balance = 0;
-    CAmount received = 0;
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
-        }
-        balance += it->second;
+        total.Add(balance);
     }
 
     Object result;
-    result.push_back(Pair("balance", balance));
-    result.push_back(Pair("received", received));
+    result.push_back(Pair("balance", total.balance));
+    result.push_back(Pair("received", total.received));
+    result.push_back(Pair("txcount", total.txCount));
 
     return result;
 
 }
 
+/** Optional filtering and paging of addresses' unspent outputs, see getaddressutxos */
+struct AddressUnspentPaging
+{
+    bool fPaged;
+    unsigned int nLimit;
+    int nMinHeight;
+    CAmount nMinAmount;
+    bool fContinue;
+    CAddressUnspentKey keyAfter;
+
+    AddressUnspentPaging() : fPaged(false), nLimit(0), nMinHeight(0), nMinAmount(0), fContinue(false), keyAfter() {}
+};
+
+AddressUnspentPaging getAddressUnspentPagingFromParams(const Array& params, const std::vector<std::pair<uint160, int> > &addresses)
+{
+    AddressUnspentPaging paging;
+    if (params[0].type() != obj_type)
+        return paging;
+
+    Value minHeightValue = find_value(params[0].get_obj(), "minHeight");
+    Value minAmountValue = find_value(params[0].get_obj(), "minAmount");
+    Value limitValue = find_value(params[0].get_obj(), "limit");
+    Value continuationValue = find_value(params[0].get_obj(), "continuation");
+
+    if (minHeightValue.type() != null_type) {
+        if (minHeightValue.type() != int_type || minHeightValue.get_int() < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "MinHeight is expected to be a height");
+        paging.nMinHeight = minHeightValue.get_int();
+    }
+    if (minAmountValue.type() != null_type) {
+        if (minAmountValue.type() != int_type || minAmountValue.get_int64() < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "MinAmount is expected to be an amount of satoshis");
+        paging.nMinAmount = minAmountValue.get_int64();
+    }
+    if (limitValue.type() != null_type) {
+        if (limitValue.type() != int_type || limitValue.get_int() <= 0 || (unsigned int)limitValue.get_int() > MAX_ADDRESS_UNSPENT_PAGE_OUTPUTS)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Limit is expected to be between 1 and %u", MAX_ADDRESS_UNSPENT_PAGE_OUTPUTS));
+        if (addresses.size() != 1)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit takes a single address");
+        paging.fPaged = true;
+        paging.nLimit = limitValue.get_int();
+    }
+
+    if (continuationValue.type() != null_type) {
+        if (!paging.fPaged)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Continuation requires a limit");
+        if (continuationValue.type() != str_type || !IsHex(continuationValue.get_str()))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Continuation is expected to be a hex string");
+        std::vector<unsigned char> continuation = ParseHex(continuationValue.get_str());
+        CDataStream ssKey(continuation, SER_DISK, CLIENT_VERSION);
+        try {
+            ssKey >> paging.keyAfter;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid continuation");
+        }
+        if (!ssKey.empty() || paging.keyAfter.hashBytes != addresses[0].first || paging.keyAfter.type != (unsigned int)addresses[0].second)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid continuation");
+        paging.fContinue = true;
+    }
+    return paging;
+}
+
 bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
                 std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
     return a.second.blockHeight < b.second.blockHeight;
@@ -1062,6 +1493,10 @@ Value getaddressutxos(const Array& params, bool fHelp)
             "      ,...\n"
             "    ],\n"
             "  \"chainInfo\"  (boolean) Include chain info with results\n"
+            "  \"minHeight\" (number, optional) Skip outputs of blocks below this height\n"
+            "  \"minAmount\" (number, optional) Skip outputs of fewer satoshis\n"
+            "  \"limit\" (number, optional) Return at most this many outputs, by txid and output index, and a continuation (single address only)\n"
+            "  \"continuation\" (string, optional) Continue after the page that returned this continuation\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -1074,8 +1509,11 @@ Value getaddressutxos(const Array& params, bool fHelp)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nWith chainInfo or a limit the outputs come as \"utxos\" in an object, along with \"hash\" and \"height\"\n"
+            "or a \"continuation\" (null once there are no more outputs) respectively.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"], \"minAmount\": 100000000, \"limit\": 1000}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             );
 
@@ -1093,16 +1531,33 @@ Value getaddressutxos(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    const AddressUnspentPaging paging = getAddressUnspentPagingFromParams(params, addresses);
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+    Value continuation;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent(fAddressIndex,pblocktree,(*it).first, (*it).second, unspentOutputs)) {
+    if (paging.fPaged) {
+        // A page is read in index order, which the continuation points into
+        bool fMore = false;
+        if (!GetAddressUnspentPage(fAddressIndex, pblocktree, addresses[0].first, addresses[0].second, paging.nMinHeight, paging.nMinAmount,
+                                   paging.nLimit, paging.fContinue ? &paging.keyAfter : NULL, unspentOutputs, fMore)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
+        if (fMore && !unspentOutputs.empty()) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            ssKey << unspentOutputs.back().first;
+            continuation = HexStr(ssKey.begin(), ssKey.end());
+        }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            bool fMore = false;
+            if (!GetAddressUnspentPage(fAddressIndex, pblocktree, (*it).first, (*it).second, paging.nMinHeight, paging.nMinAmount,
+                                       std::numeric_limits<unsigned int>::max(), NULL, unspentOutputs, fMore)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
-
     Array utxos;
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
@@ -1121,19 +1576,94 @@ Value getaddressutxos(const Array& params, bool fHelp)
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || paging.fPaged) {
         Object result;
         result.push_back(Pair("utxos", utxos));
+        if (paging.fPaged)
+            result.push_back(Pair("continuation", continuation));
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        if (includeChainInfo) {
+            LOCK(cs_main);
+            result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
+            result.push_back(Pair("height", (int)chainActive.Height()));
+        }
         return result;
     } else {
         return utxos;
     }
 }
 
+Value getaddressvaults(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressvaults {addresses:...}\n"
+            "\nReturns the unspent staking vaults that an address owns or manages (requires vaultindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address of the owner or manager key\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult\n"
+            "[\n"
+            "  {\n"
+            "    \"address\"  (string) The address base58check encoded\n"
+            "    \"role\"  (string) Whether the address is the \"owner\" or the \"manager\" of the vault\n"
+            "    \"txid\"  (string) The output txid\n"
+            "    \"outputIndex\"  (number) The output index\n"
+            "    \"owner\"  (string) The owner address of the vault\n"
+            "    \"manager\"  (string) The manager address of the vault\n"
+            "    \"script\"  (string) The script hex encoded\n"
+            "    \"satoshis\"  (number) The number of satoshis of the output\n"
+            "  }\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressvaults", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
+            + HelpExampleRpc("getaddressvaults", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
+            );
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    // Vault scripts only hold key hashes, so script addresses have no vaults
+    std::vector<std::pair<VaultIndexKey, VaultIndexValue> > vaults;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if ((*it).second != 1)
+            continue;
+        if (!GetVaultIndex(VaultIndexRole::OWNER, (*it).first, vaults) || !GetVaultIndex(VaultIndexRole::MANAGER, (*it).first, vaults)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    Array result;
+
+    for (std::vector<std::pair<VaultIndexKey, VaultIndexValue> >::const_iterator it = vaults.begin(); it != vaults.end(); it++) {
+        std::pair<valtype, valtype> keyHashes;
+        if (!GetStakingVaultPubkeyHashes(it->second.script, keyHashes)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Vault index entry without a vault script");
+        }
+
+        Object vault;
+        vault.push_back(Pair("address", CBitcoinAddress(CKeyID(it->first.keyHash)).ToString()));
+        vault.push_back(Pair("role", it->first.role == VaultIndexRole::OWNER ? "owner" : "manager"));
+        vault.push_back(Pair("txid", it->first.txhash.GetHex()));
+        vault.push_back(Pair("outputIndex", (int)it->first.index));
+        vault.push_back(Pair("owner", CBitcoinAddress(CKeyID(uint160(keyHashes.first))).ToString()));
+        vault.push_back(Pair("manager", CBitcoinAddress(CKeyID(uint160(keyHashes.second))).ToString()));
+        vault.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
+        vault.push_back(Pair("satoshis", it->second.satoshis));
+        result.push_back(vault);
+    }
+
+    return result;
+}
+
 Value clearbanned(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -118,8 +118,8 @@ Value getpeerinfo(const Array& params, bool fHelp)
 
     BOOST_FOREACH (const CNodeStats& stats, vstats) {
         Object obj;
-        CNodeStateStats statestats;
-        bool fStateStats = GetNodeStateStats(stats.nodeid, statestats);
+        const CNodeStateStats& statestats = stats.stateStats;
+        const bool fStateStats = stats.fStateStats;
         obj.push_back(Pair("id", stats.nodeid));
         obj.push_back(Pair("addr", stats.addrName));
         if (!(stats.addrLocal.empty()))
@@ -316,7 +316,14 @@ Value getnettotals(const Array& params, bool fHelp)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"uploadlimits\": {\n"
+            "    \"maxuploadrate\": n,        (numeric) Bytes per second all uploads are held to before historical blocks wait, 0 if unlimited\n"
+            "    \"maxpeeruploadrate\": n,    (numeric) Bytes per second of historical blocks each peer is sent, 0 if unlimited\n"
+            "    \"availablebytes\": n,       (numeric) Bytes left of the total upload budget, negative while in debt\n"
+            "    \"historicalbytessent\": n,  (numeric) Bytes of blocks older than a day sent to peers\n"
+            "    \"historicaldeferrals\": n   (numeric) Times serving historical blocks waited for the upload limits\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getnettotals", "") + HelpExampleRpc("getnettotals", ""));
@@ -325,6 +332,15 @@ Value getnettotals(const Array& params, bool fHelp)
     obj.push_back(Pair("totalbytesrecv", CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent", CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis", GetTimeMillis()));
+
+    const CUploadLimitStats uploadStats = CNode::GetUploadLimitStats();
+    Object uploadLimits;
+    uploadLimits.push_back(Pair("maxuploadrate", uploadStats.nMaxUploadRate));
+    uploadLimits.push_back(Pair("maxpeeruploadrate", uploadStats.nMaxPeerUploadRate));
+    uploadLimits.push_back(Pair("availablebytes", uploadStats.nAvailableBytes));
+    uploadLimits.push_back(Pair("historicalbytessent", uploadStats.nHistoricalBytesSent));
+    uploadLimits.push_back(Pair("historicaldeferrals", uploadStats.nDeferredHistoricalRequests));
+    obj.push_back(Pair("uploadlimits", uploadLimits));
     return obj;
 }
 
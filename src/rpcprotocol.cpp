@@ -13,6 +13,7 @@
 #include "utilstrencodings.h"
 #include "utiltime.h"
 #include "version.h"
+#include <HTTPChunkedStreamBuf.h>
 
 #include <stdint.h>
 
@@ -41,15 +42,15 @@ const size_t POST_READ_SIZE = 256 * 1024;
  * and to be compatible with other JSON-RPC implementations.
  */
 
-string HTTPPost(const string& strMsg, const map<string, string>& mapRequestHeaders)
+string HTTPPost(const string& strMsg, const map<string, string>& mapRequestHeaders, bool fKeepAlive, const string& strPath)
 {
     ostringstream s;
-    s << "POST / HTTP/1.1\r\n"
+    s << "POST " << strPath << " HTTP/1.1\r\n"
       << "User-Agent: izzy-json-rpc/" << FormatFullVersion() << "\r\n"
       << "Host: 127.0.0.1\r\n"
       << "Content-Type: application/json\r\n"
       << "Content-Length: " << strMsg.size() << "\r\n"
-      << "Connection: close\r\n"
+      << "Connection: " << (fKeepAlive ? "keep-alive" : "close") << "\r\n"
       << "Accept: application/json\r\n";
     BOOST_FOREACH (const PAIRTYPE(string, string) & item, mapRequestHeaders)
         s << item.first << ": " << item.second << "\r\n";
@@ -126,6 +127,41 @@ string HTTPReplyHeader(int nStatus, bool keepalive, size_t contentLength, const
         FormatFullVersion());
 }
 
+string HTTPChunkedReplyHeader(int nStatus, bool keepalive, const char* contentType)
+{
+    return strprintf(
+        "HTTP/1.1 %d %s\r\n"
+        "Date: %s\r\n"
+        "Connection: %s\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Content-Type: %s\r\n"
+        "Server: izzy-json-rpc/%s\r\n"
+        "\r\n",
+        nStatus,
+        httpStatusDescription(nStatus),
+        rfc1123Time(),
+        keepalive ? "keep-alive" : "close",
+        contentType,
+        FormatFullVersion());
+}
+
+bool WriteHTTPJSONReply(std::ostream& stream, int nStatus, const Value& value, bool keepalive, int nProto)
+{
+    // HTTP/1.0 clients do not know chunks, and are sent the reply all at once
+    if (nProto < 1) {
+        const string strJSON = write_string(value, false) + "\n";
+        stream << HTTPReply(nStatus, strJSON, keepalive) << std::flush;
+        return stream.good();
+    }
+
+    stream << HTTPChunkedReplyHeader(nStatus, keepalive, "application/json");
+    HTTPChunkedStreamBuf chunkedBuffer(stream);
+    std::ostream chunkedStream(&chunkedBuffer);
+    write_stream(value, chunkedStream, false);
+    chunkedStream << "\n";
+    return chunkedBuffer.Finish() && chunkedStream.good();
+}
+
 string HTTPReply(int nStatus, const string& strMsg, bool keepalive, bool headersOnly, const char* contentType)
 {
     if (headersOnly) {
@@ -209,6 +245,32 @@ int ReadHTTPHeaders(std::basic_istream<char>& stream, map<string, string>& mapHe
 }
 
 
+bool ReadHTTPChunkedBody(std::basic_istream<char>& stream, string& strMessageRet, size_t max_size)
+{
+    while (true) {
+        string str;
+        std::getline(stream, str);
+        if (!stream)
+            return false;
+        // Chunk extensions after the size are ignored
+        const size_t nSize = strtoul(str.c_str(), NULL, 16);
+        if (nSize == 0)
+            break;
+        if (nSize > max_size - strMessageRet.size())
+            return false;
+        const size_t ptr = strMessageRet.size();
+        strMessageRet.resize(ptr + nSize);
+        stream.read(&strMessageRet[ptr], nSize);
+        std::getline(stream, str);
+        if (!stream) // Connection lost while reading
+            return false;
+    }
+    // Skip the trailer, up to the empty line that ends the message
+    map<string, string> mapTrailers;
+    ReadHTTPHeaders(stream, mapTrailers);
+    return true;
+}
+
 int ReadHTTPMessage(std::basic_istream<char>& stream, map<string, string>& mapHeadersRet, string& strMessageRet, int nProto, size_t max_size)
 {
     mapHeadersRet.clear();
@@ -220,7 +282,10 @@ int ReadHTTPMessage(std::basic_istream<char>& stream, map<string, string>& mapHe
         return HTTP_INTERNAL_SERVER_ERROR;
 
     // Read message
-    if (nLen > 0) {
+    if (boost::algorithm::icontains(mapHeadersRet["transfer-encoding"], "chunked")) {
+        if (!ReadHTTPChunkedBody(stream, strMessageRet, max_size))
+            return HTTP_INTERNAL_SERVER_ERROR;
+    } else if (nLen > 0) {
         std::vector<char> vch;
         size_t ptr = 0;
         while (ptr < (size_t)nLen) {
@@ -256,13 +321,18 @@ int ReadHTTPMessage(std::basic_istream<char>& stream, map<string, string>& mapHe
  * http://www.codeproject.com/KB/recipes/JSON_Spirit.aspx
  */
 
-string JSONRPCRequest(const string& strMethod, const Array& params, const Value& id)
+Object JSONRPCRequestObj(const string& strMethod, const Array& params, const Value& id)
 {
     Object request;
     request.push_back(Pair("method", strMethod));
     request.push_back(Pair("params", params));
     request.push_back(Pair("id", id));
-    return write_string(Value(request), false) + "\n";
+    return request;
+}
+
+string JSONRPCRequest(const string& strMethod, const Array& params, const Value& id)
+{
+    return write_string(Value(JSONRPCRequestObj(strMethod, params, id)), false) + "\n";
 }
 
 Object JSONRPCReplyObj(const Value& result, const Value& error, const Value& id)
@@ -74,16 +74,22 @@ enum RPCErrorCode {
     RPC_WALLET_ENCRYPTION_FAILED = -16,    //! Failed to encrypt the wallet
     RPC_WALLET_ALREADY_UNLOCKED = -17,     //! Wallet is already unlocked
     RPC_WALLET_NEEDS_RELOCK = -18,         //! Wallet needs to be re-locked
+    RPC_WALLET_NOT_FOUND = -19,            //! No wallet of the requested file is loaded
 };
 
-std::string HTTPPost(const std::string& strMsg, const std::map<std::string, std::string>& mapRequestHeaders);
+std::string HTTPPost(const std::string& strMsg, const std::map<std::string, std::string>& mapRequestHeaders, bool fKeepAlive = false, const std::string& strPath = "/");
 std::string HTTPError(int nStatus, bool keepalive, bool headerOnly = false);
 std::string HTTPReplyHeader(int nStatus, bool keepalive, size_t contentLength, const char* contentType = "application/json");
 std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive, bool headerOnly = false, const char* contentType = "application/json");
+std::string HTTPChunkedReplyHeader(int nStatus, bool keepalive, const char* contentType = "application/json");
+/** Writes the reply as it is serialized, in chunks, to clients speaking HTTP/1.1 */
+bool WriteHTTPJSONReply(std::ostream& stream, int nStatus, const json_spirit::Value& value, bool keepalive, int nProto);
 bool ReadHTTPRequestLine(std::basic_istream<char>& stream, int& proto, std::string& http_method, std::string& http_uri);
 int ReadHTTPStatus(std::basic_istream<char>& stream, int& proto);
 int ReadHTTPHeaders(std::basic_istream<char>& stream, std::map<std::string, std::string>& mapHeadersRet);
+bool ReadHTTPChunkedBody(std::basic_istream<char>& stream, std::string& strMessageRet, size_t max_size);
 int ReadHTTPMessage(std::basic_istream<char>& stream, std::map<std::string, std::string>& mapHeadersRet, std::string& strMessageRet, int nProto, size_t max_size);
+json_spirit::Object JSONRPCRequestObj(const std::string& strMethod, const json_spirit::Array& params, const json_spirit::Value& id);
 std::string JSONRPCRequest(const std::string& strMethod, const json_spirit::Array& params, const json_spirit::Value& id);
 json_spirit::Object JSONRPCReplyObj(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
 std::string JSONRPCReply(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
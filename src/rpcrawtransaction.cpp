@@ -18,6 +18,7 @@
 #include "script/sign.h"
 #include "script/standard.h"
 #include <TransactionDiskAccessor.h>
+#include <RPCResponseCache.h>
 #include "uint256.h"
 #include "utilmoneystr.h"
 #include "wallet.h"
@@ -32,6 +33,7 @@
 #include <boost/assign/list_of.hpp>
 #include <ValidationState.h>
 #include <script/SignatureCheckers.h>
+#include <script/ParallelInputSigner.h>
 
 using namespace boost;
 using namespace boost::assign;
@@ -40,10 +42,10 @@ using namespace std;
 
 extern CAmount maxTxFee;
 extern CCoinsViewCache* pcoinsTip;
-extern CWallet* pwalletMain;
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
 extern BlockMap mapBlockIndex;
+extern bool fSpentIndex;
 
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, Object& out, bool fIncludeHex)
 {
@@ -272,6 +274,11 @@ Value getrawtransaction(const Array& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = (params[1].get_int() != 0);
 
+    // With the spent index the outputs tell where they were spent, which changes as they are
+    const bool fCacheable = fVerbose && !fSpentIndex;
+    const RPCResponseCacheKey cacheKey("getrawtransaction", hash, 1);
+    Value result;
+
     CTransaction tx;
     uint256 hashBlock = 0;
     int nHeight = 0;
@@ -280,6 +287,8 @@ Value getrawtransaction(const Array& params, bool fHelp)
 
     {
         LOCK(cs_main);
+        if (fCacheable && GetRPCResponseCache().Find(cacheKey, chainActive.Height(), result))
+            return result;
         if (!GetTransaction(hash, tx, hashBlock, true))
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
 
@@ -303,9 +312,17 @@ Value getrawtransaction(const Array& params, bool fHelp)
     if (!fVerbose)
         return strHex;
 
-    Object result;
-    result.push_back(Pair("hex", strHex));
-    TxToJSONExpanded(tx, hashBlock, result, nHeight, nConfirmations, nBlockTime);
+    Object txObject;
+    txObject.push_back(Pair("hex", strHex));
+    TxToJSONExpanded(tx, hashBlock, txObject, nHeight, nConfirmations, nBlockTime);
+    result = txObject;
+
+    if (fCacheable && nConfirmations > 0) {
+        LOCK(cs_main);
+        CBlockIndex* pindex = chainActive[nHeight];
+        if (pindex && pindex->GetBlockHash() == hashBlock)
+            GetRPCResponseCache().Insert(cacheKey, result, nHeight, chainActive.Height());
+    }
     return result;
 }
 
@@ -370,8 +387,9 @@ Value listunspent(const Array& params, bool fHelp)
 
     Array results;
     std::vector<COutput> vecOutputs;
-    assert(pwalletMain != NULL);
-    pwalletMain->AvailableCoins(vecOutputs, false);
+    CWallet* const pwallet = GetWalletForRPC();
+    assert(pwallet != NULL);
+    pwallet->AvailableCoins(vecOutputs, false);
     BOOST_FOREACH (const COutput& out, vecOutputs) {
         if (out.nDepth < nMinDepth || out.nDepth > nMaxDepth)
             continue;
@@ -393,8 +411,8 @@ Value listunspent(const Array& params, bool fHelp)
         CTxDestination address;
         if (ExtractDestination(out.tx->vout[out.i].scriptPubKey, address)) {
             entry.push_back(Pair("address", CBitcoinAddress(address).ToString()));
-            if (pwalletMain->mapAddressBook.count(address))
-                entry.push_back(Pair("account", pwalletMain->mapAddressBook[address].name));
+            if (pwallet->mapAddressBook.count(address))
+                entry.push_back(Pair("account", pwallet->mapAddressBook[address].name));
         }
         entry.push_back(Pair("scriptPubKey", HexStr(pk.begin(), pk.end())));
         if (pk.IsPayToScriptHash()) {
@@ -402,7 +420,7 @@ Value listunspent(const Array& params, bool fHelp)
             if (ExtractDestination(pk, address)) {
                 const CScriptID& hash = boost::get<CScriptID>(address);
                 CScript redeemScript;
-                if (pwalletMain->GetCScript(hash, redeemScript))
+                if (pwallet->GetCScript(hash, redeemScript))
                     entry.push_back(Pair("redeemScript", HexStr(redeemScript.begin(), redeemScript.end())));
             }
         }
@@ -781,7 +799,8 @@ Value signrawtransaction(const Array& params, bool fHelp)
     }
 
 #ifdef ENABLE_WALLET
-    const CKeyStore& keystore = ((fGivenKeys || !pwalletMain) ? tempKeystore : *pwalletMain);
+    CWallet* const pwallet = GetWalletForRPC();
+    const CKeyStore& keystore = ((fGivenKeys || !pwallet) ? tempKeystore : *pwallet);
 #else
     const CKeyStore& keystore = tempKeystore;
 #endif
@@ -799,7 +818,33 @@ Value signrawtransaction(const Array& params, bool fHelp)
 
     bool fHashSingle = ((nHashType & ~SIGHASH_ANYONECANPAY) == SIGHASH_SINGLE);
 
-    // Sign what we can:
+    // Sign what we can, with the inputs spread over several threads:
+    std::vector<CScript> scriptPubKeysToSign(mergedTx.vin.size());
+    for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
+        CTxIn& txin = mergedTx.vin[i];
+        const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+        if (coins == NULL || !coins->IsAvailable(txin.prevout.n))
+            continue;
+        txin.scriptSig.clear();
+        // Only sign SIGHASH_SINGLE if there's a corresponding output:
+        if (!fHashSingle || (i < mergedTx.vout.size()))
+            scriptPubKeysToSign[i] = coins->vout[txin.prevout.n].scriptPubKey;
+    }
+#ifdef ENABLE_WALLET
+    // The wallet looks each key up under its lock, so the keys are copied out of it first
+    const bool fSignWithWallet = (&keystore == pwallet);
+    CBasicKeyStore walletSigningKeystore;
+    if (fSignWithWallet) {
+        LOCK(pwallet->cs_wallet);
+        BOOST_FOREACH (const CScript& scriptPubKey, scriptPubKeysToSign)
+            ParallelInputSigner::CopySigningKeys(keystore, scriptPubKey, walletSigningKeystore);
+    }
+    const CKeyStore& signingKeystore = fSignWithWallet ? walletSigningKeystore : keystore;
+#else
+    const CKeyStore& signingKeystore = keystore;
+#endif
+    ParallelInputSigner(signingKeystore, nHashType).SignInputs(mergedTx, scriptPubKeysToSign);
+
     for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
         CTxIn& txin = mergedTx.vin[i];
         const CCoins* coins = view.AccessCoins(txin.prevout.hash);
@@ -809,11 +854,6 @@ Value signrawtransaction(const Array& params, bool fHelp)
         }
         const CScript& prevPubKey = coins->vout[txin.prevout.n].scriptPubKey;
 
-        txin.scriptSig.clear();
-        // Only sign SIGHASH_SINGLE if there's a corresponding output:
-        if (!fHashSingle || (i < mergedTx.vout.size()))
-            SignSignature(keystore, prevPubKey, mergedTx, i, nHashType);
-
         // ... and merge in other signatures:
         BOOST_FOREACH (const CMutableTransaction& txv, txVariants) {
             txin.scriptSig = CombineSignatures(prevPubKey, mergedTx, i, txin.scriptSig, txv.vin[i].scriptSig);
@@ -18,6 +18,11 @@
 #include "Settings.h"
 #include <utilmoneystr.h>
 #include <random.h>
+#include <RPCResponseCache.h>
+#include <RPCWorkQueue.h>
+#include <UniValueReader.h>
+#include <set>
+#include <defaultValues.h>
 
 #include "json/json_spirit_writer_template.h"
 #include <boost/algorithm/string.hpp>
@@ -44,6 +49,7 @@ extern json_spirit::Value getnettotals(const json_spirit::Array& params, bool fH
 extern json_spirit::Value dumpprivkey(const json_spirit::Array& params, bool fHelp); // in rpcdump.cpp
 extern json_spirit::Value importprivkey(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value importaddress(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value importmulti(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value dumphdinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value dumpwallet(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value importwallet(const json_spirit::Array& params, bool fHelp);
@@ -51,8 +57,11 @@ extern json_spirit::Value bip38encrypt(const json_spirit::Array& params, bool fH
 extern json_spirit::Value bip38decrypt(const json_spirit::Array& params, bool fHelp);
 
 extern json_spirit::Value setgenerate(const json_spirit::Array& params, bool fHelp); // in rpcmining.cpp
+extern json_spirit::Value generate(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value generateblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getmininginfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getstakingstats(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value simulatestaking(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value prioritisetransaction(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblocktemplate(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value submitblock(const json_spirit::Array& params, bool fHelp);
@@ -79,6 +88,7 @@ extern json_spirit::Value getunconfirmedbalance(const json_spirit::Array& params
 extern json_spirit::Value movecmd(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value sendfrom(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value sendmany(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value sendpayouts(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value addmultisigaddress(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value listreceivedbyaddress(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value listreceivedbyaccount(const json_spirit::Array& params, bool fHelp);
@@ -95,6 +105,8 @@ extern json_spirit::Value walletlock(const json_spirit::Array& params, bool fHel
 extern json_spirit::Value walletverify(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value encryptwallet(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getwalletinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value listwallets(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getrescanprogress(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblockchaininfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getnetworkinfo(const json_spirit::Array& params, bool fHelp);
 
@@ -110,20 +122,32 @@ extern json_spirit::Value sendrawtransaction(const json_spirit::Array& params, b
 
 extern json_spirit::Value getblockcount(const json_spirit::Array& params, bool fHelp); // in rpcblockchain.cpp
 extern json_spirit::Value getlotteryblockwinners(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getlotterystandings(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getbestblockhash(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value waitfornewblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getdifficulty(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getmempoolinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getorphaninfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getrawmempool(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblockhash(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblockheader(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getblockstats(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getcoinsupply(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value gettxoutsetinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value dumptxoutset(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value loadtxoutset(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getdbinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value gettxout(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value verifychain(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getchaintips(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value invalidateblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value reconsiderblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getinvalid(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getlockstats(const json_spirit::Array& params, bool fHelp); // in rpcmisc.cpp
+extern json_spirit::Value getperfstats(const json_spirit::Array& params, bool fHelp); // in rpcmisc.cpp
+extern json_spirit::Value getmemoryinfo(const json_spirit::Array& params, bool fHelp); // in rpcmisc.cpp
+extern json_spirit::Value logging(const json_spirit::Array& params, bool fHelp);
 
 extern json_spirit::Value debug(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value allocatefunds(const json_spirit::Array& params, bool fHelp);
@@ -160,6 +184,7 @@ extern json_spirit::Value getaddresstxids(const json_spirit::Array& params, bool
 extern json_spirit::Value getaddressdeltas(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getaddressbalance(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getaddressutxos(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getaddressvaults(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getaddressmempool(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getspentinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value ban(const json_spirit::Array& params, bool fHelp);
@@ -185,6 +210,12 @@ static asio::io_service* rpc_io_service = NULL;
 static map<string, boost::shared_ptr<deadline_timer> > deadlineTimers;
 static boost::thread_group* rpc_worker_group = NULL;
 static boost::asio::io_service::work* rpc_dummy_work = NULL;
+static RPCWorkQueue* rpc_work_queue = NULL;
+//! Runs slices of batched requests alongside the thread serving the batch
+static RPCWorkQueue* rpc_batch_queue = NULL;
+static boost::thread_group* rpc_batch_group = NULL;
+//! Commands limited by -rpcmethodlimit to a number of calls running at once
+static map<string, boost::shared_ptr<CSemaphore> > rpc_method_limits;
 static std::vector<CSubNet> rpc_allow_subnets; //!< List of subnets to allow RPC connections from
 static std::vector<boost::shared_ptr<ip::tcp::acceptor> > rpc_acceptors;
 
@@ -391,172 +422,192 @@ Value stop(const Array& params, bool fHelp)
  */
 static const CRPCCommand vRPCCommands[] =
     {
-        //  category              name                      actor (function)         okSafeMode threadSafe reqWallet
+        //  category              name                      actor (function)         okSafeMode locks      reqWallet
         //  --------------------- ------------------------  -----------------------  ---------- ---------- ---------
         /* Overall control/query calls */
-        {"control", "getinfo", &getinfo, true, false, false}, /* uses wallet if enabled */
-        {"control", "help", &help, true, true, false},
-        {"control", "stop", &stop, true, true, false},
+        {"control", "getinfo", &getinfo, true, RPC_LOCKS_CHAIN_AND_WALLET, false}, /* uses wallet if enabled */
+        {"control", "help", &help, true, RPC_LOCKS_NONE, false},
+        {"control", "stop", &stop, true, RPC_LOCKS_NONE, false},
+        {"control", "getlockstats", &getlockstats, true, RPC_LOCKS_NONE, false},
+        {"control", "getperfstats", &getperfstats, true, RPC_LOCKS_NONE, false},
+        {"control", "getmemoryinfo", &getmemoryinfo, true, RPC_LOCKS_NONE, false},
+        {"control", "logging", &logging, true, RPC_LOCKS_NONE, false},
 
         /* P2P networking */
-        {"network", "getnetworkinfo", &getnetworkinfo, true, false, false},
-        {"network", "addnode", &addnode, true, true, false},
-        {"network", "getaddednodeinfo", &getaddednodeinfo, true, true, false},
-        {"network", "getconnectioncount", &getconnectioncount, true, false, false},
-        {"network", "getnettotals", &getnettotals, true, true, false},
-        {"network", "getpeerinfo", &getpeerinfo, true, false, false},
-        {"network", "ping", &ping, true, false, false},
+        {"network", "getnetworkinfo", &getnetworkinfo, true, RPC_LOCKS_CHAIN, false},
+        {"network", "addnode", &addnode, true, RPC_LOCKS_NONE, false},
+        {"network", "getaddednodeinfo", &getaddednodeinfo, true, RPC_LOCKS_NONE, false},
+        {"network", "getconnectioncount", &getconnectioncount, true, RPC_LOCKS_CHAIN, false},
+        {"network", "getnettotals", &getnettotals, true, RPC_LOCKS_NONE, false},
+        {"network", "getpeerinfo", &getpeerinfo, true, RPC_LOCKS_CHAIN, false},
+        {"network", "ping", &ping, true, RPC_LOCKS_CHAIN, false},
 
         /* Block chain and UTXO */
-        {"blockchain", "getblockchaininfo", &getblockchaininfo, true, false, false},
-        {"blockchain", "getbestblockhash", &getbestblockhash, true, false, false},
-        {"blockchain", "getblockcount", &getblockcount, true, false, false},
-        {"blockchain", "getlotteryblockwinners", &getlotteryblockwinners, true, false, false},
-        {"blockchain", "getblock", &getblock, true, false, false},
-        {"blockchain", "getblockhash", &getblockhash, true, false, false},
-        {"blockchain", "getblockheader", &getblockheader, false, false, false},
-        {"blockchain", "getchaintips", &getchaintips, true, false, false},
-        {"blockchain", "getdifficulty", &getdifficulty, true, false, false},
-        {"blockchain", "getmempoolinfo", &getmempoolinfo, true, true, false},
-        {"blockchain", "getrawmempool", &getrawmempool, true, false, false},
-        {"blockchain", "gettxout", &gettxout, true, false, false},
-        {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true, false, false},
-        {"blockchain", "verifychain", &verifychain, true, false, false},
-        {"blockchain", "invalidateblock", &invalidateblock, true, true, false},
-        {"blockchain", "reconsiderblock", &reconsiderblock, true, true, false},
-        {"getinvalid", "getinvalid", &getinvalid, true, true, false},
+        {"blockchain", "getblockchaininfo", &getblockchaininfo, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "getbestblockhash", &getbestblockhash, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "waitfornewblock", &waitfornewblock, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "getblockcount", &getblockcount, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "getlotteryblockwinners", &getlotteryblockwinners, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "getlotterystandings", &getlotterystandings, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"blockchain", "getblock", &getblock, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "getblockhash", &getblockhash, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "getblockheader", &getblockheader, false, RPC_LOCKS_NONE, false},
+        {"blockchain", "getblockstats", &getblockstats, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "getchaintips", &getchaintips, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "getcoinsupply", &getcoinsupply, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "getdifficulty", &getdifficulty, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "getmempoolinfo", &getmempoolinfo, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "getorphaninfo", &getorphaninfo, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "getrawmempool", &getrawmempool, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "gettxout", &gettxout, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "dumptxoutset", &dumptxoutset, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "loadtxoutset", &loadtxoutset, false, RPC_LOCKS_NONE, false},
+        {"blockchain", "getdbinfo", &getdbinfo, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "verifychain", &verifychain, true, RPC_LOCKS_CHAIN, false},
+        {"blockchain", "invalidateblock", &invalidateblock, true, RPC_LOCKS_NONE, false},
+        {"blockchain", "reconsiderblock", &reconsiderblock, true, RPC_LOCKS_NONE, false},
+        {"getinvalid", "getinvalid", &getinvalid, true, RPC_LOCKS_NONE, false},
 
         /* Mining */
-        {"mining", "getblocktemplate", &getblocktemplate, true, false, false},
-        {"mining", "getmininginfo", &getmininginfo, true, false, false},
-        {"mining", "prioritisetransaction", &prioritisetransaction, true, false, false},
-        {"mining", "submitblock", &submitblock, true, true, false},
+        {"mining", "getblocktemplate", &getblocktemplate, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"mining", "getmininginfo", &getmininginfo, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"mining", "getstakingstats", &getstakingstats, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"mining", "prioritisetransaction", &prioritisetransaction, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"mining", "submitblock", &submitblock, true, RPC_LOCKS_NONE, false},
 
 #ifdef ENABLE_WALLET
         /* Coin generation */
-        {"generating", "setgenerate", &setgenerate, true, true, false},
-        {"generating", "generateblock", &generateblock, true, true, false},
+        {"generating", "setgenerate", &setgenerate, true, RPC_LOCKS_NONE, false},
+        {"generating", "generate", &generate, true, RPC_LOCKS_NONE, false},
+        {"generating", "generateblock", &generateblock, true, RPC_LOCKS_NONE, false},
+        {"generating", "simulatestaking", &simulatestaking, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
 #endif
 
         /* Raw transactions */
-        {"rawtransactions", "createrawtransaction", &createrawtransaction, true, false, false},
-        {"rawtransactions", "decoderawtransaction", &decoderawtransaction, true, false, false},
-        {"rawtransactions", "decodescript", &decodescript, true, false, false},
-        {"rawtransactions", "getrawtransaction", &getrawtransaction, true, false, false},
-        {"rawtransactions", "sendrawtransaction", &sendrawtransaction, false, false, false},
-        {"rawtransactions", "signrawtransaction", &signrawtransaction, false, false, false}, /* uses wallet if enabled */
+        {"rawtransactions", "createrawtransaction", &createrawtransaction, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"rawtransactions", "decoderawtransaction", &decoderawtransaction, true, RPC_LOCKS_CHAIN, false},
+        {"rawtransactions", "decodescript", &decodescript, true, RPC_LOCKS_CHAIN, false},
+        {"rawtransactions", "getrawtransaction", &getrawtransaction, true, RPC_LOCKS_CHAIN, false},
+        {"rawtransactions", "sendrawtransaction", &sendrawtransaction, false, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"rawtransactions", "signrawtransaction", &signrawtransaction, false, RPC_LOCKS_CHAIN_AND_WALLET, false}, /* uses wallet if enabled */
 
         /* Utility functions */
-        {"util", "createmultisig", &createmultisig, true, true, false},
-        {"util", "validateaddress", &validateaddress, true, false, false}, /* uses wallet if enabled */
-        {"util", "verifymessage", &verifymessage, true, false, false},
-        {"util", "estimatefee", &estimatefee, true, true, false},
-        {"util", "estimatepriority", &estimatepriority, true, true, false},
+        {"util", "createmultisig", &createmultisig, true, RPC_LOCKS_NONE, false},
+        {"util", "validateaddress", &validateaddress, true, RPC_LOCKS_CHAIN_AND_WALLET, false}, /* uses wallet if enabled */
+        {"util", "verifymessage", &verifymessage, true, RPC_LOCKS_CHAIN_AND_WALLET, false},
+        {"util", "estimatefee", &estimatefee, true, RPC_LOCKS_NONE, false},
+        {"util", "estimatepriority", &estimatepriority, true, RPC_LOCKS_NONE, false},
 
         /* Not shown in help */
-        {"hidden", "invalidateblock", &invalidateblock, true, true, false},
-        {"hidden", "reconsiderblock", &reconsiderblock, true, true, false},
-        {"hidden", "setmocktime", &setmocktime, true, false, false},
+        {"hidden", "invalidateblock", &invalidateblock, true, RPC_LOCKS_NONE, false},
+        {"hidden", "reconsiderblock", &reconsiderblock, true, RPC_LOCKS_NONE, false},
+        {"hidden", "setmocktime", &setmocktime, true, RPC_LOCKS_CHAIN, false},
 
         /* Izzy features */
-		{ "izzy", "debug", &debug, true, true, false },
-		{ "izzy", "masternode", &masternode, true, true, false },
-		{ "izzy", "allocatefunds", &allocatefunds, true, true, false },
-		{ "izzy", "fundmasternode", &fundmasternode, true, true, false },
-		{"izzy", "listmasternodes", &listmasternodes, true, true, false},
-        {"izzy", "getmasternodecount", &getmasternodecount, true, true, false},
-        {"izzy", "masternodeconnect", &masternodeconnect, true, true, false},
-        {"izzy", "masternodecurrent", &masternodecurrent, true, true, false},
-        // {"izzy", "masternodedebug", &masternodedebug, true, true, false},
-        {"izzy","setupmasternode",&setupmasternode,true,false,true},
-        {"izzy","verifymasternodesetup",&verifymasternodesetup,true,true,true},
-        {"izzy", "broadcaststartmasternode", &broadcaststartmasternode, true, true, false},
-        {"izzy", "startmasternode", &startmasternode, true, true, false},
-        {"izzy", "createmasternodekey", &createmasternodekey, true, true, false},
-        {"izzy", "getmasternodeoutputs", &getmasternodeoutputs, true, true, false},
-        {"izzy", "listmasternodeconf", &listmasternodeconf, true, true, false},
-        {"izzy", "getmasternodestatus", &getmasternodestatus, true, true, false},
-        {"izzy", "getmasternodewinners", &getmasternodewinners, true, true, false},
-        {"izzy", "getmasternodescores", &getmasternodescores, true, true, false},
-        //{"izzy", "mnbudget", &mnbudget, true, true, false},
-        //{"izzy", "preparebudget", &preparebudget, true, true, false},
-        //{"izzy", "submitbudget", &submitbudget, true, true, false},
-        //{"izzy", "mnbudgetvote", &mnbudgetvote, true, true, false},
-        //{"izzy", "getbudgetvotes", &getbudgetvotes, true, true, false},
-        //{"izzy", "getnextsuperblock", &getnextsuperblock, true, true, false},
-        //{"izzy", "getbudgetprojection", &getbudgetprojection, true, true, false},
-        //{"izzy", "getbudgetinfo", &getbudgetinfo, true, true, false},
-        //{"izzy", "mnbudgetrawvote", &mnbudgetrawvote, true, true, false},
-        //{"izzy", "mnfinalbudget", &mnfinalbudget, true, true, false},
-        //{"izzy", "checkbudgets", &checkbudgets, true, true, false},
-        {"izzy", "mnsync", &mnsync, true, true, false},
-        {"izzy", "spork", &spork, true, true, false},
-        {"izzy", "getpoolinfo", &getpoolinfo, true, true, false},
-        {"izzy","ban",&ban,false,false,false},
-        {"izzy","clearbanned",&clearbanned,false,false,false},
-        {"izzy","listbanned",&listbanned,false,false,false},
+		{ "izzy", "debug", &debug, true, RPC_LOCKS_NONE, false },
+		{ "izzy", "masternode", &masternode, true, RPC_LOCKS_NONE, false },
+		{ "izzy", "allocatefunds", &allocatefunds, true, RPC_LOCKS_NONE, false },
+		{ "izzy", "fundmasternode", &fundmasternode, true, RPC_LOCKS_NONE, false },
+		{"izzy", "listmasternodes", &listmasternodes, true, RPC_LOCKS_NONE, false},
+        {"izzy", "getmasternodecount", &getmasternodecount, true, RPC_LOCKS_NONE, false},
+        {"izzy", "masternodeconnect", &masternodeconnect, true, RPC_LOCKS_NONE, false},
+        {"izzy", "masternodecurrent", &masternodecurrent, true, RPC_LOCKS_NONE, false},
+        // {"izzy", "masternodedebug", &masternodedebug, true, RPC_LOCKS_NONE, false},
+        {"izzy","setupmasternode",&setupmasternode,true,RPC_LOCKS_CHAIN_AND_WALLET,true},
+        {"izzy","verifymasternodesetup",&verifymasternodesetup,true,RPC_LOCKS_NONE,true},
+        {"izzy", "broadcaststartmasternode", &broadcaststartmasternode, true, RPC_LOCKS_NONE, false},
+        {"izzy", "startmasternode", &startmasternode, true, RPC_LOCKS_NONE, false},
+        {"izzy", "createmasternodekey", &createmasternodekey, true, RPC_LOCKS_NONE, false},
+        {"izzy", "getmasternodeoutputs", &getmasternodeoutputs, true, RPC_LOCKS_NONE, false},
+        {"izzy", "listmasternodeconf", &listmasternodeconf, true, RPC_LOCKS_NONE, false},
+        {"izzy", "getmasternodestatus", &getmasternodestatus, true, RPC_LOCKS_NONE, false},
+        {"izzy", "getmasternodewinners", &getmasternodewinners, true, RPC_LOCKS_NONE, false},
+        {"izzy", "getmasternodescores", &getmasternodescores, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "mnbudget", &mnbudget, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "preparebudget", &preparebudget, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "submitbudget", &submitbudget, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "mnbudgetvote", &mnbudgetvote, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "getbudgetvotes", &getbudgetvotes, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "getnextsuperblock", &getnextsuperblock, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "getbudgetprojection", &getbudgetprojection, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "getbudgetinfo", &getbudgetinfo, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "mnbudgetrawvote", &mnbudgetrawvote, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "mnfinalbudget", &mnfinalbudget, true, RPC_LOCKS_NONE, false},
+        //{"izzy", "checkbudgets", &checkbudgets, true, RPC_LOCKS_NONE, false},
+        {"izzy", "mnsync", &mnsync, true, RPC_LOCKS_NONE, false},
+        {"izzy", "spork", &spork, true, RPC_LOCKS_NONE, false},
+        {"izzy", "getpoolinfo", &getpoolinfo, true, RPC_LOCKS_NONE, false},
+        {"izzy","ban",&ban,false,RPC_LOCKS_CHAIN,false},
+        {"izzy","clearbanned",&clearbanned,false,RPC_LOCKS_CHAIN,false},
+        {"izzy","listbanned",&listbanned,false,RPC_LOCKS_CHAIN,false},
 
         /* address index */
-        { "addressindex", "getaddresstxids", &getaddresstxids, false, false, false },
-        { "addressindex", "getaddressdeltas", &getaddressdeltas, false, false, false },
-        { "addressindex", "getaddressbalance", &getaddressbalance, false, false, false },
-        { "addressindex", "getaddressutxos", &getaddressutxos, false, false, false },
-        { "addressindex", "getaddressmempool", &getaddressmempool, true, false, false },
+        { "addressindex", "getaddresstxids", &getaddresstxids, false, RPC_LOCKS_CHAIN, false },
+        { "addressindex", "getaddressdeltas", &getaddressdeltas, false, RPC_LOCKS_CHAIN, false },
+        { "addressindex", "getaddressbalance", &getaddressbalance, false, RPC_LOCKS_CHAIN, false },
+        { "addressindex", "getaddressutxos", &getaddressutxos, false, RPC_LOCKS_CHAIN, false },
+        { "addressindex", "getaddressmempool", &getaddressmempool, true, RPC_LOCKS_CHAIN, false },
 
-        { "blockchain", "getspentinfo", &getspentinfo, false, false, false },
+        { "blockchain", "getspentinfo", &getspentinfo, false, RPC_LOCKS_CHAIN, false },
+        { "blockchain", "getaddressvaults", &getaddressvaults, false, RPC_LOCKS_CHAIN, false },
 
 #ifdef ENABLE_WALLET
-        // {"izzy", "obfuscation", &obfuscation, false, false, true}, /* not threadSafe because of SendMoney */
+        // {"izzy", "obfuscation", &obfuscation, false, RPC_LOCKS_CHAIN_AND_WALLET, true}, /* needs the wallet lock because of SendMoney */
 
         /* Wallet */
-        {"wallet", "addmultisigaddress", &addmultisigaddress, true, false, true},
-        {"wallet", "backupwallet", &backupwallet, true, false, true},
-        {"wallet", "dumpprivkey", &dumpprivkey, true, false, true},
-        {"wallet", "dumphdinfo", &dumphdinfo, true, false, true},
-        {"wallet", "dumpwallet", &dumpwallet, true, false, true},
-        {"wallet", "bip38encrypt", &bip38encrypt, true, false, true},
-        {"wallet", "bip38decrypt", &bip38decrypt, true, false, true},
-        {"wallet", "encryptwallet", &encryptwallet, true, false, true},
-        {"wallet", "getaccountaddress", &getaccountaddress, true, false, true},
-        {"wallet", "getaccount", &getaccount, true, false, true},
-        {"wallet", "getaddressesbyaccount", &getaddressesbyaccount, true, false, true},
-        {"wallet", "getbalance", &getbalance, false, false, true},
-        {"wallet", "getnewaddress", &getnewaddress, true, false, true},
-        {"wallet", "getrawchangeaddress", &getrawchangeaddress, true, false, true},
-        {"wallet", "getreceivedbyaccount", &getreceivedbyaccount, false, false, true},
-        {"wallet", "getreceivedbyaddress", &getreceivedbyaddress, false, false, true},
-        {"wallet", "getstakingstatus", &getstakingstatus, false, false, true},
-        {"wallet", "gettransaction", &gettransaction, false, false, true},
-        {"wallet", "getunconfirmedbalance", &getunconfirmedbalance, false, false, true},
-        {"wallet", "getwalletinfo", &getwalletinfo, false, false, true},
-        {"wallet", "importprivkey", &importprivkey, true, false, true},
-        {"wallet", "importwallet", &importwallet, true, false, true},
-        {"wallet", "importaddress", &importaddress, true, false, true},
-        {"wallet", "keypoolrefill", &keypoolrefill, true, false, true},
-        {"wallet", "listaccounts", &listaccounts, false, false, true},
-        {"wallet", "listaddressgroupings", &listaddressgroupings, false, false, true},
-        {"wallet", "listlockunspent", &listlockunspent, false, false, true},
-        {"wallet", "listreceivedbyaccount", &listreceivedbyaccount, false, false, true},
-        {"wallet", "listreceivedbyaddress", &listreceivedbyaddress, false, false, true},
-        {"wallet", "listsinceblock", &listsinceblock, false, false, true},
-        {"wallet", "listtransactions", &listtransactions, false, false, true},
-        {"wallet", "listunspent", &listunspent, false, false, true},
-        {"wallet", "lockunspent", &lockunspent, true, false, true},
-        {"wallet", "move", &movecmd, false, false, true},
-        {"wallet", "sendfrom", &sendfrom, false, false, true},
-        {"wallet", "sendmany", &sendmany, false, false, true},
-        {"wallet", "sendtoaddress", &sendtoaddress, false, false, true},
-        {"wallet", "fundvault", &fundvault, false, false, true},
-        {"wallet", "reclaimvaultfunds", &reclaimvaultfunds, false, false, true},
-        {"wallet", "removevault", &removevault, false, false, true},
-        {"wallet", "addvault", &addvault, false, false, true},
-        {"wallet", "getcoinavailability", &getcoinavailability, false, false, true},
-        {"wallet", "setaccount", &setaccount, true, false, true},
-        {"wallet", "signmessage", &signmessage, true, false, true},
-        {"wallet", "walletlock", &walletlock, true, false, true},
-        {"wallet", "walletpassphrasechange", &walletpassphrasechange, true, false, true},
-        {"wallet", "walletpassphrase", &walletpassphrase, true, false, true},
-        {"wallet", "walletverify", &walletverify, true, false, true}
+        {"wallet", "addmultisigaddress", &addmultisigaddress, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "backupwallet", &backupwallet, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "dumpprivkey", &dumpprivkey, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "dumphdinfo", &dumphdinfo, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "dumpwallet", &dumpwallet, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "bip38encrypt", &bip38encrypt, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "bip38decrypt", &bip38decrypt, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "encryptwallet", &encryptwallet, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getaccountaddress", &getaccountaddress, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getaccount", &getaccount, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getaddressesbyaccount", &getaddressesbyaccount, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getbalance", &getbalance, false, RPC_LOCKS_NONE, true},
+        {"wallet", "getnewaddress", &getnewaddress, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getrawchangeaddress", &getrawchangeaddress, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getrescanprogress", &getrescanprogress, true, RPC_LOCKS_NONE, true},
+        {"wallet", "getreceivedbyaccount", &getreceivedbyaccount, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getreceivedbyaddress", &getreceivedbyaddress, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getstakingstatus", &getstakingstatus, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "gettransaction", &gettransaction, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getunconfirmedbalance", &getunconfirmedbalance, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getwalletinfo", &getwalletinfo, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "importprivkey", &importprivkey, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "importwallet", &importwallet, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "importaddress", &importaddress, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "importmulti", &importmulti, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "keypoolrefill", &keypoolrefill, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listaccounts", &listaccounts, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listaddressgroupings", &listaddressgroupings, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listlockunspent", &listlockunspent, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listreceivedbyaccount", &listreceivedbyaccount, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listreceivedbyaddress", &listreceivedbyaddress, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listsinceblock", &listsinceblock, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listtransactions", &listtransactions, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listunspent", &listunspent, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "listwallets", &listwallets, true, RPC_LOCKS_NONE, true},
+        {"wallet", "lockunspent", &lockunspent, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "move", &movecmd, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "sendfrom", &sendfrom, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "sendmany", &sendmany, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "sendpayouts", &sendpayouts, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "sendtoaddress", &sendtoaddress, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "fundvault", &fundvault, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "reclaimvaultfunds", &reclaimvaultfunds, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "removevault", &removevault, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "addvault", &addvault, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "getcoinavailability", &getcoinavailability, false, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "setaccount", &setaccount, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "signmessage", &signmessage, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "walletlock", &walletlock, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "walletpassphrasechange", &walletpassphrasechange, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "walletpassphrase", &walletpassphrase, true, RPC_LOCKS_CHAIN_AND_WALLET, true},
+        {"wallet", "walletverify", &walletverify, true, RPC_LOCKS_CHAIN_AND_WALLET, true}
 
 #endif // ENABLE_WALLET
 };
@@ -654,12 +705,34 @@ public:
         socketStream.close();
     }
 
+    virtual void set_timeout(int64_t nSeconds) override
+    {
+#if BOOST_VERSION >= 106600
+        if (nSeconds > 0)
+            socketStream.expires_after(std::chrono::seconds(nSeconds));
+        else
+            socketStream.expires_at(std::chrono::steady_clock::time_point::max());
+#else
+        if (nSeconds > 0)
+            socketStream.expires_from_now(boost::posix_time::seconds(nSeconds));
+        else
+            socketStream.expires_at(boost::posix_time::pos_infin);
+#endif
+    }
+
     typename Protocol::endpoint peer;
     typename Protocol::iostream socketStream;
 };
 
 void ServiceConnection(AcceptedConnection* conn);
 
+/** Serves a connection on a worker thread until either side ends it */
+static void ServiceAcceptedConnection(boost::shared_ptr<AcceptedConnection> conn)
+{
+    ServiceConnection(conn.get());
+    conn->close();
+}
+
 //! Forward declaration required for RPCListen
 template <typename Protocol>
 static void RPCAcceptHandler(boost::shared_ptr<basic_socket_acceptor<Protocol> > acceptor,
@@ -709,8 +782,10 @@ static void RPCAcceptHandler(boost::shared_ptr<basic_socket_acceptor<Protocol> >
     else if (tcp_conn && !ClientAllowed(tcp_conn->peer.address())) {
         conn->stream() << HTTPError(HTTP_FORBIDDEN, false) << std::flush;
         conn->close();
-    } else {
-        ServiceConnection(conn.get());
+    } else if (!rpc_work_queue->Enqueue(boost::bind(&ServiceAcceptedConnection, conn))) {
+        // Answer right away instead of letting the connection wait behind a full queue
+        LogPrint(LOG_RPC, "%s: Work queue depth exceeded, refusing connection from %s\n", __func__, conn->peer_address_to_string());
+        conn->stream() << HTTPError(HTTP_SERVICE_UNAVAILABLE, false) << std::flush;
         conn->close();
     }
 }
@@ -723,6 +798,12 @@ static ip::tcp::endpoint ParseEndpoint(const std::string& strEndpoint, int defau
     return ip::tcp::endpoint(asio::ip::address::from_string(addr), port);
 }
 
+static void ThreadRPCServer(asio::io_service* io_service)
+{
+    RenameThread("izzy-rpc");
+    io_service->run();
+}
+
 void StartRPCThreads()
 {
     rpc_allow_subnets.clear();
@@ -745,7 +826,7 @@ void StartRPCThreads()
     std::string strAllowed;
     BOOST_FOREACH (const CSubNet& subnet, rpc_allow_subnets)
         strAllowed += subnet.ToString() + " ";
-    LogPrint("rpc", "Allowing RPC connections from: %s\n", strAllowed);
+    LogPrint(LOG_RPC, "Allowing RPC connections from: %s\n", strAllowed);
 
     strRPCUserColonPass = settings.GetParameter("-rpcuser") + ":" + settings.GetParameter("-rpcpassword");
     if (((settings.GetParameter("-rpcpassword") == "") ||
@@ -771,6 +852,25 @@ void StartRPCThreads()
         return;
     }
 
+    // Replies about blocks shallower than a handful of confirmations could be undone by a reorganization
+    GetRPCResponseCache().SetLimits(
+        std::max(settings.GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE), (int64_t)0) << 20,
+        std::max(settings.GetArg("-rpccachedepth", DEFAULT_RPC_CACHE_DEPTH), (int64_t)6));
+
+    rpc_method_limits.clear();
+    BOOST_FOREACH (const string& strLimit, settings.GetMultiParameter("-rpcmethodlimit")) {
+        const size_t separator = strLimit.rfind(':');
+        const int nLimit = separator == string::npos ? 0 : atoi(strLimit.substr(separator + 1));
+        if (nLimit <= 0 || !tableRPC[strLimit.substr(0, separator)]) {
+            uiInterface.ThreadSafeMessageBox(
+                strprintf(translate("Invalid -rpcmethodlimit specification: %s. Valid is a command and a positive number of calls (e.g. dumpwallet:1)."), strLimit),
+                "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+            return;
+        }
+        rpc_method_limits[strLimit.substr(0, separator)] = boost::shared_ptr<CSemaphore>(new CSemaphore(nLimit));
+    }
+
     assert(rpc_io_service == NULL);
     rpc_io_service = new asio::io_service();
 
@@ -847,9 +947,20 @@ void StartRPCThreads()
         return;
     }
 
+    // One thread accepts connections and runs the timers, so neither ever waits
+    // behind a slow command; the connections are served by the worker threads
+    rpc_work_queue = new RPCWorkQueue(std::max<int64_t>(settings.GetArg("-rpcworkqueue", DEFAULT_RPC_WORK_QUEUE_DEPTH), 1));
     rpc_worker_group = new boost::thread_group();
-    for (int i = 0; i < settings.GetArg("-rpcthreads", 4); i++)
-        rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_io_service));
+    rpc_worker_group->create_thread(boost::bind(&ThreadRPCServer, rpc_io_service));
+    for (int i = 0; i < settings.GetArg("-rpcthreads", DEFAULT_RPC_THREADS); i++)
+        rpc_worker_group->create_thread(boost::bind(&RPCWorkQueue::Run, rpc_work_queue));
+    const int64_t nBatchThreads = settings.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS);
+    if (nBatchThreads > 0) {
+        rpc_batch_queue = new RPCWorkQueue(nBatchThreads);
+        rpc_batch_group = new boost::thread_group();
+        for (int64_t i = 0; i < nBatchThreads; i++)
+            rpc_batch_group->create_thread(boost::bind(&RPCWorkQueue::Run, rpc_batch_queue));
+    }
     fRPCRunning = true;
 }
 
@@ -861,7 +972,7 @@ void StartDummyRPCThread()
          * see http://www.boost.org/doc/libs/1_51_0/doc/html/boost_asio/reference/io_service.html#boost_asio.reference.io_service.stopping_the_io_service_from_running_out_of_work */
         rpc_dummy_work = new asio::io_service::work(*rpc_io_service);
         rpc_worker_group = new boost::thread_group();
-        rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_io_service));
+        rpc_worker_group->create_thread(boost::bind(&ThreadRPCServer, rpc_io_service));
         fRPCRunning = true;
     }
 }
@@ -890,9 +1001,22 @@ void StopRPCThreads()
     deadlineTimers.clear();
 
     rpc_io_service->stop();
+    if (rpc_work_queue != NULL)
+        rpc_work_queue->Interrupt();
     cvBlockChange.notify_all();
     if (rpc_worker_group != NULL)
         rpc_worker_group->join_all();
+    // Only once no batch can be waiting on its slices any more
+    if (rpc_batch_queue != NULL)
+        rpc_batch_queue->Interrupt();
+    if (rpc_batch_group != NULL)
+        rpc_batch_group->join_all();
+    delete rpc_batch_group;
+    rpc_batch_group = NULL;
+    delete rpc_batch_queue;
+    rpc_batch_queue = NULL;
+    delete rpc_work_queue;
+    rpc_work_queue = NULL;
     delete rpc_dummy_work;
     rpc_dummy_work = NULL;
     delete rpc_worker_group;
@@ -974,7 +1098,7 @@ void JSONRequest::parse(const Value& valRequest)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Method must be a string");
     strMethod = valMethod.get_str();
     if (strMethod != "getblocktemplate")
-        LogPrint("rpc", "ThreadRPCServer method=%s\n", SanitizeString(strMethod));
+        LogPrint(LOG_RPC, "ThreadRPCServer method=%s\n", SanitizeString(strMethod));
 
     // Parse params
     Value valParams = find_value(request, "params");
@@ -987,7 +1111,7 @@ void JSONRequest::parse(const Value& valRequest)
 }
 
 
-static Object JSONRPCExecOne(const Value& req)
+static Object JSONRPCExecOne(const Value& req, CWallet* pwallet)
 {
     Object rpc_result;
 
@@ -995,7 +1119,7 @@ static Object JSONRPCExecOne(const Value& req)
     try {
         jreq.parse(req);
 
-        Value result = tableRPC.execute(jreq.strMethod, jreq.params);
+        Value result = tableRPC.execute(jreq.strMethod, jreq.params, pwallet);
         rpc_result = JSONRPCReplyObj(result, Value::null, jreq.id);
     } catch (Object& objError) {
         rpc_result = JSONRPCReplyObj(Value::null, objError, jreq.id);
@@ -1007,19 +1131,111 @@ static Object JSONRPCExecOne(const Value& req)
     return rpc_result;
 }
 
-static string JSONRPCExecBatch(const Array& vReq)
+/** The locks taken by the command the request is for, taking those of the chain if unknown */
+static RPCLocks RequestLocks(const Value& req)
 {
-    Array ret;
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    if (req.type() != obj_type)
+        return RPC_LOCKS_CHAIN;
+    const Value& valMethod = find_value(req.get_obj(), "method");
+    if (valMethod.type() != str_type)
+        return RPC_LOCKS_CHAIN;
+    const CRPCCommand* pcmd = tableRPC[valMethod.get_str()];
+    return pcmd ? pcmd->locks : RPC_LOCKS_CHAIN;
+}
+
+/** Executes the requests at the given positions of a batch, each into its own slot of the replies */
+static void JSONRPCExecSlice(const Array* vReq, const std::vector<size_t>* vIndexes, CWallet* pwallet, Array* vReplies, CSemaphore* done)
+{
+    BOOST_FOREACH (size_t reqIdx, *vIndexes)
+        (*vReplies)[reqIdx] = JSONRPCExecOne((*vReq)[reqIdx], pwallet);
+    if (done)
+        done->post();
+}
+
+/** Chain-locked requests of a batch run under one hold of cs_main at most this many at a time */
+static const size_t MAX_LOCKED_REQUESTS_PER_HOLD = 16;
+
+/**
+ * Requests that take no locks are split into slices run at once by the
+ * batch threads, while the thread serving the batch runs the others in
+ * runs of MAX_LOCKED_REQUESTS_PER_HOLD under a single hold of cs_main, so
+ * each run sees the same chain and validation still gets the lock between
+ * runs of a large batch. Wallet requests come last, one by one, as each
+ * first waits for the wallet to catch up with validation, which cannot
+ * happen with cs_main held. Replies keep the order of the requests.
+ */
+static Array JSONRPCExecBatch(const Array& vReq, CWallet* pwallet)
+{
+    Array ret(vReq.size());
+    std::vector<size_t> vLocked;
+    std::vector<size_t> vLockFree;
+    std::vector<size_t> vWallet;
+    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++) {
+        const RPCLocks locks = RequestLocks(vReq[reqIdx]);
+        if (locks == RPC_LOCKS_NONE)
+            vLockFree.push_back(reqIdx);
+        else if (locks == RPC_LOCKS_CHAIN_AND_WALLET)
+            vWallet.push_back(reqIdx);
+        else
+            vLocked.push_back(reqIdx);
+    }
+
+    // One slice more than there are batch threads, which this thread runs itself
+    const size_t nSlices = std::min(vLockFree.size(), (rpc_batch_queue == NULL ? 0 : (size_t)settings.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS)) + 1);
+    std::vector<std::vector<size_t> > vSlices(nSlices);
+    for (size_t i = 0; i < vLockFree.size(); i++)
+        vSlices[i * nSlices / vLockFree.size()].push_back(vLockFree[i]);
+
+    CSemaphore done(0);
+    size_t nQueued = 0;
+    for (size_t i = 1; i < vSlices.size(); i++) {
+        if (rpc_batch_queue->Enqueue(boost::bind(&JSONRPCExecSlice, &vReq, &vSlices[i], pwallet, &ret, &done)))
+            nQueued++;
+        else
+            JSONRPCExecSlice(&vReq, &vSlices[i], pwallet, &ret, NULL);
+    }
+
+    for (size_t nRunStart = 0; nRunStart < vLocked.size(); nRunStart += MAX_LOCKED_REQUESTS_PER_HOLD) {
+        const std::vector<size_t> vRun(
+            vLocked.begin() + nRunStart,
+            vLocked.begin() + std::min(vLocked.size(), nRunStart + MAX_LOCKED_REQUESTS_PER_HOLD));
+        LOCK(cs_main);
+        JSONRPCExecSlice(&vReq, &vRun, pwallet, &ret, NULL);
+    }
+    JSONRPCExecSlice(&vReq, &vWallet, pwallet, &ret, NULL);
+    if (!vSlices.empty())
+        JSONRPCExecSlice(&vReq, &vSlices[0], pwallet, &ret, NULL);
+    for (size_t i = 0; i < nQueued; i++)
+        done.wait();
+
+    return ret;
+}
 
-    return write_string(Value(ret), false) + "\n";
+/** Whether the replies of the command can be large enough to be better sent as they are written */
+static bool HasLargeReplies(const string& strMethod)
+{
+    static const std::set<string> largeReplyCommands = {
+        "getblock",
+        "getrawmempool",
+        "getaddresstxids",
+        "getaddressdeltas",
+        "getaddressutxos",
+        "getaddressmempool",
+        "listaddressgroupings",
+        "listreceivedbyaddress",
+        "listsinceblock",
+        "listtransactions",
+        "listunspent",
+    };
+    return largeReplyCommands.count(strMethod) > 0;
 }
 
 static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
     string& strRequest,
     map<string, string>& mapHeaders,
-    bool fRun)
+    bool fRun,
+    int nProto,
+    const string& strWalletFile)
 {
     // Check authorization
     if (mapHeaders.count("authorization") == 0) {
@@ -1042,7 +1258,7 @@ static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
     try {
         // Parse request
         Value valRequest;
-        if (!read_string(strRequest, valRequest))
+        if (!ReadJSONValue(strRequest, valRequest))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
         // Return immediately if in warmup
@@ -1052,24 +1268,35 @@ static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
                 throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
         }
 
-        string strReply;
+        // Requests sent to /wallet/<file> are for that wallet, the others for the default one
+        CWallet* pwallet = NULL;
+        if (!strWalletFile.empty()) {
+#ifdef ENABLE_WALLET
+            pwallet = FindWallet(strWalletFile);
+#endif
+            if (!pwallet)
+                throw JSONRPCError(RPC_WALLET_NOT_FOUND, "Requested wallet does not exist or is not loaded");
+        }
 
         // singleton request
         if (valRequest.type() == obj_type) {
             jreq.parse(valRequest);
 
-            Value result = tableRPC.execute(jreq.strMethod, jreq.params);
+            Value result = tableRPC.execute(jreq.strMethod, jreq.params, pwallet);
 
             // Send reply
-            strReply = JSONRPCReply(result, Value::null, jreq.id);
+            if (HasLargeReplies(jreq.strMethod)) {
+                WriteHTTPJSONReply(conn->stream(), HTTP_OK, JSONRPCReplyObj(result, Value::null, jreq.id), fRun, nProto);
+            } else {
+                string strReply = JSONRPCReply(result, Value::null, jreq.id);
+                conn->stream() << HTTPReplyHeader(HTTP_OK, fRun, strReply.size()) << strReply << std::flush;
+            }
 
             // array of requests
         } else if (valRequest.type() == array_type)
-            strReply = JSONRPCExecBatch(valRequest.get_array());
+            WriteHTTPJSONReply(conn->stream(), HTTP_OK, JSONRPCExecBatch(valRequest.get_array(), pwallet), fRun, nProto);
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        conn->stream() << HTTPReplyHeader(HTTP_OK, fRun, strReply.size()) << strReply << std::flush;
     } catch (Object& objError) {
         ErrorReply(conn->stream(), objError, jreq.id);
         return false;
@@ -1082,18 +1309,28 @@ static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
 
 void ServiceConnection(AcceptedConnection* conn)
 {
+    const int64_t nTimeout = settings.GetArg("-rpcservertimeout", DEFAULT_RPC_SERVER_TIMEOUT);
     bool fRun = true;
     while (fRun && !ShutdownRequested()) {
         int nProto = 0;
         map<string, string> mapHeaders;
         string strRequest, strMethod, strURI;
 
+        // An idle persistent connection, or a client sending its request too
+        // slowly, gives its worker thread back once the timeout runs out.
+        // Pipelined requests are already buffered and read straight away.
+        conn->set_timeout(nTimeout);
+
         // Read HTTP request line
         if (!ReadHTTPRequestLine(conn->stream(), nProto, strMethod, strURI))
             break;
 
         // Read HTTP message headers and body
         ReadHTTPMessage(conn->stream(), mapHeaders, strRequest, nProto, MAX_SIZE);
+        if (!conn->stream())
+            break;
+        // Commands take as long as they take, and their replies may be long
+        conn->set_timeout(0);
 
         // HTTP Keep-Alive is false; close connection immediately
         if ((mapHeaders["connection"] == "close") || (!settings.GetBoolArg("-rpckeepalive", true)))
@@ -1101,12 +1338,16 @@ void ServiceConnection(AcceptedConnection* conn)
 
         // Process via JSON-RPC API
         if (strURI == "/") {
-            if (!HTTPReq_JSONRPC(conn, strRequest, mapHeaders, fRun))
+            if (!HTTPReq_JSONRPC(conn, strRequest, mapHeaders, fRun, nProto, ""))
+                break;
+
+        } else if (strURI.size() > 8 && strURI.substr(0, 8) == "/wallet/") {
+            if (!HTTPReq_JSONRPC(conn, strRequest, mapHeaders, fRun, nProto, strURI.substr(8)))
                 break;
 
             // Process via HTTP REST API
         } else if (strURI.substr(0, 6) == "/rest/" && settings.GetBoolArg("-rest", false)) {
-            if (!HTTPReq_REST(conn, strURI, mapHeaders, fRun))
+            if (!HTTPReq_REST(conn, strURI, mapHeaders, fRun, nProto))
                 break;
 
         } else {
@@ -1116,14 +1357,47 @@ void ServiceConnection(AcceptedConnection* conn)
     }
 }
 
-json_spirit::Value CRPCTable::execute(const std::string& strMethod, const json_spirit::Array& params) const
+/** Wallets are owned by init, so the thread's selection must not delete them */
+static void KeepWallet(CWallet*)
+{
+}
+
+static boost::thread_specific_ptr<CWallet> rpcCallWallet(&KeepWallet);
+
+/** Makes the given wallet that of the RPC call running on this thread, for as long as it is in scope */
+class RPCCallWalletScope
+{
+public:
+    explicit RPCCallWalletScope(CWallet* pwallet)
+    {
+        rpcCallWallet.reset(pwallet);
+    }
+    ~RPCCallWalletScope()
+    {
+        rpcCallWallet.reset();
+    }
+};
+
+CWallet* GetWalletForRPC()
+{
+#ifdef ENABLE_WALLET
+    CWallet* pwallet = rpcCallWallet.get();
+    return pwallet ? pwallet : pwalletMain;
+#else
+    return NULL;
+#endif
+}
+
+json_spirit::Value CRPCTable::execute(const std::string& strMethod, const json_spirit::Array& params, CWallet* pwallet) const
 {
     // Find method
     const CRPCCommand* pcmd = tableRPC[strMethod];
     if (!pcmd)
         throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
 #ifdef ENABLE_WALLET
-    if (pcmd->reqWallet && !pwalletMain)
+    if (!pwallet)
+        pwallet = pwalletMain;
+    if (pcmd->reqWallet && !pwallet)
         throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found (disabled)");
 #endif
 
@@ -1133,41 +1407,37 @@ json_spirit::Value CRPCTable::execute(const std::string& strMethod, const json_s
         !pcmd->okSafeMode)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, string("Safe mode: ") + strWarning);
 
+    // Refuse rather than queue a call beyond its limit, so it cannot tie up more worker threads
+    map<string, boost::shared_ptr<CSemaphore> >::const_iterator limit = rpc_method_limits.find(strMethod);
+    CSemaphoreGrant grant;
+    if (limit != rpc_method_limits.end()) {
+        CSemaphoreGrant methodGrant(*limit->second, true);
+        if (!methodGrant)
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("Too many concurrent %s calls, try again later", strMethod));
+        methodGrant.MoveTo(grant);
+    }
+
     try {
         // Execute
         Value result;
         {
-            if (pcmd->threadSafe)
+            RPCCallWalletScope callWallet(pwallet);
+            // Waiting on the locks, rather than polling for them, hands them over as soon as they are released
+            if (pcmd->locks == RPC_LOCKS_NONE)
                 result = pcmd->actor(params, false);
 #ifdef ENABLE_WALLET
-            else if (!pwalletMain) {
-                LOCK(cs_main);
+            else if (pcmd->locks == RPC_LOCKS_CHAIN_AND_WALLET && pwallet) {
+                // Let the wallet catch up with the transactions and blocks validated before this call
+                SyncWithValidationInterfaceQueue();
+                // Only the wallet the call is for is locked, so calls for other wallets run alongside
+                LOCK2(cs_main, pwallet->cs_wallet);
                 result = pcmd->actor(params, false);
-            } else {
-                while (true) {
-                    TRY_LOCK(cs_main, lockMain);
-                    if (!lockMain) {
-                        MilliSleep(50);
-                        continue;
-                    }
-                    while (true) {
-                        TRY_LOCK(pwalletMain->cs_wallet, lockWallet);
-                        if (!lockMain) {
-                            MilliSleep(50);
-                            continue;
-                        }
-                        result = pcmd->actor(params, false);
-                        break;
-                    }
-                    break;
-                }
             }
-#else  // ENABLE_WALLET
+#endif // ENABLE_WALLET
             else {
                 LOCK(cs_main);
                 result = pcmd->actor(params, false);
             }
-#endif // !ENABLE_WALLET
         }
         return result;
     } catch (std::exception& e) {
@@ -22,6 +22,7 @@
 
 class CBlockIndex;
 class CNetAddr;
+class CWallet;
 
 class AcceptedConnection
 {
@@ -31,6 +32,8 @@ public:
     virtual std::iostream& stream() = 0;
     virtual std::string peer_address_to_string() const = 0;
     virtual void close() = 0;
+    //! Fail reads and writes on the stream after this many seconds from now, or never for zero
+    virtual void set_timeout(int64_t nSeconds) = 0;
 };
 
 /** Start RPC threads */
@@ -86,6 +89,16 @@ extern CNetAddr BoostAsioToCNetAddr(boost::asio::ip::address address);
 
 typedef json_spirit::Value (*rpcfn_type)(const json_spirit::Array& params, bool fHelp);
 
+/** The locks CRPCTable::execute holds around a command, going by the data the command works on */
+enum RPCLocks {
+    //! Thread safe, or takes the locks it needs itself for as short as it can
+    RPC_LOCKS_NONE,
+    //! Reads or changes the chain state, under cs_main
+    RPC_LOCKS_CHAIN,
+    //! Also uses the wallet, under cs_main and then cs_wallet
+    RPC_LOCKS_CHAIN_AND_WALLET,
+};
+
 class CRPCCommand
 {
 public:
@@ -93,7 +106,7 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
-    bool threadSafe;
+    RPCLocks locks;
     bool reqWallet;
 };
 
@@ -114,10 +127,11 @@ public:
      * Execute a method.
      * @param method   Method to execute
      * @param params   Array of arguments (JSON objects)
+     * @param pwallet  Wallet the call is for, NULL for the default one
      * @returns Result of the call.
      * @throws an exception (json_spirit::Value) when an error happens.
      */
-    json_spirit::Value execute(const std::string& method, const json_spirit::Array& params) const;
+    json_spirit::Value execute(const std::string& method, const json_spirit::Array& params, CWallet* pwallet = NULL) const;
 
     /**
     * Returns a list of registered commands
@@ -151,11 +165,14 @@ extern std::string HelpExampleCli(std::string methodname, std::string args);
 extern std::string HelpExampleRpc(std::string methodname, std::string args);
 
 extern void EnsureWalletIsUnlocked();
+/** The wallet of the RPC call running on this thread, the default wallet outside of one */
+extern CWallet* GetWalletForRPC();
 
 // in rest.cpp
 extern bool HTTPReq_REST(AcceptedConnection* conn,
     std::string& strURI,
     std::map<std::string, std::string>& mapHeaders,
-    bool fRun);
+    bool fRun,
+    int nProto);
 
 #endif // BITCOIN_RPCSERVER_H
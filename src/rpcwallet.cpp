@@ -10,6 +10,7 @@
 #include "core_io.h"
 #include <chain.h>
 #include "init.h"
+#include "main.h"
 #include "rpcserver.h"
 #include "timedata.h"
 #include "Logging.h"
@@ -23,6 +24,7 @@
 #include <script/StakingVaultScript.h>
 #include <TransactionDiskAccessor.h>
 #include <WalletTx.h>
+#include <defaultValues.h>
 #include <stdint.h>
 
 #include "json/json_spirit_utils.h"
@@ -43,22 +45,25 @@ int64_t nWalletUnlockTime;
 static CCriticalSection cs_nWalletUnlockTime;
 extern BlockMap mapBlockIndex;
 extern CChain chainActive;
-extern CWallet* pwalletMain;
+extern CCriticalSection cs_main;
 extern Settings& settings;
 
 std::string HelpRequiringPassphrase()
 {
-    return pwalletMain && pwalletMain->IsCrypted() ? "\nRequires wallet passphrase to be set with walletpassphrase call." : "";
+    CWallet* const pwallet = GetWalletForRPC();
+    return pwallet && pwallet->IsCrypted() ? "\nRequires wallet passphrase to be set with walletpassphrase call." : "";
 }
 
 void EnsureWalletIsUnlocked()
 {
-    if (!pwalletMain->IsFullyUnlocked())
+    CWallet* const pwallet = GetWalletForRPC();
+    if (!pwallet->IsFullyUnlocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
 }
 
 void WalletTxToJSON(const CWalletTx& wtx, Object& entry)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     int confirms = wtx.GetNumberOfBlockConfirmations();
     int confirmsTotal = confirms;
     entry.push_back(Pair("confirmations", confirmsTotal));
@@ -74,9 +79,9 @@ void WalletTxToJSON(const CWalletTx& wtx, Object& entry)
     entry.push_back(Pair("txid", hash.GetHex()));
     entry.push_back(Pair("baretxid", wtx.GetBareTxid().GetHex()));
     Array conflicts;
-    if(pwalletMain)
+    if(pwallet)
     {
-        BOOST_FOREACH (const uint256& conflict, pwalletMain->GetConflicts(hash))
+        BOOST_FOREACH (const uint256& conflict, pwallet->GetConflicts(hash))
                 conflicts.push_back(conflict.GetHex());
     }
     entry.push_back(Pair("walletconflicts", conflicts));
@@ -96,6 +101,7 @@ string AccountFromValue(const Value& value)
 
 Value getnewaddress(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 1)
         throw runtime_error(
                 "getnewaddress ( \"account\" )\n"
@@ -114,16 +120,16 @@ Value getnewaddress(const Array& params, bool fHelp)
     if (params.size() > 0)
         strAccount = AccountFromValue(params[0]);
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
+    if (!pwallet->IsLocked())
+        pwallet->RequestKeyPoolTopUp();
 
     // Generate a new key that is added to wallet
     CPubKey newKey;
-    if (!pwalletMain->GetKeyFromPool(newKey, false))
+    if (!pwallet->GetKeyFromPool(newKey, false))
         throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
     CKeyID keyID = newKey.GetID();
 
-    pwalletMain->SetAddressBook(keyID, strAccount, "receive");
+    pwallet->SetAddressBook(keyID, strAccount, "receive");
 
     return CBitcoinAddress(keyID).ToString();
 }
@@ -131,7 +137,8 @@ Value getnewaddress(const Array& params, bool fHelp)
 
 CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew = false)
 {
-    CWalletDB walletdb(settings,pwalletMain->strWalletFile);
+    CWallet* const pwallet = GetWalletForRPC();
+    CWalletDB walletdb(settings,pwallet->strWalletFile);
 
     CAccount account;
     walletdb.ReadAccount(strAccount, account);
@@ -141,7 +148,7 @@ CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew = false)
     // Check if the current key has been used
     if (account.vchPubKey.IsValid()) {
         CScript scriptPubKey = GetScriptForDestination(account.vchPubKey.GetID());
-        std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+        std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
         for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin();
              it != walletTransactions.end() && account.vchPubKey.IsValid();
              ++it)
@@ -155,10 +162,10 @@ CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew = false)
 
     // Generate a new key
     if (!account.vchPubKey.IsValid() || bForceNew || bKeyUsed) {
-        if (!pwalletMain->GetKeyFromPool(account.vchPubKey, false))
+        if (!pwallet->GetKeyFromPool(account.vchPubKey, false))
             throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
 
-        pwalletMain->SetAddressBook(account.vchPubKey.GetID(), strAccount, "receive");
+        pwallet->SetAddressBook(account.vchPubKey.GetID(), strAccount, "receive");
         walletdb.WriteAccount(strAccount, account);
     }
 
@@ -191,6 +198,7 @@ Value getaccountaddress(const Array& params, bool fHelp)
 
 Value getrawchangeaddress(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 1)
         throw runtime_error(
                 "getrawchangeaddress\n"
@@ -201,10 +209,10 @@ Value getrawchangeaddress(const Array& params, bool fHelp)
                 "\nExamples:\n" +
                 HelpExampleCli("getrawchangeaddress", "") + HelpExampleRpc("getrawchangeaddress", ""));
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
+    if (!pwallet->IsLocked())
+        pwallet->RequestKeyPoolTopUp();
 
-    CReserveKey reservekey(*pwalletMain);
+    CReserveKey reservekey(*pwallet);
     CPubKey vchPubKey;
     if (!reservekey.GetReservedKey(vchPubKey, true))
         throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
@@ -219,6 +227,7 @@ Value getrawchangeaddress(const Array& params, bool fHelp)
 
 Value setaccount(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
                 "setaccount \"izzyaddress\" \"account\"\n"
@@ -239,14 +248,14 @@ Value setaccount(const Array& params, bool fHelp)
         strAccount = AccountFromValue(params[1]);
 
     // Only add the account if the address is yours.
-    if (pwalletMain->IsMine(address.Get()) ) {
+    if (pwallet->IsMine(address.Get()) ) {
         // Detect when changing the account of an address that is the 'unused current key' of another account:
-        if (pwalletMain->mapAddressBook.count(address.Get())) {
-            string strOldAccount = pwalletMain->mapAddressBook[address.Get()].name;
+        if (pwallet->mapAddressBook.count(address.Get())) {
+            string strOldAccount = pwallet->mapAddressBook[address.Get()].name;
             if (address == GetAccountAddress(strOldAccount))
                 GetAccountAddress(strOldAccount, true);
         }
-        pwalletMain->SetAddressBook(address.Get(), strAccount, "receive");
+        pwallet->SetAddressBook(address.Get(), strAccount, "receive");
     } else
         throw JSONRPCError(RPC_MISC_ERROR, "setaccount can only be used with own address");
 
@@ -256,6 +265,7 @@ Value setaccount(const Array& params, bool fHelp)
 
 Value getaccount(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 1)
         throw runtime_error(
                 "getaccount \"izzyaddress\"\n"
@@ -272,8 +282,8 @@ Value getaccount(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid IZZY address");
 
     string strAccount;
-    map<CTxDestination, CAddressBookData>::iterator mi = pwalletMain->mapAddressBook.find(address.Get());
-    if (mi != pwalletMain->mapAddressBook.end() && !(*mi).second.name.empty())
+    map<CTxDestination, CAddressBookData>::iterator mi = pwallet->mapAddressBook.find(address.Get());
+    if (mi != pwallet->mapAddressBook.end() && !(*mi).second.name.empty())
         strAccount = (*mi).second.name;
     return strAccount;
 }
@@ -281,6 +291,7 @@ Value getaccount(const Array& params, bool fHelp)
 
 Value getaddressesbyaccount(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 1)
         throw runtime_error(
                 "getaddressesbyaccount \"account\"\n"
@@ -299,7 +310,7 @@ Value getaddressesbyaccount(const Array& params, bool fHelp)
 
     // Find all addresses that have the given account
     Array ret;
-    BOOST_FOREACH (const PAIRTYPE(CBitcoinAddress, CAddressBookData) & item, pwalletMain->mapAddressBook) {
+    BOOST_FOREACH (const PAIRTYPE(CBitcoinAddress, CAddressBookData) & item, pwallet->mapAddressBook) {
         const CBitcoinAddress& address = item.first;
         const string& strName = item.second.name;
         if (strName == strAccount)
@@ -311,18 +322,19 @@ Value getaddressesbyaccount(const Array& params, bool fHelp)
 
 void SendMoney(const CScript& scriptPubKey, CAmount nValue, CWalletTx& wtxNew, bool spendFromVaults = false)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     // Check amount
     if (nValue <= 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid amount");
 
-    if ( (!spendFromVaults && nValue > pwalletMain->GetSpendableBalance()) ||
-        (spendFromVaults && nValue > pwalletMain->GetBalanceByCoinType(OWNED_VAULT_COINS)  ) )
+    if ( (!spendFromVaults && nValue > pwallet->GetSpendableBalance()) ||
+        (spendFromVaults && nValue > pwallet->GetBalanceByCoinType(OWNED_VAULT_COINS)  ) )
     {
         throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Insufficient funds");
     }
 
     string strError;
-    if (pwalletMain->IsLocked()) {
+    if (pwallet->IsLocked()) {
         strError = "Error: Wallet locked, unable to create transaction!";
         LogPrintf("SendMoney() : %s", strError);
         throw JSONRPCError(RPC_WALLET_ERROR, strError);
@@ -330,7 +342,7 @@ void SendMoney(const CScript& scriptPubKey, CAmount nValue, CWalletTx& wtxNew, b
 
     // Create and send the transaction
     AvailableCoinsType coinTypeFilter = (!spendFromVaults)? ALL_SPENDABLE_COINS: OWNED_VAULT_COINS;
-    std::pair<std::string,bool> txCreation = pwalletMain->SendMoney({std::make_pair(scriptPubKey, nValue)}, wtxNew, coinTypeFilter);
+    std::pair<std::string,bool> txCreation = pwallet->SendMoney({std::make_pair(scriptPubKey, nValue)}, wtxNew, coinTypeFilter);
     if (!txCreation.second)
     {
         strError = txCreation.first;
@@ -348,11 +360,12 @@ void SendMoney(const CTxDestination& address, CAmount nValue, CWalletTx& wtxNew,
 
 Value getcoinavailability(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 1)
         throw runtime_error("");
 
     Object result;
-    if(!pwalletMain)
+    if(!pwallet)
     {
         result.push_back(Pair("Error","No wallet available at this time"));
     }
@@ -369,13 +382,13 @@ Value getcoinavailability(const Array& params, bool fHelp)
                 return totalAmount;
             };
         std::vector<COutput> outputs;
-        pwalletMain->AvailableCoins(outputs, true, false, AvailableCoinsType::OWNED_VAULT_COINS);
+        pwallet->AvailableCoins(outputs, true, false, AvailableCoinsType::OWNED_VAULT_COINS);
         result.push_back( Pair("Vaulted", ValueFromAmount(outputAmountAdder(outputs))  ) );
         outputs.clear();
-        pwalletMain->AvailableCoins(outputs, true, false, AvailableCoinsType::STAKABLE_COINS);
+        pwallet->AvailableCoins(outputs, true, false, AvailableCoinsType::STAKABLE_COINS);
         result.push_back( Pair("Stakable", ValueFromAmount(outputAmountAdder(outputs)) ) );
         outputs.clear();
-        pwalletMain->AvailableCoins(outputs, true, false, AvailableCoinsType::ALL_SPENDABLE_COINS);
+        pwallet->AvailableCoins(outputs, true, false, AvailableCoinsType::ALL_SPENDABLE_COINS);
         result.push_back( Pair("Spendable", ValueFromAmount(outputAmountAdder(outputs)) ) );
 
         return result;
@@ -435,13 +448,13 @@ Value getcoinavailability(const Array& params, bool fHelp)
                 return description;
             };
         std::vector<COutput> outputs;
-        pwalletMain->AvailableCoins(outputs, true, false, AvailableCoinsType::OWNED_VAULT_COINS);
+        pwallet->AvailableCoins(outputs, true, false, AvailableCoinsType::OWNED_VAULT_COINS);
         result.push_back( Pair("Vaulted", outputParser(outputs)  ) );
         outputs.clear();
-        pwalletMain->AvailableCoins(outputs, true, false, AvailableCoinsType::STAKABLE_COINS);
+        pwallet->AvailableCoins(outputs, true, false, AvailableCoinsType::STAKABLE_COINS);
         result.push_back( Pair("Stakable", outputParser(outputs) ) );
         outputs.clear();
-        pwalletMain->AvailableCoins(outputs, true, false, AvailableCoinsType::ALL_SPENDABLE_COINS);
+        pwallet->AvailableCoins(outputs, true, false, AvailableCoinsType::ALL_SPENDABLE_COINS);
         result.push_back( Pair("Spendable", outputParser(outputs) ) );
 
         return result;
@@ -450,6 +463,7 @@ Value getcoinavailability(const Array& params, bool fHelp)
 
 Value fundvault(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 2 || params.size() > 4)
         throw runtime_error(
                 "fundvault \"[owner_address:]manager_address\" amount ( \"comment\" \"comment-to\" )\n"
@@ -477,15 +491,15 @@ Value fundvault(const Array& params, bool fHelp)
     else
     {
         string strAccount = AccountFromValue("");
-        if (!pwalletMain->IsLocked())
-            pwalletMain->TopUpKeyPool();
+        if (!pwallet->IsLocked())
+            pwallet->RequestKeyPoolTopUp();
 
         // Generate a new key that is added to wallet
         CPubKey ownerKey;
-        if (!pwalletMain->GetKeyFromPool(ownerKey, false))
+        if (!pwallet->GetKeyFromPool(ownerKey, false))
             throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
         CKeyID ownerKeyID = ownerKey.GetID();
-        pwalletMain->SetAddressBook(ownerKeyID, strAccount, "receive");
+        pwallet->SetAddressBook(ownerKeyID, strAccount, "receive");
 
         ownerAddress.Set(ownerKeyID);
         managerAddress.SetString(addressEncodings);
@@ -558,6 +572,7 @@ Value reclaimvaultfunds(const Array& params, bool fHelp)
 
 Value removevault(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
      if (fHelp || params.size() != 1)
         throw runtime_error(
                 "removevault \"<owner_address>:<manager_address>\"\n"
@@ -591,12 +606,13 @@ Value removevault(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Vault Registry Failed: Invalid owner IZZY address");
 
     CScript script = CreateStakingVaultScript(ToByteVector(ownerKeyID),ToByteVector(managerKeyID));
-    result.push_back(Pair("removal_status", pwalletMain->RemoveVault(script) ));
+    result.push_back(Pair("removal_status", pwallet->RemoveVault(script) ));
     return result;
 }
 
 Value addvault(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
      if (fHelp || params.size() != 2)
         throw runtime_error(
                 "addvault \"<owner_address>:<manager_address>\" funding_txhash\n"
@@ -653,11 +669,11 @@ Value addvault(const Array& params, bool fHelp)
         return result;
     }
 
-    if(pwalletMain->HaveKey(managerKeyID) )
+    if(pwallet->HaveKey(managerKeyID) )
     {
         CScript script = CreateStakingVaultScript(ToByteVector(ownerKeyID),ToByteVector(managerKeyID));
 
-        if(!pwalletMain->AddVault(script,blockSearchStart,tx))
+        if(!pwallet->AddVault(script,blockSearchStart,tx))
         {
             throw JSONRPCError(RPC_INVALID_REQUEST, "AddingVaultScript: Unable to sync TX!");
         }
@@ -714,6 +730,7 @@ Value sendtoaddress(const Array& params, bool fHelp)
 
 Value listaddressgroupings(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp)
         throw runtime_error(
                 "listaddressgroupings\n"
@@ -736,17 +753,17 @@ Value listaddressgroupings(const Array& params, bool fHelp)
                 HelpExampleCli("listaddressgroupings", "") + HelpExampleRpc("listaddressgroupings", ""));
 
     Array jsonGroupings;
-    map<CTxDestination, CAmount> balances = pwalletMain->GetAddressBalances();
-    BOOST_FOREACH (set<CTxDestination> grouping, pwalletMain->GetAddressGroupings()) {
+    map<CTxDestination, CAmount> balances = pwallet->GetAddressBalances();
+    BOOST_FOREACH (set<CTxDestination> grouping, pwallet->GetAddressGroupings()) {
         Array jsonGrouping;
         BOOST_FOREACH (CTxDestination address, grouping) {
             Array addressInfo;
             addressInfo.push_back(CBitcoinAddress(address).ToString());
             addressInfo.push_back(ValueFromAmount(balances[address]));
             {
-                LOCK(pwalletMain->cs_wallet);
-                if (pwalletMain->mapAddressBook.find(CBitcoinAddress(address).Get()) != pwalletMain->mapAddressBook.end())
-                    addressInfo.push_back(pwalletMain->mapAddressBook.find(CBitcoinAddress(address).Get())->second.name);
+                LOCK(pwallet->cs_wallet);
+                if (pwallet->mapAddressBook.find(CBitcoinAddress(address).Get()) != pwallet->mapAddressBook.end())
+                    addressInfo.push_back(pwallet->mapAddressBook.find(CBitcoinAddress(address).Get())->second.name);
             }
             jsonGrouping.push_back(addressInfo);
         }
@@ -757,6 +774,7 @@ Value listaddressgroupings(const Array& params, bool fHelp)
 
 Value signmessage(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 2 || params.size() > 4)
         throw runtime_error(
                 "signmessage \"izzyaddress\" \"message\" \"input_format\" \"output_format\"\n"
@@ -802,7 +820,7 @@ Value signmessage(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_TYPE_ERROR, "Address does not refer to key");
 
     CKey key;
-    if (!pwalletMain->GetKey(keyID, key))
+    if (!pwallet->GetKey(keyID, key))
         throw JSONRPCError(RPC_WALLET_ERROR, "Private key not available");
 
     std::vector<unsigned char> vchSig;
@@ -825,6 +843,7 @@ Value signmessage(const Array& params, bool fHelp)
 
 Value getreceivedbyaddress(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
                 "getreceivedbyaddress \"izzyaddress\" ( minconf )\n"
@@ -846,7 +865,7 @@ Value getreceivedbyaddress(const Array& params, bool fHelp)
     if (!address.IsValid())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid IZZY address");
     CScript scriptPubKey = GetScriptForDestination(address.Get());
-    if (!pwalletMain->IsMine(scriptPubKey))
+    if (!pwallet->IsMine(scriptPubKey))
         return (double)0.0;
 
     // Minimum confirmations
@@ -856,7 +875,7 @@ Value getreceivedbyaddress(const Array& params, bool fHelp)
 
     // Tally
     CAmount nAmount = 0;
-    std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+    std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
     for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
     {
         const CWalletTx& wtx = *(*it);
@@ -875,6 +894,7 @@ Value getreceivedbyaddress(const Array& params, bool fHelp)
 
 Value getreceivedbyaccount(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
                 "getreceivedbyaccount \"account\" ( minconf )\n"
@@ -898,11 +918,11 @@ Value getreceivedbyaccount(const Array& params, bool fHelp)
 
     // Get the set of pub keys assigned to account
     string strAccount = AccountFromValue(params[0]);
-    set<CTxDestination> setAddress = pwalletMain->GetAccountAddresses(strAccount);
+    set<CTxDestination> setAddress = pwallet->GetAccountAddresses(strAccount);
 
     // Tally
     CAmount nAmount = 0;
-    std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+    std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
     for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
     {
         const CWalletTx& wtx = *(*it);
@@ -911,7 +931,7 @@ Value getreceivedbyaccount(const Array& params, bool fHelp)
 
         BOOST_FOREACH (const CTxOut& txout, wtx.vout) {
             CTxDestination address;
-            if (ExtractDestination(txout.scriptPubKey, address) && pwalletMain->IsMine(address) && setAddress.count(address))
+            if (ExtractDestination(txout.scriptPubKey, address) && pwallet->IsMine(address) && setAddress.count(address))
                 if (wtx.GetNumberOfBlockConfirmations() >= nMinDepth)
                     nAmount += txout.nValue;
         }
@@ -923,10 +943,11 @@ Value getreceivedbyaccount(const Array& params, bool fHelp)
 
 CAmount GetAccountBalance(CWalletDB& walletdb, const string& strAccount, int nMinDepth, const isminefilter& filter)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     CAmount nBalance = 0;
 
     // Tally wallet transactions
-    std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+    std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
     for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
     {
         const CWalletTx& wtx = *(*it);
@@ -934,7 +955,7 @@ CAmount GetAccountBalance(CWalletDB& walletdb, const string& strAccount, int nMi
             continue;
 
         CAmount nReceived, nSent, nFee;
-        pwalletMain->GetAccountAmounts(wtx,strAccount, nReceived, nSent, nFee, filter);
+        pwallet->GetAccountAmounts(wtx,strAccount, nReceived, nSent, nFee, filter);
 
         if (nReceived != 0 && wtx.GetNumberOfBlockConfirmations() >= nMinDepth)
             nBalance += nReceived;
@@ -949,13 +970,15 @@ CAmount GetAccountBalance(CWalletDB& walletdb, const string& strAccount, int nMi
 
 CAmount GetAccountBalance(const string& strAccount, int nMinDepth, const isminefilter& filter)
 {
-    CWalletDB walletdb(settings,pwalletMain->strWalletFile);
+    CWallet* const pwallet = GetWalletForRPC();
+    CWalletDB walletdb(settings,pwallet->strWalletFile);
     return GetAccountBalance(walletdb, strAccount, nMinDepth, filter);
 }
 
 
 Value getbalance(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 3)
         throw runtime_error(
                 "getbalance ( \"account\" minconf includeWatchonly )\n"
@@ -977,9 +1000,13 @@ Value getbalance(const Array& params, bool fHelp)
                 "\nThe total amount in the account named tabby with at least 6 confirmations\n" + HelpExampleCli("getbalance", "\"tabby\" 6") +
                 "\nAs a json rpc call\n" + HelpExampleRpc("getbalance", "\"tabby\", 6"));
 
+    // Let the wallet catch up with the blocks validated before this call, before any lock is taken
+    SyncWithValidationInterfaceQueue();
+    // The wallet's cached total takes the locks itself, and only while it is looked up
     if (params.size() == 0)
-        return ValueFromAmount(pwalletMain->GetBalance());
+        return ValueFromAmount(pwallet->GetBalance());
 
+    LOCK2(cs_main, pwallet->cs_wallet);
     int nMinDepth = 1;
     if (params.size() > 1)
         nMinDepth = params[1].get_int();
@@ -993,7 +1020,7 @@ Value getbalance(const Array& params, bool fHelp)
         // (GetBalance() sums up all unspent TxOuts)
         // getbalance and "getbalance * 1 true" should return the same number
         CAmount nBalance = 0;
-        std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+        std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
         for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
         {
             const CWalletTx& wtx = *(*it);
@@ -1004,7 +1031,7 @@ Value getbalance(const Array& params, bool fHelp)
             string strSentAccount;
             list<COutputEntry> listReceived;
             list<COutputEntry> listSent;
-            pwalletMain->GetAmounts(wtx,listReceived, listSent, allFee, strSentAccount, filter);
+            pwallet->GetAmounts(wtx,listReceived, listSent, allFee, strSentAccount, filter);
             if (wtx.GetNumberOfBlockConfirmations() >= nMinDepth) {
                 BOOST_FOREACH (const COutputEntry& r, listReceived)
                         nBalance += r.amount;
@@ -1025,16 +1052,18 @@ Value getbalance(const Array& params, bool fHelp)
 
 Value getunconfirmedbalance(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 0)
         throw runtime_error(
                 "getunconfirmedbalance\n"
                 "Returns the server's total unconfirmed balance\n");
-    return ValueFromAmount(pwalletMain->GetUnconfirmedBalance());
+    return ValueFromAmount(pwallet->GetUnconfirmedBalance());
 }
 
 
 Value movecmd(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 3 || params.size() > 5)
         throw runtime_error(
                 "move \"fromaccount\" \"toaccount\" amount ( minconf \"comment\" )\n"
@@ -1062,7 +1091,7 @@ Value movecmd(const Array& params, bool fHelp)
     if (params.size() > 4)
         strComment = params[4].get_str();
 
-    if(!pwalletMain->MoveFundsBetweenAccounts(strFrom,strTo,nAmount,strComment))
+    if(!pwallet->MoveFundsBetweenAccounts(strFrom,strTo,nAmount,strComment))
         throw JSONRPCError(RPC_DATABASE_ERROR, "database error");
     return true;
 }
@@ -1125,6 +1154,7 @@ Value sendfrom(const Array& params, bool fHelp)
 
 Value sendmany(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 2 || params.size() > 4)
         throw runtime_error(
                 "sendmany \"fromaccount\" {\"address\":amount,...} ( minconf \"comment\" )\n"
@@ -1187,19 +1217,107 @@ Value sendmany(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Account has insufficient funds");
 
     // Send
-    CReserveKey keyChange(*pwalletMain);
-    std::pair<std::string,bool> fCreated = pwalletMain->SendMoney(vecSend, wtx);
+    CReserveKey keyChange(*pwallet);
+    std::pair<std::string,bool> fCreated = pwallet->SendMoney(vecSend, wtx);
     if (!fCreated.second)
         throw JSONRPCError(RPC_WALLET_ERROR, fCreated.first);
 
     return wtx.GetHash().GetHex();
 }
 
+Value sendpayouts(const Array& params, bool fHelp)
+{
+    CWallet* const pwallet = GetWalletForRPC();
+    if (fHelp || params.size() < 2 || params.size() > 4)
+        throw runtime_error(
+                "sendpayouts \"fromaccount\" {\"address\":amount,...} ( maxpertransaction \"comment\" )\n"
+                "\nPay many addresses at once, in as few transactions as the limit on recipients per transaction allows.\n"
+                "The coins are selected from one listing of the wallet's coins and none of the transactions are sent\n"
+                "unless all of them could be created. Amounts are double-precision floating point numbers." +
+                HelpRequiringPassphrase() + "\n"
+                                            "\nArguments:\n"
+                                            "1. \"fromaccount\"         (string, required) The account to send the funds from, can be \"\" for the default account\n"
+                                            "2. \"amounts\"             (string, required) A json object with addresses and amounts\n"
+                                            "    {\n"
+                                            "      \"address\":amount   (numeric) The izzy address is the key, the numeric amount in IZZY is the value\n"
+                                            "      ,...\n"
+                                            "    }\n"
+                                            "3. maxpertransaction       (numeric, optional, default=" + std::to_string(DEFAULT_PAYOUTS_PER_TRANSACTION) + ") The most addresses paid by each transaction\n"
+                                            "4. \"comment\"             (string, optional) A comment\n"
+                                            "\nResult:\n"
+                                            "[                          (json array of string)\n"
+                                            "  \"transactionid\"        (string) The id of a transaction paying some of the addresses\n"
+                                            "  ,...\n"
+                                            "]\n"
+                                            "\nExamples:\n"
+                                            "\nPay two addresses:\n" +
+                HelpExampleCli("sendpayouts", "\"\" \"{\\\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\\\":0.01,\\\"XuQQkwA4FYkq2XERzMY2CiAZhJTEDAbtcg\\\":0.02}\"") +
+                "\nPay two addresses with one transaction each\n" + HelpExampleCli("sendpayouts", "\"\" \"{\\\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\\\":0.01,\\\"XuQQkwA4FYkq2XERzMY2CiAZhJTEDAbtcg\\\":0.02}\" 1 \"payout\"") +
+                "\nAs a json rpc call\n" + HelpExampleRpc("sendpayouts", "\"\", \"{\\\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\\\":0.01,\\\"XuQQkwA4FYkq2XERzMY2CiAZhJTEDAbtcg\\\":0.02}\", 100, \"payout\""));
+
+    string strAccount = AccountFromValue(params[0]);
+    Object sendTo = params[1].get_obj();
+    unsigned maxPayoutsPerTransaction = DEFAULT_PAYOUTS_PER_TRANSACTION;
+    if (params.size() > 2) {
+        const int maxPerTransaction = params[2].get_int();
+        if (maxPerTransaction < 1)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, maxpertransaction must be at least 1");
+        maxPayoutsPerTransaction = static_cast<unsigned>(maxPerTransaction);
+    }
+
+    CWalletTx wtx;
+    wtx.strFromAccount = strAccount;
+    if (params.size() > 3 && params[3].type() != null_type && !params[3].get_str().empty())
+        wtx.mapValue["comment"] = params[3].get_str();
+
+    set<CBitcoinAddress> setAddress;
+    std::vector<std::pair<CScript, CAmount> > vecSend;
+
+    CAmount totalAmount = 0;
+    BOOST_FOREACH (const Pair& s, sendTo) {
+        CBitcoinAddress address(s.name_);
+        if (!address.IsValid())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, string("Invalid IZZY address: ") + s.name_);
+
+        if (setAddress.count(address))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, duplicated address: ") + s.name_);
+        setAddress.insert(address);
+
+        CScript scriptPubKey = GetScriptForDestination(address.Get());
+        CAmount nAmount = AmountFromValue(s.value_);
+        totalAmount += nAmount;
+
+        vecSend.push_back(std::make_pair(scriptPubKey, nAmount));
+    }
+
+    EnsureWalletIsUnlocked();
+
+    // Check funds
+    CAmount nBalance = GetAccountBalance(strAccount, 1, ISMINE_SPENDABLE);
+    if (totalAmount > nBalance)
+        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Account has insufficient funds");
+
+    std::vector<CWalletTx> payoutTransactions;
+    std::pair<std::string,bool> fCreated = pwallet->SendPayouts(vecSend, maxPayoutsPerTransaction, wtx, payoutTransactions);
+    if (!fCreated.second) {
+        if (payoutTransactions.empty())
+            throw JSONRPCError(RPC_WALLET_ERROR, fCreated.first);
+        throw JSONRPCError(RPC_WALLET_ERROR, strprintf("%s Transaction %s was recorded but not sent, after %u were sent",
+            fCreated.first, payoutTransactions.back().GetHash().GetHex(), payoutTransactions.size() - 1));
+    }
+
+    Array txids;
+    BOOST_FOREACH (const CWalletTx& payoutTransaction, payoutTransactions)
+        txids.push_back(payoutTransaction.GetHash().GetHex());
+    return txids;
+}
+
 // Defined in rpcmisc.cpp
 extern CScript _createmultisig_redeemScript(const Array& params);
 
 Value addmultisigaddress(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 2 || params.size() > 3) {
         string msg = "addmultisigaddress nrequired [\"key\",...] ( \"account\" )\n"
                      "\nAdd a nrequired-to-sign multisignature address to the wallet.\n"
@@ -1232,9 +1350,9 @@ Value addmultisigaddress(const Array& params, bool fHelp)
     // Construct using pay-to-script-hash:
     CScript inner = _createmultisig_redeemScript(params);
     CScriptID innerID(inner);
-    pwalletMain->AddCScript(inner);
+    pwallet->AddCScript(inner);
 
-    pwalletMain->SetAddressBook(innerID, strAccount, "send");
+    pwallet->SetAddressBook(innerID, strAccount, "send");
     return CBitcoinAddress(innerID).ToString();
 }
 
@@ -1256,6 +1374,7 @@ struct tallyitem {
 
 Value ListReceived(const Array& params, bool fByAccounts)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     // Minimum confirmations
     int nMinDepth = 1;
     if (params.size() > 0)
@@ -1273,7 +1392,7 @@ Value ListReceived(const Array& params, bool fByAccounts)
 
     // Tally
     map<CBitcoinAddress, tallyitem> mapTally;
-    std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+    std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
     for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
     {
         const CWalletTx& wtx = *(*it);
@@ -1291,7 +1410,7 @@ Value ListReceived(const Array& params, bool fByAccounts)
             if (!ExtractDestination(txout.scriptPubKey, address))
                 continue;
 
-            isminefilter mine = pwalletMain->IsMine(address);
+            isminefilter mine = pwallet->IsMine(address);
             if (!(mine & filter))
                 continue;
 
@@ -1308,7 +1427,7 @@ Value ListReceived(const Array& params, bool fByAccounts)
     // Reply
     Array ret;
     map<string, tallyitem> mapAccountTally;
-    BOOST_FOREACH (const PAIRTYPE(CBitcoinAddress, CAddressBookData) & item, pwalletMain->mapAddressBook) {
+    BOOST_FOREACH (const PAIRTYPE(CBitcoinAddress, CAddressBookData) & item, pwallet->mapAddressBook) {
         const CBitcoinAddress& address = item.first;
         const string& strAccount = item.second.name;
         map<CBitcoinAddress, tallyitem>::iterator it = mapTally.find(address);
@@ -1439,8 +1558,9 @@ static void MaybePushAddress(Object& entry, const CTxDestination& dest)
 
 static std::string GetAccountAddress(const CTxDestination &dest)
 {
-    map<CTxDestination, CAddressBookData>::iterator mi = pwalletMain->mapAddressBook.find(dest);
-    if (mi != pwalletMain->mapAddressBook.end() && !(*mi).second.name.empty())
+    CWallet* const pwallet = GetWalletForRPC();
+    map<CTxDestination, CAddressBookData>::iterator mi = pwallet->mapAddressBook.find(dest);
+    if (mi != pwallet->mapAddressBook.end() && !(*mi).second.name.empty())
     {
         return (*mi).second.name;
     }
@@ -1450,6 +1570,7 @@ static std::string GetAccountAddress(const CTxDestination &dest)
 
 void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string& strAccount, int nMinDepth, bool fLong, Array& ret, const isminefilter& filter)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     static SuperblockSubsidyContainer superblockSubsidies(Params());
     static const I_SuperblockHeightValidator& heightValidator = superblockSubsidies.superblockHeightValidator();
 
@@ -1468,7 +1589,7 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
         CTxDestination address;
         if (ExtractDestination(wtx.vout[1].scriptPubKey, address)) {
 
-            if (!pwalletMain->IsMine(address)) {
+            if (!pwallet->IsMine(address)) {
                 const CBlockIndex *index = nullptr;
                 if(wtx.GetNumberOfBlockConfirmations(index) > 0 && index)
                 {
@@ -1477,7 +1598,7 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
                     for (unsigned int i = 1; i < wtx.vout.size(); i++) {
                         CTxDestination outAddress;
                         if (ExtractDestination(wtx.vout[i].scriptPubKey, outAddress)) {
-                            if (pwalletMain->IsMine(outAddress)) {
+                            if (pwallet->IsMine(outAddress)) {
 
                                 auto strAccountForAddress = GetAccountAddress(outAddress);
 
@@ -1486,7 +1607,7 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
 
 
                                 Object entry;
-                                isminetype mine = pwalletMain->IsMine(wtx.vout[i]);
+                                isminetype mine = pwallet->IsMine(wtx.vout[i]);
                                 entry.push_back(Pair("involvesWatchonly", mine & ISMINE_WATCH_ONLY));
                                 entry.push_back(Pair("address", CBitcoinAddress(outAddress).ToString()));
                                 entry.push_back(Pair("amount", ValueFromAmount(wtx.vout[i].nValue)));
@@ -1509,7 +1630,7 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
 
                 Object entry;
                 //stake reward
-                isminetype mine = pwalletMain->IsMine(wtx.vout[1]);
+                isminetype mine = pwallet->IsMine(wtx.vout[1]);
                 entry.push_back(Pair("involvesWatchonly", mine & ISMINE_WATCH_ONLY));
                 entry.push_back(Pair("address", CBitcoinAddress(address).ToString()));
                 entry.push_back(Pair("amount", ValueFromAmount(nNet)));
@@ -1529,22 +1650,22 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
         bool fAllFromMe = true;
         bool fAllForMe = true;
         for (const CTxIn& txin : wtx.vin) {
-            isminetype mine = pwalletMain->IsMine(txin);
+            isminetype mine = pwallet->IsMine(txin);
             fAllFromMe &= static_cast<bool>(mine & ISMINE_SPENDABLE);
         }
 
         bool fMatchesReceiveAccount = false;
         std::vector<std::pair<CBitcoinAddress, std::string>> sendAddresses;
         for (const CTxOut& txout : wtx.vout) {
-            isminetype mine = pwalletMain->IsMine(txout);
+            isminetype mine = pwallet->IsMine(txout);
             fAllForMe &= static_cast<bool>(mine & ISMINE_SPENDABLE);
 
             CTxDestination dest;
             ExtractDestination(txout.scriptPubKey, dest);
 
             std::string account;
-            if (pwalletMain->mapAddressBook.count(dest)) {
-                account = pwalletMain->mapAddressBook[dest].name;
+            if (pwallet->mapAddressBook.count(dest)) {
+                account = pwallet->mapAddressBook[dest].name;
             }
             sendAddresses.emplace_back(CBitcoinAddress(dest), account);
             fMatchesReceiveAccount |= fAllAccounts || (account == strAccount);
@@ -1580,7 +1701,7 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
             if ((!listSent.empty() || nFee != 0) && (fAllAccounts || strAccount == strSentAccount)) {
                 BOOST_FOREACH (const COutputEntry& s, listSent) {
                     Object entry;
-                    if (involvesWatchonly || (pwalletMain->IsMine(s.destination) & ISMINE_WATCH_ONLY))
+                    if (involvesWatchonly || (pwallet->IsMine(s.destination) & ISMINE_WATCH_ONLY))
                         entry.push_back(Pair("involvesWatchonly", true));
                     entry.push_back(Pair("account", strSentAccount));
                     MaybePushAddress(entry, s.destination);
@@ -1599,11 +1720,11 @@ void ListTransactions(const CWallet& wallet, const CWalletTx& wtx, const string&
             if (listReceived.size() > 0 && wtx.GetNumberOfBlockConfirmations() >= nMinDepth) {
                 BOOST_FOREACH (const COutputEntry& r, listReceived) {
                     string account;
-                    if (pwalletMain->mapAddressBook.count(r.destination))
-                        account = pwalletMain->mapAddressBook[r.destination].name;
+                    if (pwallet->mapAddressBook.count(r.destination))
+                        account = pwallet->mapAddressBook[r.destination].name;
                     if (fAllAccounts || (account == strAccount)) {
                         Object entry;
-                        if (involvesWatchonly || (pwalletMain->IsMine(r.destination) & ISMINE_WATCH_ONLY))
+                        if (involvesWatchonly || (pwallet->IsMine(r.destination) & ISMINE_WATCH_ONLY))
                             entry.push_back(Pair("involvesWatchonly", true));
                         entry.push_back(Pair("account", account));
                         MaybePushAddress(entry, r.destination);
@@ -1647,6 +1768,7 @@ void AcentryToJSON(const CAccountingEntry& acentry, const string& strAccount, Ar
 
 Value listtransactions(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 4)
         throw runtime_error(
                 "listtransactions ( \"account\" count from includeWatchonly)\n"
@@ -1722,14 +1844,13 @@ Value listtransactions(const Array& params, bool fHelp)
 
     Array ret;
 
-    std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
+    const CWallet::TxItems& txOrdered = pwallet->OrderedTxItems();
 
     // iterate backwards until we have nCount items to return:
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
+    for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
         CWalletTx* const pwtx = (*it).second.first;
         if (pwtx != 0)
-            ListTransactions(*pwalletMain, *pwtx, strAccount, 0, true, ret, filter);
+            ListTransactions(*pwallet, *pwtx, strAccount, 0, true, ret, filter);
         CAccountingEntry* const pacentry = (*it).second.second;
         if (pacentry != 0)
             AcentryToJSON(*pacentry, strAccount, ret);
@@ -1757,6 +1878,7 @@ Value listtransactions(const Array& params, bool fHelp)
 
 Value listaccounts(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 2)
         throw runtime_error(
                 "listaccounts ( minconf includeWatchonly)\n"
@@ -1785,12 +1907,12 @@ Value listaccounts(const Array& params, bool fHelp)
             includeWatchonly = includeWatchonly | ISMINE_WATCH_ONLY;
 
     map<string, CAmount> mapAccountBalances;
-    BOOST_FOREACH (const PAIRTYPE(CTxDestination, CAddressBookData) & entry, pwalletMain->mapAddressBook) {
-        if (pwalletMain->IsMine(entry.first) & includeWatchonly) // This address belongs to me
+    BOOST_FOREACH (const PAIRTYPE(CTxDestination, CAddressBookData) & entry, pwallet->mapAddressBook) {
+        if (pwallet->IsMine(entry.first) & includeWatchonly) // This address belongs to me
             mapAccountBalances[entry.second.name] = 0;
     }
 
-    std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+    std::vector<const CWalletTx*> walletTransactions = pwallet->GetWalletTransactionReferences();
     for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
     {
         const CWalletTx& wtx = *(*it);
@@ -1801,21 +1923,21 @@ Value listaccounts(const Array& params, bool fHelp)
         int nDepth = wtx.GetNumberOfBlockConfirmations();
         if (wtx.GetBlocksToMaturity() > 0 || nDepth < 0)
             continue;
-        pwalletMain->GetAmounts(wtx,listReceived, listSent, nFee, strSentAccount, includeWatchonly);
+        pwallet->GetAmounts(wtx,listReceived, listSent, nFee, strSentAccount, includeWatchonly);
         mapAccountBalances[strSentAccount] -= nFee;
         BOOST_FOREACH (const COutputEntry& s, listSent)
                 mapAccountBalances[strSentAccount] -= s.amount;
         if (nDepth >= nMinDepth) {
             BOOST_FOREACH (const COutputEntry& r, listReceived)
-                    if (pwalletMain->mapAddressBook.count(r.destination))
-                    mapAccountBalances[pwalletMain->mapAddressBook[r.destination].name] += r.amount;
+                    if (pwallet->mapAddressBook.count(r.destination))
+                    mapAccountBalances[pwallet->mapAddressBook[r.destination].name] += r.amount;
             else
             mapAccountBalances[""] += r.amount;
         }
     }
 
     list<CAccountingEntry> acentries;
-    CWalletDB(settings,pwalletMain->strWalletFile).ListAccountCreditDebit("*", acentries);
+    CWalletDB(settings,pwallet->strWalletFile).ListAccountCreditDebit("*", acentries);
     BOOST_FOREACH (const CAccountingEntry& entry, acentries)
             mapAccountBalances[entry.strAccount] += entry.nCreditDebit;
 
@@ -1828,6 +1950,7 @@ Value listaccounts(const Array& params, bool fHelp)
 
 Value listsinceblock(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp)
         throw runtime_error(
                 "listsinceblock ( \"blockhash\" target-confirmations includeWatchonly)\n"
@@ -1891,13 +2014,16 @@ Value listsinceblock(const Array& params, bool fHelp)
 
     Array transactions;
 
-    std::vector<const CWalletTx*> walletTransactions = pwalletMain->GetWalletTransactionReferences();
+    // Only the transactions confirmed after the block, or not at all, can be shallower than it
+    std::vector<const CWalletTx*> walletTransactions = pindex ?
+        pwallet->GetWalletTransactionsAboveHeight(pindex->nHeight) :
+        pwallet->GetWalletTransactionReferences();
     for (std::vector<const CWalletTx*>::iterator it = walletTransactions.begin(); it != walletTransactions.end(); ++it)
     {
-        CWalletTx tx = *(*it);
+        const CWalletTx& tx = *(*it);
 
         if (depth == -1 || tx.GetNumberOfBlockConfirmations() < depth)
-            ListTransactions(*pwalletMain, tx, "*", 0, true, transactions, filter);
+            ListTransactions(*pwallet, tx, "*", 0, true, transactions, filter);
     }
 
     CBlockIndex* pblockLast = chainActive[chainActive.Height() + 1 - target_confirms];
@@ -1912,6 +2038,7 @@ Value listsinceblock(const Array& params, bool fHelp)
 
 Value gettransaction(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
                 "gettransaction \"txid\" ( includeWatchonly )\n"
@@ -1956,13 +2083,13 @@ Value gettransaction(const Array& params, bool fHelp)
             filter = filter | ISMINE_WATCH_ONLY;
 
     Object entry;
-    const CWalletTx* txPtr = pwalletMain->GetWalletTx(hash);
+    const CWalletTx* txPtr = pwallet->GetWalletTx(hash);
     if (txPtr == nullptr)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid or non-wallet transaction id");
     const CWalletTx& wtx = *txPtr;
 
-    CAmount nCredit = pwalletMain->GetCredit(wtx,filter);
-    CAmount nDebit = pwalletMain->GetDebit(wtx,filter);
+    CAmount nCredit = pwallet->GetCredit(wtx,filter);
+    CAmount nDebit = pwallet->GetDebit(wtx,filter);
     CAmount nNet = nCredit - nDebit;
     CAmount nFee =  nDebit > 0 ? nDebit - wtx.GetValueOut(): 0;
 
@@ -1972,7 +2099,7 @@ Value gettransaction(const Array& params, bool fHelp)
     WalletTxToJSON(wtx, entry);
 
     Array details;
-    ListTransactions(*pwalletMain, wtx, "*", 0, false, details, filter);
+    ListTransactions(*pwallet, wtx, "*", 0, false, details, filter);
     entry.push_back(Pair("details", details));
 
     string strHex = EncodeHexTx(static_cast<CTransaction>(wtx));
@@ -1984,6 +2111,7 @@ Value gettransaction(const Array& params, bool fHelp)
 
 Value backupwallet(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 1)
         throw runtime_error(
                 "backupwallet \"destination\"\n"
@@ -1994,7 +2122,7 @@ Value backupwallet(const Array& params, bool fHelp)
                 HelpExampleCli("backupwallet", "\"backup.dat\"") + HelpExampleRpc("backupwallet", "\"backup.dat\""));
 
     string strDest = params[0].get_str();
-    if (!BackupWallet(*pwalletMain, strDest))
+    if (!BackupWallet(*pwallet, strDest))
         throw JSONRPCError(RPC_WALLET_ERROR, "Error: Wallet backup failed!");
 
     return Value::null;
@@ -2003,6 +2131,7 @@ Value backupwallet(const Array& params, bool fHelp)
 
 Value keypoolrefill(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 1)
         throw runtime_error(
                 "keypoolrefill ( newsize )\n"
@@ -2022,9 +2151,9 @@ Value keypoolrefill(const Array& params, bool fHelp)
     }
 
     EnsureWalletIsUnlocked();
-    pwalletMain->TopUpKeyPool(kpSize);
+    pwallet->TopUpKeyPool(kpSize);
 
-    if (pwalletMain->GetKeyPoolSize() < kpSize)
+    if (pwallet->GetKeyPoolSize() < kpSize)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error refreshing keypool.");
 
     return Value::null;
@@ -2040,7 +2169,8 @@ static void LockWallet(CWallet* pWallet)
 
 Value walletpassphrase(const Array& params, bool fHelp)
 {
-    if (pwalletMain->IsCrypted() && (fHelp || params.size() < 2 || params.size() > 3))
+    CWallet* const pwallet = GetWalletForRPC();
+    if (pwallet->IsCrypted() && (fHelp || params.size() < 2 || params.size() > 3))
         throw runtime_error(
                 "walletpassphrase \"passphrase\" timeout ( stakingOnly )\n"
                 "\nStores the wallet decryption key in memory for 'timeout' seconds.\n"
@@ -2061,7 +2191,7 @@ Value walletpassphrase(const Array& params, bool fHelp)
 
     if (fHelp)
         return true;
-    if (!pwalletMain->IsCrypted())
+    if (!pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an unencrypted wallet, but walletpassphrase was called.");
 
     // Note that the walletpassphrase is stored in params[0] which is not mlock()ed
@@ -2076,15 +2206,15 @@ Value walletpassphrase(const Array& params, bool fHelp)
         stakingOnly = params[2].get_bool();
 
 
-    if(pwalletMain->IsUnlockedForStakingOnly() && stakingOnly)
+    if(pwallet->IsUnlockedForStakingOnly() && stakingOnly)
     {
         throw JSONRPCError(RPC_WALLET_ALREADY_UNLOCKED, "Error: Wallet is already unlocked for staking.");
     }
 
-    if (!pwalletMain->Unlock(strWalletPass, stakingOnly))
+    if (!pwallet->Unlock(strWalletPass, stakingOnly))
         throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: The wallet passphrase entered was incorrect.");
 
-    pwalletMain->TopUpKeyPool();
+    pwallet->RequestKeyPoolTopUp();
 
     int64_t nSleepTime = params[1].get_int64();
     LOCK(cs_nWalletUnlockTime);
@@ -2092,7 +2222,7 @@ Value walletpassphrase(const Array& params, bool fHelp)
 
     if (nSleepTime > 0) {
         nWalletUnlockTime = GetTime () + nSleepTime;
-        RPCRunLater ("lockwallet", boost::bind (LockWallet, pwalletMain), nSleepTime);
+        RPCRunLater ("lockwallet" + pwallet->strWalletFile, boost::bind (LockWallet, pwallet), nSleepTime);
     }
 
     return Value::null;
@@ -2101,7 +2231,8 @@ Value walletpassphrase(const Array& params, bool fHelp)
 
 Value walletpassphrasechange(const Array& params, bool fHelp)
 {
-    if (pwalletMain->IsCrypted() && (fHelp || params.size() != 2))
+    CWallet* const pwallet = GetWalletForRPC();
+    if (pwallet->IsCrypted() && (fHelp || params.size() != 2))
         throw runtime_error(
                 "walletpassphrasechange \"oldpassphrase\" \"newpassphrase\"\n"
                 "\nChanges the wallet passphrase from 'oldpassphrase' to 'newpassphrase'.\n"
@@ -2113,7 +2244,7 @@ Value walletpassphrasechange(const Array& params, bool fHelp)
 
     if (fHelp)
         return true;
-    if (!pwalletMain->IsCrypted())
+    if (!pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an unencrypted wallet, but walletpassphrasechange was called.");
 
     // TODO: get rid of these .c_str() calls by implementing SecureString::operator=(std::string)
@@ -2131,7 +2262,7 @@ Value walletpassphrasechange(const Array& params, bool fHelp)
                 "walletpassphrasechange <oldpassphrase> <newpassphrase>\n"
                 "Changes the wallet passphrase from <oldpassphrase> to <newpassphrase>.");
 
-    if (!pwalletMain->ChangeWalletPassphrase(strOldWalletPass, strNewWalletPass))
+    if (!pwallet->ChangeWalletPassphrase(strOldWalletPass, strNewWalletPass))
         throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: The wallet passphrase entered was incorrect.");
 
     return Value::null;
@@ -2140,7 +2271,8 @@ Value walletpassphrasechange(const Array& params, bool fHelp)
 
 Value walletlock(const Array& params, bool fHelp)
 {
-    if (pwalletMain->IsCrypted() && (fHelp || params.size() != 0))
+    CWallet* const pwallet = GetWalletForRPC();
+    if (pwallet->IsCrypted() && (fHelp || params.size() != 0))
         throw runtime_error(
                 "walletlock\n"
                 "\nRemoves the wallet encryption key from memory, locking the wallet.\n"
@@ -2155,13 +2287,13 @@ Value walletlock(const Array& params, bool fHelp)
 
     if (fHelp)
         return true;
-    if (!pwalletMain->IsCrypted())
+    if (!pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an unencrypted wallet, but walletlock was called.");
 
-    RPCDiscardRunLater("lockwallet");
+    RPCDiscardRunLater("lockwallet" + pwallet->strWalletFile);
 
     {
-        LockWallet(pwalletMain);
+        LockWallet(pwallet);
     }
 
     return Value::null;
@@ -2169,6 +2301,7 @@ Value walletlock(const Array& params, bool fHelp)
 
 Value walletverify(const json_spirit::Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 0)
         throw runtime_error(
                 "walletverify\n"
@@ -2179,12 +2312,12 @@ Value walletverify(const json_spirit::Array& params, bool fHelp)
 
     EnsureWalletIsUnlocked();
 
-    if(!pwalletMain->IsHDEnabled())
+    if(!pwallet->IsHDEnabled())
         throw runtime_error("HD wallet is disabled, checking integrity works only with HD wallets");
 
-    for(auto &&entry : pwalletMain->mapHdPubKeys) {
+    for(auto &&entry : pwallet->mapHdPubKeys) {
         CKey derivedKey;
-        if(!pwalletMain->GetKey(entry.first, derivedKey)) {
+        if(!pwallet->GetKey(entry.first, derivedKey)) {
             return false;
         }
 
@@ -2198,7 +2331,8 @@ Value walletverify(const json_spirit::Array& params, bool fHelp)
 
 Value encryptwallet(const Array& params, bool fHelp)
 {
-    if (!pwalletMain->IsCrypted() && (fHelp || params.size() != 1))
+    CWallet* const pwallet = GetWalletForRPC();
+    if (!pwallet->IsCrypted() && (fHelp || params.size() != 1))
         throw runtime_error(
                 "encryptwallet \"passphrase\"\n"
                 "\nEncrypts the wallet with 'passphrase'. This is for first time encryption.\n"
@@ -2219,7 +2353,7 @@ Value encryptwallet(const Array& params, bool fHelp)
 
     if (fHelp)
         return true;
-    if (pwalletMain->IsCrypted())
+    if (pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an encrypted wallet, but encryptwallet was called.");
 
     // TODO: get rid of this .c_str() by implementing SecureString::operator=(std::string)
@@ -2233,7 +2367,7 @@ Value encryptwallet(const Array& params, bool fHelp)
                 "encryptwallet <passphrase>\n"
                 "Encrypts the wallet with <passphrase>.");
 
-    if (!pwalletMain->EncryptWallet(strWalletPass))
+    if (!pwallet->EncryptWallet(strWalletPass))
         throw JSONRPCError(RPC_WALLET_ENCRYPTION_FAILED, "Error: Failed to encrypt the wallet.");
 
     // BDB seems to have a bad habit of writing old data into
@@ -2245,6 +2379,7 @@ Value encryptwallet(const Array& params, bool fHelp)
 
 Value lockunspent(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
                 "lockunspent unlock [{\"txid\":\"txid\",\"vout\":n},...]\n"
@@ -2283,11 +2418,11 @@ Value lockunspent(const Array& params, bool fHelp)
 
     const bool fUnlock = params[0].get_bool();
 
-    LOCK(pwalletMain->cs_wallet);
+    LOCK(pwallet->cs_wallet);
 
     if (params.size() == 1) {
         if (fUnlock)
-            pwalletMain->UnlockAllCoins();
+            pwallet->UnlockAllCoins();
         return true;
     }
 
@@ -2310,9 +2445,9 @@ Value lockunspent(const Array& params, bool fHelp)
         COutPoint outpt(uint256(txid), nOutput);
 
         if (fUnlock)
-            pwalletMain->UnlockCoin(outpt);
+            pwallet->UnlockCoin(outpt);
         else
-            pwalletMain->LockCoin(outpt);
+            pwallet->LockCoin(outpt);
     }
 
     return true;
@@ -2320,6 +2455,7 @@ Value lockunspent(const Array& params, bool fHelp)
 
 Value listlockunspent(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() > 0)
         throw runtime_error(
                 "listlockunspent\n"
@@ -2342,7 +2478,7 @@ Value listlockunspent(const Array& params, bool fHelp)
                 "\nAs a json rpc call\n" + HelpExampleRpc("listlockunspent", ""));
 
     std::vector<COutPoint> vOutpts;
-    pwalletMain->ListLockedCoins(vOutpts);
+    pwallet->ListLockedCoins(vOutpts);
 
     Array ret;
 
@@ -2377,12 +2513,14 @@ static std::string DescribeEncryptionStatus(CWallet *wallet)
 
 Value getwalletinfo(const Array& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForRPC();
     if (fHelp || params.size() != 0)
         throw runtime_error(
                 "getwalletinfo\n"
                 "Returns an object containing various wallet state info.\n"
                 "\nResult:\n"
                 "{\n"
+                "  \"walletname\": xxxxx,        (string) the wallet file name\n"
                 "  \"walletversion\": xxxxx,     (numeric) the wallet version\n"
                 "  \"balance\": xxxxxxx,         (numeric) the total IZZY balance of the wallet\n"
                 "  \"txcount\": xxxxxxx,         (numeric) the total number of transactions in the wallet\n"
@@ -2395,19 +2533,20 @@ Value getwalletinfo(const Array& params, bool fHelp)
                 HelpExampleCli("getwalletinfo", "") + HelpExampleRpc("getwalletinfo", ""));
 
     CHDChain hdChainCurrent;
-    bool fHDEnabled = pwalletMain->GetHDChain(hdChainCurrent);
+    bool fHDEnabled = pwallet->GetHDChain(hdChainCurrent);
     Object obj;
-    obj.push_back(Pair("walletversion", pwalletMain->GetVersion()));
-    obj.push_back(Pair("balance",       ValueFromAmount(pwalletMain->GetBalance())));
-    obj.push_back(Pair("unconfirmed_balance", ValueFromAmount(pwalletMain->GetUnconfirmedBalance())));
-    obj.push_back(Pair("immature_balance",    ValueFromAmount(pwalletMain->GetImmatureBalance())));
-    obj.push_back(Pair("txcount", (int)pwalletMain->GetWalletTransactionReferences().size()));
-    obj.push_back(Pair("keypoololdest", pwalletMain->GetOldestKeyPoolTime()));
-    obj.push_back(Pair("keypoolsize", (int)pwalletMain->GetKeyPoolSize()));
-    if (pwalletMain->IsCrypted())
+    obj.push_back(Pair("walletname", pwallet->strWalletFile));
+    obj.push_back(Pair("walletversion", pwallet->GetVersion()));
+    obj.push_back(Pair("balance",       ValueFromAmount(pwallet->GetBalance())));
+    obj.push_back(Pair("unconfirmed_balance", ValueFromAmount(pwallet->GetUnconfirmedBalance())));
+    obj.push_back(Pair("immature_balance",    ValueFromAmount(pwallet->GetImmatureBalance())));
+    obj.push_back(Pair("txcount", (int)pwallet->GetWalletTransactionReferences().size()));
+    obj.push_back(Pair("keypoololdest", pwallet->GetOldestKeyPoolTime()));
+    obj.push_back(Pair("keypoolsize", (int)pwallet->GetKeyPoolSize()));
+    if (pwallet->IsCrypted())
         obj.push_back(Pair("unlocked_until", nWalletUnlockTime));
 
-    obj.push_back(Pair("encryption_status", DescribeEncryptionStatus(pwalletMain)));
+    obj.push_back(Pair("encryption_status", DescribeEncryptionStatus(pwallet)));
 
     if (fHDEnabled) {
         obj.push_back(Pair("hdchainid", hdChainCurrent.GetID().GetHex()));
@@ -2430,3 +2569,63 @@ Value getwalletinfo(const Array& params, bool fHelp)
     }
     return obj;
 }
+
+Value listwallets(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "listwallets\n"
+                "Returns the file names of the loaded wallets, the default one first.\n"
+                "Wallet commands are sent to one of them through the /wallet/<filename> endpoint, or izzy-cli -rpcwallet=<filename>.\n"
+                "\nResult:\n"
+                "[                         (json array of strings)\n"
+                "  \"walletname\"            (string) the wallet file name\n"
+                "  ,...\n"
+                "]\n"
+                "\nExamples:\n" +
+                HelpExampleCli("listwallets", "") + HelpExampleRpc("listwallets", ""));
+
+    Array ret;
+    BOOST_FOREACH (const CWallet* pwallet, vpwallets)
+        ret.push_back(pwallet->strWalletFile);
+    return ret;
+}
+
+Value getrescanprogress(const Array& params, bool fHelp)
+{
+    CWallet* const pwallet = GetWalletForRPC();
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getrescanprogress\n"
+                "Returns how far the wallet rescan running, or the last one, has got.\n"
+                "Unlike the other wallet calls, this one answers while a rescan holds the wallet.\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"rescanning\": true|false,   (boolean) whether a rescan is running\n"
+                "  \"startheight\": n,           (numeric) the height of the first block to scan\n"
+                "  \"stopheight\": n,            (numeric) the height of the last block to scan\n"
+                "  \"currentheight\": n,         (numeric) the height of the last block scanned\n"
+                "  \"blocksscanned\": n,         (numeric) the blocks scanned so far\n"
+                "  \"blockstoscan\": n,          (numeric) the blocks to scan in all\n"
+                "  \"transactionsfound\": n,     (numeric) the wallet transactions added or updated so far\n"
+                "  \"elapsed\": n,               (numeric) the seconds the rescan has taken so far\n"
+                "  \"eta\": n                    (numeric) the seconds the rest of the rescan should take, if rescanning\n"
+                "}\n"
+                "\nExamples:\n" +
+                HelpExampleCli("getrescanprogress", "") + HelpExampleRpc("getrescanprogress", ""));
+
+    const CWallet::RescanProgress progress = pwallet->GetRescanProgress();
+    const int64_t nElapsed = progress.startTime > 0 ? std::max<int64_t>(GetTime() - progress.startTime, 0) : 0;
+    Object obj;
+    obj.push_back(Pair("rescanning", progress.fRescanning));
+    obj.push_back(Pair("startheight", progress.startHeight));
+    obj.push_back(Pair("stopheight", progress.stopHeight));
+    obj.push_back(Pair("currentheight", progress.currentHeight));
+    obj.push_back(Pair("blocksscanned", (uint64_t)progress.blocksScanned));
+    obj.push_back(Pair("blockstoscan", (uint64_t)progress.blocksToScan));
+    obj.push_back(Pair("transactionsfound", progress.transactionsFound));
+    obj.push_back(Pair("elapsed", nElapsed));
+    if (progress.fRescanning && progress.blocksScanned > 0)
+        obj.push_back(Pair("eta", nElapsed * (int64_t)(progress.blocksToScan - progress.blocksScanned) / progress.blocksScanned));
+    return obj;
+}
@@ -0,0 +1,92 @@
+#include <script/ParallelInputSigner.h>
+
+#include <keystore.h>
+#include <primitives/transaction.h>
+#include <script/sign.h>
+#include <script/SignatureCheckers.h>
+#include <script/standard.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+constexpr size_t ParallelInputSigner::MIN_INPUTS_PER_THREAD;
+
+ParallelInputSigner::ParallelInputSigner(
+    const CKeyStore& keyStore,
+    int nHashType
+    ): keyStore_(keyStore)
+    , nHashType_(nHashType)
+{
+}
+
+void ParallelInputSigner::CopySigningKeys(const CKeyStore& keyStore, const CScript& scriptPubKey, CBasicKeyStore& signingKeyStore)
+{
+    txnouttype type;
+    std::vector<CTxDestination> destinations;
+    int nRequired;
+    if (!ExtractDestinations(scriptPubKey, type, destinations, nRequired))
+        return;
+    for (const CTxDestination& destination: destinations) {
+        if (const CKeyID* keyID = boost::get<CKeyID>(&destination)) {
+            CKey key;
+            if (!signingKeyStore.HaveKey(*keyID) && keyStore.GetKey(*keyID, key))
+                signingKeyStore.AddKey(key);
+        } else if (const CScriptID* scriptID = boost::get<CScriptID>(&destination)) {
+            CScript redeemScript;
+            if (!signingKeyStore.HaveCScript(*scriptID) && keyStore.GetCScript(*scriptID, redeemScript)) {
+                signingKeyStore.AddCScript(redeemScript);
+                CopySigningKeys(keyStore, redeemScript, signingKeyStore);
+            }
+        }
+    }
+}
+
+void ParallelInputSigner::SignInputRange(
+    const CMutableTransaction& txUnsigned,
+    const PrecomputedTransactionData& txdata,
+    const std::vector<CScript>& scriptPubKeys,
+    size_t begin,
+    size_t end,
+    std::vector<CScript>& scriptSigs,
+    std::vector<char>& signedInputs) const
+{
+    CMutableTransaction txCopy(txUnsigned);
+    for (size_t nIn = begin; nIn < end; nIn++) {
+        if (scriptPubKeys[nIn].empty())
+            continue;
+        signedInputs[nIn] = SignSignature(keyStore_, scriptPubKeys[nIn], txCopy, nIn, nHashType_, &txdata);
+        scriptSigs[nIn] = txCopy.vin[nIn].scriptSig;
+    }
+}
+
+bool ParallelInputSigner::SignInputs(CMutableTransaction& txTo, const std::vector<CScript>& scriptPubKeys) const
+{
+    const size_t nInputs = std::min(txTo.vin.size(), scriptPubKeys.size());
+    std::vector<CScript> scriptSigs(nInputs);
+    std::vector<char> signedInputs(nInputs, false);
+    // Signing an input leaves the parts of the transaction shared by all signature hashes as they are
+    const PrecomputedTransactionData txdata(txTo);
+
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(boost::thread::hardware_concurrency(), nInputs / MIN_INPUTS_PER_THREAD));
+    const size_t nPerThread = (nInputs + nThreads - 1) / nThreads;
+    boost::thread_group signers;
+    for (size_t n = 1; n < nThreads; n++) {
+        const size_t begin = std::min(nInputs, n * nPerThread);
+        const size_t end = std::min(nInputs, begin + nPerThread);
+        signers.create_thread(boost::bind(&ParallelInputSigner::SignInputRange, this,
+            boost::cref(txTo), boost::cref(txdata), boost::cref(scriptPubKeys), begin, end, boost::ref(scriptSigs), boost::ref(signedInputs)));
+    }
+    SignInputRange(txTo, txdata, scriptPubKeys, 0, std::min(nInputs, nPerThread), scriptSigs, signedInputs);
+    signers.join_all();
+
+    bool fAllSigned = true;
+    for (size_t nIn = 0; nIn < nInputs; nIn++) {
+        if (scriptPubKeys[nIn].empty())
+            continue;
+        txTo.vin[nIn].scriptSig = scriptSigs[nIn];
+        fAllSigned &= (signedInputs[nIn] != 0);
+    }
+    return fAllSigned && nInputs == txTo.vin.size();
+}
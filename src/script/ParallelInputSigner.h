@@ -0,0 +1,55 @@
+#ifndef PARALLEL_INPUT_SIGNER_H
+#define PARALLEL_INPUT_SIGNER_H
+#include <script/scriptandsigflags.h>
+
+#include <stddef.h>
+#include <vector>
+
+class CBasicKeyStore;
+class CKeyStore;
+class CScript;
+class PrecomputedTransactionData;
+struct CMutableTransaction;
+
+/**
+ * Signs the inputs of a transaction spread over several threads.
+ *
+ * Each thread signs its inputs against its own copy of the transaction, which
+ * gives the same signatures as signing them one after the other since an
+ * input's signature hash leaves out the scriptSigs of the other inputs.
+ *
+ * The keystore is read from every thread at once. A wallet's keystore takes
+ * the wallet lock and decrypts the key on each lookup, so the keys are best
+ * copied out of it with CopySigningKeys first, under one hold of its lock.
+ */
+class ParallelInputSigner
+{
+private:
+    const CKeyStore& keyStore_;
+    const int nHashType_;
+
+    void SignInputRange(
+        const CMutableTransaction& txUnsigned,
+        const PrecomputedTransactionData& txdata,
+        const std::vector<CScript>& scriptPubKeys,
+        size_t begin,
+        size_t end,
+        std::vector<CScript>& scriptSigs,
+        std::vector<char>& signedInputs) const;
+
+public:
+    //! Inputs each thread should have to sign before another thread is worth starting
+    static constexpr size_t MIN_INPUTS_PER_THREAD = 8;
+
+    ParallelInputSigner(const CKeyStore& keyStore, int nHashType = SIGHASH_ALL);
+
+    //! Copies the keys and redeem scripts needed to sign for the script, following redeem scripts down
+    static void CopySigningKeys(const CKeyStore& keyStore, const CScript& scriptPubKey, CBasicKeyStore& signingKeyStore);
+
+    /**
+     * Signs input i of txTo against scriptPubKeys[i], skipping the inputs whose
+     * script is empty, and returns whether all the others were signed.
+     */
+    bool SignInputs(CMutableTransaction& txTo, const std::vector<CScript>& scriptPubKeys) const;
+};
+#endif// PARALLEL_INPUT_SIGNER_H
@@ -5,11 +5,15 @@
 #include "script/scriptandsigflags.h"
 #include <eccryptoverify.h>
 #include <pubkey.h>
+#include <streams.h>
+
+#include <assert.h>
 
 MutableTransactionSignatureChecker::MutableTransactionSignatureChecker(
     const CMutableTransaction* txToIn,
-    unsigned int nInIn
-    ) : TransactionSignatureChecker(NULL, nInIn)
+    unsigned int nInIn,
+    const PrecomputedTransactionData* txdataIn
+    ) : TransactionSignatureChecker(NULL, nInIn, txdataIn)
     , txToPtr(std::make_shared<const CTransaction>(*txToIn))
 {
     txTo = txToPtr.get();
@@ -263,7 +267,69 @@ public:
 
 } // anon namespace
 
-uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+constexpr size_t PrecomputedTransactionData::MIDSTATE_INTERVAL;
+
+PrecomputedTransactionData::PrecomputedTransactionData(
+    const CTransaction& txTo
+    ): serializedInputs_()
+    , inputOffsets_()
+    , midstates_()
+    , serializedOutputs_()
+{
+    // Serialized the way CTransactionSignatureSerializer does for an input past the last one
+    CTransactionSignatureSerializer txTmp(txTo, CScript(), txTo.vin.size(), SIGHASH_ALL);
+    CDataStream ss(SER_GETHASH, 0);
+    ::Serialize(ss, txTo.nVersion, SER_GETHASH, 0);
+    ::WriteCompactSize(ss, txTo.vin.size());
+    inputOffsets_.reserve(txTo.vin.size() + 1);
+    for (unsigned int nInput = 0; nInput < txTo.vin.size(); nInput++) {
+        inputOffsets_.push_back(ss.size());
+        txTmp.SerializeInput(ss, nInput, SER_GETHASH, 0);
+    }
+    inputOffsets_.push_back(ss.size());
+    serializedInputs_.assign(ss.begin(), ss.end());
+
+    CHashWriter midstate(SER_GETHASH, 0);
+    size_t hashedUpTo = 0;
+    for (size_t nInput = 0; nInput < txTo.vin.size(); nInput += MIDSTATE_INTERVAL) {
+        midstate.write(serializedInputs_.data() + hashedUpTo, inputOffsets_[nInput] - hashedUpTo);
+        hashedUpTo = inputOffsets_[nInput];
+        midstates_.push_back(midstate);
+    }
+
+    ss.clear();
+    ::WriteCompactSize(ss, txTo.vout.size());
+    for (unsigned int nOutput = 0; nOutput < txTo.vout.size(); nOutput++)
+        txTmp.SerializeOutput(ss, nOutput, SER_GETHASH, 0);
+    ::Serialize(ss, txTo.nLockTime, SER_GETHASH, 0);
+    serializedOutputs_.assign(ss.begin(), ss.end());
+}
+
+bool PrecomputedTransactionData::IsApplicable(int nHashType) const
+{
+    return !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE &&
+        (nHashType & 0x1f) != SIGHASH_NONE;
+}
+
+uint256 PrecomputedTransactionData::SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType) const
+{
+    assert(IsApplicable(nHashType));
+    assert(nIn < txTo.vin.size() && inputOffsets_.size() == txTo.vin.size() + 1);
+
+    CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
+    const size_t nMidstate = nIn / MIDSTATE_INTERVAL;
+    const size_t midstateEnd = inputOffsets_[nMidstate * MIDSTATE_INTERVAL];
+    CHashWriter ss(midstates_[nMidstate]);
+    ss.write(serializedInputs_.data() + midstateEnd, inputOffsets_[nIn] - midstateEnd);
+    txTmp.SerializeInput(ss, nIn, SER_GETHASH, 0);
+    ss.write(serializedInputs_.data() + inputOffsets_[nIn + 1], serializedInputs_.size() - inputOffsets_[nIn + 1]);
+    ss.write(serializedOutputs_.data(), serializedOutputs_.size());
+    ss << nHashType;
+    return ss.GetHash();
+}
+
+uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* txdata)
 {
     if (nIn >= txTo.vin.size()) {
         //  nIn out of range
@@ -278,6 +344,9 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
         }
     }
 
+    if (txdata != NULL && txdata->IsApplicable(nHashType))
+        return txdata->SignatureHash(scriptCode, txTo, nIn, nHashType);
+
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
@@ -305,7 +374,7 @@ bool TransactionSignatureChecker::CheckSig(const std::vector<unsigned char>& vch
     int nHashType = vchSig.back();
     vchSig.pop_back();
 
-    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType);
+    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, txdata);
 
     if (!VerifySignature(vchSig, pubkey, sighash))
         return false;
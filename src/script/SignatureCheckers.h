@@ -1,8 +1,10 @@
 #ifndef SIGNATURE_CHECKERS_H
 #define SIGNATURE_CHECKERS_H
 
+#include <hash.h>
 #include <script/script_error.h>
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -14,7 +16,37 @@ class CTransaction;
 class uint256;
 class CMutableTransaction;
 
-uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
+/**
+ * The parts of a transaction's signature hash serialization that are the same
+ * for all its inputs, serialized once so that signing or verifying each input
+ * does not serialize the whole transaction over again.
+ *
+ * Only hash types signing all inputs and all outputs are covered; the others
+ * are serialized in full as before. The hashes are the same either way.
+ */
+class PrecomputedTransactionData
+{
+private:
+    //! nVersion, the input count and every input with a blank scriptSig
+    std::vector<char> serializedInputs_;
+    //! Where each input starts in serializedInputs_, and where the last one ends
+    std::vector<size_t> inputOffsets_;
+    //! The hash of serializedInputs_ up to each MIDSTATE_INTERVAL'th input
+    std::vector<CHashWriter> midstates_;
+    //! The output count, the outputs and nLockTime
+    std::vector<char> serializedOutputs_;
+
+public:
+    //! Number of inputs between the hash midstates kept, bounding how much is hashed again before an input
+    static constexpr size_t MIDSTATE_INTERVAL = 32;
+
+    explicit PrecomputedTransactionData(const CTransaction& txTo);
+
+    bool IsApplicable(int nHashType) const;
+    uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType) const;
+};
+
+uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* txdata = NULL);
 
 class BaseSignatureChecker
 {
@@ -39,12 +71,13 @@ class TransactionSignatureChecker : public BaseSignatureChecker
 protected:
     const CTransaction* txTo;
     unsigned int nIn;
+    const PrecomputedTransactionData* txdata;
 
 protected:
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
-    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn) : txTo(txToIn), nIn(nInIn) {}
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const PrecomputedTransactionData* txdataIn = NULL) : txTo(txToIn), nIn(nInIn), txdata(txdataIn) {}
     bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode) const;
     bool CheckCoinstake() const;
 };
@@ -55,6 +88,6 @@ private:
     std::shared_ptr<const CTransaction> txToPtr;
 
 public:
-    MutableTransactionSignatureChecker(const CMutableTransaction* txToIn, unsigned int nInIn);
+    MutableTransactionSignatureChecker(const CMutableTransaction* txToIn, unsigned int nInIn, const PrecomputedTransactionData* txdataIn = NULL);
 };
 #endif //SIGNATURE_CHECKERS_H
\ No newline at end of file
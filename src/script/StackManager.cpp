@@ -8,6 +8,7 @@
 #include <vector>
 #include <script/scriptandsigflags.h>
 #include <algorithm>
+#include <array>
 #include <memory>
 
 #include <script/SignatureCheckers.h>
@@ -630,19 +631,20 @@ struct HashingOp: public StackOperator
         if (stack_.size() < 1)
             return Helpers::set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
         valtype& vch = stackTop();
-        valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+        unsigned char hash[32];
+        const size_t hashSize = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
         if (opcode == OP_RIPEMD160)
-            CRIPEMD160().Write(begin_ptr(vch), vch.size()).Finalize(begin_ptr(vchHash));
+            CRIPEMD160().Write(begin_ptr(vch), vch.size()).Finalize(hash);
         else if (opcode == OP_SHA1)
-            CSHA1().Write(begin_ptr(vch), vch.size()).Finalize(begin_ptr(vchHash));
+            CSHA1().Write(begin_ptr(vch), vch.size()).Finalize(hash);
         else if (opcode == OP_SHA256)
-            CSHA256().Write(begin_ptr(vch), vch.size()).Finalize(begin_ptr(vchHash));
+            CSHA256().Write(begin_ptr(vch), vch.size()).Finalize(hash);
         else if (opcode == OP_HASH160)
-            CHash160().Write(begin_ptr(vch), vch.size()).Finalize(begin_ptr(vchHash));
+            CHash160().Write(begin_ptr(vch), vch.size()).Finalize(hash);
         else if (opcode == OP_HASH256)
-            CHash256().Write(begin_ptr(vch), vch.size()).Finalize(begin_ptr(vchHash));
-        stack_.pop_back();
-        stack_.push_back(vchHash);
+            CHash256().Write(begin_ptr(vch), vch.size()).Finalize(hash);
+        // The hash replaces its input in place, keeping the allocation when it is large enough
+        vch.assign(hash, hash + hashSize);
 
         return true;
     }
@@ -853,6 +855,50 @@ const std::set<opcodetype> hashingOpCodes =
 const std::set<opcodetype> checkSigOpcodes =
     {OP_CHECKSIG, OP_CHECKSIGVERIFY, OP_CHECKMULTISIG, OP_CHECKMULTISIGVERIFY};
 
+enum class OpcodeCategory
+{
+    UNKNOWN,
+    UPGRADABLE,
+    SIMPLE_VALUE,
+    CONDITIONAL,
+    STACK_MODIFICATION,
+    EQUALITY_AND_VERIFICATION,
+    UNARY_NUMERIC,
+    BINARY_NUMERIC,
+    HASHING,
+    SIGNATURE_CHECK,
+};
+typedef std::array<OpcodeCategory, 256> OpcodeCategoryTable;
+
+OpcodeCategoryTable BuildOpcodeCategoryTable()
+{
+    const std::vector<std::pair<const std::set<opcodetype>*, OpcodeCategory> > categories = {
+        {&upgradableOpCodes, OpcodeCategory::UPGRADABLE},
+        {&simpleValueOpCodes, OpcodeCategory::SIMPLE_VALUE},
+        {&conditionalOpCodes, OpcodeCategory::CONDITIONAL},
+        {&stackModificationOpCodes, OpcodeCategory::STACK_MODIFICATION},
+        {&equalityAndVerificationOpCodes, OpcodeCategory::EQUALITY_AND_VERIFICATION},
+        {&unaryNumericOpCodes, OpcodeCategory::UNARY_NUMERIC},
+        {&binaryNumericOpCodes, OpcodeCategory::BINARY_NUMERIC},
+        {&hashingOpCodes, OpcodeCategory::HASHING},
+        {&checkSigOpcodes, OpcodeCategory::SIGNATURE_CHECK}};
+    OpcodeCategoryTable table;
+    table.fill(OpcodeCategory::UNKNOWN);
+    for (const auto& category: categories) {
+        for (opcodetype opcode: *category.first)
+            table[static_cast<unsigned char>(opcode)] = category.second;
+    }
+    return table;
+}
+
+//! The sets above by opcode, so that dispatching an opcode is one lookup rather than a search of each set
+const OpcodeCategoryTable opcodeCategories = BuildOpcodeCategoryTable();
+
+OpcodeCategory GetOpcodeCategory(opcodetype opcode)
+{
+    return opcodeCategories[static_cast<unsigned char>(opcode)];
+}
+
 #define ApplyOperation(opname) \
     opname(stack,altstack,flags,conditionalManager)(opcode,serror)\
 
@@ -877,37 +923,26 @@ const std::set<opcodetype> checkSigOpcodes =
         {
             return ApplyOperation(NumericBoundsOp);
         }
-        if(upgradableOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(DisabledOp);
-        }
-        if(simpleValueOpCodes.count(opcode) > 0)
+        switch(GetOpcodeCategory(opcode))
         {
-            return ApplyOperation(PushValueOp);
-        }
-        if(conditionalOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(ConditionalOp);
-        }
-        if(stackModificationOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(StackModificationOp);
-        }
-        if(equalityAndVerificationOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(EqualityVerificationOp);
-        }
-        if(unaryNumericOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(UnaryNumericOp);
-        }
-        if(binaryNumericOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(BinaryNumericOp);
-        }
-        if(hashingOpCodes.count(opcode) > 0)
-        {
-            return ApplyOperation(HashingOp);
+            case OpcodeCategory::UPGRADABLE:
+                return ApplyOperation(DisabledOp);
+            case OpcodeCategory::SIMPLE_VALUE:
+                return ApplyOperation(PushValueOp);
+            case OpcodeCategory::CONDITIONAL:
+                return ApplyOperation(ConditionalOp);
+            case OpcodeCategory::STACK_MODIFICATION:
+                return ApplyOperation(StackModificationOp);
+            case OpcodeCategory::EQUALITY_AND_VERIFICATION:
+                return ApplyOperation(EqualityVerificationOp);
+            case OpcodeCategory::UNARY_NUMERIC:
+                return ApplyOperation(UnaryNumericOp);
+            case OpcodeCategory::BINARY_NUMERIC:
+                return ApplyOperation(BinaryNumericOp);
+            case OpcodeCategory::HASHING:
+                return ApplyOperation(HashingOp);
+            default:
+            break;
         }
 
         Helpers::set_error(serror,SCRIPT_ERR_BAD_OPCODE);
@@ -924,7 +959,7 @@ const std::set<opcodetype> checkSigOpcodes =
         const CScript& scriptCode,
         ScriptError* serror)
     {
-        if(checkSigOpcodes.count(opcode) > 0)
+        if(GetOpcodeCategory(opcode) == OpcodeCategory::SIGNATURE_CHECK)
         {
             return SignatureCheckOp(stack,altstack,flags,conditionalManager,opCount,checker)(opcode,scriptCode,serror);
         }
@@ -5,13 +5,15 @@
 
 #include "sigcache.h"
 
+#include "CuckooCache.h"
+#include "crypto/sha256.h"
+#include "defaultValues.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util.h"
 
 #include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
 #include "Settings.h"
 extern Settings& settings;
 namespace {
@@ -24,68 +26,85 @@ namespace {
 class CSignatureCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
+    //! Salt for the entries, so that their table slots cannot be aimed at
+    uint256 nonce;
+    CuckooCache<uint256, SaltedHashHasher> setValid;
     boost::shared_mutex cs_sigcache;
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    CSignatureCache()
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        GetRandBytes(nonce.begin(), 32);
+        // Sized by InitSignatureCache, this keeps it usable before then
+        setValid.Setup(0);
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+    //! The cache entry for (signature hash, signature, public key)
+    void ComputeEntry(uint256& entry, const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey) const
+    {
+        CSHA256()
+            .Write(nonce.begin(), 32)
+            .Write(hash.begin(), 32)
+            .Write(pubKey.begin(), pubKey.size())
+            .Write(vchSig.data(), vchSig.size())
+            .Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry, bool erase)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.Contains(entry, erase);
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    void Set(const uint256& entry)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = settings.GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.Insert(entry);
+    }
 
+    uint32_t SetupBytes(size_t bytes)
+    {
         boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.SetupBytes(bytes);
+    }
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
-        {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
-        }
-
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+    size_t DynamicMemoryUsage()
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.DynamicMemoryUsage();
     }
 };
 
+CSignatureCache signatureCache;
+}
+
+void InitSignatureCache()
+{
+    // -maxsigcachesize is shared with the script execution cache, in MiB as the entries take a fixed 32 bytes each
+    const size_t nMaxCacheSize = (std::min(std::max((int64_t)0, settings.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) << 20) / 2;
+    const uint32_t nElements = signatureCache.SetupBytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for signature cache, able to store %u elements\n",
+              (nElements * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElements);
+}
+
+size_t SignatureCacheDynamicMemoryUsage()
+{
+    return signatureCache.DynamicMemoryUsage();
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
 
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    // Signatures checked for a block are not looked up again, so their entries can make room
+    if (signatureCache.Get(entry, !store))
         return true;
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        signatureCache.Set(entry);
     return true;
 }
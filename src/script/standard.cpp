@@ -33,27 +33,34 @@ const char* GetTxnOutputType(txnouttype t)
     return NULL;
 }
 
+namespace
+{
+multimap<txnouttype, CScript> BuildScriptTemplates()
+{
+    multimap<txnouttype, CScript> mTemplates;
+
+    // Standard tx, sender provides pubkey, receiver adds signature
+    mTemplates.insert(std::make_pair(TX_PUBKEY, CScript() << OP_PUBKEY << OP_CHECKSIG));
+
+    // Bitcoin address tx, sender provides hash of pubkey, receiver provides signature and pubkey
+    mTemplates.insert(std::make_pair(TX_PUBKEYHASH, CScript() << OP_DUP << OP_HASH160 << OP_PUBKEYHASH << OP_EQUALVERIFY << OP_CHECKSIG));
+
+    // Sender provides N pubkeys, receivers provides M signatures
+    mTemplates.insert(std::make_pair(TX_MULTISIG, CScript() << OP_SMALLINTEGER << OP_PUBKEYS << OP_SMALLINTEGER << OP_CHECKMULTISIG));
+
+    // Sender provides 2 pubkey hashes, 1-owner & 1-manager, receivers provides exactly 1 of the two signatures
+    mTemplates.insert(std::make_pair(TX_VAULT, GetStakingVaultScriptTemplate() ));
+    return mTemplates;
+}
+}
+
 /**
  * Return public keys or hashes from scriptPubKey, for 'standard' transaction types.
  */
 bool ExtractScriptPubKeyFormat(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
 {
-    // Templates
-    static multimap<txnouttype, CScript> mTemplates;
-    if (mTemplates.empty())
-    {
-        // Standard tx, sender provides pubkey, receiver adds signature
-        mTemplates.insert(std::make_pair(TX_PUBKEY, CScript() << OP_PUBKEY << OP_CHECKSIG));
-
-        // Bitcoin address tx, sender provides hash of pubkey, receiver provides signature and pubkey
-        mTemplates.insert(std::make_pair(TX_PUBKEYHASH, CScript() << OP_DUP << OP_HASH160 << OP_PUBKEYHASH << OP_EQUALVERIFY << OP_CHECKSIG));
-
-        // Sender provides N pubkeys, receivers provides M signatures
-        mTemplates.insert(std::make_pair(TX_MULTISIG, CScript() << OP_SMALLINTEGER << OP_PUBKEYS << OP_SMALLINTEGER << OP_CHECKMULTISIG));
-
-        // Sender provides 2 pubkey hashes, 1-owner & 1-manager, receivers provides exactly 1 of the two signatures
-        mTemplates.insert(std::make_pair(TX_VAULT, GetStakingVaultScriptTemplate() ));
-    }
+    // Templates, built once by the first caller so that threads solving scripts at once do not race on them
+    static const multimap<txnouttype, CScript> mTemplates = BuildScriptTemplates();
 
     // Shortcut for pay-to-script-hash, which are more constrained than the other types:
     // it is always OP_HASH160 20 [20 byte hash] OP_EQUAL
@@ -66,6 +73,21 @@ bool ExtractScriptPubKeyFormat(const CScript& scriptPubKey, txnouttype& typeRet,
     }
 
 
+    // Shortcuts for the commonest outputs in their one canonical encoding, which the
+    // template scan below would match with the same solution
+    if (scriptPubKey.IsPayToPublicKeyHash())
+    {
+        typeRet = TX_PUBKEYHASH;
+        vSolutionsRet.push_back(valtype(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
+        return true;
+    }
+    if (scriptPubKey.IsPayToPublicKey())
+    {
+        typeRet = TX_PUBKEY;
+        vSolutionsRet.push_back(valtype(scriptPubKey.begin()+1, scriptPubKey.end()-1));
+        return true;
+    }
+
     // Provably prunable, data-carrying output
     //
     // So long as script passes the IsUnspendable() test and all but the first
@@ -209,13 +231,10 @@ bool IsStandard(const CScript& scriptPubKey, txnouttype& whichType)
     return IsStandard(scriptPubKey,whichType,MAX_OP_META_RELAY);
 }
 
-bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet)
+namespace
+{
+bool ExtractDestinationFromSolutions(txnouttype whichType, const std::vector<valtype>& vSolutions, CTxDestination& addressRet)
 {
-    std::vector<valtype> vSolutions;
-    txnouttype whichType;
-    if (!ExtractScriptPubKeyFormat(scriptPubKey, whichType, vSolutions))
-        return false;
-
     if (whichType == TX_PUBKEY)
     {
         CPubKey pubKey(vSolutions[0]);
@@ -239,6 +258,28 @@ bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet)
     // Multisig txns have more than one address...
     return false;
 }
+}
+
+bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet)
+{
+    // The hash is read straight from the canonical encodings, without collecting solutions
+    if (scriptPubKey.IsPayToPublicKeyHash())
+    {
+        addressRet = CKeyID(uint160(std::vector<unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23)));
+        return true;
+    }
+    if (scriptPubKey.IsPayToScriptHash())
+    {
+        addressRet = CScriptID(uint160(std::vector<unsigned char>(scriptPubKey.begin()+2, scriptPubKey.begin()+22)));
+        return true;
+    }
+
+    std::vector<valtype> vSolutions;
+    txnouttype whichType;
+    if (!ExtractScriptPubKeyFormat(scriptPubKey, whichType, vSolutions))
+        return false;
+    return ExtractDestinationFromSolutions(whichType, vSolutions, addressRet);
+}
 
 bool ExtractDestinations(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<CTxDestination>& addressRet, int& nRequiredRet)
 {
@@ -284,7 +325,7 @@ bool ExtractDestinations(const CScript& scriptPubKey, txnouttype& typeRet, std::
     {
         nRequiredRet = 1;
         CTxDestination address;
-        if (!ExtractDestination(scriptPubKey, address))
+        if (!ExtractDestinationFromSolutions(typeRet, vSolutions, address))
            return false;
         addressRet.push_back(address);
     }
@@ -9,16 +9,30 @@
 #include <primitives/transaction.h>
 #include <coins.h>
 
-CScriptCheck::CScriptCheck() : ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
+CScriptCheck::CScriptCheck() : ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata() {}
 
-CScriptCheck::CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) : scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey),
-                                                                                                                                ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
+CScriptCheck::CScriptCheck(
+    const CCoins& txFromIn,
+    const CTransaction& txToIn,
+    unsigned int nInIn,
+    unsigned int nFlagsIn,
+    bool cacheIn,
+    std::shared_ptr<const PrecomputedTransactionData> txdataIn
+    ): scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey)
+    , ptxTo(&txToIn)
+    , nIn(nInIn)
+    , nFlags(nFlagsIn)
+    , cacheStore(cacheIn)
+    , error(SCRIPT_ERR_UNKNOWN_ERROR)
+    , txdata(txdataIn)
+{
+}
 
     
 bool CScriptCheck::operator()()
 {
     const CScript& scriptSig = ptxTo->vin[nIn].scriptSig;
-    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore), &error)) {
+    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore, txdata.get()), &error)) {
         return ::error("CScriptCheck(): %s:%d VerifySignature failed: %s", ptxTo->ToStringShort(), nIn, ScriptErrorString(error));
     }
     return true;
@@ -33,6 +47,7 @@ void CScriptCheck::swap(CScriptCheck& check)
     std::swap(nFlags, check.nFlags);
     std::swap(cacheStore, check.cacheStore);
     std::swap(error, check.error);
+    txdata.swap(check.txdata);
 }
 
 ScriptError CScriptCheck::GetScriptError() const{return error;}
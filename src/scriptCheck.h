@@ -9,8 +9,11 @@
 #include <script/script_error.h>
 #include <script/script.h>
 
+#include <memory>
+
 class CTransaction;
 class CCoins;
+class PrecomputedTransactionData;
 
 /**
  * Closure representing one script verification
@@ -25,11 +28,19 @@ private:
     unsigned int nFlags;
     bool cacheStore;
     ScriptError error;
+    //! Shared by the checks of all the inputs of ptxTo
+    std::shared_ptr<const PrecomputedTransactionData> txdata;
 
 public:
     CScriptCheck();
 
-    CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn);
+    CScriptCheck(
+        const CCoins& txFromIn,
+        const CTransaction& txToIn,
+        unsigned int nInIn,
+        unsigned int nFlagsIn,
+        bool cacheIn,
+        std::shared_ptr<const PrecomputedTransactionData> txdataIn = std::shared_ptr<const PrecomputedTransactionData>());
 
 
     bool operator()();
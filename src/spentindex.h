@@ -36,6 +36,9 @@ struct CSpentIndexKey {
         outputIndex = 0;
     }
 
+    bool operator==(const CSpentIndexKey& other) const {
+        return txid == other.txid && outputIndex == other.outputIndex;
+    }
 };
 
 struct CSpentIndexValue {
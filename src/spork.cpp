@@ -26,6 +26,7 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/lexical_cast.hpp>
 #include <ValidationState.h>
+#include <ui_interface.h>
 #include <NodeState.h>
 
 extern bool fLiteMode;
@@ -108,6 +109,7 @@ bool CSporkManager::AddActiveSpork(const CSporkMessage &spork)
         std::sort(std::begin(sporks), std::end(sporks), [](const CSporkMessage &lhs, const CSporkMessage &rhs) {
             return lhs.nTimeSigned < rhs.nTimeSigned;
         });
+        ParseMultiValueSpork(spork.nSporkID);
     }
     else {
         sporks = { spork };
@@ -116,6 +118,25 @@ bool CSporkManager::AddActiveSpork(const CSporkMessage &spork)
     return true;
 }
 
+void CSporkManager::ParseMultiValueSpork(int nSporkID)
+{
+    const std::vector<CSporkMessage> &sporks = mapSporksActive[nSporkID];
+
+    LOCK(cs_parsedSporks_);
+    if(nSporkID == SPORK_13_BLOCK_PAYMENTS) {
+        ConvertMultiValueSporkVector(sporks, blockPaymentSporks_);
+    }
+    else if(nSporkID == SPORK_14_TX_FEE) {
+        ConvertMultiValueSporkVector(sporks, txFeeSporks_);
+    }
+    else if(nSporkID == SPORK_15_BLOCK_VALUE) {
+        ConvertMultiValueSporkVector(sporks, blockSubsiditySporks_);
+    }
+    else if(nSporkID == SPORK_16_LOTTERY_TICKET_MIN_VALUE) {
+        ConvertMultiValueSporkVector(sporks, lotteryTicketMinValueSporks_);
+    }
+}
+
 bool CSporkManager::IsNewerSpork(const CSporkMessage &spork) const
 {
 
@@ -131,6 +152,11 @@ bool CSporkManager::IsNewerSpork(const CSporkMessage &spork) const
 
 CSporkManager::CSporkManager(
     ): pSporkDB_()
+    , cs_parsedSporks_()
+    , blockPaymentSporks_()
+    , txFeeSporks_()
+    , blockSubsiditySporks_()
+    , lotteryTicketMinValueSporks_()
 {
 }
 
@@ -193,7 +219,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
         if(IsNewerSpork(spork)) {
             LogPrintf("%s new\n", strLogMsg);
         } else if(!IsMultiValueSpork(spork.nSporkID)) {
-            LogPrint("spork", "%s seen\n", strLogMsg);
+            LogPrint(LOG_SPORK, "%s seen\n", strLogMsg);
             pfrom->nSporksSynced++;
             return;
         }
@@ -218,6 +244,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             //does a task if needed
             pSporkDB_->WriteSpork(spork.nSporkID, spork);
             ExecuteSpork(spork.nSporkID);
+            uiInterface.NotifySporkChanged(spork.nSporkID, spork.strValue, spork.nTimeSigned);
         }
 
         spork.Relay();
@@ -303,7 +330,7 @@ void CSporkManager::ExecuteSpork(int nSporkID)
             static int64_t nTimeExecuted = 0; // i.e. it was never executed before
 
             if(GetTime() - nTimeExecuted < nTimeout) {
-                LogPrint("spork", "CSporkManager::ExecuteSpork -- ERROR: Trying to reconsider blocks, too soon - %d/%d\n", GetTime() - nTimeExecuted, nTimeout);
+                LogPrint(LOG_SPORK, "CSporkManager::ExecuteSpork -- ERROR: Trying to reconsider blocks, too soon - %d/%d\n", GetTime() - nTimeExecuted, nTimeout);
                 return;
             }
 
@@ -326,9 +353,7 @@ void CSporkManager::ExecuteMultiValueSpork(int nSporkID)
     if(nSporkID == SPORK_14_TX_FEE)
     {
         auto chainTip = chainActive.Tip();
-        MultiValueSporkList<TxFeeSporkValue> vValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager.GetMultiValueSpork(SPORK_14_TX_FEE), vValues);
-        TxFeeSporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vValues, chainTip->nHeight, chainTip->nTime);
+        TxFeeSporkValue activeSpork = GetActiveTxFeeSpork(chainTip->nHeight, chainTip->nTime);
 
         FeeAndPriorityCalculator::instance().setFeeRate(activeSpork.nMinFeePerKb);
         maxTxFee = activeSpork.nMaxFee;
@@ -379,7 +404,8 @@ bool CSporkManager::UpdateSpork(int nSporkID, std::string strValue)
     if(spork.Sign(sporkPrivKey, sporkPubKey)) {
         spork.Relay();
         mapSporks[spork.GetHash()] = spork;
-        AddActiveSpork(spork);
+        if(AddActiveSpork(spork))
+            uiInterface.NotifySporkChanged(spork.nSporkID, spork.strValue, spork.nTimeSigned);
         return true;
     }
 
@@ -410,7 +436,7 @@ bool CSporkManager::IsSporkActive(int nSporkID) const
     } else if (mapSporkDefaults.count(nSporkID)) {
         r = mapSporkDefaults.find(nSporkID)->second;
     } else {
-        LogPrint("spork", "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
+        LogPrint(LOG_SPORK, "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
         r = "4070908800"; // 2099-1-1 i.e. off by default
     }
 
@@ -426,6 +452,30 @@ std::vector<CSporkMessage> CSporkManager::GetMultiValueSpork(int nSporkID) const
     return std::vector<CSporkMessage>();
 }
 
+BlockPaymentSporkValue CSporkManager::GetActiveBlockPaymentSpork(int nHeight, int64_t nBlockTime) const
+{
+    LOCK(cs_parsedSporks_);
+    return GetActiveMultiValueSpork(blockPaymentSporks_, nHeight, nBlockTime);
+}
+
+TxFeeSporkValue CSporkManager::GetActiveTxFeeSpork(int nHeight, int64_t nBlockTime) const
+{
+    LOCK(cs_parsedSporks_);
+    return GetActiveMultiValueSpork(txFeeSporks_, nHeight, nBlockTime);
+}
+
+BlockSubsiditySporkValue CSporkManager::GetActiveBlockSubsiditySpork(int nHeight, int64_t nBlockTime) const
+{
+    LOCK(cs_parsedSporks_);
+    return GetActiveMultiValueSpork(blockSubsiditySporks_, nHeight, nBlockTime);
+}
+
+LotteryTicketMinValueSporkValue CSporkManager::GetActiveLotteryTicketMinValueSpork(int nHeight, int64_t nBlockTime) const
+{
+    LOCK(cs_parsedSporks_);
+    return GetActiveMultiValueSpork(lotteryTicketMinValueSporks_, nHeight, nBlockTime);
+}
+
 // grab the value of the spork on the network, or the default
 std::string CSporkManager::GetSporkValue(int nSporkID) const
 {
@@ -442,7 +492,7 @@ std::string CSporkManager::GetSporkValue(int nSporkID) const
         return mapSporkDefaults[nSporkID];
     }
 
-    LogPrint("spork", "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
+    LogPrint(LOG_SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
     return std::string();
 }
 
@@ -460,7 +510,7 @@ int CSporkManager::GetSporkIDByName(const std::string& strName)
     if (strName == "SPORK_15_BLOCK_VALUE")                      return SPORK_15_BLOCK_VALUE;
     if (strName == "SPORK_16_LOTTERY_TICKET_MIN_VALUE")         return SPORK_16_LOTTERY_TICKET_MIN_VALUE;
 
-    LogPrint("spork", "CSporkManager::GetSporkIDByName -- Unknown Spork name '%s'\n", strName);
+    LogPrint(LOG_SPORK, "CSporkManager::GetSporkIDByName -- Unknown Spork name '%s'\n", strName);
     return -1;
 }
 
@@ -479,7 +529,7 @@ std::string CSporkManager::GetSporkNameByID(int nSporkID)
     case SPORK_15_BLOCK_VALUE:                      return "SPORK_15_BLOCK_VALUE";
     case SPORK_16_LOTTERY_TICKET_MIN_VALUE:         return "SPORK_16_LOTTERY_TICKET_MIN_VALUE";
     default:
-        LogPrint("spork", "CSporkManager::GetSporkNameByID -- Unknown Spork ID %d\n", nSporkID);
+        LogPrint(LOG_SPORK, "CSporkManager::GetSporkNameByID -- Unknown Spork ID %d\n", nSporkID);
         return "Unknown";
     }
 }
@@ -8,8 +8,11 @@
 
 #include "key.h"
 #include "pubkey.h"
+#include "sync.h"
+#include <streams.h>
+
+#include <algorithm>
 
-class CDataStream;
 class CNode;
 
 class CSporkMessage;
@@ -170,8 +173,16 @@ private:
     CPubKey sporkPubKey;
     CKey sporkPrivKey;
 
+    // The multi value sporks parsed when they are received, in the order they were signed
+    mutable CCriticalSection cs_parsedSporks_;
+    MultiValueSporkList<BlockPaymentSporkValue> blockPaymentSporks_;
+    MultiValueSporkList<TxFeeSporkValue> txFeeSporks_;
+    MultiValueSporkList<BlockSubsiditySporkValue> blockSubsiditySporks_;
+    MultiValueSporkList<LotteryTicketMinValueSporkValue> lotteryTicketMinValueSporks_;
+
 private:
     bool AddActiveSpork(const CSporkMessage &spork);
+    void ParseMultiValueSpork(int nSporkID);
     bool IsNewerSpork(const CSporkMessage &spork) const;
     void ExecuteSpork(int nSporkID);
     void ExecuteMultiValueSpork(int nSporkID);
@@ -202,20 +213,37 @@ public:
         vResult.swap(result);
     }
 
+    template <class T>
+    static bool IsSignedBefore(const std::pair<T, int64_t> &sporkEntry, int64_t nTime)
+    {
+        return sporkEntry.second < nTime;
+    }
+
+    /**
+     * The last spork signed before the block time that is activated at the
+     * height, out of sporks sorted by the time they were signed. Those signed
+     * in time are found by bisection, so only the ones not activated yet at
+     * the height are walked over.
+     */
     template <class T>
     static T GetActiveMultiValueSpork(const MultiValueSporkList<T> &vSporks, int nHeight, int64_t nBlockTime)
     {
-        int nIndex = -1;
-        for(size_t i = 0; i < vSporks.size(); ++i) {
-            auto sporkEntry = vSporks.at(i);
-            if(nHeight >= sporkEntry.first.nActivationBlockHeight && sporkEntry.second < nBlockTime) {
-                nIndex = static_cast<int>(i);
+        auto it = std::lower_bound(std::begin(vSporks), std::end(vSporks), nBlockTime, &IsSignedBefore<T>);
+        while(it != std::begin(vSporks)) {
+            --it;
+            if(nHeight >= it->first.nActivationBlockHeight) {
+                return it->first;
             }
         }
 
-        return nIndex >= 0 ? vSporks.at(nIndex).first : T();
+        return T();
     }
 
+    BlockPaymentSporkValue GetActiveBlockPaymentSpork(int nHeight, int64_t nBlockTime) const;
+    TxFeeSporkValue GetActiveTxFeeSpork(int nHeight, int64_t nBlockTime) const;
+    BlockSubsiditySporkValue GetActiveBlockSubsiditySpork(int nHeight, int64_t nBlockTime) const;
+    LotteryTicketMinValueSporkValue GetActiveLotteryTicketMinValueSpork(int nHeight, int64_t nBlockTime) const;
+
     std::string GetSporkValue(int nSporkID) const;
     int GetSporkIDByName(const std::string& strName);
     std::string GetSporkNameByID(int nSporkID);
@@ -187,12 +187,12 @@ bool IsIXTXValid(const CTransaction& txCollateral)
     //}
 
     //if (nValueOut > GetSporkValue(SPORK_5_MAX_VALUE) * COIN) {
-    //    LogPrint("swiftx", "IsIXTXValid - Transaction value too high - %s\n", txCollateral);
+    //    LogPrint(LOG_SWIFTX, "IsIXTXValid - Transaction value too high - %s\n", txCollateral);
     //    return false;
     //}
 
     //if (missingTx) {
-    //    LogPrint("swiftx", "IsIXTXValid - Unknown inputs in IX transaction - %s\n", txCollateral);
+    //    LogPrint(LOG_SWIFTX, "IsIXTXValid - Unknown inputs in IX transaction - %s\n", txCollateral);
     //    /*
     //        This happens sometimes for an unknown reason, so we'll return that it's a valid transaction.
     //        If someone submits an invalid transaction it will be rejected by the network anyway and this isn't
@@ -202,7 +202,7 @@ bool IsIXTXValid(const CTransaction& txCollateral)
     //}
 
     //if (nValueIn - nValueOut < COIN * 0.01) {
-    //    LogPrint("swiftx", "IsIXTXValid - did not include enough fees in transaction %d\n%s\n", nValueOut - nValueIn, txCollateral);
+    //    LogPrint(LOG_SWIFTX, "IsIXTXValid - did not include enough fees in transaction %d\n%s\n", nValueOut - nValueIn, txCollateral);
     //    return false;
     //}
 
@@ -239,7 +239,7 @@ int64_t CreateNewLock(CTransaction tx)
     //    mapTxLocks.insert(make_pair(tx.GetHash(), newLock));
     //} else {
     //    mapTxLocks[tx.GetHash()].nBlockHeight = nBlockHeight;
-    //    LogPrint("swiftx", "CreateNewLock - Transaction Lock Exists %s !\n", tx.GetHash());
+    //    LogPrint(LOG_SWIFTX, "CreateNewLock - Transaction Lock Exists %s !\n", tx.GetHash());
     //}
 
 
@@ -255,19 +255,19 @@ void DoConsensusVote(CTransaction& tx, int64_t nBlockHeight)
     //int n = mnodeman.GetMasternodeRank(activeMasternode.vin, nBlockHeight, MIN_SWIFTTX_PROTO_VERSION);
 
     //if (n == -1) {
-    //    LogPrint("swiftx", "SwiftX::DoConsensusVote - Unknown Masternode\n");
+    //    LogPrint(LOG_SWIFTX, "SwiftX::DoConsensusVote - Unknown Masternode\n");
     //    return;
     //}
 
     //if (n > SWIFTTX_SIGNATURES_TOTAL) {
-    //    LogPrint("swiftx", "SwiftX::DoConsensusVote - Masternode not in the top %d (%d)\n", SWIFTTX_SIGNATURES_TOTAL, n);
+    //    LogPrint(LOG_SWIFTX, "SwiftX::DoConsensusVote - Masternode not in the top %d (%d)\n", SWIFTTX_SIGNATURES_TOTAL, n);
     //    return;
     //}
     ///*
     //    nBlockHeight calculated from the transaction is the authoritive source
     //*/
 
-    //LogPrint("swiftx", "SwiftX::DoConsensusVote - In the top %d (%d)\n", SWIFTTX_SIGNATURES_TOTAL, n);
+    //LogPrint(LOG_SWIFTX, "SwiftX::DoConsensusVote - In the top %d (%d)\n", SWIFTTX_SIGNATURES_TOTAL, n);
 
     //CConsensusVote ctx;
     //ctx.vinMasternode = activeMasternode.vin;
@@ -295,17 +295,17 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
 //
 //    CMasternode* pmn = mnodeman.Find(ctx.vinMasternode);
 //    if (pmn != NULL)
-//        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Masternode ADDR %s %d\n", pmn->addr, n);
+//        LogPrint(LOG_SWIFTX, "SwiftX::ProcessConsensusVote - Masternode ADDR %s %d\n", pmn->addr, n);
 //
 //    if (n == -1) {
 //        //can be caused by past versions trying to vote with an invalid protocol
-//        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Unknown Masternode\n");
+//        LogPrint(LOG_SWIFTX, "SwiftX::ProcessConsensusVote - Unknown Masternode\n");
 //        mnodeman.AskForMN(pnode, ctx.vinMasternode);
 //        return false;
 //    }
 //
 //    if (n > SWIFTTX_SIGNATURES_TOTAL) {
-//        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Masternode not in the top %d (%d) - %s\n", SWIFTTX_SIGNATURES_TOTAL, n, ctx.GetHash());
+//        LogPrint(LOG_SWIFTX, "SwiftX::ProcessConsensusVote - Masternode not in the top %d (%d) - %s\n", SWIFTTX_SIGNATURES_TOTAL, n, ctx.GetHash());
 //        return false;
 //    }
 //
@@ -326,7 +326,7 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
 //        newLock.txHash = ctx.txHash;
 //        mapTxLocks.insert(make_pair(ctx.txHash, newLock));
 //    } else
-//        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Exists %s !\n", ctx.txHash);
+//        LogPrint(LOG_SWIFTX, "SwiftX::ProcessConsensusVote - Transaction Lock Exists %s !\n", ctx.txHash);
 //
 //    //compile consessus vote
 //    std::map<uint256, CTransactionLock>::iterator i = mapTxLocks.find(ctx.txHash);
@@ -341,10 +341,10 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
 //        }
 //#endif
 //
-//        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Votes %d - %s !\n", (*i).second.CountSignatures(), ctx.GetHash());
+//        LogPrint(LOG_SWIFTX, "SwiftX::ProcessConsensusVote - Transaction Lock Votes %d - %s !\n", (*i).second.CountSignatures(), ctx.GetHash());
 //
 //        if ((*i).second.CountSignatures() >= SWIFTTX_SIGNATURES_REQUIRED) {
-//            LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Is Complete %s !\n", (*i).second.GetHash());
+//            LogPrint(LOG_SWIFTX, "SwiftX::ProcessConsensusVote - Transaction Lock Is Complete %s !\n", (*i).second.GetHash());
 //
 //            CTransaction& tx = mapTxLockReq[ctx.txHash];
 //            if (!CheckForConflictingLocks(tx)) {
@@ -7,6 +7,7 @@
 #define SWIFTTX_H
 
 #include <primitives/transaction.h>
+#include <streams.h>
 #include <string>
 /*
     At 15 signatures, 1/2 of the masternode network can be owned by
@@ -20,7 +21,6 @@
 #define SWIFTTX_SIGNATURES_REQUIRED 6
 #define SWIFTTX_SIGNATURES_TOTAL 10
 
-class CDataStream;
 class CNode;
 class CConsensusVote;
 class CTransaction;
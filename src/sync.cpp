@@ -109,7 +109,7 @@ static void push_lock(void* c, const CLockLocation& locklocation, bool fTry)
     if (lockstack.get() == NULL)
         lockstack.reset(new LockStack);
 
-    LogPrint("lock", "Locking: %s\n", locklocation);
+    LogPrint(LOG_LOCK, "Locking: %s\n", locklocation);
     dd_mutex.lock();
 
     (*lockstack).push_back(std::make_pair(c, locklocation));
@@ -138,7 +138,7 @@ static void pop_lock()
 {
     if (fDebug) {
         const CLockLocation& locklocation = (*lockstack).rbegin()->second;
-        LogPrint("lock", "Unlocked: %s\n", locklocation);
+        LogPrint(LOG_LOCK, "Unlocked: %s\n", locklocation);
     }
     dd_mutex.lock();
     (*lockstack).pop_back();
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SYNC_H
 #define BITCOIN_SYNC_H
 
+#include "LockProfiler.h"
 #include "threadsafety.h"
 
 #include <boost/thread/condition_variable.hpp>
@@ -110,10 +111,28 @@ class CMutexLock
 {
 private:
     boost::unique_lock<Mutex> lock;
+    LockProfileSample sample;
+
+    void EnterSampled(const char* pszName, const char* pszFile, int nLine)
+    {
+        const int64_t nRequestedMicros = LockProfiler::NowMicros();
+        const bool fContended = !lock.try_lock();
+        if (fContended) {
+#ifdef DEBUG_LOCKCONTENTION
+            PrintLockContention(pszName, pszFile, nLine);
+#endif
+            lock.lock();
+        }
+        LockProfiler::Acquired(sample, pszName, pszFile, nLine, nRequestedMicros, fContended);
+    }
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        if (LockProfiler::ShouldSample()) {
+            EnterSampled(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -127,14 +146,18 @@ private:
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()), true);
+        const bool fSampled = LockProfiler::ShouldSample();
+        const int64_t nRequestedMicros = fSampled ? LockProfiler::NowMicros() : 0;
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (fSampled)
+            LockProfiler::Acquired(sample, pszName, pszFile, nLine, nRequestedMicros, false);
         return lock.owns_lock();
     }
 
 public:
-    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) : lock(mutexIn, boost::defer_lock)
+    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) : lock(mutexIn, boost::defer_lock), sample()
     {
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
@@ -144,6 +167,8 @@ public:
 
     ~CMutexLock()
     {
+        if (sample.IsActive())
+            LockProfiler::Released(sample);
         if (lock.owns_lock())
             LeaveCritical();
     }
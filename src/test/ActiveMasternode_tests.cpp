@@ -1,5 +1,6 @@
 #include <activemasternode.h>
 #include <masternodeconfig.h>
+#include <MasternodePing.h>
 #include <test_only.h>
 #include <memory>
 #include <cstring>
@@ -98,4 +99,14 @@ BOOST_AUTO_TEST_CASE(willSetMatchingPubkeyForPrivateKey)
     BOOST_CHECK(activeMasternode_->pubKeyMasternode == expectedPubkey);
 }
 
+BOOST_AUTO_TEST_CASE(willSignPingsWithTheSameMessageFromTheKeptVinMessage)
+{
+    CMasternodePing ping;
+    ping.vin = CTxIn(GetRandHash(), 1u);
+    ping.blockHash = GetRandHash();
+    ping.sigTime = 1600000000;
+    const std::string vinMessage = ping.vin.ToString();
+    BOOST_CHECK_EQUAL(ping.getMessageToSign(vinMessage), ping.getMessageToSign());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <IndexDatabaseUpdateCollector.h>
+
+#include <addressindex.h>
+#include <amount.h>
+#include <coins.h>
+#include <hash.h>
+#include <IndexDatabaseUpdates.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <txdb.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+extern bool fAddressIndex;
+
+namespace
+{
+const unsigned int keyIdType = 1;
+
+CKeyID KeyId(char tag)
+{
+    return CKeyID(Hash160(std::vector<unsigned char>(1, tag)));
+}
+
+CScript PayTo(const CKeyID& keyId)
+{
+    return GetScriptForDestination(keyId);
+}
+
+CTransaction CoinbasePaying(const std::vector<std::pair<CKeyID, CAmount> >& payments)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    for (unsigned int i = 0; i < payments.size(); i++)
+        coinbase.vout.push_back(CTxOut(payments[i].second, PayTo(payments[i].first)));
+    return CTransaction(coinbase);
+}
+
+class AddressIndexEnabled
+{
+public:
+    AddressIndexEnabled() { fAddressIndex = true; }
+    ~AddressIndexEnabled() { fAddressIndex = false; }
+};
+
+std::vector<std::pair<CAddressIndexKey, CAmount> > Entries(const CKeyID& keyId, int height, int nTransactions)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    for (int i = 0; i < nTransactions; i++) {
+        const uint256 txhash = Hash(BEGIN(height), END(height), BEGIN(i), END(i));
+        entries.push_back(std::make_pair(CAddressIndexKey(keyIdType, keyId, height, i, txhash, 0, false), 100));
+        entries.push_back(std::make_pair(CAddressIndexKey(keyIdType, keyId, height, i, txhash, 1, false), 20));
+        entries.push_back(std::make_pair(CAddressIndexKey(keyIdType, keyId, height, i, txhash, 0, true), -30));
+    }
+    return entries;
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(AddressBalance_tests, AddressIndexEnabled)
+
+BOOST_AUTO_TEST_CASE(willCountEachTransactionOncePerAddress)
+{
+    std::vector<std::pair<CKeyID, CAmount> > payments;
+    payments.push_back(std::make_pair(KeyId('a'), 50));
+    payments.push_back(std::make_pair(KeyId('b'), 7));
+    payments.push_back(std::make_pair(KeyId('a'), 25));
+    const CTransaction tx = CoinbasePaying(payments);
+    CCoinsView dummy;
+    CCoinsViewCache view(&dummy);
+
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordTransaction(tx, TransactionLocationReference(tx.GetHash(), 1, 0), view, updates);
+
+    BOOST_REQUIRE_EQUAL(updates.addressBalanceDeltas.size(), 2u);
+    const CAddressBalance& a = updates.addressBalanceDeltas[CAddressIndexIteratorKey(keyIdType, KeyId('a'))];
+    BOOST_CHECK_EQUAL(a.balance, 75);
+    BOOST_CHECK_EQUAL(a.received, 75);
+    BOOST_CHECK_EQUAL(a.txCount, 1);
+    const CAddressBalance& b = updates.addressBalanceDeltas[CAddressIndexIteratorKey(keyIdType, KeyId('b'))];
+    BOOST_CHECK_EQUAL(b.balance, 7);
+    BOOST_CHECK_EQUAL(b.txCount, 1);
+}
+
+BOOST_AUTO_TEST_CASE(willTakeBackTheDeltasOfReversedTransactions)
+{
+    std::vector<std::pair<CKeyID, CAmount> > payments;
+    payments.push_back(std::make_pair(KeyId('a'), 50));
+    const CTransaction tx = CoinbasePaying(payments);
+    CCoinsView dummy;
+    CCoinsViewCache view(&dummy);
+    const TransactionLocationReference location(tx.GetHash(), 1, 0);
+
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordTransaction(tx, location, view, updates);
+    IndexDatabaseUpdateCollector::ReverseTransaction(tx, location, view, updates);
+
+    BOOST_REQUIRE_EQUAL(updates.addressBalanceDeltas.size(), 1u);
+    BOOST_CHECK(updates.addressBalanceDeltas.begin()->second.IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(willKeepBalancesUpToDateAndDropEmptyOnes)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+    CAddressBalanceDeltas deltas;
+    CAddressBalance& delta = deltas[CAddressIndexIteratorKey(keyIdType, KeyId('a'))];
+    delta.AddEntry(100, 1);
+    delta.AddEntry(-40, 1);
+    delta.txCount = 2;
+
+    BOOST_REQUIRE(db.UpdateAddressBalances(deltas));
+    BOOST_REQUIRE(db.UpdateAddressBalances(deltas));
+    CAddressBalance balance;
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId('a'), keyIdType, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 120);
+    BOOST_CHECK_EQUAL(balance.received, 200);
+    BOOST_CHECK_EQUAL(balance.txCount, 4);
+
+    delta.balance = -120;
+    delta.received = -200;
+    delta.txCount = -4;
+    BOOST_REQUIRE(db.UpdateAddressBalances(deltas));
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId('a'), keyIdType, balance));
+    BOOST_CHECK(balance.IsNull());
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId('b'), keyIdType, balance));
+    BOOST_CHECK(balance.IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(willBuildBalancesFromAnExistingAddressIndex)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+    BOOST_REQUIRE(db.WriteAddressIndex(Entries(KeyId('a'), 1, 3)));
+    BOOST_REQUIRE(db.WriteAddressIndex(Entries(KeyId('a'), 2, 1)));
+    BOOST_REQUIRE(db.WriteAddressIndex(Entries(KeyId('b'), 1, 2)));
+    bool fHaveBalances = false;
+    BOOST_CHECK(!db.ReadFlag("addressbalances", fHaveBalances) || !fHaveBalances);
+
+    BOOST_REQUIRE(db.BuildAddressBalances());
+
+    BOOST_CHECK(db.ReadFlag("addressbalances", fHaveBalances) && fHaveBalances);
+    CAddressBalance balance;
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId('a'), keyIdType, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 4 * 90);
+    BOOST_CHECK_EQUAL(balance.received, 4 * 120);
+    BOOST_CHECK_EQUAL(balance.txCount, 4);
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId('b'), keyIdType, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 2 * 90);
+    BOOST_CHECK_EQUAL(balance.txCount, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
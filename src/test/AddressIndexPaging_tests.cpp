@@ -0,0 +1,295 @@
+#include <txdb.h>
+
+#include <addressindex.h>
+#include <amount.h>
+#include <hash.h>
+#include <script/script.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+typedef std::vector<std::pair<CAddressIndexKey, CAmount> > AddressIndexEntries;
+
+const unsigned int keyIdType = 1;
+const unsigned int scriptIdType = 2;
+const unsigned int noLimit = std::numeric_limits<unsigned int>::max();
+
+uint160 AddressHash(char tag)
+{
+    return Hash160(std::vector<unsigned char>(1, tag));
+}
+
+uint256 TxHash(int height, unsigned int txindex)
+{
+    return Hash(BEGIN(height), END(height), BEGIN(txindex), END(txindex));
+}
+
+/** One transaction per height from 1 to nHeights, each paying to and spending from the address */
+AddressIndexEntries Transactions(unsigned int type, const uint160& addressHash, int nHeights)
+{
+    AddressIndexEntries entries;
+    for (int height = 1; height <= nHeights; height++) {
+        const uint256 txhash = TxHash(height, type);
+        entries.push_back(std::make_pair(CAddressIndexKey(type, addressHash, height, 1, txhash, 0, false), 10 * height));
+        entries.push_back(std::make_pair(CAddressIndexKey(type, addressHash, height, 1, txhash, 1, true), -height));
+    }
+    return entries;
+}
+
+class AddressIndexFixture
+{
+public:
+    CBlockTreeDB db;
+    const uint160 address;
+
+    AddressIndexFixture()
+        : db(1 << 20, true, true)
+        , address(AddressHash('a'))
+    {
+        BOOST_REQUIRE(db.WriteAddressIndex(Transactions(keyIdType, address, 5)));
+        BOOST_REQUIRE(db.WriteAddressIndex(Transactions(scriptIdType, address, 3)));
+        BOOST_REQUIRE(db.WriteAddressIndex(Transactions(keyIdType, AddressHash('b'), 3)));
+    }
+
+    AddressIndexEntries ReadPage(int start, int end, bool fNewestFirst, unsigned int nMaxTransactions,
+                                 const CAddressIndexKey* pkeyAfter, bool& fMore)
+    {
+        AddressIndexEntries entries;
+        BOOST_REQUIRE(db.ReadAddressIndexPage(address, keyIdType, start, end, fNewestFirst, nMaxTransactions, pkeyAfter, entries, fMore));
+        return entries;
+    }
+};
+
+std::vector<int> Heights(const AddressIndexEntries& entries)
+{
+    std::vector<int> heights;
+    for (AddressIndexEntries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        heights.push_back(it->first.blockHeight);
+    return heights;
+}
+
+std::vector<int> ExpectedHeights(int first, int last)
+{
+    std::vector<int> heights;
+    for (int height = first; ; height += (first <= last ? 1 : -1)) {
+        // Two entries per transaction
+        heights.push_back(height);
+        heights.push_back(height);
+        if (height == last)
+            break;
+    }
+    return heights;
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(AddressIndexPaging_tests, AddressIndexFixture)
+
+BOOST_AUTO_TEST_CASE(willReadTheSameEntriesAsTheUnpagedIndexWithoutALimit)
+{
+    AddressIndexEntries unpaged;
+    BOOST_REQUIRE(db.ReadAddressIndex(address, keyIdType, unpaged));
+    bool fMore = true;
+    AddressIndexEntries paged = ReadPage(0, 0, false, noLimit, NULL, fMore);
+
+    BOOST_CHECK(!fMore);
+    BOOST_REQUIRE_EQUAL(paged.size(), unpaged.size());
+    for (unsigned int i = 0; i < paged.size(); i++) {
+        BOOST_CHECK(paged[i].first.txhash == unpaged[i].first.txhash);
+        BOOST_CHECK_EQUAL(paged[i].first.index, unpaged[i].first.index);
+        BOOST_CHECK_EQUAL(paged[i].second, unpaged[i].second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willPageThroughWholeTransactionsOldestFirst)
+{
+    bool fMore = false;
+    AddressIndexEntries page = ReadPage(0, 0, false, 2, NULL, fMore);
+    BOOST_CHECK(fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(1, 2));
+
+    page = ReadPage(0, 0, false, 2, &page.back().first, fMore);
+    BOOST_CHECK(fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(3, 4));
+
+    page = ReadPage(0, 0, false, 2, &page.back().first, fMore);
+    BOOST_CHECK(!fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(5, 5));
+}
+
+BOOST_AUTO_TEST_CASE(willPageThroughWholeTransactionsNewestFirst)
+{
+    bool fMore = false;
+    AddressIndexEntries page = ReadPage(0, 0, true, 3, NULL, fMore);
+    BOOST_CHECK(fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(5, 3));
+    BOOST_CHECK(page[0].first.spending);
+
+    page = ReadPage(0, 0, true, 3, &page.back().first, fMore);
+    BOOST_CHECK(!fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(2, 1));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepPagesWithinTheHeightRange)
+{
+    bool fMore = true;
+    BOOST_CHECK(Heights(ReadPage(2, 4, true, noLimit, NULL, fMore)) == ExpectedHeights(4, 2));
+    BOOST_CHECK(!fMore);
+    BOOST_CHECK(Heights(ReadPage(2, 3, false, noLimit, NULL, fMore)) == ExpectedHeights(2, 3));
+    BOOST_CHECK(!fMore);
+
+    AddressIndexEntries page = ReadPage(3, 0, true, 2, NULL, fMore);
+    BOOST_CHECK(fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(5, 4));
+    page = ReadPage(3, 0, true, 2, &page.back().first, fMore);
+    BOOST_CHECK(!fMore);
+    BOOST_CHECK(Heights(page) == ExpectedHeights(3, 3));
+}
+
+BOOST_AUTO_TEST_CASE(willNotReadEntriesOfOtherAddresses)
+{
+    bool fMore = true;
+    AddressIndexEntries entries;
+    BOOST_REQUIRE(db.ReadAddressIndexPage(AddressHash('c'), keyIdType, 0, 0, true, noLimit, NULL, entries, fMore));
+    BOOST_CHECK(entries.empty());
+    BOOST_CHECK(!fMore);
+
+    BOOST_REQUIRE(db.ReadAddressIndexPage(address, scriptIdType, 0, 0, true, noLimit, NULL, entries, fMore));
+    BOOST_CHECK(Heights(entries) == ExpectedHeights(3, 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+namespace
+{
+typedef std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > AddressUnspentEntries;
+
+/** Outputs at heights 1 to nOutputs of 10 satoshis times the height, of one transaction per height */
+AddressUnspentEntries UnspentOutputs(unsigned int type, const uint160& addressHash, int nOutputs)
+{
+    AddressUnspentEntries entries;
+    for (int height = 1; height <= nOutputs; height++)
+        entries.push_back(std::make_pair(CAddressUnspentKey(type, addressHash, TxHash(height, type), 0),
+                                         CAddressUnspentValue(10 * height, CScript(), height)));
+    return entries;
+}
+
+class AddressUnspentFixture
+{
+public:
+    CBlockTreeDB db;
+    const uint160 address;
+
+    AddressUnspentFixture()
+        : db(1 << 20, true, true)
+        , address(AddressHash('a'))
+    {
+        BOOST_REQUIRE(db.UpdateAddressUnspentIndex(UnspentOutputs(keyIdType, address, 6)));
+        BOOST_REQUIRE(db.UpdateAddressUnspentIndex(UnspentOutputs(scriptIdType, address, 3)));
+        BOOST_REQUIRE(db.UpdateAddressUnspentIndex(UnspentOutputs(keyIdType, AddressHash('b'), 3)));
+    }
+
+    AddressUnspentEntries ReadPage(int nMinHeight, CAmount nMinAmount, unsigned int nMaxOutputs,
+                                   const CAddressUnspentKey* pkeyAfter, bool& fMore)
+    {
+        AddressUnspentEntries entries;
+        BOOST_REQUIRE(db.ReadAddressUnspentIndexPage(address, keyIdType, nMinHeight, nMinAmount, nMaxOutputs, pkeyAfter, entries, fMore));
+        return entries;
+    }
+};
+
+std::vector<uint256> Txids(const AddressUnspentEntries& entries)
+{
+    std::vector<uint256> txids;
+    for (AddressUnspentEntries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        txids.push_back(it->first.txhash);
+    return txids;
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(AddressUnspentPaging_tests, AddressUnspentFixture)
+
+BOOST_AUTO_TEST_CASE(willReadTheSameOutputsAsTheUnpagedIndexWithoutALimit)
+{
+    AddressUnspentEntries unpaged;
+    BOOST_REQUIRE(db.ReadAddressUnspentIndex(address, keyIdType, unpaged));
+    bool fMore = true;
+    const AddressUnspentEntries paged = ReadPage(0, 0, noLimit, NULL, fMore);
+
+    // The unpaged read goes on into the outputs of the same hash under the next address type
+    AddressUnspentEntries unpagedOfType;
+    for (AddressUnspentEntries::const_iterator it = unpaged.begin(); it != unpaged.end(); ++it) {
+        if (it->first.type == keyIdType)
+            unpagedOfType.push_back(*it);
+    }
+    BOOST_CHECK(!fMore);
+    BOOST_CHECK_EQUAL(paged.size(), 6u);
+    BOOST_CHECK(Txids(paged) == Txids(unpagedOfType));
+}
+
+BOOST_AUTO_TEST_CASE(willPageThroughOutputsInIndexOrder)
+{
+    bool fMore = true;
+    const AddressUnspentEntries all = ReadPage(0, 0, noLimit, NULL, fMore);
+
+    AddressUnspentEntries paged;
+    const CAddressUnspentKey* pkeyAfter = NULL;
+    AddressUnspentEntries page;
+    do {
+        page = ReadPage(0, 0, 4, pkeyAfter, fMore);
+        BOOST_CHECK(page.size() <= 4);
+        paged.insert(paged.end(), page.begin(), page.end());
+        pkeyAfter = &paged.back().first;
+    } while (fMore);
+
+    BOOST_CHECK_EQUAL(paged.size(), 6u);
+    BOOST_CHECK(Txids(paged) == Txids(all));
+}
+
+BOOST_AUTO_TEST_CASE(willSkipOutputsBelowTheMinimumHeightAndAmount)
+{
+    bool fMore = true;
+    AddressUnspentEntries outputs = ReadPage(3, 0, noLimit, NULL, fMore);
+    BOOST_CHECK_EQUAL(outputs.size(), 4u);
+    for (AddressUnspentEntries::const_iterator it = outputs.begin(); it != outputs.end(); ++it)
+        BOOST_CHECK(it->second.blockHeight >= 3);
+
+    outputs = ReadPage(3, 50, noLimit, NULL, fMore);
+    BOOST_CHECK_EQUAL(outputs.size(), 2u);
+    for (AddressUnspentEntries::const_iterator it = outputs.begin(); it != outputs.end(); ++it)
+        BOOST_CHECK(it->second.satoshis >= 50);
+    BOOST_CHECK(!fMore);
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyReportMoreOutputsWhenOnePassesTheFilters)
+{
+    bool fMore = false;
+    const AddressUnspentEntries all = ReadPage(0, 50, noLimit, NULL, fMore);
+    BOOST_REQUIRE_EQUAL(all.size(), 2u);
+
+    AddressUnspentEntries page = ReadPage(0, 50, 1, NULL, fMore);
+    BOOST_CHECK(fMore);
+    page = ReadPage(0, 50, 1, &page.back().first, fMore);
+    BOOST_CHECK_EQUAL(page.size(), 1u);
+    BOOST_CHECK(!fMore);
+}
+
+BOOST_AUTO_TEST_CASE(willNotReadOutputsOfOtherAddressesOrTypes)
+{
+    bool fMore = true;
+    AddressUnspentEntries outputs;
+    BOOST_REQUIRE(db.ReadAddressUnspentIndexPage(AddressHash('c'), keyIdType, 0, 0, noLimit, NULL, outputs, fMore));
+    BOOST_CHECK(outputs.empty());
+    BOOST_CHECK(!fMore);
+
+    BOOST_REQUIRE(db.ReadAddressUnspentIndexPage(address, scriptIdType, 0, 0, noLimit, NULL, outputs, fMore));
+    BOOST_CHECK_EQUAL(outputs.size(), 3u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
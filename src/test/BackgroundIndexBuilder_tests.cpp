@@ -0,0 +1,216 @@
+#include <BackgroundIndexBuilder.h>
+
+#include <addressindex.h>
+#include <BlockUndo.h>
+#include <chain.h>
+#include <hash.h>
+#include <I_BlockDataReader.h>
+#include <primitives/block.h>
+#include <script/standard.h>
+#include <spentindex.h>
+#include <txdb.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class InMemoryBlockDataReader : public I_BlockDataReader
+{
+public:
+    std::map<const CBlockIndex*, std::pair<CBlock, CBlockUndo> > blocks;
+
+    bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+    {
+        std::map<const CBlockIndex*, std::pair<CBlock, CBlockUndo> >::const_iterator it = blocks.find(blockIndex);
+        if (it == blocks.end())
+            return false;
+        block = it->second.first;
+        return true;
+    }
+
+    bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const
+    {
+        std::map<const CBlockIndex*, std::pair<CBlock, CBlockUndo> >::const_iterator it = blocks.find(blockIndex);
+        if (it == blocks.end())
+            return false;
+        blockUndo = it->second.second;
+        return true;
+    }
+};
+
+const int keyIdType = 1;
+
+CKeyID KeyId(char tag)
+{
+    return CKeyID(Hash160(std::vector<unsigned char>(1, tag)));
+}
+
+CTransaction Coinbase(int nHeight, const CKeyID& payee, CAmount nValue)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    coinbase.vout.push_back(CTxOut(nValue, GetScriptForDestination(payee)));
+    return CTransaction(coinbase);
+}
+
+/** Genesis, a block paying 50 to a and a block moving that on to b (30) and back to a (20) */
+class ChainWithPayments
+{
+public:
+    std::vector<uint256> hashes;
+    std::vector<std::unique_ptr<CBlockIndex> > indices;
+    InMemoryBlockDataReader reader;
+    CTransaction payment;
+
+    ChainWithPayments()
+        : hashes(3)
+        , indices()
+        , reader()
+        , payment()
+    {
+        AddBlock(std::vector<CTransaction>(1, Coinbase(0, KeyId('g'), 1)), CBlockUndo());
+        const CTransaction reward = Coinbase(1, KeyId('a'), 50);
+        AddBlock(std::vector<CTransaction>(1, reward), CBlockUndo());
+
+        CMutableTransaction spend;
+        spend.vin.push_back(CTxIn(COutPoint(reward.GetHash(), 0)));
+        spend.vout.push_back(CTxOut(30, GetScriptForDestination(KeyId('b'))));
+        spend.vout.push_back(CTxOut(20, GetScriptForDestination(KeyId('a'))));
+        payment = CTransaction(spend);
+        std::vector<CTransaction> vtx;
+        vtx.push_back(Coinbase(2, KeyId('c'), 1));
+        vtx.push_back(payment);
+        CBlockUndo undo;
+        undo.vtxundo.resize(1);
+        undo.vtxundo[0].vprevout.push_back(CTxInUndo(reward.vout[0], true, false, 1));
+        AddBlock(vtx, undo);
+    }
+
+    void AddBlock(const std::vector<CTransaction>& vtx, const CBlockUndo& undo)
+    {
+        const int nHeight = indices.size();
+        CBlock block;
+        block.vtx = vtx;
+        block.nTime = nHeight;
+        hashes[nHeight] = block.GetHash();
+        indices.push_back(std::unique_ptr<CBlockIndex>(new CBlockIndex()));
+        CBlockIndex* pindex = indices.back().get();
+        pindex->phashBlock = &hashes[nHeight];
+        pindex->nHeight = nHeight;
+        pindex->pprev = nHeight > 0 ? indices[nHeight - 1].get() : NULL;
+        reader.blocks[pindex] = std::make_pair(block, undo);
+    }
+
+    const CBlockIndex* operator[](int nHeight) const { return indices[nHeight].get(); }
+};
+
+std::vector<std::pair<CAddressIndexKey, CAmount> > AddressEntries(CBlockTreeDB& db, char tag)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    BOOST_REQUIRE(db.ReadAddressIndex(KeyId(tag), keyIdType, entries));
+    return entries;
+}
+
+std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > UnspentOutputs(CBlockTreeDB& db, char tag)
+{
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    BOOST_REQUIRE(db.ReadAddressUnspentIndex(KeyId(tag), keyIdType, unspent));
+    return unspent;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BackgroundIndexBuilder_tests)
+
+BOOST_AUTO_TEST_CASE(willBuildTheAddressIndexAndResumeWhereItLeftOff)
+{
+    ChainWithPayments chain;
+    CBlockTreeDB db(1 << 20, true, true);
+    {
+        BackgroundIndexBuilder builder(BuiltIndex::ADDRESS_INDEX, db, chain.reader);
+        BOOST_CHECK(builder.GetBestBlock() == 0);
+        BOOST_CHECK(builder.ConnectBlock(chain[0]));
+        BOOST_CHECK(builder.ConnectBlock(chain[1]));
+    }
+    BackgroundIndexBuilder builder(BuiltIndex::ADDRESS_INDEX, db, chain.reader);
+    BOOST_CHECK(builder.GetBestBlock() == chain[1]->GetBlockHash());
+    BOOST_CHECK(builder.ConnectBlock(chain[2]));
+
+    BOOST_CHECK_EQUAL(AddressEntries(db, 'a').size(), 3u);
+    BOOST_CHECK_EQUAL(AddressEntries(db, 'b').size(), 1u);
+    BOOST_CHECK(AddressEntries(db, 'g').empty());
+    const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent = UnspentOutputs(db, 'a');
+    BOOST_REQUIRE_EQUAL(unspent.size(), 1u);
+    BOOST_CHECK(unspent[0].first.txhash == chain.payment.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(willTakeDisconnectedBlocksBackOutOfTheIndex)
+{
+    ChainWithPayments chain;
+    CBlockTreeDB db(1 << 20, true, true);
+    BackgroundIndexBuilder builder(BuiltIndex::ADDRESS_INDEX, db, chain.reader);
+    for (int nHeight = 0; nHeight <= 2; nHeight++)
+        BOOST_REQUIRE(builder.ConnectBlock(chain[nHeight]));
+
+    BOOST_CHECK(builder.DisconnectBlock(chain[2]));
+
+    BOOST_CHECK(builder.GetBestBlock() == chain[1]->GetBlockHash());
+    BOOST_CHECK_EQUAL(AddressEntries(db, 'a').size(), 1u);
+    BOOST_CHECK(AddressEntries(db, 'b').empty());
+    BOOST_CHECK_EQUAL(UnspentOutputs(db, 'a').size(), 1u);
+    BOOST_CHECK(UnspentOutputs(db, 'b').empty());
+}
+
+BOOST_AUTO_TEST_CASE(willTurnTheIndexOnWithItsBalancesOnceFinished)
+{
+    ChainWithPayments chain;
+    CBlockTreeDB db(1 << 20, true, true);
+    BackgroundIndexBuilder builder(BuiltIndex::ADDRESS_INDEX, db, chain.reader);
+    for (int nHeight = 0; nHeight <= 2; nHeight++)
+        BOOST_REQUIRE(builder.ConnectBlock(chain[nHeight]));
+
+    BOOST_CHECK(builder.Finish());
+
+    bool fIndex = false;
+    BOOST_CHECK(db.ReadFlag("addressindex", fIndex) && fIndex);
+    uint256 hashProgress;
+    BOOST_CHECK(!db.ReadIndexBuildProgress("addressindex", hashProgress));
+    CAddressBalance balance;
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId('a'), keyIdType, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 20);
+    BOOST_CHECK_EQUAL(balance.received, 70);
+    BOOST_CHECK_EQUAL(balance.txCount, 2);
+}
+
+BOOST_AUTO_TEST_CASE(willBuildTheSpentAndTransactionIndexes)
+{
+    ChainWithPayments chain;
+    CBlockTreeDB db(1 << 20, true, true);
+    BackgroundIndexBuilder spentIndexBuilder(BuiltIndex::SPENT_INDEX, db, chain.reader);
+    BackgroundIndexBuilder txIndexBuilder(BuiltIndex::TX_INDEX, db, chain.reader);
+    BOOST_CHECK_EQUAL(spentIndexBuilder.GetName(), "spentindex");
+    for (int nHeight = 0; nHeight <= 2; nHeight++) {
+        BOOST_REQUIRE(spentIndexBuilder.ConnectBlock(chain[nHeight]));
+        BOOST_REQUIRE(txIndexBuilder.ConnectBlock(chain[nHeight]));
+    }
+
+    CSpentIndexKey spentKey(chain.payment.vin[0].prevout.hash, 0);
+    CSpentIndexValue spentValue;
+    BOOST_REQUIRE(db.ReadSpentIndex(spentKey, spentValue));
+    BOOST_CHECK(spentValue.txid == chain.payment.GetHash());
+    BOOST_CHECK_EQUAL(spentValue.blockHeight, 2);
+    CDiskTxPos txPos;
+    BOOST_CHECK(db.ReadTxIndex(chain.payment.GetHash(), txPos));
+    BOOST_CHECK(AddressEntries(db, 'a').empty());
+
+    BOOST_CHECK(spentIndexBuilder.DisconnectBlock(chain[2]));
+    BOOST_CHECK(!db.ReadSpentIndex(spentKey, spentValue));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
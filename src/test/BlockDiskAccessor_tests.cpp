@@ -0,0 +1,115 @@
+#include <BlockDiskAccessor.h>
+
+#include <BlockFileOpener.h>
+#include <chain.h>
+#include <CompressedBlockFile.h>
+#include <clientversion.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <util.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+void ClearBlockFile(int nFile)
+{
+    FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0));
+    BOOST_REQUIRE(file != NULL);
+    BOOST_REQUIRE(TruncateFile(file, 0));
+    fclose(file);
+}
+
+CBlock MakeBlock(int nTime)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << nTime << OP_0;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 50;
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    CBlock block;
+    block.nVersion = 4;
+    block.nTime = nTime;
+    block.vtx.push_back(CTransaction(coinbase));
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BlockDiskAccessor_tests)
+
+BOOST_AUTO_TEST_CASE(willReadBlocksAsTheyWereStored)
+{
+    ClearBlockFile(12);
+    CloseBlockFileAppender();
+    std::vector<CBlock> blocks;
+    std::vector<CDiskBlockPos> positions;
+    CDiskBlockPos pos(12, 0);
+    for (int nTime = 1; nTime <= 3; nTime++) {
+        blocks.push_back(MakeBlock(nTime));
+        CDiskBlockPos blockPos = pos;
+        BOOST_REQUIRE(WriteBlockToDisk(blocks.back(), blockPos));
+        positions.push_back(blockPos);
+        pos.nPos = blockPos.nPos + ::GetSerializeSize(blocks.back(), SER_DISK, CLIENT_VERSION);
+    }
+    CloseBlockFileAppender();
+
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        CDataStream expected(SER_NETWORK, PROTOCOL_VERSION);
+        expected << blocks[i];
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << (unsigned char)0xff;
+        BOOST_REQUIRE(ReadRawBlockFromDisk(ssBlock, positions[i]));
+        BOOST_CHECK_EQUAL(ssBlock.size(), expected.size() + 1);
+        BOOST_CHECK(std::equal(expected.begin(), expected.end(), ssBlock.begin() + 1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willNotReadWhereNoBlockWasStored)
+{
+    ClearBlockFile(13);
+    CloseBlockFileAppender();
+    CBlock block = MakeBlock(1);
+    CDiskBlockPos blockPos(13, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block, blockPos));
+    CloseBlockFileAppender();
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(!ReadRawBlockFromDisk(ssBlock, CDiskBlockPos(13, blockPos.nPos + 1)));
+    BOOST_CHECK(!ReadRawBlockFromDisk(ssBlock, CDiskBlockPos(13, 2)));
+    BOOST_CHECK(!ReadRawBlockFromDisk(ssBlock, CDiskBlockPos()));
+    BOOST_CHECK(ssBlock.empty());
+}
+
+BOOST_AUTO_TEST_CASE(willReadBlocksFromCompressedBlockFiles)
+{
+    if (!CompressedBlockFile::IsSupported())
+        return;
+    RemoveBlockAndUndoFiles(14);
+    ClearBlockFile(14);
+    CloseBlockFileAppender();
+    CBlock block = MakeBlock(1);
+    CDiskBlockPos blockPos(14, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block, blockPos));
+    CloseBlockFileAppender();
+
+    BOOST_REQUIRE(CompressBlockFile(14));
+    ReleaseMappedBlockFiles();
+    BOOST_CHECK(IsBlockFileCompressed(14));
+    BOOST_CHECK(BlockFileExists(CDiskBlockPos(14, 0), "blk"));
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_REQUIRE(ReadRawBlockFromDisk(ssBlock, blockPos));
+    CBlock blockRead;
+    ssBlock >> blockRead;
+    BOOST_CHECK(blockRead.GetHash() == block.GetHash());
+    BOOST_CHECK(ssBlock.empty());
+    RemoveBlockAndUndoFiles(14);
+    BOOST_CHECK(!BlockFileExists(CDiskBlockPos(14, 0), "blk"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
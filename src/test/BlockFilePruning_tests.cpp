@@ -0,0 +1,84 @@
+#include <BlockFilePruning.h>
+
+#include <blockFileInfo.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+const uint64_t nMiB = 1024 * 1024;
+
+/** Block files of nFiles * nBlocksPerFile consecutive blocks, each file using 10 MiB for blocks and 1 MiB for undo data */
+std::vector<CBlockFileInfo> MakeBlockFiles(int nFiles, unsigned int nBlocksPerFile)
+{
+    std::vector<CBlockFileInfo> vinfoBlockFile(nFiles);
+    for (int nFile = 0; nFile < nFiles; nFile++) {
+        for (unsigned int nHeight = nFile * nBlocksPerFile; nHeight < (nFile + 1) * nBlocksPerFile; nHeight++)
+            vinfoBlockFile[nFile].AddBlock(nHeight, 1000 + nHeight);
+        vinfoBlockFile[nFile].nSize = 10 * nMiB;
+        vinfoBlockFile[nFile].nUndoSize = nMiB;
+    }
+    return vinfoBlockFile;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BlockFilePruning_tests)
+
+BOOST_AUTO_TEST_CASE(willAddUpBlockAndUndoSizes)
+{
+    BOOST_CHECK_EQUAL(CalculateBlockFilesUsage(MakeBlockFiles(0, 100)), 0u);
+    BOOST_CHECK_EQUAL(CalculateBlockFilesUsage(MakeBlockFiles(3, 100)), 33 * nMiB);
+}
+
+BOOST_AUTO_TEST_CASE(willPruneNothingWithinTheTarget)
+{
+    const std::vector<CBlockFileInfo> vinfoBlockFile = MakeBlockFiles(5, 100);
+    BOOST_CHECK(FindBlockFilesToPrune(vinfoBlockFile, 4, 400, 100 * nMiB, 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(willPruneTheOldestFilesUntilTheTargetAndBufferFit)
+{
+    const std::vector<CBlockFileInfo> vinfoBlockFile = MakeBlockFiles(6, 100);
+
+    std::set<int> expected;
+    expected.insert(0);
+    expected.insert(1);
+    const std::set<int> setFilesToPrune = FindBlockFilesToPrune(vinfoBlockFile, 5, 500, 46 * nMiB, nMiB);
+    BOOST_CHECK_EQUAL_COLLECTIONS(setFilesToPrune.begin(), setFilesToPrune.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(willKeepFilesWithBlocksThatAreTooRecent)
+{
+    const std::vector<CBlockFileInfo> vinfoBlockFile = MakeBlockFiles(6, 100);
+
+    std::set<int> expected;
+    expected.insert(0);
+    const std::set<int> setFilesToPrune = FindBlockFilesToPrune(vinfoBlockFile, 5, 198, 10 * nMiB, 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(setFilesToPrune.begin(), setFilesToPrune.end(), expected.begin(), expected.end());
+    BOOST_CHECK(FindBlockFilesToPrune(vinfoBlockFile, 5, -1, 10 * nMiB, 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(willNeverPruneTheFileBeingAppendedTo)
+{
+    const std::vector<CBlockFileInfo> vinfoBlockFile = MakeBlockFiles(3, 100);
+    const std::set<int> setFilesToPrune = FindBlockFilesToPrune(vinfoBlockFile, 2, 1000, 0, 0);
+    BOOST_CHECK_EQUAL(setFilesToPrune.size(), 2u);
+    BOOST_CHECK(!setFilesToPrune.count(2));
+}
+
+BOOST_AUTO_TEST_CASE(willSkipFilesPrunedBefore)
+{
+    std::vector<CBlockFileInfo> vinfoBlockFile = MakeBlockFiles(5, 100);
+    vinfoBlockFile[0].SetNull();
+    vinfoBlockFile[1].SetNull();
+
+    std::set<int> expected;
+    expected.insert(2);
+    const std::set<int> setFilesToPrune = FindBlockFilesToPrune(vinfoBlockFile, 4, 400, 30 * nMiB, 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(setFilesToPrune.begin(), setFilesToPrune.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
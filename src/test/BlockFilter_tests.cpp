@@ -0,0 +1,146 @@
+#include <BlockFilter.h>
+
+#include <BlockUndo.h>
+#include <key.h>
+#include <primitives/block.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <undo.h>
+#include <version.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CScript NewKeyScript(CPubKey& pubKey)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    pubKey = key.GetPubKey();
+    return GetScriptForDestination(pubKey.GetID());
+}
+
+class BlockFilterFixture
+{
+public:
+    CBlock block;
+    CBlockUndo blockUndo;
+    CPubKey paidKey;
+    CPubKey spentKey;
+    CPubKey payToPubkeyKey;
+    CScript paidScript;
+    CScript spentScript;
+
+    BlockFilterFixture(
+        ): block()
+        , blockUndo()
+        , paidKey()
+        , spentKey()
+        , payToPubkeyKey()
+        , paidScript()
+        , spentScript()
+    {
+        paidScript = NewKeyScript(paidKey);
+        spentScript = NewKeyScript(spentKey);
+        NewKeyScript(payToPubkeyKey);
+
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.emplace_back(100, paidScript);
+        coinbase.vout.emplace_back(0, CScript() << OP_META << std::vector<unsigned char>(8, 0x42));
+        block.vtx.push_back(CTransaction(coinbase));
+
+        CMutableTransaction spend;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(uint256(1), 0);
+        spend.vout.emplace_back(50, GetScriptForPubKey(payToPubkeyKey));
+        block.vtx.push_back(CTransaction(spend));
+
+        CTxUndo txundo;
+        txundo.vprevout.push_back(CTxInUndo(CTxOut(60, spentScript)));
+        blockUndo.vtxundo.push_back(txundo);
+    }
+
+    static CScript GetScriptForPubKey(const CPubKey& pubKey)
+    {
+        return CScript() << ToByteVector(pubKey) << OP_CHECKSIG;
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(BlockFilter_tests, BlockFilterFixture)
+
+BOOST_AUTO_TEST_CASE(willMatchTheScriptsTheBlockPaysToAndSpendsFrom)
+{
+    const BlockFilter filter(block, blockUndo);
+    BOOST_CHECK(filter.GetBlockHash() == block.GetHash());
+    BOOST_CHECK(filter.MatchesAny(std::vector<CScript>(1, paidScript)));
+    BOOST_CHECK(filter.MatchesAny(std::vector<CScript>(1, spentScript)));
+    BOOST_CHECK(filter.MatchesAny(std::vector<CScript>(1, GetScriptForPubKey(payToPubkeyKey))));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchTheKeyHashScriptOfKeysPaidToDirectly)
+{
+    const BlockFilter filter(block, blockUndo);
+    BOOST_CHECK(filter.MatchesAny(std::vector<CScript>(1, GetScriptForDestination(payToPubkeyKey.GetID()))));
+}
+
+BOOST_AUTO_TEST_CASE(willLeaveOutDataCarrierOutputs)
+{
+    const BlockFilter filter(block, blockUndo);
+    // The paid, spent and pay-to-pubkey scripts, and the key hash script of the last
+    BOOST_CHECK_EQUAL(filter.GetElementCount(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotMatchUnrelatedScriptsOrAnEmptyQuery)
+{
+    const BlockFilter filter(block, blockUndo);
+    std::vector<CScript> unrelatedScripts;
+    for (unsigned n = 0; n < 20; n++) {
+        CPubKey pubKey;
+        unrelatedScripts.push_back(NewKeyScript(pubKey));
+    }
+    BOOST_CHECK(!filter.MatchesAny(unrelatedScripts));
+    BOOST_CHECK(!filter.MatchesAny(std::vector<CScript>()));
+
+    unrelatedScripts.push_back(spentScript);
+    BOOST_CHECK(filter.MatchesAny(unrelatedScripts));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchNothingWhenTheBlockHasNoScripts)
+{
+    const BlockFilter filter(uint256(7), std::set<CScript>());
+    BOOST_CHECK_EQUAL(filter.GetElementCount(), 0u);
+    BOOST_CHECK(!filter.MatchesAny(std::vector<CScript>(1, paidScript)));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchTheSameScriptsAfterARoundTrip)
+{
+    const BlockFilter filter(block, blockUndo);
+    CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+    stream << filter;
+    BlockFilter readFilter;
+    stream >> readFilter;
+    BOOST_CHECK(readFilter.GetBlockHash() == filter.GetBlockHash());
+    BOOST_CHECK(readFilter.GetEncodedFilter() == filter.GetEncodedFilter());
+    BOOST_CHECK_EQUAL(readFilter.GetElementCount(), filter.GetElementCount());
+    BOOST_CHECK(readFilter.MatchesAny(std::vector<CScript>(1, spentScript)));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchAnythingWhenTheFilterIsCorrupt)
+{
+    const BlockFilter filter(block, blockUndo);
+    std::vector<unsigned char> truncated(filter.GetEncodedFilter().begin(), filter.GetEncodedFilter().begin() + 2);
+    CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+    stream << filter.GetBlockHash() << truncated;
+    BlockFilter readFilter;
+    stream >> readFilter;
+
+    CPubKey pubKey;
+    BOOST_CHECK(readFilter.MatchesAny(std::vector<CScript>(1, NewKeyScript(pubKey))));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
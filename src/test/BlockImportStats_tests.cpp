@@ -0,0 +1,107 @@
+#include <BlockImportStats.h>
+
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+struct BlockImportStatsTestFixture {
+    BlockImportStatsTestFixture()
+    {
+        BlockImportStats::Reset();
+    }
+    ~BlockImportStatsTestFixture()
+    {
+        BlockImportStats::Reset();
+    }
+};
+
+CTransaction TransactionWithInputs(unsigned numberOfInputs)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(numberOfInputs);
+    for (unsigned i = 0; i < numberOfInputs; ++i)
+        tx.vin[i].prevout = COutPoint(uint256(i + 1), i);
+    tx.vout.resize(1);
+    return tx;
+}
+
+CTransaction Coinbase()
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.SetNull();
+    tx.vout.resize(1);
+    return tx;
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(BlockImportStats_tests, BlockImportStatsTestFixture)
+
+BOOST_AUTO_TEST_CASE(countsConnectedBlocksTransactionsAndInputsButNotTheCoinbase)
+{
+    CBlock block;
+    block.vtx.push_back(Coinbase());
+    block.vtx.push_back(TransactionWithInputs(2));
+    block.vtx.push_back(TransactionWithInputs(3));
+
+    BlockImportStats::BlockConnected(block);
+    BlockImportStats::BlockConnected(block);
+
+    const BlockImportReport report = BlockImportStats::GetReport();
+    BOOST_CHECK_EQUAL(report.nBlocks, 2u);
+    BOOST_CHECK_EQUAL(report.nTransactions, 6u);
+    BOOST_CHECK_EQUAL(report.nInputs, 10u);
+}
+
+BOOST_AUTO_TEST_CASE(addsUpTimePerPhase)
+{
+    BlockImportStats::AddPhaseTime(BlockImportPhase::CHECK_BLOCK, 100);
+    BlockImportStats::AddPhaseTime(BlockImportPhase::CHECK_BLOCK, 50);
+    BlockImportStats::AddPhaseTime(BlockImportPhase::INDEX_WRITES, 7);
+
+    const BlockImportReport report = BlockImportStats::GetReport();
+    BOOST_CHECK_EQUAL(report.phaseMicros[static_cast<unsigned>(BlockImportPhase::CHECK_BLOCK)], 150);
+    BOOST_CHECK_EQUAL(report.phaseMicros[static_cast<unsigned>(BlockImportPhase::INDEX_WRITES)], 7);
+    BOOST_CHECK_EQUAL(report.phaseMicros[static_cast<unsigned>(BlockImportPhase::READ)], 0);
+}
+
+BOOST_AUTO_TEST_CASE(resetStartsTheCountsOver)
+{
+    CBlock block;
+    block.vtx.push_back(Coinbase());
+    BlockImportStats::BlockConnected(block);
+    BlockImportStats::AddPhaseTime(BlockImportPhase::FLUSH, 1000);
+
+    BlockImportStats::Reset();
+
+    const BlockImportReport report = BlockImportStats::GetReport();
+    BOOST_CHECK_EQUAL(report.nBlocks, 0u);
+    BOOST_CHECK_EQUAL(report.phaseMicros[static_cast<unsigned>(BlockImportPhase::FLUSH)], 0);
+}
+
+BOOST_AUTO_TEST_CASE(ratesAreOverTheElapsedTime)
+{
+    BlockImportReport report;
+    report.nElapsedMicros = 2000000;
+    BOOST_CHECK_CLOSE(report.PerSecond(500), 250.0, 0.001);
+
+    report.nElapsedMicros = 0;
+    BOOST_CHECK_EQUAL(report.PerSecond(500), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(reportHasALinePerPhase)
+{
+    const std::vector<std::string> lines = BlockImportStats::GetReport().ToLines();
+    for (unsigned i = 0; i < static_cast<unsigned>(BlockImportPhase::NUMBER_OF_PHASES); ++i) {
+        const std::string phaseName = BlockImportStats::PhaseName(static_cast<BlockImportPhase>(i));
+        bool found = false;
+        for (const std::string& line : lines)
+            found |= line.compare(0, phaseName.size() + 1, phaseName + ":") == 0;
+        BOOST_CHECK_MESSAGE(found, phaseName);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,38 @@
+#include <blockmap.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(BlockMap_tests)
+
+BOOST_AUTO_TEST_CASE(keysStayInPlaceAsTheMapGrows)
+{
+    BlockMap blockMap;
+    const BlockMap::iterator first = blockMap.insert(std::make_pair(uint256(1), static_cast<CBlockIndex*>(NULL))).first;
+    const uint256* phashBlock = &first->first;
+    for (unsigned i = 2; i <= 10000; ++i)
+        blockMap.insert(std::make_pair(uint256(i), static_cast<CBlockIndex*>(NULL)));
+
+    BOOST_CHECK(blockMap.bucket_count() > 10000 / blockMap.max_load_factor() - 1);
+    BOOST_CHECK(&blockMap.find(uint256(1))->first == phashBlock);
+    BOOST_CHECK(*phashBlock == uint256(1));
+}
+
+BOOST_AUTO_TEST_CASE(findsEveryInsertedHash)
+{
+    BlockMap blockMap;
+    std::vector<CBlockIndex> indexes(1000);
+    for (unsigned i = 0; i < indexes.size(); ++i)
+        blockMap[uint256(i) << 128] = &indexes[i];
+
+    BOOST_CHECK_EQUAL(blockMap.size(), indexes.size());
+    for (unsigned i = 0; i < indexes.size(); ++i) {
+        const BlockMap::const_iterator it = blockMap.find(uint256(i) << 128);
+        BOOST_REQUIRE(it != blockMap.end());
+        BOOST_CHECK(it->second == &indexes[i]);
+    }
+    BOOST_CHECK(blockMap.find(uint256(indexes.size()) << 128) == blockMap.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+#include <BlockPolicyEstimator.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <txmempool.h>
+
+#include <stdio.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+const CAmount feeRateStep = 10000;
+
+/** A transaction paying feeRateStep per kB times the level, unique to the height it enters at */
+CTxMemPoolEntry EntryAt(unsigned int nHeight, int level)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << CScriptNum(nHeight) << CScriptNum(level);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    tx.vout[0].nValue = 1000;
+    const CTransaction txFinal(tx);
+    const unsigned int nSize = ::GetSerializeSize(txFinal, SER_NETWORK, PROTOCOL_VERSION);
+    return CTxMemPoolEntry(txFinal, CFeeRate(feeRateStep * level).GetFee(nSize), 0, 0.0, nHeight);
+}
+
+/**
+ * Ten transactions of increasing fee rates enter at every height. The upper
+ * half is mined in the next block, the lower half two blocks later.
+ */
+void MineBlocks(BlockPolicyEstimator& estimator, unsigned int nBlocks)
+{
+    std::vector<std::vector<CTxMemPoolEntry> > entered;
+    for (unsigned int nHeight = 0; nHeight < nBlocks; nHeight++) {
+        entered.push_back(std::vector<CTxMemPoolEntry>());
+        for (int level = 1; level <= 10; level++) {
+            entered.back().push_back(EntryAt(nHeight, level));
+            estimator.ProcessTransaction(entered.back().back());
+        }
+
+        std::vector<CTxMemPoolEntry> confirmed(entered[nHeight].begin() + 5, entered[nHeight].end());
+        if (nHeight >= 2)
+            confirmed.insert(confirmed.end(), entered[nHeight - 2].begin(), entered[nHeight - 2].begin() + 5);
+        estimator.ProcessBlock(nHeight + 1, confirmed);
+    }
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BlockPolicyEstimator_tests)
+
+BOOST_AUTO_TEST_CASE(willEstimateHigherFeesForFewerBlocks)
+{
+    BlockPolicyEstimator estimator((CFeeRate(feeRateStep)));
+    BOOST_CHECK(estimator.EstimateFee(1) == CFeeRate(0));
+
+    MineBlocks(estimator, 400);
+
+    const CFeeRate oneBlock = estimator.EstimateFee(1);
+    const CFeeRate threeBlocks = estimator.EstimateFee(3);
+    BOOST_CHECK(oneBlock >= CFeeRate(6 * feeRateStep));
+    BOOST_CHECK(threeBlocks > CFeeRate(0));
+    BOOST_CHECK(threeBlocks < oneBlock);
+    for (int nBlocks = 2; nBlocks <= (int)BlockPolicyEstimator::MAX_BLOCK_CONFIRMS; nBlocks++)
+        BOOST_CHECK(estimator.EstimateFee(nBlocks) <= estimator.EstimateFee(nBlocks - 1));
+    BOOST_CHECK(estimator.EstimateFee(0) == CFeeRate(0));
+    BOOST_CHECK(estimator.EstimateFee(BlockPolicyEstimator::MAX_BLOCK_CONFIRMS + 1) == CFeeRate(0));
+    BOOST_CHECK_EQUAL(estimator.EstimatePriority(1), -1);
+}
+
+BOOST_AUTO_TEST_CASE(willIgnoreTransactionsThatEnteredBelowTheTip)
+{
+    BlockPolicyEstimator estimator((CFeeRate(feeRateStep)));
+    BlockPolicyEstimator untouched((CFeeRate(feeRateStep)));
+    MineBlocks(estimator, 400);
+    MineBlocks(untouched, 400);
+
+    // Reorganised back in from an older block, these would seem to take ages
+    std::vector<CTxMemPoolEntry> stale;
+    for (int n = 0; n < 50; n++) {
+        stale.push_back(EntryAt(300 + n, 10));
+        estimator.ProcessTransaction(stale.back());
+    }
+    estimator.ProcessBlock(401, stale);
+    untouched.ProcessBlock(401, std::vector<CTxMemPoolEntry>());
+    for (int nBlocks = 1; nBlocks <= (int)BlockPolicyEstimator::MAX_BLOCK_CONFIRMS; nBlocks++)
+        BOOST_CHECK(estimator.EstimateFee(nBlocks) == untouched.EstimateFee(nBlocks));
+}
+
+BOOST_AUTO_TEST_CASE(willReadBackTheEstimatesItWrote)
+{
+    BlockPolicyEstimator estimator((CFeeRate(feeRateStep)));
+    MineBlocks(estimator, 400);
+
+    CAutoFile file(tmpfile(), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    estimator.Write(file);
+    rewind(file.Get());
+
+    BlockPolicyEstimator read((CFeeRate(feeRateStep)));
+    read.Read(file);
+    for (int nBlocks = 1; nBlocks <= (int)BlockPolicyEstimator::MAX_BLOCK_CONFIRMS; nBlocks++)
+        BOOST_CHECK(read.EstimateFee(nBlocks) == estimator.EstimateFee(nBlocks));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+#include <BlockStats.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <streams.h>
+#include <undo.h>
+#include <version.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class BlockStatsFixture
+{
+public:
+    CBlock block;
+    CBlockUndo blockUndo;
+    CBlockIndex previousIndex;
+    CBlockIndex blockIndex;
+    uint256 blockHash;
+
+    BlockStatsFixture(
+        ): block()
+        , blockUndo()
+        , previousIndex()
+        , blockIndex()
+        , blockHash(42)
+    {
+        const CScript script = CScript() << OP_TRUE;
+
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.emplace_back(0, CScript() << OP_META << std::vector<unsigned char>(8, 0x42));
+        block.vtx.push_back(CTransaction(coinbase));
+
+        CMutableTransaction coinstake;
+        coinstake.vin.resize(1);
+        coinstake.vin[0].prevout = COutPoint(uint256(1), 0);
+        coinstake.vout.resize(1);
+        coinstake.vout[0].SetEmpty();
+        coinstake.vout.emplace_back(1100, script);
+        coinstake.vout.emplace_back(300, script);
+        block.vtx.push_back(CTransaction(coinstake));
+
+        CMutableTransaction spend;
+        spend.vin.resize(2);
+        spend.vin[0].prevout = COutPoint(uint256(2), 0);
+        spend.vin[1].prevout = COutPoint(uint256(3), 1);
+        spend.vout.emplace_back(70, script);
+        spend.vout.emplace_back(20, script);
+        block.vtx.push_back(CTransaction(spend));
+
+        blockUndo.vtxundo.resize(2);
+        blockUndo.vtxundo[0].vprevout.push_back(CTxInUndo(CTxOut(1000, script)));
+        blockUndo.vtxundo[1].vprevout.push_back(CTxInUndo(CTxOut(60, script)));
+        blockUndo.vtxundo[1].vprevout.push_back(CTxInUndo(CTxOut(40, script)));
+
+        // The coinstake minted 400 and the spend paid a fee of 10, which proof of stake destroys
+        previousIndex.nMoneySupply = 5000;
+        blockIndex.pprev = &previousIndex;
+        blockIndex.phashBlock = &blockHash;
+        blockIndex.nHeight = 7;
+        blockIndex.nTime = 1234;
+        blockIndex.nMint = 400;
+        blockIndex.nMoneySupply = 5390;
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(BlockStats_tests, BlockStatsFixture)
+
+BOOST_AUTO_TEST_CASE(willCountTheTransactionsOtherThanTheCoinbaseAndCoinstake)
+{
+    const BlockStats stats(block, blockUndo, blockIndex, CBlockRewards(300, 100, 0, 0, 0, 0));
+    BOOST_CHECK(stats.blockHash == blockHash);
+    BOOST_CHECK_EQUAL(stats.nHeight, 7);
+    BOOST_CHECK_EQUAL(stats.nTime, 1234u);
+    BOOST_CHECK_EQUAL(stats.nTx, 3u);
+    BOOST_CHECK_EQUAL(stats.nInputs, 2u);
+    BOOST_CHECK_EQUAL(stats.nOutputs, 2u);
+    BOOST_CHECK_EQUAL(stats.nTotalIn, 100);
+    BOOST_CHECK_EQUAL(stats.nTotalOut, 90);
+}
+
+BOOST_AUTO_TEST_CASE(willTakeTheFeesFromTheMintAndMoneySupply)
+{
+    const BlockStats stats(block, blockUndo, blockIndex, CBlockRewards(300, 100, 0, 0, 0, 0));
+    BOOST_CHECK_EQUAL(stats.nFees, 10);
+    BOOST_CHECK_EQUAL(stats.nMint, 400);
+    BOOST_CHECK_EQUAL(stats.nMoneySupply, 5390);
+    BOOST_CHECK_EQUAL(stats.rewards.nStakeReward, 300);
+    BOOST_CHECK_EQUAL(stats.rewards.nMasternodeReward, 100);
+}
+
+BOOST_AUTO_TEST_CASE(willLeaveProvablyUnspendableOutputsOutOfTheUtxoDelta)
+{
+    const BlockStats stats(block, blockUndo, blockIndex, CBlockRewards(300, 100, 0, 0, 0, 0));
+    // The empty coinstake marker stays in the coins view, the coinbase's data output does not
+    BOOST_CHECK_EQUAL(stats.nUtxoCreated, 5u);
+    BOOST_CHECK_EQUAL(stats.nUtxoSpent, 3u);
+    BOOST_CHECK_EQUAL(stats.GetUtxoDelta(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(willSerializeEveryFigure)
+{
+    const BlockStats stats(block, blockUndo, blockIndex, CBlockRewards(300, 100, 20, 30, 40, 50));
+    CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+    stream << stats;
+    BlockStats read;
+    stream >> read;
+
+    BOOST_CHECK(read.blockHash == stats.blockHash);
+    BOOST_CHECK_EQUAL(read.nHeight, stats.nHeight);
+    BOOST_CHECK_EQUAL(read.nTx, stats.nTx);
+    BOOST_CHECK_EQUAL(read.nTotalIn, stats.nTotalIn);
+    BOOST_CHECK_EQUAL(read.nFees, stats.nFees);
+    BOOST_CHECK_EQUAL(read.rewards.ToString(), stats.rewards.ToString());
+    BOOST_CHECK_EQUAL(read.nUtxoCreated, stats.nUtxoCreated);
+    BOOST_CHECK_EQUAL(read.nUtxoSpent, stats.nUtxoSpent);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+#include <test/test_only.h>
+#include <BranchAndBoundCoinSelectionAlgorithm.h>
+#include <MinimumFeeCoinSelectionAlgorithm.h>
+#include <keystore.h>
+#include <RandomCScriptGenerator.h>
+#include <FeeAndPriorityCalculator.h>
+#include <FeeRate.h>
+#include <version.h>
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <WalletTx.h>
+#include <test/MockSignatureSizeEstimator.h>
+
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::_;
+class BranchAndBoundCoinSelectionAlgorithmTestFixture
+{
+private:
+    CBasicKeyStore keystore_;
+    std::vector<CWalletTx> walletTransactions_;
+public:
+    NiceMock<MockSignatureSizeEstimator> mockSignatureSizeEstimator;
+    MinimumFeeCoinSelectionAlgorithm fallbackAlgorithm;
+    BranchAndBoundCoinSelectionAlgorithm algorithm;
+    RandomCScriptGenerator scriptGenerator;
+    const CFeeRate& feeRate;
+
+    BranchAndBoundCoinSelectionAlgorithmTestFixture(
+        ): keystore_()
+        , walletTransactions_()
+        , mockSignatureSizeEstimator()
+        , fallbackAlgorithm(keystore_,mockSignatureSizeEstimator)
+        , algorithm(keystore_,mockSignatureSizeEstimator,fallbackAlgorithm)
+        , scriptGenerator()
+        , feeRate(FeeAndPriorityCalculator::instance().getFeeRateQuote())
+    {
+        ON_CALL(mockSignatureSizeEstimator,MaxBytesNeededForSigning(_,_)).WillByDefault(Return(100u));
+        walletTransactions_.reserve(1000u);
+    }
+
+    void addSingleUtxo(const CAmount utxoAmount)
+    {
+        CMutableTransaction mutableTx;
+        mutableTx.vin.emplace_back();
+        mutableTx.vin[0].scriptSig = scriptGenerator(25);
+        mutableTx.vout.emplace_back(utxoAmount,scriptGenerator(25));
+        walletTransactions_.emplace_back(CTransaction(mutableTx));
+    }
+
+    std::vector<COutput> getSpendableOutputs()
+    {
+        std::vector<COutput> outputs;
+        outputs.reserve(walletTransactions_.size());
+        for(const CWalletTx& walletTx: walletTransactions_)
+        {
+            outputs.emplace_back(&walletTx,0u,50u,true);
+        }
+        return outputs;
+    }
+
+    CMutableTransaction transactionSending(CAmount amount)
+    {
+        CMutableTransaction novelTx;
+        novelTx.vout.emplace_back(amount,scriptGenerator(25u));
+        return novelTx;
+    }
+    CAmount feeForInputs(unsigned inputCount) const
+    {
+        return inputCount * feeRate.GetFee(140u);
+    }
+    CAmount feeWithoutInputs(const CMutableTransaction& novelTx) const
+    {
+        return feeRate.GetFee(::GetSerializeSize(CTransaction(novelTx), SER_NETWORK, PROTOCOL_VERSION));
+    }
+    static CAmount totalValue(const std::set<COutput>& outputs)
+    {
+        CAmount total = 0;
+        for(const COutput& output: outputs) total += output.Value();
+        return total;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(BranchAndBoundCoinSelectionAlgorithm_tests, BranchAndBoundCoinSelectionAlgorithmTestFixture)
+
+BOOST_AUTO_TEST_CASE(willSelectInputsThatNeedNoChangeAndPayTheSurplusAsFees)
+{
+    addSingleUtxo(1*COIN);
+    addSingleUtxo(2*COIN);
+    addSingleUtxo(3*COIN);
+    addSingleUtxo(5*COIN);
+    std::vector<COutput> utxos = getSpendableOutputs();
+
+    // Spending the largest coin alone would overpay by more than change costs
+    CMutableTransaction novelTx = transactionSending(0);
+    const CAmount toSpend = 5*COIN - feeForInputs(3u) - feeWithoutInputs(novelTx);
+    novelTx.vout[0].nValue = toSpend;
+    CAmount feesPaidEstimate = 0;
+    std::set<COutput> selectedUTXOs = algorithm.SelectCoins(novelTx,utxos,feesPaidEstimate);
+    BOOST_CHECK_EQUAL(selectedUTXOs.size(),2u);
+    BOOST_CHECK_EQUAL(totalValue(selectedUTXOs),5*COIN);
+    BOOST_CHECK_EQUAL(feesPaidEstimate,5*COIN - toSpend);
+}
+
+BOOST_AUTO_TEST_CASE(willSelectAnExactMatchAmongManyInterchangeableCoins)
+{
+    for(unsigned coinCount = 0; coinCount < 500u; ++coinCount)
+    {
+        addSingleUtxo(1*COIN);
+    }
+    std::vector<COutput> utxos = getSpendableOutputs();
+
+    CMutableTransaction novelTx = transactionSending(0);
+    const CAmount toSpend = 3*COIN - feeForInputs(3u) - feeWithoutInputs(novelTx);
+    novelTx.vout[0].nValue = toSpend;
+    CAmount feesPaidEstimate = 0;
+    std::set<COutput> selectedUTXOs = algorithm.SelectCoins(novelTx,utxos,feesPaidEstimate);
+    BOOST_CHECK_EQUAL(selectedUTXOs.size(),3u);
+    BOOST_CHECK_EQUAL(feesPaidEstimate,3*COIN - toSpend);
+}
+
+BOOST_AUTO_TEST_CASE(willSelectTheSameInputsGivenTheCoinsInAnyOrder)
+{
+    for(unsigned coinCount = 1; coinCount <= 20u; ++coinCount)
+    {
+        addSingleUtxo(coinCount*COIN);
+    }
+    std::vector<COutput> utxos = getSpendableOutputs();
+    CMutableTransaction novelTx = transactionSending(0);
+    novelTx.vout[0].nValue = 37*COIN - feeForInputs(2u) - feeWithoutInputs(novelTx);
+
+    CAmount feesPaidEstimate = 0;
+    std::set<COutput> selectedUTXOs = algorithm.SelectCoins(novelTx,utxos,feesPaidEstimate);
+    std::reverse(utxos.begin(),utxos.end());
+    CAmount feesPaidEstimateForReversedCoins = 0;
+    BOOST_CHECK(selectedUTXOs == algorithm.SelectCoins(novelTx,utxos,feesPaidEstimateForReversedCoins));
+    BOOST_CHECK_EQUAL(feesPaidEstimate,feesPaidEstimateForReversedCoins);
+    BOOST_CHECK_EQUAL(totalValue(selectedUTXOs),37*COIN);
+}
+
+BOOST_AUTO_TEST_CASE(willFallBackToSelectingInputsWithChangeWhenNoChangelessSelectionExists)
+{
+    addSingleUtxo(10*COIN);
+    std::vector<COutput> utxos = getSpendableOutputs();
+
+    CMutableTransaction novelTx = transactionSending(1*COIN);
+    CAmount feesPaidEstimate = 0;
+    std::set<COutput> selectedUTXOs = algorithm.SelectCoins(novelTx,utxos,feesPaidEstimate);
+    BOOST_CHECK_EQUAL(selectedUTXOs.size(),1u);
+    BOOST_CHECK(feesPaidEstimate > 0);
+    BOOST_CHECK(feesPaidEstimate < 1*CENT);
+}
+
+BOOST_AUTO_TEST_CASE(willSelectNothingWhenFundsAreInsufficient)
+{
+    addSingleUtxo(1*COIN);
+    addSingleUtxo(1*COIN);
+    std::vector<COutput> utxos = getSpendableOutputs();
+
+    CMutableTransaction novelTx = transactionSending(2*COIN);
+    CAmount feesPaidEstimate = 0;
+    std::set<COutput> selectedUTXOs = algorithm.SelectCoins(novelTx,utxos,feesPaidEstimate);
+    BOOST_CHECK(selectedUTXOs.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
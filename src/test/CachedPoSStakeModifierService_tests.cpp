@@ -0,0 +1,104 @@
+#include <test_only.h>
+#include <CachedPoSStakeModifierService.h>
+#include <LegacyPoSStakeModifierService.h>
+#include <chain.h>
+#include <blockmap.h>
+#include <FakeBlockIndexChain.h>
+#include <StakingData.h>
+#include <memory>
+#include <utility>
+
+class CachedPoSStakeModifierServiceFixture
+{
+private:
+    std::unique_ptr<FakeBlockIndexWithHashes> fakeBlockIndexWithHashes_;
+    std::unique_ptr<LegacyPoSStakeModifierService> legacyStakeModifierService_;
+public:
+    std::unique_ptr<CachedPoSStakeModifierService> stakeModifierService_;
+    CBlockIndex* originalTip;
+    CBlockIndex* selectionBlock;
+    const uint64_t stakeModifier;
+
+    CachedPoSStakeModifierServiceFixture(
+        ): fakeBlockIndexWithHashes_(new FakeBlockIndexWithHashes(200, 0, 4))
+        , legacyStakeModifierService_(
+            new LegacyPoSStakeModifierService(
+                *(fakeBlockIndexWithHashes_->blockIndexByHash),
+                *(fakeBlockIndexWithHashes_->activeChain) ))
+        , stakeModifierService_()
+        , originalTip(fakeBlockIndexWithHashes_->activeChain->Tip())
+        , selectionBlock(originalTip->GetAncestor(150))
+        , stakeModifier(0x26929c2)
+    {
+        selectionBlock->SetStakeModifier(stakeModifier,true);
+        Init(CachedPoSStakeModifierService::DEFAULT_MAXIMUM_SIZE);
+    }
+    void Init(size_t maximumSize)
+    {
+        stakeModifierService_.reset(new CachedPoSStakeModifierService(*legacyStakeModifierService_, maximumSize));
+    }
+
+    CChain& getActiveChain() const
+    {
+        return *(fakeBlockIndexWithHashes_->activeChain);
+    }
+
+    StakingData fromHeight(int height) const
+    {
+        StakingData stakingData;
+        stakingData.blockHashOfFirstConfirmationBlock_ = originalTip->GetAncestor(height)->GetBlockHash();
+        return stakingData;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(CachedPoSStakeModifierServiceTests,CachedPoSStakeModifierServiceFixture)
+
+BOOST_AUTO_TEST_CASE(willReuseTheModifierOfAConfirmationBlockWithoutWalkingTheChainAgain)
+{
+    std::pair<uint64_t,bool> stakeModifierQuery = stakeModifierService_->getStakeModifier(fromHeight(49));
+    BOOST_CHECK(stakeModifierQuery.second);
+    BOOST_CHECK_EQUAL(stakeModifierQuery.first, stakeModifier);
+    BOOST_CHECK_EQUAL(stakeModifierService_->size(), 1u);
+
+    // A walk would now find the new value, the cache still has the one it read
+    selectionBlock->SetStakeModifier(stakeModifier + 1,true);
+    stakeModifierQuery = stakeModifierService_->getStakeModifier(fromHeight(49));
+    BOOST_CHECK(stakeModifierQuery.second);
+    BOOST_CHECK_EQUAL(stakeModifierQuery.first, stakeModifier);
+}
+
+BOOST_AUTO_TEST_CASE(willWalkTheChainAgainOnceTheSelectionBlockIsReorganizedAway)
+{
+    BOOST_CHECK_EQUAL(stakeModifierService_->getStakeModifier(fromHeight(49)).first, stakeModifier);
+
+    getActiveChain().SetTip(originalTip->GetAncestor(120));
+    std::pair<uint64_t,bool> stakeModifierQuery = stakeModifierService_->getStakeModifier(fromHeight(49));
+    BOOST_CHECK(stakeModifierQuery.second);
+    BOOST_CHECK_EQUAL(stakeModifierQuery.first, uint64_t(0));
+
+    // Running off the end of the chain depends on its tip, so it is not remembered
+    BOOST_CHECK_EQUAL(stakeModifierService_->getStakeModifier(fromHeight(48)).first, uint64_t(0));
+    BOOST_CHECK_EQUAL(stakeModifierService_->size(), 1u);
+
+    getActiveChain().SetTip(originalTip);
+    BOOST_CHECK_EQUAL(stakeModifierService_->getStakeModifier(fromHeight(49)).first, stakeModifier);
+}
+
+BOOST_AUTO_TEST_CASE(willStartOverOnceFullAndNotRememberFailedLookups)
+{
+    Init(2);
+    stakeModifierService_->getStakeModifier(fromHeight(47));
+    stakeModifierService_->getStakeModifier(fromHeight(48));
+    BOOST_CHECK_EQUAL(stakeModifierService_->size(), 2u);
+    stakeModifierService_->getStakeModifier(fromHeight(48));
+    BOOST_CHECK_EQUAL(stakeModifierService_->size(), 2u);
+    stakeModifierService_->getStakeModifier(fromHeight(49));
+    BOOST_CHECK_EQUAL(stakeModifierService_->size(), 1u);
+
+    StakingData unknownBlock;
+    unknownBlock.blockHashOfFirstConfirmationBlock_ = uint256S("135bd924226929c2f4267f5e5c653d2a4ae0018187588dc1f016ceffe525fad2");
+    BOOST_CHECK(!stakeModifierService_->getStakeModifier(unknownBlock).second);
+    BOOST_CHECK_EQUAL(stakeModifierService_->size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+#include <CachingBlockDataReader.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <primitives/block.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class CountingBlockDataReader : public I_BlockDataReader
+{
+public:
+    mutable int nBlockReads;
+    mutable int nBlockUndoReads;
+
+    CountingBlockDataReader() : nBlockReads(0), nBlockUndoReads(0) {}
+
+    bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+    {
+        nBlockReads++;
+        if (blockIndex->nHeight < 0)
+            return false;
+        block = CBlock();
+        block.nNonce = blockIndex->nHeight;
+        return true;
+    }
+
+    bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const
+    {
+        nBlockUndoReads++;
+        blockUndo = CBlockUndo();
+        blockUndo.vtxundo.resize(blockIndex->nHeight);
+        return true;
+    }
+};
+
+class BlockIndices
+{
+    std::vector<uint256> hashes_;
+    std::vector<std::unique_ptr<CBlockIndex> > indices_;
+
+public:
+    explicit BlockIndices(int nBlocks)
+        : hashes_(nBlocks)
+        , indices_()
+    {
+        for (int nHeight = 0; nHeight < nBlocks; nHeight++) {
+            hashes_[nHeight] = uint256(nHeight + 1);
+            indices_.push_back(std::unique_ptr<CBlockIndex>(new CBlockIndex()));
+            indices_.back()->phashBlock = &hashes_[nHeight];
+            indices_.back()->nHeight = nHeight;
+        }
+    }
+
+    const CBlockIndex* operator[](int nHeight) const { return indices_[nHeight].get(); }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(CachingBlockDataReader_tests)
+
+BOOST_AUTO_TEST_CASE(willReadEachBlockOnceWhileItStaysCached)
+{
+    CountingBlockDataReader diskReader;
+    CachingBlockDataReader reader(diskReader, 4);
+    BlockIndices indices(3);
+
+    CachingBlockDataReader::BlockRef block = reader.GetBlock(indices[1]);
+    BOOST_REQUIRE(block);
+    BOOST_CHECK_EQUAL(block->nNonce, 1u);
+    BOOST_CHECK(reader.GetBlock(indices[1]) == block);
+
+    CBlock copy;
+    BOOST_CHECK(reader.ReadBlock(indices[1], copy));
+    BOOST_CHECK(copy.GetHash() == block->GetHash());
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 1);
+
+    const BlockDataCacheStats stats = reader.GetStats();
+    BOOST_CHECK_EQUAL(stats.nCachedBlocks, 1u);
+    BOOST_CHECK_EQUAL(stats.nBlockHits, 2u);
+    BOOST_CHECK_EQUAL(stats.nBlockMisses, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willEvictTheLeastRecentlyUsedBlock)
+{
+    CountingBlockDataReader diskReader;
+    CachingBlockDataReader reader(diskReader, 2);
+    BlockIndices indices(3);
+
+    CachingBlockDataReader::BlockRef evicted = reader.GetBlock(indices[0]);
+    reader.GetBlock(indices[1]);
+    reader.GetBlock(indices[1]);
+    reader.GetBlock(indices[2]);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 3);
+    BOOST_CHECK_EQUAL(reader.GetStats().nCachedBlocks, 2u);
+
+    reader.GetBlock(indices[1]);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 3);
+    reader.GetBlock(indices[0]);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 4);
+    // Evicted blocks stay valid for their readers.
+    BOOST_CHECK_EQUAL(evicted->nNonce, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willCacheUndoDataSeparately)
+{
+    CountingBlockDataReader diskReader;
+    CachingBlockDataReader reader(diskReader, 2);
+    BlockIndices indices(3);
+
+    CBlockUndo blockUndo;
+    BOOST_CHECK(reader.ReadBlockUndo(indices[2], blockUndo));
+    BOOST_CHECK_EQUAL(blockUndo.vtxundo.size(), 2u);
+    BOOST_CHECK(reader.GetBlockUndo(indices[2]));
+    BOOST_CHECK(reader.GetBlock(indices[2]));
+    BOOST_CHECK_EQUAL(diskReader.nBlockUndoReads, 1);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 1);
+
+    const BlockDataCacheStats stats = reader.GetStats();
+    BOOST_CHECK_EQUAL(stats.nCachedBlockUndos, 1u);
+    BOOST_CHECK_EQUAL(stats.nBlockUndoHits, 1u);
+    BOOST_CHECK_EQUAL(stats.nBlockUndoMisses, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotCacheFailedReads)
+{
+    CountingBlockDataReader diskReader;
+    CachingBlockDataReader reader(diskReader, 2);
+    uint256 hash(7);
+    CBlockIndex unreadable;
+    unreadable.phashBlock = &hash;
+    unreadable.nHeight = -1;
+
+    BOOST_CHECK(!reader.GetBlock(&unreadable));
+    CBlock block;
+    BOOST_CHECK(!reader.ReadBlock(&unreadable, block));
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 2);
+    BOOST_CHECK_EQUAL(reader.GetStats().nCachedBlocks, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willReadThroughWhenClearedOrSizedZero)
+{
+    CountingBlockDataReader diskReader;
+    CachingBlockDataReader reader(diskReader, 0);
+    BlockIndices indices(1);
+    reader.GetBlock(indices[0]);
+    reader.GetBlock(indices[0]);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 2);
+
+    CachingBlockDataReader cleared(diskReader, 2);
+    cleared.GetBlock(indices[0]);
+    cleared.Clear();
+    cleared.GetBlock(indices[0]);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
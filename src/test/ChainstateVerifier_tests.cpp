@@ -0,0 +1,219 @@
+#include <ChainstateVerifier.h>
+
+#include <ActiveChainManager.h>
+#include <BlockUndo.h>
+#include <chain.h>
+#include <coins.h>
+#include <I_BlockDataReader.h>
+#include <primitives/block.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class InMemoryCoinsView : public CCoinsView
+{
+    uint256 hashBestBlock_;
+    std::map<uint256, CCoins> map_;
+
+public:
+    InMemoryCoinsView() : hashBestBlock_(0), map_() {}
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const
+    {
+        std::map<uint256, CCoins>::const_iterator it = map_.find(txid);
+        if (it == map_.end())
+            return false;
+        coins = it->second;
+        return true;
+    }
+
+    bool HaveCoins(const uint256& txid) const
+    {
+        return map_.count(txid) > 0;
+    }
+
+    uint256 GetBestBlock() const { return hashBestBlock_; }
+
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+    {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
+            if (it->second.coins.IsPruned())
+                map_.erase(it->first);
+            else
+                map_[it->first] = it->second.coins;
+            mapCoins.erase(it++);
+        }
+        if (hashBlock != uint256(0))
+            hashBestBlock_ = hashBlock;
+        return true;
+    }
+};
+
+class InMemoryBlockDataReader : public I_BlockDataReader
+{
+public:
+    std::map<const CBlockIndex*, CBlock> blocks;
+
+    bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+    {
+        std::map<const CBlockIndex*, CBlock>::const_iterator it = blocks.find(blockIndex);
+        if (it == blocks.end())
+            return false;
+        block = it->second;
+        return true;
+    }
+
+    bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const
+    {
+        // Coinbase-only blocks have no undo entries.
+        blockUndo = CBlockUndo();
+        return blocks.count(blockIndex) > 0;
+    }
+};
+
+bool AcceptAnyBlock(const CBlock&)
+{
+    return true;
+}
+
+bool RejectAnyBlock(const CBlock&)
+{
+    return false;
+}
+
+/** A chain of coinbase-only blocks along with the coins they leave behind */
+class ChainOfCoinbases
+{
+public:
+    std::vector<uint256> hashes;
+    std::vector<std::unique_ptr<CBlockIndex> > indices;
+    InMemoryBlockDataReader reader;
+    std::shared_ptr<InMemoryCoinsView> coins;
+
+    explicit ChainOfCoinbases(int nBlocks)
+        : hashes(nBlocks + 1)
+        , indices()
+        , reader()
+        , coins(new InMemoryCoinsView())
+    {
+        CCoinsViewCache cache(coins.get());
+        for (int nHeight = 0; nHeight <= nBlocks; nHeight++) {
+            CMutableTransaction coinbase;
+            coinbase.vin.resize(1);
+            coinbase.vin[0].prevout.SetNull();
+            coinbase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+            coinbase.vout.resize(1);
+            coinbase.vout[0].nValue = 50 + nHeight;
+            coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+            CBlock block;
+            block.vtx.push_back(CTransaction(coinbase));
+            block.nTime = nHeight;
+            hashes[nHeight] = block.GetHash();
+            indices.push_back(std::unique_ptr<CBlockIndex>(new CBlockIndex()));
+            CBlockIndex* pindex = indices.back().get();
+            pindex->phashBlock = &hashes[nHeight];
+            pindex->nHeight = nHeight;
+            pindex->pprev = nHeight > 0 ? indices[nHeight - 1].get() : NULL;
+            reader.blocks[pindex] = block;
+
+            *cache.ModifyCoins(block.vtx[0].GetHash()) = CCoins(block.vtx[0], nHeight);
+        }
+        cache.SetBestBlock(hashes.back());
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    CBlockIndex* Tip() const { return indices.back().get(); }
+
+    CoinsSnapshot Snapshot() const
+    {
+        CoinsSnapshot snapshot;
+        snapshot.view = std::shared_ptr<CCoinsView>(new InMemoryCoinsView(*coins));
+        snapshot.hashBlock = hashes.back();
+        snapshot.nHeight = Tip()->nHeight;
+        return snapshot;
+    }
+};
+
+const bool fAddressIndexDisabled = false;
+const unsigned maxCachedCoins = 5000;
+}
+
+BOOST_AUTO_TEST_SUITE(ChainstateVerifier_tests)
+
+BOOST_AUTO_TEST_CASE(willPassConsistentCoinsAndReportProgress)
+{
+    ChainOfCoinbases chain(10);
+    ActiveChainManager chainManager(fAddressIndexDisabled, NULL, chain.reader);
+    ChainstateVerifier verifier(&AcceptAnyBlock, maxCachedCoins);
+    BOOST_CHECK_EQUAL(verifier.GetProgress().state, ChainstateVerificationProgress::NOT_STARTED);
+
+    BOOST_CHECK(verifier.Verify(chainManager, chain.reader, chain.Snapshot(), chain.Tip(), 4));
+
+    const ChainstateVerificationProgress progress = verifier.GetProgress();
+    BOOST_CHECK_EQUAL(progress.state, ChainstateVerificationProgress::PASSED);
+    BOOST_CHECK_EQUAL(progress.nTipHeight, 10);
+    BOOST_CHECK_EQUAL(progress.nBlocksToCheck, 4);
+    BOOST_CHECK_EQUAL(progress.nBlocksChecked, 4);
+    BOOST_CHECK_EQUAL(progress.nTransactionsChecked, 4u);
+    BOOST_CHECK_EQUAL(progress.GetFractionChecked(), 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(willCheckTheWholeChainWhenDepthIsZero)
+{
+    ChainOfCoinbases chain(6);
+    ActiveChainManager chainManager(fAddressIndexDisabled, NULL, chain.reader);
+    ChainstateVerifier verifier(&AcceptAnyBlock, maxCachedCoins);
+
+    BOOST_CHECK(verifier.Verify(chainManager, chain.reader, chain.Snapshot(), chain.Tip(), 0));
+    BOOST_CHECK_EQUAL(verifier.GetProgress().nBlocksChecked, 6);
+}
+
+BOOST_AUTO_TEST_CASE(willFailWhenCoinsDisagreeWithTheBlocks)
+{
+    ChainOfCoinbases chain(10);
+    {
+        CCoinsViewCache cache(chain.coins.get());
+        const CBlock& block = chain.reader.blocks[chain.indices[8].get()];
+        CCoinsModifier coins = cache.ModifyCoins(block.vtx[0].GetHash());
+        coins->vout[0].nValue += 1;
+        BOOST_REQUIRE(cache.Flush());
+    }
+    ActiveChainManager chainManager(fAddressIndexDisabled, NULL, chain.reader);
+    ChainstateVerifier verifier(&AcceptAnyBlock, maxCachedCoins);
+
+    BOOST_CHECK(!verifier.Verify(chainManager, chain.reader, chain.Snapshot(), chain.Tip(), 5));
+
+    const ChainstateVerificationProgress progress = verifier.GetProgress();
+    BOOST_CHECK_EQUAL(progress.state, ChainstateVerificationProgress::FAILED);
+    BOOST_CHECK_EQUAL(progress.nBlocksChecked, 2);
+    BOOST_CHECK(!progress.strError.empty());
+}
+
+BOOST_AUTO_TEST_CASE(willFailOnBlocksThatDoNotPassTheBlockCheck)
+{
+    ChainOfCoinbases chain(3);
+    ActiveChainManager chainManager(fAddressIndexDisabled, NULL, chain.reader);
+    ChainstateVerifier verifier(&RejectAnyBlock, maxCachedCoins);
+
+    BOOST_CHECK(!verifier.Verify(chainManager, chain.reader, chain.Snapshot(), chain.Tip(), 3));
+    BOOST_CHECK_EQUAL(verifier.GetProgress().state, ChainstateVerificationProgress::FAILED);
+    BOOST_CHECK_EQUAL(verifier.GetProgress().nBlocksChecked, 0);
+}
+
+BOOST_AUTO_TEST_CASE(willFailOnSnapshotsOfAnotherBlock)
+{
+    ChainOfCoinbases chain(3);
+    ActiveChainManager chainManager(fAddressIndexDisabled, NULL, chain.reader);
+    ChainstateVerifier verifier(&AcceptAnyBlock, maxCachedCoins);
+
+    BOOST_CHECK(!verifier.Verify(chainManager, chain.reader, chain.Snapshot(), chain.indices[2].get(), 2));
+    BOOST_CHECK_EQUAL(verifier.GetProgress().state, ChainstateVerificationProgress::FAILED);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -138,6 +138,7 @@ BOOST_AUTO_TEST_CASE(willNotFailDueToLackOfCheckpoints)
     BOOST_CHECK(checkpointsService.GetTotalBlocksEstimate()==0);
     BOOST_CHECK(checkpointsService.GuessVerificationProgress(nullptr)==0.0);
     BOOST_CHECK(checkpointsService.GetLastCheckpoint(map)==nullptr);
+    BOOST_CHECK(checkpointsService.GetLastCheckpointHash()==uint256(0));
 }
 
 
@@ -156,6 +157,15 @@ BOOST_AUTO_TEST_CASE(willFindLargestHeightAmongstCheckpoints)
     BOOST_CHECK(checkpointsService.GetTotalBlocksEstimate()==highestBlockInCheckpoints);
 }
 
+BOOST_AUTO_TEST_CASE(willFindHashOfLargestHeightAmongstCheckpoints)
+{
+    unsigned checkpointCount = static_cast<unsigned>(abs(GetRandInt(25)))+10u;
+    TestCase testSetup(checkpointCount);
+    CCheckpointServices checkpointsService( testSetup.checkpoint_data() );
+
+    BOOST_CHECK(checkpointsService.GetLastCheckpointHash()==testSetup.mapCheckpoints_.rbegin()->second);
+}
+
 
 BOOST_AUTO_TEST_CASE(willFindCorrectBlockInMap)
 {
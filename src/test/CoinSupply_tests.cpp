@@ -0,0 +1,147 @@
+#include <CoinSupply.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <script/StakingVaultScript.h>
+#include <streams.h>
+#include <undo.h>
+#include <version.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+const CAmount collateral = 1000;
+
+CScript VaultScript()
+{
+    return CreateStakingVaultScript(valtype(20, 0x01), valtype(20, 0x02));
+}
+
+CScript PlainScript()
+{
+    return CScript() << OP_TRUE;
+}
+
+class CoinSupplyFixture
+{
+public:
+    std::set<CAmount> collateralAmounts;
+    uint256 genesisHash;
+    uint256 firstHash;
+    uint256 secondHash;
+    CBlockIndex genesisIndex;
+    CBlockIndex firstIndex;
+    CBlockIndex secondIndex;
+    CBlock firstBlock;
+    CBlock secondBlock;
+    CBlockUndo secondBlockUndo;
+
+    CoinSupplyFixture(
+        ): collateralAmounts()
+        , genesisHash(1)
+        , firstHash(2)
+        , secondHash(3)
+        , genesisIndex()
+        , firstIndex()
+        , secondIndex()
+        , firstBlock()
+        , secondBlock()
+        , secondBlockUndo()
+    {
+        collateralAmounts.insert(collateral);
+        genesisIndex.phashBlock = &genesisHash;
+        firstIndex.phashBlock = &firstHash;
+        firstIndex.pprev = &genesisIndex;
+        firstIndex.nHeight = 1;
+        firstIndex.nMoneySupply = 5000;
+        secondIndex.phashBlock = &secondHash;
+        secondIndex.pprev = &firstIndex;
+        secondIndex.nHeight = 2;
+        secondIndex.nMoneySupply = 5100;
+
+        // Pays a vault 300, a collateral and 20 to a data output
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.emplace_back(300, VaultScript());
+        coinbase.vout.emplace_back(collateral, PlainScript());
+        coinbase.vout.emplace_back(20, CScript() << OP_META << std::vector<unsigned char>(4, 0x42));
+        coinbase.vout.emplace_back(3680, PlainScript());
+        firstBlock.vtx.push_back(CTransaction(coinbase));
+
+        // Moves 100 out of the vault, and the collateral to an amount that is none
+        CMutableTransaction secondCoinbase;
+        secondCoinbase.vin.resize(1);
+        secondCoinbase.vout.emplace_back(100, PlainScript());
+        secondBlock.vtx.push_back(CTransaction(secondCoinbase));
+        CMutableTransaction spend;
+        spend.vin.resize(2);
+        spend.vin[0].prevout = COutPoint(firstBlock.vtx[0].GetHash(), 0);
+        spend.vin[1].prevout = COutPoint(firstBlock.vtx[0].GetHash(), 1);
+        spend.vout.emplace_back(200, VaultScript());
+        spend.vout.emplace_back(1100, PlainScript());
+        secondBlock.vtx.push_back(CTransaction(spend));
+        secondBlockUndo.vtxundo.resize(1);
+        secondBlockUndo.vtxundo[0].vprevout.push_back(CTxInUndo(firstBlock.vtx[0].vout[0]));
+        secondBlockUndo.vtxundo[0].vprevout.push_back(CTxInUndo(firstBlock.vtx[0].vout[1]));
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(CoinSupply_tests, CoinSupplyFixture)
+
+BOOST_AUTO_TEST_CASE(willAddTheOutputsOfABlockToThoseOfItsParent)
+{
+    const CoinSupply supply(CoinSupply(genesisHash), firstBlock, CBlockUndo(), firstIndex, collateralAmounts);
+    BOOST_CHECK(supply.blockHash == firstHash);
+    BOOST_CHECK_EQUAL(supply.nHeight, 1);
+    BOOST_CHECK_EQUAL(supply.nMoneySupply, 5000);
+    BOOST_CHECK_EQUAL(supply.nVaultValue, 300);
+    BOOST_CHECK_EQUAL(supply.nMasternodeCollateralValue, collateral);
+    BOOST_CHECK_EQUAL(supply.nUnspendableValue, 20);
+}
+
+BOOST_AUTO_TEST_CASE(willTakeTheSpentOutputsBackOut)
+{
+    const CoinSupply first(CoinSupply(genesisHash), firstBlock, CBlockUndo(), firstIndex, collateralAmounts);
+    const CoinSupply second(first, secondBlock, secondBlockUndo, secondIndex, collateralAmounts);
+    BOOST_CHECK_EQUAL(second.nMoneySupply, 5100);
+    BOOST_CHECK_EQUAL(second.nVaultValue, 200);
+    BOOST_CHECK_EQUAL(second.nMasternodeCollateralValue, 0);
+    BOOST_CHECK_EQUAL(second.nUnspendableValue, 20);
+}
+
+BOOST_AUTO_TEST_CASE(willNotCountVaultsHoldingACollateralAmountAsCollateral)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(collateral, VaultScript());
+    CBlock block;
+    block.vtx.push_back(CTransaction(coinbase));
+
+    const CoinSupply supply(CoinSupply(genesisHash), block, CBlockUndo(), firstIndex, collateralAmounts);
+    BOOST_CHECK_EQUAL(supply.nVaultValue, collateral);
+    BOOST_CHECK_EQUAL(supply.nMasternodeCollateralValue, 0);
+}
+
+BOOST_AUTO_TEST_CASE(willSerializeEveryAmount)
+{
+    const CoinSupply supply(CoinSupply(genesisHash), firstBlock, CBlockUndo(), firstIndex, collateralAmounts);
+    CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+    stream << supply;
+    CoinSupply read;
+    stream >> read;
+    BOOST_CHECK(read.blockHash == supply.blockHash);
+    BOOST_CHECK_EQUAL(read.nHeight, supply.nHeight);
+    BOOST_CHECK_EQUAL(read.nMoneySupply, supply.nMoneySupply);
+    BOOST_CHECK_EQUAL(read.nVaultValue, supply.nVaultValue);
+    BOOST_CHECK_EQUAL(read.nMasternodeCollateralValue, supply.nMasternodeCollateralValue);
+    BOOST_CHECK_EQUAL(read.nUnspendableValue, supply.nUnspendableValue);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
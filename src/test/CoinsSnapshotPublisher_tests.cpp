@@ -0,0 +1,118 @@
+#include <CoinsSnapshotPublisher.h>
+
+#include <coins.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class InMemoryCoinsView : public CCoinsView
+{
+    uint256 hashBestBlock_;
+    std::map<uint256, CCoins> map_;
+
+public:
+    unsigned int snapshotsOpened;
+
+    InMemoryCoinsView() : hashBestBlock_(0), map_(), snapshotsOpened(0) {}
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const
+    {
+        std::map<uint256, CCoins>::const_iterator it = map_.find(txid);
+        if (it == map_.end())
+            return false;
+        coins = it->second;
+        return true;
+    }
+
+    bool HaveCoins(const uint256& txid) const
+    {
+        return map_.count(txid) > 0;
+    }
+
+    uint256 GetBestBlock() const { return hashBestBlock_; }
+
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+    {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
+            if (it->second.coins.IsPruned())
+                map_.erase(it->first);
+            else
+                map_[it->first] = it->second.coins;
+            mapCoins.erase(it++);
+        }
+        if (hashBlock != uint256(0))
+            hashBestBlock_ = hashBlock;
+        return true;
+    }
+
+    std::shared_ptr<CCoinsView> OpenSnapshot()
+    {
+        ++snapshotsOpened;
+        return std::shared_ptr<CCoinsView>(new InMemoryCoinsView(*this));
+    }
+};
+
+void ConnectBlock(CCoinsViewCache& tip)
+{
+    {
+        CCoinsModifier coins = tip.ModifyCoins(GetRandHash());
+        coins->vout.resize(1);
+        coins->vout[0].nValue = 1;
+        coins->vout[0].scriptPubKey = CScript() << OP_TRUE;
+    }
+    tip.SetBestBlock(GetRandHash());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(CoinsSnapshotPublisher_tests)
+
+BOOST_AUTO_TEST_CASE(willOnlyHandOutSnapshotsOfTheCurrentTip)
+{
+    InMemoryCoinsView database;
+    CCoinsViewCache tip(&database);
+    CoinsSnapshotPublisher publisher;
+    ConnectBlock(tip);
+
+    CoinsSnapshot snapshot;
+    BOOST_CHECK(!publisher.GetLatest(snapshot));
+    BOOST_CHECK(publisher.Publish(tip, 1, snapshot));
+    BOOST_CHECK(snapshot.hashBlock == tip.GetBestBlock());
+    BOOST_CHECK_EQUAL(snapshot.nHeight, 1);
+
+    CoinsSnapshot latest;
+    BOOST_CHECK(publisher.GetLatest(latest));
+    BOOST_CHECK(latest.view == snapshot.view);
+
+    publisher.Clear();
+    BOOST_CHECK(!publisher.GetLatest(latest));
+}
+
+BOOST_AUTO_TEST_CASE(willRepublishOnTipChangesOnlyWhileSnapshotsAreRead)
+{
+    InMemoryCoinsView database;
+    CCoinsViewCache tip(&database);
+    CoinsSnapshotPublisher publisher;
+    ConnectBlock(tip);
+    CoinsSnapshot snapshot;
+    BOOST_CHECK(publisher.Publish(tip, 1, snapshot));
+
+    ConnectBlock(tip);
+    publisher.TipChanged(tip, 2);
+    BOOST_CHECK_EQUAL(database.snapshotsOpened, 1u);
+    BOOST_CHECK(!publisher.GetLatest(snapshot));
+
+    ConnectBlock(tip);
+    publisher.TipChanged(tip, 3);
+    BOOST_CHECK_EQUAL(database.snapshotsOpened, 2u);
+    BOOST_CHECK(publisher.GetLatest(snapshot));
+    BOOST_CHECK_EQUAL(snapshot.nHeight, 3);
+    BOOST_CHECK(snapshot.hashBlock == tip.GetBestBlock());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
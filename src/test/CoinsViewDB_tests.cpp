@@ -0,0 +1,174 @@
+#include <txdb.h>
+
+#include <coins.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CCoins CoinsWithOutputs(unsigned int nOutputs, int nHeight)
+{
+    CCoins coins;
+    coins.nHeight = nHeight;
+    coins.nVersion = 1;
+    coins.fCoinStake = nHeight % 2 == 0;
+    coins.vout.resize(nOutputs);
+    for (unsigned int i = 0; i < nOutputs; i++) {
+        coins.vout[i].nValue = 1000 * (i + 1);
+        coins.vout[i].scriptPubKey = CScript() << OP_TRUE;
+    }
+    return coins;
+}
+
+//! Gives the tests access to the database, to store entries the way older versions did
+class TestCoinsViewDB : public CCoinsViewDB
+{
+public:
+    TestCoinsViewDB() : CCoinsViewDB(1 << 20, true) {}
+
+    void WriteCoins(const uint256& txid, const CCoins& coins)
+    {
+        CCoinsMap mapCoins;
+        CCoinsCacheEntry& entry = mapCoins[txid];
+        entry.coins = coins;
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        BOOST_REQUIRE(BatchWrite(mapCoins, uint256(0)));
+    }
+
+    void WritePerTransactionEntry(const uint256& txid, const CCoins& coins)
+    {
+        CLevelDBBatch batch;
+        batch.Write('F', 0);
+        batch.Write(std::make_pair('c', txid), coins);
+        db.WriteBatch(batch);
+    }
+
+    bool HavePerTransactionEntries() const
+    {
+        return HaveAnyEntries('c');
+    }
+
+    void Reopen()
+    {
+        LoadCoinsFormat();
+    }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(CoinsViewDB_tests)
+
+BOOST_AUTO_TEST_CASE(willReadBackWhatIsLeftOfPartlySpentTransactions)
+{
+    TestCoinsViewDB coinsDB;
+    const uint256 txid = GetRandHash();
+    const uint256 txidOther = GetRandHash();
+    coinsDB.WriteCoins(txid, CoinsWithOutputs(4, 10));
+    coinsDB.WriteCoins(txidOther, CoinsWithOutputs(2, 11));
+
+    CCoins coins;
+    {
+        CCoinsViewCache cache(&coinsDB);
+        {
+            CCoinsModifier modifier = cache.ModifyCoins(txid);
+            BOOST_CHECK(*modifier == CoinsWithOutputs(4, 10));
+            modifier->Spend(1);
+            modifier->Spend(3);
+        }
+        BOOST_REQUIRE(cache.GetCoins(txid, coins));
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    CCoins readBack;
+    BOOST_REQUIRE(coinsDB.GetCoins(txid, readBack));
+    BOOST_CHECK(readBack == coins);
+    BOOST_CHECK_EQUAL(readBack.vout.size(), 3u);
+    BOOST_CHECK(readBack.IsAvailable(0) && !readBack.IsAvailable(1) && readBack.IsAvailable(2));
+    BOOST_CHECK(coinsDB.GetCoins(txidOther, readBack));
+    BOOST_CHECK(readBack == CoinsWithOutputs(2, 11));
+
+    {
+        CCoinsViewCache cache(&coinsDB);
+        {
+            CCoinsModifier modifier = cache.ModifyCoins(txid);
+            modifier->Spend(0);
+            modifier->Spend(2);
+        }
+        BOOST_REQUIRE(cache.Flush());
+    }
+    BOOST_CHECK(!coinsDB.HaveCoins(txid));
+    BOOST_CHECK(!coinsDB.GetCoins(txid, readBack));
+    BOOST_CHECK(coinsDB.HaveCoins(txidOther));
+}
+
+BOOST_AUTO_TEST_CASE(willWriteBackOutputsSpentAndRestoredInTheCache)
+{
+    TestCoinsViewDB coinsDB;
+    const uint256 txid = GetRandHash();
+    coinsDB.WriteCoins(txid, CoinsWithOutputs(3, 10));
+    {
+        CCoinsViewCache cache(&coinsDB);
+        {
+            CCoinsModifier modifier = cache.ModifyCoins(txid);
+            modifier->Spend(0);
+            modifier->Spend(2);
+        }
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    // Outputs made unspent again, as when disconnecting the block that spent them
+    CCoinsViewCache cache(&coinsDB);
+    {
+        CCoinsModifier modifier = cache.ModifyCoins(txid);
+        *modifier = CoinsWithOutputs(3, 10);
+        modifier->Spend(1);
+    }
+    BOOST_REQUIRE(cache.Flush());
+
+    CCoins expected = CoinsWithOutputs(3, 10);
+    expected.Spend(1);
+    CCoins coins;
+    BOOST_REQUIRE(coinsDB.GetCoins(txid, coins));
+    BOOST_CHECK(coins == expected);
+}
+
+BOOST_AUTO_TEST_CASE(willRewriteTheOutputsOfReplacedTransactions)
+{
+    TestCoinsViewDB coinsDB;
+    const uint256 txid = GetRandHash();
+    coinsDB.WriteCoins(txid, CoinsWithOutputs(2, 10));
+    {
+        CCoinsViewCache cache(&coinsDB);
+        {
+            CCoinsModifier modifier = cache.ModifyCoins(txid);
+            *modifier = CoinsWithOutputs(3, 13);
+        }
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    CCoins coins;
+    BOOST_REQUIRE(coinsDB.GetCoins(txid, coins));
+    BOOST_CHECK(coins == CoinsWithOutputs(3, 13));
+}
+
+BOOST_AUTO_TEST_CASE(willSplitPerTransactionEntriesOfOlderDatabases)
+{
+    TestCoinsViewDB coinsDB;
+    const uint256 txid = GetRandHash();
+    CCoins original = CoinsWithOutputs(5, 20);
+    original.Spend(2);
+    coinsDB.WritePerTransactionEntry(txid, original);
+    coinsDB.Reopen();
+
+    CCoins coins;
+    BOOST_REQUIRE(coinsDB.GetCoins(txid, coins));
+    BOOST_CHECK(coins == original);
+    BOOST_CHECK(!coinsDB.HavePerTransactionEntries());
+    CCoinsStats stats;
+    BOOST_REQUIRE(coinsDB.GetStats(stats));
+    BOOST_CHECK_EQUAL(stats.nTransactions, 1u);
+    BOOST_CHECK_EQUAL(stats.nTransactionOutputs, 4u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
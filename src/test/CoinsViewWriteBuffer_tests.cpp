@@ -0,0 +1,250 @@
+#include <CoinsViewWriteBuffer.h>
+
+#include <coins.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <map>
+#include <memory>
+
+#include <boost/thread/mutex.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class InMemoryCoinsView : public CCoinsView
+{
+    uint256 hashBestBlock_;
+    std::map<uint256, CCoins> map_;
+
+public:
+    bool GetCoins(const uint256& txid, CCoins& coins) const
+    {
+        std::map<uint256, CCoins>::const_iterator it = map_.find(txid);
+        if (it == map_.end())
+            return false;
+        coins = it->second;
+        return true;
+    }
+
+    bool HaveCoins(const uint256& txid) const
+    {
+        return map_.count(txid) > 0;
+    }
+
+    uint256 GetBestBlock() const { return hashBestBlock_; }
+
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+    {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
+            if (it->second.coins.IsPruned())
+                map_.erase(it->first);
+            else
+                map_[it->first] = it->second.coins;
+            mapCoins.erase(it++);
+        }
+        if (hashBlock != uint256(0))
+            hashBestBlock_ = hashBlock;
+        return true;
+    }
+
+    std::shared_ptr<CCoinsView> OpenSnapshot()
+    {
+        return std::shared_ptr<CCoinsView>(new InMemoryCoinsView(*this));
+    }
+};
+
+//! Holds back writes for as long as the gate is locked
+class GatedCoinsView : public InMemoryCoinsView
+{
+public:
+    boost::mutex gate;
+
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+    {
+        boost::unique_lock<boost::mutex> lock(gate);
+        return InMemoryCoinsView::BatchWrite(mapCoins, hashBlock);
+    }
+};
+
+CCoins CoinsWithSingleOutput(CAmount value)
+{
+    CCoins coins;
+    coins.vout.resize(1);
+    coins.vout[0].nValue = value;
+    coins.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    return coins;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(CoinsViewWriteBuffer_tests)
+
+BOOST_AUTO_TEST_CASE(willCommitFlushedEntriesToBackingView)
+{
+    InMemoryCoinsView database;
+    uint256 txid = GetRandHash();
+    uint256 bestBlock = GetRandHash();
+    {
+        CoinsViewWriteBuffer writeBuffer(&database);
+        CCoinsViewCache tip(&writeBuffer);
+        *tip.ModifyCoins(txid) = CoinsWithSingleOutput(42);
+        tip.SetBestBlock(bestBlock);
+        BOOST_CHECK(tip.Flush());
+        BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+    }
+
+    CCoins coins;
+    BOOST_CHECK(database.GetCoins(txid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 42);
+    BOOST_CHECK(database.GetBestBlock() == bestBlock);
+}
+
+BOOST_AUTO_TEST_CASE(willCountFlushedEntriesUntilTheyAreCommitted)
+{
+    GatedCoinsView database;
+    CoinsViewWriteBuffer writeBuffer(&database);
+    const size_t nEmptyUsage = writeBuffer.DynamicMemoryUsage();
+    const CCoins coins = CoinsWithSingleOutput(3);
+    {
+        boost::unique_lock<boost::mutex> lock(database.gate);
+        CCoinsViewCache tip(&writeBuffer);
+        *tip.ModifyCoins(GetRandHash()) = coins;
+        BOOST_CHECK(tip.Flush());
+        BOOST_CHECK(writeBuffer.DynamicMemoryUsage() >= nEmptyUsage + coins.DynamicMemoryUsage());
+    }
+    BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+    BOOST_CHECK_EQUAL(writeBuffer.DynamicMemoryUsage(), nEmptyUsage);
+}
+
+BOOST_AUTO_TEST_CASE(willServeFlushedEntriesIndependentlyOfWriterProgress)
+{
+    InMemoryCoinsView database;
+    CoinsViewWriteBuffer writeBuffer(&database);
+    CCoinsViewCache tip(&writeBuffer);
+
+    uint256 txid = GetRandHash();
+    uint256 bestBlock = GetRandHash();
+    *tip.ModifyCoins(txid) = CoinsWithSingleOutput(7);
+    tip.SetBestBlock(bestBlock);
+    BOOST_CHECK(tip.Flush());
+
+    CCoinsViewCache reader(&writeBuffer);
+    BOOST_CHECK(reader.HaveCoins(txid));
+    BOOST_CHECK_EQUAL(reader.AccessCoins(txid)->vout[0].nValue, 7);
+    BOOST_CHECK(reader.GetBestBlock() == bestBlock);
+}
+
+BOOST_AUTO_TEST_CASE(willNotResurrectSpentEntries)
+{
+    InMemoryCoinsView database;
+    CoinsViewWriteBuffer writeBuffer(&database);
+    uint256 txid = GetRandHash();
+    {
+        CCoinsViewCache tip(&writeBuffer);
+        *tip.ModifyCoins(txid) = CoinsWithSingleOutput(5);
+        BOOST_CHECK(tip.Flush());
+    }
+    BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+    {
+        CCoinsViewCache tip(&writeBuffer);
+        BOOST_CHECK(tip.ModifyCoins(txid)->Spend(0));
+        BOOST_CHECK(tip.Flush());
+    }
+
+    BOOST_CHECK(!writeBuffer.HaveCoins(txid));
+    BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+    BOOST_CHECK(!database.HaveCoins(txid));
+}
+
+BOOST_AUTO_TEST_CASE(willServeBatchedLookupsFromBufferAndBackingView)
+{
+    InMemoryCoinsView database;
+    CoinsViewWriteBuffer writeBuffer(&database);
+    uint256 writtenTxid = GetRandHash();
+    uint256 bufferedTxid = GetRandHash();
+    {
+        CCoinsViewCache tip(&writeBuffer);
+        *tip.ModifyCoins(writtenTxid) = CoinsWithSingleOutput(1);
+        BOOST_CHECK(tip.Flush());
+    }
+    BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+    {
+        CCoinsViewCache tip(&writeBuffer);
+        *tip.ModifyCoins(bufferedTxid) = CoinsWithSingleOutput(2);
+        BOOST_CHECK(tip.Flush());
+    }
+
+    std::vector<uint256> txids;
+    txids.push_back(bufferedTxid);
+    txids.push_back(GetRandHash());
+    txids.push_back(writtenTxid);
+    std::vector<std::pair<uint256, CCoins> > found;
+    writeBuffer.GetCoinsBatch(txids, found);
+    BOOST_REQUIRE_EQUAL(found.size(), 2u);
+    std::map<uint256, CAmount> values;
+    for (unsigned int i = 0; i < found.size(); i++)
+        values[found[i].first] = found[i].second.vout[0].nValue;
+    BOOST_CHECK_EQUAL(values[writtenTxid], 1);
+    BOOST_CHECK_EQUAL(values[bufferedTxid], 2);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepShowingSnapshotStateWhileTheBufferMovesOn)
+{
+    InMemoryCoinsView database;
+    CoinsViewWriteBuffer writeBuffer(&database);
+    uint256 spentTxid = GetRandHash();
+    uint256 createdTxid = GetRandHash();
+    uint256 firstBlock = GetRandHash();
+    {
+        CCoinsViewCache tip(&writeBuffer);
+        *tip.ModifyCoins(spentTxid) = CoinsWithSingleOutput(3);
+        tip.SetBestBlock(firstBlock);
+        BOOST_CHECK(tip.Flush());
+    }
+    std::shared_ptr<CCoinsView> snapshot = writeBuffer.OpenSnapshot();
+    BOOST_REQUIRE(snapshot);
+    {
+        CCoinsViewCache tip(&writeBuffer);
+        BOOST_CHECK(tip.ModifyCoins(spentTxid)->Spend(0));
+        *tip.ModifyCoins(createdTxid) = CoinsWithSingleOutput(4);
+        tip.SetBestBlock(GetRandHash());
+        BOOST_CHECK(tip.Flush());
+    }
+    BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+
+    CCoins coins;
+    BOOST_CHECK(snapshot->GetCoins(spentTxid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 3);
+    BOOST_CHECK(!snapshot->HaveCoins(createdTxid));
+    BOOST_CHECK(snapshot->GetBestBlock() == firstBlock);
+    BOOST_CHECK(!writeBuffer.HaveCoins(spentTxid));
+    BOOST_CHECK(writeBuffer.HaveCoins(createdTxid));
+}
+
+BOOST_AUTO_TEST_CASE(willHandDirtyTipEntriesToSnapshotsWithoutEvictingThem)
+{
+    InMemoryCoinsView database;
+    CoinsViewWriteBuffer writeBuffer(&database);
+    CCoinsViewCache tip(&writeBuffer);
+    uint256 txid = GetRandHash();
+    uint256 bestBlock = GetRandHash();
+    *tip.ModifyCoins(txid) = CoinsWithSingleOutput(9);
+    tip.SetBestBlock(bestBlock);
+
+    std::shared_ptr<CCoinsView> snapshot = tip.OpenSnapshot();
+    BOOST_REQUIRE(snapshot);
+    BOOST_CHECK_EQUAL(tip.GetCacheSize(), 1u);
+    BOOST_CHECK(tip.ModifyCoins(txid)->Spend(0));
+
+    CCoins coins;
+    BOOST_CHECK(snapshot->GetCoins(txid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 9);
+    BOOST_CHECK(snapshot->GetBestBlock() == bestBlock);
+    BOOST_CHECK(tip.Flush());
+    BOOST_CHECK(writeBuffer.WaitForPendingWrites());
+    BOOST_CHECK(!database.HaveCoins(txid));
+    BOOST_CHECK(snapshot->HaveCoins(txid));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
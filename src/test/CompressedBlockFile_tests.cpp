@@ -0,0 +1,125 @@
+#include <CompressedBlockFile.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class TemporaryFiles
+{
+    const boost::filesystem::path directory_;
+
+public:
+    TemporaryFiles()
+        : directory_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+    {
+        boost::filesystem::create_directories(directory_);
+    }
+
+    ~TemporaryFiles()
+    {
+        boost::filesystem::remove_all(directory_);
+    }
+
+    boost::filesystem::path Write(const std::string& name, const std::string& contents) const
+    {
+        const boost::filesystem::path path = directory_ / name;
+        FILE* file = fopen(path.string().c_str(), "wb");
+        BOOST_REQUIRE(file != NULL);
+        BOOST_REQUIRE_EQUAL(fwrite(contents.data(), 1, contents.size(), file), contents.size());
+        fclose(file);
+        return path;
+    }
+
+    boost::filesystem::path Path(const std::string& name) const { return directory_ / name; }
+};
+
+std::string SomeBlockFileContents(size_t nSize)
+{
+    std::string contents(nSize, '\0');
+    for (size_t n = 0; n < nSize; n++)
+        contents[n] = (n % 7 == 0) ? (char)(n * 31) : 'a' + n % 3;
+    return contents;
+}
+
+std::string ReadBack(const CompressedBlockFile& file, uint64_t nPos, size_t nSize)
+{
+    std::vector<char> buf(nSize);
+    const int64_t nRead = file.Read(nPos, buf.data(), nSize);
+    BOOST_REQUIRE(nRead >= 0);
+    return std::string(buf.data(), nRead);
+}
+
+const uint32_t nChunkSize = 1000;
+}
+
+BOOST_AUTO_TEST_SUITE(CompressedBlockFile_tests)
+
+BOOST_AUTO_TEST_CASE(willReadBackAnyRangeOfTheOriginal)
+{
+    if (!CompressedBlockFile::IsSupported())
+        return;
+    TemporaryFiles files;
+    const std::string original = SomeBlockFileContents(5500);
+    BOOST_REQUIRE(CompressedBlockFile::Compress(files.Write("blk00000.dat", original), files.Path("blk00000.dat.z"), nChunkSize));
+
+    std::shared_ptr<const CompressedBlockFile> compressed = CompressedBlockFile::Open(files.Path("blk00000.dat.z"));
+    BOOST_REQUIRE(compressed);
+    BOOST_CHECK_EQUAL(compressed->GetOriginalSize(), original.size());
+    BOOST_CHECK(boost::filesystem::file_size(files.Path("blk00000.dat.z")) < original.size());
+    BOOST_CHECK(ReadBack(*compressed, 0, original.size()) == original);
+    BOOST_CHECK(ReadBack(*compressed, 990, 2020) == original.substr(990, 2020));
+    BOOST_CHECK(ReadBack(*compressed, 5000, 1000) == original.substr(5000));
+    BOOST_CHECK(ReadBack(*compressed, 5500, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(willReadTheOriginalThroughAStream)
+{
+    if (!CompressedBlockFile::IsSupported())
+        return;
+    TemporaryFiles files;
+    const std::string original = SomeBlockFileContents(3210);
+    BOOST_REQUIRE(CompressedBlockFile::Compress(files.Write("blk00001.dat", original), files.Path("blk00001.dat.z"), nChunkSize));
+
+    FILE* stream = CompressedBlockFile::OpenAsStream(files.Path("blk00001.dat.z"));
+    BOOST_REQUIRE(stream != NULL);
+    std::vector<char> buf(1500);
+    BOOST_REQUIRE_EQUAL(fseek(stream, 1700, SEEK_SET), 0);
+    BOOST_CHECK_EQUAL(ftell(stream), 1700);
+    BOOST_REQUIRE_EQUAL(fread(buf.data(), 1, buf.size(), stream), buf.size());
+    BOOST_CHECK(std::string(buf.data(), buf.size()) == original.substr(1700, 1500));
+    BOOST_CHECK_EQUAL(fread(buf.data(), 1, buf.size(), stream), 10u);
+    BOOST_CHECK(feof(stream));
+    BOOST_REQUIRE_EQUAL(fseek(stream, -10, SEEK_END), 0);
+    BOOST_CHECK_EQUAL(fread(buf.data(), 1, buf.size(), stream), 10u);
+    BOOST_CHECK(fwrite(buf.data(), 1, 1, stream) != 1 || fflush(stream) != 0);
+    fclose(stream);
+}
+
+BOOST_AUTO_TEST_CASE(willCompressEmptyFiles)
+{
+    if (!CompressedBlockFile::IsSupported())
+        return;
+    TemporaryFiles files;
+    BOOST_REQUIRE(CompressedBlockFile::Compress(files.Write("blk00002.dat", ""), files.Path("blk00002.dat.z"), nChunkSize));
+    std::shared_ptr<const CompressedBlockFile> compressed = CompressedBlockFile::Open(files.Path("blk00002.dat.z"));
+    BOOST_REQUIRE(compressed);
+    BOOST_CHECK_EQUAL(compressed->GetOriginalSize(), 0u);
+    BOOST_CHECK(ReadBack(*compressed, 0, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(willRefuseFilesThatAreNotCompressedBlockFiles)
+{
+    TemporaryFiles files;
+    BOOST_CHECK(!CompressedBlockFile::Open(files.Write("blk00003.dat.z", SomeBlockFileContents(100))));
+    BOOST_CHECK(!CompressedBlockFile::Open(files.Path("missing.dat.z")));
+    BOOST_CHECK(CompressedBlockFile::OpenAsStream(files.Path("missing.dat.z")) == NULL);
+    BOOST_CHECK(!CompressedBlockFile::Compress(files.Path("missing.dat"), files.Path("missing.dat.z"), nChunkSize));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
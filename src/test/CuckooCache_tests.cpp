@@ -0,0 +1,81 @@
+#include <CuckooCache.h>
+
+#include <hash.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+typedef CuckooCache<uint256, SaltedHashHasher> TestCache;
+
+std::vector<uint256> Entries(uint32_t first, uint32_t count)
+{
+    std::vector<uint256> entries;
+    for (uint32_t i = first; i < first + count; i++)
+        entries.push_back(Hash(BEGIN(i), END(i)));
+    return entries;
+}
+
+double ContainedFraction(const TestCache& cache, const std::vector<uint256>& entries)
+{
+    unsigned int contained = 0;
+    for (unsigned int i = 0; i < entries.size(); i++)
+        contained += cache.Contains(entries[i], false);
+    return (double)contained / entries.size();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(CuckooCache_tests)
+
+BOOST_AUTO_TEST_CASE(willContainWhatWasInsertedWhileThereIsRoom)
+{
+    TestCache cache;
+    BOOST_CHECK_EQUAL(cache.SetupBytes(4096 * sizeof(uint256)), 4096u);
+    const std::vector<uint256> inserted = Entries(0, 1000);
+    for (unsigned int i = 0; i < inserted.size(); i++)
+        cache.Insert(inserted[i]);
+
+    BOOST_CHECK_EQUAL(ContainedFraction(cache, inserted), 1.0);
+    BOOST_CHECK_EQUAL(ContainedFraction(cache, Entries(1000, 1000)), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepTheRecentInsertsOnceFull)
+{
+    TestCache cache;
+    const uint32_t size = cache.Setup(4096);
+    const std::vector<uint256> inserted = Entries(0, 4 * size);
+    for (unsigned int i = 0; i < inserted.size(); i++)
+        cache.Insert(inserted[i]);
+
+    const std::vector<uint256> recent(inserted.end() - size / 4, inserted.end());
+    const std::vector<uint256> oldest(inserted.begin(), inserted.begin() + size);
+    BOOST_CHECK_GE(ContainedFraction(cache, recent), 0.95);
+    BOOST_CHECK_LE(ContainedFraction(cache, oldest), 0.05);
+}
+
+BOOST_AUTO_TEST_CASE(willOverwriteErasedEntriesBeforeOthers)
+{
+    TestCache cache;
+    const uint32_t size = cache.Setup(4096);
+    const std::vector<uint256> erased = Entries(0, size / 5);
+    const std::vector<uint256> kept = Entries(size / 5, size / 5);
+    for (unsigned int i = 0; i < erased.size(); i++)
+        cache.Insert(erased[i]);
+    for (unsigned int i = 0; i < kept.size(); i++)
+        cache.Insert(kept[i]);
+    for (unsigned int i = 0; i < erased.size(); i++)
+        BOOST_CHECK(cache.Contains(erased[i], true));
+
+    const std::vector<uint256> replacements = Entries(2 * (size / 5), size / 5);
+    for (unsigned int i = 0; i < replacements.size(); i++)
+        cache.Insert(replacements[i]);
+
+    BOOST_CHECK_GE(ContainedFraction(cache, kept), 0.95);
+    BOOST_CHECK_GE(ContainedFraction(cache, replacements), 0.95);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
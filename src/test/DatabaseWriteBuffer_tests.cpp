@@ -0,0 +1,70 @@
+#include <DatabaseWriteBuffer.h>
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CSerializeData Data(const std::string& text)
+{
+    return CSerializeData(text.begin(), text.end());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(DatabaseWriteBuffer_tests)
+
+BOOST_AUTO_TEST_CASE(willKeepOnlyTheLastWriteOfAKey)
+{
+    DatabaseWriteBuffer buffer;
+    buffer.Write(Data("pool1"), Data("first"));
+    buffer.Write(Data("pool2"), Data("other"));
+    buffer.Write(Data("pool1"), Data("second"));
+
+    BOOST_CHECK_EQUAL(buffer.size(), 2u);
+    CSerializeData value;
+    BOOST_CHECK_EQUAL(buffer.Lookup(Data("pool1"), value), DatabaseWriteBuffer::BUFFERED_WRITE);
+    BOOST_CHECK(value == Data("second"));
+}
+
+BOOST_AUTO_TEST_CASE(willTellErasedKeysFromKeysItKnowsNothingOf)
+{
+    DatabaseWriteBuffer buffer;
+    buffer.Write(Data("pool1"), Data("first"));
+    buffer.Erase(Data("pool1"));
+    buffer.Erase(Data("pool2"));
+
+    CSerializeData value;
+    BOOST_CHECK_EQUAL(buffer.Lookup(Data("pool1"), value), DatabaseWriteBuffer::BUFFERED_ERASE);
+    BOOST_CHECK_EQUAL(buffer.Lookup(Data("pool2"), value), DatabaseWriteBuffer::BUFFERED_ERASE);
+    BOOST_CHECK_EQUAL(buffer.Lookup(Data("pool3"), value), DatabaseWriteBuffer::NOT_BUFFERED);
+}
+
+BOOST_AUTO_TEST_CASE(willWriteAKeyAgainAfterItWasErased)
+{
+    DatabaseWriteBuffer buffer;
+    buffer.Erase(Data("pool1"));
+    buffer.Write(Data("pool1"), Data("again"));
+
+    CSerializeData value;
+    BOOST_CHECK_EQUAL(buffer.Lookup(Data("pool1"), value), DatabaseWriteBuffer::BUFFERED_WRITE);
+    BOOST_CHECK(value == Data("again"));
+}
+
+BOOST_AUTO_TEST_CASE(willHandOverItsWritesWhenSwapped)
+{
+    DatabaseWriteBuffer buffer;
+    buffer.Write(Data("pool1"), Data("first"));
+    buffer.Erase(Data("pool2"));
+
+    DatabaseWriteBuffer taken;
+    taken.swap(buffer);
+    BOOST_CHECK(buffer.empty());
+    BOOST_REQUIRE_EQUAL(taken.size(), 2u);
+    DatabaseWriteBuffer::BufferedWrites::const_iterator it = taken.begin();
+    BOOST_CHECK(it->first == Data("pool1") && !it->second.first);
+    ++it;
+    BOOST_CHECK(it->first == Data("pool2") && it->second.first);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,51 @@
+#include <HTTPChunkedStreamBuf.h>
+
+#include <sstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(HTTPChunkedStreamBuf_tests)
+
+BOOST_AUTO_TEST_CASE(willWriteOnlyTheLastChunkForAnEmptyBody)
+{
+    std::ostringstream out;
+    HTTPChunkedStreamBuf buffer(out);
+    BOOST_CHECK(buffer.Finish());
+    BOOST_CHECK_EQUAL(out.str(), "0\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(willSplitTheBodyIntoChunksOfTheGivenSize)
+{
+    std::ostringstream out;
+    HTTPChunkedStreamBuf buffer(out, 4);
+    std::ostream stream(&buffer);
+    stream << "0123456789";
+    BOOST_CHECK(buffer.Finish());
+    BOOST_CHECK_EQUAL(out.str(), "4\r\n0123\r\n4\r\n4567\r\n2\r\n89\r\n0\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(willWriteTheChunkSizeInHex)
+{
+    std::ostringstream out;
+    HTTPChunkedStreamBuf buffer(out, 64);
+    std::ostream stream(&buffer);
+    const std::string body(26, 'x');
+    stream << body;
+    stream.flush();
+    BOOST_CHECK_EQUAL(out.str(), "1a\r\n" + body + "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(willEndTheBodyOnceWhenDestroyed)
+{
+    std::ostringstream out;
+    {
+        HTTPChunkedStreamBuf buffer(out);
+        std::ostream stream(&buffer);
+        stream << "abc";
+        buffer.Finish();
+    }
+    BOOST_CHECK_EQUAL(out.str(), "3\r\nabc\r\n0\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,218 @@
+#include <IndexDatabaseUpdateCollector.h>
+
+#include <addressindex.h>
+#include <BlockUndo.h>
+#include <coins.h>
+#include <hash.h>
+#include <IndexDatabaseUpdates.h>
+#include <primitives/block.h>
+#include <script/StakingVaultScript.h>
+#include <script/standard.h>
+#include <spentindex.h>
+#include <txdb.h>
+#include <utilstrencodings.h>
+#include <VaultIndex.h>
+
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+const int keyIdType = 1;
+
+CKeyID KeyId(unsigned int n)
+{
+    return CKeyID(Hash160(std::vector<unsigned char>(BEGIN(n), END(n))));
+}
+
+CScript VaultScript(unsigned int owner, unsigned int manager)
+{
+    const CKeyID ownerKeyId = KeyId(owner);
+    const CKeyID managerKeyId = KeyId(manager);
+    return CreateStakingVaultScript(valtype(ownerKeyId.begin(), ownerKeyId.end()), valtype(managerKeyId.begin(), managerKeyId.end()));
+}
+
+std::vector<std::pair<VaultIndexKey, VaultIndexValue> > ReadVaults(CBlockTreeDB& db, VaultIndexRole role, unsigned int n)
+{
+    std::vector<std::pair<VaultIndexKey, VaultIndexValue> > vaults;
+    BOOST_REQUIRE(db.ReadVaultIndex(role, KeyId(n), vaults));
+    return vaults;
+}
+
+/** A block whose transactions spend outputs paying to a few addresses on to a few others */
+class BlockWithUndoData
+{
+public:
+    CBlock block;
+    CBlockUndo blockUndo;
+    CCoinsView noCoins;
+    CCoinsViewCache spentOutputs;
+
+    explicit BlockWithUndoData(unsigned int nTransactions)
+        : block()
+        , blockUndo()
+        , noCoins()
+        , spentOutputs(&noCoins)
+    {
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].prevout.SetNull();
+        coinbase.vout.push_back(CTxOut(1, GetScriptForDestination(KeyId(0))));
+        block.vtx.push_back(CTransaction(coinbase));
+
+        for (unsigned int i = 1; i < nTransactions; i++) {
+            const uint256 prevTxid = Hash(BEGIN(i), END(i));
+            const CTxOut prevout(10 * i, GetScriptForDestination(KeyId(i % 7)));
+            CMutableTransaction tx;
+            tx.vin.push_back(CTxIn(COutPoint(prevTxid, 1)));
+            tx.vout.push_back(CTxOut(5 * i, GetScriptForDestination(KeyId(i % 5))));
+            tx.vout.push_back(CTxOut(5 * i, GetScriptForDestination(KeyId(i % 3))));
+            block.vtx.push_back(CTransaction(tx));
+
+            blockUndo.vtxundo.push_back(CTxUndo());
+            blockUndo.vtxundo.back().vprevout.push_back(CTxInUndo(prevout, false, false, 1));
+            CCoinsModifier coins = spentOutputs.ModifyCoins(prevTxid);
+            coins->vout.resize(2);
+            coins->vout[1] = prevout;
+        }
+    }
+};
+
+IndexDatabaseUpdates RecordOneByOne(const BlockWithUndoData& data, int blockHeight)
+{
+    IndexDatabaseUpdates updates;
+    for (unsigned int i = 0; i < data.block.vtx.size(); i++) {
+        const TransactionLocationReference txLocationRef(data.block.vtx[i].GetHash(), blockHeight, i);
+        IndexDatabaseUpdateCollector::RecordTransaction(data.block.vtx[i], txLocationRef, data.spentOutputs, true, true, false, updates);
+    }
+    return updates;
+}
+
+void CheckSameUpdates(const IndexDatabaseUpdates& updates, const IndexDatabaseUpdates& expected)
+{
+    BOOST_CHECK_EQUAL(updates.addressIndex.size(), expected.addressIndex.size());
+    BOOST_CHECK(SerializeHash(updates.addressIndex) == SerializeHash(expected.addressIndex));
+    BOOST_CHECK(SerializeHash(updates.addressUnspentIndex) == SerializeHash(expected.addressUnspentIndex));
+    BOOST_CHECK(SerializeHash(updates.spentIndex) == SerializeHash(expected.spentIndex));
+    BOOST_CHECK(SerializeHash(updates.addressBalanceDeltas) == SerializeHash(expected.addressBalanceDeltas));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(IndexDatabaseUpdateCollector_tests)
+
+BOOST_AUTO_TEST_CASE(willRecordABlockFromItsUndoDataLikeTransactionByTransaction)
+{
+    BlockWithUndoData data(20);
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordBlock(data.block, data.blockUndo, 3, true, true, false, 1, updates);
+
+    CheckSameUpdates(updates, RecordOneByOne(data, 3));
+    BOOST_CHECK_EQUAL(updates.spentIndex.size(), 19u);
+}
+
+BOOST_AUTO_TEST_CASE(willRecordTheSameUpdatesWhenSplitAcrossThreads)
+{
+    BlockWithUndoData data(1001);
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordBlock(data.block, data.blockUndo, 3, true, true, false, 4, updates);
+
+    CheckSameUpdates(updates, RecordOneByOne(data, 3));
+    BOOST_CHECK_EQUAL(updates.addressIndex.size(), 1 + 3 * 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyRecordTheRequestedIndexes)
+{
+    BlockWithUndoData data(10);
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordBlock(data.block, data.blockUndo, 3, false, true, false, 4, updates);
+
+    BOOST_CHECK(updates.addressIndex.empty());
+    BOOST_CHECK(updates.addressBalanceDeltas.empty());
+    BOOST_CHECK_EQUAL(updates.spentIndex.size(), 9u);
+}
+
+BOOST_AUTO_TEST_CASE(willWriteTheEnabledIndexesInOneBatch)
+{
+    BlockWithUndoData data(10);
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordBlock(data.block, data.blockUndo, 3, true, true, false, 1, updates);
+    updates.txLocationData.push_back(TxIndexEntry(data.block.vtx[1].GetHash(), data.block.vtx[1].GetHash(), CDiskTxPos()));
+    CBlockTreeDB db(1 << 20, true, true);
+
+    BOOST_REQUIRE(db.WriteIndexDatabaseUpdates(updates, false, true, true));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    BOOST_REQUIRE(db.ReadAddressIndex(KeyId(1), keyIdType, entries));
+    BOOST_CHECK(!entries.empty());
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    BOOST_REQUIRE(db.ReadAddressUnspentIndex(KeyId(1), keyIdType, unspent));
+    BOOST_CHECK(!unspent.empty());
+    CAddressBalance balance;
+    BOOST_REQUIRE(db.ReadAddressBalance(KeyId(1), keyIdType, balance));
+    BOOST_CHECK(!balance.IsNull());
+    CSpentIndexKey spentKey(data.block.vtx[1].vin[0].prevout.hash, 1);
+    CSpentIndexValue spentValue;
+    BOOST_CHECK(db.ReadSpentIndex(spentKey, spentValue));
+    CDiskTxPos txPos;
+    BOOST_CHECK(!db.ReadTxIndex(data.block.vtx[1].GetHash(), txPos));
+}
+
+BOOST_AUTO_TEST_CASE(willIndexVaultsUnderTheirOwnerAndManagerUntilSpent)
+{
+    const uint256 prevTxid = Hash(BEGIN(keyIdType), END(keyIdType));
+    const CTxOut spentVault(30, VaultScript(10, 12));
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.push_back(CTxOut(50, VaultScript(10, 11)));
+    block.vtx.push_back(CTransaction(coinbase));
+    CMutableTransaction tx;
+    tx.vin.push_back(CTxIn(COutPoint(prevTxid, 0)));
+    tx.vout.push_back(CTxOut(30, GetScriptForDestination(KeyId(10))));
+    block.vtx.push_back(CTransaction(tx));
+    CBlockUndo blockUndo;
+    blockUndo.vtxundo.push_back(CTxUndo());
+    blockUndo.vtxundo.back().vprevout.push_back(CTxInUndo(spentVault, false, false, 1));
+
+    CBlockTreeDB db(1 << 20, true, true);
+    std::vector<std::pair<VaultIndexKey, VaultIndexValue> > existing;
+    existing.push_back(std::make_pair(VaultIndexKey(VaultIndexRole::OWNER, KeyId(10), prevTxid, 0), VaultIndexValue(30, spentVault.scriptPubKey)));
+    existing.push_back(std::make_pair(VaultIndexKey(VaultIndexRole::MANAGER, KeyId(12), prevTxid, 0), VaultIndexValue(30, spentVault.scriptPubKey)));
+    BOOST_REQUIRE(db.UpdateVaultIndex(existing));
+
+    IndexDatabaseUpdates updates;
+    IndexDatabaseUpdateCollector::RecordBlock(block, blockUndo, 3, false, false, true, 1, updates);
+    BOOST_CHECK(updates.addressIndex.empty());
+    BOOST_CHECK_EQUAL(updates.vaultIndex.size(), 4u);
+    BOOST_REQUIRE(db.WriteIndexDatabaseUpdates(updates, false, false, false));
+
+    const std::vector<std::pair<VaultIndexKey, VaultIndexValue> > owned = ReadVaults(db, VaultIndexRole::OWNER, 10);
+    BOOST_REQUIRE_EQUAL(owned.size(), 1u);
+    BOOST_CHECK(owned[0].first.txhash == block.vtx[0].GetHash());
+    BOOST_CHECK_EQUAL(owned[0].second.satoshis, 50);
+    BOOST_CHECK_EQUAL(ReadVaults(db, VaultIndexRole::MANAGER, 11).size(), 1u);
+    BOOST_CHECK(ReadVaults(db, VaultIndexRole::MANAGER, 12).empty());
+    BOOST_CHECK(ReadVaults(db, VaultIndexRole::OWNER, 11).empty());
+
+    CCoinsView noCoins;
+    CCoinsViewCache spentOutputs(&noCoins);
+    spentOutputs.ModifyCoins(prevTxid)->vout.push_back(spentVault);
+    IndexDatabaseUpdates reversal;
+    for (int i = block.vtx.size() - 1; i >= 0; i--) {
+        const TransactionLocationReference txLocationRef(block.vtx[i].GetHash(), 3, i);
+        IndexDatabaseUpdateCollector::ReverseTransaction(block.vtx[i], txLocationRef, spentOutputs, false, false, true, reversal);
+    }
+    BOOST_REQUIRE(db.UpdateVaultIndex(reversal.vaultIndex));
+
+    const std::vector<std::pair<VaultIndexKey, VaultIndexValue> > restored = ReadVaults(db, VaultIndexRole::OWNER, 10);
+    BOOST_REQUIRE_EQUAL(restored.size(), 1u);
+    BOOST_CHECK(restored[0].first.txhash == prevTxid);
+    BOOST_CHECK_EQUAL(restored[0].second.satoshis, 30);
+    BOOST_CHECK_EQUAL(ReadVaults(db, VaultIndexRole::MANAGER, 12).size(), 1u);
+    BOOST_CHECK(ReadVaults(db, VaultIndexRole::MANAGER, 11).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
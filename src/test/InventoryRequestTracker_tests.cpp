@@ -0,0 +1,136 @@
+#include <InventoryRequestTracker.h>
+
+#include <hash.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CInv Tx(int n)
+{
+    return CInv(MSG_TX, Hash(BEGIN(n), END(n)));
+}
+
+std::set<CInv> have;
+
+bool AlreadyHave(const CInv& inv)
+{
+    return have.count(inv) > 0;
+}
+
+std::vector<CInv> Requestable(InventoryRequestTracker& tracker, NodeId peer, int64_t nNow)
+{
+    std::vector<CInv> toRequest;
+    tracker.GetRequestable(peer, nNow, &AlreadyHave, toRequest);
+    return toRequest;
+}
+
+const int64_t SECOND = 1000000;
+}
+
+BOOST_AUTO_TEST_SUITE(InventoryRequestTracker_tests)
+
+BOOST_AUTO_TEST_CASE(willAskOnlyOnePeerAtATime)
+{
+    have.clear();
+    InventoryRequestTracker tracker;
+    BOOST_CHECK(tracker.ReceivedInv(1, Tx(1), true, 0));
+    BOOST_CHECK(tracker.ReceivedInv(2, Tx(1), true, 0));
+    BOOST_CHECK(!tracker.ReceivedInv(2, Tx(1), true, 0));
+
+    BOOST_CHECK_EQUAL(Requestable(tracker, 1, 0).size(), 1u);
+    BOOST_CHECK(Requestable(tracker, 1, 0).empty());
+    BOOST_CHECK(Requestable(tracker, 2, 0).empty());
+    BOOST_CHECK_EQUAL(tracker.CountInFlight(1), 1u);
+
+    tracker.ForgetInv(Tx(1));
+    BOOST_CHECK(Requestable(tracker, 2, 0).empty());
+    BOOST_CHECK_EQUAL(tracker.Size(), 0u);
+    BOOST_CHECK_EQUAL(tracker.CountAnnounced(2), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willAskTheNextPeerOnceARequestExpires)
+{
+    have.clear();
+    InventoryRequestTracker tracker;
+    tracker.ReceivedInv(1, Tx(1), true, 0);
+    tracker.ReceivedInv(2, Tx(1), true, 0);
+    BOOST_CHECK_EQUAL(Requestable(tracker, 1, 0).size(), 1u);
+
+    BOOST_CHECK(Requestable(tracker, 2, 59 * SECOND).empty());
+    const std::vector<CInv> toRequest = Requestable(tracker, 2, 60 * SECOND);
+    BOOST_REQUIRE_EQUAL(toRequest.size(), 1u);
+    BOOST_CHECK(toRequest[0].hash == Tx(1).hash);
+    BOOST_CHECK_EQUAL(tracker.CountInFlight(1), 0u);
+
+    // Once every peer failed to answer, the inventory is forgotten
+    BOOST_CHECK(Requestable(tracker, 1, 120 * SECOND).empty());
+    BOOST_CHECK_EQUAL(tracker.Size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willAskAnotherPeerRightAwayWhenTheOneAskedDisconnects)
+{
+    have.clear();
+    InventoryRequestTracker tracker;
+    tracker.ReceivedInv(1, Tx(1), true, 0);
+    tracker.ReceivedInv(2, Tx(1), true, 0);
+    BOOST_CHECK_EQUAL(Requestable(tracker, 1, 0).size(), 1u);
+
+    tracker.DisconnectedPeer(1);
+    BOOST_CHECK_EQUAL(Requestable(tracker, 2, SECOND).size(), 1u);
+    tracker.DisconnectedPeer(2);
+    BOOST_CHECK(tracker.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(willPreferPreferredPeersOverOthersThatAnnouncedFirst)
+{
+    have.clear();
+    InventoryRequestTracker tracker;
+    tracker.ReceivedInv(1, Tx(1), false, 0);
+    tracker.ReceivedInv(1, Tx(2), false, 0);
+    BOOST_CHECK(Requestable(tracker, 1, SECOND).empty());
+
+    tracker.ReceivedInv(2, Tx(1), true, SECOND);
+    const std::vector<CInv> toRequest = Requestable(tracker, 1, 2 * SECOND);
+    BOOST_REQUIRE_EQUAL(toRequest.size(), 1u);
+    BOOST_CHECK(toRequest[0].hash == Tx(2).hash);
+    BOOST_CHECK_EQUAL(Requestable(tracker, 2, 2 * SECOND).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willForgetWhatArrivedThroughAnotherMessage)
+{
+    have.clear();
+    InventoryRequestTracker tracker;
+    tracker.ReceivedInv(1, Tx(1), true, 0);
+    tracker.ReceivedInv(1, Tx(2), true, 0);
+    tracker.ReceivedInv(2, Tx(2), true, 0);
+    BOOST_CHECK_EQUAL(Requestable(tracker, 1, 0).size(), 2u);
+
+    have.insert(Tx(1));
+    have.insert(Tx(2));
+    BOOST_CHECK(Requestable(tracker, 1, 0).empty());
+    BOOST_CHECK_EQUAL(tracker.CountInFlight(1), 0u);
+    BOOST_CHECK_EQUAL(tracker.CountAnnounced(2), 0u);
+    BOOST_CHECK_EQUAL(tracker.Size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willBoundTheRequestsInFlightOfAPeer)
+{
+    have.clear();
+    InventoryRequestTracker tracker;
+    for (int n = 0; n < 150; n++)
+        tracker.ReceivedInv(1, Tx(n), true, 0);
+    const std::vector<CInv> requested = Requestable(tracker, 1, 0);
+    BOOST_REQUIRE_EQUAL(requested.size(), 100u);
+    BOOST_CHECK(Requestable(tracker, 1, 0).empty());
+
+    for (int n = 0; n < 10; n++)
+        tracker.ForgetInv(requested[n]);
+    BOOST_CHECK_EQUAL(Requestable(tracker, 1, 0).size(), 10u);
+    BOOST_CHECK_EQUAL(tracker.CountAnnounced(1), 140u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
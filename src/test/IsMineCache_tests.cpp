@@ -0,0 +1,85 @@
+#include <IsMineCache.h>
+
+#include <key.h>
+#include <keystore.h>
+#include <script/standard.h>
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class IsMineCacheFixture
+{
+public:
+    CBasicKeyStore keyStore;
+    std::atomic<unsigned> keyStoreVersion;
+    CKey key;
+    CScript scriptPubKey;
+
+    IsMineCacheFixture(
+        ): keyStore()
+        , keyStoreVersion(0u)
+        , key()
+        , scriptPubKey()
+    {
+        key.MakeNewKey(true);
+        scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    }
+
+    CScript unknownScript() const
+    {
+        CKey otherKey;
+        otherKey.MakeNewKey(true);
+        return GetScriptForDestination(otherKey.GetPubKey().GetID());
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(IsMineCache_tests, IsMineCacheFixture)
+
+BOOST_AUTO_TEST_CASE(willKeepTheClassificationUntilTheKeyStoreVersionChanges)
+{
+    IsMineCache cache(keyStore, keyStoreVersion, 10);
+    VaultType vaultType;
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_NO);
+
+    keyStore.AddKey(key);
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_NO);
+
+    ++keyStoreVersion;
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_SPENDABLE);
+    BOOST_CHECK_EQUAL(vaultType, NON_VAULT);
+    BOOST_CHECK_EQUAL(cache.NumberOfScripts(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willForgetTheScriptsOnceItHoldsTheMaximumNumber)
+{
+    IsMineCache cache(keyStore, keyStoreVersion, 2);
+    keyStore.AddKey(key);
+    VaultType vaultType;
+    cache.IsMine(unknownScript(), vaultType);
+    cache.IsMine(unknownScript(), vaultType);
+    BOOST_CHECK_EQUAL(cache.NumberOfScripts(), 2u);
+
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_SPENDABLE);
+    BOOST_CHECK_EQUAL(cache.NumberOfScripts(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willClassifyWatchedScriptsAfterTheVersionChanges)
+{
+    IsMineCache cache(keyStore, keyStoreVersion, 10);
+    VaultType vaultType;
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_NO);
+
+    keyStore.AddWatchOnly(scriptPubKey);
+    ++keyStoreVersion;
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_WATCH_ONLY);
+
+    keyStore.RemoveWatchOnly(scriptPubKey);
+    ++keyStoreVersion;
+    BOOST_CHECK_EQUAL(cache.IsMine(scriptPubKey, vaultType), ISMINE_NO);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+#include <LockProfiler.h>
+
+#include <sync.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+struct LockProfilerTestFixture {
+    CCriticalSection cs;
+
+    LockProfilerTestFixture(): cs()
+    {
+        LockProfiler::Reset();
+    }
+    ~LockProfilerTestFixture()
+    {
+        LockProfiler::SetSamplingInterval(0);
+        LockProfiler::Reset();
+    }
+
+    //! Samples taken here, leaving out what other threads of the test process locked meanwhile
+    uint64_t SamplesOfThisFile(const std::vector<LockSiteStats>& stats) const
+    {
+        uint64_t nSamples = 0;
+        for (const LockSiteStats& site : stats) {
+            if (site.file == __FILE__)
+                nSamples += site.nSamples;
+        }
+        return nSamples;
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(LockProfiler_tests, LockProfilerTestFixture)
+
+BOOST_AUTO_TEST_CASE(willNotRecordLocksWhileProfilingIsOff)
+{
+    LockProfiler::SetSamplingInterval(0);
+    for (int i = 0; i < 10; ++i) {
+        LOCK(cs);
+    }
+    BOOST_CHECK(LockProfiler::GetStats().empty());
+}
+
+BOOST_AUTO_TEST_CASE(willRecordEverySampledAcquisitionAgainstItsSite)
+{
+    LockProfiler::SetSamplingInterval(1);
+    for (int i = 0; i < 3; ++i) {
+        LOCK(cs);
+    }
+    const int nLine = __LINE__ - 2;
+    {
+        TRY_LOCK(cs, lockTaken);
+        const bool fTaken = lockTaken;
+        BOOST_CHECK(fTaken);
+    }
+    LockProfiler::SetSamplingInterval(0);
+
+    const std::vector<LockSiteStats> stats = LockProfiler::GetStats();
+    bool fFoundLoopSite = false;
+    for (const LockSiteStats& site : stats) {
+        if (site.file != __FILE__)
+            continue;
+        BOOST_CHECK_EQUAL(site.lockName, "cs");
+        BOOST_CHECK_EQUAL(site.nContended, 0u);
+        BOOST_CHECK_EQUAL(site.waitHistogram.size(), LockSiteStats::NUMBER_OF_BUCKETS);
+        if (site.line == nLine) {
+            fFoundLoopSite = true;
+            BOOST_CHECK_EQUAL(site.nSamples, 3u);
+        }
+    }
+    BOOST_CHECK(fFoundLoopSite);
+    BOOST_CHECK_EQUAL(SamplesOfThisFile(stats), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyTimeOneInEverySamplingIntervalAcquisitions)
+{
+    LockProfiler::SetSamplingInterval(4);
+    for (int i = 0; i < 40; ++i) {
+        LOCK(cs);
+    }
+    LockProfiler::SetSamplingInterval(0);
+    BOOST_CHECK_EQUAL(SamplesOfThisFile(LockProfiler::GetStats()), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(willCountHoldTimesInPowerOfTwoBuckets)
+{
+    LockProfileSample sample;
+    LockProfiler::Acquired(sample, "cs", "file.cpp", 7, LockProfiler::NowMicros(), true);
+    BOOST_CHECK(sample.IsActive());
+    sample.nRequestedMicros = sample.nAcquiredMicros - 5;
+    sample.nAcquiredMicros -= 1000000000;
+    LockProfiler::Released(sample);
+
+    const std::vector<LockSiteStats> stats = LockProfiler::GetStats();
+    BOOST_CHECK_EQUAL(stats.size(), 1u);
+    BOOST_CHECK_EQUAL(stats[0].nContended, 1u);
+    BOOST_CHECK_EQUAL(stats[0].nSamples, 1u);
+    BOOST_CHECK_EQUAL(stats[0].waitHistogram[0], 1u);
+    BOOST_CHECK_EQUAL(stats[0].holdHistogram.back(), 1u);
+    BOOST_CHECK(stats[0].nMaxHoldMicros >= 1000000000u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+#include <LogMessageQueue.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+LogMessageQueue::Message MakeMessage(int64_t nTime, const std::string& text)
+{
+    LogMessageQueue::Message message;
+    message.nTime = nTime;
+    message.text = text;
+    return message;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(LogMessageQueue_tests)
+
+BOOST_AUTO_TEST_CASE(willRoundTheCapacityUpToAPowerOfTwo)
+{
+    BOOST_CHECK_EQUAL(LogMessageQueue(1).Capacity(), 1u);
+    BOOST_CHECK_EQUAL(LogMessageQueue(5).Capacity(), 8u);
+    BOOST_CHECK_EQUAL(LogMessageQueue(16).Capacity(), 16u);
+}
+
+BOOST_AUTO_TEST_CASE(willPopMessagesInTheOrderTheyWerePushed)
+{
+    LogMessageQueue queue(4);
+    LogMessageQueue::Message message;
+    BOOST_CHECK(!queue.Pop(message));
+    for (int round = 0; round < 3; ++round) {
+        LogMessageQueue::Message first = MakeMessage(1, "first\n");
+        LogMessageQueue::Message second = MakeMessage(2, "second\n");
+        BOOST_CHECK(queue.Push(first));
+        BOOST_CHECK(queue.Push(second));
+        BOOST_CHECK(queue.Pop(message));
+        BOOST_CHECK_EQUAL(message.text, "first\n");
+        BOOST_CHECK_EQUAL(message.nTime, 1);
+        BOOST_CHECK(queue.Pop(message));
+        BOOST_CHECK_EQUAL(message.text, "second\n");
+        BOOST_CHECK(!queue.Pop(message));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willRefuseMessagesWhenFullWithoutTakingThem)
+{
+    LogMessageQueue queue(2);
+    LogMessageQueue::Message message = MakeMessage(0, "a");
+    BOOST_CHECK(queue.Push(message));
+    message = MakeMessage(0, "b");
+    BOOST_CHECK(queue.Push(message));
+    message = MakeMessage(0, "c");
+    BOOST_CHECK(!queue.Push(message));
+    BOOST_CHECK_EQUAL(message.text, "c");
+
+    LogMessageQueue::Message popped;
+    BOOST_CHECK(queue.Pop(popped));
+    BOOST_CHECK_EQUAL(popped.text, "a");
+    BOOST_CHECK(queue.Push(message));
+    BOOST_CHECK(queue.Pop(popped));
+    BOOST_CHECK(queue.Pop(popped));
+    BOOST_CHECK_EQUAL(popped.text, "c");
+}
+
+BOOST_AUTO_TEST_CASE(willKeepTheOrderOfEachOfManyPushingThreads)
+{
+    const int nThreads = 4;
+    const int nMessagesPerThread = 2000;
+    LogMessageQueue queue(64);
+    boost::thread_group threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.create_thread([&queue, t]() {
+            for (int i = 0; i < nMessagesPerThread; ++i) {
+                LogMessageQueue::Message message = MakeMessage(t, std::to_string(i));
+                while (!queue.Push(message))
+                    boost::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<int> nextFromThread(nThreads, 0);
+    LogMessageQueue::Message message;
+    for (int nPopped = 0; nPopped < nThreads * nMessagesPerThread;) {
+        if (!queue.Pop(message)) {
+            boost::this_thread::yield();
+            continue;
+        }
+        BOOST_REQUIRE(message.nTime >= 0 && message.nTime < nThreads);
+        BOOST_CHECK_EQUAL(message.text, std::to_string(nextFromThread[message.nTime]));
+        ++nextFromThread[message.nTime];
+        ++nPopped;
+    }
+    threads.join_all();
+    BOOST_CHECK(std::count(nextFromThread.begin(), nextFromThread.end(), nMessagesPerThread) == nThreads);
+    BOOST_CHECK(!queue.Pop(message));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 #include <primitives/transaction.h>
 #include <chain.h>
 #include <script/script.h>
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <test/test_only.h>
@@ -145,10 +146,32 @@ BOOST_AUTO_TEST_CASE(willEnsureThatWinningALotteryForbidsWinningForTheNextThreeL
     BOOST_CHECK(getLotteryCoinstakes(150-1).size()>0);
 }
 
+BOOST_AUTO_TEST_CASE(willReportThePriorWinnersScriptsAsVetoed)
+{
+    SetDefaultLotteryStartAndCycleLength(100, 10);
+    InitializeChainToFixedBlockCount(151,unixTimestampForDec31stMidnight+1);
+
+    CScript initialScript = constructDistinctDummyScript();
+    UpdateNextLotteryBlocks(101,initialScript);
+    CScript firstWinnerScript = constructDistinctDummyScript();
+    UpdateNextLotteryBlocks(50,firstWinnerScript);
+
+    std::vector<CScript> vetoedScripts;
+    BOOST_CHECK(calculator_->GetVetoedPaymentScripts(125,vetoedScripts));
+    BOOST_CHECK(std::find(vetoedScripts.begin(),vetoedScripts.end(),firstWinnerScript) != vetoedScripts.end());
+    BOOST_CHECK(std::find(vetoedScripts.begin(),vetoedScripts.end(),initialScript) == vetoedScripts.end());
+
+    // Three lotteries on, the first winners may win again
+    BOOST_CHECK(calculator_->GetVetoedPaymentScripts(145,vetoedScripts));
+    BOOST_CHECK(std::find(vetoedScripts.begin(),vetoedScripts.end(),firstWinnerScript) == vetoedScripts.end());
+}
+
 BOOST_AUTO_TEST_CASE(willEnsureThatBefore2021ThereAreNoVetosToRepeatedWinning)
 {
     SetDefaultLotteryStartAndCycleLength(100, 20);
     InitializeChainToFixedBlockCount(301,unixTimestampForDec31stMidnight-60*201);
+    std::vector<CScript> vetoedScripts;
+    BOOST_CHECK(!calculator_->GetVetoedPaymentScripts(130,vetoedScripts));
 
     CScript initialScript = constructDistinctDummyScript();
     UpdateNextLotteryBlocks(101,initialScript);
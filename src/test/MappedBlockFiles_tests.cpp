@@ -0,0 +1,103 @@
+#include <MappedBlockFiles.h>
+
+#include <BlockFileOpener.h>
+#include <chain.h>
+#include <streams.h>
+#include <util.h>
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+void ClearBlockFile(int nFile)
+{
+    FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0));
+    BOOST_REQUIRE(file != NULL);
+    BOOST_REQUIRE(TruncateFile(file, 0));
+    fclose(file);
+}
+
+void AppendToBlockFile(int nFile, const std::string& data)
+{
+    FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0));
+    BOOST_REQUIRE(file != NULL);
+    BOOST_REQUIRE_EQUAL(fseek(file, 0, SEEK_END), 0);
+    BOOST_REQUIRE_EQUAL(fwrite(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+}
+
+bool MappingStartsWith(const MappedBlockFiles::MappingRef& mapping, const std::string& data)
+{
+    return mapping && mapping->size() >= data.size() && memcmp(mapping->data(), data.data(), data.size()) == 0;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MappedBlockFiles_tests)
+
+BOOST_AUTO_TEST_CASE(willMapBlockFilesAndRemapThemOnceTheyGrow)
+{
+    const std::string first(100, 'a');
+    const std::string second(50, 'b');
+    ClearBlockFile(7);
+    AppendToBlockFile(7, first);
+    MappedBlockFiles mappedFiles(4);
+
+    MappedBlockFiles::MappingRef mapping = mappedFiles.Get(7, first.size());
+    BOOST_CHECK(MappingStartsWith(mapping, first));
+    BOOST_CHECK(mappedFiles.Get(7, first.size()) == mapping);
+    BOOST_CHECK(!mappedFiles.Get(7, first.size() + second.size()));
+
+    AppendToBlockFile(7, second);
+    MappedBlockFiles::MappingRef grown = mappedFiles.Get(7, first.size() + second.size());
+    BOOST_REQUIRE(grown);
+    BOOST_CHECK_EQUAL(grown->size(), first.size() + second.size());
+    BOOST_CHECK(memcmp(grown->data() + first.size(), second.data(), second.size()) == 0);
+    BOOST_CHECK(MappingStartsWith(mapping, first));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepEvictedMappingsValidForTheirReaders)
+{
+    const std::string data(64, 'c');
+    ClearBlockFile(8);
+    ClearBlockFile(9);
+    AppendToBlockFile(8, data);
+    AppendToBlockFile(9, data);
+    MappedBlockFiles mappedFiles(1);
+
+    MappedBlockFiles::MappingRef mapping = mappedFiles.Get(8, data.size());
+    BOOST_REQUIRE(mapping);
+    BOOST_CHECK(mappedFiles.Get(9, data.size()));
+    BOOST_CHECK(MappingStartsWith(mapping, data));
+    mappedFiles.Clear();
+    BOOST_CHECK(MappingStartsWith(mapping, data));
+}
+
+BOOST_AUTO_TEST_CASE(willNotMapWithoutAPool)
+{
+    ClearBlockFile(10);
+    AppendToBlockFile(10, std::string(16, 'd'));
+    MappedBlockFiles mappedFiles(0);
+    BOOST_CHECK(!mappedFiles.Get(10, 16));
+}
+
+BOOST_AUTO_TEST_CASE(willDeserializeFromMemoryWithoutCopyingIt)
+{
+    CDataStream ss(SER_DISK, 0);
+    ss << (unsigned int)42 << std::string("block");
+    const std::vector<char> data(ss.begin(), ss.end());
+
+    CMemoryReader reader(&data[0], &data[0] + data.size(), SER_DISK, 0);
+    unsigned int n = 0;
+    std::string str;
+    reader >> n >> str;
+    BOOST_CHECK_EQUAL(n, 42u);
+    BOOST_CHECK_EQUAL(str, "block");
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK_THROW(reader >> n, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include <MempoolAddressIndex.h>
+
+#include <addressindex.h>
+#include <hash.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+const int keyIdType = 1;
+const int scriptIdType = 2;
+
+uint160 AddressHash(char tag)
+{
+    return Hash160(std::vector<unsigned char>(1, tag));
+}
+
+uint256 TxHash(int n)
+{
+    return Hash(BEGIN(n), END(n));
+}
+
+/** Transaction n pays to address a and spends from address a, and from b every other transaction */
+void AddTransaction(MempoolAddressIndex& index, int n)
+{
+    index.Add(CMempoolAddressDeltaKey(keyIdType, AddressHash('a'), TxHash(n), 0, 0), CMempoolAddressDelta(n, 10 * n));
+    index.Add(CMempoolAddressDeltaKey(keyIdType, AddressHash('a'), TxHash(n), 0, 1), CMempoolAddressDelta(n, -n, TxHash(-n), 0));
+    if (n % 2 == 0)
+        index.Add(CMempoolAddressDeltaKey(keyIdType, AddressHash('b'), TxHash(n), 1, 1), CMempoolAddressDelta(n, -n, TxHash(-n), 1));
+}
+
+std::multiset<uint256> Transactions(const MempoolAddressIndex& index, char tag, int type = keyIdType)
+{
+    MempoolAddressIndex::AddressDeltas deltas;
+    index.GetAddressDeltas(AddressHash(tag), type, deltas);
+    std::multiset<uint256> txhashes;
+    for (unsigned int i = 0; i < deltas.size(); i++) {
+        BOOST_CHECK(deltas[i].first.addressBytes == AddressHash(tag));
+        BOOST_CHECK(deltas[i].first.txhash == TxHash(deltas[i].second.time));
+        txhashes.insert(deltas[i].first.txhash);
+    }
+    return txhashes;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MempoolAddressIndex_tests)
+
+BOOST_AUTO_TEST_CASE(willReturnTheDeltasOfAnAddressInKeyOrder)
+{
+    MempoolAddressIndex index;
+    for (int n = 1; n <= 20; n++)
+        AddTransaction(index, n);
+    index.Add(CMempoolAddressDeltaKey(scriptIdType, AddressHash('a'), TxHash(1), 1, 0), CMempoolAddressDelta(1, 5));
+
+    MempoolAddressIndex::AddressDeltas deltas;
+    index.GetAddressDeltas(AddressHash('a'), keyIdType, deltas);
+
+    BOOST_REQUIRE_EQUAL(deltas.size(), 40u);
+    for (unsigned int i = 1; i < deltas.size(); i++)
+        BOOST_CHECK(CMempoolAddressDeltaKeyCompare()(deltas[i - 1].first, deltas[i].first));
+    BOOST_CHECK_EQUAL(Transactions(index, 'b').size(), 10u);
+    BOOST_CHECK_EQUAL(Transactions(index, 'a', scriptIdType).size(), 1u);
+    BOOST_CHECK(Transactions(index, 'c').empty());
+    BOOST_CHECK_EQUAL(index.NumberOfAddresses(), 3u);
+    BOOST_CHECK(index.HasTransaction(TxHash(20)));
+    BOOST_CHECK(!index.HasTransaction(TxHash(21)));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepTheOtherTransactionsWhenRemovingOneInAnyOrder)
+{
+    MempoolAddressIndex index;
+    std::multiset<uint256> expectedA, expectedB;
+    for (int n = 1; n <= 50; n++) {
+        AddTransaction(index, n);
+        expectedA.insert(TxHash(n));
+        expectedA.insert(TxHash(n));
+        if (n % 2 == 0)
+            expectedB.insert(TxHash(n));
+    }
+
+    for (int step = 0; step < 50; step++) {
+        // Visits every transaction once, out of insertion order
+        const int n = 1 + (step * 17) % 50;
+        index.RemoveTransaction(TxHash(n));
+        expectedA.erase(TxHash(n));
+        expectedB.erase(TxHash(n));
+
+        BOOST_CHECK(!index.HasTransaction(TxHash(n)));
+        BOOST_CHECK(Transactions(index, 'a') == expectedA);
+        BOOST_CHECK(Transactions(index, 'b') == expectedB);
+    }
+    BOOST_CHECK_EQUAL(index.NumberOfAddresses(), 0u);
+    BOOST_CHECK_EQUAL(index.NumberOfTransactions(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willIgnoreTransactionsItDoesNotHold)
+{
+    MempoolAddressIndex index;
+    AddTransaction(index, 2);
+    index.RemoveTransaction(TxHash(3));
+    BOOST_CHECK_EQUAL(Transactions(index, 'a').size(), 2u);
+
+    index.Clear();
+    BOOST_CHECK(Transactions(index, 'a').empty());
+    BOOST_CHECK(!index.HasTransaction(TxHash(2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+#include <merkletx.h>
+
+#include <blockmap.h>
+#include <chain.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <test/FakeBlockIndexChain.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+struct MerkleTxTestFixture {
+    FakeBlockIndexWithHashes fakeChain;
+    CMerkleTx merkleTx;
+
+    MerkleTxTestFixture()
+      : fakeChain(10, 1600000000, 1)
+      , merkleTx(CMutableTransaction(), *fakeChain.activeChain, *fakeChain.blockIndexByHash)
+    {
+        SetBlock(5);
+    }
+
+    void SetBlock(int nHeight)
+    {
+        merkleTx.hashBlock = (*fakeChain.activeChain)[nHeight]->GetBlockHash();
+        merkleTx.nIndex = 0;
+        merkleTx.fMerkleVerified = true;
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(MerkleTx_tests, MerkleTxTestFixture)
+
+BOOST_AUTO_TEST_CASE(depthFollowsTheChainAsItGrows)
+{
+    BOOST_CHECK_EQUAL(merkleTx.GetNumberOfBlockConfirmations(), 5);
+    fakeChain.addBlocks(3, 1);
+    BOOST_CHECK_EQUAL(merkleTx.GetNumberOfBlockConfirmations(), 8);
+
+    const CBlockIndex* pindex = NULL;
+    BOOST_CHECK_EQUAL(merkleTx.GetNumberOfBlockConfirmations(pindex), 8);
+    BOOST_CHECK(pindex == (*fakeChain.activeChain)[5]);
+}
+
+BOOST_AUTO_TEST_CASE(depthFollowsAChangeOfBlock)
+{
+    BOOST_CHECK_EQUAL(merkleTx.GetNumberOfBlockConfirmations(), 5);
+    SetBlock(2);
+    BOOST_CHECK_EQUAL(merkleTx.GetNumberOfBlockConfirmations(), 8);
+    merkleTx.hashBlock = uint256(1);
+    BOOST_CHECK(!merkleTx.IsInMainChain());
+}
+
+BOOST_AUTO_TEST_CASE(blockDisconnectedFromTheChainIsNoLongerInIt)
+{
+    BOOST_CHECK(merkleTx.IsInMainChain());
+    CChain& activeChain = *fakeChain.activeChain;
+    activeChain.SetTip(activeChain[4]);
+    BOOST_CHECK(!merkleTx.IsInMainChain());
+    activeChain.SetTip(fakeChain.blockIndexByHash->find(merkleTx.hashBlock)->second);
+    BOOST_CHECK(merkleTx.IsInMainChain());
+}
+
+BOOST_AUTO_TEST_CASE(blockReplacedAtItsHeightIsNoLongerInTheChain)
+{
+    BOOST_CHECK(merkleTx.IsInMainChain());
+    CChain& activeChain = *fakeChain.activeChain;
+
+    const uint256 competingHash(12345);
+    CBlockIndex competingBlock;
+    competingBlock.pprev = activeChain[4];
+    competingBlock.nHeight = 5;
+    competingBlock.phashBlock = &competingHash;
+    activeChain.SetTip(&competingBlock);
+
+    BOOST_CHECK(!merkleTx.IsInMainChain());
+}
+
+BOOST_AUTO_TEST_CASE(branchLeadingToTheBlockIsVerifiedAndKept)
+{
+    std::vector<uint256> branch;
+    branch.push_back(uint256(7));
+    branch.push_back(uint256(8));
+    (*fakeChain.activeChain)[5]->hashMerkleRoot = CBlock::CheckMerkleBranch(merkleTx.GetHash(), branch, 1);
+    merkleTx.nIndex = 1;
+    merkleTx.fMerkleVerified = false;
+    merkleTx.vMerkleBranch = branch;
+
+    BOOST_CHECK_EQUAL(merkleTx.GetNumberOfBlockConfirmations(), 5);
+    BOOST_CHECK(merkleTx.fMerkleVerified);
+    BOOST_CHECK(merkleTx.vMerkleBranch == branch);
+}
+
+BOOST_AUTO_TEST_CASE(branchNotLeadingToTheBlockIsKeptUnverified)
+{
+    std::vector<uint256> branch(1, uint256(7));
+    merkleTx.fMerkleVerified = false;
+    merkleTx.vMerkleBranch = branch;
+
+    BOOST_CHECK(!merkleTx.IsInMainChain());
+    BOOST_CHECK(!merkleTx.fMerkleVerified);
+    BOOST_CHECK(merkleTx.vMerkleBranch == branch);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
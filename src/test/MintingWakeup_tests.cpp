@@ -0,0 +1,51 @@
+#include <MintingWakeup.h>
+
+#include <utiltime.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+void NotifyAfter(MintingWakeup& wakeup, int64_t milliseconds)
+{
+    MilliSleep(milliseconds);
+    wakeup.Notify();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MintingWakeup_tests)
+
+BOOST_AUTO_TEST_CASE(willTimeOutWithoutAWakeup)
+{
+    MintingWakeup wakeup;
+    const int64_t start = GetTimeMillis();
+    BOOST_CHECK(!wakeup.WaitFor(50, wakeup.NumberOfWakeups()));
+    BOOST_CHECK(GetTimeMillis() - start >= 40);
+}
+
+BOOST_AUTO_TEST_CASE(willNotLoseAWakeupFromBeforeTheWait)
+{
+    MintingWakeup wakeup;
+    const uint64_t wakeupsSeen = wakeup.NumberOfWakeups();
+    wakeup.Notify();
+
+    const int64_t start = GetTimeMillis();
+    BOOST_CHECK(wakeup.WaitFor(60000, wakeupsSeen));
+    BOOST_CHECK(GetTimeMillis() - start < 1000);
+    BOOST_CHECK_EQUAL(wakeup.NumberOfWakeups(), wakeupsSeen + 1);
+}
+
+BOOST_AUTO_TEST_CASE(willWakeUpWhenNotifiedFromAnotherThread)
+{
+    MintingWakeup wakeup;
+    boost::thread notifier(boost::bind(&NotifyAfter, boost::ref(wakeup), 20));
+
+    const int64_t start = GetTimeMillis();
+    BOOST_CHECK(wakeup.WaitFor(60000, wakeup.NumberOfWakeups()));
+    BOOST_CHECK(GetTimeMillis() - start < 30000);
+    notifier.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@ class MockVaultManagerDatabase: public I_VaultManagerDatabase
 public:
     MOCK_METHOD1(WriteTx,bool(const CWalletTx& walletTransaction));
     MOCK_METHOD2(ReadTx,bool(const uint64_t txIndex, CWalletTx& walletTransaction));
+    MOCK_METHOD4(ReadTxs,unsigned(const uint64_t firstTxIndex, const unsigned maxCount, const CWalletTx& emptyTransaction, std::vector<CWalletTx>& walletTransactions));
     MOCK_METHOD1(WriteManagedScripts,bool(const ManagedScripts& managedScripts));
     MOCK_METHOD1(ReadManagedScripts, bool(ManagedScripts& managedScripts));
 };
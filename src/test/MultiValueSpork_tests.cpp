@@ -0,0 +1,45 @@
+#include <spork.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+MultiValueSporkList<BlockSubsiditySporkValue> subsidySporks()
+{
+    // Sorted by the time they were signed, as the spork manager keeps them
+    MultiValueSporkList<BlockSubsiditySporkValue> sporks;
+    sporks.emplace_back(BlockSubsiditySporkValue(100, 1000), 5000);
+    sporks.emplace_back(BlockSubsiditySporkValue(200, 3000), 6000);
+    sporks.emplace_back(BlockSubsiditySporkValue(300, 2000), 7000);
+    return sporks;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MultiValueSpork_tests)
+
+BOOST_AUTO_TEST_CASE(willFindNoSporkBeforeTheFirstOneIsSignedOrActivated)
+{
+    const MultiValueSporkList<BlockSubsiditySporkValue> sporks = subsidySporks();
+    BOOST_CHECK(!CSporkManager::GetActiveMultiValueSpork(sporks, 5000, 5000).IsValid());
+    BOOST_CHECK(!CSporkManager::GetActiveMultiValueSpork(sporks, 999, 8000).IsValid());
+    BOOST_CHECK(!CSporkManager::GetActiveMultiValueSpork(MultiValueSporkList<BlockSubsiditySporkValue>(), 5000, 8000).IsValid());
+}
+
+BOOST_AUTO_TEST_CASE(willFindTheLastSporkSignedBeforeTheBlockTime)
+{
+    const MultiValueSporkList<BlockSubsiditySporkValue> sporks = subsidySporks();
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 5000, 5001).nBlockSubsidity, 100);
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 5000, 7000).nBlockSubsidity, 200);
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 5000, 7001).nBlockSubsidity, 300);
+}
+
+BOOST_AUTO_TEST_CASE(willSkipTheSporksNotActivatedAtTheHeight)
+{
+    const MultiValueSporkList<BlockSubsiditySporkValue> sporks = subsidySporks();
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 1500, 8000).nBlockSubsidity, 100);
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 2500, 8000).nBlockSubsidity, 300);
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 2500, 7000).nBlockSubsidity, 100);
+    BOOST_CHECK_EQUAL(CSporkManager::GetActiveMultiValueSpork(sporks, 3000, 7000).nBlockSubsidity, 200);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+#include <NetworkStreamCompression.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+bool Append(std::string* decoded, const char* data, size_t size)
+{
+    decoded->append(data, size);
+    return true;
+}
+
+bool Refuse(const char*, size_t)
+{
+    return false;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(NetworkStreamCompression_tests)
+
+BOOST_AUTO_TEST_CASE(decodesEachMessageAsSoonAsItArrives)
+{
+    if (!NetworkStreamCompressor::IsSupported())
+        return;
+    NetworkStreamCompressor compressor;
+    NetworkStreamDecompressor decompressor;
+    std::string decoded;
+
+    const std::string first(1000, 'a');
+    const std::string second = "inv" + std::string(500, 'b') + first;
+    std::vector<char> sent;
+    BOOST_CHECK(compressor.Compress(first.data(), first.size(), sent));
+    BOOST_CHECK(sent.size() < first.size());
+    BOOST_CHECK(decompressor.Decompress(sent.data(), sent.size(), boost::bind(&Append, &decoded, _1, _2)));
+    BOOST_CHECK_EQUAL(decoded, first);
+
+    sent.clear();
+    BOOST_CHECK(compressor.Compress(second.data(), second.size(), sent));
+    for (size_t nByte = 0; nByte < sent.size(); nByte++)
+        BOOST_CHECK(decompressor.Decompress(&sent[nByte], 1, boost::bind(&Append, &decoded, _1, _2)));
+    BOOST_CHECK_EQUAL(decoded, first + second);
+}
+
+BOOST_AUTO_TEST_CASE(handsOutLargeMessagesInPieces)
+{
+    if (!NetworkStreamCompressor::IsSupported())
+        return;
+    NetworkStreamCompressor compressor;
+    NetworkStreamDecompressor decompressor;
+    const std::string message(1 << 20, 'z');
+    std::vector<char> sent;
+    BOOST_CHECK(compressor.Compress(message.data(), message.size(), sent));
+
+    std::string decoded;
+    BOOST_CHECK(decompressor.Decompress(sent.data(), sent.size(), boost::bind(&Append, &decoded, _1, _2)));
+    BOOST_CHECK(decoded == message);
+    BOOST_CHECK(!NetworkStreamDecompressor().Decompress(sent.data(), sent.size(), &Refuse));
+}
+
+BOOST_AUTO_TEST_CASE(rejectsCorruptStreams)
+{
+    if (!NetworkStreamCompressor::IsSupported())
+        return;
+    NetworkStreamDecompressor decompressor;
+    const std::string garbage(64, '\xff');
+    std::string decoded;
+    BOOST_CHECK(!decompressor.Decompress(garbage.data(), garbage.size(), boost::bind(&Append, &decoded, _1, _2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
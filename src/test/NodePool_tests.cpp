@@ -0,0 +1,99 @@
+#include <NodePool.h>
+#include <NodePoolAllocator.h>
+
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/unordered_map.hpp>
+
+BOOST_AUTO_TEST_SUITE(NodePool_tests)
+
+BOOST_AUTO_TEST_CASE(willReuseDeallocatedNodesOfTheSameSize)
+{
+    NodePool pool;
+    void* first = pool.Allocate(40);
+    pool.Deallocate(first, 40);
+    BOOST_CHECK(pool.Allocate(36) == first);
+    BOOST_CHECK(pool.Allocate(40) != first);
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), NodePool::CHUNK_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(willAllocateNewChunksWhenExhausted)
+{
+    NodePool pool;
+    const size_t nodesPerChunk = NodePool::CHUNK_SIZE / NodePool::MAX_NODE_SIZE;
+    for (size_t i = 0; i <= nodesPerChunk; ++i)
+        pool.Allocate(NodePool::MAX_NODE_SIZE);
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), 2 * NodePool::CHUNK_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(willReleaseChunksAllNodesWereFreedFrom)
+{
+    NodePool pool;
+    const size_t nodesPerChunk = NodePool::CHUNK_SIZE / NodePool::MAX_NODE_SIZE;
+    std::vector<void*> nodes;
+    for (size_t i = 0; i < 3 * nodesPerChunk; ++i)
+        nodes.push_back(pool.Allocate(NodePool::MAX_NODE_SIZE));
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), 3 * NodePool::CHUNK_SIZE);
+
+    // One node keeps the second chunk, the current chunk always stays
+    for (size_t i = 0; i < 2 * nodesPerChunk; ++i) {
+        if (i != nodesPerChunk)
+            pool.Deallocate(nodes[i], NodePool::MAX_NODE_SIZE);
+    }
+    BOOST_CHECK_EQUAL(pool.ReleaseFreeChunks(), NodePool::CHUNK_SIZE);
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), 2 * NodePool::CHUNK_SIZE);
+    BOOST_CHECK_EQUAL(pool.ReleaseFreeChunks(), 0u);
+
+    // The free nodes of the chunk that stayed are still handed out
+    void* reused = pool.Allocate(NodePool::MAX_NODE_SIZE);
+    BOOST_CHECK(reused >= nodes[nodesPerChunk + 1] && reused <= nodes[2 * nodesPerChunk - 1]);
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), 2 * NodePool::CHUNK_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepErasedNodesOfContainersUntilTheirChunksAreReleased)
+{
+    typedef boost::unordered_map<int, uint256, boost::hash<int>, std::equal_to<int>,
+        NodePoolAllocator<std::pair<const int, uint256> > > PooledMap;
+    PooledMap map;
+    for (int i = 0; i < 10000; ++i)
+        map[i] = uint256(i);
+    const size_t usage = map.get_allocator().PoolMemoryUsage();
+
+    for (int i = 0; i < 9000; ++i)
+        map.erase(i);
+    BOOST_CHECK_EQUAL(map.get_allocator().PoolMemoryUsage(), usage);
+    BOOST_CHECK(map.get_allocator().ReleaseFreeChunks() > 0);
+    BOOST_CHECK(map.get_allocator().PoolMemoryUsage() < usage);
+    BOOST_CHECK(map[9999] == uint256(9999));
+}
+
+BOOST_AUTO_TEST_CASE(willGiveCopiedAndCopyAssignedContainersTheirOwnPool)
+{
+    typedef boost::unordered_map<int, uint256, boost::hash<int>, std::equal_to<int>,
+        NodePoolAllocator<std::pair<const int, uint256> > > PooledMap;
+    PooledMap original;
+    for (int i = 0; i < 1000; ++i)
+        original[i] = uint256(i);
+
+    PooledMap copy(original);
+    BOOST_CHECK(copy.get_allocator() != original.get_allocator());
+    original.clear();
+    BOOST_CHECK_EQUAL(copy.size(), 1000u);
+    BOOST_CHECK(copy[999] == uint256(999));
+
+    PooledMap assigned;
+    const NodePoolAllocator<std::pair<const int, uint256> > assignedAllocator = assigned.get_allocator();
+    assigned = copy;
+    BOOST_CHECK(assigned.get_allocator() == assignedAllocator);
+    BOOST_CHECK(assigned.get_allocator() != copy.get_allocator());
+    BOOST_CHECK(assigned[999] == uint256(999));
+
+    PooledMap swapped;
+    const NodePoolAllocator<std::pair<const int, uint256> > allocator = copy.get_allocator();
+    swapped.swap(copy);
+    BOOST_CHECK(swapped.get_allocator() == allocator);
+    BOOST_CHECK(swapped[0] == uint256(0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+#include <NotificationDispatchQueue.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+void Record(std::vector<int>* delivered, int notification)
+{
+    delivered->push_back(notification);
+}
+
+void RecordThread(boost::thread::id* thread)
+{
+    *thread = boost::this_thread::get_id();
+}
+
+void BlockUntilReleased(boost::mutex* release)
+{
+    boost::unique_lock<boost::mutex> lock(*release);
+}
+
+struct Gate {
+    boost::mutex mutex;
+    boost::condition_variable changed;
+    bool entered;
+    bool open;
+
+    Gate(): mutex(), changed(), entered(false), open(false) {}
+
+    void Pass()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        entered = true;
+        changed.notify_all();
+        while (!open)
+            changed.wait(lock);
+    }
+    void WaitUntilEntered()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!entered)
+            changed.wait(lock);
+    }
+    void Open()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        open = true;
+        changed.notify_all();
+    }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(NotificationDispatchQueue_tests)
+
+BOOST_AUTO_TEST_CASE(willDeliverStraightAwayUntilStarted)
+{
+    std::vector<int> delivered;
+    NotificationDispatchQueue queue(10);
+    boost::thread::id thread;
+    queue.Dispatch(boost::bind(&Record, &delivered, 1));
+    queue.Dispatch(boost::bind(&RecordThread, &thread));
+    BOOST_CHECK(delivered == std::vector<int>({1}));
+    BOOST_CHECK(thread == boost::this_thread::get_id());
+    BOOST_CHECK_EQUAL(queue.Pending(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willDeliverInOrderFromItsOwnThreadOnceStarted)
+{
+    std::vector<int> delivered;
+    NotificationDispatchQueue queue(100);
+    queue.Start();
+    boost::thread::id thread;
+    for (int i = 0; i < 50; i++)
+        queue.Dispatch(boost::bind(&Record, &delivered, i));
+    queue.Dispatch(boost::bind(&RecordThread, &thread));
+    queue.WaitUntilDelivered();
+
+    BOOST_CHECK_EQUAL(delivered.size(), 50u);
+    for (int i = 0; i < 50; i++)
+        BOOST_CHECK_EQUAL(delivered[i], i);
+    BOOST_CHECK(thread != boost::this_thread::get_id());
+    queue.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(willDeliverWhatIsPendingWhenStopped)
+{
+    std::vector<int> delivered;
+    boost::mutex release;
+    NotificationDispatchQueue queue(100);
+    queue.Start();
+    {
+        boost::unique_lock<boost::mutex> lock(release);
+        queue.Dispatch(boost::bind(&BlockUntilReleased, &release));
+        queue.Dispatch(boost::bind(&Record, &delivered, 1));
+        queue.Dispatch(boost::bind(&Record, &delivered, 2));
+        BOOST_CHECK(delivered.empty());
+    }
+    queue.Stop();
+    BOOST_CHECK(delivered == std::vector<int>({1, 2}));
+    BOOST_CHECK(!queue.IsRunning());
+
+    queue.Dispatch(boost::bind(&Record, &delivered, 3));
+    BOOST_CHECK(delivered == std::vector<int>({1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(willNotWaitForRoomWhileTheQueueThreadIsBusy)
+{
+    std::vector<int> delivered;
+    Gate gate;
+    NotificationDispatchQueue queue(2);
+    queue.Start();
+    queue.Dispatch(boost::bind(&Gate::Pass, &gate));
+    gate.WaitUntilEntered();
+
+    for (int i = 0; i < 4; i++)
+        queue.Dispatch(boost::bind(&Record, &delivered, i));
+    BOOST_CHECK(delivered.empty());
+    BOOST_CHECK_EQUAL(queue.Pending(), 4u);
+
+    gate.Open();
+    queue.WaitUntilDelivered();
+    BOOST_CHECK(delivered == std::vector<int>({0, 1, 2, 3}));
+    queue.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(willNotMakeDispatchersWaitWhileStopping)
+{
+    std::vector<int> delivered;
+    Gate gate;
+    NotificationDispatchQueue queue(1);
+    queue.Start();
+    queue.Dispatch(boost::bind(&Gate::Pass, &gate));
+    gate.WaitUntilEntered();
+
+    boost::thread stopping(boost::bind(&NotificationDispatchQueue::Stop, &queue));
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+    for (int i = 0; i < 3; i++)
+        queue.Dispatch(boost::bind(&Record, &delivered, i));
+    BOOST_CHECK(delivered.empty());
+    BOOST_CHECK(queue.IsRunning());
+
+    gate.Open();
+    stopping.join();
+    BOOST_CHECK(delivered == std::vector<int>({0, 1, 2}));
+    BOOST_CHECK(!queue.IsRunning());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+#include <OrphanTransactionPool.h>
+
+#include <hash.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+uint256 ParentHash(int n)
+{
+    return Hash(BEGIN(n), END(n));
+}
+
+/** A transaction spending output n of the parent, padded to about the given size */
+CTransaction Orphan(const uint256& parent, unsigned int n, unsigned int nPadding = 0)
+{
+    CMutableTransaction tx;
+    tx.vin.push_back(CTxIn(COutPoint(parent, n)));
+    tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(nPadding, 1);
+    tx.vout.push_back(CTxOut(1000, CScript() << OP_TRUE));
+    return CTransaction(tx);
+}
+
+size_t SizeOf(const CTransaction& tx)
+{
+    return tx.GetSerializeSize(SER_NETWORK, CTransaction::CURRENT_VERSION);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(OrphanTransactionPool_tests)
+
+BOOST_AUTO_TEST_CASE(willFindTheOrphansSpendingTheOutputsOfAParent)
+{
+    OrphanTransactionPool pool;
+    CMutableTransaction parent;
+    parent.vout.resize(3);
+    const uint256 parentHash = CTransaction(parent).GetHash();
+    const CTransaction spendsFirst = Orphan(parentHash, 0);
+    const CTransaction spendsLast = Orphan(parentHash, 2);
+    BOOST_CHECK(pool.Add(spendsFirst, 1, 0, 100000));
+    BOOST_CHECK(pool.Add(spendsLast, 2, 0, 100000));
+    BOOST_CHECK(pool.Add(Orphan(parentHash, 3), 2, 0, 100000));
+    BOOST_CHECK(pool.Add(Orphan(ParentHash(1), 0), 2, 0, 100000));
+    BOOST_CHECK(!pool.Add(spendsFirst, 3, 0, 100000));
+
+    std::vector<uint256> spending;
+    pool.GetOrphansSpending(CTransaction(parent), spending);
+    BOOST_REQUIRE_EQUAL(spending.size(), 2u);
+    BOOST_CHECK(spending[0] == spendsFirst.GetHash());
+    BOOST_CHECK(spending[1] == spendsLast.GetHash());
+
+    NodeId peer = -1;
+    BOOST_REQUIRE(pool.Get(spendsLast.GetHash(), peer) != nullptr);
+    BOOST_CHECK_EQUAL(peer, 2);
+    pool.Erase(spendsFirst.GetHash());
+    spending.clear();
+    pool.GetOrphansSpending(CTransaction(parent), spending);
+    BOOST_CHECK_EQUAL(spending.size(), 1u);
+    BOOST_CHECK(pool.Get(spendsFirst.GetHash(), peer) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(willMakeRoomFromTheOldestOrphansOfAPeerOverItsQuota)
+{
+    OrphanTransactionPool pool;
+    const size_t nSize = SizeOf(Orphan(ParentHash(0), 0, 500));
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK(pool.Add(Orphan(ParentHash(i), 0, 500), 1, i, 3 * nSize));
+    BOOST_CHECK(pool.Add(Orphan(ParentHash(9), 0, 500), 2, 9, 3 * nSize));
+
+    BOOST_CHECK_EQUAL(pool.Size(), 4u);
+    BOOST_CHECK(!pool.Contains(Orphan(ParentHash(1), 0, 500).GetHash()));
+    BOOST_CHECK(pool.Contains(Orphan(ParentHash(2), 0, 500).GetHash()));
+    BOOST_CHECK(!pool.Add(Orphan(ParentHash(10), 0, OrphanTransactionPool::MAX_ORPHAN_TX_SIZE), 3, 10, 100000));
+
+    const OrphanTransactionPool::Stats stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.bytes, 4 * nSize);
+    BOOST_REQUIRE_EQUAL(stats.peers.size(), 2u);
+    BOOST_CHECK_EQUAL(stats.peers[0].count, 3u);
+    BOOST_CHECK_EQUAL(stats.peers[1].bytes, nSize);
+}
+
+BOOST_AUTO_TEST_CASE(willEvictFromThePeerHoldingTheMostWhenFull)
+{
+    OrphanTransactionPool pool;
+    for (int i = 0; i < 8; i++)
+        BOOST_CHECK(pool.Add(Orphan(ParentHash(i), 0), 1, i, 100000));
+    BOOST_CHECK(pool.Add(Orphan(ParentHash(20), 0), 2, 20, 100000));
+    BOOST_CHECK(pool.Add(Orphan(ParentHash(21), 0), 3, 21, 100000));
+
+    BOOST_CHECK_EQUAL(pool.LimitCount(4), 6u);
+    BOOST_CHECK(pool.Contains(Orphan(ParentHash(20), 0).GetHash()));
+    BOOST_CHECK(pool.Contains(Orphan(ParentHash(21), 0).GetHash()));
+    BOOST_CHECK(pool.Contains(Orphan(ParentHash(7), 0).GetHash()));
+
+    BOOST_CHECK_EQUAL(pool.EraseForPeer(1), 2u);
+    BOOST_CHECK_EQUAL(pool.Size(), 2u);
+    BOOST_CHECK_EQUAL(pool.LimitCount(0), 2u);
+    BOOST_CHECK(pool.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(willExpireOrphansThatWaitedTooLong)
+{
+    OrphanTransactionPool pool;
+    const int64_t nStart = 1000000;
+    BOOST_CHECK(pool.Add(Orphan(ParentHash(0), 0), 1, nStart, 100000));
+    BOOST_CHECK(pool.Add(Orphan(ParentHash(1), 0), 1, nStart + 600, 100000));
+
+    const int64_t nFirstLook = nStart + OrphanTransactionPool::ORPHAN_TX_EXPIRE_TIME - 1;
+    BOOST_CHECK_EQUAL(pool.Expire(nFirstLook), 0u);
+    // Nothing is looked at again until the interval has passed
+    BOOST_CHECK_EQUAL(pool.Expire(nStart + OrphanTransactionPool::ORPHAN_TX_EXPIRE_TIME), 0u);
+    BOOST_CHECK_EQUAL(pool.Expire(nFirstLook + OrphanTransactionPool::ORPHAN_TX_EXPIRE_INTERVAL), 1u);
+    BOOST_CHECK(pool.Contains(Orphan(ParentHash(1), 0).GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
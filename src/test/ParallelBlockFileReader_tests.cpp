@@ -0,0 +1,181 @@
+#include <ParallelBlockFileReader.h>
+
+#include <BlockFileScanner.h>
+#include <clientversion.h>
+#include <primitives/block.h>
+#include <streams.h>
+
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+const MessageStartChars messageStart = {0x01, 0x02, 0x03, 0x04};
+
+CBlock BlockWithNonce(unsigned int nNonce)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << nNonce << OP_0;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 50;
+    CBlock block;
+    block.vtx.push_back(CTransaction(coinbase));
+    block.nNonce = nNonce;
+    return block;
+}
+
+/** blk?????.dat-style contents: each block preceded by the message start and its size */
+std::string BlockFileContents(const std::vector<CBlock>& blocks, const std::string& garbage = "")
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    for (unsigned n = 0; n < blocks.size(); n++) {
+        ss.write(garbage.data(), garbage.size());
+        ss << FLATDATA(messageStart) << (unsigned int)::GetSerializeSize(blocks[n], SER_DISK, CLIENT_VERSION) << blocks[n];
+    }
+    return std::string(ss.begin(), ss.end());
+}
+
+FILE* FileWithContents(const std::string& contents)
+{
+    FILE* file = tmpfile();
+    BOOST_REQUIRE(file != NULL);
+    BOOST_REQUIRE_EQUAL(fwrite(contents.data(), 1, contents.size(), file), contents.size());
+    rewind(file);
+    return file;
+}
+
+class BlockFiles
+{
+public:
+    std::vector<std::string> contents;
+
+    FILE* Open(int nFile) const
+    {
+        if (nFile >= (int)contents.size())
+            return NULL;
+        return FileWithContents(contents[nFile]);
+    }
+
+    ParallelBlockFileReader::FileOpener Opener() const
+    {
+        return boost::bind(&BlockFiles::Open, this, _1);
+    }
+};
+
+bool CollectBlock(std::vector<std::pair<uint64_t, unsigned int> >* found, CBlock& block, uint64_t nBlockPos)
+{
+    found->push_back(std::make_pair(nBlockPos, block.nNonce));
+    return true;
+}
+
+bool StopAtFirstBlock(int* pnFound, CBlock&, uint64_t)
+{
+    ++*pnFound;
+    return false;
+}
+
+std::vector<unsigned int> ReadAllNonces(ParallelBlockFileReader& reader, std::vector<CDiskBlockPos>* positions = NULL)
+{
+    std::vector<unsigned int> nonces;
+    ParallelBlockFileReader::ScannedBlock scannedBlock;
+    while (reader.Next(scannedBlock)) {
+        nonces.push_back(scannedBlock.block->nNonce);
+        if (positions)
+            positions->push_back(scannedBlock.pos);
+    }
+    return nonces;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ParallelBlockFileReader_tests)
+
+BOOST_AUTO_TEST_CASE(willFindBlocksBetweenGarbageAndReportWhereTheyStart)
+{
+    std::vector<CBlock> blocks;
+    blocks.push_back(BlockWithNonce(1));
+    blocks.push_back(BlockWithNonce(2));
+    const std::string contents = BlockFileContents(blocks, std::string("\x01\x02garbage", 9));
+
+    std::vector<std::pair<uint64_t, unsigned int> > found;
+    ScanBlockFile(FileWithContents(contents), messageStart, boost::bind(&CollectBlock, &found, _1, _2));
+
+    BOOST_REQUIRE_EQUAL(found.size(), 2u);
+    BOOST_CHECK_EQUAL(found[0].second, 1u);
+    BOOST_CHECK_EQUAL(found[1].second, 2u);
+    const uint64_t nBlockSize = ::GetSerializeSize(blocks[0], SER_DISK, CLIENT_VERSION);
+    BOOST_CHECK_EQUAL(found[0].first, 9u + 8u);
+    BOOST_CHECK_EQUAL(found[1].first, found[0].first + nBlockSize + 9u + 8u);
+}
+
+BOOST_AUTO_TEST_CASE(willStopScanningWhenTheHandlerSaysSo)
+{
+    std::vector<CBlock> blocks;
+    blocks.push_back(BlockWithNonce(1));
+    blocks.push_back(BlockWithNonce(2));
+
+    int nFound = 0;
+    ScanBlockFile(FileWithContents(BlockFileContents(blocks)), messageStart, boost::bind(&StopAtFirstBlock, &nFound, _1, _2));
+    BOOST_CHECK_EQUAL(nFound, 1);
+}
+
+BOOST_AUTO_TEST_CASE(willHandBlocksOverInFileOrderWhateverTheThreadCount)
+{
+    BlockFiles files;
+    std::vector<unsigned int> expected;
+    for (unsigned nFile = 0; nFile < 6; nFile++) {
+        std::vector<CBlock> blocks;
+        for (unsigned n = 0; n < 5 + nFile; n++) {
+            blocks.push_back(BlockWithNonce(100 * nFile + n));
+            expected.push_back(100 * nFile + n);
+        }
+        files.contents.push_back(BlockFileContents(blocks));
+    }
+
+    for (unsigned nThreads = 1; nThreads <= 4; nThreads++) {
+        ParallelBlockFileReader reader(files.Opener(), messageStart, nThreads, 2);
+        std::vector<CDiskBlockPos> positions;
+        const std::vector<unsigned int> nonces = ReadAllNonces(reader, &positions);
+        BOOST_CHECK(nonces == expected);
+        BOOST_CHECK(reader.GetError().empty());
+        BOOST_REQUIRE_EQUAL(positions.size(), expected.size());
+        BOOST_CHECK_EQUAL(positions.front().nFile, 0);
+        BOOST_CHECK_EQUAL(positions.front().nPos, 8u);
+        BOOST_CHECK_EQUAL(positions.back().nFile, 5);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willSkipFilesWithoutBlocks)
+{
+    BlockFiles files;
+    files.contents.push_back(BlockFileContents(std::vector<CBlock>(1, BlockWithNonce(1))));
+    files.contents.push_back(std::string(100, '\0'));
+    files.contents.push_back(BlockFileContents(std::vector<CBlock>(1, BlockWithNonce(3))));
+
+    ParallelBlockFileReader reader(files.Opener(), messageStart, 2, 1);
+    const std::vector<unsigned int> nonces = ReadAllNonces(reader);
+    BOOST_REQUIRE_EQUAL(nonces.size(), 2u);
+    BOOST_CHECK_EQUAL(nonces[0], 1u);
+    BOOST_CHECK_EQUAL(nonces[1], 3u);
+}
+
+BOOST_AUTO_TEST_CASE(willStopScanningWhenDestroyedEarly)
+{
+    BlockFiles files;
+    for (unsigned nFile = 0; nFile < 4; nFile++)
+        files.contents.push_back(BlockFileContents(std::vector<CBlock>(10, BlockWithNonce(nFile))));
+
+    ParallelBlockFileReader reader(files.Opener(), messageStart, 4, 1);
+    ParallelBlockFileReader::ScannedBlock scannedBlock;
+    BOOST_CHECK(reader.Next(scannedBlock));
+    BOOST_CHECK_EQUAL(scannedBlock.block->nNonce, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
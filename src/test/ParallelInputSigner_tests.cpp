@@ -0,0 +1,112 @@
+#include <script/ParallelInputSigner.h>
+
+#include <key.h>
+#include <keystore.h>
+#include <primitives/transaction.h>
+#include <script/sign.h>
+#include <script/SignatureCheckers.h>
+#include <script/standard.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class ParallelInputSignerFixture
+{
+public:
+    CBasicKeyStore keyStore;
+    std::vector<CScript> scriptPubKeys;
+    CMutableTransaction txFrom;
+    CMutableTransaction txTo;
+
+    ParallelInputSignerFixture(
+        ): keyStore()
+        , scriptPubKeys()
+        , txFrom()
+        , txTo()
+    {
+    }
+
+    void spendFromNewKeys(unsigned numberOfInputs)
+    {
+        txFrom.vout.resize(numberOfInputs);
+        for (unsigned n = 0; n < numberOfInputs; n++) {
+            CKey key;
+            key.MakeNewKey(true);
+            keyStore.AddKey(key);
+            txFrom.vout[n].scriptPubKey = (n % 2 == 0)
+                ? GetScriptForDestination(key.GetPubKey().GetID())
+                : CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+            txFrom.vout[n].nValue = 1000;
+            scriptPubKeys.push_back(txFrom.vout[n].scriptPubKey);
+        }
+        txTo.vin.resize(numberOfInputs);
+        for (unsigned n = 0; n < numberOfInputs; n++)
+            txTo.vin[n].prevout = COutPoint(txFrom.GetHash(), n);
+        txTo.vout.resize(1);
+        txTo.vout[0].nValue = 1;
+    }
+
+    bool inputIsSigned(const CMutableTransaction& tx, unsigned n) const
+    {
+        return VerifyScript(tx.vin[n].scriptSig, scriptPubKeys[n], STANDARD_SCRIPT_VERIFY_FLAGS, MutableTransactionSignatureChecker(&tx, n));
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(ParallelInputSigner_tests, ParallelInputSignerFixture)
+
+BOOST_AUTO_TEST_CASE(willSignEveryInputAsSigningThemOneAfterTheOtherWould)
+{
+    spendFromNewKeys(10 * ParallelInputSigner::MIN_INPUTS_PER_THREAD);
+    CMutableTransaction txSignedInOrder(txTo);
+    for (unsigned n = 0; n < txSignedInOrder.vin.size(); n++)
+        BOOST_CHECK(SignSignature(keyStore, txFrom, txSignedInOrder, n));
+
+    BOOST_CHECK(ParallelInputSigner(keyStore).SignInputs(txTo, scriptPubKeys));
+    for (unsigned n = 0; n < txTo.vin.size(); n++) {
+        BOOST_CHECK(inputIsSigned(txTo, n));
+        BOOST_CHECK(txTo.vin[n].scriptSig == txSignedInOrder.vin[n].scriptSig);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willLeaveTheInputsWithoutAScriptAlone)
+{
+    spendFromNewKeys(3);
+    txTo.vin[1].scriptSig = CScript() << OP_TRUE;
+    scriptPubKeys[1] = CScript();
+
+    BOOST_CHECK(ParallelInputSigner(keyStore).SignInputs(txTo, scriptPubKeys));
+    BOOST_CHECK(txTo.vin[1].scriptSig == CScript() << OP_TRUE);
+    BOOST_CHECK(!txTo.vin[0].scriptSig.empty());
+    BOOST_CHECK(!txTo.vin[2].scriptSig.empty());
+}
+
+BOOST_AUTO_TEST_CASE(willReportInputsItHasNoKeysFor)
+{
+    spendFromNewKeys(2);
+    CBasicKeyStore partialKeyStore;
+    ParallelInputSigner::CopySigningKeys(keyStore, scriptPubKeys[0], partialKeyStore);
+
+    BOOST_CHECK(!ParallelInputSigner(partialKeyStore).SignInputs(txTo, scriptPubKeys));
+    BOOST_CHECK(inputIsSigned(txTo, 0));
+    BOOST_CHECK(!inputIsSigned(txTo, 1));
+}
+
+BOOST_AUTO_TEST_CASE(willCopyTheKeysAndRedeemScriptsBehindAPayToScriptHash)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    keyStore.AddKey(key);
+    const CScript redeemScript = GetScriptForDestination(key.GetPubKey().GetID());
+    keyStore.AddCScript(redeemScript);
+
+    CBasicKeyStore signingKeyStore;
+    ParallelInputSigner::CopySigningKeys(keyStore, GetScriptForDestination(CScriptID(redeemScript)), signingKeyStore);
+    BOOST_CHECK(signingKeyStore.HaveCScript(CScriptID(redeemScript)));
+    BOOST_CHECK(signingKeyStore.HaveKey(key.GetPubKey().GetID()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+#include <PartiallyDownloadedBlock.h>
+
+#include <BlockTransactions.h>
+#include <CompactBlock.h>
+#include <streams.h>
+#include <txmempool.h>
+#include <version.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CTransaction TransactionWithOutputValue(CAmount value)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout.hash = uint256(value);
+    tx.vin[0].prevout.n = 0;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx.vout[0].nValue = value;
+    return CTransaction(tx);
+}
+
+class PartiallyDownloadedBlockFixture
+{
+public:
+    CTxMemPool pool;
+    CBlock block;
+
+    PartiallyDownloadedBlockFixture(
+        ): pool(CFeeRate(0))
+        , block()
+    {
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].prevout.SetNull();
+        coinbase.vin[0].scriptSig = CScript() << OP_1 << OP_2;
+        coinbase.vout.resize(1);
+        coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        coinbase.vout[0].nValue = 50;
+        block.vtx.push_back(CTransaction(coinbase));
+        for (CAmount value = 1; value <= 3; value++)
+            block.vtx.push_back(TransactionWithOutputValue(value * 1000));
+        block.nTime = 1234567;
+        block.nBits = 0x1e0fffff;
+        block.hashMerkleRoot = block.BuildMerkleTree();
+    }
+
+    void addToMempool(const CTransaction& tx)
+    {
+        pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 1));
+    }
+
+    CompactBlock sentCompactBlock() const
+    {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << CompactBlock(block, 42);
+        CompactBlock received;
+        stream >> received;
+        return received;
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(PartiallyDownloadedBlock_tests, PartiallyDownloadedBlockFixture)
+
+BOOST_AUTO_TEST_CASE(willPrefillTheCoinbaseAndNameTheOthersByShortId)
+{
+    const CompactBlock compactBlock = sentCompactBlock();
+    BOOST_CHECK(compactBlock.header.GetHash() == block.GetHash());
+    BOOST_REQUIRE_EQUAL(compactBlock.prefilledTransactions.size(), 1u);
+    BOOST_CHECK_EQUAL(compactBlock.prefilledTransactions[0].index, 0u);
+    BOOST_REQUIRE_EQUAL(compactBlock.shortIds.size(), 3u);
+    BOOST_CHECK_EQUAL(compactBlock.shortIds[1], compactBlock.GetShortId(block.vtx[2].GetHash()));
+    BOOST_CHECK(compactBlock.shortIds[1] != CompactBlock(block, 43).GetShortId(block.vtx[2].GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(willRebuildTheBlockFromTheMempoolAndTheExtraTransactions)
+{
+    addToMempool(block.vtx[1]);
+    const CTransaction orphan = block.vtx[3];
+    const std::vector<const CTransaction*> extraTransactions(1, &orphan);
+
+    PartiallyDownloadedBlock partialBlock;
+    BOOST_REQUIRE(partialBlock.InitData(sentCompactBlock(), pool, extraTransactions) == PartiallyDownloadedBlock::READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(partialBlock.PrefilledCount(), 1u);
+    BOOST_CHECK_EQUAL(partialBlock.MempoolCount(), 1u);
+    BOOST_CHECK_EQUAL(partialBlock.ExtraCount(), 1u);
+    BOOST_CHECK(partialBlock.GetMissingIndexes() == std::vector<uint32_t>(1, 2));
+
+    CBlock rebuilt;
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, std::vector<CTransaction>(1, block.vtx[2])) == PartiallyDownloadedBlock::READ_STATUS_OK);
+    BOOST_CHECK(rebuilt.GetHash() == block.GetHash());
+    BOOST_CHECK(rebuilt.BuildMerkleTree() == block.hashMerkleRoot);
+}
+
+BOOST_AUTO_TEST_CASE(willFailWhenTheTransactionsHandedOverDoNotMatch)
+{
+    PartiallyDownloadedBlock partialBlock;
+    BOOST_REQUIRE(partialBlock.InitData(sentCompactBlock(), pool, std::vector<const CTransaction*>()) == PartiallyDownloadedBlock::READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(partialBlock.GetMissingIndexes().size(), 3u);
+
+    CBlock rebuilt;
+    std::vector<CTransaction> missing(block.vtx.begin() + 1, block.vtx.end());
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, std::vector<CTransaction>(missing.begin(), missing.begin() + 2)) == PartiallyDownloadedBlock::READ_STATUS_INVALID);
+    missing[1] = TransactionWithOutputValue(5000);
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, missing) == PartiallyDownloadedBlock::READ_STATUS_FAILED);
+}
+
+BOOST_AUTO_TEST_CASE(willRejectPrefilledTransactionsOutOfOrder)
+{
+    CompactBlock compactBlock = sentCompactBlock();
+    compactBlock.prefilledTransactions.push_back(compactBlock.prefilledTransactions[0]);
+    compactBlock.shortIds.pop_back();
+
+    PartiallyDownloadedBlock partialBlock;
+    BOOST_CHECK(partialBlock.InitData(compactBlock, pool, std::vector<const CTransaction*>()) == PartiallyDownloadedBlock::READ_STATUS_INVALID);
+}
+
+BOOST_AUTO_TEST_CASE(willRoundTripTheTransactionRequests)
+{
+    BlockTransactionsRequest request;
+    request.blockHash = block.GetHash();
+    request.indexes = {1, 3, 300};
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << request;
+    BlockTransactionsRequest received;
+    stream >> received;
+    BOOST_CHECK(received.blockHash == request.blockHash);
+    BOOST_CHECK(received.indexes == request.indexes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
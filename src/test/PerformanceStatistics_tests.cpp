@@ -0,0 +1,92 @@
+#include <PerformanceStatistics.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+struct PerformanceStatisticsTestFixture {
+    PerformanceStatisticsTestFixture()
+    {
+        PerformanceStatistics::Reset();
+    }
+    ~PerformanceStatisticsTestFixture()
+    {
+        PerformanceStatistics::Reset();
+    }
+};
+
+PerformanceTimerStats StatsOf(const std::vector<PerformanceTimerStats>& stats, PerformanceTimer timer)
+{
+    return stats[static_cast<unsigned>(timer)];
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(PerformanceStatistics_tests, PerformanceStatisticsTestFixture)
+
+BOOST_AUTO_TEST_CASE(reportsEveryTimerByName)
+{
+    const std::vector<PerformanceTimerStats> stats = PerformanceStatistics::GetStats();
+    BOOST_CHECK_EQUAL(stats.size(), PerformanceStatistics::NUMBER_OF_TIMERS);
+    BOOST_CHECK_EQUAL(StatsOf(stats, PerformanceTimer::CONNECT_BLOCK).name, "connectblock");
+    BOOST_CHECK_EQUAL(StatsOf(stats, PerformanceTimer::WALLET_SYNC).name, "wallet_sync");
+    BOOST_CHECK_EQUAL(StatsOf(stats, PerformanceTimer::CHECK_BLOCK).count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(recordsCountTotalAndMaximum)
+{
+    PerformanceStatistics::Record(PerformanceTimer::MEMPOOL_ACCEPT, 10);
+    PerformanceStatistics::Record(PerformanceTimer::MEMPOOL_ACCEPT, 300);
+    PerformanceStatistics::Record(PerformanceTimer::MEMPOOL_ACCEPT, -5);
+
+    const PerformanceTimerStats timer = StatsOf(PerformanceStatistics::GetStats(), PerformanceTimer::MEMPOOL_ACCEPT);
+    BOOST_CHECK_EQUAL(timer.count, 3u);
+    BOOST_CHECK_EQUAL(timer.totalMicros, 310u);
+    BOOST_CHECK_EQUAL(timer.maximumMicros, 300u);
+    BOOST_CHECK_EQUAL(timer.buckets[0], 1u);
+    BOOST_CHECK_EQUAL(timer.buckets[4], 1u);
+    BOOST_CHECK_EQUAL(timer.buckets[9], 1u);
+}
+
+BOOST_AUTO_TEST_CASE(percentilesAreTheUpperBoundsOfTheirBuckets)
+{
+    for (int i = 0; i < 90; ++i)
+        PerformanceStatistics::Record(PerformanceTimer::CONNECT_TIP, 100);
+    for (int i = 0; i < 10; ++i)
+        PerformanceStatistics::Record(PerformanceTimer::CONNECT_TIP, 5000);
+
+    const PerformanceTimerStats timer = StatsOf(PerformanceStatistics::GetStats(), PerformanceTimer::CONNECT_TIP);
+    BOOST_CHECK_EQUAL(timer.Percentile(0.5), 127u);
+    BOOST_CHECK_EQUAL(timer.Percentile(0.9), 127u);
+    // The bucket above 4096 reaches to 8191, but nothing took longer than 5000
+    BOOST_CHECK_EQUAL(timer.Percentile(0.99), 5000u);
+    BOOST_CHECK_EQUAL(PerformanceTimerStats().Percentile(0.5), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(addsUpTheTimesOfAllThreadsIncludingExitedOnes)
+{
+    boost::thread_group threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.create_thread([]() {
+            for (int j = 0; j < 250; ++j) {
+                PerformanceTimerScope timer(PerformanceTimer::BLOCK_TEMPLATE);
+            }
+        });
+    }
+    threads.join_all();
+    PerformanceStatistics::Record(PerformanceTimer::BLOCK_TEMPLATE, 1);
+
+    BOOST_CHECK_EQUAL(StatsOf(PerformanceStatistics::GetStats(), PerformanceTimer::BLOCK_TEMPLATE).count, 1001u);
+}
+
+BOOST_AUTO_TEST_CASE(resetStartsOver)
+{
+    PerformanceStatistics::Record(PerformanceTimer::MASTERNODE_MESSAGE, 42);
+    PerformanceStatistics::Reset();
+
+    const PerformanceTimerStats timer = StatsOf(PerformanceStatistics::GetStats(), PerformanceTimer::MASTERNODE_MESSAGE);
+    BOOST_CHECK_EQUAL(timer.count, 0u);
+    BOOST_CHECK_EQUAL(timer.maximumMicros, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include <PrefetchingBlockDataReader.h>
+
+#include <BlockUndo.h>
+#include <chain.h>
+#include <primitives/block.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class CountingBlockDataReader : public I_BlockDataReader
+{
+public:
+    mutable boost::atomic<int> nBlockReads;
+    mutable boost::atomic<int> nBlockUndoReads;
+
+    CountingBlockDataReader() : nBlockReads(0), nBlockUndoReads(0) {}
+
+    bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+    {
+        nBlockReads++;
+        if (blockIndex->nHeight < 0)
+            return false;
+        block = CBlock();
+        block.nNonce = blockIndex->nHeight;
+        return true;
+    }
+
+    bool ReadBlockUndo(const CBlockIndex* blockIndex, CBlockUndo& blockUndo) const
+    {
+        nBlockUndoReads++;
+        if (blockIndex->nHeight < 0)
+            return false;
+        blockUndo = CBlockUndo();
+        blockUndo.vtxundo.resize(blockIndex->nHeight);
+        return true;
+    }
+};
+
+class BlockChain
+{
+    std::vector<uint256> hashes_;
+    std::vector<std::unique_ptr<CBlockIndex> > indices_;
+
+public:
+    explicit BlockChain(int nBlocks)
+        : hashes_(nBlocks)
+        , indices_()
+    {
+        for (int nHeight = 0; nHeight < nBlocks; nHeight++) {
+            hashes_[nHeight] = uint256(nHeight + 1);
+            indices_.push_back(std::unique_ptr<CBlockIndex>(new CBlockIndex()));
+            indices_.back()->phashBlock = &hashes_[nHeight];
+            indices_.back()->nHeight = nHeight;
+            indices_.back()->pprev = nHeight > 0 ? indices_[nHeight - 1].get() : nullptr;
+        }
+    }
+
+    const CBlockIndex* operator[](int nHeight) const { return indices_[nHeight].get(); }
+};
+
+void Disconnect(const I_BlockDataReader& reader, const CBlockIndex* blockIndex)
+{
+    CBlock block;
+    CBlockUndo blockUndo;
+    BOOST_CHECK(reader.ReadBlock(blockIndex, block));
+    BOOST_CHECK(reader.ReadBlockUndo(blockIndex, blockUndo));
+    BOOST_CHECK_EQUAL(block.nNonce, static_cast<unsigned>(blockIndex->nHeight));
+    BOOST_CHECK_EQUAL(blockUndo.vtxundo.size(), static_cast<size_t>(blockIndex->nHeight));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(PrefetchingBlockDataReader_tests)
+
+BOOST_AUTO_TEST_CASE(willServeEachParentFromWhatWasReadAhead)
+{
+    CountingBlockDataReader diskReader;
+    BlockChain chain(6);
+    {
+        PrefetchingBlockDataReader reader(diskReader);
+        for (int nHeight = 5; nHeight > 0; nHeight--)
+            Disconnect(reader, chain[nHeight]);
+        // Only the tip had to be waited for
+        BOOST_CHECK_EQUAL(reader.GetMisses(), 2u);
+        BOOST_CHECK_EQUAL(reader.GetHits(), 8u);
+    }
+    // The genesis block, without undo data, is never read ahead
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 5);
+    BOOST_CHECK_EQUAL(diskReader.nBlockUndoReads, 5);
+}
+
+BOOST_AUTO_TEST_CASE(willNotReadAheadPastTheStop)
+{
+    CountingBlockDataReader diskReader;
+    BlockChain chain(6);
+    {
+        PrefetchingBlockDataReader reader(diskReader, chain[3]);
+        Disconnect(reader, chain[5]);
+        Disconnect(reader, chain[4]);
+    }
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 2);
+    BOOST_CHECK_EQUAL(diskReader.nBlockUndoReads, 2);
+}
+
+BOOST_AUTO_TEST_CASE(willReadBlocksAskedForOutOfOrderRightAway)
+{
+    CountingBlockDataReader diskReader;
+    BlockChain chain(6);
+    PrefetchingBlockDataReader reader(diskReader);
+    Disconnect(reader, chain[5]);
+    Disconnect(reader, chain[2]);
+    BOOST_CHECK_EQUAL(reader.GetMisses(), 4u);
+
+    CBlock block;
+    BOOST_CHECK(reader.ReadBlock(chain[2], block));
+    BOOST_CHECK_EQUAL(block.nNonce, 2u);
+    Disconnect(reader, chain[1]);
+    BOOST_CHECK_EQUAL(reader.GetHits(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willReadAgainWhatFailedToBeReadAhead)
+{
+    CountingBlockDataReader diskReader;
+    uint256 hashes[3] = {uint256(1), uint256(2), uint256(3)};
+    CBlockIndex genesis;
+    genesis.phashBlock = &hashes[0];
+    CBlockIndex unreadable;
+    unreadable.phashBlock = &hashes[1];
+    unreadable.nHeight = -1;
+    unreadable.pprev = &genesis;
+    CBlockIndex child;
+    child.phashBlock = &hashes[2];
+    child.nHeight = 2;
+    child.pprev = &unreadable;
+
+    PrefetchingBlockDataReader reader(diskReader);
+    CBlock block;
+    BOOST_CHECK(reader.ReadBlock(&child, block));
+    BOOST_CHECK(!reader.ReadBlock(&unreadable, block));
+    BOOST_CHECK_EQUAL(reader.GetHits(), 0u);
+    BOOST_CHECK_EQUAL(diskReader.nBlockReads, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
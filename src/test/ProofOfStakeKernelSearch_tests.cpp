@@ -0,0 +1,97 @@
+#include <ProofOfStakeKernelSearch.h>
+
+#include <I_ProofOfStakeGenerator.h>
+#include <StakingData.h>
+#include <uint256.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+/** Finds a hashproof for the candidates whose value is listed, as far before the initial timestamp as the value's last digit */
+class FakeProofOfStakeGenerator: public I_ProofOfStakeGenerator
+{
+private:
+    std::set<CAmount> winningValues_;
+    CAmount setupFailureValue_;
+
+public:
+    FakeProofOfStakeGenerator(const std::set<CAmount>& winningValues, CAmount setupFailureValue = -1)
+        : winningValues_(winningValues)
+        , setupFailureValue_(setupFailureValue)
+    {
+    }
+    HashproofCreationResult CreateHashproofTimestamp(const StakingData& stakingData, const unsigned initialTimestamp) const
+    {
+        if (stakingData.utxoValue_ == setupFailureValue_)
+            return HashproofCreationResult::FailedSetup();
+        if (!winningValues_.count(stakingData.utxoValue_))
+            return HashproofCreationResult::FailedGeneration();
+        return HashproofCreationResult::Success(initialTimestamp - stakingData.utxoValue_ % 10);
+    }
+    bool ComputeAndVerifyProofOfStake(const StakingData&, const unsigned int&, uint256&) const
+    {
+        return false;
+    }
+};
+
+std::vector<StakingData> Candidates(unsigned numberOfCandidates)
+{
+    std::vector<StakingData> candidates;
+    for (unsigned n = 0; n < numberOfCandidates; n++)
+        candidates.push_back(StakingData(0, 0, uint256(n), COutPoint(uint256(n), 0), n, uint256(0)));
+    return candidates;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ProofOfStakeKernelSearch_tests)
+
+BOOST_AUTO_TEST_CASE(willFindTheFirstCandidateInOrderWhateverTheNumberOfThreads)
+{
+    const std::vector<StakingData> candidates = Candidates(1000);
+    const std::set<CAmount> winningValues = {997, 640, 311, 312};
+    FakeProofOfStakeGenerator generator(winningValues);
+
+    for (unsigned nThreads = 1; nThreads <= 8; nThreads++) {
+        ProofOfStakeKernelSearch search(generator, nThreads);
+        std::vector<HashproofCreationResult> results;
+        BOOST_CHECK_EQUAL(search.FindFirstHashproof(candidates, 1000, 0, results), 311u);
+        BOOST_REQUIRE_EQUAL(results.size(), candidates.size());
+        BOOST_CHECK(results[311].succeeded());
+        BOOST_CHECK_EQUAL(results[311].timestamp(), 999u);
+        for (unsigned n = 0; n < 311; n++)
+            BOOST_CHECK(!results[n].succeeded());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willSkipHashproofsThatAreNotLaterThanTheLimit)
+{
+    const std::vector<StakingData> candidates = Candidates(500);
+    FakeProofOfStakeGenerator generator({19, 20, 400});
+    ProofOfStakeKernelSearch search(generator, 4);
+    std::vector<HashproofCreationResult> results;
+
+    // Candidate 19 finds 1000 - 9, which is not later than the limit, and 20 finds 1000
+    BOOST_CHECK_EQUAL(search.FindFirstHashproof(candidates, 1000, 991, results), 20u);
+    BOOST_CHECK(results[19].succeeded());
+    BOOST_CHECK_EQUAL(search.FindFirstHashproof(candidates, 1000, 1000, results), 500u);
+}
+
+BOOST_AUTO_TEST_CASE(willReportTheResultOfEveryCandidateBeforeTheWinner)
+{
+    const std::vector<StakingData> candidates = Candidates(200);
+    FakeProofOfStakeGenerator generator({150}, 3);
+    ProofOfStakeKernelSearch search(generator, 3);
+    std::vector<HashproofCreationResult> results;
+
+    BOOST_CHECK_EQUAL(search.FindFirstHashproof(candidates, 1000, 0, results), 150u);
+    BOOST_CHECK(results[3].failedAtSetup());
+    BOOST_CHECK(!results[4].failedAtSetup());
+    BOOST_CHECK(search.FindFirstHashproof(std::vector<StakingData>(), 1000, 0, results) == 0u);
+    BOOST_CHECK(results.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,7 @@
 #include <I_ProofOfStakeCalculator.h>
 #include <MockPoSStakeModifierService.h>
 #include <sstream>
+#include <limits>
 
 #include <gmock/gmock.h>
 
@@ -216,4 +217,34 @@ BOOST_AUTO_TEST_CASE(willEnsureBackwardCompatibilityWithMainnetHashproofs)
     }
 }
 
+BOOST_AUTO_TEST_CASE(willFindTheSameHashproofsAmongTimestampsAsCheckingThemOneByOne)
+{
+    const unsigned difficulties[] = {0x1d00ffff, 0x1f00ffff, 0x207fffff};
+    for (unsigned difficulty: difficulties)
+    {
+        for (int trial = 0; trial < 20; trial++)
+        {
+            uint32_t blockTimeOfFirstUTXOConfirmation = GetRandInt(1<<30);
+            StakingData stakingData(difficulty, blockTimeOfFirstUTXOConfirmation, GetRandHash(),
+                COutPoint(GetRandHash(),GetRandInt(10)), GetRandInt(100000)*COIN, GetRandHash());
+            ProofOfStakeCalculator calculator(stakingData, GetRand(std::numeric_limits<uint64_t>::max()));
+
+            // Start both under and over the coin age cap of a week less an hour
+            unsigned startingTimestamp = blockTimeOfFirstUTXOConfirmation + GetRandInt(2*60*60*24*7);
+            unsigned batchedTimestamp = startingTimestamp;
+            unsigned oneByOneTimestamp = startingTimestamp;
+            uint256 batchedHashproof;
+            uint256 oneByOneHashproof;
+            bool batchedResult = calculator.computeProofOfStakeAmongTimestamps(
+                batchedTimestamp, I_ProofOfStakeGenerator::nHashDrift, batchedHashproof);
+            bool oneByOneResult = calculator.I_ProofOfStakeCalculator::computeProofOfStakeAmongTimestamps(
+                oneByOneTimestamp, I_ProofOfStakeGenerator::nHashDrift, oneByOneHashproof);
+
+            BOOST_CHECK_EQUAL(batchedResult, oneByOneResult);
+            BOOST_CHECK_EQUAL(batchedTimestamp, oneByOneTimestamp);
+            BOOST_CHECK(batchedHashproof == oneByOneHashproof);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <RPCResponseCache.h>
+
+#include "json/json_spirit_utils.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace json_spirit;
+
+namespace
+{
+Object BlockReply(int nHeight, int nConfirmations)
+{
+    Object reply;
+    reply.push_back(Pair("height", nHeight));
+    reply.push_back(Pair("confirmations", nConfirmations));
+    reply.push_back(Pair("tx", Array(3, Value(std::string(64, 'a')))));
+    return reply;
+}
+
+int ConfirmationsOf(const Value& reply)
+{
+    return find_value(reply.get_obj(), "confirmations").get_int();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(RPCResponseCache_tests)
+
+BOOST_AUTO_TEST_CASE(handsOutRepliesWithTheConfirmationsAtTheTip)
+{
+    RPCResponseCache cache;
+    cache.SetLimits(1 << 20, 10);
+    const RPCResponseCacheKey key("getblock", uint256(1), 1);
+    cache.Insert(key, BlockReply(100, 11), 100, 110);
+
+    Value found;
+    BOOST_CHECK(cache.Find(key, 110, found));
+    BOOST_CHECK_EQUAL(ConfirmationsOf(found), 11);
+    BOOST_CHECK(cache.Find(key, 150, found));
+    BOOST_CHECK_EQUAL(ConfirmationsOf(found), 51);
+    BOOST_CHECK_EQUAL(find_value(found.get_obj(), "height").get_int(), 100);
+
+    BOOST_CHECK(!cache.Find(RPCResponseCacheKey("getblock", uint256(1), 2), 150, found));
+    BOOST_CHECK(!cache.Find(RPCResponseCacheKey("rest/block", uint256(1), 1), 150, found));
+    const RPCResponseCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nCachedResponses, 1u);
+    BOOST_CHECK(stats.nUsage > 3 * 64u);
+    BOOST_CHECK_EQUAL(stats.nHits, 2u);
+    BOOST_CHECK_EQUAL(stats.nMisses, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(keepsNoRepliesAboutShallowBlocks)
+{
+    RPCResponseCache cache;
+    cache.SetLimits(1 << 20, 10);
+    const RPCResponseCacheKey key("getblock", uint256(1), 1);
+    BOOST_CHECK(!cache.IsCacheable(100, 108));
+    BOOST_CHECK(cache.IsCacheable(100, 109));
+    cache.Insert(key, BlockReply(100, 9), 100, 108);
+
+    Value found;
+    BOOST_CHECK(!cache.Find(key, 200, found));
+    BOOST_CHECK_EQUAL(cache.GetStats().nCachedResponses, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(evictsTheLeastRecentlyUsedRepliesBeyondItsMemory)
+{
+    RPCResponseCache cache;
+    cache.SetLimits(1 << 20, 1);
+    const RPCResponseCacheKey first("getblock", uint256(1), 1);
+    cache.Insert(first, BlockReply(1, 1), 1, 1);
+    const size_t nUsage = cache.GetStats().nUsage;
+    cache.SetLimits(2 * nUsage, 1);
+
+    const RPCResponseCacheKey second("getblock", uint256(2), 1);
+    const RPCResponseCacheKey third("getblock", uint256(3), 1);
+    cache.Insert(second, BlockReply(2, 1), 2, 2);
+    Value found;
+    BOOST_CHECK(cache.Find(first, 3, found));
+    cache.Insert(third, BlockReply(3, 1), 3, 3);
+
+    BOOST_CHECK(cache.Find(first, 3, found));
+    BOOST_CHECK(!cache.Find(second, 3, found));
+    BOOST_CHECK(cache.Find(third, 3, found));
+    BOOST_CHECK(cache.GetStats().nUsage <= 2 * nUsage);
+}
+
+BOOST_AUTO_TEST_CASE(keepsNothingOnceClearedOrWithoutMemory)
+{
+    RPCResponseCache cache;
+    const RPCResponseCacheKey key("getblockheader", uint256(1), 0);
+    cache.Insert(key, Value(std::string("00")), 1, 100);
+    Value found;
+    BOOST_CHECK(!cache.Find(key, 100, found));
+
+    cache.SetLimits(1 << 20, 1);
+    cache.Insert(key, Value(std::string("00")), 1, 100);
+    BOOST_CHECK(cache.Find(key, 100, found));
+    BOOST_CHECK_EQUAL(found.get_str(), "00");
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Find(key, 100, found));
+    BOOST_CHECK_EQUAL(cache.GetStats().nUsage, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,58 @@
+#include <RPCWorkQueue.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+void Record(std::vector<int>* ran, int item)
+{
+    ran->push_back(item);
+}
+
+void RecordAndInterrupt(std::vector<int>* ran, int item, RPCWorkQueue* queue)
+{
+    ran->push_back(item);
+    queue->Interrupt();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(RPCWorkQueue_tests)
+
+BOOST_AUTO_TEST_CASE(willRefuseWorkBeyondItsDepth)
+{
+    std::vector<int> ran;
+    RPCWorkQueue queue(2);
+    BOOST_CHECK(queue.Enqueue(boost::bind(&Record, &ran, 1)));
+    BOOST_CHECK(queue.Enqueue(boost::bind(&Record, &ran, 2)));
+    BOOST_CHECK(!queue.Enqueue(boost::bind(&Record, &ran, 3)));
+    BOOST_CHECK_EQUAL(queue.Depth(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willRunWorkInTheOrderItWasQueued)
+{
+    std::vector<int> ran;
+    RPCWorkQueue queue(4);
+    queue.Enqueue(boost::bind(&Record, &ran, 1));
+    queue.Enqueue(boost::bind(&Record, &ran, 2));
+    queue.Enqueue(boost::bind(&RecordAndInterrupt, &ran, 3, &queue));
+    queue.Run();
+    BOOST_CHECK(ran == std::vector<int>({1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(willStopTheWorkersAndRefuseWorkOnceInterrupted)
+{
+    std::vector<int> ran;
+    RPCWorkQueue queue(4);
+    boost::thread worker(boost::bind(&RPCWorkQueue::Run, &queue));
+    queue.Interrupt();
+    worker.join();
+
+    BOOST_CHECK(!queue.Enqueue(boost::bind(&Record, &ran, 1)));
+    BOOST_CHECK(ran.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+#include <RecentTransactionCache.h>
+
+#include <primitives/transaction.h>
+#include <script/script.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CTransaction TransactionSpending(unsigned n, const CScript& scriptSig = CScript())
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256(n + 1), 0);
+    tx.vin[0].scriptSig = scriptSig;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = n;
+    return tx;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(RecentTransactionCache_tests)
+
+BOOST_AUTO_TEST_CASE(findsTransactionsByTxidAndBareTxid)
+{
+    RecentTransactionCache cache(10);
+    const CTransaction tx = TransactionSpending(1, CScript() << OP_TRUE);
+    BOOST_CHECK(tx.GetHash() != tx.GetBareTxid());
+    cache.Insert(tx, uint256(42));
+
+    CTransaction found;
+    uint256 hashBlock;
+    BOOST_CHECK(cache.Find(tx.GetHash(), found, hashBlock));
+    BOOST_CHECK(found.GetHash() == tx.GetHash());
+    BOOST_CHECK(hashBlock == uint256(42));
+
+    found = CTransaction();
+    hashBlock = 0;
+    BOOST_CHECK(cache.Find(tx.GetBareTxid(), found, hashBlock));
+    BOOST_CHECK(found.GetHash() == tx.GetHash());
+    BOOST_CHECK(hashBlock == uint256(42));
+
+    BOOST_CHECK(!cache.Find(uint256(7), found, hashBlock));
+    const TransactionCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nCachedTransactions, 1u);
+    BOOST_CHECK_EQUAL(stats.nHits, 2u);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(evictsTheLeastRecentlyUsedTransaction)
+{
+    RecentTransactionCache cache(2);
+    const CTransaction first = TransactionSpending(1);
+    const CTransaction second = TransactionSpending(2);
+    const CTransaction third = TransactionSpending(3);
+    cache.Insert(first, uint256(1));
+    cache.Insert(second, uint256(2));
+
+    CTransaction found;
+    uint256 hashBlock;
+    BOOST_CHECK(cache.Find(first.GetHash(), found, hashBlock));
+    cache.Insert(third, uint256(3));
+
+    BOOST_CHECK(cache.Find(first.GetHash(), found, hashBlock));
+    BOOST_CHECK(!cache.Find(second.GetHash(), found, hashBlock));
+    BOOST_CHECK(!cache.Find(second.GetBareTxid(), found, hashBlock));
+    BOOST_CHECK(cache.Find(third.GetHash(), found, hashBlock));
+    BOOST_CHECK_EQUAL(cache.GetStats().nCachedTransactions, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(evictingAMalleatedCopyKeepsTheBareTxidOfTheOther)
+{
+    RecentTransactionCache cache(2);
+    const CTransaction original = TransactionSpending(1, CScript() << OP_TRUE);
+    const CTransaction malleated = TransactionSpending(1, CScript() << OP_TRUE << OP_NOP);
+    BOOST_CHECK(original.GetHash() != malleated.GetHash());
+    BOOST_CHECK(original.GetBareTxid() == malleated.GetBareTxid());
+    cache.Insert(original, uint256(1));
+    cache.Insert(malleated, uint256(2));
+    cache.Insert(TransactionSpending(2), uint256(3));
+
+    CTransaction found;
+    uint256 hashBlock;
+    BOOST_CHECK(!cache.Find(original.GetHash(), found, hashBlock));
+    BOOST_CHECK(cache.Find(malleated.GetBareTxid(), found, hashBlock));
+    BOOST_CHECK(found.GetHash() == malleated.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(clearingForgetsEveryTransaction)
+{
+    RecentTransactionCache cache(10);
+    const CTransaction tx = TransactionSpending(1);
+    cache.Insert(tx, uint256(1));
+    cache.Clear();
+
+    CTransaction found;
+    uint256 hashBlock;
+    BOOST_CHECK(!cache.Find(tx.GetHash(), found, hashBlock));
+    BOOST_CHECK_EQUAL(cache.GetStats().nCachedTransactions, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(accountsForTheMemoryOfTheTransactionsItHolds)
+{
+    RecentTransactionCache cache(1);
+    const CTransaction small = TransactionSpending(1);
+    const CTransaction large = TransactionSpending(2, CScript() << std::vector<unsigned char>(200, 1));
+    cache.Insert(small, uint256(1));
+    const size_t nSmallUsage = cache.GetStats().nUsage;
+    BOOST_CHECK(nSmallUsage > 0);
+
+    cache.Insert(large, uint256(2));
+    BOOST_CHECK_EQUAL(cache.GetStats().nCachedTransactions, 1u);
+    BOOST_CHECK(cache.GetStats().nUsage > nSmallUsage + 200);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.GetStats().nUsage, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(cacheOfNoEntriesKeepsNothing)
+{
+    RecentTransactionCache cache(0);
+    const CTransaction tx = TransactionSpending(1);
+    cache.Insert(tx, uint256(1));
+
+    CTransaction found;
+    uint256 hashBlock;
+    BOOST_CHECK(!cache.Find(tx.GetHash(), found, hashBlock));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
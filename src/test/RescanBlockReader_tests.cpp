@@ -0,0 +1,213 @@
+#include <RescanBlockReader.h>
+
+#include <BlockFilter.h>
+#include <BlockUndo.h>
+#include <chain.h>
+#include <I_BlockDataReader.h>
+#include <I_BlockFilterReader.h>
+#include <key.h>
+#include <primitives/block.h>
+#include <script/standard.h>
+#include <WalletOutputFilter.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+/** Each block has a transaction paying to the given script at the heights listed, and one paying elsewhere */
+class FakeBlockDataReader: public I_BlockDataReader
+{
+private:
+    CScript script_;
+    std::set<int> heightsPayingToScript_;
+    std::set<int> unreadableHeights_;
+
+public:
+    FakeBlockDataReader(
+        const CScript& script,
+        const std::set<int>& heightsPayingToScript,
+        const std::set<int>& unreadableHeights = std::set<int>()
+        ): script_(script)
+        , heightsPayingToScript_(heightsPayingToScript)
+        , unreadableHeights_(unreadableHeights)
+    {
+    }
+    bool ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
+    {
+        if (unreadableHeights_.count(blockIndex->nHeight))
+            return false;
+        CMutableTransaction elsewhere;
+        elsewhere.vout.emplace_back(blockIndex->nHeight, CScript() << OP_TRUE);
+        block.vtx.push_back(CTransaction(elsewhere));
+        if (heightsPayingToScript_.count(blockIndex->nHeight)) {
+            CMutableTransaction payment;
+            payment.vout.emplace_back(blockIndex->nHeight, CScript() << OP_TRUE);
+            payment.vout.emplace_back(blockIndex->nHeight, script_);
+            block.vtx.push_back(CTransaction(payment));
+        }
+        return true;
+    }
+    bool ReadBlockUndo(const CBlockIndex*, CBlockUndo&) const
+    {
+        return false;
+    }
+};
+
+/** Filters of the blocks of a block data reader, except at the heights listed */
+class FakeBlockFilterReader: public I_BlockFilterReader
+{
+private:
+    const I_BlockDataReader& blockReader_;
+    std::set<int> heightsWithoutFilter_;
+
+public:
+    FakeBlockFilterReader(
+        const I_BlockDataReader& blockReader,
+        const std::set<int>& heightsWithoutFilter
+        ): blockReader_(blockReader)
+        , heightsWithoutFilter_(heightsWithoutFilter)
+    {
+    }
+    bool ReadBlockFilter(const CBlockIndex* blockIndex, BlockFilter& filter) const
+    {
+        CBlock block;
+        if (heightsWithoutFilter_.count(blockIndex->nHeight) || !blockReader_.ReadBlock(blockIndex, block))
+            return false;
+        filter = BlockFilter(block, CBlockUndo());
+        return true;
+    }
+};
+
+class RescanBlockReaderFixture
+{
+public:
+    std::vector<CBlockIndex> blockIndices;
+    std::vector<const CBlockIndex*> blocks;
+    CKeyID keyId;
+    std::shared_ptr<WalletOutputFilter> filter;
+
+    RescanBlockReaderFixture(
+        ): blockIndices(100)
+        , blocks()
+        , keyId()
+        , filter(std::make_shared<WalletOutputFilter>())
+    {
+        for (unsigned height = 0; height < blockIndices.size(); height++) {
+            blockIndices[height].nHeight = height;
+            blocks.push_back(&blockIndices[height]);
+        }
+        CKey key;
+        key.MakeNewKey(true);
+        keyId = key.GetPubKey().GetID();
+        filter->AddKey(keyId);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(RescanBlockReader_tests, RescanBlockReaderFixture)
+
+BOOST_AUTO_TEST_CASE(willHandOutTheBlocksInTheOrderListedWithThePaymentsToTheFilterMarked)
+{
+    const FakeBlockDataReader blockReader(GetScriptForDestination(keyId), {3, 50, 99});
+    RescanBlockReader reader(blockReader, blocks, filter, 4, 8);
+
+    RescanBlockReader::ScannedBlock scannedBlock;
+    for (unsigned height = 0; height < blocks.size(); height++) {
+        BOOST_REQUIRE(reader.Next(scannedBlock));
+        BOOST_CHECK(scannedBlock.pindex == blocks[height]);
+        BOOST_CHECK(scannedBlock.fRead);
+        BOOST_CHECK(scannedBlock.filter == filter);
+        BOOST_REQUIRE_EQUAL(scannedBlock.paysToFilter.size(), scannedBlock.block->vtx.size());
+        BOOST_CHECK(!scannedBlock.paysToFilter[0]);
+        const bool paysToFilter = height == 3 || height == 50 || height == 99;
+        BOOST_CHECK_EQUAL(scannedBlock.block->vtx.size(), paysToFilter ? 2u : 1u);
+        if (paysToFilter)
+            BOOST_CHECK(scannedBlock.paysToFilter[1]);
+    }
+    BOOST_CHECK(!reader.Next(scannedBlock));
+}
+
+BOOST_AUTO_TEST_CASE(willReadTheBlocksAsTheyAreAskedForWithoutThreads)
+{
+    const FakeBlockDataReader blockReader(GetScriptForDestination(keyId), {7});
+    RescanBlockReader reader(blockReader, blocks, filter, 0, 8);
+
+    RescanBlockReader::ScannedBlock scannedBlock;
+    unsigned blocksHandedOut = 0;
+    unsigned paymentsMarked = 0;
+    while (reader.Next(scannedBlock)) {
+        BOOST_CHECK(scannedBlock.pindex == blocks[blocksHandedOut]);
+        for (bool paysToFilter: scannedBlock.paysToFilter)
+            paymentsMarked += paysToFilter ? 1u : 0u;
+        ++blocksHandedOut;
+    }
+    BOOST_CHECK_EQUAL(blocksHandedOut, blocks.size());
+    BOOST_CHECK_EQUAL(paymentsMarked, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willMarkTheBlocksClaimedAfterANewFilterIsSetWithIt)
+{
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    const FakeBlockDataReader blockReader(GetScriptForDestination(otherKey.GetPubKey().GetID()), {1});
+    RescanBlockReader reader(blockReader, blocks, filter, 0, 8);
+
+    RescanBlockReader::ScannedBlock scannedBlock;
+    BOOST_REQUIRE(reader.Next(scannedBlock));
+    BOOST_CHECK(scannedBlock.filter == filter);
+
+    std::shared_ptr<WalletOutputFilter> newFilter = std::make_shared<WalletOutputFilter>(*filter);
+    newFilter->AddKey(otherKey.GetPubKey().GetID());
+    reader.SetFilter(newFilter);
+    BOOST_REQUIRE(reader.Next(scannedBlock));
+    BOOST_CHECK(scannedBlock.filter == newFilter);
+    BOOST_REQUIRE_EQUAL(scannedBlock.paysToFilter.size(), 2u);
+    BOOST_CHECK(scannedBlock.paysToFilter[1]);
+}
+
+BOOST_AUTO_TEST_CASE(willHandOutBlocksThatCouldNotBeReadAsUnread)
+{
+    const FakeBlockDataReader blockReader(GetScriptForDestination(keyId), {}, {10});
+    RescanBlockReader reader(blockReader, blocks, filter, 2, 4);
+
+    RescanBlockReader::ScannedBlock scannedBlock;
+    for (unsigned height = 0; height < blocks.size(); height++) {
+        BOOST_REQUIRE(reader.Next(scannedBlock));
+        BOOST_CHECK_EQUAL(scannedBlock.fRead, height != 10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willSkipTheBlocksWhoseBlockFilterRulesThemOut)
+{
+    const FakeBlockDataReader blockReader(GetScriptForDestination(keyId), {3, 50});
+    const FakeBlockFilterReader blockFilterReader(blockReader, {60});
+    RescanBlockReader reader(blockReader, blocks, filter, 4, 8, &blockFilterReader);
+
+    RescanBlockReader::ScannedBlock scannedBlock;
+    for (unsigned height = 0; height < blocks.size(); height++) {
+        BOOST_REQUIRE(reader.Next(scannedBlock));
+        BOOST_CHECK(scannedBlock.pindex == blocks[height]);
+        const bool fNeedsReading = height == 3 || height == 50 || height == 60;
+        BOOST_CHECK_EQUAL(scannedBlock.fSkipped, !fNeedsReading);
+        BOOST_CHECK_EQUAL(scannedBlock.fRead, fNeedsReading);
+        if (scannedBlock.fSkipped)
+            BOOST_CHECK(scannedBlock.block->vtx.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willStopTheThreadsWhenDestroyedBeforeAllBlocksWereHandedOut)
+{
+    const FakeBlockDataReader blockReader(GetScriptForDestination(keyId), {});
+    {
+        RescanBlockReader reader(blockReader, blocks, filter, 4, 2);
+        RescanBlockReader::ScannedBlock scannedBlock;
+        BOOST_CHECK(reader.Next(scannedBlock));
+    }
+    BOOST_CHECK(true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+#include <RunningCoinsStats.h>
+
+#include <coins.h>
+#include <crypto/muhash.h>
+#include <random.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CCoins CoinsWithOutputs(unsigned int nOutputs, int nHeight)
+{
+    CCoins coins;
+    coins.nHeight = nHeight;
+    coins.vout.resize(nOutputs);
+    for (unsigned int i = 0; i < nOutputs; i++) {
+        coins.vout[i].nValue = 1000 * (i + 1);
+        coins.vout[i].scriptPubKey = CScript() << OP_TRUE;
+    }
+    return coins;
+}
+
+void WriteCoins(CCoinsViewDB& coinsDB, const uint256& txid, const CCoins& coins, const uint256& hashBlock)
+{
+    CCoinsViewCache cache(&coinsDB);
+    *cache.ModifyCoins(txid) = coins;
+    cache.SetBestBlock(hashBlock);
+    BOOST_REQUIRE(cache.Flush());
+}
+
+uint256 Finalized(const MuHash3072& muhash)
+{
+    uint256 hash;
+    muhash.Finalize(hash.begin());
+    return hash;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(RunningCoinsStats_tests)
+
+BOOST_AUTO_TEST_CASE(muHashWillOnlyDependOnTheFinalSet)
+{
+    const unsigned char a[] = {1, 2, 3};
+    const unsigned char b[] = {4, 5};
+    const unsigned char c[] = {6};
+
+    MuHash3072 forward;
+    forward.Insert(a, sizeof(a)).Insert(b, sizeof(b));
+    MuHash3072 backward;
+    backward.Insert(b, sizeof(b)).Insert(c, sizeof(c)).Insert(a, sizeof(a)).Remove(c, sizeof(c));
+    BOOST_CHECK(Finalized(forward) == Finalized(backward));
+
+    MuHash3072 combined;
+    MuHash3072 onlyB;
+    onlyB.Insert(b, sizeof(b));
+    combined.Insert(a, sizeof(a));
+    combined *= onlyB;
+    BOOST_CHECK(Finalized(combined) == Finalized(forward));
+
+    MuHash3072 empty;
+    MuHash3072 emptied;
+    emptied.Insert(a, sizeof(a)).Remove(a, sizeof(a));
+    BOOST_CHECK(Finalized(empty) == Finalized(emptied));
+    BOOST_CHECK(Finalized(empty) != Finalized(forward));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchAFullScanAsCoinsChange)
+{
+    CCoinsViewDB coinsDB(1 << 20, true);
+    std::vector<uint256> txids;
+    for (int i = 0; i < 20; i++) {
+        txids.push_back(GetRandHash());
+        WriteCoins(coinsDB, txids.back(), CoinsWithOutputs(1 + i % 4, i), GetRandHash());
+    }
+
+    // Spend one output of a transaction and all outputs of another.
+    CCoins partiallySpent;
+    BOOST_REQUIRE(coinsDB.GetCoins(txids[3], partiallySpent));
+    partiallySpent.vout[1].SetNull();
+    WriteCoins(coinsDB, txids[3], partiallySpent, GetRandHash());
+    const uint256 hashBest = GetRandHash();
+    WriteCoins(coinsDB, txids[5], CCoins(), hashBest);
+
+    CCoinsStats running;
+    BOOST_REQUIRE(coinsDB.GetRunningStats(running));
+    CCoinsStats scanned;
+    BOOST_REQUIRE(coinsDB.GetStats(scanned));
+    BOOST_CHECK(running.hashBlock == hashBest);
+    BOOST_CHECK(scanned.hashBlock == hashBest);
+    BOOST_CHECK(running.hashMuHash == scanned.hashMuHash);
+    BOOST_CHECK_EQUAL(running.nTransactions, 19u);
+    BOOST_CHECK_EQUAL(running.nTransactions, scanned.nTransactions);
+    BOOST_CHECK_EQUAL(running.nTransactionOutputs, scanned.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(running.nTotalAmount, scanned.nTotalAmount);
+}
+
+BOOST_AUTO_TEST_CASE(willTellOutputsOfReplacedTransactionsApart)
+{
+    const uint256 txid = GetRandHash();
+    RunningCoinsStats replaced;
+    const CCoins original = CoinsWithOutputs(2, 10);
+    replaced.UpdateCoins(txid, NULL, original);
+    replaced.UpdateCoins(txid, &original, CoinsWithOutputs(2, 11));
+
+    RunningCoinsStats direct;
+    direct.UpdateCoins(txid, NULL, CoinsWithOutputs(2, 11));
+
+    CCoinsStats replacedStats;
+    CCoinsStats directStats;
+    replaced.GetStats(replacedStats);
+    direct.GetStats(directStats);
+    BOOST_CHECK(replacedStats.hashMuHash == directStats.hashMuHash);
+    BOOST_CHECK_EQUAL(replacedStats.nTransactionOutputs, 2u);
+    BOOST_CHECK_EQUAL(replacedStats.nTransactions, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,51 @@
+#include <ScriptExecutionCache.h>
+
+#include <primitives/transaction.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CTransaction TransactionWithLockTime(unsigned int lockTime)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.nLockTime = lockTime;
+    return CTransaction(tx);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ScriptExecutionCache_tests)
+
+BOOST_AUTO_TEST_CASE(willOnlyMatchTheSameTransactionUnderTheSameFlags)
+{
+    ScriptExecutionCache cache;
+    cache.SetupBytes(1 << 16);
+    const CTransaction tx = TransactionWithLockTime(1);
+    cache.Insert(cache.ComputeEntry(tx, 5));
+
+    BOOST_CHECK(cache.Contains(cache.ComputeEntry(tx, 5), false));
+    BOOST_CHECK(!cache.Contains(cache.ComputeEntry(tx, 4), false));
+    BOOST_CHECK(!cache.Contains(cache.ComputeEntry(TransactionWithLockTime(2), 5), false));
+}
+
+BOOST_AUTO_TEST_CASE(willSaltEntriesPerCache)
+{
+    ScriptExecutionCache first;
+    ScriptExecutionCache second;
+    const CTransaction tx = TransactionWithLockTime(1);
+    BOOST_CHECK(first.ComputeEntry(tx, 5) != second.ComputeEntry(tx, 5));
+}
+
+BOOST_AUTO_TEST_CASE(willForgetEverythingWhenResized)
+{
+    ScriptExecutionCache cache;
+    cache.SetupBytes(1 << 16);
+    const uint256 entry = cache.ComputeEntry(TransactionWithLockTime(1), 5);
+    cache.Insert(entry);
+    BOOST_CHECK_EQUAL(cache.SetupBytes(1 << 16), (1u << 16) / 32);
+    BOOST_CHECK(!cache.Contains(entry, false));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
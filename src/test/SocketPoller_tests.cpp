@@ -0,0 +1,95 @@
+#include <SocketPoller.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#ifndef WIN32
+namespace
+{
+class ConnectedSockets
+{
+public:
+    SOCKET sockets[2];
+
+    ConnectedSockets()
+    {
+        int descriptors[2];
+        BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) == 0);
+        sockets[0] = descriptors[0];
+        sockets[1] = descriptors[1];
+    }
+    ~ConnectedSockets()
+    {
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+};
+
+void checkPollerReportsReadiness(I_SocketPoller& poller)
+{
+    ConnectedSockets pair;
+    std::vector<I_SocketPoller::PolledSocket> polledSockets(
+        1, I_SocketPoller::PolledSocket(pair.sockets[0], 1, I_SocketPoller::POLL_RECEIVE));
+    poller.Update(polledSockets);
+
+    I_SocketPoller::ReadySockets readySockets;
+    BOOST_CHECK(poller.Wait(0, readySockets));
+    BOOST_CHECK(readySockets.empty());
+
+    BOOST_REQUIRE_EQUAL(send(pair.sockets[1], "x", 1, 0), 1);
+    BOOST_CHECK(poller.Wait(100, readySockets));
+    BOOST_CHECK(readySockets[pair.sockets[0]].receive);
+    // Readiness is reported again until the data has been received
+    BOOST_CHECK(poller.Wait(0, readySockets));
+    BOOST_CHECK(readySockets[pair.sockets[0]].receive);
+
+    polledSockets[0].interest = I_SocketPoller::POLL_SEND;
+    poller.Update(polledSockets);
+    BOOST_CHECK(poller.Wait(100, readySockets));
+    BOOST_CHECK(readySockets[pair.sockets[0]].send);
+    BOOST_CHECK(!readySockets[pair.sockets[0]].receive);
+
+    poller.Update(std::vector<I_SocketPoller::PolledSocket>());
+    BOOST_CHECK(poller.Wait(0, readySockets));
+    BOOST_CHECK(readySockets.empty());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(SocketPoller_tests)
+
+BOOST_AUTO_TEST_CASE(willReportReadinessWithSelect)
+{
+    SelectSocketPoller poller;
+    checkPollerReportsReadiness(poller);
+}
+
+BOOST_AUTO_TEST_CASE(willReportReadinessWithThePlatformPoller)
+{
+    std::unique_ptr<I_SocketPoller> poller = CreateSocketPoller();
+    checkPollerReportsReadiness(*poller);
+}
+
+BOOST_AUTO_TEST_CASE(willPollAReusedDescriptorForItsNewOwner)
+{
+    std::unique_ptr<I_SocketPoller> poller = CreateSocketPoller();
+    std::unique_ptr<ConnectedSockets> pair(new ConnectedSockets());
+    const SOCKET reusedSocket = pair->sockets[0];
+    poller->Update(std::vector<I_SocketPoller::PolledSocket>(
+        1, I_SocketPoller::PolledSocket(reusedSocket, 1, I_SocketPoller::POLL_RECEIVE)));
+    pair.reset();
+
+    pair.reset(new ConnectedSockets());
+    BOOST_REQUIRE(pair->sockets[0] == reusedSocket);
+    poller->Update(std::vector<I_SocketPoller::PolledSocket>(
+        1, I_SocketPoller::PolledSocket(reusedSocket, 2, I_SocketPoller::POLL_RECEIVE)));
+    BOOST_REQUIRE_EQUAL(send(pair->sockets[1], "x", 1, 0), 1);
+
+    I_SocketPoller::ReadySockets readySockets;
+    BOOST_CHECK(poller->Wait(100, readySockets));
+    BOOST_CHECK(readySockets[reusedSocket].receive);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
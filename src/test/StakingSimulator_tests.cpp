@@ -0,0 +1,129 @@
+#include <StakingSimulator.h>
+
+#include <blockmap.h>
+#include <chain.h>
+#include <FakeBlockIndexChain.h>
+#include <I_ProofOfStakeGenerator.h>
+#include <ProofOfStakeKernelSearch.h>
+#include <StakingData.h>
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+/** Finds a hashproof at the initial timestamp for the coins whose value is listed, once they are old enough */
+class FakeProofOfStakeGenerator: public I_ProofOfStakeGenerator
+{
+private:
+    std::set<CAmount> winningValues_;
+    unsigned minimumCoinAge_;
+
+public:
+    FakeProofOfStakeGenerator(const std::set<CAmount>& winningValues, unsigned minimumCoinAge)
+        : winningValues_(winningValues)
+        , minimumCoinAge_(minimumCoinAge)
+    {
+    }
+    HashproofCreationResult CreateHashproofTimestamp(const StakingData& stakingData, const unsigned initialTimestamp) const
+    {
+        if (stakingData.blockTimeOfFirstConfirmationBlock_ + minimumCoinAge_ > initialTimestamp)
+            return HashproofCreationResult::FailedSetup();
+        if (!winningValues_.count(stakingData.utxoValue_))
+            return HashproofCreationResult::FailedGeneration();
+        return HashproofCreationResult::Success(initialTimestamp);
+    }
+    bool ComputeAndVerifyProofOfStake(const StakingData&, const unsigned int&, uint256&) const
+    {
+        return false;
+    }
+};
+
+class StakingSimulatorFixture
+{
+public:
+    FakeBlockIndexWithHashes blocks;
+    FakeProofOfStakeGenerator generator;
+    ProofOfStakeKernelSearch kernelSearch;
+    StakingSimulator simulator;
+
+    StakingSimulatorFixture(
+        ): blocks(200, 1000000, 4)
+        , generator({1000}, 120)
+        , kernelSearch(generator, 2)
+        , simulator(*blocks.activeChain, *blocks.blockIndexByHash, kernelSearch)
+    {
+    }
+
+    StakingData coinConfirmedAt(int height, CAmount value, unsigned n = 0) const
+    {
+        const CBlockIndex* confirmation = (*blocks.activeChain)[height];
+        return StakingData(0, 0, confirmation->GetBlockHash(), COutPoint(uint256(n + 1), n), value, uint256(0));
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(StakingSimulator_tests, StakingSimulatorFixture)
+
+BOOST_AUTO_TEST_CASE(willRestakeAWinningCoinOnceItIsOldEnoughAgain)
+{
+    const std::vector<StakingData> coins(1, coinConfirmedAt(50, 1000));
+
+    // Blocks are a minute apart, so a restaked coin sits out the next block
+    const StakingSimulator::Result result = simulator.Simulate(coins, 101, 110);
+    BOOST_CHECK_EQUAL(result.numberOfCoins, 1u);
+    BOOST_CHECK_EQUAL(result.blocksSimulated, 10u);
+    BOOST_CHECK_EQUAL(result.blocksStaked, 5u);
+    BOOST_CHECK_EQUAL(result.kernelsHashed, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotStakeBlocksBeforeTheCoinsAreConfirmedAndOldEnough)
+{
+    const std::vector<StakingData> coins(1, coinConfirmedAt(105, 1000));
+
+    const StakingSimulator::Result result = simulator.Simulate(coins, 101, 110);
+    BOOST_CHECK_EQUAL(result.blocksStaked, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willCountTheKernelsOfCoinsThatNeverWin)
+{
+    const std::vector<StakingData> coins = {coinConfirmedAt(50, 999, 0), coinConfirmedAt(50, 998, 1)};
+
+    // Each minute between blocks takes two hash drifts to cover
+    const StakingSimulator::Result result = simulator.Simulate(coins, 101, 110);
+    BOOST_CHECK_EQUAL(result.blocksStaked, 0u);
+    BOOST_CHECK_EQUAL(result.kernelsHashed, 10u * 2u * 2u * I_ProofOfStakeGenerator::nHashDrift);
+}
+
+BOOST_AUTO_TEST_CASE(willNotSimulatePastTheTip)
+{
+    const std::vector<StakingData> coins(1, coinConfirmedAt(50, 1000));
+
+    const StakingSimulator::Result result = simulator.Simulate(coins, 195, 250);
+    BOOST_CHECK_EQUAL(result.blocksSimulated, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(willSplitCoinsIntoPartsOfTheSameTotalValue)
+{
+    const std::vector<StakingData> coins = {coinConfirmedAt(50, 1001, 0), coinConfirmedAt(60, 500, 1)};
+
+    const std::vector<StakingData> splitCoins = StakingSimulator::SplitCoins(coins, 4);
+    BOOST_REQUIRE_EQUAL(splitCoins.size(), 8u);
+    BOOST_CHECK(splitCoins[0].utxoBeingStaked_ == coins[0].utxoBeingStaked_);
+    BOOST_CHECK_EQUAL(splitCoins[0].utxoValue_, 251);
+    CAmount total = 0;
+    std::set<COutPoint> outpoints;
+    for (unsigned part = 0; part < 4; part++) {
+        total += splitCoins[part].utxoValue_;
+        outpoints.insert(splitCoins[part].utxoBeingStaked_);
+        BOOST_CHECK(splitCoins[part].blockHashOfFirstConfirmationBlock_ == coins[0].blockHashOfFirstConfirmationBlock_);
+        BOOST_CHECK_EQUAL(splitCoins[4 + part].utxoValue_, 125);
+    }
+    BOOST_CHECK_EQUAL(total, 1001);
+    BOOST_CHECK_EQUAL(outpoints.size(), 4u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,71 @@
+#include <StakingStatistics.h>
+
+#include <hash.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(StakingStatistics_tests)
+
+BOOST_AUTO_TEST_CASE(willCountAttemptsKernelsAndMissesByReason)
+{
+    StakingStatistics statistics;
+    for (int attempt = 0; attempt < 3; attempt++)
+        statistics.RecordAttempt();
+    statistics.RecordKernelSearch(10, 450, 2000);
+    statistics.RecordKernelSearch(12, 30, 1000);
+    statistics.RecordMiss(StakingMiss::NO_KERNEL_FOUND);
+    statistics.RecordMiss(StakingMiss::NO_KERNEL_FOUND);
+    statistics.RecordMiss(StakingMiss::BLOCK_REJECTED);
+    statistics.RecordStakeFound();
+
+    const StakingStatistics::Snapshot snapshot = statistics.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot.attempts, 3u);
+    BOOST_CHECK_EQUAL(snapshot.coinsScanned, 22u);
+    BOOST_CHECK_EQUAL(snapshot.kernelsHashed, 480u);
+    BOOST_CHECK_EQUAL(snapshot.stakesFound, 1u);
+    BOOST_CHECK_EQUAL(snapshot.misses[static_cast<unsigned>(StakingMiss::NO_KERNEL_FOUND)], 2u);
+    BOOST_CHECK_EQUAL(snapshot.misses[static_cast<unsigned>(StakingMiss::BLOCK_REJECTED)], 1u);
+    BOOST_CHECK_EQUAL(snapshot.misses[static_cast<unsigned>(StakingMiss::NO_STAKABLE_COINS)], 0u);
+    BOOST_CHECK_EQUAL(snapshot.stages[static_cast<unsigned>(StakingStage::KERNEL_SEARCH)].count, 2u);
+    BOOST_CHECK_EQUAL(snapshot.stages[static_cast<unsigned>(StakingStage::KERNEL_SEARCH)].totalMicros, 3000u);
+}
+
+BOOST_AUTO_TEST_CASE(willBucketStageTimesUpToInclusiveBounds)
+{
+    StakingStatistics statistics;
+    statistics.RecordStageTime(StakingStage::BLOCK_SIGNING, StakingStatistics::BucketUpperBound(0));
+    statistics.RecordStageTime(StakingStage::BLOCK_SIGNING, StakingStatistics::BucketUpperBound(0) + 1);
+    statistics.RecordStageTime(StakingStage::BLOCK_SIGNING, -5);
+    statistics.RecordStageTime(StakingStage::BLOCK_SIGNING, 3600000000);
+
+    const StakingStatistics::StageTimings& timings =
+        statistics.GetSnapshot().stages[static_cast<unsigned>(StakingStage::BLOCK_SIGNING)];
+    BOOST_CHECK_EQUAL(timings.count, 4u);
+    BOOST_CHECK_EQUAL(timings.buckets[0], 2u);
+    BOOST_CHECK_EQUAL(timings.buckets[1], 1u);
+    BOOST_CHECK_EQUAL(timings.buckets[StakingStatistics::NUMBER_OF_BUCKETS - 1], 1u);
+    BOOST_CHECK_EQUAL(timings.maximumMicros, 3600000000u);
+    BOOST_CHECK_EQUAL(StakingStatistics::BucketUpperBound(StakingStatistics::NUMBER_OF_BUCKETS - 1), -1);
+}
+
+BOOST_AUTO_TEST_CASE(willRememberOnlyTheLastAcceptedBlocksUntilReset)
+{
+    StakingStatistics statistics(2);
+    for (int n = 0; n < 3; n++)
+        statistics.RecordAcceptedBlock(Hash(BEGIN(n), END(n)));
+
+    StakingStatistics::Snapshot snapshot = statistics.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot.blocksAccepted, 3u);
+    BOOST_REQUIRE_EQUAL(snapshot.stakedBlocks.size(), 2u);
+    int first = 1;
+    BOOST_CHECK(snapshot.stakedBlocks[0] == Hash(BEGIN(first), END(first)));
+
+    statistics.Reset();
+    snapshot = statistics.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot.blocksAccepted, 0u);
+    BOOST_CHECK(snapshot.stakedBlocks.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
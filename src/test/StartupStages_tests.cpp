@@ -0,0 +1,78 @@
+#include <StartupStages.h>
+
+#include <stdexcept>
+
+#include <boost/thread/barrier.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(StartupStages_tests)
+
+BOOST_AUTO_TEST_CASE(parallelStagesRunAlongsideOneAnother)
+{
+    // Neither stage gets past the barrier unless both are running at once
+    boost::barrier bothRunning(2);
+    StartupStages stages(true);
+    stages.Start("first", [&bothRunning]() {
+        bothRunning.wait();
+        return true;
+    });
+    stages.Start("second", [&bothRunning]() {
+        bothRunning.wait();
+        return true;
+    });
+    BOOST_CHECK(stages.Wait("first"));
+    BOOST_CHECK(stages.Wait("second"));
+}
+
+BOOST_AUTO_TEST_CASE(sequentialStagesCompleteAsTheyAreStarted)
+{
+    bool fRan = false;
+    StartupStages stages(false);
+    stages.Start("stage", [&fRan]() {
+        fRan = true;
+        return true;
+    });
+    BOOST_CHECK(fRan);
+    BOOST_CHECK(stages.Wait("stage"));
+}
+
+BOOST_AUTO_TEST_CASE(failureIsReportedByEveryWait)
+{
+    for (bool fParallel : {false, true}) {
+        StartupStages stages(fParallel);
+        stages.Start("failing", []() { return false; });
+        BOOST_CHECK(!stages.Wait("failing"));
+        BOOST_CHECK(!stages.Wait("failing"));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(exceptionIsRethrownToTheWaiter)
+{
+    for (bool fParallel : {false, true}) {
+        StartupStages stages(fParallel);
+        stages.Start("throwing", []() -> bool { throw std::runtime_error("unreadable file"); });
+        BOOST_CHECK_THROW(stages.Wait("throwing"), std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stageNeverStartedSucceeds)
+{
+    StartupStages stages(true);
+    BOOST_CHECK(stages.Wait("unknown"));
+}
+
+BOOST_AUTO_TEST_CASE(stagesNotWaitedForAreJoinedOnDestruction)
+{
+    bool fFinished = false;
+    {
+        StartupStages stages(true);
+        stages.Start("slow", [&fFinished]() {
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+            fFinished = true;
+            return true;
+        });
+    }
+    BOOST_CHECK(fFinished);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
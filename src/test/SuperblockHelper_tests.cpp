@@ -4,6 +4,7 @@
 #include <MockSuperblockHeightValidator.h>
 #include <MockBlockSubsidyProvider.h>
 #include <memory>
+#include <vector>
 #include <LegacyBlockSubsidies.h>
 #include <SuperblockHeightValidator.h>
 #include <BlockSubsidyProvider.h>
@@ -505,4 +506,25 @@ BOOST_AUTO_TEST_CASE(willKeepLotteryBlockCycleSameBeforeAndAfterTransitionHeight
     }
 }
 
+BOOST_AUTO_TEST_CASE(willReturnTheSameRewardsWhetherOrNotTheyWereWorkedOutBefore)
+{
+    const CChainParams& chainParams = Params(CBaseChainParams::MAIN);
+    SuperblockHeightValidator heightValidator(chainParams);
+    BlockSubsidyProvider blockSubsidies(chainParams,heightValidator);
+    const int transitionHeight = heightValidator.getTransitionHeight();
+    // Heights a whole table apart share their entry in it
+    const std::vector<int> heights = {
+        transitionHeight, transitionHeight + 1, transitionHeight + 256, transitionHeight + 1, transitionHeight};
+    for(int blockHeight: heights)
+    {
+        BlockSubsidyProvider freshBlockSubsidies(chainParams,heightValidator);
+        const CBlockRewards expectedRewards = freshBlockSubsidies.GetBlockSubsidity(blockHeight);
+        for(int repeat = 0; repeat < 2; ++repeat)
+        {
+            const CBlockRewards rewards = blockSubsidies.GetBlockSubsidity(blockHeight);
+            BOOST_CHECK_EQUAL(rewards.ToString(), expectedRewards.ToString());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
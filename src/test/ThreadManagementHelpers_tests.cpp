@@ -0,0 +1,66 @@
+#include <ThreadManagementHelpers.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+std::vector<std::string> Settings(const std::string& first, const std::string& second = "")
+{
+    std::vector<std::string> settings(1, first);
+    if (!second.empty())
+        settings.push_back(second);
+    return settings;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ThreadManagementHelpers_tests)
+
+BOOST_AUTO_TEST_CASE(findsTheGroupOfAThreadByItsName)
+{
+    BOOST_CHECK(ThreadGroupOf("izzy-msghand") == ThreadGroup::NETWORK);
+    BOOST_CHECK(ThreadGroupOf("scriptch") == ThreadGroup::SCRIPT_CHECK);
+    BOOST_CHECK(ThreadGroupOf("izzy-rpcworker") == ThreadGroup::RPC);
+    BOOST_CHECK(ThreadGroupOf("izzy-stakemint") == ThreadGroup::STAKING);
+    BOOST_CHECK(ThreadGroupOf("izzy-obfuscation") == ThreadGroup::MASTERNODE);
+    BOOST_CHECK(ThreadGroupOf("izzy-loadblk") == ThreadGroup::IMPORT);
+    BOOST_CHECK(ThreadGroupOf("izzy-dustcombiner") == ThreadGroup::BACKGROUND);
+    BOOST_CHECK(ThreadGroupOf("izzy-init-blockindex") == ThreadGroup::NONE);
+}
+
+BOOST_AUTO_TEST_CASE(takesThePrioritiesAndProcessorsOfGroups)
+{
+    std::string error;
+    BOOST_CHECK(InitThreadGroupSettings(Settings("rpc:low", "staking:high"), Settings("staking:2-3,1", "network:0"), error));
+    BOOST_CHECK_EQUAL(ThreadGroupPriority(ThreadGroup::RPC, -7), THREAD_PRIORITY_BELOW_NORMAL);
+    BOOST_CHECK_EQUAL(ThreadGroupPriority(ThreadGroup::STAKING, -7), THREAD_PRIORITY_ABOVE_NORMAL);
+    BOOST_CHECK_EQUAL(ThreadGroupPriority(ThreadGroup::NETWORK, -7), -7);
+    BOOST_CHECK_EQUAL(ThreadGroupPriority(ThreadGroup::BACKGROUND, -7), THREAD_PRIORITY_LOWEST);
+
+    const std::vector<unsigned> expected = {1, 2, 3};
+    const std::vector<unsigned> processors = ThreadGroupProcessors(ThreadGroup::STAKING);
+    BOOST_CHECK_EQUAL_COLLECTIONS(processors.begin(), processors.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(ThreadGroupProcessors(ThreadGroup::NETWORK).size(), 1u);
+    BOOST_CHECK(ThreadGroupProcessors(ThreadGroup::RPC).empty());
+
+    BOOST_CHECK(InitThreadGroupSettings(Settings("background:normal"), std::vector<std::string>(), error));
+    BOOST_CHECK_EQUAL(ThreadGroupPriority(ThreadGroup::BACKGROUND, -7), THREAD_PRIORITY_NORMAL);
+    BOOST_CHECK(ThreadGroupProcessors(ThreadGroup::STAKING).empty());
+    BOOST_CHECK(InitThreadGroupSettings(std::vector<std::string>(), std::vector<std::string>(), error));
+}
+
+BOOST_AUTO_TEST_CASE(refusesUnknownGroupsPrioritiesAndProcessors)
+{
+    const std::vector<std::string> none;
+    std::string error;
+    BOOST_CHECK(!InitThreadGroupSettings(Settings("wallet:low"), none, error));
+    BOOST_CHECK(!InitThreadGroupSettings(Settings("rpc"), none, error));
+    BOOST_CHECK(!InitThreadGroupSettings(Settings("rpc:urgent"), none, error));
+    BOOST_CHECK(!InitThreadGroupSettings(none, Settings("staking:3-2"), error));
+    BOOST_CHECK(!InitThreadGroupSettings(none, Settings("staking:a"), error));
+    BOOST_CHECK(!InitThreadGroupSettings(none, Settings("staking:"), error));
+    BOOST_CHECK(!InitThreadGroupSettings(none, Settings("staking:-1"), error));
+    BOOST_CHECK(!error.empty());
+    BOOST_CHECK(InitThreadGroupSettings(none, none, error));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+#include <UniValueReader.h>
+
+#include "json/json_spirit_reader_template.h"
+#include "json/json_spirit_writer_template.h"
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+/** Reads the text both ways and compares what they read */
+void CheckReadsLikeJSONSpirit(const std::string& strJSON)
+{
+    json_spirit::Value expected;
+    json_spirit::Value value;
+    const bool expectedResult = json_spirit::read_string(strJSON, expected);
+    BOOST_CHECK_EQUAL(ReadJSONValue(strJSON, value), expectedResult);
+    if (expectedResult)
+        BOOST_CHECK_EQUAL(json_spirit::write_string(value, false), json_spirit::write_string(expected, false));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(UniValueReader_tests)
+
+BOOST_AUTO_TEST_CASE(willReadRequestsLikeJSONSpirit)
+{
+    CheckReadsLikeJSONSpirit("{\"method\":\"getblockhash\",\"params\":[1000],\"id\":1}");
+    CheckReadsLikeJSONSpirit("[{\"method\":\"getblock\",\"params\":[\"00ff\",true],\"id\":\"a\"},{\"method\":\"help\",\"params\":[],\"id\":null}]");
+    CheckReadsLikeJSONSpirit("{\"amount\":1.5,\"minconf\":-1,\"fee\":1e-4,\"escaped\":\"a\\\"b\\\\c\\n\"}");
+    CheckReadsLikeJSONSpirit("  {\"nested\":{\"array\":[[],{}],\"flag\":false}}  ");
+}
+
+BOOST_AUTO_TEST_CASE(willKeepIntegersAndRealsApart)
+{
+    json_spirit::Value value;
+    BOOST_CHECK(ReadJSONValue("[7,-7,7.0,18446744073709551615]", value));
+    const json_spirit::Array& arr = value.get_array();
+    BOOST_CHECK(arr[0].type() == json_spirit::int_type);
+    BOOST_CHECK_EQUAL(arr[0].get_int64(), 7);
+    BOOST_CHECK_EQUAL(arr[1].get_int64(), -7);
+    BOOST_CHECK(arr[2].type() == json_spirit::real_type);
+    BOOST_CHECK_EQUAL(arr[3].get_uint64(), 18446744073709551615ULL);
+}
+
+BOOST_AUTO_TEST_CASE(willFailOnTextJSONSpiritFailsOn)
+{
+    CheckReadsLikeJSONSpirit("");
+    CheckReadsLikeJSONSpirit("{\"method\":");
+    CheckReadsLikeJSONSpirit("[1,2");
+    CheckReadsLikeJSONSpirit("{\"a\" 1}");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
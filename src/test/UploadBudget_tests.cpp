@@ -0,0 +1,53 @@
+#include <UploadBudget.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(UploadBudget_tests)
+
+BOOST_AUTO_TEST_CASE(willAlwaysHaveBytesAvailableWhenUnlimited)
+{
+    UploadBudget budget;
+    budget.Spend(1000000, 0);
+    BOOST_CHECK(!budget.IsLimited());
+    BOOST_CHECK(budget.HasBytesAvailable(0));
+}
+
+BOOST_AUTO_TEST_CASE(willStartWithAFullBurst)
+{
+    UploadBudget budget;
+    budget.SetRate(1000, 10, 0);
+    BOOST_CHECK(budget.IsLimited());
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(0), 10000);
+}
+
+BOOST_AUTO_TEST_CASE(willRunIntoDebtAndPayItOffAtTheRate)
+{
+    UploadBudget budget;
+    budget.SetRate(1000, 10, 0);
+    budget.Spend(12000, 0);
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(0), -2000);
+    BOOST_CHECK(!budget.HasBytesAvailable(1000000));
+
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(2000000), 0);
+    BOOST_CHECK(budget.HasBytesAvailable(2500000));
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(2500000), 500);
+}
+
+BOOST_AUTO_TEST_CASE(willNotRefillPastTheBurst)
+{
+    UploadBudget budget;
+    budget.SetRate(1000, 10, 0);
+    budget.Spend(5000, 0);
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(1000000000000LL), 10000);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepFractionsOfABytesTimeForTheNextRefill)
+{
+    UploadBudget budget;
+    budget.SetRate(3, 10, 0);
+    budget.Spend(30, 0);
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(500000), 1);
+    BOOST_CHECK_EQUAL(budget.GetAvailableBytes(1000000), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,135 @@
+#include <UtxoSnapshot.h>
+
+#include <chain.h>
+#include <coins.h>
+#include <DataDirectory.h>
+#include <random.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <stdio.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CCoins CoinsWithOutputs(unsigned int nOutputs, int nHeight)
+{
+    CCoins coins;
+    coins.nHeight = nHeight;
+    coins.vout.resize(nOutputs);
+    for (unsigned int i = 0; i < nOutputs; i++) {
+        coins.vout[i].nValue = 1000 * (i + 1);
+        coins.vout[i].scriptPubKey = CScript() << OP_TRUE;
+    }
+    return coins;
+}
+
+struct SnapshotTestSetup {
+    CCoinsViewDB coinsDB;
+    uint256 hashBase;
+    CBlockIndex indexBase;
+    boost::filesystem::path path;
+
+    SnapshotTestSetup(
+        ): coinsDB(1 << 20, true)
+        , hashBase(GetRandHash())
+        , indexBase()
+        , path(GetDataDir() / "utxo.snapshot")
+    {
+        indexBase.phashBlock = &hashBase;
+        indexBase.nHeight = 100;
+
+        CCoinsMap mapCoins;
+        for (int i = 0; i < 50; i++) {
+            CCoinsCacheEntry& entry = mapCoins[GetRandHash()];
+            entry.coins = CoinsWithOutputs(1 + i % 3, i);
+            entry.flags = CCoinsCacheEntry::DIRTY;
+        }
+        BOOST_REQUIRE(coinsDB.BatchWrite(mapCoins, hashBase));
+    }
+
+    ~SnapshotTestSetup()
+    {
+        boost::filesystem::remove(path);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(UtxoSnapshot_tests, SnapshotTestSetup)
+
+BOOST_AUTO_TEST_CASE(willCommitToTheSameHashAsTheCoinStatistics)
+{
+    UtxoSnapshotMetadata metadata;
+    std::string strError;
+    BOOST_REQUIRE(WriteUtxoSnapshot(coinsDB, &indexBase, path, metadata, strError));
+
+    CCoinsStats stats;
+    BOOST_REQUIRE(coinsDB.GetStats(stats));
+    BOOST_CHECK(metadata.hashSerialized == stats.hashSerialized);
+    BOOST_CHECK(metadata.hashBaseBlock == hashBase);
+    BOOST_CHECK_EQUAL(metadata.nBaseHeight, 100);
+    BOOST_CHECK_EQUAL(metadata.nCoinsCount, 50u);
+
+    UtxoSnapshotMetadata verified;
+    BOOST_CHECK(VerifyUtxoSnapshot(path, verified, strError));
+    BOOST_CHECK(verified.hashSerialized == stats.hashSerialized);
+}
+
+BOOST_AUTO_TEST_CASE(willRebuildAnIdenticalCoinDatabase)
+{
+    UtxoSnapshotMetadata metadata;
+    std::string strError;
+    BOOST_REQUIRE(WriteUtxoSnapshot(coinsDB, &indexBase, path, metadata, strError));
+    BOOST_REQUIRE(VerifyUtxoSnapshot(path, metadata, strError));
+
+    CCoinsViewDB loadedDB(1 << 20, true);
+    CCoinsMap mapStale;
+    CCoinsCacheEntry& staleEntry = mapStale[GetRandHash()];
+    staleEntry.coins = CoinsWithOutputs(1, 1);
+    staleEntry.flags = CCoinsCacheEntry::DIRTY;
+    BOOST_REQUIRE(loadedDB.BatchWrite(mapStale, GetRandHash()));
+
+    BOOST_REQUIRE(LoadUtxoSnapshot(loadedDB, path, metadata, strError));
+    CCoinsStats original;
+    CCoinsStats loaded;
+    BOOST_REQUIRE(coinsDB.GetStats(original));
+    BOOST_REQUIRE(loadedDB.GetStats(loaded));
+    BOOST_CHECK(loaded.hashSerialized == original.hashSerialized);
+    BOOST_CHECK_EQUAL(loaded.nTransactions, original.nTransactions);
+    BOOST_CHECK(loadedDB.GetBestBlock() == hashBase);
+}
+
+BOOST_AUTO_TEST_CASE(willRejectTamperedSnapshots)
+{
+    UtxoSnapshotMetadata metadata;
+    std::string strError;
+    BOOST_REQUIRE(WriteUtxoSnapshot(coinsDB, &indexBase, path, metadata, strError));
+
+    FILE* file = fopen(path.string().c_str(), "r+b");
+    BOOST_REQUIRE(file != NULL);
+    BOOST_REQUIRE(fseek(file, -1, SEEK_END) == 0);
+    const int lastByte = fgetc(file);
+    BOOST_REQUIRE(fseek(file, -1, SEEK_END) == 0);
+    fputc(lastByte ^ 0x01, file);
+    fclose(file);
+
+    UtxoSnapshotMetadata verified;
+    BOOST_CHECK(!VerifyUtxoSnapshot(path, verified, strError));
+}
+
+BOOST_AUTO_TEST_CASE(willRemoveTheIncompleteFileOfFailedSnapshots)
+{
+    CBlockIndex indexOther;
+    const uint256 hashOther = GetRandHash();
+    indexOther.phashBlock = &hashOther;
+
+    UtxoSnapshotMetadata metadata;
+    std::string strError;
+    BOOST_CHECK(!WriteUtxoSnapshot(coinsDB, &indexOther, path, metadata, strError));
+    BOOST_CHECK(!boost::filesystem::exists(path));
+    BOOST_CHECK(!boost::filesystem::exists(path.string() + ".incomplete"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -168,6 +168,47 @@ BOOST_AUTO_TEST_CASE(willDiscountSpentUTXOs)
     BOOST_CHECK_EQUAL(manager->getUTXOs().size(), 4u);
 }
 
+BOOST_AUTO_TEST_CASE(willDiscountUTXOsSpentAfterTheyWereListed)
+{
+    CScript managedScript = scriptGenerator(10);
+    manager->addManagedScript(managedScript, 5);
+
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(100,managedScript));
+    tx.vout.push_back(CTxOut(300,managedScript));
+    CBlock blockMiningFirstTx = getBlockToMineTransaction(tx);
+    manager->SyncTransaction(tx,&blockMiningFirstTx);
+    BOOST_CHECK_EQUAL(manager->getUTXOs().size(), 2u);
+
+    CMutableTransaction otherTx;
+    otherTx.vin.emplace_back( COutPoint(tx.GetHash(), 1u) );
+    otherTx.vout.push_back(CTxOut(100,managedScript));
+    CBlock blockMiningSecondTx = getBlockToMineTransaction(otherTx);
+    manager->SyncTransaction(otherTx,&blockMiningSecondTx);
+
+    UnspentOutputs outputs = manager->getUTXOs();
+    BOOST_CHECK_EQUAL(outputs.size(), 2u);
+    BOOST_CHECK(outputs.count(COutPoint(tx.GetHash(), 0u)));
+    BOOST_CHECK(outputs.count(COutPoint(otherTx.GetHash(), 0u)));
+}
+
+BOOST_AUTO_TEST_CASE(willCountUTXOsOfScriptsManagedAfterTheirTransactionsWereSeen)
+{
+    CScript managedScript = scriptGenerator(10);
+    CScript laterManagedScript = scriptGenerator(10);
+    manager->addManagedScript(managedScript, 5);
+
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(100,managedScript));
+    tx.vout.push_back(CTxOut(300,laterManagedScript));
+    CBlock blockMiningTx = getBlockToMineTransaction(tx);
+    manager->SyncTransaction(tx,&blockMiningTx);
+    BOOST_CHECK_EQUAL(manager->getUTXOs().size(), 1u);
+
+    manager->addManagedScript(laterManagedScript, 5);
+    BOOST_CHECK_EQUAL(manager->getUTXOs().size(), 2u);
+}
+
 BOOST_AUTO_TEST_CASE(willNotCountUTXOsFromTransactionsWithoutConfirmations)
 {
     CScript managedScript = scriptGenerator(10);
@@ -266,15 +307,16 @@ BOOST_AUTO_TEST_CASE(willLoadTransactionsFromDatabase)
         }
     ));
 
-    ON_CALL(*mockPtr, ReadTx(_,_)).WillByDefault(Invoke(
-        [&txStream](const uint64_t txIndex,CWalletTx& returnTx)
+    ON_CALL(*mockPtr, ReadTxs(_,_,_,_)).WillByDefault(Invoke(
+        [&txStream](const uint64_t firstTxIndex, const unsigned maxCount, const CWalletTx& emptyTransaction, std::vector<CWalletTx>& returnTxs)
         {
-            if(txIndex != 0u)
+            if(firstTxIndex != 0u)
             {
-                return false;
+                return 0u;
             }
-            txStream >> returnTx;
-            return true;
+            returnTxs.push_back(emptyTransaction);
+            txStream >> returnTxs.back();
+            return 1u;
         }
     ));
     manager.reset(new VaultManager( activeChain, blockIndexByHash, *mockPtr ));
@@ -312,15 +354,16 @@ BOOST_AUTO_TEST_CASE(willLoadManyTransactionsFromDatabase)
     auto& activeChain = *(fakeBlockIndexWithHashesResource->activeChain);
     auto& blockIndexByHash = *(fakeBlockIndexWithHashesResource->blockIndexByHash);
 
-    ON_CALL(*mockPtr, ReadTx(_,_)).WillByDefault(Invoke(
-        [&streamOfTransactions](const uint64_t txIndex,CWalletTx& returnTx)
+    ON_CALL(*mockPtr, ReadTxs(_,_,_,_)).WillByDefault(Invoke(
+        [&streamOfTransactions](const uint64_t firstTxIndex, const unsigned maxCount, const CWalletTx& emptyTransaction, std::vector<CWalletTx>& returnTxs)
         {
-            if(txIndex < streamOfTransactions.size())
+            unsigned txIndex = firstTxIndex;
+            for(; txIndex < streamOfTransactions.size() && txIndex < firstTxIndex + maxCount; ++txIndex)
             {
-                streamOfTransactions[txIndex] >> returnTx;
-                return true;
+                returnTxs.push_back(emptyTransaction);
+                streamOfTransactions[txIndex] >> returnTxs.back();
             }
-            return false;
+            return txIndex - static_cast<unsigned>(firstTxIndex);
         }
     ));
     manager.reset(new VaultManager( activeChain, blockIndexByHash, *mockPtr ));
@@ -331,5 +374,47 @@ BOOST_AUTO_TEST_CASE(willLoadManyTransactionsFromDatabase)
     }
 }
 
+BOOST_AUTO_TEST_CASE(willKeepReadingUntilTheDatabaseHasNoMoreTransactions)
+{
+    std::vector<CDataStream> streamOfTransactions(10u,CDataStream(SER_DISK, CLIENT_VERSION));
+    for(unsigned txCount =0 ; txCount < 10u; ++txCount)
+    {
+        CMutableTransaction tx;
+        tx.vin.push_back(CTxIn(uint256(txCount + 1),0u));
+        tx.vout.push_back(CTxOut(100,scriptGenerator(10)));
+        streamOfTransactions[txCount] << CWalletTx(CTransaction(tx));
+    }
+
+    std::vector<uint64_t> firstTxIndicesRead;
+    ON_CALL(*mockPtr, ReadTxs(_,_,_,_)).WillByDefault(Invoke(
+        [&streamOfTransactions,&firstTxIndicesRead](const uint64_t firstTxIndex, const unsigned maxCount, const CWalletTx& emptyTransaction, std::vector<CWalletTx>& returnTxs)
+        {
+            firstTxIndicesRead.push_back(firstTxIndex);
+            unsigned txIndex = firstTxIndex;
+            for(; txIndex < streamOfTransactions.size() && txIndex < firstTxIndex + 3u; ++txIndex)
+            {
+                returnTxs.push_back(emptyTransaction);
+                streamOfTransactions[txIndex] >> returnTxs.back();
+            }
+            return txIndex - static_cast<unsigned>(firstTxIndex);
+        }
+    ));
+    manager.reset(new VaultManager(
+        *(fakeBlockIndexWithHashesResource->activeChain),
+        *(fakeBlockIndexWithHashesResource->blockIndexByHash),
+        *mockPtr ));
+
+    const std::vector<uint64_t> expectedFirstTxIndices = {0u, 3u, 6u, 9u, 10u};
+    BOOST_CHECK(firstTxIndicesRead == expectedFirstTxIndices);
+
+    // What arrives later is ordered after everything loaded
+    CScript managedScript = scriptGenerator(10);
+    manager->addManagedScript(managedScript,10u);
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(100,managedScript));
+    manager->SyncTransaction(tx,nullptr);
+    BOOST_CHECK_EQUAL(manager->GetTransaction(tx.GetHash()).nOrderPos, 10);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
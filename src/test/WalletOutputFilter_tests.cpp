@@ -0,0 +1,68 @@
+#include <WalletOutputFilter.h>
+
+#include <key.h>
+#include <script/standard.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class WalletOutputFilterFixture
+{
+public:
+    CPubKey knownKey;
+    CPubKey unknownKey;
+    WalletOutputFilter filter;
+
+    WalletOutputFilterFixture(
+        ): knownKey()
+        , unknownKey()
+        , filter()
+    {
+        CKey key;
+        key.MakeNewKey(true);
+        knownKey = key.GetPubKey();
+        key.MakeNewKey(true);
+        unknownKey = key.GetPubKey();
+        filter.AddKey(knownKey.GetID());
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(WalletOutputFilter_tests, WalletOutputFilterFixture)
+
+BOOST_AUTO_TEST_CASE(willLetThroughPaymentsToKnownKeysOnly)
+{
+    BOOST_CHECK(filter.MayBeMine(GetScriptForDestination(knownKey.GetID())));
+    BOOST_CHECK(filter.MayBeMine(CScript() << ToByteVector(knownKey) << OP_CHECKSIG));
+    BOOST_CHECK(!filter.MayBeMine(GetScriptForDestination(unknownKey.GetID())));
+    BOOST_CHECK(!filter.MayBeMine(CScript() << ToByteVector(unknownKey) << OP_CHECKSIG));
+}
+
+BOOST_AUTO_TEST_CASE(willLetThroughMultisigPaymentsWithAnyKnownKey)
+{
+    std::vector<CPubKey> keys = {unknownKey, knownKey};
+    BOOST_CHECK(filter.MayBeMine(GetScriptForMultisig(1, keys)));
+    keys[1] = unknownKey;
+    BOOST_CHECK(!filter.MayBeMine(GetScriptForMultisig(1, keys)));
+}
+
+BOOST_AUTO_TEST_CASE(willLetThroughPaymentsToKnownScriptHashes)
+{
+    const CScript redeemScript = GetScriptForDestination(unknownKey.GetID());
+    BOOST_CHECK(!filter.MayBeMine(GetScriptForDestination(CScriptID(redeemScript))));
+    filter.AddScriptHash(CScriptID(redeemScript));
+    BOOST_CHECK(filter.MayBeMine(GetScriptForDestination(CScriptID(redeemScript))));
+}
+
+BOOST_AUTO_TEST_CASE(willLetThroughWatchedScriptsEvenIfNonstandard)
+{
+    const CScript watchedScript = CScript() << OP_TRUE;
+    BOOST_CHECK(!filter.MayBeMine(watchedScript));
+    filter.AddScript(watchedScript);
+    BOOST_CHECK(filter.MayBeMine(watchedScript));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,92 @@
+#include <WalletTransactionOrderIndex.h>
+
+#include <WalletTx.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CWalletTx TransactionAtOrderPosition(int64_t orderPosition)
+{
+    CWalletTx wtx;
+    wtx.nOrderPos = orderPosition;
+    return wtx;
+}
+
+std::vector<int64_t> OrderPositions(const WalletTransactionOrderIndex::TxItems& items)
+{
+    std::vector<int64_t> positions;
+    for (WalletTransactionOrderIndex::TxItems::const_iterator it = items.begin(); it != items.end(); ++it)
+        positions.push_back(it->first);
+    return positions;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(WalletTransactionOrderIndex_tests)
+
+BOOST_AUTO_TEST_CASE(willKeepTransactionsAndAccountingEntriesInOrder)
+{
+    WalletTransactionOrderIndex index;
+    CWalletTx first = TransactionAtOrderPosition(0);
+    CWalletTx third = TransactionAtOrderPosition(2);
+    index.UpdateTransaction(third, 10);
+    index.UpdateTransaction(first, 5);
+    CAccountingEntry entry;
+    entry.nOrderPos = 1;
+    index.AddAccountingEntry(entry);
+
+    const WalletTransactionOrderIndex::TxItems& items = index.GetOrderedItems();
+    BOOST_CHECK(OrderPositions(items) == std::vector<int64_t>({0, 1, 2}));
+    BOOST_CHECK(items.rbegin()->second.first == &third);
+    BOOST_CHECK(items.begin()->second.first == &first);
+    BOOST_CHECK((++items.begin())->second.second != nullptr);
+    BOOST_CHECK_EQUAL(index.NumberOfTransactions(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willMoveATransactionWhoseOrderPositionChanged)
+{
+    WalletTransactionOrderIndex index;
+    CWalletTx first = TransactionAtOrderPosition(0);
+    CWalletTx second = TransactionAtOrderPosition(1);
+    index.UpdateTransaction(first, 5);
+    index.UpdateTransaction(second, 5);
+
+    first.nOrderPos = 3;
+    index.UpdateTransaction(first, 5);
+    index.UpdateTransaction(second, 5);
+
+    const WalletTransactionOrderIndex::TxItems& items = index.GetOrderedItems();
+    BOOST_CHECK(OrderPositions(items) == std::vector<int64_t>({1, 3}));
+    BOOST_CHECK(items.rbegin()->second.first == &first);
+}
+
+BOOST_AUTO_TEST_CASE(willListTheTransactionsAboveAHeightWithTheUnconfirmedOnes)
+{
+    WalletTransactionOrderIndex index;
+    CWalletTx early = TransactionAtOrderPosition(0);
+    CWalletTx late = TransactionAtOrderPosition(1);
+    CWalletTx unconfirmed = TransactionAtOrderPosition(2);
+    index.UpdateTransaction(early, 5);
+    index.UpdateTransaction(late, 10);
+    index.UpdateTransaction(unconfirmed, WalletTransactionOrderIndex::UNCONFIRMED_HEIGHT);
+
+    BOOST_CHECK(index.GetTransactionsAboveHeight(10) == std::vector<CWalletTx*>({&unconfirmed}));
+    BOOST_CHECK(index.GetTransactionsAboveHeight(9) == std::vector<CWalletTx*>({&late, &unconfirmed}));
+    BOOST_CHECK_EQUAL(index.GetTransactionsAboveHeight(0).size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(willListATransactionWhoseBlockLeftTheActiveChainAsUnconfirmed)
+{
+    WalletTransactionOrderIndex index;
+    CWalletTx wtx = TransactionAtOrderPosition(0);
+    index.UpdateTransaction(wtx, 5);
+    BOOST_CHECK(index.GetTransactionsAboveHeight(8).empty());
+
+    index.UpdateTransaction(wtx, WalletTransactionOrderIndex::UNCONFIRMED_HEIGHT);
+    BOOST_CHECK(index.GetTransactionsAboveHeight(8) == std::vector<CWalletTx*>({&wtx}));
+    BOOST_CHECK_EQUAL(index.GetOrderedItems().size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,63 @@
+#include <addrman.h>
+
+#include <netbase.h>
+
+#include <set>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+CAddress RoutableAddress(const std::string& ip)
+{
+    CAddress addr(CService(ip, 8333));
+    addr.nTime = GetAdjustedTime();
+    return addr;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(addrman_tests)
+
+BOOST_AUTO_TEST_CASE(willSelectNothingFromAnEmptyTable)
+{
+    CAddrMan addrman;
+    BOOST_CHECK_EQUAL(addrman.size(), 0);
+    BOOST_CHECK(!addrman.Select().IsValid());
+}
+
+BOOST_AUTO_TEST_CASE(willFindTheOnlyNewAndTriedEntriesOfASparseTable)
+{
+    CAddrMan addrman;
+    const CNetAddr source("250.1.2.1");
+    const CAddress newAddr = RoutableAddress("250.3.1.1");
+    BOOST_REQUIRE(addrman.Add(newAddr, source));
+    for (int n = 0; n < 20; n++)
+        BOOST_CHECK(addrman.Select() == newAddr);
+
+    const CAddress triedAddr = RoutableAddress("251.4.1.1");
+    BOOST_REQUIRE(addrman.Add(triedAddr, source));
+    addrman.Good(triedAddr);
+    std::set<CService> selected;
+    for (int n = 0; n < 100; n++)
+        selected.insert(addrman.Select());
+    BOOST_CHECK_EQUAL(selected.size(), 2u);
+    BOOST_CHECK(selected.count(newAddr));
+    BOOST_CHECK(selected.count(triedAddr));
+}
+
+BOOST_AUTO_TEST_CASE(willHandOutAShareOfTheAddressesWithoutRepeats)
+{
+    CAddrMan addrman;
+    const CNetAddr source("250.1.2.1");
+    std::vector<CAddress> vAddr;
+    for (int n = 1; n <= 200; n++)
+        vAddr.push_back(RoutableAddress(strprintf("250.%d.%d.1", 2 + n / 100, n % 100 + 1)));
+    BOOST_REQUIRE(addrman.Add(vAddr, source));
+
+    const std::vector<CAddress> vHandedOut = addrman.GetAddr();
+    BOOST_CHECK_EQUAL(vHandedOut.size(), (size_t)(ADDRMAN_GETADDR_MAX_PCT * addrman.size() / 100));
+    BOOST_CHECK_EQUAL(std::set<CService>(vHandedOut.begin(), vHandedOut.end()).size(), vHandedOut.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
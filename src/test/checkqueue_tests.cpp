@@ -0,0 +1,66 @@
+#include <checkqueue.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class FakeCheck
+{
+private:
+    bool result_;
+
+public:
+    FakeCheck(bool result = true) : result_(result) {}
+    bool operator()() { return result_; }
+    void swap(FakeCheck& other) { std::swap(result_, other.result_); }
+};
+
+void AddChecks(CCheckQueueControl<FakeCheck>& control, unsigned int numberOfChecks, bool result)
+{
+    std::vector<FakeCheck> checks(numberOfChecks, FakeCheck(result));
+    control.Add(checks);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(checkqueue_tests)
+
+BOOST_AUTO_TEST_CASE(willRunEveryCheckAndCountTheBatches)
+{
+    CCheckQueue<FakeCheck> queue(16);
+    boost::thread_group workers;
+    for (int i = 0; i < 3; ++i)
+        workers.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, &queue));
+
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        AddChecks(control, 1000, true);
+        BOOST_CHECK(control.Wait());
+    }
+    const CCheckQueueStats stats = queue.GetStats();
+    BOOST_CHECK_EQUAL(stats.nChecks, 1000u);
+    BOOST_CHECK(stats.nBatches >= 1000u / 16u);
+    BOOST_CHECK(stats.nCheckCostNanos > 0);
+
+    workers.interrupt_all();
+    workers.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(willFailWhenOneCheckFailsAndRecoverForTheNextBlock)
+{
+    CCheckQueue<FakeCheck> queue(16);
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        AddChecks(control, 100, true);
+        AddChecks(control, 1, false);
+        BOOST_CHECK(!control.Wait());
+    }
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        AddChecks(control, 100, true);
+        BOOST_CHECK(control.Wait());
+    }
+    BOOST_CHECK(queue.IsIdle());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
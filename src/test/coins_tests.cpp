@@ -61,6 +61,27 @@ public:
 
     bool GetStats(CCoinsStats& stats) const { return false; }
 };
+
+class CCoinsViewLookupCounter : public CCoinsViewBacked
+{
+public:
+    mutable unsigned int nSingleLookups;
+    mutable unsigned int nBatchLookups;
+
+    CCoinsViewLookupCounter(CCoinsView* viewIn) : CCoinsViewBacked(viewIn), nSingleLookups(0), nBatchLookups(0) {}
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const
+    {
+        ++nSingleLookups;
+        return CCoinsViewBacked::GetCoins(txid, coins);
+    }
+
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+    {
+        ++nBatchLookups;
+        CCoinsViewBacked::GetCoinsBatch(txids, coins);
+    }
+};
 }
 
 BOOST_AUTO_TEST_SUITE(coins_tests)
@@ -86,6 +107,7 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     bool updated_an_entry = false;
     bool found_an_entry = false;
     bool missed_an_entry = false;
+    bool trimmed_a_cache = false;
 
     // A simple map to track what we expect the cache stack to represent.
     std::map<uint256, CCoins> result;
@@ -140,6 +162,16 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
             }
         }
 
+        if (insecure_rand() % 100 == 50) {
+            // Every 100 iterations, write the tip's changes to its base while keeping some of its entries.
+            const size_t nMaxUsage = insecure_rand() % 2 ? 0 : stack.back()->DynamicMemoryUsage() / 2;
+            BOOST_CHECK(stack.back()->Trim(nMaxUsage));
+            if (nMaxUsage == 0) {
+                BOOST_CHECK_EQUAL(stack.back()->GetCacheSize(), 0U);
+            }
+            trimmed_a_cache = true;
+        }
+
         if (insecure_rand() % 100 == 0) {
             // Every 100 iterations, change the cache stack.
             if (stack.size() > 0 && insecure_rand() % 2 == 0) {
@@ -176,6 +208,45 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(updated_an_entry);
     BOOST_CHECK(found_an_entry);
     BOOST_CHECK(missed_an_entry);
+    BOOST_CHECK(trimmed_a_cache);
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_prefetch_test)
+{
+    CCoinsViewTest base;
+    std::vector<uint256> txids;
+    {
+        CCoinsViewCache writer(&base);
+        for (unsigned int i = 0; i < 8; i++) {
+            txids.push_back(GetRandHash());
+            CCoinsModifier coins = writer.ModifyCoins(txids.back());
+            coins->vout.resize(1);
+            coins->vout[0].nValue = i + 1;
+        }
+        BOOST_CHECK(writer.Flush());
+    }
+    const uint256 missing = GetRandHash();
+
+    CCoinsViewLookupCounter counter(&base);
+    CCoinsViewCache cache(&counter);
+    BOOST_CHECK(cache.AccessCoins(txids[0]) != NULL);
+    std::vector<uint256> prefetch(txids);
+    prefetch.push_back(missing);
+    prefetch.push_back(txids[1]);
+    cache.PrefetchCoins(prefetch);
+    BOOST_CHECK_EQUAL(counter.nSingleLookups, 1U);
+    BOOST_CHECK_EQUAL(counter.nBatchLookups, 1U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), txids.size());
+
+    for (unsigned int i = 0; i < txids.size(); i++)
+        BOOST_CHECK_EQUAL(cache.AccessCoins(txids[i])->vout[0].nValue, i + 1);
+    BOOST_CHECK_EQUAL(counter.nSingleLookups, 1U);
+
+    std::vector<std::pair<uint256, CCoins> > found;
+    CCoinsViewCache child(&cache);
+    child.GetCoinsBatch(prefetch, found);
+    BOOST_CHECK_EQUAL(found.size(), txids.size() + 1);
+    BOOST_CHECK_EQUAL(counter.nBatchLookups, 2U);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,7 +2,10 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "clientversion.h"
 #include "compressor.h"
+#include "script/StakingVaultScript.h"
+#include "streams.h"
 
 #include <stdint.h>
 
@@ -60,4 +63,38 @@ BOOST_AUTO_TEST_CASE(compress_amounts)
         BOOST_CHECK(TestDecode(i));
 }
 
+CScript static RoundTripScript(const CScript& script, int nType, unsigned int& nSize)
+{
+    CScript in(script);
+    CDataStream ss(nType, CLIENT_VERSION);
+    ss << CScriptCompressor(in);
+    nSize = ss.size();
+    BOOST_CHECK_EQUAL(nSize, ::GetSerializeSize(CScriptCompressor(in), nType, CLIENT_VERSION));
+    CScript out;
+    CScriptCompressor compressor(out);
+    ss >> compressor;
+    BOOST_CHECK(ss.empty());
+    return out;
+}
+
+BOOST_AUTO_TEST_CASE(compress_scripts_staking_vault)
+{
+    const CScript vault = CreateStakingVaultScript(valtype(20, 0x11), valtype(20, 0x22));
+    const CScript p2pkh = CScript() << OP_DUP << OP_HASH160 << valtype(20, 0x33) << OP_EQUALVERIFY << OP_CHECKSIG;
+    const CScript raw = CScript() << OP_TRUE;
+    BOOST_REQUIRE(IsStakingVaultScript(vault));
+
+    unsigned int nSize = 0;
+    BOOST_CHECK(RoundTripScript(vault, SER_DISK, nSize) == vault);
+    BOOST_CHECK_EQUAL(nSize, vault.size() + 1);
+    BOOST_CHECK(RoundTripScript(vault, SER_DISK | SER_COMPACT_SCRIPTS, nSize) == vault);
+    BOOST_CHECK_EQUAL(nSize, 41u);
+
+    BOOST_CHECK(RoundTripScript(p2pkh, SER_DISK | SER_COMPACT_SCRIPTS, nSize) == p2pkh);
+    BOOST_CHECK_EQUAL(nSize, 21u);
+    BOOST_CHECK(RoundTripScript(raw, SER_DISK | SER_COMPACT_SCRIPTS, nSize) == raw);
+    BOOST_CHECK_EQUAL(nSize, raw.size() + 1);
+    BOOST_CHECK(RoundTripScript(CScript(), SER_DISK | SER_COMPACT_SCRIPTS, nSize) == CScript());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
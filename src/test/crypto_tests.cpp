@@ -3,12 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "crypto/rfc6979_hmac_sha256.h"
+#include "crypto/scrypt.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 
@@ -266,6 +268,36 @@ void TestRFC6979(const std::string& hexkey, const std::string& hexmsg, const std
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64_matches_double_sha256_for_any_number_of_blocks)
+{
+    for (int blocks = 0; blocks <= 32; ++blocks) {
+        unsigned char in[64 * 32];
+        unsigned char expected[32 * 32], actual[32 * 32];
+        GetRandBytes(in, 64 * blocks);
+        for (int i = 0; i < blocks; ++i)
+            CHash256().Write(in + 64 * i, 64).Finalize(expected + 32 * i);
+        SHA256D64(actual, in, blocks);
+        BOOST_CHECK(memcmp(expected, actual, 32 * blocks) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(scrypt_testvectors)
+{
+    // RFC 7914, with more lanes than threads mix them on most machines
+    std::vector<unsigned char> expected = ParseHex(
+        "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+        "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640");
+    std::vector<unsigned char> output(64);
+    scrypt("password", 8, "NaCl", 4, (char*)&output[0], 1024, 8, 16, 64);
+    BOOST_CHECK(output == expected);
+
+    expected = ParseHex(
+        "7023bdcb3afd7348461c06cd81fd38ebfda8fbba904f8e3ea9b543f6545da1f2"
+        "d5432955613f0fcf62d49705242a9af9e61e85dc0d651e40dfcf017b45575887");
+    scrypt("pleaseletmein", 13, "SodiumChloride", 14, (char*)&output[0], 16384, 8, 1, 64);
+    BOOST_CHECK(output == expected);
+}
+
 BOOST_AUTO_TEST_CASE(rfc6979_hmac_sha256)
 {
     TestRFC6979(
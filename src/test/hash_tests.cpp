@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
 
 #include <vector>
@@ -46,4 +47,22 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(legacy_header_hash_follows_every_change_to_the_header)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.nTime = 1454124731;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 7;
+    const uint256 first = header.GetHash();
+    BOOST_CHECK(first == HashQuark(BEGIN(header.nVersion), END(header.nNonce)));
+
+    header.nNonce++;
+    BOOST_CHECK(header.GetHash() != first);
+    BOOST_CHECK(header.GetHash() == HashQuark(BEGIN(header.nVersion), END(header.nNonce)));
+
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash() == first);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
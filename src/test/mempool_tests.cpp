@@ -5,8 +5,14 @@
 #include "main.h"
 #include "txmempool.h"
 
+#include "clientversion.h"
+#include "streams.h"
+
 #include <boost/test/unit_test.hpp>
 #include <list>
+#include <map>
+#include <set>
+#include <stdio.h>
 
 class MempoolTestFixture
 {
@@ -144,4 +150,202 @@ BOOST_AUTO_TEST_CASE(MempoolIndexByBareTxid)
     BOOST_CHECK(!testPool.lookupBareTxid(txGrandChild[0].GetBareTxid(), tx));
 }
 
+BOOST_AUTO_TEST_CASE(MempoolDumpWritesParentsBeforeChildren)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 0, 10, 0.0, 1));
+    for (int i = 0; i < 3; ++i)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 0, 20 + i, 0.0, 1));
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], 0, 30 + i, 0.0, 1));
+    }
+    testPool.PrioritiseTransaction(txChild[1].GetHash(), txChild[1].GetHash().ToString(), 1.5, 1000);
+    const uint256 absentHash = txParent.vin[0].prevout.hash;
+    testPool.PrioritiseTransaction(absentHash, absentHash.ToString(), 0.0, -7);
+
+    CAutoFile file(tmpfile(), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    BOOST_REQUIRE(testPool.WriteTransactions(file));
+    rewind(file.Get());
+
+    uint64_t nVersion, nTransactions;
+    file >> nVersion >> nTransactions;
+    BOOST_CHECK_EQUAL(nVersion, MEMPOOL_DUMP_VERSION);
+    BOOST_REQUIRE_EQUAL(nTransactions, 7u);
+    std::set<uint256> read;
+    for (uint64_t n = 0; n < nTransactions; n++)
+    {
+        CDumpedMempoolEntry entry;
+        file >> entry;
+        BOOST_CHECK(testPool.exists(entry.tx.GetHash()));
+        for (unsigned int i = 0; i < entry.tx.vin.size(); i++)
+            BOOST_CHECK(!testPool.exists(entry.tx.vin[i].prevout.hash) || read.count(entry.tx.vin[i].prevout.hash));
+        if (entry.tx.GetHash() == txChild[1].GetHash())
+        {
+            BOOST_CHECK_EQUAL(entry.nTime, 21);
+            BOOST_CHECK_EQUAL(entry.dPriorityDelta, 1.5);
+            BOOST_CHECK_EQUAL(entry.nFeeDelta, 1000);
+        }
+        read.insert(entry.tx.GetHash());
+    }
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    file >> mapDeltas;
+    BOOST_REQUIRE_EQUAL(mapDeltas.size(), 1u);
+    BOOST_CHECK(mapDeltas.begin()->first == absentHash);
+    BOOST_CHECK_EQUAL(mapDeltas.begin()->second.second, -7);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolTracksTotalsOverAncestorsAndDescendants)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 10000, 0, 0.0, 1));
+    for (int i = 0; i < 3; ++i)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 1000, 0, 0.0, 1));
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], 100, 0, 0.0, 1));
+    }
+    const CTxMemPoolEntry& parent = testPool.mapTx[txParent.GetHash()];
+    const CTxMemPoolEntry& grandChild = testPool.mapTx[txGrandChild[0].GetHash()];
+    const uint64_t nParentSize = parent.GetTxSize();
+    const uint64_t nChildSize = testPool.mapTx[txChild[0].GetHash()].GetTxSize();
+    const uint64_t nGrandChildSize = grandChild.GetTxSize();
+
+    BOOST_CHECK_EQUAL(parent.GetCountWithDescendants(), 7u);
+    BOOST_CHECK_EQUAL(parent.GetSizeWithDescendants(), nParentSize + 3 * nChildSize + 3 * nGrandChildSize);
+    BOOST_CHECK_EQUAL(parent.GetModFeesWithDescendants(), 13300);
+    BOOST_CHECK_EQUAL(parent.GetCountWithAncestors(), 1u);
+    BOOST_CHECK_EQUAL(grandChild.GetCountWithAncestors(), 3u);
+    BOOST_CHECK_EQUAL(grandChild.GetSizeWithAncestors(), nParentSize + nChildSize + nGrandChildSize);
+    BOOST_CHECK_EQUAL(grandChild.GetModFeesWithAncestors(), 11100);
+
+    // Prioritisation counts towards the totals of the relatives
+    testPool.PrioritiseTransaction(txGrandChild[1].GetHash(), txGrandChild[1].GetHash().ToString(), 0.0, 500);
+    BOOST_CHECK_EQUAL(testPool.mapTx[txGrandChild[1].GetHash()].GetModifiedFee(), 600);
+    BOOST_CHECK_EQUAL(testPool.mapTx[txGrandChild[1].GetHash()].GetModFeesWithAncestors(), 11600);
+    BOOST_CHECK_EQUAL(parent.GetModFeesWithDescendants(), 13800);
+
+    // Taking a child out alone parts its own child from the parent
+    std::list<CTransaction> removed;
+    testPool.remove(txChild[0], removed, false);
+    BOOST_CHECK_EQUAL(parent.GetCountWithDescendants(), 5u);
+    BOOST_CHECK_EQUAL(parent.GetModFeesWithDescendants(), 12700);
+    BOOST_CHECK_EQUAL(grandChild.GetCountWithAncestors(), 1u);
+    BOOST_CHECK_EQUAL(grandChild.GetModFeesWithAncestors(), 100);
+
+    // As when the parent is mined, and comes back on a reorganisation
+    testPool.remove(txParent, removed, false);
+    BOOST_CHECK_EQUAL(testPool.mapTx[txGrandChild[2].GetHash()].GetCountWithAncestors(), 2u);
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 10000, 0, 0.0, 1));
+    BOOST_CHECK_EQUAL(testPool.mapTx[txParent.GetHash()].GetCountWithDescendants(), 5u);
+    BOOST_CHECK_EQUAL(testPool.mapTx[txParent.GetHash()].GetModFeesWithDescendants(), 12700);
+    BOOST_CHECK_EQUAL(testPool.mapTx[txGrandChild[2].GetHash()].GetCountWithAncestors(), 3u);
+    BOOST_CHECK_EQUAL(testPool.mapTx[txGrandChild[2].GetHash()].GetModFeesWithAncestors(), 11100);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolKeepsUnconfirmedChainsWithinTheLimits)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 0, 0, 0.0, 1));
+    testPool.addUnchecked(txChild[1].GetHash(), CTxMemPoolEntry(txChild[1], 0, 0, 0.0, 1));
+    const size_t nSize = ::GetSerializeSize(txGrandChild[0], SER_NETWORK, PROTOCOL_VERSION);
+    const uint64_t nParentSize = testPool.mapTx[txParent.GetHash()].GetSizeWithDescendants();
+    std::string errString;
+
+    LOCK(testPool.cs);
+    BOOST_CHECK(testPool.CheckChainLimits(txGrandChild[0], nSize, 3, 1000000, 4, 1000000, errString));
+    BOOST_CHECK(!testPool.CheckChainLimits(txGrandChild[0], nSize, 2, 1000000, 4, 1000000, errString));
+    BOOST_CHECK(errString.find("ancestors") != std::string::npos);
+    // The parent already has two children in the pool
+    BOOST_CHECK(!testPool.CheckChainLimits(txGrandChild[0], nSize, 3, 1000000, 3, 1000000, errString));
+    BOOST_CHECK(!testPool.CheckChainLimits(txGrandChild[0], nSize, 3, 1000000, 4, nParentSize + nSize - 1, errString));
+    BOOST_CHECK(testPool.CheckChainLimits(txGrandChild[0], nSize, 3, 1000000, 4, nParentSize + nSize, errString));
+    BOOST_CHECK(!testPool.CheckChainLimits(txGrandChild[0], nSize, 3, nSize, 4, 1000000, errString));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolTrimsTheLowestScoringPackagesFirst)
+{
+    CMutableTransaction txCheap;
+    txCheap.vin.resize(1);
+    txCheap.vin[0].scriptSig = CScript() << OP_12;
+    txCheap.vout.resize(1);
+    txCheap.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    txCheap.vout[0].nValue = 11000LL;
+
+    // The parent pays little itself, but its child pays for both
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1));
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 100000, 0, 0.0, 1));
+    testPool.addUnchecked(txCheap.GetHash(), CTxMemPoolEntry(txCheap, 2000, 0, 0.0, 1));
+    BOOST_CHECK(testPool.GetMinFee(1) == CFeeRate(0));
+
+    BOOST_CHECK_EQUAL(testPool.TrimToSize(testPool.DynamicMemoryUsage()), 0u);
+    BOOST_CHECK_EQUAL(testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1), 1u);
+    BOOST_CHECK(!testPool.exists(txCheap.GetHash()));
+    const CFeeRate cheapFeeRate(2000, ::GetSerializeSize(txCheap, SER_NETWORK, PROTOCOL_VERSION));
+    BOOST_CHECK(testPool.GetMinFee(1) == cheapFeeRate);
+
+    BOOST_CHECK_EQUAL(testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1), 2u);
+    BOOST_CHECK_EQUAL(testPool.size(), 0u);
+    BOOST_CHECK(testPool.GetMinFee(1) > cheapFeeRate);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolKeepsTransactionsInBlockTemplateOrders)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1));
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 5000, 0, 1e6, 1));
+    testPool.addUnchecked(txChild[1].GetHash(), CTxMemPoolEntry(txChild[1], 2000, 0, 1e5, 1));
+
+    LOCK(testPool.cs);
+    std::vector<uint256> byFeeRate;
+    for (const CTxMemPoolEntry* entry : testPool.GetFeeRateOrder())
+        byFeeRate.push_back(entry->GetTx().GetHash());
+    BOOST_REQUIRE_EQUAL(byFeeRate.size(), 3u);
+    BOOST_CHECK(byFeeRate[0] == txChild[0].GetHash());
+    BOOST_CHECK(byFeeRate[1] == txChild[1].GetHash());
+    BOOST_CHECK(byFeeRate[2] == txParent.GetHash());
+
+    // The parent's larger inputs make up for its lack of priority once they have aged enough
+    BOOST_CHECK((*testPool.GetPriorityOrder(2).begin())->GetTx().GetHash() == txChild[0].GetHash());
+    BOOST_CHECK((*testPool.GetPriorityOrder(1000000).begin())->GetTx().GetHash() == txParent.GetHash());
+
+    testPool.PrioritiseTransaction(txChild[1].GetHash(), txChild[1].GetHash().ToString(), 1e7, 10000);
+    BOOST_CHECK((*testPool.GetFeeRateOrder().begin())->GetTx().GetHash() == txChild[1].GetHash());
+    BOOST_CHECK((*testPool.GetPriorityOrder(2).begin())->GetTx().GetHash() == txChild[1].GetHash());
+
+    std::list<CTransaction> removed;
+    testPool.remove(txChild[1], removed, false);
+    BOOST_CHECK_EQUAL(testPool.GetFeeRateOrder().size(), 2u);
+    BOOST_CHECK_EQUAL(testPool.GetPriorityOrder(2).size(), 2u);
+    BOOST_CHECK((*testPool.GetPriorityOrder(2).begin())->GetTx().GetHash() == txChild[0].GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolOrdersPackagesByAncestorFeeRate)
+{
+    CMutableTransaction txMedium;
+    txMedium.vin.resize(1);
+    txMedium.vin[0].scriptSig = CScript() << OP_12;
+    txMedium.vout.resize(1);
+    txMedium.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    txMedium.vout[0].nValue = 11000LL;
+
+    // The child pays enough for its parent to beat the medium transaction as a package
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1));
+    testPool.addUnchecked(txMedium.GetHash(), CTxMemPoolEntry(txMedium, 10000, 0, 0.0, 1));
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 100000, 0, 0.0, 1));
+
+    LOCK(testPool.cs);
+    std::vector<uint256> byAncestorScore;
+    for (const CTxMemPoolEntry* entry : testPool.GetAncestorScoreOrder())
+        byAncestorScore.push_back(entry->GetTx().GetHash());
+    BOOST_REQUIRE_EQUAL(byAncestorScore.size(), 3u);
+    BOOST_CHECK(byAncestorScore[0] == txChild[0].GetHash());
+    BOOST_CHECK(byAncestorScore[1] == txMedium.GetHash());
+    BOOST_CHECK(byAncestorScore[2] == txParent.GetHash());
+
+    std::set<uint256> ancestors;
+    testPool.CalculateAncestors(txChild[0], ancestors);
+    BOOST_CHECK(ancestors == std::set<uint256>(byAncestorScore.end() - 1, byAncestorScore.end()));
+
+    // Without most of its fee the child can no longer carry its parent
+    testPool.PrioritiseTransaction(txChild[0].GetHash(), txChild[0].GetHash().ToString(), 0, -99000);
+    BOOST_CHECK((*testPool.GetAncestorScoreOrder().begin())->GetTx().GetHash() == txMedium.GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -311,6 +311,71 @@ BOOST_AUTO_TEST_CASE(multisig_Solver1)
 
 }
 
+BOOST_AUTO_TEST_CASE(Solver_gives_canonical_and_other_pushes_the_same_solutions)
+{
+    CKey key;
+    key.MakeNewKey(false);
+    const valtype pubkey = ToByteVector(key.GetPubKey());
+    const valtype pubkeyHash = ToByteVector(key.GetPubKey().GetID());
+
+    CScript canonicalPubkeyHash;
+    canonicalPubkeyHash << OP_DUP << OP_HASH160 << pubkeyHash << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript pushdataPubkeyHash;
+    pushdataPubkeyHash << OP_DUP << OP_HASH160 << OP_PUSHDATA1;
+    pushdataPubkeyHash.push_back(static_cast<unsigned char>(pubkeyHash.size()));
+    pushdataPubkeyHash.insert(pushdataPubkeyHash.end(), pubkeyHash.begin(), pubkeyHash.end());
+    pushdataPubkeyHash << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CScript canonicalPubkey;
+    canonicalPubkey << pubkey << OP_CHECKSIG;
+    CScript pushdataPubkey;
+    pushdataPubkey << OP_PUSHDATA1;
+    pushdataPubkey.push_back(static_cast<unsigned char>(pubkey.size()));
+    pushdataPubkey.insert(pushdataPubkey.end(), pubkey.begin(), pubkey.end());
+    pushdataPubkey << OP_CHECKSIG;
+
+    const std::vector<std::pair<CScript, txnouttype> > scripts = {
+        {canonicalPubkeyHash, TX_PUBKEYHASH}, {pushdataPubkeyHash, TX_PUBKEYHASH},
+        {canonicalPubkey, TX_PUBKEY}, {pushdataPubkey, TX_PUBKEY}};
+    for (const auto& script: scripts) {
+        vector<valtype> solutions;
+        txnouttype whichType;
+        BOOST_CHECK(ExtractScriptPubKeyFormat(script.first, whichType, solutions));
+        BOOST_CHECK_EQUAL(whichType, script.second);
+        BOOST_CHECK(solutions == vector<valtype>(1, script.second == TX_PUBKEY ? pubkey : pubkeyHash));
+    }
+
+    CScript notPubkeyHash = canonicalPubkeyHash;
+    notPubkeyHash.back() = OP_CHECKMULTISIG;
+    vector<valtype> solutions;
+    txnouttype whichType;
+    BOOST_CHECK(!ExtractScriptPubKeyFormat(notPubkeyHash, whichType, solutions));
+    BOOST_CHECK_EQUAL(whichType, TX_NONSTANDARD);
+}
+
+BOOST_AUTO_TEST_CASE(ExtractDestinations_gives_the_one_destination_of_single_key_scripts)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript redeemScript = GetScriptForDestination(key.GetPubKey().GetID());
+    const std::vector<std::pair<CScript, CTxDestination> > scripts = {
+        {CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG, key.GetPubKey().GetID()},
+        {GetScriptForDestination(key.GetPubKey().GetID()), key.GetPubKey().GetID()},
+        {GetScriptForDestination(CScriptID(redeemScript)), CScriptID(redeemScript)}};
+    for (const auto& script: scripts) {
+        CTxDestination destination;
+        BOOST_CHECK(ExtractDestination(script.first, destination));
+        BOOST_CHECK(destination == script.second);
+
+        txnouttype whichType;
+        std::vector<CTxDestination> destinations;
+        int nRequired;
+        BOOST_CHECK(ExtractDestinations(script.first, whichType, destinations, nRequired));
+        BOOST_CHECK(destinations == std::vector<CTxDestination>(1, script.second));
+        BOOST_CHECK_EQUAL(nRequired, 1);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(multisig_Sign)
 {
 
@@ -45,6 +45,7 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
 
         // calculate actual merkle root and height
         uint256 merkleRoot1 = block.BuildMerkleTree();
+        BOOST_CHECK(block.ComputeMerkleRoot() == merkleRoot1);
         std::vector<uint256> vTxid(nTx, 0);
         for (unsigned int j=0; j<nTx; j++)
             vTxid[j] = block.vtx[j].GetHash();
@@ -104,4 +105,26 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
     }
 }
 
+BOOST_AUTO_TEST_CASE(merkle_root_flags_a_duplicated_tail_like_the_full_tree)
+{
+    CBlock block;
+    for (unsigned int j = 0; j < 6; j++) {
+        CMutableTransaction tx;
+        tx.nLockTime = j;
+        block.vtx.push_back(CTransaction(tx));
+    }
+    bool mutated = true;
+    const uint256 root = block.ComputeMerkleRoot(&mutated);
+    BOOST_CHECK(!mutated);
+
+    // [1,2,3,4,5,6] and [1,2,3,4,5,6,5,6] share their merkle root
+    block.vtx.push_back(block.vtx[4]);
+    block.vtx.push_back(block.vtx[5]);
+    bool treeMutated = false;
+    BOOST_CHECK(block.ComputeMerkleRoot(&mutated) == root);
+    BOOST_CHECK(block.BuildMerkleTree(&treeMutated) == root);
+    BOOST_CHECK(mutated);
+    BOOST_CHECK(treeMutated);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
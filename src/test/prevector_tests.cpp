@@ -0,0 +1,159 @@
+#include <prevector.h>
+
+#include <serialize.h>
+#include <streams.h>
+#include <version.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+typedef prevector<8, int> SmallVector;
+
+/** Applies every change to a prevector and a std::vector, and checks they stay alike */
+class VectorPair
+{
+    std::vector<int> real_;
+    SmallVector pre_;
+
+public:
+    void Check() const
+    {
+        BOOST_REQUIRE_EQUAL(real_.size(), pre_.size());
+        BOOST_CHECK_EQUAL(real_.empty(), pre_.empty());
+        BOOST_CHECK(pre_.capacity() >= pre_.size());
+        for (unsigned n = 0; n < real_.size(); n++)
+            BOOST_CHECK_EQUAL(real_[n], pre_[n]);
+        BOOST_CHECK(std::equal(pre_.begin(), pre_.end(), real_.begin()));
+
+        const SmallVector copy(pre_);
+        BOOST_CHECK(copy == pre_);
+        SmallVector moved(std::move(SmallVector(pre_)));
+        BOOST_CHECK(moved == pre_);
+        BOOST_CHECK(!(moved < pre_) && !(pre_ < moved));
+
+        CDataStream real(SER_DISK, PROTOCOL_VERSION);
+        CDataStream pre(SER_DISK, PROTOCOL_VERSION);
+        real << real_;
+        pre << pre_;
+        BOOST_CHECK(real.str() == pre.str());
+        SmallVector read;
+        pre >> read;
+        BOOST_CHECK(read == pre_);
+    }
+
+    void Resize(unsigned nSize) { real_.resize(nSize); pre_.resize(nSize); }
+    void Insert(unsigned pos, int value) { real_.insert(real_.begin() + pos, value); pre_.insert(pre_.begin() + pos, value); }
+    void Insert(unsigned pos, unsigned count, int value) { real_.insert(real_.begin() + pos, count, value); pre_.insert(pre_.begin() + pos, count, value); }
+    void InsertRange(unsigned pos, const std::vector<int>& values) { real_.insert(real_.begin() + pos, values.begin(), values.end()); pre_.insert(pre_.begin() + pos, values.begin(), values.end()); }
+    void Erase(unsigned first, unsigned last) { real_.erase(real_.begin() + first, real_.begin() + last); pre_.erase(pre_.begin() + first, pre_.begin() + last); }
+    void PushBack(int value) { real_.push_back(value); pre_.push_back(value); }
+    void PopBack() { real_.pop_back(); pre_.pop_back(); }
+    void Assign(unsigned count, int value) { real_.assign(count, value); pre_.assign(count, value); }
+    void ShrinkToFit() { pre_.shrink_to_fit(); }
+    void Reserve(unsigned nCapacity) { real_.reserve(nCapacity); pre_.reserve(nCapacity); }
+    void Swap() { SmallVector other(pre_); pre_.clear(); pre_.swap(other); }
+    unsigned Size() const { return real_.size(); }
+};
+
+/** Deterministic, so that a failure reproduces */
+class Lcg
+{
+    uint64_t state_;
+
+public:
+    explicit Lcg(uint64_t seed) : state_(seed) {}
+    unsigned Next(unsigned range)
+    {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (state_ >> 33) % range;
+    }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(prevector_tests)
+
+BOOST_AUTO_TEST_CASE(willBehaveLikeAStdVector)
+{
+    for (uint64_t seed = 0; seed < 32; seed++) {
+        Lcg rand(seed);
+        VectorPair vectors;
+        for (int step = 0; step < 512; step++) {
+            const unsigned nSize = vectors.Size();
+            switch (rand.Next(11)) {
+            case 0:
+                vectors.Resize(std::max(0, (int)nSize + (int)rand.Next(9) - 4));
+                break;
+            case 1:
+                vectors.Insert(rand.Next(nSize + 1), rand.Next(1000));
+                break;
+            case 2:
+                vectors.Insert(rand.Next(nSize + 1), rand.Next(10), rand.Next(1000));
+                break;
+            case 3: {
+                std::vector<int> values(rand.Next(12), (int)rand.Next(1000));
+                vectors.InsertRange(rand.Next(nSize + 1), values);
+                break;
+            }
+            case 4:
+                if (nSize > 0) {
+                    const unsigned first = rand.Next(nSize);
+                    vectors.Erase(first, first + rand.Next(nSize - first + 1));
+                }
+                break;
+            case 5:
+                vectors.PushBack(rand.Next(1000));
+                break;
+            case 6:
+                if (nSize > 0)
+                    vectors.PopBack();
+                break;
+            case 7:
+                vectors.Assign(rand.Next(20), rand.Next(1000));
+                break;
+            case 8:
+                vectors.ShrinkToFit();
+                break;
+            case 9:
+                vectors.Reserve(rand.Next(32));
+                break;
+            case 10:
+                vectors.Swap();
+                break;
+            }
+            vectors.Check();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willKeepShortContentsInline)
+{
+    prevector<28, unsigned char> bytes(28, 0xab);
+    BOOST_CHECK_EQUAL(bytes.allocated_memory(), 0u);
+    bytes.push_back(0xcd);
+    BOOST_CHECK(bytes.allocated_memory() > 0);
+    BOOST_CHECK_EQUAL(bytes.back(), 0xcd);
+
+    bytes.erase(bytes.begin(), bytes.begin() + 10);
+    BOOST_CHECK(bytes.allocated_memory() > 0);
+    bytes.shrink_to_fit();
+    BOOST_CHECK_EQUAL(bytes.allocated_memory(), 0u);
+    BOOST_CHECK_EQUAL(bytes.size(), 19u);
+    BOOST_CHECK_EQUAL(bytes.front(), 0xab);
+}
+
+BOOST_AUTO_TEST_CASE(willOrderLikeAStdVector)
+{
+    const unsigned char shortBytes[] = {2};
+    const unsigned char longBytes[] = {1, 9};
+    const prevector<4, unsigned char> shorter(shortBytes, shortBytes + 1);
+    const prevector<4, unsigned char> longer(longBytes, longBytes + 2);
+    BOOST_CHECK(longer < shorter);
+    BOOST_CHECK(std::vector<unsigned char>(longBytes, longBytes + 2) < std::vector<unsigned char>(shortBytes, shortBytes + 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,7 +17,7 @@ BOOST_AUTO_TEST_CASE(basic_sanity)
 
   
   
-  BOOST_CHECK_MESSAGE(ECC_InitSanityCheck() == true, "openssl ECC test");
+  BOOST_CHECK_MESSAGE(ECC_InitSanityCheck() == true, "secp256k1 ECC test");
   
 }
 
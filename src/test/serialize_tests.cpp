@@ -2,8 +2,10 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "primitives/transaction.h"
 #include "serialize.h"
 #include "streams.h"
+#include "version.h"
 
 #include <stdint.h>
 
@@ -156,9 +158,79 @@ BOOST_AUTO_TEST_CASE(insert_delete)
     BOOST_CHECK_EQUAL(ss[3], (char)0xff);
 
     // Make sure GetAndClear does the right thing:
-    CSerializeData d;
+    std::vector<char> d;
     ss.GetAndClear(d);
     BOOST_CHECK_EQUAL(ss.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(getandclear_keeps_the_unread_bytes)
+{
+    CDataStream ss(SER_DISK, 0);
+    ss << (char)1 << (char)2 << (char)3;
+    std::vector<char> whole;
+    ss.GetAndClear(whole);
+    BOOST_CHECK(whole == std::vector<char>({1, 2, 3}));
+    BOOST_CHECK(ss.empty());
+
+    ss << (char)4 << (char)5;
+    char c;
+    ss >> c;
+    std::vector<char> appended(1, 9);
+    ss.GetAndClear(appended);
+    BOOST_CHECK(appended == std::vector<char>({9, 5}));
+    BOOST_CHECK(ss.empty());
+
+    ss << (char)6;
+    ss.GetAndClear(whole);
+    BOOST_CHECK(whole == std::vector<char>({1, 2, 3, 6}));
+}
+
+BOOST_AUTO_TEST_CASE(secure_stream_serializes_like_the_plain_one)
+{
+    CDataStream ss(SER_DISK, 0);
+    CSecureDataStream ssSecure(SER_DISK, 0);
+    ss << std::string("secret") << 42;
+    ssSecure << std::string("secret") << 42;
+    BOOST_CHECK(std::vector<char>(ss.begin(), ss.end()) == std::vector<char>(ssSecure.begin(), ssSecure.end()));
+
+    CSerializeData data;
+    ssSecure.GetAndClear(data);
+    CSecureDataStream ssRead(data, SER_DISK, 0);
+    std::string str;
+    int n;
+    ssRead >> str >> n;
+    BOOST_CHECK_EQUAL(str, "secret");
+    BOOST_CHECK_EQUAL(n, 42);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_read_in_place_hashes_like_a_copied_one)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(2);
+    mtx.vin[0].prevout = COutPoint(uint256S("0x01"), 3);
+    mtx.vin[0].scriptSig = CScript() << OP_1 << std::vector<unsigned char>(300, 7);
+    mtx.vin[1].prevout = COutPoint(uint256S("0x02"), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 5;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    mtx.nLockTime = 17;
+    const CTransaction expected(mtx);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << expected << 42;
+    CTransaction tx;
+    UnserializeInPlace(ss, tx);
+    BOOST_CHECK(tx.GetHash() == expected.GetHash());
+    BOOST_CHECK(tx == expected);
+    int n;
+    ss >> n;
+    BOOST_CHECK_EQUAL(n, 42);
+    BOOST_CHECK(ss.empty());
+
+    CDataStream ssTruncated(SER_NETWORK, PROTOCOL_VERSION);
+    ssTruncated << expected;
+    ssTruncated.resize(ssTruncated.size() - 1);
+    BOOST_CHECK_THROW(UnserializeInPlace(ssTruncated, tx), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
 #include "json/json_spirit_writer_template.h"
 #include <ValidationState.h>
 #include <streams.h>
+#include <script/SignatureCheckers.h>
 #include <utilstrencodings.h>
 #include <script/SignatureCheckers.h>
 #include <script/scriptandsigflags.h>
@@ -171,6 +172,30 @@ BOOST_AUTO_TEST_CASE(sighash_test)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(sighash_with_precomputed_data_matches_the_full_serialization)
+{
+    seed_insecure_rand(false);
+
+    for (int i=0; i<2000; i++) {
+        int nHashType = insecure_rand();
+        CMutableTransaction txTo;
+        RandomTransaction(txTo, (nHashType & 0x1f) == SIGHASH_SINGLE);
+        // Some transactions span several hash midstates
+        if (i % 100 == 0) {
+            const CMutableTransaction txInputs = txTo;
+            while (txTo.vin.size() < 3 * PrecomputedTransactionData::MIDSTATE_INTERVAL + 5)
+                txTo.vin.insert(txTo.vin.end(), txInputs.vin.begin(), txInputs.vin.end());
+        }
+        CScript scriptCode;
+        RandomScript(scriptCode);
+        const CTransaction tx(txTo);
+        const PrecomputedTransactionData txdata(tx);
+
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++)
+            BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, &txdata) == SignatureHash(scriptCode, tx, nIn, nHashType));
+    }
+}
+
 // Goal: check that SignatureHash generates correct hash
 BOOST_AUTO_TEST_CASE(sighash_from_data)
 {
@@ -18,6 +18,9 @@
 #include <TransactionInputChecker.h>
 #include <chainparams.h>
 #include <Settings.h>
+#include <crypto/sha256.h>
+#include <script/sigcache.h>
+#include <UtxoCheckingAndUpdating.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
@@ -41,6 +44,9 @@ struct TestingSetup {
 
     TestingSetup() {
         SetupEnvironment();
+        SHA256AutoDetect();
+        InitSignatureCache();
+        InitScriptExecutionCache();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(CBaseChainParams::UNITTEST);
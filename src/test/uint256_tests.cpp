@@ -9,6 +9,7 @@
 #include <limits>
 #include <cmath>
 #include "uint256.h"
+#include <SaltedHasher.h>
 #include <string>
 #include "version.h"
 
@@ -822,6 +823,41 @@ BOOST_AUTO_TEST_CASE(bignum_SetCompact)
 }
 
 
+BOOST_AUTO_TEST_CASE( hexConversionEdgeCases )
+{
+    BOOST_CHECK_EQUAL(R1L.GetHex(), "7d1de5eaf9b156d53208f033b5aa8122d2d2355d5e12292b121156cfdb4a529c");
+    BOOST_CHECK_EQUAL(R1L.ToStringReverseEndian(), "9c524adbcf5611122b29125e5d35d2d22281aab533f00832d556b1f9eae51d7d");
+    BOOST_CHECK_EQUAL(R1S.GetHex(), R1L.GetHex().substr(24));
+
+    // Mixed case digits, leading spaces and 0x are accepted
+    BOOST_CHECK(uint256(R1ArrayHex) == R1L);
+    BOOST_CHECK(uint256("  0x" + R1L.GetHex()) == R1L);
+    // Short and odd length strings are read as the low order digits
+    BOOST_CHECK(uint256("abc") == uint256(0xabc));
+    BOOST_CHECK(uint256("0x1") == OneL);
+    BOOST_CHECK(uint256("") == ZeroL);
+    BOOST_CHECK(uint256("0x") == ZeroL);
+    // Parsing stops at the first character that is not a hex digit
+    BOOST_CHECK(uint256("12g4") == uint256(0x12));
+    // Of a string longer than the number, the last digits are kept
+    BOOST_CHECK(uint256("ff" + R1L.GetHex()) == R1L);
+}
+
+BOOST_AUTO_TEST_CASE( saltedHashers )
+{
+    const SaltedUint256Hasher hasher256;
+    BOOST_CHECK_EQUAL(hasher256(R1L), hasher256(uint256(R1L)));
+    BOOST_CHECK(hasher256(R1L) != hasher256(R2L));
+
+    const SaltedUint160Hasher hasher160;
+    BOOST_CHECK_EQUAL(hasher160(R1S), hasher160(uint160(R1S)));
+    BOOST_CHECK(hasher160(R1S) != hasher160(R2S));
+
+    // Every hasher draws a salt of its own
+    BOOST_CHECK(SaltedUint256Hasher()(R1L) != SaltedUint256Hasher()(R1L));
+    BOOST_CHECK(SaltedUint160Hasher()(R1S) != SaltedUint160Hasher()(R1S));
+}
+
 BOOST_AUTO_TEST_CASE( getmaxcoverage ) // some more tests just to get 100% coverage
 {
     // ~R1L give a base_uint<256>
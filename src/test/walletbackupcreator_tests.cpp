@@ -177,6 +177,46 @@ BOOST_AUTO_TEST_CASE(will_remove_files_down_to_maximum_number_of_backups)
     backupCreator.BackupWallet();
 }
 
+BOOST_AUTO_TEST_CASE(will_not_copy_wallet_that_has_not_changed_since_newest_backup)
+{
+    NiceMock<MockFileSystem> fileSystem;
+
+    std::string dataDirectory = "/bogusDirectory";
+    std::string backupDirectoryPath = dataDirectory+"/backups";
+    std::string walletPath = dataDirectory+"/wallet.dat";
+
+    ON_CALL(fileSystem, exists(backupDirectoryPath)).WillByDefault(Return(true));
+    ON_CALL(fileSystem, exists(walletPath)).WillByDefault(Return(true));
+    ON_CALL(fileSystem, get_timestamped_folder_contents(backupDirectoryPath))
+        .WillByDefault(Return(createTimestampedFolderContents(backupDirectoryPath,3u)));
+    ON_CALL(fileSystem, last_write_time(walletPath)).WillByDefault(Return(std::time_t(89)));
+    EXPECT_CALL(fileSystem, copy_file(walletPath, _)).Times(0);
+
+    WalletBackupCreator backupCreator(10, fileSystem,  dataDirectory);
+
+    BOOST_CHECK(backupCreator.BackupWallet());
+}
+
+BOOST_AUTO_TEST_CASE(will_copy_wallet_that_changed_since_newest_backup)
+{
+    NiceMock<MockFileSystem> fileSystem;
+
+    std::string dataDirectory = "/bogusDirectory";
+    std::string backupDirectoryPath = dataDirectory+"/backups";
+    std::string walletPath = dataDirectory+"/wallet.dat";
+
+    ON_CALL(fileSystem, exists(backupDirectoryPath)).WillByDefault(Return(true));
+    ON_CALL(fileSystem, exists(walletPath)).WillByDefault(Return(true));
+    ON_CALL(fileSystem, get_timestamped_folder_contents(backupDirectoryPath))
+        .WillByDefault(Return(createTimestampedFolderContents(backupDirectoryPath,3u)));
+    ON_CALL(fileSystem, last_write_time(walletPath)).WillByDefault(Return(std::time_t(90)));
+    EXPECT_CALL(fileSystem, copy_file(walletPath, _)).Times(1);
+
+    WalletBackupCreator backupCreator(10, fileSystem,  dataDirectory);
+
+    BOOST_CHECK(backupCreator.BackupWallet());
+}
+
 BOOST_AUTO_TEST_CASE(willSetBackupDirectoryPath)
 {
     NiceMock<MockFileSystem> fileSystem;
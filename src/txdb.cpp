@@ -8,6 +8,7 @@
 #include "pow.h"
 #include "uint256.h"
 #include <stdint.h>
+#include <limits>
 #include <coins.h>
 #include <boost/thread.hpp>
 #include <blockFileInfo.h>
@@ -15,9 +16,13 @@
 #include <chainparams.h>
 #include <addressindex.h>
 #include <spentindex.h>
+#include <VaultIndex.h>
 #include <DataDirectory.h>
 #include <IndexDatabaseUpdates.h>
+#include <checkqueue.h>
+#include <ThreadManagementHelpers.h>
 
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
 
 using namespace std;
@@ -26,10 +31,220 @@ namespace
 {
 
 constexpr char DB_ADDRESSINDEX = 'a';
+constexpr char DB_ADDRESSBALANCE = 'A';
 constexpr char DB_SPENTINDEX = 'p';
 constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
 constexpr char DB_TXINDEX = 't';
 constexpr char DB_BARETXIDINDEX = 'T';
+constexpr char DB_INDEXBUILDPROGRESS = 'X';
+constexpr char DB_RUNNINGCOINSSTATS = 'S';
+constexpr char DB_COIN = 'C';
+//! Per transaction coins entries of older databases
+constexpr char DB_COINS_LEGACY = 'c';
+constexpr char DB_COINSFORMAT = 'F';
+constexpr char DB_COINSFORMATUPGRADE = 'U';
+constexpr char DB_BLOCKFILTER = 'g';
+constexpr char DB_BLOCKSTATS = 's';
+constexpr char DB_COINSUPPLY = 'y';
+constexpr char DB_VAULTINDEX = 'v';
+
+//! One entry per transaction, as written before the format record existed
+constexpr int COINS_FORMAT_LEGACY = 0;
+//! One entry per unspent output
+constexpr int COINS_FORMAT_PER_OUTPUT = 1;
+//! One entry per unspent output, serialized with SER_COMPACT_SCRIPTS
+constexpr int COINS_FORMAT_COMPACT_SCRIPTS = 2;
+
+//! Number of block index records read from the database before they are decoded
+constexpr size_t BLOCK_INDEX_LOAD_BATCH_SIZE = 16384;
+//! Smallest number of records worth handing to a separate decoding thread
+constexpr size_t MIN_BLOCK_INDEX_RECORDS_PER_THREAD = 1024;
+//! Number of coins entries a snapshot load writes per database batch
+constexpr size_t COINS_SNAPSHOT_BATCH_ENTRIES = 50000;
+//! Number of coins entries a format upgrade converts per database batch
+constexpr size_t COINS_UPGRADE_BATCH_ENTRIES = 50000;
+//! Number of address balances written per database batch while they are built from the address index
+constexpr size_t ADDRESS_BALANCE_BUILD_BATCH_ENTRIES = 50000;
+
+/** Key of an unspent output; the index is varint encoded, so the outputs of a transaction follow each other in order */
+struct CoinEntryKey {
+    char chType;
+    uint256 txid;
+    uint32_t n;
+
+    CoinEntryKey() : chType(0), txid(0), n(0) {}
+    CoinEntryKey(const uint256& txidIn, uint32_t nIn) : chType(DB_COIN), txid(txidIn), n(nIn) {}
+
+    bool IsOutputOf(const uint256& txidIn) const { return chType == DB_COIN && txid == txidIn; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(chType);
+        READWRITE(txid);
+        READWRITE(VARINT(n));
+    }
+};
+
+/** An unspent output along with what the coins of its transaction record besides the outputs */
+struct CoinEntryValue {
+    CTxOut out;
+    int nHeight;
+    int nTxVersion;
+    bool fCoinBase;
+    bool fCoinStake;
+
+    CoinEntryValue() : out(), nHeight(0), nTxVersion(0), fCoinBase(false), fCoinStake(false) {}
+    CoinEntryValue(const CCoins& coins, uint32_t n) : out(coins.vout[n]), nHeight(coins.nHeight), nTxVersion(coins.nVersion), fCoinBase(coins.fCoinBase), fCoinStake(coins.fCoinStake) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        unsigned int nCode = nHeight * 4 + (fCoinStake ? 2 : 0) + (fCoinBase ? 1 : 0);
+        READWRITE(VARINT(nCode));
+        if (ser_action.ForRead()) {
+            nHeight = nCode / 4;
+            fCoinStake = (nCode & 2) != 0;
+            fCoinBase = (nCode & 1) != 0;
+        }
+        READWRITE(VARINT(nTxVersion));
+        READWRITE(REF(CTxOutCompressor(out)));
+    }
+};
+
+bool ReadCoinEntryKey(const leveldb::Iterator& cursor, CoinEntryKey& key)
+{
+    if (!cursor.Valid())
+        return false;
+    try {
+        leveldb::Slice slKey = cursor.key();
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        ssKey >> key;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read the output the cursor is at, and the ones after it of the same transaction,
+ * into coins, leaving the cursor past them. False if the cursor is not at an output.
+ */
+bool ReadCoinsAt(leveldb::Iterator& cursor, int nValueType, uint256& txid, CCoins& coins, size_t* pnValueSize)
+{
+    CoinEntryKey key;
+    if (!ReadCoinEntryKey(cursor, key) || key.chType != DB_COIN)
+        return false;
+    txid = key.txid;
+    coins.Clear();
+    do {
+        CoinEntryValue value;
+        try {
+            leveldb::Slice slValue = cursor.value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), nValueType, CLIENT_VERSION);
+            ssValue >> value;
+            if (pnValueSize)
+                *pnValueSize += slValue.size();
+        } catch (const std::exception&) {
+            throw leveldb_error("Unreadable coin database entry of " + txid.ToString());
+        }
+        if (coins.vout.size() <= key.n)
+            coins.vout.resize(key.n + 1);
+        coins.vout[key.n] = value.out;
+        coins.nHeight = value.nHeight;
+        coins.nVersion = value.nTxVersion;
+        coins.fCoinBase = value.fCoinBase;
+        coins.fCoinStake = value.fCoinStake;
+        cursor.Next();
+    } while (ReadCoinEntryKey(cursor, key) && key.IsOutputOf(txid));
+    return true;
+}
+
+/** Position a lookup cursor at the first output of txid, false if it has none */
+bool SeekCoins(leveldb::Iterator& cursor, const uint256& txid)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << CoinEntryKey(txid, 0);
+    cursor.Seek(leveldb::Slice(&ssKey[0], ssKey.size()));
+    CoinEntryKey key;
+    return ReadCoinEntryKey(cursor, key) && key.IsOutputOf(txid);
+}
+
+bool ReadCoins(const CLevelDBWrapper& db, const uint256& txid, CCoins& coins, const CLevelDBSnapshot* psnapshot = NULL)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewLookupIterator(psnapshot));
+    uint256 txidFound;
+    return SeekCoins(*pcursor, txid) && ReadCoinsAt(*pcursor, db.GetValueSerializationType(), txidFound, coins, NULL);
+}
+
+bool HaveCoinsIn(const CLevelDBWrapper& db, const uint256& txid, const CLevelDBSnapshot* psnapshot = NULL)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewLookupIterator(psnapshot));
+    return SeekCoins(*pcursor, txid);
+}
+
+struct DecodedBlockIndex {
+    CDiskBlockIndex diskindex;
+    uint256 hash;
+};
+
+//! A block index record as read from the database, keyed by the hash it was stored under
+typedef std::pair<uint256, std::string> BlockIndexRecord;
+
+void DecodeBlockIndexRecords(
+    const std::vector<BlockIndexRecord>& records,
+    std::vector<DecodedBlockIndex>& decoded,
+    size_t begin,
+    size_t end,
+    std::string& strError)
+{
+    try {
+        for (size_t i = begin; i < end; i++) {
+            const std::string& value = records[i].second;
+            CDataStream ssValue(value.data(), value.data() + value.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> decoded[i].diskindex;
+            // The key is the hash the header had when it was validated and written.
+            // Recomputing it would run the Quark kernels for every legacy header.
+            decoded[i].hash = records[i].first;
+        }
+    } catch (const std::exception& e) {
+        strError = e.what();
+    }
+}
+
+/** Deserialize a batch of block index records, split over several threads. */
+bool DecodeBlockIndexBatch(
+    const std::vector<BlockIndexRecord>& records,
+    std::vector<DecodedBlockIndex>& decoded,
+    std::string& strError)
+{
+    decoded.clear();
+    decoded.resize(records.size());
+
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(boost::thread::hardware_concurrency(), records.size() / MIN_BLOCK_INDEX_RECORDS_PER_THREAD));
+    const size_t nPerThread = (records.size() + nThreads - 1) / nThreads;
+    std::vector<std::string> errors(nThreads);
+    boost::thread_group decoders;
+    for (size_t n = 1; n < nThreads; n++) {
+        const size_t begin = std::min(records.size(), n * nPerThread);
+        const size_t end = std::min(records.size(), begin + nPerThread);
+        decoders.create_thread(boost::bind(&DecodeBlockIndexRecords, boost::cref(records), boost::ref(decoded), begin, end, boost::ref(errors[n])));
+    }
+    DecodeBlockIndexRecords(records, decoded, 0, std::min(records.size(), nPerThread), errors[0]);
+    decoders.join_all();
+
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            strError = error;
+            return false;
+        }
+    }
+    return true;
+}
 
 } // anonymous namespace
 
@@ -38,12 +253,30 @@ extern std::set<std::pair<COutPoint, unsigned int> > setStakeSeen;
 
 CBlockIndex* InsertBlockIndex(uint256 hash);
 
-void static BatchWriteCoins(CLevelDBBatch& batch, const uint256& hash, const CCoins& coins)
+void static BatchWriteNewCoins(CLevelDBBatch& batch, const uint256& hash, const CCoins& coins)
 {
-    if (coins.IsPruned())
-        batch.Erase(std::make_pair('c', hash));
-    else
-        batch.Write(std::make_pair('c', hash), coins);
+    for (uint32_t n = 0; n < coins.vout.size(); n++) {
+        if (coins.IsAvailable(n))
+            batch.Write(CoinEntryKey(hash, n), CoinEntryValue(coins, n));
+    }
+}
+
+void static BatchWriteCoins(CLevelDBBatch& batch, const uint256& hash, const CCoinsCacheEntry& entry)
+{
+    // Outputs do not change once created, so only the ones created or spent since the
+    // parent outputs were recorded are written, unless the transaction was connected
+    // again at another height.
+    const CCoins& coins = entry.coins;
+    const bool fSameTransaction = entry.nParentHeight == coins.nHeight;
+    const size_t nOutputs = std::max(coins.vout.size(), entry.vParentUnspent.size());
+    for (uint32_t n = 0; n < nOutputs; n++) {
+        const bool fOld = n < entry.vParentUnspent.size() && entry.vParentUnspent[n];
+        const bool fNew = coins.IsAvailable(n);
+        if (fNew && !(fOld && fSameTransaction))
+            batch.Write(CoinEntryKey(hash, n), CoinEntryValue(coins, n));
+        else if (fOld && !fNew)
+            batch.Erase(CoinEntryKey(hash, n));
+    }
 }
 
 void static BatchWriteHashBestChain(CLevelDBBatch& batch, const uint256& hash)
@@ -51,18 +284,274 @@ void static BatchWriteHashBestChain(CLevelDBBatch& batch, const uint256& hash)
     batch.Write('B', hash);
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+void static BatchWriteRunningStats(CLevelDBBatch& batch, const RunningCoinsStats& stats)
+{
+    batch.Write(DB_RUNNINGCOINSSTATS, stats);
+}
+
+CCoinsViewDB::CCoinsViewDB(
+    size_t nCacheSize,
+    bool fMemory,
+    bool fWipe
+    ): db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+    , csRunningStats()
+    , runningStats()
+    , fRunningStatsValid(false)
+{
+    LoadCoinsFormat();
+    LoadRunningStats();
+}
+
+CCoinsViewDB::CCoinsViewDB(
+    const CLevelDBTuning& tuning,
+    bool fMemory,
+    bool fWipe
+    ): db(GetDataDir() / "chainstate", tuning, fMemory, fWipe)
+    , csRunningStats()
+    , runningStats()
+    , fRunningStatsValid(false)
+{
+    LoadCoinsFormat();
+    LoadRunningStats();
+}
+
+void CCoinsViewDB::LoadCoinsFormat()
+{
+    int nFormat = COINS_FORMAT_LEGACY;
+    if (!db.Read(DB_COINSFORMAT, nFormat) && !HaveAnyEntries(DB_COINS_LEGACY)) {
+        db.Write(DB_COINSFORMAT, COINS_FORMAT_COMPACT_SCRIPTS);
+        nFormat = COINS_FORMAT_COMPACT_SCRIPTS;
+    }
+    if (nFormat == COINS_FORMAT_LEGACY) {
+        UpgradeToPerOutputEntries();
+        nFormat = COINS_FORMAT_PER_OUTPUT;
+    }
+    if (nFormat == COINS_FORMAT_PER_OUTPUT) {
+        UpgradeToCompactScripts();
+        nFormat = COINS_FORMAT_COMPACT_SCRIPTS;
+    }
+    if (nFormat != COINS_FORMAT_COMPACT_SCRIPTS)
+        throw std::runtime_error("The coin database was written in an unknown format. Rebuild it with -reindex.");
+    db.SetValueSerializationType(SER_DISK | SER_COMPACT_SCRIPTS);
+}
+
+void CCoinsViewDB::UpgradeToPerOutputEntries()
+{
+    // Every batch erases the entries it split up, so an interrupted upgrade
+    // resumes with the ones left.
+    LogPrintf("Upgrading the coin database to one entry per unspent output...\n");
+
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::string(1, DB_COINS_LEGACY));
+    CLevelDBBatch batch;
+    size_t nBatchEntries = 0;
+    uint64_t nUpgraded = 0;
+    for (; pcursor->Valid() && pcursor->key().starts_with(std::string(1, DB_COINS_LEGACY)); pcursor->Next()) {
+        uint256 txhash;
+        CCoins coins;
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType >> txhash;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> coins;
+        } catch (const std::exception& e) {
+            throw std::runtime_error(std::string("Coin database upgrade failed: ") + e.what());
+        }
+        batch.Erase(std::make_pair(DB_COINS_LEGACY, txhash));
+        BatchWriteNewCoins(batch, txhash, coins);
+        nUpgraded++;
+        if (++nBatchEntries == COINS_UPGRADE_BATCH_ENTRIES) {
+            db.WriteBatch(batch);
+            batch.Clear();
+            nBatchEntries = 0;
+            LogPrint(LOG_COINDB, "Upgraded %u coin database entries so far\n", (unsigned int)nUpgraded);
+        }
+    }
+    batch.Write(DB_COINSFORMAT, COINS_FORMAT_PER_OUTPUT);
+    db.WriteBatch(batch, true);
+    LogPrintf("Split %u coin database entries into one entry per unspent output\n", (unsigned int)nUpgraded);
+}
+
+void CCoinsViewDB::UpgradeToCompactScripts()
+{
+    // Every batch records the last entry it converted, so an interrupted
+    // upgrade resumes there instead of misreading converted entries.
+    CoinEntryKey keyUpgraded;
+    const bool fResuming = db.Read(DB_COINSFORMATUPGRADE, keyUpgraded);
+    LogPrintf("%s upgrade of the coin database to the compact script encoding...\n", fResuming ? "Resuming" : "Starting");
+
+    CDataStream ssStart(SER_DISK, CLIENT_VERSION);
+    if (fResuming)
+        ssStart << keyUpgraded;
+    else
+        ssStart << DB_COIN;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    pcursor->Seek(ssStart.str());
+    if (fResuming && pcursor->Valid() && pcursor->key().ToString() == ssStart.str())
+        pcursor->Next();
+
+    CLevelDBBatch batch(SER_DISK | SER_COMPACT_SCRIPTS);
+    size_t nBatchEntries = 0;
+    uint64_t nUpgraded = 0;
+    CoinEntryKey key;
+    for (; ReadCoinEntryKey(*pcursor, key) && key.chType == DB_COIN; pcursor->Next()) {
+        CoinEntryValue value;
+        try {
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> value;
+        } catch (const std::exception& e) {
+            throw std::runtime_error(std::string("Coin database upgrade failed: ") + e.what());
+        }
+        batch.Write(key, value);
+        nUpgraded++;
+        if (++nBatchEntries == COINS_UPGRADE_BATCH_ENTRIES) {
+            batch.Write(DB_COINSFORMATUPGRADE, key);
+            db.WriteBatch(batch);
+            batch.Clear();
+            nBatchEntries = 0;
+            LogPrint(LOG_COINDB, "Upgraded %u coin database entries so far\n", (unsigned int)nUpgraded);
+        }
+    }
+    batch.Erase(DB_COINSFORMATUPGRADE);
+    batch.Write(DB_COINSFORMAT, COINS_FORMAT_COMPACT_SCRIPTS);
+    db.WriteBatch(batch, true);
+    LogPrintf("Upgraded %u coin database entries to the compact script encoding\n", (unsigned int)nUpgraded);
+}
+
+void CCoinsViewDB::LoadRunningStats()
 {
+    const uint256 hashBestChain = GetBestBlock();
+    if (db.Read(DB_RUNNINGCOINSSTATS, runningStats))
+        fRunningStatsValid = runningStats.hashBlock == hashBestChain;
+    else
+        fRunningStatsValid = hashBestChain == uint256(0) && !HaveAnyEntries(DB_COIN);
+}
+
+bool CCoinsViewDB::HaveAnyEntries(char chType) const
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::string(1, chType));
+    return pcursor->Valid() && pcursor->key().starts_with(std::string(1, chType));
 }
 
 bool CCoinsViewDB::GetCoins(const uint256& txid, CCoins& coins) const
 {
-    return db.Read(std::make_pair('c', txid), coins);
+    return ReadCoins(db, txid, coins);
+}
+
+namespace
+{
+/** Reads one coins entry of a batch, on whichever lookup thread picks it up */
+class CCoinsLookup
+{
+public:
+    enum Result {
+        NOT_FOUND,
+        FOUND,
+        READ_ERROR,
+    };
+
+private:
+    const CLevelDBWrapper* pdb;
+    uint256 txid;
+    CCoins* pcoins;
+    Result* presult;
+
+public:
+    CCoinsLookup() : pdb(NULL), txid(0), pcoins(NULL), presult(NULL) {}
+    CCoinsLookup(const CLevelDBWrapper& db, const uint256& txidIn, CCoins& coins, Result& result) : pdb(&db), txid(txidIn), pcoins(&coins), presult(&result) {}
+
+    bool operator()()
+    {
+        try {
+            *presult = ReadCoins(*pdb, txid, *pcoins) ? FOUND : NOT_FOUND;
+        } catch (const std::runtime_error&) {
+            // Rethrown on the calling thread, which knows how to handle it.
+            *presult = READ_ERROR;
+        }
+        return true;
+    }
+
+    void swap(CCoinsLookup& other)
+    {
+        std::swap(pdb, other.pdb);
+        std::swap(txid, other.txid);
+        std::swap(pcoins, other.pcoins);
+        std::swap(presult, other.presult);
+    }
+};
+
+//! Below this many keys a batch is not worth handing out to the lookup threads
+constexpr size_t MIN_PARALLEL_COINS_LOOKUPS = 16;
+
+CCheckQueue<CCoinsLookup> coinsLookupQueue(8);
+//! Only one batch may be spread at a time, as the queue serves a single master
+boost::mutex csCoinsLookupQueue;
+int nCoinsLookupThreads = 0;
+
+void ThreadCoinsLookup()
+{
+    RenameThread("izzy-coinslookup");
+    coinsLookupQueue.Thread();
+}
+
+bool IsBeforeInKeyOrder(const uint256& a, const uint256& b)
+{
+    // Keys are compared bytewise, which differs from uint256's numeric order.
+    return memcmp(a.begin(), b.begin(), a.size()) < 0;
+}
+}
+
+void CCoinsViewDB::StartLookupThreads(boost::thread_group& threadGroup, int nThreads)
+{
+    nCoinsLookupThreads = nThreads;
+    for (int i = 0; i < nThreads - 1; i++)
+        threadGroup.create_thread(&ThreadCoinsLookup);
+}
+
+void CCoinsViewDB::GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+{
+    std::vector<uint256> sorted(txids);
+    std::sort(sorted.begin(), sorted.end(), IsBeforeInKeyOrder);
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::vector<CCoins> found(sorted.size());
+    std::vector<CCoinsLookup::Result> results(sorted.size(), CCoinsLookup::NOT_FOUND);
+    std::vector<CCoinsLookup> lookups;
+    lookups.reserve(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++)
+        lookups.push_back(CCoinsLookup(db, sorted[i], found[i], results[i]));
+
+    if (nCoinsLookupThreads > 1 && lookups.size() >= MIN_PARALLEL_COINS_LOOKUPS) {
+        // The queue hands out lookups from the back, so reverse them to keep
+        // each thread walking the keys in ascending order.
+        std::reverse(lookups.begin(), lookups.end());
+        boost::unique_lock<boost::mutex> lock(csCoinsLookupQueue);
+        CCheckQueueControl<CCoinsLookup> control(&coinsLookupQueue);
+        control.Add(lookups);
+        control.Wait();
+    } else {
+        for (std::vector<CCoinsLookup>::iterator it = lookups.begin(); it != lookups.end(); ++it)
+            (*it)();
+    }
+
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (results[i] == CCoinsLookup::READ_ERROR)
+            throw leveldb_error("Database read error in coins batch lookup");
+        if (results[i] == CCoinsLookup::FOUND) {
+            coins.push_back(std::make_pair(sorted[i], CCoins()));
+            coins.back().second.swap(found[i]);
+        }
+    }
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256& txid) const
 {
-    return db.Exists(std::make_pair('c', txid));
+    return HaveCoinsIn(db, txid);
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const
@@ -73,31 +562,86 @@ uint256 CCoinsViewDB::GetBestBlock() const
     return hashBestChain;
 }
 
+namespace
+{
+/** The coin database as of a LevelDB snapshot */
+class CCoinsViewDBSnapshot : public CCoinsView
+{
+private:
+    const CLevelDBWrapper& db;
+    CLevelDBSnapshot snapshot;
+
+public:
+    explicit CCoinsViewDBSnapshot(const CLevelDBWrapper& dbIn) : db(dbIn), snapshot(dbIn) {}
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const
+    {
+        return ReadCoins(db, txid, coins, &snapshot);
+    }
+
+    bool HaveCoins(const uint256& txid) const
+    {
+        return HaveCoinsIn(db, txid, &snapshot);
+    }
+
+    uint256 GetBestBlock() const
+    {
+        uint256 hashBestChain;
+        if (!db.Read('B', hashBestChain, &snapshot))
+            return uint256(0);
+        return hashBestChain;
+    }
+};
+}
+
+std::shared_ptr<CCoinsView> CCoinsViewDB::OpenSnapshot()
+{
+    return std::shared_ptr<CCoinsView>(new CCoinsViewDBSnapshot(db));
+}
+
 bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
 {
-    CLevelDBBatch batch;
+    boost::unique_lock<boost::mutex> lock(csRunningStats);
+    RunningCoinsStats stats = runningStats;
+    CLevelDBBatch batch(db.GetValueSerializationType());
     size_t count = 0;
     size_t changed = 0;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+            if (fRunningStatsValid) {
+                CCoins coinsOld;
+                const bool fHaveOld = !(it->second.flags & CCoinsCacheEntry::FRESH) && GetCoins(it->first, coinsOld);
+                stats.UpdateCoins(it->first, fHaveOld ? &coinsOld : NULL, it->second.coins);
+            }
+            BatchWriteCoins(batch, it->first, it->second);
             changed++;
         }
         count++;
         CCoinsMap::iterator itOld = it++;
         mapCoins.erase(itOld);
     }
-    if (hashBlock != uint256(0))
+    if (hashBlock != uint256(0)) {
         BatchWriteHashBestChain(batch, hashBlock);
+        stats.hashBlock = hashBlock;
+    }
+    if (fRunningStatsValid)
+        BatchWriteRunningStats(batch, stats);
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    LogPrint(LOG_COINDB, "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    if (!db.WriteBatch(batch))
+        return false;
+    runningStats = stats;
+    return true;
 }
 
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
 {
 }
 
+CBlockTreeDB::CBlockTreeDB(const CLevelDBTuning& tuning, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", tuning, fMemory, fWipe)
+{
+}
+
 bool CBlockTreeDB::WriteBlockIndex(const CDiskBlockIndex& blockindex)
 {
     return Write(std::make_pair('b', blockindex.GetBlockHash()), blockindex);
@@ -139,58 +683,174 @@ bool CBlockTreeDB::ReadLastBlockFile(int& nFile)
 
 bool CCoinsViewDB::GetStats(CCoinsStats& stats) const
 {
+    // While the running statistics are not available the scan provides them,
+    // so no batch may be written in between.
+    boost::unique_lock<boost::mutex> lock(csRunningStats);
+    if (fRunningStatsValid)
+        lock.unlock();
+
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
+
+    // The iterator reads the best block marker from the same database state
+    // as the coins entries.
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    RunningCoinsStats scannedStats;
+    try {
+        stats.hashBlock = uint256(0);
+        pcursor->Seek(std::string(1, 'B'));
+        if (pcursor->Valid() && pcursor->key() == leveldb::Slice("B", 1)) {
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> stats.hashBlock;
+        }
+        ss << stats.hashBlock;
+        pcursor->Seek(std::string(1, DB_COIN));
+        uint256 txhash;
+        CCoins coins;
+        size_t nValueSize = 0;
+        while (ReadCoinsAt(*pcursor, db.GetValueSerializationType(), txhash, coins, &nValueSize)) {
+            boost::this_thread::interruption_point();
+            UpdateCoinsStats(ss, txhash, coins, stats);
+            scannedStats.UpdateCoins(txhash, NULL, coins);
+            stats.nSerializedSize += 32 + nValueSize;
+            nValueSize = 0;
+        }
+    } catch (std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    stats.hashSerialized = ss.GetHash();
+    scannedStats.hashBlock = stats.hashBlock;
+    scannedStats.GetStats(stats);
+
+    if (!fRunningStatsValid) {
+        CLevelDBBatch batch;
+        BatchWriteRunningStats(batch, scannedStats);
+        if (!const_cast<CLevelDBWrapper&>(db).WriteBatch(batch))
+            return false;
+        runningStats = scannedStats;
+        fRunningStatsValid = true;
+        LogPrint(LOG_COINDB, "Running UTXO set statistics initialized at %s\n", stats.hashBlock);
+    }
+    return true;
+}
+
+bool CCoinsViewDB::GetRunningStats(CCoinsStats& stats) const
+{
+    RunningCoinsStats current;
+    {
+        boost::unique_lock<boost::mutex> lock(csRunningStats);
+        if (!fRunningStatsValid)
+            return false;
+        current = runningStats;
+    }
+    current.GetStats(stats);
+    return true;
+}
+
+bool CCoinsViewDB::WriteSnapshot(CAutoFile& file, CCoinsStats& stats) const
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::string(1, DB_COIN));
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     stats.hashBlock = GetBestBlock();
     ss << stats.hashBlock;
-    CAmount nTotalAmount = 0;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == 'c') {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-                stats.nTransactions++;
-                for (unsigned int i = 0; i < coins.vout.size(); i++) {
-                    const CTxOut& out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i + 1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
-                }
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
-            }
-            pcursor->Next();
-        } catch (std::exception& e) {
-            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    try {
+        uint256 txhash;
+        CCoins coins;
+        size_t nValueSize = 0;
+        while (ReadCoinsAt(*pcursor, db.GetValueSerializationType(), txhash, coins, &nValueSize)) {
+            boost::this_thread::interruption_point();
+            file << txhash << coins;
+            UpdateCoinsStats(ss, txhash, coins, stats);
+            stats.nSerializedSize += 32 + nValueSize;
+            nValueSize = 0;
         }
+    } catch (std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
-    stats.nHeight = mapBlockIndex.find(GetBestBlock())->second->nHeight;
     stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
     return true;
 }
 
+bool CCoinsViewDB::LoadSnapshot(CAutoFile& file, uint64_t nCoins, const uint256& hashBlock)
+{
+    boost::unique_lock<boost::mutex> lock(csRunningStats);
+    fRunningStatsValid = false;
+    // The best block marker is cleared first and only set once every entry
+    // is in, so an interrupted load is never mistaken for a usable chainstate.
+    {
+        CLevelDBBatch batch;
+        BatchWriteHashBestChain(batch, uint256(0));
+        batch.Erase(DB_RUNNINGCOINSSTATS);
+        size_t nBatchEntries = 0;
+        boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+        CoinEntryKey key;
+        for (pcursor->Seek(std::string(1, DB_COIN)); ReadCoinEntryKey(*pcursor, key) && key.chType == DB_COIN; pcursor->Next()) {
+            batch.Erase(key);
+            if (++nBatchEntries == COINS_SNAPSHOT_BATCH_ENTRIES) {
+                if (!db.WriteBatch(batch))
+                    return false;
+                batch.Clear();
+                nBatchEntries = 0;
+            }
+        }
+        if (!db.WriteBatch(batch, true))
+            return false;
+    }
+
+    CLevelDBBatch batch(db.GetValueSerializationType());
+    RunningCoinsStats stats;
+    try {
+        for (uint64_t i = 0; i < nCoins; i++) {
+            boost::this_thread::interruption_point();
+            uint256 txhash;
+            CCoins coins;
+            file >> txhash >> coins;
+            BatchWriteNewCoins(batch, txhash, coins);
+            stats.UpdateCoins(txhash, NULL, coins);
+            if ((i + 1) % COINS_SNAPSHOT_BATCH_ENTRIES == 0) {
+                if (!db.WriteBatch(batch))
+                    return false;
+                batch.Clear();
+            }
+        }
+    } catch (std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    BatchWriteHashBestChain(batch, hashBlock);
+    stats.hashBlock = hashBlock;
+    BatchWriteRunningStats(batch, stats);
+    LogPrint(LOG_COINDB, "Loaded %u coins entries from snapshot based on %s\n", (unsigned int)nCoins, hashBlock);
+    if (!db.WriteBatch(batch, true))
+        return false;
+    runningStats = stats;
+    fRunningStatsValid = true;
+    return true;
+}
+
+void UpdateCoinsStats(CHashWriter& ss, const uint256& txid, const CCoins& coins, CCoinsStats& stats)
+{
+    ss << txid;
+    ss << VARINT(coins.nVersion);
+    ss << (coins.fCoinBase ? 'c' : 'n');
+    ss << VARINT(coins.nHeight);
+    stats.nTransactions++;
+    for (unsigned int i = 0; i < coins.vout.size(); i++) {
+        const CTxOut& out = coins.vout[i];
+        if (!out.IsNull()) {
+            stats.nTransactionOutputs++;
+            ss << VARINT(i + 1);
+            ss << out;
+            stats.nTotalAmount += out.nValue;
+        }
+    }
+    ss << VARINT(0);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256& txid, CDiskTxPos& pos)
 {
     /* This method looks up by txid or bare txid.  Both are tried, and if
@@ -207,17 +867,69 @@ bool CBlockTreeDB::ReadTxIndex(const uint256& txid, CDiskTxPos& pos)
     return false;
 }
 
-bool CBlockTreeDB::WriteTxIndex(const std::vector<TxIndexEntry>& vect)
+static void BatchWriteTxIndex(CLevelDBBatch& batch, const std::vector<TxIndexEntry>& vect)
 {
-    CLevelDBBatch batch;
     for (const auto& entry : vect)
     {
         batch.Write(std::make_pair(DB_TXINDEX, entry.txid), entry.diskPos);
         batch.Write(std::make_pair(DB_BARETXIDINDEX, entry.bareTxid), entry.diskPos);
     }
+}
+
+bool CBlockTreeDB::WriteTxIndex(const std::vector<TxIndexEntry>& vect)
+{
+    CLevelDBBatch batch;
+    BatchWriteTxIndex(batch, vect);
+    return WriteBatch(batch);
+}
+
+static void BatchWriteBlockFilters(CLevelDBBatch& batch, const std::vector<BlockFilter>& filters)
+{
+    for (const BlockFilter& filter : filters)
+        batch.Write(std::make_pair(DB_BLOCKFILTER, filter.GetBlockHash()), filter);
+}
+
+bool CBlockTreeDB::WriteBlockFilters(const std::vector<BlockFilter>& filters)
+{
+    CLevelDBBatch batch;
+    BatchWriteBlockFilters(batch, filters);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256& blockHash, BlockFilter& filter)
+{
+    return Read(std::make_pair(DB_BLOCKFILTER, blockHash), filter);
+}
+
+static void BatchWriteBlockStats(CLevelDBBatch& batch, const std::vector<BlockStats>& blockStats)
+{
+    for (const BlockStats& stats : blockStats)
+        batch.Write(std::make_pair(DB_BLOCKSTATS, stats.blockHash), stats);
+}
+
+bool CBlockTreeDB::ReadBlockStats(const uint256& blockHash, BlockStats& stats)
+{
+    return Read(std::make_pair(DB_BLOCKSTATS, blockHash), stats);
+}
+
+static void BatchWriteCoinSupplies(CLevelDBBatch& batch, const std::vector<CoinSupply>& supplies)
+{
+    for (const CoinSupply& supply : supplies)
+        batch.Write(std::make_pair(DB_COINSUPPLY, supply.blockHash), supply);
+}
+
+bool CBlockTreeDB::WriteCoinSupplies(const std::vector<CoinSupply>& supplies)
+{
+    CLevelDBBatch batch;
+    BatchWriteCoinSupplies(batch, supplies);
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadCoinSupply(const uint256& blockHash, CoinSupply& supply)
+{
+    return Read(std::make_pair(DB_COINSUPPLY, blockHash), supply);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string& name, bool fValue)
 {
     return Write(std::make_pair('F', name), fValue ? '1' : '0');
@@ -242,6 +954,21 @@ bool CBlockTreeDB::ReadInt(const std::string& name, int& nValue)
     return Read(std::make_pair('I', name), nValue);
 }
 
+bool CBlockTreeDB::WriteIndexBuildProgress(const std::string& name, const uint256& hashBlock)
+{
+    return Write(std::make_pair(DB_INDEXBUILDPROGRESS, name), hashBlock);
+}
+
+bool CBlockTreeDB::ReadIndexBuildProgress(const std::string& name, uint256& hashBlock)
+{
+    return Read(std::make_pair(DB_INDEXBUILDPROGRESS, name), hashBlock);
+}
+
+bool CBlockTreeDB::EraseIndexBuildProgress(const std::string& name)
+{
+    return Erase(std::make_pair(DB_INDEXBUILDPROGRESS, name));
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
     boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
@@ -250,75 +977,90 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
     ssKeySet << make_pair('b', uint256(0));
     pcursor->Seek(ssKeySet.str());
 
-    // Load mapBlockIndex
-    uint256 nPreviousCheckpoint;
-    while (pcursor->Valid()) {
+    // Load mapBlockIndex. Records are read sequentially in batches, decoded in parallel,
+    // and then linked into mapBlockIndex in the order they were read.
+    std::vector<BlockIndexRecord> records;
+    std::vector<DecodedBlockIndex> decoded;
+    records.reserve(BLOCK_INDEX_LOAD_BATCH_SIZE);
+    bool fFinished = false;
+    while (!fFinished) {
         boost::this_thread::interruption_point();
+        records.clear();
         try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == 'b') {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskindex;
-                ssValue >> diskindex;
-
-                // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
-                pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
-                pindexNew->nHeight = diskindex.nHeight;
-                pindexNew->nFile = diskindex.nFile;
-                pindexNew->nDataPos = diskindex.nDataPos;
-                pindexNew->nUndoPos = diskindex.nUndoPos;
-                pindexNew->nVersion = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime = diskindex.nTime;
-                pindexNew->nBits = diskindex.nBits;
-                pindexNew->nNonce = diskindex.nNonce;
-                pindexNew->nStatus = diskindex.nStatus;
-                pindexNew->nTx = diskindex.nTx;
-
-                //zerocoin
-                pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
-                pindexNew->mapZerocoinSupply = diskindex.mapZerocoinSupply;
-                pindexNew->vMintDenominationsInBlock = diskindex.vMintDenominationsInBlock;
-
-                //Proof Of Stake
-                pindexNew->nMint = diskindex.nMint;
-                pindexNew->nMoneySupply = diskindex.nMoneySupply;
-                pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake = diskindex.prevoutStake;
-                pindexNew->nStakeTime = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
-
-                pindexNew->vLotteryWinnersCoinstakes = diskindex.vLotteryWinnersCoinstakes;
-
-                if (pindexNew->nHeight <= Params().LAST_POW_BLOCK()) {
-                    if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params()))
-                        return error("LoadBlockIndex() : CheckProofOfWork failed: %s", *pindexNew);
+            while (records.size() < BLOCK_INDEX_LOAD_BATCH_SIZE) {
+                if (!pcursor->Valid()) {
+                    fFinished = true;
+                    break;
                 }
-                // ppcoin: build setStakeSeen
-                if (pindexNew->IsProofOfStake())
-                    setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
-
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chType;
+                ssKey >> chType;
+                if (chType != 'b') {
+                    fFinished = true; // finished loading block index
+                    break;
+                }
+                uint256 hash;
+                ssKey >> hash;
+                leveldb::Slice slValue = pcursor->value();
+                records.push_back(BlockIndexRecord(hash, std::string(slValue.data(), slValue.size())));
                 pcursor->Next();
-            } else {
-                break; // if shutdown requested or finished loading block index
             }
         } catch (std::exception& e) {
             return error("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
+
+        std::string strError;
+        if (!DecodeBlockIndexBatch(records, decoded, strError))
+            return error("%s : Deserialize or I/O error - %s", __func__, strError);
+
+        for (const DecodedBlockIndex& entry : decoded) {
+            const CDiskBlockIndex& diskindex = entry.diskindex;
+
+            // Construct block index object
+            CBlockIndex* pindexNew = InsertBlockIndex(entry.hash);
+            pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
+            pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
+            pindexNew->nHeight = diskindex.nHeight;
+            pindexNew->nFile = diskindex.nFile;
+            pindexNew->nDataPos = diskindex.nDataPos;
+            pindexNew->nUndoPos = diskindex.nUndoPos;
+            pindexNew->nVersion = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime = diskindex.nTime;
+            pindexNew->nBits = diskindex.nBits;
+            pindexNew->nNonce = diskindex.nNonce;
+            pindexNew->nStatus = diskindex.nStatus;
+            pindexNew->nTx = diskindex.nTx;
+
+            //zerocoin
+            pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
+
+            //Proof Of Stake
+            pindexNew->nMint = diskindex.nMint;
+            pindexNew->nMoneySupply = diskindex.nMoneySupply;
+            pindexNew->nFlags = diskindex.nFlags;
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            pindexNew->prevoutStake = diskindex.prevoutStake;
+            pindexNew->nStakeTime = diskindex.nStakeTime;
+            pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
+
+            pindexNew->vLotteryWinnersCoinstakes = diskindex.vLotteryWinnersCoinstakes;
+
+            if (pindexNew->nHeight <= Params().LAST_POW_BLOCK()) {
+                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params()))
+                    return error("LoadBlockIndex() : CheckProofOfWork failed: %s", *pindexNew);
+            }
+            // ppcoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+        }
     }
 
     return true;
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CLevelDBBatch batch;
+static void BatchUpdateAddressUnspentIndex(CLevelDBBatch& batch, const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -326,6 +1068,11 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
             batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+    CLevelDBBatch batch;
+    BatchUpdateAddressUnspentIndex(batch, vect);
     return WriteBatch(batch);
 }
 
@@ -379,10 +1126,60 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CLevelDBBatch batch;
+bool CBlockTreeDB::ReadAddressUnspentIndexPage(uint160 addressHash, int type, int nMinHeight, CAmount nMinAmount,
+                                               unsigned int nMaxOutputs, const CAddressUnspentKey* pkeyAfter,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, bool& fMore) {
+
+    boost::scoped_ptr<CLevelDBIterator> pcursor(NewCursor());
+    fMore = false;
+
+    if (pkeyAfter) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, *pkeyAfter));
+        std::pair<char,CAddressUnspentKey> key;
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX
+            && key.second.hashBytes == pkeyAfter->hashBytes && key.second.type == pkeyAfter->type
+            && key.second.txhash == pkeyAfter->txhash && key.second.index == pkeyAfter->index) {
+            pcursor->Next();
+        }
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    unsigned int nOutputs = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != (unsigned int)type
+            || key.second.hashBytes != addressHash) {
+            break;
+        }
+
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value)) {
+            return error("failed to get address unspent value");
+        }
+        if ((nMinHeight <= 0 || value.blockHeight >= nMinHeight) && (nMinAmount <= 0 || value.satoshis >= nMinAmount)) {
+            if (nOutputs == nMaxOutputs) {
+                fMore = true;
+                break;
+            }
+            nOutputs++;
+            unspentOutputs.push_back(make_pair(key.second, value));
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+static void BatchWriteAddressIndex(CLevelDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+}
+
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+    CLevelDBBatch batch;
+    BatchWriteAddressIndex(batch, vect);
     return WriteBatch(batch);
 }
 
@@ -421,7 +1218,7 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
         boost::this_thread::interruption_point();
         std::pair<char,CAddressIndexKey> key;
         // if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
-        if (GetKey(pcursor->key(), key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
+        if (GetKey(pcursor->key(), key) && key.first == DB_ADDRESSINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
@@ -445,12 +1242,161 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressIndexPage(uint160 addressHash, int type, int start, int end, bool fNewestFirst,
+                                        unsigned int nMaxTransactions, const CAddressIndexKey* pkeyAfter,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool& fMore) {
+
+    boost::scoped_ptr<CLevelDBIterator> pcursor(NewCursor());
+    fMore = false;
+
+    if (pkeyAfter) {
+        if (fNewestFirst) {
+            pcursor->SeekBefore(make_pair(DB_ADDRESSINDEX, *pkeyAfter));
+        } else {
+            pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pkeyAfter));
+            std::pair<char,CAddressIndexKey> key;
+            if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX
+                && key.second.hashBytes == pkeyAfter->hashBytes && key.second.type == pkeyAfter->type
+                && key.second.txhash == pkeyAfter->txhash && key.second.index == pkeyAfter->index
+                && key.second.spending == pkeyAfter->spending) {
+                pcursor->Next();
+            }
+        }
+    } else if (fNewestFirst) {
+        // Heights are big-endian in the key, so everything of the address up to end sorts below end + 1.
+        const int nBefore = (end > 0 && end < std::numeric_limits<int>::max()) ? end + 1 : std::numeric_limits<int>::max();
+        pcursor->SeekBefore(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, nBefore)));
+    } else if (start > 0) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    // Entries of one transaction are adjacent; a page always holds whole transactions.
+    unsigned int nTransactions = 0;
+    uint256 hashLastTx;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != (unsigned int)type
+            || key.second.hashBytes != addressHash) {
+            break;
+        }
+        if ((end > 0 && key.second.blockHeight > end) || (start > 0 && key.second.blockHeight < start)) {
+            break;
+        }
+        if (nTransactions == 0 || key.second.txhash != hashLastTx) {
+            if (nTransactions == nMaxTransactions) {
+                fMore = true;
+                break;
+            }
+            nTransactions++;
+            hashLastTx = key.second.txhash;
+        }
+
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("failed to get address index value");
+        }
+        addressIndex.push_back(make_pair(key.second, nValue));
+
+        if (fNewestFirst) {
+            pcursor->Prev();
+        } else {
+            pcursor->Next();
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalance& balance) {
+    balance.SetNull();
+    if (!Exists(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash))))
+        return true;
+    return Read(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance);
+}
+
+bool CBlockTreeDB::BatchUpdateAddressBalances(CLevelDBBatch& batch, const CAddressBalanceDeltas& deltas) {
+    for (CAddressBalanceDeltas::const_iterator it = deltas.begin(); it != deltas.end(); it++) {
+        CAddressBalance balance;
+        if (!ReadAddressBalance(it->first.hashBytes, it->first.type, balance))
+            return error("failed to read address balance");
+        balance.Add(it->second);
+        if (balance.IsNull()) {
+            batch.Erase(make_pair(DB_ADDRESSBALANCE, it->first));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSBALANCE, it->first), balance);
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::UpdateAddressBalances(const CAddressBalanceDeltas& deltas) {
+    CLevelDBBatch batch;
+    return BatchUpdateAddressBalances(batch, deltas) && WriteBatch(batch);
+}
+
+bool CBlockTreeDB::BuildAddressBalances() {
+    LogPrintf("Building the address balances from the address index...\n");
+
+    boost::scoped_ptr<CLevelDBIterator> pcursor(NewCursor());
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    // The address index is ordered by address, so every address' balance is complete
+    // once the next address shows up. Transactions are adjacent within an address.
+    CLevelDBBatch batch;
+    size_t nBatchEntries = 0;
+    uint64_t nAddresses = 0;
+    CAddressIndexIteratorKey address;
+    CAddressBalance balance;
+    uint256 hashLastTx;
+    bool fHaveAddress = false;
+    for (;; pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        const bool fEntry = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX;
+        if (fHaveAddress && (!fEntry || key.second.type != address.type || key.second.hashBytes != address.hashBytes)) {
+            batch.Write(make_pair(DB_ADDRESSBALANCE, address), balance);
+            nAddresses++;
+            if (++nBatchEntries == ADDRESS_BALANCE_BUILD_BATCH_ENTRIES) {
+                if (!WriteBatch(batch))
+                    return error("failed to write address balances");
+                batch.Clear();
+                nBatchEntries = 0;
+            }
+            fHaveAddress = false;
+        }
+        if (!fEntry)
+            break;
+
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        if (!fHaveAddress) {
+            address = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            balance.SetNull();
+            fHaveAddress = true;
+        } else if (key.second.txhash == hashLastTx) {
+            balance.AddEntry(nValue, 1);
+            continue;
+        }
+        hashLastTx = key.second.txhash;
+        balance.txCount++;
+        balance.AddEntry(nValue, 1);
+    }
+    batch.Write(std::make_pair('F', std::string("addressbalances")), '1');
+    if (!WriteBatch(batch, true))
+        return error("failed to write address balances");
+    LogPrintf("Built the balances of %u addresses\n", (unsigned int)nAddresses);
+    return true;
+}
+
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
     return Read(make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CLevelDBBatch batch;
+static void BatchUpdateSpentIndex(CLevelDBBatch& batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_SPENTINDEX, it->first));
@@ -458,5 +1404,64 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
             batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+    CLevelDBBatch batch;
+    BatchUpdateSpentIndex(batch, vect);
+    return WriteBatch(batch);
+}
+
+static void BatchUpdateVaultIndex(CLevelDBBatch& batch, const std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vect)
+{
+    for (const std::pair<VaultIndexKey, VaultIndexValue>& entry : vect) {
+        if (entry.second.IsNull())
+            batch.Erase(make_pair(DB_VAULTINDEX, entry.first));
+        else
+            batch.Write(make_pair(DB_VAULTINDEX, entry.first), entry.second);
+    }
+}
+
+bool CBlockTreeDB::UpdateVaultIndex(const std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vect)
+{
+    CLevelDBBatch batch;
+    BatchUpdateVaultIndex(batch, vect);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadVaultIndex(VaultIndexRole role, const uint160& keyHash, std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vect)
+{
+    boost::scoped_ptr<CLevelDBIterator> pcursor(NewCursor());
+    pcursor->Seek(make_pair(DB_VAULTINDEX, VaultIndexIteratorKey(role, keyHash)));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, VaultIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_VAULTINDEX || key.second.role != role || key.second.keyHash != keyHash)
+            break;
+        VaultIndexValue value;
+        if (!pcursor->GetValue(value))
+            return error("failed to get vault index value");
+        vect.push_back(make_pair(key.second, value));
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WriteIndexDatabaseUpdates(const IndexDatabaseUpdates& updates, bool fTxIndex, bool fAddressIndex, bool fSpentIndex) {
+    CLevelDBBatch batch;
+    if (fTxIndex)
+        BatchWriteTxIndex(batch, updates.txLocationData);
+    if (fAddressIndex) {
+        BatchWriteAddressIndex(batch, updates.addressIndex);
+        BatchUpdateAddressUnspentIndex(batch, updates.addressUnspentIndex);
+        if (!BatchUpdateAddressBalances(batch, updates.addressBalanceDeltas))
+            return false;
+    }
+    if (fSpentIndex)
+        BatchUpdateSpentIndex(batch, updates.spentIndex);
+    BatchWriteBlockFilters(batch, updates.blockFilters);
+    BatchWriteBlockStats(batch, updates.blockStats);
+    BatchWriteCoinSupplies(batch, updates.coinSupplies);
+    BatchUpdateVaultIndex(batch, updates.vaultIndex);
     return WriteBatch(batch);
 }
@@ -9,18 +9,33 @@
 
 #include "leveldbwrapper.h"
 #include <coins.h>
+#include <RunningCoinsStats.h>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/thread/mutex.hpp>
+
+namespace boost
+{
+class thread_group;
+}
+
 class uint256;
+class BlockFilter;
+class BlockStats;
+class CoinSupply;
+class CAutoFile;
 class CBlockFileInfo;
+class CHashWriter;
 class CDiskBlockIndex;
 
 
+struct CAddressBalance;
 struct CAddressIndexKey;
 struct CAddressIndexIteratorKey;
+struct CAddressIndexIteratorKeyCompare;
 struct CAddressIndexIteratorHeightKey;
 struct CSpentIndexKey;
 struct CAddressUnspentKey;
@@ -29,33 +44,77 @@ struct CDiskTxPos;
 struct CCoinsStats;
 struct CSpentIndexValue;
 struct TxIndexEntry;
+struct IndexDatabaseUpdates;
+struct VaultIndexKey;
+struct VaultIndexValue;
+enum class VaultIndexRole : unsigned char;
 
-/** CCoinsView backed by the LevelDB coin database (chainstate/) */
+/**
+ * CCoinsView backed by the LevelDB coin database (chainstate/). Every unspent output
+ * is stored as its own entry, keyed by its outpoint, so spending one output of a wide
+ * transaction only erases that entry. The outputs of a transaction are adjacent and
+ * read back into one CCoins.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CLevelDBWrapper db;
 
+    //! Guards the running statistics, which the coins writer thread updates
+    mutable boost::mutex csRunningStats;
+    //! Statistics as of the best block, stored alongside it in every batch
+    mutable RunningCoinsStats runningStats;
+    //! False for databases written before the statistics were kept, until a full scan
+    mutable bool fRunningStatsValid;
+
+    bool HaveAnyEntries(char chType) const;
+    //! Upgrade the coins entries to the current layout and encoding if needed and read with it from then on
+    void LoadCoinsFormat();
+    void UpgradeToPerOutputEntries();
+    void UpgradeToCompactScripts();
+    void LoadRunningStats();
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(const CLevelDBTuning& tuning, bool fMemory = false, bool fWipe = false);
+
+    //! Spread the lookups of large GetCoinsBatch calls over nThreads threads, the calling one included
+    static void StartLookupThreads(boost::thread_group& threadGroup, int nThreads);
 
     bool GetCoins(const uint256& txid, CCoins& coins) const;
+    //! Looks the coins up in key order, in parallel once the batch is large enough
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const;
     bool HaveCoins(const uint256& txid) const;
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock);
     bool GetStats(CCoinsStats& stats) const;
+    bool GetRunningStats(CCoinsStats& stats) const;
+    std::shared_ptr<CCoinsView> OpenSnapshot();
+
+    //! Stream all coins into a snapshot file, one entry per transaction, collecting the same statistics as GetStats
+    bool WriteSnapshot(CAutoFile& file, CCoinsStats& stats) const;
+    //! Replace all coins entries by the nCoins entries read from a snapshot file, based on hashBlock
+    bool LoadSnapshot(CAutoFile& file, uint64_t nCoins, const uint256& hashBlock);
+
+    const CLevelDBWrapper& GetDatabase() const { return db; }
 };
 
+/** Add a coins entry to the statistics and UTXO set hash reported by gettxoutsetinfo */
+void UpdateCoinsStats(CHashWriter& ss, const uint256& txid, const CCoins& coins, CCoinsStats& stats);
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CLevelDBWrapper
 {
 public:
     CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CBlockTreeDB(const CLevelDBTuning& tuning, bool fMemory = false, bool fWipe = false);
 
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
 
+    bool BatchUpdateAddressBalances(CLevelDBBatch& batch, const std::map<CAddressIndexIteratorKey, CAddressBalance, CAddressIndexIteratorKeyCompare>& deltas);
+
 public:
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& fileinfo);
@@ -66,20 +125,56 @@ public:
     bool ReadReindexing(bool& fReindex);
     bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
     bool WriteTxIndex(const std::vector<TxIndexEntry>& list);
+    bool WriteBlockFilters(const std::vector<BlockFilter>& filters);
+    bool ReadBlockFilter(const uint256& blockHash, BlockFilter& filter);
+    bool ReadBlockStats(const uint256& blockHash, BlockStats& stats);
+    bool WriteCoinSupplies(const std::vector<CoinSupply>& supplies);
+    bool ReadCoinSupply(const uint256& blockHash, CoinSupply& supply);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
+    /**
+     * Read at most nMaxTransactions transactions' worth of address index entries between heights start and end
+     * (either bound ignored when not positive), oldest or newest first. pkeyAfter, the last entry of a previous
+     * page, continues past it. fMore tells whether entries are left after this page.
+     */
+    bool ReadAddressIndexPage(uint160 addressHash, int type, int start, int end, bool fNewestFirst,
+                              unsigned int nMaxTransactions, const CAddressIndexKey* pkeyAfter,
+                              std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool& fMore);
+    //! Totals of the address' index entries, null if it has none
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalance& balance);
+    bool UpdateAddressBalances(const std::map<CAddressIndexIteratorKey, CAddressBalance, CAddressIndexIteratorKeyCompare>& deltas);
+    //! Sum up the address balances of an address index that was written without them and set the "addressbalances" flag
+    bool BuildAddressBalances();
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
+    //! Write the updates of the enabled indexes for a connected block in a single batch
+    bool WriteIndexDatabaseUpdates(const IndexDatabaseUpdates& updates, bool fTxIndex, bool fAddressIndex, bool fSpentIndex);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    /**
+     * Read at most nMaxOutputs of the address' unspent outputs in index order, that is by txid and output index,
+     * skipping those below height nMinHeight or worth less than nMinAmount (either ignored when not positive).
+     * pkeyAfter, the last output of a previous page, continues past it. fMore tells whether outputs are left
+     * after this page.
+     */
+    bool ReadAddressUnspentIndexPage(uint160 addressHash, int type, int nMinHeight, CAmount nMinAmount,
+                                     unsigned int nMaxOutputs, const CAddressUnspentKey* pkeyAfter,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect, bool& fMore);
+    bool UpdateVaultIndex(const std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vect);
+    //! Read the unspent vault outputs whose script has the key hash in the given role
+    bool ReadVaultIndex(VaultIndexRole role, const uint160& keyHash, std::vector<std::pair<VaultIndexKey, VaultIndexValue> >& vect);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
     bool ReadInt(const std::string& name, int& nValue);
+    //! Last block an index being built in the background has been built up to
+    bool WriteIndexBuildProgress(const std::string& name, const uint256& hashBlock);
+    bool ReadIndexBuildProgress(const std::string& name, uint256& hashBlock);
+    bool EraseIndexBuildProgress(const std::string& name);
     bool LoadBlockIndexGuts();
 };
 
@@ -8,31 +8,57 @@
 
 #include "clientversion.h"
 #include "main.h"
+#include "memusage.h"
+#include "random.h"
 #include "streams.h"
 #include "Logging.h"
 #include "utilmoneystr.h"
+#include "utiltime.h"
 #include "version.h"
+#include <TransactionMemoryUsage.h>
 #include <UtxoCheckingAndUpdating.h>
 #include <chainparams.h>
+#include <BlockPolicyEstimator.h>
 
-#include <boost/circular_buffer.hpp>
-
+#include <algorithm>
+#include <math.h>
+#include <set>
 
 #include "FeeAndPriorityCalculator.h"
 #include <ValidationState.h>
 
 using namespace std;
 
-CTxMemPoolEntry::CTxMemPoolEntry() : nFee(0), nTxSize(0), nModSize(0), nTime(0), dPriority(0.0)
+//! Fee estimate files written before this version hold samples rather than buckets
+static const int FEE_ESTIMATES_FORMAT_VERSION = 2030000;
+
+CTxMemPoolEntry::CTxMemPoolEntry() : nFee(0), nTxSize(0), nModSize(0), nTime(0), dPriority(0.0), nUsageSize(0), feeDelta(0), priorityDelta(0.0),
+                                     nCountWithAncestors(0), nSizeWithAncestors(0), nModFeesWithAncestors(0),
+                                     nCountWithDescendants(0), nSizeWithDescendants(0), nModFeesWithDescendants(0)
 {
     nHeight = MEMPOOL_HEIGHT;
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) : tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight)
+CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight)
+    : CTxMemPoolEntry(MakeTransactionRef(_tx), _nFee, _nTime, _dPriority, _nHeight)
 {
-    nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+}
 
-    nModSize = FeeAndPriorityCalculator::instance().CalculateModifiedSize(tx,nTxSize);
+CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) : tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight)
+{
+    nTxSize = ::GetSerializeSize(*tx, SER_NETWORK, PROTOCOL_VERSION);
+
+    nModSize = FeeAndPriorityCalculator::instance().CalculateModifiedSize(*tx,nTxSize);
+    nUsageSize = memusage::DynamicUsage(tx) + TransactionMemoryUsage(*tx);
+    feeDelta = 0;
+    priorityDelta = 0.0;
+
+    nCountWithAncestors = 1;
+    nSizeWithAncestors = nTxSize;
+    nModFeesWithAncestors = nFee;
+    nCountWithDescendants = 1;
+    nSizeWithDescendants = nTxSize;
+    nModFeesWithDescendants = nFee;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -43,338 +69,102 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
 double
 CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
 {
-    CAmount nValueIn = tx.GetValueOut() + nFee;
+    CAmount nValueIn = tx->GetValueOut() + nFee;
     double deltaPriority = ((double)(currentHeight - nHeight) * nValueIn) / nModSize;
     double dResult = dPriority + deltaPriority;
     return dResult;
 }
 
-/**
- * Keep track of fee/priority for transactions confirmed within N blocks
- */
-class CBlockAverage
+void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
 {
-private:
-    boost::circular_buffer<CFeeRate> feeSamples;
-    boost::circular_buffer<double> prioritySamples;
-
-    template <typename T>
-    std::vector<T> buf2vec(boost::circular_buffer<T> buf) const
-    {
-        std::vector<T> vec(buf.begin(), buf.end());
-        return vec;
-    }
-
-public:
-    CBlockAverage() : feeSamples(100), prioritySamples(100) {}
-
-    void RecordFee(const CFeeRate& feeRate)
-    {
-        feeSamples.push_back(feeRate);
-    }
-
-    void RecordPriority(double priority)
-    {
-        prioritySamples.push_back(priority);
-    }
-
-    size_t FeeSamples() const { return feeSamples.size(); }
-    size_t GetFeeSamples(std::vector<CFeeRate>& insertInto) const
-    {
-        BOOST_FOREACH (const CFeeRate& f, feeSamples)
-            insertInto.push_back(f);
-        return feeSamples.size();
-    }
-    size_t PrioritySamples() const { return prioritySamples.size(); }
-    size_t GetPrioritySamples(std::vector<double>& insertInto) const
-    {
-        BOOST_FOREACH (double d, prioritySamples)
-            insertInto.push_back(d);
-        return prioritySamples.size();
-    }
-
-    /**
-     * Used as belt-and-suspenders check when reading to detect
-     * file corruption
-     */
-    static bool AreSane(const CFeeRate fee, const CFeeRate& minRelayFee)
-    {
-        if (fee < CFeeRate(0))
-            return false;
-        if (fee.GetFeePerK() > minRelayFee.GetFeePerK() * 10000)
-            return false;
-        return true;
-    }
-    static bool AreSane(const std::vector<CFeeRate>& vecFee, const CFeeRate& minRelayFee)
-    {
-        BOOST_FOREACH (CFeeRate fee, vecFee) {
-            if (!AreSane(fee, minRelayFee))
-                return false;
-        }
-        return true;
-    }
-    static bool AreSane(const double priority)
-    {
-        return priority >= 0;
-    }
-    static bool AreSane(const std::vector<double> vecPriority)
-    {
-        BOOST_FOREACH (double priority, vecPriority) {
-            if (!AreSane(priority))
-                return false;
-        }
-        return true;
-    }
-
-    void Write(CAutoFile& fileout) const
-    {
-        std::vector<CFeeRate> vecFee = buf2vec(feeSamples);
-        fileout << vecFee;
-        std::vector<double> vecPriority = buf2vec(prioritySamples);
-        fileout << vecPriority;
-    }
-
-    void Read(CAutoFile& filein, const CFeeRate& minRelayFee)
-    {
-        std::vector<CFeeRate> vecFee;
-        filein >> vecFee;
-        if (AreSane(vecFee, minRelayFee))
-            feeSamples.insert(feeSamples.end(), vecFee.begin(), vecFee.end());
-        else
-            throw runtime_error("Corrupt fee value in estimates file.");
-        std::vector<double> vecPriority;
-        filein >> vecPriority;
-        if (AreSane(vecPriority))
-            prioritySamples.insert(prioritySamples.end(), vecPriority.begin(), vecPriority.end());
-        else
-            throw runtime_error("Corrupt priority value in estimates file.");
-        if (feeSamples.size() + prioritySamples.size() > 0)
-            LogPrint("estimatefee", "Read %d fee samples and %d priority samples\n",
-                feeSamples.size(), prioritySamples.size());
-    }
-};
-
-class CMinerPolicyEstimator
-{
-private:
-    /**
-     * Records observed averages transactions that confirmed within one block, two blocks,
-     * three blocks etc.
-     */
-    std::vector<CBlockAverage> history;
-    std::vector<CFeeRate> sortedFeeSamples;
-    std::vector<double> sortedPrioritySamples;
-
-    int nBestSeenHeight;
-
-    /**
-     * nBlocksAgo is 0 based, i.e. transactions that confirmed in the highest seen block are
-     * nBlocksAgo == 0, transactions in the block before that are nBlocksAgo == 1 etc.
-     */
-    void seenTxConfirm(const CFeeRate& feeRate, const CFeeRate& minRelayFee, double dPriority, int nBlocksAgo)
-    {
-        // Last entry records "everything else".
-        int nBlocksTruncated = min(nBlocksAgo, (int)history.size() - 1);
-        assert(nBlocksTruncated >= 0);
-
-        // We need to guess why the transaction was included in a block-- either
-        // because it is high-priority or because it has sufficient fees.
-        bool sufficientFee = (feeRate > minRelayFee);
-        bool sufficientPriority = AllowFree(dPriority);
-        const char* assignedTo = "unassigned";
-        if (sufficientFee && !sufficientPriority && CBlockAverage::AreSane(feeRate, minRelayFee)) {
-            history[nBlocksTruncated].RecordFee(feeRate);
-            assignedTo = "fee";
-        } else if (sufficientPriority && !sufficientFee && CBlockAverage::AreSane(dPriority)) {
-            history[nBlocksTruncated].RecordPriority(dPriority);
-            assignedTo = "priority";
-        } else {
-            // Neither or both fee and priority sufficient to get confirmed:
-            // don't know why they got confirmed.
-        }
-        LogPrint("estimatefee", "Seen TX confirm: %s : %s fee/%g priority, took %d blocks\n",
-            assignedTo, feeRate, dPriority, nBlocksAgo);
-    }
-
-public:
-    CMinerPolicyEstimator(int nEntries) : nBestSeenHeight(0)
-    {
-        history.resize(nEntries);
-    }
-
-    void seenBlock(const std::vector<CTxMemPoolEntry>& entries, int nBlockHeight, const CFeeRate minRelayFee)
-    {
-        if (nBlockHeight <= nBestSeenHeight) {
-            // Ignore side chains and re-orgs; assuming they are random
-            // they don't affect the estimate.
-            // And if an attacker can re-org the chain at will, then
-            // you've got much bigger problems than "attacker can influence
-            // transaction fees."
-            return;
-        }
-        nBestSeenHeight = nBlockHeight;
-
-        // Fill up the history buckets based on how long transactions took
-        // to confirm.
-        std::vector<std::vector<const CTxMemPoolEntry*> > entriesByConfirmations;
-        entriesByConfirmations.resize(history.size());
-        BOOST_FOREACH (const CTxMemPoolEntry& entry, entries) {
-            // How many blocks did it take for miners to include this transaction?
-            int delta = nBlockHeight - entry.GetHeight();
-            if (delta <= 0) {
-                // Re-org made us lose height, this should only happen if we happen
-                // to re-org on a difficulty transition point: very rare!
-                continue;
-            }
-            if ((delta - 1) >= (int)history.size())
-                delta = history.size(); // Last bucket is catch-all
-            entriesByConfirmations.at(delta - 1).push_back(&entry);
-        }
-        for (size_t i = 0; i < entriesByConfirmations.size(); i++) {
-            std::vector<const CTxMemPoolEntry*>& e = entriesByConfirmations.at(i);
-            // Insert at most 10 random entries per bucket, otherwise a single block
-            // can dominate an estimate:
-            if (e.size() > 10) {
-                std::random_shuffle(e.begin(), e.end());
-                e.resize(10);
-            }
-            BOOST_FOREACH (const CTxMemPoolEntry* entry, e) {
-                // Fees are stored and reported as IZZY-per-kb:
-                CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
-                double dPriority = entry->GetPriority(entry->GetHeight()); // Want priority when it went IN
-                seenTxConfirm(feeRate, minRelayFee, dPriority, i);
-            }
-        }
-
-        //After new samples are added, we have to clear the sorted lists,
-        //so they'll be resorted the next time someone asks for an estimate
-        sortedFeeSamples.clear();
-        sortedPrioritySamples.clear();
-
-        for (size_t i = 0; i < history.size(); i++) {
-            if (history[i].FeeSamples() + history[i].PrioritySamples() > 0)
-                LogPrint("estimatefee", "estimates: for confirming within %d blocks based on %d/%d samples, fee=%s, prio=%g\n",
-                    i,
-                    history[i].FeeSamples(), history[i].PrioritySamples(),
-                    estimateFee(i + 1), estimatePriority(i + 1));
-        }
-    }
-
-    /**
-     * Can return CFeeRate(0) if we don't have any data for that many blocks back. nBlocksToConfirm is 1 based.
-     */
-    CFeeRate estimateFee(int nBlocksToConfirm)
-    {
-        nBlocksToConfirm--;
-
-        if (nBlocksToConfirm < 0 || nBlocksToConfirm >= (int)history.size())
-            return CFeeRate(0);
+    nSizeWithAncestors += modifySize;
+    nModFeesWithAncestors += modifyFee;
+    nCountWithAncestors += modifyCount;
+}
 
-        if (sortedFeeSamples.size() == 0) {
-            for (size_t i = 0; i < history.size(); i++)
-                history.at(i).GetFeeSamples(sortedFeeSamples);
-            std::sort(sortedFeeSamples.begin(), sortedFeeSamples.end(),
-                std::greater<CFeeRate>());
-        }
-        if (sortedFeeSamples.size() < 11) {
-            // Eleven is Gavin's Favorite Number
-            // ... but we also take a maximum of 10 samples per block so eleven means
-            // we're getting samples from at least two different blocks
-            return CFeeRate(0);
-        }
+void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithDescendants += modifySize;
+    nModFeesWithDescendants += modifyFee;
+    nCountWithDescendants += modifyCount;
+}
 
-        int nBucketSize = history.at(nBlocksToConfirm).FeeSamples();
+void CTxMemPoolEntry::UpdateFeeDelta(CAmount newFeeDelta)
+{
+    nModFeesWithAncestors += newFeeDelta - feeDelta;
+    nModFeesWithDescendants += newFeeDelta - feeDelta;
+    feeDelta = newFeeDelta;
+}
 
-        // Estimates should not increase as number of confirmations goes up,
-        // but the estimates are noisy because confirmations happen discretely
-        // in blocks. To smooth out the estimates, use all samples in the history
-        // and use the nth highest where n is (number of samples in previous bucket +
-        // half the samples in nBlocksToConfirm bucket):
-        size_t nPrevSize = 0;
-        for (int i = 0; i < nBlocksToConfirm; i++)
-            nPrevSize += history.at(i).FeeSamples();
-        size_t index = min(nPrevSize + nBucketSize / 2, sortedFeeSamples.size() - 1);
-        return sortedFeeSamples[index];
+bool CompareTxMemPoolEntryByDescendantScore::operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const
+{
+    // Fee rates are compared by cross multiplying fees and sizes
+    double aFees = a->GetModifiedFee();
+    double aSize = a->GetTxSize();
+    if ((double)a->GetModFeesWithDescendants() * aSize > aFees * a->GetSizeWithDescendants()) {
+        aFees = a->GetModFeesWithDescendants();
+        aSize = a->GetSizeWithDescendants();
     }
-    double estimatePriority(int nBlocksToConfirm)
-    {
-        nBlocksToConfirm--;
-
-        if (nBlocksToConfirm < 0 || nBlocksToConfirm >= (int)history.size())
-            return -1;
-
-        if (sortedPrioritySamples.size() == 0) {
-            for (size_t i = 0; i < history.size(); i++)
-                history.at(i).GetPrioritySamples(sortedPrioritySamples);
-            std::sort(sortedPrioritySamples.begin(), sortedPrioritySamples.end(),
-                std::greater<double>());
-        }
-        if (sortedPrioritySamples.size() < 11)
-            return -1.0;
-
-        int nBucketSize = history.at(nBlocksToConfirm).PrioritySamples();
-
-        // Estimates should not increase as number of confirmations needed goes up,
-        // but the estimates are noisy because confirmations happen discretely
-        // in blocks. To smooth out the estimates, use all samples in the history
-        // and use the nth highest where n is (number of samples in previous buckets +
-        // half the samples in nBlocksToConfirm bucket).
-        size_t nPrevSize = 0;
-        for (int i = 0; i < nBlocksToConfirm; i++)
-            nPrevSize += history.at(i).PrioritySamples();
-        size_t index = min(nPrevSize + nBucketSize / 2, sortedPrioritySamples.size() - 1);
-        return sortedPrioritySamples[index];
+    double bFees = b->GetModifiedFee();
+    double bSize = b->GetTxSize();
+    if ((double)b->GetModFeesWithDescendants() * bSize > bFees * b->GetSizeWithDescendants()) {
+        bFees = b->GetModFeesWithDescendants();
+        bSize = b->GetSizeWithDescendants();
     }
 
-    void Write(CAutoFile& fileout) const
-    {
-        fileout << nBestSeenHeight;
-        fileout << history.size();
-        BOOST_FOREACH (const CBlockAverage& entry, history) {
-            entry.Write(fileout);
-        }
-    }
+    const double f1 = aFees * bSize;
+    const double f2 = bFees * aSize;
+    if (f1 != f2)
+        return f1 < f2;
+    if (a->GetTime() != b->GetTime())
+        return a->GetTime() > b->GetTime();
+    return a->GetTx().GetHash() < b->GetTx().GetHash();
+}
 
-    void Read(CAutoFile& filein, const CFeeRate& minRelayFee)
-    {
-        int nFileBestSeenHeight;
-        filein >> nFileBestSeenHeight;
-        size_t numEntries;
-        filein >> numEntries;
-        if (numEntries <= 0 || numEntries > 10000)
-            throw runtime_error("Corrupt estimates file. Must have between 1 and 10k entries.");
-
-        std::vector<CBlockAverage> fileHistory;
-
-        for (size_t i = 0; i < numEntries; i++) {
-            CBlockAverage entry;
-            entry.Read(filein, minRelayFee);
-            fileHistory.push_back(entry);
-        }
+bool CompareTxMemPoolEntryByAncestorScore::operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const
+{
+    const double f1 = (double)a->GetModFeesWithAncestors() * b->GetSizeWithAncestors();
+    const double f2 = (double)b->GetModFeesWithAncestors() * a->GetSizeWithAncestors();
+    if (f1 != f2)
+        return f1 > f2;
+    return a->GetTx().GetHash() < b->GetTx().GetHash();
+}
 
-        // Now that we've processed the entire fee estimate data file and not
-        // thrown any errors, we can copy it to our history
-        nBestSeenHeight = nFileBestSeenHeight;
-        history = fileHistory;
-        assert(history.size() > 0);
-    }
-};
+bool CompareTxMemPoolEntryByFeeRate::operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const
+{
+    const CFeeRate aFeeRate(a->GetModifiedFee(), a->GetTxSize());
+    const CFeeRate bFeeRate(b->GetModifiedFee(), b->GetTxSize());
+    if (!(aFeeRate == bFeeRate))
+        return aFeeRate > bFeeRate;
+    return a->GetTx().GetHash() < b->GetTx().GetHash();
+}
 
+bool CompareTxMemPoolEntryByPriority::operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const
+{
+    const double aPriority = a->GetModifiedPriority(nHeight);
+    const double bPriority = b->GetModifiedPriority(nHeight);
+    if (aPriority != bPriority)
+        return aPriority > bPriority;
+    return a->GetTx().GetHash() < b->GetTx().GetHash();
+}
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) : nTransactionsUpdated(0),
-                                                       minRelayFee(_minRelayFee)
+                                                       minRelayFee(_minRelayFee),
+                                                       totalTxSize(0),
+                                                       cachedInnerUsage(0),
+                                                       setFeeRateOrder(),
+                                                       setPriorityOrder(CompareTxMemPoolEntryByPriority(0)),
+                                                       nPriorityOrderHeight(0),
+                                                       lastRollingFeeUpdate(GetTime()),
+                                                       blockSinceLastRollingFeeBump(false),
+                                                       rollingMinimumFeeRate(0)
 {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
-    fSanityCheck = false;
+    nCheckRatio = 0;
 
-    // 25 blocks is a compromise between using a lot of disk/memory and
-    // trying to give accurate estimates to people who might be willing
-    // to wait a day or two to save a fraction of a penny in fees.
-    // Confirmation times for very-low-fee transactions that take more
-    // than an hour or three to confirm are highly variable.
-    minerPolicyEstimator = new CMinerPolicyEstimator(25);
+    minerPolicyEstimator = new BlockPolicyEstimator(_minRelayFee);
 }
 
 CTxMemPool::~CTxMemPool()
@@ -415,40 +205,212 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry)
     // all the appropriate checks.
     LOCK(cs);
     {
-        mapTx[hash] = entry;
-        const auto* entryInMap = &mapTx[hash];
+        auto* entryInMap = &(mapTx[hash] = entry);
         const CTransaction& tx = entryInMap->GetTx();
         mapBareTxid.emplace(tx.GetBareTxid(), entryInMap);
         for (unsigned int i = 0; i < tx.vin.size(); i++)
             mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
+        double dPriorityDelta = 0;
+        CAmount nFeeDelta = 0;
+        ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
+        entryInMap->UpdateFeeDelta(nFeeDelta);
+        entryInMap->UpdatePriorityDelta(dPriorityDelta);
+        UpdateForNewEntry(hash);
+        setFeeRateOrder.insert(entryInMap);
+        setPriorityOrder.insert(entryInMap);
+        minerPolicyEstimator->ProcessTransaction(*entryInMap);
         nTransactionsUpdated++;
         totalTxSize += entry.GetTxSize();
+        cachedInnerUsage += entry.DynamicMemoryUsage();
     }
     return true;
 }
 
+void CTxMemPool::CalculateAncestors(const CTransaction& tx, std::set<uint256>& ancestors) const
+{
+    ancestors.clear();
+    std::vector<const CTransaction*> toVisit(1, &tx);
+    while (!toVisit.empty()) {
+        const CTransaction* visiting = toVisit.back();
+        toVisit.pop_back();
+        for (const auto& txin : visiting->vin) {
+            std::map<uint256, CTxMemPoolEntry>::const_iterator parent = mapTx.find(txin.prevout.hash);
+            if (parent != mapTx.end() && ancestors.insert(parent->first).second)
+                toVisit.push_back(&parent->second.GetTx());
+        }
+    }
+}
+
+void CTxMemPool::CalculateDescendants(const uint256& hash, std::set<uint256>& descendants) const
+{
+    descendants.clear();
+    std::vector<uint256> toVisit(1, hash);
+    while (!toVisit.empty()) {
+        const uint256 visiting = toVisit.back();
+        toVisit.pop_back();
+        std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.lower_bound(COutPoint(visiting, 0));
+        for (; it != mapNextTx.end() && it->first.hash == visiting; ++it) {
+            const uint256& child = it->second.ptx->GetHash();
+            if (descendants.insert(child).second)
+                toVisit.push_back(child);
+        }
+    }
+}
+
+bool CTxMemPool::CheckChainLimits(const CTransaction& tx, size_t nSize, uint64_t nLimitAncestors, uint64_t nLimitAncestorSize, uint64_t nLimitDescendants, uint64_t nLimitDescendantSize, std::string& errString) const
+{
+    // Every entry already in the pool is within the limits, so walking the ancestors stays bounded
+    std::set<uint256> ancestors;
+    CalculateAncestors(tx, ancestors);
+    if (ancestors.size() + 1 > nLimitAncestors) {
+        errString = strprintf("too many unconfirmed ancestors [limit: %u]", nLimitAncestors);
+        return false;
+    }
+    uint64_t nSizeWithAncestors = nSize;
+    for (const uint256& ancestor : ancestors) {
+        const CTxMemPoolEntry& entry = mapTx.find(ancestor)->second;
+        nSizeWithAncestors += entry.GetTxSize();
+        if (entry.GetCountWithDescendants() + 1 > nLimitDescendants) {
+            errString = strprintf("too many descendants for tx %s [limit: %u]", ancestor.ToString(), nLimitDescendants);
+            return false;
+        }
+        if (entry.GetSizeWithDescendants() + nSize > nLimitDescendantSize) {
+            errString = strprintf("exceeds descendant size limit for tx %s [limit: %u]", ancestor.ToString(), nLimitDescendantSize);
+            return false;
+        }
+    }
+    if (nSizeWithAncestors > nLimitAncestorSize) {
+        errString = strprintf("exceeds ancestor size limit [limit: %u]", nLimitAncestorSize);
+        return false;
+    }
+    return true;
+}
+
+void CTxMemPool::UpdateDescendantState(CTxMemPoolEntry& entry, int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    setDescendantScore.erase(&entry);
+    entry.UpdateDescendantState(modifySize, modifyFee, modifyCount);
+    setDescendantScore.insert(&entry);
+}
+
+void CTxMemPool::UpdateAncestorState(CTxMemPoolEntry& entry, int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    setAncestorScore.erase(&entry);
+    entry.UpdateAncestorState(modifySize, modifyFee, modifyCount);
+    setAncestorScore.insert(&entry);
+}
+
+void CTxMemPool::RecalculateRelativeState(const uint256& hash)
+{
+    CTxMemPoolEntry& entry = mapTx[hash];
+    std::set<uint256> relatives;
+
+    CalculateAncestors(entry.GetTx(), relatives);
+    int64_t nSize = entry.GetTxSize();
+    CAmount nModFees = entry.GetModifiedFee();
+    for (const uint256& ancestor : relatives) {
+        nSize += mapTx[ancestor].GetTxSize();
+        nModFees += mapTx[ancestor].GetModifiedFee();
+    }
+    UpdateAncestorState(entry, nSize - entry.GetSizeWithAncestors(), nModFees - entry.GetModFeesWithAncestors(),
+        (int64_t)relatives.size() + 1 - entry.GetCountWithAncestors());
+
+    CalculateDescendants(hash, relatives);
+    nSize = entry.GetTxSize();
+    nModFees = entry.GetModifiedFee();
+    for (const uint256& descendant : relatives) {
+        nSize += mapTx[descendant].GetTxSize();
+        nModFees += mapTx[descendant].GetModifiedFee();
+    }
+    UpdateDescendantState(entry, nSize - entry.GetSizeWithDescendants(), nModFees - entry.GetModFeesWithDescendants(),
+        (int64_t)relatives.size() + 1 - entry.GetCountWithDescendants());
+}
+
+void CTxMemPool::UpdateForNewEntry(const uint256& hash)
+{
+    CTxMemPoolEntry& entry = mapTx[hash];
+    setDescendantScore.insert(&entry);
+    setAncestorScore.insert(&entry);
+
+    std::set<uint256> descendants;
+    CalculateDescendants(hash, descendants);
+    if (!descendants.empty()) {
+        // Only transactions put back from a disconnected block find their children waiting in the
+        // pool. The relatives of those children may already count some of each other, so everything
+        // around the new entry is counted again from scratch.
+        std::set<uint256> affected(descendants);
+        affected.insert(hash);
+        for (const uint256& descendant : descendants) {
+            std::set<uint256> ancestors;
+            CalculateAncestors(mapTx[descendant].GetTx(), ancestors);
+            affected.insert(ancestors.begin(), ancestors.end());
+        }
+        for (const uint256& relative : affected)
+            RecalculateRelativeState(relative);
+        return;
+    }
+
+    std::set<uint256> ancestors;
+    CalculateAncestors(entry.GetTx(), ancestors);
+    for (const uint256& ancestorHash : ancestors) {
+        CTxMemPoolEntry& ancestor = mapTx[ancestorHash];
+        UpdateAncestorState(entry, ancestor.GetTxSize(), ancestor.GetModifiedFee(), 1);
+        UpdateDescendantState(ancestor, entry.GetTxSize(), entry.GetModifiedFee(), 1);
+    }
+}
+
+void CTxMemPool::UpdateForRemoval(const std::set<uint256>& hashesToRemove, std::set<uint256>& hashesToRecalculate)
+{
+    // Relatives are looked up before anything is erased, as a removed transaction may be what
+    // connects a remaining one to another removed one
+    for (const uint256& hash : hashesToRemove) {
+        const CTxMemPoolEntry& removing = mapTx[hash];
+        std::set<uint256> relatives;
+        std::set<uint256> remainingAncestors;
+        CalculateAncestors(removing.GetTx(), relatives);
+        for (const uint256& ancestor : relatives) {
+            if (hashesToRemove.count(ancestor))
+                continue;
+            UpdateDescendantState(mapTx[ancestor], -(int64_t)removing.GetTxSize(), -removing.GetModifiedFee(), -1);
+            remainingAncestors.insert(ancestor);
+        }
+        std::set<uint256> remainingDescendants;
+        CalculateDescendants(hash, relatives);
+        for (const uint256& descendant : relatives) {
+            if (hashesToRemove.count(descendant))
+                continue;
+            UpdateAncestorState(mapTx[descendant], -(int64_t)removing.GetTxSize(), -removing.GetModifiedFee(), -1);
+            remainingDescendants.insert(descendant);
+        }
+        // Taking a transaction out from between others without its descendants may also part
+        // those from its ancestors, which only counting them again after the removal tells
+        if (!remainingAncestors.empty() && !remainingDescendants.empty()) {
+            hashesToRecalculate.insert(remainingAncestors.begin(), remainingAncestors.end());
+            hashesToRecalculate.insert(remainingDescendants.begin(), remainingDescendants.end());
+        }
+    }
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
 
     uint256 txhash = tx.GetHash();
+    if (addressIndex.HasTransaction(txhash))
+        return;
+
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
-        const CTxIn input = tx.vin[j];
+        const CTxIn& input = tx.vin[j];
         const CTxOut &prevout = view.GetOutputFor(input);
         if (prevout.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            addressIndex.Add(key, CMempoolAddressDelta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n));
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            addressIndex.Add(key, CMempoolAddressDelta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n));
         }
     }
 
@@ -457,18 +419,13 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addressIndex.Add(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addressIndex.Add(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         }
     }
-
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
@@ -476,11 +433,7 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
+        addressIndex.GetAddressDeltas((*it).first, (*it).second, results);
     }
     return true;
 }
@@ -488,16 +441,7 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 {
     LOCK(cs);
-    addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
-
-    if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
-        }
-        mapAddressInserted.erase(it);
-    }
-
+    addressIndex.RemoveTransaction(txhash);
     return true;
 }
 
@@ -507,6 +451,7 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
 
     const CTransaction& tx = entry.GetTx();
     std::vector<CSpentIndexKey> inserted;
+    inserted.reserve(tx.vin.size());
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -556,8 +501,8 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
     mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
 
     if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
+        const std::vector<CSpentIndexKey>& keys = (*it).second;
+        for (std::vector<CSpentIndexKey>::const_iterator mit = keys.begin(); mit != keys.end(); mit++) {
             mapSpent.erase(*mit);
         }
         mapSpentInserted.erase(it);
@@ -585,11 +530,14 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
                 txToRemove.push_back(it->second.ptx->GetHash());
             }
         }
+        std::vector<uint256> hashesInOrder;
+        std::set<uint256> hashesToRemove;
         while (!txToRemove.empty()) {
             const uint256 hash = txToRemove.front();
             txToRemove.pop_front();
-            if (!mapTx.count(hash))
+            if (!mapTx.count(hash) || !hashesToRemove.insert(hash).second)
                 continue;
+            hashesInOrder.push_back(hash);
             const CTransaction& tx = mapTx[hash].GetTx();
             if (fRecursive) {
                 for (unsigned int i = 0; i < tx.vout.size(); i++) {
@@ -599,15 +547,31 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
                     txToRemove.push_back(it->second.ptx->GetHash());
                 }
             }
+        }
+        std::set<uint256> hashesToRecalculate;
+        UpdateForRemoval(hashesToRemove, hashesToRecalculate);
+        for (const uint256& hash : hashesInOrder) {
+            std::map<uint256, CTxMemPoolEntry>::iterator entry = mapTx.find(hash);
+            const CTransaction& tx = entry->second.GetTx();
             mapBareTxid.erase(tx.GetBareTxid());
             for (const auto& txin : tx.vin)
                 mapNextTx.erase(txin.prevout);
+            removeAddressIndex(hash);
+            removeSpentIndex(hash);
 
             removed.push_back(tx);
-            totalTxSize -= mapTx[hash].GetTxSize();
-            mapTx.erase(hash);
+            totalTxSize -= entry->second.GetTxSize();
+            cachedInnerUsage -= entry->second.DynamicMemoryUsage();
+            setDescendantScore.erase(&entry->second);
+            setAncestorScore.erase(&entry->second);
+            setFeeRateOrder.erase(&entry->second);
+            setPriorityOrder.erase(&entry->second);
+            minerPolicyEstimator->RemoveTx(hash);
+            mapTx.erase(entry);
             nTransactionsUpdated++;
         }
+        for (const uint256& hash : hashesToRecalculate)
+            RecalculateRelativeState(hash);
     }
 }
 
@@ -619,11 +583,10 @@ void CTxMemPool::removeCoinbaseSpends(const CCoinsViewCache* pcoins, unsigned in
     for (const auto& entry : mapTx) {
         const CTransaction& tx = entry.second.GetTx();
         for (const auto& txin : tx.vin) {
-            CTransaction tx2;
-            if (lookup(txin.prevout.hash, tx2))
+            if (mapTx.count(txin.prevout.hash))
                 continue;
             const CCoins* coins = pcoins->AccessCoins(txin.prevout.hash);
-            if (fSanityCheck) assert(coins);
+            if (nCheckRatio != 0) assert(coins);
             if (!coins || ((coins->IsCoinBase() || coins->IsCoinStake()) && nMemPoolHeight - coins->nHeight < (unsigned)Params().COINBASE_MATURITY())) {
                 transactionsToRemove.push_back(tx);
                 break;
@@ -664,34 +627,135 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
         if (mapTx.count(hash))
             entries.push_back(mapTx[hash]);
     }
-    minerPolicyEstimator->seenBlock(entries, nBlockHeight, minRelayFee);
+    minerPolicyEstimator->ProcessBlock(nBlockHeight, entries);
     BOOST_FOREACH (const CTransaction& tx, vtx) {
         std::list<CTransaction> dummy;
         remove(tx, dummy, false);
         removeConflicts(tx, conflicts);
         ClearPrioritisation(tx.GetHash());
     }
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = true;
 }
 
 
 void CTxMemPool::clear()
 {
     LOCK(cs);
+    for (const std::pair<const uint256, CTxMemPoolEntry>& entry : mapTx)
+        minerPolicyEstimator->RemoveTx(entry.first);
     mapTx.clear();
     mapNextTx.clear();
     mapBareTxid.clear();
+    addressIndex.Clear();
+    mapSpent.clear();
+    mapSpentInserted.clear();
+    setDescendantScore.clear();
+    setAncestorScore.clear();
+    setFeeRateOrder.clear();
+    setPriorityOrder.clear();
     totalTxSize = 0;
+    cachedInnerUsage = 0;
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = false;
+    rollingMinimumFeeRate = 0;
     ++nTransactionsUpdated;
 }
 
+const CTxMemPool::setEntriesByPriority& CTxMemPool::GetPriorityOrder(unsigned int nHeight)
+{
+    AssertLockHeld(cs);
+    if (nHeight != nPriorityOrderHeight) {
+        setEntriesByPriority reordered((CompareTxMemPoolEntryByPriority(nHeight)));
+        reordered.insert(setPriorityOrder.begin(), setPriorityOrder.end());
+        setPriorityOrder.swap(reordered);
+        nPriorityOrderHeight = nHeight;
+    }
+    return setPriorityOrder;
+}
+
+size_t CTxMemPool::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    return memusage::DynamicUsage(mapTx) + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapBareTxid) +
+           memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(setDescendantScore) +
+           memusage::DynamicUsage(setAncestorScore) +
+           memusage::DynamicUsage(setFeeRateOrder) + memusage::DynamicUsage(setPriorityOrder) +
+           memusage::DynamicUsage(mapSpent) + memusage::DynamicUsage(mapSpentInserted) +
+           addressIndex.DynamicMemoryUsage() + cachedInnerUsage;
+}
+
+CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const
+{
+    LOCK(cs);
+    if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
+        return CFeeRate((CAmount)rollingMinimumFeeRate);
+
+    const int64_t time = GetTime();
+    if (time > lastRollingFeeUpdate + 10) {
+        double halflife = ROLLING_FEE_HALFLIFE;
+        const size_t usage = DynamicMemoryUsage();
+        if (usage < sizelimit / 4)
+            halflife /= 4;
+        else if (usage < sizelimit / 2)
+            halflife /= 2;
+
+        rollingMinimumFeeRate = rollingMinimumFeeRate / pow(2.0, (time - lastRollingFeeUpdate) / halflife);
+        lastRollingFeeUpdate = time;
+
+        if (rollingMinimumFeeRate < minRelayFee.GetFeePerK() / 2) {
+            rollingMinimumFeeRate = 0;
+            return CFeeRate(0);
+        }
+    }
+    return std::max(CFeeRate((CAmount)rollingMinimumFeeRate), minRelayFee);
+}
+
+void CTxMemPool::TrackPackageRemoved(const CFeeRate& rate)
+{
+    AssertLockHeld(cs);
+    if (rate.GetFeePerK() > rollingMinimumFeeRate) {
+        rollingMinimumFeeRate = rate.GetFeePerK();
+        blockSinceLastRollingFeeBump = false;
+    }
+}
+
+unsigned int CTxMemPool::TrimToSize(size_t sizelimit)
+{
+    LOCK(cs);
+    unsigned int nEvicted = 0;
+    CFeeRate maxFeeRateRemoved(0);
+    while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
+        const CTxMemPoolEntry* worst = *setDescendantScore.begin();
+
+        // Whatever comes in next has to pay more than the package going out, or evicting it
+        // would only make room for something no better
+        const CFeeRate packageFeeRate(worst->GetModFeesWithDescendants(), worst->GetSizeWithDescendants());
+        const CFeeRate removedFeeRate(packageFeeRate.GetFeePerK() + minRelayFee.GetFeePerK());
+        TrackPackageRemoved(removedFeeRate);
+        maxFeeRateRemoved = std::max(maxFeeRateRemoved, removedFeeRate);
+
+        const CTransaction tx = worst->GetTx();
+        std::list<CTransaction> removed;
+        remove(tx, removed, true);
+        nEvicted += removed.size();
+    }
+    if (nEvicted > 0)
+        LogPrint(LOG_MEMPOOL, "Evicted %u transactions from the mempool, minimum fee raised to %s\n", nEvicted, maxFeeRateRemoved);
+    return nEvicted;
+}
+
 void CTxMemPool::check(const CCoinsViewCache* pcoins) const
 {
-    if (!fSanityCheck)
+    if (nCheckRatio == 0)
+        return;
+    if (nCheckRatio > 1 && GetRand(nCheckRatio) != 0)
         return;
 
-    LogPrint("mempool", "Checking mempool with %u transactions and %u inputs\n", (unsigned int)mapTx.size(), (unsigned int)mapNextTx.size());
+    LogPrint(LOG_MEMPOOL, "Checking mempool with %u transactions and %u inputs\n", (unsigned int)mapTx.size(), (unsigned int)mapNextTx.size());
 
     uint64_t checkTotal = 0;
+    uint64_t innerUsage = 0;
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(pcoins));
 
@@ -700,7 +764,34 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
     for (const auto& entry : mapTx) {
         unsigned int i = 0;
         checkTotal += entry.second.GetTxSize();
+        innerUsage += entry.second.DynamicMemoryUsage();
         const CTransaction& tx = entry.second.GetTx();
+        // Check the totals kept over the transaction's relatives.
+        std::set<uint256> relatives;
+        CalculateAncestors(tx, relatives);
+        uint64_t nSizeWithRelatives = entry.second.GetTxSize();
+        CAmount nModFeesWithRelatives = entry.second.GetModifiedFee();
+        for (const uint256& ancestor : relatives) {
+            nSizeWithRelatives += mapTx.find(ancestor)->second.GetTxSize();
+            nModFeesWithRelatives += mapTx.find(ancestor)->second.GetModifiedFee();
+        }
+        assert(entry.second.GetCountWithAncestors() == relatives.size() + 1);
+        assert(entry.second.GetSizeWithAncestors() == nSizeWithRelatives);
+        assert(entry.second.GetModFeesWithAncestors() == nModFeesWithRelatives);
+        CalculateDescendants(entry.first, relatives);
+        nSizeWithRelatives = entry.second.GetTxSize();
+        nModFeesWithRelatives = entry.second.GetModifiedFee();
+        for (const uint256& descendant : relatives) {
+            nSizeWithRelatives += mapTx.find(descendant)->second.GetTxSize();
+            nModFeesWithRelatives += mapTx.find(descendant)->second.GetModifiedFee();
+        }
+        assert(entry.second.GetCountWithDescendants() == relatives.size() + 1);
+        assert(entry.second.GetSizeWithDescendants() == nSizeWithRelatives);
+        assert(entry.second.GetModFeesWithDescendants() == nModFeesWithRelatives);
+        assert(setDescendantScore.count(&entry.second));
+        assert(setAncestorScore.count(&entry.second));
+        assert(setFeeRateOrder.count(&entry.second));
+        assert(setPriorityOrder.count(&entry.second));
         bool fDependsWait = false;
         for (const auto& txin : tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
@@ -755,6 +846,11 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
     }
 
     assert(totalTxSize == checkTotal);
+    assert(cachedInnerUsage == innerUsage);
+    assert(setDescendantScore.size() == mapTx.size());
+    assert(setAncestorScore.size() == mapTx.size());
+    assert(setFeeRateOrder.size() == mapTx.size());
+    assert(setPriorityOrder.size() == mapTx.size());
 }
 
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
@@ -776,6 +872,14 @@ bool CTxMemPool::lookup(const uint256& hash, CTransaction& result) const
     return true;
 }
 
+CTransactionRef CTxMemPool::get(const uint256& hash) const
+{
+    LOCK(cs);
+    map<uint256, CTxMemPoolEntry>::const_iterator i = mapTx.find(hash);
+    if (i == mapTx.end()) return CTransactionRef();
+    return i->second.GetSharedTx();
+}
+
 bool CTxMemPool::lookupBareTxid(const uint256& btxid, CTransaction& result) const
 {
     LOCK(cs);
@@ -788,19 +892,19 @@ bool CTxMemPool::lookupBareTxid(const uint256& btxid, CTransaction& result) cons
 CFeeRate CTxMemPool::estimateFee(int nBlocks) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimateFee(nBlocks);
+    return minerPolicyEstimator->EstimateFee(nBlocks);
 }
 double CTxMemPool::estimatePriority(int nBlocks) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimatePriority(nBlocks);
+    return minerPolicyEstimator->EstimatePriority(nBlocks);
 }
 
 bool CTxMemPool::WriteFeeEstimates(CAutoFile& fileout) const
 {
     try {
         LOCK(cs);
-        fileout << 120000;         // version required to read: 0.12.00 or later
+        fileout << FEE_ESTIMATES_FORMAT_VERSION; // version required to read
         fileout << CLIENT_VERSION; // version that wrote the file
         minerPolicyEstimator->Write(fileout);
     } catch (const std::exception&) {
@@ -817,9 +921,11 @@ bool CTxMemPool::ReadFeeEstimates(CAutoFile& filein)
         filein >> nVersionRequired >> nVersionThatWrote;
         if (nVersionRequired > CLIENT_VERSION)
             return error("CTxMemPool::ReadFeeEstimates() : up-version (%d) fee estimate file", nVersionRequired);
+        if (nVersionRequired < FEE_ESTIMATES_FORMAT_VERSION)
+            return error("CTxMemPool::ReadFeeEstimates() : fee estimate file of the sampled format (%d), starting afresh", nVersionRequired);
 
         LOCK(cs);
-        minerPolicyEstimator->Read(filein, minRelayFee);
+        minerPolicyEstimator->Read(filein);
     } catch (const std::exception&) {
         LogPrintf("CTxMemPool::ReadFeeEstimates() : unable to read policy estimator data (non-fatal)");
         return false;
@@ -827,6 +933,58 @@ bool CTxMemPool::ReadFeeEstimates(CAutoFile& filein)
     return true;
 }
 
+bool CTxMemPool::WriteTransactions(CAutoFile& fileout) const
+{
+    try {
+        LOCK(cs);
+        std::vector<std::map<uint256, CTxMemPoolEntry>::const_iterator> ordered;
+        ordered.reserve(mapTx.size());
+        std::set<uint256> setOrdered;
+        for (std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.begin(); it != mapTx.end(); ++it) {
+            // Walk up to the ancestors not written yet, so a reload never sees a child before its parent
+            std::vector<std::map<uint256, CTxMemPoolEntry>::const_iterator> pending(1, it);
+            while (!pending.empty()) {
+                const std::map<uint256, CTxMemPoolEntry>::const_iterator next = pending.back();
+                if (setOrdered.count(next->first)) {
+                    pending.pop_back();
+                    continue;
+                }
+                bool fParentsOrdered = true;
+                for (const auto& txin : next->second.GetTx().vin) {
+                    const std::map<uint256, CTxMemPoolEntry>::const_iterator parent = mapTx.find(txin.prevout.hash);
+                    if (parent != mapTx.end() && !setOrdered.count(parent->first)) {
+                        pending.push_back(parent);
+                        fParentsOrdered = false;
+                    }
+                }
+                if (fParentsOrdered) {
+                    setOrdered.insert(next->first);
+                    ordered.push_back(next);
+                    pending.pop_back();
+                }
+            }
+        }
+
+        fileout << MEMPOOL_DUMP_VERSION;
+        fileout << (uint64_t)ordered.size();
+        std::map<uint256, std::pair<double, CAmount> > mapDeltasOutsidePool = mapDeltas;
+        for (const auto& it : ordered) {
+            std::pair<double, CAmount> deltas(0, 0);
+            std::map<uint256, std::pair<double, CAmount> >::iterator pos = mapDeltasOutsidePool.find(it->first);
+            if (pos != mapDeltasOutsidePool.end()) {
+                deltas = pos->second;
+                mapDeltasOutsidePool.erase(pos);
+            }
+            fileout << CDumpedMempoolEntry(it->second.GetTx(), it->second.GetTime(), deltas.first, deltas.second);
+        }
+        fileout << mapDeltasOutsidePool;
+    } catch (const std::exception& e) {
+        LogPrintf("CTxMemPool::WriteTransactions() : unable to write the mempool (%s)\n", e.what());
+        return false;
+    }
+    return true;
+}
+
 void CTxMemPool::PrioritiseTransaction(const uint256 hash, const string strHash, double dPriorityDelta, const CAmount& nFeeDelta)
 {
     {
@@ -834,6 +992,27 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const string strHash,
         std::pair<double, CAmount>& deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+        std::map<uint256, CTxMemPoolEntry>::iterator it = mapTx.find(hash);
+        if (it != mapTx.end()) {
+            CTxMemPoolEntry& entry = it->second;
+            setDescendantScore.erase(&entry);
+            setAncestorScore.erase(&entry);
+            setFeeRateOrder.erase(&entry);
+            setPriorityOrder.erase(&entry);
+            entry.UpdatePriorityDelta(deltas.first);
+            entry.UpdateFeeDelta(deltas.second);
+            setDescendantScore.insert(&entry);
+            setAncestorScore.insert(&entry);
+            setFeeRateOrder.insert(&entry);
+            setPriorityOrder.insert(&entry);
+            std::set<uint256> relatives;
+            CalculateAncestors(entry.GetTx(), relatives);
+            for (const uint256& ancestor : relatives)
+                UpdateDescendantState(mapTx[ancestor], 0, nFeeDelta, 0);
+            CalculateDescendants(hash, relatives);
+            for (const uint256& descendant : relatives)
+                UpdateAncestorState(mapTx[descendant], 0, nFeeDelta, 0);
+        }
     }
     LogPrintf("PrioritiseTransaction: %s priority += %f, fee += %d\n", strHash, dPriorityDelta, FormatMoney(nFeeDelta));
 }
@@ -871,6 +1050,28 @@ bool CCoinsViewMemPool::GetCoins(const uint256& txid, CCoins& coins) const
     return (base->GetCoins(txid, coins) && !coins.IsPruned());
 }
 
+void CCoinsViewMemPool::GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const
+{
+    std::vector<uint256> missing;
+    CTransaction tx;
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        if (mempool.lookup(*it, tx))
+            coins.push_back(std::make_pair(*it, CCoins(tx, MEMPOOL_HEIGHT)));
+        else
+            missing.push_back(*it);
+    }
+    if (missing.empty())
+        return;
+    std::vector<std::pair<uint256, CCoins> > found;
+    base->GetCoinsBatch(missing, found);
+    for (std::vector<std::pair<uint256, CCoins> >::iterator it = found.begin(); it != found.end(); ++it) {
+        if (!it->second.IsPruned()) {
+            coins.push_back(std::make_pair(it->first, CCoins()));
+            coins.back().second.swap(it->second);
+        }
+    }
+}
+
 bool CCoinsViewMemPool::HaveCoins(const uint256& txid) const
 {
     return mempool.exists(txid) || base->HaveCoins(txid);
@@ -8,12 +8,14 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <list>
+#include <set>
 
 #include "addressindex.h"
 #include "spentindex.h"
 #include "amount.h"
 #include "FeeRate.h"
 #include "coins.h"
+#include "MempoolAddressIndex.h"
 #include "primitives/transaction.h"
 #include "sync.h"
 
@@ -41,28 +43,126 @@ static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 class CTxMemPoolEntry
 {
 private:
-    CTransaction tx;
+    CTransactionRef tx;   //! Shared with whoever else holds on to the transaction
     CAmount nFee;         //! Cached to avoid expensive parent-transaction lookups
     size_t nTxSize;       //! ... and avoid recomputing tx size
     size_t nModSize;      //! ... and modified size for priority
     int64_t nTime;        //! Local time when entering the mempool
     double dPriority;     //! Priority when entering the mempool
     unsigned int nHeight; //! Chain height when entering the mempool
+    size_t nUsageSize;    //! ... and memory held by the transaction
+    CAmount feeDelta;     //! Fee prioritisation through PrioritiseTransaction
+    double priorityDelta; //! ... and priority prioritisation
+
+    // Totals over the transaction and everything in the pool it spends from, and likewise
+    // over the transaction and everything in the pool spending from it, kept up to date by
+    // the pool as relatives come and go. Fees include prioritisation.
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
 
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
+    CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
     CTxMemPoolEntry();
     CTxMemPoolEntry(const CTxMemPoolEntry& other);
 
-    const CTransaction& GetTx() const { return this->tx; }
+    const CTransaction& GetTx() const { return *this->tx; }
+    const CTransactionRef& GetSharedTx() const { return this->tx; }
     double GetPriority(unsigned int currentHeight) const;
+    double GetModifiedPriority(unsigned int currentHeight) const { return GetPriority(currentHeight) + priorityDelta; }
     CAmount GetFee() const { return nFee; }
+    CAmount GetModifiedFee() const { return nFee + feeDelta; }
     size_t GetTxSize() const { return nTxSize; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return nHeight; }
+    size_t DynamicMemoryUsage() const { return nUsageSize; }
+
+    uint64_t GetCountWithAncestors() const { return nCountWithAncestors; }
+    uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
+    CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
+    uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
+    uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
+    CAmount GetModFeesWithDescendants() const { return nModFeesWithDescendants; }
+
+    /** Add a relative (or, with negative amounts, take it away) to the totals */
+    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void UpdateFeeDelta(CAmount newFeeDelta);
+    void UpdatePriorityDelta(double newPriorityDelta) { priorityDelta = newPriorityDelta; }
+};
+
+/**
+ * Orders mempool entries from the first to be evicted to the last: by the higher of the fee rate of
+ * the transaction alone and the fee rate of the transaction with its descendants, so a transaction
+ * a child pays for is kept along with the child. Evicting an entry takes its descendants with it.
+ * Ties go to the newer transaction first.
+ */
+class CompareTxMemPoolEntryByDescendantScore
+{
+public:
+    bool operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const;
+};
+
+/** Orders mempool entries by the fee rate of the transaction together with its ancestors, highest first, the order packages are mined in */
+class CompareTxMemPoolEntryByAncestorScore
+{
+public:
+    bool operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const;
+};
+
+/** Orders mempool entries by modified fee rate, highest first, the order blocks are filled in past the priority area */
+class CompareTxMemPoolEntryByFeeRate
+{
+public:
+    bool operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const;
+};
+
+/**
+ * Orders mempool entries by modified priority in a block at the given height, highest first. Priorities
+ * grow with the height at rates depending on each transaction's inputs, so the order only holds for one height.
+ */
+class CompareTxMemPoolEntryByPriority
+{
+private:
+    unsigned int nHeight;
+
+public:
+    explicit CompareTxMemPoolEntryByPriority(unsigned int nHeightIn): nHeight(nHeightIn) {}
+    bool operator()(const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) const;
+};
+
+/** Format version of mempool.dat */
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+
+/** A mempool transaction as written to mempool.dat, with the time it entered the pool and its prioritisation */
+struct CDumpedMempoolEntry
+{
+    CTransaction tx;
+    int64_t nTime;
+    double dPriorityDelta;
+    CAmount nFeeDelta;
+
+    CDumpedMempoolEntry(): tx(), nTime(0), dPriorityDelta(0), nFeeDelta(0) {}
+    CDumpedMempoolEntry(const CTransaction& txIn, int64_t nTimeIn, double dPriorityDeltaIn, CAmount nFeeDeltaIn)
+        : tx(txIn), nTime(nTimeIn), dPriorityDelta(dPriorityDeltaIn), nFeeDelta(nFeeDeltaIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(tx);
+        READWRITE(nTime);
+        READWRITE(dPriorityDelta);
+        READWRITE(nFeeDelta);
+    }
 };
 
-class CMinerPolicyEstimator;
+class BlockPolicyEstimator;
 
 /** An inpoint - a combination of a transaction and an index n into its vin */
 class CInPoint
@@ -98,23 +198,29 @@ public:
 class CTxMemPool
 {
 private:
-    bool fSanityCheck; //! Normally false, true if -checkmempool or -regtest
+    unsigned int nCheckRatio; //! Normally 0, n if -checkmempool=n or 1 in -regtest: check runs once every n calls on average
     unsigned int nTransactionsUpdated;
-    CMinerPolicyEstimator* minerPolicyEstimator;
+    BlockPolicyEstimator* minerPolicyEstimator;
 
     CFeeRate minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
+    MempoolAddressIndex addressIndex;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
-    addressDeltaMapInserted mapAddressInserted;
+    class CSpentIndexKeyHasher
+    {
+    private:
+        CCoinsKeyHasher txidHasher;
+
+    public:
+        size_t operator()(const CSpentIndexKey& key) const { return txidHasher(key.txid) ^ key.outputIndex; }
+    };
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
+    typedef boost::unordered_map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyHasher, std::equal_to<CSpentIndexKey>,
+        NodePoolAllocator<std::pair<const CSpentIndexKey, CSpentIndexValue> > > mapSpentIndex;
     mapSpentIndex mapSpent;
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
+    typedef boost::unordered_map<uint256, std::vector<CSpentIndexKey>, CCoinsKeyHasher> mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
@@ -122,9 +228,41 @@ private:
     /** Maps bare txid's of transactions to the corresponding mempool entries.
      *  This is used for lookups of outputs available in the mempool instead
      *  of mapTx in case of segwit light.  */
-    std::map<uint256, const CTxMemPoolEntry*> mapBareTxid;
+    boost::unordered_map<uint256, const CTxMemPoolEntry*, SaltedUint256Hasher> mapBareTxid;
+
+    /** The entries of mapTx in eviction order; an entry's totals only change while it is out of the set */
+    typedef std::set<const CTxMemPoolEntry*, CompareTxMemPoolEntryByDescendantScore> setEntriesByDescendantScore;
+    setEntriesByDescendantScore setDescendantScore;
+
+    uint64_t cachedInnerUsage; //! sum of the memory held by the pool's transactions
+
+public:
+    typedef std::set<const CTxMemPoolEntry*, CompareTxMemPoolEntryByAncestorScore> setEntriesByAncestorScore;
+    typedef std::set<const CTxMemPoolEntry*, CompareTxMemPoolEntryByFeeRate> setEntriesByFeeRate;
+    typedef std::set<const CTxMemPoolEntry*, CompareTxMemPoolEntryByPriority> setEntriesByPriority;
+
+private:
+    /** The entries of mapTx in the orders block templates are filled in, kept as entries come and go */
+    setEntriesByAncestorScore setAncestorScore;
+    setEntriesByFeeRate setFeeRateOrder;
+    setEntriesByPriority setPriorityOrder; //! ordered for a block at nPriorityOrderHeight
+    unsigned int nPriorityOrderHeight;
+
+    mutable int64_t lastRollingFeeUpdate;
+    mutable bool blockSinceLastRollingFeeBump;
+    mutable double rollingMinimumFeeRate; //! fee rate in satoshis per kB, raised by evictions
+
+    void UpdateAncestorState(CTxMemPoolEntry& entry, int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void UpdateDescendantState(CTxMemPoolEntry& entry, int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void RecalculateRelativeState(const uint256& hash);
+    void UpdateForNewEntry(const uint256& hash);
+    void UpdateForRemoval(const std::set<uint256>& hashesToRemove, std::set<uint256>& hashesToRecalculate);
+    void TrackPackageRemoved(const CFeeRate& rate);
 
 public:
+    /** Time in seconds for the minimum fee raised by evictions to halve once blocks come in */
+    static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12;
+
     mutable CCriticalSection cs;
     std::map<uint256, CTxMemPoolEntry> mapTx;
     std::map<COutPoint, CInPoint> mapNextTx;
@@ -136,10 +274,10 @@ public:
      * If sanity-checking is turned on, check makes sure the pool is
      * consistent (does not contain two transactions that spend the same inputs,
      * all inputs are in the mapNextTx array). If sanity-checking is turned off,
-     * check does nothing.
+     * check does nothing; otherwise it runs on a random one in nCheckRatio calls.
      */
     void check(const CCoinsViewCache* pcoins) const;
-    void setSanityCheck(bool _fSanityCheck) { fSanityCheck = _fSanityCheck; }
+    void setSanityCheck(unsigned int _nCheckRatio) { nCheckRatio = _nCheckRatio; }
 
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry);
     void remove(const CTransaction& tx, std::list<CTransaction>& removed, bool fRecursive = false);
@@ -189,7 +327,33 @@ public:
         return (mapBareTxid.count(hash) != 0);
     }
 
+    /** Fill the sets with the hashes of the pool transactions tx spends from, directly or not, or spending from hash */
+    void CalculateAncestors(const CTransaction& tx, std::set<uint256>& ancestors) const;
+    void CalculateDescendants(const uint256& hash, std::set<uint256>& descendants) const;
+    /** Whether adding tx of nSize bytes keeps it and its in-pool ancestors within the given count and byte limits; cs must be held */
+    bool CheckChainLimits(const CTransaction& tx, size_t nSize, uint64_t nLimitAncestors, uint64_t nLimitAncestorSize, uint64_t nLimitDescendants, uint64_t nLimitDescendantSize, std::string& errString) const;
+
+    /** The pool's entries by ancestor fee rate, by modified fee rate and by modified priority in a block at nHeight, best first; cs must be held */
+    const setEntriesByAncestorScore& GetAncestorScoreOrder() const { return setAncestorScore; }
+    const setEntriesByFeeRate& GetFeeRateOrder() const { return setFeeRateOrder; }
+    const setEntriesByPriority& GetPriorityOrder(unsigned int nHeight);
+
+    /** Memory used by the pool's transactions and the structures tracking them */
+    size_t DynamicMemoryUsage() const;
+
+    /**
+     * The fee rate a transaction must pay to enter a pool limited to sizelimit bytes: zero until
+     * the pool has evicted, then just above the best package evicted, halving every
+     * ROLLING_FEE_HALFLIFE (faster while the pool is well below its limit) once a block arrived.
+     */
+    CFeeRate GetMinFee(size_t sizelimit) const;
+
+    /** Evict the packages of lowest descendant score until at most sizelimit bytes are used; returns the number of transactions evicted */
+    unsigned int TrimToSize(size_t sizelimit);
+
     bool lookup(const uint256& hash, CTransaction& result) const;
+    //! The transaction with the hash, without copying it, or null if it is not in the pool
+    CTransactionRef get(const uint256& hash) const;
     bool lookupBareTxid(const uint256& btxid, CTransaction& result) const;
 
     /** Estimate fee rate needed to get into the next nBlocks */
@@ -201,6 +365,12 @@ public:
     /** Write/Read estimates to disk */
     bool WriteFeeEstimates(CAutoFile& fileout) const;
     bool ReadFeeEstimates(CAutoFile& filein);
+
+    /**
+     * Write the version, the number of transactions and the pool's transactions, each after the
+     * pool transactions it spends, followed by the prioritisation of transactions not in the pool.
+     */
+    bool WriteTransactions(CAutoFile& fileout) const;
 };
 
 /** 
@@ -215,6 +385,7 @@ protected:
 public:
     CCoinsViewMemPool(CCoinsView* baseIn, CTxMemPool& mempoolIn);
     bool GetCoins(const uint256& txid, CCoins& coins) const;
+    void GetCoinsBatch(const std::vector<uint256>& txids, std::vector<std::pair<uint256, CCoins> >& coins) const;
     bool HaveCoins(const uint256& txid) const;
 };
 
@@ -13,6 +13,7 @@
 #include <boost/signals2/signal.hpp>
 
 class CBasicKeyStore;
+class COutPoint;
 class CWallet;
 class uint256;
 
@@ -101,6 +102,15 @@ public:
 
     /** New block has been accepted */
     boost::signals2::signal<void(const uint256& hash)> NotifyBlockTip;
+
+    /**
+     * A masternode was added to the list, or its state (CMasternode::state) changed.
+     * @note called with the lock of the masternode list held.
+     */
+    boost::signals2::signal<void(const COutPoint& collateral, int state)> NotifyMasternodeChanged;
+
+    /** A newer spork has been accepted */
+    boost::signals2::signal<void(int sporkId, const std::string& value, int64_t timeSigned)> NotifySporkChanged;
 };
 
 extern CClientUIInterface uiInterface;
@@ -10,6 +10,21 @@
 #include <stdio.h>
 #include <string.h>
 
+namespace
+{
+const char hexDigits[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+//! Writes two hex digits per byte, without going through printf formatting
+void EncodeHex(const unsigned char* bytes, size_t size, bool fReversed, char* out)
+{
+    for (size_t i = 0; i < size; i++) {
+        const unsigned char byte = fReversed ? bytes[size - i - 1] : bytes[i];
+        out[2 * i] = hexDigits[byte >> 4];
+        out[2 * i + 1] = hexDigits[byte & 15];
+    }
+}
+}
+
 template <unsigned int BITS>
 base_uint<BITS>::base_uint(const std::string& str)
 {
@@ -135,18 +150,6 @@ base_uint<BITS>& base_uint<BITS>::operator/=(const base_uint& b)
     return *this;
 }
 
-template <unsigned int BITS>
-int base_uint<BITS>::CompareTo(const base_uint<BITS>& b) const
-{
-    for (int i = WIDTH - 1; i >= 0; i--) {
-        if (pn[i] < b.pn[i])
-            return -1;
-        if (pn[i] > b.pn[i])
-            return 1;
-    }
-    return 0;
-}
-
 template <unsigned int BITS>
 bool base_uint<BITS>::EqualTo(uint64_t b) const
 {
@@ -176,10 +179,9 @@ double base_uint<BITS>::getdouble() const
 template <unsigned int BITS>
 std::string base_uint<BITS>::GetHex() const
 {
-    char psz[sizeof(pn) * 2 + 1];
-    for (unsigned int i = 0; i < sizeof(pn); i++)
-        sprintf(psz + i * 2, "%02x", ((unsigned char*)pn)[sizeof(pn) - i - 1]);
-    return std::string(psz, psz + sizeof(pn) * 2);
+    std::string hex(sizeof(pn) * 2, '0');
+    EncodeHex((const unsigned char*)pn, sizeof(pn), true, &hex[0]);
+    return hex;
 }
 
 template <unsigned int BITS>
@@ -195,19 +197,17 @@ void base_uint<BITS>::SetHex(const char* psz)
     if (psz[0] == '0' && tolower(psz[1]) == 'x')
         psz += 2;
 
-    // hex string to uint
+    // hex string to uint, from the least significant digit at its end
     const char* pbegin = psz;
     while (::HexDigit(*psz) != -1)
         psz++;
-    psz--;
     unsigned char* p1 = (unsigned char*)pn;
     unsigned char* pend = p1 + WIDTH * 4;
-    while (psz >= pbegin && p1 < pend) {
-        *p1 = ::HexDigit(*psz--);
-        if (psz >= pbegin) {
-            *p1 |= ((unsigned char)::HexDigit(*psz--) << 4);
-            p1++;
-        }
+    while (psz > pbegin && p1 < pend) {
+        unsigned char byte = ::HexDigit(*--psz);
+        if (psz > pbegin)
+            byte |= (unsigned char)::HexDigit(*--psz) << 4;
+        *p1++ = byte;
     }
 }
 
@@ -226,10 +226,9 @@ std::string base_uint<BITS>::ToString() const
 template <unsigned int BITS>
 std::string base_uint<BITS>::ToStringReverseEndian() const
 {
-    char psz[sizeof(pn) * 2 + 1];
-    for (unsigned int i = 0; i < sizeof(pn); i++)
-        sprintf(psz + i * 2, "%02x", ((unsigned char*)pn)[i]);
-    return std::string(psz, psz + sizeof(pn) * 2);
+    std::string hex(sizeof(pn) * 2, '0');
+    EncodeHex((const unsigned char*)pn, sizeof(pn), false, &hex[0]);
+    return hex;
 }
 
 template <unsigned int BITS>
@@ -255,7 +254,6 @@ template base_uint<160>& base_uint<160>::operator>>=(unsigned int);
 template base_uint<160>& base_uint<160>::operator*=(uint32_t b32);
 template base_uint<160>& base_uint<160>::operator*=(const base_uint<160>& b);
 template base_uint<160>& base_uint<160>::operator/=(const base_uint<160>& b);
-template int base_uint<160>::CompareTo(const base_uint<160>&) const;
 template bool base_uint<160>::EqualTo(uint64_t) const;
 template double base_uint<160>::getdouble() const;
 template std::string base_uint<160>::GetHex() const;
@@ -273,7 +271,6 @@ template base_uint<256>& base_uint<256>::operator*=(uint32_t b32);
 template base_uint<256>& base_uint<256>::operator*=(const base_uint<256>& b);
 template bool base_uint<256>::MultiplyBy(const base_uint<256>& b);
 template base_uint<256>& base_uint<256>::operator/=(const base_uint<256>& b);
-template int base_uint<256>::CompareTo(const base_uint<256>&) const;
 template bool base_uint<256>::EqualTo(uint64_t) const;
 template double base_uint<256>::getdouble() const;
 template std::string base_uint<256>::GetHex() const;
@@ -397,3 +394,19 @@ uint64_t uint256::GetHash(const uint256& salt) const
 
     return ((((uint64_t)b) << 32) | c);
 }
+
+uint64_t uint160::GetHash(const uint256& salt) const
+{
+    uint32_t a, b, c;
+    a = b = c = 0xdeadbeef + (WIDTH << 2);
+
+    a += pn[0] ^ salt.pn[0];
+    b += pn[1] ^ salt.pn[1];
+    c += pn[2] ^ salt.pn[2];
+    HashMix(a, b, c);
+    a += pn[3] ^ salt.pn[3];
+    b += pn[4] ^ salt.pn[4];
+    HashFinal(a, b, c);
+
+    return ((((uint64_t)b) << 32) | c);
+}
@@ -226,7 +226,16 @@ public:
         return ret;
     }
 
-    int CompareTo(const base_uint& b) const;
+    int CompareTo(const base_uint& b) const
+    {
+        for (int i = WIDTH - 1; i >= 0; i--) {
+            if (pn[i] < b.pn[i])
+                return -1;
+            if (pn[i] > b.pn[i])
+                return 1;
+        }
+        return 0;
+    }
     bool EqualTo(uint64_t b) const;
 
     friend inline const base_uint operator+(const base_uint& a, const base_uint& b) { return base_uint(a) += b; }
@@ -322,6 +331,8 @@ public:
     friend class uint512;
 };
 
+class uint256;
+
 /** 160-bit unsigned big integer. */
 class uint160 : public base_uint<160>
 {
@@ -331,6 +342,8 @@ public:
     uint160(uint64_t b) : base_uint<160>(b) {}
     explicit uint160(const std::string& str) : base_uint<160>(str) {}
     explicit uint160(const std::vector<unsigned char>& vch) : base_uint<160>(vch) {}
+
+    uint64_t GetHash(const uint256& salt) const;
 };
 
 /** 256-bit unsigned big integer. */
@@ -60,6 +60,8 @@ public:
 
     size_t count() const { return values.size(); }
 
+    const std::vector<std::string>& getKeys() const { return keys; }
+    const std::vector<UniValue>& getValues() const { return values; }
     bool getBool() const { return isTrue(); }
     bool checkObject(const std::map<std::string,UniValue::VType>& memberTypes);
     const UniValue& operator[](const std::string& key) const;
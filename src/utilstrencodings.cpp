@@ -56,11 +56,6 @@ const signed char p_util_hexdigit[256] =
         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
 };
 
-signed char HexDigit(char c)
-{
-    return p_util_hexdigit[(unsigned char)c];
-}
-
 bool IsHex(const string& str)
 {
     for (std::string::const_iterator it(str.begin()); it != str.end(); ++it) {
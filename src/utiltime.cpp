@@ -31,7 +31,7 @@ int64_t GetTime()
 void SetMockTime(int64_t nMockTimeIn)
 {
     boost::unique_lock<boost::mutex> lock(csMockTime);
-    LogPrint("mocktime", "Setting mocktime to %d\n", nMockTime);
+    LogPrint(LOG_MOCKTIME, "Setting mocktime to %d\n", nMockTime);
     nMockTime = nMockTimeIn;
     cvMockTimeChanged.notify_all();
 }
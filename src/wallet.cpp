@@ -18,16 +18,21 @@
 #include "net.h"
 #include "script/script.h"
 #include "script/sign.h"
+#include "script/standard.h"
+#include <script/ParallelInputSigner.h>
 #include "spork.h"
 #include "swifttx.h"
 #include "timedata.h"
 #include "utilmoneystr.h"
 #include "libzerocoin/Denominations.h"
 #include <assert.h>
+#include <limits>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/filesystem/operations.hpp>
 #include "FeeAndPriorityCalculator.h"
+#include <PerformanceStatistics.h>
 #include <ValidationState.h>
 #include <blockmap.h>
 #include <txmempool.h>
@@ -38,10 +43,21 @@
 #include <SpentOutputTracker.h>
 #include <WalletTx.h>
 #include <WalletTransactionRecord.h>
+#include <WalletTransactionOrderIndex.h>
 #include <StochasticSubsetSelectionAlgorithm.h>
 #include <CoinControlSelectionAlgorithm.h>
 #include <MinimumFeeCoinSelectionAlgorithm.h>
+#include <BranchAndBoundCoinSelectionAlgorithm.h>
 #include <SignatureSizeEstimator.h>
+#include <RescanBlockReader.h>
+#include <BlockFilter.h>
+#include <I_BlockFilterReader.h>
+#include <main.h>
+#include <WalletOutputFilter.h>
+#include <IsMineCache.h>
+#include <WalletDatabaseGroupCommit.h>
+#include <keystore.h>
+#include <ThreadManagementHelpers.h>
 
 #include "Settings.h"
 extern Settings& settings;
@@ -128,9 +144,8 @@ bool CheckFinalTx(const CTransaction& tx, const CChain& activeChain, int flags =
     return IsFinalTx(tx, activeChain, nBlockHeight, nBlockTime);
 }
 
-bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, AvailableCoinsType coinType, isminetype& mine,VaultType& vaultType)
+static bool IsAvailableVaultType(AvailableCoinsType coinType, VaultType vaultType)
 {
-    mine = ::IsMine(keystore, scriptPubKey, vaultType);
     if( coinType == STAKABLE_COINS && vaultType == OWNED_VAULT)
     {
         return false;
@@ -145,6 +160,11 @@ bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, Ava
     }
     return true;
 }
+bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, AvailableCoinsType coinType, isminetype& mine,VaultType& vaultType)
+{
+    mine = ::IsMine(keystore, scriptPubKey, vaultType);
+    return IsAvailableVaultType(coinType, vaultType);
+}
 bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, AvailableCoinsType coinType)
 {
     VaultType vaultType;
@@ -170,7 +190,8 @@ bool WriteTxToDisk(const CWallet* walletPtr, const CWalletTx& transactionToWrite
 CWallet::CWallet(const CChain& chain, const BlockMap& blockMap
     ): cs_wallet()
     , transactionRecord_(new WalletTransactionRecord(cs_wallet,strWalletFile) )
-    , outputTracker_( new SpentOutputTracker(*transactionRecord_) )
+    , outputTracker_( new SpentOutputTracker(*transactionRecord_,chain) )
+    , transactionOrderIndex_( new WalletTransactionOrderIndex() )
     , chainActive_(chain)
     , mapBlockIndex_(blockMap)
     , orderedTransactionIndex()
@@ -183,7 +204,22 @@ CWallet::CWallet(const CChain& chain, const BlockMap& blockMap
     , walletStakingOnly(false)
     , allowSpendingZeroConfirmationOutputs(false)
     , signatureSizeEstimator_(new SignatureSizeEstimator())
-    , defaultCoinSelectionAlgorithm_(new MinimumFeeCoinSelectionAlgorithm(*this,*signatureSizeEstimator_))
+    , minimumFeeCoinSelectionAlgorithm_(new MinimumFeeCoinSelectionAlgorithm(*this,*signatureSizeEstimator_))
+    , defaultCoinSelectionAlgorithm_(
+        new BranchAndBoundCoinSelectionAlgorithm(*this,*signatureSizeEstimator_,*minimumFeeCoinSelectionAlgorithm_))
+    , stakeCandidates_()
+    , stakeCandidatesStale_(true)
+    , unspentCandidates_()
+    , unspentCandidatesStale_(true)
+    , stakeCoinsVersion_(0u)
+    , balanceCache_()
+    , keyStoreVersion_(0u)
+    , isMineCache_(new IsMineCache(*this, keyStoreVersion_, ISMINE_CACHE_MAX_SCRIPTS))
+    , cs_rescanProgress_()
+    , rescanProgress_()
+    , keyPoolTopUpMutex_()
+    , keyPoolTopUpRequested_()
+    , fKeyPoolTopUpRequested_(false)
     , defaultKeyPoolTopUp(0)
 {
     SetNull();
@@ -199,9 +235,11 @@ CWallet::CWallet(const std::string& strWalletFileIn, const CChain& chain, const
 CWallet::~CWallet()
 {
     defaultCoinSelectionAlgorithm_.reset();
+    minimumFeeCoinSelectionAlgorithm_.reset();
     signatureSizeEstimator_.reset();
     delete pwalletdbEncryption;
     pwalletdbEncryption = NULL;
+    transactionOrderIndex_.reset();
     outputTracker_.reset();
     transactionRecord_.reset();
 }
@@ -234,6 +272,9 @@ void CWallet::UpdateTransactionMetadata(const std::vector<CWalletTx>& oldTransac
     {
         uint256 hash = wtxOld.GetHash();
         transactionRecord_->UpdateMetadata(hash,wtxOld,true,true);
+        CWalletTx* wtx = const_cast<CWalletTx*>(transactionRecord_->GetWalletTx(hash));
+        if (wtx != nullptr)
+            UpdateTransactionOrderIndex(*wtx);
     }
 }
 void CWallet::IncrementDBUpdateCount() const
@@ -250,11 +291,16 @@ bool CWallet::CanSupportFeature(enum WalletFeature wf)
 
 isminetype CWallet::IsMine(const CScript& scriptPubKey) const
 {
-    return ::IsMine(*this, scriptPubKey);
+    VaultType vaultType;
+    return IsMine(scriptPubKey, vaultType);
+}
+isminetype CWallet::IsMine(const CScript& scriptPubKey, VaultType& vaultType) const
+{
+    return isMineCache_->IsMine(scriptPubKey, vaultType);
 }
 isminetype CWallet::IsMine(const CTxDestination& dest) const
 {
-    return ::IsMine(*this, dest);
+    return IsMine(GetScriptForDestination(dest));
 }
 isminetype CWallet::IsMine(const CTxOut& txout) const
 {
@@ -344,7 +390,9 @@ CAmount CWallet::ComputeCredit(const CWalletTx& tx, const isminefilter& filter,
         if( (creditFilterFlags & REQUIRE_AVAILABLE_TYPE) )
         {
             AvailableCoinsType coinType = static_cast<AvailableCoinsType>( creditFilterFlags >> 4);
-            if(!IsAvailableType(*this,out.scriptPubKey, coinType))
+            VaultType vaultType;
+            IsMine(out.scriptPubKey, vaultType);
+            if(!IsAvailableVaultType(coinType, vaultType))
             {
                 continue;
             }
@@ -426,6 +474,11 @@ std::vector<const CWalletTx*> CWallet::GetWalletTransactionReferences() const
     LOCK(cs_wallet);
     return transactionRecord_->GetWalletTransactionReferences();
 }
+size_t CWallet::DynamicMemoryUsage() const
+{
+    LOCK(cs_wallet);
+    return transactionRecord_->DynamicMemoryUsage();
+}
 
 
 CPubKey CWallet::GenerateNewKey(uint32_t nAccountIndex, bool fInternal)
@@ -580,6 +633,7 @@ bool CWallet::LoadHDPubKey(const CHDPubKey &hdPubKey)
     AssertLockHeld(cs_wallet);
 
     mapHdPubKeys[hdPubKey.extPubKey.pubkey.GetID()] = hdPubKey;
+    ++keyStoreVersion_;
     return true;
 }
 
@@ -595,6 +649,7 @@ bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
     hdPubKey.hdchainID = hdChainCurrent.GetID();
     hdPubKey.nChangeIndex = fInternal ? 1 : 0;
     mapHdPubKeys[extPubKey.pubkey.GetID()] = hdPubKey;
+    ++keyStoreVersion_;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -613,6 +668,8 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
+    MarkStakeCandidatesStale();
+    ++keyStoreVersion_;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -635,6 +692,8 @@ bool CWallet::AddCryptedKey(const CPubKey& vchPubKey,
 {
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    MarkStakeCandidatesStale();
+    ++keyStoreVersion_;
     if (!fFileBacked)
         return true;
     {
@@ -681,6 +740,7 @@ void CWallet::UpdateTimeFirstKey(int64_t nCreateTime)
 
 bool CWallet::LoadCryptedKey(const CPubKey& vchPubKey, const std::vector<unsigned char>& vchCryptedSecret)
 {
+    ++keyStoreVersion_;
     return CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret);
 }
 
@@ -688,6 +748,8 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    MarkStakeCandidatesStale();
+    ++keyStoreVersion_;
     if (!fFileBacked)
         return true;
     return CWalletDB(settings,strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
@@ -705,6 +767,7 @@ bool CWallet::LoadCScript(const CScript& redeemScript)
         return true;
     }
 
+    ++keyStoreVersion_;
     return CCryptoKeyStore::AddCScript(redeemScript);
 }
 
@@ -724,6 +787,8 @@ bool CWallet::RemoveVault(const CScript& vaultScript)
 {
     LOCK2(cs_KeyStore,cs_wallet);
     mapScripts.erase(vaultScript);
+    MarkStakeCandidatesStale();
+    ++keyStoreVersion_;
     if (!fFileBacked)
         return true;
     return CWalletDB(settings,strWalletFile).EraseCScript(Hash160(vaultScript));
@@ -735,6 +800,8 @@ bool CWallet::AddWatchOnly(const CScript& dest)
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
     nTimeFirstKey = 1; // No birthday information for watch-only keys.
+    ++stakeCoinsVersion_;
+    ++keyStoreVersion_;
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
         return true;
@@ -746,6 +813,8 @@ bool CWallet::RemoveWatchOnly(const CScript& dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    ++stakeCoinsVersion_;
+    ++keyStoreVersion_;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (fFileBacked)
@@ -757,6 +826,7 @@ bool CWallet::RemoveWatchOnly(const CScript& dest)
 
 bool CWallet::LoadWatchOnly(const CScript& dest)
 {
+    ++keyStoreVersion_;
     return CCryptoKeyStore::AddWatchOnly(dest);
 }
 
@@ -764,6 +834,8 @@ bool CWallet::AddMultiSig(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddMultiSig(dest))
         return false;
+    MarkStakeCandidatesStale();
+    ++keyStoreVersion_;
     nTimeFirstKey = 1; // No birthday information
     NotifyMultiSigChanged(true);
     if (!fFileBacked)
@@ -776,6 +848,7 @@ bool CWallet::RemoveMultiSig(const CScript& dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveMultiSig(dest))
         return false;
+    ++keyStoreVersion_;
     if (!HaveMultiSig())
         NotifyMultiSigChanged(false);
     if (fFileBacked)
@@ -787,6 +860,7 @@ bool CWallet::RemoveMultiSig(const CScript& dest)
 
 bool CWallet::LoadMultiSig(const CScript& dest)
 {
+    ++keyStoreVersion_;
     return CCryptoKeyStore::AddMultiSig(dest);
 }
 
@@ -1057,27 +1131,53 @@ int64_t CWallet::IncOrderPosNext(CWalletDB* pwalletdb)
     return nRet;
 }
 
-CWallet::TxItems CWallet::OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount)
+const CWallet::TxItems& CWallet::OrderedTxItems() const
 {
-    AssertLockHeld(cs_wallet); // mapWallet
-    CWalletDB walletdb(settings,strWalletFile);
+    AssertLockHeld(cs_wallet); // transactionOrderIndex_
+    return transactionOrderIndex_->GetOrderedItems();
+}
 
-    // First: get all CWalletTx and CAccountingEntry into a sorted-by-order multimap.
-    TxItems txOrdered;
+std::vector<const CWalletTx*> CWallet::GetWalletTransactionsAboveHeight(int height) const
+{
+    AssertLockHeld(cs_wallet); // transactionOrderIndex_
+    const std::vector<CWalletTx*> transactions = transactionOrderIndex_->GetTransactionsAboveHeight(height);
+    return std::vector<const CWalletTx*>(transactions.begin(), transactions.end());
+}
 
-    // Note: maintaining indices in the database of (account,time) --> txid and (account, time) --> acentry
-    // would make this much faster for applications that do this a lot.
-    for (map<uint256, CWalletTx>::iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-        CWalletTx* wtx = &((*it).second);
-        txOrdered.insert(std::make_pair(wtx->nOrderPos, TxPair(wtx, (CAccountingEntry*)0)));
-    }
-    acentries.clear();
-    walletdb.ListAccountCreditDebit(strAccount, acentries);
-    BOOST_FOREACH (CAccountingEntry& entry, acentries) {
-        txOrdered.insert(std::make_pair(entry.nOrderPos, TxPair((CWalletTx*)0, &entry)));
+int CWallet::GetConfirmationHeight(const CWalletTx& walletTransaction) const
+{
+    if (walletTransaction.hashBlock == 0 || walletTransaction.nIndex == -1)
+        return WalletTransactionOrderIndex::UNCONFIRMED_HEIGHT;
+
+    LOCK(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex_.find(walletTransaction.hashBlock);
+    if (it == mapBlockIndex_.end() || !it->second || !chainActive_.Contains(it->second))
+        return WalletTransactionOrderIndex::UNCONFIRMED_HEIGHT;
+    return it->second->nHeight;
+}
+
+void CWallet::UpdateTransactionOrderIndex(CWalletTx& walletTransaction)
+{
+    AssertLockHeld(cs_wallet); // transactionOrderIndex_
+    transactionOrderIndex_->UpdateTransaction(walletTransaction, GetConfirmationHeight(walletTransaction));
+}
+
+void CWallet::RebuildTransactionOrderIndex()
+{
+    LOCK2(cs_main, cs_wallet);
+    transactionOrderIndex_->Clear();
+    for (std::map<uint256, CWalletTx>::iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it)
+    {
+        UpdateTransactionOrderIndex(it->second);
     }
+    if (!fFileBacked)
+        return;
 
-    return txOrdered;
+    std::list<CAccountingEntry> acentries;
+    CWalletDB(settings,strWalletFile).ListAccountCreditDebit("*", acentries);
+    BOOST_FOREACH (const CAccountingEntry& entry, acentries) {
+        transactionOrderIndex_->AddAccountingEntry(entry);
+    }
 }
 
 void CWallet::RecomputeCachedQuantities()
@@ -1087,6 +1187,7 @@ void CWallet::RecomputeCachedQuantities()
     {
         item.second.RecomputeCachedQuantities();
     }
+    ++stakeCoinsVersion_;
 }
 
 int64_t CWallet::SmartWalletTxTimestampEstimation(const CWalletTx& wtx)
@@ -1096,9 +1197,8 @@ int64_t CWallet::SmartWalletTxTimestampEstimation(const CWalletTx& wtx)
     {
         // Tolerate times up to the last timestamp in the wallet not more than 5 minutes into the future
         int64_t latestTolerated = latestNow + 300;
-        std::list<CAccountingEntry> acentries;
-        TxItems txOrdered = OrderedTxItems(acentries);
-        for (TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
+        const TxItems& txOrdered = OrderedTxItems();
+        for (TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
             CWalletTx* const pwtx = (*it).second.first;
             if (pwtx == &wtx)
                 continue;
@@ -1134,7 +1234,10 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
 
     if (fFromLoadWallet)
     {
-        outputTracker_->UpdateSpends(wtxIn, orderedTransactionIndex, fFromLoadWallet).first->RecomputeCachedQuantities();
+        CWalletTx& wtx = *outputTracker_->UpdateSpends(wtxIn, orderedTransactionIndex, fFromLoadWallet).first;
+        wtx.RecomputeCachedQuantities();
+        UpdateStakeCandidates(wtx);
+        UpdateUnspentCandidates(wtx);
     }
     else
     {
@@ -1191,6 +1294,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
             (transactionHashIsNewToWallet ? "new" : ""),
             (walletTransactionHasBeenUpdated ? "update" : ""));
 
+        // Keep the activity log in order, which also notices a block leaving the active chain
+        UpdateTransactionOrderIndex(wtx);
+
         // Write to disk
         if (transactionHashIsNewToWallet || walletTransactionHasBeenUpdated)
             if (!WriteTxToDisk(this,wtx))
@@ -1198,6 +1304,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
 
         // Break debit/credit balance caches:
         wtx.RecomputeCachedQuantities();
+        UpdateStakeCandidates(wtx);
+        UpdateUnspentCandidates(wtx);
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, transactionHashIsNewToWallet ? CT_NEW : CT_UPDATED);
@@ -1214,6 +1322,18 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
     return true;
 }
 
+void CWallet::LoadWalletTransactions(const std::vector<CWalletTx>& walletTransactions)
+{
+    AssertLockHeld(cs_wallet);
+    const std::vector<CWalletTx*> addedTransactions = outputTracker_->AddLoadedTransactions(walletTransactions);
+    for (CWalletTx* wtx: addedTransactions)
+    {
+        wtx->RecomputeCachedQuantities();
+        UpdateStakeCandidates(*wtx);
+        UpdateUnspentCandidates(*wtx);
+    }
+}
+
 /**
  * Add a transaction to the wallet, or update it.
  * pblock is optional, but should be provided if the transaction is known to be in a block.
@@ -1238,6 +1358,7 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
 {
+    PerformanceTimerScope timer(PerformanceTimer::WALLET_SYNC);
     LOCK2(cs_main, cs_wallet);
     if (!AddToWalletIfInvolvingMe(tx, pblock, true))
         return; // Not one of ours
@@ -1247,9 +1368,12 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     // recomputed, also:
     BOOST_FOREACH (const CTxIn& txin, tx.vin) {
         CWalletTx* wtx = const_cast<CWalletTx*>(GetWalletTx(txin.prevout.hash));
-        if (wtx != nullptr)
+        if (wtx != nullptr) {
             wtx->RecomputeCachedQuantities();
+            UpdateUnspentCandidates(*wtx);
+        }
     }
+    ++stakeCoinsVersion_;
 }
 
 isminetype CWallet::IsMine(const CTxIn& txin) const
@@ -1290,7 +1414,7 @@ bool CWallet::IsChange(const CTxOut& txout) const
     // a better way of identifying which outputs are 'the send' and which are
     // 'the change' will need to be implemented (maybe extend CWalletTx to remember
     // which output, if any, was change).
-    if (::IsMine(*this, txout.scriptPubKey))
+    if (IsMine(txout.scriptPubKey))
     {
         CTxDestination address;
         if (!ExtractDestination(txout.scriptPubKey, address))
@@ -1307,14 +1431,77 @@ bool CWallet::IsChange(const CTxOut& txout) const
     return false;
 }
 
+CWallet::RescanProgress::RescanProgress(
+    ): fRescanning(false)
+    , startHeight(-1)
+    , stopHeight(-1)
+    , currentHeight(-1)
+    , startTime(0)
+    , blocksScanned(0u)
+    , blocksToScan(0u)
+    , transactionsFound(0)
+{
+}
+
+std::shared_ptr<const WalletOutputFilter> CWallet::BuildOutputFilter() const
+{
+    AssertLockHeld(cs_wallet);
+    LOCK(cs_KeyStore);
+    std::shared_ptr<WalletOutputFilter> filter = std::make_shared<WalletOutputFilter>();
+    std::set<CKeyID> keyIds;
+    GetKeys(keyIds);
+    for (const CKeyID& keyId: keyIds)
+        filter->AddKey(keyId);
+    for (const std::pair<const CKeyID, CHDPubKey>& hdPubKey: mapHdPubKeys)
+        filter->AddKey(hdPubKey.first);
+    for (const std::pair<const CScriptID, CScript>& redeemScript: mapScripts)
+        filter->AddScriptHash(redeemScript.first);
+    for (const CScript& watchedScript: setWatchOnly)
+        filter->AddScript(watchedScript);
+    for (const CScript& multiSigScript: setMultiSig)
+        filter->AddScript(multiSigScript);
+    return filter;
+}
+
+bool CWallet::IsOrSpendsWalletTransaction(const CTransaction& tx) const
+{
+    if (GetWalletTx(tx.GetHash()) != nullptr)
+        return true;
+    for (const CTxIn& txin: tx.vin) {
+        if (GetWalletTx(txin.prevout.hash) != nullptr)
+            return true;
+    }
+    return false;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * The blocks are read ahead on -rescanthreads threads, which also mark the
+ * transactions paying to the wallet's keys and scripts. Only those, and
+ * the ones spending or updating wallet transactions, are checked here.
  */
+namespace
+{
+/** Block filters from the block filter index, when it is on */
+class BlockFilterIndexReader: public I_BlockFilterReader
+{
+public:
+    virtual bool ReadBlockFilter(const CBlockIndex* blockIndex, BlockFilter& filter) const
+    {
+        return GetBlockFilter(blockIndex, filter);
+    }
+};
+}
+
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     static const CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
+    static const BlockDiskDataReader blockReader;
+    static const BlockFilterIndexReader blockFilterReader;
+    const unsigned nRescanThreads = std::max(0, std::min((int)settings.GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS), MAX_RESCAN_THREADS));
 
     int ret = 0;
     int64_t nNow = GetTime();
@@ -1328,30 +1515,79 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive_.Next(pindex);
 
+        std::vector<const CBlockIndex*> blocksToScan;
+        for (const CBlockIndex* pindexToScan = pindex; pindexToScan; pindexToScan = chainActive_.Next(pindexToScan))
+            blocksToScan.push_back(pindexToScan);
+        {
+            LOCK(cs_rescanProgress_);
+            rescanProgress_ = RescanProgress();
+            rescanProgress_.fRescanning = true;
+            rescanProgress_.startTime = GetTime();
+            rescanProgress_.blocksToScan = blocksToScan.size();
+            if (!blocksToScan.empty()) {
+                rescanProgress_.startHeight = blocksToScan.front()->nHeight;
+                rescanProgress_.stopHeight = blocksToScan.back()->nHeight;
+            }
+        }
+
         ShowProgress(translate("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = checkpointsVerifier.GuessVerificationProgress(pindex, false);
         double dProgressTip = checkpointsVerifier.GuessVerificationProgress(chainActive_.Tip(), false);
-        while (pindex) {
+
+        WalletDatabaseGroupCommit groupCommit(settings,strWalletFile);
+        unsigned filterVersion = keyStoreVersion_;
+        std::shared_ptr<const WalletOutputFilter> filter = BuildOutputFilter();
+        RescanBlockReader reader(blockReader, blocksToScan, filter, nRescanThreads, RESCAN_BLOCKS_AHEAD_PER_THREAD * std::max(nRescanThreads, 1u), &blockFilterReader);
+        RescanBlockReader::ScannedBlock scannedBlock;
+        while (reader.Next(scannedBlock)) {
+            pindex = const_cast<CBlockIndex*>(scannedBlock.pindex);
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
                 ShowProgress(translate("Rescanning..."), std::max(1, std::min(99, (int)((checkpointsVerifier.GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-            BOOST_FOREACH (CTransaction& tx, block.vtx) {
+            // Blocks marked before keys were added since are checked in full,
+            // including those their block filter ruled out for the older keys
+            const bool fMarkedWithCurrentKeys = scannedBlock.filter == filter;
+            if (scannedBlock.fSkipped && !fMarkedWithCurrentKeys)
+                blockReader.ReadBlock(pindex, *scannedBlock.block);
+            const CBlock& block = *scannedBlock.block;
+            for (size_t nTx = 0; nTx < block.vtx.size(); nTx++) {
+                const CTransaction& tx = block.vtx[nTx];
+                if (fMarkedWithCurrentKeys && !scannedBlock.paysToFilter[nTx] && !IsOrSpendsWalletTransaction(tx))
+                    continue;
                 if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
                     ret++;
             }
-            pindex = chainActive_.Next(pindex);
+            if (keyStoreVersion_ != filterVersion) {
+                filterVersion = keyStoreVersion_;
+                filter = BuildOutputFilter();
+                reader.SetFilter(filter);
+            }
+            {
+                LOCK(cs_rescanProgress_);
+                rescanProgress_.currentHeight = pindex->nHeight;
+                ++rescanProgress_.blocksScanned;
+                rescanProgress_.transactionsFound = ret;
+            }
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, checkpointsVerifier.GuessVerificationProgress(pindex));
             }
         }
+        {
+            LOCK(cs_rescanProgress_);
+            rescanProgress_.fRescanning = false;
+        }
         ShowProgress(translate("Rescanning..."), 100); // hide progress dialog in GUI
     }
     return ret;
 }
 
+CWallet::RescanProgress CWallet::GetRescanProgress() const
+{
+    LOCK(cs_rescanProgress_);
+    return rescanProgress_;
+}
+
 void CWallet::ReacceptWalletTransactions()
 {
     LOCK2(cs_main, cs_wallet);
@@ -1484,29 +1720,95 @@ void CWallet::ResendWalletTransactions()
  * @{
  */
 
+CWallet::BalanceCache::BalanceCache(
+    ): valid(false)
+    , coinsVersion(0u)
+    , tipHash()
+    , zeroConfirmationSpending(false)
+    , unconfirmedTransactions()
+    , balance(0)
+    , unconfirmedBalance(0)
+    , immatureBalance(0)
+    , spendableBalance(0)
+    , stakingBalance(0)
+    , watchOnlyBalance(0)
+    , unconfirmedWatchOnlyBalance(0)
+    , immatureWatchOnlyBalance(0)
+{
+}
+
+bool CWallet::BalanceCacheIsCurrent() const
+{
+    const CBlockIndex* chainTip = chainActive_.Tip();
+    if (!balanceCache_.valid ||
+        balanceCache_.coinsVersion != stakeCoinsVersion_ ||
+        balanceCache_.tipHash != (chainTip ? chainTip->GetBlockHash() : uint256()) ||
+        balanceCache_.zeroConfirmationSpending != allowSpendingZeroConfirmationOutputs)
+        return false;
+
+    // Only the transactions that are not in a block yet can change without the wallet or tip changing
+    for (const auto& unconfirmed: balanceCache_.unconfirmedTransactions) {
+        const CWalletTx* pcoin = GetWalletTx(unconfirmed.first);
+        if (pcoin == nullptr ||
+            mempool.exists(unconfirmed.first) != unconfirmed.second.first ||
+            IsFinalTx(*pcoin, chainActive_) != unconfirmed.second.second)
+            return false;
+    }
+    return true;
+}
+
+const CWallet::BalanceCache& CWallet::GetCachedBalances() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    if (BalanceCacheIsCurrent())
+        return balanceCache_;
+
+    BalanceCache balances;
+    const CBlockIndex* chainTip = chainActive_.Tip();
+    balances.coinsVersion = stakeCoinsVersion_;
+    balances.tipHash = chainTip ? chainTip->GetBlockHash() : uint256();
+    balances.zeroConfirmationSpending = allowSpendingZeroConfirmationOutputs;
+    for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
+        const CWalletTx* pcoin = &(*it).second;
+        const bool isFinal = IsFinalTx(*pcoin, chainActive_);
+        const int depth = pcoin->GetNumberOfBlockConfirmations();
+        if (depth <= 0)
+            balances.unconfirmedTransactions.push_back(std::make_pair((*it).first, std::make_pair(depth == 0, isFinal)));
+
+        if (IsTrusted(*pcoin)) {
+            balances.balance += GetAvailableCredit(*pcoin);
+            balances.spendableBalance += GetCreditByCoinType(*pcoin, ALL_SPENDABLE_COINS);
+            balances.stakingBalance += GetCreditByCoinType(*pcoin, STAKABLE_COINS);
+            balances.watchOnlyBalance += GetAvailableWatchOnlyCredit(*pcoin);
+        } else if (!isFinal || depth == 0) {
+            balances.unconfirmedBalance += GetAvailableCredit(*pcoin);
+            balances.unconfirmedWatchOnlyBalance += GetAvailableWatchOnlyCredit(*pcoin);
+        }
+        balances.immatureBalance += GetImmatureCredit(*pcoin);
+        balances.immatureWatchOnlyBalance += GetImmatureWatchOnlyCredit(*pcoin);
+    }
+    balances.valid = true;
+    balanceCache_ = balances;
+    return balanceCache_;
+}
+
 CAmount CWallet::GetStakingBalance() const
 {
-    return GetBalanceByCoinType(STAKABLE_COINS);
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().stakingBalance;
 }
 
 CAmount CWallet::GetSpendableBalance() const
 {
-    return GetBalanceByCoinType(ALL_SPENDABLE_COINS);
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().spendableBalance;
 }
 
 CAmount CWallet::GetBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (IsTrusted(*pcoin))
-                nTotal += GetAvailableCredit(*pcoin);
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().balance;
 }
 
 CAmount CWallet::GetBalanceByCoinType(AvailableCoinsType coinType) const
@@ -1517,86 +1819,49 @@ CAmount CWallet::GetBalanceByCoinType(AvailableCoinsType coinType) const
         for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
             const CWalletTx* pcoin = &(*it).second;
             if (IsTrusted(*pcoin))
-            {
-                int coinTypeEncoding = static_cast<int>(coinType) << 4;
-                int additionalFilterFlags = REQUIRE_UNSPENT | REQUIRE_AVAILABLE_TYPE | coinTypeEncoding;
-                if(coinType==STAKABLE_COINS) additionalFilterFlags |= REQUIRE_UNLOCKED;
-                nTotal += ComputeCredit(*pcoin,ISMINE_SPENDABLE, additionalFilterFlags);
-            }
-
+                nTotal += GetCreditByCoinType(*pcoin, coinType);
         }
     }
 
     return nTotal;
 }
 
+CAmount CWallet::GetCreditByCoinType(const CWalletTx& walletTransaction, AvailableCoinsType coinType) const
+{
+    int coinTypeEncoding = static_cast<int>(coinType) << 4;
+    int additionalFilterFlags = REQUIRE_UNSPENT | REQUIRE_AVAILABLE_TYPE | coinTypeEncoding;
+    if(coinType==STAKABLE_COINS) additionalFilterFlags |= REQUIRE_UNLOCKED;
+    return ComputeCredit(walletTransaction,ISMINE_SPENDABLE, additionalFilterFlags);
+}
+
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin, chainActive_) || (!IsTrusted(*pcoin) && pcoin->GetNumberOfBlockConfirmations() == 0))
-                nTotal += GetAvailableCredit(*pcoin);
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().unconfirmedBalance;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += GetImmatureCredit(*pcoin);
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().immatureBalance;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (IsTrusted(*pcoin))
-                nTotal += GetAvailableWatchOnlyCredit(*pcoin);
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().watchOnlyBalance;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin, chainActive_) || (!IsTrusted(*pcoin) && pcoin->GetNumberOfBlockConfirmations() == 0))
-                nTotal += GetAvailableWatchOnlyCredit(*pcoin);
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().unconfirmedWatchOnlyBalance;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += GetImmatureWatchOnlyCredit(*pcoin);
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().immatureWatchOnlyBalance;
 }
 
 /**
@@ -1632,7 +1897,8 @@ bool CWallet::IsAvailableForSpending(
 {
     isminetype mine;
     VaultType vaultType;
-    if(!IsAvailableType(*this,pcoin->vout[i].scriptPubKey,coinType,mine,vaultType))
+    mine = IsMine(pcoin->vout[i].scriptPubKey, vaultType);
+    if(!IsAvailableVaultType(coinType, vaultType))
     {
         return false;
     }
@@ -1662,6 +1928,35 @@ bool CWallet::IsAvailableForSpending(
     fIsSpendable = (mine & ISMINE_SPENDABLE) != ISMINE_NO || (mine & ISMINE_MULTISIG) != ISMINE_NO;
     return true;
 }
+void CWallet::AppendAvailableCoins(
+    const CWalletTx* pcoin,
+    bool fOnlyConfirmed,
+    bool fIncludeZeroValue,
+    AvailableCoinsType nCoinType,
+    CAmount nExactValue,
+    std::vector<COutput>& vCoins) const
+{
+    int nDepth = 0;
+    if(!SatisfiesMinimumDepthRequirements(pcoin,nDepth,fOnlyConfirmed))
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+    {
+        bool found = (nExactValue>0)? pcoin->vout[i].nValue == nExactValue : true;
+        if (!found) continue;
+
+        bool fIsSpendable = false;
+        if(!IsAvailableForSpending(pcoin,i,fIncludeZeroValue,fIsSpendable,nCoinType))
+        {
+            continue;
+        }
+
+        vCoins.emplace_back(COutput(pcoin, i, nDepth, fIsSpendable));
+    }
+}
+
 void CWallet::AvailableCoins(
     std::vector<COutput>& vCoins,
     bool fOnlyConfirmed,
@@ -1673,29 +1968,27 @@ void CWallet::AvailableCoins(
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : transactionRecord_->mapWallet)
+        if (unspentCandidatesStale_.exchange(false))
         {
-            const CWalletTx* pcoin = &entry.second;
-
-            int nDepth = 0;
-            if(!SatisfiesMinimumDepthRequirements(pcoin,nDepth,fOnlyConfirmed))
+            unspentCandidates_.clear();
+            for (const auto& entry : transactionRecord_->mapWallet)
             {
-                continue;
+                if (MayHoldUnspentOutputs(entry.second))
+                    unspentCandidates_.insert(entry.first);
             }
+        }
 
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+        // Candidates are visited in hash order, like the wallet itself, so the coins come out in the same order
+        for (std::set<uint256>::const_iterator it = unspentCandidates_.begin(); it != unspentCandidates_.end();)
+        {
+            const CWalletTx* pcoin = GetWalletTx(*it);
+            if (pcoin == nullptr || !MayHoldUnspentOutputs(*pcoin))
             {
-                bool found = (nExactValue>0)? pcoin->vout[i].nValue == nExactValue : true;
-                if (!found) continue;
-
-                bool fIsSpendable = false;
-                if(!IsAvailableForSpending(pcoin,i,fIncludeZeroValue,fIsSpendable,nCoinType))
-                {
-                    continue;
-                }
-
-                vCoins.emplace_back(COutput(pcoin, i, nDepth, fIsSpendable));
+                it = unspentCandidates_.erase(it);
+                continue;
             }
+            ++it;
+            AppendAvailableCoins(pcoin, fOnlyConfirmed, fIncludeZeroValue, nCoinType, nExactValue, vCoins);
         }
     }
 }
@@ -1770,13 +2063,98 @@ static void ApproximateSmallestCoinSubsetForPayment(
     }
 }
 
-bool CWallet::SelectStakeCoins(std::set<StakableCoin>& setCoins) const
+bool CWallet::MayHoldStakableOutputs(const CWalletTx& walletTransaction) const
+{
+    for (unsigned int i = 0; i < walletTransaction.vout.size(); i++)
+    {
+        isminetype mine;
+        VaultType vaultType;
+        mine = IsMine(walletTransaction.vout[i].scriptPubKey, vaultType);
+        if (IsAvailableVaultType(STAKABLE_COINS, vaultType) &&
+            mine != ISMINE_NO && mine != ISMINE_WATCH_ONLY && !IsSpent(walletTransaction, i))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CWallet::UpdateStakeCandidates(const CWalletTx& walletTransaction)
+{
+    // Spent transactions are only dropped when coins are next selected
+    if (!stakeCandidatesStale_ && MayHoldStakableOutputs(walletTransaction))
+        stakeCandidates_.insert(walletTransaction.GetHash());
+    ++stakeCoinsVersion_;
+}
+
+bool CWallet::MayHoldUnspentOutputs(const CWalletTx& walletTransaction) const
+{
+    for (unsigned int i = 0; i < walletTransaction.vout.size(); i++)
+    {
+        // Outputs spent by unconfirmed transactions are kept, those spends can drop out of the mempool
+        if (!outputTracker_->IsSpentInBlock(walletTransaction.GetHash(), i) && IsMine(walletTransaction.vout[i]) != ISMINE_NO)
+            return true;
+    }
+    return false;
+}
+
+void CWallet::UpdateUnspentCandidates(const CWalletTx& walletTransaction)
+{
+    // Spent transactions are only dropped when coins are next listed
+    if (!unspentCandidatesStale_ && MayHoldUnspentOutputs(walletTransaction))
+        unspentCandidates_.insert(walletTransaction.GetHash());
+}
+
+unsigned CWallet::GetStakeCoinsVersion() const
 {
-    CAmount nTargetAmount = GetStakingBalance();
+    return stakeCoinsVersion_;
+}
+
+void CWallet::MarkStakeCandidatesStale()
+{
+    stakeCandidatesStale_ = true;
+    unspentCandidatesStale_ = true;
+    ++stakeCoinsVersion_;
+}
+
+bool CWallet::SelectStakeCoins(std::set<StakableCoin>& setCoins, int64_t& nextChangeTime, int& nextChangeHeight) const
+{
+    LOCK2(cs_main, cs_wallet);
+    if (stakeCandidatesStale_.exchange(false))
+    {
+        stakeCandidates_.clear();
+        for (const auto& entry : transactionRecord_->mapWallet)
+        {
+            if (MayHoldStakableOutputs(entry.second))
+                stakeCandidates_.insert(entry.first);
+        }
+    }
+
+    nextChangeTime = std::numeric_limits<int64_t>::max();
+    nextChangeHeight = std::numeric_limits<int>::max();
+    const int chainHeight = chainActive_.Height();
+
+    // Candidates are visited in hash order, like the wallet itself, so the selection is unchanged
+    CAmount nTargetAmount = 0;
     std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, false, STAKABLE_COINS);
-    CAmount nAmountSelected = 0;
+    for (std::set<uint256>::const_iterator it = stakeCandidates_.begin(); it != stakeCandidates_.end();)
+    {
+        const CWalletTx* pcoin = GetWalletTx(*it);
+        if (pcoin == nullptr || !MayHoldStakableOutputs(*pcoin))
+        {
+            it = stakeCandidates_.erase(it);
+            continue;
+        }
+        ++it;
 
+        if (IsTrusted(*pcoin))
+            nTargetAmount += GetCreditByCoinType(*pcoin, STAKABLE_COINS);
+        if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0)
+            nextChangeHeight = std::min(nextChangeHeight, chainHeight + pcoin->GetBlocksToMaturity());
+        AppendAvailableCoins(pcoin, true, false, STAKABLE_COINS, CAmount(0), vCoins);
+    }
+
+    CAmount nAmountSelected = 0;
     for (const COutput& out : vCoins) {
         //make sure not to outrun target amount
         if (nAmountSelected + out.tx->vout[out.i].nValue > nTargetAmount)
@@ -1790,11 +2168,18 @@ bool CWallet::SelectStakeCoins(std::set<StakableCoin>& setCoins) const
 
         //check for min age
         if (std::max(int64_t(0),GetAdjustedTime() - nTxTime) < Params().GetMinCoinAgeForStaking())
+        {
+            nextChangeTime = std::min(nextChangeTime, nTxTime + Params().GetMinCoinAgeForStaking());
             continue;
+        }
 
         //check that it is matured
-        if (out.nDepth < (out.tx->IsCoinStake() ? Params().COINBASE_MATURITY() : 10))
+        const int nRequiredDepth = out.tx->IsCoinStake() ? Params().COINBASE_MATURITY() : 10;
+        if (out.nDepth < nRequiredDepth)
+        {
+            nextChangeHeight = std::min(nextChangeHeight, chainHeight + nRequiredDepth - out.nDepth);
             continue;
+        }
 
         //add to our stake set
         setCoins.insert(StakableCoin(out.tx, out.i,out.tx->hashBlock));
@@ -1923,6 +2308,7 @@ bool CWallet::SelectCoinsMinConf(
 DBErrors CWallet::ReorderTransactionsByTimestamp()
 {
     LOCK(cs_wallet);
+    WalletDatabaseGroupCommit groupCommit(settings,strWalletFile);
     CWalletDB walletdb(settings,strWalletFile);
     // Old wallets didn't have any defined order for transactions
     // Probably a bad idea to change the output of this
@@ -1983,7 +2369,7 @@ DBErrors CWallet::ReorderTransactionsByTimestamp()
     }
     UpdateNextTransactionIndexAvailable(_orderedTransactionIndex);
     walletdb.WriteOrderPosNext(_orderedTransactionIndex);
-    return DB_LOAD_OK;
+    return groupCommit.Commit() ? DB_LOAD_OK : DB_LOAD_FAIL;
 }
 
 int64_t CWallet::GetNextTransactionIndexAvailable() const
@@ -2096,21 +2482,36 @@ static FeeSufficiencyStatus CheckFeesAreSufficientAndUpdateFeeAsNeeded(
     return FeeSufficiencyStatus::HAS_ENOUGH_FEES;
 }
 
+static CTransaction SignInputsWithSigningKeys(
+    const CKeyStore& signingKeyStore,
+    const std::set<COutput>& setCoins,
+    CMutableTransaction& txWithoutChange)
+{
+    std::vector<CScript> scriptPubKeys;
+    scriptPubKeys.reserve(setCoins.size());
+    for(const COutput& coin: setCoins)
+    {
+        scriptPubKeys.push_back(coin.tx->vout[coin.i].scriptPubKey);
+    }
+    if (!ParallelInputSigner(signingKeyStore).SignInputs(txWithoutChange, scriptPubKeys))
+    {
+        return CTransaction();
+    }
+    return CTransaction(txWithoutChange);
+}
+
 static CTransaction SignInputs(
     const CKeyStore& keyStore,
     const std::set<COutput>& setCoins,
     CMutableTransaction& txWithoutChange)
 {
-    // Sign
-    int nIn = 0;
+    // The keys are looked up once, under the wallet lock held by the caller, before the inputs are signed in parallel
+    CBasicKeyStore signingKeyStore;
     for(const COutput& coin: setCoins)
     {
-        if (!SignSignature(keyStore, *coin.tx, txWithoutChange, nIn++))
-        {
-            return CTransaction();
-        }
+        ParallelInputSigner::CopySigningKeys(keyStore, coin.tx->vout[coin.i].scriptPubKey, signingKeyStore);
     }
-    return CTransaction(txWithoutChange);
+    return SignInputsWithSigningKeys(signingKeyStore, setCoins, txWithoutChange);
 }
 
 static void AttachChangeOutput(
@@ -2253,6 +2654,8 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey)
             // duration of this scope.  This is the only place where this optimization
             // maybe makes sense; please don't do it anywhere else.
             CWalletDB* pwalletdb = fFileBacked ? new CWalletDB(settings,strWalletFile, "r") : NULL;
+            // The transaction, the spent coins and the kept key are written together
+            WalletDatabaseGroupCommit groupCommit(settings,strWalletFile);
 
             // Take key pair from key pool so it won't be used again
             reservekey.KeepKey();
@@ -2280,8 +2683,12 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey)
                 }
             }
 
+            const bool fStored = groupCommit.Commit();
             if (fFileBacked)
                 delete pwalletdb;
+            // Never broadcast a transaction the wallet file may not know of
+            if (!fStored)
+                return error("CommitTransaction() : writing the transaction %s to the wallet failed", wtxNew.GetHash());
         }
 
         // Broadcast
@@ -2312,6 +2719,164 @@ std::pair<std::string,bool> CWallet::SendMoney(
     return {std::string(""),true};
 }
 
+namespace
+{
+void SignPayoutTransactions(
+    const CKeyStore& signingKeyStore,
+    const std::vector<std::set<COutput> >& inputs,
+    std::vector<CMutableTransaction>& unsignedTransactions,
+    std::vector<CTransaction>& signedTransactions,
+    size_t begin,
+    size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+        signedTransactions[i] = SignInputsWithSigningKeys(signingKeyStore, inputs[i], unsignedTransactions[i]);
+}
+} // anonymous namespace
+
+std::pair<std::string,bool> CWallet::SendPayouts(
+    const std::vector<std::pair<CScript, CAmount> >& payouts,
+    unsigned maxPayoutsPerTransaction,
+    const CWalletTx& wtxTemplate,
+    std::vector<CWalletTx>& payoutTransactions)
+{
+    payoutTransactions.clear();
+    if (payouts.empty())
+    {
+        return {translate("Must provide at least one destination for funds."),false};
+    }
+    if (maxPayoutsPerTransaction == 0)
+    {
+        maxPayoutsPerTransaction = DEFAULT_PAYOUTS_PER_TRANSACTION;
+    }
+
+    LOCK2(cs_main, cs_wallet);
+    std::vector<COutput> vCoins;
+    AvailableCoins(vCoins, true, false, ALL_SPENDABLE_COINS);
+    const I_CoinSelectionAlgorithm* coinSelector = defaultCoinSelectionAlgorithm_.get();
+
+    std::vector<CMutableTransaction> unsignedTransactions;
+    std::vector<std::set<COutput> > inputs;
+    std::vector<CAmount> valuesSent;
+    std::vector<CAmount> fees;
+    // Every transaction holds on to its own change key until the batch is committed
+    std::vector<std::unique_ptr<CReserveKey> > changeKeys;
+    CBasicKeyStore signingKeyStore;
+    for (size_t first = 0; first < payouts.size(); first += maxPayoutsPerTransaction)
+    {
+        const std::vector<std::pair<CScript, CAmount> > recipients(
+            payouts.begin() + first,
+            payouts.begin() + std::min<size_t>(payouts.size(), first + maxPayoutsPerTransaction));
+        CMutableTransaction txNew;
+        AppendOutputs(recipients,txNew);
+        if(!EnsureNoOutputsAreDust(txNew))
+        {
+            return {translate("Transaction output(s) amount too small"),false};
+        }
+        const CAmount totalValueToSend = txNew.GetValueOut();
+        if(!(totalValueToSend > 0))
+        {
+            return {translate("Transaction amounts must be positive. Total output may not exceed limits."),false};
+        }
+
+        changeKeys.push_back(std::unique_ptr<CReserveKey>(new CReserveKey(*this)));
+        CPubKey changePubKey;
+        if (!changeKeys.back()->GetReservedKey(changePubKey, true))
+        {
+            return {translate("Keypool ran out, please call keypoolrefill first"),false};
+        }
+        CTxOut changeOutput;
+        changeOutput.scriptPubKey = GetScriptForDestination(changePubKey.GetID());
+
+        CAmount nFeeRet = 0;
+        const std::set<COutput> setCoins = coinSelector->SelectCoins(txNew,vCoins,nFeeRet);
+        const CAmount nValueIn = AttachInputs(setCoins,txNew);
+        const CAmount nTotalValue = totalValueToSend + nFeeRet;
+        if (setCoins.empty() || nValueIn < nTotalValue)
+        {
+            return {translate("Insufficient funds to meet coin selection algorithm requirements."),false};
+        }
+        if(!SetChangeOutput(nValueIn,nTotalValue,txNew,nFeeRet,changeOutput))
+        {
+            changeKeys.back()->ReturnKey();
+        }
+
+        // Later transactions of the batch select from the coins left over
+        std::vector<COutput> coinsLeft;
+        coinsLeft.reserve(vCoins.size());
+        for(const COutput& coin: vCoins)
+        {
+            if(!setCoins.count(coin))
+            {
+                coinsLeft.push_back(coin);
+            }
+        }
+        vCoins.swap(coinsLeft);
+        for(const COutput& coin: setCoins)
+        {
+            ParallelInputSigner::CopySigningKeys(*this, coin.tx->vout[coin.i].scriptPubKey, signingKeyStore);
+        }
+
+        unsignedTransactions.push_back(txNew);
+        inputs.push_back(setCoins);
+        valuesSent.push_back(totalValueToSend);
+        fees.push_back(nFeeRet);
+    }
+
+    std::vector<CTransaction> signedTransactions(unsignedTransactions.size());
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(boost::thread::hardware_concurrency(), unsignedTransactions.size()));
+    const size_t nPerThread = (unsignedTransactions.size() + nThreads - 1) / nThreads;
+    boost::thread_group signers;
+    for (size_t n = 1; n < nThreads; n++)
+    {
+        const size_t begin = std::min(unsignedTransactions.size(), n * nPerThread);
+        const size_t end = std::min(unsignedTransactions.size(), begin + nPerThread);
+        signers.create_thread(boost::bind(&SignPayoutTransactions, boost::cref(signingKeyStore), boost::cref(inputs), boost::ref(unsignedTransactions), boost::ref(signedTransactions), begin, end));
+    }
+    SignPayoutTransactions(signingKeyStore, inputs, unsignedTransactions, signedTransactions, 0, std::min(unsignedTransactions.size(), nPerThread));
+    signers.join_all();
+
+    for (size_t i = 0; i < signedTransactions.size(); i++)
+    {
+        if(signedTransactions[i].IsNull())
+        {
+            return {translate("Signing transaction failed"),false};
+        }
+        CAmount nFeeRet = fees[i];
+        const FeeSufficiencyStatus status = CheckFeesAreSufficientAndUpdateFeeAsNeeded(signedTransactions[i],inputs[i],valuesSent[i],nFeeRet);
+        if(status == FeeSufficiencyStatus::TX_TOO_LARGE)
+        {
+            return {translate("Transaction too large, pay fewer recipients per transaction"),false};
+        }
+        else if(status == FeeSufficiencyStatus::NEEDS_MORE_FEES)
+        {
+            return {translate("Selected too few inputs to meet fees"),false};
+        }
+    }
+
+    payoutTransactions.reserve(signedTransactions.size());
+    for (size_t i = 0; i < signedTransactions.size(); i++)
+    {
+        payoutTransactions.push_back(wtxTemplate);
+        CWalletTx& wtxNew = payoutTransactions.back();
+        wtxNew.fTimeReceivedIsTxTime = true;
+        wtxNew.createdByMe = true;
+        wtxNew.RecomputeCachedQuantities();
+        *static_cast<CTransaction*>(&wtxNew) = signedTransactions[i];
+    }
+
+    for (size_t i = 0; i < payoutTransactions.size(); i++)
+    {
+        if(!CommitTransaction(payoutTransactions[i],*changeKeys[i]))
+        {
+            while (payoutTransactions.size() > i + 1)
+                payoutTransactions.pop_back();
+            return {translate("The transaction was rejected!"),false};
+        }
+    }
+    return {std::string(""),true};
+}
+
 DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
 {
     if (!fFileBacked)
@@ -2334,6 +2899,7 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     if (nLoadWalletRet != DB_LOAD_OK)
         return nLoadWalletRet;
     fFirstRunRet = !vchDefaultKey.IsValid();
+    RebuildTransactionOrderIndex();
 
     uiInterface.LoadWallet(this);
 
@@ -2377,7 +2943,7 @@ bool CWallet::SetAddressBook(const CTxDestination& address, const string& strNam
         if (!strPurpose.empty()) /* update purpose only if requested */
             mapAddressBook[address].purpose = strPurpose;
     }
-    NotifyAddressBookChanged(this, address, strName, ::IsMine(*this, address) != ISMINE_NO,
+    NotifyAddressBookChanged(this, address, strName, IsMine(address) != ISMINE_NO,
                              strPurpose, (fUpdated ? CT_UPDATED : CT_NEW));
     if (!fFileBacked)
         return false;
@@ -2404,6 +2970,7 @@ bool CWallet::NewKeyPool()
 {
     {
         LOCK(cs_wallet);
+        WalletDatabaseGroupCommit groupCommit(settings,strWalletFile);
         CWalletDB walletdb(settings,strWalletFile);
         BOOST_FOREACH(int64_t nIndex, setInternalKeyPool) {
             walletdb.ErasePool(nIndex);
@@ -2419,13 +2986,74 @@ bool CWallet::NewKeyPool()
 
         if (!TopUpKeyPool())
             return false;
+        if (!groupCommit.Commit())
+            return false;
 
         LogPrintf("CWallet::NewKeyPool rewrote keypool\n");
     }
     return true;
 }
 
-bool CWallet::TopUpKeyPool(unsigned int kpSize)
+void CWallet::CountMissingKeyPoolKeys(unsigned int kpSize, int64_t& missingInternal, int64_t& missingExternal)
+{
+    AssertLockHeld(cs_wallet); // setInternalKeyPool, setExternalKeyPool
+    unsigned int nTargetSize;
+    if (kpSize > 0)
+        nTargetSize = kpSize;
+    else
+        nTargetSize = std::max(
+            defaultKeyPoolTopUp? defaultKeyPoolTopUp: settings.GetArg("-keypool", DEFAULT_KEYPOOL_SIZE),
+            (int64_t) 0);
+
+    // count amount of available keys (internal, external)
+    // make sure the keypool of external and internal keys fits the user selected target (-keypool)
+    int64_t amountExternal = setExternalKeyPool.size();
+    int64_t amountInternal = setInternalKeyPool.size();
+    missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountExternal, (int64_t) 0);
+    missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountInternal, (int64_t) 0);
+
+    // don't create extra internal keys
+    if (!IsHDEnabled())
+        missingInternal = 0;
+}
+
+int64_t CWallet::NextKeyPoolIndex() const
+{
+    AssertLockHeld(cs_wallet); // setInternalKeyPool, setExternalKeyPool
+    int64_t nEnd = 1;
+    if (!setInternalKeyPool.empty()) {
+        nEnd = *(--setInternalKeyPool.end()) + 1;
+    }
+    if (!setExternalKeyPool.empty()) {
+        nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
+    }
+    return nEnd;
+}
+
+void CWallet::ForgetKeyPoolKeys(int64_t nFirstIndex)
+{
+    AssertLockHeld(cs_wallet); // setInternalKeyPool, setExternalKeyPool
+    setInternalKeyPool.erase(setInternalKeyPool.lower_bound(nFirstIndex), setInternalKeyPool.end());
+    setExternalKeyPool.erase(setExternalKeyPool.lower_bound(nFirstIndex), setExternalKeyPool.end());
+}
+
+void CWallet::AddKeyToKeyPool(CWalletDB& walletdb, bool fInternal)
+{
+    AssertLockHeld(cs_wallet); // setInternalKeyPool, setExternalKeyPool
+    const int64_t nEnd = NextKeyPoolIndex();
+    // TODO: implement keypools for all accounts?
+    if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(0, fInternal), fInternal)))
+        throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+
+    if (fInternal) {
+        setInternalKeyPool.insert(nEnd);
+    } else {
+        setExternalKeyPool.insert(nEnd);
+    }
+    LogPrintf("keypool added key %d, size=%u, internal=%d\n", nEnd, setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+}
+
+bool CWallet::TopUpKeyPool(unsigned int kpSize, unsigned int nMaxNewKeys)
 {
     {
         LOCK(cs_wallet);
@@ -2434,61 +3062,79 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             return false;
 
         // Top up key pool
-        unsigned int nTargetSize;
-        if (kpSize > 0)
-            nTargetSize = kpSize;
-        else
-            nTargetSize = std::max(
-                defaultKeyPoolTopUp? defaultKeyPoolTopUp: settings.GetArg("-keypool", DEFAULT_KEYPOOL_SIZE),
-                (int64_t) 0);
-
-        // count amount of available keys (internal, external)
-        // make sure the keypool of external and internal keys fits the user selected target (-keypool)
-        int64_t amountExternal = setExternalKeyPool.size();
-        int64_t amountInternal = setInternalKeyPool.size();
-        int64_t missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountExternal, (int64_t) 0);
-        int64_t missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountInternal, (int64_t) 0);
-
-        if (!IsHDEnabled())
-        {
-            // don't create extra internal keys
-            missingInternal = 0;
-        } else {
-            nTargetSize *= 2;
-        }
-        bool fInternal = false;
+        int64_t missingInternal;
+        int64_t missingExternal;
+        CountMissingKeyPoolKeys(kpSize, missingInternal, missingExternal);
+        int64_t missingKeys = missingInternal + missingExternal;
+        if (nMaxNewKeys > 0)
+            missingKeys = std::min(missingKeys, (int64_t) nMaxNewKeys);
+
+        WalletDatabaseGroupCommit groupCommit(settings,strWalletFile);
+        const int64_t nFirstNewIndex = NextKeyPoolIndex();
         CWalletDB walletdb(settings,strWalletFile);
-        for (int64_t i = missingInternal + missingExternal; i--;)
+        for (int64_t i = missingInternal + missingExternal, n = 0; n < missingKeys; n++)
         {
-            int64_t nEnd = 1;
-            if (i < missingInternal) {
-                fInternal = true;
-            }
-            if (!setInternalKeyPool.empty()) {
-                nEnd = *(--setInternalKeyPool.end()) + 1;
-            }
-            if (!setExternalKeyPool.empty()) {
-                nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
-            }
-            // TODO: implement keypools for all accounts?
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(0, fInternal), fInternal)))
-                throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
-
-            if (fInternal) {
-                setInternalKeyPool.insert(nEnd);
-            } else {
-                setExternalKeyPool.insert(nEnd);
-            }
-            LogPrintf("keypool added key %d, size=%u, internal=%d\n", nEnd, setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+            // External keys first, then the internal ones
+            AddKeyToKeyPool(walletdb, --i < missingInternal);
 
-            double dProgress = 100.f * nEnd / (nTargetSize + 1);
+            double dProgress = 100.f * (n + 1) / (missingKeys + 1);
             std::string strMsg = strprintf(translate("Loading wallet... (%3.2f %%)"), dProgress);
             uiInterface.InitMessage(strMsg);
         }
+        // No key is handed out before it is stored
+        if (!groupCommit.Commit()) {
+            ForgetKeyPoolKeys(nFirstNewIndex);
+            throw std::runtime_error(std::string(__func__) + ": writing generated keys failed");
+        }
     }
     return true;
 }
 
+void CWallet::RequestKeyPoolTopUp()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(keyPoolTopUpMutex_);
+        fKeyPoolTopUpRequested_ = true;
+    }
+    keyPoolTopUpRequested_.notify_one();
+}
+
+void CWallet::MaintainKeyPool()
+{
+    while (true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(keyPoolTopUpMutex_);
+            while (!fKeyPoolTopUpRequested_)
+                keyPoolTopUpRequested_.wait(lock);
+            fKeyPoolTopUpRequested_ = false;
+        }
+
+        // Address requests only wait on cs_wallet for one batch at a time
+        while (true)
+        {
+            boost::this_thread::interruption_point();
+            {
+                LOCK(cs_wallet);
+                int64_t missingInternal;
+                int64_t missingExternal;
+                CountMissingKeyPoolKeys(0, missingInternal, missingExternal);
+                if (missingInternal + missingExternal == 0 || IsLocked(true))
+                    break;
+            }
+            if (!TopUpKeyPool(0, KEYPOOL_TOPUP_BATCH_SIZE))
+                break;
+        }
+    }
+}
+
+void ThreadMaintainKeyPool(CWallet* pwallet)
+{
+    RenameThread("izzy-keypool");
+    pwallet->RequestKeyPoolTopUp();
+    pwallet->MaintainKeyPool();
+}
+
 void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool, bool fInternal)
 {
     nIndex = -1;
@@ -2496,12 +3142,24 @@ void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool, bool fIn
     {
         LOCK(cs_wallet);
 
-        if (!IsLocked(true))
-            TopUpKeyPool();
-
         fInternal = fInternal && IsHDEnabled();
         std::set<int64_t>& setKeyPool = fInternal ? setInternalKeyPool : setExternalKeyPool;
 
+        // The keypool maintainer refills the pool, a key is only derived here if it ran dry
+        if (!IsLocked(true)) {
+            if (setKeyPool.empty()) {
+                WalletDatabaseGroupCommit groupCommit(settings,strWalletFile);
+                const int64_t nNewIndex = NextKeyPoolIndex();
+                CWalletDB walletdb(settings,strWalletFile);
+                AddKeyToKeyPool(walletdb, fInternal);
+                if (!groupCommit.Commit()) {
+                    ForgetKeyPoolKeys(nNewIndex);
+                    throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+                }
+            }
+            RequestKeyPoolTopUp();
+        }
+
         // Get the oldest key
         if(setKeyPool.empty())
             return;
@@ -2815,6 +3473,7 @@ void CWallet::LockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    ++stakeCoinsVersion_;
     CWalletTx* txPtr = const_cast<CWalletTx*>(GetWalletTx(output.hash));
     if (txPtr != nullptr) txPtr->RecomputeCachedQuantities(); // recalculate all credits for this tx
 }
@@ -2823,12 +3482,14 @@ void CWallet::UnlockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    ++stakeCoinsVersion_;
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    ++stakeCoinsVersion_;
 }
 
 bool CWallet::IsLockedCoin(uint256 hash, unsigned int n) const
@@ -3151,6 +3812,9 @@ bool CWallet::MoveFundsBetweenAccounts(std::string from, std::string to, CAmount
     walletdb.WriteAccountingEntry(credit);
     if (!walletdb.TxnCommit()) return false;
 
+    transactionOrderIndex_->AddAccountingEntry(debit);
+    transactionOrderIndex_->AddAccountingEntry(credit);
+
     return true;
 }
 
@@ -27,6 +27,12 @@
 #include <OutputEntry.h>
 #include <Output.h>
 
+#include <atomic>
+#include <memory>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
 class I_SignatureSizeEstimator;
 class I_CoinSelectionAlgorithm;
 class CKeyMetadata;
@@ -38,6 +44,7 @@ class CBlockIndex;
 struct StakableCoin;
 class WalletTransactionRecord;
 class SpentOutputTracker;
+class WalletTransactionOrderIndex;
 class BlockMap;
 class CAccountingEntry;
 class CChain;
@@ -51,8 +58,13 @@ class CTxMemPool;
 class CWalletDB;
 class COutPoint;
 class CTxIn;
+class WalletOutputFilter;
+class IsMineCache;
+class CWallet;
 
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
+//! Keep the wallet's keypool topped up ahead of address requests
+void ThreadMaintainKeyPool(CWallet* pwallet);
 
 
 /** (client) version numbers for particular wallet features */
@@ -121,6 +133,7 @@ public:
 private:
     std::unique_ptr<WalletTransactionRecord> transactionRecord_;
     std::unique_ptr<SpentOutputTracker> outputTracker_;
+    std::unique_ptr<WalletTransactionOrderIndex> transactionOrderIndex_;
     const CChain& chainActive_;
     const BlockMap& mapBlockIndex_;
     int64_t orderedTransactionIndex;
@@ -140,6 +153,19 @@ public:
     LockedCoinsSet setLockedCoins;
     int64_t nTimeFirstKey;
     std::map<CKeyID, CHDPubKey> mapHdPubKeys; //<! memory map of HD extended pubkeys
+    //! Where the rescan running, or the last one, has got to
+    struct RescanProgress {
+        bool fRescanning;
+        int startHeight;
+        int stopHeight;
+        int currentHeight;
+        int64_t startTime;
+        unsigned blocksScanned;
+        unsigned blocksToScan;
+        int transactionsFound;
+
+        RescanProgress();
+    };
 private:
     int64_t nNextResend;
     int64_t nLastResend;
@@ -149,7 +175,76 @@ private:
     bool walletStakingOnly;
     bool allowSpendingZeroConfirmationOutputs;
     std::unique_ptr<I_SignatureSizeEstimator> signatureSizeEstimator_;
+    std::unique_ptr<I_CoinSelectionAlgorithm> minimumFeeCoinSelectionAlgorithm_;
     std::unique_ptr<I_CoinSelectionAlgorithm> defaultCoinSelectionAlgorithm_;
+    //! Wallet transactions that may still hold outputs to stake, kept up to date as transactions are added
+    mutable std::set<uint256> stakeCandidates_;
+    //! Set when the keystore changed, so that the candidates are rebuilt from the whole wallet
+    mutable std::atomic<bool> stakeCandidatesStale_;
+    //! Wallet transactions that may still hold outputs of ours that are unspent, kept up to date the same way
+    mutable std::set<uint256> unspentCandidates_;
+    mutable std::atomic<bool> unspentCandidatesStale_;
+    std::atomic<unsigned> stakeCoinsVersion_;
+    //! All balances worked out in one pass over the wallet, reused until the wallet or chain tip
+    //! changes or one of the unconfirmed transactions enters or leaves the mempool or becomes final
+    struct BalanceCache {
+        bool valid;
+        unsigned coinsVersion;
+        uint256 tipHash;
+        bool zeroConfirmationSpending;
+        //! The unconfirmed transactions with whether they were in the mempool and final
+        std::vector<std::pair<uint256, std::pair<bool, bool>>> unconfirmedTransactions;
+        CAmount balance;
+        CAmount unconfirmedBalance;
+        CAmount immatureBalance;
+        CAmount spendableBalance;
+        CAmount stakingBalance;
+        CAmount watchOnlyBalance;
+        CAmount unconfirmedWatchOnlyBalance;
+        CAmount immatureWatchOnlyBalance;
+
+        BalanceCache();
+    };
+    mutable BalanceCache balanceCache_;
+    //! Changes whenever a key, redeem script or watched script is added or removed
+    std::atomic<unsigned> keyStoreVersion_;
+    std::unique_ptr<IsMineCache> isMineCache_;
+    mutable CCriticalSection cs_rescanProgress_;
+    RescanProgress rescanProgress_;
+    boost::mutex keyPoolTopUpMutex_;
+    boost::condition_variable keyPoolTopUpRequested_;
+    bool fKeyPoolTopUpRequested_;
+
+    //! Requires cs_wallet
+    void CountMissingKeyPoolKeys(unsigned int kpSize, int64_t& missingInternal, int64_t& missingExternal);
+    //! Requires cs_wallet
+    void AddKeyToKeyPool(CWalletDB& walletdb, bool fInternal);
+    //! Requires cs_wallet; the index the next key added to the key pool gets
+    int64_t NextKeyPoolIndex() const;
+    //! Requires cs_wallet; takes the keys from nFirstIndex on out of the key pool again, when they could not be stored
+    void ForgetKeyPoolKeys(int64_t nFirstIndex);
+
+    bool MayHoldStakableOutputs(const CWalletTx& walletTransaction) const;
+    void UpdateStakeCandidates(const CWalletTx& walletTransaction);
+    bool MayHoldUnspentOutputs(const CWalletTx& walletTransaction) const;
+    void UpdateUnspentCandidates(const CWalletTx& walletTransaction);
+    //! The height of the active chain block confirming the transaction, or WalletTransactionOrderIndex::UNCONFIRMED_HEIGHT
+    int GetConfirmationHeight(const CWalletTx& walletTransaction) const;
+    void UpdateTransactionOrderIndex(CWalletTx& walletTransaction);
+    void AppendAvailableCoins(
+        const CWalletTx* pcoin,
+        bool fOnlyConfirmed,
+        bool fIncludeZeroValue,
+        AvailableCoinsType nCoinType,
+        CAmount nExactValue,
+        std::vector<COutput>& vCoins) const;
+    CAmount GetCreditByCoinType(const CWalletTx& walletTransaction, AvailableCoinsType coinType) const;
+    bool BalanceCacheIsCurrent() const;
+    //! Requires cs_main and cs_wallet
+    const BalanceCache& GetCachedBalances() const;
+    //! Requires cs_wallet
+    std::shared_ptr<const WalletOutputFilter> BuildOutputFilter() const;
+    bool IsOrSpendsWalletTransaction(const CTransaction& tx) const;
 public:
     int64_t defaultKeyPoolTopUp;
     void toggleSpendingZeroConfirmationOutputs();
@@ -166,7 +261,15 @@ public:
     bool MoveFundsBetweenAccounts(std::string from, std::string to, CAmount amount, std::string comment);
 
     bool MintableCoins();
-    bool SelectStakeCoins(std::set<StakableCoin>& setCoins) const;
+    /**
+     * Select the coins to stake among the stake candidates. Also reports the earliest adjusted time
+     * and chain height at which the selection could change without the wallet itself changing.
+     */
+    bool SelectStakeCoins(std::set<StakableCoin>& setCoins, int64_t& nextChangeTime, int& nextChangeHeight) const;
+    //! Changes whenever a wallet transaction, locked coin, key or watched script may have changed the coins to stake or the balances
+    unsigned GetStakeCoinsVersion() const;
+    //! Rebuild the stake candidates from the whole wallet on the next selection
+    void MarkStakeCandidatesStale();
 
     bool IsSpent(const CWalletTx& wtx, unsigned int n) const;
 
@@ -186,6 +289,8 @@ public:
 
     const CWalletTx* GetWalletTx(const uint256& hash) const;
     std::vector<const CWalletTx*> GetWalletTransactionReferences() const;
+    //! Bytes of memory the wallet transactions take up; walks them all
+    size_t DynamicMemoryUsage() const;
     CWalletTx initializeEmptyWalletTransaction() const;
 
     //! check whether we are allowed to upgrade (or already support) to the named feature
@@ -235,7 +340,7 @@ public:
     //! Adds a key to the store, and saves it to disk.
     bool AddKeyPubKey(const CKey& key, const CPubKey& pubkey);
     //! Adds a key to the store, without saving it to disk (used by LoadWallet)
-    bool LoadKey(const CKey& key, const CPubKey& pubkey) { return CCryptoKeyStore::AddKeyPubKey(key, pubkey); }
+    bool LoadKey(const CKey& key, const CPubKey& pubkey) { ++keyStoreVersion_; return CCryptoKeyStore::AddKeyPubKey(key, pubkey); }
     //! Load metadata (used by LoadWallet)
     bool LoadKeyMetadata(const CPubKey& pubkey, const CKeyMetadata& metadata);
 
@@ -288,18 +393,26 @@ public:
     typedef std::multimap<int64_t, TxPair> TxItems;
 
     /**
-     * Get the wallet's activity log
-     * @return multimap of ordered transactions and accounting entries
-     * @warning Returned pointers are *only* valid within the scope of passed acentries
+     * Get the wallet's activity log, which is kept in order as transactions are added
+     * @return multimap of ordered transactions and accounting entries of all accounts
+     * @warning Returned pointers are *only* valid while cs_wallet is held
      */
-    TxItems OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount = "");
+    const TxItems& OrderedTxItems() const;
+    //! Transactions confirmed above the given height of the active chain, or not confirmed in it
+    std::vector<const CWalletTx*> GetWalletTransactionsAboveHeight(int height) const;
+    //! Rebuild the activity log from the loaded transactions and the accounting entries on disk
+    void RebuildTransactionOrderIndex();
 
     void RecomputeCachedQuantities();
     int64_t SmartWalletTxTimestampEstimation(const CWalletTx& wtxIn);
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet = false);
+    //! Adds the transactions read by LoadWallet together, rather than one AddToWallet at a time
+    void LoadWalletTransactions(const std::vector<CWalletTx>& walletTransactions);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    //! Does not wait for cs_wallet, which a rescan holds throughout
+    RescanProgress GetRescanProgress() const;
     void ReacceptWalletTransactions();
     void ResendWalletTransactions();
     CAmount GetBalance() const;
@@ -329,10 +442,26 @@ public:
         CWalletTx& wtxNew,
         AvailableCoinsType coin_type = ALL_SPENDABLE_COINS,
         const I_CoinSelectionAlgorithm* coinSelector = nullptr);
+    /**
+     * Pays the recipients in transactions of at most maxPayoutsPerTransaction
+     * outputs each, funded from one listing of the available coins and signed
+     * in parallel. Each transaction starts as a copy of wtxTemplate. None are
+     * committed unless all of them could be created.
+     */
+    std::pair<std::string,bool> SendPayouts(
+        const std::vector<std::pair<CScript, CAmount> >& payouts,
+        unsigned maxPayoutsPerTransaction,
+        const CWalletTx& wtxTemplate,
+        std::vector<CWalletTx>& payoutTransactions);
     std::string PrepareObfuscationDenominate(int minRounds, int maxRounds);
 
     bool NewKeyPool();
-    bool TopUpKeyPool(unsigned int kpSize = 0);
+    //! Derives at most nMaxNewKeys keys when that is not 0
+    bool TopUpKeyPool(unsigned int kpSize = 0, unsigned int nMaxNewKeys = 0);
+    //! Has the keypool maintainer top up the keypool without the caller waiting on it
+    void RequestKeyPoolTopUp();
+    //! Tops up the keypool in batches whenever that is requested, until the thread is interrupted
+    void MaintainKeyPool();
     bool GetKeyFromPool(CPubKey& key, bool fInternal);
     int64_t GetOldestKeyPoolTime();
     void GetAllReserveKeys(std::set<CKeyID>& setAddress) const;
@@ -358,6 +487,8 @@ public:
     std::set<CTxDestination> GetAccountAddresses(std::string strAccount) const;
 
     isminetype IsMine(const CScript& scriptPubKey) const;
+    //! Classified once per script until the wallet's keys or scripts change
+    isminetype IsMine(const CScript& scriptPubKey, VaultType& vaultType) const;
     isminetype IsMine(const CTxDestination& dest) const;
     isminetype IsMine(const CTxIn& txin) const;
     CAmount GetDebit(const CTxIn& txin, const isminefilter& filter) const;
@@ -15,6 +15,7 @@
 #include "utiltime.h"
 #include "wallet.h"
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
@@ -269,10 +270,10 @@ void CWalletDB::ListAccountCreditDebit(const string& strAccount, list<CAccountin
     unsigned int fFlags = DB_SET_RANGE;
     while (true) {
         // Read next record
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
         if (fFlags == DB_SET_RANGE)
             ssKey << std::make_pair(std::string("acentry"), std::make_pair((fAllAccounts ? string("") : strAccount), uint64_t(0)));
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
         int ret = ReadAtCursor(pcursor, ssKey, ssValue, fFlags);
         fFlags = DB_NEXT;
         if (ret == DB_NOTFOUND)
@@ -300,6 +301,18 @@ void CWalletDB::ListAccountCreditDebit(const string& strAccount, list<CAccountin
     pcursor->close();
 }
 
+//! Number of wallet transaction records read from the database before they are decoded
+constexpr size_t WALLET_TX_LOAD_BATCH_SIZE = 16384;
+//! Smallest number of records worth handing to a separate decoding thread
+constexpr size_t MIN_WALLET_TX_RECORDS_PER_THREAD = 256;
+
+struct WalletTxRecord {
+    uint256 hash;
+    std::string value;
+
+    WalletTxRecord(const uint256& hashIn, const std::string& valueIn): hash(hashIn), value(valueIn) {}
+};
+
 class CWalletScanState
 {
 public:
@@ -310,6 +323,9 @@ public:
     bool fAnyUnordered;
     int nFileVersion;
     std::vector<uint256> vWalletUpgrade;
+    //! Transaction records are set aside to be decoded and added in batches
+    bool fDeferTransactions;
+    std::vector<WalletTxRecord> vDeferredTransactions;
 
     CWalletScanState()
     {
@@ -317,10 +333,106 @@ public:
         fIsEncrypted = false;
         fAnyUnordered = false;
         nFileVersion = 0;
+        fDeferTransactions = false;
+    }
+};
+
+namespace
+{
+/** Read a transaction record, undoing the serialization changes of 31600. */
+bool DecodeWalletTx(const uint256& hash, CSecureDataStream& ssValue, CWalletTx& wtx, bool& fUpgraded, string& strErr)
+{
+    ssValue >> wtx;
+    if (wtx.GetHash() != hash)
+        return false;
+
+    fUpgraded = false;
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
+        if (!ssValue.empty()) {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        } else {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
     }
+    return true;
+}
+
+struct DecodedWalletTx {
+    CWalletTx wtx;
+    bool fValid;
+    bool fUpgraded;
+    std::string strErr;
+
+    explicit DecodedWalletTx(const CWalletTx& emptyWalletTx): wtx(emptyWalletTx), fValid(false), fUpgraded(false), strErr() {}
 };
 
-bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CWalletScanState& wss, string& strType, string& strErr)
+void DecodeWalletTxRecords(
+    const std::vector<WalletTxRecord>& records,
+    std::vector<DecodedWalletTx>& decoded,
+    size_t begin,
+    size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        try {
+            CSecureDataStream ssValue(records[i].value.data(), records[i].value.data() + records[i].value.size(), SER_DISK, CLIENT_VERSION);
+            decoded[i].fValid = DecodeWalletTx(records[i].hash, ssValue, decoded[i].wtx, decoded[i].fUpgraded, decoded[i].strErr);
+        } catch (const std::exception&) {
+            decoded[i].fValid = false;
+        }
+    }
+}
+
+/**
+ * Deserialize the deferred transaction records split over several threads, then add
+ * the ones that decoded to the wallet in one pass.
+ * @return false if any record could not be read
+ */
+bool LoadDeferredTransactions(CWallet* pwallet, CWalletScanState& wss)
+{
+    const std::vector<WalletTxRecord>& records = wss.vDeferredTransactions;
+    std::vector<DecodedWalletTx> decoded(records.size(), DecodedWalletTx(pwallet->initializeEmptyWalletTransaction()));
+
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(boost::thread::hardware_concurrency(), records.size() / MIN_WALLET_TX_RECORDS_PER_THREAD));
+    const size_t nPerThread = (records.size() + nThreads - 1) / nThreads;
+    boost::thread_group decoders;
+    for (size_t n = 1; n < nThreads; n++) {
+        const size_t begin = std::min(records.size(), n * nPerThread);
+        const size_t end = std::min(records.size(), begin + nPerThread);
+        decoders.create_thread(boost::bind(&DecodeWalletTxRecords, boost::cref(records), boost::ref(decoded), begin, end));
+    }
+    DecodeWalletTxRecords(records, decoded, 0, std::min(records.size(), nPerThread));
+    decoders.join_all();
+
+    bool fAllRead = true;
+    std::vector<CWalletTx> walletTransactions;
+    walletTransactions.reserve(decoded.size());
+    for (size_t i = 0; i < decoded.size(); i++) {
+        if (!decoded[i].strErr.empty())
+            LogPrintf("%s\n", decoded[i].strErr);
+        if (!decoded[i].fValid) {
+            fAllRead = false;
+            continue;
+        }
+        if (decoded[i].fUpgraded)
+            wss.vWalletUpgrade.push_back(records[i].hash);
+        if (decoded[i].wtx.nOrderPos == -1)
+            wss.fAnyUnordered = true;
+        walletTransactions.push_back(decoded[i].wtx);
+    }
+    pwallet->LoadWalletTransactions(walletTransactions);
+    wss.vDeferredTransactions.clear();
+    return fAllRead;
+}
+} // anonymous namespace
+
+bool ReadKeyValue(CWallet* pwallet, CSecureDataStream& ssKey, CSecureDataStream& ssValue, CWalletScanState& wss, string& strType, string& strErr)
 {
     try {
         // Unserialize
@@ -338,28 +450,16 @@ bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CW
         } else if (strType == "tx") {
             uint256 hash;
             ssKey >> hash;
+            if (wss.fDeferTransactions) {
+                wss.vDeferredTransactions.push_back(WalletTxRecord(hash, std::string(ssValue.begin(), ssValue.end())));
+                return true;
+            }
             CWalletTx wtx = pwallet->initializeEmptyWalletTransaction();
-            ssValue >> wtx;
-            CValidationState state;
-            // false because there is no reason to go through the zerocoin checks for our own wallet
-            if (wtx.GetHash() != hash)
+            bool fUpgraded = false;
+            if (!DecodeWalletTx(hash, ssValue, wtx, fUpgraded, strErr))
                 return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
-                if (!ssValue.empty()) {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                        wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                } else {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
+            if (fUpgraded)
                 wss.vWalletUpgrade.push_back(hash);
-            }
 
             if (wtx.nOrderPos == -1)
                 wss.fAnyUnordered = true;
@@ -583,6 +683,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
 {
     pwallet->vchDefaultKey = CPubKey();
     CWalletScanState wss;
+    wss.fDeferTransactions = true;
     bool fNoncriticalErrors = false;
     DBErrors result = DB_LOAD_OK;
 
@@ -602,10 +703,13 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
+        // Rescan if there is a bad transaction record
+        bool fAllTransactionsRead = true;
+
         while (true) {
             // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
             int ret = ReadAtCursor(pcursor, ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
@@ -631,8 +735,15 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             }
             if (!strErr.empty())
                 LogPrintf("%s\n", strErr);
+            if (wss.vDeferredTransactions.size() >= WALLET_TX_LOAD_BATCH_SIZE)
+                fAllTransactionsRead &= LoadDeferredTransactions(pwallet, wss);
         }
         pcursor->close();
+        fAllTransactionsRead &= LoadDeferredTransactions(pwallet, wss);
+        if (!fAllTransactionsRead) {
+            fNoncriticalErrors = true;
+            settings_.SoftSetBoolArg("-rescan", true);
+        }
     } catch (boost::thread_interrupted) {
         throw;
     } catch (...) {
@@ -708,8 +819,8 @@ DBErrors CWalletDB::FindWalletTx(CWallet* pwallet, std::vector<uint256>& vTxHash
 
         while (true) {
             // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
             int ret = ReadAtCursor(pcursor, ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
@@ -766,10 +877,14 @@ void ThreadFlushWalletDB(const string& strFile)
     // Make this thread recognisable as the wallet flushing thread
     RenameThread("izzy-wallet");
 
-    static bool fOneThread;
-    if (fOneThread)
-        return;
-    fOneThread = true;
+    // One thread per wallet file, however many times it is started
+    static CCriticalSection cs_flushedFiles;
+    static std::set<std::string> setFlushedFiles;
+    {
+        LOCK(cs_flushedFiles);
+        if (!setFlushedFiles.insert(strFile).second)
+            return;
+    }
 
     unsigned& walletDbUpdated = lockedDBUpdateMapping(strFile);
     unsigned int nLastSeen =  walletDbUpdated;
@@ -798,7 +913,7 @@ void ThreadFlushWalletDB(const string& strFile)
                     boost::this_thread::interruption_point();
                     map<string, int>::iterator mi = CDB::bitdb.mapFileUseCount.find(strFile);
                     if (mi != CDB::bitdb.mapFileUseCount.end()) {
-                        LogPrint("db", "Flushing wallet.dat\n");
+                        LogPrint(LOG_DB, "Flushing wallet.dat\n");
                         nLastFlushed = walletDbUpdated;
                         int64_t nStart = GetTimeMillis();
 
@@ -807,7 +922,7 @@ void ThreadFlushWalletDB(const string& strFile)
                         CDB::bitdb.CheckpointLSN(strFile);
 
                         CDB::bitdb.mapFileUseCount.erase(mi++);
-                        LogPrint("db", "Flushed wallet.dat %dms\n", GetTimeMillis() - nStart);
+                        LogPrint(LOG_DB, "Flushed wallet.dat %dms\n", GetTimeMillis() - nStart);
                     }
                 }
             }
@@ -910,8 +1025,8 @@ bool CWalletDB::Recover(
     DbTxn* ptxn = dbenv.TxnBegin();
     BOOST_FOREACH (CDBEnv::KeyValPair& row, salvagedData) {
         if (fOnlyKeys) {
-            CDataStream ssKey(row.first, SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(row.second, SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(row.first, SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(row.second, SER_DISK, CLIENT_VERSION);
             string strType, strErr;
             bool fReadOK = ReadKeyValue(&dummyWallet, ssKey, ssValue,
                 wss, strType, strErr);
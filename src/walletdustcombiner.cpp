@@ -11,108 +11,181 @@
 #include <version.h>
 #include <FeeRate.h>
 #include <FeeAndPriorityCalculator.h>
+#include <txmempool.h>
+#include <defaultValues.h>
+#include <ThreadManagementHelpers.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/thread.hpp>
 
 extern CWallet* pwalletMain;
+extern CTxMemPool mempool;
+
+//! The outpoint, sequence number and scriptSig length every input takes besides its scriptSig
+constexpr unsigned inputBytesBesidesScriptSig = 41u;
+constexpr unsigned costOfMaybeIncludingChangeAddress = 34u;
 
-static CAmount FeeEstimates(
-    const CFeeRate& feeRate,
-    const CKeyStore& keyStore,
-    const std::vector<std::pair<CScript, CAmount> >& intendedDestinations,
-    const std::vector<COutput>& outputsToCombine)
+static unsigned SizeWithoutInputs(const std::vector<std::pair<CScript, CAmount> >& intendedDestinations)
 {
-    constexpr unsigned costOfMaybeIncludingChangeAddress = 34u;
     CMutableTransaction txNew;
     txNew.vout.clear();
     for(const std::pair<CScript, CAmount>& s: intendedDestinations)
     {
         txNew.vout.emplace_back(s.second,s.first);
     }
-    const unsigned initialTxSize = ::GetSerializeSize(CTransaction(txNew),SER_NETWORK,PROTOCOL_VERSION);
-    SignatureSizeEstimator estimator;
-    unsigned scriptSigSize = 0u;
-    for(const auto& output: outputsToCombine)
+    return ::GetSerializeSize(CTransaction(txNew),SER_NETWORK,PROTOCOL_VERSION) + costOfMaybeIncludingChangeAddress;
+}
+
+struct CompareCoinValues {
+    bool operator()(const COutput& a, const COutput& b) const
     {
-        scriptSigSize += estimator.MaxBytesNeededForScriptSig(keyStore,output.scriptPubKey());
+        return a.Value() < b.Value();
     }
-    return feeRate.GetFee(initialTxSize + scriptSigSize + costOfMaybeIncludingChangeAddress);
-}
+};
 
 WalletDustCombiner::WalletDustCombiner(
     CWallet& wallet,
-    const CFeeRate& relayFeeRate
+    const CFeeRate& relayFeeRate,
+    const CTxMemPool& mempool
     ): wallet_(wallet)
     , relayFeeRate_(relayFeeRate)
+    , mempool_(mempool)
+    , requestMutex_()
+    , roundRequested_()
+    , fRoundRequested_(false)
 {
 }
 
+bool WalletDustCombiner::FeesAreLow() const
+{
+    // Without enough history to estimate from, the estimate is zero
+    const CFeeRate estimatedFeeRate = mempool_.estimateFee(DUST_COMBINE_FEE_ESTIMATE_BLOCKS);
+    return estimatedFeeRate.GetFeePerK() <= relayFeeRate_.GetFeePerK() * DUST_COMBINE_MAX_FEE_RATE_MULTIPLE;
+}
+
 void WalletDustCombiner::CombineDust(CAmount combineThreshold)
 {
-    if (wallet_.IsLocked()) {
+    if (wallet_.IsLocked() || combineThreshold <= 0) {
         return;
     }
 
-    std::map<CBitcoinAddress, std::vector<COutput> > mapCoinsByAddress = wallet_.AvailableCoinsByAddress(true, 0);
+    // No dust limit is applied when the threshold is beyond any amount of coins
+    const CAmount maxDustValue = (combineThreshold <= std::numeric_limits<CAmount>::max() / COIN)? combineThreshold * COIN: 0;
+    std::map<CBitcoinAddress, std::vector<COutput> > mapCoinsByAddress = wallet_.AvailableCoinsByAddress(true, maxDustValue);
 
+    unsigned transactionsSent = 0;
     //coins are sectioned by address. This combination code only wants to combine inputs that belong to the same address
-    for (std::map<CBitcoinAddress, std::vector<COutput> >::iterator it = mapCoinsByAddress.begin(); it != mapCoinsByAddress.end(); it++)
+    for (std::map<CBitcoinAddress, std::vector<COutput> >::iterator it = mapCoinsByAddress.begin();
+         it != mapCoinsByAddress.end() && transactionsSent < DUST_COMBINE_MAX_TRANSACTIONS_PER_ROUND;
+         it++)
     {
+        std::vector<COutput>& dust = it->second;
+        std::sort(dust.begin(), dust.end(), CompareCoinValues());
+
+        std::vector<std::pair<CScript, CAmount> > vecSend;
+        CScript scriptPubKey = GetScriptForDestination(it->first.Get());
+        vecSend.push_back(std::make_pair(scriptPubKey, CAmount(0)));
+        unsigned transactionSize = SizeWithoutInputs(vecSend);
+
+        // The smallest coins go in first, for as long as the transaction stays within its size budget
         std::vector<COutput> coinsToCombine;
-        //find masternode rewards that need to be combined
-        CCoinControl* coinControl = new CCoinControl();
+        CCoinControl coinControl;
         CAmount nTotalRewardsValue = 0;
-        for(const COutput& out: it->second)
+        SignatureSizeEstimator estimator;
+        for(const COutput& out: dust)
         {
             //no coins should get this far if they dont have proper maturity, this is double checking
             if (out.tx->IsCoinStake() && out.tx->GetNumberOfBlockConfirmations() < Params().COINBASE_MATURITY() + 1)
                 continue;
 
-            if (out.Value() > combineThreshold * COIN)
-                continue;
+            const unsigned inputSize = inputBytesBesidesScriptSig + estimator.MaxBytesNeededForScriptSig(wallet_,out.scriptPubKey());
+            if (transactionSize + inputSize > DUST_COMBINE_MAX_TRANSACTION_SIZE)
+                break;
 
-            COutPoint outpt(out.tx->GetHash(), out.i);
-            coinControl->Select(outpt);
+            transactionSize += inputSize;
+            coinControl.Select(COutPoint(out.tx->GetHash(), out.i));
             coinsToCombine.push_back(out);
             nTotalRewardsValue += out.Value();
         }
 
-        //if no inputs found then return
-        if (!coinControl->HasSelected())
-            continue;
-
         //we cannot combine one coin with itself
         if (coinsToCombine.size() <= 1)
             continue;
 
-        std::vector<std::pair<CScript, CAmount> > vecSend;
-        CScript scriptPubKey = GetScriptForDestination(it->first.Get());
-        CAmount expectedFee = FeeEstimates(relayFeeRate_,wallet_,vecSend,coinsToCombine);
-        vecSend.push_back(std::make_pair(scriptPubKey, nTotalRewardsValue-expectedFee));
+        const CAmount expectedFee = relayFeeRate_.GetFee(transactionSize);
+        if (expectedFee >= nTotalRewardsValue)
+            continue;
+        vecSend.back().second = nTotalRewardsValue - expectedFee;
 
         // Create the transaction and commit it to the network
         CWalletTx wtx;
         std::pair<std::string,bool> txCreationResult;
         {
-            CoinControlSelectionAlgorithm coinSelectionAlgorithm(coinControl);
+            CoinControlSelectionAlgorithm coinSelectionAlgorithm(&coinControl);
             txCreationResult = wallet_.SendMoney(vecSend, wtx, ALL_SPENDABLE_COINS,&coinSelectionAlgorithm);
         }
-        delete coinControl;
         if (!txCreationResult.second) {
             LogPrintf("CombineDust transaction failed, reason: %s\n", txCreationResult.first);
             continue;
         }
-        LogPrintf("CombineDust sent transaction\n");
+        transactionsSent++;
+        LogPrintf("CombineDust sent transaction combining %u coins\n", coinsToCombine.size());
+    }
+}
+
+void WalletDustCombiner::RequestCombination()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(requestMutex_);
+        fRoundRequested_ = true;
+    }
+    roundRequested_.notify_one();
+}
+
+void WalletDustCombiner::CombineDustWhenRequested(CAmount combineThreshold)
+{
+    while (true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(requestMutex_);
+            while (!fRoundRequested_)
+                roundRequested_.wait(lock);
+            fRoundRequested_ = false;
+        }
+
+        // A busy mempool puts the round off until a later block asks again
+        if (!FeesAreLow())
+            continue;
+
+        CombineDust(combineThreshold);
+        boost::this_thread::sleep_for(boost::chrono::seconds(DUST_COMBINE_INTERVAL));
     }
 }
 
+static WalletDustCombiner& GetWalletDustCombiner()
+{
+    static WalletDustCombiner dustCombiner(*pwalletMain,FeeAndPriorityCalculator::instance().getFeeRateQuote(),mempool);
+    return dustCombiner;
+}
+
 void combineWalletDust(const Settings& settings)
 {
     if (pwalletMain) {
         // If turned on Auto Combine will scan wallet for dust to combine
         if (settings.ParameterIsSet("-combinethreshold"))
         {
-            static WalletDustCombiner dustCombiner(*pwalletMain,FeeAndPriorityCalculator::instance().getFeeRateQuote());
-            dustCombiner.CombineDust(
-                settings.GetArg("-combinethreshold",std::numeric_limits<int64_t>::max() ) );
+            GetWalletDustCombiner().RequestCombination();
         }
     }
-}
\ No newline at end of file
+}
+
+void ThreadCombineWalletDust(const Settings& settings)
+{
+    if (!pwalletMain || !settings.ParameterIsSet("-combinethreshold"))
+        return;
+    RenameThread("izzy-dustcombiner");
+    GetWalletDustCombiner().CombineDustWhenRequested(
+        settings.GetArg("-combinethreshold",std::numeric_limits<int64_t>::max() ) );
+}
@@ -1,17 +1,45 @@
 #ifndef WALLET_DUST_COMBINER_H
 #define WALLET_DUST_COMBINER_H
 #include <amount.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
 class CWallet;
 class Settings;
 class CFeeRate;
+class CTxMemPool;
+
+/**
+ * Combines the wallet's dust, per address, into transactions as large as the
+ * size budget allows, starting from the smallest coins.
+ *
+ * Rounds run on their own thread when a new block asks for one, at most once
+ * every DUST_COMBINE_INTERVAL seconds, sending up to
+ * DUST_COMBINE_MAX_TRANSACTIONS_PER_ROUND transactions, and are put off while
+ * the mempool's fee estimate is well above the relay fee.
+ */
 class WalletDustCombiner
 {
 private:
     CWallet& wallet_;
     const CFeeRate& relayFeeRate_;
+    const CTxMemPool& mempool_;
+    boost::mutex requestMutex_;
+    boost::condition_variable roundRequested_;
+    bool fRoundRequested_;
+
+    bool FeesAreLow() const;
 public:
-    WalletDustCombiner(CWallet& wallet,const CFeeRate& relayFeeRate);
+    WalletDustCombiner(CWallet& wallet,const CFeeRate& relayFeeRate,const CTxMemPool& mempool);
+    //! Sends the transactions of one round right away
     void CombineDust(CAmount combineThreshold);
+    //! Has the combining thread run a round when it is next due, without the caller waiting on it
+    void RequestCombination();
+    //! Runs the requested rounds until the thread is interrupted
+    void CombineDustWhenRequested(CAmount combineThreshold);
 };
 void combineWalletDust(const Settings& settings);
-#endif // WALLET_DUST_COMBINER_H
\ No newline at end of file
+//! Combine the wallet's dust in the background, if -combinethreshold is set
+void ThreadCombineWalletDust(const Settings& settings);
+#endif // WALLET_DUST_COMBINER_H
@@ -24,3 +24,23 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyWalletTransaction(const uint256 &/*hash*/, int /*status*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyStake(const uint256 &/*hashBlock*/, const CTransaction &/*coinstake*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMasternodeStatus(const COutPoint &/*collateral*/, int /*state*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifySporkChange(int /*nSporkID*/, const std::string &/*strValue*/, int64_t /*nTimeSigned*/)
+{
+    return true;
+}
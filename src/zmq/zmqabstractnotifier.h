@@ -9,13 +9,17 @@
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+class CZMQSender;
+
+/** Default outbound message high water mark of the sockets, as used by libzmq */
+static const int DEFAULT_ZMQ_SNDHWM = 1000;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
 {
 public:
-    CZMQAbstractNotifier() : psocket(0) { }
+    CZMQAbstractNotifier() : psocket(0), psender(0), outbound_message_high_water_mark(DEFAULT_ZMQ_SNDHWM) { }
     virtual ~CZMQAbstractNotifier();
 
     template <typename T>
@@ -28,6 +32,14 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    int GetOutboundMessageHighWaterMark() const { return outbound_message_high_water_mark; }
+    void SetOutboundMessageHighWaterMark(const int sndhwm) {
+        if (sndhwm >= 0) {
+            outbound_message_high_water_mark = sndhwm;
+        }
+    }
+    //! The thread the messages go out from, set before the first notification
+    void SetSender(CZMQSender *s) { psender = s; }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
@@ -35,11 +47,20 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
+    //! A wallet transaction was added (CT_NEW), updated (CT_UPDATED) or removed (CT_DELETED)
+    virtual bool NotifyWalletTransaction(const uint256 &hash, int status);
+    //! The wallet staked the block
+    virtual bool NotifyStake(const uint256 &hashBlock, const CTransaction &coinstake);
+    //! A masternode was added or changed state
+    virtual bool NotifyMasternodeStatus(const COutPoint &collateral, int state);
+    virtual bool NotifySporkChange(int nSporkID, const std::string &strValue, int64_t nTimeSigned);
 
 protected:
     void *psocket;
+    CZMQSender *psender;
     std::string type;
     std::string address;
+    int outbound_message_high_water_mark; // aka SNDHWM
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
@@ -5,15 +5,22 @@
 #include <zmq/zmqnotificationinterface.h>
 
 #include <zmq/zmqpublishnotifier.h>
+#include <zmq/zmqsender.h>
 #include <Settings.h>
 #include <Logging.h>
+#ifdef ENABLE_WALLET
+#include <wallet.h>
+#include <WalletTx.h>
+#endif
+
+#include <boost/bind.hpp>
 
 void zmqError(const char *str)
 {
-    LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
+    LogPrint(LOG_ZMQ, "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL), psender(NULL), pwallet(NULL)
 {
 }
 
@@ -39,6 +46,11 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubrawtxlock"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionLockNotifier>;
+    factories["pubwallettx"] = CZMQAbstractNotifier::Create<CZMQPublishWalletTransactionNotifier>;
+    factories["pubstake"] = CZMQAbstractNotifier::Create<CZMQPublishStakeNotifier>;
+    factories["pubmasternodestatus"] = CZMQAbstractNotifier::Create<CZMQPublishMasternodeStatusNotifier>;
+    factories["publotterywinner"] = CZMQAbstractNotifier::Create<CZMQPublishLotteryWinnerNotifier>;
+    factories["pubsporkchange"] = CZMQAbstractNotifier::Create<CZMQPublishSporkChangeNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -49,6 +61,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            notifier->SetOutboundMessageHighWaterMark(settings.GetArg("-zmq" + i->first + "hwm", DEFAULT_ZMQ_SNDHWM));
             notifiers.push_back(notifier);
         }
     }
@@ -71,7 +84,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
 // Called at startup to conditionally set up ZMQ socket(s)
 bool CZMQNotificationInterface::Initialize()
 {
-    LogPrint("zmq", "zmq: Initialize notification interface\n");
+    LogPrint(LOG_ZMQ, "zmq: Initialize notification interface\n");
     assert(!pcontext);
 
     pcontext = zmq_init(1);
@@ -88,11 +101,11 @@ bool CZMQNotificationInterface::Initialize()
         CZMQAbstractNotifier *notifier = *i;
         if (notifier->Initialize(pcontext))
         {
-            LogPrint("zmq", "  Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+            LogPrint(LOG_ZMQ, "  Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
         }
         else
         {
-            LogPrint("zmq", "  Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+            LogPrint(LOG_ZMQ, "  Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
             break;
         }
     }
@@ -102,19 +115,39 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    // All sockets are used from the sender thread only from here on
+    psender = new CZMQSender();
+    for (i = notifiers.begin(); i != notifiers.end(); ++i)
+    {
+        (*i)->SetSender(psender);
+    }
+    psender->Start();
+
+    uiInterface.NotifyMasternodeChanged.connect(boost::bind(&CZMQNotificationInterface::NotifyMasternodeChanged, this, _1, _2));
+    uiInterface.NotifySporkChanged.connect(boost::bind(&CZMQNotificationInterface::NotifySporkChanged, this, _1, _2, _3));
+
     return true;
 }
 
 // Called during shutdown sequence
 void CZMQNotificationInterface::Shutdown()
 {
-    LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    LogPrint(LOG_ZMQ, "zmq: Shutdown notification interface\n");
+    DisconnectWallet();
+    uiInterface.NotifyMasternodeChanged.disconnect(boost::bind(&CZMQNotificationInterface::NotifyMasternodeChanged, this, _1, _2));
+    uiInterface.NotifySporkChanged.disconnect(boost::bind(&CZMQNotificationInterface::NotifySporkChanged, this, _1, _2, _3));
+    if (psender)
+    {
+        psender->Stop();
+        delete psender;
+        psender = NULL;
+    }
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
-            LogPrint("zmq", "   Shutdown notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
+            LogPrint(LOG_ZMQ, "   Shutdown notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
             notifier->Shutdown();
         }
         zmq_ctx_destroy(pcontext);
@@ -123,29 +156,33 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+void CZMQNotificationInterface::ConnectWallet(CWallet *pwalletIn)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+#ifdef ENABLE_WALLET
+    DisconnectWallet();
+    pwallet = pwalletIn;
+    pwallet->NotifyTransactionChanged.connect(boost::bind(&CZMQNotificationInterface::NotifyWalletTransactionChanged, this, _1, _2, _3));
+#endif
+}
+
+void CZMQNotificationInterface::DisconnectWallet()
+{
+#ifdef ENABLE_WALLET
+    if (pwallet)
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
+        pwallet->NotifyTransactionChanged.disconnect(boost::bind(&CZMQNotificationInterface::NotifyWalletTransactionChanged, this, _1, _2, _3));
+        pwallet = NULL;
     }
+#endif
 }
 
-void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+void CZMQNotificationInterface::Publish(const boost::function<bool(CZMQAbstractNotifier*)> &notify)
 {
+    boost::unique_lock<boost::mutex> lock(notifiersMutex);
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+        if (notify(notifier))
         {
             i++;
         }
@@ -157,19 +194,43 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
     }
 }
 
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifyBlock, _1, pindex));
+}
+
+void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifyTransaction, _1, boost::cref(tx)));
+}
+
 void CZMQNotificationInterface::NotifyTransactionLock(const CTransaction &tx)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransactionLock(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifyTransactionLock, _1, boost::cref(tx)));
+}
+
+// Called with the wallet lock held
+void CZMQNotificationInterface::NotifyWalletTransactionChanged(CWallet *pwalletIn, const uint256 &hash, ChangeType status)
+{
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifyWalletTransaction, _1, boost::cref(hash), (int)status));
+#ifdef ENABLE_WALLET
+    if (status != CT_NEW)
+        return;
+    LOCK(pwalletIn->cs_wallet);
+    const CWalletTx *wtx = pwalletIn->GetWalletTx(hash);
+    // A coinstake of someone else's may pay this wallet too, as the lottery does
+    if (!wtx || !wtx->IsCoinStake() || wtx->hashBlock == 0 || pwalletIn->IsMine(wtx->vin[0]) == ISMINE_NO)
+        return;
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifyStake, _1, boost::cref(wtx->hashBlock), boost::cref(*wtx)));
+#endif
+}
+
+void CZMQNotificationInterface::NotifyMasternodeChanged(const COutPoint &collateral, int state)
+{
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifyMasternodeStatus, _1, boost::cref(collateral), state));
+}
+
+void CZMQNotificationInterface::NotifySporkChanged(int nSporkID, const std::string &strValue, int64_t nTimeSigned)
+{
+    Publish(boost::bind(&CZMQAbstractNotifier::NotifySporkChange, _1, nSporkID, boost::cref(strValue), nTimeSigned));
 }
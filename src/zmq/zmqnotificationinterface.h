@@ -6,11 +6,18 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "NotificationInterface.h"
+#include "ui_interface.h"
 #include <string>
 #include <map>
 
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
 class CBlockIndex;
+class COutPoint;
+class CWallet;
 class CZMQAbstractNotifier;
+class CZMQSender;
 class Settings;
 
 class CZMQNotificationInterface : public NotificationInterface
@@ -20,6 +27,10 @@ public:
 
     static CZMQNotificationInterface* CreateWithArguments(const Settings &settings);
 
+    //! Publish the transactions and stakes of the wallet, until it is disconnected or this shuts down
+    void ConnectWallet(CWallet *pwalletIn);
+    void DisconnectWallet();
+
 protected:
     bool Initialize();
     void Shutdown();
@@ -32,7 +43,18 @@ protected:
 private:
     CZMQNotificationInterface();
 
+    //! Hands the event to each notifier, shutting down those that fail
+    void Publish(const boost::function<bool(CZMQAbstractNotifier*)> &notify);
+
+    void NotifyWalletTransactionChanged(CWallet *pwalletIn, const uint256 &hash, ChangeType status);
+    void NotifyMasternodeChanged(const COutPoint &collateral, int state);
+    void NotifySporkChanged(int nSporkID, const std::string &strValue, int64_t nTimeSigned);
+
     void *pcontext;
+    CZMQSender *psender;
+    CWallet *pwallet;
+    //! Events now come from the network and wallet threads as well as from validation
+    boost::mutex notifiersMutex;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
 
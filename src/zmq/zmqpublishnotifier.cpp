@@ -4,15 +4,19 @@
 
 #include "chainparams.h"
 #include "zmqpublishnotifier.h"
+#include "zmqsender.h"
 #include "Logging.h"
-#include "crypto/common.h"
-#include "BlockDiskAccessor.h"
 #include <chain.h>
 #include <streams.h>
-#include <version.h>
 #include <sync.h>
+#include <version.h>
+#include <SuperblockSubsidyContainer.h>
+#include <I_SuperblockHeightValidator.h>
+
+#include <boost/thread/mutex.hpp>
 
 extern CCriticalSection cs_main;
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK  = "hashblock";
@@ -21,45 +25,34 @@ static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_WALLETTX   = "walletTx";
+static const char *MSG_STAKE      = "stake";
+static const char *MSG_MASTERNODESTATUS = "masternodeStatus";
+static const char *MSG_LOTTERYWINNER    = "lotteryWinner";
+static const char *MSG_SPORKCHANGE      = "sporkChange";
 
-// Internal function to send multipart message
-static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+static std::shared_ptr<const std::vector<unsigned char> > Serialized(const CDataStream &ss)
 {
-    va_list args;
-    va_start(args, size);
-
-    while (1)
-    {
-        zmq_msg_t msg;
-
-        int rc = zmq_msg_init_size(&msg, size);
-        if (rc != 0)
-        {
-            zmqError("Unable to initialize ZMQ msg");
-            return -1;
-        }
-
-        void *buf = zmq_msg_data(&msg);
-        memcpy(buf, data, size);
-
-        data = va_arg(args, const void*);
-
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
-        if (rc == -1)
-        {
-            zmqError("Unable to send ZMQ msg");
-            zmq_msg_close(&msg);
-            return -1;
-        }
-
-        zmq_msg_close(&msg);
+    return std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+}
 
-        if (!data)
-            break;
+/** The serialization of the transaction last notified, shared by all the notifiers sending it */
+static std::shared_ptr<const std::vector<unsigned char> > SerializedTransaction(const CTransaction &transaction)
+{
+    static boost::mutex mutex;
+    static uint256 hashLast;
+    static std::shared_ptr<const std::vector<unsigned char> > dataLast;
 
-        size = va_arg(args, size_t);
+    const uint256 hash = transaction.GetHash();
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (!dataLast || hash != hashLast)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << transaction;
+        dataLast = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+        hashLast = hash;
     }
-    return 0;
+    return dataLast;
 }
 
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
@@ -78,7 +71,17 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        LogPrint(LOG_ZMQ, "zmq: Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
+
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &outbound_message_high_water_mark, sizeof(outbound_message_high_water_mark));
+        if (rc != 0)
+        {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -92,7 +95,7 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
     }
     else
     {
-        LogPrint("zmq", "zmq: Reusing socket for address %s\n", address);
+        LogPrint(LOG_ZMQ, "zmq: Reusing socket for address %s\n", address);
 
         psocket = i->second->psocket;
         mapPublishNotifiers.insert(std::make_pair(address, this));
@@ -122,7 +125,7 @@ void CZMQAbstractPublishNotifier::Shutdown()
 
     if (count == 1)
     {
-        LogPrint("zmq", "Close socket at address %s\n", address);
+        LogPrint(LOG_ZMQ, "Close socket at address %s\n", address);
         int linger = 0;
         zmq_setsockopt(psocket, ZMQ_LINGER, &linger, sizeof(linger));
         zmq_close(psocket);
@@ -132,26 +135,46 @@ void CZMQAbstractPublishNotifier::Shutdown()
 }
 
 bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    return SendMessage(command, std::make_shared<const std::vector<unsigned char> >(bytes, bytes + size));
+}
+
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const std::shared_ptr<const std::vector<unsigned char> >& data)
 {
     assert(psocket);
+    assert(psender);
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
-        return false;
+    CZMQSender::Message message;
+    message.psocket = psocket;
+    message.command = command;
+    message.data = data;
+    /* the sequence number is used up even by a dropped message, so subscribers see the gap */
+    message.nSequence = nSequence++;
+    psender->Enqueue(message);
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    // A full queue drops the message but keeps the notifier publishing
+    return true;
+}
 
+bool CZMQAbstractPublishNotifier::SendBlockMessage(const char *command, const CBlockIndex *pindex)
+{
+    assert(psocket);
+    assert(psender);
+
+    CZMQSender::Message message;
+    message.psocket = psocket;
+    message.command = command;
+    message.pindex = pindex;
+    message.nSequence = nSequence++;
+    psender->Enqueue(message);
     return true;
 }
 
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
-    LogPrint("zmq", "zmq: Publish hashblock %s\n", hash);
+    LogPrint(LOG_ZMQ, "zmq: Publish hashblock %s\n", hash);
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
@@ -161,7 +184,7 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
-    LogPrint("zmq", "zmq: Publish hashtx %s\n", hash);
+    LogPrint(LOG_ZMQ, "zmq: Publish hashtx %s\n", hash);
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
@@ -171,7 +194,7 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
 bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
-    LogPrint("zmq", "zmq: Publish hashtxlock %s\n", hash);
+    LogPrint(LOG_ZMQ, "zmq: Publish hashtxlock %s\n", hash);
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
@@ -180,40 +203,69 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
 
 bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
-    LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash());
+    LogPrint(LOG_ZMQ, "zmq: Publish rawblock %s\n", pindex->GetBlockHash());
+    return SendBlockMessage(MSG_RAWBLOCK, pindex);
+}
 
-// XX42    const Consensus::Params& consensusParams = Params().GetConsensus();
+bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(LOG_ZMQ, "zmq: Publish rawtx %s\n", hash);
+    return SendMessage(MSG_RAWTX, SerializedTransaction(transaction));
+}
+
+bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(LOG_ZMQ, "zmq: Publish rawtxlock %s\n", hash);
+    return SendMessage(MSG_RAWTXLOCK, SerializedTransaction(transaction));
+}
+
+bool CZMQPublishWalletTransactionNotifier::NotifyWalletTransaction(const uint256 &hash, int status)
+{
+    LogPrint(LOG_ZMQ, "zmq: Publish walletTx %s\n", hash);
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-// XX42        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        if(!ReadBlockFromDisk(block, pindex))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
+    ss << hash << (unsigned char)status;
+    return SendMessage(MSG_WALLETTX, Serialized(ss));
+}
 
-        ss << block;
-    }
+bool CZMQPublishStakeNotifier::NotifyStake(const uint256 &hashBlock, const CTransaction &coinstake)
+{
+    LogPrint(LOG_ZMQ, "zmq: Publish stake %s\n", hashBlock);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hashBlock << coinstake.GetHash() << coinstake.GetValueOut();
+    return SendMessage(MSG_STAKE, Serialized(ss));
+}
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+bool CZMQPublishMasternodeStatusNotifier::NotifyMasternodeStatus(const COutPoint &collateral, int state)
+{
+    LogPrint(LOG_ZMQ, "zmq: Publish masternodeStatus %s\n", collateral.ToString());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << collateral << state;
+    return SendMessage(MSG_MASTERNODESTATUS, Serialized(ss));
 }
 
-bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishLotteryWinnerNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
-    uint256 hash = transaction.GetHash();
-    LogPrint("zmq", "zmq: Publish rawtx %s\n", hash);
+    static const SuperblockSubsidyContainer superblockSubsidies(Params());
+    if (!pindex->pprev || !superblockSubsidies.superblockHeightValidator().IsValidLotteryBlockHeight(pindex->nHeight))
+        return true;
+
+    LogPrint(LOG_ZMQ, "zmq: Publish lotteryWinner %s\n", pindex->GetBlockHash());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    ss << pindex->GetBlockHash() << pindex->nHeight;
+    {
+        // The winners paid by a lottery block are the standings as of the block before it
+        LOCK(cs_main);
+        ss << pindex->pprev->vLotteryWinnersCoinstakes.getLotteryCoinstakes();
+    }
+    return SendMessage(MSG_LOTTERYWINNER, Serialized(ss));
 }
 
-bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
+bool CZMQPublishSporkChangeNotifier::NotifySporkChange(int nSporkID, const std::string &strValue, int64_t nTimeSigned)
 {
-    uint256 hash = transaction.GetHash();
-    LogPrint("zmq", "zmq: Publish rawtxlock %s\n", hash);
+    LogPrint(LOG_ZMQ, "zmq: Publish sporkChange %d\n", nSporkID);
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << transaction;
-    return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
+    ss << nSporkID << strValue << nTimeSigned;
+    return SendMessage(MSG_SPORKCHANGE, Serialized(ss));
 }
@@ -7,6 +7,9 @@
 
 #include <zmq/zmqabstractnotifier.h>
 
+#include <memory>
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
@@ -14,15 +17,21 @@ class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 private:
     uint32_t nSequence; // upcounting per message sequence number
 
+protected:
+    //! Queue the raw data of the block to be read and sent by the sender thread
+    bool SendBlockMessage(const char *command, const CBlockIndex *pindex);
+
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0) { }
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the sender thread
        parts:
           * command
           * data
           * message sequence number
     */
     bool SendMessage(const char *command, const void* data, size_t size);
+    bool SendMessage(const char *command, const std::shared_ptr<const std::vector<unsigned char> >& data);
 
     bool Initialize(void *pcontext);
     void Shutdown();
@@ -64,4 +73,38 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction) override;
 };
 
+/* The notifiers below publish wallet and masternode events, so that
+   integrations need not poll for them. Their bodies are serialized
+   like the P2P messages are, hashes included. */
+
+class CZMQPublishWalletTransactionNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyWalletTransaction(const uint256 &hash, int status) override;
+};
+
+class CZMQPublishStakeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyStake(const uint256 &hashBlock, const CTransaction &coinstake) override;
+};
+
+class CZMQPublishMasternodeStatusNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeStatus(const COutPoint &collateral, int state) override;
+};
+
+class CZMQPublishLotteryWinnerNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlock(const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishSporkChangeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifySporkChange(int nSporkID, const std::string &strValue, int64_t nTimeSigned) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,157 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zmqsender.h"
+
+#include "BlockDiskAccessor.h"
+#include "Logging.h"
+#include "ThreadManagementHelpers.h"
+#include "crypto/common.h"
+#include <chain.h>
+#include <streams.h>
+#include <sync.h>
+#include <version.h>
+
+#include <boost/bind.hpp>
+
+extern CCriticalSection cs_main;
+
+// Internal function to send multipart message
+static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+{
+    va_list args;
+    va_start(args, size);
+
+    while (1)
+    {
+        zmq_msg_t msg;
+
+        int rc = zmq_msg_init_size(&msg, size);
+        if (rc != 0)
+        {
+            zmqError("Unable to initialize ZMQ msg");
+            va_end(args);
+            return -1;
+        }
+
+        void *buf = zmq_msg_data(&msg);
+        memcpy(buf, data, size);
+
+        data = va_arg(args, const void*);
+
+        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
+        if (rc == -1)
+        {
+            zmqError("Unable to send ZMQ msg");
+            zmq_msg_close(&msg);
+            va_end(args);
+            return -1;
+        }
+
+        zmq_msg_close(&msg);
+
+        if (!data)
+            break;
+
+        size = va_arg(args, size_t);
+    }
+    va_end(args);
+    return 0;
+}
+
+CZMQSender::CZMQSender(size_t nMaxQueuedIn) : nMaxQueued(nMaxQueuedIn), fRunning(false), nDropped(0)
+{
+}
+
+CZMQSender::~CZMQSender()
+{
+    Stop();
+}
+
+void CZMQSender::Start()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (fRunning)
+        return;
+    fRunning = true;
+    thread = boost::thread(boost::bind(&CZMQSender::ThreadSend, this));
+}
+
+void CZMQSender::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (!fRunning)
+            return;
+        fRunning = false;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+bool CZMQSender::Enqueue(const Message& message)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (!fRunning || queue.size() >= nMaxQueued)
+        {
+            if (nDropped++ % 100 == 0)
+                LogPrint(LOG_ZMQ, "zmq: Send queue full, %u messages dropped so far\n", nDropped);
+            return false;
+        }
+        queue.push_back(message);
+    }
+    condition.notify_one();
+    return true;
+}
+
+void CZMQSender::ThreadSend()
+{
+    RenameThread("izzy-zmqsend");
+    while (true)
+    {
+        Message message;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (fRunning && queue.empty())
+                condition.wait(lock);
+            // Publishing never blocks, so the queue is still sent out when stopping
+            if (queue.empty())
+                return;
+            message = queue.front();
+            queue.pop_front();
+        }
+        Send(message);
+    }
+}
+
+bool CZMQSender::Send(const Message& message)
+{
+    std::shared_ptr<const std::vector<unsigned char> > data = message.data;
+    if (!data && message.pindex)
+    {
+        // The block is passed on as stored, without deserializing and reserializing it
+        CDiskBlockPos pos;
+        {
+            LOCK(cs_main);
+            pos = message.pindex->GetBlockPos();
+        }
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        if (!ReadRawBlockFromDisk(ss, pos))
+        {
+            zmqError("Can't read block from disk");
+            return false;
+        }
+        data = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+    }
+    if (!data)
+        return false;
+
+    /* send three parts, command & data & a LE 4byte sequence number */
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], message.nSequence);
+    const void* payload = data->empty() ? (const void*)msgseq : (const void*)&(*data)[0];
+    int rc = zmq_send_multipart(message.psocket, message.command, strlen(message.command), payload, data->size(), msgseq, (size_t)sizeof(uint32_t), (void*)0);
+    return rc != -1;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ZMQ_ZMQSENDER_H
+#define BITCOIN_ZMQ_ZMQSENDER_H
+
+#include "zmqconfig.h"
+
+#include <deque>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class CBlockIndex;
+
+/** Messages waiting for the sender thread, beyond which new ones are dropped */
+static const size_t MAX_ZMQ_SEND_QUEUE = 1000;
+
+/**
+ * Sends the messages of the publish notifiers from a thread of its own.
+ *
+ * Notifications are queued as they come in from validation, so neither a
+ * slow subscriber nor reading a large block adds to the time it takes to
+ * connect a block. Once the queue is full messages are dropped; their
+ * sequence numbers are used up all the same, so subscribers can tell.
+ */
+class CZMQSender
+{
+public:
+    struct Message {
+        void* psocket;
+        const char* command;
+        //! Serialized once and shared by every notifier sending the same payload
+        std::shared_ptr<const std::vector<unsigned char> > data;
+        //! Block to read the raw data of in the sender thread, when there is no data yet
+        const CBlockIndex* pindex;
+        uint32_t nSequence;
+
+        Message() : psocket(0), command(0), data(), pindex(0), nSequence(0) {}
+    };
+
+private:
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    std::deque<Message> queue;
+    const size_t nMaxQueued;
+    bool fRunning;
+    uint64_t nDropped;
+    boost::thread thread;
+
+    void ThreadSend();
+    static bool Send(const Message& message);
+
+public:
+    explicit CZMQSender(size_t nMaxQueuedIn = MAX_ZMQ_SEND_QUEUE);
+    ~CZMQSender();
+
+    void Start();
+    //! Sends what is still queued, then stops the thread, before the sockets are closed
+    void Stop();
+    //! False if the message was dropped for the queue being full
+    bool Enqueue(const Message& message);
+};
+
+#endif // BITCOIN_ZMQ_ZMQSENDER_H